@@ -31,6 +31,8 @@
 enum {
     MP_SPI_IOCTL_INIT,
     MP_SPI_IOCTL_DEINIT,
+    MP_SPI_IOCTL_BUS_ACQUIRE,
+    MP_SPI_IOCTL_BUS_RELEASE,
 };
 
 typedef struct _mp_spi_proto_t {
@@ -164,6 +164,10 @@ void cyw43_cb_process_ethernet(void *cb_data, int itf, size_t len, const uint8_t
         cyw43_ethernet_trace(self, netif, len, buf, NETUTILS_TRACE_NEWLINE);
     }
     if (netif->flags & NETIF_FLAG_LINK_UP) {
+        // buf is the low-level driver's bus buffer, which it reuses once this
+        // returns, so the frame must be copied: lwIP can keep hold of a pbuf
+        // after input returns (out-of-order TCP segments, socket receive
+        // queues), so a PBUF_REF pointing at buf isn't safe.
         struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
         if (p != NULL) {
             pbuf_take(p, buf, len);
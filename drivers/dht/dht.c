@@ -37,6 +37,13 @@
 #define mp_hal_pin_od_high_dht mp_hal_pin_od_high
 #endif
 
+#if defined(mp_hal_pin_capture_start)
+// falling edges: the response, then the start of each of the 40 bits and the
+// low that ends the last one
+#define DHT_EDGES (42)
+#define DHT_TIMEOUT_MS (10)
+#endif
+
 STATIC mp_obj_t dht_readinto(mp_obj_t pin_in, mp_obj_t buf_in) {
     mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(pin_in);
     mp_hal_pin_open_drain(pin);
@@ -54,6 +61,34 @@ STATIC mp_obj_t dht_readinto(mp_obj_t pin_in, mp_obj_t buf_in) {
     mp_hal_pin_od_low(pin);
     mp_hal_delay_ms(18);
 
+    #if defined(mp_hal_pin_capture_start)
+    // The port times the falling edges in the background, with interrupts
+    // left on.  The response starts with one, the next starts the first bit,
+    // and each bit is 50us low then 26us (0) or 70us (1) high, so the time
+    // from one falling edge to the next gives the bit.
+    uint32_t edges[DHT_EDGES];
+    int ret = mp_hal_pin_capture_start(pin, edges, DHT_EDGES);
+    if (ret != 0) {
+        mp_raise_OSError(ret);
+    }
+    // release the line so the device can respond
+    mp_hal_pin_od_high_dht(pin);
+    mp_uint_t t0 = mp_hal_ticks_ms();
+    // no event polling here: a KeyboardInterrupt would leave edges being
+    // written after this frame is gone
+    while (mp_hal_pin_capture_count() < DHT_EDGES && mp_hal_ticks_ms() - t0 < DHT_TIMEOUT_MS) {
+    }
+    mp_hal_pin_capture_stop();
+    if (mp_hal_pin_capture_count() < DHT_EDGES) {
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+    uint8_t *buf = bufinfo.buf;
+    for (int i = 0; i < 40; ++i) {
+        buf[i / 8] = (buf[i / 8] << 1) | (edges[i + 2] - edges[i + 1] > 98);
+    }
+    return mp_const_none;
+    #else
+
     mp_uint_t irq_state = mp_hal_quiet_timing_enter();
 
     // release the line so the device can respond
@@ -90,5 +125,6 @@ STATIC mp_obj_t dht_readinto(mp_obj_t pin_in, mp_obj_t buf_in) {
 timeout:
     mp_hal_quiet_timing_exit(irq_state);
     mp_raise_OSError(MP_ETIMEDOUT);
+    #endif
 }
 MP_DEFINE_CONST_FUN_OBJ_2(dht_readinto_obj, dht_readinto);
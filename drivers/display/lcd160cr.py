@@ -433,8 +433,21 @@ class LCD160CR:
             self.oflush()
         return self.spi
 
-    def show_framebuf(self, buf):
-        self.fast_spi().write(buf)
+    def show_framebuf(self, buf, rect=None):
+        if rect is None:
+            self.fast_spi().write(buf)
+            return
+        if not rect:
+            return
+        # send only the rows of the rectangle, eg FrameBuffer.dirty(), from a
+        # buffer the size of the screen
+        x, y, w, h = rect
+        self.set_spi_win(x, y, w, h)
+        spi = self.fast_spi()
+        buf = memoryview(buf)
+        stride = 2 * self.w
+        for i in range(y * stride + 2 * x, (y + h) * stride, stride):
+            spi.write(buf[i:i + 2 * w])
 
     def set_scroll(self, on):
         self._fcmd2('<BBB', 0x15, on)
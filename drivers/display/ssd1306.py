@@ -60,7 +60,7 @@ class SSD1306(framebuf.FrameBuffer):
             SET_DISP | 0x01): # on
             self.write_cmd(cmd)
         self.fill(0)
-        self.show()
+        self.show(True)
 
     def poweroff(self):
         self.write_cmd(SET_DISP | 0x00)
@@ -75,9 +75,22 @@ class SSD1306(framebuf.FrameBuffer):
     def invert(self, invert):
         self.write_cmd(SET_NORM_INV | (invert & 1))
 
-    def show(self):
-        x0 = 0
-        x1 = self.width - 1
+    def show(self, full=False):
+        # Only the pages and columns drawn on since the last show() are sent,
+        # as given by the framebuf's dirty box.  Pass full=True after writing
+        # to self.buffer directly, which the box doesn't see.
+        if full:
+            x, y, w, h = 0, 0, self.width, self.height
+        else:
+            box = self.dirty()
+            if not box:
+                return
+            x, y, w, h = box
+        self.dirty_reset()
+        p0 = y // 8
+        p1 = (y + h - 1) // 8
+        x0 = x
+        x1 = x + w - 1
         if self.width == 64:
             # displays with width of 64 pixels are shifted by 32
             x0 += 32
@@ -86,10 +99,15 @@ class SSD1306(framebuf.FrameBuffer):
         self.write_cmd(x0)
         self.write_cmd(x1)
         self.write_cmd(SET_PAGE_ADDR)
-        self.write_cmd(0)
-        self.write_cmd(self.pages - 1)
-        self.write_data(self.buffer)
-
+        self.write_cmd(p0)
+        self.write_cmd(p1)
+        if w == self.width:
+            self.write_data(memoryview(self.buffer)[p0 * w:(p1 + 1) * w])
+        else:
+            # the column and page window wraps to the next page by itself
+            buf = memoryview(self.buffer)
+            for p in range(p0, p1 + 1):
+                self.write_data(buf[p * self.width + x:p * self.width + x + w])
 
 class SSD1306_I2C(SSD1306):
     def __init__(self, width, height, i2c, addr=0x3c, external_vcc=False):
@@ -37,6 +37,7 @@
 #define CMD_WRSR        (0x01)
 #define CMD_WRITE       (0x02)
 #define CMD_READ        (0x03)
+#define CMD_FAST_READ   (0x0b)
 #define CMD_RDSR        (0x05)
 #define CMD_WREN        (0x06)
 #define CMD_SEC_ERASE   (0x20)
@@ -54,6 +55,8 @@ STATIC void mp_spiflash_acquire_bus(mp_spiflash_t *self) {
     const mp_spiflash_config_t *c = self->config;
     if (c->bus_kind == MP_SPIFLASH_BUS_QSPI) {
         c->bus.u_qspi.proto->ioctl(c->bus.u_qspi.data, MP_QSPI_IOCTL_BUS_ACQUIRE);
+    } else {
+        c->bus.u_spi.proto->ioctl(c->bus.u_spi.data, MP_SPI_IOCTL_BUS_ACQUIRE);
     }
 }
 
@@ -61,6 +64,8 @@ STATIC void mp_spiflash_release_bus(mp_spiflash_t *self) {
     const mp_spiflash_config_t *c = self->config;
     if (c->bus_kind == MP_SPIFLASH_BUS_QSPI) {
         c->bus.u_qspi.proto->ioctl(c->bus.u_qspi.data, MP_QSPI_IOCTL_BUS_RELEASE);
+    } else {
+        c->bus.u_spi.proto->ioctl(c->bus.u_spi.data, MP_SPI_IOCTL_BUS_RELEASE);
     }
 }
 
@@ -108,9 +113,11 @@ STATIC uint32_t mp_spiflash_read_cmd(mp_spiflash_t *self, uint8_t cmd, size_t le
 STATIC void mp_spiflash_read_data(mp_spiflash_t *self, uint32_t addr, size_t len, uint8_t *dest) {
     const mp_spiflash_config_t *c = self->config;
     if (c->bus_kind == MP_SPIFLASH_BUS_SPI) {
-        uint8_t buf[4] = {CMD_READ, addr >> 16, addr >> 8, addr};
+        // Fast read takes a dummy byte after the address but can be clocked
+        // at the full speed of the device, unlike CMD_READ
+        uint8_t buf[5] = {CMD_FAST_READ, addr >> 16, addr >> 8, addr, 0};
         mp_hal_pin_write(c->bus.u_spi.cs, 0);
-        c->bus.u_spi.proto->transfer(c->bus.u_spi.data, 4, buf, NULL);
+        c->bus.u_spi.proto->transfer(c->bus.u_spi.data, 5, buf, NULL);
         c->bus.u_spi.proto->transfer(c->bus.u_spi.data, len, dest, dest);
         mp_hal_pin_write(c->bus.u_spi.cs, 1);
     } else {
@@ -146,6 +153,10 @@ STATIC int mp_spiflash_wait_wip0(mp_spiflash_t *self) {
     return mp_spiflash_wait_sr(self, 1, 0, WAIT_SR_TIMEOUT);
 }
 
+STATIC bool mp_spiflash_busy(mp_spiflash_t *self) {
+    return mp_spiflash_read_cmd(self, CMD_RDSR, 1) & 1;
+}
+
 static inline void mp_spiflash_deepsleep_internal(mp_spiflash_t *self, int value) {
     mp_spiflash_write_cmd(self, value ? 0xb9 : 0xab); // sleep/wake
 }
@@ -189,9 +200,12 @@ void mp_spiflash_init(mp_spiflash_t *self) {
     mp_spiflash_release_bus(self);
 }
 
+STATIC int mp_spiflash_flush_wait(mp_spiflash_t *self);
+
 void mp_spiflash_deepsleep(mp_spiflash_t *self, int value) {
     if (value) {
         mp_spiflash_acquire_bus(self);
+        mp_spiflash_flush_wait(self);
     }
     mp_spiflash_deepsleep_internal(self, value);
     if (!value) {
@@ -199,7 +213,8 @@ void mp_spiflash_deepsleep(mp_spiflash_t *self, int value) {
     }
 }
 
-STATIC int mp_spiflash_erase_block_internal(mp_spiflash_t *self, uint32_t addr) {
+// Start erasing a sector, without waiting for it to finish
+STATIC int mp_spiflash_erase_block_start(mp_spiflash_t *self, uint32_t addr) {
     // enable writes
     mp_spiflash_write_cmd(self, CMD_WREN);
 
@@ -211,12 +226,21 @@ STATIC int mp_spiflash_erase_block_internal(mp_spiflash_t *self, uint32_t addr)
 
     // erase the sector
     mp_spiflash_write_cmd_addr(self, CMD_SEC_ERASE, addr);
+    return 0;
+}
+
+STATIC int mp_spiflash_erase_block_internal(mp_spiflash_t *self, uint32_t addr) {
+    int ret = mp_spiflash_erase_block_start(self, addr);
+    if (ret != 0) {
+        return ret;
+    }
 
     // wait WIP=0
     return mp_spiflash_wait_wip0(self);
 }
 
-STATIC int mp_spiflash_write_page(mp_spiflash_t *self, uint32_t addr, size_t len, const uint8_t *src) {
+// Start programming a page, without waiting for it to finish
+STATIC int mp_spiflash_write_page_start(mp_spiflash_t *self, uint32_t addr, size_t len, const uint8_t *src) {
     // enable writes
     mp_spiflash_write_cmd(self, CMD_WREN);
 
@@ -228,17 +252,47 @@ STATIC int mp_spiflash_write_page(mp_spiflash_t *self, uint32_t addr, size_t len
 
     // write the page
     mp_spiflash_write_cmd_addr_data(self, CMD_WRITE, addr, len, src);
+    return 0;
+}
+
+STATIC int mp_spiflash_write_page(mp_spiflash_t *self, uint32_t addr, size_t len, const uint8_t *src) {
+    int ret = mp_spiflash_write_page_start(self, addr, len, src);
+    if (ret != 0) {
+        return ret;
+    }
 
     // wait WIP=0
     return mp_spiflash_wait_wip0(self);
 }
 
+STATIC int mp_spiflash_cache_flush_step_internal(mp_spiflash_t *self);
+
+// Complete a stepped write back of the cache, if one is in progress, so the
+// flash can be used.  The bus must be acquired.
+STATIC int mp_spiflash_flush_wait(mp_spiflash_t *self) {
+    mp_spiflash_cache_t *cache = self->config->cache;
+    int ret = 0;
+    while (cache != NULL && cache->user == self && cache->flush != NULL) {
+        ret = mp_spiflash_wait_wip0(self);
+        if (ret == 0) {
+            ret = mp_spiflash_cache_flush_step_internal(self);
+        }
+        if (ret < 0) {
+            break;
+        }
+    }
+    return ret < 0 ? ret : 0;
+}
+
 /******************************************************************************/
 // Interface functions that go direct to the SPI flash device
 
 int mp_spiflash_erase_block(mp_spiflash_t *self, uint32_t addr) {
     mp_spiflash_acquire_bus(self);
-    int ret = mp_spiflash_erase_block_internal(self, addr);
+    int ret = mp_spiflash_flush_wait(self);
+    if (ret == 0) {
+        ret = mp_spiflash_erase_block_internal(self, addr);
+    }
     mp_spiflash_release_bus(self);
     return ret;
 }
@@ -248,15 +302,16 @@ void mp_spiflash_read(mp_spiflash_t *self, uint32_t addr, size_t len, uint8_t *d
         return;
     }
     mp_spiflash_acquire_bus(self);
+    mp_spiflash_flush_wait(self);
     mp_spiflash_read_data(self, addr, len, dest);
     mp_spiflash_release_bus(self);
 }
 
 int mp_spiflash_write(mp_spiflash_t *self, uint32_t addr, size_t len, const uint8_t *src) {
     mp_spiflash_acquire_bus(self);
-    int ret = 0;
+    int ret = mp_spiflash_flush_wait(self);
     uint32_t offset = addr & (PAGE_SIZE - 1);
-    while (len) {
+    while (len && ret == 0) {
         size_t rest = PAGE_SIZE - offset;
         if (rest > len) {
             rest = len;
@@ -277,43 +332,129 @@ int mp_spiflash_write(mp_spiflash_t *self, uint32_t addr, size_t len, const uint
 /******************************************************************************/
 // Interface functions that use the cache
 
+// Claim the cache for self, writing back and dropping what another flash
+// instance held in it.
+STATIC mp_spiflash_cache_t *mp_spiflash_cache_acquire(mp_spiflash_t *self) {
+    mp_spiflash_cache_t *cache = self->config->cache;
+    if (cache->user != self) {
+        if (cache->user != NULL) {
+            mp_spiflash_cache_flush(cache->user);
+        }
+        cache->user = self;
+        for (int i = 0; i < MP_SPIFLASH_CACHE_SLOTS; ++i) {
+            cache->slot[i].block = 0xffffffff;
+            cache->slot[i].dirty = false;
+        }
+    }
+    return cache;
+}
+
+STATIC mp_spiflash_cache_slot_t *mp_spiflash_cache_find(mp_spiflash_cache_t *cache, uint32_t sec) {
+    for (int i = 0; i < MP_SPIFLASH_CACHE_SLOTS; ++i) {
+        if (cache->slot[i].block == sec) {
+            return &cache->slot[i];
+        }
+    }
+    return NULL;
+}
+
+// A slot is loaded lazily: pages that a write covers whole are never read,
+// so a block written in a few parts, as USB mass storage writes arrive, is
+// not read from the flash before it's rewritten.  Read the pages of slot in
+// mask that it doesn't hold yet, in runs.
+STATIC void mp_spiflash_cache_fill(mp_spiflash_t *self, mp_spiflash_cache_slot_t *slot, uint32_t mask) {
+    mask &= ~slot->valid;
+    for (int i = 0; mask >> i;) {
+        if (!(mask & (1 << i))) {
+            ++i;
+            continue;
+        }
+        int n = 1;
+        while (mask & (1 << (i + n))) {
+            ++n;
+        }
+        mp_spiflash_read_data(self, slot->block * SECTOR_SIZE + i * PAGE_SIZE, n * PAGE_SIZE, slot->buf + i * PAGE_SIZE);
+        i += n;
+    }
+    slot->valid |= mask;
+}
+
+#define PAGES_ALL ((1 << (SECTOR_SIZE / PAGE_SIZE)) - 1)
+
+// Mask of the pages holding bytes offset to offset + len - 1 of a block
+STATIC uint32_t mp_spiflash_pages(uint32_t offset, size_t len) {
+    uint32_t first = offset / PAGE_SIZE;
+    uint32_t last = (offset + len - 1) / PAGE_SIZE;
+    return ((2 << last) - 1) & ~((1 << first) - 1);
+}
+
+// Erase the block held in slot and program it from the slot's buffer.
+STATIC int mp_spiflash_cache_write_slot(mp_spiflash_t *self, mp_spiflash_cache_slot_t *slot) {
+    mp_spiflash_cache_fill(self, slot, PAGES_ALL);
+    slot->dirty = false;
+
+    // Erase sector
+    int ret = mp_spiflash_erase_block_internal(self, slot->block * SECTOR_SIZE);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Write
+    for (int i = 0; i < SECTOR_SIZE / PAGE_SIZE; i += 1) {
+        uint32_t addr = slot->block * SECTOR_SIZE + i * PAGE_SIZE;
+        ret = mp_spiflash_write_page(self, addr, PAGE_SIZE, slot->buf + i * PAGE_SIZE);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
 void mp_spiflash_cached_read(mp_spiflash_t *self, uint32_t addr, size_t len, uint8_t *dest) {
     if (len == 0) {
         return;
     }
     mp_spiflash_acquire_bus(self);
+    mp_spiflash_flush_wait(self);
     mp_spiflash_cache_t *cache = self->config->cache;
-    if (cache->user == self && cache->block != 0xffffffff) {
-        uint32_t bis = addr / SECTOR_SIZE;
-        uint32_t bie = (addr + len - 1) / SECTOR_SIZE;
-        if (bis <= cache->block && cache->block <= bie) {
-            // Read straddles current buffer
-            size_t rest = 0;
-            if (bis < cache->block) {
-                // Read direct from flash for first part
-                rest = cache->block * SECTOR_SIZE - addr;
-                mp_spiflash_read_data(self, addr, rest, dest);
-                len -= rest;
-                dest += rest;
-                addr += rest;
-            }
-            uint32_t offset = addr & (SECTOR_SIZE - 1);
-            rest = SECTOR_SIZE - offset;
-            if (rest > len) {
-                rest = len;
+    if (cache->user != self) {
+        mp_spiflash_read_data(self, addr, len, dest);
+        mp_spiflash_release_bus(self);
+        return;
+    }
+    // Copy blocks held in the cache, and read runs of the others direct
+    // from flash
+    uint32_t direct_addr = addr;
+    size_t direct_len = 0;
+    uint8_t *direct_dest = dest;
+    while (len) {
+        uint32_t offset = addr & (SECTOR_SIZE - 1);
+        size_t rest = SECTOR_SIZE - offset;
+        if (rest > len) {
+            rest = len;
+        }
+        mp_spiflash_cache_slot_t *slot = mp_spiflash_cache_find(cache, addr / SECTOR_SIZE);
+        if (slot != NULL) {
+            if (direct_len) {
+                mp_spiflash_read_data(self, direct_addr, direct_len, direct_dest);
+                direct_len = 0;
             }
-            memcpy(dest, &cache->buf[offset], rest);
-            len -= rest;
-            if (len == 0) {
-                mp_spiflash_release_bus(self);
-                return;
+            mp_spiflash_cache_fill(self, slot, mp_spiflash_pages(offset, rest));
+            memcpy(dest, &slot->buf[offset], rest);
+        } else {
+            if (direct_len == 0) {
+                direct_addr = addr;
+                direct_dest = dest;
             }
-            dest += rest;
-            addr += rest;
+            direct_len += rest;
         }
+        len -= rest;
+        addr += rest;
+        dest += rest;
+    }
+    if (direct_len) {
+        mp_spiflash_read_data(self, direct_addr, direct_len, direct_dest);
     }
-    // Read rest direct from flash
-    mp_spiflash_read_data(self, addr, len, dest);
     mp_spiflash_release_bus(self);
 }
 
@@ -323,31 +464,118 @@ STATIC void mp_spiflash_cache_flush_internal(mp_spiflash_t *self) {
         return;
     }
 
+    if (mp_spiflash_flush_wait(self) != 0) {
+        return;
+    }
+
     self->flags &= ~1;
 
     mp_spiflash_cache_t *cache = self->config->cache;
+    for (int i = 0; i < MP_SPIFLASH_CACHE_SLOTS; ++i) {
+        if (cache->slot[i].dirty) {
+            if (mp_spiflash_cache_write_slot(self, &cache->slot[i]) != 0) {
+                return;
+            }
+        }
+    }
+    #endif
+}
 
-    // Erase sector
-    int ret = mp_spiflash_erase_block_internal(self, cache->block * SECTOR_SIZE);
-    if (ret != 0) {
-        return;
+void mp_spiflash_cache_flush(mp_spiflash_t *self) {
+    mp_spiflash_acquire_bus(self);
+    mp_spiflash_cache_flush_internal(self);
+    mp_spiflash_release_bus(self);
+}
+
+// Do one step of writing back the dirty slots: start the erase of a block,
+// or program its next page once the flash is ready.  The flash is only
+// polled, so a step takes no longer than a page transfer.
+STATIC int mp_spiflash_cache_flush_step_internal(mp_spiflash_t *self) {
+    mp_spiflash_cache_t *cache = self->config->cache;
+    if (!(self->flags & 1) || cache->user != self) {
+        return 0;
     }
 
-    // Write
-    for (int i = 0; i < 16; i += 1) {
-        uint32_t addr = cache->block * SECTOR_SIZE + i * PAGE_SIZE;
-        int ret = mp_spiflash_write_page(self, addr, PAGE_SIZE, cache->buf + i * PAGE_SIZE);
+    mp_spiflash_cache_slot_t *slot = cache->flush;
+    if (slot == NULL) {
+        // Start on the next dirty slot
+        for (int i = 0; i < MP_SPIFLASH_CACHE_SLOTS; ++i) {
+            if (cache->slot[i].dirty) {
+                slot = &cache->slot[i];
+                break;
+            }
+        }
+        if (slot == NULL) {
+            self->flags &= ~1;
+            return 0;
+        }
+        mp_spiflash_cache_fill(self, slot, PAGES_ALL);
+        slot->dirty = false;
+        int ret = mp_spiflash_erase_block_start(self, slot->block * SECTOR_SIZE);
         if (ret != 0) {
-            return;
+            slot->dirty = true;
+            return ret;
         }
+        cache->flush = slot;
+        cache->flush_page = 0;
+        return 1;
     }
-    #endif
+
+    if (mp_spiflash_busy(self)) {
+        return 1;
+    }
+
+    if (cache->flush_page == SECTOR_SIZE / PAGE_SIZE) {
+        // The block is written
+        cache->flush = NULL;
+        return 1;
+    }
+
+    uint32_t offset = cache->flush_page * PAGE_SIZE;
+    int ret = mp_spiflash_write_page_start(self, slot->block * SECTOR_SIZE + offset, PAGE_SIZE, slot->buf + offset);
+    if (ret != 0) {
+        cache->flush = NULL;
+        slot->dirty = true;
+        return ret;
+    }
+    cache->flush_page += 1;
+    return 1;
 }
 
-void mp_spiflash_cache_flush(mp_spiflash_t *self) {
+int mp_spiflash_cache_flush_step(mp_spiflash_t *self) {
     mp_spiflash_acquire_bus(self);
-    mp_spiflash_cache_flush_internal(self);
+    int ret = mp_spiflash_cache_flush_step_internal(self);
     mp_spiflash_release_bus(self);
+    return ret;
+}
+
+// Return the slot holding sector sec, taking the least recently used slot
+// for it if it is not there.  Its data is read as it is needed.
+STATIC mp_spiflash_cache_slot_t *mp_spiflash_cache_get_slot(mp_spiflash_t *self, uint32_t sec, int *ret) {
+    mp_spiflash_cache_t *cache = mp_spiflash_cache_acquire(self);
+    mp_spiflash_cache_slot_t *slot = mp_spiflash_cache_find(cache, sec);
+    if (slot == NULL) {
+        // Prefer an empty slot, otherwise evict the least recently used
+        slot = &cache->slot[0];
+        for (int i = 0; i < MP_SPIFLASH_CACHE_SLOTS && slot->block != 0xffffffff; ++i) {
+            mp_spiflash_cache_slot_t *s = &cache->slot[i];
+            if (s->block == 0xffffffff || cache->use_counter - s->last_use > cache->use_counter - slot->last_use) {
+                slot = s;
+            }
+        }
+        if (slot->dirty) {
+            *ret = mp_spiflash_cache_write_slot(self, slot);
+            if (*ret != 0) {
+                slot->block = 0xffffffff;
+                return NULL;
+            }
+        }
+        slot->block = sec;
+        slot->valid = 0;
+    }
+    slot->last_use = ++cache->use_counter;
+    *ret = 0;
+    return slot;
 }
 
 STATIC int mp_spiflash_cached_write_part(mp_spiflash_t *self, uint32_t addr, size_t len, const uint8_t *src) {
@@ -362,43 +590,40 @@ STATIC int mp_spiflash_cached_write_part(mp_spiflash_t *self, uint32_t addr, siz
         return -MP_EIO;
     }
 
-    mp_spiflash_cache_t *cache = self->config->cache;
-
-    // Acquire the sector buffer
-    if (cache->user != self) {
-        if (cache->user != NULL) {
-            mp_spiflash_cache_flush(cache->user);
-        }
-        cache->user = self;
-        cache->block = 0xffffffff;
-    }
-
-    if (cache->block != sec) {
-        // Read sector
-        #if USE_WR_DELAY
-        if (cache->block != 0xffffffff) {
-            mp_spiflash_cache_flush_internal(self);
-        }
-        #endif
-        mp_spiflash_read_data(self, addr, SECTOR_SIZE, cache->buf);
+    int ret;
+    mp_spiflash_cache_slot_t *slot = mp_spiflash_cache_get_slot(self, sec, &ret);
+    if (slot == NULL) {
+        return ret;
     }
 
     #if USE_WR_DELAY
 
-    cache->block = sec;
-    // Just copy to buffer
-    memcpy(cache->buf + offset, src, len);
+    // Read the pages that are only partly overwritten, then just copy to
+    // buffer; the pages written whole need never be read
+    uint32_t partial = 0;
+    if (offset % PAGE_SIZE) {
+        partial |= 1 << (offset / PAGE_SIZE);
+    }
+    if ((offset + len) % PAGE_SIZE) {
+        partial |= 1 << ((offset + len) / PAGE_SIZE);
+    }
+    mp_spiflash_cache_fill(self, slot, partial);
+    memcpy(slot->buf + offset, src, len);
+    slot->valid |= mp_spiflash_pages(offset, len);
     // And mark dirty
+    slot->dirty = true;
     self->flags |= 1;
 
     #else
 
+    mp_spiflash_cache_fill(self, slot, PAGES_ALL);
+
     uint32_t dirty = 0;
     for (size_t i = 0; i < len; ++i) {
-        if (cache->buf[offset + i] != src[i]) {
-            if (cache->buf[offset + i] != 0xff) {
+        if (slot->buf[offset + i] != src[i]) {
+            if (slot->buf[offset + i] != 0xff) {
                 // Erase sector
-                int ret = mp_spiflash_erase_block_internal(self, addr);
+                ret = mp_spiflash_erase_block_internal(self, addr);
                 if (ret != 0) {
                     return ret;
                 }
@@ -410,14 +635,13 @@ STATIC int mp_spiflash_cached_write_part(mp_spiflash_t *self, uint32_t addr, siz
         }
     }
 
-    cache->block = sec;
     // Copy new block into buffer
-    memcpy(cache->buf + offset, src, len);
+    memcpy(slot->buf + offset, src, len);
 
     // Write sector in pages of 256 bytes
     for (size_t i = 0; i < 16; ++i) {
         if (dirty & (1 << i)) {
-            int ret = mp_spiflash_write_page(self, addr + i * PAGE_SIZE, PAGE_SIZE, cache->buf + i * PAGE_SIZE);
+            ret = mp_spiflash_write_page(self, addr + i * PAGE_SIZE, PAGE_SIZE, slot->buf + i * PAGE_SIZE);
             if (ret != 0) {
                 return ret;
             }
@@ -430,62 +654,21 @@ STATIC int mp_spiflash_cached_write_part(mp_spiflash_t *self, uint32_t addr, siz
 }
 
 int mp_spiflash_cached_write(mp_spiflash_t *self, uint32_t addr, size_t len, const uint8_t *src) {
-    uint32_t bis = addr / SECTOR_SIZE;
-    uint32_t bie = (addr + len - 1) / SECTOR_SIZE;
-
     mp_spiflash_acquire_bus(self);
 
-    mp_spiflash_cache_t *cache = self->config->cache;
-    if (cache->user == self && bis <= cache->block && bie >= cache->block) {
-        // Write straddles current buffer
-        uint32_t pre;
-        uint32_t offset;
-        if (cache->block * SECTOR_SIZE >= addr) {
-            pre = cache->block * SECTOR_SIZE - addr;
-            offset = 0;
-        } else {
-            pre = 0;
-            offset = addr - cache->block * SECTOR_SIZE;
-        }
-
-        // Write buffered part first
-        uint32_t len_in_buf = len - pre;
-        len = 0;
-        if (len_in_buf > SECTOR_SIZE - offset) {
-            len = len_in_buf - (SECTOR_SIZE - offset);
-            len_in_buf = SECTOR_SIZE - offset;
-        }
-        memcpy(&cache->buf[offset], &src[pre], len_in_buf);
-        self->flags |= 1; // Mark dirty
-
-        // Write part before buffer sector
-        while (pre) {
-            int rest = pre & (SECTOR_SIZE - 1);
-            if (rest == 0) {
-                rest = SECTOR_SIZE;
-            }
-            int ret = mp_spiflash_cached_write_part(self, addr, rest, src);
-            if (ret != 0) {
-                mp_spiflash_release_bus(self);
-                return ret;
-            }
-            src += rest;
-            addr += rest;
-            pre -= rest;
-        }
-        src += len_in_buf;
-        addr += len_in_buf;
-
-        // Fall through to write remaining part
+    int ret = mp_spiflash_flush_wait(self);
+    if (ret != 0) {
+        mp_spiflash_release_bus(self);
+        return ret;
     }
 
     uint32_t offset = addr & (SECTOR_SIZE - 1);
     while (len) {
-        int rest = SECTOR_SIZE - offset;
+        size_t rest = SECTOR_SIZE - offset;
         if (rest > len) {
             rest = len;
         }
-        int ret = mp_spiflash_cached_write_part(self, addr, rest, src);
+        ret = mp_spiflash_cached_write_part(self, addr, rest, src);
         if (ret != 0) {
             mp_spiflash_release_bus(self);
             return ret;
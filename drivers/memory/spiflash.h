@@ -38,12 +38,29 @@ enum {
 
 struct _mp_spiflash_t;
 
+// Number of erase blocks held by the cache.  Writes that move between a few
+// blocks in turn, as FAT updates do, need a slot for each to avoid erasing
+// a block on every write; each slot costs MP_SPIFLASH_ERASE_BLOCK_SIZE bytes.
+#ifndef MP_SPIFLASH_CACHE_SLOTS
+#define MP_SPIFLASH_CACHE_SLOTS (1)
+#endif
+
+typedef struct _mp_spiflash_cache_slot_t {
+    uint8_t buf[MP_SPIFLASH_ERASE_BLOCK_SIZE] __attribute__((aligned(4)));
+    uint32_t block; // block stored in buf; 0xffffffff if invalid
+    uint32_t last_use; // value of the cache use counter when last used
+    uint16_t valid; // bit n set when page n of buf holds the block's data
+    bool dirty; // buf holds changes not written to the flash
+} mp_spiflash_cache_slot_t;
+
 // A cache must be provided by the user in the config struct.  The same cache
 // struct can be shared by multiple SPI flash instances.
 typedef struct _mp_spiflash_cache_t {
-    uint8_t buf[MP_SPIFLASH_ERASE_BLOCK_SIZE] __attribute__((aligned(4)));
-    struct _mp_spiflash_t *user; // current user of buf, for shared use
-    uint32_t block; // current block stored in buf; 0xffffffff if invalid
+    mp_spiflash_cache_slot_t slot[MP_SPIFLASH_CACHE_SLOTS];
+    struct _mp_spiflash_t *user; // current user of the slots, for shared use
+    uint32_t use_counter; // for least recently used eviction
+    mp_spiflash_cache_slot_t *flush; // slot being written back in steps, or NULL
+    uint32_t flush_page; // page of that slot to program next
 } mp_spiflash_cache_t;
 
 typedef struct _mp_spiflash_config_t {
@@ -64,7 +81,7 @@ typedef struct _mp_spiflash_config_t {
 
 typedef struct _mp_spiflash_t {
     const mp_spiflash_config_t *config;
-    volatile uint32_t flags;
+    volatile uint32_t flags; // bit 0 set while the cache holds unwritten changes
 } mp_spiflash_t;
 
 void mp_spiflash_init(mp_spiflash_t *self);
@@ -80,4 +97,10 @@ void mp_spiflash_cache_flush(mp_spiflash_t *self);
 void mp_spiflash_cached_read(mp_spiflash_t *self, uint32_t addr, size_t len, uint8_t *dest);
 int mp_spiflash_cached_write(mp_spiflash_t *self, uint32_t addr, size_t len, const uint8_t *src);
 
+// Write back the cache a step at a time, without waiting for the flash to
+// finish an erase or program.  Returns 1 while there is more to do (call
+// again later), 0 once the cache is clean, or a negative error code.  The
+// other functions complete a write back in progress before using the flash.
+int mp_spiflash_cache_flush_step(mp_spiflash_t *self);
+
 #endif // MICROPY_INCLUDED_DRIVERS_MEMORY_SPIFLASH_H
@@ -1,4 +1,7 @@
 """NRF24L01 driver for MicroPython
+
+Ports with machine.NRF24L01 have a faster C version of this driver, with the
+same methods, which can also receive into a buffer from the IRQ pin.
 """
 
 from micropython import const
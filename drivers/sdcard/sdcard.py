@@ -4,6 +4,9 @@ MicroPython driver for SD cards using SPI bus.
 Requires an SPI bus and a CS pin.  Provides readblocks and writeblocks
 methods so the device can be mounted as a filesystem.
 
+Ports with machine.SDCardSPI have a much faster C version of this driver,
+with the same constructor arguments.
+
 Example usage on pyboard:
 
     import pyb, sdcard, os
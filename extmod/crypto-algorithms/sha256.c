@@ -14,6 +14,7 @@
 
 /*************************** HEADER FILES ***************************/
 #include <stdlib.h>
+#include <string.h>
 #include "sha256.h"
 
 /****************************** MACROS ******************************/
@@ -40,6 +41,61 @@ static const WORD k[64] = {
 };
 
 /*********************** FUNCTION DEFINITIONS ***********************/
+#if SHA256_UNROLL
+// The rounds are unrolled so that the working variables are renamed from one
+// round to the next instead of being moved, and the message schedule is kept
+// in a ring of 16 words that is extended as the rounds go.
+#define SCHED(i) (m[(i) & 15] += SIG1(m[((i) - 2) & 15]) + m[((i) - 7) & 15] + SIG0(m[((i) - 15) & 15]))
+#define MSG(i) (m[i])
+#define ROUND(a,b,c,d,e,f,g,h,i,w) do { \
+	WORD t1 = h + EP1(e) + CH(e,f,g) + k[i] + (w); \
+	d += t1; \
+	h = t1 + EP0(a) + MAJ(a,b,c); \
+} while (0)
+#define ROUND8(i,W) do { \
+	ROUND(a,b,c,d,e,f,g,h,(i),W(i)); \
+	ROUND(h,a,b,c,d,e,f,g,(i) + 1,W((i) + 1)); \
+	ROUND(g,h,a,b,c,d,e,f,(i) + 2,W((i) + 2)); \
+	ROUND(f,g,h,a,b,c,d,e,(i) + 3,W((i) + 3)); \
+	ROUND(e,f,g,h,a,b,c,d,(i) + 4,W((i) + 4)); \
+	ROUND(d,e,f,g,h,a,b,c,(i) + 5,W((i) + 5)); \
+	ROUND(c,d,e,f,g,h,a,b,(i) + 6,W((i) + 6)); \
+	ROUND(b,c,d,e,f,g,h,a,(i) + 7,W((i) + 7)); \
+} while (0)
+
+static void sha256_transform(CRYAL_SHA256_CTX *ctx, const BYTE data[])
+{
+	WORD a, b, c, d, e, f, g, h, i, m[16];
+
+	for (i = 0; i < 16; ++i, data += 4)
+		m[i] = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | (data[3]);
+
+	a = ctx->state[0];
+	b = ctx->state[1];
+	c = ctx->state[2];
+	d = ctx->state[3];
+	e = ctx->state[4];
+	f = ctx->state[5];
+	g = ctx->state[6];
+	h = ctx->state[7];
+
+	ROUND8(0, MSG);
+	ROUND8(8, MSG);
+	for (i = 16; i < 64; i += 16) {
+		ROUND8(i, SCHED);
+		ROUND8(i + 8, SCHED);
+	}
+
+	ctx->state[0] += a;
+	ctx->state[1] += b;
+	ctx->state[2] += c;
+	ctx->state[3] += d;
+	ctx->state[4] += e;
+	ctx->state[5] += f;
+	ctx->state[6] += g;
+	ctx->state[7] += h;
+}
+#else
 static void sha256_transform(CRYAL_SHA256_CTX *ctx, const BYTE data[])
 {
 	WORD a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
@@ -80,6 +136,7 @@ static void sha256_transform(CRYAL_SHA256_CTX *ctx, const BYTE data[])
 	ctx->state[6] += g;
 	ctx->state[7] += h;
 }
+#endif
 
 void sha256_init(CRYAL_SHA256_CTX *ctx)
 {
@@ -97,11 +154,24 @@ void sha256_init(CRYAL_SHA256_CTX *ctx)
 
 void sha256_update(CRYAL_SHA256_CTX *ctx, const BYTE data[], size_t len)
 {
-	WORD i;
+	size_t n;
 
-	for (i = 0; i < len; ++i) {
-		ctx->data[ctx->datalen] = data[i];
-		ctx->datalen++;
+	while (len > 0) {
+		if (ctx->datalen == 0 && len >= 64) {
+			// Whole blocks are hashed straight from the caller's buffer.
+			sha256_transform(ctx, data);
+			ctx->bitlen += 512;
+			data += 64;
+			len -= 64;
+			continue;
+		}
+		n = 64 - ctx->datalen;
+		if (n > len)
+			n = len;
+		memcpy(ctx->data + ctx->datalen, data, n);
+		ctx->datalen += n;
+		data += n;
+		len -= n;
 		if (ctx->datalen == 64) {
 			sha256_transform(ctx, ctx->data);
 			ctx->bitlen += 512;
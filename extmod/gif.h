@@ -15,18 +15,18 @@
 #define GIF_GRAPHICCTL  	0xF9
 
 
-typedef struct __attribute__((packed))
+#define GIF_READ_SIZE		512			// read-ahead buffer for the input stream
+
+typedef struct
 {
-	uint8_t    aBuffer[258];                     // Input buffer for data block 
-	short aCode  [(1 << MAX_NUM_LWZ_BITS)]; // This array stores the LZW codes for the compressed strings 
-	uint8_t    aPrefix[(1 << MAX_NUM_LWZ_BITS)]; // Prefix character of the LZW code.
-	uint8_t    aDecompBuffer[3000];              // Decompression buffer. The higher the compression, the more bytes are needed in the buffer.
-	uint8_t *  sp;                               // Pointer into the decompression buffer 
-	int   CurBit;
-	int   LastBit;
-	int   GetDone;
-	int   LastByte;
-	int   ReturnClear;
+	uint16_t aCode  [(1 << MAX_NUM_LWZ_BITS)]; // Prefix code of each string in the table
+	uint8_t  aSuffix[(1 << MAX_NUM_LWZ_BITS)]; // Last character of each string
+	uint8_t  aStack [(1 << MAX_NUM_LWZ_BITS)]; // A decoded string, last character first; no string is longer than the table
+	uint8_t *sp;                               // Top of the characters in aStack still to be output
+	uint32_t BitBuf;                           // Bits read ahead from the data blocks, next code in the low bits
+	int   BitCnt;
+	int   BlockLeft;                           // Bytes left in the current data block
+	int   GetDone;                             // The block terminator has been read
 	int   CodeSize;
 	int   SetCodeSize;
 	int   MaxCode;
@@ -34,7 +34,7 @@ typedef struct __attribute__((packed))
 	int   ClearCode;
 	int   EndCode;
 	int   FirstCode;
-	int   OldCode;
+	int   OldCode;                             // -1 straight after a clear code
 }LZW_INFO;
 
 //逻辑屏幕描述块
@@ -59,12 +59,12 @@ typedef struct __attribute__((packed))
 }ImageScreenDescriptor;
 
 //图像描述
-typedef struct __attribute__((packed))
+typedef struct
 {
 	LogicalScreenDescriptor gifLSD;	//逻辑屏幕描述块
 	ImageScreenDescriptor gifISD;	//图像描述快
-	uint32_t colortbl[256];				//当前使用颜色表
-	uint32_t bkpcolortbl[256];			//备份颜色表.当存在局部颜色表时使用
+	uint16_t colortbl[256];				//全局颜色表, RGB565 as stored in a framebuffer
+	uint16_t *localtbl;					//局部颜色表, allocated by the first frame that has one
 	uint16_t numcolors;					//颜色表大小
 	uint16_t delay;					    //延迟时间
 	LZW_INFO *lzw;					//LZW信息
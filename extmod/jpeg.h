@@ -0,0 +1,59 @@
+#ifndef __JPEG_H__
+#define __JPEG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// markers, the byte following 0xff
+#define JPEG_SOF0       0xc0    // baseline
+#define JPEG_SOF1       0xc1    // extended sequential, decoded as baseline
+#define JPEG_DHT        0xc4
+#define JPEG_RST0       0xd0
+#define JPEG_SOI        0xd8
+#define JPEG_EOI        0xd9
+#define JPEG_SOS        0xda
+#define JPEG_DQT        0xdb
+#define JPEG_DRI        0xdd
+
+// codes up to this many bits are decoded with a single table lookup
+#define JPEG_HUFF_LOOKAHEAD 8
+
+typedef struct
+{
+    int32_t maxcode[18];                            // largest code of each length, -1 if none; maxcode[17] ends the search
+    int32_t valoff[17];                             // index in vals of the codes of each length, less the first code
+    uint8_t look_nbits[1 << JPEG_HUFF_LOOKAHEAD];   // length of the code starting with these bits, 0 if it is longer
+    uint8_t look_sym[1 << JPEG_HUFF_LOOKAHEAD];     // the symbol of that code
+    uint8_t vals[256];                              // symbols in order of code
+} jpeg_huff_t;
+
+typedef struct
+{
+    uint8_t id;
+    uint8_t h, v;           // sampling factors
+    uint8_t tq;             // quantisation table
+    uint8_t td, ta;         // DC and AC huffman tables of the scan
+    uint8_t hs, vs;         // shift from MCU pixels to samples, 0 or 1
+    uint8_t block;          // index of the first block of the component in an MCU
+    int dcpred;
+} jpeg_comp_t;
+
+// Baseline has at most two huffman tables of each class and sampling
+// factors of 1 or 2, so an MCU is at most 16x16 pixels in 6 blocks.
+typedef struct
+{
+    uint16_t qt[4][64];     // in natural order
+    jpeg_huff_t huff[4];    // DC tables 0 and 1, then AC tables 0 and 1
+    jpeg_comp_t comp[3];
+    uint8_t ncomp;
+    uint8_t hmax, vmax;
+    uint16_t width, height;
+    uint16_t restart_interval;
+    uint32_t bits;          // bits read ahead, the next one at the top
+    int nbits;
+    uint8_t marker;         // marker reached in the entropy coded data, or 0
+    int32_t coef[64];
+    uint8_t blocks[6][64];
+} jpeg_decoder_t;
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_EXTMOD_MACHINE_AUDIO_H
+#define MICROPY_INCLUDED_EXTMOD_MACHINE_AUDIO_H
+
+#include "py/obj.h"
+
+// Audio protocol, for an output that plays buffers of unsigned 8-bit
+// samples in the background, like pyb.Audio.  As with the display protocol
+// it's passed along with the output.
+typedef struct _mp_machine_audio_p_t {
+    // The sample rate in Hz, or 0 if the output isn't initialised.
+    mp_uint_t (*freq)(void *self);
+    // Queue buf_in to play after what is playing, starting playback if it
+    // has stopped.  Returns false if the queue is full.  The output holds
+    // on to buf_in until it has been played.
+    bool (*queue)(void *self, mp_obj_t buf_in, const mp_buffer_info_t *bufinfo);
+    // Whether samples are playing.
+    bool (*busy)(void *self);
+    // Stop playing and drop anything queued.
+    void (*stop)(void *self);
+} mp_machine_audio_p_t;
+
+// Queue buf_in on an audio output, waiting for room in its queue.
+void mp_machine_audio_write(const mp_machine_audio_p_t *p, void *self, mp_obj_t buf_in);
+
+#endif // MICROPY_INCLUDED_EXTMOD_MACHINE_AUDIO_H
@@ -0,0 +1,199 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "extmod/machine_display.h"
+
+#if MICROPY_PY_MACHINE_DISPLAY
+
+#define COL0(r, g, b) ((((r) >> 3) << 11) | (((g) >> 2) << 5) | ((b) >> 3))
+#define COL(c) COL0((c >> 16) & 0xff, (c >> 8) & 0xff, c & 0xff)
+
+// default palette, repeated every 16 entries of the 256-entry palette table
+STATIC const uint16_t palette_default[] = {
+    COL(0x000000), // 0
+    COL(0xffffff), // 1
+    COL(0xff2121), // 2
+    COL(0xff93c4), // 3
+    COL(0xff8135), // 4
+    COL(0xfff609), // 5
+    COL(0x249ca3), // 6
+    COL(0x78dc52), // 7
+    COL(0x003fad), // 8
+    COL(0x87f2ff), // 9
+    COL(0x8e2ec4), // 10
+    COL(0xa4839f), // 11
+    COL(0x5c406c), // 12
+    COL(0xe5cdc4), // 13
+    COL(0x91463d), // 14
+    COL(0x000000), // 15
+};
+
+// Ping-pong RGB565 line buffers for palette formats.  They are static
+// rather than on the stack, because the DMA may not reach the stack.
+STATIC uint16_t display_line_buf[2][MICROPY_PY_MACHINE_DISPLAY_LINE];
+
+void mp_machine_display_palette_reset(uint16_t *palette) {
+    for (int i = 0; i < MP_MACHINE_DISPLAY_PALETTE_SIZE; ++i) {
+        uint16_t color = palette_default[i & 0xf];
+        palette[i] = (color >> 8) | (color << 8);
+    }
+}
+
+void mp_machine_display_palette_load(uint16_t *palette, const mp_buffer_info_t *bufinfo) {
+    size_t n = MIN(bufinfo->len / 2, MP_MACHINE_DISPLAY_PALETTE_SIZE);
+    const uint16_t *src = bufinfo->buf;
+    for (size_t i = 0; i < n; ++i) {
+        uint16_t color = src[i];
+        palette[i] = (color >> 8) | (color << 8);
+    }
+}
+
+int mp_machine_display_mode(size_t buf_len, size_t npixels, bool with_palette) {
+    if (!with_palette) {
+        return MP_MACHINE_DISPLAY_RGB565;
+    }
+    // a buffer half the size of the window holds 4-bit indices (GS4_HMSB),
+    // otherwise there is one 8-bit index per pixel (PL8)
+    return buf_len * 2 == npixels ? MP_MACHINE_DISPLAY_PL4 : MP_MACHINE_DISPLAY_PL8;
+}
+
+void mp_machine_display_get_rects(mp_obj_t *rect_in, size_t *n, mp_obj_t **rects) {
+    mp_obj_get_array(*rect_in, n, rects);
+    if (*n > 0 && mp_obj_is_int((*rects)[0])) {
+        *n = 1;
+        *rects = rect_in;
+    }
+}
+
+bool mp_machine_display_clip_rect(mp_obj_t rect_in, int fb_w, int fb_h, int *r) {
+    mp_obj_t *items;
+    mp_obj_get_array_fixed_n(rect_in, 4, &items);
+    int x = mp_obj_get_int(items[0]);
+    int y = mp_obj_get_int(items[1]);
+    int x2 = MIN(x + mp_obj_get_int(items[2]), fb_w);
+    int y2 = MIN(y + mp_obj_get_int(items[3]), fb_h);
+    x = MAX(x, 0);
+    y = MAX(y, 0);
+    r[0] = x;
+    r[1] = y;
+    r[2] = x2 - x;
+    r[3] = y2 - y;
+    return x < x2 && y < y2;
+}
+
+// Expand n palette indices starting at pixel index i into RGB565 line buffer dest.
+STATIC void display_expand_line(uint16_t *dest, const byte *src, const uint16_t *palette, size_t i, size_t n, bool packed) {
+    if (packed) {
+        for (; n; --n, ++i) {
+            uint8_t idx = (src[i >> 1] >> ((i & 1) ? 0 : 4)) & 0xf;
+            *dest++ = palette[idx];
+        }
+    } else {
+        src += i;
+        for (; n; --n) {
+            *dest++ = palette[*src++];
+        }
+    }
+}
+
+int mp_machine_display_write_rect(const mp_machine_display_p_t *p, void *self, const byte *buf, int mode,
+    const uint16_t *palette, size_t start, size_t w, size_t h, size_t stride) {
+    int err = 0;
+    if (mode == MP_MACHINE_DISPLAY_RGB565) {
+        const uint16_t *src = (const uint16_t*)buf + start;
+        if (w == stride) {
+            // contiguous, send it in one piece
+            err = p->write(self, src, w * h);
+        } else {
+            for (; h && err == 0; --h, src += stride) {
+                err = p->write(self, src, w);
+            }
+        }
+    } else {
+        // while one line buffer is sent the next line is expanded into the other
+        uint cur = 0;
+        for (; h && err == 0; --h, start += stride) {
+            for (size_t i = 0; i < w && err == 0; i += MICROPY_PY_MACHINE_DISPLAY_LINE, cur ^= 1) {
+                size_t n = MIN(w - i, MICROPY_PY_MACHINE_DISPLAY_LINE);
+                display_expand_line(display_line_buf[cur], buf, palette, start + i, n, mode == MP_MACHINE_DISPLAY_PL4);
+                err = p->write(self, display_line_buf[cur], n);
+            }
+        }
+    }
+    if (p->flush != NULL) {
+        int flush_err = p->flush(self);
+        if (err == 0) {
+            err = flush_err;
+        }
+    }
+    return err;
+}
+
+int mp_machine_display_show(const mp_machine_display_p_t *p, void *self, const mp_buffer_info_t *bufinfo, int mode,
+    const uint16_t *palette, int fb_w, int fb_h, mp_obj_t rect_in) {
+    size_t fb_pixels = (size_t)fb_w * fb_h;
+
+    if (rect_in == mp_const_none) {
+        // whole screen, as many pixels as the buffer holds
+        size_t npixels = mode == MP_MACHINE_DISPLAY_RGB565 ? bufinfo->len / 2
+            : mode == MP_MACHINE_DISPLAY_PL4 ? fb_pixels : bufinfo->len;
+        npixels = MIN(npixels, fb_pixels);
+        p->window(self, 0, 0, fb_w, fb_h);
+        int err = mp_machine_display_write_rect(p, self, bufinfo->buf, mode, palette, 0, npixels, 1, npixels);
+        if (p->present != NULL) {
+            p->present(self);
+        }
+        return err;
+    }
+
+    size_t needed = mode == MP_MACHINE_DISPLAY_RGB565 ? fb_pixels * 2
+        : mode == MP_MACHINE_DISPLAY_PL4 ? fb_pixels / 2 : fb_pixels;
+    if (bufinfo->len < needed) {
+        mp_raise_ValueError("buffer too small");
+    }
+
+    size_t nrects;
+    mp_obj_t *rects;
+    mp_machine_display_get_rects(&rect_in, &nrects, &rects);
+    int err = 0;
+    for (size_t i = 0; i < nrects && err == 0; ++i) {
+        int r[4];
+        if (!mp_machine_display_clip_rect(rects[i], fb_w, fb_h, r)) {
+            continue;
+        }
+        p->window(self, r[0], r[1], r[2], r[3]);
+        err = mp_machine_display_write_rect(p, self, bufinfo->buf, mode, palette,
+            r[1] * fb_w + r[0], r[2], r[3], fb_w);
+    }
+    if (p->present != NULL) {
+        p->present(self);
+    }
+    return err;
+}
+
+#endif // MICROPY_PY_MACHINE_DISPLAY
@@ -0,0 +1,95 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_EXTMOD_MACHINE_DISPLAY_H
+#define MICROPY_INCLUDED_EXTMOD_MACHINE_DISPLAY_H
+
+#include "py/obj.h"
+
+// Pixel formats of a buffer sent to a display.  Pixels go out as RGB565 in
+// wire (big-endian) byte order, so an RGB565 buffer is sent as it is, and
+// palette indices are looked up in a palette held in wire byte order.
+#define MP_MACHINE_DISPLAY_RGB565 (0)
+#define MP_MACHINE_DISPLAY_PL8 (1) // one 8-bit index per pixel
+#define MP_MACHINE_DISPLAY_PL4 (2) // two 4-bit indices per byte, high nibble first
+
+#define MP_MACHINE_DISPLAY_PALETTE_SIZE (256)
+
+// Display protocol.  The shared code in machine_display.c sends pixels to a
+// display through it a rectangle at a time.  It's passed along with the
+// display rather than being its type->protocol, which a screen may use for
+// a stream.
+typedef struct _mp_machine_display_p_t {
+    // Set the rectangle, in framebuffer coordinates, that the next pixels
+    // written fill row by row.
+    void (*window)(void *self, int x, int y, int w, int h);
+    // Send n pixels in wire byte order.  This may return while a DMA
+    // transfer of them is still going, but it must first wait for the
+    // transfer of the previous write, so its buffer can be reused.
+    // Returns 0, or a non-zero error of the port's choosing.
+    int (*write)(void *self, const uint16_t *pixels, size_t n);
+    // Wait for the last write to finish.  Can be NULL.
+    int (*flush)(void *self);
+    // Called once all the rectangles of a frame have been written, for a
+    // display that isn't updated as it's written to.  Can be NULL.
+    void (*present)(void *self);
+} mp_machine_display_p_t;
+
+// Get the display protocol of obj, raising TypeError if it isn't a display.
+// Provided by the port.
+const mp_machine_display_p_t *mp_machine_display_get(mp_obj_t obj);
+
+// Set the palette to the default 16 colours, repeated.
+void mp_machine_display_palette_reset(uint16_t *palette);
+
+// Load palette from a buffer of native RGB565 values.
+void mp_machine_display_palette_load(uint16_t *palette, const mp_buffer_info_t *bufinfo);
+
+// Get the format of a buf_len byte buffer covering npixels pixels, given
+// whether it's shown with a palette.
+int mp_machine_display_mode(size_t buf_len, size_t npixels, bool with_palette);
+
+// Get the array of (x, y, w, h) rectangles from the rect argument of
+// show(), which is a single rectangle or a sequence of them.  For a single
+// one, *rects is set to rect_in itself.
+void mp_machine_display_get_rects(mp_obj_t *rect_in, size_t *n, mp_obj_t **rects);
+
+// Clip rectangle rect_in to a fb_w x fb_h framebuffer, setting r to x, y, w
+// and h.  Returns false if nothing of it is left.
+bool mp_machine_display_clip_rect(mp_obj_t rect_in, int fb_w, int fb_h, int *r);
+
+// Send a w x h rectangle of buf, starting at pixel index start and with rows
+// stride pixels apart, through the display's write().  Palette indices are
+// expanded a line at a time, while the display sends the previous line.
+// The display window must already be set.  Returns 0 or write()'s error.
+int mp_machine_display_write_rect(const mp_machine_display_p_t *p, void *self, const byte *buf, int mode,
+    const uint16_t *palette, size_t start, size_t w, size_t h, size_t stride);
+
+// Show buf on a fb_w x fb_h display, as show() does: the whole buffer if
+// rect_in is None, otherwise the rectangles in rect_in.
+int mp_machine_display_show(const mp_machine_display_p_t *p, void *self, const mp_buffer_info_t *bufinfo, int mode,
+    const uint16_t *palette, int fb_w, int fb_h, mp_obj_t rect_in);
+
+#endif // MICROPY_INCLUDED_EXTMOD_MACHINE_DISPLAY_H
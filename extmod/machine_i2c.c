@@ -612,6 +612,56 @@ STATIC mp_obj_t machine_i2c_readfrom_mem_into(size_t n_args, const mp_obj_t *pos
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(machine_i2c_readfrom_mem_into_obj, 1, machine_i2c_readfrom_mem_into);
 
+STATIC mp_obj_t machine_i2c_readfrom_mem_multi(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_ops, ARG_buf, ARG_addrsize };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_ops, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_addrsize, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    // get the buffer to store data into
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_WRITE);
+
+    // each op is (addr, memaddr, nbytes); check they all fit before
+    // starting on the bus, so a bad op doesn't leave a half done sequence
+    size_t nops;
+    mp_obj_t *ops;
+    mp_obj_get_array(args[ARG_ops].u_obj, &nops, &ops);
+    size_t total = 0;
+    for (size_t i = 0; i < nops; ++i) {
+        mp_obj_t *op;
+        mp_obj_get_array_fixed_n(ops[i], 3, &op);
+        mp_int_t len = mp_obj_get_int(op[2]);
+        if (len < 0) {
+            mp_raise_ValueError(NULL);
+        }
+        total += len;
+    }
+    if (total > bufinfo.len) {
+        mp_raise_ValueError("buffer too small");
+    }
+
+    // do the transfers, one after the other into buf
+    uint8_t *dest = bufinfo.buf;
+    for (size_t i = 0; i < nops; ++i) {
+        mp_obj_t *op;
+        mp_obj_get_array_fixed_n(ops[i], 3, &op);
+        size_t len = mp_obj_get_int(op[2]);
+        int ret = read_mem(pos_args[0], mp_obj_get_int(op[0]), mp_obj_get_int(op[1]),
+            args[ARG_addrsize].u_int, dest, len);
+        if (ret < 0) {
+            mp_raise_OSError(-ret);
+        }
+        dest += len;
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(machine_i2c_readfrom_mem_multi_obj, 1, machine_i2c_readfrom_mem_multi);
+
 STATIC mp_obj_t machine_i2c_writeto_mem(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     enum { ARG_addr, ARG_memaddr, ARG_buf, ARG_addrsize };
     mp_arg_val_t args[MP_ARRAY_SIZE(machine_i2c_mem_allowed_args)];
@@ -652,6 +702,7 @@ STATIC const mp_rom_map_elem_t machine_i2c_locals_dict_table[] = {
     // memory operations
     { MP_ROM_QSTR(MP_QSTR_readfrom_mem), MP_ROM_PTR(&machine_i2c_readfrom_mem_obj) },
     { MP_ROM_QSTR(MP_QSTR_readfrom_mem_into), MP_ROM_PTR(&machine_i2c_readfrom_mem_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readfrom_mem_multi), MP_ROM_PTR(&machine_i2c_readfrom_mem_multi_obj) },
     { MP_ROM_QSTR(MP_QSTR_writeto_mem), MP_ROM_PTR(&machine_i2c_writeto_mem_obj) },
 };
 
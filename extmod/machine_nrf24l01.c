@@ -0,0 +1,500 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016-2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "extmod/machine_spi.h"
+
+#if MICROPY_PY_MACHINE_NRF24L01
+
+// nRF24L01+ radio driven through any object with the machine.SPI protocol.
+// This is the C version of drivers/nrf24l01/nrf24l01.py, with the same
+// methods.  Each command and its payload go in a single transfer, and with
+// the radio's IRQ pin connected the RX FIFO is emptied into a ring of
+// payloads from a (soft) pin interrupt, so packets aren't lost while the
+// script is busy and any()/recv() don't need to touch the bus.
+
+#define NRF24_MAX_PAYLOAD (32)
+#define NRF24_ADDR_LEN (5)
+
+// registers
+#define CONFIG (0x00)
+#define EN_RXADDR (0x02)
+#define SETUP_AW (0x03)
+#define SETUP_RETR (0x04)
+#define RF_CH (0x05)
+#define RF_SETUP (0x06)
+#define STATUS (0x07)
+#define RX_ADDR_P0 (0x0a)
+#define TX_ADDR (0x10)
+#define RX_PW_P0 (0x11)
+#define FIFO_STATUS (0x17)
+#define DYNPD (0x1c)
+
+// CONFIG register
+#define EN_CRC (0x08)
+#define CRCO (0x04)
+#define PWR_UP (0x02)
+#define PRIM_RX (0x01)
+
+// RF_SETUP register
+#define POWER_0 (0x00) // -18 dBm
+#define POWER_1 (0x02) // -12 dBm
+#define POWER_2 (0x04) // -6 dBm
+#define POWER_3 (0x06) // 0 dBm
+#define SPEED_1M (0x00)
+#define SPEED_2M (0x08)
+#define SPEED_250K (0x20)
+
+// STATUS register
+#define RX_DR (0x40)
+#define TX_DS (0x20)
+#define MAX_RT (0x10)
+
+// FIFO_STATUS register
+#define RX_EMPTY (0x01)
+
+// instructions
+#define W_REGISTER (0x20)
+#define R_RX_PAYLOAD (0x61)
+#define W_TX_PAYLOAD (0xa0)
+#define FLUSH_TX (0xe1)
+#define FLUSH_RX (0xe2)
+#define NOP (0xff)
+
+// results of send_done()
+#define TX_PENDING (0)
+#define TX_OK (1)
+#define TX_FAIL (2)
+
+typedef struct _mp_machine_nrf24l01_obj_t {
+    mp_obj_base_t base;
+    mp_obj_base_t *spi;
+    mp_hal_pin_obj_t cs;
+    mp_hal_pin_obj_t ce;
+    bool use_irq;
+    uint8_t payload_size;
+    uint8_t tx_result;
+    bool pipe0_read_addr_set;
+    uint8_t pipe0_read_addr[NRF24_ADDR_LEN];
+    // received payloads, rx_depth of them, each payload_size bytes
+    uint16_t rx_depth;
+    uint16_t rx_head;
+    uint16_t rx_len;
+    uint8_t *rx_buf;
+} mp_machine_nrf24l01_obj_t;
+
+// Send cmd followed by len bytes of src (or NOPs if src is NULL), reading
+// the bytes clocked back into dest if it's not NULL.  Returns STATUS.
+STATIC uint8_t nrf24_cmd(mp_machine_nrf24l01_obj_t *self, uint8_t cmd, size_t len, const uint8_t *src, uint8_t *dest) {
+    uint8_t buf[1 + NRF24_MAX_PAYLOAD];
+    buf[0] = cmd;
+    if (src != NULL) {
+        memcpy(buf + 1, src, len);
+    } else {
+        memset(buf + 1, NOP, len);
+    }
+    const mp_machine_spi_p_t *spi_p = (const mp_machine_spi_p_t*)self->spi->type->protocol;
+    mp_hal_pin_write(self->cs, 0);
+    spi_p->transfer(self->spi, 1 + len, buf, buf);
+    mp_hal_pin_write(self->cs, 1);
+    if (dest != NULL) {
+        memcpy(dest, buf + 1, len);
+    }
+    return buf[0];
+}
+
+STATIC uint8_t nrf24_reg_read(mp_machine_nrf24l01_obj_t *self, uint8_t reg) {
+    uint8_t value;
+    nrf24_cmd(self, reg, 1, NULL, &value);
+    return value;
+}
+
+STATIC uint8_t nrf24_reg_write(mp_machine_nrf24l01_obj_t *self, uint8_t reg, uint8_t value) {
+    return nrf24_cmd(self, W_REGISTER | reg, 1, &value, NULL);
+}
+
+// Take the TX result and empty the RX FIFO into the ring, as far as there's
+// room.  RX_DR is cleared before the FIFO is read, so a packet arriving
+// meanwhile sets it again and makes a new interrupt.
+STATIC void nrf24_service(mp_machine_nrf24l01_obj_t *self) {
+    uint8_t status = nrf24_cmd(self, NOP, 0, NULL, NULL);
+    uint8_t clear = status & (RX_DR | TX_DS | MAX_RT);
+    if (clear != 0) {
+        nrf24_reg_write(self, STATUS, clear);
+    }
+    if (status & TX_DS) {
+        self->tx_result = TX_OK;
+    } else if (status & MAX_RT) {
+        // no ack after all the retries; the payload stays in the TX FIFO
+        self->tx_result = TX_FAIL;
+        nrf24_cmd(self, FLUSH_TX, 0, NULL, NULL);
+    }
+    while (self->rx_len < self->rx_depth && !(nrf24_reg_read(self, FIFO_STATUS) & RX_EMPTY)) {
+        size_t i = (self->rx_head + self->rx_len) % self->rx_depth;
+        nrf24_cmd(self, R_RX_PAYLOAD, self->payload_size, NULL, self->rx_buf + i * self->payload_size);
+        ++self->rx_len;
+    }
+}
+
+STATIC void nrf24_pin_init(mp_obj_t pin, qstr mode, int value) {
+    // pin.init(pin.<mode>[, value=value])
+    mp_obj_t dest[5];
+    mp_load_method(pin, MP_QSTR_init, dest);
+    dest[2] = mp_load_attr(pin, mode);
+    size_t n_kw = 0;
+    if (value >= 0) {
+        dest[3] = MP_OBJ_NEW_QSTR(MP_QSTR_value);
+        dest[4] = MP_OBJ_NEW_SMALL_INT(value);
+        n_kw = 1;
+    }
+    mp_call_method_n_kw(1, n_kw, dest);
+}
+
+STATIC void nrf24_get_addr(mp_obj_t addr_in, mp_buffer_info_t *bufinfo) {
+    mp_get_buffer_raise(addr_in, bufinfo, MP_BUFFER_READ);
+    if (bufinfo->len != NRF24_ADDR_LEN) {
+        mp_raise_ValueError("address must be 5 bytes");
+    }
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC mp_obj_t machine_nrf24l01_irq_handler(mp_obj_t self_in, mp_obj_t pin_in) {
+    (void)pin_in;
+    nrf24_service(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_nrf24l01_irq_handler_obj, machine_nrf24l01_irq_handler);
+
+STATIC mp_obj_t machine_nrf24l01_set_channel(mp_obj_t self_in, mp_obj_t channel_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    nrf24_reg_write(self, RF_CH, MIN(mp_obj_get_int(channel_in), 125));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_nrf24l01_set_channel_obj, machine_nrf24l01_set_channel);
+
+STATIC mp_obj_t machine_nrf24l01_set_power_speed(mp_obj_t self_in, mp_obj_t power_in, mp_obj_t speed_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint8_t setup = nrf24_reg_read(self, RF_SETUP) & 0xd1;
+    nrf24_reg_write(self, RF_SETUP, setup | mp_obj_get_int(power_in) | mp_obj_get_int(speed_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_nrf24l01_set_power_speed_obj, machine_nrf24l01_set_power_speed);
+
+STATIC mp_obj_t machine_nrf24l01_set_crc(mp_obj_t self_in, mp_obj_t length_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_int_t length = mp_obj_get_int(length_in);
+    uint8_t config = nrf24_reg_read(self, CONFIG) & ~(CRCO | EN_CRC);
+    if (length == 1) {
+        config |= EN_CRC;
+    } else if (length > 1) {
+        config |= EN_CRC | CRCO;
+    }
+    nrf24_reg_write(self, CONFIG, config);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_nrf24l01_set_crc_obj, machine_nrf24l01_set_crc);
+
+STATIC mp_obj_t machine_nrf24l01_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_spi, ARG_cs, ARG_ce, ARG_channel, ARG_payload_size, ARG_irq, ARG_rx_depth, ARG_baudrate };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_spi, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_cs, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_ce, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_channel, MP_ARG_INT, {.u_int = 46} },
+        { MP_QSTR_payload_size, MP_ARG_INT, {.u_int = 16} },
+        { MP_QSTR_irq, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_rx_depth, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8} },
+        { MP_QSTR_baudrate, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 4000000} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_base_t *spi = (mp_obj_base_t*)MP_OBJ_TO_PTR(args[ARG_spi].u_obj);
+    if (!mp_obj_is_obj(args[ARG_spi].u_obj) || spi->type->protocol == NULL) {
+        mp_raise_TypeError("expecting an SPI object");
+    }
+    mp_int_t payload_size = args[ARG_payload_size].u_int;
+    mp_int_t rx_depth = args[ARG_rx_depth].u_int;
+    if (payload_size < 1 || payload_size > NRF24_MAX_PAYLOAD || rx_depth < 1 || rx_depth > 1024) {
+        mp_raise_ValueError(NULL);
+    }
+
+    mp_machine_nrf24l01_obj_t *self = m_new_obj(mp_machine_nrf24l01_obj_t);
+    self->base.type = type;
+    self->spi = spi;
+    self->cs = mp_hal_get_pin_obj(args[ARG_cs].u_obj);
+    self->ce = mp_hal_get_pin_obj(args[ARG_ce].u_obj);
+    self->use_irq = false;
+    self->payload_size = payload_size;
+    self->tx_result = TX_PENDING;
+    self->pipe0_read_addr_set = false;
+    self->rx_depth = rx_depth;
+    self->rx_head = 0;
+    self->rx_len = 0;
+    self->rx_buf = m_new(uint8_t, rx_depth * payload_size);
+
+    // init the SPI bus and pins: spi.init(baudrate=..., polarity=0, phase=0)
+    mp_obj_t dest[8];
+    mp_load_method(args[ARG_spi].u_obj, MP_QSTR_init, dest);
+    dest[2] = MP_OBJ_NEW_QSTR(MP_QSTR_baudrate);
+    dest[3] = mp_obj_new_int(args[ARG_baudrate].u_int);
+    dest[4] = MP_OBJ_NEW_QSTR(MP_QSTR_polarity);
+    dest[5] = MP_OBJ_NEW_SMALL_INT(0);
+    dest[6] = MP_OBJ_NEW_QSTR(MP_QSTR_phase);
+    dest[7] = MP_OBJ_NEW_SMALL_INT(0);
+    mp_call_method_n_kw(0, 3, dest);
+    nrf24_pin_init(args[ARG_ce].u_obj, MP_QSTR_OUT, 0);
+    nrf24_pin_init(args[ARG_cs].u_obj, MP_QSTR_OUT, 1);
+    mp_hal_delay_ms(5);
+
+    // set address width to 5 bytes and check for device present
+    nrf24_reg_write(self, SETUP_AW, 0x03);
+    if (nrf24_reg_read(self, SETUP_AW) != 0x03) {
+        mp_raise_msg(&mp_type_OSError, "nRF24L01+ Hardware not responding");
+    }
+
+    // disable dynamic payloads
+    nrf24_reg_write(self, DYNPD, 0);
+
+    // auto retransmit delay: 1750us, auto retransmit count: 8
+    nrf24_reg_write(self, SETUP_RETR, (6 << 4) | 8);
+
+    // best for point to point links
+    machine_nrf24l01_set_power_speed(MP_OBJ_FROM_PTR(self), MP_OBJ_NEW_SMALL_INT(POWER_3), MP_OBJ_NEW_SMALL_INT(SPEED_250K));
+    machine_nrf24l01_set_crc(MP_OBJ_FROM_PTR(self), MP_OBJ_NEW_SMALL_INT(2));
+    nrf24_reg_write(self, STATUS, RX_DR | TX_DS | MAX_RT);
+    machine_nrf24l01_set_channel(MP_OBJ_FROM_PTR(self), MP_OBJ_NEW_SMALL_INT(args[ARG_channel].u_int));
+    nrf24_cmd(self, FLUSH_RX, 0, NULL, NULL);
+    nrf24_cmd(self, FLUSH_TX, 0, NULL, NULL);
+
+    if (args[ARG_irq].u_obj != mp_const_none) {
+        // irq.init(irq.IN); irq.irq(handler=..., trigger=irq.IRQ_FALLING)
+        mp_obj_t irq = args[ARG_irq].u_obj;
+        nrf24_pin_init(irq, MP_QSTR_IN, -1);
+        mp_load_method(irq, MP_QSTR_irq, dest);
+        dest[2] = MP_OBJ_NEW_QSTR(MP_QSTR_handler);
+        dest[3] = mp_obj_new_bound_meth(MP_OBJ_FROM_PTR(&machine_nrf24l01_irq_handler_obj), MP_OBJ_FROM_PTR(self));
+        dest[4] = MP_OBJ_NEW_QSTR(MP_QSTR_trigger);
+        dest[5] = mp_load_attr(irq, MP_QSTR_IRQ_FALLING);
+        mp_call_method_n_kw(0, 2, dest);
+        self->use_irq = true;
+    }
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t machine_nrf24l01_open_tx_pipe(mp_obj_t self_in, mp_obj_t addr_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t addr;
+    nrf24_get_addr(addr_in, &addr);
+    nrf24_cmd(self, W_REGISTER | RX_ADDR_P0, NRF24_ADDR_LEN, addr.buf, NULL);
+    nrf24_cmd(self, W_REGISTER | TX_ADDR, NRF24_ADDR_LEN, addr.buf, NULL);
+    nrf24_reg_write(self, RX_PW_P0, self->payload_size);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_nrf24l01_open_tx_pipe_obj, machine_nrf24l01_open_tx_pipe);
+
+// Pipes 0 and 1 have a 5 byte address; pipes 2-5 share the 4 most
+// significant bytes of pipe 1 and only the first byte of address is used.
+STATIC mp_obj_t machine_nrf24l01_open_rx_pipe(mp_obj_t self_in, mp_obj_t pipe_id_in, mp_obj_t addr_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_int_t pipe_id = mp_obj_get_int(pipe_id_in);
+    mp_buffer_info_t addr;
+    nrf24_get_addr(addr_in, &addr);
+    if (pipe_id < 0 || pipe_id > 5) {
+        mp_raise_ValueError("bad pipe");
+    }
+    if (pipe_id == 0) {
+        memcpy(self->pipe0_read_addr, addr.buf, NRF24_ADDR_LEN);
+        self->pipe0_read_addr_set = true;
+    }
+    if (pipe_id < 2) {
+        nrf24_cmd(self, W_REGISTER | (RX_ADDR_P0 + pipe_id), NRF24_ADDR_LEN, addr.buf, NULL);
+    } else {
+        nrf24_reg_write(self, RX_ADDR_P0 + pipe_id, ((uint8_t*)addr.buf)[0]);
+    }
+    nrf24_reg_write(self, RX_PW_P0 + pipe_id, self->payload_size);
+    nrf24_reg_write(self, EN_RXADDR, nrf24_reg_read(self, EN_RXADDR) | (1 << pipe_id));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_nrf24l01_open_rx_pipe_obj, machine_nrf24l01_open_rx_pipe);
+
+STATIC mp_obj_t machine_nrf24l01_start_listening(mp_obj_t self_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    nrf24_reg_write(self, CONFIG, nrf24_reg_read(self, CONFIG) | PWR_UP | PRIM_RX);
+    nrf24_reg_write(self, STATUS, RX_DR | TX_DS | MAX_RT);
+    if (self->pipe0_read_addr_set) {
+        nrf24_cmd(self, W_REGISTER | RX_ADDR_P0, NRF24_ADDR_LEN, self->pipe0_read_addr, NULL);
+    }
+    nrf24_cmd(self, FLUSH_RX, 0, NULL, NULL);
+    nrf24_cmd(self, FLUSH_TX, 0, NULL, NULL);
+    self->rx_len = 0;
+    mp_hal_pin_write(self->ce, 1);
+    mp_hal_delay_us(130);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_nrf24l01_start_listening_obj, machine_nrf24l01_start_listening);
+
+STATIC mp_obj_t machine_nrf24l01_stop_listening(mp_obj_t self_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_hal_pin_write(self->ce, 0);
+    nrf24_cmd(self, FLUSH_TX, 0, NULL, NULL);
+    nrf24_cmd(self, FLUSH_RX, 0, NULL, NULL);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_nrf24l01_stop_listening_obj, machine_nrf24l01_stop_listening);
+
+// Return the number of payloads ready to recv().  With the IRQ pin this is
+// just the ring; without it the radio is asked first.
+STATIC mp_obj_t machine_nrf24l01_any(mp_obj_t self_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!self->use_irq || self->rx_len == self->rx_depth) {
+        nrf24_service(self);
+    }
+    return MP_OBJ_NEW_SMALL_INT(self->rx_len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_nrf24l01_any_obj, machine_nrf24l01_any);
+
+// Return the oldest payload received, or None if there isn't one.
+STATIC mp_obj_t machine_nrf24l01_recv(mp_obj_t self_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    // a full ring leaves packets in the radio, so fetch them as room is made
+    if (!self->use_irq || self->rx_len == 0 || self->rx_len == self->rx_depth) {
+        nrf24_service(self);
+    }
+    if (self->rx_len == 0) {
+        return mp_const_none;
+    }
+    mp_obj_t buf = mp_obj_new_bytes(self->rx_buf + self->rx_head * self->payload_size, self->payload_size);
+    self->rx_head = (self->rx_head + 1) % self->rx_depth;
+    --self->rx_len;
+    return buf;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_nrf24l01_recv_obj, machine_nrf24l01_recv);
+
+// Non-blocking send: the payload, padded to payload_size, goes in one
+// transfer and CE is pulsed to transmit it.
+STATIC mp_obj_t machine_nrf24l01_send_start(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+
+    // power up in TX mode, waiting for the radio to settle only if that's a
+    // change, so back to back sends don't wait
+    uint8_t config = nrf24_reg_read(self, CONFIG);
+    uint8_t new_config = (config | PWR_UP) & ~PRIM_RX;
+    if (new_config != config) {
+        nrf24_reg_write(self, CONFIG, new_config);
+        mp_hal_delay_us(150);
+    }
+
+    uint8_t payload[NRF24_MAX_PAYLOAD];
+    size_t len = MIN(bufinfo.len, self->payload_size);
+    memcpy(payload, bufinfo.buf, len);
+    memset(payload + len, 0, self->payload_size - len);
+    self->tx_result = TX_PENDING;
+    nrf24_cmd(self, W_TX_PAYLOAD, self->payload_size, payload, NULL);
+
+    // enable the chip so it can send the data
+    mp_hal_pin_write(self->ce, 1);
+    mp_hal_delay_us(15); // needs to be >10us
+    mp_hal_pin_write(self->ce, 0);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_nrf24l01_send_start_obj, machine_nrf24l01_send_start);
+
+// Return None if the send is still in progress, 1 for success (acked) and
+// 2 for failure (not acked after the retries).
+STATIC mp_obj_t machine_nrf24l01_send_done(mp_obj_t self_in) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->tx_result == TX_PENDING) {
+        nrf24_service(self);
+        if (self->tx_result == TX_PENDING) {
+            return mp_const_none;
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(self->tx_result);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_nrf24l01_send_done_obj, machine_nrf24l01_send_done);
+
+STATIC mp_obj_t machine_nrf24l01_send(size_t n_args, const mp_obj_t *args) {
+    mp_machine_nrf24l01_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_uint_t timeout = n_args > 2 ? mp_obj_get_int(args[2]) : 500;
+    machine_nrf24l01_send_start(args[0], args[1]);
+    mp_uint_t t0 = mp_hal_ticks_ms();
+    while (machine_nrf24l01_send_done(args[0]) == mp_const_none) {
+        if (mp_hal_ticks_ms() - t0 >= timeout) {
+            break;
+        }
+        #ifdef MICROPY_EVENT_POLL_HOOK
+        MICROPY_EVENT_POLL_HOOK
+        #endif
+    }
+    if (self->tx_result != TX_OK) {
+        mp_raise_msg(&mp_type_OSError, "send failed");
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_nrf24l01_send_obj, 2, 3, machine_nrf24l01_send);
+
+STATIC const mp_rom_map_elem_t machine_nrf24l01_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_set_channel), MP_ROM_PTR(&machine_nrf24l01_set_channel_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_power_speed), MP_ROM_PTR(&machine_nrf24l01_set_power_speed_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_crc), MP_ROM_PTR(&machine_nrf24l01_set_crc_obj) },
+    { MP_ROM_QSTR(MP_QSTR_open_tx_pipe), MP_ROM_PTR(&machine_nrf24l01_open_tx_pipe_obj) },
+    { MP_ROM_QSTR(MP_QSTR_open_rx_pipe), MP_ROM_PTR(&machine_nrf24l01_open_rx_pipe_obj) },
+    { MP_ROM_QSTR(MP_QSTR_start_listening), MP_ROM_PTR(&machine_nrf24l01_start_listening_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop_listening), MP_ROM_PTR(&machine_nrf24l01_stop_listening_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&machine_nrf24l01_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&machine_nrf24l01_recv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&machine_nrf24l01_send_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send_start), MP_ROM_PTR(&machine_nrf24l01_send_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send_done), MP_ROM_PTR(&machine_nrf24l01_send_done_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_POWER_0), MP_ROM_INT(POWER_0) },
+    { MP_ROM_QSTR(MP_QSTR_POWER_1), MP_ROM_INT(POWER_1) },
+    { MP_ROM_QSTR(MP_QSTR_POWER_2), MP_ROM_INT(POWER_2) },
+    { MP_ROM_QSTR(MP_QSTR_POWER_3), MP_ROM_INT(POWER_3) },
+    { MP_ROM_QSTR(MP_QSTR_SPEED_250K), MP_ROM_INT(SPEED_250K) },
+    { MP_ROM_QSTR(MP_QSTR_SPEED_1M), MP_ROM_INT(SPEED_1M) },
+    { MP_ROM_QSTR(MP_QSTR_SPEED_2M), MP_ROM_INT(SPEED_2M) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_nrf24l01_locals_dict, machine_nrf24l01_locals_dict_table);
+
+const mp_obj_type_t mp_machine_nrf24l01_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_NRF24L01,
+    .make_new = machine_nrf24l01_make_new,
+    .locals_dict = (mp_obj_dict_t*)&machine_nrf24l01_locals_dict,
+};
+
+#endif // MICROPY_PY_MACHINE_NRF24L01
@@ -0,0 +1,412 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016-2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "extmod/machine_spi.h"
+#include "extmod/vfs.h"
+
+#if MICROPY_PY_MACHINE_SDCARD_SPI
+
+// SD card in SPI mode, driven through any object with the machine.SPI
+// protocol.  This is the C version of drivers/sdcard/sdcard.py: the blocks
+// themselves go in a single transfer each, which the port can do with DMA,
+// and only the waits for response and data tokens are done a byte at a time.
+
+#define SDCARD_BLOCK_SIZE (512)
+#define SDCARD_INIT_BAUDRATE (100000)
+#define SDCARD_CMD_TIMEOUT (100) // bytes to wait for a command response
+#define SDCARD_READ_TIMEOUT_MS (200)
+#define SDCARD_WRITE_TIMEOUT_MS (500)
+
+#define R1_IDLE_STATE (1 << 0)
+#define R1_ILLEGAL_COMMAND (1 << 2)
+
+#define TOKEN_CMD25 (0xfc)
+#define TOKEN_STOP_TRAN (0xfd)
+#define TOKEN_DATA (0xfe)
+
+typedef struct _mp_machine_sdcard_spi_obj_t {
+    mp_obj_base_t base;
+    mp_obj_base_t *spi;
+    mp_hal_pin_obj_t cs;
+    uint32_t baudrate;
+    uint32_t sectors;
+    uint8_t addr_shift; // 9 for byte-addressed cards, 0 for block-addressed
+} mp_machine_sdcard_spi_obj_t;
+
+STATIC void sdcard_spi_transfer(mp_machine_sdcard_spi_obj_t *self, size_t len, const uint8_t *src, uint8_t *dest) {
+    const mp_machine_spi_p_t *spi_p = (const mp_machine_spi_p_t*)self->spi->type->protocol;
+    spi_p->transfer(self->spi, len, src, dest);
+}
+
+STATIC uint8_t sdcard_spi_xchg(mp_machine_sdcard_spi_obj_t *self, uint8_t out) {
+    uint8_t b = out;
+    sdcard_spi_transfer(self, 1, &b, &b);
+    return b;
+}
+
+// Receive len bytes while sending 0xff, which the card expects on MOSI.
+STATIC void sdcard_spi_readinto(mp_machine_sdcard_spi_obj_t *self, uint8_t *buf, size_t len) {
+    memset(buf, 0xff, len);
+    sdcard_spi_transfer(self, len, buf, buf);
+}
+
+STATIC void sdcard_spi_release(mp_machine_sdcard_spi_obj_t *self) {
+    mp_hal_pin_write(self->cs, 1);
+    // the card only lets go of MISO on the next clock
+    sdcard_spi_xchg(self, 0xff);
+}
+
+STATIC void sdcard_spi_set_baudrate(mp_machine_sdcard_spi_obj_t *self, uint32_t baudrate) {
+    mp_obj_t dest[8];
+    mp_load_method(MP_OBJ_FROM_PTR(self->spi), MP_QSTR_init, dest);
+    dest[2] = MP_OBJ_NEW_QSTR(MP_QSTR_baudrate);
+    dest[3] = mp_obj_new_int_from_uint(baudrate);
+    dest[4] = MP_OBJ_NEW_QSTR(MP_QSTR_polarity);
+    dest[5] = MP_OBJ_NEW_SMALL_INT(0);
+    dest[6] = MP_OBJ_NEW_QSTR(MP_QSTR_phase);
+    dest[7] = MP_OBJ_NEW_SMALL_INT(0);
+    mp_call_method_n_kw(0, 3, dest);
+}
+
+// Send a command and return its R1 response, or -1 on timeout.  resp_len
+// further response bytes (eg the OCR) go in resp.  The card stays selected
+// if release is false.
+STATIC int sdcard_spi_cmd(mp_machine_sdcard_spi_obj_t *self, uint8_t cmd, uint32_t arg, uint8_t crc,
+    uint8_t *resp, size_t resp_len, bool release) {
+    mp_hal_pin_write(self->cs, 0);
+
+    uint8_t buf[6] = {0x40 | cmd, arg >> 24, arg >> 16, arg >> 8, arg, crc};
+    sdcard_spi_transfer(self, sizeof(buf), buf, NULL);
+
+    if (cmd == 12) {
+        // skip the stuff byte that follows CMD12
+        sdcard_spi_xchg(self, 0xff);
+    }
+
+    int r1 = -1;
+    for (int i = 0; i < SDCARD_CMD_TIMEOUT; ++i) {
+        uint8_t b = sdcard_spi_xchg(self, 0xff);
+        if (!(b & 0x80)) {
+            r1 = b;
+            break;
+        }
+    }
+
+    if (r1 >= 0 && resp_len != 0) {
+        sdcard_spi_readinto(self, resp, resp_len);
+    }
+    if (release || r1 < 0) {
+        sdcard_spi_release(self);
+    }
+    return r1;
+}
+
+// Wait for the card to send something other than fill, with the card
+// selected.  Returns the first such byte, or -1 on timeout.
+STATIC int sdcard_spi_wait_byte(mp_machine_sdcard_spi_obj_t *self, uint8_t fill, mp_uint_t timeout_ms) {
+    mp_uint_t t0 = mp_hal_ticks_ms();
+    for (;;) {
+        uint8_t b = sdcard_spi_xchg(self, 0xff);
+        if (b != fill) {
+            return b;
+        }
+        if (mp_hal_ticks_ms() - t0 >= timeout_ms) {
+            return -1;
+        }
+    }
+}
+
+STATIC int sdcard_spi_read_block(mp_machine_sdcard_spi_obj_t *self, uint8_t *buf, size_t len) {
+    int token = sdcard_spi_wait_byte(self, 0xff, SDCARD_READ_TIMEOUT_MS);
+    if (token != TOKEN_DATA) {
+        return token < 0 ? MP_ETIMEDOUT : MP_EIO;
+    }
+    sdcard_spi_readinto(self, buf, len);
+    // skip the CRC
+    uint8_t crc[2];
+    sdcard_spi_readinto(self, crc, sizeof(crc));
+    return 0;
+}
+
+STATIC int sdcard_spi_write_block(mp_machine_sdcard_spi_obj_t *self, uint8_t token, const uint8_t *buf) {
+    sdcard_spi_xchg(self, token);
+    sdcard_spi_transfer(self, SDCARD_BLOCK_SIZE, buf, NULL);
+    uint8_t crc[2];
+    sdcard_spi_readinto(self, crc, sizeof(crc));
+    if ((sdcard_spi_xchg(self, 0xff) & 0x1f) != 0x05) {
+        // data not accepted
+        return MP_EIO;
+    }
+    // the card holds MISO low while it programs the block
+    if (sdcard_spi_wait_byte(self, 0x00, SDCARD_WRITE_TIMEOUT_MS) < 0) {
+        return MP_ETIMEDOUT;
+    }
+    return 0;
+}
+
+STATIC void sdcard_spi_init_card(mp_machine_sdcard_spi_obj_t *self) {
+    // use a low data rate for initialisation, and clock the card at least 74
+    // cycles with CS high
+    sdcard_spi_set_baudrate(self, SDCARD_INIT_BAUDRATE);
+    uint8_t buf[16];
+    sdcard_spi_readinto(self, buf, 10);
+
+    // CMD0: go to idle state, allowing a few attempts
+    int i;
+    for (i = 0; i < 5; ++i) {
+        if (sdcard_spi_cmd(self, 0, 0, 0x95, NULL, 0, true) == R1_IDLE_STATE) {
+            break;
+        }
+    }
+    if (i == 5) {
+        mp_raise_msg(&mp_type_OSError, "no SD card");
+    }
+
+    // CMD8: determine card version
+    int r1 = sdcard_spi_cmd(self, 8, 0x01aa, 0x87, buf, 4, true);
+    bool v2;
+    if (r1 == R1_IDLE_STATE) {
+        v2 = true;
+    } else if (r1 == (R1_IDLE_STATE | R1_ILLEGAL_COMMAND)) {
+        v2 = false;
+    } else {
+        mp_raise_msg(&mp_type_OSError, "couldn't determine SD card version");
+    }
+
+    // ACMD41: wait for the card to leave the idle state, up to about a second
+    for (i = 0; i < 100; ++i) {
+        sdcard_spi_cmd(self, 55, 0, 0, NULL, 0, true);
+        if (sdcard_spi_cmd(self, 41, v2 ? 0x40000000 : 0, 0, NULL, 0, true) == 0) {
+            break;
+        }
+        mp_hal_delay_ms(10);
+    }
+    if (i == 100) {
+        mp_raise_msg(&mp_type_OSError, "timeout waiting for SD card");
+    }
+
+    // CMD58: a v2 card with CCS set in the OCR is block addressed (SDHC/SDXC)
+    self->addr_shift = 9;
+    if (v2 && sdcard_spi_cmd(self, 58, 0, 0, buf, 4, true) == 0 && (buf[0] & 0x40)) {
+        self->addr_shift = 0;
+    }
+
+    // CMD9: read the CSD to get the number of sectors
+    if (sdcard_spi_cmd(self, 9, 0, 0, NULL, 0, false) != 0
+        || sdcard_spi_read_block(self, buf, 16) != 0) {
+        sdcard_spi_release(self);
+        mp_raise_msg(&mp_type_OSError, "no response from SD card");
+    }
+    sdcard_spi_release(self);
+    if ((buf[0] & 0xc0) == 0x40) {
+        // CSD version 2.0
+        uint32_t c_size = (buf[7] & 0x3f) << 16 | buf[8] << 8 | buf[9];
+        self->sectors = (c_size + 1) * 1024;
+    } else if ((buf[0] & 0xc0) == 0x00) {
+        // CSD version 1.0 (old, <=2GB)
+        uint32_t c_size = (buf[6] & 0x03) << 10 | buf[7] << 2 | buf[8] >> 6;
+        uint32_t c_size_mult = (buf[9] & 0x03) << 1 | buf[10] >> 7;
+        uint32_t read_bl_len = buf[5] & 0x0f;
+        self->sectors = (c_size + 1) << (c_size_mult + 2 + read_bl_len - 9);
+    } else {
+        mp_raise_msg(&mp_type_OSError, "SD card CSD format not supported");
+    }
+
+    // CMD16: set block length to 512 bytes
+    if (sdcard_spi_cmd(self, 16, SDCARD_BLOCK_SIZE, 0, NULL, 0, true) != 0) {
+        mp_raise_msg(&mp_type_OSError, "can't set 512 block size");
+    }
+
+    sdcard_spi_set_baudrate(self, self->baudrate);
+}
+
+STATIC void sdcard_spi_check_buf(mp_obj_t buf_in, mp_buffer_info_t *bufinfo, int flags) {
+    mp_get_buffer_raise(buf_in, bufinfo, flags);
+    if (bufinfo->len == 0 || bufinfo->len % SDCARD_BLOCK_SIZE != 0) {
+        mp_raise_ValueError("buffer length must be a multiple of 512");
+    }
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC mp_obj_t machine_sdcard_spi_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_spi, ARG_cs, ARG_baudrate };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_spi, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_cs, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_baudrate, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 10000000} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_base_t *spi = (mp_obj_base_t*)MP_OBJ_TO_PTR(args[ARG_spi].u_obj);
+    if (!mp_obj_is_obj(args[ARG_spi].u_obj) || spi->type->protocol == NULL) {
+        mp_raise_TypeError("expecting an SPI object");
+    }
+
+    mp_machine_sdcard_spi_obj_t *self = m_new_obj(mp_machine_sdcard_spi_obj_t);
+    self->base.type = type;
+    self->spi = spi;
+    self->cs = mp_hal_get_pin_obj(args[ARG_cs].u_obj);
+
+    // configure CS as an output, deselected: cs.init(cs.OUT, value=1)
+    mp_obj_t dest[5];
+    mp_load_method(args[ARG_cs].u_obj, MP_QSTR_init, dest);
+    dest[2] = mp_load_attr(args[ARG_cs].u_obj, MP_QSTR_OUT);
+    dest[3] = MP_OBJ_NEW_QSTR(MP_QSTR_value);
+    dest[4] = MP_OBJ_NEW_SMALL_INT(1);
+    mp_call_method_n_kw(1, 1, dest);
+
+    self->baudrate = args[ARG_baudrate].u_int;
+    self->sectors = 0;
+    sdcard_spi_init_card(self);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t machine_sdcard_spi_readblocks(mp_obj_t self_in, mp_obj_t block_num, mp_obj_t buf_in) {
+    mp_machine_sdcard_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    sdcard_spi_check_buf(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    uint8_t *buf = bufinfo.buf;
+    size_t nblocks = bufinfo.len / SDCARD_BLOCK_SIZE;
+    uint32_t addr = mp_obj_get_int(block_num) << self->addr_shift;
+
+    int ret = 0;
+    if (nblocks == 1) {
+        // CMD17: read a single block
+        if (sdcard_spi_cmd(self, 17, addr, 0, NULL, 0, false) != 0) {
+            sdcard_spi_release(self);
+            mp_raise_OSError(MP_EIO);
+        }
+        ret = sdcard_spi_read_block(self, buf, SDCARD_BLOCK_SIZE);
+        sdcard_spi_release(self);
+    } else {
+        // CMD18: read blocks until stopped by CMD12
+        if (sdcard_spi_cmd(self, 18, addr, 0, NULL, 0, false) != 0) {
+            sdcard_spi_release(self);
+            mp_raise_OSError(MP_EIO);
+        }
+        for (; nblocks != 0 && ret == 0; --nblocks) {
+            ret = sdcard_spi_read_block(self, buf, SDCARD_BLOCK_SIZE);
+            buf += SDCARD_BLOCK_SIZE;
+        }
+        if (sdcard_spi_cmd(self, 12, 0, 0xff, NULL, 0, false) != 0 && ret == 0) {
+            ret = MP_EIO;
+        }
+        sdcard_spi_wait_byte(self, 0x00, SDCARD_WRITE_TIMEOUT_MS);
+        sdcard_spi_release(self);
+    }
+    if (ret != 0) {
+        mp_raise_OSError(ret);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_sdcard_spi_readblocks_obj, machine_sdcard_spi_readblocks);
+
+STATIC mp_obj_t machine_sdcard_spi_writeblocks(mp_obj_t self_in, mp_obj_t block_num, mp_obj_t buf_in) {
+    mp_machine_sdcard_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    sdcard_spi_check_buf(buf_in, &bufinfo, MP_BUFFER_READ);
+    const uint8_t *buf = bufinfo.buf;
+    size_t nblocks = bufinfo.len / SDCARD_BLOCK_SIZE;
+    uint32_t addr = mp_obj_get_int(block_num) << self->addr_shift;
+
+    int ret;
+    if (nblocks == 1) {
+        // CMD24: write a single block
+        if (sdcard_spi_cmd(self, 24, addr, 0, NULL, 0, false) != 0) {
+            sdcard_spi_release(self);
+            mp_raise_OSError(MP_EIO);
+        }
+        ret = sdcard_spi_write_block(self, TOKEN_DATA, buf);
+    } else {
+        // CMD25: write blocks until the stop token
+        if (sdcard_spi_cmd(self, 25, addr, 0, NULL, 0, false) != 0) {
+            sdcard_spi_release(self);
+            mp_raise_OSError(MP_EIO);
+        }
+        ret = 0;
+        for (; nblocks != 0 && ret == 0; --nblocks) {
+            ret = sdcard_spi_write_block(self, TOKEN_CMD25, buf);
+            buf += SDCARD_BLOCK_SIZE;
+        }
+        sdcard_spi_xchg(self, TOKEN_STOP_TRAN);
+        sdcard_spi_xchg(self, 0xff);
+        if (sdcard_spi_wait_byte(self, 0x00, SDCARD_WRITE_TIMEOUT_MS) < 0 && ret == 0) {
+            ret = MP_ETIMEDOUT;
+        }
+    }
+    sdcard_spi_release(self);
+    if (ret != 0) {
+        mp_raise_OSError(ret);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_sdcard_spi_writeblocks_obj, machine_sdcard_spi_writeblocks);
+
+STATIC mp_obj_t machine_sdcard_spi_ioctl(mp_obj_t self_in, mp_obj_t cmd_in, mp_obj_t arg_in) {
+    mp_machine_sdcard_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_int_t cmd = mp_obj_get_int(cmd_in);
+    switch (cmd) {
+        case BP_IOCTL_INIT:
+        case BP_IOCTL_DEINIT:
+        case BP_IOCTL_SYNC:
+            return MP_OBJ_NEW_SMALL_INT(0);
+
+        case BP_IOCTL_SEC_COUNT:
+            return mp_obj_new_int_from_uint(self->sectors);
+
+        case BP_IOCTL_SEC_SIZE:
+            return MP_OBJ_NEW_SMALL_INT(SDCARD_BLOCK_SIZE);
+
+        default: // unknown command
+            return mp_const_none;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_sdcard_spi_ioctl_obj, machine_sdcard_spi_ioctl);
+
+STATIC const mp_rom_map_elem_t machine_sdcard_spi_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_readblocks), MP_ROM_PTR(&machine_sdcard_spi_readblocks_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writeblocks), MP_ROM_PTR(&machine_sdcard_spi_writeblocks_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ioctl), MP_ROM_PTR(&machine_sdcard_spi_ioctl_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_sdcard_spi_locals_dict, machine_sdcard_spi_locals_dict_table);
+
+const mp_obj_type_t mp_machine_sdcard_spi_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_SDCardSPI,
+    .make_new = machine_sdcard_spi_make_new,
+    .locals_dict = (mp_obj_dict_t*)&machine_sdcard_spi_locals_dict,
+};
+
+#endif // MICROPY_PY_MACHINE_SDCARD_SPI
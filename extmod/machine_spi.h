@@ -45,9 +45,13 @@ typedef struct _mp_machine_soft_spi_obj_t {
 extern const mp_machine_spi_p_t mp_machine_soft_spi_p;
 extern const mp_obj_type_t mp_machine_soft_spi_type;
 extern const mp_obj_dict_t mp_machine_spi_locals_dict;
+extern const mp_obj_type_t mp_machine_sdcard_spi_type;
+extern const mp_obj_type_t mp_machine_nrf24l01_type;
 
 mp_obj_t mp_machine_spi_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args);
 
+MP_DECLARE_CONST_FUN_OBJ_KW(mp_machine_spi_init_obj);
+MP_DECLARE_CONST_FUN_OBJ_1(mp_machine_spi_deinit_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_machine_spi_read_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_machine_spi_readinto_obj);
 MP_DECLARE_CONST_FUN_OBJ_2(mp_machine_spi_write_obj);
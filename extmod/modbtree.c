@@ -31,15 +31,33 @@
 
 #include "py/runtime.h"
 #include "py/stream.h"
+#include "py/gc.h"
 
 #if MICROPY_PY_BTREE
 
 #include <db.h>
 #include <../../btree/btree.h>
 
+// The stream a database is stored in.  Seeks are only passed on when a read
+// or write needs them, so the usual seek to where the stream already is costs
+// nothing, and while iterating, runs of pages stored in order are read ahead.
+typedef struct _btree_file_t {
+    mp_obj_base_t *stream;
+    off_t pos;              // position the database has seeked to
+    off_t stream_pos;       // actual position of the stream, -1 if unknown
+    #if MICROPY_PY_BTREE_READAHEAD
+    bool sequential;        // set while iterating in ascending order
+    off_t last_end;         // where the last read from the stream ended
+    off_t ra_pos;           // position of the data in ra_buf
+    size_t ra_len;
+    byte *ra_buf;           // MICROPY_PY_BTREE_READAHEAD bytes, or NULL
+    #endif
+} btree_file_t;
+
 typedef struct _mp_obj_btree_t {
     mp_obj_base_t base;
     DB *db;
+    btree_file_t *file;
     mp_obj_t start_key;
     mp_obj_t end_key;
     #define FLAG_END_KEY_INCL 1
@@ -63,10 +81,11 @@ void __dbpanic(DB *db) {
     printf("__dbpanic(%p)\n", db);
 }
 
-STATIC mp_obj_btree_t *btree_new(DB *db) {
+STATIC mp_obj_btree_t *btree_new(DB *db, btree_file_t *file) {
     mp_obj_btree_t *o = m_new_obj(mp_obj_btree_t);
     o->base.type = &btree_type;
     o->db = db;
+    o->file = file;
     o->start_key = mp_const_none;
     o->end_key = mp_const_none;
     o->next_flags = 0;
@@ -206,7 +225,13 @@ STATIC mp_obj_t btree_iternext(mp_obj_t self_in) {
         res = __bt_seq(self->db, &key, &val, flags);
         self->start_key = MP_OBJ_NULL;
     } else {
+        #if MICROPY_PY_BTREE_READAHEAD
+        self->file->sequential = !desc;
+        #endif
         res = __bt_seq(self->db, &key, &val, desc ? R_PREV : R_NEXT);
+        #if MICROPY_PY_BTREE_READAHEAD
+        self->file->sequential = false;
+        #endif
     }
 
     if (res == RET_SPECIAL) {
@@ -320,11 +345,106 @@ STATIC const mp_obj_type_t btree_type = {
     .locals_dict = (void*)&btree_locals_dict,
 };
 
+STATIC int btree_file_sync_pos(btree_file_t *f) {
+    if (f->stream_pos != f->pos) {
+        f->stream_pos = mp_stream_posix_lseek(f->stream, f->pos, SEEK_SET);
+        if (f->stream_pos == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+STATIC ssize_t btree_file_read(void *fd, void *buf, size_t len) {
+    btree_file_t *f = fd;
+
+    #if MICROPY_PY_BTREE_READAHEAD
+    if (f->ra_len != 0 && f->pos >= f->ra_pos && f->pos + (off_t)len <= f->ra_pos + (off_t)f->ra_len) {
+        memcpy(buf, f->ra_buf + (f->pos - f->ra_pos), len);
+        f->pos += len;
+        f->last_end = f->pos;
+        return len;
+    }
+    if (f->sequential && f->ra_buf != NULL && f->pos == f->last_end && len < MICROPY_PY_BTREE_READAHEAD) {
+        // reading on from the last page, so take the following ones too
+        f->ra_len = 0;
+        if (btree_file_sync_pos(f) == -1) {
+            return -1;
+        }
+        ssize_t n = mp_stream_posix_read(f->stream, f->ra_buf, MICROPY_PY_BTREE_READAHEAD);
+        if (n == -1) {
+            f->stream_pos = -1;
+            return -1;
+        }
+        f->stream_pos += n;
+        f->ra_pos = f->pos;
+        f->ra_len = n;
+        if ((size_t)n > len) {
+            n = len;
+        }
+        memcpy(buf, f->ra_buf, n);
+        f->pos += n;
+        f->last_end = f->pos;
+        return n;
+    }
+    #endif
+
+    if (btree_file_sync_pos(f) == -1) {
+        return -1;
+    }
+    ssize_t n = mp_stream_posix_read(f->stream, buf, len);
+    if (n == -1) {
+        f->stream_pos = -1;
+        return -1;
+    }
+    f->pos = f->stream_pos += n;
+    #if MICROPY_PY_BTREE_READAHEAD
+    f->last_end = f->pos;
+    #endif
+    return n;
+}
+
+STATIC ssize_t btree_file_write(void *fd, const void *buf, size_t len) {
+    btree_file_t *f = fd;
+    #if MICROPY_PY_BTREE_READAHEAD
+    if (f->ra_len != 0 && f->pos < f->ra_pos + (off_t)f->ra_len && f->pos + (off_t)len > f->ra_pos) {
+        f->ra_len = 0;
+    }
+    #endif
+    if (btree_file_sync_pos(f) == -1) {
+        return -1;
+    }
+    ssize_t n = mp_stream_posix_write(f->stream, buf, len);
+    if (n == -1) {
+        f->stream_pos = -1;
+        return -1;
+    }
+    f->pos = f->stream_pos += n;
+    return n;
+}
+
+STATIC off_t btree_file_lseek(void *fd, off_t offset, int whence) {
+    btree_file_t *f = fd;
+    if (whence == SEEK_SET) {
+        f->pos = offset;
+    } else if (whence == SEEK_CUR) {
+        f->pos += offset;
+    } else {
+        f->pos = f->stream_pos = mp_stream_posix_lseek(f->stream, offset, whence);
+    }
+    return f->pos;
+}
+
+STATIC int btree_file_fsync(void *fd) {
+    btree_file_t *f = fd;
+    return mp_stream_posix_fsync(f->stream);
+}
+
 STATIC FILEVTABLE btree_stream_fvtable = {
-    mp_stream_posix_read,
-    mp_stream_posix_write,
-    mp_stream_posix_lseek,
-    mp_stream_posix_fsync
+    btree_file_read,
+    btree_file_write,
+    btree_file_lseek,
+    btree_file_fsync
 };
 
 STATIC mp_obj_t mod_btree_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -352,11 +472,32 @@ STATIC mp_obj_t mod_btree_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t
     openinfo.psize = args.pagesize.u_int;
     openinfo.minkeypage = args.minkeypage.u_int;
 
-    DB *db = __bt_open(MP_OBJ_TO_PTR(pos_args[0]), &btree_stream_fvtable, &openinfo, /*dflags*/0);
+    #if MICROPY_PY_BTREE_CACHESIZE && MICROPY_ENABLE_GC
+    if (openinfo.cachesize == 0) {
+        // size the cache to what the heap can spare
+        gc_info_t info;
+        gc_info(&info);
+        openinfo.cachesize = MIN(info.free / 8, MICROPY_PY_BTREE_CACHESIZE);
+    }
+    #endif
+
+    btree_file_t *file = m_new_obj(btree_file_t);
+    file->stream = MP_OBJ_TO_PTR(pos_args[0]);
+    file->pos = 0;
+    file->stream_pos = -1;
+    #if MICROPY_PY_BTREE_READAHEAD
+    file->sequential = false;
+    file->last_end = -1;
+    file->ra_pos = 0;
+    file->ra_len = 0;
+    file->ra_buf = m_new_maybe(byte, MICROPY_PY_BTREE_READAHEAD);
+    #endif
+
+    DB *db = __bt_open(file, &btree_stream_fvtable, &openinfo, /*dflags*/0);
     if (db == NULL) {
         mp_raise_OSError(errno);
     }
-    return MP_OBJ_FROM_PTR(btree_new(db));
+    return MP_OBJ_FROM_PTR(btree_new(db, file));
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_btree_open_obj, 1, mod_btree_open);
 
@@ -26,20 +26,31 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 
 #include "py/runtime.h"
+#include "py/binary.h"
 
 #if MICROPY_PY_FRAMEBUF
 #include "py/mphal.h"
-// defined for fs operation
-#include "lib/oofatfs/ff.h"
+#include "ports/stm32/font_petme128_8x8.h"
 
-#include "extmod/vfs.h"
-#include "extmod/vfs_fat.h"
+#if MICROPY_PY_MACHINE_DISPLAY
+#include "py/mperrno.h"
+#include "extmod/machine_display.h"
+#endif
 
-#include "ports/stm32/font_petme128_8x8.h"
+// image loaders read from any file or stream
+#if MICROPY_PY_IO
+#include "py/builtin.h"
+#include "py/stream.h"
 #include "bmp.h"
 #include "gif.h"
+#include "jpeg.h"
+#if MICROPY_PY_UZLIB
+#include "uzlib/tinf.h"
+#endif
+#endif
 
 typedef struct _mp_obj_framebuf_t {
     mp_obj_base_t base;
@@ -47,16 +58,25 @@ typedef struct _mp_obj_framebuf_t {
     void *buf;
     uint16_t width, height, stride;
     uint8_t format;
+    // drawing is limited to clip_x0 <= x < clip_x1 and clip_y0 <= y < clip_y1
+    uint16_t clip_x0, clip_y0, clip_x1, clip_y1;
+    // bounding box of pixels drawn since dirty_reset(), empty if x1 <= x0
+    uint16_t dirty_x0, dirty_y0, dirty_x1, dirty_y1;
 } mp_obj_framebuf_t;
 
 typedef void (*setpixel_t)(const mp_obj_framebuf_t*, int, int, uint32_t);
 typedef uint32_t (*getpixel_t)(const mp_obj_framebuf_t*, int, int);
 typedef void (*fill_rect_t)(const mp_obj_framebuf_t *, int, int, int, int, uint32_t);
+typedef void (*span_t)(const mp_obj_framebuf_t *, int, int, int, uint32_t);
 
+// hspan and vspan draw a horizontal or vertical run of pixels that the
+// caller has already clipped to the framebuffer, and len is at least 1
 typedef struct _mp_framebuf_p_t {
     setpixel_t setpixel;
     getpixel_t getpixel;
     fill_rect_t fill_rect;
+    span_t hspan;
+    span_t vspan;
 } mp_framebuf_p_t;
 
 // constants for formats
@@ -96,6 +116,14 @@ STATIC void mono_horiz_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int
     }
 }
 
+STATIC void mono_horiz_hspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    mono_horiz_fill_rect(fb, x, y, len, 1, col);
+}
+
+STATIC void mono_horiz_vspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    mono_horiz_fill_rect(fb, x, y, 1, len, col);
+}
+
 // Functions for MVLSB format
 
 STATIC void mvlsb_setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
@@ -120,6 +148,14 @@ STATIC void mvlsb_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, in
     }
 }
 
+STATIC void mvlsb_hspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    mvlsb_fill_rect(fb, x, y, len, 1, col);
+}
+
+STATIC void mvlsb_vspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    mvlsb_fill_rect(fb, x, y, 1, len, col);
+}
+
 // Functions for RGB565 format
 #define COL0(r, g, b) ((((r) >> 3) << 11) | (((g) >> 2) << 5) | ((b) >> 3))
 #define COL(c) COL0((c >> 16) & 0xff, (c >> 8) & 0xff, c & 0xff)
@@ -134,15 +170,59 @@ STATIC uint32_t rgb565_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
     return ((uint16_t*)fb->buf)[x + y * fb->stride];
 }
 
+// Fill n pixels starting at b with color, storing two pixels per 32-bit
+// word once b is word aligned.
+STATIC void rgb565_fill_run(uint16_t *b, size_t n, uint16_t color) {
+    if (n && ((uintptr_t)b & 2)) {
+        *b++ = color;
+        --n;
+    }
+    uint32_t pair = color | ((uint32_t)color << 16);
+    uint32_t *w = (uint32_t*)b;
+    for (; n >= 8; n -= 8) {
+        w[0] = pair;
+        w[1] = pair;
+        w[2] = pair;
+        w[3] = pair;
+        w += 4;
+    }
+    for (; n >= 2; n -= 2) {
+        *w++ = pair;
+    }
+    if (n) {
+        *(uint16_t*)w = color;
+    }
+}
+
 STATIC void rgb565_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
     col = COL(col);
     uint16_t color = ((col&0xff) << 8) | ((col >> 8) & 0xff);
     uint16_t *b = &((uint16_t*)fb->buf)[x + y * fb->stride];
-    while (h--) {
-        for (int ww = w; ww; --ww) {
-            *b++ = color;
-        }
-        b += fb->stride - w;
+    if (MICROPY_FRAMEBUF_HW_FILL_RGB565(b, fb->stride, w, h, color)) {
+        return;
+    }
+    if (w == fb->stride) {
+        // rows are contiguous, eg fill(), so fill them as one run
+        rgb565_fill_run(b, (size_t)w * h, color);
+        return;
+    }
+    for (; h; --h, b += fb->stride) {
+        rgb565_fill_run(b, w, color);
+    }
+}
+
+STATIC void rgb565_hspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    col = COL(col);
+    uint16_t color = ((col&0xff) << 8) | ((col >> 8) & 0xff);
+    rgb565_fill_run(&((uint16_t*)fb->buf)[x + y * fb->stride], len, color);
+}
+
+STATIC void rgb565_vspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    col = COL(col);
+    uint16_t color = ((col&0xff) << 8) | ((col >> 8) & 0xff);
+    uint16_t *b = &((uint16_t*)fb->buf)[x + y * fb->stride];
+    for (; len; --len, b += fb->stride) {
+        *b = color;
     }
 }
 
@@ -170,6 +250,14 @@ STATIC void gs2_hmsb_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w,
     }
 }
 
+STATIC void gs2_hmsb_hspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    gs2_hmsb_fill_rect(fb, x, y, len, 1, col);
+}
+
+STATIC void gs2_hmsb_vspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    gs2_hmsb_fill_rect(fb, x, y, 1, len, col);
+}
+
 // Functions for GS4_HMSB format
 
 STATIC void gs4_hmsb_setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
@@ -221,6 +309,19 @@ STATIC void gs4_hmsb_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w,
     }
 }
 
+STATIC void gs4_hmsb_hspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    gs4_hmsb_fill_rect(fb, x, y, len, 1, col);
+}
+
+STATIC void gs4_hmsb_vspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    uint8_t *pixel = &((uint8_t*)fb->buf)[(x + y * fb->stride) >> 1];
+    uint8_t mask = (x & 1) ? 0xf0 : 0x0f;
+    uint8_t color = (x & 1) ? (col & 0x0f) : (col << 4);
+    for (int advance = fb->stride >> 1; len; --len, pixel += advance) {
+        *pixel = color | (*pixel & mask);
+    }
+}
+
 // Functions for GS8 format
 //#define COL08(r, g, b) ((((r) >> 5) << 5) | (((g) >> 5) << 2) | ((b) >> 6))
 //#define COL8(c) COL08((c >> 16) & 0xff, (c >> 8) & 0xff, c & 0xff)
@@ -241,14 +342,25 @@ STATIC void gs8_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int
     }
 }
 
+STATIC void gs8_hspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    memset(&((uint8_t*)fb->buf)[(x + y * fb->stride)], col, len);
+}
+
+STATIC void gs8_vspan(const mp_obj_framebuf_t *fb, int x, int y, int len, uint32_t col) {
+    uint8_t *pixel = &((uint8_t*)fb->buf)[(x + y * fb->stride)];
+    for (; len; --len, pixel += fb->stride) {
+        *pixel = col;
+    }
+}
+
 STATIC mp_framebuf_p_t formats[] = {
-    [FRAMEBUF_MVLSB] = {mvlsb_setpixel, mvlsb_getpixel, mvlsb_fill_rect},
-    [FRAMEBUF_RGB565] = {rgb565_setpixel, rgb565_getpixel, rgb565_fill_rect},
-    [FRAMEBUF_GS2_HMSB] = {gs2_hmsb_setpixel, gs2_hmsb_getpixel, gs2_hmsb_fill_rect},
-    [FRAMEBUF_GS4_HMSB] = {gs4_hmsb_setpixel, gs4_hmsb_getpixel, gs4_hmsb_fill_rect},
-    [FRAMEBUF_PL8] = {gs8_setpixel, gs8_getpixel, gs8_fill_rect},
-    [FRAMEBUF_MHLSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect},
-    [FRAMEBUF_MHMSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect},
+    [FRAMEBUF_MVLSB] = {mvlsb_setpixel, mvlsb_getpixel, mvlsb_fill_rect, mvlsb_hspan, mvlsb_vspan},
+    [FRAMEBUF_RGB565] = {rgb565_setpixel, rgb565_getpixel, rgb565_fill_rect, rgb565_hspan, rgb565_vspan},
+    [FRAMEBUF_GS2_HMSB] = {gs2_hmsb_setpixel, gs2_hmsb_getpixel, gs2_hmsb_fill_rect, gs2_hmsb_hspan, gs2_hmsb_vspan},
+    [FRAMEBUF_GS4_HMSB] = {gs4_hmsb_setpixel, gs4_hmsb_getpixel, gs4_hmsb_fill_rect, gs4_hmsb_hspan, gs4_hmsb_vspan},
+    [FRAMEBUF_PL8] = {gs8_setpixel, gs8_getpixel, gs8_fill_rect, gs8_hspan, gs8_vspan},
+    [FRAMEBUF_MHLSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect, mono_horiz_hspan, mono_horiz_vspan},
+    [FRAMEBUF_MHMSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect, mono_horiz_hspan, mono_horiz_vspan},
 };
 
 static inline void setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
@@ -259,21 +371,88 @@ static inline uint32_t getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
     return formats[fb->format].getpixel(fb, x, y);
 }
 
+static inline void framebuf_clip_reset(mp_obj_framebuf_t *fb) {
+    fb->clip_x0 = 0;
+    fb->clip_y0 = 0;
+    fb->clip_x1 = fb->width;
+    fb->clip_y1 = fb->height;
+}
+
+// A new framebuffer has not been shown yet, so it starts out all dirty.
+static inline void framebuf_init_state(mp_obj_framebuf_t *fb) {
+    framebuf_clip_reset(fb);
+    fb->dirty_x0 = 0;
+    fb->dirty_y0 = 0;
+    fb->dirty_x1 = fb->width;
+    fb->dirty_y1 = fb->height;
+}
+
+// Grow the dirty box to include the rectangle from (x0, y0) up to but not
+// including (x1, y1), which the caller has already clipped.  The drawing
+// helpers take a const framebuffer, so the box is the one mutable part.
+static inline void dirty_add(const mp_obj_framebuf_t *fb, int x0, int y0, int x1, int y1) {
+    mp_obj_framebuf_t *self = (mp_obj_framebuf_t*)fb;
+    if (self->dirty_x1 <= self->dirty_x0) {
+        self->dirty_x0 = x0;
+        self->dirty_y0 = y0;
+        self->dirty_x1 = x1;
+        self->dirty_y1 = y1;
+    } else {
+        self->dirty_x0 = MIN(self->dirty_x0, x0);
+        self->dirty_y0 = MIN(self->dirty_y0, y0);
+        self->dirty_x1 = MAX(self->dirty_x1, x1);
+        self->dirty_y1 = MAX(self->dirty_y1, y1);
+    }
+}
+
+static inline bool clip_contains(const mp_obj_framebuf_t *fb, int x, int y) {
+    return fb->clip_x0 <= x && x < fb->clip_x1 && fb->clip_y0 <= y && y < fb->clip_y1;
+}
+
 STATIC void fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
-    if (h < 1 || w < 1 || x + w <= 0 || y + h <= 0 || y >= fb->height || x >= fb->width) {
+    if (h < 1 || w < 1 || x + w <= fb->clip_x0 || y + h <= fb->clip_y0 || y >= fb->clip_y1 || x >= fb->clip_x1) {
         // No operation needed.
         return;
     }
 
-    // clip to the framebuffer
-    int xend = MIN(fb->width, x + w);
-    int yend = MIN(fb->height, y + h);
-    x = MAX(x, 0);
-    y = MAX(y, 0);
+    // clip to the clip rectangle
+    int xend = MIN(fb->clip_x1, x + w);
+    int yend = MIN(fb->clip_y1, y + h);
+    x = MAX(x, fb->clip_x0);
+    y = MAX(y, fb->clip_y0);
+    dirty_add(fb, x, y, xend, yend);
 
     formats[fb->format].fill_rect(fb, x, y, xend - x, yend - y, col);
 }
 
+// Draw the horizontal run of pixels from x0 to x1 inclusive, clipped.
+STATIC void hspan(const mp_obj_framebuf_t *fb, int x0, int x1, int y, uint32_t col) {
+    if (x0 > x1) {
+        int t = x0; x0 = x1; x1 = t;
+    }
+    if (y < fb->clip_y0 || y >= fb->clip_y1 || x1 < fb->clip_x0 || x0 >= fb->clip_x1) {
+        return;
+    }
+    x0 = MAX(x0, fb->clip_x0);
+    x1 = MIN(x1, fb->clip_x1 - 1);
+    dirty_add(fb, x0, y, x1 + 1, y + 1);
+    formats[fb->format].hspan(fb, x0, y, x1 - x0 + 1, col);
+}
+
+// Draw the vertical run of pixels from y0 to y1 inclusive, clipped.
+STATIC void vspan(const mp_obj_framebuf_t *fb, int x, int y0, int y1, uint32_t col) {
+    if (y0 > y1) {
+        int t = y0; y0 = y1; y1 = t;
+    }
+    if (x < fb->clip_x0 || x >= fb->clip_x1 || y1 < fb->clip_y0 || y0 >= fb->clip_y1) {
+        return;
+    }
+    y0 = MAX(y0, fb->clip_y0);
+    y1 = MIN(y1, fb->clip_y1 - 1);
+    dirty_add(fb, x, y0, x + 1, y1 + 1);
+    formats[fb->format].vspan(fb, x, y0, y1 - y0 + 1, col);
+}
+
 STATIC mp_obj_t framebuf_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 4, 5, false);
 
@@ -313,6 +492,7 @@ STATIC mp_obj_t framebuf_make_new(const mp_obj_type_t *type, size_t n_args, size
         default:
             mp_raise_ValueError("invalid format");
     }
+    framebuf_init_state(o);
 
     return MP_OBJ_FROM_PTR(o);
 }
@@ -329,7 +509,7 @@ STATIC mp_int_t framebuf_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo,
 STATIC mp_obj_t framebuf_fill(mp_obj_t self_in, mp_obj_t col_in) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t col = mp_obj_get_int(col_in);
-    formats[self->format].fill_rect(self, 0, 0, self->width, self->height, col);
+    fill_rect(self, 0, 0, self->width, self->height, col);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(framebuf_fill_obj, framebuf_fill);
@@ -358,15 +538,74 @@ STATIC mp_obj_t framebuf_pixel(size_t n_args, const mp_obj_t *args) {
         if (n_args == 3) {
             // get
             return MP_OBJ_NEW_SMALL_INT(getpixel(self, x, y));
-        } else {
+        } else if (clip_contains(self, x, y)) {
             // set
             setpixel(self, x, y, mp_obj_get_int(args[3]));
+            dirty_add(self, x, y, x + 1, y + 1);
         }
     }
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_pixel_obj, 3, 4, framebuf_pixel);
 
+// clip([x, y, w, h]): limit all drawing to a rectangle, or with no arguments
+// allow drawing anywhere again.  Returns the previous clip rectangle.
+STATIC mp_obj_t framebuf_clip(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_t prev[4] = {
+        MP_OBJ_NEW_SMALL_INT(self->clip_x0),
+        MP_OBJ_NEW_SMALL_INT(self->clip_y0),
+        MP_OBJ_NEW_SMALL_INT(self->clip_x1 - self->clip_x0),
+        MP_OBJ_NEW_SMALL_INT(self->clip_y1 - self->clip_y0),
+    };
+    if (n_args == 1) {
+        framebuf_clip_reset(self);
+    } else {
+        mp_int_t x = mp_obj_get_int(args[1]);
+        mp_int_t y = mp_obj_get_int(args[2]);
+        mp_int_t w = mp_obj_get_int(args[3]);
+        mp_int_t h = mp_obj_get_int(args[4]);
+        // intersect with the framebuffer; an empty rectangle stops all drawing
+        mp_int_t x1 = MAX(0, MIN(x + w, self->width));
+        mp_int_t y1 = MAX(0, MIN(y + h, self->height));
+        self->clip_x0 = MIN(MAX(x, 0), x1);
+        self->clip_y0 = MIN(MAX(y, 0), y1);
+        self->clip_x1 = x1;
+        self->clip_y1 = y1;
+    }
+    return mp_obj_new_tuple(4, prev);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_clip_obj, 1, 5, framebuf_clip);
+
+// dirty(): the (x, y, w, h) bounding box of everything drawn since the last
+// dirty_reset(), or an empty tuple if nothing was drawn.  Either can be
+// passed straight to show(rect=...).
+STATIC mp_obj_t framebuf_dirty(mp_obj_t self_in) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->dirty_x1 <= self->dirty_x0) {
+        return mp_const_empty_tuple;
+    }
+    mp_obj_t box[4] = {
+        MP_OBJ_NEW_SMALL_INT(self->dirty_x0),
+        MP_OBJ_NEW_SMALL_INT(self->dirty_y0),
+        MP_OBJ_NEW_SMALL_INT(self->dirty_x1 - self->dirty_x0),
+        MP_OBJ_NEW_SMALL_INT(self->dirty_y1 - self->dirty_y0),
+    };
+    return mp_obj_new_tuple(4, box);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(framebuf_dirty_obj, framebuf_dirty);
+
+// dirty_reset(): forget the dirty box, typically after showing it.
+STATIC mp_obj_t framebuf_dirty_reset(mp_obj_t self_in) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
+    self->dirty_x0 = 0;
+    self->dirty_y0 = 0;
+    self->dirty_x1 = 0;
+    self->dirty_y1 = 0;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(framebuf_dirty_reset_obj, framebuf_dirty_reset);
+
 STATIC mp_obj_t framebuf_hline(size_t n_args, const mp_obj_t *args) {
     (void)n_args;
 
@@ -376,7 +615,9 @@ STATIC mp_obj_t framebuf_hline(size_t n_args, const mp_obj_t *args) {
     mp_int_t w = mp_obj_get_int(args[3]);
     mp_int_t col = mp_obj_get_int(args[4]);
 
-    fill_rect(self, x, y, w, 1, col);
+    if (w > 0) {
+        hspan(self, x, x + w - 1, y, col);
+    }
 
     return mp_const_none;
 }
@@ -391,7 +632,9 @@ STATIC mp_obj_t framebuf_vline(size_t n_args, const mp_obj_t *args) {
     mp_int_t h = mp_obj_get_int(args[3]);
     mp_int_t col = mp_obj_get_int(args[4]);
 
-    fill_rect(self, x, y, 1, h, col);
+    if (h > 0) {
+        vspan(self, x, y, y + h - 1, col);
+    }
 
     return mp_const_none;
 }
@@ -416,7 +659,17 @@ STATIC mp_obj_t framebuf_rect(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_rect_obj, 6, 6, framebuf_rect);
 
+// Bresenham line, drawn as runs of pixels along the major axis so that each
+// run costs one clipped span instead of a setpixel call per pixel.
 static void drawLine(mp_obj_framebuf_t *self, mp_int_t x1, mp_int_t y1, mp_int_t x2, mp_int_t y2, mp_int_t col){
+    if (y1 == y2) {
+        hspan(self, x1, x2, y1, col);
+        return;
+    }
+    if (x1 == x2) {
+        vspan(self, x1, y1, y2, col);
+        return;
+    }
 
     mp_int_t dx = x2 - x1;
     mp_int_t sx;
@@ -447,27 +700,31 @@ static void drawLine(mp_obj_framebuf_t *self, mp_int_t x1, mp_int_t y1, mp_int_t
         steep = false;
     }
 
+    // x1 now steps along the major axis; a run ends when y1 changes
     mp_int_t e = 2 * dy - dx;
+    mp_int_t run_start = x1;
     for (mp_int_t i = 0; i < dx; ++i) {
-        if (steep) {
-            if (0 <= y1 && y1 < self->width && 0 <= x1 && x1 < self->height) {
-                setpixel(self, y1, x1, col);
+        if (e >= 0) {
+            if (steep) {
+                vspan(self, y1, run_start, x1, col);
+            } else {
+                hspan(self, run_start, x1, y1, col);
             }
-        } else {
-            if (0 <= x1 && x1 < self->width && 0 <= y1 && y1 < self->height) {
-                setpixel(self, x1, y1, col);
+            while (e >= 0) {
+                y1 += sy;
+                e -= 2 * dx;
             }
-        }
-        while (e >= 0) {
-            y1 += sy;
-            e -= 2 * dx;
+            run_start = x1 + sx;
         }
         x1 += sx;
         e += 2 * dy;
     }
 
-    if (0 <= x2 && x2 < self->width && 0 <= y2 && y2 < self->height) {
-        setpixel(self, x2, y2, col);
+    // final run, which ends at the end point
+    if (steep) {
+        vspan(self, y1, run_start, x1, col);
+    } else {
+        hspan(self, run_start, x1, y1, col);
     }
 }
 
@@ -485,48 +742,540 @@ STATIC mp_obj_t framebuf_line(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_line_obj, 6, 6, framebuf_line);
 
+// Store a pixel value as it is kept in the framebuffer, without the colour
+// conversion setpixel does for RGB565.
+static inline void setpixel_raw(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
+    if (fb->format == FRAMEBUF_RGB565) {
+        ((uint16_t*)fb->buf)[x + y * fb->stride] = col;
+    } else {
+        setpixel(fb, x, y, col);
+    }
+}
+
+// Index of the GS4_HMSB pixel at pixel offset i into the buffer.
+static inline uint gs4_index(const uint8_t *src, size_t i) {
+    return (src[i >> 1] >> ((i & 1) ? 0 : 4)) & 0x0f;
+}
+
+// Copy n pixels of row sy of source, starting at sx, to (x, y) of self.
+// lut maps source pixel values to destination values and may be NULL.
+// Source pixels equal to key are skipped.
+STATIC void blit_row(const mp_obj_framebuf_t *self, int x, int y,
+    const mp_obj_framebuf_t *source, int sx, int sy, int n, mp_int_t key, const uint16_t *lut) {
+    size_t si = sx + sy * source->stride;
+    if (self->format == FRAMEBUF_RGB565 && (lut != NULL || source->format == FRAMEBUF_RGB565)) {
+        uint16_t *d = &((uint16_t*)self->buf)[x + y * self->stride];
+        if (source->format == FRAMEBUF_PL8) {
+            const uint8_t *src = (const uint8_t*)source->buf + si;
+            for (; n; --n, ++d) {
+                uint idx = *src++;
+                if (idx != (uint)key) {
+                    *d = lut[idx];
+                }
+            }
+            return;
+        } else if (source->format == FRAMEBUF_GS4_HMSB) {
+            const uint8_t *src = source->buf;
+            for (; n; --n, ++d, ++si) {
+                uint idx = gs4_index(src, si);
+                if (idx != (uint)key) {
+                    *d = lut[idx];
+                }
+            }
+            return;
+        } else if (source->format == FRAMEBUF_RGB565 && lut == NULL) {
+            const uint16_t *src = (const uint16_t*)source->buf + si;
+            if (key == -1) {
+                memcpy(d, src, n * sizeof(uint16_t));
+            } else {
+                for (; n; --n, ++d, ++src) {
+                    if (*src != (uint16_t)key) {
+                        *d = *src;
+                    }
+                }
+            }
+            return;
+        }
+    } else if (self->format == FRAMEBUF_PL8 && source->format == FRAMEBUF_PL8) {
+        uint8_t *d = (uint8_t*)self->buf + x + y * self->stride;
+        const uint8_t *src = (const uint8_t*)source->buf + si;
+        if (key == -1 && lut == NULL) {
+            memcpy(d, src, n);
+            return;
+        }
+        for (; n; --n, ++d, ++src) {
+            if (*src != (uint8_t)key) {
+                *d = lut != NULL ? lut[*src] : *src;
+            }
+        }
+        return;
+    }
+    // any other pair of formats
+    for (; n; --n, ++x, ++sx) {
+        uint32_t col = getpixel(source, sx, sy);
+        if (col != (uint32_t)key) {
+            setpixel_raw(self, x, y, lut != NULL ? lut[col & 0xff] : col);
+        }
+    }
+}
+
+// Copy the sw x sh rectangle at (sx, sy) of source to (x, y) of self, clipped
+// to self.  lut and key are as for blit_row.
+STATIC void blit_rect(const mp_obj_framebuf_t *self, int x, int y,
+    const mp_obj_framebuf_t *source, int sx, int sy, int sw, int sh, mp_int_t key, const uint16_t *lut) {
+    if (x >= self->clip_x1 || y >= self->clip_y1 || x + sw <= self->clip_x0 || y + sh <= self->clip_y0) {
+        // Out of bounds, no-op.
+        return;
+    }
+
+    // Clip.
+    int x0 = MAX(self->clip_x0, x);
+    int y0 = MAX(self->clip_y0, y);
+    int x1 = sx + (x0 - x);
+    int y1 = sy + (y0 - y);
+    int x0end = MIN(self->clip_x1, x + sw);
+    int y0end = MIN(self->clip_y1, y + sh);
+    dirty_add(self, x0, y0, x0end, y0end);
+
+    // whole rectangles without a key may be done by the port's accelerator
+    if (key == -1 && self->format == FRAMEBUF_RGB565) {
+        if (source->format == FRAMEBUF_RGB565 && lut == NULL
+            && MICROPY_FRAMEBUF_HW_COPY_RGB565(&((uint16_t*)self->buf)[x0 + y0 * self->stride], self->stride,
+                &((const uint16_t*)source->buf)[x1 + y1 * source->stride], source->stride,
+                x0end - x0, y0end - y0)) {
+            return;
+        }
+        if (source->format == FRAMEBUF_PL8 && lut != NULL
+            && MICROPY_FRAMEBUF_HW_COPY_L8_RGB565(&((uint16_t*)self->buf)[x0 + y0 * self->stride], self->stride,
+                &((const uint8_t*)source->buf)[x1 + y1 * source->stride], source->stride,
+                x0end - x0, y0end - y0, lut)) {
+            return;
+        }
+    }
+
+    for (; y0 < y0end; ++y0, ++y1) {
+        blit_row(self, x0, y0, source, x1, y1, x0end - x0, key, lut);
+    }
+}
+
+// Expand a palette argument into lut, returning lut, or NULL if there is no
+// palette.  The palette is a framebuffer in the destination format whose
+// pixels, read along its rows, are the colours for source pixel values 0, 1, ...
+STATIC const uint16_t *blit_lut(mp_obj_t palette_in, uint16_t *lut) {
+    if (palette_in == mp_const_none) {
+        return NULL;
+    }
+    mp_obj_framebuf_t *palette = MP_OBJ_TO_PTR(palette_in);
+    size_t npal = MIN((size_t)palette->width * palette->height, 256);
+    for (size_t i = 0; i < 256; ++i) {
+        lut[i] = i < npal ? getpixel(palette, i % palette->width, i / palette->width) : 0;
+    }
+    return lut;
+}
+
+// Sprite: the opaque pixels of a framebuffer, run-length encoded.  Each row
+// is stored as a span count followed by the spans, each of which is a count
+// of transparent pixels to skip, a count of opaque pixels, and the opaque
+// pixels themselves (2 bytes each for RGB565, otherwise 1 byte per pixel).
+
+typedef struct _mp_obj_sprite_t {
+    mp_obj_base_t base;
+    uint8_t *data;
+    size_t len;
+    uint16_t width, height;
+    uint8_t format; // FRAMEBUF_RGB565 or FRAMEBUF_PL8
+} mp_obj_sprite_t;
+
+STATIC const mp_obj_type_t mp_type_sprite;
+
+// Encode source into data, or just count the bytes needed if data is NULL.
+STATIC size_t sprite_encode(const mp_obj_framebuf_t *source, mp_int_t key, uint8_t *data) {
+    size_t bpp = source->format == FRAMEBUF_RGB565 ? 2 : 1;
+    size_t n = 0;
+    for (int y = 0; y < source->height; ++y) {
+        size_t count_pos = n++;
+        uint nspans = 0;
+        int x = 0;
+        while (x < source->width) {
+            int start = x;
+            while (x < source->width && getpixel(source, x, y) == (uint32_t)key) {
+                ++x;
+            }
+            if (x == source->width) {
+                break;
+            }
+            int skip = x - start;
+            int opaque = x;
+            while (x < source->width && getpixel(source, x, y) != (uint32_t)key) {
+                ++x;
+            }
+            if (data != NULL) {
+                data[n] = skip;
+                data[n + 1] = x - opaque;
+                uint8_t *d = &data[n + 2];
+                for (int i = opaque; i < x; ++i) {
+                    uint32_t col = getpixel(source, i, y);
+                    *d++ = col;
+                    if (bpp == 2) {
+                        *d++ = col >> 8;
+                    }
+                }
+            }
+            n += 2 + (x - opaque) * bpp;
+            ++nspans;
+        }
+        if (data != NULL) {
+            data[count_pos] = nspans;
+        }
+    }
+    return n;
+}
+
+// Sprite(fb, key): encode the pixels of fb that are not equal to key.
+STATIC mp_obj_t sprite_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 2, 2, false);
+    mp_obj_framebuf_t *source = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t key = mp_obj_get_int(args[1]);
+    if (source->width > 255) {
+        // the span lengths are stored in a byte
+        mp_raise_ValueError(NULL);
+    }
+    mp_obj_sprite_t *o = m_new_obj(mp_obj_sprite_t);
+    o->base.type = type;
+    o->width = source->width;
+    o->height = source->height;
+    o->format = source->format == FRAMEBUF_RGB565 ? FRAMEBUF_RGB565 : FRAMEBUF_PL8;
+    o->len = sprite_encode(source, key, NULL);
+    o->data = m_new(uint8_t, o->len);
+    sprite_encode(source, key, o->data);
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_int_t sprite_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    (void)flags;
+    mp_obj_sprite_t *self = MP_OBJ_TO_PTR(self_in);
+    bufinfo->buf = self->data;
+    bufinfo->len = self->len;
+    bufinfo->typecode = 'B';
+    return 0;
+}
+
+STATIC const mp_obj_type_t mp_type_sprite = {
+    { &mp_type_type },
+    .name = MP_QSTR_Sprite,
+    .make_new = sprite_make_new,
+    .buffer_p = { .get_buffer = sprite_get_buffer },
+};
+
+// Draw a sprite at (x, y), jumping over its transparent runs.
+STATIC void sprite_blit(const mp_obj_framebuf_t *self, const mp_obj_sprite_t *spr, int x, int y, const uint16_t *lut) {
+    size_t bpp = spr->format == FRAMEBUF_RGB565 ? 2 : 1;
+    const uint8_t *p = spr->data;
+    for (int row = 0; row < spr->height; ++row) {
+        uint nspans = *p++;
+        int dy = y + row;
+        if (dy < self->clip_y0 || dy >= self->clip_y1) {
+            // skip the row without drawing it
+            for (; nspans; --nspans) {
+                p += 2 + p[1] * bpp;
+            }
+            continue;
+        }
+        int dx = x;
+        for (; nspans; --nspans) {
+            dx += p[0];
+            int len = p[1];
+            const uint8_t *src = p + 2;
+            p += 2 + len * bpp;
+            // clip the span
+            int x0 = MAX(dx, self->clip_x0);
+            int x1 = MIN(dx + len, self->clip_x1);
+            dx += len;
+            if (x0 >= x1) {
+                continue;
+            }
+            dirty_add(self, x0, dy, x1, dy + 1);
+            src += (x0 - (dx - len)) * bpp;
+            int n = x1 - x0;
+            if (self->format == FRAMEBUF_RGB565 && bpp == 2 && lut == NULL) {
+                memcpy(&((uint16_t*)self->buf)[x0 + dy * self->stride], src, n * 2);
+            } else if (self->format == FRAMEBUF_PL8 && bpp == 1 && lut == NULL) {
+                memcpy(&((uint8_t*)self->buf)[x0 + dy * self->stride], src, n);
+            } else if (self->format == FRAMEBUF_RGB565 && bpp == 1) {
+                uint16_t *d = &((uint16_t*)self->buf)[x0 + dy * self->stride];
+                for (; n; --n) {
+                    uint v = *src++;
+                    *d++ = lut != NULL ? lut[v] : v;
+                }
+            } else {
+                for (; n; --n, ++x0, src += bpp) {
+                    uint32_t v = bpp == 2 ? (src[0] | src[1] << 8) : src[0];
+                    setpixel_raw(self, x0, dy, lut != NULL ? lut[v & 0xff] : v);
+                }
+            }
+        }
+    }
+}
+
 STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
-    mp_obj_framebuf_t *source = MP_OBJ_TO_PTR(args[1]);
     mp_int_t x = mp_obj_get_int(args[2]);
     mp_int_t y = mp_obj_get_int(args[3]);
     mp_int_t key = -1;
     if (n_args > 4) {
         key = mp_obj_get_int(args[4]);
     }
+    uint16_t lut_buf[256];
+    const uint16_t *lut = blit_lut(n_args > 5 ? args[5] : mp_const_none, lut_buf);
 
-    if (
-        (x >= self->width) ||
-        (y >= self->height) ||
-        (-x >= source->width) ||
-        (-y >= source->height)
-    ) {
-        // Out of bounds, no-op.
+    if (mp_obj_is_type(args[1], &mp_type_sprite)) {
+        // transparency is already encoded in the sprite, so key is not used
+        sprite_blit(self, MP_OBJ_TO_PTR(args[1]), x, y, lut);
         return mp_const_none;
     }
+    mp_obj_framebuf_t *source = MP_OBJ_TO_PTR(args[1]);
+    blit_rect(self, x, y, source, 0, 0, source->width, source->height, key, lut);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_blit_obj, 4, 6, framebuf_blit);
+
+// Fixed point with 16 fractional bits, used to step through the source of a
+// scaled or rotated blit.
+#define FB_FIX_SHIFT (16)
+#define FB_FIX_ONE (1 << FB_FIX_SHIFT)
+
+STATIC int32_t framebuf_get_fixed(mp_obj_t o) {
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (!mp_obj_is_int(o)) {
+        return (int32_t)(mp_obj_get_float(o) * FB_FIX_ONE);
+    }
+    #endif
+    return mp_obj_get_int(o) * FB_FIX_ONE;
+}
 
-    // Clip.
-    int x0 = MAX(0, x);
-    int y0 = MAX(0, y);
-    int x1 = MAX(0, -x);
-    int y1 = MAX(0, -y);
-    int x0end = MIN(self->width, x + source->width);
-    int y0end = MIN(self->height, y + source->height);
-
-    for (; y0 < y0end; ++y0) {
-        int cx1 = x1;
-        for (int cx0 = x0; cx0 < x0end; ++cx0) {
-            uint32_t col = getpixel(source, cx1, y1);
-            if (col != (uint32_t)key) {
-                setpixel(self, cx0, y0, col);
+// Write n pixels along row y of self from x, taking each from source at
+// fixed point position (u, v) and stepping it by (du, dv) per pixel.
+// Positions outside the source and pixels equal to key are skipped.
+STATIC void blit_row_mapped(const mp_obj_framebuf_t *self, int x, int y, int n,
+    const mp_obj_framebuf_t *source, int32_t u, int32_t v, int32_t du, int32_t dv, mp_int_t key) {
+    uint32_t sw = source->width;
+    uint32_t sh = source->height;
+    if (self->format == FRAMEBUF_RGB565 && source->format == FRAMEBUF_RGB565) {
+        uint16_t *d = &((uint16_t*)self->buf)[x + y * self->stride];
+        const uint16_t *src = source->buf;
+        for (; n; --n, ++d, u += du, v += dv) {
+            uint32_t su = u >> FB_FIX_SHIFT, sv = v >> FB_FIX_SHIFT;
+            if (su < sw && sv < sh) {
+                uint16_t col = src[su + sv * source->stride];
+                if (col != (uint16_t)key) {
+                    *d = col;
+                }
+            }
+        }
+    } else if (self->format == FRAMEBUF_PL8 && source->format == FRAMEBUF_PL8) {
+        uint8_t *d = &((uint8_t*)self->buf)[x + y * self->stride];
+        const uint8_t *src = source->buf;
+        for (; n; --n, ++d, u += du, v += dv) {
+            uint32_t su = u >> FB_FIX_SHIFT, sv = v >> FB_FIX_SHIFT;
+            if (su < sw && sv < sh) {
+                uint8_t col = src[su + sv * source->stride];
+                if (col != (uint8_t)key) {
+                    *d = col;
+                }
+            }
+        }
+    } else {
+        for (; n; --n, ++x, u += du, v += dv) {
+            uint32_t su = u >> FB_FIX_SHIFT, sv = v >> FB_FIX_SHIFT;
+            if (su < sw && sv < sh) {
+                uint32_t col = getpixel(source, su, sv);
+                if (col != (uint32_t)key) {
+                    setpixel_raw(self, x, y, col);
+                }
+            }
+        }
+    }
+}
+
+// blit_scaled(src, x, y, sx, sy[, key]): draw src at (x, y) scaled by sx
+// horizontally and sy vertically, which may be fractional.
+STATIC mp_obj_t framebuf_blit_scaled(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_framebuf_t *source = MP_OBJ_TO_PTR(args[1]);
+    mp_int_t x = mp_obj_get_int(args[2]);
+    mp_int_t y = mp_obj_get_int(args[3]);
+    int32_t sx = framebuf_get_fixed(args[4]);
+    int32_t sy = framebuf_get_fixed(args[5]);
+    mp_int_t key = -1;
+    if (n_args > 6) {
+        key = mp_obj_get_int(args[6]);
+    }
+    if (sx <= 0 || sy <= 0) {
+        mp_raise_ValueError(NULL);
+    }
+
+    // destination size, and source step per destination pixel
+    int w = ((int64_t)source->width * sx) >> FB_FIX_SHIFT;
+    int h = ((int64_t)source->height * sy) >> FB_FIX_SHIFT;
+    int32_t du = ((int64_t)FB_FIX_ONE << FB_FIX_SHIFT) / sx;
+    int32_t dv = ((int64_t)FB_FIX_ONE << FB_FIX_SHIFT) / sy;
+
+    // clip
+    int x0 = MAX(x, self->clip_x0);
+    int y0 = MAX(y, self->clip_y0);
+    int x1 = MIN(x + w, self->clip_x1);
+    int y1 = MIN(y + h, self->clip_y1);
+    // sample the source at the centre of each destination pixel
+    int32_t u = (x0 - x) * du + du / 2;
+    if (x0 < x1 && y0 < y1) {
+        dirty_add(self, x0, y0, x1, y1);
+    }
+    for (int32_t v = (y0 - y) * dv + dv / 2; y0 < y1; ++y0, v += dv) {
+        if (x0 < x1) {
+            blit_row_mapped(self, x0, y0, x1 - x0, source, u, v, du, 0, key);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_blit_scaled_obj, 6, 7, framebuf_blit_scaled);
+
+#if MICROPY_PY_BUILTINS_FLOAT
+// blit_rotated(src, cx, cy, angle[, key]): draw src rotated clockwise by
+// angle degrees about its centre, with the centre placed at (cx, cy).
+STATIC mp_obj_t framebuf_blit_rotated(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_framebuf_t *source = MP_OBJ_TO_PTR(args[1]);
+    mp_int_t cx = mp_obj_get_int(args[2]);
+    mp_int_t cy = mp_obj_get_int(args[3]);
+    mp_float_t angle = mp_obj_get_float(args[4]) * (MICROPY_FLOAT_CONST(3.14159265358979) / 180);
+    mp_int_t key = -1;
+    if (n_args > 5) {
+        key = mp_obj_get_int(args[5]);
+    }
+    int32_t c = (int32_t)(MICROPY_FLOAT_C_FUN(cos)(angle) * FB_FIX_ONE);
+    int32_t s = (int32_t)(MICROPY_FLOAT_C_FUN(sin)(angle) * FB_FIX_ONE);
+
+    // the rotated source fits in a square with the length of its diagonal
+    int half = (int)MICROPY_FLOAT_C_FUN(sqrt)((mp_float_t)(source->width * source->width + source->height * source->height)) / 2 + 1;
+    int x0 = MAX(cx - half, self->clip_x0);
+    int y0 = MAX(cy - half, self->clip_y0);
+    int x1 = MIN(cx + half + 1, self->clip_x1);
+    int y1 = MIN(cy + half + 1, self->clip_y1);
+    if (x0 >= x1 || y0 >= y1) {
+        return mp_const_none;
+    }
+    dirty_add(self, x0, y0, x1, y1);
+
+    // inverse map each destination pixel centre back into the source:
+    // u = c * dx + s * dy + w / 2, v = -s * dx + c * dy + h / 2
+    int32_t su0 = source->width << (FB_FIX_SHIFT - 1);
+    int32_t sv0 = source->height << (FB_FIX_SHIFT - 1);
+    for (int y = y0; y < y1; ++y) {
+        int32_t dx = (x0 - cx) * FB_FIX_ONE + FB_FIX_ONE / 2;
+        int32_t dy = (y - cy) * FB_FIX_ONE + FB_FIX_ONE / 2;
+        int32_t u = (int32_t)(((int64_t)c * dx + (int64_t)s * dy) >> FB_FIX_SHIFT) + su0;
+        int32_t v = (int32_t)(((int64_t)c * dy - (int64_t)s * dx) >> FB_FIX_SHIFT) + sv0;
+        blit_row_mapped(self, x0, y, x1 - x0, source, u, v, c, -s, key);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_blit_rotated_obj, 5, 6, framebuf_blit_rotated);
+#endif
+
+// TileMap: a grid of tile indices into a sheet of equally sized tiles
+
+typedef struct _mp_obj_tilemap_t {
+    mp_obj_base_t base;
+    mp_obj_t sheet;
+    mp_obj_t map_obj;
+    uint16_t tile_w, tile_h;
+    uint16_t map_w;
+} mp_obj_tilemap_t;
+
+STATIC const mp_obj_type_t mp_type_tilemap;
+
+// TileMap(sheet, tile_w, tile_h, map, map_w): sheet is a FrameBuffer holding
+// tiles of tile_w x tile_h pixels, numbered along its rows, and map is a buffer
+// of tile numbers, map_w per row.  Tile numbers past the end of the sheet are
+// left empty.
+STATIC mp_obj_t tilemap_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 5, 5, false);
+    mp_obj_tilemap_t *o = m_new_obj(mp_obj_tilemap_t);
+    o->base.type = type;
+    o->sheet = args[0];
+    o->tile_w = mp_obj_get_int(args[1]);
+    o->tile_h = mp_obj_get_int(args[2]);
+    o->map_obj = args[3];
+    o->map_w = mp_obj_get_int(args[4]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(o->map_obj, &bufinfo, MP_BUFFER_READ);
+    mp_obj_framebuf_t *sheet = MP_OBJ_TO_PTR(o->sheet);
+    if (o->tile_w == 0 || o->tile_h == 0 || o->map_w == 0
+        || o->tile_w > sheet->width || o->tile_h > sheet->height) {
+        mp_raise_ValueError(NULL);
+    }
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC const mp_obj_type_t mp_type_tilemap = {
+    { &mp_type_type },
+    .name = MP_QSTR_TileMap,
+    .make_new = tilemap_make_new,
+};
+
+// Draw the part of tm seen from map pixel position (scroll_x, scroll_y),
+// visiting only the tiles that overlap the framebuffer.
+STATIC void draw_tilemap(const mp_obj_framebuf_t *fb, const mp_obj_tilemap_t *tm,
+    int scroll_x, int scroll_y, mp_int_t key, const uint16_t *lut) {
+    const mp_obj_framebuf_t *sheet = MP_OBJ_TO_PTR(tm->sheet);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(tm->map_obj, &bufinfo, MP_BUFFER_READ);
+    const uint8_t *map = bufinfo.buf;
+    int tw = tm->tile_w;
+    int th = tm->tile_h;
+    int map_w = tm->map_w;
+    int map_h = bufinfo.len / map_w;
+    uint sheet_cols = sheet->width / tw;
+    uint ntiles = sheet_cols * (sheet->height / th);
+
+    // range of map cells that overlap the clip rectangle
+    int left = scroll_x + fb->clip_x0;
+    int top = scroll_y + fb->clip_y0;
+    int c0 = left >= 0 ? left / tw : -((-left + tw - 1) / tw);
+    int r0 = top >= 0 ? top / th : -((-top + th - 1) / th);
+    int c1 = MIN(map_w, (scroll_x + fb->clip_x1 + tw - 1) / tw);
+    int r1 = MIN(map_h, (scroll_y + fb->clip_y1 + th - 1) / th);
+    for (int r = MAX(r0, 0); r < r1; ++r) {
+        int y = r * th - scroll_y;
+        for (int c = MAX(c0, 0); c < c1; ++c) {
+            uint tile = map[r * map_w + c];
+            if (tile >= ntiles) {
+                continue;
             }
-            ++cx1;
+            blit_rect(fb, c * tw - scroll_x, y, sheet,
+                (tile % sheet_cols) * tw, (tile / sheet_cols) * th, tw, th, key, lut);
         }
-        ++y1;
     }
+}
+
+STATIC mp_obj_t framebuf_draw_tilemap(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (!mp_obj_is_type(args[1], &mp_type_tilemap)) {
+        mp_raise_TypeError(NULL);
+    }
+    mp_obj_tilemap_t *tm = MP_OBJ_TO_PTR(args[1]);
+    mp_int_t scroll_x = mp_obj_get_int(args[2]);
+    mp_int_t scroll_y = mp_obj_get_int(args[3]);
+    mp_int_t key = -1;
+    if (n_args > 4) {
+        key = mp_obj_get_int(args[4]);
+    }
+    uint16_t lut_buf[256];
+    const uint16_t *lut = blit_lut(n_args > 5 ? args[5] : mp_const_none, lut_buf);
+    draw_tilemap(self, tm, scroll_x, scroll_y, key, lut);
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_blit_obj, 4, 5, framebuf_blit);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_draw_tilemap_obj, 4, 6, framebuf_draw_tilemap);
 
 STATIC mp_obj_t framebuf_scroll(mp_obj_t self_in, mp_obj_t xstep_in, mp_obj_t ystep_in) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
@@ -556,810 +1305,2413 @@ STATIC mp_obj_t framebuf_scroll(mp_obj_t self_in, mp_obj_t xstep_in, mp_obj_t ys
             setpixel(self, x, y, getpixel(self, x - xstep, y - ystep));
         }
     }
+    dirty_add(self, 0, 0, self->width, self->height);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(framebuf_scroll_obj, framebuf_scroll);
 
-STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
-    // extract arguments
-    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
-    const char *str = mp_obj_str_get_str(args[1]);
-    mp_int_t x0 = mp_obj_get_int(args[2]);
-    mp_int_t y0 = mp_obj_get_int(args[3]);
-    mp_int_t col = 1;
-    if (n_args >= 5) {
-        col = mp_obj_get_int(args[4]);
+// Compact font format accepted by text(..., font):
+//   byte 0: flags, bit 0 set if glyphs have 2 bits per pixel (anti-aliased)
+//   byte 1: glyph height in pixels
+//   bytes 2, 3: first and last character code
+//   then for each character: 16-bit little-endian offset of its bitmap from
+//   the end of this table, followed by its width in pixels
+//   bitmaps: rows from the top, each padded to a whole byte, with the
+//   leftmost pixel in the most significant bits
+#define FONT_FLAG_AA (0x01)
+#define FONT_HEADER_SIZE (4)
+#define FONT_ENTRY_SIZE (3)
+
+// Blend col into the pixel at (x, y) with coverage level (1 to 3) out of 3.
+// Only RGB565 can show partial coverage; other formats draw levels 2 and 3.
+STATIC void text_blend_pixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col, uint level) {
+    if (!clip_contains(fb, x, y)) {
+        return;
     }
-
-    // loop over chars
-    for (; *str; ++str) {
-        // get char and make sure its in range of font
-        int chr = *(uint8_t*)str;
-        if (chr < 32 || chr > 127) {
-            chr = 127;
-        }
-        // get char data
-        const uint8_t *chr_data = &font_petme128_8x8[(chr - 32) * 8];
-        // loop over char data
-        for (int j = 0; j < 8; j++, x0++) {
-            if (0 <= x0 && x0 < self->width) { // clip x
-                uint vline_data = chr_data[j]; // each byte is a column of 8 pixels, LSB at top
-                for (int y = y0; vline_data; vline_data >>= 1, y++) { // scan over vertical column
-                    if (vline_data & 1) { // only draw if pixel set
-                        if (0 <= y && y < self->height) { // clip y
-                            setpixel(self, x0, y, col);
-                        }
-                    }
-                }
-            }
+    dirty_add(fb, x, y, x + 1, y + 1);
+    if (fb->format != FRAMEBUF_RGB565) {
+        if (level >= 2) {
+            setpixel(fb, x, y, col);
         }
+        return;
     }
-    return mp_const_none;
+    uint16_t *p = &((uint16_t*)fb->buf)[x + y * fb->stride];
+    uint16_t d = (*p >> 8) | (*p << 8);
+    int dr = d >> 11, dg = (d >> 5) & 0x3f, db = d & 0x1f;
+    uint16_t c = COL(col);
+    int sr = c >> 11, sg = (c >> 5) & 0x3f, sb = c & 0x1f;
+    dr += (sr - dr) * (int)level / 3;
+    dg += (sg - dg) * (int)level / 3;
+    db += (sb - db) * (int)level / 3;
+    d = dr << 11 | dg << 5 | db;
+    *p = (d >> 8) | (d << 8);
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_text_obj, 4, 5, framebuf_text);
 
-extern fs_user_mount_t fs_user_mount_flash;
-STATIC mp_obj_t framebuf_loadbmp(size_t n_args, const mp_obj_t *args) {
-    (void)n_args;
-    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
-    const char *filename = mp_obj_str_get_str(args[1]);
-    mp_int_t x0 = 0;
-    mp_int_t y0 = 0;
-    if (n_args > 2){
-        x0 = mp_obj_get_int(args[2]);
-        y0 = mp_obj_get_int(args[3]);
+// Draw one character of the builtin 8x8 font, each column as vertical runs.
+STATIC void text_char_builtin(const mp_obj_framebuf_t *fb, int chr, int x0, int y0, int scale, uint32_t col) {
+    if (chr < 32 || chr > 127) {
+        chr = 127;
+    }
+    const uint8_t *chr_data = &font_petme128_8x8[(chr - 32) * 8];
+    for (int j = 0; j < 8; j++, x0 += scale) {
+        uint vline_data = chr_data[j]; // each byte is a column of 8 pixels, LSB at top
+        for (int y = 0; vline_data; ) {
+            if (!(vline_data & 1)) {
+                vline_data >>= 1;
+                ++y;
+                continue;
+            }
+            int start = y;
+            while (vline_data & 1) {
+                vline_data >>= 1;
+                ++y;
+            }
+            fill_rect(fb, x0, y0 + start * scale, scale, (y - start) * scale, col);
+        }
     }
+}
 
-    
-    fs_user_mount_t *vfs_fat = &fs_user_mount_flash;
-    uint8_t res;
-    UINT br;
-    uint8_t rgb ,color_byte;
-    uint32_t color;
-    uint16_t x, y;
-    uint16_t count;
-    FIL fp;
-    uint8_t * databuf;
-    uint16_t readlen=BMP_DBUF_SIZE;
-    uint32_t imgWidth, imgHeight;
-
-    uint16_t countpix=0;//记录像素 
-    //x,y的实际坐标	
-    //uint16_t  realx=0;
-    //uint16_t realy=0;
-    //uint8_t  yok=1;			   
-
-    uint8_t *bmpbuf;
-    // uint8_t biCompression=0;
-
-    uint16_t rowlen;
-    BITMAPINFO *pbmp;
-
-    databuf = (uint8_t*)m_malloc(readlen);
-    res = f_open(&vfs_fat->fatfs, &fp, filename, FA_READ);
-    if (res == 0){
-        res = f_read(&fp, databuf, readlen, &br);
-        
-        pbmp=(BITMAPINFO*)databuf;
-        count=pbmp->bmfHeader.bfOffBits;        	//数据偏移,得到数据段的开始地址
-        color_byte=pbmp->bmiHeader.biBitCount/8;	//彩色位 16/24/32  
-        // biCompression=pbmp->bmiHeader.biCompression;//压缩方式
-        imgWidth = pbmp->bmiHeader.biWidth;
-        imgHeight = pbmp->bmiHeader.biHeight;
-
-        // printf("bmp %d %d %ld %ld\n", biCompression, color_byte, pbmp->bmiHeader.biHeight, pbmp->bmiHeader.biWidth);
-
-        //开始解码BMP   
-        rowlen = imgWidth * color_byte;
-        color=0;//颜色清空
-        x=0;
-        y=imgHeight;
-        rgb=0;
-        //对于尺寸小于等于设定尺寸的图片,进行快速解码
-        //realy=(y*picinfo.Div_Fac)>>13;
-        bmpbuf=databuf;
-
-        if (color_byte!=3 && color_byte!=4){
-            printf("only support 24/32 bit bmp\r\n");
-        }
-
-        while(1){
-            while(count<readlen){  //读取一簇1024扇区 (SectorsPerClust 每簇扇区数)
-                if(color_byte==3){   //24位颜色图
-                    switch (rgb){
-                        case 0:				  
-                            color=bmpbuf[count]; //B
-                            break ;	   
-                        case 1: 	 
-                            color+=((uint16_t)bmpbuf[count]<<8);//G
-                            break;	  
-                        case 2 : 
-                            color+=((uint32_t)bmpbuf[count]<<16);//R	  
-                            break ;			
-                    }
-                } else if(color_byte==4){//32位颜色图
-					switch (rgb){
-						case 0:				  
-							color=bmpbuf[count]; //B
-							break ;	   
-						case 1: 	 
-							color+=((uint16_t)bmpbuf[count]<<8);//G
-							break;	  
-						case 2 : 
-							color+=((uint32_t)bmpbuf[count]<<16);//R	  
-							break ;			
-						case 3 :
-							//alphabend=bmpbuf[count];//不读取  ALPHA通道
-							break ;  		  	 
-					}	
-				}
-                rgb++;	  
-                count++;
-                if(rgb==color_byte){ //水平方向读取到1像素数数据后显示	
-                    if(x < imgWidth){	
-                        setpixel(self, x0 + x, y0 + y, color);
+// Draw one character of a font in the compact format, each row as runs of
+// fully covered pixels.  Returns the width of the character in pixels.
+STATIC int text_char_font(const mp_obj_framebuf_t *fb, const mp_buffer_info_t *font, int chr, int x0, int y0, int scale, uint32_t col) {
+    const uint8_t *f = font->buf;
+    uint first = f[2];
+    uint last = f[3];
+    if (chr < (int)first || chr > (int)last) {
+        return 0;
+    }
+    const uint8_t *entry = &f[FONT_HEADER_SIZE + (chr - first) * FONT_ENTRY_SIZE];
+    size_t offset = FONT_HEADER_SIZE + (last - first + 1) * FONT_ENTRY_SIZE + (entry[0] | entry[1] << 8);
+    int w = entry[2];
+    int h = f[1];
+    uint bpp = (f[0] & FONT_FLAG_AA) ? 2 : 1;
+    size_t row_bytes = (w * bpp + 7) / 8;
+    if (offset + row_bytes * h > font->len) {
+        // truncated font, don't read past its end
+        return w;
+    }
+    const uint8_t *row = f + offset;
+    uint max_level = (1 << bpp) - 1;
+    for (int r = 0; r < h; ++r, row += row_bytes) {
+        int y = y0 + r * scale;
+        for (int i = 0; i < w; ) {
+            uint level = (row[i * bpp / 8] >> (8 - bpp - (i * bpp) % 8)) & max_level;
+            if (level == 0) {
+                ++i;
+                continue;
+            }
+            if (level < max_level) {
+                // partially covered pixel
+                for (int yy = 0; yy < scale; ++yy) {
+                    for (int xx = 0; xx < scale; ++xx) {
+                        text_blend_pixel(fb, x0 + i * scale + xx, y + yy, col, level);
                     }
-                    x++;//x轴增加一个像素
-                    color=0x00;
-                    rgb=0;
-                }
-                countpix++;//像素累加
-                if(countpix>=rowlen){//水平方向像素值到了.换行
-                    y--; 
-                    if(y==0)break;
-                    x=0; 
-                    countpix=0;
-                    color=0x00;
-                    rgb=0;
                 }
+                ++i;
+                continue;
+            }
+            int start = i;
+            while (i < w && ((row[i * bpp / 8] >> (8 - bpp - (i * bpp) % 8)) & max_level) == max_level) {
+                ++i;
             }
-            res=f_read(&fp, databuf, readlen, &br);//读出readlen个字节
-            if(br!=readlen)readlen=br;	//最后一批数据		  
-            if(res||br==0)break;		//读取出错
-            bmpbuf=databuf;
-            count=0;
+            fill_rect(fb, x0 + start * scale, y, (i - start) * scale, scale, col);
+        }
+    }
+    return w;
+}
+
+STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
+    // extract arguments
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    const char *str = mp_obj_str_get_str(args[1]);
+    mp_int_t x0 = mp_obj_get_int(args[2]);
+    mp_int_t y0 = mp_obj_get_int(args[3]);
+    mp_int_t col = 1;
+    if (n_args >= 5) {
+        col = mp_obj_get_int(args[4]);
+    }
+    mp_buffer_info_t font = { .buf = NULL };
+    if (n_args >= 6 && args[5] != mp_const_none) {
+        mp_get_buffer_raise(args[5], &font, MP_BUFFER_READ);
+        const uint8_t *f = font.buf;
+        if (font.len < FONT_HEADER_SIZE || f[2] > f[3]
+            || font.len < (size_t)(FONT_HEADER_SIZE + (f[3] - f[2] + 1) * FONT_ENTRY_SIZE)) {
+            mp_raise_ValueError("invalid font");
+        }
+    }
+    mp_int_t scale = 1;
+    if (n_args >= 7) {
+        scale = mp_obj_get_int(args[6]);
+        if (scale < 1) {
+            mp_raise_ValueError(NULL);
         }
-        f_close(&fp);
     }
-    m_free(databuf);
 
+    // loop over chars
+    for (; *str; ++str) {
+        int chr = *(uint8_t*)str;
+        if (x0 >= self->clip_x1) {
+            break;
+        }
+        if (font.buf == NULL) {
+            text_char_builtin(self, chr, x0, y0, scale, col);
+            x0 += 8 * scale;
+        } else {
+            x0 += text_char_font(self, &font, chr, x0, y0, scale, col) * scale;
+        }
+    }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_loadbmp_obj, 2, 4, framebuf_loadbmp);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_text_obj, 4, 7, framebuf_text);
+
+#if MICROPY_PY_IO
+// Totals for framebuf.loader_stats(), gathered only while it is enabled.
+// Time not spent reading the stream or writing pixels is put down to
+// decoding.
+typedef struct _loader_stats_t {
+    bool enabled;
+    mp_uint_t bytes, pixels;
+    mp_uint_t io_us, blit_us, total_us;
+} loader_stats_t;
+
+STATIC loader_stats_t loader_stats;
+
+static inline mp_uint_t stats_start(void) {
+    return loader_stats.enabled ? mp_hal_ticks_us() : 0;
+}
+
+static inline void stats_add(mp_uint_t *us, mp_uint_t t0) {
+    if (loader_stats.enabled) {
+        *us += mp_hal_ticks_us() - t0;
+    }
+}
+
+static inline void stats_pixels(mp_uint_t n) {
+    loader_stats.pixels += n;
+}
+
+// loader_stats([enable]): with an argument, turn gathering of image loader
+// statistics on or off.  Without, return the totals since the last call as
+// (bytes read, pixels written, I/O us, decode us, pixel writing us).  Either
+// way the totals are then cleared.
+STATIC mp_obj_t framebuf_loader_stats(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t ret = mp_const_none;
+    if (n_args > 0) {
+        loader_stats.enabled = mp_obj_is_true(args[0]);
+    } else {
+        mp_uint_t other = loader_stats.io_us + loader_stats.blit_us;
+        mp_obj_t stats[5] = {
+            mp_obj_new_int_from_uint(loader_stats.bytes),
+            mp_obj_new_int_from_uint(loader_stats.pixels),
+            mp_obj_new_int_from_uint(loader_stats.io_us),
+            mp_obj_new_int_from_uint(loader_stats.total_us > other ? loader_stats.total_us - other : 0),
+            mp_obj_new_int_from_uint(loader_stats.blit_us),
+        };
+        ret = mp_obj_new_tuple(5, stats);
+    }
+    bool enabled = loader_stats.enabled;
+    memset(&loader_stats, 0, sizeof(loader_stats));
+    loader_stats.enabled = enabled;
+    return ret;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_loader_stats_obj, 0, 1, framebuf_loader_stats);
+
+// Image loaders take either a file name, which is opened and closed here, or
+// an already open binary stream, so they work on any mounted filesystem.
+STATIC mp_obj_t image_open(mp_obj_t file, bool *opened) {
+    *opened = mp_obj_is_str(file);
+    if (*opened) {
+        mp_obj_t open_args[2] = {file, MP_OBJ_NEW_QSTR(MP_QSTR_rb)};
+        file = mp_builtin_open(2, open_args, (mp_map_t*)&mp_const_empty_map);
+    }
+    mp_get_stream_raise(file, MP_STREAM_OP_READ);
+    return file;
+}
+
+// Read exactly len bytes from an image stream.
+STATIC void image_read(mp_obj_t stream, void *buf, size_t len) {
+    int errcode;
+    mp_uint_t t0 = stats_start();
+    mp_uint_t n = mp_stream_rw(stream, buf, len, &errcode, MP_STREAM_RW_READ);
+    stats_add(&loader_stats.io_us, t0);
+    loader_stats.bytes += n;
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    if (n != len) {
+        mp_raise_ValueError("truncated image");
+    }
+}
+
+// Discard len bytes from an image stream, using buf as scratch space.
+STATIC void image_skip(mp_obj_t stream, uint8_t *buf, size_t buf_len, size_t len) {
+    while (len > 0) {
+        size_t n = MIN(len, buf_len);
+        image_read(stream, buf, n);
+        len -= n;
+    }
+}
+
+// the pixel layouts the BMP decoder handles
+enum {
+    BMP_BGR,    // 24 or 32 bit
+    BMP_RGB565, // 16 bit with 5-6-5 bitfields
+    BMP_RGB555, // 16 bit, the default layout without bitfields
+    BMP_PAL8,   // 8 bit palette indices
+};
+
+typedef struct _bmp_decoder_t {
+    uint kind;
+    uint bytespp;
+    uint16_t ncolors;
+    uint32_t *colors; // palette as 0xRRGGBB, for BMP_PAL8
+    uint16_t *lut;    // palette as stored in an RGB565 framebuffer
+} bmp_decoder_t;
+
+// Convert n pixels of one row and write them at (x, y), which the caller
+// has clipped.  Pixels that already match the target format are copied.
+STATIC void bmp_write_row(const mp_obj_framebuf_t *fb, const bmp_decoder_t *dec, int x, int y, const uint8_t *src, int n) {
+    if (fb->format == FRAMEBUF_RGB565) {
+        // the framebuffer holds big-endian RGB565
+        uint16_t *d = &((uint16_t*)fb->buf)[x + y * fb->stride];
+        switch (dec->kind) {
+            case BMP_BGR:
+                for (; n; --n, src += dec->bytespp) {
+                    uint16_t c = ((src[2] & 0xf8) << 8) | ((src[1] & 0xfc) << 3) | (src[0] >> 3);
+                    *d++ = (c >> 8) | (c << 8);
+                }
+                return;
+            case BMP_RGB565:
+                for (; n; --n, src += 2) {
+                    *d++ = src[0] << 8 | src[1];
+                }
+                return;
+            case BMP_RGB555:
+                for (; n; --n, src += 2) {
+                    uint v = src[0] | src[1] << 8;
+                    uint16_t c = (v & 0x7fe0) << 1 | (v & 0x0200) >> 4 | (v & 0x1f);
+                    *d++ = (c >> 8) | (c << 8);
+                }
+                return;
+            default:
+                for (; n; --n) {
+                    *d++ = dec->lut[*src++];
+                }
+                return;
+        }
+    }
+    if (fb->format == FRAMEBUF_PL8 && dec->kind == BMP_PAL8) {
+        memcpy(&((uint8_t*)fb->buf)[x + y * fb->stride], src, n);
+        return;
+    }
+    for (; n; --n, ++x, src += dec->bytespp) {
+        uint32_t col;
+        if (dec->kind == BMP_BGR) {
+            col = src[2] << 16 | src[1] << 8 | src[0];
+        } else if (dec->kind == BMP_PAL8) {
+            col = dec->colors[src[0]];
+        } else {
+            uint v = src[0] | src[1] << 8;
+            uint r, g, b = v & 0x1f;
+            if (dec->kind == BMP_RGB565) {
+                r = v >> 11;
+                g = (v >> 5) & 0x3f;
+                g = g << 2 | g >> 4;
+            } else {
+                r = (v >> 10) & 0x1f;
+                g = (v >> 5) & 0x1f;
+                g = g << 3 | g >> 2;
+            }
+            col = (r << 3 | r >> 2) << 16 | g << 8 | (b << 3 | b >> 2);
+        }
+        setpixel(fb, x, y, col);
+    }
+}
+
+// Decode a BMP image at (x, y).  If the image has a palette and palette is
+// not NULL the colours are also written to it as native RGB565 values, up to
+// palette_len entries.  Returns the number of palette entries in the image.
+STATIC uint bmp_decode(mp_obj_framebuf_t *self, mp_obj_t stream, mp_int_t x, mp_int_t y, uint16_t *palette, size_t palette_len) {
+    BITMAPINFO info;
+    size_t pos = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);
+    image_read(stream, &info, pos);
+    if (info.bmfHeader.bfType != 0x4d42 || info.bmiHeader.biSize < sizeof(BITMAPINFOHEADER)) {
+        mp_raise_ValueError("not a bmp");
+    }
+    uint bpp = info.bmiHeader.biBitCount;
+    uint32_t comp = info.bmiHeader.biCompression;
+    if (comp == BI_BITFIELDS) {
+        // the masks follow a plain info header, or are part of a larger one
+        image_read(stream, info.RGB_MASK, sizeof(info.RGB_MASK));
+        pos += sizeof(info.RGB_MASK);
+    } else if (comp != BI_RGB) {
+        mp_raise_ValueError("unsupported bmp");
+    }
+
+    bmp_decoder_t dec = { .bytespp = bpp / 8 };
+    if (bpp == 24 || (bpp == 32 && (comp == BI_RGB || info.RGB_MASK[0] == 0xff0000))) {
+        dec.kind = BMP_BGR;
+    } else if (bpp == 16 && comp == BI_RGB) {
+        dec.kind = BMP_RGB555;
+    } else if (bpp == 16 && info.RGB_MASK[0] == 0xf800 && info.RGB_MASK[1] == 0x07e0 && info.RGB_MASK[2] == 0x001f) {
+        dec.kind = BMP_RGB565;
+    } else if (bpp == 16 && info.RGB_MASK[0] == 0x7c00 && info.RGB_MASK[1] == 0x03e0 && info.RGB_MASK[2] == 0x001f) {
+        dec.kind = BMP_RGB555;
+    } else if (bpp == 8 && comp == BI_RGB) {
+        dec.kind = BMP_PAL8;
+        dec.ncolors = info.bmiHeader.biClrUsed == 0 ? 256 : MIN(info.bmiHeader.biClrUsed, 256);
+    } else {
+        mp_raise_ValueError("unsupported bmp");
+    }
+    int w = (int32_t)info.bmiHeader.biWidth;
+    int h = (int32_t)info.bmiHeader.biHeight;
+    // a negative height means the rows are stored from the top down
+    bool top_down = h < 0;
+    if (top_down) {
+        h = -h;
+    }
+    if (w <= 0 || w > 0xffff || h > 0xffff) {
+        mp_raise_ValueError("unsupported bmp");
+    }
+
+    // rows are padded to a multiple of 4 bytes; the row buffer is also used
+    // for skipping and holds at least a whole palette
+    size_t row_len = ((size_t)w * bpp + 31) / 32 * 4;
+    size_t buf_len = MAX(row_len, 256 * sizeof(RGBQUAD));
+    uint8_t *row = m_new(uint8_t, buf_len);
+    size_t head_end = sizeof(BITMAPFILEHEADER) + info.bmiHeader.biSize;
+    if (pos < head_end) {
+        image_skip(stream, row, buf_len, head_end - pos);
+        pos = head_end;
+    }
+    if (dec.kind == BMP_PAL8) {
+        const RGBQUAD *quad = (const RGBQUAD*)row;
+        image_read(stream, row, dec.ncolors * sizeof(RGBQUAD));
+        pos += dec.ncolors * sizeof(RGBQUAD);
+        dec.colors = m_new(uint32_t, 256);
+        dec.lut = m_new(uint16_t, 256);
+        memset(dec.colors, 0, 256 * sizeof(uint32_t));
+        memset(dec.lut, 0, 256 * sizeof(uint16_t));
+        for (uint i = 0; i < dec.ncolors; ++i) {
+            dec.colors[i] = quad[i].rgbRed << 16 | quad[i].rgbGreen << 8 | quad[i].rgbBlue;
+            uint16_t c = COL(dec.colors[i]);
+            dec.lut[i] = (c >> 8) | (c << 8);
+            if (palette != NULL && i < palette_len) {
+                palette[i] = c;
+            }
+        }
+    }
+    if (info.bmfHeader.bfOffBits < pos) {
+        mp_raise_ValueError("not a bmp");
+    }
+    image_skip(stream, row, buf_len, info.bmfHeader.bfOffBits - pos);
+
+    int x0 = MAX(x, self->clip_x0);
+    int x1 = MIN(x + w, self->clip_x1);
+    for (int r = 0; r < h; ++r) {
+        int dy = y + (top_down ? r : h - 1 - r);
+        image_read(stream, row, row_len);
+        if (x0 < x1 && dy >= self->clip_y0 && dy < self->clip_y1) {
+            mp_uint_t t0 = stats_start();
+            bmp_write_row(self, &dec, x0, dy, row + (x0 - x) * dec.bytespp, x1 - x0);
+            stats_add(&loader_stats.blit_us, t0);
+            stats_pixels(x1 - x0);
+            dirty_add(self, x0, dy, x1, dy + 1);
+        }
+    }
+    m_del(uint8_t, row, buf_len);
+    if (dec.kind == BMP_PAL8) {
+        m_del(uint32_t, dec.colors, 256);
+        m_del(uint16_t, dec.lut, 256);
+    }
+    return dec.ncolors;
+}
+
+// loadbmp(file[, x, y[, palette]]): draw a BMP image with its top left
+// corner at (x, y).  file is a file name or an open binary stream.  24 and
+// 32 bit, 16 bit (5-6-5 or 5-5-5) and 8 bit paletted images are supported.
+// Palette indices are stored as they are in a PL8 framebuffer and their
+// colours written to palette, eg an array('H') for SCREEN.palette();
+// returns the number of colours in the palette, or 0 if there is none.
+STATIC mp_obj_t framebuf_loadbmp(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t x = 0;
+    mp_int_t y = 0;
+    if (n_args > 2) {
+        x = mp_obj_get_int(args[2]);
+        y = mp_obj_get_int(args[3]);
+    }
+    mp_buffer_info_t palinfo = { .buf = NULL, .len = 0 };
+    if (n_args > 4 && args[4] != mp_const_none) {
+        mp_get_buffer_raise(args[4], &palinfo, MP_BUFFER_WRITE);
+    }
+    bool opened;
+    mp_obj_t stream = image_open(args[1], &opened);
+    uint ncolors = 0;
+    mp_uint_t t0 = stats_start();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        ncolors = bmp_decode(self, stream, x, y, palinfo.buf, palinfo.len / sizeof(uint16_t));
+        nlr_pop();
+        stats_add(&loader_stats.total_us, t0);
+    } else {
+        if (opened) {
+            mp_stream_close(stream);
+        }
+        nlr_jump(nlr.ret_val);
+    }
+    if (opened) {
+        mp_stream_close(stream);
+    }
+    return MP_OBJ_NEW_SMALL_INT(ncolors);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_loadbmp_obj, 2, 5, framebuf_loadbmp);
+#endif // MICROPY_PY_IO
 
+#if MICROPY_PY_IO
 // gif decoder
 
-const uint16_t _aMaskTbl[16] =
-{
-    0x0000, 0x0001, 0x0003, 0x0007,
-    0x000f, 0x001f, 0x003f, 0x007f,
-    0x00ff, 0x01ff, 0x03ff, 0x07ff,
-    0x0fff, 0x1fff, 0x3fff, 0x7fff,
-};	  
 const uint8_t _aInterlaceOffset[]={8,8,4,2};
 const uint8_t _aInterlaceYPos[]={0,4,2,1};
- 
-uint8_t gifdecoding=0;//标记GIF正在解码.
 
-uint8_t gif_check_head(FIL *file)
+// The input stream is read through a buffer, as most reads are a byte or
+// a few bytes at a time.
+typedef struct _gif_reader_t {
+    mp_obj_t stream;
+    uint16_t pos, len;
+    uint8_t buf[GIF_READ_SIZE];
+} gif_reader_t;
+
+STATIC NORETURN void gif_refill_fail(void) {
+    mp_raise_ValueError("truncated image");
+}
+
+STATIC void gif_refill(gif_reader_t *rd) {
+    int errcode;
+    mp_uint_t t0 = stats_start();
+    mp_uint_t n = mp_stream_rw(rd->stream, rd->buf, sizeof(rd->buf), &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+    stats_add(&loader_stats.io_us, t0);
+    loader_stats.bytes += n;
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    if (n == 0) {
+        gif_refill_fail();
+    }
+    rd->pos = 0;
+    rd->len = n;
+}
+
+static inline uint8_t gif_readbyte(gif_reader_t *rd) {
+    if (rd->pos == rd->len) {
+        gif_refill(rd);
+    }
+    return rd->buf[rd->pos++];
+}
+
+STATIC void gif_read(gif_reader_t *rd, void *dest, size_t len) {
+    uint8_t *d = dest;
+    while (len > 0) {
+        if (rd->pos == rd->len) {
+            gif_refill(rd);
+        }
+        size_t n = MIN(len, (size_t)(rd->len - rd->pos));
+        if (d != NULL) {
+            memcpy(d, &rd->buf[rd->pos], n);
+            d += n;
+        }
+        rd->pos += n;
+        len -= n;
+    }
+}
+
+STATIC uint8_t gif_check_head(gif_reader_t *rd)
 {
     uint8_t gifversion[6];
-    uint32_t readed;
-    uint8_t res;
-    res=f_read(file,gifversion,6,(UINT*)&readed);
-    if(res)return 1;	   
+    gif_read(rd, gifversion, 6);
     if((gifversion[0]!='G')||(gifversion[1]!='I')||(gifversion[2]!='F')||
     (gifversion[3]!='8')||((gifversion[4]!='7')&&(gifversion[4]!='9'))||
     (gifversion[5]!='a'))return 2;
     else return 0;	
 }
 
-uint16_t gif_getrgb565(uint8_t *ctb) 
+// Colour tables are kept as RGB565 in the byte order of an RGB565
+// framebuffer, half the size of 24-bit entries and copied straight into one.
+STATIC uint16_t gif_getrgb565(uint8_t *ctb) 
 {
     uint16_t r,g,b;
     r=(ctb[0]>>3)&0X1F;
     g=(ctb[1]>>2)&0X3F;
     b=(ctb[2]>>3)&0X1F;
-    return b+(g<<5)+(r<<11);
+    uint16_t c=b+(g<<5)+(r<<11);
+    return (c>>8)|(c<<8);
+}
+
+// Expand a colour table entry back to 0xRRGGBB for other framebuffer formats.
+static inline uint32_t gif_getrgb888(uint16_t c)
+{
+    c=(c>>8)|(c<<8);
+    uint32_t r=c>>11,g=(c>>5)&0x3f,b=c&0x1f;
+    return (r<<3|r>>2)<<16|(g<<2|g>>4)<<8|(b<<3|b>>2);
 }
 
-uint8_t gif_readcolortbl(FIL *file,gif89a * gif,uint16_t num)
+STATIC void gif_readcolortbl(gif_reader_t *rd,uint16_t *tbl,uint16_t num)
 {
     uint8_t rgb[3];
     uint16_t t;
-    uint8_t res;
-    uint32_t readed;
     for(t=0;t<num;t++)
     {
-        res=f_read(file,rgb,3,(UINT*)&readed);
-        if(res)return 1;//读错误
-        // riven, no need to 565 for framebuffer
-        // gif->colortbl[t]=gif_getrgb565(rgb);
-        gif->colortbl[t] = ((uint32_t)rgb[0]<<16) + ((uint32_t)rgb[1]<<8) + (rgb[2]);
-        // printf("color %lx\r\n", gif->colortbl[t]);
+        gif_read(rd, rgb, 3);
+        tbl[t]=gif_getrgb565(rgb);
     }
-    return 0;
 }
 
-uint8_t gif_getinfo(FIL *file,gif89a * gif)
+STATIC void gif_getinfo(gif_reader_t *rd,gif89a * gif)
 {
-    uint32_t readed;	 
-    uint8_t res;   
-    res=f_read(file,(uint8_t*)&gif->gifLSD,7,(UINT*)&readed);
-    if(res)return 1;
+    gif_read(rd, &gif->gifLSD, 7);
     if(gif->gifLSD.flag&0x80)//存在全局颜色表
     {
         gif->numcolors=2<<(gif->gifLSD.flag&0x07);//得到颜色表大小
-        if(gif_readcolortbl(file,gif,gif->numcolors))return 1;//读错误	
+        gif_readcolortbl(rd,gif->colortbl,gif->numcolors);
     }	   
-    return 0;
-}
-
-void gif_savegctbl(gif89a* gif)
-{
-    uint16_t i=0;
-    for(i=0;i<256;i++)gif->bkpcolortbl[i]=gif->colortbl[i];//保存全局颜色.
 }
 
-void gif_recovergctbl(gif89a* gif)
+STATIC void gif_initlzw(gif89a* gif,uint8_t codesize) 
 {
-    uint16_t i=0;
-    for(i=0;i<256;i++)gif->colortbl[i]=gif->bkpcolortbl[i];//恢复全局颜色.
+    LZW_INFO *lzw=gif->lzw;
+    lzw->SetCodeSize  = codesize;
+    lzw->CodeSize     = codesize + 1;
+    lzw->ClearCode    = (1 << codesize);
+    lzw->EndCode      = (1 << codesize) + 1;
+    lzw->MaxCode      = (1 << codesize) + 2;
+    lzw->MaxCodeSize  = (1 << codesize) << 1;
+    lzw->OldCode      = -1;
+    lzw->BitBuf       = 0;
+    lzw->BitCnt       = 0;
+    lzw->BlockLeft    = 0;
+    lzw->GetDone      = 0;
+    lzw->sp           = lzw->aStack;
 }
 
-void gif_initlzw(gif89a* gif,uint8_t codesize) 
+// Read a data sub-block into buf if it fits in maxnum bytes, otherwise skip
+// it.  Returns its length, 0 for the block terminator.
+STATIC uint16_t gif_getdatablock(gif_reader_t *rd,uint8_t *buf,uint16_t maxnum) 
 {
-    memset((uint8_t *)gif->lzw, 0, sizeof(LZW_INFO));
-    gif->lzw->SetCodeSize  = codesize;
-    gif->lzw->CodeSize     = codesize + 1;
-    gif->lzw->ClearCode    = (1 << codesize);
-    gif->lzw->EndCode      = (1 << codesize) + 1;
-    gif->lzw->MaxCode      = (1 << codesize) + 2;
-    gif->lzw->MaxCodeSize  = (1 << codesize) << 1;
-    gif->lzw->ReturnClear  = 1;
-    gif->lzw->LastByte     = 2;
-    gif->lzw->sp           = gif->lzw->aDecompBuffer;
-}
-
-uint16_t gif_getdatablock(FIL *gfile,uint8_t *buf,uint16_t maxnum) 
-{
-    uint8_t cnt;
-    uint32_t readed;
-    uint32_t fpos;
-    f_read(gfile,&cnt,1,(UINT*)&readed);//得到LZW长度			 
-    if(cnt) 
-    {
-        if (buf)//需要读取 
-        {
-            if(cnt>maxnum)
-            {
-                fpos=f_tell(gfile);
-                f_lseek(gfile,fpos+cnt);//跳过
-                return cnt;//直接不读
-            }
-            f_read(gfile,buf,cnt,(UINT*)&readed);//得到LZW长度	
-        }else 	//直接跳过
-        {
-            fpos=f_tell(gfile);
-            f_lseek(gfile,fpos+cnt);//跳过
-        }
-    }
+    uint8_t cnt=gif_readbyte(rd);//得到LZW长度			 
+    gif_read(rd, cnt<=maxnum?buf:NULL, cnt);
     return cnt;
 }
 
-uint8_t gif_readextension(FIL *gfile,gif89a* gif, int *pTransIndex,uint8_t *pDisposal)
+STATIC uint8_t gif_readextension(gif_reader_t *rd,gif89a* gif, int *pTransIndex,uint8_t *pDisposal)
 {
     uint8_t temp;
-    uint32_t readed;	 
     uint8_t buf[4];  
-    f_read(gfile,&temp,1,(UINT*)&readed);//得到长度		 
+    temp=gif_readbyte(rd);//得到长度		 
     switch(temp)
     {
         case GIF_PLAINTEXT:
         case GIF_APPLICATION:
         case GIF_COMMENT:
-            while(gif_getdatablock(gfile,0,256)>0);			//获取数据块
+            while(gif_getdatablock(rd,NULL,0)>0);			//获取数据块
             return 0;
         case GIF_GRAPHICCTL://图形控制扩展块
-            if(gif_getdatablock(gfile,buf,4)!=4)return 1;	//图形控制扩展块的长度必须为4 
+            if(gif_getdatablock(rd,buf,4)!=4)return 1;	//图形控制扩展块的长度必须为4 
             gif->delay=(buf[2]<<8)|buf[1];					//得到延时 
             *pDisposal=(buf[0]>>2)&0x7; 	    			//得到处理方法
             if((buf[0]&0x1)!=0)*pTransIndex=buf[3];			//透明色表 
-            f_read(gfile,&temp,1,(UINT*)&readed);	 		//得到LZW长度	
+            temp=gif_readbyte(rd);	 		//得到LZW长度	
             if(temp!=0)return 1;							//读取数据块结束符错误.
             return 0;
     }
     return 1;//错误的数据
 }
 
-int gif_getnextcode(FIL *gfile,gif89a* gif) 
+// Top up the bit buffer from the data blocks to at least 25 bits, or as
+// many as remain.  A whole code is then taken with one shift and mask.
+STATIC void gif_fillbits(gif_reader_t *rd,LZW_INFO *lzw)
 {
-    int i,j,End;
-    long Result;
-    if(gif->lzw->ReturnClear)
+    while(lzw->BitCnt<=24&&!lzw->GetDone)
     {
-        //The first code should be a clearcode.
-        gif->lzw->ReturnClear=0;
-        return gif->lzw->ClearCode;
+        if(lzw->BlockLeft==0)
+        {
+            lzw->BlockLeft=gif_readbyte(rd);
+            if(lzw->BlockLeft==0)
+            {
+                lzw->GetDone=1;
+                break;
+            }
+        }
+        // take as many bytes as fit from the block and the read buffer
+        if(rd->pos==rd->len)gif_refill(rd);
+        int n=MIN(MIN(lzw->BlockLeft,rd->len-rd->pos),(32-lzw->BitCnt)/8);
+        const uint8_t *p=&rd->buf[rd->pos];
+        rd->pos+=n;
+        lzw->BlockLeft-=n;
+        for(;n;--n)
+        {
+            lzw->BitBuf|=(uint32_t)*p++<<lzw->BitCnt;
+            lzw->BitCnt+=8;
+        }
     }
-    End=gif->lzw->CurBit+gif->lzw->CodeSize;
-    if(End>=gif->lzw->LastBit)
-    {
-        int Count;
-        if(gif->lzw->GetDone)return-1;//Error 
-        gif->lzw->aBuffer[0]=gif->lzw->aBuffer[gif->lzw->LastByte-2];
-        gif->lzw->aBuffer[1]=gif->lzw->aBuffer[gif->lzw->LastByte-1];
-        if((Count=gif_getdatablock(gfile,&gif->lzw->aBuffer[2],300))==0)gif->lzw->GetDone=1;
-        if(Count<0)return -1;//Error 
-        gif->lzw->LastByte=2+Count;
-        gif->lzw->CurBit=(gif->lzw->CurBit-gif->lzw->LastBit)+16;
-        gif->lzw->LastBit=(2+Count)*8;
-        End=gif->lzw->CurBit+gif->lzw->CodeSize;
-    }
-    j=End>>3;
-    i=gif->lzw->CurBit>>3;
-    if(i==j)Result=(long)gif->lzw->aBuffer[i];
-    else if(i+1==j)Result=(long)gif->lzw->aBuffer[i]|((long)gif->lzw->aBuffer[i+1]<<8);
-    else Result=(long)gif->lzw->aBuffer[i]|((long)gif->lzw->aBuffer[i+1]<<8)|((long)gif->lzw->aBuffer[i+2]<<16);
-    Result=(Result>>(gif->lzw->CurBit&0x7))&_aMaskTbl[gif->lzw->CodeSize];
-    gif->lzw->CurBit+=gif->lzw->CodeSize;
-    return(int)Result;
-}
-
-int gif_getnextbyte(FIL *gfile,gif89a* gif) 
+}
+
+// Decode up to n colour indices into out.  Returns the number decoded, which
+// is less than n only at the end code, or -1 on corrupt data.
+STATIC int gif_decode(gif_reader_t *rd,LZW_INFO *lzw,uint8_t *out,int n)
 {
-    int i,Code,Incode;
-    while((Code=gif_getnextcode(gfile,gif))>=0)
+    int i=0;
+    while(i<n)
     {
-        if(Code==gif->lzw->ClearCode)
+        // characters of the last string not yet output
+        while(lzw->sp>lzw->aStack&&i<n)out[i++]=*--lzw->sp;
+        if(i==n)break;
+
+        if(lzw->BitCnt<lzw->CodeSize)
         {
-            //Corrupt GIFs can make this happen  
-            if(gif->lzw->ClearCode>=(1<<MAX_NUM_LWZ_BITS))return -1;//Error 
-            //Clear the tables 
-            memset((uint8_t*)gif->lzw->aCode,0,sizeof(gif->lzw->aCode));
-            for(i=0;i<gif->lzw->ClearCode;++i)gif->lzw->aPrefix[i]=i;
-            //Calculate the'special codes' independence of the initial code size
-            //and initialize the stack pointer 
-            gif->lzw->CodeSize=gif->lzw->SetCodeSize+1;
-            gif->lzw->MaxCodeSize=gif->lzw->ClearCode<<1;
-            gif->lzw->MaxCode=gif->lzw->ClearCode+2;
-            gif->lzw->sp=gif->lzw->aDecompBuffer;
-            //Read the first code from the stack after clear ingand initializing*/
-            do
-            {
-                gif->lzw->FirstCode=gif_getnextcode(gfile,gif);
-            }while(gif->lzw->FirstCode==gif->lzw->ClearCode);
-            gif->lzw->OldCode=gif->lzw->FirstCode;
-            return gif->lzw->FirstCode;
-        }
-        if(Code==gif->lzw->EndCode)return -2;//End code
-        Incode=Code;
-        if(Code>=gif->lzw->MaxCode)
+            gif_fillbits(rd,lzw);
+            if(lzw->BitCnt<lzw->CodeSize)return -1;//Error
+        }
+        int Code=lzw->BitBuf&((1<<lzw->CodeSize)-1);
+        lzw->BitBuf>>=lzw->CodeSize;
+        lzw->BitCnt-=lzw->CodeSize;
+
+        if(Code==lzw->ClearCode)
+        {
+            lzw->CodeSize=lzw->SetCodeSize+1;
+            lzw->MaxCodeSize=lzw->ClearCode<<1;
+            lzw->MaxCode=lzw->ClearCode+2;
+            lzw->OldCode=-1;
+            continue;
+        }
+        if(Code==lzw->EndCode)break;//End code
+        if(lzw->OldCode<0)
         {
-            *(gif->lzw->sp)++=gif->lzw->FirstCode;
-            Code=gif->lzw->OldCode;
+            // the first code after a clear is always a single character
+            if(Code>lzw->ClearCode)return -1;
+            out[i++]=lzw->FirstCode=lzw->OldCode=Code;
+            continue;
         }
-        while(Code>=gif->lzw->ClearCode)
+        int Incode=Code;
+        uint8_t *sp=lzw->sp;
+        if(Code>=lzw->MaxCode)
         {
-            *(gif->lzw->sp)++=gif->lzw->aPrefix[Code];
-            if(Code==gif->lzw->aCode[Code])return Code;
-            if((gif->lzw->sp-gif->lzw->aDecompBuffer)>=sizeof(gif->lzw->aDecompBuffer))return Code;
-            Code=gif->lzw->aCode[Code];
+            // the string being defined: the previous one plus its first character
+            if(Code>lzw->MaxCode)return -1;
+            *sp++=lzw->FirstCode;
+            Code=lzw->OldCode;
         }
-        *(gif->lzw->sp)++=gif->lzw->FirstCode=gif->lzw->aPrefix[Code];
-        if((Code=gif->lzw->MaxCode)<(1<<MAX_NUM_LWZ_BITS))
+        while(Code>=lzw->ClearCode)
         {
-            gif->lzw->aCode[Code]=gif->lzw->OldCode;
-            gif->lzw->aPrefix[Code]=gif->lzw->FirstCode;
-            ++gif->lzw->MaxCode;
-            if((gif->lzw->MaxCode>=gif->lzw->MaxCodeSize)&&(gif->lzw->MaxCodeSize<(1<<MAX_NUM_LWZ_BITS)))
+            *sp++=lzw->aSuffix[Code];
+            Code=lzw->aCode[Code];
+        }
+        *sp++=lzw->FirstCode=Code;
+        lzw->sp=sp;
+        if(lzw->MaxCode<(1<<MAX_NUM_LWZ_BITS))
+        {
+            lzw->aCode[lzw->MaxCode]=lzw->OldCode;
+            lzw->aSuffix[lzw->MaxCode]=lzw->FirstCode;
+            ++lzw->MaxCode;
+            if((lzw->MaxCode>=lzw->MaxCodeSize)&&(lzw->MaxCodeSize<(1<<MAX_NUM_LWZ_BITS)))
             {
-                gif->lzw->MaxCodeSize<<=1;
-                ++gif->lzw->CodeSize;
+                lzw->MaxCodeSize<<=1;
+                ++lzw->CodeSize;
             }
         }
-        gif->lzw->OldCode=Incode;
-        if(gif->lzw->sp>gif->lzw->aDecompBuffer)return *--(gif->lzw->sp);
+        lzw->OldCode=Incode;
     }
-    return Code;
+    return i;
 }
 
-mp_obj_framebuf_t * _fb;
+// Write n colour indices of a row at (x, y), leaving transparent pixels
+// alone.  RGB565 framebuffers are written directly from the colour table and
+// PL8 ones get the indices themselves; other formats get each run of equal
+// indices as one span.
+STATIC void gif_write_row(const mp_obj_framebuf_t *fb,int x,int y,const uint8_t *row,int n,const uint16_t *tbl,int Transparency)
+{
+    if(y<fb->clip_y0||y>=fb->clip_y1)return;
+    int i0=MAX(0,fb->clip_x0-x);
+    int i1=MIN(n,fb->clip_x1-x);
+    if(i0>=i1)return;
+    if(fb->format==FRAMEBUF_RGB565)
+    {
+        uint16_t *d=&((uint16_t*)fb->buf)[x+y*fb->stride];
+        for(int i=i0;i<i1;++i)
+        {
+            if(row[i]!=Transparency)d[i]=tbl[row[i]];
+        }
+        dirty_add(fb,x+i0,y,x+i1,y+1);
+        return;
+    }
+    if(fb->format==FRAMEBUF_PL8)
+    {
+        uint8_t *d=&((uint8_t*)fb->buf)[x+y*fb->stride];
+        for(int i=i0;i<i1;++i)
+        {
+            if(row[i]!=Transparency)d[i]=row[i];
+        }
+        dirty_add(fb,x+i0,y,x+i1,y+1);
+        return;
+    }
+    while(i0<i1)
+    {
+        int Index=row[i0];
+        int RunStart=i0;
+        while(++i0<i1&&row[i0]==Index);
+        if(Index!=Transparency)hspan(fb,x+RunStart,x+i0-1,y,gif_getrgb888(tbl[Index]));
+    }
+}
 
-uint8_t gif_dispimage(FIL *gfile,gif89a* gif,uint16_t x0,uint16_t y0,int Transparency, uint8_t Disposal) 
+// Decode the image data of the current frame into fb at (x0, y0) a row at
+// a time, using row to hold the indices of one row.  Returns 0 when done, 1
+// on corrupt data.
+STATIC uint8_t gif_dispimage(const mp_obj_framebuf_t *fb,gif_reader_t *rd,gif89a* gif,int x0,int y0,const uint16_t *tbl,int numcolors,int Transparency,uint8_t *row) 
 {
-    uint32_t readed;	   
-    uint8_t lzwlen;
-    int Index,OldIndex,XPos,YPos,YCnt,Pass,Interlace,XEnd;
-    int Width,Height,Cnt,ColorIndex;
-    uint32_t bkcolor;
-    uint32_t *pTrans;
+    int YPos,YCnt,Pass,Interlace;
+    int Width,Height;
 
     Width=gif->gifISD.width;
     Height=gif->gifISD.height;
-    XEnd=Width+x0-1;
-    bkcolor=gif->colortbl[gif->gifLSD.bkcindex];
-    pTrans=(uint32_t*)gif->colortbl;
-    f_read(gfile,&lzwlen,1,(UINT*)&readed);//得到LZW长度	 
-    gif_initlzw(gif,lzwlen);//Initialize the LZW stack with the LZW code size 
+    uint8_t codesize=gif_readbyte(rd);
+    if(codesize<1||codesize>=MAX_NUM_LWZ_BITS)return 1;
+    gif_initlzw(gif,codesize);//Initialize the LZW stack with the LZW code size 
     Interlace=gif->gifISD.flag&0x40;//是否交织编码
+    uint8_t res=0;
     for(YCnt=0,YPos=y0,Pass=0;YCnt<Height;YCnt++)
     {
-        Cnt=0;
-        OldIndex=-1;
-        for(XPos=x0;XPos<=XEnd;XPos++)
+        int n=gif_decode(rd,gif->lzw,row,Width);
+        if(n<0)
         {
-            if(gif->lzw->sp>gif->lzw->aDecompBuffer)Index=*--(gif->lzw->sp);
-            else Index=gif_getnextbyte(gfile,gif);	   
-            if(Index==-2)return 0;//Endcode     
-            if((Index<0)||(Index>=gif->numcolors))
-            {
-                //IfIndex out of legal range stop decompressing
-                return 1;//Error
-            }
-            //If current index equals old index increment counter
-            if((Index==OldIndex)&&(XPos<=XEnd))Cnt++;
-            else
-            {
-                if(Cnt)
-                {
-                    if(OldIndex!=Transparency)
-                    {									    
-                        // pic_phy.draw_hline(XPos-Cnt-1,YPos,Cnt+1,*(pTrans+OldIndex));
-                        fill_rect(_fb, XPos-Cnt-1,YPos,Cnt+1,1,*(pTrans+OldIndex));
-
-                    }else if(Disposal==2)
-                    {
-                        // pic_phy.draw_hline(XPos-Cnt-1,YPos,Cnt+1,bkcolor);
-                        fill_rect(_fb, XPos-Cnt-1,YPos,Cnt+1,1,*(pTrans+OldIndex));
-                    }
-                    Cnt=0;
-                }else
-                {
-                    if(OldIndex>=0)
-                    {
-                        // if(OldIndex!=Transparency)pic_phy.draw_point(XPos-1,YPos,*(pTrans+OldIndex));
-                        // else if(Disposal==2)pic_phy.draw_point(XPos-1,YPos,bkcolor); 
-                        if (OldIndex!=Transparency){
-                            setpixel(_fb, XPos-1,YPos,*(pTrans+OldIndex));
-                        }else if(Disposal==2){
-                            setpixel(_fb, XPos-1,YPos,bkcolor);
-                        }
-                    }
-                }
-            }
-            OldIndex=Index;
+            res=1;
+            break;
         }
-        if((OldIndex!=Transparency)||(Disposal==2))
+        for(int i=0;i<n;++i)
         {
-            if(OldIndex!=Transparency)ColorIndex=*(pTrans+OldIndex);
-            else ColorIndex=bkcolor;
-            if(Cnt)
+            //IfIndex out of legal range stop decompressing
+            if(row[i]>=numcolors)
             {
-                // pic_phy.draw_hline(XPos-Cnt-1,YPos,Cnt+1,ColorIndex);
-                fill_rect(_fb, XPos-Cnt-1,YPos,Cnt+1,1,ColorIndex);
-            }else{
-                // pic_phy.draw_point(XEnd,YPos,ColorIndex);
-                setpixel(_fb, XEnd,YPos,ColorIndex);
+                n=i;
+                res=1;
+                break;
             }
         }
+        mp_uint_t t0=stats_start();
+        gif_write_row(fb,x0,YPos,row,n,tbl,Transparency);
+        stats_add(&loader_stats.blit_us,t0);
+        stats_pixels(n);
+        if(n<Width)break;//Endcode
         //Adjust YPos if image is interlaced 
         if(Interlace)//交织编码
         {
             YPos+=_aInterlaceOffset[Pass];
-            if((YPos-y0)>=Height)
+            if((YPos-y0)>=Height&&Pass<3)
             {
                 ++Pass;
                 YPos=_aInterlaceYPos[Pass]+y0;
             }
         }else YPos++;	    
     }
-    return 0;
+    return res;
 }
 
-void gif_clear2bkcolor(uint16_t x,uint16_t y,gif89a* gif,ImageScreenDescriptor pimge)
-{
-    uint16_t x0,y0,x1,y1;
-    uint32_t color=gif->colortbl[gif->gifLSD.bkcindex];
-    if(pimge.width==0||pimge.height==0)return;//直接不用清除了,原来没有图像!!
-    if(gif->gifISD.yoff>pimge.yoff)
-    {
-        x0=x+pimge.xoff;
-        y0=y+pimge.yoff;
-        x1=x+pimge.xoff+pimge.width-1;;
-        y1=y+gif->gifISD.yoff-1;
-        //if(x0<x1&&y0<y1&&x1<320&&y1<320)pic_phy.fill(x0,y0,x1,y1,color); //设定xy,的范围不能太大.
-        if(x0<x1&&y0<y1&&x1<320&&y1<320)fill_rect(_fb,x0,y0,x1,y1,color); //设定xy,的范围不能太大.
-    }
-    if(gif->gifISD.xoff>pimge.xoff)
-    {
-        x0=x+pimge.xoff;
-        y0=y+pimge.yoff;
-        x1=x+gif->gifISD.xoff-1;;
-        y1=y+pimge.yoff+pimge.height-1;
-        //if(x0<x1&&y0<y1&&x1<320&&y1<320)pic_phy.fill(x0,y0,x1,y1,color);
-        if(x0<x1&&y0<y1&&x1<320&&y1<320)fill_rect(_fb,x0,y0,x1,y1,color);
-    }
-    if((gif->gifISD.yoff+gif->gifISD.height)<(pimge.yoff+pimge.height))
-    {
-        x0=x+pimge.xoff;
-        y0=y+gif->gifISD.yoff+gif->gifISD.height-1;
-        x1=x+pimge.xoff+pimge.width-1;;
-        y1=y+pimge.yoff+pimge.height-1;
-        //if(x0<x1&&y0<y1&&x1<320&&y1<320)pic_phy.fill(x0,y0,x1,y1,color);
-        if(x0<x1&&y0<y1&&x1<320&&y1<320)fill_rect(_fb,x0,y0,x1,y1,color);
-    }
-    if((gif->gifISD.xoff+gif->gifISD.width)<(pimge.xoff+pimge.width))
-    {
-        x0=x+gif->gifISD.xoff+gif->gifISD.width-1;
-        y0=y+pimge.yoff;
-        x1=x+pimge.xoff+pimge.width-1;;
-        y1=y+pimge.yoff+pimge.height-1;
-        //if(x0<x1&&y0<y1&&x1<320&&y1<320)pic_phy.fill(x0,y0,x1,y1,color);
-        if(x0<x1&&y0<y1&&x1<320&&y1<320)fill_rect(_fb,x0,y0,x1,y1,color);
-    }   
-}
-
-uint8_t gif_drawimage(FIL *gfile,gif89a* gif,uint16_t x0,uint16_t y0)
+typedef struct _mp_obj_gif_t {
+    mp_obj_base_t base;
+    bool opened;
+    bool done;
+    // size of the logical screen
+    uint16_t width, height;
+    // disposal method and framebuffer area of the last frame drawn
+    uint8_t disposal;
+    int16_t prev_x, prev_y;
+    uint16_t prev_w, prev_h;
+    // indices of one row, grown if a frame is wider than the logical screen
+    uint16_t row_len;
+    uint8_t *row;
+    // keeps a caller's scratch buffer holding the LZW tables alive
+    mp_obj_t scratch;
+    gif89a *gif;
+    gif_reader_t rd;
+} mp_obj_gif_t;
+
+// Read blocks up to and including the next image and draw it into fb with
+// the logical screen at (x0, y0).  Returns 0 if a frame was drawn, 2 at the
+// end of the file and 1 on corrupt data.
+STATIC uint8_t gif_drawimage(mp_obj_gif_t *self,const mp_obj_framebuf_t *fb,int x0,int y0)
 {		  
-    uint32_t readed;
-    uint8_t res,temp;    
-    uint16_t numcolors;
-    ImageScreenDescriptor previmg;
-
-    uint8_t Disposal;
-    int TransIndex;
+    gif89a *gif=self->gif;
+    gif_reader_t *rd=&self->rd;
+    uint8_t temp;    
+    uint8_t Disposal=0;
+    int TransIndex=-1;
     uint8_t Introducer;
-    TransIndex=-1;				  
-    do
+    gif->delay=0;
+    for(;;)
     {
-        res=f_read(gfile,&Introducer,1,(UINT*)&readed);//读取一个字节
-        if(res)return 1;   
+        Introducer=gif_readbyte(rd);//读取一个字节
         switch(Introducer)
         {		 
             case GIF_INTRO_IMAGE://图像描述
-                previmg.xoff=gif->gifISD.xoff;
-                previmg.yoff=gif->gifISD.yoff;
-                previmg.width=gif->gifISD.width;
-                previmg.height=gif->gifISD.height;
-
-                res=f_read(gfile,(uint8_t*)&gif->gifISD,9,(UINT*)&readed);//读取一个字节
-                if(res)return 1;			 
+            {
+                gif_read(rd,&gif->gifISD,9);
+                const uint16_t *tbl=gif->colortbl;
+                int numcolors=gif->numcolors;
                 if(gif->gifISD.flag&0x80)//存在局部颜色表
                 {							  
-                    gif_savegctbl(gif);//保存全局颜色表
                     numcolors=2<<(gif->gifISD.flag&0X07);//得到局部颜色表大小
-                    if(gif_readcolortbl(gfile,gif,numcolors))return 1;//读错误	
+                    if(gif->localtbl==NULL)gif->localtbl=m_new(uint16_t,256);
+                    gif_readcolortbl(rd,gif->localtbl,numcolors);
+                    tbl=gif->localtbl;
+                }
+                if(gif->gifISD.width>self->row_len)
+                {
+                    self->row=m_renew(uint8_t,self->row,self->row_len,gif->gifISD.width);
+                    self->row_len=gif->gifISD.width;
+                }
+                // the previous frame asked for its area to be cleared to the background
+                if(self->disposal==2)
+                {
+                    uint32_t bkcolor=fb->format==FRAMEBUF_PL8?gif->gifLSD.bkcindex:gif_getrgb888(gif->colortbl[gif->gifLSD.bkcindex]);
+                    fill_rect(fb,self->prev_x,self->prev_y,self->prev_w,self->prev_h,bkcolor);
                 }
-                if(Disposal==2)gif_clear2bkcolor(x0,y0,gif,previmg); 
-                gif_dispimage(gfile,gif,x0+gif->gifISD.xoff,y0+gif->gifISD.yoff,TransIndex,Disposal);
-                while(1)
+                self->disposal=Disposal;
+                self->prev_x=x0+gif->gifISD.xoff;
+                self->prev_y=y0+gif->gifISD.yoff;
+                self->prev_w=gif->gifISD.width;
+                self->prev_h=gif->gifISD.height;
+                if(gif_dispimage(fb,rd,gif,self->prev_x,self->prev_y,tbl,numcolors,TransIndex,self->row))return 1;
+                // skip what is left of the image data, unless the terminator was already read
+                if(!gif->lzw->GetDone)
                 {
-                    f_read(gfile,&temp,1,(UINT*)&readed);//读取一个字节
-                    if(temp==0)break;
-                    readed=f_tell(gfile);//还存在块.	
-                    if(f_lseek(gfile,readed+temp))break;//继续向后偏移	 
+                    gif_read(rd,NULL,gif->lzw->BlockLeft);
+                    while(gif_getdatablock(rd,NULL,0)!=0);
                 }
-                if(temp!=0)return 1;//Error 
                 return 0;
+            }
             case GIF_INTRO_TERMINATOR://得到结束符了
                 return 2;//代表图像解码完成了.
             case GIF_INTRO_EXTENSION:
                 //Read image extension*/
-                res=gif_readextension(gfile,gif,&TransIndex,&Disposal);//读取图像扩展块消息
-                if(res)return 1;
+                temp=gif_readextension(rd,gif,&TransIndex,&Disposal);//读取图像扩展块消息
+                if(temp)return 1;
                 break;
             default:
                 return 1;
         }
-    }while(Introducer!=GIF_INTRO_TERMINATOR);//读到结束符了
-    return 0;
-}
-
-void gif_quit(void)
-{
-    gifdecoding=0;
+    }
 }
 
-STATIC mp_obj_t framebuf_loadgif(size_t n_args, const mp_obj_t *args) {
-    (void)n_args;
-    int res = 0;
-    FIL gfile;
-    fs_user_mount_t *vfs_fat = &fs_user_mount_flash;
-
-    uint16_t dtime=0;//解码延时
-    gif89a *mygif89a;
+STATIC const mp_obj_type_t mp_type_gif;
 
-    _fb = MP_OBJ_TO_PTR(args[0]);
-    const char *filename = mp_obj_str_get_str(args[1]);
-    mp_obj_t callback = MP_OBJ_TO_PTR(args[2]);
-    mp_int_t x = 0;
-    mp_int_t y = 0;
-    if (n_args > 3){
-        x = mp_obj_get_int(args[3]);
-        y = mp_obj_get_int(args[4]);
+STATIC void gif_close(mp_obj_gif_t *self) {
+    if (self->opened) {
+        self->opened = false;
+        mp_stream_close(self->rd.stream);
     }
-    mygif89a=(gif89a*)m_malloc(sizeof(gif89a));
-    if (!mygif89a){
-        res = -99;
+    self->done = true;
+    // give the decoder memory back straight away rather than at the next GC
+    if (!self->gif) {
+        return;
     }
-    mygif89a->lzw=(LZW_INFO*)m_malloc(sizeof(LZW_INFO));
-    if(mygif89a->lzw==NULL){
-        res = -98;
+    if (self->scratch == mp_const_none) {
+        m_del_obj(LZW_INFO, self->gif->lzw);
     }
-    if (res != 0){
-        printf("mem low %d\r\n", res);
-        return mp_const_none;
+    if (self->gif->localtbl != NULL) {
+        m_del(uint16_t, self->gif->localtbl, 256);
     }
+    m_del(uint8_t, self->row, self->row_len);
+    m_del_obj(gif89a, self->gif);
+    self->gif = NULL;
+    self->row = NULL;
+    self->row_len = 0;
+}
 
-    res = f_open(&vfs_fat->fatfs, &gfile, filename, FA_READ);
-    if(res==0)//打开文件ok
-    {
-        if(gif_check_head(&gfile))res=-3;
-        if(gif_getinfo(&gfile,mygif89a))res=-4;
-        /*
-        if(mygif89a->gifLSD.width>width||mygif89a->gifLSD.height>height)res=-2;//尺寸太大.
-        else
-        {
-            x=(width-mygif89a->gifLSD.width)/2+x;
-            y=(height-mygif89a->gifLSD.height)/2+y;
-        }
-        */
-        gifdecoding=1;
-        while(gifdecoding&&res==0)//解码循环
-        {	 
-            res=gif_drawimage(&gfile,mygif89a,x,y);//显示一张图片
-            if(callback != mp_const_none){
-                mp_call_function_0(callback);
-            }
-            if(mygif89a->gifISD.flag&0x80)gif_recovergctbl(mygif89a);//恢复全局颜色表
-            if(mygif89a->delay)dtime=mygif89a->delay;
-            else dtime=10;//默认延时
-            while(dtime--&&gifdecoding)mp_hal_delay_ms(10);//延迟
-            if(res==2)
-            {
-                res=0;
-                break;
-            }
+// GIF(file[, scratch]): an animation read a frame at a time from a file name
+// or an open binary stream.  The LZW tables, the largest part of the decoder
+// state, are put in scratch if given, a writable buffer of at least
+// GIF.SCRATCH_SIZE bytes that can be shared by GIF objects not in use at the
+// same time; otherwise they are allocated on the heap.
+STATIC mp_obj_t gif_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    LZW_INFO *lzw;
+    mp_obj_t scratch = mp_const_none;
+    if (n_args > 1 && args[1] != mp_const_none) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+        if (bufinfo.len < sizeof(LZW_INFO) || ((uintptr_t)bufinfo.buf & (sizeof(void*) - 1)) != 0) {
+            mp_raise_ValueError("scratch buffer too small or unaligned");
         }
+        lzw = bufinfo.buf;
+        scratch = args[1];
+    } else {
+        lzw = m_new_obj(LZW_INFO);
     }
-    f_close(&gfile);
-    m_free(mygif89a->lzw);
-    m_free(mygif89a); 
-    return mp_const_none;
+    mp_obj_gif_t *o = m_new_obj(mp_obj_gif_t);
+    o->base.type = type;
+    o->done = false;
+    o->disposal = 0;
+    o->row_len = 0;
+    o->row = NULL;
+    o->scratch = scratch;
+    o->gif = m_new_obj(gif89a);
+    o->gif->lzw = lzw;
+    o->gif->localtbl = NULL;
+    o->gif->numcolors = 0;
+    o->rd.stream = image_open(args[0], &o->opened);
+    o->rd.pos = 0;
+    o->rd.len = 0;
+    mp_uint_t t0 = stats_start();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        if (gif_check_head(&o->rd)) {
+            mp_raise_ValueError("not a gif");
+        }
+        gif_getinfo(&o->rd, o->gif);
+        o->width = o->gif->gifLSD.width;
+        o->height = o->gif->gifLSD.height;
+        o->row_len = o->width;
+        o->row = m_new(uint8_t, o->row_len);
+        nlr_pop();
+        stats_add(&loader_stats.total_us, t0);
+    } else {
+        gif_close(o);
+        nlr_jump(nlr.ret_val);
+    }
+    return MP_OBJ_FROM_PTR(o);
 }
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_loadgif_obj, 3, 5, framebuf_loadgif);
-
-STATIC mp_obj_t framebuf_circle(size_t n_args, const mp_obj_t *args) {
-    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
-    mp_int_t x0 = mp_obj_get_int(args[1]);
-    mp_int_t y0 = mp_obj_get_int(args[2]);
-    mp_int_t r = mp_obj_get_int(args[3]);
-    mp_int_t col = mp_obj_get_int(args[4]);
-    mp_int_t fill = 0;
-    if (n_args == 6){
-        fill = mp_obj_get_int(args[5]);
+// Draw the next frame into fb and return how long to show it for in ms, or
+// None after the last frame.
+STATIC mp_obj_t gif_next_frame_fb(mp_obj_gif_t *self, mp_obj_framebuf_t *fb, int x, int y) {
+    if (self->done) {
+        return mp_const_none;
     }
-    // fb, x0, 0, r, color
-    int f = 1 - r;
-    int ddF_x = 1;
-    int ddF_y = -2 * r;
-    int x = 0;
-	int y = r;
-    if (fill){
-        fill_rect(self, x0, y0 - r, 1, 2*r + 1, col);
+    uint8_t res;
+    mp_uint_t t0 = stats_start();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        res = gif_drawimage(self, fb, x, y);
+        nlr_pop();
+        stats_add(&loader_stats.total_us, t0);
+    } else {
+        gif_close(self);
+        nlr_jump(nlr.ret_val);
     }
-    while (x < y){
-        if (f >= 0) {
-			y--;
-			ddF_y += 2;
-			f += ddF_y;
-		}
-        x++;
-		ddF_x += 2;
-		f += ddF_x;
-        if (fill){
-            fill_rect(self, x0 + x, y0 - y, 1, 2*y + 1, col);
-            fill_rect(self, x0 + y, y0 - x, 1, 2*x + 1, col);
-            fill_rect(self, x0 - x, y0 - y, 1, 2*y + 1, col);
-            fill_rect(self, x0 - y, y0 - x, 1, 2*x + 1, col);
-
-        } else {
-            setpixel(self, x0 + x, y0 + y, col);
-            setpixel(self, x0 - x, y0 + y, col);
-            setpixel(self, x0 + x, y0 - y, col);
-            setpixel(self, x0 - x, y0 - y, col);
-            setpixel(self, x0 + y, y0 + x, col);
-            setpixel(self, x0 - y, y0 + x, col);
-            setpixel(self, x0 + y, y0 - x, col);
-            setpixel(self, x0 - y, y0 - x, col);
+    if (res != 0) {
+        gif_close(self);
+        if (res == 1) {
+            mp_raise_ValueError("invalid gif");
         }
+        return mp_const_none;
     }
-    return mp_const_none;
+    // a delay of 0 is shown by most players as 100ms
+    return MP_OBJ_NEW_SMALL_INT(self->gif->delay ? self->gif->delay * 10 : 100);
 }
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_circle_obj, 5, 6, framebuf_circle);
-
-#define swap(a, b) { int16_t t = a; a = b; b = t; }
-
-STATIC mp_obj_t framebuf_traingle(size_t n_args, const mp_obj_t *args) {
-    // fb, x0, y0, x1, y1, x2, y2, color, fill?
+// next_frame(fb[, x, y]): draw the next frame with the top left corner of
+// the animation at (x, y).
+STATIC mp_obj_t gif_next_frame(size_t n_args, const mp_obj_t *args) {
+    mp_obj_gif_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_framebuf_t *fb = MP_OBJ_TO_PTR(args[1]);
+    mp_int_t x = 0;
+    mp_int_t y = 0;
+    if (n_args > 2) {
+        x = mp_obj_get_int(args[2]);
+        y = mp_obj_get_int(args[3]);
+    }
+    return gif_next_frame_fb(self, fb, x, y);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gif_next_frame_obj, 2, 4, gif_next_frame);
+
+STATIC mp_obj_t gif_close_meth(mp_obj_t self_in) {
+    gif_close(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(gif_close_obj, gif_close_meth);
+
+// palette(buf): write the global colour table to buf as native RGB565
+// values, eg an array('H') for SCREEN.palette(), to show frames drawn into a
+// PL8 framebuffer.  Returns the number of colours in the table.
+STATIC mp_obj_t gif_palette(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_gif_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (self->gif == NULL) {
+        mp_raise_ValueError("closed");
+    }
+    uint16_t *pal = bufinfo.buf;
+    size_t n = MIN(self->gif->numcolors, bufinfo.len / sizeof(uint16_t));
+    for (size_t i = 0; i < n; ++i) {
+        uint16_t c = self->gif->colortbl[i];
+        pal[i] = (c >> 8) | (c << 8);
+    }
+    return MP_OBJ_NEW_SMALL_INT(self->gif->numcolors);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(gif_palette_obj, gif_palette);
+
+STATIC mp_obj_t gif_size(mp_obj_t self_in) {
+    mp_obj_gif_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t size[2] = {
+        MP_OBJ_NEW_SMALL_INT(self->width),
+        MP_OBJ_NEW_SMALL_INT(self->height),
+    };
+    return mp_obj_new_tuple(2, size);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(gif_size_obj, gif_size);
+
+STATIC const mp_rom_map_elem_t gif_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_next_frame), MP_ROM_PTR(&gif_next_frame_obj) },
+    { MP_ROM_QSTR(MP_QSTR_size), MP_ROM_PTR(&gif_size_obj) },
+    { MP_ROM_QSTR(MP_QSTR_palette), MP_ROM_PTR(&gif_palette_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&gif_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_SCRATCH_SIZE), MP_ROM_INT(sizeof(LZW_INFO)) },
+};
+STATIC MP_DEFINE_CONST_DICT(gif_locals_dict, gif_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_gif = {
+    { &mp_type_type },
+    .name = MP_QSTR_GIF,
+    .make_new = gif_make_new,
+    .locals_dict = (mp_obj_dict_t*)&gif_locals_dict,
+};
+
+// loadgif(file, callback[, x, y]): play a whole animation, calling callback
+// after each frame is drawn.  Kept for existing code; GIF.next_frame() lets
+// other work run between frames.
+STATIC mp_obj_t framebuf_loadgif(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_t callback = args[2];
+    mp_int_t x = 0;
+    mp_int_t y = 0;
+    if (n_args > 3) {
+        x = mp_obj_get_int(args[3]);
+        y = mp_obj_get_int(args[4]);
+    }
+    mp_obj_gif_t *gif = MP_OBJ_TO_PTR(gif_make_new(&mp_type_gif, 1, 0, &args[1]));
+    for (;;) {
+        mp_obj_t delay = gif_next_frame_fb(gif, self, x, y);
+        if (delay == mp_const_none) {
+            break;
+        }
+        if (callback != mp_const_none) {
+            mp_call_function_0(callback);
+        }
+        mp_hal_delay_ms(MP_OBJ_SMALL_INT_VALUE(delay));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_loadgif_obj, 3, 5, framebuf_loadgif);
+
+// GIFCache: an animation decoded once and kept as the rectangle of pixels
+// that changed from one frame to the next, so that playing it again is a
+// blit per frame.  The first frame is kept whole, and an extra rectangle
+// takes the last frame back to the first for looping.
+
+typedef struct _gifcache_frame_t {
+    uint16_t x, y, w, h;
+    uint16_t delay;
+    uint32_t offset; // of the pixels in data
+} gifcache_frame_t;
+
+typedef struct _mp_obj_gifcache_t {
+    mp_obj_base_t base;
+    uint16_t width, height;
+    uint8_t format;
+    bool looped;
+    uint16_t nframes, pos;
+    gifcache_frame_t *frames; // nframes + 1 entries, the last for looping
+    uint8_t *data;
+    size_t data_len;
+} mp_obj_gifcache_t;
+
+// Find the bounding box of the pixels that differ between a and b, both
+// width x height with bpp bytes per pixel.  The box is empty if they match.
+STATIC void gifcache_diff(const uint8_t *a, const uint8_t *b, int width, int height, int bpp, gifcache_frame_t *f) {
+    int x0 = width, x1 = 0, y0 = height, y1 = 0;
+    size_t row_len = width * bpp;
+    for (int y = 0; y < height; ++y, a += row_len, b += row_len) {
+        if (memcmp(a, b, row_len) == 0) {
+            continue;
+        }
+        int l = 0;
+        while (memcmp(a + l * bpp, b + l * bpp, bpp) == 0) {
+            ++l;
+        }
+        int r = width - 1;
+        while (memcmp(a + r * bpp, b + r * bpp, bpp) == 0) {
+            --r;
+        }
+        x0 = MIN(x0, l);
+        x1 = MAX(x1, r + 1);
+        y0 = MIN(y0, y);
+        y1 = y + 1;
+    }
+    if (x1 <= x0) {
+        f->x = f->y = f->w = f->h = 0;
+    } else {
+        f->x = x0;
+        f->y = y0;
+        f->w = x1 - x0;
+        f->h = y1 - y0;
+    }
+}
+
+// Append the pixels of rectangle f of the width-wide image src to the store.
+STATIC void gifcache_add(mp_obj_gifcache_t *self, gifcache_frame_t *f, const uint8_t *src, int bpp) {
+    size_t row_len = f->w * bpp;
+    size_t len = row_len * f->h;
+    self->data = m_renew(uint8_t, self->data, self->data_len, self->data_len + len);
+    f->offset = self->data_len;
+    self->data_len += len;
+    uint8_t *dest = self->data + f->offset;
+    for (int y = 0; y < f->h; ++y, dest += row_len) {
+        memcpy(dest, src + ((f->y + y) * self->width + f->x) * bpp, row_len);
+    }
+}
+
+// GIFCache(file[, format[, scratch]]): decode every frame of a GIF, drawn
+// into a framebuffer of format (RGB565 by default, or PL8) cleared to 0.
+// scratch is as for GIF.
+STATIC mp_obj_t gifcache_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 3, false);
+    uint8_t format = n_args > 1 ? mp_obj_get_int(args[1]) : FRAMEBUF_RGB565;
+    if (format != FRAMEBUF_RGB565 && format != FRAMEBUF_PL8) {
+        mp_raise_ValueError("invalid format");
+    }
+    mp_obj_t gif_args[2] = { args[0], n_args > 2 ? args[2] : mp_const_none };
+    mp_obj_gif_t *gif = MP_OBJ_TO_PTR(gif_make_new(&mp_type_gif, 2, 0, gif_args));
+
+    mp_obj_gifcache_t *o = m_new_obj(mp_obj_gifcache_t);
+    o->base.type = type;
+    o->width = gif->width;
+    o->height = gif->height;
+    o->format = format;
+    o->looped = false;
+    o->nframes = 0;
+    o->pos = 0;
+    o->frames = m_new(gifcache_frame_t, 1);
+    o->data = NULL;
+    o->data_len = 0;
+
+    // frames are drawn into cur and compared with the previous frame in prev
+    int bpp = format == FRAMEBUF_RGB565 ? 2 : 1;
+    size_t len = o->width * o->height * bpp;
+    uint8_t *prev = m_new0(uint8_t, len);
+    mp_obj_framebuf_t canvas = {
+        .buf = m_new0(uint8_t, len), .width = o->width, .height = o->height,
+        .stride = o->width, .format = format,
+    };
+    framebuf_init_state(&canvas);
+    for (;;) {
+        mp_obj_t delay = gif_next_frame_fb(gif, &canvas, 0, 0);
+        if (delay == mp_const_none) {
+            break;
+        }
+        o->frames = m_renew(gifcache_frame_t, o->frames, o->nframes + 1, o->nframes + 2);
+        gifcache_frame_t *f = &o->frames[o->nframes];
+        if (o->nframes == 0) {
+            *f = (gifcache_frame_t){ .w = o->width, .h = o->height };
+        } else {
+            gifcache_diff(prev, canvas.buf, o->width, o->height, bpp, f);
+        }
+        f->delay = MP_OBJ_SMALL_INT_VALUE(delay);
+        gifcache_add(o, f, canvas.buf, bpp);
+        memcpy(prev, canvas.buf, len);
+        ++o->nframes;
+    }
+    if (o->nframes == 0) {
+        mp_raise_ValueError("invalid gif");
+    }
+
+    // the loop rectangle goes from the last frame, in prev, to the first,
+    // which is whole at the start of the store
+    gifcache_frame_t *f = &o->frames[o->nframes];
+    gifcache_diff(prev, o->data, o->width, o->height, bpp, f);
+    f->delay = o->frames[0].delay;
+    memcpy(canvas.buf, o->data, len);
+    gifcache_add(o, f, canvas.buf, bpp);
+
+    m_del(uint8_t, canvas.buf, len);
+    m_del(uint8_t, prev, len);
+    return MP_OBJ_FROM_PTR(o);
+}
+
+// next_frame(fb[, x, y]): draw the next frame with the top left corner of
+// the animation at (x, y), which must hold the frame before it, and return
+// how long to show it for in ms.  After the last frame the animation starts
+// again.
+STATIC mp_obj_t gifcache_next_frame(size_t n_args, const mp_obj_t *args) {
+    mp_obj_gifcache_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_framebuf_t *fb = MP_OBJ_TO_PTR(args[1]);
+    mp_int_t x = 0;
+    mp_int_t y = 0;
+    if (n_args > 2) {
+        x = mp_obj_get_int(args[2]);
+        y = mp_obj_get_int(args[3]);
+    }
+    const gifcache_frame_t *f = &self->frames[self->pos];
+    if (self->pos == 0 && self->looped) {
+        f = &self->frames[self->nframes];
+    }
+    mp_obj_framebuf_t src = {
+        .buf = self->data + f->offset, .width = f->w, .height = f->h,
+        .stride = f->w, .format = self->format,
+    };
+    blit_rect(fb, x + f->x, y + f->y, &src, 0, 0, f->w, f->h, -1, NULL);
+    if (++self->pos == self->nframes) {
+        self->pos = 0;
+        self->looped = true;
+    }
+    return MP_OBJ_NEW_SMALL_INT(f->delay);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gifcache_next_frame_obj, 2, 4, gifcache_next_frame);
+
+// rewind(): start again from the first frame, drawn whole.
+STATIC mp_obj_t gifcache_rewind(mp_obj_t self_in) {
+    mp_obj_gifcache_t *self = MP_OBJ_TO_PTR(self_in);
+    self->pos = 0;
+    self->looped = false;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(gifcache_rewind_obj, gifcache_rewind);
+
+// info(): return (frames, bytes of pixels stored).
+STATIC mp_obj_t gifcache_info(mp_obj_t self_in) {
+    mp_obj_gifcache_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t info[2] = {
+        MP_OBJ_NEW_SMALL_INT(self->nframes),
+        mp_obj_new_int_from_uint(self->data_len),
+    };
+    return mp_obj_new_tuple(2, info);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(gifcache_info_obj, gifcache_info);
+
+STATIC mp_obj_t gifcache_size(mp_obj_t self_in) {
+    mp_obj_gifcache_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t size[2] = {
+        MP_OBJ_NEW_SMALL_INT(self->width),
+        MP_OBJ_NEW_SMALL_INT(self->height),
+    };
+    return mp_obj_new_tuple(2, size);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(gifcache_size_obj, gifcache_size);
+
+STATIC const mp_rom_map_elem_t gifcache_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_next_frame), MP_ROM_PTR(&gifcache_next_frame_obj) },
+    { MP_ROM_QSTR(MP_QSTR_rewind), MP_ROM_PTR(&gifcache_rewind_obj) },
+    { MP_ROM_QSTR(MP_QSTR_size), MP_ROM_PTR(&gifcache_size_obj) },
+    { MP_ROM_QSTR(MP_QSTR_info), MP_ROM_PTR(&gifcache_info_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(gifcache_locals_dict, gifcache_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_gifcache = {
+    { &mp_type_type },
+    .name = MP_QSTR_GIFCache,
+    .make_new = gifcache_make_new,
+    .locals_dict = (mp_obj_dict_t*)&gifcache_locals_dict,
+};
+
+// jpeg decoder: baseline, huffman coded, 8 bit, greyscale or YCbCr with
+// sampling factors of 1 or 2.  Each MCU is decoded with an integer IDCT and
+// written straight to the framebuffer, so the working set does not depend
+// on the size of the image.
+
+STATIC const uint8_t jpeg_zigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+STATIC NORETURN void jpeg_invalid(void) {
+    mp_raise_ValueError("invalid jpeg");
+}
+
+STATIC uint jpeg_read16(gif_reader_t *rd) {
+    uint v = gif_readbyte(rd) << 8;
+    return v | gif_readbyte(rd);
+}
+
+// DQT: one or more quantisation tables.
+STATIC void jpeg_read_dqt(jpeg_decoder_t *d, gif_reader_t *rd, int len) {
+    while (len > 0) {
+        uint pq_tq = gif_readbyte(rd);
+        if ((pq_tq & 0x0f) > 3) {
+            jpeg_invalid();
+        }
+        uint16_t *qt = d->qt[pq_tq & 3];
+        for (int i = 0; i < 64; ++i) {
+            qt[jpeg_zigzag[i]] = pq_tq >> 4 ? jpeg_read16(rd) : gif_readbyte(rd);
+        }
+        len -= 1 + (pq_tq >> 4 ? 128 : 64);
+    }
+}
+
+// DHT: one or more huffman tables, built for canonical decoding with a
+// lookup table for the short codes.
+STATIC void jpeg_read_dht(jpeg_decoder_t *d, gif_reader_t *rd, int len) {
+    while (len > 0) {
+        uint tc_th = gif_readbyte(rd);
+        if ((tc_th >> 4) > 1 || (tc_th & 0x0f) > 1) {
+            mp_raise_ValueError("unsupported jpeg");
+        }
+        jpeg_huff_t *h = &d->huff[(tc_th >> 4) * 2 + (tc_th & 1)];
+        uint8_t counts[16];
+        gif_read(rd, counts, 16);
+        int total = 0;
+        for (int l = 0; l < 16; ++l) {
+            total += counts[l];
+        }
+        if (total > 256) {
+            jpeg_invalid();
+        }
+        gif_read(rd, h->vals, total);
+        len -= 17 + total;
+
+        memset(h->look_nbits, 0, sizeof(h->look_nbits));
+        int32_t code = 0;
+        int k = 0;
+        for (int l = 1; l <= 16; ++l) {
+            int n = counts[l - 1];
+            h->valoff[l] = k - code;
+            h->maxcode[l] = n ? code + n - 1 : -1;
+            for (; n; --n, ++k, ++code) {
+                if (l <= JPEG_HUFF_LOOKAHEAD) {
+                    int shift = JPEG_HUFF_LOOKAHEAD - l;
+                    for (int i = 0; i < (1 << shift); ++i) {
+                        h->look_nbits[(code << shift) + i] = l;
+                        h->look_sym[(code << shift) + i] = h->vals[k];
+                    }
+                }
+            }
+            if (code > (1 << l)) {
+                jpeg_invalid();
+            }
+            code <<= 1;
+        }
+        h->maxcode[17] = INT32_MAX;
+    }
+}
+
+// SOF0/SOF1: image size and components.
+STATIC void jpeg_read_sof(jpeg_decoder_t *d, gif_reader_t *rd) {
+    if (gif_readbyte(rd) != 8) {
+        mp_raise_ValueError("unsupported jpeg");
+    }
+    d->height = jpeg_read16(rd);
+    d->width = jpeg_read16(rd);
+    d->ncomp = gif_readbyte(rd);
+    if ((d->ncomp != 1 && d->ncomp != 3) || d->width == 0 || d->height == 0) {
+        mp_raise_ValueError("unsupported jpeg");
+    }
+    d->hmax = d->vmax = 1;
+    for (int i = 0; i < d->ncomp; ++i) {
+        jpeg_comp_t *c = &d->comp[i];
+        c->id = gif_readbyte(rd);
+        uint hv = gif_readbyte(rd);
+        c->h = hv >> 4;
+        c->v = hv & 0x0f;
+        c->tq = gif_readbyte(rd) & 3;
+        if (c->h < 1 || c->h > 2 || c->v < 1 || c->v > 2) {
+            mp_raise_ValueError("unsupported jpeg");
+        }
+        d->hmax = MAX(d->hmax, c->h);
+        d->vmax = MAX(d->vmax, c->v);
+    }
+    // a single component is coded a block at a time whatever its sampling
+    if (d->ncomp == 1) {
+        d->comp[0].h = d->comp[0].v = d->hmax = d->vmax = 1;
+    }
+    int block = 0;
+    for (int i = 0; i < d->ncomp; ++i) {
+        jpeg_comp_t *c = &d->comp[i];
+        c->hs = d->hmax / c->h - 1;
+        c->vs = d->vmax / c->v - 1;
+        c->block = block;
+        block += c->h * c->v;
+    }
+}
+
+// SOS: the tables used by each component of the scan.
+STATIC void jpeg_read_sos(jpeg_decoder_t *d, gif_reader_t *rd) {
+    if (d->ncomp == 0) {
+        jpeg_invalid();
+    }
+    uint ns = gif_readbyte(rd);
+    if (ns != d->ncomp) {
+        mp_raise_ValueError("unsupported jpeg");
+    }
+    for (uint i = 0; i < ns; ++i) {
+        uint id = gif_readbyte(rd);
+        uint td_ta = gif_readbyte(rd);
+        jpeg_comp_t *c = NULL;
+        for (int j = 0; j < d->ncomp; ++j) {
+            if (d->comp[j].id == id) {
+                c = &d->comp[j];
+            }
+        }
+        if (c == NULL || (td_ta >> 4) > 1 || (td_ta & 0x0f) > 1) {
+            jpeg_invalid();
+        }
+        c->td = td_ta >> 4;
+        c->ta = 2 + (td_ta & 1);
+        c->dcpred = 0;
+    }
+    // spectral selection and successive approximation are fixed for baseline
+    gif_read(rd, NULL, 3);
+}
+
+// Top up the bit buffer to at least 25 bits.  Stuffed zero bytes are
+// dropped, and once a marker is reached zeros are fed instead.
+static inline void jpeg_fill(jpeg_decoder_t *d, gif_reader_t *rd) {
+    while (d->nbits <= 24) {
+        uint b = 0;
+        if (!d->marker) {
+            b = gif_readbyte(rd);
+            if (b == 0xff) {
+                uint m = gif_readbyte(rd);
+                while (m == 0xff) {
+                    m = gif_readbyte(rd);
+                }
+                if (m != 0) {
+                    d->marker = m;
+                    b = 0;
+                }
+            }
+        }
+        d->bits |= b << (24 - d->nbits);
+        d->nbits += 8;
+    }
+}
+
+static inline uint jpeg_getbits(jpeg_decoder_t *d, gif_reader_t *rd, int n) {
+    jpeg_fill(d, rd);
+    uint v = d->bits >> (32 - n);
+    d->bits <<= n;
+    d->nbits -= n;
+    return v;
+}
+
+// Sign-extend an n bit value as coded in the entropy data.
+static inline int jpeg_extend(uint v, int n) {
+    return v < (1u << (n - 1)) ? (int)v - (1 << n) + 1 : (int)v;
+}
+
+STATIC uint jpeg_decode_huff(jpeg_decoder_t *d, gif_reader_t *rd, const jpeg_huff_t *h) {
+    jpeg_fill(d, rd);
+    uint look = d->bits >> (32 - JPEG_HUFF_LOOKAHEAD);
+    int n = h->look_nbits[look];
+    if (n) {
+        d->bits <<= n;
+        d->nbits -= n;
+        return h->look_sym[look];
+    }
+    for (n = JPEG_HUFF_LOOKAHEAD + 1; n <= 16; ++n) {
+        int32_t code = d->bits >> (32 - n);
+        if (code <= h->maxcode[n]) {
+            d->bits <<= n;
+            d->nbits -= n;
+            return h->vals[h->valoff[n] + code];
+        }
+    }
+    jpeg_invalid();
+}
+
+// Decode the coefficients of one block into d->coef, dequantised.
+STATIC void jpeg_decode_block(jpeg_decoder_t *d, gif_reader_t *rd, jpeg_comp_t *c) {
+    const uint16_t *qt = d->qt[c->tq];
+    int32_t *coef = d->coef;
+    memset(coef, 0, sizeof(d->coef));
+    uint t = jpeg_decode_huff(d, rd, &d->huff[c->td]);
+    if (t > 11) {
+        jpeg_invalid();
+    }
+    if (t) {
+        c->dcpred += jpeg_extend(jpeg_getbits(d, rd, t), t);
+    }
+    coef[0] = c->dcpred * qt[0];
+    for (int k = 1; k < 64;) {
+        uint rs = jpeg_decode_huff(d, rd, &d->huff[c->ta]);
+        uint s = rs & 0x0f;
+        if (s == 0) {
+            if (rs != 0xf0) {
+                break; // end of block
+            }
+            k += 16;
+            continue;
+        }
+        k += rs >> 4;
+        if (k > 63 || s > 10) {
+            jpeg_invalid();
+        }
+        int z = jpeg_zigzag[k++];
+        coef[z] = jpeg_extend(jpeg_getbits(d, rd, s), s) * qt[z];
+    }
+}
+
+static inline uint8_t jpeg_clamp(int v) {
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+// One dimensional 8 point IDCT in 12 bit fixed point (the even part, then
+// the odd part, of the factorisation used by the IJG integer IDCT).  Leaves
+// outputs i and 7 - i as x[i] + t[3 - i] and x[i] - t[3 - i], scaled by 4096
+// times a further factor of sqrt(8).
+#define JPEG_IDCT_1D(s0, s1, s2, s3, s4, s5, s6, s7) \
+    int t0, t1, t2, t3, p1, p2, p3, p4, p5, x0, x1, x2, x3; \
+    p1 = ((s2) + (s6)) * 2217; \
+    t2 = p1 + (s6) * -7568; \
+    t3 = p1 + (s2) * 3135; \
+    t0 = ((s0) + (s4)) * 4096; \
+    t1 = ((s0) - (s4)) * 4096; \
+    x0 = t0 + t3; \
+    x3 = t0 - t3; \
+    x1 = t1 + t2; \
+    x2 = t1 - t2; \
+    t0 = (s7); \
+    t1 = (s5); \
+    t2 = (s3); \
+    t3 = (s1); \
+    p3 = t0 + t2; \
+    p4 = t1 + t3; \
+    p1 = t0 + t3; \
+    p2 = t1 + t2; \
+    p5 = (p3 + p4) * 4816; \
+    t0 *= 1223; \
+    t1 *= 8410; \
+    t2 *= 12586; \
+    t3 *= 6149; \
+    p1 = p5 + p1 * -3686; \
+    p2 = p5 + p2 * -10498; \
+    p3 *= -8035; \
+    p4 *= -1598; \
+    t3 += p1 + p4; \
+    t2 += p2 + p3; \
+    t1 += p2 + p4; \
+    t0 += p1 + p3;
+
+// Transform d->coef into 8x8 samples in out.
+STATIC void jpeg_idct(jpeg_decoder_t *d, uint8_t *out) {
+    int32_t *s = d->coef;
+    int v[64];
+    // columns, keeping 2 extra bits of precision
+    for (int i = 0; i < 8; ++i) {
+        int32_t *c = s + i;
+        if ((c[8] | c[16] | c[24] | c[32] | c[40] | c[48] | c[56]) == 0) {
+            int dc = c[0] * 4;
+            for (int j = 0; j < 64; j += 8) {
+                v[i + j] = dc;
+            }
+            continue;
+        }
+        JPEG_IDCT_1D(c[0], c[8], c[16], c[24], c[32], c[40], c[48], c[56])
+        x0 += 512;
+        x1 += 512;
+        x2 += 512;
+        x3 += 512;
+        v[i] = (x0 + t3) >> 10;
+        v[i + 56] = (x0 - t3) >> 10;
+        v[i + 8] = (x1 + t2) >> 10;
+        v[i + 48] = (x1 - t2) >> 10;
+        v[i + 16] = (x2 + t1) >> 10;
+        v[i + 40] = (x2 - t1) >> 10;
+        v[i + 24] = (x3 + t0) >> 10;
+        v[i + 32] = (x3 - t0) >> 10;
+    }
+    // rows: remove the 2 bits, 12 bits of fixed point and 3 bits for the
+    // two factors of sqrt(8), rounding and adding the level shift of 128
+    for (int i = 0; i < 64; i += 8, out += 8) {
+        int *r = v + i;
+        JPEG_IDCT_1D(r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7])
+        x0 += 65536 + (128 << 17);
+        x1 += 65536 + (128 << 17);
+        x2 += 65536 + (128 << 17);
+        x3 += 65536 + (128 << 17);
+        out[0] = jpeg_clamp((x0 + t3) >> 17);
+        out[7] = jpeg_clamp((x0 - t3) >> 17);
+        out[1] = jpeg_clamp((x1 + t2) >> 17);
+        out[6] = jpeg_clamp((x1 - t2) >> 17);
+        out[2] = jpeg_clamp((x2 + t1) >> 17);
+        out[5] = jpeg_clamp((x2 - t1) >> 17);
+        out[3] = jpeg_clamp((x3 + t0) >> 17);
+        out[4] = jpeg_clamp((x3 - t0) >> 17);
+    }
+}
+
+// Sample of component c for pixel (px, py) of the MCU.
+static inline uint jpeg_sample(const jpeg_decoder_t *d, const jpeg_comp_t *c, int px, int py) {
+    int sx = px >> c->hs;
+    int sy = py >> c->vs;
+    return d->blocks[c->block + (sy >> 3) * c->h + (sx >> 3)][(sy & 7) * 8 + (sx & 7)];
+}
+
+// Convert the part of the MCU at (mx, my) of fb inside x0 <= x < x1,
+// y0 <= y < y1 to RGB and write it to fb.
+STATIC void jpeg_write_mcu(const mp_obj_framebuf_t *fb, const jpeg_decoder_t *d, int mx, int my, int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; ++y) {
+        int py = y - my;
+        uint16_t *dest = fb->format == FRAMEBUF_RGB565 ? &((uint16_t*)fb->buf)[x0 + y * fb->stride] : NULL;
+        for (int x = x0; x < x1; ++x) {
+            int px = x - mx;
+            int r, g, b;
+            r = g = b = jpeg_sample(d, &d->comp[0], px, py);
+            if (d->ncomp == 3) {
+                int cb = (int)jpeg_sample(d, &d->comp[1], px, py) - 128;
+                int cr = (int)jpeg_sample(d, &d->comp[2], px, py) - 128;
+                // YCbCr to RGB in 16 bit fixed point
+                r = jpeg_clamp(r + ((91881 * cr + 32768) >> 16));
+                g = jpeg_clamp(g - ((22554 * cb + 46802 * cr - 32768) >> 16));
+                b = jpeg_clamp(b + ((116130 * cb + 32768) >> 16));
+            }
+            if (dest != NULL) {
+                // the framebuffer holds big-endian RGB565
+                uint16_t c = COL0(r, g, b);
+                *dest++ = (c >> 8) | (c << 8);
+            } else {
+                setpixel(fb, x, y, r << 16 | g << 8 | b);
+            }
+        }
+    }
+}
+
+// At the end of a restart interval, skip to the restart marker and start
+// the entropy coded data again.
+STATIC void jpeg_restart(jpeg_decoder_t *d, gif_reader_t *rd) {
+    if (!d->marker) {
+        uint b;
+        do {
+            while (gif_readbyte(rd) != 0xff) {
+            }
+            do {
+                b = gif_readbyte(rd);
+            } while (b == 0xff);
+        } while (b == 0);
+        d->marker = b;
+    }
+    if ((d->marker & 0xf8) != JPEG_RST0) {
+        jpeg_invalid();
+    }
+    d->marker = 0;
+    d->bits = 0;
+    d->nbits = 0;
+    for (int i = 0; i < d->ncomp; ++i) {
+        d->comp[i].dcpred = 0;
+    }
+}
+
+// Decode the image with its top left corner at (x, y) of fb.
+STATIC void jpeg_decode(mp_obj_framebuf_t *fb, jpeg_decoder_t *d, gif_reader_t *rd, int x, int y) {
+    if (gif_readbyte(rd) != 0xff || gif_readbyte(rd) != JPEG_SOI) {
+        mp_raise_ValueError("not a jpeg");
+    }
+    d->ncomp = 0;
+    d->restart_interval = 0;
+    for (;;) {
+        // markers may be preceded by any number of fill bytes
+        if (gif_readbyte(rd) != 0xff) {
+            jpeg_invalid();
+        }
+        uint m;
+        do {
+            m = gif_readbyte(rd);
+        } while (m == 0xff);
+        if (m == JPEG_EOI) {
+            jpeg_invalid();
+        }
+        int len = jpeg_read16(rd) - 2;
+        if (len < 0) {
+            jpeg_invalid();
+        }
+        switch (m) {
+            case JPEG_SOF0:
+            case JPEG_SOF1:
+                jpeg_read_sof(d, rd);
+                break;
+            case JPEG_DHT:
+                jpeg_read_dht(d, rd, len);
+                break;
+            case JPEG_DQT:
+                jpeg_read_dqt(d, rd, len);
+                break;
+            case JPEG_DRI:
+                d->restart_interval = jpeg_read16(rd);
+                break;
+            case JPEG_SOS:
+                jpeg_read_sos(d, rd);
+                goto scan;
+            default:
+                // progressive, lossless and arithmetic coded frames
+                if (m >= 0xc2 && m <= 0xcf && m != JPEG_DHT && m != 0xc8 && m != 0xcc) {
+                    mp_raise_ValueError("unsupported jpeg");
+                }
+                // APPn, COM and others
+                gif_read(rd, NULL, len);
+                break;
+        }
+    }
+
+scan:;
+    int mcu_w = 8 * d->hmax;
+    int mcu_h = 8 * d->vmax;
+    int mcus_x = (d->width + mcu_w - 1) / mcu_w;
+    int mcus_y = (d->height + mcu_h - 1) / mcu_h;
+    int ix0 = MAX(x, fb->clip_x0);
+    int iy0 = MAX(y, fb->clip_y0);
+    int ix1 = MIN(x + d->width, fb->clip_x1);
+    int iy1 = MIN(y + d->height, fb->clip_y1);
+    d->bits = 0;
+    d->nbits = 0;
+    d->marker = 0;
+    uint todo = d->restart_interval;
+    for (int my = 0; my < mcus_y; ++my) {
+        int py = y + my * mcu_h;
+        for (int mx = 0; mx < mcus_x; ++mx) {
+            if (d->restart_interval) {
+                if (todo == 0) {
+                    jpeg_restart(d, rd);
+                    todo = d->restart_interval;
+                }
+                --todo;
+            }
+            int px = x + mx * mcu_w;
+            int x0 = MAX(px, ix0);
+            int y0 = MAX(py, iy0);
+            int x1 = MIN(px + mcu_w, ix1);
+            int y1 = MIN(py + mcu_h, iy1);
+            // MCUs that are not seen are entropy decoded but not transformed
+            bool visible = x0 < x1 && y0 < y1;
+            for (int i = 0; i < d->ncomp; ++i) {
+                jpeg_comp_t *c = &d->comp[i];
+                for (int b = 0; b < c->h * c->v; ++b) {
+                    jpeg_decode_block(d, rd, c);
+                    if (visible) {
+                        jpeg_idct(d, d->blocks[c->block + b]);
+                    }
+                }
+            }
+            if (visible) {
+                mp_uint_t t0 = stats_start();
+                jpeg_write_mcu(fb, d, px, py, x0, y0, x1, y1);
+                stats_add(&loader_stats.blit_us, t0);
+                stats_pixels((x1 - x0) * (y1 - y0));
+            }
+        }
+    }
+    if (ix0 < ix1 && iy0 < iy1) {
+        dirty_add(fb, ix0, iy0, ix1, iy1);
+    }
+}
+
+// loadjpeg(file[, x, y]): draw a baseline JPEG with its top left corner at
+// (x, y).  Returns the size of the image as (width, height).
+STATIC mp_obj_t framebuf_loadjpeg(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t x = 0;
+    mp_int_t y = 0;
+    if (n_args > 2) {
+        x = mp_obj_get_int(args[2]);
+        y = mp_obj_get_int(args[3]);
+    }
+    jpeg_decoder_t *d = m_new_obj(jpeg_decoder_t);
+    gif_reader_t *rd = m_new_obj(gif_reader_t);
+    bool opened;
+    rd->stream = image_open(args[1], &opened);
+    rd->pos = 0;
+    rd->len = 0;
+    mp_uint_t t0 = stats_start();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        jpeg_decode(self, d, rd, x, y);
+        nlr_pop();
+        stats_add(&loader_stats.total_us, t0);
+    } else {
+        if (opened) {
+            mp_stream_close(rd->stream);
+        }
+        nlr_jump(nlr.ret_val);
+    }
+    if (opened) {
+        mp_stream_close(rd->stream);
+    }
+    mp_obj_t size[2] = {
+        MP_OBJ_NEW_SMALL_INT(d->width),
+        MP_OBJ_NEW_SMALL_INT(d->height),
+    };
+    m_del_obj(gif_reader_t, rd);
+    m_del_obj(jpeg_decoder_t, d);
+    return mp_obj_new_tuple(2, size);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_loadjpeg_obj, 2, 4, framebuf_loadjpeg);
+
+// Native image files (.fbi), written by tools/mkfbi.py, hold pixels already
+// in a framebuffer format so they can be read without decoding:
+//   16 byte header, all values little endian:
+//     'F', 'B', 'I', version (1)
+//     format (RGB565, GS4_HMSB or PL8), reserved byte (0)
+//     width, height, stride in pixels, number of palette entries: 16 bits each
+//     reserved 16 bits (0)
+//   palette: native RGB565 values, 16 bits each, as taken by SCREEN.palette()
+//   pixels: height rows of stride pixels, laid out as in a FrameBuffer
+typedef struct _fbi_header_t {
+    uint8_t magic[4];
+    uint8_t format;
+    uint8_t reserved1;
+    uint16_t width, height, stride, ncolors;
+    uint16_t reserved2;
+} fbi_header_t;
+
+STATIC const mp_obj_type_t mp_type_framebuf;
+
+// Discard n bytes of an image stream.
+STATIC void fbi_skip(mp_obj_t stream, size_t n) {
+    uint8_t skip[16];
+    image_skip(stream, skip, sizeof(skip), n);
+}
+
+// Read and check the header, then the palette into pal.  Returns the number
+// of bytes in one row of pixels.
+STATIC size_t fbi_read_head(mp_obj_t stream, fbi_header_t *head, uint16_t *pal) {
+    image_read(stream, head, sizeof(*head));
+    if (memcmp(head->magic, "FBI\x01", 4) != 0) {
+        mp_raise_ValueError("not an fbi");
+    }
+    size_t row_len;
+    switch (head->format) {
+        case FRAMEBUF_RGB565:
+            row_len = head->stride * 2;
+            break;
+        case FRAMEBUF_GS4_HMSB:
+            row_len = (head->stride + 1) / 2;
+            break;
+        case FRAMEBUF_PL8:
+            row_len = head->stride;
+            break;
+        default:
+            mp_raise_ValueError("unsupported fbi");
+    }
+    if (head->width > head->stride || head->ncolors > 256) {
+        mp_raise_ValueError("unsupported fbi");
+    }
+    image_read(stream, pal, head->ncolors * sizeof(uint16_t));
+    return row_len;
+}
+
+// Copy the n entries of pal to the caller's palette buffer, if there is one.
+STATIC void fbi_copy_palette(mp_obj_t palette_in, const uint16_t *pal, size_t n) {
+    if (palette_in != mp_const_none) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(palette_in, &bufinfo, MP_BUFFER_WRITE);
+        memcpy(bufinfo.buf, pal, MIN(n, bufinfo.len / sizeof(uint16_t)) * sizeof(uint16_t));
+    }
+}
+
+// load(file[, palette]): read an .fbi image into a new FrameBuffer with a
+// single read of its pixels.  The image palette, if any, is written to
+// palette as for loadbmp().
+STATIC mp_obj_t framebuf_load(size_t n_args, const mp_obj_t *args) {
+    bool opened;
+    mp_obj_t stream = image_open(args[0], &opened);
+    mp_obj_framebuf_t *o = m_new_obj(mp_obj_framebuf_t);
+    mp_uint_t t0 = stats_start();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        fbi_header_t head;
+        uint16_t pal[256];
+        size_t row_len = fbi_read_head(stream, &head, pal);
+        fbi_copy_palette(n_args > 1 ? args[1] : mp_const_none, pal, head.ncolors);
+        size_t len = row_len * head.height;
+        // RGB565 pixels are read in place, so keep them 16-bit aligned
+        byte *buf = m_new(byte, len);
+        image_read(stream, buf, len);
+        stats_pixels(head.width * head.height);
+        o->base.type = &mp_type_framebuf;
+        o->buf_obj = mp_obj_new_bytearray_by_ref(len, buf);
+        o->buf = buf;
+        o->width = head.width;
+        o->height = head.height;
+        o->stride = head.stride;
+        o->format = head.format;
+        framebuf_init_state(o);
+        nlr_pop();
+        stats_add(&loader_stats.total_us, t0);
+    } else {
+        if (opened) {
+            mp_stream_close(stream);
+        }
+        nlr_jump(nlr.ret_val);
+    }
+    if (opened) {
+        mp_stream_close(stream);
+    }
+    return MP_OBJ_FROM_PTR(o);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_load_obj, 1, 2, framebuf_load);
+
+STATIC void fbi_draw(mp_obj_framebuf_t *self, mp_obj_t stream, int x, int y, mp_obj_t palette_in) {
+    fbi_header_t head;
+    uint16_t pal[256];
+    size_t row_len = fbi_read_head(stream, &head, pal);
+    fbi_copy_palette(palette_in, pal, head.ncolors);
+    // indexed images are shown in an RGB565 framebuffer through their palette
+    const uint16_t *lut = NULL;
+    if (self->format == FRAMEBUF_RGB565 && head.format != FRAMEBUF_RGB565) {
+        for (size_t i = 0; i < 256; ++i) {
+            uint16_t c = i < head.ncolors ? pal[i] : 0;
+            pal[i] = (c >> 8) | (c << 8);
+        }
+        lut = pal;
+    }
+
+    // rows wholly inside the clip rectangle of a framebuffer in the same
+    // format are read straight into place
+    size_t bpp = head.format == FRAMEBUF_RGB565 ? 2 : 1;
+    bool direct = head.format == self->format && head.format != FRAMEBUF_GS4_HMSB
+        && x >= self->clip_x0 && x + head.width <= self->clip_x1;
+    uint8_t *row = NULL;
+    if (!direct) {
+        row = m_new(uint8_t, row_len);
+    }
+    mp_obj_framebuf_t src = {
+        .buf = row, .width = head.width, .height = 1, .stride = head.stride, .format = head.format,
+    };
+    for (int r = 0; r < head.height; ++r) {
+        int dy = y + r;
+        bool visible = dy >= self->clip_y0 && dy < self->clip_y1;
+        if (direct && visible) {
+            image_read(stream, &((uint8_t*)self->buf)[(x + dy * self->stride) * bpp], head.width * bpp);
+            fbi_skip(stream, row_len - head.width * bpp);
+            dirty_add(self, x, dy, x + head.width, dy + 1);
+            stats_pixels(head.width);
+        } else if (direct) {
+            fbi_skip(stream, row_len);
+        } else {
+            image_read(stream, row, row_len);
+            if (visible) {
+                mp_uint_t t0 = stats_start();
+                blit_rect(self, x, dy, &src, 0, 0, head.width, 1, -1, lut);
+                stats_add(&loader_stats.blit_us, t0);
+                stats_pixels(head.width);
+            }
+        }
+    }
+    if (row != NULL) {
+        m_del(uint8_t, row, row_len);
+    }
+}
+
+// loadfbi(file[, x, y[, palette]]): draw an .fbi image with its top left
+// corner at (x, y).  Images in the framebuffer's own format are read
+// directly into it; indexed images drawn into an RGB565 framebuffer use
+// their palette, and palette receives the image palette as for loadbmp().
+STATIC mp_obj_t framebuf_loadfbi(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t x = 0;
+    mp_int_t y = 0;
+    if (n_args > 2) {
+        x = mp_obj_get_int(args[2]);
+        y = mp_obj_get_int(args[3]);
+    }
+    bool opened;
+    mp_obj_t stream = image_open(args[1], &opened);
+    mp_uint_t t0 = stats_start();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        fbi_draw(self, stream, x, y, n_args > 4 ? args[4] : mp_const_none);
+        nlr_pop();
+        stats_add(&loader_stats.total_us, t0);
+    } else {
+        if (opened) {
+            mp_stream_close(stream);
+        }
+        nlr_jump(nlr.ret_val);
+    }
+    if (opened) {
+        mp_stream_close(stream);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_loadfbi_obj, 2, 5, framebuf_loadfbi);
+
+#if MICROPY_PY_UZLIB
+// The compressed stream is read through a buffer; decomp must come first
+// so the uzlib read callback can find the rest of the state.
+typedef struct _inflate_reader_t {
+    TINF_DATA decomp;
+    mp_obj_t stream;
+    uint8_t buf[256];
+} inflate_reader_t;
+
+STATIC int inflate_read_src(TINF_DATA *data) {
+    inflate_reader_t *rd = (inflate_reader_t*)data;
+    int errcode;
+    mp_uint_t t0 = stats_start();
+    mp_uint_t n = mp_stream_rw(rd->stream, rd->buf, sizeof(rd->buf), &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+    stats_add(&loader_stats.io_us, t0);
+    loader_stats.bytes += n;
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    if (n == 0) {
+        return -1;
+    }
+    rd->decomp.source = rd->buf + 1;
+    rd->decomp.source_limit = rd->buf + n;
+    return rd->buf[0];
+}
+
+STATIC mp_int_t inflate_into(mp_obj_framebuf_t *self, mp_obj_t stream, mp_int_t wbits) {
+    inflate_reader_t *rd = m_new_obj(inflate_reader_t);
+    memset(&rd->decomp, 0, sizeof(rd->decomp));
+    rd->decomp.readSource = inflate_read_src;
+    rd->stream = stream;
+
+    int st = 0;
+    if (wbits >= 16) {
+        st = uzlib_gzip_parse_header(&rd->decomp);
+    } else if (wbits >= 0) {
+        st = uzlib_zlib_parse_header(&rd->decomp);
+    }
+    if (st < 0) {
+        mp_raise_ValueError("compression header");
+    }
+
+    // The framebuffer itself is the window for back references, as the
+    // output is written to it in order, so no dictionary is needed.
+    mp_buffer_info_t bufinfo;
+    framebuf_get_buffer(MP_OBJ_FROM_PTR(self), &bufinfo, MP_BUFFER_WRITE);
+    uzlib_uncompress_init(&rd->decomp, NULL, 0);
+    rd->decomp.destStart = bufinfo.buf;
+    rd->decomp.dest = bufinfo.buf;
+    rd->decomp.dest_limit = (byte*)bufinfo.buf + bufinfo.len;
+    st = uzlib_uncompress_chksum(&rd->decomp);
+    mp_int_t n = rd->decomp.dest - (byte*)bufinfo.buf;
+    m_del_obj(inflate_reader_t, rd);
+    if (st < 0) {
+        mp_raise_ValueError("corrupt compressed data");
+    }
+    dirty_add(self, 0, 0, self->width, self->height);
+    if (bufinfo.len) {
+        stats_pixels((uint64_t)n * self->width * self->height / bufinfo.len);
+    }
+    return n;
+}
+
+// load_deflated(file[, wbits]): inflate a compressed stream of raw pixels,
+// laid out as in the framebuffer, straight into the buffer.  wbits selects
+// the header as for uzlib.DecompIO: zlib by default, gzip if 16 or more,
+// none (raw deflate) if negative.  Returns the number of bytes written,
+// which is less than the buffer size if the stream ends early.
+STATIC mp_obj_t framebuf_load_deflated(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t wbits = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
+    bool opened;
+    mp_obj_t stream = image_open(args[1], &opened);
+    mp_int_t n;
+    mp_uint_t t0 = stats_start();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        n = inflate_into(self, stream, wbits);
+        nlr_pop();
+        stats_add(&loader_stats.total_us, t0);
+    } else {
+        if (opened) {
+            mp_stream_close(stream);
+        }
+        nlr_jump(nlr.ret_val);
+    }
+    if (opened) {
+        mp_stream_close(stream);
+    }
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_load_deflated_obj, 2, 3, framebuf_load_deflated);
+#endif // MICROPY_PY_UZLIB
+#endif // MICROPY_PY_IO
+
+// Draw the pixels of a circle outline for octant points (a..b, y) as spans,
+// along with the points mirrored into the other seven octants.
+STATIC void circle_runs(mp_obj_framebuf_t *fb, int x0, int y0, int a, int b, int y, uint32_t col) {
+    hspan(fb, x0 + a, x0 + b, y0 + y, col);
+    hspan(fb, x0 - b, x0 - a, y0 + y, col);
+    hspan(fb, x0 + a, x0 + b, y0 - y, col);
+    hspan(fb, x0 - b, x0 - a, y0 - y, col);
+    vspan(fb, x0 + y, y0 + a, y0 + b, col);
+    vspan(fb, x0 - y, y0 + a, y0 + b, col);
+    vspan(fb, x0 + y, y0 - b, y0 - a, col);
+    vspan(fb, x0 - y, y0 - b, y0 - a, col);
+}
+
+STATIC mp_obj_t framebuf_circle(size_t n_args, const mp_obj_t *args) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
     mp_int_t x0 = mp_obj_get_int(args[1]);
     mp_int_t y0 = mp_obj_get_int(args[2]);
-    mp_int_t x1 = mp_obj_get_int(args[3]);
-    mp_int_t y1 = mp_obj_get_int(args[4]);
-    mp_int_t x2 = mp_obj_get_int(args[5]);
-    mp_int_t y2 = mp_obj_get_int(args[6]);
-    mp_int_t col = mp_obj_get_int(args[7]);
-    
+    mp_int_t r = mp_obj_get_int(args[3]);
+    mp_int_t col = mp_obj_get_int(args[4]);
     mp_int_t fill = 0;
-    if (n_args == 9){
-        fill = mp_obj_get_int(args[8]);
-    }
-
-    if (fill){
-        int16_t a, b, y, last;
-        if (y0 > y1) {
-            swap(y0, y1); swap(x0, x1);
-        }
-        if (y1 > y2) {
-            swap(y2, y1); swap(x2, x1);
-        }
-        if (y0 > y1) {
-            swap(y0, y1); swap(x0, x1);
-        }
-        if(y0 == y2) { // Handle awkward all-on-same-line case as its own thing
-            a = b = x0;
-            if(x1 < a)      a = x1;
-            else if(x1 > b) b = x1;
-            if(x2 < a)      a = x2;
-            else if(x2 > b) b = x2;
-            fill_rect(self, a, y0, b-a+1, 1, col);
-            return mp_const_none;
-        }
-        int16_t dx01 = x1 - x0;
-        int16_t dy01 = y1 - y0;
-        int16_t dx02 = x2 - x0;
-        int16_t dy02 = y2 - y0;
-        int16_t dx12 = x2 - x1;
-        int16_t dy12 = y2 - y1;
-        if (dy01 == 0) dy01 = 1;
-        if (dy02 == 0) dy02 = 1;
-        if (dy12 == 0) dy12 = 1;
-        int16_t sa = 0, sb = 0;
-        if (y1 == y2){
-            last = y1;
+    if (n_args == 6){
+        fill = mp_obj_get_int(args[5]);
+    }
+    if (r < 0 || x0 + r < self->clip_x0 || y0 + r < self->clip_y0 || x0 - r >= self->clip_x1 || y0 - r >= self->clip_y1) {
+        // nothing visible
+        return mp_const_none;
+    }
+    // midpoint circle over the octant from (0, r) to the diagonal; a run
+    // of points with the same y is drawn when y is about to change
+    int f = 1 - r;
+    int ddF_x = 1;
+    int ddF_y = -2 * r;
+    int x = 0;
+    int y = r;
+    int run_start = 0;
+    if (fill) {
+        hspan(self, x0 - r, x0 + r, y0, col);
+    }
+    while (x < y) {
+        if (f >= 0) {
+            if (fill) {
+                // rows y0 +/- y are complete, they span -x..x
+                hspan(self, x0 - x, x0 + x, y0 + y, col);
+                hspan(self, x0 - x, x0 + x, y0 - y, col);
+            } else {
+                circle_runs(self, x0, y0, run_start, x, y, col);
+            }
+            y--;
+            ddF_y += 2;
+            f += ddF_y;
+            run_start = x + 1;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        if (fill) {
+            hspan(self, x0 - y, x0 + y, y0 + x, col);
+            hspan(self, x0 - y, x0 + y, y0 - x, col);
+        }
+    }
+    if (fill) {
+        hspan(self, x0 - x, x0 + x, y0 + y, col);
+        hspan(self, x0 - x, x0 + x, y0 - y, col);
+    } else {
+        circle_runs(self, x0, y0, run_start, x, y, col);
+    }
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_circle_obj, 5, 6, framebuf_circle);
+
+// Scanline filling shared by poly, traingle, ellipse and round_rect
+
+// Fill the polygon with the n vertices (vx[i], vy[i]) using the even-odd
+// rule, one span per pair of edge crossings in each visible row, and draw its
+// outline so the edges are part of the shape.
+STATIC void fill_polygon(const mp_obj_framebuf_t *fb, size_t n, const mp_int_t *vx, const mp_int_t *vy, uint32_t col) {
+    mp_int_t ymin = vy[0], ymax = vy[0];
+    for (size_t i = 1; i < n; ++i) {
+        ymin = MIN(ymin, vy[i]);
+        ymax = MAX(ymax, vy[i]);
+    }
+    ymin = MAX(ymin, fb->clip_y0);
+    ymax = MIN(ymax, fb->clip_y1 - 1);
+
+    // a row crosses at most n edges
+    mp_int_t nodes_buf[16];
+    mp_int_t *nodes = n <= MP_ARRAY_SIZE(nodes_buf) ? nodes_buf : m_new(mp_int_t, n);
+    for (mp_int_t y = ymin; y <= ymax; ++y) {
+        size_t nnodes = 0;
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            mp_int_t y1 = vy[i], y2 = vy[j];
+            // half-open in y so a vertex shared by two edges counts once
+            if ((y1 <= y && y < y2) || (y2 <= y && y < y1)) {
+                mp_int_t x1 = vx[i], x2 = vx[j];
+                mp_int_t x = x1 + ((x2 - x1) * (y - y1) * 2 + (y2 - y1)) / ((y2 - y1) * 2);
+                // insertion sort as the crossings are found
+                size_t k = nnodes++;
+                for (; k > 0 && nodes[k - 1] > x; --k) {
+                    nodes[k] = nodes[k - 1];
+                }
+                nodes[k] = x;
+            }
+        }
+        for (size_t k = 0; k + 1 < nnodes; k += 2) {
+            hspan(fb, nodes[k], nodes[k + 1], y, col);
+        }
+    }
+    if (nodes != nodes_buf) {
+        m_del(mp_int_t, nodes, n);
+    }
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+        drawLine((mp_obj_framebuf_t*)fb, vx[j], vy[j], vx[i], vy[i], col);
+    }
+}
+
+// Extents of row i of a shape, as the first and last pixel of the row.
+typedef void (*row_extent_t)(const void *ctx, int i, int *l, int *r);
+
+// Draw a shape of nrows rows starting at y0 given by the extents of each of
+// its rows, which must be convex along each row.  When not filled, each
+// side of a row is drawn from its end to where the narrower of the rows above
+// and below starts, which joins up the outline.
+STATIC void draw_rows(const mp_obj_framebuf_t *fb, int y0, int nrows, row_extent_t extent, const void *ctx, uint32_t col, bool fill) {
+    int i0 = MAX(0, fb->clip_y0 - y0 - 1);
+    int i1 = MIN(nrows, fb->clip_y1 - y0 + 1);
+    int l, r, pl = 0, pr = 0, nl, nr;
+    if (i0 < i1) {
+        extent(ctx, i0, &l, &r);
+        if (i0 > 0) {
+            extent(ctx, i0 - 1, &pl, &pr);
+        }
+    }
+    for (int i = i0; i < i1; ++i) {
+        int y = y0 + i;
+        bool last = i + 1 == nrows;
+        if (!last) {
+            extent(ctx, i + 1, &nl, &nr);
+        }
+        if (fill || i == 0 || last) {
+            hspan(fb, l, r, y, col);
         } else {
-            last = y1 - 1;
-        }
-        y = y0;
-        for (;y<last+1;y++){
-            a = x0 + sa / dy01;
-            b = x0 + sb / dy02;
-            sa += dx01;
-            sb += dx02;
-            if(a > b){
-                swap(a,b);
+            // extend each end towards the narrower neighbour row
+            int el = MIN(r, MAX(l, MAX(pl, nl) - 1));
+            int er = MAX(el + 1, MIN(r, MIN(pr, nr) + 1));
+            hspan(fb, l, el, y, col);
+            if (er <= r) {
+                hspan(fb, er, r, y, col);
             }
-            fill_rect(self, a, y, b-a+1, 1, col);
-        }
-        sa = dx12 * (y - y1);
-        sb = dx02 * (y - y0);
-        while(y <= y2){
-            a = x1 + sa / dy12;
-            b = x0 + sb / dy02;
-            sa += dx12;
-            sb += dx02;
-            if (a > b) swap(a, b);
-            fill_rect(self, a, y, b-a+1, 1, col);
-            y += 1;
         }
+        pl = l;
+        pr = r;
+        l = nl;
+        r = nr;
+    }
+}
+
+// Integer square root, rounded to nearest.
+STATIC mp_int_t fb_isqrt(uint64_t v) {
+    uint64_t x = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (v >= x + bit) {
+            v -= x + bit;
+            x = (x >> 1) + bit;
+        } else {
+            x >>= 1;
+        }
+        bit >>= 2;
+    }
+    return x + (v > x);
+}
+
+typedef struct _ellipse_t {
+    mp_int_t cx, xr, yr;
+} ellipse_t;
+
+STATIC void ellipse_extent(const void *ctx, int i, int *l, int *r) {
+    const ellipse_t *e = ctx;
+    mp_int_t dy = i - e->yr;
+    mp_int_t dx = e->yr == 0 ? e->xr : fb_isqrt((uint64_t)e->xr * e->xr * (e->yr * e->yr - dy * dy) / (e->yr * e->yr));
+    *l = e->cx - dx;
+    *r = e->cx + dx;
+}
+
+typedef struct _round_rect_t {
+    mp_int_t x, w, h, r;
+} round_rect_t;
+
+STATIC void round_rect_extent(const void *ctx, int i, int *l, int *r) {
+    const round_rect_t *rr = ctx;
+    // distance into the top or bottom corner rows
+    mp_int_t d = MIN(i, rr->h - 1 - i);
+    mp_int_t inset = 0;
+    if (d < rr->r) {
+        mp_int_t dy = rr->r - d;
+        inset = rr->r - fb_isqrt((uint64_t)(rr->r * rr->r - dy * dy));
+    }
+    *l = rr->x + inset;
+    *r = rr->x + rr->w - 1 - inset;
+}
+
+// poly(x, y, coords, col[, fill]): coords is an array of x, y vertex pairs,
+// relative to (x, y)
+STATIC mp_obj_t framebuf_poly(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t x = mp_obj_get_int(args[1]);
+    mp_int_t y = mp_obj_get_int(args[2]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[3], &bufinfo, MP_BUFFER_READ);
+    mp_int_t col = mp_obj_get_int(args[4]);
+    bool fill = n_args > 5 && mp_obj_is_true(args[5]);
+
+    size_t n = bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL) / 2;
+    if (n == 0) {
+        return mp_const_none;
+    }
+    mp_int_t v_buf[32];
+    mp_int_t *v = 2 * n <= MP_ARRAY_SIZE(v_buf) ? v_buf : m_new(mp_int_t, 2 * n);
+    mp_int_t *vx = v, *vy = v + n;
+    for (size_t i = 0; i < n; ++i) {
+        vx[i] = x + mp_obj_get_int(mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, 2 * i));
+        vy[i] = y + mp_obj_get_int(mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, 2 * i + 1));
+    }
+    if (fill) {
+        fill_polygon(self, n, vx, vy, col);
+    } else {
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            drawLine(self, vx[j], vy[j], vx[i], vy[i], col);
+        }
+    }
+    if (v != v_buf) {
+        m_del(mp_int_t, v, 2 * n);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_poly_obj, 5, 6, framebuf_poly);
+
+STATIC mp_obj_t framebuf_ellipse(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t cy = mp_obj_get_int(args[2]);
+    ellipse_t e = { mp_obj_get_int(args[1]), mp_obj_get_int(args[3]), mp_obj_get_int(args[4]) };
+    mp_int_t col = mp_obj_get_int(args[5]);
+    bool fill = n_args > 6 && mp_obj_is_true(args[6]);
+    if (e.xr < 0 || e.yr < 0) {
+        mp_raise_ValueError(NULL);
+    }
+    draw_rows(self, cy - e.yr, 2 * e.yr + 1, ellipse_extent, &e, col, fill);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_ellipse_obj, 6, 7, framebuf_ellipse);
+
+STATIC mp_obj_t framebuf_round_rect(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t y = mp_obj_get_int(args[2]);
+    round_rect_t rr = { mp_obj_get_int(args[1]), mp_obj_get_int(args[3]), mp_obj_get_int(args[4]), mp_obj_get_int(args[5]) };
+    mp_int_t col = mp_obj_get_int(args[6]);
+    bool fill = n_args > 7 && mp_obj_is_true(args[7]);
+    if (rr.w <= 0 || rr.h <= 0) {
+        return mp_const_none;
+    }
+    // the corners can at most meet in the middle
+    rr.r = MAX(0, MIN(rr.r, MIN((rr.w - 1) / 2, (rr.h - 1) / 2)));
+    draw_rows(self, y, rr.h, round_rect_extent, &rr, col, fill);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_round_rect_obj, 7, 8, framebuf_round_rect);
+
+STATIC mp_obj_t framebuf_traingle(size_t n_args, const mp_obj_t *args) {
+    // fb, x0, y0, x1, y1, x2, y2, color, fill?
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t vx[3] = { mp_obj_get_int(args[1]), mp_obj_get_int(args[3]), mp_obj_get_int(args[5]) };
+    mp_int_t vy[3] = { mp_obj_get_int(args[2]), mp_obj_get_int(args[4]), mp_obj_get_int(args[6]) };
+    mp_int_t col = mp_obj_get_int(args[7]);
+    bool fill = n_args == 9 && mp_obj_is_true(args[8]);
+
+    if (fill) {
+        fill_polygon(self, 3, vx, vy, col);
     } else {
-        drawLine(self, x0, y0, x1, y1, col);
-        drawLine(self, x1, y1, x2, y2, col);
-        drawLine(self, x2, y2, x0, y0, col);
+        drawLine(self, vx[0], vy[0], vx[1], vy[1], col);
+        drawLine(self, vx[1], vy[1], vx[2], vy[2], col);
+        drawLine(self, vx[2], vy[2], vx[0], vy[0], col);
     }
     return mp_const_none;
 }
@@ -1370,17 +3722,35 @@ STATIC const mp_rom_map_elem_t framebuf_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_fill), MP_ROM_PTR(&framebuf_fill_obj) },
     { MP_ROM_QSTR(MP_QSTR_fill_rect), MP_ROM_PTR(&framebuf_fill_rect_obj) },
     { MP_ROM_QSTR(MP_QSTR_pixel), MP_ROM_PTR(&framebuf_pixel_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clip), MP_ROM_PTR(&framebuf_clip_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dirty), MP_ROM_PTR(&framebuf_dirty_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dirty_reset), MP_ROM_PTR(&framebuf_dirty_reset_obj) },
     { MP_ROM_QSTR(MP_QSTR_hline), MP_ROM_PTR(&framebuf_hline_obj) },
     { MP_ROM_QSTR(MP_QSTR_vline), MP_ROM_PTR(&framebuf_vline_obj) },
     { MP_ROM_QSTR(MP_QSTR_rect), MP_ROM_PTR(&framebuf_rect_obj) },
     { MP_ROM_QSTR(MP_QSTR_line), MP_ROM_PTR(&framebuf_line_obj) },
     { MP_ROM_QSTR(MP_QSTR_blit), MP_ROM_PTR(&framebuf_blit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_blit_scaled), MP_ROM_PTR(&framebuf_blit_scaled_obj) },
+    #if MICROPY_PY_BUILTINS_FLOAT
+    { MP_ROM_QSTR(MP_QSTR_blit_rotated), MP_ROM_PTR(&framebuf_blit_rotated_obj) },
+    #endif
+    { MP_ROM_QSTR(MP_QSTR_draw_tilemap), MP_ROM_PTR(&framebuf_draw_tilemap_obj) },
     { MP_ROM_QSTR(MP_QSTR_scroll), MP_ROM_PTR(&framebuf_scroll_obj) },
     { MP_ROM_QSTR(MP_QSTR_text), MP_ROM_PTR(&framebuf_text_obj) },
+    #if MICROPY_PY_IO
     { MP_ROM_QSTR(MP_QSTR_loadbmp), MP_ROM_PTR(&framebuf_loadbmp_obj) },
     { MP_ROM_QSTR(MP_QSTR_loadgif), MP_ROM_PTR(&framebuf_loadgif_obj) },
+    { MP_ROM_QSTR(MP_QSTR_loadjpeg), MP_ROM_PTR(&framebuf_loadjpeg_obj) },
+    { MP_ROM_QSTR(MP_QSTR_loadfbi), MP_ROM_PTR(&framebuf_loadfbi_obj) },
+    #if MICROPY_PY_UZLIB
+    { MP_ROM_QSTR(MP_QSTR_load_deflated), MP_ROM_PTR(&framebuf_load_deflated_obj) },
+    #endif
+    #endif
     { MP_ROM_QSTR(MP_QSTR_circle), MP_ROM_PTR(&framebuf_circle_obj) },
     { MP_ROM_QSTR(MP_QSTR_traingle), MP_ROM_PTR(&framebuf_traingle_obj) },
+    { MP_ROM_QSTR(MP_QSTR_poly), MP_ROM_PTR(&framebuf_poly_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ellipse), MP_ROM_PTR(&framebuf_ellipse_obj) },
+    { MP_ROM_QSTR(MP_QSTR_round_rect), MP_ROM_PTR(&framebuf_round_rect_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(framebuf_locals_dict, framebuf_locals_dict_table);
 
@@ -1392,6 +3762,355 @@ STATIC const mp_obj_type_t mp_type_framebuf = {
     .locals_dict = (mp_obj_dict_t*)&framebuf_locals_dict,
 };
 
+#if MICROPY_PY_MACHINE_DISPLAY
+
+// Compositor: draws an ordered list of layers, each a FrameBuffer, Sprite or
+// TileMap, straight to a display without a framebuffer for the whole screen.
+// The screen is divided into square tiles.  Moving a layer or changing its
+// image damages the tiles it covered and now covers, drawing on a FrameBuffer
+// layer damages the tiles under its dirty box, and update() redraws only the
+// damaged tiles.  Each run of damaged tiles in a row of tiles is composed
+// into one of two strip buffers, and sent through the display protocol while
+// the next run is composed into the other.
+
+typedef struct _compositor_layer_t {
+    mp_obj_t obj; // FrameBuffer, Sprite or TileMap
+    uint16_t *lut; // colours for the pixel values of obj, or NULL
+    mp_int_t key;
+    int16_t x, y; // position, or scroll position of a TileMap
+    bool visible;
+} compositor_layer_t;
+
+typedef struct _mp_obj_compositor_t {
+    mp_obj_base_t base;
+    mp_obj_t display;
+    const mp_machine_display_p_t *display_p;
+    uint16_t width, height;
+    uint16_t tile;
+    uint16_t cols, rows;
+    uint32_t bg;
+    uint16_t nlayers, max_layers;
+    compositor_layer_t *layers;
+    uint8_t *damage; // cols x rows, non-zero for a tile to redraw
+    uint16_t *strip[2]; // width x tile pixels each
+} mp_obj_compositor_t;
+
+// Damage the tiles under a rectangle of the screen.
+STATIC void compositor_damage_rect(mp_obj_compositor_t *self, int x, int y, int w, int h) {
+    int x1 = MIN(x + w, self->width);
+    int y1 = MIN(y + h, self->height);
+    x = MAX(x, 0);
+    y = MAX(y, 0);
+    if (x >= x1 || y >= y1) {
+        return;
+    }
+    int c0 = x / self->tile;
+    int c1 = (x1 - 1) / self->tile;
+    for (int r = y / self->tile; r <= (y1 - 1) / self->tile; ++r) {
+        memset(&self->damage[r * self->cols + c0], 1, c1 - c0 + 1);
+    }
+}
+
+// Damage the tiles a visible layer covers; a TileMap covers the whole screen.
+STATIC void compositor_damage_layer(mp_obj_compositor_t *self, const compositor_layer_t *layer) {
+    if (!layer->visible) {
+        return;
+    }
+    if (mp_obj_is_type(layer->obj, &mp_type_tilemap)) {
+        compositor_damage_rect(self, 0, 0, self->width, self->height);
+    } else if (mp_obj_is_type(layer->obj, &mp_type_sprite)) {
+        const mp_obj_sprite_t *spr = MP_OBJ_TO_PTR(layer->obj);
+        compositor_damage_rect(self, layer->x, layer->y, spr->width, spr->height);
+    } else {
+        const mp_obj_framebuf_t *fb = MP_OBJ_TO_PTR(layer->obj);
+        compositor_damage_rect(self, layer->x, layer->y, fb->width, fb->height);
+    }
+}
+
+STATIC mp_obj_t compositor_check_image(mp_obj_t obj) {
+    if (!mp_obj_is_type(obj, &mp_type_framebuf) && !mp_obj_is_type(obj, &mp_type_sprite)
+        && !mp_obj_is_type(obj, &mp_type_tilemap)) {
+        mp_raise_TypeError(NULL);
+    }
+    return obj;
+}
+
+STATIC compositor_layer_t *compositor_get_layer(mp_obj_compositor_t *self, mp_obj_t index_in) {
+    mp_int_t i = mp_obj_get_int(index_in);
+    if (i < 0 || i >= self->nlayers) {
+        mp_raise_msg(&mp_type_IndexError, "layer index out of range");
+    }
+    return &self->layers[i];
+}
+
+// Compose the w x h rectangle of the screen at (x, y) into buf.  RGB565
+// framebuffers hold pixels in the byte order they are sent to the display.
+STATIC void compositor_compose(const mp_obj_compositor_t *self, uint16_t *buf, int x, int y, int w, int h) {
+    mp_obj_framebuf_t strip;
+    strip.base.type = &mp_type_framebuf;
+    strip.buf_obj = MP_OBJ_NULL;
+    strip.buf = buf;
+    strip.width = w;
+    strip.height = h;
+    strip.stride = w;
+    strip.format = FRAMEBUF_RGB565;
+    framebuf_init_state(&strip);
+    formats[FRAMEBUF_RGB565].fill_rect(&strip, 0, 0, w, h, self->bg);
+    for (size_t i = 0; i < self->nlayers; ++i) {
+        const compositor_layer_t *layer = &self->layers[i];
+        if (!layer->visible) {
+            continue;
+        }
+        if (mp_obj_is_type(layer->obj, &mp_type_sprite)) {
+            sprite_blit(&strip, MP_OBJ_TO_PTR(layer->obj), layer->x - x, layer->y - y, layer->lut);
+        } else if (mp_obj_is_type(layer->obj, &mp_type_tilemap)) {
+            draw_tilemap(&strip, MP_OBJ_TO_PTR(layer->obj), layer->x + x, layer->y + y, layer->key, layer->lut);
+        } else {
+            const mp_obj_framebuf_t *source = MP_OBJ_TO_PTR(layer->obj);
+            blit_rect(&strip, layer->x - x, layer->y - y, source, 0, 0, source->width, source->height,
+                layer->key, layer->lut);
+        }
+    }
+}
+
+// Compositor(display, width, height, *, tile=8, bg=0, layers=8): draw to
+// display, a width x height screen such as pyb.SCREEN.  bg is the colour
+// under the layers, as for fill(), and layers the most that can be added.
+STATIC mp_obj_t compositor_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_display, ARG_width, ARG_height, ARG_tile, ARG_bg, ARG_layers };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_display, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_width, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_height, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_tile, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8} },
+        { MP_QSTR_bg, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_layers, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t width = args[ARG_width].u_int;
+    mp_int_t height = args[ARG_height].u_int;
+    mp_int_t tile = args[ARG_tile].u_int;
+    mp_int_t max_layers = args[ARG_layers].u_int;
+    if (width <= 0 || height <= 0 || width > 0xffff || height > 0xffff
+        || tile <= 0 || tile > 0xff || max_layers <= 0 || max_layers > 0xffff) {
+        mp_raise_ValueError(NULL);
+    }
+
+    mp_obj_compositor_t *o = m_new_obj(mp_obj_compositor_t);
+    o->base.type = type;
+    o->display = args[ARG_display].u_obj;
+    o->display_p = mp_machine_display_get(o->display);
+    o->width = width;
+    o->height = height;
+    o->tile = tile;
+    o->cols = (width + tile - 1) / tile;
+    o->rows = (height + tile - 1) / tile;
+    o->bg = args[ARG_bg].u_int;
+    o->nlayers = 0;
+    o->max_layers = max_layers;
+    o->layers = m_new0(compositor_layer_t, max_layers);
+    o->damage = m_new(uint8_t, o->cols * o->rows);
+    o->strip[0] = m_new(uint16_t, width * tile);
+    o->strip[1] = m_new(uint16_t, width * tile);
+    // nothing has been drawn yet
+    memset(o->damage, 1, o->cols * o->rows);
+    return MP_OBJ_FROM_PTR(o);
+}
+
+// layer(image, x=0, y=0, key=-1, palette=None): add a layer on top of the
+// others and return its index.  image is a FrameBuffer, Sprite or TileMap,
+// and for a TileMap (x, y) is the map position at the top left of the
+// screen.  key and palette are as for blit(); the palette is read now.
+STATIC mp_obj_t compositor_layer(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_image, ARG_x, ARG_y, ARG_key, ARG_palette };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_image, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_x, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_y, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_key, MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_palette, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+    };
+    mp_obj_compositor_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (self->nlayers == self->max_layers) {
+        mp_raise_ValueError("too many layers");
+    }
+    mp_obj_t palette = args[ARG_palette].u_obj;
+    if (palette != mp_const_none && !mp_obj_is_type(palette, &mp_type_framebuf)) {
+        mp_raise_TypeError(NULL);
+    }
+    compositor_layer_t *layer = &self->layers[self->nlayers];
+    layer->obj = compositor_check_image(args[ARG_image].u_obj);
+    layer->lut = palette != mp_const_none ? (uint16_t*)blit_lut(palette, m_new(uint16_t, 256)) : NULL;
+    layer->key = args[ARG_key].u_int;
+    layer->x = args[ARG_x].u_int;
+    layer->y = args[ARG_y].u_int;
+    layer->visible = true;
+    compositor_damage_layer(self, layer);
+    return MP_OBJ_NEW_SMALL_INT(self->nlayers++);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(compositor_layer_obj, 2, compositor_layer);
+
+// move(i, x, y): move layer i, or scroll it if it's a TileMap.
+STATIC mp_obj_t compositor_move(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_compositor_t *self = MP_OBJ_TO_PTR(args[0]);
+    compositor_layer_t *layer = compositor_get_layer(self, args[1]);
+    mp_int_t x = mp_obj_get_int(args[2]);
+    mp_int_t y = mp_obj_get_int(args[3]);
+    if (x != layer->x || y != layer->y) {
+        compositor_damage_layer(self, layer);
+        layer->x = x;
+        layer->y = y;
+        compositor_damage_layer(self, layer);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(compositor_move_obj, 4, 4, compositor_move);
+
+// image(i, image): change the image of layer i, for example to the next
+// frame of an animated sprite.
+STATIC mp_obj_t compositor_image(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t image_in) {
+    mp_obj_compositor_t *self = MP_OBJ_TO_PTR(self_in);
+    compositor_layer_t *layer = compositor_get_layer(self, index_in);
+    compositor_check_image(image_in);
+    if (image_in != layer->obj) {
+        compositor_damage_layer(self, layer);
+        layer->obj = image_in;
+        compositor_damage_layer(self, layer);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(compositor_image_obj, compositor_image);
+
+// visible(i, flag): show or hide layer i.
+STATIC mp_obj_t compositor_visible(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t flag_in) {
+    mp_obj_compositor_t *self = MP_OBJ_TO_PTR(self_in);
+    compositor_layer_t *layer = compositor_get_layer(self, index_in);
+    bool visible = mp_obj_is_true(flag_in);
+    if (visible != layer->visible) {
+        layer->visible = true;
+        compositor_damage_layer(self, layer);
+        layer->visible = visible;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(compositor_visible_obj, compositor_visible);
+
+// damage([x, y, w, h]): redraw a rectangle of the screen, or all of it, at
+// the next update(), for changes the compositor can't see such as to the
+// map of a TileMap or the pixels of a sheet.
+STATIC mp_obj_t compositor_damage(size_t n_args, const mp_obj_t *args) {
+    mp_obj_compositor_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 1) {
+        compositor_damage_rect(self, 0, 0, self->width, self->height);
+    } else if (n_args == 5) {
+        compositor_damage_rect(self, mp_obj_get_int(args[1]), mp_obj_get_int(args[2]),
+            mp_obj_get_int(args[3]), mp_obj_get_int(args[4]));
+    } else {
+        mp_raise_TypeError(NULL);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(compositor_damage_obj, 1, 5, compositor_damage);
+
+// update(): redraw the damaged tiles on the display, and return how many
+// there were.
+STATIC mp_obj_t compositor_update(mp_obj_t self_in) {
+    mp_obj_compositor_t *self = MP_OBJ_TO_PTR(self_in);
+    const mp_machine_display_p_t *p = self->display_p;
+    void *display = MP_OBJ_TO_PTR(self->display);
+
+    // pick up what was drawn on the FrameBuffer layers since the last update
+    for (size_t i = 0; i < self->nlayers; ++i) {
+        compositor_layer_t *layer = &self->layers[i];
+        if (!mp_obj_is_type(layer->obj, &mp_type_framebuf)) {
+            continue;
+        }
+        mp_obj_framebuf_t *fb = MP_OBJ_TO_PTR(layer->obj);
+        if (layer->visible && fb->dirty_x1 > fb->dirty_x0) {
+            compositor_damage_rect(self, layer->x + fb->dirty_x0, layer->y + fb->dirty_y0,
+                fb->dirty_x1 - fb->dirty_x0, fb->dirty_y1 - fb->dirty_y0);
+        }
+        fb->dirty_x0 = fb->dirty_y0 = fb->dirty_x1 = fb->dirty_y1 = 0;
+    }
+
+    int err = 0;
+    bool pending = false;
+    uint cur = 0;
+    mp_int_t ntiles = 0;
+    int tile = self->tile;
+    for (int r = 0; r < self->rows && err == 0; ++r) {
+        uint8_t *damage = &self->damage[r * self->cols];
+        for (int c = 0; c < self->cols && err == 0;) {
+            if (!damage[c]) {
+                ++c;
+                continue;
+            }
+            int c0 = c;
+            for (; c < self->cols && damage[c]; ++c) {
+                damage[c] = 0;
+            }
+            ntiles += c - c0;
+            int x = c0 * tile;
+            int y = r * tile;
+            int w = MIN(c * tile, self->width) - x;
+            int h = MIN(y + tile, self->height) - y;
+            compositor_compose(self, self->strip[cur], x, y, w, h);
+            // the previous run was being sent while this one was composed
+            if (pending && p->flush != NULL) {
+                err = p->flush(display);
+            }
+            pending = false;
+            if (err == 0) {
+                p->window(display, x, y, w, h);
+                err = p->write(display, self->strip[cur], w * h);
+                pending = true;
+                cur ^= 1;
+            }
+        }
+    }
+    if (pending && p->flush != NULL) {
+        int flush_err = p->flush(display);
+        if (err == 0) {
+            err = flush_err;
+        }
+    }
+    if (ntiles > 0 && p->present != NULL) {
+        p->present(display);
+    }
+    if (err != 0) {
+        // the screen is in an unknown state, so redraw all of it next time
+        compositor_damage_rect(self, 0, 0, self->width, self->height);
+        mp_raise_OSError(MP_EIO);
+    }
+    return MP_OBJ_NEW_SMALL_INT(ntiles);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(compositor_update_obj, compositor_update);
+
+STATIC const mp_rom_map_elem_t compositor_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_layer), MP_ROM_PTR(&compositor_layer_obj) },
+    { MP_ROM_QSTR(MP_QSTR_move), MP_ROM_PTR(&compositor_move_obj) },
+    { MP_ROM_QSTR(MP_QSTR_image), MP_ROM_PTR(&compositor_image_obj) },
+    { MP_ROM_QSTR(MP_QSTR_visible), MP_ROM_PTR(&compositor_visible_obj) },
+    { MP_ROM_QSTR(MP_QSTR_damage), MP_ROM_PTR(&compositor_damage_obj) },
+    { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&compositor_update_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(compositor_locals_dict, compositor_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_compositor = {
+    { &mp_type_type },
+    .name = MP_QSTR_Compositor,
+    .make_new = compositor_make_new,
+    .locals_dict = (mp_obj_dict_t*)&compositor_locals_dict,
+};
+
+#endif // MICROPY_PY_MACHINE_DISPLAY
+
 // this factory function is provided for backwards compatibility with old FrameBuffer1 class
 STATIC mp_obj_t legacy_framebuffer1(size_t n_args, const mp_obj_t *args) {
     mp_obj_framebuf_t *o = m_new_obj(mp_obj_framebuf_t);
@@ -1409,6 +4128,7 @@ STATIC mp_obj_t legacy_framebuffer1(size_t n_args, const mp_obj_t *args) {
     } else {
         o->stride = o->width;
     }
+    framebuf_init_state(o);
 
     return MP_OBJ_FROM_PTR(o);
 }
@@ -1418,6 +4138,17 @@ STATIC const mp_rom_map_elem_t framebuf_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_framebuf) },
     { MP_ROM_QSTR(MP_QSTR_FrameBuffer), MP_ROM_PTR(&mp_type_framebuf) },
     { MP_ROM_QSTR(MP_QSTR_FrameBuffer1), MP_ROM_PTR(&legacy_framebuffer1_obj) },
+    { MP_ROM_QSTR(MP_QSTR_TileMap), MP_ROM_PTR(&mp_type_tilemap) },
+    { MP_ROM_QSTR(MP_QSTR_Sprite), MP_ROM_PTR(&mp_type_sprite) },
+    #if MICROPY_PY_MACHINE_DISPLAY
+    { MP_ROM_QSTR(MP_QSTR_Compositor), MP_ROM_PTR(&mp_type_compositor) },
+    #endif
+    #if MICROPY_PY_IO
+    { MP_ROM_QSTR(MP_QSTR_GIF), MP_ROM_PTR(&mp_type_gif) },
+    { MP_ROM_QSTR(MP_QSTR_GIFCache), MP_ROM_PTR(&mp_type_gifcache) },
+    { MP_ROM_QSTR(MP_QSTR_load), MP_ROM_PTR(&framebuf_load_obj) },
+    { MP_ROM_QSTR(MP_QSTR_loader_stats), MP_ROM_PTR(&framebuf_loader_stats_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_MVLSB), MP_ROM_INT(FRAMEBUF_MVLSB) },
     { MP_ROM_QSTR(MP_QSTR_MONO_VLSB), MP_ROM_INT(FRAMEBUF_MVLSB) },
     { MP_ROM_QSTR(MP_QSTR_RGB565), MP_ROM_INT(FRAMEBUF_RGB565) },
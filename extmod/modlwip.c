@@ -310,6 +310,10 @@ typedef struct _lwip_socket_obj_t {
     #define STATE_PEER_CLOSED 4
     // Negative value is lwIP error
     int8_t state;
+
+    #if MICROPY_PY_USELECT_NOTIFY
+    struct _poll_obj_t *poll_notify;
+    #endif
 } lwip_socket_obj_t;
 
 static inline void poll_sockets(void) {
@@ -362,6 +366,18 @@ static inline void exec_user_callback(lwip_socket_obj_t *socket) {
     }
 }
 
+// Tell a poll object that is waiting on the socket that its state changed
+static inline void lwip_socket_notify(lwip_socket_obj_t *socket, mp_uint_t events) {
+    #if MICROPY_PY_USELECT_NOTIFY
+    if (socket->poll_notify != NULL) {
+        mp_poll_notify(socket->poll_notify, events);
+    }
+    #else
+    (void)socket;
+    (void)events;
+    #endif
+}
+
 #if MICROPY_PY_LWIP_SOCK_RAW
 // Callback for incoming raw packets.
 #if LWIP_VERSION_MAJOR < 2
@@ -377,6 +393,7 @@ STATIC u8_t _lwip_raw_incoming(void *arg, struct raw_pcb *pcb, struct pbuf *p, c
     } else {
         socket->incoming.pbuf = p;
         memcpy(&socket->peer, addr, sizeof(socket->peer));
+        lwip_socket_notify(socket, MP_STREAM_POLL_RD);
     }
     return 1; // we ate the packet
 }
@@ -399,6 +416,7 @@ STATIC void _lwip_udp_incoming(void *arg, struct udp_pcb *upcb, struct pbuf *p,
         socket->incoming.pbuf = p;
         socket->peer_port = (mp_uint_t)port;
         memcpy(&socket->peer, addr, sizeof(socket->peer));
+        lwip_socket_notify(socket, MP_STREAM_POLL_RD);
     }
 }
 
@@ -412,6 +430,7 @@ STATIC void _lwip_tcp_error(void *arg, err_t err) {
     socket->state = err;
     // If we got here, the lwIP stack either has deallocated or will deallocate the pcb.
     socket->pcb.tcp = NULL;
+    lwip_socket_notify(socket, MP_STREAM_POLL_RD | MP_STREAM_POLL_WR | MP_STREAM_POLL_ERR | MP_STREAM_POLL_HUP);
 }
 
 // Callback for tcp connection requests. Error code err is unused. (See tcp.h)
@@ -419,9 +438,18 @@ STATIC err_t _lwip_tcp_connected(void *arg, struct tcp_pcb *tpcb, err_t err) {
     lwip_socket_obj_t *socket = (lwip_socket_obj_t*)arg;
 
     socket->state = STATE_CONNECTED;
+    lwip_socket_notify(socket, MP_STREAM_POLL_WR);
     return ERR_OK;
 }
 
+#if MICROPY_PY_USELECT_NOTIFY
+// Callback for sent data being acknowledged, which frees space in the send buffer.
+STATIC err_t _lwip_tcp_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    lwip_socket_notify((lwip_socket_obj_t*)arg, MP_STREAM_POLL_WR);
+    return ERR_OK;
+}
+#endif
+
 // Handle errors (eg connection aborted) on TCP PCBs that have been put on the
 // accept queue but are not yet actually accepted.
 STATIC void _lwip_tcp_err_unaccepted(void *arg, err_t err) {
@@ -489,6 +517,7 @@ STATIC err_t _lwip_tcp_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
 
         // Schedule user accept callback
         exec_user_callback(socket);
+        lwip_socket_notify(socket, MP_STREAM_POLL_RD);
 
         // Set the error callback to handle the case of a dropped connection before we
         // have a chance to take it off the accept queue.
@@ -514,6 +543,7 @@ STATIC err_t _lwip_tcp_recv(void *arg, struct tcp_pcb *tcpb, struct pbuf *p, err
         DEBUG_printf("_lwip_tcp_recv[%p]: other side closed connection\n", socket);
         socket->state = STATE_PEER_CLOSED;
         exec_user_callback(socket);
+        lwip_socket_notify(socket, MP_STREAM_POLL_RD | MP_STREAM_POLL_WR);
         return ERR_OK;
     }
 
@@ -528,6 +558,7 @@ STATIC err_t _lwip_tcp_recv(void *arg, struct tcp_pcb *tcpb, struct pbuf *p, err
     }
 
     exec_user_callback(socket);
+    lwip_socket_notify(socket, MP_STREAM_POLL_RD);
 
     return ERR_OK;
 }
@@ -765,32 +796,35 @@ STATIC mp_uint_t lwip_tcp_receive(lwip_socket_obj_t *socket, byte *buf, mp_uint_
 
     assert(socket->pcb.tcp != NULL);
 
+    // Copy from as many of the queued pbufs as the buffer has room for
     struct pbuf *p = socket->incoming.pbuf;
-
-    mp_uint_t remaining = p->len - socket->recv_offset;
-    if (len > remaining) {
-        len = remaining;
-    }
-
-    memcpy(buf, (byte*)p->payload + socket->recv_offset, len);
-
-    remaining -= len;
-    if (remaining == 0) {
-        socket->incoming.pbuf = p->next;
-        // If we don't ref here, free() will free the entire chain,
-        // if we ref, it does what we need: frees 1st buf, and decrements
-        // next buf's refcount back to 1.
-        pbuf_ref(p->next);
-        pbuf_free(p);
-        socket->recv_offset = 0;
-    } else {
-        socket->recv_offset += len;
+    mp_uint_t total = 0;
+    while (p != NULL && total < len) {
+        mp_uint_t remaining = p->len - socket->recv_offset;
+        mp_uint_t n = MIN(remaining, len - total);
+
+        memcpy(buf + total, (byte*)p->payload + socket->recv_offset, n);
+        total += n;
+
+        if (n == remaining) {
+            struct pbuf *next = p->next;
+            // If we don't ref here, free() will free the entire chain,
+            // if we ref, it does what we need: frees 1st buf, and decrements
+            // next buf's refcount back to 1.
+            pbuf_ref(next);
+            pbuf_free(p);
+            socket->recv_offset = 0;
+            p = next;
+        } else {
+            socket->recv_offset += n;
+        }
+        tcp_recved(socket->pcb.tcp, n);
     }
-    tcp_recved(socket->pcb.tcp, len);
+    socket->incoming.pbuf = p;
 
     MICROPY_PY_LWIP_EXIT
 
-    return len;
+    return total;
 }
 
 /*******************************************************************************/
@@ -813,6 +847,9 @@ STATIC mp_obj_t lwip_socket_make_new(const mp_obj_type_t *type, size_t n_args, s
     socket->domain = MOD_NETWORK_AF_INET;
     socket->type = MOD_NETWORK_SOCK_STREAM;
     socket->callback = MP_OBJ_NULL;
+    #if MICROPY_PY_USELECT_NOTIFY
+    socket->poll_notify = NULL;
+    #endif
     if (n_args >= 1) {
         socket->domain = mp_obj_get_int(args[0]);
         if (n_args >= 2) {
@@ -1013,6 +1050,10 @@ STATIC mp_obj_t lwip_socket_accept(mp_obj_t self_in) {
     tcp_arg(socket2->pcb.tcp, (void*)socket2);
     tcp_err(socket2->pcb.tcp, _lwip_tcp_error);
     tcp_recv(socket2->pcb.tcp, _lwip_tcp_recv);
+    #if MICROPY_PY_USELECT_NOTIFY
+    socket2->poll_notify = NULL;
+    tcp_sent(socket2->pcb.tcp, _lwip_tcp_sent);
+    #endif
 
     tcp_accepted(listener);
 
@@ -1058,6 +1099,9 @@ STATIC mp_obj_t lwip_socket_connect(mp_obj_t self_in, mp_obj_t addr_in) {
             // Register our receive callback.
             MICROPY_PY_LWIP_ENTER
             tcp_recv(socket->pcb.tcp, _lwip_tcp_recv);
+            #if MICROPY_PY_USELECT_NOTIFY
+            tcp_sent(socket->pcb.tcp, _lwip_tcp_sent);
+            #endif
             socket->state = STATE_CONNECTING;
             err = tcp_connect(socket->pcb.tcp, &dest, port, _lwip_tcp_connected);
             if (err != ERR_OK) {
@@ -1149,33 +1193,41 @@ STATIC mp_obj_t lwip_socket_send(mp_obj_t self_in, mp_obj_t buf_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(lwip_socket_send_obj, lwip_socket_send);
 
-STATIC mp_obj_t lwip_socket_recv(mp_obj_t self_in, mp_obj_t len_in) {
-    lwip_socket_obj_t *socket = MP_OBJ_TO_PTR(self_in);
+// Helper function for recv/recv_into
+STATIC mp_uint_t lwip_socket_receive(lwip_socket_obj_t *socket, byte *buf, mp_uint_t len) {
     int _errno;
 
     lwip_socket_check_connected(socket);
 
-    mp_int_t len = mp_obj_get_int(len_in);
-    vstr_t vstr;
-    vstr_init_len(&vstr, len);
-
     mp_uint_t ret = 0;
     switch (socket->type) {
         case MOD_NETWORK_SOCK_STREAM: {
-            ret = lwip_tcp_receive(socket, (byte*)vstr.buf, len, &_errno);
+            ret = lwip_tcp_receive(socket, buf, len, &_errno);
             break;
         }
         case MOD_NETWORK_SOCK_DGRAM:
         #if MICROPY_PY_LWIP_SOCK_RAW
         case MOD_NETWORK_SOCK_RAW:
         #endif
-            ret = lwip_raw_udp_receive(socket, (byte*)vstr.buf, len, NULL, NULL, &_errno);
+            ret = lwip_raw_udp_receive(socket, buf, len, NULL, NULL, &_errno);
             break;
     }
     if (ret == -1) {
         mp_raise_OSError(_errno);
     }
 
+    return ret;
+}
+
+STATIC mp_obj_t lwip_socket_recv(mp_obj_t self_in, mp_obj_t len_in) {
+    lwip_socket_obj_t *socket = MP_OBJ_TO_PTR(self_in);
+
+    mp_int_t len = mp_obj_get_int(len_in);
+    vstr_t vstr;
+    vstr_init_len(&vstr, len);
+
+    mp_uint_t ret = lwip_socket_receive(socket, (byte*)vstr.buf, len);
+
     if (ret == 0) {
         return mp_const_empty_bytes;
     }
@@ -1184,6 +1236,28 @@ STATIC mp_obj_t lwip_socket_recv(mp_obj_t self_in, mp_obj_t len_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(lwip_socket_recv_obj, lwip_socket_recv);
 
+// Receive straight into a caller-supplied buffer, so nothing is allocated
+STATIC mp_obj_t lwip_socket_recv_into(size_t n_args, const mp_obj_t *args) {
+    lwip_socket_obj_t *socket = MP_OBJ_TO_PTR(args[0]);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+
+    mp_uint_t len = bufinfo.len;
+    if (n_args > 2) {
+        mp_int_t n = mp_obj_get_int(args[2]);
+        if (n < 0 || (mp_uint_t)n > len) {
+            mp_raise_ValueError("nbytes out of range");
+        }
+        if (n > 0) {
+            len = n;
+        }
+    }
+
+    return mp_obj_new_int_from_uint(lwip_socket_receive(socket, bufinfo.buf, len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lwip_socket_recv_into_obj, 2, 3, lwip_socket_recv_into);
+
 STATIC mp_obj_t lwip_socket_sendto(mp_obj_t self_in, mp_obj_t data_in, mp_obj_t addr_in) {
     lwip_socket_obj_t *socket = MP_OBJ_TO_PTR(self_in);
     int _errno;
@@ -1483,6 +1557,17 @@ STATIC mp_uint_t lwip_socket_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_
             ret |= flags & MP_STREAM_POLL_ERR;
         }
 
+    #if MICROPY_PY_USELECT_NOTIFY
+    } else if (request == MP_STREAM_POLL_NOTIFY) {
+        if (arg != 0 && socket->poll_notify != NULL) {
+            MICROPY_PY_LWIP_EXIT
+            *errcode = MP_EBUSY;
+            return MP_STREAM_ERROR;
+        }
+        socket->poll_notify = (struct _poll_obj_t*)arg;
+        ret = MP_STREAM_POLL_RD | MP_STREAM_POLL_WR | MP_STREAM_POLL_ERR | MP_STREAM_POLL_HUP;
+    #endif
+
     } else if (request == MP_STREAM_CLOSE) {
         if (socket->pcb.tcp == NULL) {
             MICROPY_PY_LWIP_EXIT
@@ -1493,6 +1578,9 @@ STATIC mp_uint_t lwip_socket_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_
         tcp_arg(socket->pcb.tcp, NULL);
         tcp_err(socket->pcb.tcp, NULL);
         tcp_recv(socket->pcb.tcp, NULL);
+        #if MICROPY_PY_USELECT_NOTIFY
+        tcp_sent(socket->pcb.tcp, NULL);
+        #endif
 
         // Free any incoming buffers or connections that are stored
         lwip_socket_free_incoming(socket);
@@ -1519,6 +1607,7 @@ STATIC mp_uint_t lwip_socket_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_
 
         socket->pcb.tcp = NULL;
         socket->state = _ERR_BADF;
+        lwip_socket_notify(socket, MP_STREAM_POLL_RD | MP_STREAM_POLL_WR | MP_STREAM_POLL_ERR | MP_STREAM_POLL_HUP);
         ret = 0;
 
     } else {
@@ -1540,6 +1629,7 @@ STATIC const mp_rom_map_elem_t lwip_socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_connect), MP_ROM_PTR(&lwip_socket_connect_obj) },
     { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&lwip_socket_send_obj) },
     { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&lwip_socket_recv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv_into), MP_ROM_PTR(&lwip_socket_recv_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_sendto), MP_ROM_PTR(&lwip_socket_sendto_obj) },
     { MP_ROM_QSTR(MP_QSTR_recvfrom), MP_ROM_PTR(&lwip_socket_recvfrom_obj) },
     { MP_ROM_QSTR(MP_QSTR_sendall), MP_ROM_PTR(&lwip_socket_sendall_obj) },
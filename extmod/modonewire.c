@@ -68,6 +68,9 @@ STATIC int onewire_bus_readbit(mp_hal_pin_obj_t pin) {
     return value;
 }
 
+// Only a 1 needs exact timing, its low pulse must end within 15us.  A 0 is
+// held low for 60-120us, so an interrupt during the rest of the slot only
+// stretches it a little, and interrupts are left on for that part.
 STATIC void onewire_bus_writebit(mp_hal_pin_obj_t pin, int value) {
     uint32_t i = mp_hal_quiet_timing_enter();
     mp_hal_pin_write(pin, 0);
@@ -75,10 +78,10 @@ STATIC void onewire_bus_writebit(mp_hal_pin_obj_t pin, int value) {
     if (value) {
         mp_hal_pin_write(pin, 1);
     }
+    mp_hal_quiet_timing_exit(i);
     mp_hal_delay_us_fast(TIMING_WRITE2);
     mp_hal_pin_write(pin, 1);
     mp_hal_delay_us_fast(TIMING_WRITE3);
-    mp_hal_quiet_timing_exit(i);
 }
 
 /******************************************************************************/
@@ -0,0 +1,454 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/smallint.h"
+#include "py/objgenerator.h"
+#include "py/stream.h"
+#include "py/mphal.h"
+#include "extmod/modutimeq.h"
+
+#if MICROPY_PY_UASYNCIO
+
+// A native core for cooperative tasks.  Tasks are generators (or async def
+// coroutines) resumed directly with mp_obj_gen_resume.  What a task yields
+// tells the loop what to do with it next:
+//   None         run it again after the other runnable tasks
+//   an int       sleep that many milliseconds
+//   False        park it; something else must create_task it again
+//   a generator  start that as a new task, and run this one again
+//   loop.sleep_ms(t), loop.wait_read(obj), loop.wait_write(obj)
+//                sleep, or wait for obj to be ready through uselect.poll
+// Runnable tasks are in a fixed ring, sleeping ones in a utimeq and ones
+// waiting on I/O in a fixed table, so switching tasks doesn't allocate.
+
+#define TICKS_PERIOD (MICROPY_PY_UTIME_TICKS_PERIOD)
+#define TICKS_MASK (MICROPY_PY_UTIME_TICKS_PERIOD - 1)
+
+enum {
+    SYSCALL_NONE,
+    SYSCALL_SLEEP,
+    SYSCALL_READ,
+    SYSCALL_WRITE,
+};
+
+// The object returned by sleep_ms and friends.  Awaiting it yields it to
+// the loop once, which then reads the request out of it.  Each loop has one,
+// which is safe because a task yields it straight after filling it in.
+typedef struct _uasyncio_syscall_t {
+    mp_obj_base_t base;
+    uint8_t kind;
+    bool armed;
+    mp_int_t ms;
+    mp_obj_t obj;
+} uasyncio_syscall_t;
+
+typedef struct _uasyncio_io_t {
+    mp_obj_t obj;
+    mp_obj_t coro;
+    mp_uint_t flags;
+} uasyncio_io_t;
+
+typedef struct _mp_obj_uasyncio_loop_t {
+    mp_obj_base_t base;
+    bool stopped;
+    uint16_t runq_alloc;
+    uint16_t runq_head;
+    uint16_t runq_len;
+    uint16_t io_alloc;
+    uint16_t io_len;
+    mp_obj_t *runq;
+    mp_obj_t timeq;
+    uasyncio_io_t *io;
+    mp_obj_t poll; // uselect.poll, made on the first I/O wait
+    mp_obj_t main; // task run_until_complete is waiting for
+    mp_obj_t main_ret;
+    uasyncio_syscall_t *syscall;
+} mp_obj_uasyncio_loop_t;
+
+STATIC mp_obj_t uasyncio_syscall_iternext(mp_obj_t self_in) {
+    uasyncio_syscall_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->armed) {
+        self->armed = false;
+        return self_in;
+    }
+    return MP_OBJ_STOP_ITERATION;
+}
+
+STATIC const mp_obj_type_t uasyncio_syscall_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_SysCall,
+    .getiter = mp_identity_getiter,
+    .iternext = uasyncio_syscall_iternext,
+};
+
+STATIC mp_int_t ticks_diff(mp_uint_t end, mp_uint_t start) {
+    return ((end - start + TICKS_PERIOD / 2) & TICKS_MASK) - TICKS_PERIOD / 2;
+}
+
+STATIC void loop_runq_push(mp_obj_uasyncio_loop_t *self, mp_obj_t coro) {
+    if (self->runq_len == self->runq_alloc) {
+        mp_raise_msg(&mp_type_IndexError, "queue overflow");
+    }
+    size_t i = self->runq_head + self->runq_len;
+    if (i >= self->runq_alloc) {
+        i -= self->runq_alloc;
+    }
+    self->runq[i] = coro;
+    self->runq_len += 1;
+}
+
+STATIC mp_obj_t loop_runq_pop(mp_obj_uasyncio_loop_t *self) {
+    mp_obj_t coro = self->runq[self->runq_head];
+    self->runq[self->runq_head] = MP_OBJ_NULL; // so we don't retain a pointer
+    if (++self->runq_head == self->runq_alloc) {
+        self->runq_head = 0;
+    }
+    self->runq_len -= 1;
+    return coro;
+}
+
+STATIC void loop_sleep(mp_obj_uasyncio_loop_t *self, mp_obj_t coro, mp_int_t ms) {
+    if (ms <= 0) {
+        loop_runq_push(self, coro);
+        return;
+    }
+    mp_uint_t t = (mp_hal_ticks_ms() + ms) & TICKS_MASK;
+    if (!mp_utimeq_push(self->timeq, t, coro, mp_const_none)) {
+        mp_raise_msg(&mp_type_IndexError, "queue overflow");
+    }
+}
+
+// Tell the poll object what the waiting tasks want from obj
+STATIC void loop_io_update(mp_obj_uasyncio_loop_t *self, mp_obj_t obj) {
+    mp_uint_t flags = 0;
+    for (size_t i = 0; i < self->io_len; ++i) {
+        if (self->io[i].obj == obj && self->io[i].coro != MP_OBJ_NULL) {
+            flags |= self->io[i].flags;
+        }
+    }
+    mp_obj_t dest[4];
+    if (flags != 0) {
+        mp_load_method(self->poll, MP_QSTR_register, dest);
+        dest[2] = obj;
+        dest[3] = MP_OBJ_NEW_SMALL_INT(flags);
+        mp_call_method_n_kw(2, 0, dest);
+    } else {
+        mp_load_method(self->poll, MP_QSTR_unregister, dest);
+        dest[2] = obj;
+        mp_call_method_n_kw(1, 0, dest);
+    }
+}
+
+STATIC void loop_io_wait(mp_obj_uasyncio_loop_t *self, mp_obj_t coro, mp_obj_t obj, mp_uint_t flags) {
+    if (self->io_len == self->io_alloc) {
+        mp_raise_msg(&mp_type_IndexError, "queue overflow");
+    }
+    if (self->poll == MP_OBJ_NULL) {
+        mp_obj_t mod = mp_import_name(MP_QSTR_uselect, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+        self->poll = mp_call_function_0(mp_load_attr(mod, MP_QSTR_poll));
+    }
+    uasyncio_io_t *io = &self->io[self->io_len++];
+    io->obj = obj;
+    io->coro = coro;
+    io->flags = flags;
+    loop_io_update(self, obj);
+}
+
+// Wait up to timeout ms (-1 for no limit) for I/O, and make the tasks whose
+// objects became ready runnable
+STATIC void loop_io_poll(mp_obj_uasyncio_loop_t *self, mp_int_t timeout) {
+    mp_obj_t dest[3];
+    mp_load_method(self->poll, MP_QSTR_ipoll, dest);
+    dest[2] = MP_OBJ_NEW_SMALL_INT(timeout);
+    mp_obj_t iter = mp_getiter(mp_call_method_n_kw(1, 0, dest), NULL);
+    mp_obj_t item;
+    bool any = false;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(item, &len, &items);
+        mp_uint_t ev = mp_obj_get_int(items[1]);
+        if (ev & (MP_STREAM_POLL_ERR | MP_STREAM_POLL_HUP)) {
+            // wake everything waiting on it, so the task sees the error
+            ev |= MP_STREAM_POLL_RD | MP_STREAM_POLL_WR;
+        }
+        for (size_t i = 0; i < self->io_len; ++i) {
+            uasyncio_io_t *io = &self->io[i];
+            if (io->coro != MP_OBJ_NULL && io->obj == items[0] && (io->flags & ev)) {
+                loop_runq_push(self, io->coro);
+                io->coro = MP_OBJ_NULL;
+                any = true;
+            }
+        }
+    }
+    if (!any) {
+        return;
+    }
+    // the poll object is only changed now that its iteration is finished
+    for (size_t i = 0; i < self->io_len;) {
+        if (self->io[i].coro == MP_OBJ_NULL) {
+            mp_obj_t obj = self->io[i].obj;
+            self->io[i] = self->io[--self->io_len];
+            self->io[self->io_len].obj = MP_OBJ_NULL;
+            loop_io_update(self, obj);
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Run coro up to its next yield, and queue it according to what it yielded
+STATIC void loop_step(mp_obj_uasyncio_loop_t *self, mp_obj_t coro) {
+    mp_obj_t ret;
+    mp_vm_return_kind_t kind = mp_obj_gen_resume(coro, mp_const_none, MP_OBJ_NULL, &ret);
+    if (kind == MP_VM_RETURN_NORMAL) {
+        if (coro == self->main) {
+            self->main = MP_OBJ_NULL;
+            self->main_ret = ret;
+            self->stopped = true;
+        }
+        return;
+    } else if (kind == MP_VM_RETURN_EXCEPTION) {
+        nlr_raise(ret);
+    }
+
+    if (ret == mp_const_none) {
+        loop_runq_push(self, coro);
+    } else if (ret == MP_OBJ_FROM_PTR(self->syscall)) {
+        uasyncio_syscall_t *sc = self->syscall;
+        mp_obj_t obj = sc->obj;
+        sc->obj = MP_OBJ_NULL;
+        switch (sc->kind) {
+            case SYSCALL_SLEEP: loop_sleep(self, coro, sc->ms); break;
+            case SYSCALL_READ: loop_io_wait(self, coro, obj, MP_STREAM_POLL_RD); break;
+            default: loop_io_wait(self, coro, obj, MP_STREAM_POLL_WR); break;
+        }
+    } else if (mp_obj_is_small_int(ret)) {
+        loop_sleep(self, coro, MP_OBJ_SMALL_INT_VALUE(ret));
+    } else if (ret == mp_const_false) {
+        // parked
+    } else if (mp_obj_is_type(ret, &mp_type_gen_instance)) {
+        loop_runq_push(self, ret);
+        loop_runq_push(self, coro);
+    } else {
+        mp_raise_TypeError("bad yield");
+    }
+}
+
+STATIC void loop_run(mp_obj_uasyncio_loop_t *self) {
+    self->stopped = false;
+    while (!self->stopped) {
+        // make the tasks whose sleep has ended runnable
+        mp_uint_t now = mp_hal_ticks_ms() & TICKS_MASK;
+        mp_int_t timeout = -1;
+        while (mp_utimeq_len(self->timeq) != 0) {
+            mp_int_t dt = ticks_diff(mp_utimeq_peektime(self->timeq), now);
+            if (dt > 0) {
+                timeout = dt;
+                break;
+            }
+            mp_obj_t coro, args;
+            mp_utimeq_pop(self->timeq, &coro, &args);
+            loop_runq_push(self, coro);
+        }
+
+        if (self->runq_len != 0) {
+            timeout = 0;
+        } else if (timeout < 0 && self->io_len == 0) {
+            // nothing can ever become runnable
+            break;
+        }
+
+        if (self->io_len != 0) {
+            loop_io_poll(self, timeout);
+        } else if (timeout > 0) {
+            mp_hal_delay_ms(timeout);
+            continue;
+        }
+
+        // run the tasks that are runnable now; ones they make runnable wait
+        // for the next pass, after timers and I/O have been checked again
+        for (size_t n = self->runq_len; n != 0 && !self->stopped; --n) {
+            loop_step(self, loop_runq_pop(self));
+        }
+    }
+}
+
+STATIC mp_obj_t uasyncio_loop_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_runq_len, ARG_timeq_len, ARG_ioq_len };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_runq_len, MP_ARG_INT, {.u_int = 16} },
+        { MP_QSTR_timeq_len, MP_ARG_INT, {.u_int = 16} },
+        { MP_QSTR_ioq_len, MP_ARG_INT, {.u_int = 4} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t runq_len = args[ARG_runq_len].u_int;
+    mp_int_t ioq_len = args[ARG_ioq_len].u_int;
+    if (runq_len <= 0 || runq_len > 0xffff || args[ARG_timeq_len].u_int <= 0
+        || ioq_len < 0 || ioq_len > 0xffff) {
+        mp_raise_ValueError(NULL);
+    }
+
+    mp_obj_uasyncio_loop_t *self = m_new_obj(mp_obj_uasyncio_loop_t);
+    self->base.type = type;
+    self->stopped = false;
+    self->runq_alloc = runq_len;
+    self->runq_head = 0;
+    self->runq_len = 0;
+    self->io_alloc = ioq_len;
+    self->io_len = 0;
+    self->runq = m_new0(mp_obj_t, runq_len);
+    self->timeq = mp_utimeq_new(args[ARG_timeq_len].u_int);
+    self->io = m_new0(uasyncio_io_t, ioq_len);
+    self->poll = MP_OBJ_NULL;
+    self->main = MP_OBJ_NULL;
+    self->main_ret = mp_const_none;
+    self->syscall = m_new_obj(uasyncio_syscall_t);
+    self->syscall->base.type = &uasyncio_syscall_type;
+    self->syscall->kind = SYSCALL_NONE;
+    self->syscall->armed = false;
+    self->syscall->obj = MP_OBJ_NULL;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t uasyncio_loop_create_task(mp_obj_t self_in, mp_obj_t coro) {
+    mp_obj_uasyncio_loop_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!mp_obj_is_type(coro, &mp_type_gen_instance)) {
+        mp_raise_TypeError("expecting a coroutine");
+    }
+    loop_runq_push(self, coro);
+    return coro;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uasyncio_loop_create_task_obj, uasyncio_loop_create_task);
+
+STATIC mp_obj_t uasyncio_loop_call_later_ms(mp_obj_t self_in, mp_obj_t delay_in, mp_obj_t coro) {
+    mp_obj_uasyncio_loop_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!mp_obj_is_type(coro, &mp_type_gen_instance)) {
+        mp_raise_TypeError("expecting a coroutine");
+    }
+    loop_sleep(self, coro, mp_obj_get_int(delay_in));
+    return coro;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(uasyncio_loop_call_later_ms_obj, uasyncio_loop_call_later_ms);
+
+STATIC mp_obj_t uasyncio_loop_run_forever(mp_obj_t self_in) {
+    loop_run(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uasyncio_loop_run_forever_obj, uasyncio_loop_run_forever);
+
+STATIC mp_obj_t uasyncio_loop_run_until_complete(mp_obj_t self_in, mp_obj_t coro) {
+    mp_obj_uasyncio_loop_t *self = MP_OBJ_TO_PTR(self_in);
+    uasyncio_loop_create_task(self_in, coro);
+    self->main = coro;
+    self->main_ret = mp_const_none;
+    loop_run(self);
+    self->main = MP_OBJ_NULL;
+    mp_obj_t ret = self->main_ret;
+    self->main_ret = mp_const_none;
+    return ret;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uasyncio_loop_run_until_complete_obj, uasyncio_loop_run_until_complete);
+
+STATIC mp_obj_t uasyncio_loop_stop(mp_obj_t self_in) {
+    mp_obj_uasyncio_loop_t *self = MP_OBJ_TO_PTR(self_in);
+    self->stopped = true;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uasyncio_loop_stop_obj, uasyncio_loop_stop);
+
+STATIC mp_obj_t uasyncio_loop_syscall(mp_obj_t self_in, uint8_t kind, mp_int_t ms, mp_obj_t obj) {
+    mp_obj_uasyncio_loop_t *self = MP_OBJ_TO_PTR(self_in);
+    uasyncio_syscall_t *sc = self->syscall;
+    sc->kind = kind;
+    sc->armed = true;
+    sc->ms = ms;
+    sc->obj = obj;
+    return MP_OBJ_FROM_PTR(sc);
+}
+
+STATIC mp_obj_t uasyncio_loop_sleep_ms(mp_obj_t self_in, mp_obj_t ms_in) {
+    return uasyncio_loop_syscall(self_in, SYSCALL_SLEEP, mp_obj_get_int(ms_in), MP_OBJ_NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uasyncio_loop_sleep_ms_obj, uasyncio_loop_sleep_ms);
+
+#if MICROPY_PY_BUILTINS_FLOAT
+STATIC mp_obj_t uasyncio_loop_sleep(mp_obj_t self_in, mp_obj_t s_in) {
+    return uasyncio_loop_syscall(self_in, SYSCALL_SLEEP, 1000 * mp_obj_get_float(s_in), MP_OBJ_NULL);
+}
+#else
+STATIC mp_obj_t uasyncio_loop_sleep(mp_obj_t self_in, mp_obj_t s_in) {
+    return uasyncio_loop_syscall(self_in, SYSCALL_SLEEP, 1000 * mp_obj_get_int(s_in), MP_OBJ_NULL);
+}
+#endif
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uasyncio_loop_sleep_obj, uasyncio_loop_sleep);
+
+STATIC mp_obj_t uasyncio_loop_wait_read(mp_obj_t self_in, mp_obj_t obj) {
+    return uasyncio_loop_syscall(self_in, SYSCALL_READ, 0, obj);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uasyncio_loop_wait_read_obj, uasyncio_loop_wait_read);
+
+STATIC mp_obj_t uasyncio_loop_wait_write(mp_obj_t self_in, mp_obj_t obj) {
+    return uasyncio_loop_syscall(self_in, SYSCALL_WRITE, 0, obj);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uasyncio_loop_wait_write_obj, uasyncio_loop_wait_write);
+
+STATIC const mp_rom_map_elem_t uasyncio_loop_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_create_task), MP_ROM_PTR(&uasyncio_loop_create_task_obj) },
+    { MP_ROM_QSTR(MP_QSTR_call_later_ms), MP_ROM_PTR(&uasyncio_loop_call_later_ms_obj) },
+    { MP_ROM_QSTR(MP_QSTR_run_forever), MP_ROM_PTR(&uasyncio_loop_run_forever_obj) },
+    { MP_ROM_QSTR(MP_QSTR_run_until_complete), MP_ROM_PTR(&uasyncio_loop_run_until_complete_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&uasyncio_loop_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sleep), MP_ROM_PTR(&uasyncio_loop_sleep_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sleep_ms), MP_ROM_PTR(&uasyncio_loop_sleep_ms_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait_read), MP_ROM_PTR(&uasyncio_loop_wait_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait_write), MP_ROM_PTR(&uasyncio_loop_wait_write_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(uasyncio_loop_locals_dict, uasyncio_loop_locals_dict_table);
+
+STATIC const mp_obj_type_t uasyncio_loop_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Loop,
+    .make_new = uasyncio_loop_make_new,
+    .locals_dict = (void*)&uasyncio_loop_locals_dict,
+};
+
+STATIC const mp_rom_map_elem_t mp_module_uasyncio_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR__uasyncio) },
+    { MP_ROM_QSTR(MP_QSTR_Loop), MP_ROM_PTR(&uasyncio_loop_type) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_uasyncio_globals, mp_module_uasyncio_globals_table);
+
+const mp_obj_module_t mp_module_uasyncio = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&mp_module_uasyncio_globals,
+};
+
+#endif // MICROPY_PY_UASYNCIO
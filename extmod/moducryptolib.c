@@ -79,6 +79,13 @@ struct mbedtls_aes_ctx_with_key {
 #define AES_CTX_IMPL struct mbedtls_aes_ctx_with_key
 #endif
 
+#if !MICROPY_SSL_AXTLS && !MICROPY_SSL_MBEDTLS
+// without an SSL library use the built-in AES
+#include "crypto-algorithms/aes.h"
+
+#define AES_CTX_IMPL aes_ctx_t
+#endif
+
 typedef struct _mp_obj_aes_t {
     mp_obj_base_t base;
     AES_CTX_IMPL ctx;
@@ -140,32 +147,6 @@ STATIC void aes_process_cbc_impl(AES_CTX_IMPL *ctx, const uint8_t *in, uint8_t *
     }
 }
 
-#if MICROPY_PY_UCRYPTOLIB_CTR
-// axTLS doesn't have CTR support out of the box. This implements the counter part using the ECB primitive.
-STATIC void aes_process_ctr_impl(AES_CTX_IMPL *ctx, const uint8_t *in, uint8_t *out, size_t in_len, struct ctr_params *ctr_params) {
-    size_t n = ctr_params->offset;
-    uint8_t *const counter = ctx->iv;
-
-    while (in_len--) {
-        if (n == 0) {
-            aes_process_ecb_impl(ctx, counter, ctr_params->encrypted_counter, true);
-
-            // increment the 128-bit counter
-            for (int i = 15; i >= 0; --i) {
-                if (++counter[i] != 0) {
-                    break;
-                }
-            }
-        }
-
-        *out++ = *in++ ^ ctr_params->encrypted_counter[n];
-        n = (n + 1) & 0xf;
-    }
-
-    ctr_params->offset = n;
-}
-#endif
-
 #endif
 
 #if MICROPY_SSL_MBEDTLS
@@ -211,6 +192,89 @@ STATIC void aes_process_ctr_impl(AES_CTX_IMPL *ctx, const uint8_t *in, uint8_t *
 
 #endif
 
+#if !MICROPY_SSL_AXTLS && !MICROPY_SSL_MBEDTLS
+#include "crypto-algorithms/aes.c"
+
+STATIC void aes_initial_set_key_impl(AES_CTX_IMPL *ctx, const uint8_t *key, size_t keysize, const uint8_t iv[16]) {
+    assert(16 == keysize || 32 == keysize);
+    aes_set_key(ctx, key, keysize, iv);
+}
+
+STATIC void aes_final_set_key_impl(AES_CTX_IMPL *ctx, bool encrypt) {
+    if (!encrypt) {
+        aes_convert_key(ctx);
+    }
+}
+
+STATIC void aes_process_ecb_impl(AES_CTX_IMPL *ctx, const uint8_t in[16], uint8_t out[16], bool encrypt) {
+    if (encrypt) {
+        aes_encrypt_block(ctx, in, out);
+    } else {
+        aes_decrypt_block(ctx, in, out);
+    }
+}
+
+// in and out may be the same buffer
+STATIC void aes_process_cbc_impl(AES_CTX_IMPL *ctx, const uint8_t *in, uint8_t *out, size_t in_len, bool encrypt) {
+    uint8_t block[16];
+    for (; in_len >= 16; in_len -= 16, in += 16, out += 16) {
+        if (encrypt) {
+            for (int i = 0; i < 16; ++i) {
+                block[i] = in[i] ^ ctx->iv[i];
+            }
+            aes_encrypt_block(ctx, block, out);
+            memcpy(ctx->iv, out, 16);
+        } else {
+            aes_decrypt_block(ctx, in, block);
+            for (int i = 0; i < 16; ++i) {
+                block[i] ^= ctx->iv[i];
+            }
+            memcpy(ctx->iv, in, 16);
+            memcpy(out, block, 16);
+        }
+    }
+}
+#endif
+
+#if MICROPY_PY_UCRYPTOLIB_CTR && !MICROPY_SSL_MBEDTLS
+// axTLS and the built-in AES don't have CTR support, so this implements it
+// using the ECB primitive.  The key stream is XORed in a block at a time, so
+// large buffers go at close to the speed of the cipher.
+STATIC void aes_process_ctr_impl(AES_CTX_IMPL *ctx, const uint8_t *in, uint8_t *out, size_t in_len, struct ctr_params *ctr_params) {
+    size_t n = ctr_params->offset;
+    uint8_t *const counter = ctx->iv;
+    uint8_t *const stream = ctr_params->encrypted_counter;
+
+    // use up the key stream left from the previous call
+    for (; n != 0 && in_len != 0; --in_len) {
+        *out++ = *in++ ^ stream[n];
+        n = (n + 1) & 0xf;
+    }
+
+    while (in_len != 0) {
+        aes_process_ecb_impl(ctx, counter, stream, true);
+
+        // increment the 128-bit counter
+        for (int i = 15; i >= 0; --i) {
+            if (++counter[i] != 0) {
+                break;
+            }
+        }
+
+        size_t len = MIN(in_len, 16);
+        for (size_t i = 0; i < len; ++i) {
+            out[i] = in[i] ^ stream[i];
+        }
+        in += len;
+        out += len;
+        in_len -= len;
+        n = len & 0xf;
+    }
+
+    ctr_params->offset = n;
+}
+#endif
+
 STATIC mp_obj_t ucryptolib_aes_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 2, 3, false);
 
@@ -108,6 +108,7 @@ enum {
 
 // "struct" in uctypes context means "structural", i.e. aggregate, type.
 STATIC const mp_obj_type_t uctypes_struct_type;
+STATIC const mp_obj_type_t uctypes_layout_type;
 
 typedef struct _mp_obj_uctypes_struct_t {
     mp_obj_base_t base;
@@ -116,10 +117,63 @@ typedef struct _mp_obj_uctypes_struct_t {
     uint32_t flags;
 } mp_obj_uctypes_struct_t;
 
+// A structure field, decoded from its descriptor value
+#define FIELD_AGG (0x100) // or'd with the aggregate type
+typedef struct _uctypes_field_t {
+    qstr name;
+    uint16_t type;          // scalar type, or FIELD_AGG | aggregate type
+    uint8_t bit_offset;
+    uint8_t bit_len;
+    mp_uint_t offset;
+    mp_obj_t sub;           // descriptor tuple of an aggregate, else MP_OBJ_NULL
+} uctypes_field_t;
+
+// A structure descriptor compiled by uctypes.compile(), with its fields
+// decoded up front and sorted by name
+typedef struct _mp_obj_uctypes_layout_t {
+    mp_obj_base_t base;
+    size_t n_fields;
+    uctypes_field_t fields[];
+} mp_obj_uctypes_layout_t;
+
 STATIC NORETURN void syntax_error(void) {
     mp_raise_TypeError("syntax error in uctypes descriptor");
 }
 
+STATIC bool uctypes_is_struct_desc(mp_obj_t desc) {
+    return mp_obj_is_type(desc, &mp_type_dict)
+        #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+        || mp_obj_is_type(desc, &mp_type_ordereddict)
+        #endif
+        || mp_obj_is_type(desc, &uctypes_layout_type);
+}
+
+STATIC void uctypes_decode_field(mp_obj_t deref, uctypes_field_t *f) {
+    if (mp_obj_is_small_int(deref)) {
+        mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(deref);
+        f->type = GET_TYPE(offset, VAL_TYPE_BITS);
+        offset &= VALUE_MASK(VAL_TYPE_BITS);
+        f->bit_offset = 0;
+        f->bit_len = 0;
+        if (f->type >= BFUINT8 && f->type <= BFINT32) {
+            f->bit_offset = (offset >> 17) & 31;
+            f->bit_len = (offset >> 22) & 31;
+            offset &= (1 << OFFSET_BITS) - 1;
+        }
+        f->offset = offset;
+        f->sub = MP_OBJ_NULL;
+    } else {
+        if (!mp_obj_is_type(deref, &mp_type_tuple)) {
+            syntax_error();
+        }
+        mp_obj_tuple_t *t = MP_OBJ_TO_PTR(deref);
+        mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(t->items[0]);
+        f->type = FIELD_AGG | GET_TYPE(offset, AGG_TYPE_BITS);
+        f->offset = offset & VALUE_MASK(AGG_TYPE_BITS);
+        f->sub = deref;
+    }
+}
+
 STATIC mp_obj_t uctypes_struct_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 2, 3, false);
     mp_obj_uctypes_struct_t *o = m_new_obj(mp_obj_uctypes_struct_t);
@@ -137,11 +191,7 @@ STATIC void uctypes_struct_print(const mp_print_t *print, mp_obj_t self_in, mp_p
     (void)kind;
     mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
     const char *typen = "unk";
-    if (mp_obj_is_type(self->desc, &mp_type_dict)
-      #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
-        || mp_obj_is_type(self->desc, &mp_type_ordereddict)
-      #endif
-      ) {
+    if (uctypes_is_struct_desc(self->desc)) {
         typen = "STRUCT";
     } else if (mp_obj_is_type(self->desc, &mp_type_tuple)) {
         mp_obj_tuple_t *t = MP_OBJ_TO_PTR(self->desc);
@@ -209,12 +259,22 @@ STATIC mp_uint_t uctypes_struct_agg_size(mp_obj_tuple_t *t, int layout_type, mp_
     return total_size;
 }
 
+// Get the offset of the end of a field
+STATIC mp_uint_t uctypes_field_end(const uctypes_field_t *f, int layout_type, mp_uint_t *max_field_size) {
+    mp_uint_t s;
+    if (f->sub == MP_OBJ_NULL) {
+        s = uctypes_struct_scalar_size(f->type);
+        if (s > *max_field_size) {
+            *max_field_size = s;
+        }
+    } else {
+        s = uctypes_struct_agg_size(MP_OBJ_TO_PTR(f->sub), layout_type, max_field_size);
+    }
+    return f->offset + s;
+}
+
 STATIC mp_uint_t uctypes_struct_size(mp_obj_t desc_in, int layout_type, mp_uint_t *max_field_size) {
-    if (!mp_obj_is_type(desc_in, &mp_type_dict)
-      #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
-        && !mp_obj_is_type(desc_in, &mp_type_ordereddict)
-      #endif
-      ) {
+    if (!uctypes_is_struct_desc(desc_in)) {
         if (mp_obj_is_type(desc_in, &mp_type_tuple)) {
             return uctypes_struct_agg_size((mp_obj_tuple_t*)MP_OBJ_TO_PTR(desc_in), layout_type, max_field_size);
         } else if (mp_obj_is_small_int(desc_in)) {
@@ -227,36 +287,25 @@ STATIC mp_uint_t uctypes_struct_size(mp_obj_t desc_in, int layout_type, mp_uint_
         syntax_error();
     }
 
-    mp_obj_dict_t *d = MP_OBJ_TO_PTR(desc_in);
     mp_uint_t total_size = 0;
 
-    for (mp_uint_t i = 0; i < d->map.alloc; i++) {
-        if (mp_map_slot_is_filled(&d->map, i)) {
-            mp_obj_t v = d->map.table[i].value;
-            if (mp_obj_is_small_int(v)) {
-                mp_uint_t offset = MP_OBJ_SMALL_INT_VALUE(v);
-                mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
-                offset &= VALUE_MASK(VAL_TYPE_BITS);
-                if (val_type >= BFUINT8 && val_type <= BFINT32) {
-                    offset &= (1 << OFFSET_BITS) - 1;
-                }
-                mp_uint_t s = uctypes_struct_scalar_size(val_type);
-                if (s > *max_field_size) {
-                    *max_field_size = s;
-                }
-                if (offset + s > total_size) {
-                    total_size = offset + s;
-                }
-            } else {
-                if (!mp_obj_is_type(v, &mp_type_tuple)) {
-                    syntax_error();
-                }
-                mp_obj_tuple_t *t = MP_OBJ_TO_PTR(v);
-                mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(t->items[0]);
-                offset &= VALUE_MASK(AGG_TYPE_BITS);
-                mp_uint_t s = uctypes_struct_agg_size(t, layout_type, max_field_size);
-                if (offset + s > total_size) {
-                    total_size = offset + s;
+    if (mp_obj_is_type(desc_in, &uctypes_layout_type)) {
+        mp_obj_uctypes_layout_t *layout = MP_OBJ_TO_PTR(desc_in);
+        for (size_t i = 0; i < layout->n_fields; i++) {
+            mp_uint_t end = uctypes_field_end(&layout->fields[i], layout_type, max_field_size);
+            if (end > total_size) {
+                total_size = end;
+            }
+        }
+    } else {
+        mp_obj_dict_t *d = MP_OBJ_TO_PTR(desc_in);
+        for (mp_uint_t i = 0; i < d->map.alloc; i++) {
+            if (mp_map_slot_is_filled(&d->map, i)) {
+                uctypes_field_t f;
+                uctypes_decode_field(d->map.table[i].value, &f);
+                mp_uint_t end = uctypes_field_end(&f, layout_type, max_field_size);
+                if (end > total_size) {
+                    total_size = end;
                 }
             }
         }
@@ -403,26 +452,12 @@ STATIC void set_aligned(uint val_type, void *p, mp_int_t index, mp_obj_t val) {
     }
 }
 
-STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
-    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
-
-    if (!mp_obj_is_type(self->desc, &mp_type_dict)
-      #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
-        && !mp_obj_is_type(self->desc, &mp_type_ordereddict)
-      #endif
-      ) {
-            mp_raise_TypeError("struct: no fields");
-    }
-
-    mp_obj_t deref = mp_obj_dict_get(self->desc, MP_OBJ_NEW_QSTR(attr));
-    if (mp_obj_is_small_int(deref)) {
-        mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(deref);
-        mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
-        offset &= VALUE_MASK(VAL_TYPE_BITS);
-//printf("scalar type=%d offset=%x\n", val_type, offset);
+STATIC mp_obj_t uctypes_struct_field_op(mp_obj_uctypes_struct_t *self, const uctypes_field_t *f, mp_obj_t set_val) {
+    mp_uint_t val_type = f->type;
+    mp_uint_t offset = f->offset;
 
+    if (f->sub == MP_OBJ_NULL) {
         if (val_type <= INT64 || val_type == FLOAT32 || val_type == FLOAT64) {
-//            printf("size=%d\n", GET_SCALAR_SIZE(val_type));
             if (self->flags == LAYOUT_NATIVE) {
                 if (set_val == MP_OBJ_NULL) {
                     return get_aligned(val_type, self->addr + offset, 0);
@@ -439,9 +474,8 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
                 }
             }
         } else if (val_type >= BFUINT8 && val_type <= BFINT32) {
-            uint bit_offset = (offset >> 17) & 31;
-            uint bit_len = (offset >> 22) & 31;
-            offset &= (1 << 17) - 1;
+            uint bit_offset = f->bit_offset;
+            uint bit_len = f->bit_len;
             mp_uint_t val;
             if (self->flags == LAYOUT_NATIVE) {
                 val = get_aligned_basic(val_type & 6, self->addr + offset);
@@ -476,22 +510,14 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
         return MP_OBJ_NULL;
     }
 
-    if (!mp_obj_is_type(deref, &mp_type_tuple)) {
-        syntax_error();
-    }
-
     if (set_val != MP_OBJ_NULL) {
         // Cannot assign to aggregate
         syntax_error();
     }
 
-    mp_obj_tuple_t *sub = MP_OBJ_TO_PTR(deref);
-    mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(sub->items[0]);
-    mp_uint_t agg_type = GET_TYPE(offset, AGG_TYPE_BITS);
-    offset &= VALUE_MASK(AGG_TYPE_BITS);
-//printf("agg type=%d offset=%x\n", agg_type, offset);
+    mp_obj_tuple_t *sub = MP_OBJ_TO_PTR(f->sub);
 
-    switch (agg_type) {
+    switch (val_type & ~FIELD_AGG) {
         case STRUCT: {
             mp_obj_uctypes_struct_t *o = m_new_obj(mp_obj_uctypes_struct_t);
             o->base.type = &uctypes_struct_type;
@@ -513,7 +539,6 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
             o->desc = MP_OBJ_FROM_PTR(sub);
             o->addr = self->addr + offset;
             o->flags = self->flags;
-//printf("PTR/ARR base addr=%p\n", o->addr);
             return MP_OBJ_FROM_PTR(o);
         }
     }
@@ -522,6 +547,36 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
     return MP_OBJ_NULL;
 }
 
+STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
+    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (mp_obj_is_type(self->desc, &uctypes_layout_type)) {
+        // binary search of the compiled fields
+        mp_obj_uctypes_layout_t *layout = MP_OBJ_TO_PTR(self->desc);
+        size_t lo = 0, hi = layout->n_fields;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            qstr name = layout->fields[mid].name;
+            if (name == attr) {
+                return uctypes_struct_field_op(self, &layout->fields[mid], set_val);
+            } else if (name < attr) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, MP_OBJ_NEW_QSTR(attr)));
+    }
+
+    if (!uctypes_is_struct_desc(self->desc)) {
+        mp_raise_TypeError("struct: no fields");
+    }
+
+    uctypes_field_t f;
+    uctypes_decode_field(mp_obj_dict_get(self->desc, MP_OBJ_NEW_QSTR(attr)), &f);
+    return uctypes_struct_field_op(self, &f, set_val);
+}
+
 STATIC void uctypes_struct_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     if (dest[0] == MP_OBJ_NULL) {
         // load attribute
@@ -673,6 +728,74 @@ STATIC mp_obj_t uctypes_struct_bytes_at(mp_obj_t ptr, mp_obj_t size) {
 }
 MP_DEFINE_CONST_FUN_OBJ_2(uctypes_struct_bytes_at_obj, uctypes_struct_bytes_at);
 
+STATIC mp_obj_t uctypes_compile_desc(mp_obj_t desc);
+
+// Compile the descriptor nested in an aggregate, if it has one
+STATIC mp_obj_t uctypes_compile_agg(mp_obj_t agg_in) {
+    if (!mp_obj_is_type(agg_in, &mp_type_tuple)) {
+        syntax_error();
+    }
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(agg_in);
+    mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(t->items[0]);
+    size_t i = GET_TYPE(offset, AGG_TYPE_BITS) == ARRAY ? 2 : 1;
+    if (i >= t->len || mp_obj_is_small_int(t->items[i])) {
+        return agg_in;
+    }
+    mp_obj_tuple_t *compiled = MP_OBJ_TO_PTR(mp_obj_new_tuple(t->len, t->items));
+    compiled->items[i] = uctypes_compile_desc(t->items[i]);
+    return MP_OBJ_FROM_PTR(compiled);
+}
+
+STATIC mp_obj_t uctypes_compile_desc(mp_obj_t desc) {
+    if (mp_obj_is_type(desc, &uctypes_layout_type)) {
+        return desc;
+    }
+    if (mp_obj_is_type(desc, &mp_type_tuple)) {
+        return uctypes_compile_agg(desc);
+    }
+    if (!uctypes_is_struct_desc(desc)) {
+        syntax_error();
+    }
+
+    mp_map_t *map = mp_obj_dict_get_map(desc);
+    mp_obj_uctypes_layout_t *layout = m_new_obj_var(mp_obj_uctypes_layout_t, uctypes_field_t, map->used);
+    layout->base.type = &uctypes_layout_type;
+    size_t n = 0;
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (!mp_map_slot_is_filled(map, i)) {
+            continue;
+        }
+        uctypes_field_t f;
+        uctypes_decode_field(map->table[i].value, &f);
+        f.name = mp_obj_str_get_qstr(map->table[i].key);
+        if (f.sub != MP_OBJ_NULL) {
+            f.sub = uctypes_compile_agg(f.sub);
+        }
+        // insert in order of name
+        size_t j = n++;
+        while (j > 0 && layout->fields[j - 1].name > f.name) {
+            layout->fields[j] = layout->fields[j - 1];
+            j--;
+        }
+        layout->fields[j] = f;
+    }
+    layout->n_fields = n;
+    return MP_OBJ_FROM_PTR(layout);
+}
+
+/// \function compile()
+/// Compile a structure descriptor, and those nested in it, into a form that
+/// is faster to access fields through.
+STATIC mp_obj_t uctypes_compile(mp_obj_t desc) {
+    return uctypes_compile_desc(desc);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(uctypes_compile_obj, uctypes_compile);
+
+STATIC const mp_obj_type_t uctypes_layout_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_layout,
+};
+
 
 STATIC const mp_obj_type_t uctypes_struct_type = {
     { &mp_type_type },
@@ -689,6 +812,7 @@ STATIC const mp_rom_map_elem_t mp_module_uctypes_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uctypes) },
     { MP_ROM_QSTR(MP_QSTR_struct), MP_ROM_PTR(&uctypes_struct_type) },
     { MP_ROM_QSTR(MP_QSTR_sizeof), MP_ROM_PTR(&uctypes_struct_sizeof_obj) },
+    { MP_ROM_QSTR(MP_QSTR_compile), MP_ROM_PTR(&uctypes_compile_obj) },
     { MP_ROM_QSTR(MP_QSTR_addressof), MP_ROM_PTR(&uctypes_struct_addressof_obj) },
     { MP_ROM_QSTR(MP_QSTR_bytes_at), MP_ROM_PTR(&uctypes_struct_bytes_at_obj) },
     { MP_ROM_QSTR(MP_QSTR_bytearray_at), MP_ROM_PTR(&uctypes_struct_bytearray_at_obj) },
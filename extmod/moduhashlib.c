@@ -58,6 +58,10 @@
 
 #endif
 
+#if MICROPY_PY_UHASHLIB_CRC32
+#include "uzlib/tinf.h"
+#endif
+
 typedef struct _mp_obj_hash_t {
     mp_obj_base_t base;
     char state[0];
@@ -104,6 +108,7 @@ STATIC mp_obj_t uhashlib_sha256_digest(mp_obj_t self_in) {
 
 #else
 
+#define SHA256_UNROLL MICROPY_PY_UHASHLIB_SHA256_UNROLL
 #include "crypto-algorithms/sha256.c"
 
 STATIC mp_obj_t uhashlib_sha256_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
@@ -326,6 +331,58 @@ STATIC const mp_obj_type_t uhashlib_md5_type = {
 };
 #endif // MICROPY_PY_UHASHLIB_MD5
 
+#if MICROPY_PY_UHASHLIB_CRC32
+STATIC mp_obj_t uhashlib_crc32_update(mp_obj_t self_in, mp_obj_t arg);
+
+STATIC mp_obj_t uhashlib_crc32_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+    mp_obj_hash_t *o = m_new_obj_var(mp_obj_hash_t, char, sizeof(uint32_t));
+    o->base.type = type;
+    *(uint32_t*)o->state = 0xffffffff;
+    if (n_args == 1) {
+        uhashlib_crc32_update(MP_OBJ_FROM_PTR(o), args[0]);
+    }
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_obj_t uhashlib_crc32_update(mp_obj_t self_in, mp_obj_t arg) {
+    mp_obj_hash_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(arg, &bufinfo, MP_BUFFER_READ);
+    uint32_t *crc = (uint32_t*)self->state;
+    *crc = MICROPY_CRC32_UPDATE(*crc, bufinfo.buf, bufinfo.len);
+    return mp_const_none;
+}
+
+// The digest is the CRC in big-endian order, as for zlib's stream trailer
+STATIC mp_obj_t uhashlib_crc32_digest(mp_obj_t self_in) {
+    mp_obj_hash_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t crc = *(uint32_t*)self->state ^ 0xffffffff;
+    vstr_t vstr;
+    vstr_init_len(&vstr, 4);
+    for (int i = 0; i < 4; ++i) {
+        vstr.buf[i] = crc >> (24 - i * 8);
+    }
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(uhashlib_crc32_update_obj, uhashlib_crc32_update);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uhashlib_crc32_digest_obj, uhashlib_crc32_digest);
+
+STATIC const mp_rom_map_elem_t uhashlib_crc32_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&uhashlib_crc32_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_digest), MP_ROM_PTR(&uhashlib_crc32_digest_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(uhashlib_crc32_locals_dict, uhashlib_crc32_locals_dict_table);
+
+STATIC const mp_obj_type_t uhashlib_crc32_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_crc32,
+    .make_new = uhashlib_crc32_make_new,
+    .locals_dict = (void*)&uhashlib_crc32_locals_dict,
+};
+#endif // MICROPY_PY_UHASHLIB_CRC32
+
 STATIC const mp_rom_map_elem_t mp_module_uhashlib_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uhashlib) },
     #if MICROPY_PY_UHASHLIB_SHA256
@@ -337,6 +394,9 @@ STATIC const mp_rom_map_elem_t mp_module_uhashlib_globals_table[] = {
     #if MICROPY_PY_UHASHLIB_MD5
     { MP_ROM_QSTR(MP_QSTR_md5), MP_ROM_PTR(&uhashlib_md5_type) },
     #endif
+    #if MICROPY_PY_UHASHLIB_CRC32
+    { MP_ROM_QSTR(MP_QSTR_crc32), MP_ROM_PTR(&uhashlib_crc32_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uhashlib_globals, mp_module_uhashlib_globals_table);
@@ -25,19 +25,53 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/objlist.h"
-#include "py/objstringio.h"
 #include "py/parsenum.h"
 #include "py/runtime.h"
 #include "py/stream.h"
 
 #if MICROPY_PY_UJSON
 
+// dump collects the output in a buffer on the C stack, so the stream gets a
+// few large writes rather than one for each token
+#define UJSON_DUMP_CHUNK (256)
+
+typedef struct _ujson_dump_buf_t {
+    mp_obj_t stream;
+    size_t len;
+    byte buf[UJSON_DUMP_CHUNK];
+} ujson_dump_buf_t;
+
+STATIC void ujson_dump_flush(ujson_dump_buf_t *d) {
+    if (d->len != 0) {
+        mp_stream_write(d->stream, d->buf, d->len, MP_STREAM_RW_WRITE);
+        d->len = 0;
+    }
+}
+
+STATIC void ujson_dump_strn(void *data, const char *str, size_t len) {
+    ujson_dump_buf_t *d = data;
+    if (d->len + len > UJSON_DUMP_CHUNK) {
+        ujson_dump_flush(d);
+        if (len > UJSON_DUMP_CHUNK) {
+            mp_stream_write(d->stream, str, len, MP_STREAM_RW_WRITE);
+            return;
+        }
+    }
+    memcpy(d->buf + d->len, str, len);
+    d->len += len;
+}
+
 STATIC mp_obj_t mod_ujson_dump(mp_obj_t obj, mp_obj_t stream) {
     mp_get_stream_raise(stream, MP_STREAM_OP_WRITE);
-    mp_print_t print = {MP_OBJ_TO_PTR(stream), mp_stream_write_adaptor};
+    ujson_dump_buf_t d;
+    d.stream = stream;
+    d.len = 0;
+    mp_print_t print = {&d, ujson_dump_strn};
     mp_obj_print_helper(&print, obj, PRINT_JSON);
+    ujson_dump_flush(&d);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ujson_dump_obj, mod_ujson_dump);
@@ -61,35 +95,57 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_dumps_obj, mod_ujson_dumps);
 // input is outside it's specs.
 //
 // Most of the work is parsing the primitives (null, false, true, numbers,
-// strings).  It does 1 pass over the input stream.  It tries to be fast and
-// small in code size, while not using more RAM than necessary.
+// strings).  It does 1 pass over the input stream, which it reads in chunks
+// of UJSON_STREAM_CHUNK bytes, or directly from the string passed to loads.
+// It tries to be fast and small in code size, while not using more RAM than
+// necessary.
+
+#define UJSON_STREAM_CHUNK (256)
 
 typedef struct _ujson_stream_t {
     mp_obj_t stream_obj;
     mp_uint_t (*read)(mp_obj_t obj, void *buf, mp_uint_t size, int *errcode);
-    int errcode;
+    const byte *ptr; // the input not yet consumed is ptr to top
+    const byte *top;
     byte cur;
 } ujson_stream_t;
 
 #define S_EOF (0) // null is not allowed in json stream so is ok as EOF marker
 #define S_END(s) ((s).cur == S_EOF)
 #define S_CUR(s) ((s).cur)
-#define S_NEXT(s) (ujson_stream_next(&(s)))
+#define S_NEXT(s) ((s).ptr < (s).top ? ((s).cur = *(s).ptr++) : ujson_stream_next(&(s), buf))
 
-STATIC byte ujson_stream_next(ujson_stream_t *s) {
-    mp_uint_t ret = s->read(s->stream_obj, &s->cur, 1, &s->errcode);
-    if (s->errcode != 0) {
-        mp_raise_OSError(s->errcode);
+// Read the next chunk of the stream into buf, and take its first byte
+STATIC byte ujson_stream_next(ujson_stream_t *s, byte *buf) {
+    mp_uint_t ret = 0;
+    if (s->read != NULL) {
+        int errcode;
+        ret = s->read(s->stream_obj, buf, UJSON_STREAM_CHUNK, &errcode);
+        if (ret == MP_STREAM_ERROR) {
+            mp_raise_OSError(errcode);
+        }
     }
     if (ret == 0) {
+        // don't read any more once the stream has ended
+        s->read = NULL;
         s->cur = S_EOF;
+    } else {
+        s->ptr = buf + 1;
+        s->top = buf + ret;
+        s->cur = buf[0];
     }
     return s->cur;
 }
 
-STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
-    const mp_stream_p_t *stream_p = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ);
-    ujson_stream_t s = {stream_obj, stream_p->read, 0, 0};
+// Parse the JSON in stream_obj, or in the given string if that's MP_OBJ_NULL
+STATIC mp_obj_t ujson_load(mp_obj_t stream_obj, const byte *str, size_t len) {
+    ujson_stream_t s = {stream_obj, NULL, str, str, 0};
+    byte buf[UJSON_STREAM_CHUNK];
+    if (stream_obj != MP_OBJ_NULL) {
+        s.read = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ)->read;
+    } else {
+        s.top += len;
+    }
     vstr_t vstr;
     vstr_init(&vstr, 8);
     mp_obj_list_t stack; // we use a list as a simple stack for nested JSON
@@ -278,23 +334,316 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
     fail:
     mp_raise_ValueError("syntax error in JSON");
 }
+
+STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
+    return ujson_load(stream_obj, NULL, 0);
+}
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_load_obj, mod_ujson_load);
 
 STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
     size_t len;
     const char *buf = mp_obj_str_get_data(obj, &len);
-    vstr_t vstr = {len, len, (char*)buf, true};
-    mp_obj_stringio_t sio = {{&mp_type_stringio}, &vstr, 0, MP_OBJ_NULL};
-    return mod_ujson_load(MP_OBJ_FROM_PTR(&sio));
+    return ujson_load(MP_OBJ_NULL, (const byte*)buf, len);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_loads_obj, mod_ujson_loads);
 
+#if MICROPY_PY_UJSON_DECODER
+
+// A Decoder parses JSON given to it in pieces of any size, and turns each
+// piece into a list of (event, value) tuples, so a large document can be
+// handled without holding all of it or all of the object it describes.
+// Only the current string or number and a byte per level of nesting are
+// kept between pieces.  Like load, it treats commas and colons as
+// whitespace.
+
+enum {
+    UJSON_EV_START_OBJECT,
+    UJSON_EV_END_OBJECT,
+    UJSON_EV_START_ARRAY,
+    UJSON_EV_END_ARRAY,
+    UJSON_EV_KEY,
+    UJSON_EV_VALUE,
+};
+
+// What the decoder is in the middle of
+enum {
+    UJSON_DEC_SPACE,
+    UJSON_DEC_STRING,
+    UJSON_DEC_ESCAPE,
+    UJSON_DEC_HEX,
+    UJSON_DEC_NUMBER,
+    UJSON_DEC_LITERAL,
+    UJSON_DEC_ERROR,
+};
+
+typedef struct _mp_obj_ujson_decoder_t {
+    mp_obj_base_t base;
+    byte state;
+    bool want_key; // the innermost container is an object that needs a key next
+    bool done; // a whole top-level value has been parsed
+    byte n; // hex digits still to come, or the position in the literal
+    mp_uint_t hex;
+    const char *lit; // the literal being matched
+    mp_obj_t events;
+    vstr_t tok; // the string or number so far
+    vstr_t nest; // '{' or '[' for each open container
+} mp_obj_ujson_decoder_t;
+
+STATIC mp_obj_t ujson_decoder_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    (void)args;
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    mp_obj_ujson_decoder_t *self = m_new_obj(mp_obj_ujson_decoder_t);
+    self->base.type = type;
+    self->state = UJSON_DEC_SPACE;
+    self->want_key = false;
+    self->done = false;
+    self->events = MP_OBJ_NULL;
+    vstr_init(&self->tok, 8);
+    vstr_init(&self->nest, 8);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC void ujson_decoder_event(mp_obj_ujson_decoder_t *self, int event, mp_obj_t value) {
+    mp_obj_t items[2] = {MP_OBJ_NEW_SMALL_INT(event), value};
+    mp_obj_list_append(self->events, mp_obj_new_tuple(2, items));
+}
+
+// Start a value, which is a key if the innermost container is an object
+// that needs one next; returns false if that's not allowed here
+STATIC bool ujson_decoder_value(mp_obj_ujson_decoder_t *self, bool is_str) {
+    if (self->nest.len == 0) {
+        return !self->done;
+    }
+    if (self->nest.buf[self->nest.len - 1] == '{') {
+        if (self->want_key && !is_str) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Report a complete string, number or literal
+STATIC void ujson_decoder_scalar(mp_obj_ujson_decoder_t *self, mp_obj_t value) {
+    if (self->want_key) {
+        ujson_decoder_event(self, UJSON_EV_KEY, value);
+        self->want_key = false;
+    } else {
+        ujson_decoder_event(self, UJSON_EV_VALUE, value);
+        if (self->nest.len == 0) {
+            self->done = true;
+        } else {
+            self->want_key = self->nest.buf[self->nest.len - 1] == '{';
+        }
+    }
+}
+
+STATIC void ujson_decoder_number(mp_obj_ujson_decoder_t *self) {
+    const char *s = self->tok.buf;
+    size_t len = self->tok.len;
+    mp_obj_t value;
+    self->state = UJSON_DEC_ERROR; // if the number doesn't parse
+    if (memchr(s, '.', len) != NULL || memchr(s, 'e', len) != NULL || memchr(s, 'E', len) != NULL) {
+        value = mp_parse_num_decimal(s, len, false, false, NULL);
+    } else {
+        value = mp_parse_num_integer(s, len, 10, NULL);
+    }
+    self->state = UJSON_DEC_SPACE;
+    ujson_decoder_scalar(self, value);
+}
+
+// Parse the bytes from buf to top, returning false on a syntax error
+STATIC bool ujson_decoder_parse(mp_obj_ujson_decoder_t *self, const byte *buf, const byte *top) {
+    while (buf < top) {
+        byte c = *buf++;
+        switch (self->state) {
+            case UJSON_DEC_STRING:
+                if (c == '"') {
+                    self->state = UJSON_DEC_SPACE;
+                    ujson_decoder_scalar(self, mp_obj_new_str(self->tok.buf, self->tok.len));
+                } else if (c == '\\') {
+                    self->state = UJSON_DEC_ESCAPE;
+                } else {
+                    vstr_add_byte(&self->tok, c);
+                }
+                continue;
+            case UJSON_DEC_ESCAPE:
+                self->state = UJSON_DEC_STRING;
+                switch (c) {
+                    case 'b': c = 0x08; break;
+                    case 'f': c = 0x0c; break;
+                    case 'n': c = 0x0a; break;
+                    case 'r': c = 0x0d; break;
+                    case 't': c = 0x09; break;
+                    case 'u':
+                        self->state = UJSON_DEC_HEX;
+                        self->n = 4;
+                        self->hex = 0;
+                        continue;
+                }
+                vstr_add_byte(&self->tok, c);
+                continue;
+            case UJSON_DEC_HEX:
+                if (!unichar_isxdigit(c)) {
+                    return false;
+                }
+                self->hex = (self->hex << 4) | unichar_xdigit_value(c);
+                if (--self->n == 0) {
+                    vstr_add_char(&self->tok, self->hex);
+                    self->state = UJSON_DEC_STRING;
+                }
+                continue;
+            case UJSON_DEC_NUMBER:
+                if (unichar_isdigit(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                    vstr_add_byte(&self->tok, c);
+                    continue;
+                }
+                ujson_decoder_number(self);
+                break; // look at c again
+            case UJSON_DEC_LITERAL:
+                if (c != (byte)self->lit[self->n]) {
+                    return false;
+                }
+                if (self->lit[++self->n] == '\0') {
+                    self->state = UJSON_DEC_SPACE;
+                    c = self->lit[0];
+                    ujson_decoder_scalar(self, c == 'n' ? mp_const_none : mp_obj_new_bool(c == 't'));
+                }
+                continue;
+            case UJSON_DEC_ERROR:
+                return false;
+        }
+
+        // between tokens
+        switch (c) {
+            case ',':
+            case ':':
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                break;
+            case '"':
+                if (!ujson_decoder_value(self, true)) {
+                    return false;
+                }
+                vstr_reset(&self->tok);
+                self->state = UJSON_DEC_STRING;
+                break;
+            case '-':
+            case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+                if (!ujson_decoder_value(self, false)) {
+                    return false;
+                }
+                vstr_reset(&self->tok);
+                vstr_add_byte(&self->tok, c);
+                self->state = UJSON_DEC_NUMBER;
+                break;
+            case 'n':
+            case 'f':
+            case 't':
+                if (!ujson_decoder_value(self, false)) {
+                    return false;
+                }
+                self->lit = c == 'n' ? "null" : c == 'f' ? "false" : "true";
+                self->n = 1;
+                self->state = UJSON_DEC_LITERAL;
+                break;
+            case '{':
+            case '[':
+                if (!ujson_decoder_value(self, false)) {
+                    return false;
+                }
+                vstr_add_byte(&self->nest, c);
+                self->want_key = c == '{';
+                ujson_decoder_event(self, c == '{' ? UJSON_EV_START_OBJECT : UJSON_EV_START_ARRAY, mp_const_none);
+                break;
+            case '}':
+            case ']':
+                // an object must not end between a key and its value
+                if (self->nest.len == 0 || self->nest.buf[self->nest.len - 1] != (c == '}' ? '{' : '[')
+                    || (c == '}' && !self->want_key)) {
+                    return false;
+                }
+                self->nest.len -= 1;
+                ujson_decoder_event(self, c == '}' ? UJSON_EV_END_OBJECT : UJSON_EV_END_ARRAY, mp_const_none);
+                if (self->nest.len == 0) {
+                    self->done = true;
+                    self->want_key = false;
+                } else {
+                    self->want_key = self->nest.buf[self->nest.len - 1] == '{';
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// Parse the given piece of the document, and return the events it completes
+STATIC mp_obj_t ujson_decoder_feed(mp_obj_t self_in, mp_obj_t data_in) {
+    mp_obj_ujson_decoder_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+    self->events = mp_obj_new_list(0, NULL);
+    const byte *buf = bufinfo.buf;
+    if (!ujson_decoder_parse(self, buf, buf + bufinfo.len)) {
+        self->state = UJSON_DEC_ERROR;
+        mp_raise_ValueError("syntax error in JSON");
+    }
+    mp_obj_t events = self->events;
+    self->events = MP_OBJ_NULL;
+    return events;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ujson_decoder_feed_obj, ujson_decoder_feed);
+
+// Finish the document, returning the events of a number that ends it
+STATIC mp_obj_t ujson_decoder_close(mp_obj_t self_in) {
+    mp_obj_ujson_decoder_t *self = MP_OBJ_TO_PTR(self_in);
+    self->events = mp_obj_new_list(0, NULL);
+    if (self->state == UJSON_DEC_NUMBER) {
+        ujson_decoder_number(self);
+    }
+    if (self->state != UJSON_DEC_SPACE || !self->done) {
+        self->state = UJSON_DEC_ERROR;
+        mp_raise_ValueError("syntax error in JSON");
+    }
+    mp_obj_t events = self->events;
+    self->events = MP_OBJ_NULL;
+    return events;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ujson_decoder_close_obj, ujson_decoder_close);
+
+STATIC const mp_rom_map_elem_t ujson_decoder_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_feed), MP_ROM_PTR(&ujson_decoder_feed_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&ujson_decoder_close_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(ujson_decoder_locals_dict, ujson_decoder_locals_dict_table);
+
+STATIC const mp_obj_type_t ujson_decoder_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Decoder,
+    .make_new = ujson_decoder_make_new,
+    .locals_dict = (void*)&ujson_decoder_locals_dict,
+};
+
+#endif // MICROPY_PY_UJSON_DECODER
+
 STATIC const mp_rom_map_elem_t mp_module_ujson_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ujson) },
     { MP_ROM_QSTR(MP_QSTR_dump), MP_ROM_PTR(&mod_ujson_dump_obj) },
     { MP_ROM_QSTR(MP_QSTR_dumps), MP_ROM_PTR(&mod_ujson_dumps_obj) },
     { MP_ROM_QSTR(MP_QSTR_load), MP_ROM_PTR(&mod_ujson_load_obj) },
     { MP_ROM_QSTR(MP_QSTR_loads), MP_ROM_PTR(&mod_ujson_loads_obj) },
+    #if MICROPY_PY_UJSON_DECODER
+    { MP_ROM_QSTR(MP_QSTR_Decoder), MP_ROM_PTR(&ujson_decoder_type) },
+    { MP_ROM_QSTR(MP_QSTR_START_OBJECT), MP_ROM_INT(UJSON_EV_START_OBJECT) },
+    { MP_ROM_QSTR(MP_QSTR_END_OBJECT), MP_ROM_INT(UJSON_EV_END_OBJECT) },
+    { MP_ROM_QSTR(MP_QSTR_START_ARRAY), MP_ROM_INT(UJSON_EV_START_ARRAY) },
+    { MP_ROM_QSTR(MP_QSTR_END_ARRAY), MP_ROM_INT(UJSON_EV_END_ARRAY) },
+    { MP_ROM_QSTR(MP_QSTR_KEY), MP_ROM_INT(UJSON_EV_KEY) },
+    { MP_ROM_QSTR(MP_QSTR_VALUE), MP_ROM_INT(UJSON_EV_VALUE) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_ujson_globals, mp_module_ujson_globals_table);
@@ -43,6 +43,10 @@
 
 typedef struct _mp_obj_re_t {
     mp_obj_base_t base;
+    #if MICROPY_PY_URE_PIKEVM
+    bool use_pikevm;
+    #endif
+    int prefix_char; // byte that every match starts with, or -1 if not known
     ByteProg re;
 } mp_obj_re_t;
 
@@ -171,6 +175,45 @@ STATIC void re_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t
     mp_printf(print, "<re %p>", self);
 }
 
+// Match the compiled program against subj, storing the submatches in caps
+STATIC int re_exec_prog(mp_obj_re_t *self, Subject subj, const char **caps, int caps_num, bool is_anchored) {
+    if (self->prefix_char >= 0) {
+        // a match can only start at an occurrence of this byte, so skip to it
+        if (is_anchored) {
+            if (subj.begin == subj.end || (byte)*subj.begin != self->prefix_char) {
+                return 0;
+            }
+        } else {
+            subj.begin = memchr(subj.begin, self->prefix_char, subj.end - subj.begin);
+            if (subj.begin == NULL) {
+                return 0;
+            }
+        }
+    }
+    #if MICROPY_PY_URE_PIKEVM
+    if (!self->use_pikevm) {
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            int res = re1_5_recursiveloopprog(&self->re, &subj, caps, caps_num, is_anchored);
+            nlr_pop();
+            return res;
+        }
+        if (!mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(((mp_obj_base_t*)nlr.ret_val)->type), MP_OBJ_FROM_PTR(&mp_type_RuntimeError))) {
+            nlr_jump(nlr.ret_val);
+        }
+        // backtracking recurses once per repetition so ran out of stack on
+        // a long subject, but the Pike VM recursion is bounded by the pattern
+    }
+    size_t n = re1_5_pikevm_memsize(&self->re, caps_num);
+    void *mem = m_new(byte, n);
+    int res = re1_5_pikevm(&self->re, &subj, caps, caps_num, is_anchored, mem);
+    m_del(byte, mem, n);
+    return res;
+    #else
+    return re1_5_recursiveloopprog(&self->re, &subj, caps, caps_num, is_anchored);
+    #endif
+}
+
 STATIC mp_obj_t ure_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
     (void)n_args;
     mp_obj_re_t *self = MP_OBJ_TO_PTR(args[0]);
@@ -182,7 +225,7 @@ STATIC mp_obj_t ure_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
     mp_obj_match_t *match = m_new_obj_var(mp_obj_match_t, char*, caps_num);
     // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
     memset((char*)match->caps, 0, caps_num * sizeof(char*));
-    int res = re1_5_recursiveloopprog(&self->re, &subj, match->caps, caps_num, is_anchored);
+    int res = re_exec_prog(self, subj, match->caps, caps_num, is_anchored);
     if (res == 0) {
         m_del_var(mp_obj_match_t, char*, caps_num, match);
         return mp_const_none;
@@ -223,7 +266,7 @@ STATIC mp_obj_t re_split(size_t n_args, const mp_obj_t *args) {
     while (true) {
         // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
         memset((char**)caps, 0, caps_num * sizeof(char*));
-        int res = re1_5_recursiveloopprog(&self->re, &subj, caps, caps_num, false);
+        int res = re_exec_prog(self, subj, caps, caps_num, false);
 
         // if we didn't have a match, or had an empty match, it's time to stop
         if (!res || caps[0] == caps[1]) {
@@ -278,7 +321,7 @@ STATIC mp_obj_t re_sub_helper(mp_obj_t self_in, size_t n_args, const mp_obj_t *a
     for (;;) {
         // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
         memset((char*)match->caps, 0, caps_num * sizeof(char*));
-        int res = re1_5_recursiveloopprog(&self->re, &subj, match->caps, caps_num, false);
+        int res = re_exec_prog(self, subj, match->caps, caps_num, false);
 
         // If we didn't have a match, or had an empty match, it's time to stop
         if (!res || match->caps[0] == match->caps[1]) {
@@ -381,6 +424,58 @@ STATIC const mp_obj_type_t re_type = {
     .locals_dict = (void*)&re_locals_dict,
 };
 
+// Work out from the compiled program which shortcuts re_exec_prog can take
+STATIC void re_analyse(mp_obj_re_t *o) {
+    const char *pc = o->re.insts + NON_ANCHORED_PREFIX;
+    while (*pc == Save) {
+        pc += 2;
+    }
+    o->prefix_char = *pc == Char ? (byte)pc[1] : -1;
+
+    #if MICROPY_PY_URE_PIKEVM
+    // Backtracking can take exponential time when a repeated part of the
+    // pattern can itself match in more than one way, so look for a loop
+    // whose body contains a jump.  The body of x* starts after the Split
+    // that the closing Jmp goes back to, while the body of x+ starts at the
+    // target of the closing Split.
+    o->use_pikevm = false;
+    const char *end = o->re.insts + o->re.bytelen;
+    for (pc = o->re.insts + NON_ANCHORED_PREFIX; pc < end && !o->use_pikevm;) {
+        switch (*pc) {
+            case Class:
+            case ClassNot:
+                pc += (byte)pc[1] * 2 + 2;
+                continue;
+            case Any:
+            case Bol:
+            case Eol:
+            case Match:
+                pc += 1;
+                continue;
+            case Jmp:
+            case Split:
+            case RSplit:
+                if ((signed char)pc[1] < 0) {
+                    const char *body = pc + 2 + (signed char)pc[1];
+                    if (*pc == Jmp) {
+                        body += 2;
+                    }
+                    while (body < pc) {
+                        if (*body == Jmp || *body == Split || *body == RSplit) {
+                            o->use_pikevm = true;
+                            break;
+                        }
+                        body += *body == Class || *body == ClassNot ? (byte)body[1] * 2 + 2
+                            : *body == Any || *body == Bol || *body == Eol ? 1 : 2;
+                    }
+                }
+                break;
+        }
+        pc += 2;
+    }
+    #endif
+}
+
 STATIC mp_obj_t mod_re_compile(size_t n_args, const mp_obj_t *args) {
     const char *re_str = mp_obj_str_get_str(args[0]);
     int size = re1_5_sizecode(re_str);
@@ -398,6 +493,7 @@ STATIC mp_obj_t mod_re_compile(size_t n_args, const mp_obj_t *args) {
 error:
         mp_raise_ValueError("Error in regex");
     }
+    re_analyse(o);
     if (flags & FLAG_DEBUG) {
         re1_5_dumpcode(&o->re);
     }
@@ -405,9 +501,40 @@ error:
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_compile_obj, 1, 2, mod_re_compile);
 
+// Compile a pattern for the module-level functions, reusing the result of a
+// recent compile of the same pattern if there is one
+STATIC mp_obj_t mod_re_compile_cached(mp_obj_t pattern) {
+    #if MICROPY_PY_URE_CACHE_SIZE
+    mp_obj_t *cache = MP_STATE_VM(ure_cache);
+    mp_obj_t re = MP_OBJ_NULL;
+    size_t i;
+    for (i = 0; i < MICROPY_PY_URE_CACHE_SIZE && cache[2 * i] != MP_OBJ_NULL; ++i) {
+        if (mp_obj_get_type(cache[2 * i]) == mp_obj_get_type(pattern)
+            && mp_obj_equal(cache[2 * i], pattern)) {
+            re = cache[2 * i + 1];
+            break;
+        }
+    }
+    if (re == MP_OBJ_NULL) {
+        re = mod_re_compile(1, &pattern);
+        if (i == MICROPY_PY_URE_CACHE_SIZE) {
+            // drop the least recently used entry
+            --i;
+        }
+    }
+    // move the entry to the front
+    memmove(cache + 2, cache, 2 * i * sizeof(mp_obj_t));
+    cache[0] = pattern;
+    cache[1] = re;
+    return re;
+    #else
+    return mod_re_compile(1, &pattern);
+    #endif
+}
+
 STATIC mp_obj_t mod_re_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
     (void)n_args;
-    mp_obj_t self = mod_re_compile(1, args);
+    mp_obj_t self = mod_re_compile_cached(args[0]);
 
     const mp_obj_t args2[] = {self, args[1]};
     mp_obj_t match = ure_exec(is_anchored, 2, args2);
@@ -426,7 +553,7 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_search_obj, 2, 4, mod_re_search);
 
 #if MICROPY_PY_URE_SUB
 STATIC mp_obj_t mod_re_sub(size_t n_args, const mp_obj_t *args) {
-    mp_obj_t self = mod_re_compile(1, args);
+    mp_obj_t self = mod_re_compile_cached(args[0]);
     return re_sub_helper(self, n_args, args);
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_sub_obj, 3, 5, mod_re_sub);
@@ -457,6 +584,9 @@ const mp_obj_module_t mp_module_ure = {
 #include "re1.5/compilecode.c"
 #include "re1.5/dumpcode.c"
 #include "re1.5/recursiveloop.c"
+#if MICROPY_PY_URE_PIKEVM
+#include "re1.5/pike.c"
+#endif
 #include "re1.5/charclass.c"
 
 #endif //MICROPY_PY_URE
@@ -49,6 +49,15 @@ typedef struct _poll_obj_t {
     mp_uint_t (*ioctl)(mp_obj_t obj, mp_uint_t request, uintptr_t arg, int *errcode);
     mp_uint_t flags;
     mp_uint_t flags_ret;
+    // the following are only used by poll objects
+    struct _poll_obj_t *next_active;        // link in the list checked by each poll
+    bool is_active;
+    #if MICROPY_PY_USELECT_NOTIFY
+    volatile bool is_pending;
+    struct _poll_obj_t *next_pending;       // link in the list of notified entries
+    struct _mp_obj_poll_t *poll;            // NULL once unregistered
+    mp_uint_t notify_events;                // events the object notifies of
+    #endif
 } poll_obj_t;
 
 STATIC void poll_map_add(mp_map_t *poll_map, const mp_obj_t *obj, mp_uint_t obj_len, mp_uint_t flags, bool or_flags) {
@@ -62,6 +71,14 @@ STATIC void poll_map_add(mp_map_t *poll_map, const mp_obj_t *obj, mp_uint_t obj_
             poll_obj->ioctl = stream_p->ioctl;
             poll_obj->flags = flags;
             poll_obj->flags_ret = 0;
+            poll_obj->next_active = NULL;
+            poll_obj->is_active = false;
+            #if MICROPY_PY_USELECT_NOTIFY
+            poll_obj->is_pending = false;
+            poll_obj->next_pending = NULL;
+            poll_obj->poll = NULL;
+            poll_obj->notify_events = 0;
+            #endif
             elem->value = MP_OBJ_FROM_PTR(poll_obj);
         } else {
             // object exists; update its flags
@@ -74,6 +91,19 @@ STATIC void poll_map_add(mp_map_t *poll_map, const mp_obj_t *obj, mp_uint_t obj_
     }
 }
 
+STATIC mp_uint_t poll_obj_poll(poll_obj_t *poll_obj) {
+    int errcode;
+    mp_int_t ret = poll_obj->ioctl(poll_obj->obj, MP_STREAM_POLL, poll_obj->flags, &errcode);
+    poll_obj->flags_ret = ret;
+
+    if (ret == -1) {
+        // error doing ioctl
+        mp_raise_OSError(errcode);
+    }
+
+    return ret;
+}
+
 // poll each object in the map
 STATIC mp_uint_t poll_map_poll(mp_map_t *poll_map, size_t *rwx_num) {
     mp_uint_t n_ready = 0;
@@ -83,14 +113,7 @@ STATIC mp_uint_t poll_map_poll(mp_map_t *poll_map, size_t *rwx_num) {
         }
 
         poll_obj_t *poll_obj = MP_OBJ_TO_PTR(poll_map->table[i].value);
-        int errcode;
-        mp_int_t ret = poll_obj->ioctl(poll_obj->obj, MP_STREAM_POLL, poll_obj->flags, &errcode);
-        poll_obj->flags_ret = ret;
-
-        if (ret == -1) {
-            // error doing ioctl
-            mp_raise_OSError(errcode);
-        }
+        mp_uint_t ret = poll_obj_poll(poll_obj);
 
         if (ret != 0) {
             // object is ready
@@ -183,13 +206,136 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_select_select_obj, 3, 4, select_select);
 typedef struct _mp_obj_poll_t {
     mp_obj_base_t base;
     mp_map_t poll_map;
+    // entries that may be ready, which are all that a poll needs to check
+    poll_obj_t *active;
+    poll_obj_t *iter_next;
+    #if MICROPY_PY_USELECT_NOTIFY
+    // entries notified since the last poll, added to from IRQs
+    poll_obj_t *volatile pending;
+    #endif
     short iter_cnt;
-    short iter_idx;
     int flags;
     // callee-owned tuple
     mp_obj_t ret_tuple;
 } mp_obj_poll_t;
 
+// An entry stays on the active list while it is ready or if its object can't
+// notify of all the events it's polled for, and is added back when notified.
+
+STATIC void poll_activate(mp_obj_poll_t *self, poll_obj_t *poll_obj) {
+    if (!poll_obj->is_active) {
+        poll_obj->is_active = true;
+        poll_obj->next_active = self->active;
+        self->active = poll_obj;
+    }
+}
+
+STATIC void poll_deactivate(mp_obj_poll_t *self, poll_obj_t *poll_obj) {
+    if (poll_obj->is_active) {
+        poll_obj_t **link = &self->active;
+        while (*link != poll_obj) {
+            link = &(*link)->next_active;
+        }
+        *link = poll_obj->next_active;
+        poll_obj->is_active = false;
+        if (self->iter_next == poll_obj) {
+            self->iter_next = poll_obj->next_active;
+        }
+    }
+}
+
+#if MICROPY_PY_USELECT_NOTIFY
+
+void mp_poll_notify(poll_obj_t *poll_obj, mp_uint_t events) {
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    mp_obj_poll_t *self = poll_obj->poll;
+    if (self != NULL && !poll_obj->is_pending && (events & poll_obj->flags)) {
+        poll_obj->is_pending = true;
+        poll_obj->next_pending = self->pending;
+        self->pending = poll_obj;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+// move the notified entries onto the active list
+STATIC void poll_take_pending(mp_obj_poll_t *self) {
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    poll_obj_t *poll_obj = self->pending;
+    self->pending = NULL;
+    while (poll_obj != NULL) {
+        poll_obj->is_pending = false;
+        poll_activate(self, poll_obj);
+        poll_obj = poll_obj->next_pending;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+STATIC void poll_attach(mp_obj_poll_t *self, poll_obj_t *poll_obj) {
+    if (poll_obj->poll == NULL) {
+        int errcode;
+        poll_obj->poll = self;
+        mp_uint_t ret = poll_obj->ioctl(poll_obj->obj, MP_STREAM_POLL_NOTIFY, (uintptr_t)poll_obj, &errcode);
+        poll_obj->notify_events = ret == MP_STREAM_ERROR ? 0 : ret;
+    }
+}
+
+STATIC void poll_detach(mp_obj_poll_t *self, poll_obj_t *poll_obj) {
+    if (poll_obj->notify_events != 0) {
+        int errcode;
+        poll_obj->ioctl(poll_obj->obj, MP_STREAM_POLL_NOTIFY, (uintptr_t)NULL, &errcode);
+    }
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    poll_obj->poll = NULL;
+    if (poll_obj->is_pending) {
+        poll_obj_t **link = (poll_obj_t**)&self->pending;
+        while (*link != poll_obj) {
+            link = &(*link)->next_pending;
+        }
+        *link = poll_obj->next_pending;
+        poll_obj->is_pending = false;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+STATIC bool poll_obj_notifies(poll_obj_t *poll_obj) {
+    return (poll_obj->flags & ~poll_obj->notify_events) == 0;
+}
+
+#else
+
+#define poll_take_pending(self) (void)0
+#define poll_attach(self, poll_obj) (void)0
+#define poll_detach(self, poll_obj) (void)0
+#define poll_obj_notifies(poll_obj) (false)
+
+#endif
+
+// check each active entry, returning the number that are ready
+STATIC mp_uint_t poll_check_active(mp_obj_poll_t *self) {
+    poll_take_pending(self);
+    mp_uint_t n_ready = 0;
+    poll_obj_t *poll_obj = self->active;
+    while (poll_obj != NULL) {
+        poll_obj_t *next = poll_obj->next_active;
+        if (poll_obj_poll(poll_obj) != 0) {
+            n_ready += 1;
+        } else if (poll_obj_notifies(poll_obj)) {
+            // it will be notified when it becomes ready
+            poll_deactivate(self, poll_obj);
+        }
+        poll_obj = next;
+    }
+    return n_ready;
+}
+
+STATIC poll_obj_t *poll_lookup(mp_obj_poll_t *self, mp_obj_t obj_in, mp_map_lookup_kind_t kind) {
+    mp_map_elem_t *elem = mp_map_lookup(&self->poll_map, mp_obj_id(obj_in), kind);
+    if (elem == NULL) {
+        return NULL;
+    }
+    return MP_OBJ_TO_PTR(elem->value);
+}
+
 /// \method register(obj[, eventmask])
 STATIC mp_obj_t poll_register(size_t n_args, const mp_obj_t *args) {
     mp_obj_poll_t *self = MP_OBJ_TO_PTR(args[0]);
@@ -200,6 +346,9 @@ STATIC mp_obj_t poll_register(size_t n_args, const mp_obj_t *args) {
         flags = MP_STREAM_POLL_RD | MP_STREAM_POLL_WR;
     }
     poll_map_add(&self->poll_map, &args[1], 1, flags, false);
+    poll_obj_t *poll_obj = poll_lookup(self, args[1], MP_MAP_LOOKUP);
+    poll_attach(self, poll_obj);
+    poll_activate(self, poll_obj);
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_register_obj, 2, 3, poll_register);
@@ -207,8 +356,12 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_register_obj, 2, 3, poll_register);
 /// \method unregister(obj)
 STATIC mp_obj_t poll_unregister(mp_obj_t self_in, mp_obj_t obj_in) {
     mp_obj_poll_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_map_lookup(&self->poll_map, mp_obj_id(obj_in), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    poll_obj_t *poll_obj = poll_lookup(self, obj_in, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
     // TODO raise KeyError if obj didn't exist in map
+    if (poll_obj != NULL) {
+        poll_detach(self, poll_obj);
+        poll_deactivate(self, poll_obj);
+    }
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_2(poll_unregister_obj, poll_unregister);
@@ -216,11 +369,12 @@ MP_DEFINE_CONST_FUN_OBJ_2(poll_unregister_obj, poll_unregister);
 /// \method modify(obj, eventmask)
 STATIC mp_obj_t poll_modify(mp_obj_t self_in, mp_obj_t obj_in, mp_obj_t eventmask_in) {
     mp_obj_poll_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_map_elem_t *elem = mp_map_lookup(&self->poll_map, mp_obj_id(obj_in), MP_MAP_LOOKUP);
-    if (elem == NULL) {
+    poll_obj_t *poll_obj = poll_lookup(self, obj_in, MP_MAP_LOOKUP);
+    if (poll_obj == NULL) {
         mp_raise_OSError(MP_ENOENT);
     }
-    ((poll_obj_t*)MP_OBJ_TO_PTR(elem->value))->flags = mp_obj_get_int(eventmask_in);
+    poll_obj->flags = mp_obj_get_int(eventmask_in);
+    poll_activate(self, poll_obj);
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_3(poll_modify_obj, poll_modify);
@@ -249,7 +403,7 @@ STATIC mp_uint_t poll_poll_internal(uint n_args, const mp_obj_t *args) {
     mp_uint_t n_ready;
     for (;;) {
         // poll the objects
-        n_ready = poll_map_poll(&self->poll_map, NULL);
+        n_ready = poll_check_active(self);
         if (n_ready > 0 || (timeout != -1 && mp_hal_ticks_ms() - start_tick >= timeout)) {
             break;
         }
@@ -266,11 +420,7 @@ STATIC mp_obj_t poll_poll(size_t n_args, const mp_obj_t *args) {
     // one or more objects are ready, or we had a timeout
     mp_obj_list_t *ret_list = MP_OBJ_TO_PTR(mp_obj_new_list(n_ready, NULL));
     n_ready = 0;
-    for (mp_uint_t i = 0; i < self->poll_map.alloc; ++i) {
-        if (!mp_map_slot_is_filled(&self->poll_map, i)) {
-            continue;
-        }
-        poll_obj_t *poll_obj = MP_OBJ_TO_PTR(self->poll_map.table[i].value);
+    for (poll_obj_t *poll_obj = self->active; poll_obj != NULL; poll_obj = poll_obj->next_active) {
         if (poll_obj->flags_ret != 0) {
             mp_obj_t tuple[2] = {poll_obj->obj, MP_OBJ_NEW_SMALL_INT(poll_obj->flags_ret)};
             ret_list->items[n_ready++] = mp_obj_new_tuple(2, tuple);
@@ -293,7 +443,7 @@ STATIC mp_obj_t poll_ipoll(size_t n_args, const mp_obj_t *args) {
 
     int n_ready = poll_poll_internal(n_args, args);
     self->iter_cnt = n_ready;
-    self->iter_idx = 0;
+    self->iter_next = self->active;
 
     return args[0];
 }
@@ -308,12 +458,9 @@ STATIC mp_obj_t poll_iternext(mp_obj_t self_in) {
 
     self->iter_cnt--;
 
-    for (mp_uint_t i = self->iter_idx; i < self->poll_map.alloc; ++i) {
-        self->iter_idx++;
-        if (!mp_map_slot_is_filled(&self->poll_map, i)) {
-            continue;
-        }
-        poll_obj_t *poll_obj = MP_OBJ_TO_PTR(self->poll_map.table[i].value);
+    while (self->iter_next != NULL) {
+        poll_obj_t *poll_obj = self->iter_next;
+        self->iter_next = poll_obj->next_active;
         if (poll_obj->flags_ret != 0) {
             mp_obj_tuple_t *t = MP_OBJ_TO_PTR(self->ret_tuple);
             t->items[0] = poll_obj->obj;
@@ -353,6 +500,11 @@ STATIC mp_obj_t select_poll(void) {
     mp_obj_poll_t *poll = m_new_obj(mp_obj_poll_t);
     poll->base.type = &mp_type_poll;
     mp_map_init(&poll->poll_map, 0);
+    poll->active = NULL;
+    poll->iter_next = NULL;
+    #if MICROPY_PY_USELECT_NOTIFY
+    poll->pending = NULL;
+    #endif
     poll->iter_cnt = 0;
     poll->ret_tuple = MP_OBJ_NULL;
     return MP_OBJ_FROM_PTR(poll);
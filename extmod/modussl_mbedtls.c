@@ -54,6 +54,11 @@ typedef struct _mp_obj_ssl_socket_t {
     mbedtls_x509_crt cacert;
     mbedtls_x509_crt cert;
     mbedtls_pk_context pkey;
+    #if MICROPY_PY_USSL_SESSION_CACHE_SIZE
+    // server_hostname of a client connection whose session is to be cached,
+    // MP_OBJ_NULL once it has been
+    mp_obj_t cache_hostname;
+    #endif
 } mp_obj_ssl_socket_t;
 
 struct ssl_args {
@@ -66,6 +71,85 @@ struct ssl_args {
 
 STATIC const mp_obj_type_t ussl_socket_type;
 
+// If the record input buffer has been configured smaller than the 16k that
+// the standard allows, ask servers to send records that fit it
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH) && defined(MBEDTLS_SSL_IN_CONTENT_LEN) && MBEDTLS_SSL_IN_CONTENT_LEN < 16384
+#if MBEDTLS_SSL_IN_CONTENT_LEN >= 4096
+#define USSL_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#elif MBEDTLS_SSL_IN_CONTENT_LEN >= 2048
+#define USSL_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_2048
+#elif MBEDTLS_SSL_IN_CONTENT_LEN >= 1024
+#define USSL_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_1024
+#else
+#define USSL_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_512
+#endif
+#endif
+
+#if MICROPY_PY_USSL_SESSION_CACHE_SIZE
+// Return the index in the cache of the session for hostname, or -1
+STATIC int session_cache_find(mp_obj_t hostname) {
+    mp_obj_t *cache = MP_STATE_VM(ussl_session_cache);
+    for (int i = 0; i < MICROPY_PY_USSL_SESSION_CACHE_SIZE && cache[2 * i] != MP_OBJ_NULL; ++i) {
+        if (mp_obj_equal(cache[2 * i], hostname)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Move entry i of the cache to the front, making it the most recent
+STATIC void session_cache_to_front(int i) {
+    mp_obj_t *cache = MP_STATE_VM(ussl_session_cache);
+    mp_obj_t hostname = cache[2 * i];
+    mp_obj_t session = cache[2 * i + 1];
+    memmove(&cache[2], &cache[0], 2 * i * sizeof(mp_obj_t));
+    cache[0] = hostname;
+    cache[1] = session;
+}
+
+// Give the connection the cached session for its server, if there is one,
+// so that the handshake can resume it
+STATIC void session_cache_load(mp_obj_ssl_socket_t *o) {
+    int i = session_cache_find(o->cache_hostname);
+    if (i >= 0) {
+        session_cache_to_front(i);
+        mbedtls_ssl_set_session(&o->ssl, MP_OBJ_TO_PTR(MP_STATE_VM(ussl_session_cache[1])));
+    }
+}
+
+// Keep the session of a connection whose handshake is over, replacing the
+// one for the same server or else the least recent
+STATIC void session_cache_save(mp_obj_ssl_socket_t *o) {
+    if (o->cache_hostname == MP_OBJ_NULL || o->ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        return;
+    }
+    mp_obj_t *cache = MP_STATE_VM(ussl_session_cache);
+    int i = session_cache_find(o->cache_hostname);
+    if (i < 0) {
+        i = MICROPY_PY_USSL_SESSION_CACHE_SIZE - 1;
+        cache[2 * i] = o->cache_hostname;
+    }
+    mbedtls_ssl_session *session = MP_OBJ_TO_PTR(cache[2 * i + 1]);
+    if (session == NULL) {
+        session = m_new_obj(mbedtls_ssl_session);
+        mbedtls_ssl_session_init(session);
+        cache[2 * i + 1] = MP_OBJ_FROM_PTR(session);
+    } else {
+        // frees the old session's certificate and ticket, and clears it
+        mbedtls_ssl_session_free(session);
+    }
+    session_cache_to_front(i);
+    if (mbedtls_ssl_get_session(&o->ssl, session) != 0) {
+        // drop the entry, which is now at the front
+        mbedtls_ssl_session_free(session);
+        memmove(&cache[0], &cache[2], 2 * (MICROPY_PY_USSL_SESSION_CACHE_SIZE - 1) * sizeof(mp_obj_t));
+        cache[2 * MICROPY_PY_USSL_SESSION_CACHE_SIZE - 2] = MP_OBJ_NULL;
+        cache[2 * MICROPY_PY_USSL_SESSION_CACHE_SIZE - 1] = MP_OBJ_NULL;
+    }
+    o->cache_hostname = MP_OBJ_NULL;
+}
+#endif
+
 #ifdef MBEDTLS_DEBUG_C
 STATIC void mbedtls_debug(void *ctx, int level, const char *file, int line, const char *str) {
     (void)ctx;
@@ -120,6 +204,9 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
 #endif
     o->base.type = &ussl_socket_type;
     o->sock = sock;
+    #if MICROPY_PY_USSL_SESSION_CACHE_SIZE
+    o->cache_hostname = MP_OBJ_NULL;
+    #endif
 
     int ret;
     mbedtls_ssl_init(&o->ssl);
@@ -150,6 +237,9 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
 
     mbedtls_ssl_conf_authmode(&o->conf, MBEDTLS_SSL_VERIFY_NONE);
     mbedtls_ssl_conf_rng(&o->conf, mbedtls_ctr_drbg_random, &o->ctr_drbg);
+    #ifdef USSL_MAX_FRAG_LEN
+    mbedtls_ssl_conf_max_frag_len(&o->conf, USSL_MAX_FRAG_LEN);
+    #endif
     #ifdef MBEDTLS_DEBUG_C
     mbedtls_ssl_conf_dbg(&o->conf, mbedtls_debug, NULL);
     #endif
@@ -165,6 +255,12 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
         if (ret != 0) {
             goto cleanup;
         }
+        #if MICROPY_PY_USSL_SESSION_CACHE_SIZE
+        if (!args->server_side.u_bool) {
+            o->cache_hostname = args->server_hostname.u_obj;
+            session_cache_load(o);
+        }
+        #endif
     }
 
     mbedtls_ssl_set_bio(&o->ssl, &o->sock, _mbedtls_ssl_send, _mbedtls_ssl_recv, NULL);
@@ -193,6 +289,9 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
                 goto cleanup;
             }
         }
+        #if MICROPY_PY_USSL_SESSION_CACHE_SIZE
+        session_cache_save(o);
+        #endif
     }
 
     return o;
@@ -284,6 +383,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_setblocking_obj, socket_setblocking);
 STATIC mp_uint_t socket_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
     mp_obj_ssl_socket_t *self = MP_OBJ_TO_PTR(o_in);
     if (request == MP_STREAM_CLOSE) {
+        #if MICROPY_PY_USSL_SESSION_CACHE_SIZE
+        // the handshake may have been done by the first read or write
+        session_cache_save(self);
+        #endif
         mbedtls_pk_free(&self->pkey);
         mbedtls_x509_crt_free(&self->cert);
         mbedtls_x509_crt_free(&self->cacert);
@@ -38,6 +38,14 @@ enum { FRAME_HEADER, FRAME_OPT, PAYLOAD, CONTROL };
 
 enum { BLOCKING_WRITE = 0x80 };
 
+// Socket reads are made in pieces of at least this size, so a frame header
+// and a small payload usually take one read.
+#define WEBSOCKET_READ_AHEAD (64)
+
+// Frames with payloads up to this size are written with their header in one
+// socket write, so that they go in one packet.
+#define WEBSOCKET_WRITE_COALESCE (128)
+
 typedef struct _mp_obj_websocket_t {
     mp_obj_base_t base;
     mp_obj_t sock;
@@ -53,6 +61,10 @@ typedef struct _mp_obj_websocket_t {
     byte ws_flags;
     // Copy of current frame flags
     byte last_flags;
+    // Data read from the socket but not yet consumed
+    byte rbuf_pos;
+    byte rbuf_len;
+    byte rbuf[WEBSOCKET_READ_AHEAD];
 } mp_obj_websocket_t;
 
 STATIC mp_uint_t websocket_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode);
@@ -67,6 +79,8 @@ STATIC mp_obj_t websocket_make_new(const mp_obj_type_t *type, size_t n_args, siz
     o->to_recv = 2;
     o->mask_pos = 0;
     o->buf_pos = 0;
+    o->rbuf_pos = 0;
+    o->rbuf_len = 0;
     o->opts = FRAME_TXT;
     if (n_args > 1 && args[1] == mp_const_true) {
         o->opts |= BLOCKING_WRITE;
@@ -74,12 +88,59 @@ STATIC mp_obj_t websocket_make_new(const mp_obj_type_t *type, size_t n_args, siz
     return  MP_OBJ_FROM_PTR(o);
 }
 
+// Read from the socket through the read-ahead buffer.  Reads at least as
+// big as the buffer go straight into buf when it's empty.
+STATIC mp_uint_t websocket_read_raw(mp_obj_websocket_t *self, void *buf, mp_uint_t size, int *errcode) {
+    if (self->rbuf_pos == self->rbuf_len) {
+        const mp_stream_p_t *stream_p = mp_get_stream(self->sock);
+        if (size >= sizeof(self->rbuf)) {
+            return stream_p->read(self->sock, buf, size, errcode);
+        }
+        mp_uint_t out_sz = stream_p->read(self->sock, self->rbuf, sizeof(self->rbuf), errcode);
+        if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
+            return out_sz;
+        }
+        self->rbuf_pos = 0;
+        self->rbuf_len = out_sz;
+    }
+    size = MIN(size, (mp_uint_t)(self->rbuf_len - self->rbuf_pos));
+    memcpy(buf, self->rbuf + self->rbuf_pos, size);
+    self->rbuf_pos += size;
+    return size;
+}
+
+// XOR the payload with the mask, a word at a time where it can be
+STATIC void websocket_unmask(mp_obj_websocket_t *self, byte *p, size_t sz) {
+    uint32_t w;
+    memcpy(&w, self->mask, 4);
+    if (w == 0) {
+        // Unmasked, as frames from a server are
+        return;
+    }
+    for (; sz != 0 && ((uintptr_t)p & 3) != 0; --sz) {
+        *p++ ^= self->mask[self->mask_pos++ & 3];
+    }
+    if (sz >= 4) {
+        // mask_pos doesn't change, being counted modulo 4
+        byte m[4];
+        for (int i = 0; i < 4; ++i) {
+            m[i] = self->mask[(self->mask_pos + i) & 3];
+        }
+        memcpy(&w, m, 4);
+        for (; sz >= 4; sz -= 4, p += 4) {
+            *(uint32_t*)p ^= w;
+        }
+    }
+    for (; sz != 0; --sz) {
+        *p++ ^= self->mask[self->mask_pos++ & 3];
+    }
+}
+
 STATIC mp_uint_t websocket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
     mp_obj_websocket_t *self =  MP_OBJ_TO_PTR(self_in);
-    const mp_stream_p_t *stream_p = mp_get_stream(self->sock);
     while (1) {
         if (self->to_recv != 0) {
-            mp_uint_t out_sz = stream_p->read(self->sock, self->buf + self->buf_pos, self->to_recv, errcode);
+            mp_uint_t out_sz = websocket_read_raw(self, self->buf + self->buf_pos, self->to_recv, errcode);
             if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
                 return out_sz;
             }
@@ -170,15 +231,12 @@ STATIC mp_uint_t websocket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
                 }
 
                 size_t sz = MIN(size, self->msg_sz);
-                out_sz = stream_p->read(self->sock, buf, sz, errcode);
+                out_sz = websocket_read_raw(self, buf, sz, errcode);
                 if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
                     return out_sz;
                 }
 
-                sz = out_sz;
-                for (byte *p = buf; sz--; p++) {
-                    *p ^= self->mask[self->mask_pos++ & 3];
-                }
+                websocket_unmask(self, buf, out_sz);
 
                 self->msg_sz -= out_sz;
                 if (self->msg_sz == 0) {
@@ -238,9 +296,18 @@ STATIC mp_uint_t websocket_write(mp_obj_t self_in, const void *buf, mp_uint_t si
         mp_call_method_n_kw(1, 0, dest);
     }
 
-    mp_uint_t out_sz = mp_stream_write_exactly(self->sock, header, hdr_sz, errcode);
-    if (*errcode == 0) {
-        out_sz = mp_stream_write_exactly(self->sock, buf, size, errcode);
+    mp_uint_t out_sz = 0;
+    if (size <= WEBSOCKET_WRITE_COALESCE) {
+        byte frame[4 + WEBSOCKET_WRITE_COALESCE];
+        memcpy(frame, header, hdr_sz);
+        memcpy(frame + hdr_sz, buf, size);
+        mp_stream_write_exactly(self->sock, frame, hdr_sz + size, errcode);
+        out_sz = size;
+    } else {
+        mp_stream_write_exactly(self->sock, header, hdr_sz, errcode);
+        if (*errcode == 0) {
+            out_sz = mp_stream_write_exactly(self->sock, buf, size, errcode);
+        }
     }
 
     if (self->opts & BLOCKING_WRITE) {
@@ -262,6 +329,19 @@ STATIC mp_uint_t websocket_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t
             // abrupt close (connection abort).
             mp_stream_close(self->sock);
             return 0;
+        case MP_STREAM_POLL: {
+            // Data in the read-ahead buffer is ready even if the socket isn't
+            mp_uint_t ret = 0;
+            if ((arg & MP_STREAM_POLL_RD) && self->rbuf_pos != self->rbuf_len) {
+                ret = MP_STREAM_POLL_RD;
+            }
+            const mp_stream_p_t *stream_p = mp_get_stream(self->sock);
+            mp_uint_t sock_ret = stream_p->ioctl(self->sock, request, arg, errcode);
+            if (sock_ret == MP_STREAM_ERROR) {
+                return ret != 0 ? ret : MP_STREAM_ERROR;
+            }
+            return ret | sock_ret;
+        }
         case MP_STREAM_GET_DATA_OPTS:
             return self->ws_flags & FRAME_OPCODE_MASK;
         case MP_STREAM_SET_DATA_OPTS: {
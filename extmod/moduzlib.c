@@ -94,7 +94,8 @@ STATIC mp_obj_t decompio_make_new(const mp_obj_type_t *type, size_t n_args, size
 header_error:
             mp_raise_ValueError("compression header");
         }
-        dict_sz = 1 << dict_opt;
+        // CINFO is the base-2 logarithm of the window size minus 8
+        dict_sz = 1 << (dict_opt + 8);
     } else {
         dict_sz = 1 << -dict_opt;
     }
@@ -182,11 +183,14 @@ STATIC mp_obj_t mod_uzlib_decompress(size_t n_args, const mp_obj_t *args) {
         if (st == TINF_DONE) {
             break;
         }
+        // grow by a fraction of the size, so the data is copied a bounded
+        // number of times overall
         size_t offset = decomp->dest - dest_buf;
-        dest_buf = m_renew(byte, dest_buf, dest_buf_size, dest_buf_size + 256);
-        dest_buf_size += 256;
+        size_t grow = dest_buf_size / 4 + 256;
+        dest_buf = m_renew(byte, dest_buf, dest_buf_size, dest_buf_size + grow);
+        dest_buf_size += grow;
         decomp->dest = dest_buf + offset;
-        decomp->dest_limit = decomp->dest + 256;
+        decomp->dest_limit = decomp->dest + grow;
     }
 
     mp_uint_t final_sz = decomp->dest - dest_buf;
@@ -201,10 +205,302 @@ error:
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_decompress_obj, 1, 3, mod_uzlib_decompress);
 
+#if MICROPY_PY_UZLIB_COMPRESS
+
+#define COMPIO_MIN_MATCH (3)
+#define COMPIO_MAX_MATCH (258)
+// data needed after a position to encode it as it would be if all the data
+// were available: the longest match, and the bytes hashed at its last position
+#define COMPIO_LOOKAHEAD (COMPIO_MAX_MATCH + COMPIO_MIN_MATCH - 1)
+#define COMPIO_OUTBUF_SIZE (64)
+
+enum {
+    COMPIO_FORMAT_RAW,
+    COMPIO_FORMAT_ZLIB,
+    COMPIO_FORMAT_GZIP,
+};
+
+typedef struct _mp_obj_compio_t {
+    mp_obj_base_t base;
+    mp_obj_t dest_stream; // MP_OBJ_NULL to collect the output in vstr
+    vstr_t *vstr;
+    struct Outbuf out;
+    // data being compressed, from window bytes before pos up to end
+    const byte *buf;
+    size_t pos;
+    size_t end;
+    size_t buf_offset; // offset of buf[0] in the uncompressed data
+    byte *hist; // buffer owned by a CompIO, which buf points to
+    size_t hist_size;
+    // low 16 bits of the offset of the last occurrence of each hash of 3 bytes
+    uint16_t *hash;
+    size_t window;
+    uint32_t checksum;
+    uint32_t in_len;
+    uint8_t hash_bits;
+    uint8_t format;
+    bool closed;
+    byte outbuf[COMPIO_OUTBUF_SIZE];
+} mp_obj_compio_t;
+
+STATIC void compio_flush_out(struct Outbuf *out) {
+    byte *p = (void*)out;
+    p -= offsetof(mp_obj_compio_t, out);
+    mp_obj_compio_t *self = (mp_obj_compio_t*)p;
+
+    if (self->dest_stream == MP_OBJ_NULL) {
+        vstr_add_strn(self->vstr, (const char*)out->outbuf, out->outlen);
+    } else {
+        mp_stream_write(self->dest_stream, out->outbuf, out->outlen, MP_STREAM_RW_WRITE);
+    }
+    out->outlen = 0;
+}
+
+STATIC void compio_out_bytes(mp_obj_compio_t *self, uint32_t val, int n, bool big_endian) {
+    for (int i = 0; i < n; ++i) {
+        int shift = big_endian ? (n - 1 - i) * 8 : i * 8;
+        outbits(&self->out, (val >> shift) & 0xff, 8);
+    }
+}
+
+// Check the wbits argument, which selects the format and window size as for
+// DecompIO, and set up the encoder with the header written
+STATIC void compio_init(mp_obj_compio_t *self, mp_int_t wbits, mp_obj_t dest_stream, vstr_t *vstr) {
+    self->format = COMPIO_FORMAT_ZLIB;
+    if (wbits < 0) {
+        wbits = -wbits;
+        self->format = COMPIO_FORMAT_RAW;
+    } else if (wbits >= 16) {
+        wbits -= 16;
+        self->format = COMPIO_FORMAT_GZIP;
+    }
+    if (wbits < 8 || wbits > 15) {
+        mp_raise_ValueError("wbits");
+    }
+
+    self->dest_stream = dest_stream;
+    self->vstr = vstr;
+    memset(&self->out, 0, sizeof(self->out));
+    self->out.outbuf = self->outbuf;
+    self->out.outsize = COMPIO_OUTBUF_SIZE;
+    self->out.flush = compio_flush_out;
+    self->buf = NULL;
+    self->pos = 0;
+    self->end = 0;
+    self->buf_offset = 0;
+    self->hist = NULL;
+    self->hist_size = 0;
+    self->window = 1 << wbits;
+    self->hash_bits = MIN(wbits - 2, 10);
+    self->hash = m_new0(uint16_t, 1 << self->hash_bits);
+    self->in_len = 0;
+    self->closed = false;
+
+    if (self->format == COMPIO_FORMAT_ZLIB) {
+        uint32_t cmf = 0x08 | (wbits - 8) << 4;
+        compio_out_bytes(self, cmf << 8 | (31 - (cmf << 8) % 31), 2, true);
+        self->checksum = 1;
+    } else if (self->format == COMPIO_FORMAT_GZIP) {
+        // magic, deflate, no flags, no mtime, no extra flags, unknown OS
+        static const byte gzip_header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+        for (size_t i = 0; i < sizeof(gzip_header); ++i) {
+            outbits(&self->out, gzip_header[i], 8);
+        }
+        self->checksum = 0xffffffff;
+    }
+    zlib_start_block(&self->out);
+}
+
+STATIC void compio_add_checksum(mp_obj_compio_t *self, const byte *data, size_t len) {
+    if (self->format == COMPIO_FORMAT_ZLIB) {
+        self->checksum = uzlib_adler32(data, len, self->checksum);
+    } else if (self->format == COMPIO_FORMAT_GZIP) {
+        self->checksum = uzlib_crc32(data, len, self->checksum);
+    }
+    self->in_len += len;
+}
+
+// Encode the data in buf from pos, leaving the last keep bytes for later so
+// that matches can be as long as possible
+STATIC void compio_encode(mp_obj_compio_t *self, size_t keep) {
+    const byte *buf = self->buf;
+    uint16_t *hash = self->hash;
+    int hash_shift = 32 - self->hash_bits;
+    size_t pos = self->pos;
+    size_t end = self->end;
+    while (end - pos > keep) {
+        size_t avail = end - pos;
+        size_t len = 0;
+        size_t dist = 0;
+        if (avail >= COMPIO_MIN_MATCH) {
+            const byte *p = buf + pos;
+            uint32_t h = ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> hash_shift;
+            uint16_t here = self->buf_offset + pos;
+            dist = (uint16_t)(here - hash[h]);
+            hash[h] = here;
+            if (0 < dist && dist <= self->window && dist <= pos) {
+                const byte *cand = p - dist;
+                size_t max = MIN(avail, COMPIO_MAX_MATCH);
+                while (len < max && cand[len] == p[len]) {
+                    ++len;
+                }
+            }
+        }
+        if (len >= COMPIO_MIN_MATCH) {
+            zlib_match(&self->out, dist, len);
+            // record the positions inside the match too
+            size_t match_end = pos + len;
+            for (++pos; pos < match_end && pos + COMPIO_MIN_MATCH <= end; ++pos) {
+                const byte *p = buf + pos;
+                uint32_t h = ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> hash_shift;
+                hash[h] = self->buf_offset + pos;
+            }
+            pos = match_end;
+        } else {
+            zlib_literal(&self->out, buf[pos]);
+            ++pos;
+        }
+    }
+    self->pos = pos;
+}
+
+STATIC void compio_finish(mp_obj_compio_t *self) {
+    compio_encode(self, 0);
+    zlib_finish_block(&self->out);
+    zlib_flush_bits(&self->out);
+    if (self->format == COMPIO_FORMAT_ZLIB) {
+        compio_out_bytes(self, self->checksum, 4, true);
+    } else if (self->format == COMPIO_FORMAT_GZIP) {
+        compio_out_bytes(self, self->checksum ^ 0xffffffff, 4, false);
+        compio_out_bytes(self, self->in_len, 4, false);
+    }
+    if (self->out.outlen != 0) {
+        compio_flush_out(&self->out);
+    }
+    self->closed = true;
+    m_del(uint16_t, self->hash, 1 << self->hash_bits);
+    self->hash = NULL;
+    if (self->hist != NULL) {
+        m_del(byte, self->hist, self->hist_size);
+        self->hist = NULL;
+    }
+    self->buf = NULL;
+}
+
+STATIC mp_obj_t compio_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+    mp_obj_compio_t *o = m_new_obj(mp_obj_compio_t);
+    o->base.type = type;
+    compio_init(o, n_args > 1 ? mp_obj_get_int(args[1]) : MICROPY_PY_UZLIB_COMPRESS_WBITS, args[0], NULL);
+    // room for the window behind the data being encoded, plus a run of data
+    // at least as long as the window so that sliding it back is infrequent
+    o->hist_size = 2 * o->window + COMPIO_LOOKAHEAD;
+    o->hist = m_new(byte, o->hist_size);
+    o->buf = o->hist;
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_uint_t compio_write(mp_obj_t o_in, const void *buf_in, mp_uint_t size, int *errcode) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    if (o->closed) {
+        *errcode = MP_EINVAL;
+        return MP_STREAM_ERROR;
+    }
+    const byte *buf = buf_in;
+    compio_add_checksum(o, buf, size);
+    for (mp_uint_t remain = size; remain > 0;) {
+        if (o->end == o->hist_size) {
+            // keep only a window's worth of the encoded data
+            size_t drop = o->pos - o->window;
+            memmove(o->hist, o->hist + drop, o->end - drop);
+            o->buf_offset += drop;
+            o->pos -= drop;
+            o->end -= drop;
+        }
+        size_t n = MIN(remain, o->hist_size - o->end);
+        memcpy(o->hist + o->end, buf, n);
+        o->end += n;
+        buf += n;
+        remain -= n;
+        compio_encode(o, COMPIO_LOOKAHEAD - 1);
+    }
+    return size;
+}
+
+STATIC mp_uint_t compio_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    (void)arg;
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    if (request == MP_STREAM_CLOSE) {
+        if (!o->closed) {
+            compio_finish(o);
+        }
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC mp_obj_t compio___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return mp_stream_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(compio___exit___obj, 4, 4, compio___exit__);
+
+STATIC const mp_rom_map_elem_t compio_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&compio___exit___obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(compio_locals_dict, compio_locals_dict_table);
+
+STATIC const mp_stream_p_t compio_stream_p = {
+    .write = compio_write,
+    .ioctl = compio_ioctl,
+};
+
+STATIC const mp_obj_type_t compio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_CompIO,
+    .make_new = compio_make_new,
+    .protocol = &compio_stream_p,
+    .locals_dict = (void*)&compio_locals_dict,
+};
+
+STATIC mp_obj_t mod_uzlib_compress(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    // args[1] is the compression level, which is ignored
+    mp_int_t wbits = 15;
+    if (n_args > 2) {
+        wbits = mp_obj_get_int(args[2]);
+    }
+
+    // the data is all available, so is encoded in place with no window buffer
+    vstr_t vstr;
+    vstr_init(&vstr, bufinfo.len / 2 + 16);
+    mp_obj_compio_t comp;
+    compio_init(&comp, wbits, MP_OBJ_NULL, &vstr);
+    compio_add_checksum(&comp, bufinfo.buf, bufinfo.len);
+    comp.buf = bufinfo.buf;
+    comp.end = bufinfo.len;
+    compio_finish(&comp);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_compress_obj, 1, 3, mod_uzlib_compress);
+
+#endif // MICROPY_PY_UZLIB_COMPRESS
+
 STATIC const mp_rom_map_elem_t mp_module_uzlib_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uzlib) },
     { MP_ROM_QSTR(MP_QSTR_decompress), MP_ROM_PTR(&mod_uzlib_decompress_obj) },
     { MP_ROM_QSTR(MP_QSTR_DecompIO), MP_ROM_PTR(&decompio_type) },
+    #if MICROPY_PY_UZLIB_COMPRESS
+    { MP_ROM_QSTR(MP_QSTR_compress), MP_ROM_PTR(&mod_uzlib_compress_obj) },
+    { MP_ROM_QSTR(MP_QSTR_CompIO), MP_ROM_PTR(&compio_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uzlib_globals, mp_module_uzlib_globals_table);
@@ -222,5 +518,8 @@ const mp_obj_module_t mp_module_uzlib = {
 #include "uzlib/tinfgzip.c"
 #include "uzlib/adler32.c"
 #include "uzlib/crc32.c"
+#if MICROPY_PY_UZLIB_COMPRESS
+#include "uzlib/defl_static.c"
+#endif
 
 #endif // MICROPY_PY_UZLIB
@@ -0,0 +1,155 @@
+// Copyright 2007-2009 Russ Cox.  All Rights Reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "re1.5.h"
+
+// Pike VM: runs all the threads of the program in lock step over the input,
+// so takes time proportional to the input length times the program length,
+// whatever the pattern.  Threads are kept in priority order and at most one
+// per instruction, so the match and submatches found are the same as a
+// backtracking search would give.
+
+typedef struct Pike Pike;
+struct Pike
+{
+	ByteProg *prog;
+	Subject *input;
+	int nsubp;
+	int *mark;	// gen when each instruction was last added to a list
+	int gen;
+};
+
+typedef struct ThreadList ThreadList;
+struct ThreadList
+{
+	int n;
+	const char **t;	// each thread is its pc followed by nsubp submatches
+};
+
+int
+re1_5_pikevm_memsize(ByteProg *prog, int nsubp)
+{
+	return 2 * prog->len * (nsubp + 1) * sizeof(const char*) + nsubp * sizeof(const char*)
+		+ prog->bytelen * sizeof(int);
+}
+
+static void
+addthread(Pike *p, ThreadList *l, const char *pc, const char **sub, const char *sp)
+{
+	const char *old;
+	int off;
+
+	re1_5_stack_chk();
+
+	if(p->mark[pc - p->prog->insts] == p->gen)
+		return;
+	p->mark[pc - p->prog->insts] = p->gen;
+
+	switch(*pc) {
+	case Jmp:
+		addthread(p, l, pc + 2 + (signed char)pc[1], sub, sp);
+		return;
+	case Split:
+		addthread(p, l, pc + 2, sub, sp);
+		addthread(p, l, pc + 2 + (signed char)pc[1], sub, sp);
+		return;
+	case RSplit:
+		addthread(p, l, pc + 2 + (signed char)pc[1], sub, sp);
+		addthread(p, l, pc + 2, sub, sp);
+		return;
+	case Save:
+		off = (unsigned char)pc[1];
+		if(off >= p->nsubp) {
+			addthread(p, l, pc + 2, sub, sp);
+			return;
+		}
+		old = sub[off];
+		sub[off] = sp;
+		addthread(p, l, pc + 2, sub, sp);
+		sub[off] = old;
+		return;
+	case Bol:
+		if(sp == p->input->begin)
+			addthread(p, l, pc + 1, sub, sp);
+		return;
+	case Eol:
+		if(sp == p->input->end)
+			addthread(p, l, pc + 1, sub, sp);
+		return;
+	}
+	// a consumer, or Match
+	const char **t = l->t + l->n++ * (p->nsubp + 1);
+	t[0] = pc;
+	memcpy(t + 1, sub, p->nsubp * sizeof(*sub));
+}
+
+// mem must be re1_5_pikevm_memsize(prog, nsubp) bytes
+int
+re1_5_pikevm(ByteProg *prog, Subject *input, const char **subp, int nsubp, int is_anchored, void *mem)
+{
+	Pike p = {prog, input, nsubp, nil, 0};
+	ThreadList lists[2], *clist, *nlist, *tmp;
+	const char **sub, *sp, *pc;
+	int i, matched;
+
+	lists[0].t = mem;
+	lists[1].t = lists[0].t + prog->len * (nsubp + 1);
+	sub = lists[1].t + prog->len * (nsubp + 1);
+	p.mark = (int*)(sub + nsubp);
+	memset(p.mark, 0, prog->bytelen * sizeof(int));
+	memset(sub, 0, nsubp * sizeof(*sub));
+
+	clist = &lists[0];
+	nlist = &lists[1];
+	clist->n = 0;
+	p.gen++;
+	addthread(&p, clist, HANDLE_ANCHORED(prog->insts, is_anchored), sub, input->begin);
+	matched = 0;
+	for(sp = input->begin; clist->n > 0; sp++) {
+		p.gen++;
+		nlist->n = 0;
+		for(i = 0; i < clist->n; i++) {
+			sub = clist->t + i * (nsubp + 1);
+			pc = *sub++;
+			if(*pc == Match) {
+				// threads after this one have lower priority, so are cut off
+				memcpy(subp, sub, nsubp * sizeof(*sub));
+				matched = 1;
+				break;
+			}
+			if(sp >= input->end)
+				continue;
+			switch(*pc) {
+			case Char:
+				if(*sp != pc[1])
+					continue;
+				pc += 2;
+				break;
+			case Any:
+				pc++;
+				break;
+			case Class:
+			case ClassNot:
+				if(!_re1_5_classmatch(pc + 1, sp))
+					continue;
+				pc += (unsigned char)pc[1] * 2 + 2;
+				break;
+			case NamedClass:
+				if(!_re1_5_namedclassmatch(pc + 1, sp))
+					continue;
+				pc += 2;
+				break;
+			default:
+				re1_5_fatal("pikevm");
+			}
+			addthread(&p, nlist, pc, sub, sp + 1);
+		}
+		if(sp >= input->end)
+			break;
+		tmp = clist;
+		clist = nlist;
+		nlist = tmp;
+	}
+	return matched;
+}
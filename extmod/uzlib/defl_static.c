@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) uzlib authors
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely, subject to
+ * the following restrictions:
+ *
+ * 1. The origin of this software must not be
+ *    misrepresented; you must not claim that you
+ *    wrote the original software. If you use this
+ *    software in a product, an acknowledgment in
+ *    the product documentation would be appreciated
+ *    but is not required.
+ *
+ * 2. Altered source versions must be plainly marked
+ *    as such, and must not be misrepresented as
+ *    being the original software.
+ *
+ * 3. This notice may not be removed or altered from
+ *    any source distribution.
+ */
+
+/* Encoder for DEFLATE blocks with the fixed Huffman codes (RFC 1951,
+   section 3.2.6), fed with literals and matches by an LZ77 stage. */
+
+#include "uzlib.h"
+
+/* the bases and extra bits of the length and distance codes are shared with
+   tinflate.c */
+#ifndef RUNTIME_BITS_TABLES
+extern const unsigned char length_bits[30];
+extern const unsigned short length_base[30];
+extern const unsigned char dist_bits[30];
+extern const unsigned short dist_base[30];
+#endif
+
+void outbits(struct Outbuf *out, unsigned long bits, int nbits)
+{
+    out->outbits |= bits << out->noutbits;
+    out->noutbits += nbits;
+    while (out->noutbits >= 8) {
+        if (out->outlen >= out->outsize) {
+            out->flush(out);
+        }
+        out->outbuf[out->outlen++] = out->outbits & 0xff;
+        out->outbits >>= 8;
+        out->noutbits -= 8;
+    }
+}
+
+/* Huffman codes are packed starting from their most significant bit */
+static void outcode(struct Outbuf *out, unsigned int code, int nbits)
+{
+    unsigned int rev = 0;
+    int i;
+    for (i = 0; i < nbits; i++) {
+        rev = (rev << 1) | (code & 1);
+        code >>= 1;
+    }
+    outbits(out, rev, nbits);
+}
+
+static void outsym(struct Outbuf *out, unsigned int sym)
+{
+    if (sym < 144) {
+        outcode(out, 0x30 + sym, 8);
+    } else if (sym < 256) {
+        outcode(out, 0x190 + sym - 144, 9);
+    } else if (sym < 280) {
+        outcode(out, sym - 256, 7);
+    } else {
+        outcode(out, 0xc0 + sym - 280, 8);
+    }
+}
+
+void zlib_start_block(struct Outbuf *out)
+{
+    outbits(out, 1, 1); /* final block */
+    outbits(out, 1, 2); /* fixed Huffman codes */
+}
+
+void zlib_finish_block(struct Outbuf *out)
+{
+    outsym(out, 256); /* end of block */
+}
+
+/* pad out to a whole byte, so that all the bits reach outbuf */
+void zlib_flush_bits(struct Outbuf *out)
+{
+    if (out->noutbits > 0) {
+        outbits(out, 0, 8 - out->noutbits);
+    }
+}
+
+void zlib_literal(struct Outbuf *out, unsigned char c)
+{
+    outsym(out, c);
+}
+
+/* len must be 3..258 and distance 1..32768 */
+void zlib_match(struct Outbuf *out, int distance, int len)
+{
+    int i = 28;
+    while (len < length_base[i]) {
+        i--;
+    }
+    outsym(out, 257 + i);
+    outbits(out, len - length_base[i], length_bits[i]);
+
+    i = 29;
+    while (distance < dist_base[i]) {
+        i--;
+    }
+    outcode(out, i, 5);
+    outbits(out, distance - dist_base[i], dist_bits[i]);
+}
@@ -36,6 +36,8 @@ struct Outbuf {
     unsigned long outbits;
     int noutbits;
     int comp_disabled;
+    /* called when outbuf is full, must make room by lowering outlen */
+    void (*flush)(struct Outbuf *out);
 };
 
 void outbits(struct Outbuf *out, unsigned long bits, int nbits);
@@ -43,3 +45,4 @@ void zlib_start_block(struct Outbuf *ctx);
 void zlib_finish_block(struct Outbuf *ctx);
 void zlib_literal(struct Outbuf *ectx, unsigned char c);
 void zlib_match(struct Outbuf *ectx, int distance, int len);
+void zlib_flush_bits(struct Outbuf *ctx);
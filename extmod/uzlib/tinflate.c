@@ -121,6 +121,35 @@ static void tinf_build_bits_base(unsigned char *bits, unsigned short *base, int
 }
 #endif
 
+#if UZLIB_CONF_LOOKUP_BITS
+/* fill in the lookup table from the code length counts and symbols */
+static void tinf_build_lookup(TINF_TREE *t)
+{
+   unsigned int len, i, n, code = 0, idx = 0;
+
+   for (i = 0; i < (1 << UZLIB_CONF_LOOKUP_BITS); ++i) t->lookup[i] = 0;
+
+   /* codes are assigned in order of length, then of symbol */
+   for (len = 1; len <= UZLIB_CONF_LOOKUP_BITS; ++len, code <<= 1)
+   {
+      for (n = t->table[len]; n; --n, ++code)
+      {
+         /* the first bit of the code is the first bit read, so the lowest
+            bit of the index */
+         unsigned int rev = 0, c = code;
+         for (i = 0; i < len; ++i, c >>= 1) rev = (rev << 1) | (c & 1);
+         for (; rev < (1 << UZLIB_CONF_LOOKUP_BITS); rev += 1 << len)
+         {
+            t->lookup[rev] = t->trans[idx] << 4 | len;
+         }
+         ++idx;
+      }
+   }
+}
+#else
+#define tinf_build_lookup(t)
+#endif
+
 /* build the fixed huffman trees */
 static void tinf_build_fixed_trees(TINF_TREE *lt, TINF_TREE *dt)
 {
@@ -144,6 +173,9 @@ static void tinf_build_fixed_trees(TINF_TREE *lt, TINF_TREE *dt)
    dt->table[5] = 32;
 
    for (i = 0; i < 32; ++i) dt->trans[i] = i;
+
+   tinf_build_lookup(lt);
+   tinf_build_lookup(dt);
 }
 
 /* given an array of code lengths, build a tree */
@@ -183,6 +215,8 @@ static void tinf_build_tree(TINF_TREE *t, const unsigned char *lengths, unsigned
    {
       if (lengths[i]) t->trans[offs[lengths[i]]++] = i;
    }
+
+   tinf_build_lookup(t);
 }
 
 /* ---------------------- *
@@ -235,22 +269,28 @@ uint32_t tinf_get_be_uint32(TINF_DATA *d)
     return val;
 }
 
+/* load whole bytes into tag until it has at least num bits; bytes are only
+   read when needed, so fewer than 8 bits are left over after taking num */
+static void tinf_need_bits(TINF_DATA *d, unsigned int num)
+{
+   while (d->bitcount < num)
+   {
+      d->tag |= (unsigned int)uzlib_get_byte(d) << d->bitcount;
+      d->bitcount += 8;
+   }
+}
+
 /* get one bit from source stream */
 static int tinf_getbit(TINF_DATA *d)
 {
    unsigned int bit;
 
-   /* check if tag is empty */
-   if (!d->bitcount--)
-   {
-      /* load next tag */
-      d->tag = uzlib_get_byte(d);
-      d->bitcount = 7;
-   }
+   tinf_need_bits(d, 1);
 
    /* shift bit out of tag */
    bit = d->tag & 0x01;
    d->tag >>= 1;
+   d->bitcount--;
 
    return bit;
 }
@@ -263,11 +303,10 @@ static unsigned int tinf_read_bits(TINF_DATA *d, int num, int base)
    /* read num bits */
    if (num)
    {
-      unsigned int limit = 1 << (num);
-      unsigned int mask;
-
-      for (mask = 1; mask < limit; mask *= 2)
-         if (tinf_getbit(d)) val += mask;
+      tinf_need_bits(d, num);
+      val = d->tag & ((1 << num) - 1);
+      d->tag >>= num;
+      d->bitcount -= num;
    }
 
    return val + base;
@@ -278,6 +317,29 @@ static int tinf_decode_symbol(TINF_DATA *d, TINF_TREE *t)
 {
    int sum = 0, cur = 0, len = 0;
 
+   #if UZLIB_CONF_LOOKUP_BITS
+   /* Bits of tag above bitcount are 0, so an entry found with fewer bits
+      than the table is indexed by is right if its code is no longer than
+      the bits there are, and otherwise another byte is needed. */
+   for (;;)
+   {
+      unsigned int entry = t->lookup[d->tag & ((1 << UZLIB_CONF_LOOKUP_BITS) - 1)];
+      unsigned int elen = entry & 15;
+      if (elen != 0 && elen <= d->bitcount)
+      {
+         d->tag >>= elen;
+         d->bitcount -= elen;
+         return entry >> 4;
+      }
+      if (d->bitcount >= UZLIB_CONF_LOOKUP_BITS)
+      {
+         /* a longer code, which is decoded bit by bit from the start */
+         break;
+      }
+      tinf_need_bits(d, d->bitcount + 1);
+   }
+   #endif
+
    /* get more bits while code value is above sum */
    do {
 
@@ -402,86 +464,100 @@ static int tinf_decode_trees(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
  * -- block inflate functions -- *
  * ----------------------------- */
 
-/* given a stream and two trees, inflate next byte of output */
+/* given a stream and two trees, inflate output until dest_limit is reached
+   or the block ends */
 static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
 {
-    if (d->curlen == 0) {
-        unsigned int offs;
-        int dist;
-        int sym = tinf_decode_symbol(d, lt);
-        //printf("huff sym: %02x\n", sym);
+    do {
+        if (d->curlen == 0) {
+            unsigned int offs;
+            int dist;
+            int sym = tinf_decode_symbol(d, lt);
+            //printf("huff sym: %02x\n", sym);
 
-        if (d->eof) {
-            return TINF_DATA_ERROR;
-        }
+            if (d->eof) {
+                return TINF_DATA_ERROR;
+            }
 
-        /* literal byte */
-        if (sym < 256) {
-            TINF_PUT(d, sym);
-            return TINF_OK;
-        }
+            /* literal byte */
+            if (sym < 256) {
+                TINF_PUT(d, sym);
+                continue;
+            }
 
-        /* end of block */
-        if (sym == 256) {
-            return TINF_DONE;
-        }
+            /* end of block */
+            if (sym == 256) {
+                return TINF_DONE;
+            }
 
-        /* substring from sliding dictionary */
-        sym -= 257;
-        if (sym >= 29) {
-            return TINF_DATA_ERROR;
-        }
+            /* substring from sliding dictionary */
+            sym -= 257;
+            if (sym >= 29) {
+                return TINF_DATA_ERROR;
+            }
 
-        /* possibly get more bits from length code */
-        d->curlen = tinf_read_bits(d, length_bits[sym], length_base[sym]);
+            /* possibly get more bits from length code */
+            d->curlen = tinf_read_bits(d, length_bits[sym], length_base[sym]);
 
-        dist = tinf_decode_symbol(d, dt);
-        if (dist >= 30) {
-            return TINF_DATA_ERROR;
-        }
+            dist = tinf_decode_symbol(d, dt);
+            if (dist >= 30) {
+                return TINF_DATA_ERROR;
+            }
 
-        /* possibly get more bits from distance code */
-        offs = tinf_read_bits(d, dist_bits[dist], dist_base[dist]);
+            /* possibly get more bits from distance code */
+            offs = tinf_read_bits(d, dist_bits[dist], dist_base[dist]);
 
-        /* calculate and validate actual LZ offset to use */
-        if (d->dict_ring) {
-            if (offs > d->dict_size) {
-                return TINF_DICT_ERROR;
+            /* calculate and validate actual LZ offset to use */
+            if (d->dict_ring) {
+                if (offs > d->dict_size) {
+                    return TINF_DICT_ERROR;
+                }
+                /* Note: unlike full-dest-in-memory case below, we don't
+                   try to catch offset which points to not yet filled
+                   part of the dictionary here. Doing so would require
+                   keeping another variable to track "filled in" size
+                   of the dictionary. Appearance of such an offset cannot
+                   lead to accessing memory outside of the dictionary
+                   buffer, and clients which don't want to leak unrelated
+                   information, should explicitly initialize dictionary
+                   buffer passed to uzlib. */
+
+                d->lzOff = d->dict_idx - offs;
+                if (d->lzOff < 0) {
+                    d->lzOff += d->dict_size;
+                }
+            } else {
+                /* catch trying to point before the start of dest buffer */
+                if (offs > d->dest - d->destStart) {
+                    return TINF_DATA_ERROR;
+                }
+                d->lzOff = -offs;
             }
-            /* Note: unlike full-dest-in-memory case below, we don't
-               try to catch offset which points to not yet filled
-               part of the dictionary here. Doing so would require
-               keeping another variable to track "filled in" size
-               of the dictionary. Appearance of such an offset cannot
-               lead to accessing memory outside of the dictionary
-               buffer, and clients which don't want to leak unrelated
-               information, should explicitly initialize dictionary
-               buffer passed to uzlib. */
-
-            d->lzOff = d->dict_idx - offs;
-            if (d->lzOff < 0) {
-                d->lzOff += d->dict_size;
+        }
+
+        /* copy as much of the dict substring as there is room for */
+        if (d->dict_ring) {
+            while (d->curlen != 0 && d->dest < d->dest_limit) {
+                TINF_PUT(d, d->dict_ring[d->lzOff]);
+                if ((unsigned)++d->lzOff == d->dict_size) {
+                    d->lzOff = 0;
+                }
+                d->curlen--;
             }
         } else {
-            /* catch trying to point before the start of dest buffer */
-            if (offs > d->dest - d->destStart) {
-                return TINF_DATA_ERROR;
+            unsigned char *dest = d->dest;
+            unsigned int n = d->dest_limit - dest;
+            if (n > d->curlen) {
+                n = d->curlen;
             }
-            d->lzOff = -offs;
+            d->curlen -= n;
+            for (; n; --n, ++dest) {
+                dest[0] = dest[d->lzOff];
+            }
+            d->dest = dest;
         }
-    }
+    } while (d->dest < d->dest_limit);
 
-    /* copy next byte from dict substring */
-    if (d->dict_ring) {
-        TINF_PUT(d, d->dict_ring[d->lzOff]);
-        if ((unsigned)++d->lzOff == d->dict_size) {
-            d->lzOff = 0;
-        }
-    } else {
-        d->dest[0] = d->dest[d->lzOff];
-        d->dest++;
-    }
-    d->curlen--;
     return TINF_OK;
 }
 
@@ -505,6 +581,7 @@ static int tinf_inflate_uncompressed_block(TINF_DATA *d)
         d->curlen = length + 1;
 
         /* make sure we start next block on a byte boundary */
+        d->tag = 0;
         d->bitcount = 0;
     }
 
@@ -539,6 +616,7 @@ void uzlib_init(void)
 void uzlib_uncompress_init(TINF_DATA *d, void *dict, unsigned int dictLen)
 {
    d->eof = 0;
+   d->tag = 0;
    d->bitcount = 0;
    d->bfinal = 0;
    d->btype = -1;
@@ -80,6 +80,11 @@ extern "C" {
 typedef struct {
    unsigned short table[16];  /* table of code length counts */
    unsigned short trans[288]; /* code -> symbol translation table */
+#if UZLIB_CONF_LOOKUP_BITS
+   /* symbol << 4 | code length, indexed by the next UZLIB_CONF_LOOKUP_BITS
+      bits of input, or 0 if the code is longer than that */
+   unsigned short lookup[1 << UZLIB_CONF_LOOKUP_BITS];
+#endif
 } TINF_TREE;
 
 struct uzlib_uncomp {
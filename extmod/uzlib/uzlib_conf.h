@@ -19,4 +19,15 @@
 #define UZLIB_CONF_PARANOID_CHECKS 0
 #endif
 
+#ifndef UZLIB_CONF_LOOKUP_BITS
+/* Number of bits of Huffman code decoded with a single table lookup, with
+   longer codes decoded bit by bit. Each tree takes 2 * 2^N bytes for the
+   table. 0 decodes all codes bit by bit. */
+#ifdef MICROPY_PY_UZLIB_LOOKUP_BITS
+#define UZLIB_CONF_LOOKUP_BITS MICROPY_PY_UZLIB_LOOKUP_BITS
+#else
+#define UZLIB_CONF_LOOKUP_BITS 0
+#endif
+#endif
+
 #endif /* UZLIB_CONF_H_INCLUDED */
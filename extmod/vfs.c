@@ -44,13 +44,14 @@
 
 // For mp_vfs_proxy_call, the maximum number of additional args that can be passed.
 // A fixed maximum size is used to avoid the need for a costly variable array.
-#define PROXY_MAX_ARGS (2)
+#define PROXY_MAX_ARGS (3)
 
 // path is the path to lookup and *path_out holds the path within the VFS
 // object (starts with / if an absolute path).
 // Returns MP_VFS_ROOT for root dir (and then path_out is undefined) and
 // MP_VFS_NONE for path not found.
 mp_vfs_mount_t *mp_vfs_lookup_path(const char *path, const char **path_out) {
+    MICROPY_VFS_LAZY_MOUNT_HOOK();
     if (*path == '/' || MP_STATE_VM(vfs_cur) == MP_VFS_ROOT) {
         // an absolute path, or the current volume is root, so search root dir
         bool is_abs = 0;
@@ -122,7 +123,47 @@ STATIC mp_obj_t mp_vfs_proxy_call(mp_vfs_mount_t *vfs, qstr meth_name, size_t n_
     return mp_call_method_n_kw(n_args, 0, meth);
 }
 
+#if MICROPY_VFS_STAT_CACHE_SIZE
+// This may be called from an IRQ, eg when USB MSC writes to a block device
+void mp_vfs_stat_cache_clear(void) {
+    for (size_t i = 0; i < 2 * MICROPY_VFS_STAT_CACHE_SIZE; i += 2) {
+        MP_STATE_VM(vfs_stat_cache[i]) = MP_OBJ_NULL;
+    }
+}
+
+STATIC mp_import_stat_t vfs_import_stat(const char *path);
+
+mp_import_stat_t mp_vfs_import_stat(const char *path) {
+    mp_obj_t *cache = MP_STATE_VM(vfs_stat_cache);
+    size_t len = strlen(path);
+    for (size_t i = 0; i < 2 * MICROPY_VFS_STAT_CACHE_SIZE; i += 2) {
+        if (cache[i] != MP_OBJ_NULL) {
+            size_t l;
+            const char *s = mp_obj_str_get_data(cache[i], &l);
+            if (l == len && memcmp(s, path, len) == 0) {
+                return MP_OBJ_SMALL_INT_VALUE(cache[i + 1]);
+            }
+        }
+    }
+
+    mp_import_stat_t stat = vfs_import_stat(path);
+
+    // replace the oldest entry, moving the others down
+    memmove(cache + 2, cache, (2 * MICROPY_VFS_STAT_CACHE_SIZE - 2) * sizeof(mp_obj_t));
+    cache[0] = mp_obj_new_str(path, len);
+    cache[1] = MP_OBJ_NEW_SMALL_INT(stat);
+    return stat;
+}
+
+// A change to the files through the VFS may change the result of any lookup
+#define VFS_STAT_CACHE_CLEAR() mp_vfs_stat_cache_clear()
+
+STATIC mp_import_stat_t vfs_import_stat(const char *path) {
+#else
+#define VFS_STAT_CACHE_CLEAR()
+
 mp_import_stat_t mp_vfs_import_stat(const char *path) {
+#endif
     const char *path_out;
     mp_vfs_mount_t *vfs = mp_vfs_lookup_path(path, &path_out);
     if (vfs == MP_VFS_NONE || vfs == MP_VFS_ROOT) {
@@ -163,6 +204,9 @@ mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args
         { MP_QSTR_mkfs, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_false_obj)} },
     };
 
+    // the port's own filesystems go first in the mount table
+    MICROPY_VFS_LAZY_MOUNT_HOOK();
+
     // parse args
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args - 2, pos_args + 2, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
@@ -217,12 +261,15 @@ mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args
         vfsp = &(*vfsp)->next;
     }
     *vfsp = vfs;
+    VFS_STAT_CACHE_CLEAR();
 
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mp_vfs_mount_obj, 2, mp_vfs_mount);
 
 mp_obj_t mp_vfs_umount(mp_obj_t mnt_in) {
+    MICROPY_VFS_LAZY_MOUNT_HOOK();
+
     // remove vfs from the mount table
     mp_vfs_mount_t *vfs = NULL;
     size_t mnt_len;
@@ -241,6 +288,7 @@ mp_obj_t mp_vfs_umount(mp_obj_t mnt_in) {
     if (vfs == NULL) {
         mp_raise_OSError(MP_EINVAL);
     }
+    VFS_STAT_CACHE_CLEAR();
 
     // if we unmounted the current device then set current to root
     if (MP_STATE_VM(vfs_cur) == vfs) {
@@ -254,14 +302,16 @@ mp_obj_t mp_vfs_umount(mp_obj_t mnt_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_umount_obj, mp_vfs_umount);
 
-// Note: buffering and encoding args are currently ignored
+// Note: buffering and encoding args are currently ignored.  fastseek is
+// passed on to the filesystem's open as a third argument, only when set.
 mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_file, ARG_mode, ARG_encoding };
+    enum { ARG_file, ARG_mode, ARG_buffering, ARG_encoding, ARG_fastseek };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_file, MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
         { MP_QSTR_mode, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_QSTR(MP_QSTR_r)} },
         { MP_QSTR_buffering, MP_ARG_INT, {.u_int = -1} },
         { MP_QSTR_encoding, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+        { MP_QSTR_fastseek, MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false} },
     };
 
     // parse args
@@ -276,6 +326,16 @@ mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args)
     #endif
 
     mp_vfs_mount_t *vfs = lookup_path(args[ARG_file].u_obj, &args[ARG_file].u_obj);
+    #if MICROPY_VFS_STAT_CACHE_SIZE
+    if (strpbrk(mp_obj_str_get_str(args[ARG_mode].u_obj), "wax+") != NULL) {
+        // opening to write may create the file
+        VFS_STAT_CACHE_CLEAR();
+    }
+    #endif
+    if (args[ARG_fastseek].u_bool) {
+        mp_obj_t open_args[3] = {args[ARG_file].u_obj, args[ARG_mode].u_obj, mp_const_true};
+        return mp_vfs_proxy_call(vfs, MP_QSTR_open, 3, open_args);
+    }
     return mp_vfs_proxy_call(vfs, MP_QSTR_open, 2, (mp_obj_t*)&args);
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mp_vfs_open_obj, 0, mp_vfs_open);
@@ -284,6 +344,8 @@ mp_obj_t mp_vfs_chdir(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
     MP_STATE_VM(vfs_cur) = vfs;
+    // relative paths now name other files
+    VFS_STAT_CACHE_CLEAR();
     if (vfs == MP_VFS_ROOT) {
         // If we change to the root dir and a VFS is mounted at the root then
         // we must change that VFS's current dir to the root dir so that any
@@ -303,6 +365,7 @@ mp_obj_t mp_vfs_chdir(mp_obj_t path_in) {
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_chdir_obj, mp_vfs_chdir);
 
 mp_obj_t mp_vfs_getcwd(void) {
+    MICROPY_VFS_LAZY_MOUNT_HOOK();
     if (MP_STATE_VM(vfs_cur) == MP_VFS_ROOT) {
         return MP_OBJ_NEW_QSTR(MP_QSTR__slash_);
     }
@@ -407,6 +470,7 @@ mp_obj_t mp_vfs_mkdir(mp_obj_t path_in) {
     if (vfs == MP_VFS_ROOT || (vfs != MP_VFS_NONE && !strcmp(mp_obj_str_get_str(path_out), "/"))) {
         mp_raise_OSError(MP_EEXIST);
     }
+    VFS_STAT_CACHE_CLEAR();
     return mp_vfs_proxy_call(vfs, MP_QSTR_mkdir, 1, &path_out);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_mkdir_obj, mp_vfs_mkdir);
@@ -414,6 +478,7 @@ MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_mkdir_obj, mp_vfs_mkdir);
 mp_obj_t mp_vfs_remove(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
+    VFS_STAT_CACHE_CLEAR();
     return mp_vfs_proxy_call(vfs, MP_QSTR_remove, 1, &path_out);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_remove_obj, mp_vfs_remove);
@@ -426,6 +491,7 @@ mp_obj_t mp_vfs_rename(mp_obj_t old_path_in, mp_obj_t new_path_in) {
         // can't rename across filesystems
         mp_raise_OSError(MP_EPERM);
     }
+    VFS_STAT_CACHE_CLEAR();
     return mp_vfs_proxy_call(old_vfs, MP_QSTR_rename, 2, args);
 }
 MP_DEFINE_CONST_FUN_OBJ_2(mp_vfs_rename_obj, mp_vfs_rename);
@@ -433,6 +499,7 @@ MP_DEFINE_CONST_FUN_OBJ_2(mp_vfs_rename_obj, mp_vfs_rename);
 mp_obj_t mp_vfs_rmdir(mp_obj_t path_in) {
     mp_obj_t path_out;
     mp_vfs_mount_t *vfs = lookup_path(path_in, &path_out);
+    VFS_STAT_CACHE_CLEAR();
     return mp_vfs_proxy_call(vfs, MP_QSTR_rmdir, 1, &path_out);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_rmdir_obj, mp_vfs_rmdir);
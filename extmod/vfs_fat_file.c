@@ -151,12 +151,39 @@ STATIC mp_uint_t file_obj_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg,
     }
 }
 
+#if FF_USE_FASTSEEK
+// Build the cluster link map of the file, so seeks look the cluster up in
+// it instead of following the FAT chain from the start of the file.  The
+// map is on the heap, kept alive by the pointer to it in the FIL.
+STATIC FRESULT file_create_linkmap(FIL *fp) {
+    // Start with room for a few fragments, then grow to the size FatFs asks for
+    size_t len = 2 + 2 * 4;
+    DWORD *tbl = m_new(DWORD, len);
+    for (;;) {
+        tbl[0] = len;
+        fp->cltbl = tbl;
+        FRESULT res = f_lseek(fp, CREATE_LINKMAP);
+        if (res != FR_NOT_ENOUGH_CORE) {
+            if (res != FR_OK) {
+                fp->cltbl = NULL;
+                m_del(DWORD, tbl, len);
+            }
+            return res;
+        }
+        size_t new_len = tbl[0];
+        tbl = m_renew(DWORD, tbl, len, new_len);
+        len = new_len;
+    }
+}
+#endif
+
 // Note: encoding is ignored for now; it's also not a valid kwarg for CPython's FileIO,
 // but by adding it here we can use one single mp_arg_t array for open() and FileIO's constructor
 STATIC const mp_arg_t file_open_args[] = {
     { MP_QSTR_file, MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
     { MP_QSTR_mode, MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_QSTR(MP_QSTR_r)} },
     { MP_QSTR_encoding, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+    { MP_QSTR_fastseek, MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false} },
 };
 #define FILE_OPEN_NUM_ARGS MP_ARRAY_SIZE(file_open_args)
 
@@ -192,6 +219,17 @@ STATIC mp_obj_t file_open(fs_user_mount_t *vfs, const mp_obj_type_t *type, mp_ar
         }
     }
 
+    if (args[3].u_bool) {
+        #if FF_USE_FASTSEEK
+        // In fast seek mode the file can't grow, so only allow reading
+        if (mode & FA_WRITE) {
+            mp_raise_ValueError("fastseek needs read-only mode");
+        }
+        #else
+        mp_raise_ValueError("fastseek not supported");
+        #endif
+    }
+
     pyb_file_obj_t *o = m_new_obj_with_finaliser(pyb_file_obj_t);
     o->base.type = type;
 
@@ -208,6 +246,16 @@ STATIC mp_obj_t file_open(fs_user_mount_t *vfs, const mp_obj_type_t *type, mp_ar
         f_lseek(&o->fp, f_size(&o->fp));
     }
 
+    #if FF_USE_FASTSEEK
+    if (args[3].u_bool) {
+        res = file_create_linkmap(&o->fp);
+        if (res != FR_OK) {
+            f_close(&o->fp);
+            mp_raise_OSError(fresult_to_errno_table[res]);
+        }
+    }
+    #endif
+
     return MP_OBJ_FROM_PTR(o);
 }
 
@@ -274,15 +322,17 @@ const mp_obj_type_t mp_type_vfs_fat_textio = {
 };
 
 // Factory function for I/O stream classes
-STATIC mp_obj_t fatfs_builtin_open_self(mp_obj_t self_in, mp_obj_t path, mp_obj_t mode) {
+// The optional third argument enables fast seeking, see file_open.
+STATIC mp_obj_t fatfs_builtin_open_self(size_t n_args, const mp_obj_t *args) {
     // TODO: analyze buffering args and instantiate appropriate type
-    fs_user_mount_t *self = MP_OBJ_TO_PTR(self_in);
+    fs_user_mount_t *self = MP_OBJ_TO_PTR(args[0]);
     mp_arg_val_t arg_vals[FILE_OPEN_NUM_ARGS];
-    arg_vals[0].u_obj = path;
-    arg_vals[1].u_obj = mode;
+    arg_vals[0].u_obj = args[1];
+    arg_vals[1].u_obj = args[2];
     arg_vals[2].u_obj = mp_const_none;
+    arg_vals[3].u_bool = n_args > 3 && mp_obj_is_true(args[3]);
     return file_open(self, &mp_type_vfs_fat_textio, arg_vals);
 }
-MP_DEFINE_CONST_FUN_OBJ_3(fat_vfs_open_obj, fatfs_builtin_open_self);
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(fat_vfs_open_obj, 3, 4, fatfs_builtin_open_self);
 
 #endif // MICROPY_VFS && MICROPY_VFS_FAT
@@ -44,18 +44,30 @@
 
 enum { ESEQ_NONE, ESEQ_ESC, ESEQ_ESC_BRACKET, ESEQ_ESC_BRACKET_DIGIT, ESEQ_ESC_O };
 
+// The history lines are kept in a fixed pool, oldest first, and
+// readline_hist[0] points to the most recent one.  The pointers still live
+// in readline_hist for the ports that read the history back.
+STATIC char readline_hist_pool[MICROPY_READLINE_HISTORY_BYTES];
+STATIC size_t readline_hist_pool_len;
+
 void readline_init0(void) {
     memset(MP_STATE_PORT(readline_hist), 0, READLINE_HIST_SIZE * sizeof(const char*));
+    readline_hist_pool_len = 0;
 }
 
-STATIC char *str_dup_maybe(const char *str) {
-    uint32_t len = strlen(str);
-    char *s2 = m_new_maybe(char, len + 1);
-    if (s2 == NULL) {
-        return NULL;
+// Drop the oldest history line, which is at the start of the pool.
+STATIC void readline_hist_drop_oldest(void) {
+    int oldest = READLINE_HIST_SIZE - 1;
+    while (MP_STATE_PORT(readline_hist)[oldest] == NULL) {
+        --oldest;
+    }
+    size_t len = strlen(readline_hist_pool) + 1;
+    readline_hist_pool_len -= len;
+    memmove(readline_hist_pool, readline_hist_pool + len, readline_hist_pool_len);
+    MP_STATE_PORT(readline_hist)[oldest] = NULL;
+    for (int i = 0; i < oldest; i++) {
+        MP_STATE_PORT(readline_hist)[i] -= len;
     }
-    memcpy(s2, str, len + 1);
-    return s2;
 }
 
 // By default assume terminal which implements VT100 commands...
@@ -435,13 +447,21 @@ void readline_push_history(const char *line) {
         && (MP_STATE_PORT(readline_hist)[0] == NULL
             || strcmp(MP_STATE_PORT(readline_hist)[0], line) != 0)) {
         // a line which is not empty and different from the last one
-        // so update the history
-        char *most_recent_hist = str_dup_maybe(line);
-        if (most_recent_hist != NULL) {
-            for (int i = READLINE_HIST_SIZE - 1; i > 0; i--) {
-                MP_STATE_PORT(readline_hist)[i] = MP_STATE_PORT(readline_hist)[i - 1];
-            }
-            MP_STATE_PORT(readline_hist)[0] = most_recent_hist;
+        // so update the history, unless it could never fit in the pool
+        size_t len = strlen(line) + 1;
+        if (len > sizeof(readline_hist_pool)) {
+            return;
+        }
+        while (MP_STATE_PORT(readline_hist)[READLINE_HIST_SIZE - 1] != NULL
+            || readline_hist_pool_len + len > sizeof(readline_hist_pool)) {
+            readline_hist_drop_oldest();
+        }
+        char *most_recent_hist = readline_hist_pool + readline_hist_pool_len;
+        memcpy(most_recent_hist, line, len);
+        readline_hist_pool_len += len;
+        for (int i = READLINE_HIST_SIZE - 1; i > 0; i--) {
+            MP_STATE_PORT(readline_hist)[i] = MP_STATE_PORT(readline_hist)[i - 1];
         }
+        MP_STATE_PORT(readline_hist)[0] = most_recent_hist;
     }
 }
@@ -3655,7 +3655,22 @@ FRESULT f_read (
             cc = btr / SS(fs);                  /* When remaining bytes >= sector size, */
             if (cc > 0) {                       /* Read maximum contiguous sectors directly */
                 if (csect + cc > fs->csize) {   /* Clip at cluster boundary */
+                    UINT rest = cc - (fs->csize - csect);
                     cc = fs->csize - csect;
+                    /* Extend the read over following clusters that are consecutive on the volume */
+                    while (rest >= fs->csize && cc + fs->csize <= 128) {
+#if FF_USE_FASTSEEK
+                        if (fp->cltbl) {
+                            clst = clmt_clust(fp, fp->fptr + (FSIZE_t)cc * SS(fs));
+                        } else
+#endif
+                        {
+                            clst = get_fat(&fp->obj, fp->clust);
+                        }
+                        if (clst != fp->clust + 1) break;   /* Not consecutive, or end of chain or error found on the next pass */
+                        fp->clust = clst;
+                        cc += fs->csize; rest -= fs->csize;
+                    }
                 }
                 if (disk_read(fs->drv, rbuff, sect, cc) != RES_OK) ABORT(fs, FR_DISK_ERR);
 #if !FF_FS_READONLY && FF_FS_MINIMIZE <= 2      /* Replace one of the read sectors with cached data if it contains a dirty sector */
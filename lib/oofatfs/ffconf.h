@@ -73,7 +73,11 @@
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
+#ifdef MICROPY_FATFS_USE_FASTSEEK
+#define FF_USE_FASTSEEK (MICROPY_FATFS_USE_FASTSEEK)
+#else
 #define FF_USE_FASTSEEK 0
+#endif
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
@@ -282,7 +286,11 @@
 / System Configurations
 /---------------------------------------------------------------------------*/
 
+#ifdef MICROPY_FATFS_TINY
+#define FF_FS_TINY      (MICROPY_FATFS_TINY)
+#else
 #define FF_FS_TINY      1
+#endif
 /* This option switches tiny buffer configuration. (0:Normal or 1:Tiny)
 /  At the tiny configuration, size of file object (FIL) is shrinked FF_MAX_SS bytes.
 /  Instead of private sector buffer eliminated from the file object, common sector
@@ -53,6 +53,7 @@ STATIC bool repl_display_debugging_info = 0;
 #define EXEC_FLAG_SOURCE_IS_RAW_CODE (8)
 #define EXEC_FLAG_SOURCE_IS_VSTR (16)
 #define EXEC_FLAG_SOURCE_IS_FILENAME (32)
+#define EXEC_FLAG_SOURCE_IS_READER (64)
 
 // parses, compiles and executes the code in the lexer
 // frees the lexer before returning
@@ -83,6 +84,8 @@ STATIC int parse_compile_execute(const void *source, mp_parse_input_kind_t input
                 lex = mp_lexer_new_from_str_len(MP_QSTR__lt_stdin_gt_, vstr->buf, vstr->len, 0);
             } else if (exec_flags & EXEC_FLAG_SOURCE_IS_FILENAME) {
                 lex = mp_lexer_new_from_file(source);
+            } else if (exec_flags & EXEC_FLAG_SOURCE_IS_READER) {
+                lex = mp_lexer_new(MP_QSTR__lt_stdin_gt_, *(mp_reader_t*)source);
             } else {
                 lex = (mp_lexer_t*)source;
             }
@@ -151,6 +154,110 @@ STATIC int parse_compile_execute(const void *source, mp_parse_input_kind_t input
 }
 
 #if MICROPY_ENABLE_COMPILER
+
+// Raw-paste mode of the raw REPL.  The host sends Ctrl-E 'A' Ctrl-A at the
+// prompt, and the device replies "R\x01" if it supports raw-paste mode (or
+// "R\x00" if it doesn't), followed by the flow-control window size as 2
+// bytes little endian.  The host may then send that many bytes, and one more
+// window each time the device sends \x01.  The host ends the code with
+// Ctrl-D, or the device ends the transfer early with \x04 (eg on a syntax
+// error), to which the host replies Ctrl-D.  The lexer reads the code
+// straight from stdin as it arrives, so it never has to fit in RAM as a
+// string, and the output follows as for a normal raw REPL command.
+
+#if !MICROPY_REPL_EVENT_DRIVEN
+
+// The size of the port's stdin buffer; the window is half of it, so one
+// window can be received while the other is being parsed.
+#ifndef MICROPY_REPL_STDIN_BUFFER_MAX
+#define MICROPY_REPL_STDIN_BUFFER_MAX (256)
+#endif
+
+typedef struct _mp_reader_stdin_t {
+    bool eof;
+    uint16_t window_max;
+    uint16_t window_remain;
+} mp_reader_stdin_t;
+
+STATIC mp_uint_t mp_reader_stdin_readbyte(void *data) {
+    mp_reader_stdin_t *reader = (mp_reader_stdin_t*)data;
+
+    if (reader->eof) {
+        return MP_READER_EOF;
+    }
+
+    int c = mp_hal_stdin_rx_chr();
+
+    if (c == CHAR_CTRL_C || c == CHAR_CTRL_D) {
+        reader->eof = true;
+        mp_hal_stdout_tx_strn("\x04", 1); // indicate end to host
+        if (c == CHAR_CTRL_C) {
+            #if MICROPY_KBD_EXCEPTION
+            MP_STATE_VM(mp_kbd_exception).traceback_data = NULL;
+            nlr_raise(MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_kbd_exception)));
+            #else
+            mp_raise_msg(&mp_type_KeyboardInterrupt, NULL);
+            #endif
+        }
+        return MP_READER_EOF;
+    }
+
+    if (--reader->window_remain == 0) {
+        mp_hal_stdout_tx_strn("\x01", 1); // indicate another window to host
+        reader->window_remain = reader->window_max;
+    }
+
+    return c;
+}
+
+STATIC void mp_reader_stdin_close(void *data) {
+    mp_reader_stdin_t *reader = (mp_reader_stdin_t*)data;
+    if (!reader->eof) {
+        // the lexer stopped early, so tell the host and discard the rest
+        reader->eof = true;
+        mp_hal_stdout_tx_strn("\x04", 1);
+        for (;;) {
+            int c = mp_hal_stdin_rx_chr();
+            if (c == CHAR_CTRL_C || c == CHAR_CTRL_D) {
+                break;
+            }
+        }
+    }
+}
+
+STATIC void mp_reader_new_stdin(mp_reader_t *reader, mp_reader_stdin_t *reader_stdin, uint16_t buf_max) {
+    // Sending the window size gives the host one window, and the \x01 after
+    // it gives a second, so the host can fill the whole buffer.
+    uint16_t window = buf_max / 2;
+    char reply[3] = { window & 0xff, window >> 8, 0x01 };
+    mp_hal_stdout_tx_strn(reply, sizeof(reply));
+
+    reader_stdin->eof = false;
+    reader_stdin->window_max = window;
+    reader_stdin->window_remain = window;
+    reader->data = reader_stdin;
+    reader->readbyte = mp_reader_stdin_readbyte;
+    reader->close = mp_reader_stdin_close;
+}
+
+STATIC int pyexec_raw_paste(int c) {
+    if (c != 'A') {
+        // unsupported command
+        mp_hal_stdout_tx_strn("R\x00", 2);
+        return 0;
+    }
+
+    // indicate reception of command
+    mp_hal_stdout_tx_strn("R\x01", 2);
+
+    mp_reader_t reader;
+    mp_reader_stdin_t reader_stdin;
+    mp_reader_new_stdin(&reader, &reader_stdin, MICROPY_REPL_STDIN_BUFFER_MAX);
+    return parse_compile_execute(&reader, MP_PARSE_FILE_INPUT, EXEC_FLAG_PRINT_EOF | EXEC_FLAG_SOURCE_IS_READER);
+}
+
+#endif // !MICROPY_REPL_EVENT_DRIVEN
+
 #if MICROPY_REPL_EVENT_DRIVEN
 
 typedef struct _repl_t {
@@ -183,6 +290,13 @@ void pyexec_event_repl_init(void) {
 
 STATIC int pyexec_raw_repl_process_char(int c) {
     if (c == CHAR_CTRL_A) {
+        vstr_t *line = MP_STATE_VM(repl_line);
+        if (line->len == 2 && line->buf[0] == CHAR_CTRL_E) {
+            // raw-paste mode isn't supported by the event-driven REPL
+            mp_hal_stdout_tx_strn("R\x00", 2);
+            vstr_reset(line);
+            return 0;
+        }
         // reset raw REPL
         mp_hal_stdout_tx_str("raw REPL; CTRL-B to exit\r\n");
         goto reset;
@@ -368,6 +482,17 @@ raw_repl_reset:
         for (;;) {
             int c = mp_hal_stdin_rx_chr();
             if (c == CHAR_CTRL_A) {
+                if (line.len == 2 && line.buf[0] == CHAR_CTRL_E) {
+                    // Ctrl-E <cmd> Ctrl-A at the start of a line enters raw-paste mode
+                    int ret = pyexec_raw_paste(line.buf[1]);
+                    if (ret & PYEXEC_FORCED_EXIT) {
+                        vstr_clear(&line);
+                        return ret;
+                    }
+                    vstr_reset(&line);
+                    mp_hal_stdout_tx_str(">");
+                    continue;
+                }
                 // reset raw REPL
                 goto raw_repl_reset;
             } else if (c == CHAR_CTRL_B) {
@@ -103,13 +103,17 @@ STATIC int usage(char **argv) {
 "-o : output file for compiled bytecode (defaults to input with .mpy extension)\n"
 "-s : source filename to embed in the compiled bytecode (defaults to input file)\n"
 "-v : verbose (trace various operations); can be multiple\n"
-"-O[N] : apply bytecode optimizations of level N\n"
+"-O[N] : apply bytecode optimizations of level N (2 and up add peephole optimizations)\n"
 "\n"
 "Target specific options:\n"
 "-msmall-int-bits=number : set the maximum bits used to encode a small-int\n"
 "-mno-unicode : don't support unicode in compiled strings\n"
 "-mcache-lookup-bc : cache map lookups in the bytecode\n"
-"-march=<arch> : set architecture for native emitter; x86, x64, armv6, armv7m, xtensa\n"
+"-msuperinstr : fuse common opcode sequences into superinstructions\n"
+"-mxip : save bytecode so it can run in place from ROM\n"
+"-march=<arch> : set architecture for native emitter; x86, x64, armv6, armv7m, armv7em, xtensa\n"
+"-mnative=<f,C.m,...> : emit these functions as native code, as if decorated\n"
+"-mviper=<f,C.m,...> : emit these functions as viper code, as if decorated\n"
 "\n"
 "Implementation specific options:\n", argv[0]
 );
@@ -193,7 +197,11 @@ MP_NOINLINE int main_(int argc, char **argv) {
     // set default compiler configuration
     mp_dynamic_compiler.small_int_bits = 31;
     mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode = 0;
+    mp_dynamic_compiler.opt_superinstructions = 0;
+    mp_dynamic_compiler.persistent_code_xip = 0;
     mp_dynamic_compiler.py_builtins_str_unicode = 1;
+    mp_dynamic_compiler.native_funcs = NULL;
+    mp_dynamic_compiler.viper_funcs = NULL;
     #if defined(__i386__)
     mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_X86;
     #elif defined(__x86_64__)
@@ -250,10 +258,22 @@ MP_NOINLINE int main_(int argc, char **argv) {
                 mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode = 0;
             } else if (strcmp(argv[a], "-mcache-lookup-bc") == 0) {
                 mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode = 1;
+            } else if (strcmp(argv[a], "-mno-superinstr") == 0) {
+                mp_dynamic_compiler.opt_superinstructions = 0;
+            } else if (strcmp(argv[a], "-msuperinstr") == 0) {
+                mp_dynamic_compiler.opt_superinstructions = 1;
+            } else if (strcmp(argv[a], "-mno-xip") == 0) {
+                mp_dynamic_compiler.persistent_code_xip = 0;
+            } else if (strcmp(argv[a], "-mxip") == 0) {
+                mp_dynamic_compiler.persistent_code_xip = 1;
             } else if (strcmp(argv[a], "-mno-unicode") == 0) {
                 mp_dynamic_compiler.py_builtins_str_unicode = 0;
             } else if (strcmp(argv[a], "-municode") == 0) {
                 mp_dynamic_compiler.py_builtins_str_unicode = 1;
+            } else if (strncmp(argv[a], "-mnative=", sizeof("-mnative=") - 1) == 0) {
+                mp_dynamic_compiler.native_funcs = argv[a] + sizeof("-mnative=") - 1;
+            } else if (strncmp(argv[a], "-mviper=", sizeof("-mviper=") - 1) == 0) {
+                mp_dynamic_compiler.viper_funcs = argv[a] + sizeof("-mviper=") - 1;
             } else if (strncmp(argv[a], "-march=", sizeof("-march=") - 1) == 0) {
                 const char *arch = argv[a] + sizeof("-march=") - 1;
                 if (strcmp(arch, "x86") == 0) {
@@ -264,6 +284,8 @@ MP_NOINLINE int main_(int argc, char **argv) {
                     mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_ARMV6;
                 } else if (strcmp(arch, "armv7m") == 0) {
                     mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_ARMV7M;
+                } else if (strcmp(arch, "armv7em") == 0) {
+                    mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_ARMV7EM;
                 } else if (strcmp(arch, "xtensa") == 0) {
                     mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_XTENSA;
                 } else {
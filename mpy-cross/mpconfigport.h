@@ -47,8 +47,10 @@
 #define MICROPY_COMP_DOUBLE_TUPLE_ASSIGN (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (1)
 #define MICROPY_COMP_RETURN_IF_EXPR (1)
+#define MICROPY_COMP_PEEPHOLE       (1) // applied with -O2 and higher
 
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
+#define MICROPY_OPT_SUPERINSTRUCTIONS (1) // emitted with -msuperinstr
 
 #define MICROPY_READER_POSIX        (1)
 #define MICROPY_ENABLE_RUNTIME      (0)
@@ -62,6 +64,8 @@
 #define MICROPY_WARNINGS            (1)
 
 #define MICROPY_FLOAT_IMPL          (MICROPY_FLOAT_IMPL_DOUBLE)
+// parse float constants, and save them in .mpy files, the same as the ports
+#define MICROPY_OPT_FAST_FLOAT      (1)
 #define MICROPY_CPYTHON_COMPAT      (1)
 #define MICROPY_USE_INTERNAL_PRINTF (0)
 
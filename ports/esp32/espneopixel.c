@@ -1,53 +1,129 @@
-// Original version from https://github.com/adafruit/Adafruit_NeoPixel
-// Modifications by dpgeorge to support auto-CPU-frequency detection
+// WS2812 (NeoPixel) output using the RMT peripheral.
+//
+// Each bit of the pixel data becomes one RMT item: a high pulse then a low
+// pulse, timed by the RMT from the 80MHz APB clock, so the output doesn't
+// depend on interrupts being disabled.  The encoding of the items and the
+// wait for the RMT run as an offload job on the other core, so the
+// MicroPython task only copies the pixels and carries on.
 
-// This is a mash-up of the Due show() code + insights from Michael Miller's
-// ESP8266 work for the NeoPixelBus library: github.com/Makuna/NeoPixelBus
-// Needs to be a separate .c file to enforce ICACHE_RAM_ATTR execution.
+#include <stdlib.h>
+#include <string.h>
 
-#include "py/mpconfig.h"
+#include "driver/rmt.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
 #include "py/mphal.h"
 #include "modesp.h"
+#include "offload.h"
+
+#define NEOPIXEL_RMT_CHANNEL (RMT_CHANNEL_0)
+
+// RMT ticks are 12.5ns with the APB clock undivided
+#define NEOPIXEL_RMT_CLK_DIV (1)
+#define NEOPIXEL_NS(ns) ((ns) * 2 / 25)
+
+// the LEDs latch the data after the line is low for 50us
+#define NEOPIXEL_RESET_TICKS NEOPIXEL_NS(50000)
 
-void IRAM_ATTR esp_neopixel_write(uint8_t pin, uint8_t *pixels, uint32_t numBytes, uint8_t timing) {
-    uint8_t *p, *end, pix, mask;
-    uint32_t t, time0, time1, period, c, startTime, pinMask;
+typedef struct _neopixel_job_t {
+    uint8_t pin;
+    uint8_t timing;
+    uint8_t *pixels;
+    uint32_t len;
+} neopixel_job_t;
 
-    pinMask   = 1 << pin;
-    p         =  pixels;
-    end       =  p + numBytes;
-    pix       = *p++;
-    mask      = 0x80;
-    startTime = 0;
+STATIC neopixel_job_t neopixel_job;
+STATIC volatile bool neopixel_busy;
+STATIC int neopixel_rmt_pin = -1; // the pin the RMT channel drives, or -1
+
+// Runs on the offload task, so the RMT interrupt is also on that core.
+STATIC void neopixel_rmt_setup(uint8_t pin) {
+    if (neopixel_rmt_pin == -1) {
+        rmt_config_t config;
+        config.rmt_mode = RMT_MODE_TX;
+        config.channel = NEOPIXEL_RMT_CHANNEL;
+        config.gpio_num = pin;
+        config.mem_block_num = 1;
+        config.clk_div = NEOPIXEL_RMT_CLK_DIV;
+        config.tx_config.loop_en = false;
+        config.tx_config.carrier_en = false;
+        config.tx_config.carrier_freq_hz = 0;
+        config.tx_config.carrier_duty_percent = 0;
+        config.tx_config.carrier_level = RMT_CARRIER_LEVEL_LOW;
+        config.tx_config.idle_output_en = true;
+        config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+        rmt_config(&config);
+        rmt_driver_install(NEOPIXEL_RMT_CHANNEL, 0, 0);
+    } else if (neopixel_rmt_pin != pin) {
+        rmt_set_pin(NEOPIXEL_RMT_CHANNEL, RMT_MODE_TX, pin);
+    }
+    neopixel_rmt_pin = pin;
+}
 
-    uint32_t fcpu = ets_get_cpu_frequency() * 1000000;
+STATIC void neopixel_job_run(void *arg) {
+    neopixel_job_t *job = arg;
+    neopixel_rmt_setup(job->pin);
 
-    if (timing == 1) {
-        // 800 KHz
-        time0 = (fcpu * 0.35) / 1000000; // 0.35us
-        time1 = (fcpu * 0.8) / 1000000; // 0.8us
-        period = (fcpu * 1.25) / 1000000; // 1.25us per bit
+    rmt_item32_t bit0, bit1;
+    if (job->timing == 1) {
+        // 800kHz
+        bit0.duration0 = NEOPIXEL_NS(350);
+        bit0.duration1 = NEOPIXEL_NS(900);
+        bit1.duration0 = NEOPIXEL_NS(800);
+        bit1.duration1 = NEOPIXEL_NS(450);
     } else {
-        // 400 KHz
-        time0 = (fcpu * 0.5) / 1000000; // 0.35us
-        time1 = (fcpu * 1.2) / 1000000; // 0.8us
-        period = (fcpu * 2.5) / 1000000; // 1.25us per bit
+        // 400kHz
+        bit0.duration0 = NEOPIXEL_NS(500);
+        bit0.duration1 = NEOPIXEL_NS(2000);
+        bit1.duration0 = NEOPIXEL_NS(1200);
+        bit1.duration1 = NEOPIXEL_NS(1300);
     }
+    bit0.level0 = bit1.level0 = 1;
+    bit0.level1 = bit1.level1 = 0;
 
-    uint32_t irq_state = mp_hal_quiet_timing_enter();
-    for (t = time0;; t = time0) {
-        if (pix & mask) t = time1;                                  // Bit high duration
-        while (((c = mp_hal_ticks_cpu()) - startTime) < period);    // Wait for bit start
-        GPIO_REG_WRITE(GPIO_OUT_W1TS_REG, pinMask);                 // Set high
-        startTime = c;                                              // Save start time
-        while (((c = mp_hal_ticks_cpu()) - startTime) < t);         // Wait high duration
-        GPIO_REG_WRITE(GPIO_OUT_W1TC_REG, pinMask);                 // Set low
-        if (!(mask >>= 1)) {                                        // Next bit/byte
-            if(p >= end) break;
-            pix  = *p++;
-            mask = 0x80;
+    // the RMT driver feeds its memory block from the items as it goes, so
+    // they stay allocated until the write is done
+    size_t n = job->len * 8;
+    rmt_item32_t *items = malloc(n * sizeof(rmt_item32_t));
+    if (items != NULL) {
+        rmt_item32_t *item = items;
+        for (size_t i = 0; i < job->len; ++i) {
+            uint8_t pix = job->pixels[i];
+            for (uint8_t mask = 0x80; mask; mask >>= 1) {
+                *item++ = (pix & mask) ? bit1 : bit0;
+            }
         }
+        items[n - 1].duration1 = NEOPIXEL_RESET_TICKS;
+        rmt_write_items(NEOPIXEL_RMT_CHANNEL, items, n, true);
+        free(items);
+    }
+
+    free(job->pixels);
+    job->pixels = NULL;
+    neopixel_busy = false;
+}
+
+void esp_neopixel_write(uint8_t pin, uint8_t *pixels, uint32_t numBytes, uint8_t timing) {
+    // there is one job, so wait for the last write to go out
+    while (neopixel_busy) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    if (numBytes == 0) {
+        return;
+    }
+
+    // the job takes a copy of the pixels, so the caller can change them
+    // while they're being sent
+    uint8_t *copy = malloc(numBytes);
+    if (copy == NULL) {
+        mp_raise_OSError(MP_ENOMEM);
     }
-    while ((mp_hal_ticks_cpu() - startTime) < period); // Wait for last bit
-    mp_hal_quiet_timing_exit(irq_state);
+    memcpy(copy, pixels, numBytes);
+    neopixel_job.pin = pin;
+    neopixel_job.timing = timing;
+    neopixel_job.pixels = copy;
+    neopixel_job.len = numBytes;
+    neopixel_busy = true;
+    offload_submit(neopixel_job_run, &neopixel_job);
 }
@@ -52,6 +52,7 @@
 #include "modmachine.h"
 #include "modnetwork.h"
 #include "mpthreadport.h"
+#include "offload.h"
 
 // MicroPython runs as a task under FreeRTOS
 #define MP_TASK_PRIORITY        (ESP_TASK_PRIO_MIN + 1)
@@ -69,6 +70,7 @@ void mp_task(void *pvParameter) {
     mp_thread_init(pxTaskGetStackStart(NULL), MP_TASK_STACK_LEN);
     #endif
     uart_init();
+    offload_init();
 
     #if CONFIG_SPIRAM_SUPPORT
     // Try to use the entire external SPIRAM directly for the heap
@@ -131,6 +133,7 @@ soft_reset:
     }
 
     machine_timer_deinit_all();
+    offload_wait();
 
     #if MICROPY_PY_THREAD
     mp_thread_deinit();
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_task.h"
+
+#include "py/mpconfig.h"
+#include "py/mpthread.h"
+#include "py/mphal.h"
+#include "offload.h"
+
+#define OFFLOAD_COREID          (MP_TASK_COREID ^ 1)
+#define OFFLOAD_PRIORITY        (ESP_TASK_PRIO_MIN + 1)
+#define OFFLOAD_STACK_SIZE      (4 * 1024)
+#define OFFLOAD_STACK_LEN       (OFFLOAD_STACK_SIZE / sizeof(StackType_t))
+
+// must be a power of 2
+#define OFFLOAD_QUEUE_LEN       (8)
+
+typedef struct _offload_item_t {
+    offload_fn_t fn;
+    void *arg;
+} offload_item_t;
+
+// The queue is a ring with a single producer and a single consumer, so it
+// needs no lock: only the MicroPython task(s) move the head, and they hold
+// the GIL while doing so, and only the offload task moves the tail.  The
+// tail is moved after an item has run, so an empty queue means all the
+// submitted work is finished.
+STATIC offload_item_t offload_queue[OFFLOAD_QUEUE_LEN];
+STATIC volatile uint32_t offload_head;
+STATIC volatile uint32_t offload_tail;
+STATIC TaskHandle_t offload_task_handle;
+
+STATIC void offload_task(void *arg) {
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (offload_tail != offload_head) {
+            // make sure the item is read after the head that published it
+            __sync_synchronize();
+            offload_item_t *item = &offload_queue[offload_tail & (OFFLOAD_QUEUE_LEN - 1)];
+            item->fn(item->arg);
+            __sync_synchronize();
+            offload_tail = offload_tail + 1;
+        }
+    }
+}
+
+void offload_init(void) {
+    // the task lives across soft resets
+    if (offload_task_handle == NULL) {
+        xTaskCreatePinnedToCore(offload_task, "offload", OFFLOAD_STACK_LEN, NULL, OFFLOAD_PRIORITY, &offload_task_handle, OFFLOAD_COREID);
+    }
+}
+
+// Wait for a free slot if the queue is full.
+void offload_submit(offload_fn_t fn, void *arg) {
+    while (offload_head - offload_tail >= OFFLOAD_QUEUE_LEN) {
+        MP_THREAD_GIL_EXIT();
+        vTaskDelay(1);
+        MP_THREAD_GIL_ENTER();
+    }
+    offload_item_t *item = &offload_queue[offload_head & (OFFLOAD_QUEUE_LEN - 1)];
+    item->fn = fn;
+    item->arg = arg;
+    // the item must be written before the offload task can see the new head
+    __sync_synchronize();
+    offload_head = offload_head + 1;
+    xTaskNotifyGive(offload_task_handle);
+}
+
+bool offload_busy(void) {
+    return offload_tail != offload_head;
+}
+
+void offload_wait(void) {
+    while (offload_busy()) {
+        MP_THREAD_GIL_EXIT();
+        vTaskDelay(1);
+        MP_THREAD_GIL_ENTER();
+    }
+}
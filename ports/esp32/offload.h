@@ -0,0 +1,44 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_ESP32_OFFLOAD_H
+#define MICROPY_INCLUDED_ESP32_OFFLOAD_H
+
+#include <stdbool.h>
+
+// C-level work, such as feeding pixels to the RMT or pushing a frame out of
+// SPI to a display, can be handed to a task on the core that MicroPython is
+// not pinned to.  Items run one at a time in the order they were submitted.
+// They must not touch the MicroPython heap or call into the runtime, because
+// they run concurrently with the interpreter.
+
+typedef void (*offload_fn_t)(void *arg);
+
+void offload_init(void);
+void offload_submit(offload_fn_t fn, void *arg);
+bool offload_busy(void);
+void offload_wait(void);
+
+#endif // MICROPY_INCLUDED_ESP32_OFFLOAD_H
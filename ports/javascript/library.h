@@ -29,3 +29,4 @@
 extern void mp_js_write(const char *str, mp_uint_t len);
 extern int mp_js_ticks_ms(void);
 extern void mp_js_hook(void);
+extern void mp_js_screen_show(const uint16_t *ptr, int width, int height);
@@ -68,4 +68,33 @@ mergeInto(LibraryManager.library, {
             }
         }
     },
+
+    // Draw a frame of RGB565 pixels, in wire (big-endian) byte order, on the
+    // canvas with id mp_js_screen.  The pixels are read through a view of the
+    // heap rather than copied out of it first.
+    mp_js_screen_show: function(ptr, width, height) {
+        if (typeof document === 'undefined') {
+            return;
+        }
+        var canvas = document.getElementById('mp_js_screen');
+        if (!canvas) {
+            return;
+        }
+        var ctx = canvas.getContext('2d');
+        if (!Module.mp_js_screen_image || Module.mp_js_screen_image.width != width || Module.mp_js_screen_image.height != height) {
+            Module.mp_js_screen_image = ctx.createImageData(width, height);
+        }
+        var image = Module.mp_js_screen_image;
+        // HEAPU8 is replaced when the memory grows, so the view is made each time
+        var src = new Uint8Array(HEAPU8.buffer, ptr, width * height * 2);
+        var dest = new Uint32Array(image.data.buffer);
+        for (var i = 0, j = 0; i < dest.length; i++, j += 2) {
+            var c = (src[j] << 8) | src[j + 1];
+            var r = (c >> 8) & 0xf8;
+            var g = (c >> 3) & 0xfc;
+            var b = (c << 3) & 0xf8;
+            dest[i] = 0xff000000 | (b << 16) | (g << 8) | r;
+        }
+        ctx.putImageData(image, 0, 0);
+    },
 });
@@ -38,6 +38,10 @@
 
 #include "library.h"
 
+#if MICROPY_JS_ASYNCIFY
+#include <emscripten.h>
+#endif
+
 #if MICROPY_ENABLE_COMPILER
 int do_str(const char *src, mp_parse_input_kind_t input_kind) {
     int ret = 0;
@@ -71,6 +75,7 @@ int do_str(const char *src, mp_parse_input_kind_t input_kind) {
 #endif
 
 static char *stack_top;
+static size_t heap_grow_size;
 
 int mp_js_do_str(const char *code) {
     return do_str(code, MP_PARSE_FILE_INPUT);
@@ -87,6 +92,7 @@ void mp_js_init(int heap_size) {
     #if MICROPY_ENABLE_GC
     char *heap = (char*)malloc(heap_size * sizeof(char));
     gc_init(heap, heap + heap_size);
+    heap_grow_size = heap_size;
     #endif
 
     #if MICROPY_ENABLE_PYSTACK
@@ -105,15 +111,43 @@ void mp_js_init_repl() {
     pyexec_event_repl_init();
 }
 
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+// Add an area of at least the initial heap size, and twice the allocation so
+// there's room for the area's tables.  The page's memory grows to hold it.
+bool gc_grow_heap(size_t n_bytes) {
+    size_t size = MAX(heap_grow_size, 2 * n_bytes);
+    char *heap = (char*)malloc(size);
+    if (heap == NULL) {
+        return false;
+    }
+    gc_add(heap, heap + size);
+    return true;
+}
+#endif
+
+#if MICROPY_JS_ASYNCIFY
+static void gc_scan_func(void *begin, void *end) {
+    gc_collect_root((void**)begin, ((uintptr_t)end - (uintptr_t)begin) / sizeof(void*));
+}
+#endif
+
 void gc_collect(void) {
+    gc_collect_start();
+    #if MICROPY_JS_ASYNCIFY
+    // Asyncify can spill the locals of the functions on the call stack, which
+    // WebAssembly keeps outside of memory, so only the live part of the stack
+    // and those locals need scanning.
+    emscripten_scan_stack(gc_scan_func);
+    emscripten_scan_registers(gc_scan_func);
+    #else
     // WARNING: This gc_collect implementation doesn't try to get root
     // pointers from CPU registers, and thus may function incorrectly.
     jmp_buf dummy;
     if (setjmp(dummy) == 0) {
         longjmp(dummy, 1);
     }
-    gc_collect_start();
     gc_collect_root((void*)stack_top, ((mp_uint_t)(void*)(&dummy + 1) - (mp_uint_t)stack_top) / sizeof(mp_uint_t));
+    #endif
     gc_collect_end();
 }
 
@@ -46,6 +46,8 @@
 #define MICROPY_MEM_STATS           (0) //BROKEN
 #define MICROPY_DEBUG_PRINTERS      (0)
 #define MICROPY_ENABLE_GC           (1)
+#define MICROPY_GC_SPLIT_HEAP       (1)
+#define MICROPY_GC_SPLIT_HEAP_AUTO  (1)
 #define MICROPY_GC_ALLOC_THRESHOLD  (1)
 #define MICROPY_GC_USES_ALLOCATED_SIZE (1)
 #define MICROPY_REPL_EVENT_DRIVEN   (1)
@@ -122,13 +124,30 @@
 #define MICROPY_USE_INTERNAL_ERRNO  (1)
 #define MICROPY_ENABLE_SCHEDULER    (1)
 #define MICROPY_SCHEDULER_DEPTH     (1)
+#define MICROPY_PY_PYB_SCREEN       (1)
+#define MICROPY_PY_MACHINE_DISPLAY  (1)
+
+// Set by the Makefile when building with ASYNCIFY=1, so that the code can
+// give the browser its event loop back with emscripten_sleep
+#ifndef MICROPY_JS_ASYNCIFY
+#define MICROPY_JS_ASYNCIFY         (0)
+#endif
+
+// pyb.SCREEN draws each frame it's shown on the page's canvas
+#define MICROPY_PY_PYB_SCREEN_SHOW_HOOK(frame, w, h) \
+    do { \
+        extern void mp_js_screen_show(const uint16_t *ptr, int width, int height); \
+        mp_js_screen_show((frame), (w), (h)); \
+    } while (0)
 
 #define MP_SSIZE_MAX (0x7fffffff)
 
 extern const struct _mp_obj_module_t mp_module_utime;
+extern const struct _mp_obj_module_t mp_module_pyb;
 
 #define MICROPY_PORT_BUILTIN_MODULES \
     { MP_ROM_QSTR(MP_QSTR_utime), MP_ROM_PTR(&mp_module_utime) }, \
+    { MP_ROM_QSTR(MP_QSTR_pyb), MP_ROM_PTR(&mp_module_pyb) }, \
 
 #define MICROPY_PORT_BUILTIN_MODULE_WEAK_LINKS \
     { MP_ROM_QSTR(MP_QSTR_binascii), MP_ROM_PTR(&mp_module_ubinascii) }, \
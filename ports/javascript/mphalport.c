@@ -27,14 +27,24 @@
 #include "library.h"
 #include "mphalport.h"
 
+#if MICROPY_JS_ASYNCIFY
+#include <emscripten.h>
+#endif
+
 void mp_hal_stdout_tx_strn(const char *str, size_t len) {
     mp_js_write(str, len);
 }
 
 void mp_hal_delay_ms(mp_uint_t ms) {
+    #if MICROPY_JS_ASYNCIFY
+    // suspend the code and return to the browser's event loop, so that the
+    // page keeps drawing and handling events while Python sleeps
+    emscripten_sleep(ms);
+    #else
     uint32_t start = mp_hal_ticks_ms();
     while (mp_hal_ticks_ms() - start < ms) {
     }
+    #endif
 }
 
 void mp_hal_delay_us(mp_uint_t us) {
@@ -29,9 +29,10 @@ var Module = {};
 var mainProgram = function()
 {
   mp_js_init = Module.cwrap('mp_js_init', 'null', ['number']);
-  mp_js_do_str = Module.cwrap('mp_js_do_str', 'number', ['string']);
+  // With ASYNCIFY=1 these may sleep, and then return a Promise of the result
+  mp_js_do_str = Module.cwrap('mp_js_do_str', 'number', ['string'], {async: true});
   mp_js_init_repl = Module.cwrap('mp_js_init_repl', 'null', ['null']);
-  mp_js_process_char = Module.cwrap('mp_js_process_char', 'number', ['number']);
+  mp_js_process_char = Module.cwrap('mp_js_process_char', 'number', ['number'], {async: true});
 
   MP_JS_EPOCH = (new Date()).getTime();
 
@@ -61,15 +62,25 @@ var mainProgram = function()
       if (repl) {
           mp_js_init_repl();
           process.stdin.setRawMode(true);
-          process.stdin.on('data', function (data) {
-              for (var i = 0; i < data.length; i++) {
-                  if (mp_js_process_char(data[i])) {
+          // a character is only passed in once the last one is done with,
+          // as the code can't be entered again while it sleeps
+          var pending = Promise.resolve();
+          var process_char = function (c) {
+              return Promise.resolve(mp_js_process_char(c)).then(function (ret) {
+                  if (ret) {
                       process.exit()
                   }
+              });
+          };
+          process.stdin.on('data', function (data) {
+              for (var i = 0; i < data.length; i++) {
+                  pending = pending.then(process_char.bind(null, data[i]));
               }
           });
       } else {
-          process.exitCode = mp_js_do_str(contents);
+          Promise.resolve(mp_js_do_str(contents)).then(function (ret) {
+              process.exitCode = ret;
+          });
       }
   }
 }
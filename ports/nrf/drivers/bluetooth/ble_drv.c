@@ -72,6 +72,18 @@
   #define GATT_MTU_SIZE_DEFAULT BLE_GATT_ATT_MTU_DEFAULT
 #endif
 
+// Notifications that the SoftDevice has no room for yet wait in a queue, and
+// are handed over from the TX complete event, so its buffers are refilled
+// while the connection event is still going instead of when Python next runs.
+#if (BLUETOOTH_SD == 110)
+  #define BLE_DRV_TX_QUEUE_LEN       (4)
+  #define BLE_DRV_ERROR_TX_FULL      BLE_ERROR_NO_TX_PACKETS
+#else
+  #define BLE_DRV_TX_QUEUE_LEN       (8)
+  #define BLE_DRV_ERROR_TX_FULL      NRF_ERROR_RESOURCES
+#endif
+#define BLE_DRV_TX_DATA_MAX          (GATT_MTU_SIZE_DEFAULT - 3)
+
 #define SD_TEST_OR_ENABLE() \
 if (ble_drv_stack_enabled() == 0) { \
     (void)ble_drv_stack_enable(); \
@@ -80,6 +92,17 @@ if (ble_drv_stack_enabled() == 0) { \
 static volatile bool m_adv_in_progress;
 static volatile uint8_t m_tx_in_progress;
 
+typedef struct {
+    uint16_t conn_handle;
+    uint16_t handle;
+    uint16_t len;
+    uint8_t  data[BLE_DRV_TX_DATA_MAX];
+} ble_drv_tx_t;
+
+static ble_drv_tx_t m_tx_queue[BLE_DRV_TX_QUEUE_LEN];
+static volatile uint8_t m_tx_queue_head;
+static volatile uint8_t m_tx_queue_len;
+
 static ble_drv_gap_evt_callback_t          gap_event_handler;
 static ble_drv_gatts_evt_callback_t        gatts_event_handler;
 
@@ -128,6 +151,7 @@ void softdevice_assert_handler(uint32_t id, uint32_t pc, uint32_t info) {
 uint32_t ble_drv_stack_enable(void) {
     m_adv_in_progress = false;
     m_tx_in_progress  = 0;
+    m_tx_queue_len    = 0;
 
 #if (BLUETOOTH_SD == 110)
   #if BLUETOOTH_LFCLK_RC
@@ -204,6 +228,15 @@ uint32_t ble_drv_stack_enable(void) {
     uint32_t app_ram_start = 0x200039c0;
     err_code = sd_ble_enable(&app_ram_start); // 8K SD headroom from linker script.
     BLE_DRIVER_LOG("BLE ram size: " UINT_FMT "\n", (uint16_t)app_ram_start);
+
+    // let a connection event run on past its event_length while there are
+    // notifications to send, rather than leaving the rest to the next one
+    ble_opt_t opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.common_opt.conn_evt_ext.enable = 1;
+    uint32_t opt_err_code = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &opt);
+    BLE_DRIVER_LOG("BLE_COMMON_OPT_CONN_EVT_EXT status: " UINT_FMT "\n", (uint16_t)opt_err_code);
+    (void)opt_err_code;
 #endif
 
     BLE_DRIVER_LOG("BLE enable status: " UINT_FMT "\n", (uint16_t)err_code);
@@ -698,7 +731,7 @@ void ble_drv_attr_s_write(uint16_t conn_handle, uint16_t handle, uint16_t len, u
     }
 }
 
-void ble_drv_attr_s_notify(uint16_t conn_handle, uint16_t handle, uint16_t len, uint8_t * p_data) {
+static uint32_t ble_drv_tx_hvx(uint16_t conn_handle, uint16_t handle, uint16_t len, uint8_t * p_data) {
     uint16_t               hvx_len = len;
     ble_gatts_hvx_params_t hvx_params;
 
@@ -710,18 +743,69 @@ void ble_drv_attr_s_notify(uint16_t conn_handle, uint16_t handle, uint16_t len,
     hvx_params.p_len  = &hvx_len;
     hvx_params.p_data = p_data;
 
-    while (m_tx_in_progress > MAX_TX_IN_PROGRESS) {
-        ;
+    uint32_t err_code = sd_ble_gatts_hvx(conn_handle, &hvx_params);
+    if (err_code == 0) {
+        m_tx_in_progress++;
     }
+    return err_code;
+}
 
-    BLE_DRIVER_LOG("Request TX, m_tx_in_progress: %u\n", m_tx_in_progress);
-    uint32_t err_code;
-    if ((err_code = sd_ble_gatts_hvx(conn_handle, &hvx_params)) != 0) {
-        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_OSError,
-                  "Can not notify attribute value. status: 0x" HEX2_FMT, (uint16_t)err_code));
+// Hand queued notifications to the SoftDevice until it is full.  Called from
+// the BLE event handler, or with it masked.
+static void ble_drv_tx_queue_flush(void) {
+    while (m_tx_queue_len > 0 && m_tx_in_progress < MAX_TX_IN_PROGRESS) {
+        ble_drv_tx_t * p_tx = &m_tx_queue[m_tx_queue_head];
+        uint32_t err_code = ble_drv_tx_hvx(p_tx->conn_handle, p_tx->handle, p_tx->len, p_tx->data);
+        if (err_code == BLE_DRV_ERROR_TX_FULL) {
+            break;
+        }
+        // any other error can't be reported any more, so it's dropped
+        BLE_DRIVER_LOG("Flushed TX, status: 0x" HEX2_FMT "\n", (uint16_t)err_code);
+        m_tx_queue_head = (m_tx_queue_head + 1) % BLE_DRV_TX_QUEUE_LEN;
+        m_tx_queue_len--;
+    }
+}
+
+void ble_drv_attr_s_notify(uint16_t conn_handle, uint16_t handle, uint16_t len, uint8_t * p_data) {
+    if (len > BLE_DRV_TX_DATA_MAX) {
+        mp_raise_ValueError("notification too long");
+    }
+
+    for (;;) {
+        uint8_t nested;
+        sd_nvic_critical_region_enter(&nested);
+
+        uint32_t err_code = BLE_DRV_ERROR_TX_FULL;
+        if (m_tx_queue_len == 0 && m_tx_in_progress < MAX_TX_IN_PROGRESS) {
+            // nothing waiting, so send it straight away, and report errors
+            BLE_DRIVER_LOG("Request TX, m_tx_in_progress: %u\n", m_tx_in_progress);
+            err_code = ble_drv_tx_hvx(conn_handle, handle, len, p_data);
+        }
+
+        if (err_code == BLE_DRV_ERROR_TX_FULL && m_tx_queue_len < BLE_DRV_TX_QUEUE_LEN) {
+            ble_drv_tx_t * p_tx = &m_tx_queue[(m_tx_queue_head + m_tx_queue_len) % BLE_DRV_TX_QUEUE_LEN];
+            p_tx->conn_handle = conn_handle;
+            p_tx->handle      = handle;
+            p_tx->len         = len;
+            memcpy(p_tx->data, p_data, len);
+            m_tx_queue_len++;
+            err_code = 0;
+        }
+
+        sd_nvic_critical_region_exit(nested);
+
+        if (err_code == 0) {
+            BLE_DRIVER_LOG("Queued TX, m_tx_in_progress: %u\n", m_tx_in_progress);
+            return;
+        }
+        if (err_code != BLE_DRV_ERROR_TX_FULL) {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_OSError,
+                      "Can not notify attribute value. status: 0x" HEX2_FMT, (uint16_t)err_code));
+        }
+
+        // the queue is full, so wait for a TX complete event to drain it
+        __WFE();
     }
-    m_tx_in_progress++;
-    BLE_DRIVER_LOG("Queued TX, m_tx_in_progress: %u\n", m_tx_in_progress);
 }
 
 void ble_drv_gap_event_handler_set(mp_obj_t obj, ble_drv_gap_evt_callback_t evt_handler) {
@@ -970,10 +1054,17 @@ static void ble_evt_handler(ble_evt_t * p_ble_evt) {
             ble_gap_conn_params_t conn_params;
             (void)sd_ble_gap_ppcp_get(&conn_params);
             (void)sd_ble_gap_conn_param_update(p_ble_evt->evt.gap_evt.conn_handle, &conn_params);
+#if (BLUETOOTH_SD == 132) || (BLUETOOTH_SD == 140)
+            // ask for the longest link layer packets that both sides support
+            (void)sd_ble_gap_data_length_update(p_ble_evt->evt.gap_evt.conn_handle, NULL, NULL);
+#endif
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
             BLE_DRIVER_LOG("GAP DISCONNECT\n");
+            // notifications in flight or queued won't be sent any more
+            m_tx_in_progress = 0;
+            m_tx_queue_len   = 0;
             gap_event_handler(mp_gap_observer, p_ble_evt->header.evt_id, p_ble_evt->evt.gap_evt.conn_handle, p_ble_evt->header.evt_len - (2 * sizeof(uint16_t)), NULL);
             break;
 
@@ -1015,6 +1106,7 @@ static void ble_evt_handler(ble_evt_t * p_ble_evt) {
             m_tx_in_progress -= p_ble_evt->evt.common_evt.params.tx_complete.count;
             BLE_DRIVER_LOG("TX_COMPLETE, m_tx_in_progress: %u\n", m_tx_in_progress);
 #endif
+            ble_drv_tx_queue_flush();
             break;
 
         case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
@@ -1137,6 +1229,17 @@ static void ble_evt_handler(ble_evt_t * p_ble_evt) {
             BLE_DRIVER_LOG("GATTS EVT EXCHANGE MTU REQUEST\n");
             (void)sd_ble_gatts_exchange_mtu_reply(p_ble_evt->evt.gatts_evt.conn_handle, 23); // MAX MTU size
             break;
+
+        case BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST:
+            BLE_DRIVER_LOG("GAP EVT DATA LENGTH UPDATE REQUEST\n");
+            // let the SoftDevice pick the longest packets it has buffers for
+            (void)sd_ble_gap_data_length_update(p_ble_evt->evt.gap_evt.conn_handle, NULL, NULL);
+            break;
+
+        case BLE_GAP_EVT_DATA_LENGTH_UPDATE:
+            BLE_DRIVER_LOG("GAP EVT DATA LENGTH UPDATE, tx: %u\n",
+                           p_ble_evt->evt.gap_evt.params.data_length_update.effective_params.max_tx_octets);
+            break;
 #endif // (BLUETOOTH_SD == 132) || (BLUETOOTH_SD == 140)
 
         default:
@@ -43,6 +43,7 @@
 #include "gccollect.h"
 #include "modmachine.h"
 #include "modmusic.h"
+#include "musicaudio.h"
 #include "modules/uos/microbitfs.h"
 #include "led.h"
 #include "uart.h"
@@ -244,6 +245,10 @@ pin_init0();
         }
     }
 
+#if MICROPY_PY_MUSIC && defined(NRF52_SERIES)
+    music_audio_deinit();
+#endif
+
     mp_deinit();
 
     printf("MPY: soft reboot\n");
@@ -37,6 +37,7 @@
 #include "musictunes.h"
 #include "softpwm.h"
 #include "ticker.h"
+#include "musicaudio.h"
 #include "pin.h"
 #include "genhdr/pins.h"
 
@@ -76,6 +77,21 @@ extern volatile uint32_t ticks;
 
 STATIC uint32_t start_note(const char *note_str, size_t note_len, const pin_obj_t *pin);
 
+#if defined(NRF52_SERIES)
+// the nRF52 PWM peripheral makes the square wave, see musicaudio.c
+#define music_output_tone(pin, period_us) music_audio_tone((pin)->pin, (period_us))
+#define music_output_off(pin) music_audio_tone_off()
+#else
+STATIC int music_output_tone(const pin_obj_t *pin, uint32_t period_us) {
+    pwm_set_duty_cycle(pin->pin, 128); // TODO: remove pin setting.
+    return pwm_set_period_us(period_us);
+}
+
+STATIC void music_output_off(const pin_obj_t *pin) {
+    pwm_set_duty_cycle(pin->pin, 0); // TODO: remove pin setting.
+}
+#endif
+
 void microbit_music_init0(void) {
     ticker_register_low_pri_callback(microbit_music_tick);
 }
@@ -98,7 +114,7 @@ void microbit_music_tick(void) {
 
     if (music_data->async_state == ASYNC_MUSIC_STATE_ARTICULATE) {
         // turn off output and rest
-        pwm_set_duty_cycle(music_data->async_pin->pin, 0); // TODO: remove pin setting.
+        music_output_off(music_data->async_pin);
         music_data->async_wait_ticks = ticks + ARTICULATION_MS;
         music_data->async_state = ASYNC_MUSIC_STATE_NEXT_NOTE;
     } else if (music_data->async_state == ASYNC_MUSIC_STATE_NEXT_NOTE) {
@@ -121,7 +137,7 @@ void microbit_music_tick(void) {
         }
         if (note == mp_const_none) {
             // a rest (is this even used anymore?)
-            pwm_set_duty_cycle(music_data->async_pin->pin, 0); // TODO: remove pin setting.
+            music_output_off(music_data->async_pin);
             music_data->async_wait_ticks = 60000 / music_data->bpm;
             music_data->async_state = ASYNC_MUSIC_STATE_NEXT_NOTE;
         } else {
@@ -142,15 +158,13 @@ STATIC void wait_async_music_idle(void) {
         // allow CTRL-C to stop the music
         if (MP_STATE_VM(mp_pending_exception) != MP_OBJ_NULL) {
             music_data->async_state = ASYNC_MUSIC_STATE_IDLE;
-            pwm_set_duty_cycle(music_data->async_pin->pin, 0); // TODO: remove pin setting.
+            music_output_off(music_data->async_pin);
             break;
         }
     }
 }
 
 STATIC uint32_t start_note(const char *note_str, size_t note_len, const pin_obj_t *pin) {
-    pwm_set_duty_cycle(pin->pin, 128); // TODO: remove pin setting.
-
     // [NOTE](#|b)(octave)(:length)
     // technically, c4 is middle c, so we'll go with that...
     // if we define A as 0 and G as 7, then we can use the following
@@ -245,9 +259,9 @@ STATIC uint32_t start_note(const char *note_str, size_t note_len, const pin_obj_
                 period = periods_us[note_index] << -octave;
             }
         }
-        pwm_set_period_us(period);
+        music_output_tone(pin, period);
     } else {
-        pwm_set_duty_cycle(pin->pin, 0); // TODO: remove pin setting.
+        music_output_off(pin);
     }
 
     // Cut off a short time from end of note so we hear articulation.
@@ -292,7 +306,7 @@ STATIC mp_obj_t microbit_music_stop(mp_uint_t n_args, const mp_obj_t *args) {
     (void)pin;
     // Raise exception if the pin we are trying to stop is not in a compatible mode.
 // TODO: microbit_obj_pin_acquire(pin, microbit_pin_mode_music);
-    pwm_set_duty_cycle(pin->pin, 0); // TODO: remove pin setting.
+    music_output_off(pin);
 // TODO: microbit_obj_pin_free(pin);
     music_data->async_pin = NULL;
     music_data->async_state = ASYNC_MUSIC_STATE_IDLE;
@@ -403,11 +417,12 @@ STATIC mp_obj_t microbit_music_pitch(mp_uint_t n_args, const mp_obj_t *pos_args,
     music_data->async_pin = NULL;
 //TODO: microbit_obj_pin_acquire(pin, microbit_pin_mode_music);
     bool wait = args[3].u_bool;
-    pwm_set_duty_cycle(pin->pin, 128); // TODO: remove pin setting.
     if (frequency == 0) {
-//TODO: pwm_release(pin->name);
-    } else if (pwm_set_period_us(1000000/frequency)) {
+        music_output_off(pin);
+    } else if (music_output_tone(pin, 1000000 / frequency)) {
+        #if !defined(NRF52_SERIES)
         pwm_release(pin->pin); // TODO: remove pin setting.
+        #endif
         mp_raise_ValueError("invalid pitch");
     }
     if (duration >= 0) {
@@ -478,6 +493,9 @@ STATIC const mp_rom_map_elem_t microbit_music_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_play), MP_ROM_PTR(&microbit_music_play_obj) },
     { MP_ROM_QSTR(MP_QSTR_pitch), MP_ROM_PTR(&microbit_music_pitch_obj) },
     { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&microbit_music_stop_obj) },
+#if defined(NRF52_SERIES)
+    { MP_ROM_QSTR(MP_QSTR_Audio), MP_ROM_PTR(&music_audio_type) },
+#endif
 
     { MP_ROM_QSTR(MP_QSTR_DADADADUM), MP_ROM_PTR(&microbit_music_tune_dadadadum_obj) },
     { MP_ROM_QSTR(MP_QSTR_ENTERTAINER), MP_ROM_PTR(&microbit_music_tune_entertainer_obj) },
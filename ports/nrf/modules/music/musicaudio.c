@@ -0,0 +1,507 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+
+#if MICROPY_PY_MUSIC && defined(NRF52_SERIES)
+
+#include "nrfx_pwm.h"
+#include "pin.h"
+#include "genhdr/pins.h"
+#include "musicaudio.h"
+#include "extmod/machine_audio.h"
+
+/// \moduleref music
+/// \class Audio - sample playback on a PWM output
+///
+/// The same interface as pyb.Audio on stm32, without the voice mixer.
+/// Samples are unsigned 8-bit values, one per byte of a buffer, and set the
+/// PWM duty cycle.  The PWM period is one sample, and the PWM peripheral
+/// reads the duty cycles from RAM with EasyDMA, so playback doesn't involve
+/// Python and keeps going while the script does other things.
+///
+///     audio = music.Audio(8000)
+///     audio.play(open('boom.raw', 'rb').read())
+///
+/// music.play() and music.pitch() use the same PWM peripheral for their
+/// square wave, so they stop any samples that are playing, and the other
+/// way around.  machine.PWM can't use that peripheral while either has it.
+
+// The PWM instance used for music; the last one, so that machine.PWM(0)
+// and up are free.
+#ifndef MICROPY_HW_MUSIC_PWM
+#if NRF52840
+#define MICROPY_HW_MUSIC_PWM (3)
+#else
+#define MICROPY_HW_MUSIC_PWM (2)
+#endif
+#endif
+
+// The PWM plays sequence 0 then sequence 1 from the two halves of a ring,
+// and loops.  Each half is refilled from the queued buffers by the END_SEQ
+// event of that half, while the other half plays.
+#define AUDIO_HALF_LEN (128)
+
+#define AUDIO_PWM_CLK_FREQ (16000000)
+
+enum {
+    MUSIC_PWM_NONE,
+    MUSIC_PWM_TONE,
+    MUSIC_PWM_AUDIO,
+};
+
+typedef struct _music_audio_obj_t {
+    mp_obj_base_t base;
+    uint16_t top; // PWM counts per sample, 0 if not initialised
+    uint8_t pin;
+    volatile bool playing;
+    bool loop;
+    uint8_t idle; // consecutive halves of the ring filled with silence
+    // the buffer being played and the one queued after it; the objects
+    // are held so the GC doesn't reclaim them while the DMA reads them
+    mp_obj_t cur_obj;
+    const uint8_t *cur_buf;
+    size_t cur_len;
+    size_t cur_pos;
+    mp_obj_t next_obj;
+    const uint8_t *next_buf;
+    size_t next_len;
+} music_audio_obj_t;
+
+STATIC const nrfx_pwm_t music_pwm = NRFX_PWM_INSTANCE(MICROPY_HW_MUSIC_PWM);
+STATIC volatile uint8_t music_pwm_owner;
+STATIC uint8_t music_pwm_pin;
+
+STATIC uint16_t audio_ring[2 * AUDIO_HALF_LEN];
+STATIC uint16_t tone_seq[1];
+
+// A sequence value is the count at which the output goes high, so the high
+// time of a period is top minus the value.
+#define PWM_VALUE(top, duty) ((top) - (((uint32_t)(duty) * (top)) >> 8))
+
+STATIC bool music_pwm_init(uint8_t pin, nrf_pwm_clk_t clk, uint16_t top, nrfx_pwm_handler_t handler) {
+    if (music_pwm_owner != MUSIC_PWM_NONE) {
+        nrfx_pwm_uninit(&music_pwm);
+        music_pwm_owner = MUSIC_PWM_NONE;
+    }
+
+    nrfx_pwm_config_t config;
+    config.output_pins[0] = pin;
+    config.output_pins[1] = NRFX_PWM_PIN_NOT_USED;
+    config.output_pins[2] = NRFX_PWM_PIN_NOT_USED;
+    config.output_pins[3] = NRFX_PWM_PIN_NOT_USED;
+    config.irq_priority   = 6;
+    config.base_clock     = clk;
+    config.count_mode     = NRF_PWM_MODE_UP;
+    config.top_value      = top;
+    config.load_mode      = NRF_PWM_LOAD_COMMON;
+    config.step_mode      = NRF_PWM_STEP_AUTO;
+
+    // this fails if machine.PWM has the instance
+    if (nrfx_pwm_init(&music_pwm, &config, handler) != NRFX_SUCCESS) {
+        return false;
+    }
+    music_pwm_pin = pin;
+    return true;
+}
+
+// Fill one half of the ring from the queued buffers.
+STATIC void audio_fill(music_audio_obj_t *self, uint16_t *dest) {
+    uint32_t top = self->top;
+    size_t n = 0;
+    while (n < AUDIO_HALF_LEN) {
+        if (self->cur_pos >= self->cur_len) {
+            if (self->next_buf != NULL) {
+                self->cur_obj = self->next_obj;
+                self->cur_buf = self->next_buf;
+                self->cur_len = self->next_len;
+                self->next_obj = MP_OBJ_NULL;
+                self->next_buf = NULL;
+            } else if (!self->loop || self->cur_len == 0) {
+                break;
+            }
+            self->cur_pos = 0;
+        }
+        size_t len = MIN(AUDIO_HALF_LEN - n, self->cur_len - self->cur_pos);
+        const uint8_t *src = self->cur_buf + self->cur_pos;
+        self->cur_pos += len;
+        while (len--) {
+            dest[n++] = PWM_VALUE(top, *src++);
+        }
+    }
+    if (n > 0) {
+        self->idle = 0;
+    } else {
+        self->idle += 1;
+    }
+    // silence is mid scale, so the speaker doesn't click
+    while (n < AUDIO_HALF_LEN) {
+        dest[n++] = PWM_VALUE(top, 128);
+    }
+}
+
+// Can be called from the PWM and ticker IRQs.
+STATIC void audio_stop(music_audio_obj_t *self) {
+    if (self->playing) {
+        nrfx_pwm_stop(&music_pwm, false);
+    }
+    self->cur_obj = MP_OBJ_NULL;
+    self->cur_buf = NULL;
+    self->cur_len = 0;
+    self->cur_pos = 0;
+    self->next_obj = MP_OBJ_NULL;
+    self->next_buf = NULL;
+    self->playing = false;
+}
+
+STATIC void audio_pwm_handler(nrfx_pwm_evt_type_t event_type) {
+    music_audio_obj_t *self = MP_STATE_PORT(music_audio_obj);
+    if (self == NULL || !self->playing) {
+        return;
+    }
+    if (event_type == NRFX_PWM_EVT_END_SEQ0) {
+        audio_fill(self, &audio_ring[0]);
+    } else if (event_type == NRFX_PWM_EVT_END_SEQ1) {
+        audio_fill(self, &audio_ring[AUDIO_HALF_LEN]);
+    } else {
+        return;
+    }
+    if (self->idle >= 2) {
+        // the last samples have played out of the other half
+        audio_stop(self);
+    }
+}
+
+STATIC void audio_start(music_audio_obj_t *self) {
+    // prime the whole ring before the PWM starts
+    self->idle = 0;
+    audio_fill(self, &audio_ring[0]);
+    audio_fill(self, &audio_ring[AUDIO_HALF_LEN]);
+
+    nrf_pwm_sequence_t seq0 = {
+        .values.p_common = &audio_ring[0],
+        .length = AUDIO_HALF_LEN,
+        .repeats = 0,
+        .end_delay = 0
+    };
+    nrf_pwm_sequence_t seq1 = {
+        .values.p_common = &audio_ring[AUDIO_HALF_LEN],
+        .length = AUDIO_HALF_LEN,
+        .repeats = 0,
+        .end_delay = 0
+    };
+
+    // the ticker IRQ can take the PWM for a tone, so the handover is atomic
+    bool ok;
+    NRFX_CRITICAL_SECTION_ENTER();
+    ok = music_pwm_init(self->pin, NRF_PWM_CLK_16MHz, self->top, audio_pwm_handler);
+    if (ok) {
+        music_pwm_owner = MUSIC_PWM_AUDIO;
+        self->playing = true;
+        nrfx_pwm_complex_playback(&music_pwm, &seq0, &seq1, 1,
+            NRFX_PWM_FLAG_LOOP | NRFX_PWM_FLAG_SIGNAL_END_SEQ0 | NRFX_PWM_FLAG_SIGNAL_END_SEQ1);
+    }
+    NRFX_CRITICAL_SECTION_EXIT();
+
+    if (!ok) {
+        audio_stop(self);
+        mp_raise_msg(&mp_type_OSError, "PWM in use");
+    }
+}
+
+STATIC void audio_stop_atomic(music_audio_obj_t *self) {
+    NRFX_CRITICAL_SECTION_ENTER();
+    audio_stop(self);
+    NRFX_CRITICAL_SECTION_EXIT();
+}
+
+int music_audio_tone(uint8_t pin, uint32_t period_us) {
+    // use the fastest clock that the period fits the 15-bit counter at
+    nrf_pwm_clk_t clk = NRF_PWM_CLK_1MHz;
+    uint32_t top = period_us;
+    while (top > 0x7fff && clk < NRF_PWM_CLK_125kHz) {
+        clk = (nrf_pwm_clk_t)(clk + 1);
+        top >>= 1;
+    }
+    if (top < 3 || top > 0x7fff) {
+        return -1;
+    }
+
+    if (music_pwm_owner == MUSIC_PWM_AUDIO && MP_STATE_PORT(music_audio_obj) != NULL) {
+        audio_stop(MP_STATE_PORT(music_audio_obj));
+    }
+    if (music_pwm_owner != MUSIC_PWM_TONE || music_pwm_pin != pin) {
+        if (!music_pwm_init(pin, clk, top, NULL)) {
+            return -1;
+        }
+        music_pwm_owner = MUSIC_PWM_TONE;
+    } else {
+        nrf_pwm_configure(music_pwm.p_registers, clk, NRF_PWM_MODE_UP, top);
+    }
+
+    // one value played over and over gives a square wave with no IRQs
+    tone_seq[0] = PWM_VALUE(top, 128);
+    nrf_pwm_sequence_t seq = {
+        .values.p_common = tone_seq,
+        .length = 1,
+        .repeats = 0,
+        .end_delay = 0
+    };
+    nrfx_pwm_simple_playback(&music_pwm, &seq, 1, NRFX_PWM_FLAG_LOOP);
+    return 0;
+}
+
+void music_audio_tone_off(void) {
+    if (music_pwm_owner == MUSIC_PWM_TONE) {
+        nrfx_pwm_stop(&music_pwm, false);
+    }
+}
+
+void music_audio_deinit(void) {
+    if (MP_STATE_PORT(music_audio_obj) != NULL) {
+        audio_stop_atomic(MP_STATE_PORT(music_audio_obj));
+        MP_STATE_PORT(music_audio_obj) = NULL;
+    }
+    if (music_pwm_owner != MUSIC_PWM_NONE) {
+        nrfx_pwm_uninit(&music_pwm);
+        music_pwm_owner = MUSIC_PWM_NONE;
+    }
+}
+
+STATIC void audio_check_init(music_audio_obj_t *self) {
+    if (self->top == 0) {
+        mp_raise_msg(&mp_type_OSError, "Audio not initialised");
+    }
+}
+
+STATIC void audio_set_freq(music_audio_obj_t *self, mp_int_t freq) {
+    // at least 8 bits of duty cycle, and no more than the 15-bit counter
+    if (freq <= 0 || AUDIO_PWM_CLK_FREQ / freq < 256 || AUDIO_PWM_CLK_FREQ / freq > 0x7fff) {
+        mp_raise_ValueError("freq out of range");
+    }
+    self->top = AUDIO_PWM_CLK_FREQ / freq;
+}
+
+// The audio protocol, through which write() queues buffers.
+
+STATIC mp_uint_t audio_p_freq(void *self_in) {
+    music_audio_obj_t *self = self_in;
+    return self->top == 0 ? 0 : AUDIO_PWM_CLK_FREQ / self->top;
+}
+
+STATIC bool audio_p_queue(void *self_in, mp_obj_t buf_in, const mp_buffer_info_t *bufinfo) {
+    music_audio_obj_t *self = self_in;
+    bool start = false;
+    bool queued = false;
+    NRFX_CRITICAL_SECTION_ENTER();
+    if (!self->playing) {
+        self->cur_obj = buf_in;
+        self->cur_buf = bufinfo->buf;
+        self->cur_len = bufinfo->len;
+        self->cur_pos = 0;
+        start = true;
+    } else if (self->next_buf == NULL) {
+        self->next_obj = buf_in;
+        self->next_buf = bufinfo->buf;
+        self->next_len = bufinfo->len;
+        queued = true;
+    }
+    NRFX_CRITICAL_SECTION_EXIT();
+    if (start) {
+        audio_start(self);
+    }
+    return start || queued;
+}
+
+STATIC bool audio_p_busy(void *self_in) {
+    music_audio_obj_t *self = self_in;
+    return self->playing;
+}
+
+STATIC void audio_p_stop(void *self_in) {
+    audio_stop_atomic(self_in);
+}
+
+STATIC const mp_machine_audio_p_t audio_p = {
+    .freq = audio_p_freq,
+    .queue = audio_p_queue,
+    .busy = audio_p_busy,
+    .stop = audio_p_stop,
+};
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC void music_audio_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    music_audio_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->top == 0) {
+        mp_print_str(print, "Audio()");
+    } else {
+        mp_printf(print, "Audio(freq=%u, pin=%u)", AUDIO_PWM_CLK_FREQ / self->top, self->pin);
+    }
+}
+
+/// \classmethod \constructor(freq=8000, *, pin)
+/// There is one audio output; this initialises it at the given sample rate
+/// on the given pin, by default the music pin of the board, and returns it.
+STATIC mp_obj_t music_audio_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_freq, MP_ARG_INT, {.u_int = 8000} },
+        { MP_QSTR_pin, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    const pin_obj_t *pin;
+    if (args[1].u_obj == MP_OBJ_NULL) {
+#ifdef MICROPY_HW_MUSIC_PIN
+        pin = mp_hal_get_pin_obj(MP_OBJ_NEW_SMALL_INT(MICROPY_HW_MUSIC_PIN));
+#else
+        mp_raise_ValueError("pin parameter not given");
+#endif
+    } else {
+        pin = mp_hal_get_pin_obj(args[1].u_obj);
+    }
+
+    music_audio_obj_t *self = MP_STATE_PORT(music_audio_obj);
+    if (self == NULL) {
+        self = m_new0(music_audio_obj_t, 1);
+        self->base.type = &music_audio_type;
+        MP_STATE_PORT(music_audio_obj) = self;
+    } else {
+        audio_stop_atomic(self);
+    }
+    audio_set_freq(self, args[0].u_int);
+    self->pin = pin->pin;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+/// \method init(freq)
+/// Stop playing and set the sample rate.
+STATIC mp_obj_t music_audio_init(mp_obj_t self_in, mp_obj_t freq_in) {
+    music_audio_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    audio_stop_atomic(self);
+    audio_set_freq(self, mp_obj_get_int(freq_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(music_audio_init_obj, music_audio_init);
+
+/// \method deinit()
+/// Stop playing and release the PWM peripheral.
+STATIC mp_obj_t music_audio_deinit_method(mp_obj_t self_in) {
+    music_audio_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    NRFX_CRITICAL_SECTION_ENTER();
+    audio_stop(self);
+    if (music_pwm_owner == MUSIC_PWM_AUDIO) {
+        nrfx_pwm_uninit(&music_pwm);
+        music_pwm_owner = MUSIC_PWM_NONE;
+    }
+    NRFX_CRITICAL_SECTION_EXIT();
+    self->top = 0;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(music_audio_deinit_obj, music_audio_deinit_method);
+
+/// \method play(buf, *, loop=False)
+/// Drop the buffers being played and play `buf` now.  With `loop=True` the
+/// last buffer repeats until another is written.
+STATIC mp_obj_t music_audio_play(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_loop, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    music_audio_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    audio_check_init(self);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_READ);
+
+    bool start;
+    NRFX_CRITICAL_SECTION_ENTER();
+    self->loop = args[1].u_bool;
+    self->cur_obj = args[0].u_obj;
+    self->cur_buf = bufinfo.buf;
+    self->cur_len = bufinfo.len;
+    self->cur_pos = 0;
+    self->next_obj = MP_OBJ_NULL;
+    self->next_buf = NULL;
+    start = !self->playing;
+    NRFX_CRITICAL_SECTION_EXIT();
+
+    if (start && bufinfo.len > 0) {
+        audio_start(self);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(music_audio_play_obj, 1, music_audio_play);
+
+/// \method write(buf)
+/// Queue `buf` to play after the current buffer, starting playback if it
+/// has stopped.  One buffer can wait in the queue; if one already is then
+/// this blocks until it starts playing.
+STATIC mp_obj_t music_audio_write(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_machine_audio_write(&audio_p, MP_OBJ_TO_PTR(self_in), buf_in);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(music_audio_write_obj, music_audio_write);
+
+/// \method stop()
+/// Stop playing and drop anything queued.
+STATIC mp_obj_t music_audio_stop(mp_obj_t self_in) {
+    audio_p.stop(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(music_audio_stop_obj, music_audio_stop);
+
+/// \method busy()
+/// Return True while samples are playing.
+STATIC mp_obj_t music_audio_busy(mp_obj_t self_in) {
+    return mp_obj_new_bool(audio_p.busy(MP_OBJ_TO_PTR(self_in)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(music_audio_busy_obj, music_audio_busy);
+
+STATIC const mp_rom_map_elem_t music_audio_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&music_audio_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&music_audio_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_play), MP_ROM_PTR(&music_audio_play_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&music_audio_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&music_audio_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&music_audio_busy_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(music_audio_locals_dict, music_audio_locals_dict_table);
+
+const mp_obj_type_t music_audio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Audio,
+    .print = music_audio_print,
+    .make_new = music_audio_make_new,
+    .locals_dict = (mp_obj_dict_t*)&music_audio_locals_dict,
+};
+
+#endif // MICROPY_PY_MUSIC && defined(NRF52_SERIES)
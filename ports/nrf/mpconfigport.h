@@ -146,6 +146,11 @@
 #define MICROPY_PY_MUSIC            (0)
 #endif
 
+// music.Audio queues buffers through the shared audio protocol
+#if MICROPY_PY_MUSIC && defined(NRF52_SERIES)
+#define MICROPY_PY_MACHINE_AUDIO    (1)
+#endif
+
 #ifndef MICROPY_PY_MACHINE_ADC
 #define MICROPY_PY_MACHINE_ADC      (0)
 #endif
@@ -298,7 +303,11 @@ extern const struct _mp_obj_module_t ble_module;
 
 #define MP_STATE_PORT MP_STATE_VM
 
-#if MICROPY_PY_MUSIC
+#if MICROPY_PY_MUSIC && defined(NRF52_SERIES)
+#define ROOT_POINTERS_MUSIC \
+    struct _music_data_t *music_data; \
+    struct _music_audio_obj_t *music_audio_obj;
+#elif MICROPY_PY_MUSIC
 #define ROOT_POINTERS_MUSIC \
     struct _music_data_t *music_data;
 #else
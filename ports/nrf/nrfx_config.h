@@ -97,7 +97,7 @@
 #define NRFX_TIMER4_ENABLED (!NRF51)
 
 
-#define NRFX_PWM_ENABLED (!NRF51) && MICROPY_PY_MACHINE_HW_PWM
+#define NRFX_PWM_ENABLED (!NRF51) && (MICROPY_PY_MACHINE_HW_PWM || MICROPY_PY_MUSIC)
 #define NRFX_PWM0_ENABLED 1
 #define NRFX_PWM1_ENABLED 1
 #define NRFX_PWM2_ENABLED 1
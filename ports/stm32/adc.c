@@ -29,10 +29,13 @@
 
 #include "py/runtime.h"
 #include "py/binary.h"
+#include "py/mperrno.h"
 #include "py/mphal.h"
 #include "adc.h"
 #include "pin.h"
 #include "timer.h"
+#include "dma.h"
+#include "irq.h"
 
 #if MICROPY_HW_ENABLE_ADC
 
@@ -184,6 +187,16 @@ static inline uint32_t adc_get_internal_channel(uint32_t channel) {
     return channel;
 }
 
+// ADC.capture() owns ADC1 until it is stopped, so anything else that would
+// reconfigure it must fail instead
+STATIC void adc_check_not_capturing(void) {
+    #if MICROPY_HW_ENABLE_ADC_CAPTURE
+    if (MP_STATE_PORT(pyb_adc_capture_obj) != NULL) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    #endif
+}
+
 STATIC bool is_adcx_channel(int channel) {
 #if defined(STM32F411xE)
     // The HAL has an incorrect IS_ADC_CHANNEL macro for the F411 so we check for temp
@@ -228,6 +241,7 @@ STATIC void adcx_clock_enable(void) {
 }
 
 STATIC void adcx_init_periph(ADC_HandleTypeDef *adch, uint32_t resolution) {
+    adc_check_not_capturing();
     adcx_clock_enable();
 
     adch->Instance                   = ADCx;
@@ -303,11 +317,14 @@ STATIC void adc_init_single(pyb_obj_adc_t *adc_obj) {
 #endif
 }
 
-STATIC void adc_config_channel(ADC_HandleTypeDef *adc_handle, uint32_t channel) {
+// configure the given channel as the rank'th conversion of the regular group
+STATIC void adc_config_rank(ADC_HandleTypeDef *adc_handle, uint32_t channel, uint32_t rank) {
     ADC_ChannelConfTypeDef sConfig;
 
+    adc_check_not_capturing();
+
     sConfig.Channel = channel;
-    sConfig.Rank = 1;
+    sConfig.Rank = rank;
 #if defined(STM32F0)
     sConfig.SamplingTime = ADC_SAMPLETIME_71CYCLES_5;
 #elif defined(STM32F4) || defined(STM32F7)
@@ -348,6 +365,10 @@ STATIC void adc_config_channel(ADC_HandleTypeDef *adc_handle, uint32_t channel)
     HAL_ADC_ConfigChannel(adc_handle, &sConfig);
 }
 
+STATIC void adc_config_channel(ADC_HandleTypeDef *adc_handle, uint32_t channel) {
+    adc_config_rank(adc_handle, channel, 1);
+}
+
 STATIC uint32_t adc_read_channel(ADC_HandleTypeDef *adcHandle) {
     HAL_ADC_Start(adcHandle);
     adc_wait_for_eoc_or_timeout(EOC_TIMEOUT);
@@ -651,10 +672,321 @@ STATIC mp_obj_t adc_read_timed_multi(mp_obj_t adc_array_in, mp_obj_t buf_array_i
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(adc_read_timed_multi_fun_obj, adc_read_timed_multi);
 STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(adc_read_timed_multi_obj, MP_ROM_PTR(&adc_read_timed_multi_fun_obj));
 
+#if MICROPY_HW_ENABLE_ADC_CAPTURE
+
+// Most channels the regular group can sequence through
+#define ADC_CAPTURE_MAX_CHANNELS (16)
+
+// State of the background capture started by ADC.capture().  There is only
+// one ADC1, so only one capture runs at a time; its ADC object, buffer and
+// callback are kept alive by root pointers while it does.  Samples of a
+// multi-channel capture are interleaved in frames of nchan, and all the
+// counts and indices below stay at frame boundaries.
+typedef struct _adc_capture_t {
+    uint16_t *buf;
+    uint32_t len;
+    uint32_t nchan;
+    volatile uint32_t laps;     // times the DMA has wrapped round buf
+    uint32_t rd_idx;            // index in buf of the next sample to read
+    uint32_t rd_total;          // samples consumed so far, modulo 2**32
+    uint32_t lost;              // samples overwritten before they were read
+} adc_capture_t;
+
+STATIC adc_capture_t adc_capture;
+STATIC DMA_HandleTypeDef adc_capture_dma;
+
+STATIC void adc_capture_schedule(mp_int_t half) {
+    mp_obj_t callback = MP_STATE_PORT(pyb_adc_capture_callback);
+    if (callback != MP_OBJ_NULL) {
+        mp_sched_schedule(callback, MP_OBJ_NEW_SMALL_INT(half));
+    }
+}
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc) {
+    adc_capture_schedule(0);
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) {
+    adc_capture.laps += 1;
+    adc_capture_schedule(1);
+}
+
+// Return the number of samples written since the capture began (modulo
+// 2**32), and set *idx to the index in buf the next one will be written to.
+STATIC uint32_t adc_capture_written(uint32_t *idx) {
+    uint32_t len = adc_capture.len;
+    uint32_t irq_state = disable_irq();
+    uint32_t laps = adc_capture.laps;
+    uint32_t pos = len - __HAL_DMA_GET_COUNTER(&adc_capture_dma);
+    if (__HAL_DMA_GET_FLAG(&adc_capture_dma, __HAL_DMA_GET_TC_FLAG_INDEX(&adc_capture_dma))
+        && pos < len / 2) {
+        // the DMA has wrapped round but its IRQ hasn't run yet to count it
+        laps += 1;
+    }
+    enable_irq(irq_state);
+    *idx = pos == len ? 0 : pos;
+    return laps * len + pos;
+}
+
+STATIC void adc_capture_get_buffer(mp_obj_t buf_in, mp_buffer_info_t *bufinfo) {
+    mp_get_buffer_raise(buf_in, bufinfo, MP_BUFFER_WRITE);
+    if (mp_binary_get_size('@', bufinfo->typecode, NULL) != 2) {
+        mp_raise_ValueError("buffer must have 16-bit elements");
+    }
+}
+
+STATIC void adc_capture_check(void) {
+    if (MP_STATE_PORT(pyb_adc_capture_obj) == NULL) {
+        mp_raise_msg(&mp_type_OSError, "ADC not capturing");
+    }
+}
+
+STATIC uint32_t adc_capture_trigger(mp_obj_t timer) {
+    // the timer's update event, on TRGO, starts each conversion
+    TIM_HandleTypeDef *tim = pyb_timer_get_handle(timer);
+    TIM_MasterConfigTypeDef config;
+    config.MasterOutputTrigger = TIM_TRGO_UPDATE;
+    config.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    HAL_TIMEx_MasterConfigSynchronization(tim, &config);
+
+    // work out the trigger source (only certain timers can start ADC1)
+    if (tim->Instance == TIM2) {
+        return ADC_EXTERNALTRIGCONV_T2_TRGO;
+    } else if (tim->Instance == TIM3) {
+        return ADC_EXTERNALTRIGCONV_T3_TRGO;
+    #if defined(TIM8)
+    } else if (tim->Instance == TIM8) {
+        return ADC_EXTERNALTRIGCONV_T8_TRGO;
+    #endif
+    } else {
+        mp_raise_ValueError("Timer does not support ADC triggering");
+    }
+}
+
+void adc_capture_deinit(void) {
+    pyb_obj_adc_t *self = MP_STATE_PORT(pyb_adc_capture_obj);
+    if (self == NULL) {
+        return;
+    }
+    HAL_ADC_Stop_DMA(&self->handle);
+    dma_deinit(&dma_ADC_1_RX);
+    MP_STATE_PORT(pyb_adc_capture_obj) = NULL;
+    MP_STATE_PORT(pyb_adc_capture_buf) = MP_OBJ_NULL;
+    MP_STATE_PORT(pyb_adc_capture_callback) = MP_OBJ_NULL;
+    // back to software-started single conversions, for read()
+    adcx_init_periph(&self->handle, ADC_RESOLUTION_12B);
+}
+
+// Start a capture of the channels of the nadcs ADC objects in adcs, in that
+// order, using the handle of the first one to drive ADC1.
+STATIC void adc_capture_begin(size_t nadcs, const mp_obj_t *adcs, mp_obj_t buf_in, mp_obj_t timer, mp_obj_t callback) {
+    if (nadcs < 1) {
+        mp_raise_ValueError("need at least 1 ADC");
+    }
+    if (nadcs > ADC_CAPTURE_MAX_CHANNELS) {
+        mp_raise_ValueError("too many ADCs");
+    }
+    for (size_t i = 0; i < nadcs; i++) {
+        if (!mp_obj_is_type(adcs[i], &pyb_adc_type)) {
+            mp_raise_TypeError("expecting an ADC");
+        }
+    }
+
+    mp_buffer_info_t bufinfo;
+    adc_capture_get_buffer(buf_in, &bufinfo);
+    uint32_t len = bufinfo.len / 2;
+    if (len == 0 || len % (2 * nadcs) != 0) {
+        // so each half of the buffer holds whole frames
+        mp_raise_ValueError("buffer length must be a multiple of 2 * number of ADCs");
+    }
+    if (callback != mp_const_none && !mp_obj_is_callable(callback)) {
+        mp_raise_ValueError("callback must be None or a callable object");
+    }
+
+    // a new capture replaces any running one
+    adc_capture_deinit();
+
+    uint32_t trigger = adc_capture_trigger(timer);
+
+    // convert the whole group in sequence on each trigger edge, and request
+    // a DMA transfer for every conversion rather than only the first
+    pyb_obj_adc_t *self = MP_OBJ_TO_PTR(adcs[0]);
+    adcx_init_periph(&self->handle, ADC_RESOLUTION_12B);
+    self->handle.Init.ScanConvMode = nadcs > 1 ? ENABLE : DISABLE;
+    self->handle.Init.NbrOfConversion = nadcs;
+    self->handle.Init.ExternalTrigConv = trigger;
+    self->handle.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    self->handle.Init.DMAContinuousRequests = ENABLE;
+    HAL_ADC_Init(&self->handle);
+    for (size_t i = 0; i < nadcs; i++) {
+        pyb_obj_adc_t *adc = MP_OBJ_TO_PTR(adcs[i]);
+        adc_config_rank(&self->handle, adc->channel, i + 1);
+    }
+
+    dma_init(&adc_capture_dma, &dma_ADC_1_RX, DMA_PERIPH_TO_MEMORY, &self->handle);
+    self->handle.DMA_Handle = &adc_capture_dma;
+
+    adc_capture.buf = bufinfo.buf;
+    adc_capture.len = len;
+    adc_capture.nchan = nadcs;
+    adc_capture.laps = 0;
+    adc_capture.rd_idx = 0;
+    adc_capture.rd_total = 0;
+    adc_capture.lost = 0;
+    MP_STATE_PORT(pyb_adc_capture_obj) = self;
+    MP_STATE_PORT(pyb_adc_capture_buf) = buf_in;
+    MP_STATE_PORT(pyb_adc_capture_callback) = callback == mp_const_none ? MP_OBJ_NULL : callback;
+
+    // HAL_ADC_Start_DMA sets the DMA callbacks that lead to the ones above
+    HAL_ADC_Start_DMA(&self->handle, (uint32_t*)bufinfo.buf, len);
+}
+
+/// \method capture(buf, timer, *, callback=None)
+///
+/// Start sampling into `buf` in the background, one sample each time `timer`
+/// triggers, which must be Timer 2 or 3 (or 8).  `buf` must have 16-bit
+/// elements, eg array.array('H'), and an even length, and is filled round
+/// and round by circular DMA until capture_stop() is called.
+///
+/// If `callback` is given it is scheduled with 0 as soon as the first half of
+/// `buf` has been filled, and with 1 when the second half has.
+///
+/// While capturing, anything else using ADC1 raises OSError(EBUSY).
+STATIC mp_obj_t adc_capture_start(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_timer, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_timer, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    adc_capture_begin(1, pos_args, args[ARG_buf].u_obj, args[ARG_timer].u_obj, args[ARG_callback].u_obj);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(adc_capture_start_obj, 3, adc_capture_start);
+
+// capture_multi((adcx, adcy, ...), buf, timer, *, callback=None)
+//
+// As capture(), but scans the channels of all the given ADC's in hardware
+// on each timer trigger, storing the samples interleaved in `buf`:
+// adcx, adcy, ..., adcx, adcy, ...  The length of `buf` must be a multiple
+// of twice the number of ADC's.
+STATIC mp_obj_t adc_capture_multi(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_adcs, ARG_buf, ARG_timer, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_adcs, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_timer, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    size_t nadcs;
+    mp_obj_t *adcs;
+    mp_obj_get_array(args[ARG_adcs].u_obj, &nadcs, &adcs);
+    adc_capture_begin(nadcs, adcs, args[ARG_buf].u_obj, args[ARG_timer].u_obj, args[ARG_callback].u_obj);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(adc_capture_multi_fun_obj, 3, adc_capture_multi);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(adc_capture_multi_obj, MP_ROM_PTR(&adc_capture_multi_fun_obj));
+
+/// \method capture_pos()
+/// Return the index in the capture buffer that the next sample will be
+/// written to.
+STATIC mp_obj_t adc_capture_pos(mp_obj_t self_in) {
+    adc_capture_check();
+    uint32_t idx;
+    adc_capture_written(&idx);
+    return MP_OBJ_NEW_SMALL_INT(idx);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(adc_capture_pos_obj, adc_capture_pos);
+
+/// \method capture_read(buf)
+///
+/// Copy the samples captured since the last call into `buf`, oldest first,
+/// and return how many were copied; at most as many whole frames as fit in
+/// `buf`.  If the
+/// capture has lapped the reader then the samples that were overwritten are
+/// skipped, and counted in the value returned by capture_stop().
+STATIC mp_obj_t adc_capture_read(mp_obj_t self_in, mp_obj_t buf_in) {
+    adc_capture_check();
+    mp_buffer_info_t bufinfo;
+    adc_capture_get_buffer(buf_in, &bufinfo);
+
+    // on an overrun the ADC stops making DMA requests, so the capture is dead
+    if (ADCx->SR & ADC_SR_OVR) {
+        mp_raise_OSError(MP_EIO);
+    }
+
+    uint32_t len = adc_capture.len;
+    uint32_t idx;
+    uint32_t total = adc_capture_written(&idx);
+    uint32_t avail = total - adc_capture.rd_total;
+    if (avail > len) {
+        // the oldest sample still in the buffer is the one at idx, so carry
+        // on from the first whole frame after it
+        uint32_t nchan = adc_capture.nchan;
+        uint32_t skip = (nchan - idx % nchan) % nchan;
+        adc_capture.lost += avail - len + skip;
+        adc_capture.rd_total = total - len + skip;
+        adc_capture.rd_idx = idx + skip;
+        if (adc_capture.rd_idx >= len) {
+            adc_capture.rd_idx -= len;
+        }
+        avail = len - skip;
+    }
+
+    // only whole frames are returned
+    uint32_t n = MIN(avail, bufinfo.len / 2);
+    n -= n % adc_capture.nchan;
+    uint32_t n1 = MIN(n, len - adc_capture.rd_idx);
+    uint16_t *dest = bufinfo.buf;
+    memcpy(dest, adc_capture.buf + adc_capture.rd_idx, n1 * 2);
+    memcpy(dest + n1, adc_capture.buf, (n - n1) * 2);
+
+    adc_capture.rd_idx += n;
+    if (adc_capture.rd_idx >= len) {
+        adc_capture.rd_idx -= len;
+    }
+    adc_capture.rd_total += n;
+
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(adc_capture_read_obj, adc_capture_read);
+
+/// \method capture_stop()
+/// Stop a background capture, and return the number of samples that were
+/// overwritten before capture_read() could return them.
+STATIC mp_obj_t adc_capture_stop(mp_obj_t self_in) {
+    uint32_t lost = 0;
+    if (MP_STATE_PORT(pyb_adc_capture_obj) != NULL) {
+        lost = adc_capture.lost;
+        adc_capture_deinit();
+    }
+    return mp_obj_new_int_from_uint(lost);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(adc_capture_stop_obj, adc_capture_stop);
+
+#endif // MICROPY_HW_ENABLE_ADC_CAPTURE
+
 STATIC const mp_rom_map_elem_t adc_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&adc_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_read_timed), MP_ROM_PTR(&adc_read_timed_obj) },
     { MP_ROM_QSTR(MP_QSTR_read_timed_multi), MP_ROM_PTR(&adc_read_timed_multi_obj) },
+    #if MICROPY_HW_ENABLE_ADC_CAPTURE
+    { MP_ROM_QSTR(MP_QSTR_capture), MP_ROM_PTR(&adc_capture_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_capture_multi), MP_ROM_PTR(&adc_capture_multi_obj) },
+    { MP_ROM_QSTR(MP_QSTR_capture_read), MP_ROM_PTR(&adc_capture_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_capture_pos), MP_ROM_PTR(&adc_capture_pos_obj) },
+    { MP_ROM_QSTR(MP_QSTR_capture_stop), MP_ROM_PTR(&adc_capture_stop_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(adc_locals_dict, adc_locals_dict_table);
@@ -29,4 +29,6 @@
 extern const mp_obj_type_t pyb_adc_type;
 extern const mp_obj_type_t pyb_adc_all_type;
 
+void adc_capture_deinit(void);
+
 #endif // MICROPY_INCLUDED_STM32_ADC_H
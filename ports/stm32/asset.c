@@ -0,0 +1,535 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "irq.h"
+#include "storage.h"
+#include "asset.h"
+
+#if MICROPY_HW_ENABLE_ASSETS
+
+/// \moduleref pyb
+/// \class Asset - read-only data from the asset image
+///
+/// The asset image is a table of named blobs in a flash partition that the
+/// filesystem doesn't use, so data shipped with an app is read without going
+/// through FatFs.  An Asset is a read-only stream, and can be indexed and
+/// sliced like bytes.  Where the partition is memory mapped it also has the
+/// buffer protocol, so `memoryview(asset)` points straight at the flash.
+///
+///     tiles = pyb.Asset('tiles.fbi')
+///     fb = framebuf.load(tiles)
+///
+/// The image is made on the host by tools/mkassets.py.
+
+#define ASSET_MAGIC (0x31545341) // "AST1"
+#define ASSET_NAME_LEN (24)
+#define ASSET_WINDOW_SIZE (256)
+
+typedef struct _asset_header_t {
+    uint32_t magic;
+    uint32_t count;
+} asset_header_t;
+
+typedef struct _asset_entry_t {
+    char name[ASSET_NAME_LEN]; // NUL padded
+    uint32_t offset; // from the start of the image
+    uint32_t len;
+} asset_entry_t;
+
+typedef struct _pyb_asset_obj_t {
+    mp_obj_base_t base;
+    uint32_t addr; // offset of the data in the partition
+    uint32_t len;
+    uint32_t pos;
+    #if defined(MICROPY_HW_ASSETS_SPIFLASH)
+    // small reads are served from a window of the data read ahead
+    uint32_t window_pos;
+    uint32_t window_len;
+    uint8_t window[ASSET_WINDOW_SIZE];
+    #endif
+} pyb_asset_obj_t;
+
+STATIC void asset_read(uint32_t addr, size_t len, void *dest) {
+    #if defined(MICROPY_HW_ASSETS_SPIFLASH)
+    uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH); // prevent cache flushing and USB access
+    mp_spiflash_cached_read(MICROPY_HW_ASSETS_SPIFLASH, MICROPY_HW_ASSETS_SPIFLASH_ADDR + addr, len, dest);
+    restore_irq_pri(basepri);
+    #else
+    memcpy(dest, (const uint8_t*)MICROPY_HW_ASSETS_ADDR + addr, len);
+    #endif
+}
+
+// Return the number of entries in the table, 0 if there's no image
+STATIC uint32_t asset_count(void) {
+    asset_header_t hdr;
+    asset_read(0, sizeof(hdr), &hdr);
+    if (hdr.magic != ASSET_MAGIC || hdr.count > (MICROPY_HW_ASSETS_SIZE - sizeof(hdr)) / sizeof(asset_entry_t)) {
+        return 0;
+    }
+    return hdr.count;
+}
+
+STATIC void asset_get_entry(uint32_t i, asset_entry_t *e) {
+    asset_read(sizeof(asset_header_t) + i * sizeof(asset_entry_t), sizeof(*e), e);
+}
+
+STATIC size_t asset_name_len(const asset_entry_t *e) {
+    size_t n = 0;
+    while (n < ASSET_NAME_LEN && e->name[n] != '\0') {
+        ++n;
+    }
+    return n;
+}
+
+STATIC void asset_copy(pyb_asset_obj_t *self, uint32_t pos, size_t len, uint8_t *dest) {
+    #if defined(MICROPY_HW_ASSETS_SPIFLASH)
+    if (len < ASSET_WINDOW_SIZE) {
+        if (pos < self->window_pos || pos + len > self->window_pos + self->window_len) {
+            self->window_pos = pos;
+            self->window_len = MIN(ASSET_WINDOW_SIZE, self->len - pos);
+            asset_read(self->addr + pos, self->window_len, self->window);
+        }
+        memcpy(dest, self->window + (pos - self->window_pos), len);
+        return;
+    }
+    #endif
+    asset_read(self->addr + pos, len, dest);
+}
+
+/// \classmethod \constructor(name)
+/// Open the asset called `name`.  Raises `OSError(ENOENT)` if the image
+/// doesn't have it.
+STATIC mp_obj_t pyb_asset_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    size_t name_len;
+    const char *name = mp_obj_str_get_data(args[0], &name_len);
+
+    uint32_t count = asset_count();
+    for (uint32_t i = 0; i < count; ++i) {
+        asset_entry_t e;
+        asset_get_entry(i, &e);
+        if (asset_name_len(&e) != name_len || memcmp(e.name, name, name_len) != 0) {
+            continue;
+        }
+        if (e.offset > MICROPY_HW_ASSETS_SIZE || e.len > MICROPY_HW_ASSETS_SIZE - e.offset) {
+            break;
+        }
+        pyb_asset_obj_t *self = m_new_obj(pyb_asset_obj_t);
+        self->base.type = type;
+        self->addr = e.offset;
+        self->len = e.len;
+        self->pos = 0;
+        #if defined(MICROPY_HW_ASSETS_SPIFLASH)
+        self->window_pos = 0;
+        self->window_len = 0;
+        #endif
+        return MP_OBJ_FROM_PTR(self);
+    }
+    mp_raise_OSError(MP_ENOENT);
+}
+
+STATIC void pyb_asset_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    pyb_asset_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "<Asset %u bytes at 0x%x>", self->len, self->addr);
+}
+
+STATIC mp_obj_t pyb_asset_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    pyb_asset_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return mp_obj_new_bool(self->len != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(self->len);
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t pyb_asset_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    pyb_asset_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (value != MP_OBJ_SENTINEL) {
+        // delete or store
+        return MP_OBJ_NULL; // op not supported
+    }
+    if (mp_obj_is_type(index, &mp_type_slice)) {
+        mp_bound_slice_t slice;
+        if (!mp_seq_get_fast_slice_indexes(self->len, index, &slice)) {
+            mp_raise_NotImplementedError("only slices with step=1 (aka None) are supported");
+        }
+        vstr_t vstr;
+        vstr_init_len(&vstr, slice.stop - slice.start);
+        asset_copy(self, slice.start, vstr.len, (uint8_t*)vstr.buf);
+        return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    }
+    uint8_t b;
+    asset_copy(self, mp_get_index(self->base.type, self->len, index, false), 1, &b);
+    return MP_OBJ_NEW_SMALL_INT(b);
+}
+
+#if !defined(MICROPY_HW_ASSETS_SPIFLASH)
+STATIC mp_int_t pyb_asset_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    pyb_asset_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (flags & MP_BUFFER_WRITE) {
+        return 1;
+    }
+    bufinfo->buf = (void*)(MICROPY_HW_ASSETS_ADDR + self->addr);
+    bufinfo->len = self->len;
+    bufinfo->typecode = 'B';
+    return 0;
+}
+#endif
+
+STATIC mp_uint_t pyb_asset_stream_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
+    pyb_asset_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (size > self->len - self->pos) {
+        size = self->len - self->pos;
+    }
+    asset_copy(self, self->pos, size, buf);
+    self->pos += size;
+    return size;
+}
+
+STATIC mp_uint_t pyb_asset_stream_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    pyb_asset_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_SEEK) {
+        struct mp_stream_seek_t *s = (struct mp_stream_seek_t*)arg;
+        mp_off_t pos = s->offset;
+        if (s->whence == MP_SEEK_CUR) {
+            pos += self->pos;
+        } else if (s->whence == MP_SEEK_END) {
+            pos += self->len;
+        }
+        if (pos < 0) {
+            *errcode = MP_EINVAL;
+            return MP_STREAM_ERROR;
+        }
+        self->pos = MIN((mp_uint_t)pos, self->len);
+        s->offset = self->pos;
+        return 0;
+    } else if (request == MP_STREAM_CLOSE) {
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+/// \classmethod names()
+/// Return a list of the names in the asset image.
+STATIC mp_obj_t pyb_asset_names(void) {
+    uint32_t count = asset_count();
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (uint32_t i = 0; i < count; ++i) {
+        asset_entry_t e;
+        asset_get_entry(i, &e);
+        mp_obj_list_append(list, mp_obj_new_str(e.name, asset_name_len(&e)));
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(pyb_asset_names_fun_obj, pyb_asset_names);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(pyb_asset_names_obj, MP_ROM_PTR(&pyb_asset_names_fun_obj));
+
+#if defined(MICROPY_HW_ASSETS_SPIFLASH)
+/// \classmethod load(stream)
+/// Program the asset partition with the image read from `stream`, eg a file
+/// copied to the filesystem or SD card.  The image is only marked valid once
+/// it's all written, so an interrupted load leaves no assets rather than
+/// broken ones.
+STATIC mp_obj_t pyb_asset_load(mp_obj_t stream) {
+    mp_get_stream_raise(stream, MP_STREAM_OP_READ);
+    uint8_t *buf = m_new(uint8_t, MP_SPIFLASH_ERASE_BLOCK_SIZE);
+    uint32_t magic = 0;
+    for (uint32_t addr = 0;; addr += MP_SPIFLASH_ERASE_BLOCK_SIZE) {
+        int errcode;
+        mp_uint_t n = mp_stream_read_exactly(stream, buf, MP_SPIFLASH_ERASE_BLOCK_SIZE, &errcode);
+        if (errcode != 0) {
+            mp_raise_OSError(errcode);
+        }
+        if (addr == 0) {
+            if (n < sizeof(asset_header_t) || ((asset_header_t*)buf)->magic != ASSET_MAGIC) {
+                mp_raise_ValueError("not an asset image");
+            }
+            // leave the magic erased until the rest is written
+            magic = ((asset_header_t*)buf)->magic;
+            ((asset_header_t*)buf)->magic = 0xffffffff;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (addr + n > MICROPY_HW_ASSETS_SIZE) {
+            mp_raise_ValueError("image too big");
+        }
+        uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH); // prevent cache flushing and USB access
+        int ret = mp_spiflash_erase_block(MICROPY_HW_ASSETS_SPIFLASH, MICROPY_HW_ASSETS_SPIFLASH_ADDR + addr);
+        if (ret == 0) {
+            ret = mp_spiflash_write(MICROPY_HW_ASSETS_SPIFLASH, MICROPY_HW_ASSETS_SPIFLASH_ADDR + addr, n, buf);
+        }
+        restore_irq_pri(basepri);
+        if (ret != 0) {
+            mp_raise_OSError(-ret);
+        }
+        if (n < MP_SPIFLASH_ERASE_BLOCK_SIZE) {
+            break;
+        }
+    }
+    m_del(uint8_t, buf, MP_SPIFLASH_ERASE_BLOCK_SIZE);
+
+    uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH);
+    int ret = mp_spiflash_write(MICROPY_HW_ASSETS_SPIFLASH, MICROPY_HW_ASSETS_SPIFLASH_ADDR, sizeof(magic), (const uint8_t*)&magic);
+    restore_irq_pri(basepri);
+    if (ret != 0) {
+        mp_raise_OSError(-ret);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_asset_load_fun_obj, pyb_asset_load);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(pyb_asset_load_obj, MP_ROM_PTR(&pyb_asset_load_fun_obj));
+#endif
+
+#if MICROPY_HW_ASSETS_UF2
+
+#if !defined(MICROPY_HW_ASSETS_SPIFLASH)
+#error "MICROPY_HW_ASSETS_UF2 needs the asset partition in SPI flash"
+#endif
+
+// pyb.Asset as a USB MSC logical unit.  The host sees a small FAT16 drive
+// holding only INFO_UF2.TXT, and copying a UF2 file made with
+//     uf2conv.py -c -f MPY_ASSETS -o assets.uf2 assets.img
+// onto it programs the asset partition as one sequential write: each sector
+// the host writes that is a UF2 block of the asset family has its payload
+// written at that offset in the partition, and everything else (the FAT and
+// directory updates) is dropped.  As for load(), the magic is written last,
+// once every block of the file has arrived.
+
+#define UF2_MAGIC_START0 (0x0a324655) // "UF2\n"
+#define UF2_MAGIC_START1 (0x9e5d5157)
+#define UF2_MAGIC_END (0x0ab16f30)
+#define UF2_FLAG_NOT_MAIN_FLASH (0x00000001)
+#define UF2_FLAG_FAMILY_ID (0x00002000)
+#define UF2_FAMILY_MPY_ASSETS (0x3e6a1b5d) // must match MPY_ASSETS in tools/uf2conv.py
+
+// uf2conv.py puts 256 bytes in each block
+#define UF2_MAX_BLOCKS (MICROPY_HW_ASSETS_SIZE / 256)
+#define UF2_ERASE_BLOCKS (MICROPY_HW_ASSETS_SIZE / MP_SPIFLASH_ERASE_BLOCK_SIZE)
+
+// Layout of the emulated drive, with one sector per cluster
+#define UF2_NUM_SECTORS (8000)
+#define UF2_SECTORS_PER_FAT (32)
+#define UF2_ROOT_ENTRIES (64)
+#define UF2_START_FAT0 (1)
+#define UF2_START_FAT1 (UF2_START_FAT0 + UF2_SECTORS_PER_FAT)
+#define UF2_START_ROOT (UF2_START_FAT1 + UF2_SECTORS_PER_FAT)
+#define UF2_START_DATA (UF2_START_ROOT + UF2_ROOT_ENTRIES * 32 / 512)
+
+#if 2 * MICROPY_HW_ASSETS_SIZE > (UF2_NUM_SECTORS - UF2_START_DATA - 1) * 512
+#error "asset partition too big for the UF2 drive"
+#endif
+
+typedef struct _uf2_block_t {
+    uint32_t magic_start0;
+    uint32_t magic_start1;
+    uint32_t flags;
+    uint32_t target_addr;
+    uint32_t payload_size;
+    uint32_t block_no;
+    uint32_t num_blocks;
+    uint32_t family_id;
+    uint8_t data[476];
+    uint32_t magic_end;
+} uf2_block_t;
+
+STATIC const uint8_t asset_uf2_boot_sector[62] = {
+    0xeb, 0x3c, 0x90, // jump instruction
+    'U', 'F', '2', ' ', 'U', 'F', '2', ' ', // OEM name
+    0x00, 0x02, // bytes per sector
+    1, // sectors per cluster
+    1, 0, // reserved sectors
+    2, // number of FATs
+    UF2_ROOT_ENTRIES, 0, // root directory entries
+    UF2_NUM_SECTORS & 0xff, UF2_NUM_SECTORS >> 8, // total sectors
+    0xf8, // media descriptor
+    UF2_SECTORS_PER_FAT, 0, // sectors per FAT
+    1, 0, 1, 0, // sectors per track, number of heads
+    0, 0, 0, 0, // hidden sectors
+    0, 0, 0, 0, // total sectors, 32 bit
+    0x80, 0, 0x29, // drive number, reserved, extended boot signature
+    0x5d, 0x1b, 0x6a, 0x3e, // serial number
+    'A', 'S', 'S', 'E', 'T', 'S', ' ', ' ', ' ', ' ', ' ', // volume label
+    'F', 'A', 'T', '1', '6', ' ', ' ', ' ', // file system type
+};
+
+STATIC const char asset_uf2_info[] =
+    "UF2 Bootloader MicroPython\r\n"
+    "Model: " MICROPY_HW_BOARD_NAME " asset partition\r\n"
+    "Board-ID: MPY-ASSETS\r\n";
+
+// Progress of the UF2 file being copied
+STATIC struct {
+    bool active;
+    uint32_t num_blocks;
+    uint32_t count;
+    uint32_t magic;
+    uint8_t erased[(UF2_ERASE_BLOCKS + 7) / 8];
+    uint8_t written[(UF2_MAX_BLOCKS + 7) / 8];
+} asset_uf2;
+
+uint32_t asset_uf2_block_count(void) {
+    return UF2_NUM_SECTORS;
+}
+
+STATIC void asset_uf2_dir_entry(uint8_t *e, const char *name, uint8_t attr, uint16_t cluster, uint32_t size) {
+    memcpy(e, name, 11);
+    e[11] = attr;
+    e[26] = cluster;
+    e[27] = cluster >> 8;
+    memcpy(e + 28, &size, sizeof(size));
+}
+
+void asset_uf2_read_blocks(uint8_t *dest, uint32_t block_num, uint32_t num_blocks) {
+    for (; num_blocks; --num_blocks, ++block_num, dest += 512) {
+        memset(dest, 0, 512);
+        if (block_num == 0) {
+            memcpy(dest, asset_uf2_boot_sector, sizeof(asset_uf2_boot_sector));
+            dest[510] = 0x55;
+            dest[511] = 0xaa;
+        } else if (block_num == UF2_START_FAT0 || block_num == UF2_START_FAT1) {
+            // the two reserved entries, then the one cluster of INFO_UF2.TXT
+            static const uint8_t fat[6] = {0xf8, 0xff, 0xff, 0xff, 0xff, 0xff};
+            memcpy(dest, fat, sizeof(fat));
+        } else if (block_num == UF2_START_ROOT) {
+            asset_uf2_dir_entry(dest, "ASSETS     ", 0x08, 0, 0);
+            asset_uf2_dir_entry(dest + 32, "INFO_UF2TXT", 0x01, 2, sizeof(asset_uf2_info) - 1);
+        } else if (block_num == UF2_START_DATA) {
+            memcpy(dest, asset_uf2_info, sizeof(asset_uf2_info) - 1);
+        }
+    }
+}
+
+STATIC int asset_uf2_write_block(const uf2_block_t *b) {
+    if (b->magic_start0 != UF2_MAGIC_START0 || b->magic_start1 != UF2_MAGIC_START1
+        || b->magic_end != UF2_MAGIC_END || (b->flags & UF2_FLAG_NOT_MAIN_FLASH)
+        || !(b->flags & UF2_FLAG_FAMILY_ID) || b->family_id != UF2_FAMILY_MPY_ASSETS) {
+        // not part of an asset UF2, eg a FAT or directory sector
+        return 0;
+    }
+    uint32_t addr = b->target_addr;
+    uint32_t len = b->payload_size;
+    if (len == 0 || len > sizeof(b->data) || addr > MICROPY_HW_ASSETS_SIZE || len > MICROPY_HW_ASSETS_SIZE - addr
+        || b->num_blocks > UF2_MAX_BLOCKS || b->block_no >= b->num_blocks) {
+        return -1;
+    }
+
+    // A different block count, or a block already written, means a new copy
+    if (!asset_uf2.active || b->num_blocks != asset_uf2.num_blocks
+        || (asset_uf2.written[b->block_no / 8] & (1 << (b->block_no % 8)))) {
+        memset(&asset_uf2, 0, sizeof(asset_uf2));
+        asset_uf2.active = true;
+        asset_uf2.num_blocks = b->num_blocks;
+    }
+
+    uint8_t buf[sizeof(b->data)];
+    memcpy(buf, b->data, len);
+    if (addr == 0 && len >= sizeof(uint32_t)) {
+        // leave the magic erased until the rest is written
+        memcpy(&asset_uf2.magic, buf, sizeof(uint32_t));
+        memset(buf, 0xff, sizeof(uint32_t));
+    }
+
+    uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH); // prevent cache flushing and USB access
+    int ret = 0;
+    if (!(asset_uf2.erased[0] & 1)) {
+        // erase the header first, so an old image is gone as soon as a copy starts
+        ret = mp_spiflash_erase_block(MICROPY_HW_ASSETS_SPIFLASH, MICROPY_HW_ASSETS_SPIFLASH_ADDR);
+        asset_uf2.erased[0] |= 1;
+    }
+    for (uint32_t e = addr / MP_SPIFLASH_ERASE_BLOCK_SIZE; ret == 0 && e <= (addr + len - 1) / MP_SPIFLASH_ERASE_BLOCK_SIZE; ++e) {
+        if (!(asset_uf2.erased[e / 8] & (1 << (e % 8)))) {
+            ret = mp_spiflash_erase_block(MICROPY_HW_ASSETS_SPIFLASH, MICROPY_HW_ASSETS_SPIFLASH_ADDR + e * MP_SPIFLASH_ERASE_BLOCK_SIZE);
+            asset_uf2.erased[e / 8] |= 1 << (e % 8);
+        }
+    }
+    if (ret == 0) {
+        ret = mp_spiflash_write(MICROPY_HW_ASSETS_SPIFLASH, MICROPY_HW_ASSETS_SPIFLASH_ADDR + addr, len, buf);
+    }
+    if (ret == 0) {
+        asset_uf2.written[b->block_no / 8] |= 1 << (b->block_no % 8);
+        if (++asset_uf2.count == asset_uf2.num_blocks) {
+            if (asset_uf2.magic == ASSET_MAGIC) {
+                ret = mp_spiflash_write(MICROPY_HW_ASSETS_SPIFLASH, MICROPY_HW_ASSETS_SPIFLASH_ADDR, sizeof(uint32_t), (const uint8_t*)&asset_uf2.magic);
+            }
+            asset_uf2.active = false;
+        }
+    }
+    restore_irq_pri(basepri);
+    return ret;
+}
+
+int asset_uf2_write_blocks(const uint8_t *src, uint32_t block_num, uint32_t num_blocks) {
+    for (; num_blocks; --num_blocks, src += 512) {
+        if (asset_uf2_write_block((const uf2_block_t*)src) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#endif // MICROPY_HW_ASSETS_UF2
+
+STATIC const mp_rom_map_elem_t pyb_asset_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_seek), MP_ROM_PTR(&mp_stream_seek_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tell), MP_ROM_PTR(&mp_stream_tell_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_names), MP_ROM_PTR(&pyb_asset_names_obj) },
+    #if defined(MICROPY_HW_ASSETS_SPIFLASH)
+    { MP_ROM_QSTR(MP_QSTR_load), MP_ROM_PTR(&pyb_asset_load_obj) },
+    #endif
+};
+
+STATIC MP_DEFINE_CONST_DICT(pyb_asset_locals_dict, pyb_asset_locals_dict_table);
+
+STATIC const mp_stream_p_t pyb_asset_stream_p = {
+    .read = pyb_asset_stream_read,
+    .ioctl = pyb_asset_stream_ioctl,
+};
+
+const mp_obj_type_t pyb_asset_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Asset,
+    .print = pyb_asset_print,
+    .make_new = pyb_asset_make_new,
+    .unary_op = pyb_asset_unary_op,
+    .subscr = pyb_asset_subscr,
+    #if !defined(MICROPY_HW_ASSETS_SPIFLASH)
+    .buffer_p = { .get_buffer = pyb_asset_get_buffer },
+    #endif
+    .protocol = &pyb_asset_stream_p,
+    .locals_dict = (mp_obj_dict_t*)&pyb_asset_locals_dict,
+};
+
+#endif // MICROPY_HW_ENABLE_ASSETS
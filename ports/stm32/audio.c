@@ -0,0 +1,708 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "irq.h"
+#include "pin.h"
+#include "timer.h"
+#include "dma.h"
+#include "audio.h"
+#include "extmod/machine_audio.h"
+
+#if MICROPY_HW_ENABLE_AUDIO
+
+/// \moduleref pyb
+/// \class Audio - sample playback on the PA2 (TIM5 CH3) PWM output
+///
+/// Samples are unsigned 8-bit values, one per byte of a buffer, and set the
+/// PWM duty cycle.  TIM5 runs at the sample rate and each update event makes
+/// the DMA copy the next duty cycle into TIM5->CCR3, so playback doesn't
+/// involve Python and keeps going while the script does other things.
+///
+///     audio = pyb.Audio(8000)
+///     audio.play(open('/sd/boom.raw', 'rb').read())
+///
+/// Tones, noise and samples can be played on the voices of a mixer at the
+/// same time, from the same interrupt that feeds the DMA:
+///
+///     audio.voice(0, pyb.Audio.SQUARE, freq=440, volume=64)
+///     audio.voice(1, pyb.Audio.SAMPLE, freq=8000, sample=drum)
+///
+/// TIM5 is also used by pyb.Servo and pyb.pwm, which can't be used while
+/// audio is playing.
+
+// The DMA streams circularly out of a ring of CCR3 values.  Each half of
+// the ring is refilled from the queued buffers by the half/full transfer
+// interrupt while the other half plays.
+#define AUDIO_HALF_LEN (128)
+
+// Voice() calls are passed to the interrupt through a ring of commands, so
+// a voice is never seen half changed.  Python only moves the head and the
+// interrupt only moves the tail.
+#define AUDIO_CMD_LEN (16)
+
+// sample positions are fixed point with this many fraction bits
+#define AUDIO_SAMPLE_FRAC (12)
+
+enum {
+    AUDIO_WAVE_OFF,
+    AUDIO_WAVE_SQUARE,
+    AUDIO_WAVE_TRIANGLE,
+    AUDIO_WAVE_SAW,
+    AUDIO_WAVE_NOISE,
+    AUDIO_WAVE_SAMPLE,
+};
+
+// which fields of an audio_cmd_t are set
+#define AUDIO_CMD_WAVE (0x01)
+#define AUDIO_CMD_STEP (0x02)
+#define AUDIO_CMD_VOLUME (0x04)
+#define AUDIO_CMD_DUTY (0x08)
+#define AUDIO_CMD_SAMPLE (0x10)
+#define AUDIO_CMD_LOOP (0x20)
+
+typedef struct _audio_voice_t {
+    uint8_t wave;
+    uint8_t volume;
+    uint8_t duty; // square wave high time, out of 256
+    bool loop;
+    uint16_t lfsr; // noise generator
+    // phase of the waveform out of 2^32, or the position in the sample
+    uint32_t phase;
+    uint32_t step;
+    const uint8_t *buf;
+    uint32_t len;
+} audio_voice_t;
+
+typedef struct _audio_cmd_t {
+    uint8_t voice;
+    uint8_t flags;
+    uint8_t wave;
+    uint8_t volume;
+    uint8_t duty;
+    bool loop;
+    uint32_t step;
+    const uint8_t *buf;
+    uint32_t len;
+} audio_cmd_t;
+
+typedef struct _pyb_audio_obj_t {
+    mp_obj_base_t base;
+    uint32_t period; // timer counts per sample
+    volatile bool playing;
+    bool loop;
+    uint8_t idle; // consecutive halves of the ring filled with silence
+    // the buffer being played and the one queued after it; the objects
+    // are held so the GC doesn't reclaim them while the DMA reads them
+    mp_obj_t cur_obj;
+    const uint8_t *cur_buf;
+    size_t cur_len;
+    size_t cur_pos;
+    mp_obj_t next_obj;
+    const uint8_t *next_buf;
+    size_t next_len;
+    volatile uint8_t cmd_head;
+    volatile uint8_t cmd_tail;
+    audio_cmd_t cmd[AUDIO_CMD_LEN];
+    audio_voice_t voice[MICROPY_HW_AUDIO_VOICES];
+    // samples referenced by queued commands and by the voices
+    mp_obj_t cmd_obj[AUDIO_CMD_LEN];
+    mp_obj_t voice_obj[MICROPY_HW_AUDIO_VOICES];
+    // the wave each voice was last given, for converting freq
+    uint8_t voice_wave[MICROPY_HW_AUDIO_VOICES];
+} pyb_audio_obj_t;
+
+STATIC uint32_t audio_ring[2 * AUDIO_HALF_LEN];
+STATIC DMA_HandleTypeDef audio_dma;
+
+STATIC void audio_apply_cmds(pyb_audio_obj_t *self) {
+    uint8_t tail = self->cmd_tail;
+    while (tail != self->cmd_head) {
+        audio_cmd_t *cmd = &self->cmd[tail];
+        audio_voice_t *v = &self->voice[cmd->voice];
+        if (cmd->flags & AUDIO_CMD_SAMPLE) {
+            v->buf = cmd->buf;
+            v->len = cmd->len;
+            v->phase = 0;
+            self->voice_obj[cmd->voice] = self->cmd_obj[tail];
+            self->cmd_obj[tail] = MP_OBJ_NULL;
+        }
+        if (cmd->flags & AUDIO_CMD_WAVE) {
+            v->wave = cmd->wave;
+        }
+        if (cmd->flags & AUDIO_CMD_STEP) {
+            v->step = cmd->step;
+        }
+        if (cmd->flags & AUDIO_CMD_VOLUME) {
+            v->volume = cmd->volume;
+        }
+        if (cmd->flags & AUDIO_CMD_DUTY) {
+            v->duty = cmd->duty;
+        }
+        if (cmd->flags & AUDIO_CMD_LOOP) {
+            v->loop = cmd->loop;
+        }
+        tail = (tail + 1) % AUDIO_CMD_LEN;
+    }
+    self->cmd_tail = tail;
+}
+
+// Add a half of the ring's worth of one voice to the mix.  Returns false if
+// the voice is off.
+STATIC bool audio_mix_voice(audio_voice_t *v, int16_t *mix) {
+    uint32_t phase = v->phase;
+    uint32_t step = v->step;
+    int vol = v->volume;
+    switch (v->wave) {
+        case AUDIO_WAVE_SQUARE: {
+            uint32_t duty = v->duty;
+            for (size_t i = 0; i < AUDIO_HALF_LEN; ++i) {
+                mix[i] += ((phase >> 24) < duty ? 127 : -128) * vol >> 8;
+                phase += step;
+            }
+            break;
+        }
+        case AUDIO_WAVE_TRIANGLE:
+            for (size_t i = 0; i < AUDIO_HALF_LEN; ++i) {
+                int t = phase >> 23;
+                mix[i] += (t < 256 ? t - 128 : 383 - t) * vol >> 8;
+                phase += step;
+            }
+            break;
+        case AUDIO_WAVE_SAW:
+            for (size_t i = 0; i < AUDIO_HALF_LEN; ++i) {
+                mix[i] += ((int)(phase >> 24) - 128) * vol >> 8;
+                phase += step;
+            }
+            break;
+        case AUDIO_WAVE_NOISE: {
+            // the generator is clocked each time the phase wraps
+            uint32_t lfsr = v->lfsr;
+            for (size_t i = 0; i < AUDIO_HALF_LEN; ++i) {
+                uint32_t next = phase + step;
+                if (next < phase) {
+                    lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xb400);
+                }
+                phase = next;
+                mix[i] += (lfsr & 1 ? 127 : -128) * vol >> 8;
+            }
+            v->lfsr = lfsr;
+            break;
+        }
+        case AUDIO_WAVE_SAMPLE: {
+            const uint8_t *buf = v->buf;
+            uint32_t end = v->len << AUDIO_SAMPLE_FRAC;
+            if (end == 0) {
+                v->wave = AUDIO_WAVE_OFF;
+                return false;
+            }
+            for (size_t i = 0; i < AUDIO_HALF_LEN; ++i) {
+                if (phase >= end) {
+                    if (!v->loop) {
+                        v->wave = AUDIO_WAVE_OFF;
+                        break;
+                    }
+                    phase %= end;
+                }
+                mix[i] += ((int)buf[phase >> AUDIO_SAMPLE_FRAC] - 128) * vol >> 8;
+                phase += step;
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+    v->phase = phase;
+    return true;
+}
+
+// Fill one half of the ring from the queued buffers and the voices.
+STATIC void audio_fill(pyb_audio_obj_t *self, uint32_t *dest) {
+    int16_t mix[AUDIO_HALF_LEN];
+    audio_apply_cmds(self);
+
+    int16_t *m = mix;
+    size_t n = AUDIO_HALF_LEN;
+    while (n > 0) {
+        if (self->cur_pos >= self->cur_len) {
+            if (self->next_buf != NULL) {
+                self->cur_obj = self->next_obj;
+                self->cur_buf = self->next_buf;
+                self->cur_len = self->next_len;
+                self->next_obj = MP_OBJ_NULL;
+                self->next_buf = NULL;
+            } else if (!self->loop || self->cur_len == 0) {
+                break;
+            }
+            self->cur_pos = 0;
+        }
+        size_t len = MIN(n, self->cur_len - self->cur_pos);
+        const uint8_t *src = self->cur_buf + self->cur_pos;
+        self->cur_pos += len;
+        n -= len;
+        while (len--) {
+            *m++ = *src++ - 128;
+        }
+    }
+    bool active = n < AUDIO_HALF_LEN;
+    for (; n > 0; --n) {
+        *m++ = 0;
+    }
+
+    for (size_t i = 0; i < MICROPY_HW_AUDIO_VOICES; ++i) {
+        active |= audio_mix_voice(&self->voice[i], mix);
+    }
+    if (active) {
+        self->idle = 0;
+    } else {
+        self->idle += 1;
+    }
+
+    // silence is mid scale, so the speaker doesn't click
+    uint32_t period = self->period;
+    for (size_t i = 0; i < AUDIO_HALF_LEN; ++i) {
+        int v = mix[i];
+        if (v < -128) {
+            v = -128;
+        } else if (v > 127) {
+            v = 127;
+        }
+        dest[i] = (uint32_t)(v + 128) * period >> 8;
+    }
+}
+
+// Can be called from the DMA IRQ.
+STATIC void audio_stop(pyb_audio_obj_t *self) {
+    if (self->playing) {
+        TIM5->DIER &= ~TIM_DIER_UDE;
+        HAL_DMA_Abort(&audio_dma);
+        dma_deinit(&dma_TIM_5_UP);
+        TIM5->CCR3 = 0;
+    }
+    for (size_t i = 0; i < MICROPY_HW_AUDIO_VOICES; ++i) {
+        self->voice[i].wave = AUDIO_WAVE_OFF;
+        self->voice_obj[i] = MP_OBJ_NULL;
+        self->voice_wave[i] = AUDIO_WAVE_OFF;
+    }
+    for (size_t i = 0; i < AUDIO_CMD_LEN; ++i) {
+        self->cmd_obj[i] = MP_OBJ_NULL;
+    }
+    self->cmd_tail = self->cmd_head;
+    self->cur_obj = MP_OBJ_NULL;
+    self->cur_buf = NULL;
+    self->cur_len = 0;
+    self->cur_pos = 0;
+    self->next_obj = MP_OBJ_NULL;
+    self->next_buf = NULL;
+    self->playing = false;
+}
+
+STATIC void audio_refill(DMA_HandleTypeDef *hdma, uint32_t *half) {
+    pyb_audio_obj_t *self = hdma->Parent;
+    audio_fill(self, half);
+    if (self->idle >= 2 && self->cmd_tail == self->cmd_head) {
+        // the last samples have played out of the other half, and no
+        // voice() has come in since this half was filled
+        audio_stop(self);
+    }
+}
+
+STATIC void audio_dma_half_callback(DMA_HandleTypeDef *hdma) {
+    audio_refill(hdma, &audio_ring[0]);
+}
+
+STATIC void audio_dma_callback(DMA_HandleTypeDef *hdma) {
+    audio_refill(hdma, &audio_ring[AUDIO_HALF_LEN]);
+}
+
+STATIC void audio_start(pyb_audio_obj_t *self) {
+    // prime the whole ring before the first update request
+    self->idle = 0;
+    audio_fill(self, &audio_ring[0]);
+    audio_fill(self, &audio_ring[AUDIO_HALF_LEN]);
+
+    dma_init(&audio_dma, &dma_TIM_5_UP, DMA_MEMORY_TO_PERIPH, self);
+    // dma_init clears the handle, so the callbacks are set after it
+    audio_dma.XferHalfCpltCallback = audio_dma_half_callback;
+    audio_dma.XferCpltCallback = audio_dma_callback;
+    self->playing = true;
+    HAL_DMA_Start_IT(&audio_dma, (uint32_t)audio_ring, (uint32_t)&TIM5->CCR3, MP_ARRAY_SIZE(audio_ring));
+    TIM5->DIER |= TIM_DIER_UDE;
+}
+
+STATIC void audio_init_timer(pyb_audio_obj_t *self, mp_int_t freq) {
+    // at least 8 bits of duty cycle, and no more than 16, so a sample times
+    // the period can't overflow
+    uint32_t source_freq = timer_get_source_freq(5);
+    if (freq <= 0 || source_freq / freq < 256 || source_freq / freq > 65536) {
+        mp_raise_ValueError("freq out of range");
+    }
+    self->period = source_freq / freq;
+
+    mp_hal_pin_config(pin_A2, MP_HAL_PIN_MODE_ALT, MP_HAL_PIN_PULL_NONE, GPIO_AF2_TIM5);
+    if (__HAL_RCC_TIM5_IS_CLK_DISABLED()) {
+        timer_tim5_init();
+    }
+
+    TIM_OC_InitTypeDef oc_init;
+    oc_init.OCMode = TIM_OCMODE_PWM1;
+    oc_init.Pulse = 0;
+    oc_init.OCPolarity = TIM_OCPOLARITY_HIGH;
+    oc_init.OCFastMode = TIM_OCFAST_DISABLE;
+    HAL_TIM_PWM_ConfigChannel(&TIM5_Handle, &oc_init, TIM_CHANNEL_3);
+    HAL_TIM_PWM_Start(&TIM5_Handle, TIM_CHANNEL_3);
+
+    // TIM5 counts at the source clock and overflows once per sample
+    TIM5->PSC = 0;
+    TIM5->ARR = self->period - 1;
+    TIM5->EGR = TIM_EGR_UG;
+}
+
+STATIC void audio_deinit_obj(pyb_audio_obj_t *self) {
+    uint32_t irq_state = disable_irq();
+    audio_stop(self);
+    enable_irq(irq_state);
+    HAL_TIM_PWM_Stop(&TIM5_Handle, TIM_CHANNEL_3);
+    // put back the 100kHz/50Hz timebase the servos use
+    HAL_TIM_PWM_Init(&TIM5_Handle);
+    self->period = 0;
+}
+
+STATIC void audio_check_init(pyb_audio_obj_t *self) {
+    if (self->period == 0) {
+        mp_raise_msg(&mp_type_OSError, "Audio not initialised");
+    }
+}
+
+void audio_deinit(void) {
+    if (MP_STATE_PORT(pyb_audio_obj) != NULL) {
+        audio_deinit_obj(MP_STATE_PORT(pyb_audio_obj));
+        MP_STATE_PORT(pyb_audio_obj) = NULL;
+    }
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC void pyb_audio_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    pyb_audio_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->period == 0) {
+        mp_print_str(print, "Audio()");
+    } else {
+        mp_printf(print, "Audio(freq=%u)", timer_get_source_freq(5) / self->period);
+    }
+}
+
+/// \classmethod \constructor(freq=8000)
+/// There is one audio output; this initialises it at the given sample rate
+/// and returns it.
+STATIC mp_obj_t pyb_audio_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+    pyb_audio_obj_t *self = MP_STATE_PORT(pyb_audio_obj);
+    if (self == NULL) {
+        self = m_new0(pyb_audio_obj_t, 1);
+        self->base.type = &pyb_audio_type;
+        for (size_t i = 0; i < MICROPY_HW_AUDIO_VOICES; ++i) {
+            self->voice[i].volume = 128;
+            self->voice[i].duty = 128;
+            self->voice[i].lfsr = 1;
+        }
+        MP_STATE_PORT(pyb_audio_obj) = self;
+    } else {
+        uint32_t irq_state = disable_irq();
+        audio_stop(self);
+        enable_irq(irq_state);
+    }
+    audio_init_timer(self, n_args > 0 ? mp_obj_get_int(args[0]) : 8000);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+/// \method init(freq)
+/// Stop playing and set the sample rate.
+STATIC mp_obj_t pyb_audio_init(mp_obj_t self_in, mp_obj_t freq_in) {
+    pyb_audio_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t irq_state = disable_irq();
+    audio_stop(self);
+    enable_irq(irq_state);
+    audio_init_timer(self, mp_obj_get_int(freq_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_audio_init_obj, pyb_audio_init);
+
+/// \method deinit()
+/// Stop playing and give TIM5 back to the servos.
+STATIC mp_obj_t pyb_audio_deinit(mp_obj_t self_in) {
+    audio_deinit_obj(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_audio_deinit_obj, pyb_audio_deinit);
+
+/// \method play(buf, *, loop=False)
+/// Drop the buffers being played and play `buf` now; the voices carry on.
+/// With `loop=True` the last buffer repeats until another is written.
+STATIC mp_obj_t pyb_audio_play(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_loop, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    pyb_audio_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    audio_check_init(self);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_READ);
+
+    uint32_t irq_state = disable_irq();
+    self->loop = args[1].u_bool;
+    self->cur_obj = args[0].u_obj;
+    self->cur_buf = bufinfo.buf;
+    self->cur_len = bufinfo.len;
+    self->cur_pos = 0;
+    self->next_obj = MP_OBJ_NULL;
+    self->next_buf = NULL;
+    bool start = !self->playing;
+    enable_irq(irq_state);
+
+    if (start && bufinfo.len > 0) {
+        audio_start(self);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_audio_play_obj, 1, pyb_audio_play);
+
+// The audio protocol, through which write() queues buffers.
+
+STATIC mp_uint_t audio_p_freq(void *self_in) {
+    pyb_audio_obj_t *self = self_in;
+    return self->period == 0 ? 0 : timer_get_source_freq(5) / self->period;
+}
+
+STATIC bool audio_p_queue(void *self_in, mp_obj_t buf_in, const mp_buffer_info_t *bufinfo) {
+    pyb_audio_obj_t *self = self_in;
+    uint32_t irq_state = disable_irq();
+    if (!self->playing) {
+        // the DMA IRQ is off, so self can be changed without it
+        enable_irq(irq_state);
+        self->cur_obj = buf_in;
+        self->cur_buf = bufinfo->buf;
+        self->cur_len = bufinfo->len;
+        self->cur_pos = 0;
+        audio_start(self);
+        return true;
+    }
+    bool queued = self->next_buf == NULL;
+    if (queued) {
+        self->next_obj = buf_in;
+        self->next_buf = bufinfo->buf;
+        self->next_len = bufinfo->len;
+    }
+    enable_irq(irq_state);
+    return queued;
+}
+
+STATIC bool audio_p_busy(void *self_in) {
+    pyb_audio_obj_t *self = self_in;
+    return self->playing;
+}
+
+STATIC void audio_p_stop(void *self_in) {
+    uint32_t irq_state = disable_irq();
+    audio_stop(self_in);
+    enable_irq(irq_state);
+}
+
+STATIC const mp_machine_audio_p_t audio_p = {
+    .freq = audio_p_freq,
+    .queue = audio_p_queue,
+    .busy = audio_p_busy,
+    .stop = audio_p_stop,
+};
+
+/// \method write(buf)
+/// Queue `buf` to play after the current buffer, starting playback if it
+/// has stopped.  One buffer can wait in the queue; if one already is then
+/// this blocks until it starts playing, by which time the buffer written
+/// before it has finished, so a stream can be played from three buffers.
+STATIC mp_obj_t pyb_audio_write(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_machine_audio_write(&audio_p, MP_OBJ_TO_PTR(self_in), buf_in);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_audio_write_obj, pyb_audio_write);
+
+/// \method voice(n, wave=None, *, freq=None, volume=None, duty=None, sample=None, loop=None)
+/// Change voice `n` of the mixer, starting playback if it has stopped.
+/// Only the arguments given are changed, and they all take effect together
+/// at the start of the next half of the ring.  `freq` is the frequency of
+/// the wave in Hz, or for a SAMPLE voice the rate its sample is played at.
+/// Giving a `sample` (unsigned 8-bit, like the buffers) restarts it.
+STATIC mp_obj_t pyb_audio_voice(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_n, ARG_wave, ARG_freq, ARG_volume, ARG_duty, ARG_sample, ARG_loop };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_n, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_wave, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_freq, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_volume, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_duty, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_sample, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_loop, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    pyb_audio_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    audio_check_init(self);
+
+    mp_int_t n = args[ARG_n].u_int;
+    if (n < 0 || n >= MICROPY_HW_AUDIO_VOICES) {
+        mp_raise_ValueError("voice out of range");
+    }
+
+    audio_cmd_t cmd = { .voice = n };
+    mp_obj_t sample_obj = MP_OBJ_NULL;
+    if (args[ARG_wave].u_obj != mp_const_none) {
+        mp_int_t wave = mp_obj_get_int(args[ARG_wave].u_obj);
+        if (wave < AUDIO_WAVE_OFF || wave > AUDIO_WAVE_SAMPLE) {
+            mp_raise_ValueError("bad wave");
+        }
+        cmd.flags |= AUDIO_CMD_WAVE;
+        cmd.wave = wave;
+    }
+    if (args[ARG_volume].u_obj != mp_const_none) {
+        mp_int_t volume = mp_obj_get_int(args[ARG_volume].u_obj);
+        cmd.flags |= AUDIO_CMD_VOLUME;
+        cmd.volume = MIN(MAX(volume, 0), 255);
+    }
+    if (args[ARG_duty].u_obj != mp_const_none) {
+        mp_int_t duty = mp_obj_get_int(args[ARG_duty].u_obj);
+        cmd.flags |= AUDIO_CMD_DUTY;
+        cmd.duty = MIN(MAX(duty, 0), 255);
+    }
+    if (args[ARG_sample].u_obj != mp_const_none) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[ARG_sample].u_obj, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len >= (1 << (32 - AUDIO_SAMPLE_FRAC))) {
+            mp_raise_ValueError("sample too long");
+        }
+        sample_obj = args[ARG_sample].u_obj;
+        cmd.flags |= AUDIO_CMD_SAMPLE;
+        cmd.buf = bufinfo.buf;
+        cmd.len = bufinfo.len;
+        if (!(cmd.flags & AUDIO_CMD_WAVE)) {
+            cmd.flags |= AUDIO_CMD_WAVE;
+            cmd.wave = AUDIO_WAVE_SAMPLE;
+        }
+    }
+    if (args[ARG_freq].u_obj != mp_const_none) {
+        // the step is per sample of output: a whole cycle is 2^32, and a
+        // sample's position is fixed point
+        uint8_t wave = (cmd.flags & AUDIO_CMD_WAVE) ? cmd.wave : self->voice_wave[n];
+        uint32_t rate = timer_get_source_freq(5) / self->period;
+        uint64_t one = wave == AUDIO_WAVE_SAMPLE ? 1 << AUDIO_SAMPLE_FRAC : 0x100000000ULL;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        mp_float_t step = mp_obj_get_float(args[ARG_freq].u_obj) * (mp_float_t)one / rate;
+        #else
+        uint64_t step = mp_obj_get_int(args[ARG_freq].u_obj) * one / rate;
+        #endif
+        // a wave above half the rate would alias
+        uint32_t limit = wave == AUDIO_WAVE_SAMPLE ? 0xffffffff : 0x80000000;
+        if (!(step >= 0 && step < limit)) {
+            mp_raise_ValueError("freq out of range");
+        }
+        cmd.flags |= AUDIO_CMD_STEP;
+        cmd.step = step;
+    }
+    if (args[ARG_loop].u_obj != mp_const_none) {
+        cmd.flags |= AUDIO_CMD_LOOP;
+        cmd.loop = mp_obj_is_true(args[ARG_loop].u_obj);
+    }
+
+    if (cmd.flags & AUDIO_CMD_WAVE) {
+        self->voice_wave[n] = cmd.wave;
+    }
+
+    // wait for room in the ring, then publish the command by moving the head
+    uint8_t head = self->cmd_head;
+    uint8_t next = (head + 1) % AUDIO_CMD_LEN;
+    while (next == self->cmd_tail) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    self->cmd[head] = cmd;
+    self->cmd_obj[head] = sample_obj;
+    __DMB();
+    self->cmd_head = next;
+
+    // the interrupt doesn't stop playback while a command is waiting
+    if (!self->playing) {
+        audio_start(self);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_audio_voice_obj, 2, pyb_audio_voice);
+
+/// \method stop()
+/// Stop playing, drop anything queued and turn the voices off.
+STATIC mp_obj_t pyb_audio_stop(mp_obj_t self_in) {
+    audio_p.stop(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_audio_stop_obj, pyb_audio_stop);
+
+/// \method busy()
+/// Return True while samples are playing.
+STATIC mp_obj_t pyb_audio_busy(mp_obj_t self_in) {
+    return mp_obj_new_bool(audio_p.busy(MP_OBJ_TO_PTR(self_in)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_audio_busy_obj, pyb_audio_busy);
+
+STATIC const mp_rom_map_elem_t pyb_audio_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&pyb_audio_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&pyb_audio_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_play), MP_ROM_PTR(&pyb_audio_play_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&pyb_audio_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&pyb_audio_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&pyb_audio_busy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_voice), MP_ROM_PTR(&pyb_audio_voice_obj) },
+
+    // waves for voice()
+    { MP_ROM_QSTR(MP_QSTR_OFF), MP_ROM_INT(AUDIO_WAVE_OFF) },
+    { MP_ROM_QSTR(MP_QSTR_SQUARE), MP_ROM_INT(AUDIO_WAVE_SQUARE) },
+    { MP_ROM_QSTR(MP_QSTR_TRIANGLE), MP_ROM_INT(AUDIO_WAVE_TRIANGLE) },
+    { MP_ROM_QSTR(MP_QSTR_SAW), MP_ROM_INT(AUDIO_WAVE_SAW) },
+    { MP_ROM_QSTR(MP_QSTR_NOISE), MP_ROM_INT(AUDIO_WAVE_NOISE) },
+    { MP_ROM_QSTR(MP_QSTR_SAMPLE), MP_ROM_INT(AUDIO_WAVE_SAMPLE) },
+};
+STATIC MP_DEFINE_CONST_DICT(pyb_audio_locals_dict, pyb_audio_locals_dict_table);
+
+const mp_obj_type_t pyb_audio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Audio,
+    .print = pyb_audio_print,
+    .make_new = pyb_audio_make_new,
+    .locals_dict = (mp_obj_dict_t*)&pyb_audio_locals_dict,
+};
+
+#endif // MICROPY_HW_ENABLE_AUDIO
@@ -8,7 +8,54 @@
 #define MICROPY_HW_ENABLE_USB       (1)
 #define MICROPY_HW_HAS_SDCARD       (1)
 #define MICROPY_HW_ENABLE_SERVO     (1)
+#define MICROPY_HW_ENABLE_AUDIO     (1)
+#define MICROPY_HW_ENABLE_ADC_CAPTURE (1)
+#define MICROPY_HW_UART_DMA         (1)
+#define MICROPY_HW_ENABLE_JACDAC    (1)
+#define MICROPY_HW_ENABLE_TICKLESS_IDLE (1)
+#define MICROPY_HW_ENABLE_FREQ_POLICY (1)
+#define MICROPY_HW_FAST_BOOT        (1)
+#define MICROPY_HW_ENABLE_HIBERNATE (1)
+#define MICROPY_HW_I2C_DMA          (1)
 #define MICROPY_HW_ENABLE_SDCARD    (1)
+#define MICROPY_HW_SDCARD_READAHEAD_BLOCKS (8)
+
+// keep floats out of the heap, so float maths in games doesn't make garbage
+#define MICROPY_OBJ_REPR            (MICROPY_OBJ_REPR_C)
+
+// sample the line running from systick, for micropython.profile()
+#define MICROPY_SAMPLING_PROFILE    (1)
+
+// keep GC pause and allocation totals, for gc.stats()
+#define MICROPY_GC_STATS            (1)
+
+// count the cycles taken by gc_collect and spi_transfer, for machine.info()
+#define MICROPY_HW_CYCLE_STATS      (1)
+
+// measure IRQ, PendSV and scheduler latency, with pyb.Timer.latency()
+#define MICROPY_HW_IRQ_LATENCY      (1)
+
+// paint the stacks, for micropython.stack_use_max() and pystack_use_max()
+#define MICROPY_STACK_HIGH_WATER    (1)
+
+// draw frame timing stats on the screen, with SCREEN.overlay()
+#define MICROPY_HW_SCREEN_OVERLAY   (1)
+
+// compile imported games one top-level statement at a time, to fit in 64k
+#define MICROPY_PARSE_STREAM        (1)
+
+// read source and .mpy files a whole FAT sector at a time
+#define MICROPY_READER_BUF_SIZE     (512)
+
+// remember import lookups, so games with several modules import faster
+#define MICROPY_VFS_STAT_CACHE_SIZE (16)
+
+// unrolled SHA256 rounds, for checking downloaded games and assets faster
+#define MICROPY_PY_UHASHLIB_SHA256_UNROLL (1)
+
+// AES for encrypted save games, using the built-in core since there's no SSL
+#define MICROPY_PY_UCRYPTOLIB       (1)
+#define MICROPY_PY_UCRYPTOLIB_CTR   (1)
 
 #define MICROPY_HW_ENABLE_INTERNAL_FLASH_STORAGE (0)
 
@@ -17,18 +64,39 @@
 #define MICROPY_HW_SPIFLASH_SCK     (pin_B13)
 #define MICROPY_HW_SPIFLASH_MOSI    (pin_B15)
 #define MICROPY_HW_SPIFLASH_MISO    (pin_B14)
+// cache the FAT, directory and data blocks a small file write goes between
+#define MP_SPIFLASH_CACHE_SLOTS     (3)
+
+// give each open file its own sector buffer, so streaming from two files
+// at once doesn't reload the shared window on every switch
+#define MICROPY_FATFS_TINY          (0)
+
+// reserve this many bytes at the top of the flash for an asset image read
+// by pyb.Asset; changing it means the filesystem has to be recreated
+#define MICROPY_HW_ASSETS_SIZE      (0)
+#if MICROPY_HW_ASSETS_SIZE
+#define MICROPY_HW_ENABLE_ASSETS    (1)
+#define MICROPY_HW_ASSETS_SPIFLASH  (&spi_bdev.spiflash)
+#define MICROPY_HW_ASSETS_SPIFLASH_ADDR (MICROPY_HW_SPIFLASH_SIZE_BITS / 8 - MICROPY_HW_ASSETS_SIZE)
+#define MICROPY_HW_ASSETS_UF2       (1)
+#endif
 
 // block device config for SPI flash
 extern const struct _mp_spiflash_config_t spiflash_config;
 extern struct _spi_bdev_t spi_bdev;
 #define MICROPY_HW_BDEV_IOCTL(op, arg) ( \
-    (op) == BDEV_IOCTL_NUM_BLOCKS ? (MICROPY_HW_SPIFLASH_SIZE_BITS / 8 / FLASH_BLOCK_SIZE) : \
+    (op) == BDEV_IOCTL_NUM_BLOCKS ? ((MICROPY_HW_SPIFLASH_SIZE_BITS / 8 - MICROPY_HW_ASSETS_SIZE) / FLASH_BLOCK_SIZE) : \
     (op) == BDEV_IOCTL_INIT ? spi_bdev_ioctl(&spi_bdev, (op), (uint32_t)&spiflash_config) : \
     spi_bdev_ioctl(&spi_bdev, (op), (arg)) \
 )
 #define MICROPY_HW_BDEV_READBLOCKS(dest, bl, n) spi_bdev_readblocks(&spi_bdev, (dest), (bl), (n))
 #define MICROPY_HW_BDEV_WRITEBLOCKS(src, bl, n) spi_bdev_writeblocks(&spi_bdev, (src), (bl), (n))
 
+// To spread writes over the whole flash instead, define the bdev with
+// FTL_BDEV_DEFINE(ftl_bdev, MICROPY_HW_SPIFLASH_SIZE_BITS / 8) in bdev.c and use
+// the ftl_bdev_* functions above, passing BDEV_IOCTL_NUM_BLOCKS through.  The
+// on-flash format differs, so the filesystem is recreated on first boot.
+
 // HSE is 8MHz, CPU freq set to 84MHz
 // #define MICROPY_HW_CLK_PLLM (8)
 // 12M /12 * 336 / 4 = 84Mhz
@@ -85,6 +153,18 @@ extern struct _spi_bdev_t spi_bdev;
 #define MICROPY_HW_USRSW_EXTI_MODE  (GPIO_MODE_IT_FALLING)
 #define MICROPY_HW_USRSW_PRESSED    (0)
 
+// Buttons, scanned by pyb.Keys; all pulled up and pressed low
+#define MICROPY_HW_ENABLE_KEYS      (1)
+#define MICROPY_HW_KEY_PINS         { pin_A6, pin_A5, pin_A7, pin_B2, pin_B9, pin_C3 }
+#define MICROPY_HW_KEY_DPAD         { 0, 1, 2, 3 }
+#define MICROPY_HW_KEY_NAMES \
+    { MP_ROM_QSTR(MP_QSTR_UP), MP_ROM_INT(0) }, \
+    { MP_ROM_QSTR(MP_QSTR_DOWN), MP_ROM_INT(1) }, \
+    { MP_ROM_QSTR(MP_QSTR_LEFT), MP_ROM_INT(2) }, \
+    { MP_ROM_QSTR(MP_QSTR_RIGHT), MP_ROM_INT(3) }, \
+    { MP_ROM_QSTR(MP_QSTR_A), MP_ROM_INT(4) }, \
+    { MP_ROM_QSTR(MP_QSTR_B), MP_ROM_INT(5) },
+
 // LEDs
 #define MICROPY_HW_HAS_LED          (1)
 #define MICROPY_HW_LED_COUNT        (2)
@@ -104,5 +184,9 @@ extern struct _spi_bdev_t spi_bdev;
 
 // USB config
 #define MICROPY_HW_USB_FS              (1)
+#define MICROPY_HW_USB_HID_GAMEPAD     (1)
 // #define MICROPY_HW_USB_VBUS_DETECT_PIN (pin_A9)
-// #define MICROPY_HW_USB_OTG_ID_PIN      (pin_A10)
\ No newline at end of file
+// #define MICROPY_HW_USB_OTG_ID_PIN      (pin_A10)
+// Larger USB VCP buffers for bulk transfers to and from the host
+#define USBD_CDC_RX_DATA_SIZE       (2048)
+#define USBD_CDC_TX_DATA_SIZE       (2048)
@@ -10,6 +10,10 @@
 #define MICROPY_HW_HAS_SWITCH       (1)
 #define MICROPY_HW_HAS_FLASH        (1)
 
+// D2 SRAM1, SRAM2 and SRAM3 are otherwise unused, so add them to the heap
+#define MICROPY_HEAP2_START         ((void*)0x30000000)
+#define MICROPY_HEAP2_END           ((void*)0x30048000)
+
 #define MICROPY_BOARD_EARLY_INIT    NUCLEO_H743ZI_board_early_init
 void NUCLEO_H743ZI_board_early_init(void);
 
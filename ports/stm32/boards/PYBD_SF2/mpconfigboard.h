@@ -98,6 +98,12 @@ extern struct _spi_bdev_t spi_bdev;
 extern const struct _mp_spiflash_config_t spiflash2_config;
 extern struct _spi_bdev_t spi_bdev2;
 
+// SPI flash #2, last 512K is the memory mapped asset partition (must match
+// the linker script and ASSETS_ADDR in mpconfigboard.mk)
+#define MICROPY_HW_ENABLE_ASSETS    (1)
+#define MICROPY_HW_ASSETS_ADDR      (0x90180000)
+#define MICROPY_HW_ASSETS_SIZE      (512 * 1024)
+
 // UART config
 #define MICROPY_HW_UART1_NAME       "YA"
 #define MICROPY_HW_UART1_TX         (pyb_pin_Y1)
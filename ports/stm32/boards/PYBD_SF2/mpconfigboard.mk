@@ -8,6 +8,7 @@ TEXT0_ADDR = 0x08008000
 TEXT1_ADDR = 0x90000000
 TEXT0_SECTIONS = .isr_vector .text .data
 TEXT1_SECTIONS = .text_ext
+ASSETS_ADDR = 0x90180000
 
 # MicroPython settings
 MICROPY_PY_LWIP = 1
@@ -0,0 +1,81 @@
+#include "py/mphal.h"
+#include "pin.h"
+
+// The ILI9341 panel takes its pixels from the LTDC over the parallel RGB
+// interface, but is configured over SPI first.  The few bytes that takes are
+// bit-banged on the SPI5 pins, with D/C on WRX.
+
+#define ILI9341_SCK (pin_F7)
+#define ILI9341_MOSI (pin_F9)
+#define ILI9341_CS (pin_C2)
+#define ILI9341_DC (pin_D13)
+
+#define ILI9341_DELAY (0xff)
+
+// Each command is its byte, the number of parameters and the parameters, or
+// ILI9341_DELAY and a time in ms.  The sequence is the one from ST's board
+// support package for this board.
+STATIC const uint8_t ili9341_init_seq[] = {
+    0xca, 3, 0xc3, 0x08, 0x50,
+    0xcf, 3, 0x00, 0xc1, 0x30, // power control B
+    0xed, 4, 0x64, 0x03, 0x12, 0x81, // power on sequence
+    0xe8, 3, 0x85, 0x00, 0x78, // driver timing control A
+    0xcb, 5, 0x39, 0x2c, 0x00, 0x34, 0x02, // power control A
+    0xf7, 1, 0x20, // pump ratio
+    0xea, 2, 0x00, 0x00, // driver timing control B
+    0xb1, 2, 0x00, 0x1b, // frame rate
+    0xb6, 2, 0x0a, 0xa2, // display function control
+    0xc0, 1, 0x10, // power control 1
+    0xc1, 1, 0x10, // power control 2
+    0xc5, 2, 0x45, 0x15, // VCOM control 1
+    0xc7, 1, 0x90, // VCOM control 2
+    0x36, 1, 0xc8, // memory access control
+    0xf2, 1, 0x00, // 3 gamma disable
+    0xb0, 1, 0xc2, // RGB interface, DE mode
+    0xb6, 4, 0x0a, 0xa7, 0x27, 0x04, // display function control
+    0x2a, 4, 0x00, 0x00, 0x00, 0xef, // column address
+    0x2b, 4, 0x00, 0x00, 0x01, 0x3f, // page address
+    0xf6, 3, 0x01, 0x00, 0x06, // interface control: RGB interface
+    0x2c, 0,
+    ILI9341_DELAY, 200,
+    0x26, 1, 0x01, // gamma curve
+    0xe0, 15, 0x0f, 0x29, 0x24, 0x0c, 0x0e, 0x09, 0x4e, 0x78, 0x3c, 0x09, 0x13, 0x05, 0x17, 0x11, 0x00,
+    0xe1, 15, 0x00, 0x16, 0x1b, 0x04, 0x11, 0x07, 0x31, 0x33, 0x42, 0x05, 0x0c, 0x0a, 0x28, 0x2f, 0x0f,
+    0x11, 0, // sleep out
+    ILI9341_DELAY, 200,
+    0x29, 0, // display on
+    0x2c, 0,
+};
+
+STATIC void ili9341_write(uint8_t b, bool data) {
+    mp_hal_pin_write(ILI9341_DC, data);
+    mp_hal_pin_low(ILI9341_CS);
+    for (int i = 0; i < 8; ++i, b <<= 1) {
+        mp_hal_pin_write(ILI9341_MOSI, b >> 7);
+        mp_hal_pin_high(ILI9341_SCK);
+        mp_hal_pin_low(ILI9341_SCK);
+    }
+    mp_hal_pin_high(ILI9341_CS);
+}
+
+void board_ltdc_panel_init(void) {
+    mp_hal_pin_high(ILI9341_CS);
+    mp_hal_pin_low(ILI9341_SCK);
+    mp_hal_pin_output(ILI9341_CS);
+    mp_hal_pin_output(ILI9341_SCK);
+    mp_hal_pin_output(ILI9341_MOSI);
+    mp_hal_pin_output(ILI9341_DC);
+
+    for (const uint8_t *p = ili9341_init_seq; p < ili9341_init_seq + sizeof(ili9341_init_seq);) {
+        if (p[0] == ILI9341_DELAY) {
+            mp_hal_delay_ms(p[1]);
+            p += 2;
+            continue;
+        }
+        ili9341_write(p[0], false);
+        for (int i = 0; i < p[1]; ++i) {
+            ili9341_write(p[2 + i], true);
+        }
+        p += 2 + p[1];
+    }
+}
@@ -6,6 +6,8 @@
 #define MICROPY_HW_ENABLE_RNG       (1)
 #define MICROPY_HW_ENABLE_RTC       (1)
 #define MICROPY_HW_ENABLE_USB       (1)
+#define MICROPY_HW_ENABLE_DMA2D     (1) // framebuf fills and blits
+#define MICROPY_HW_ENABLE_LTDC      (1) // pyb.LTDC, the 240x320 LCD
 
 // HSE is 8MHz
 #define MICROPY_HW_CLK_PLLM (8)
@@ -142,3 +144,27 @@
 #define MICROPY_HW_FMC_D13      (pin_D8)
 #define MICROPY_HW_FMC_D14      (pin_D9)
 #define MICROPY_HW_FMC_D15      (pin_D10)
+
+// LCD: ILI9341 on the LTDC, 240x320 at about 65Hz from a 6MHz pixel clock
+#define MICROPY_HW_LTDC_WIDTH       (240)
+#define MICROPY_HW_LTDC_HEIGHT      (320)
+#define MICROPY_HW_LTDC_HSYNC       (10)
+#define MICROPY_HW_LTDC_HBP         (20)
+#define MICROPY_HW_LTDC_HFP         (10)
+#define MICROPY_HW_LTDC_VSYNC       (2)
+#define MICROPY_HW_LTDC_VBP         (2)
+#define MICROPY_HW_LTDC_VFP         (4)
+#define MICROPY_HW_LTDC_PLLSAIN     (192)
+#define MICROPY_HW_LTDC_PLLSAIR     (4)
+#define MICROPY_HW_LTDC_PLLSAIDIVR  (RCC_PLLSAIDIVR_8)
+#define MICROPY_HW_LTDC_PINS { \
+    { pin_C10, 14 }, { pin_B0, 9 }, { pin_A11, 14 }, { pin_A12, 14 }, /* R2-R5 */ \
+    { pin_B1, 9 }, { pin_G6, 14 }, /* R6-R7 */ \
+    { pin_A6, 14 }, { pin_G10, 9 }, { pin_B10, 14 }, { pin_B11, 14 }, /* G2-G5 */ \
+    { pin_C7, 14 }, { pin_D3, 14 }, /* G6-G7 */ \
+    { pin_D6, 14 }, { pin_G11, 14 }, { pin_G12, 9 }, { pin_A3, 14 }, /* B2-B5 */ \
+    { pin_B8, 14 }, { pin_B9, 14 }, /* B6-B7 */ \
+    { pin_C6, 14 }, { pin_A4, 14 }, { pin_F10, 14 }, { pin_G7, 14 }, /* HSYNC, VSYNC, DE, CLK */ \
+}
+#define MICROPY_HW_LTDC_PANEL_INIT  board_ltdc_panel_init
+void board_ltdc_panel_init(void);
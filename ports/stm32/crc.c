@@ -0,0 +1,87 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/mphal.h"
+#include "extmod/uzlib/tinf.h"
+#include "crc.h"
+
+// The CRC unit computes a CRC32 of whole words with the same polynomial as
+// zlib, but shifting msb first and starting from 0xffffffff.  zlib shifts lsb
+// first, so each word goes in bit reversed and the result comes out bit
+// reversed.  The unit on the F4 can only be reset, not loaded with a value, so
+// to carry on from an earlier running CRC the unit is reset and then given the
+// one word that takes it from 0xffffffff to that CRC.  Bytes before the first
+// word boundary and after the last are done in software.
+//
+// The CPU feeds the unit: it takes 4 cycles per word and a load, bit reverse
+// and store keep up with it, so DMA would only add its setup time.
+
+#define CRC32_POLY (0x04c11db7)
+
+// Shorter buffers are quicker in software than loading the unit
+#define CRC32_HW_MIN_LEN (32)
+
+// Set while the unit is in use, so that a call from an interrupt handler
+// in the middle of another call doesn't clobber its state
+STATIC volatile bool crc32_hw_busy;
+
+// Return the word that takes the unit from its reset value to value, found by
+// undoing the 32 shifts made for a word.
+STATIC uint32_t crc32_hw_preload(uint32_t value) {
+    for (int i = 0; i < 32; ++i) {
+        if (value & 1) {
+            value = ((value ^ CRC32_POLY) >> 1) | 0x80000000;
+        } else {
+            value >>= 1;
+        }
+    }
+    return value ^ 0xffffffff;
+}
+
+uint32_t crc32_update(uint32_t crc, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    if (len < CRC32_HW_MIN_LEN || crc32_hw_busy) {
+        return uzlib_crc32(p, len, crc);
+    }
+    crc32_hw_busy = true;
+
+    size_t head = -(uintptr_t)p & 3;
+    crc = uzlib_crc32(p, head, crc);
+    p += head;
+    len -= head;
+
+    __HAL_RCC_CRC_CLK_ENABLE();
+    CRC->CR = CRC_CR_RESET;
+    CRC->DR = crc32_hw_preload(__RBIT(crc));
+    const uint32_t *w = (const uint32_t*)p;
+    for (size_t n = len / 4; n; --n) {
+        CRC->DR = __RBIT(*w++);
+    }
+    crc = __RBIT(CRC->DR);
+
+    crc32_hw_busy = false;
+    return uzlib_crc32(w, len & 3, crc);
+}
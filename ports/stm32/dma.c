@@ -167,6 +167,75 @@ static const DMA_InitTypeDef dma_init_struct_dac = {
 };
 #endif
 
+#if MICROPY_HW_ENABLE_AUDIO || MICROPY_PY_MACHINE_BITSTREAM
+// Parameters to dma_init() for pyb.Audio and machine.bitstream, which stream
+// a ring of 32-bit compare values into a timer
+static const DMA_InitTypeDef dma_init_struct_tim_ring = {
+    #if defined(STM32F4) || defined(STM32F7)
+    .Channel             = 0,
+    #endif
+    .Direction           = 0,
+    .PeriphInc           = DMA_PINC_DISABLE,
+    .MemInc              = DMA_MINC_ENABLE,
+    .PeriphDataAlignment = DMA_PDATAALIGN_WORD,
+    .MemDataAlignment    = DMA_MDATAALIGN_WORD,
+    .Mode                = DMA_CIRCULAR,
+    .Priority            = DMA_PRIORITY_HIGH,
+    #if defined(STM32F4) || defined(STM32F7)
+    .FIFOMode            = DMA_FIFOMODE_DISABLE,
+    .FIFOThreshold       = DMA_FIFO_THRESHOLD_FULL,
+    .MemBurst            = DMA_MBURST_SINGLE,
+    .PeriphBurst         = DMA_PBURST_SINGLE,
+    #endif
+};
+#endif
+
+#if MICROPY_HW_UART_DMA
+// Parameters to dma_init() for UART receive, which runs continuously round
+// the UART's read buffer
+static const DMA_InitTypeDef dma_init_struct_uart_rx = {
+    #if defined(STM32F4) || defined(STM32F7)
+    .Channel             = 0,
+    #endif
+    .Direction           = 0,
+    .PeriphInc           = DMA_PINC_DISABLE,
+    .MemInc              = DMA_MINC_ENABLE,
+    .PeriphDataAlignment = DMA_PDATAALIGN_BYTE,
+    .MemDataAlignment    = DMA_MDATAALIGN_BYTE,
+    .Mode                = DMA_CIRCULAR,
+    .Priority            = DMA_PRIORITY_HIGH,
+    #if defined(STM32F4) || defined(STM32F7)
+    .FIFOMode            = DMA_FIFOMODE_DISABLE,
+    .FIFOThreshold       = DMA_FIFO_THRESHOLD_FULL,
+    .MemBurst            = DMA_MBURST_SINGLE,
+    .PeriphBurst         = DMA_PBURST_SINGLE,
+    #endif
+};
+#endif
+
+#if MICROPY_HW_ENABLE_ADC_CAPTURE
+// Parameters to dma_init() for ADC.capture(), which fills a ring of 16-bit
+// samples from the ADC data register
+static const DMA_InitTypeDef dma_init_struct_adc = {
+    #if defined(STM32F4) || defined(STM32F7)
+    .Channel             = 0,
+    #endif
+    .Direction           = 0,
+    .PeriphInc           = DMA_PINC_DISABLE,
+    .MemInc              = DMA_MINC_ENABLE,
+    .PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD,
+    .MemDataAlignment    = DMA_MDATAALIGN_HALFWORD,
+    .Mode                = DMA_CIRCULAR,
+    .Priority            = DMA_PRIORITY_HIGH,
+    #if defined(STM32F4) || defined(STM32F7)
+    .FIFOMode            = DMA_FIFOMODE_DISABLE,
+    .FIFOThreshold       = DMA_FIFO_THRESHOLD_FULL,
+    .MemBurst            = DMA_MBURST_SINGLE,
+    .PeriphBurst         = DMA_PBURST_SINGLE,
+    #endif
+};
+#endif
+
 #if MICROPY_HW_ENABLE_DCMI
 static const DMA_InitTypeDef dma_init_struct_dcmi = {
     #if defined(STM32H7)
@@ -188,6 +257,26 @@ static const DMA_InitTypeDef dma_init_struct_dcmi = {
 };
 #endif
 
+#if MICROPY_PY_MACHINE_MEMCPY
+// Parameters to dma_nohal_init() for memory-to-memory copies.  Memory to
+// memory needs the FIFO.  The source address increments only if the caller
+// adds DMA_PINC_ENABLE to the config, so a fill can read one fixed word.
+static const DMA_InitTypeDef dma_init_struct_mem2mem = {
+    .Channel             = DMA_CHANNEL_0,
+    .Direction           = DMA_MEMORY_TO_MEMORY,
+    .PeriphInc           = DMA_PINC_DISABLE,
+    .MemInc              = DMA_MINC_ENABLE,
+    .PeriphDataAlignment = DMA_PDATAALIGN_WORD,
+    .MemDataAlignment    = DMA_MDATAALIGN_WORD,
+    .Mode                = DMA_NORMAL,
+    .Priority            = DMA_PRIORITY_LOW,
+    .FIFOMode            = DMA_FIFOMODE_ENABLE,
+    .FIFOThreshold       = DMA_FIFO_THRESHOLD_FULL,
+    .MemBurst            = DMA_MBURST_SINGLE,
+    .PeriphBurst         = DMA_PBURST_SINGLE
+};
+#endif
+
 #if defined(STM32F0)
 
 #define NCONTROLLERS            (2)
@@ -246,11 +335,17 @@ static const uint8_t dma_irqn[NSTREAM] = {
 
 // DMA1 streams
 const dma_descr_t dma_I2C_1_RX = { DMA1_Stream0, DMA_CHANNEL_1, dma_id_0,   &dma_init_struct_spi_i2c };
+#if MICROPY_PY_MACHINE_BITSTREAM
+const dma_descr_t dma_TIM_2_UP = { DMA1_Stream1, DMA_CHANNEL_3, dma_id_1,   &dma_init_struct_tim_ring };
+#endif
 const dma_descr_t dma_SPI_3_RX = { DMA1_Stream2, DMA_CHANNEL_0, dma_id_2,   &dma_init_struct_spi_i2c };
 #if defined(STM32F7)
 const dma_descr_t dma_I2C_4_RX = { DMA1_Stream2, DMA_CHANNEL_2, dma_id_2,   &dma_init_struct_spi_i2c };
 #endif
 const dma_descr_t dma_I2C_3_RX = { DMA1_Stream2, DMA_CHANNEL_3, dma_id_2,   &dma_init_struct_spi_i2c };
+#if MICROPY_PY_MACHINE_BITSTREAM
+const dma_descr_t dma_TIM_3_UP = { DMA1_Stream2, DMA_CHANNEL_5, dma_id_2,   &dma_init_struct_tim_ring };
+#endif
 const dma_descr_t dma_I2C_2_RX = { DMA1_Stream2, DMA_CHANNEL_7, dma_id_2,   &dma_init_struct_spi_i2c };
 const dma_descr_t dma_SPI_2_RX = { DMA1_Stream3, DMA_CHANNEL_0, dma_id_3,   &dma_init_struct_spi_i2c };
 const dma_descr_t dma_SPI_2_TX = { DMA1_Stream4, DMA_CHANNEL_0, dma_id_4,   &dma_init_struct_spi_i2c };
@@ -262,6 +357,16 @@ const dma_descr_t dma_I2C_4_TX = { DMA1_Stream5, DMA_CHANNEL_2, dma_id_5,   &dma
 const dma_descr_t dma_DAC_1_TX = { DMA1_Stream5, DMA_CHANNEL_7, dma_id_5,   &dma_init_struct_dac };
 const dma_descr_t dma_DAC_2_TX = { DMA1_Stream6, DMA_CHANNEL_7, dma_id_6,   &dma_init_struct_dac };
 #endif
+#if MICROPY_HW_UART_DMA && defined(STM32F4)
+const dma_descr_t dma_USART_2_RX = { DMA1_Stream5, DMA_CHANNEL_4, dma_id_5,   &dma_init_struct_uart_rx };
+const dma_descr_t dma_USART_2_TX = { DMA1_Stream6, DMA_CHANNEL_4, dma_id_6,   &dma_init_struct_spi_i2c };
+#endif
+#if MICROPY_PY_MACHINE_BITSTREAM
+const dma_descr_t dma_TIM_4_UP = { DMA1_Stream6, DMA_CHANNEL_2, dma_id_6,   &dma_init_struct_tim_ring };
+#endif
+#if (MICROPY_HW_ENABLE_AUDIO && defined(STM32F4)) || MICROPY_PY_MACHINE_BITSTREAM
+const dma_descr_t dma_TIM_5_UP = { DMA1_Stream6, DMA_CHANNEL_6, dma_id_6,   &dma_init_struct_tim_ring };
+#endif
 const dma_descr_t dma_SPI_3_TX = { DMA1_Stream7, DMA_CHANNEL_0, dma_id_7,   &dma_init_struct_spi_i2c };
 const dma_descr_t dma_I2C_1_TX = { DMA1_Stream7, DMA_CHANNEL_1, dma_id_7,   &dma_init_struct_spi_i2c };
 const dma_descr_t dma_I2C_2_TX = { DMA1_Stream7, DMA_CHANNEL_7, dma_id_7,   &dma_init_struct_spi_i2c };
@@ -274,9 +379,19 @@ const dma_descr_t dma_I2C_1_TX = { DMA1_Stream6, DMA_CHANNEL_1, dma_id_6,   &dma
 #if defined(STM32F7) && defined(SDMMC2) && ENABLE_SDIO
 const dma_descr_t dma_SDMMC_2 = { DMA2_Stream0, DMA_CHANNEL_11, dma_id_8,  &dma_init_struct_sdio };
 #endif
+#if MICROPY_HW_ENABLE_ADC_CAPTURE && defined(STM32F4)
+const dma_descr_t dma_ADC_1_RX = { DMA2_Stream0, DMA_CHANNEL_0, dma_id_8,   &dma_init_struct_adc };
+#endif
 #if MICROPY_HW_ENABLE_DCMI
 const dma_descr_t dma_DCMI_0 = { DMA2_Stream1, DMA_CHANNEL_1, dma_id_9,  &dma_init_struct_dcmi };
 #endif
+#if MICROPY_HW_UART_DMA && defined(STM32F4)
+const dma_descr_t dma_USART_6_RX = { DMA2_Stream1, DMA_CHANNEL_5, dma_id_9,   &dma_init_struct_uart_rx };
+const dma_descr_t dma_USART_1_RX = { DMA2_Stream2, DMA_CHANNEL_4, dma_id_10,  &dma_init_struct_uart_rx };
+#endif
+#if MICROPY_PY_MACHINE_BITSTREAM && defined(TIM8)
+const dma_descr_t dma_TIM_8_UP = { DMA2_Stream1, DMA_CHANNEL_7, dma_id_9,   &dma_init_struct_tim_ring };
+#endif
 const dma_descr_t dma_SPI_1_RX = { DMA2_Stream2, DMA_CHANNEL_3, dma_id_10,  &dma_init_struct_spi_i2c };
 const dma_descr_t dma_SPI_5_RX = { DMA2_Stream3, DMA_CHANNEL_2, dma_id_11,  &dma_init_struct_spi_i2c };
 #if ENABLE_SDIO
@@ -287,13 +402,30 @@ const dma_descr_t dma_SPI_5_TX = { DMA2_Stream4, DMA_CHANNEL_2, dma_id_12,  &dma
 const dma_descr_t dma_SPI_4_TX = { DMA2_Stream4, DMA_CHANNEL_5, dma_id_12,  &dma_init_struct_spi_i2c };
 const dma_descr_t dma_SPI_6_TX = { DMA2_Stream5, DMA_CHANNEL_1, dma_id_13,  &dma_init_struct_spi_i2c };
 const dma_descr_t dma_SPI_1_TX = { DMA2_Stream5, DMA_CHANNEL_3, dma_id_13,  &dma_init_struct_spi_i2c };
+#if MICROPY_PY_MACHINE_BITSTREAM
+const dma_descr_t dma_TIM_1_UP = { DMA2_Stream5, DMA_CHANNEL_6, dma_id_13,  &dma_init_struct_tim_ring };
+#endif
 //#if defined(STM32F7) && defined(SDMMC2) && ENABLE_SDIO
 //const dma_descr_t dma_SDMMC_2 = { DMA2_Stream5, DMA_CHANNEL_11, dma_id_13,  &dma_init_struct_sdio };
 //#endif
 const dma_descr_t dma_SPI_6_RX = { DMA2_Stream6, DMA_CHANNEL_1, dma_id_14,  &dma_init_struct_spi_i2c };
+#if MICROPY_HW_UART_DMA && defined(STM32F4)
+const dma_descr_t dma_USART_6_TX = { DMA2_Stream6, DMA_CHANNEL_5, dma_id_14,  &dma_init_struct_spi_i2c };
+const dma_descr_t dma_USART_1_TX = { DMA2_Stream7, DMA_CHANNEL_4, dma_id_15,  &dma_init_struct_spi_i2c };
+#endif
 //#if ENABLE_SDIO
 //const dma_descr_t dma_SDIO_0 = { DMA2_Stream6, DMA_CHANNEL_4, dma_id_14,  &dma_init_struct_sdio };
 //#endif
+#if MICROPY_PY_MACHINE_MEMCPY
+// Only DMA2 can copy memory to memory.  These are the streams it may use,
+// in order of preference, starting with those that the fewest peripherals
+// of this port share.
+static const dma_descr_t dma_mem2mem[] = {
+    { DMA2_Stream7, DMA_CHANNEL_0, dma_id_15,  &dma_init_struct_mem2mem },
+    { DMA2_Stream6, DMA_CHANNEL_0, dma_id_14,  &dma_init_struct_mem2mem },
+    { DMA2_Stream4, DMA_CHANNEL_0, dma_id_12,  &dma_init_struct_mem2mem },
+};
+#endif
 /* not preferred streams
 const dma_descr_t dma_SPI_1_TX = { DMA2_Stream3, DMA_CHANNEL_3, dma_id_11,  &dma_init_struct_spi_i2c };
 const dma_descr_t dma_SPI_1_RX = { DMA2_Stream0, DMA_CHANNEL_3, dma_id_8,   &dma_init_struct_spi_i2c };
@@ -882,6 +1014,11 @@ void dma_nohal_start(const dma_descr_t *descr, uint32_t src_addr, uint32_t dst_a
     dma->CCR |= DMA_CCR_EN;
 }
 
+bool dma_nohal_is_busy(const dma_descr_t *descr) {
+    DMA_Channel_TypeDef *dma = descr->instance;
+    return (dma->CCR & DMA_CCR_EN) != 0;
+}
+
 #else
 
 void dma_nohal_init(const dma_descr_t *descr, uint32_t config) {
@@ -954,6 +1091,24 @@ void dma_nohal_start(const dma_descr_t *descr, uint32_t src_addr, uint32_t dst_a
     dma->CR |= DMA_SxCR_EN;
 }
 
+bool dma_nohal_is_busy(const dma_descr_t *descr) {
+    DMA_Stream_TypeDef *dma = descr->instance;
+    return (dma->CR & DMA_SxCR_EN) != 0;
+}
+
+#if MICROPY_PY_MACHINE_MEMCPY
+// Returns a stream for memory-to-memory transfers that no peripheral has
+// enabled, or NULL if they are all in use.
+const dma_descr_t *dma_find_free_mem2mem(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(dma_mem2mem); ++i) {
+        if (!(dma_enable_mask & (1 << dma_mem2mem[i].id))) {
+            return &dma_mem2mem[i];
+        }
+    }
+    return NULL;
+}
+#endif
+
 #endif
 
 #endif // defined(STM32WB)
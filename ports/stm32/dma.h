@@ -31,9 +31,11 @@ typedef struct _dma_descr_t dma_descr_t;
 #if defined(STM32F0) || defined(STM32F4) || defined(STM32F7) || defined(STM32H7)
 
 extern const dma_descr_t dma_I2C_1_RX;
+extern const dma_descr_t dma_TIM_2_UP;
 extern const dma_descr_t dma_SPI_3_RX;
 extern const dma_descr_t dma_I2C_4_RX;
 extern const dma_descr_t dma_I2C_3_RX;
+extern const dma_descr_t dma_TIM_3_UP;
 extern const dma_descr_t dma_I2C_2_RX;
 extern const dma_descr_t dma_SPI_2_RX;
 extern const dma_descr_t dma_SPI_2_TX;
@@ -41,10 +43,18 @@ extern const dma_descr_t dma_I2C_3_TX;
 extern const dma_descr_t dma_I2C_4_TX;
 extern const dma_descr_t dma_DAC_1_TX;
 extern const dma_descr_t dma_DAC_2_TX;
+extern const dma_descr_t dma_USART_2_RX;
+extern const dma_descr_t dma_USART_2_TX;
+extern const dma_descr_t dma_TIM_4_UP;
+extern const dma_descr_t dma_TIM_5_UP;
 extern const dma_descr_t dma_SPI_3_TX;
 extern const dma_descr_t dma_I2C_1_TX;
 extern const dma_descr_t dma_I2C_2_TX;
 extern const dma_descr_t dma_SDMMC_2;
+extern const dma_descr_t dma_ADC_1_RX;
+extern const dma_descr_t dma_USART_6_RX;
+extern const dma_descr_t dma_USART_1_RX;
+extern const dma_descr_t dma_TIM_8_UP;
 extern const dma_descr_t dma_SPI_1_RX;
 extern const dma_descr_t dma_SPI_5_RX;
 extern const dma_descr_t dma_SDIO_0;
@@ -53,8 +63,11 @@ extern const dma_descr_t dma_SPI_5_TX;
 extern const dma_descr_t dma_SPI_4_TX;
 extern const dma_descr_t dma_SPI_6_TX;
 extern const dma_descr_t dma_SPI_1_TX;
+extern const dma_descr_t dma_TIM_1_UP;
 extern const dma_descr_t dma_SDMMC_2;
 extern const dma_descr_t dma_SPI_6_RX;
+extern const dma_descr_t dma_USART_6_TX;
+extern const dma_descr_t dma_USART_1_TX;
 extern const dma_descr_t dma_SDIO_0;
 extern const dma_descr_t dma_DCMI_0;
 
@@ -106,5 +119,8 @@ void dma_invalidate_channel(const dma_descr_t *dma_descr);
 void dma_nohal_init(const dma_descr_t *descr, uint32_t config);
 void dma_nohal_deinit(const dma_descr_t *descr);
 void dma_nohal_start(const dma_descr_t *descr, uint32_t src_addr, uint32_t dst_addr, uint16_t len);
+bool dma_nohal_is_busy(const dma_descr_t *descr);
+
+const dma_descr_t *dma_find_free_mem2mem(void);
 
 #endif // MICROPY_INCLUDED_STM32_DMA_H
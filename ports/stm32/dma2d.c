@@ -0,0 +1,148 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/mphal.h"
+#include "dma2d.h"
+
+#if MICROPY_HW_ENABLE_DMA2D
+
+// The DMA2D does fills and copies, with pixel format conversion, between any
+// memory on the AHB bus matrix, eg SRAM and the external SDRAM.  It is started
+// and then polled until done: the caller goes on to read or draw over the
+// pixels, so it has to wait anyway, and the CPU fill and copy loops it
+// replaces run at a fraction of the DMA2D's speed for large areas.
+
+// Below this many pixels setting up the DMA2D takes longer than the CPU
+#define DMA2D_MIN_PIXELS (256)
+
+#define DMA2D_TIMEOUT_MS (100)
+
+// values for the MODE field of CR
+#define DMA2D_MODE_M2M (0 << 16)
+#define DMA2D_MODE_M2M_PFC (1 << 16)
+#define DMA2D_MODE_R2M (3 << 16)
+
+// values for the CM field of the PFCCR registers
+#define DMA2D_CM_ARGB8888 (0)
+#define DMA2D_CM_RGB565 (2)
+#define DMA2D_CM_L8 (5)
+
+// The foreground CLUT, which the CPU can write while the DMA2D is idle
+#define DMA2D_FGCLUT ((volatile uint32_t*)(DMA2D_BASE + 0x400))
+
+STATIC bool dma2d_reachable(const void *addr) {
+    #if defined(CCMDATARAM_BASE)
+    // the core-coupled RAM is only connected to the CPU
+    if ((uintptr_t)addr - CCMDATARAM_BASE < 0x10000) {
+        return false;
+    }
+    #endif
+    // RGB565 pixels must be halfword aligned
+    return ((uintptr_t)addr & 1) == 0;
+}
+
+// Check that the DMA2D can do a w x h operation with a stride of the given
+// number of pixels, and claim it if so.
+STATIC bool dma2d_claim(int w, int h, size_t stride) {
+    if (w * h < DMA2D_MIN_PIXELS || w > 0x3fff || h > 0xffff || stride - w > 0x3fff) {
+        return false;
+    }
+    __HAL_RCC_DMA2D_CLK_ENABLE();
+    // in use by the code that this call interrupted
+    return !(DMA2D->CR & DMA2D_CR_START);
+}
+
+// Run the operation set up in the registers, with the output at dest, and
+// wait for it to finish.
+STATIC bool dma2d_run(uint32_t mode, uint16_t *dest, size_t stride, int w, int h) {
+    MP_HAL_CLEANINVALIDATE_DCACHE(dest, ((h - 1) * stride + w) * sizeof(uint16_t));
+    DMA2D->OPFCCR = DMA2D_CM_RGB565;
+    DMA2D->OMAR = (uint32_t)dest;
+    DMA2D->OOR = stride - w;
+    DMA2D->NLR = w << 16 | h;
+    DMA2D->IFCR = 0x3f;
+    DMA2D->CR = mode | DMA2D_CR_START;
+
+    uint32_t t0 = mp_hal_ticks_ms();
+    while (DMA2D->CR & DMA2D_CR_START) {
+        if (mp_hal_ticks_ms() - t0 >= DMA2D_TIMEOUT_MS) {
+            DMA2D->CR |= DMA2D_CR_ABORT;
+            while (DMA2D->CR & DMA2D_CR_START) {
+            }
+            return false;
+        }
+    }
+    // drop any lines the CPU fetched while the DMA2D was writing
+    MP_HAL_CLEANINVALIDATE_DCACHE(dest, ((h - 1) * stride + w) * sizeof(uint16_t));
+    return !(DMA2D->ISR & (DMA2D_ISR_TEIF | DMA2D_ISR_CEIF));
+}
+
+bool dma2d_fill_rgb565(uint16_t *dest, size_t stride, int w, int h, uint16_t col) {
+    if (!dma2d_reachable(dest) || !dma2d_claim(w, h, stride)) {
+        return false;
+    }
+    DMA2D->OCOLR = col;
+    return dma2d_run(DMA2D_MODE_R2M, dest, stride, w, h);
+}
+
+bool dma2d_copy_rgb565(uint16_t *dest, size_t dest_stride, const uint16_t *src, size_t src_stride, int w, int h) {
+    if (!dma2d_reachable(dest) || !dma2d_reachable(src)
+        || src_stride - w > 0x3fff || !dma2d_claim(w, h, dest_stride)) {
+        return false;
+    }
+    MP_HAL_CLEAN_DCACHE(src, ((h - 1) * src_stride + w) * sizeof(uint16_t));
+    DMA2D->FGPFCCR = DMA2D_CM_RGB565;
+    DMA2D->FGMAR = (uint32_t)src;
+    DMA2D->FGOR = src_stride - w;
+    return dma2d_run(DMA2D_MODE_M2M, dest, dest_stride, w, h);
+}
+
+bool dma2d_copy_l8_rgb565(uint16_t *dest, size_t dest_stride, const uint8_t *src, size_t src_stride, int w, int h, const uint16_t *lut) {
+    if (!dma2d_reachable(dest)
+        #if defined(CCMDATARAM_BASE)
+        || (uintptr_t)src - CCMDATARAM_BASE < 0x10000
+        #endif
+        || src_stride - w > 0x3fff || !dma2d_claim(w, h, dest_stride)) {
+        return false;
+    }
+
+    // The CLUT holds ARGB8888 colours, and converting them to RGB565 keeps
+    // the top bits of each component, so widening the lut's entries by
+    // repeating their top bits gives back exactly the same values.
+    for (int i = 0; i < 256; ++i) {
+        uint32_t c = lut[i];
+        uint32_t r = c >> 11, g = (c >> 5) & 0x3f, b = c & 0x1f;
+        DMA2D_FGCLUT[i] = 0xff000000 | (r << 3 | r >> 2) << 16 | (g << 2 | g >> 4) << 8 | (b << 3 | b >> 2);
+    }
+
+    MP_HAL_CLEAN_DCACHE(src, (h - 1) * src_stride + w);
+    DMA2D->FGPFCCR = 255 << 8 | DMA2D_CM_L8;
+    DMA2D->FGMAR = (uint32_t)src;
+    DMA2D->FGOR = src_stride - w;
+    return dma2d_run(DMA2D_MODE_M2M_PFC, dest, dest_stride, w, h);
+}
+
+#endif // MICROPY_HW_ENABLE_DMA2D
@@ -0,0 +1,48 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_STM32_DMA2D_H
+#define MICROPY_INCLUDED_STM32_DMA2D_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// These do a framebuf operation on RGB565 pixels with the DMA2D, waiting for
+// it to finish.  Strides are in pixels and colours are the 16-bit values as
+// they are stored in memory.  Each returns false, having done nothing, if
+// the operation is too small to be worth it, a buffer can't be reached by
+// the DMA2D or the DMA2D is in use, and then the caller does it instead.
+
+// Fill w x h pixels at dest with col.
+bool dma2d_fill_rgb565(uint16_t *dest, size_t stride, int w, int h, uint16_t col);
+
+// Copy w x h pixels from src to dest.
+bool dma2d_copy_rgb565(uint16_t *dest, size_t dest_stride, const uint16_t *src, size_t src_stride, int w, int h);
+
+// Copy w x h 8-bit pixels from src to dest, looking each up in the 256-entry lut.
+bool dma2d_copy_l8_rgb565(uint16_t *dest, size_t dest_stride, const uint8_t *src, size_t src_stride, int w, int h, const uint16_t *lut);
+
+#endif // MICROPY_INCLUDED_STM32_DMA2D_H
@@ -30,6 +30,8 @@
 
 #include "py/runtime.h"
 #include "py/gc.h"
+#include "py/mperrno.h"
+#include "py/eventring.h"
 #include "py/mphal.h"
 #include "pendsv.h"
 #include "pin.h"
@@ -128,6 +130,19 @@ STATIC bool pyb_extint_hard_irq[EXTI_NUM_VECTORS];
 // The callback arg is a small-int or a ROM Pin object, so no need to scan by GC
 STATIC mp_obj_t pyb_extint_callback_arg[EXTI_NUM_VECTORS];
 
+// Soft callbacks are queued as line numbers and all run from one scheduled
+// drain, so a burst of edges on several lines doesn't fill the scheduler
+STATIC uint8_t extint_event_buf[MICROPY_HW_EXTINT_EVENTS];
+STATIC mp_event_ring_t extint_events = {extint_event_buf, 1, MICROPY_HW_EXTINT_EVENTS};
+
+// Edge capture: the ticks_us() time of each falling edge on one line is
+// stored by the interrupt, until the buffer is full
+#define EXTINT_CAPTURE_NONE (0xff)
+STATIC volatile uint8_t extint_capture_line = EXTINT_CAPTURE_NONE;
+STATIC uint32_t *extint_capture_buf;
+STATIC size_t extint_capture_max;
+STATIC volatile size_t extint_capture_len;
+
 #if !defined(ETH)
 #define ETH_WKUP_IRQn   62  // Some MCUs don't have ETH, but we want a value to put in our table
 #endif
@@ -623,7 +638,24 @@ const mp_obj_type_t extint_type = {
     .locals_dict = (mp_obj_dict_t*)&extint_locals_dict,
 };
 
+STATIC mp_obj_t extint_drain(mp_obj_t arg) {
+    uint8_t lines[8];
+    size_t n;
+    while ((n = mp_event_ring_take(&extint_events, lines, MP_ARRAY_SIZE(lines))) != 0) {
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t line = lines[i];
+            mp_obj_t cb = MP_STATE_PORT(pyb_extint_callback)[line];
+            if (cb != mp_const_none && cb != MP_OBJ_SENTINEL) {
+                mp_call_function_1_protected(cb, pyb_extint_callback_arg[line]);
+            }
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(extint_drain_obj, extint_drain);
+
 void extint_init0(void) {
+    mp_event_ring_init(&extint_events, MP_OBJ_FROM_PTR(&extint_drain_obj), mp_const_none);
     for (int i = 0; i < PYB_EXTI_NUM_VECTORS; i++) {
         if (MP_STATE_PORT(pyb_extint_callback)[i] == MP_OBJ_SENTINEL) {
             continue;
@@ -633,10 +665,59 @@ void extint_init0(void) {
    }
 }
 
+// Start timing the falling edges on pin in the background, into buf.  The
+// line must not be used by an ExtInt or Pin.irq.  Returns 0 or an errno.
+int extint_capture_start(const pin_obj_t *pin, uint32_t *buf, size_t n) {
+    uint32_t line = pin->pin;
+    if (MP_STATE_PORT(pyb_extint_callback)[line] != mp_const_none || extint_capture_line != EXTINT_CAPTURE_NONE) {
+        return MP_EBUSY;
+    }
+    extint_disable(line);
+    extint_capture_buf = buf;
+    extint_capture_max = n;
+    extint_capture_len = 0;
+    extint_capture_line = line;
+    pyb_extint_mode[line] = EXTI_Mode_Interrupt;
+
+    #if !defined(STM32WB)
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    #endif
+    SYSCFG->EXTICR[line >> 2] =
+        (SYSCFG->EXTICR[line >> 2] & ~(0x0f << (4 * (line & 0x03))))
+        | ((uint32_t)(GPIO_GET_INDEX(pin->gpio)) << (4 * (line & 0x03)));
+    extint_trigger_mode(line, GPIO_MODE_IT_FALLING);
+    __HAL_GPIO_EXTI_CLEAR_FLAG(1 << line);
+    NVIC_SetPriority(IRQn_NONNEG(nvic_irq_channel[line]), IRQ_PRI_EXTINT_CAPTURE);
+    HAL_NVIC_EnableIRQ(nvic_irq_channel[line]);
+    extint_enable(line);
+    return 0;
+}
+
+size_t extint_capture_count(void) {
+    return extint_capture_len;
+}
+
+void extint_capture_stop(void) {
+    uint32_t line = extint_capture_line;
+    if (line == EXTINT_CAPTURE_NONE) {
+        return;
+    }
+    extint_disable(line);
+    NVIC_SetPriority(IRQn_NONNEG(nvic_irq_channel[line]), IRQ_PRI_EXTINT);
+    extint_capture_line = EXTINT_CAPTURE_NONE;
+}
+
 // Interrupt handler
 void Handle_EXTI_Irq(uint32_t line) {
     if (__HAL_GPIO_EXTI_GET_FLAG(1 << line)) {
         __HAL_GPIO_EXTI_CLEAR_FLAG(1 << line);
+        if (line == extint_capture_line) {
+            extint_capture_buf[extint_capture_len++] = mp_hal_ticks_us();
+            if (extint_capture_len == extint_capture_max) {
+                extint_disable(line);
+            }
+            return;
+        }
         if (line < EXTI_NUM_VECTORS) {
             mp_obj_t *cb = &MP_STATE_PORT(pyb_extint_callback)[line];
             #if MICROPY_PY_NETWORK_CYW43 && defined(pyb_pin_WL_HOST_WAKE)
@@ -649,9 +730,10 @@ void Handle_EXTI_Irq(uint32_t line) {
             }
             #endif
             if (*cb != mp_const_none) {
-                // If it's a soft IRQ handler then just schedule callback for later
+                // If it's a soft IRQ handler then just queue the line for the drain
                 if (!pyb_extint_hard_irq[line]) {
-                    mp_sched_schedule(*cb, pyb_extint_callback_arg[line]);
+                    uint8_t event = line;
+                    mp_event_ring_put(&extint_events, &event);
                     return;
                 }
 
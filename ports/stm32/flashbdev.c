@@ -164,6 +164,7 @@ int32_t flash_bdev_ioctl(uint32_t op, uint32_t arg) {
             flash_bdev_irq_handler();
             return 0;
 
+        case BDEV_IOCTL_SYNC_STEP: // the internal flash is written back whole
         case BDEV_IOCTL_SYNC: {
             uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH); // prevent cache flushing and USB access
             if (flash_flags & FLASH_FLAG_DIRTY) {
@@ -0,0 +1,317 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "py/obj.h"
+#include "py/mperrno.h"
+#include "irq.h"
+#include "led.h"
+#include "storage.h"
+
+#if MICROPY_HW_ENABLE_STORAGE
+
+// Sectors are never rewritten in place: each write goes to the next free
+// slot of the block being filled, tagged with the sector number and a
+// sequence number, and the RAM map is pointed at it.  The newest tag of a
+// sector wins when the map is rebuilt at init.  Blocks whose slots are
+// mostly stale are reclaimed by copying out what is still valid and erasing
+// them, in the background once writes stop, so a write rarely waits for an
+// erase.  Free blocks are taken least worn first.
+//
+// Block layout: header at 0, a tag for each slot from FTL_TAG_OFFSET, and
+// the slots from FLASH_BLOCK_SIZE on.
+
+#define FTL_MAGIC (0x314c5446) // "FTL1"
+#define FTL_TAG_OFFSET (16)
+#define FTL_NONE (0xffff)
+#define FTL_ERASED (0xffffffff)
+
+// Keep this many blocks free for reclaiming in the foreground, and reclaim
+// in the background until this many more are free
+#define FTL_GC_RESERVE (1)
+#define FTL_GC_TARGET (4)
+
+typedef struct _ftl_header_t {
+    uint32_t magic;
+    uint32_t erase_count;
+    uint32_t opened; // FTL_ERASED until the block is first written to
+    uint32_t reserved;
+} ftl_header_t;
+
+typedef struct _ftl_tag_t {
+    uint32_t sector;
+    uint32_t seq;
+} ftl_tag_t;
+
+STATIC uint8_t ftl_buf[FLASH_BLOCK_SIZE] __attribute__((aligned(4)));
+
+static inline uint32_t ftl_block_addr(uint32_t block) {
+    return block * MP_SPIFLASH_ERASE_BLOCK_SIZE;
+}
+
+static inline uint32_t ftl_slot_addr(uint32_t slot) {
+    return ftl_block_addr(slot / FTL_SLOTS_PER_BLOCK) + FLASH_BLOCK_SIZE * (1 + slot % FTL_SLOTS_PER_BLOCK);
+}
+
+static inline uint32_t ftl_tag_addr(uint32_t slot) {
+    return ftl_block_addr(slot / FTL_SLOTS_PER_BLOCK) + FTL_TAG_OFFSET + sizeof(ftl_tag_t) * (slot % FTL_SLOTS_PER_BLOCK);
+}
+
+// Rebuild the tables from the tags on the flash
+STATIC void ftl_mount(ftl_bdev_t *bdev) {
+    uint32_t num_sectors = FTL_NUM_SECTORS(bdev->num_blocks);
+    memset(bdev->map, 0xff, num_sectors * sizeof(uint16_t));
+    memset(bdev->valid, 0, bdev->num_blocks);
+    bdev->seq = 0;
+    bdev->free_blocks = 0;
+    bdev->cur_block = bdev->num_blocks;
+
+    struct {
+        ftl_header_t hdr;
+        ftl_tag_t tag[FTL_SLOTS_PER_BLOCK];
+    } meta;
+    for (uint32_t b = 0; b < bdev->num_blocks; ++b) {
+        mp_spiflash_read(&bdev->spiflash, ftl_block_addr(b), sizeof(meta), (uint8_t*)&meta);
+        if (meta.hdr.magic != FTL_MAGIC) {
+            // Not formatted: treat it as full of stale data, to be erased
+            bdev->wear[b] = 0;
+            bdev->used[b] = FTL_SLOTS_PER_BLOCK;
+            continue;
+        }
+        bdev->wear[b] = meta.hdr.erase_count > 0xffff ? 0xffff : meta.hdr.erase_count;
+        if (meta.hdr.opened == FTL_ERASED) {
+            bdev->used[b] = 0;
+            bdev->free_blocks += 1;
+            continue;
+        }
+        // A block that was being filled may have a slot programmed without
+        // its tag, so none of its free slots are used again until it's erased
+        bdev->used[b] = FTL_SLOTS_PER_BLOCK;
+        for (uint32_t i = 0; i < FTL_SLOTS_PER_BLOCK; ++i) {
+            ftl_tag_t *tag = &meta.tag[i];
+            if (tag->sector >= num_sectors || tag->seq == FTL_ERASED) {
+                continue;
+            }
+            uint16_t *m = &bdev->map[tag->sector];
+            if (*m != FTL_NONE) {
+                ftl_tag_t old;
+                mp_spiflash_read(&bdev->spiflash, ftl_tag_addr(*m), sizeof(old), (uint8_t*)&old);
+                if ((int32_t)(tag->seq - old.seq) < 0) {
+                    continue;
+                }
+            }
+            *m = b * FTL_SLOTS_PER_BLOCK + i;
+            if ((int32_t)(tag->seq - bdev->seq) > 0) {
+                bdev->seq = tag->seq;
+            }
+        }
+    }
+    for (uint32_t s = 0; s < num_sectors; ++s) {
+        if (bdev->map[s] != FTL_NONE) {
+            bdev->valid[bdev->map[s] / FTL_SLOTS_PER_BLOCK] += 1;
+        }
+    }
+}
+
+STATIC int ftl_erase(ftl_bdev_t *bdev, uint32_t b) {
+    ftl_header_t hdr = {FTL_MAGIC, bdev->wear[b] + 1, FTL_ERASED, FTL_ERASED};
+    int ret = mp_spiflash_erase_block(&bdev->spiflash, ftl_block_addr(b));
+    if (ret == 0) {
+        ret = mp_spiflash_write(&bdev->spiflash, ftl_block_addr(b), sizeof(hdr), (const uint8_t*)&hdr);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    if (bdev->wear[b] < 0xffff) {
+        bdev->wear[b] += 1;
+    }
+    bdev->used[b] = 0;
+    bdev->free_blocks += 1;
+    return 0;
+}
+
+STATIC int ftl_write_sector(ftl_bdev_t *bdev, uint32_t sector, const uint8_t *src);
+
+// Reclaim the block with the fewest valid slots, least worn if equal
+STATIC int ftl_gc(ftl_bdev_t *bdev) {
+    uint32_t victim = bdev->num_blocks;
+    for (uint32_t b = 0; b < bdev->num_blocks; ++b) {
+        if (b == bdev->cur_block || bdev->used[b] == 0) {
+            continue;
+        }
+        if (victim == bdev->num_blocks || bdev->valid[b] < bdev->valid[victim]
+            || (bdev->valid[b] == bdev->valid[victim] && bdev->wear[b] < bdev->wear[victim])) {
+            victim = b;
+        }
+    }
+    if (victim == bdev->num_blocks || bdev->valid[victim] == FTL_SLOTS_PER_BLOCK) {
+        return -MP_ENOSPC;
+    }
+
+    // Move the valid sectors out, then erase
+    uint32_t num_sectors = FTL_NUM_SECTORS(bdev->num_blocks);
+    for (uint32_t s = 0; s < num_sectors && bdev->valid[victim] > 0; ++s) {
+        if (bdev->map[s] != FTL_NONE && bdev->map[s] / FTL_SLOTS_PER_BLOCK == victim) {
+            mp_spiflash_read(&bdev->spiflash, ftl_slot_addr(bdev->map[s]), FLASH_BLOCK_SIZE, ftl_buf);
+            int ret = ftl_write_sector(bdev, s, ftl_buf);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+    }
+    return ftl_erase(bdev, victim);
+}
+
+// Make cur_block a block with a free slot
+STATIC int ftl_open_block(ftl_bdev_t *bdev, bool gc) {
+    if (bdev->cur_block < bdev->num_blocks && bdev->used[bdev->cur_block] < FTL_SLOTS_PER_BLOCK) {
+        return 0;
+    }
+    bdev->cur_block = bdev->num_blocks;
+
+    // Reclaiming writes through here, and one free block always holds what
+    // it moves out of a victim
+    while (gc && bdev->free_blocks <= FTL_GC_RESERVE) {
+        int ret = ftl_gc(bdev);
+        if (ret != 0) {
+            return ret;
+        }
+        if (bdev->cur_block < bdev->num_blocks) {
+            return 0;
+        }
+    }
+    if (bdev->free_blocks == 0) {
+        return -MP_ENOSPC;
+    }
+
+    uint32_t best = bdev->num_blocks;
+    for (uint32_t b = 0; b < bdev->num_blocks; ++b) {
+        if (bdev->used[b] == 0 && (best == bdev->num_blocks || bdev->wear[b] < bdev->wear[best])) {
+            best = b;
+        }
+    }
+    uint32_t opened = 0;
+    int ret = mp_spiflash_write(&bdev->spiflash, ftl_block_addr(best) + offsetof(ftl_header_t, opened), sizeof(opened), (const uint8_t*)&opened);
+    if (ret != 0) {
+        return ret;
+    }
+    bdev->free_blocks -= 1;
+    bdev->cur_block = best;
+    return 0;
+}
+
+// Append the sector to the log; gc is false while reclaiming
+STATIC int ftl_write_sector_internal(ftl_bdev_t *bdev, uint32_t sector, const uint8_t *src, bool gc) {
+    int ret = ftl_open_block(bdev, gc);
+    if (ret != 0) {
+        return ret;
+    }
+    uint32_t slot = bdev->cur_block * FTL_SLOTS_PER_BLOCK + bdev->used[bdev->cur_block];
+    bdev->used[bdev->cur_block] += 1;
+
+    // The data goes before the tag, so a tag always names a complete sector
+    ftl_tag_t tag = {sector, bdev->seq + 1};
+    ret = mp_spiflash_write(&bdev->spiflash, ftl_slot_addr(slot), FLASH_BLOCK_SIZE, src);
+    if (ret == 0) {
+        ret = mp_spiflash_write(&bdev->spiflash, ftl_tag_addr(slot), sizeof(tag), (const uint8_t*)&tag);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    bdev->seq = tag.seq;
+
+    uint16_t old = bdev->map[sector];
+    if (old != FTL_NONE) {
+        bdev->valid[old / FTL_SLOTS_PER_BLOCK] -= 1;
+    }
+    bdev->map[sector] = slot;
+    bdev->valid[bdev->cur_block] += 1;
+    return 0;
+}
+
+STATIC int ftl_write_sector(ftl_bdev_t *bdev, uint32_t sector, const uint8_t *src) {
+    return ftl_write_sector_internal(bdev, sector, src, false);
+}
+
+int32_t ftl_bdev_ioctl(ftl_bdev_t *bdev, uint32_t op, uint32_t arg) {
+    switch (op) {
+        case BDEV_IOCTL_INIT:
+            bdev->spiflash.config = (const mp_spiflash_config_t*)arg;
+            mp_spiflash_init(&bdev->spiflash);
+            ftl_mount(bdev);
+            bdev->flash_tick_counter_last_write = 0;
+            return 0;
+
+        case BDEV_IOCTL_NUM_BLOCKS:
+            return FTL_NUM_SECTORS(bdev->num_blocks);
+
+        case BDEV_IOCTL_IRQ_HANDLER:
+            // Reclaim a block at a time once writes have stopped, returning 1
+            // to be called again soon
+            if (bdev->free_blocks < FTL_GC_RESERVE + FTL_GC_TARGET
+                && HAL_GetTick() - bdev->flash_tick_counter_last_write >= 1000) {
+                if (ftl_gc(bdev) == 0) {
+                    return 1;
+                }
+            }
+            return 0;
+
+        case BDEV_IOCTL_SYNC:
+        case BDEV_IOCTL_SYNC_STEP:
+            // writes go straight to the flash
+            return 0;
+    }
+    return -MP_EINVAL;
+}
+
+int ftl_bdev_readblocks(ftl_bdev_t *bdev, uint8_t *dest, uint32_t block_num, uint32_t num_blocks) {
+    uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH); // prevent reclaiming and USB access
+    for (; num_blocks > 0; --num_blocks, ++block_num, dest += FLASH_BLOCK_SIZE) {
+        uint16_t slot = bdev->map[block_num];
+        if (slot == FTL_NONE) {
+            memset(dest, 0xff, FLASH_BLOCK_SIZE);
+        } else {
+            mp_spiflash_read(&bdev->spiflash, ftl_slot_addr(slot), FLASH_BLOCK_SIZE, dest);
+        }
+    }
+    restore_irq_pri(basepri);
+    return 0;
+}
+
+int ftl_bdev_writeblocks(ftl_bdev_t *bdev, const uint8_t *src, uint32_t block_num, uint32_t num_blocks) {
+    uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH); // prevent reclaiming and USB access
+    int ret = 0;
+    for (; num_blocks > 0 && ret == 0; --num_blocks, ++block_num, src += FLASH_BLOCK_SIZE) {
+        ret = ftl_write_sector_internal(bdev, block_num, src, true);
+    }
+    bdev->flash_tick_counter_last_write = HAL_GetTick();
+    restore_irq_pri(basepri);
+    return ret;
+}
+
+#endif
@@ -30,6 +30,7 @@
 #include "py/mpstate.h"
 #include "py/gc.h"
 #include "py/mpthread.h"
+#include "py/mphal.h"
 #include "lib/utils/gchelper.h"
 #include "gccollect.h"
 #include "systick.h"
@@ -39,6 +40,7 @@ void gc_collect(void) {
     #if 0
     uint32_t start = mp_hal_ticks_us();
     #endif
+    MP_HAL_CYCLES_START(cycles_start);
 
     // start the GC
     gc_collect_start();
@@ -57,6 +59,7 @@ void gc_collect(void) {
 
     // end the GC
     gc_collect_end();
+    MP_HAL_CYCLES_STOP(cycles_start, &mp_hal_cycles_gc_collect);
 
     #if 0
     // print GC info
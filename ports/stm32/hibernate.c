@@ -0,0 +1,283 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/gc.h"
+#include "py/mperrno.h"
+#include "lib/oofatfs/ff.h"
+#include "lib/mp-readline/readline.h"
+#include "lib/utils/interrupt_char.h"
+#include "lib/utils/pyexec.h"
+#include "extmod/vfs_fat.h"
+#include "genhdr/mpversion.h"
+#include "powerctrl.h"
+#include "storage.h"
+#include "hibernate.h"
+
+#if MICROPY_HW_ENABLE_HIBERNATE
+
+#if !MICROPY_HW_ENABLE_STORAGE
+#error MICROPY_HW_ENABLE_HIBERNATE needs the flash filesystem
+#endif
+
+// An image holds a header, the regions of the interpreter state listed
+// below, and for each GC area its descriptor, its mp_state_mem_area_t and
+// its tables and pool up to the last allocated block.  Pointers in all of
+// these are only valid for the same firmware with the same heap layout,
+// which the header identifies.
+
+#define HIBERNATE_MAGIC (0x48424e31) // "HBN1"
+
+#if MICROPY_GC_SPLIT_HEAP
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define NEXT_AREA(area) (NULL)
+#endif
+
+typedef struct _hibernate_header_t {
+    uint32_t magic;
+    const void *firmware_end;
+    char build[32];
+    uint32_t state_len;
+    uint32_t num_areas;
+    mp_obj_t resume;
+} hibernate_header_t;
+
+typedef struct _hibernate_area_t {
+    mp_state_mem_area_t *area;
+    byte *start;
+    size_t len;
+} hibernate_area_t;
+
+typedef struct _hibernate_region_t {
+    void *addr;
+    size_t len;
+} hibernate_region_t;
+
+#define REGION(x) { &(x), sizeof(x) }
+
+// The parts of the interpreter state that refer to the heap: the qstr pools,
+// sys.modules with the modules' globals, __main__, sys.path and sys.argv.
+// Port root pointers are left out, since they refer to peripherals that
+// are set up afresh at each boot.
+STATIC const hibernate_region_t hibernate_regions[] = {
+    REGION(MP_STATE_VM(last_pool)),
+    #if MICROPY_QSTR_INDEX
+    REGION(MP_STATE_VM(qstr_index)),
+    REGION(MP_STATE_VM(qstr_index_alloc)),
+    REGION(MP_STATE_VM(qstr_index_used)),
+    #endif
+    REGION(MP_STATE_VM(qstr_last_chunk)),
+    REGION(MP_STATE_VM(qstr_last_alloc)),
+    REGION(MP_STATE_VM(qstr_last_used)),
+    REGION(MP_STATE_VM(mp_loaded_modules_dict)),
+    REGION(MP_STATE_VM(dict_main)),
+    REGION(MP_STATE_VM(mp_sys_path_obj)),
+    REGION(MP_STATE_VM(mp_sys_argv_obj)),
+    #if MICROPY_CAN_OVERRIDE_BUILTINS
+    REGION(MP_STATE_VM(mp_module_builtins_override_dict)),
+    #endif
+};
+
+extern uint32_t _sidata[];
+
+STATIC void hibernate_make_header(hibernate_header_t *hdr, mp_obj_t resume) {
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = HIBERNATE_MAGIC;
+    hdr->firmware_end = _sidata;
+    strncpy(hdr->build, MICROPY_GIT_HASH " " MICROPY_BUILD_DATE, sizeof(hdr->build) - 1);
+    hdr->state_len = sizeof(mp_state_ctx_t);
+    hdr->num_areas = 0;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        hdr->num_areas += 1;
+    }
+    hdr->resume = resume;
+}
+
+// The tables of an area and its pool up to the last allocated block
+STATIC size_t hibernate_area_len(mp_state_mem_area_t *area) {
+    size_t n = area->gc_alloc_table_byte_len;
+    while (n > 0 && area->gc_alloc_table_start[n - 1] == 0) {
+        --n;
+    }
+    byte *end = area->gc_pool_start + n * 4 * MICROPY_BYTES_PER_GC_BLOCK; // 4 blocks per ATB byte
+    return MIN(end, area->gc_pool_end) - area->gc_alloc_table_start;
+}
+
+STATIC FRESULT hibernate_write(FIL *fp, const void *buf, size_t len) {
+    UINT n;
+    FRESULT res = f_write(fp, buf, len, &n);
+    if (res == FR_OK && n != len) {
+        res = FR_DENIED; // disk full
+    }
+    return res;
+}
+
+STATIC FRESULT hibernate_read(FIL *fp, void *buf, size_t len) {
+    UINT n;
+    FRESULT res = f_read(fp, buf, len, &n);
+    if (res == FR_OK && n != len) {
+        res = FR_INT_ERR; // truncated image
+    }
+    return res;
+}
+
+extern fs_user_mount_t fs_user_mount_flash;
+
+int hibernate_save(mp_obj_t resume) {
+    // leave only live objects on the heap, with no sweep pending
+    gc_collect();
+    gc_sweep_all();
+
+    FIL fp;
+    FRESULT res = f_open(&fs_user_mount_flash.fatfs, &fp, MICROPY_HW_HIBERNATE_FILE, FA_WRITE | FA_CREATE_ALWAYS);
+    if (res != FR_OK) {
+        return -fresult_to_errno_table[res];
+    }
+
+    // nothing may be allocated while the heap is written out
+    gc_lock();
+    hibernate_header_t hdr;
+    hibernate_make_header(&hdr, resume);
+    res = hibernate_write(&fp, &hdr, sizeof(hdr));
+    for (size_t i = 0; res == FR_OK && i < MP_ARRAY_SIZE(hibernate_regions); ++i) {
+        res = hibernate_write(&fp, hibernate_regions[i].addr, hibernate_regions[i].len);
+    }
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); res == FR_OK && area != NULL; area = NEXT_AREA(area)) {
+        hibernate_area_t desc = { area, area->gc_alloc_table_start, hibernate_area_len(area) };
+        res = hibernate_write(&fp, &desc, sizeof(desc));
+        if (res == FR_OK) {
+            res = hibernate_write(&fp, area, sizeof(*area));
+        }
+        if (res == FR_OK) {
+            res = hibernate_write(&fp, desc.start, desc.len);
+        }
+    }
+    gc_unlock();
+
+    FRESULT res_close = f_close(&fp);
+    if (res == FR_OK) {
+        res = res_close;
+    }
+    if (res != FR_OK) {
+        // don't leave a partial image to be resumed from
+        f_unlink(&fs_user_mount_flash.fatfs, MICROPY_HW_HIBERNATE_FILE);
+        return -fresult_to_errno_table[res];
+    }
+
+    // the image must survive a power-off straight after
+    storage_flush();
+    return 0;
+}
+
+void hibernate_discard(void) {
+    f_unlink(&fs_user_mount_flash.fatfs, MICROPY_HW_HIBERNATE_FILE);
+}
+
+mp_obj_t hibernate_restore(void) {
+    FIL fp;
+    if (f_open(&fs_user_mount_flash.fatfs, &fp, MICROPY_HW_HIBERNATE_FILE, FA_READ) != FR_OK) {
+        return MP_OBJ_NULL;
+    }
+
+    // check the image was made by this firmware before changing anything
+    hibernate_header_t hdr, expect;
+    hibernate_make_header(&expect, MP_OBJ_NULL);
+    if (hibernate_read(&fp, &hdr, sizeof(hdr)) != FR_OK) {
+        goto discard;
+    }
+    expect.resume = hdr.resume;
+    if (memcmp(&hdr, &expect, sizeof(hdr)) != 0) {
+        goto discard;
+    }
+
+    gc_lock();
+    bool changed = false;
+    FRESULT res = FR_OK;
+    for (size_t i = 0; res == FR_OK && i < MP_ARRAY_SIZE(hibernate_regions); ++i) {
+        res = hibernate_read(&fp, hibernate_regions[i].addr, hibernate_regions[i].len);
+        changed = true;
+    }
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); res == FR_OK && area != NULL; area = NEXT_AREA(area)) {
+        hibernate_area_t desc;
+        res = hibernate_read(&fp, &desc, sizeof(desc));
+        if (res == FR_OK && (desc.area != area || desc.start != area->gc_alloc_table_start
+            || desc.len > (size_t)(area->gc_pool_end - desc.start))) {
+            res = FR_INT_ERR;
+        }
+        if (res == FR_OK) {
+            res = hibernate_read(&fp, area, sizeof(*area));
+        }
+        if (res == FR_OK) {
+            res = hibernate_read(&fp, desc.start, desc.len);
+        }
+    }
+    gc_unlock();
+    f_close(&fp);
+
+    // an image is resumed from once
+    f_unlink(&fs_user_mount_flash.fatfs, MICROPY_HW_HIBERNATE_FILE);
+
+    if (res != FR_OK) {
+        if (changed) {
+            // the heap is in pieces, so start over without the image
+            storage_flush();
+            powerctrl_mcu_reset();
+        }
+        return MP_OBJ_NULL;
+    }
+    return hdr.resume;
+
+discard:
+    // made by other firmware, or unreadable
+    f_close(&fp);
+    f_unlink(&fs_user_mount_flash.fatfs, MICROPY_HW_HIBERNATE_FILE);
+    return MP_OBJ_NULL;
+}
+
+int hibernate_resume(mp_obj_t resume) {
+    // like running main.py, see pyexec.c
+    pyexec_system_exit = 0;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_hal_set_interrupt_char(CHAR_CTRL_C);
+        mp_call_function_0(resume);
+        mp_hal_set_interrupt_char(-1);
+        nlr_pop();
+        return 1;
+    } else {
+        mp_hal_set_interrupt_char(-1);
+        if (mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(((mp_obj_base_t*)nlr.ret_val)->type), MP_OBJ_FROM_PTR(&mp_type_SystemExit))) {
+            return pyexec_system_exit;
+        }
+        mp_obj_print_exception(&mp_plat_print, MP_OBJ_FROM_PTR(nlr.ret_val));
+        return 0;
+    }
+}
+
+#endif // MICROPY_HW_ENABLE_HIBERNATE
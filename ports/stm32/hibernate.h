@@ -0,0 +1,50 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_STM32_HIBERNATE_H
+#define MICROPY_INCLUDED_STM32_HIBERNATE_H
+
+#include "py/obj.h"
+
+// Save the heap and the interpreter state to the hibernation image on the
+// flash filesystem, to be resumed from at the next boot by calling resume.
+// Returns a negative errno value on failure.
+int hibernate_save(mp_obj_t resume);
+
+// Delete the hibernation image, if there is one.
+void hibernate_discard(void);
+
+// Replace the heap and the interpreter state with those from the hibernation
+// image, which is consumed, and return the callable to resume with.  Returns
+// MP_OBJ_NULL, with nothing changed, if there is no image or it was made by
+// different firmware.  Must be called at boot before any Python code runs;
+// everything on the heap that isn't part of the interpreter state, such as
+// the VFS mount table, is lost and must be set up again.
+mp_obj_t hibernate_restore(void);
+
+// Call resume as main.py would be run, returning as pyexec_file does.
+int hibernate_resume(mp_obj_t resume);
+
+#endif // MICROPY_INCLUDED_STM32_HIBERNATE_H
@@ -30,6 +30,9 @@
 
 #if MICROPY_HW_ENABLE_HW_I2C
 
+// Reads shorter than this are quicker to do by polling than to set up DMA for
+#define I2C_DMA_MIN_LEN (8)
+
 #if defined(STM32F4)
 
 STATIC uint16_t i2c_timeout_ms[MICROPY_HW_MAX_I2C];
@@ -267,6 +270,54 @@ int i2c_write(i2c_t *i2c, const uint8_t *src, size_t len, size_t next_len) {
     return num_acks;
 }
 
+#if MICROPY_HW_I2C_DMA
+
+STATIC const dma_descr_t *i2c_rx_dma_descr(i2c_t *i2c) {
+    switch (((uint32_t)i2c - I2C1_BASE) / (I2C2_BASE - I2C1_BASE)) {
+        case 0: return &dma_I2C_1_RX;
+        case 1: return &dma_I2C_2_RX;
+        #if defined(I2C3)
+        case 2: return &dma_I2C_3_RX;
+        #endif
+        default: return NULL;
+    }
+}
+
+// Read len (at least 3) bytes with the DMA, then send a STOP.  The I2C
+// peripheral NACKs the last byte itself because of CR2_LAST.
+STATIC int i2c_readfrom_dma(i2c_t *i2c, uint16_t addr, uint8_t *dest, size_t len) {
+    uint32_t i2c_id = ((uint32_t)i2c - I2C1_BASE) / (I2C2_BASE - I2C1_BASE);
+    const dma_descr_t *descr = i2c_rx_dma_descr(i2c);
+    DMA_HandleTypeDef rx_dma;
+    dma_init(&rx_dma, descr, DMA_PERIPH_TO_MEMORY, NULL);
+    HAL_DMA_Start(&rx_dma, (uint32_t)&i2c->DR, (uint32_t)dest, len);
+
+    // DMA requests must be enabled before ADDR is cleared by i2c_start_addr
+    i2c->CR2 |= I2C_CR2_DMAEN | I2C_CR2_LAST;
+    int ret = i2c_start_addr(i2c, 1, addr, len, true);
+    if (ret == 0) {
+        uint32_t t0 = HAL_GetTick();
+        while (__HAL_DMA_GET_COUNTER(&rx_dma) != 0) {
+            if (HAL_GetTick() - t0 >= i2c_timeout_ms[i2c_id]) {
+                i2c->CR1 &= ~I2C_CR1_PE;
+                ret = -MP_ETIMEDOUT;
+                break;
+            }
+        }
+        if (ret == 0) {
+            i2c->CR1 |= I2C_CR1_STOP;
+            ret = i2c_wait_stop(i2c);
+        }
+    }
+    i2c->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
+
+    HAL_DMA_Abort(&rx_dma);
+    dma_deinit(descr);
+    return ret;
+}
+
+#endif
+
 #elif defined(STM32F0) || defined(STM32F7)
 
 STATIC uint16_t i2c_timeout_ms[MICROPY_HW_MAX_I2C];
@@ -466,6 +517,11 @@ int i2c_write(i2c_t *i2c, const uint8_t *src, size_t len, size_t next_len) {
 #if defined(STM32F0) || defined(STM32F4) || defined(STM32F7)
 
 int i2c_readfrom(i2c_t *i2c, uint16_t addr, uint8_t *dest, size_t len, bool stop) {
+    #if MICROPY_HW_I2C_DMA && defined(STM32F4)
+    if (len >= I2C_DMA_MIN_LEN && stop) {
+        return i2c_readfrom_dma(i2c, addr, dest, len);
+    }
+    #endif
     int ret;
     if ((ret = i2c_start_addr(i2c, 1, addr, len, stop))) {
         return ret;
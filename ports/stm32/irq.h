@@ -122,6 +122,7 @@ MP_DECLARE_CONST_FUN_OBJ_0(pyb_irq_stats_obj);
 
 //#def  IRQ_PRI_SYSTICK         0
 #define IRQ_PRI_UART            1
+#define IRQ_PRI_EXTINT_CAPTURE  1
 #define IRQ_PRI_SDIO            1
 #define IRQ_PRI_DMA             1
 #define IRQ_PRI_FLASH           2
@@ -142,6 +143,11 @@ MP_DECLARE_CONST_FUN_OBJ_0(pyb_irq_stats_obj);
 // get dropped. The handling for each character only consumes about 0.5 usec
 #define IRQ_PRI_UART            NVIC_EncodePriority(NVIC_PRIORITYGROUP_4, 1, 0)
 
+// An ExtInt line capturing edge times (eg for a DHT read) is raised above the
+// other peripherals for the few ms it runs, so the times have little jitter.
+// Each edge only takes a timestamp.
+#define IRQ_PRI_EXTINT_CAPTURE  NVIC_EncodePriority(NVIC_PRIORITYGROUP_4, 2, 0)
+
 // SDIO must be higher priority than DMA for SDIO DMA transfers to work.
 #define IRQ_PRI_SDIO            NVIC_EncodePriority(NVIC_PRIORITYGROUP_4, 4, 0)
 
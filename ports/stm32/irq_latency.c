@@ -0,0 +1,156 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "pendsv.h"
+#include "irq_latency.h"
+
+#if MICROPY_HW_IRQ_LATENCY
+
+// Measures how long after a timer update event its IRQ handler, a PendSV
+// dispatch and a scheduled callback get to run.  The timer's counter at the
+// start of the handler gives the time since the event, from which the event
+// is placed on the DWT cycle counter.  Latencies are kept as histograms of
+// IRQ_LATENCY_BUCKETS power-of-2 microsecond buckets: bucket 0 is under 1us,
+// and bucket i is 2**(i-1) to 2**i - 1 us, with the last one open-ended.
+
+#define IRQ_LATENCY_BUCKETS (16)
+
+enum {
+    IRQ_LATENCY_IRQ,
+    IRQ_LATENCY_PENDSV,
+    IRQ_LATENCY_SCHED,
+    IRQ_LATENCY_NUM,
+};
+
+typedef struct _irq_latency_hist_t {
+    uint32_t count[IRQ_LATENCY_BUCKETS];
+    uint32_t max_cycles;
+} irq_latency_hist_t;
+
+STATIC struct {
+    volatile bool active;
+    volatile bool pendsv_pending;
+    volatile bool sched_pending;
+    uint32_t cycles_per_tick_q8;
+    uint32_t event_cycles;
+    irq_latency_hist_t hist[IRQ_LATENCY_NUM];
+} irq_latency;
+
+STATIC uint32_t irq_latency_cycles_to_us(uint32_t cycles) {
+    return cycles / (SystemCoreClock / 1000000);
+}
+
+STATIC void irq_latency_record(irq_latency_hist_t *hist, uint32_t cycles) {
+    uint32_t us = irq_latency_cycles_to_us(cycles);
+    size_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= IRQ_LATENCY_BUCKETS) {
+        bucket = IRQ_LATENCY_BUCKETS - 1;
+    }
+    hist->count[bucket] += 1;
+    if (cycles > hist->max_cycles) {
+        hist->max_cycles = cycles;
+    }
+}
+
+STATIC void irq_latency_pendsv(void) {
+    irq_latency_record(&irq_latency.hist[IRQ_LATENCY_PENDSV], DWT->CYCCNT - irq_latency.event_cycles);
+    irq_latency.pendsv_pending = false;
+}
+
+STATIC mp_obj_t irq_latency_sched(mp_obj_t arg) {
+    (void)arg;
+    irq_latency_record(&irq_latency.hist[IRQ_LATENCY_SCHED], DWT->CYCCNT - irq_latency.event_cycles);
+    irq_latency.sched_pending = false;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(irq_latency_sched_obj, irq_latency_sched);
+
+// cycles_per_tick_q8 is the CPU cycles per timer count, times 256
+void irq_latency_start(uint32_t cycles_per_tick_q8) {
+    irq_latency.active = false;
+    memset(irq_latency.hist, 0, sizeof(irq_latency.hist));
+    irq_latency.cycles_per_tick_q8 = cycles_per_tick_q8;
+    irq_latency.pendsv_pending = false;
+    irq_latency.sched_pending = false;
+    irq_latency.active = true;
+}
+
+void irq_latency_stop(void) {
+    irq_latency.active = false;
+}
+
+// Called at the start of the timer's IRQ handler, with its counter, for an
+// update event
+void irq_latency_timer_irq(uint32_t ticks) {
+    uint32_t now = DWT->CYCCNT;
+    if (!irq_latency.active) {
+        return;
+    }
+    uint32_t cycles = (uint64_t)ticks * irq_latency.cycles_per_tick_q8 >> 8;
+    irq_latency_record(&irq_latency.hist[IRQ_LATENCY_IRQ], cycles);
+
+    // the next event is only timed through PendSV and the scheduler once
+    // the last one has got through both
+    if (irq_latency.pendsv_pending || irq_latency.sched_pending) {
+        return;
+    }
+    irq_latency.event_cycles = now - cycles;
+    irq_latency.pendsv_pending = true;
+    irq_latency.sched_pending = true;
+    pendsv_schedule_dispatch(PENDSV_DISPATCH_IRQ_LATENCY, irq_latency_pendsv);
+    if (!mp_sched_schedule(MP_OBJ_FROM_PTR(&irq_latency_sched_obj), mp_const_none)) {
+        irq_latency.sched_pending = false;
+    }
+}
+
+// Returns a tuple of (histogram, max_us) for the IRQ handler, PendSV and
+// scheduler latencies
+mp_obj_t irq_latency_results(void) {
+    irq_latency_hist_t hist[IRQ_LATENCY_NUM];
+    uint32_t irq_state = disable_irq();
+    memcpy(hist, irq_latency.hist, sizeof(hist));
+    enable_irq(irq_state);
+
+    mp_obj_t items[IRQ_LATENCY_NUM];
+    for (size_t i = 0; i < IRQ_LATENCY_NUM; ++i) {
+        mp_obj_t counts[IRQ_LATENCY_BUCKETS];
+        for (size_t j = 0; j < IRQ_LATENCY_BUCKETS; ++j) {
+            counts[j] = mp_obj_new_int_from_uint(hist[i].count[j]);
+        }
+        mp_obj_t t[2] = {
+            mp_obj_new_list(IRQ_LATENCY_BUCKETS, counts),
+            mp_obj_new_int_from_uint(irq_latency_cycles_to_us(hist[i].max_cycles)),
+        };
+        items[i] = mp_obj_new_tuple(2, t);
+    }
+    return mp_obj_new_tuple(IRQ_LATENCY_NUM, items);
+}
+
+#endif // MICROPY_HW_IRQ_LATENCY
@@ -0,0 +1,610 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "irq.h"
+#include "pin.h"
+#include "dma.h"
+#include "systick.h"
+#include "jacdac.h"
+
+#if MICROPY_HW_ENABLE_JACDAC
+
+#if !MICROPY_HW_UART_DMA
+#error "MICROPY_HW_ENABLE_JACDAC requires MICROPY_HW_UART_DMA"
+#endif
+
+/// \moduleref pyb
+/// \class Jacdac - frames on the single-wire Jacdac bus
+///
+/// The bus is UART1's TX pin, open-drain and half-duplex at 1Mbaud.  Each
+/// frame is sent between two breaks which the UART sees as framing errors,
+/// with a gap after the first for receivers to get ready.  Frames are
+/// received and sent by DMA, checked and queued in the UART IRQ, so
+/// Python only sees whole frames:
+///
+///     jd = pyb.Jacdac()
+///     jd.write(frame)     # queued, sent when the bus is free
+///     frame = jd.read()   # the next good frame, or None
+///
+/// A frame is a little-endian CRC-16, a size byte, a flags byte, the 8-byte
+/// device id and then size bytes of data.  The size and CRC of a written
+/// frame are filled in here.
+
+#define JD_UART_ID (PYB_UART_1)
+#define JD_UART_UNIT (1)
+#define JD_UART_IRQn (USART1_IRQn)
+#define JD_UART_PIN (MICROPY_HW_UART1_TX)
+#define JD_BAUDRATE (1000000)
+
+#define JD_FRAME_HEADER (12)
+#define JD_FRAME_MAX (JD_FRAME_HEADER + 240)
+
+// time between the end of the start break and the first byte of a frame
+#define JD_GAP_US (50)
+
+// a frame that has been started but not ended in this long is abandoned,
+// so that sending can go ahead; the longest frame takes about 2.5ms
+#define JD_BUSY_TIMEOUT_MS (4)
+
+// rings have a free slot to tell full from empty
+#define JD_QUEUE_SLOTS (MICROPY_HW_JACDAC_QUEUE + 1)
+
+enum {
+    JD_STATE_OFF,
+    JD_STATE_RX,   // listening, and sending when the bus is free
+    JD_STATE_TX,   // the DMA is sending the frame at tx_tail
+};
+
+typedef struct _pyb_jacdac_obj_t {
+    mp_obj_base_t base;
+    pyb_uart_obj_t *uart;
+    uint16_t timeout; // ms that read and write wait
+    volatile uint8_t state;
+    // a start break has been seen and its frame hasn't ended yet
+    bool rx_busy;
+    // a frame has just ended, so the next break is its end break
+    bool rx_ended;
+    // a noise or overrun error spoilt the frame being received
+    bool rx_error;
+    uint32_t rx_busy_tick;
+    // the IRQ moves rx_head and tx_tail, Python moves rx_tail and tx_head
+    volatile uint8_t rx_head;
+    volatile uint8_t rx_tail;
+    volatile uint8_t tx_head;
+    volatile uint8_t tx_tail;
+    uint32_t n_received;
+    uint32_t n_bad;
+    uint32_t n_dropped;
+    uint32_t n_sent;
+    #if MICROPY_PY_USELECT_NOTIFY
+    struct _poll_obj_t *poll_notify;
+    #endif
+    DMA_HandleTypeDef rx_dma;
+    DMA_HandleTypeDef tx_dma;
+    uint8_t rx_frame[JD_FRAME_MAX]; // the DMA receives into this
+    uint8_t rxq[JD_QUEUE_SLOTS][JD_FRAME_MAX];
+    uint8_t txq[JD_QUEUE_SLOTS][JD_FRAME_MAX];
+} pyb_jacdac_obj_t;
+
+STATIC uint16_t jd_crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xffff;
+    while (len--) {
+        uint8_t x = (crc >> 8) ^ *data++;
+        x ^= x >> 4;
+        crc = (crc << 8) ^ (x << 12) ^ (x << 5) ^ x;
+    }
+    return crc;
+}
+
+STATIC size_t jd_frame_len(const uint8_t *frame) {
+    return JD_FRAME_HEADER + frame[2];
+}
+
+/******************************************************************************/
+// Bus state machine, run from the UART IRQ
+
+STATIC uint32_t jd_rx_count(pyb_jacdac_obj_t *self) {
+    return JD_FRAME_MAX - __HAL_DMA_GET_COUNTER(&self->rx_dma);
+}
+
+STATIC void jd_rx_restart(pyb_jacdac_obj_t *self) {
+    // the DMA is circular, so it's still running and the abort is needed to
+    // move it back to the start of rx_frame
+    HAL_DMA_Abort(&self->rx_dma);
+    HAL_DMA_Start(&self->rx_dma, (uint32_t)&self->uart->uartx->DR, (uint32_t)self->rx_frame, JD_FRAME_MAX);
+    self->uart->uartx->CR3 |= USART_CR3_DMAR;
+}
+
+// Stop the DMA requests and return how many bytes the DMA has taken.  The
+// SR read that went before this and the DR read here clear the error and
+// idle flags.
+STATIC uint32_t jd_rx_halt(pyb_jacdac_obj_t *self, bool *taken) {
+    USART_TypeDef *uartx = self->uart->uartx;
+    uartx->CR3 &= ~USART_CR3_DMAR;
+    uint32_t n = jd_rx_count(self);
+    *taken = !(uartx->SR & USART_SR_RXNE);
+    (void)uartx->DR;
+    return n;
+}
+
+STATIC void jd_rx_frame(pyb_jacdac_obj_t *self, uint32_t n) {
+    bool error = self->rx_error;
+    self->rx_error = false;
+    if (n == 0) {
+        return;
+    }
+    const uint8_t *f = self->rx_frame;
+    size_t len = jd_frame_len(f);
+    if (error || n < JD_FRAME_HEADER || len > n || len > JD_FRAME_MAX
+        || (f[0] | f[1] << 8) != jd_crc16(f + 2, len - 2)) {
+        self->n_bad += 1;
+        return;
+    }
+    uint8_t next = (self->rx_head + 1) % JD_QUEUE_SLOTS;
+    if (next == self->rx_tail) {
+        self->n_dropped += 1;
+        return;
+    }
+    memcpy(self->rxq[self->rx_head], f, len);
+    self->rx_head = next;
+    self->n_received += 1;
+    #if MICROPY_PY_USELECT_NOTIFY
+    if (self->poll_notify != NULL) {
+        mp_poll_notify(self->poll_notify, MP_STREAM_POLL_RD);
+    }
+    #endif
+}
+
+// Send a break: 10 bit times low, which receivers see as a framing error.
+STATIC void jd_tx_break(pyb_jacdac_obj_t *self) {
+    USART_TypeDef *uartx = self->uart->uartx;
+    uartx->CR1 |= USART_CR1_SBK;
+    // cleared by hardware during the stop bit of the break
+    while (uartx->CR1 & USART_CR1_SBK) {
+    }
+}
+
+STATIC void jd_tx_start(pyb_jacdac_obj_t *self) {
+    USART_TypeDef *uartx = self->uart->uartx;
+    if (self->tx_head == self->tx_tail || self->rx_busy || jd_rx_count(self) != 0
+        || !mp_hal_pin_read(JD_UART_PIN)) {
+        // nothing to send, or the bus isn't free
+        return;
+    }
+
+    // stop listening, so as not to receive the frame being sent
+    uartx->CR3 &= ~USART_CR3_DMAR;
+    HAL_DMA_Abort(&self->rx_dma);
+    uartx->CR1 &= ~USART_CR1_RE;
+    self->state = JD_STATE_TX;
+
+    // this busy-waits for about 60us, but receivers need the gap to set up
+    // for the frame and other IRQs of higher priority still run
+    jd_tx_break(self);
+    mp_hal_delay_us(JD_GAP_US);
+
+    const uint8_t *f = self->txq[self->tx_tail];
+    HAL_DMA_Start(&self->tx_dma, (uint32_t)f, (uint32_t)&uartx->DR, jd_frame_len(f));
+    uartx->SR = ~USART_SR_TC;
+    uartx->CR3 |= USART_CR3_DMAT;
+    uartx->CR1 |= USART_CR1_TCIE;
+}
+
+STATIC void jd_tx_done(pyb_jacdac_obj_t *self) {
+    USART_TypeDef *uartx = self->uart->uartx;
+    uartx->CR1 &= ~USART_CR1_TCIE;
+    uartx->CR3 &= ~USART_CR3_DMAT;
+    HAL_DMA_Abort(&self->tx_dma);
+    jd_tx_break(self);
+
+    self->tx_tail = (self->tx_tail + 1) % JD_QUEUE_SLOTS;
+    self->n_sent += 1;
+
+    // listen again
+    (void)uartx->SR;
+    (void)uartx->DR;
+    self->rx_busy = false;
+    self->rx_ended = false;
+    self->rx_error = false;
+    uartx->CR1 |= USART_CR1_RE;
+    jd_rx_restart(self);
+    self->state = JD_STATE_RX;
+}
+
+bool jacdac_uart_irq(pyb_uart_obj_t *uart) {
+    pyb_jacdac_obj_t *self = MP_STATE_PORT(pyb_jacdac_obj);
+    if (self == NULL || self->uart != uart || self->state == JD_STATE_OFF) {
+        return false;
+    }
+    USART_TypeDef *uartx = uart->uartx;
+    uint32_t sr = uartx->SR;
+
+    if (self->state == JD_STATE_TX) {
+        if ((uartx->CR1 & USART_CR1_TCIE) && (sr & USART_SR_TC)) {
+            jd_tx_done(self);
+        } else {
+            return true;
+        }
+    } else if (sr & USART_SR_FE) {
+        // a break, which starts or ends a frame; it may have been taken by
+        // the DMA as a 0 byte, which isn't part of the frame
+        bool taken;
+        uint32_t n = jd_rx_halt(self, &taken);
+        if (taken && n > 0) {
+            n -= 1;
+        }
+        if (n > 0) {
+            // no idle line after the data, so it ends here
+            jd_rx_frame(self, n);
+            self->rx_ended = true;
+        }
+        if (self->rx_ended) {
+            self->rx_busy = false;
+            self->rx_ended = false;
+        } else {
+            self->rx_busy = true;
+            self->rx_busy_tick = HAL_GetTick();
+        }
+        jd_rx_restart(self);
+    } else if (sr & (USART_SR_NE | USART_SR_ORE)) {
+        // the DR read to clear these may lose a byte, and the frame is
+        // spoilt anyway, so just let it fail when it ends
+        (void)uartx->DR;
+        self->rx_error = true;
+    } else if (sr & USART_SR_IDLE) {
+        if (jd_rx_count(self) > 0) {
+            bool taken;
+            uint32_t n = jd_rx_halt(self, &taken);
+            jd_rx_frame(self, n);
+            self->rx_ended = true;
+            self->rx_busy = false;
+            jd_rx_restart(self);
+        } else {
+            // the gap after a break
+            (void)uartx->DR;
+        }
+    }
+
+    if (self->rx_busy && HAL_GetTick() - self->rx_busy_tick >= JD_BUSY_TIMEOUT_MS) {
+        self->rx_busy = false;
+    }
+    if (self->state == JD_STATE_RX) {
+        jd_tx_start(self);
+    }
+    return true;
+}
+
+// Runs every few ms to send queued frames once the bus has gone quiet, by
+// making the UART IRQ run.
+STATIC void jd_systick(uint32_t tick) {
+    pyb_jacdac_obj_t *self = MP_STATE_PORT(pyb_jacdac_obj);
+    if (self != NULL && self->state == JD_STATE_RX && self->tx_head != self->tx_tail) {
+        NVIC_SetPendingIRQ(JD_UART_IRQn);
+    }
+}
+
+/******************************************************************************/
+// Setup
+
+STATIC void jd_deinit_obj(pyb_jacdac_obj_t *self) {
+    if (self->state == JD_STATE_OFF) {
+        return;
+    }
+    USART_TypeDef *uartx = self->uart->uartx;
+    uint32_t irq_state = disable_irq();
+    self->state = JD_STATE_OFF;
+    uartx->CR1 &= ~(USART_CR1_TCIE | USART_CR1_IDLEIE);
+    uartx->CR3 &= ~(USART_CR3_EIE | USART_CR3_DMAR | USART_CR3_DMAT);
+    enable_irq(irq_state);
+    HAL_DMA_Abort(&self->rx_dma);
+    HAL_DMA_Abort(&self->tx_dma);
+    dma_deinit(&dma_USART_1_RX);
+    dma_deinit(&dma_USART_1_TX);
+    uart_deinit(self->uart);
+    systick_disable_dispatch(SYSTICK_DISPATCH_JACDAC);
+}
+
+STATIC void jd_init(pyb_jacdac_obj_t *self) {
+    jd_deinit_obj(self);
+
+    // the bus is the TX pin, open-drain and pulled up
+    if (!uart_init(self->uart, JD_BAUDRATE, UART_WORDLENGTH_8B, UART_PARITY_NONE, UART_STOPBITS_1, UART_HWCONTROL_NONE)) {
+        mp_raise_msg(&mp_type_OSError, "Jacdac UART init failed");
+    }
+    mp_hal_pin_config_alt(JD_UART_PIN, MP_HAL_PIN_MODE_ALT_OPEN_DRAIN, MP_HAL_PIN_PULL_UP, AF_FN_UART, JD_UART_UNIT);
+    USART_TypeDef *uartx = self->uart->uartx;
+    uartx->CR1 &= ~USART_CR1_UE;
+    uartx->CR3 |= USART_CR3_HDSEL;
+    uartx->CR1 |= USART_CR1_UE;
+
+    self->rx_head = self->rx_tail = 0;
+    self->tx_head = self->tx_tail = 0;
+    self->rx_busy = false;
+    self->rx_ended = false;
+    self->rx_error = false;
+
+    // no DMA IRQs are used: the UART's error, idle and TC IRQs say when a
+    // frame has been received or sent
+    dma_init(&self->rx_dma, &dma_USART_1_RX, DMA_PERIPH_TO_MEMORY, self);
+    dma_init(&self->tx_dma, &dma_USART_1_TX, DMA_MEMORY_TO_PERIPH, self);
+    (void)uartx->SR;
+    (void)uartx->DR;
+    self->state = JD_STATE_RX;
+    jd_rx_restart(self);
+    uartx->CR3 |= USART_CR3_EIE;
+    uartx->CR1 |= USART_CR1_IDLEIE;
+    systick_enable_dispatch(SYSTICK_DISPATCH_JACDAC, jd_systick);
+}
+
+void jacdac_deinit(void) {
+    if (MP_STATE_PORT(pyb_jacdac_obj) != NULL) {
+        jd_deinit_obj(MP_STATE_PORT(pyb_jacdac_obj));
+        MP_STATE_PORT(pyb_jacdac_obj) = NULL;
+    }
+}
+
+STATIC void jd_check_init(pyb_jacdac_obj_t *self) {
+    if (self->state == JD_STATE_OFF) {
+        mp_raise_msg(&mp_type_OSError, "Jacdac not initialised");
+    }
+}
+
+// Wait up to the timeout for a received frame; returns false if there's none.
+STATIC bool jd_wait_rx(pyb_jacdac_obj_t *self) {
+    uint32_t start = mp_hal_ticks_ms();
+    while (self->rx_head == self->rx_tail) {
+        if (mp_hal_ticks_ms() - start >= self->timeout) {
+            return false;
+        }
+        MICROPY_EVENT_POLL_HOOK
+    }
+    return true;
+}
+
+// Take the next received frame into buf, which is cut short if it's too small.
+STATIC size_t jd_take_rx(pyb_jacdac_obj_t *self, uint8_t *buf, size_t size) {
+    const uint8_t *f = self->rxq[self->rx_tail];
+    size_t len = MIN(jd_frame_len(f), size);
+    memcpy(buf, f, len);
+    self->rx_tail = (self->rx_tail + 1) % JD_QUEUE_SLOTS;
+    return len;
+}
+
+STATIC mp_uint_t jd_stream_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
+    pyb_jacdac_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    jd_check_init(self);
+    if (!jd_wait_rx(self)) {
+        *errcode = MP_EAGAIN;
+        return MP_STREAM_ERROR;
+    }
+    return jd_take_rx(self, buf, size);
+}
+
+STATIC mp_uint_t jd_stream_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
+    pyb_jacdac_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    jd_check_init(self);
+    if (size < JD_FRAME_HEADER || size > JD_FRAME_MAX) {
+        mp_raise_ValueError("frame must be 12 to 252 bytes");
+    }
+    uint8_t next = (self->tx_head + 1) % JD_QUEUE_SLOTS;
+    uint32_t start = mp_hal_ticks_ms();
+    while (next == self->tx_tail) {
+        if (mp_hal_ticks_ms() - start >= self->timeout) {
+            *errcode = MP_EAGAIN;
+            return MP_STREAM_ERROR;
+        }
+        MICROPY_EVENT_POLL_HOOK
+    }
+    uint8_t *f = self->txq[self->tx_head];
+    memcpy(f, buf, size);
+    f[2] = size - JD_FRAME_HEADER;
+    uint16_t crc = jd_crc16(f + 2, size - 2);
+    f[0] = crc;
+    f[1] = crc >> 8;
+    self->tx_head = next;
+    // send it now if the bus is free
+    NVIC_SetPendingIRQ(JD_UART_IRQn);
+    return size;
+}
+
+STATIC mp_uint_t jd_stream_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    pyb_jacdac_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_uint_t ret;
+    if (request == MP_STREAM_POLL) {
+        uintptr_t flags = arg;
+        ret = 0;
+        if ((flags & MP_STREAM_POLL_RD) && self->rx_head != self->rx_tail) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+        if ((flags & MP_STREAM_POLL_WR) && (self->tx_head + 1) % JD_QUEUE_SLOTS != self->tx_tail) {
+            ret |= MP_STREAM_POLL_WR;
+        }
+    #if MICROPY_PY_USELECT_NOTIFY
+    } else if (request == MP_STREAM_POLL_NOTIFY) {
+        // only RX is notified, so TX room must still be polled
+        if (arg != 0 && self->poll_notify != NULL) {
+            *errcode = MP_EBUSY;
+            return MP_STREAM_ERROR;
+        }
+        self->poll_notify = (struct _poll_obj_t*)arg;
+        ret = MP_STREAM_POLL_RD;
+    #endif
+    } else {
+        *errcode = MP_EINVAL;
+        ret = MP_STREAM_ERROR;
+    }
+    return ret;
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC void pyb_jacdac_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    pyb_jacdac_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->state == JD_STATE_OFF) {
+        mp_print_str(print, "Jacdac()");
+    } else {
+        mp_printf(print, "Jacdac(timeout=%u)", self->timeout);
+    }
+}
+
+STATIC void pyb_jacdac_init_helper(pyb_jacdac_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    self->timeout = args[0].u_int;
+    jd_init(self);
+}
+
+/// \classmethod \constructor(*, timeout=0)
+/// There is one bus; this starts listening on it and returns it.
+STATIC mp_obj_t pyb_jacdac_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 0, true);
+    pyb_jacdac_obj_t *self = MP_STATE_PORT(pyb_jacdac_obj);
+    if (self == NULL) {
+        self = m_new0(pyb_jacdac_obj_t, 1);
+        self->base.type = &pyb_jacdac_type;
+        // share the UART object, so that uart_irq_handler can find it
+        self->uart = MP_STATE_PORT(pyb_uart_obj_all)[JD_UART_ID - 1];
+        if (self->uart == NULL) {
+            self->uart = m_new0(pyb_uart_obj_t, 1);
+            self->uart->base.type = &pyb_uart_type;
+            self->uart->uart_id = JD_UART_ID;
+            MP_STATE_PORT(pyb_uart_obj_all)[JD_UART_ID - 1] = self->uart;
+        }
+        MP_STATE_PORT(pyb_jacdac_obj) = self;
+    }
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, args + n_args);
+    pyb_jacdac_init_helper(self, n_args, args, &kw_args);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+/// \method init(*, timeout=0)
+/// Restart the bus, dropping any queued frames.
+STATIC mp_obj_t pyb_jacdac_init(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    pyb_jacdac_init_helper(MP_OBJ_TO_PTR(args[0]), n_args - 1, args + 1, kw_args);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_jacdac_init_obj, 1, pyb_jacdac_init);
+
+/// \method deinit()
+/// Stop using the bus and turn off UART1.
+STATIC mp_obj_t pyb_jacdac_deinit(mp_obj_t self_in) {
+    jd_deinit_obj(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_jacdac_deinit_obj, pyb_jacdac_deinit);
+
+/// \method any()
+/// Return the number of received frames waiting to be read.
+STATIC mp_obj_t pyb_jacdac_any(mp_obj_t self_in) {
+    pyb_jacdac_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return MP_OBJ_NEW_SMALL_INT((self->rx_head + JD_QUEUE_SLOTS - self->rx_tail) % JD_QUEUE_SLOTS);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_jacdac_any_obj, pyb_jacdac_any);
+
+/// \method read()
+/// Return the next received frame as bytes, or None if none came within
+/// the timeout.
+STATIC mp_obj_t pyb_jacdac_read(mp_obj_t self_in) {
+    pyb_jacdac_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    jd_check_init(self);
+    if (!jd_wait_rx(self)) {
+        return mp_const_none;
+    }
+    vstr_t vstr;
+    vstr_init_len(&vstr, jd_frame_len(self->rxq[self->rx_tail]));
+    jd_take_rx(self, (uint8_t*)vstr.buf, vstr.len);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_jacdac_read_obj, pyb_jacdac_read);
+
+/// \method readinto(buf)
+/// Read the next received frame into buf and return its length, or None if
+/// none came within the timeout.  A frame longer than buf is cut short.
+STATIC mp_obj_t pyb_jacdac_readinto(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    int errcode;
+    mp_uint_t len = jd_stream_read(self_in, bufinfo.buf, bufinfo.len, &errcode);
+    if (len == MP_STREAM_ERROR) {
+        return mp_const_none;
+    }
+    return MP_OBJ_NEW_SMALL_INT(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_jacdac_readinto_obj, pyb_jacdac_readinto);
+
+/// \method stats()
+/// Return a tuple (received, bad, dropped, sent) of frame counts.
+STATIC mp_obj_t pyb_jacdac_stats(mp_obj_t self_in) {
+    pyb_jacdac_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t tuple[4] = {
+        mp_obj_new_int_from_uint(self->n_received),
+        mp_obj_new_int_from_uint(self->n_bad),
+        mp_obj_new_int_from_uint(self->n_dropped),
+        mp_obj_new_int_from_uint(self->n_sent),
+    };
+    return mp_obj_new_tuple(4, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_jacdac_stats_obj, pyb_jacdac_stats);
+
+STATIC const mp_rom_map_elem_t pyb_jacdac_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&pyb_jacdac_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&pyb_jacdac_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&pyb_jacdac_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&pyb_jacdac_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&pyb_jacdac_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&pyb_jacdac_stats_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(pyb_jacdac_locals_dict, pyb_jacdac_locals_dict_table);
+
+STATIC const mp_stream_p_t jacdac_stream_p = {
+    .read = jd_stream_read,
+    .write = jd_stream_write,
+    .ioctl = jd_stream_ioctl,
+    .is_text = false,
+};
+
+const mp_obj_type_t pyb_jacdac_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Jacdac,
+    .print = pyb_jacdac_print,
+    .make_new = pyb_jacdac_make_new,
+    .protocol = &jacdac_stream_p,
+    .locals_dict = (mp_obj_dict_t*)&pyb_jacdac_locals_dict,
+};
+
+#endif // MICROPY_HW_ENABLE_JACDAC
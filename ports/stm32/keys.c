@@ -0,0 +1,271 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "pin.h"
+#include "systick.h"
+#include "keys.h"
+
+#if MICROPY_HW_ENABLE_KEYS
+
+/// \moduleref pyb
+/// \class Keys - debounced scanning of the board's buttons
+///
+/// The buttons are sampled from the systick interrupt every few ms.  Each
+/// change that stays put for the debounce time becomes a press or release
+/// event, stamped with the ms tick it was first seen at and put in a ring,
+/// so no presses are lost however long the script takes between looks:
+///
+///     keys = pyb.Keys()
+///     for key, pressed, t in keys.events():
+///         if key == keys.A and pressed:
+///             jump()
+///     if keys.state() & (1 << keys.LEFT):
+///         walk_left()
+
+#define KEYS_EVENT_LEN (32)
+
+#define KEYS_DEBOUNCE_DEFAULT_MS (10)
+
+// the systick dispatch slot comes round this often
+#define KEYS_PERIOD_MS (SYSTICK_DISPATCH_NUM_SLOTS)
+
+typedef struct _keys_event_t {
+    uint32_t tick;
+    uint8_t key;
+    bool pressed;
+} keys_event_t;
+
+typedef struct _pyb_keys_obj_t {
+    mp_obj_base_t base;
+} pyb_keys_obj_t;
+
+STATIC const pin_obj_t *const keys_pin[] = MICROPY_HW_KEY_PINS;
+#define KEYS_NUM MP_ARRAY_SIZE(keys_pin)
+
+// Scanner state, only changed by keys_systick once it's running.  The IRQ
+// moves event_head and Python moves event_tail.
+STATIC struct {
+    uint8_t scans; // scans a change must last to be taken
+    uint16_t state; // debounced, bit set for each key that's down
+    uint8_t count[KEYS_NUM]; // scans each key has differed from state
+    uint32_t change_tick[KEYS_NUM]; // tick each differing key first changed
+    volatile uint8_t event_head;
+    volatile uint8_t event_tail;
+    uint32_t lost; // events dropped because the ring was full
+    keys_event_t event[KEYS_EVENT_LEN];
+} keys;
+
+STATIC const pyb_keys_obj_t pyb_keys_obj = {{&pyb_keys_type}};
+
+STATIC uint16_t keys_read(void) {
+    uint16_t down = 0;
+    for (size_t i = 0; i < KEYS_NUM; ++i) {
+        if (mp_hal_pin_read(keys_pin[i]) == MICROPY_HW_KEY_PRESSED) {
+            down |= 1 << i;
+        }
+    }
+    return down;
+}
+
+STATIC void keys_systick(uint32_t tick) {
+    uint16_t changed = keys_read() ^ keys.state;
+    for (size_t i = 0; i < KEYS_NUM; ++i) {
+        if (!(changed & (1 << i))) {
+            // a bounce that went back, or no change
+            keys.count[i] = 0;
+            continue;
+        }
+        if (keys.count[i]++ == 0) {
+            keys.change_tick[i] = tick;
+        }
+        if (keys.count[i] < keys.scans) {
+            continue;
+        }
+        keys.count[i] = 0;
+        keys.state ^= 1 << i;
+        uint8_t next = (keys.event_head + 1) % KEYS_EVENT_LEN;
+        if (next == keys.event_tail) {
+            keys.lost += 1;
+            continue;
+        }
+        keys_event_t *e = &keys.event[keys.event_head];
+        e->tick = keys.change_tick[i];
+        e->key = i;
+        e->pressed = (keys.state >> i) & 1;
+        keys.event_head = next;
+    }
+}
+
+STATIC void keys_init(mp_int_t debounce_ms) {
+    systick_disable_dispatch(SYSTICK_DISPATCH_KEYS);
+    for (size_t i = 0; i < KEYS_NUM; ++i) {
+        mp_hal_pin_config(keys_pin[i], MP_HAL_PIN_MODE_INPUT, MICROPY_HW_KEY_PULL, 0);
+        keys.count[i] = 0;
+    }
+    mp_int_t scans = (debounce_ms + KEYS_PERIOD_MS - 1) / KEYS_PERIOD_MS;
+    keys.scans = MAX(1, MIN(scans, 255));
+    // keys already held down don't make events
+    keys.state = keys_read();
+    keys.event_head = keys.event_tail = 0;
+    keys.lost = 0;
+    systick_enable_dispatch(SYSTICK_DISPATCH_KEYS, keys_systick);
+}
+
+void keys_deinit(void) {
+    systick_disable_dispatch(SYSTICK_DISPATCH_KEYS);
+}
+
+// Start scanning with the default debounce, unless already scanning.
+void keys_start(void) {
+    if (systick_dispatch_table[SYSTICK_DISPATCH_KEYS] == NULL) {
+        keys_init(KEYS_DEBOUNCE_DEFAULT_MS);
+    }
+}
+
+#if MICROPY_HW_USB_HID_GAMEPAD
+#ifdef MICROPY_HW_KEY_DPAD
+STATIC const uint8_t keys_dpad[4] = MICROPY_HW_KEY_DPAD;
+
+STATIC int8_t keys_axis(uint16_t state, uint8_t neg, uint8_t pos) {
+    return ((state >> pos) & 1) * 127 - ((state >> neg) & 1) * 127;
+}
+#endif
+
+// Fill in a USB HID gamepad report: 16 button bits, then the X and Y axes.
+// Called from the USB IRQ, so it only reads the debounced state.
+void keys_gamepad_report(uint8_t *report) {
+    uint16_t state = keys.state;
+    report[0] = state;
+    report[1] = state >> 8;
+    #ifdef MICROPY_HW_KEY_DPAD
+    report[2] = keys_axis(state, keys_dpad[2], keys_dpad[3]);
+    report[3] = keys_axis(state, keys_dpad[0], keys_dpad[1]);
+    #else
+    report[2] = 0;
+    report[3] = 0;
+    #endif
+}
+#endif
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC void pyb_keys_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    mp_printf(print, "Keys(debounce=%u)", keys.scans * KEYS_PERIOD_MS);
+}
+
+STATIC mp_obj_t pyb_keys_init_helper(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_debounce, MP_ARG_INT, {.u_int = KEYS_DEBOUNCE_DEFAULT_MS} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    keys_init(args[0].u_int);
+    return mp_const_none;
+}
+
+/// \classmethod \constructor(debounce=10)
+/// Start scanning the buttons, taking a change once it has lasted
+/// `debounce` ms, and return the Keys object.
+STATIC mp_obj_t pyb_keys_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, true);
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, args + n_args);
+    pyb_keys_init_helper(n_args, args, &kw_args);
+    return MP_OBJ_FROM_PTR(&pyb_keys_obj);
+}
+
+/// \method init(debounce=10)
+/// Restart scanning, dropping any events not read yet.
+STATIC mp_obj_t pyb_keys_init(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    return pyb_keys_init_helper(n_args - 1, args + 1, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_keys_init_obj, 1, pyb_keys_init);
+
+/// \method deinit()
+/// Stop scanning.
+STATIC mp_obj_t pyb_keys_deinit(mp_obj_t self_in) {
+    keys_deinit();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_keys_deinit_obj, pyb_keys_deinit);
+
+/// \method state()
+/// Return the debounced keys that are down, as a bit for each key.
+STATIC mp_obj_t pyb_keys_state(mp_obj_t self_in) {
+    return MP_OBJ_NEW_SMALL_INT(keys.state);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_keys_state_obj, pyb_keys_state);
+
+/// \method events()
+/// Take the events since the last call, oldest first, as a list of
+/// (key, pressed, ticks_ms) tuples.
+STATIC mp_obj_t pyb_keys_events(mp_obj_t self_in) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    while (keys.event_tail != keys.event_head) {
+        const keys_event_t *e = &keys.event[keys.event_tail];
+        mp_obj_t tuple[3] = {
+            MP_OBJ_NEW_SMALL_INT(e->key),
+            mp_obj_new_bool(e->pressed),
+            MP_OBJ_NEW_SMALL_INT(e->tick & (MICROPY_PY_UTIME_TICKS_PERIOD - 1)),
+        };
+        keys.event_tail = (keys.event_tail + 1) % KEYS_EVENT_LEN;
+        mp_obj_list_append(list, mp_obj_new_tuple(3, tuple));
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_keys_events_obj, pyb_keys_events);
+
+/// \method lost()
+/// Return the number of events dropped because the ring was full.
+STATIC mp_obj_t pyb_keys_lost(mp_obj_t self_in) {
+    return mp_obj_new_int_from_uint(keys.lost);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_keys_lost_obj, pyb_keys_lost);
+
+STATIC const mp_rom_map_elem_t pyb_keys_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&pyb_keys_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&pyb_keys_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_state), MP_ROM_PTR(&pyb_keys_state_obj) },
+    { MP_ROM_QSTR(MP_QSTR_events), MP_ROM_PTR(&pyb_keys_events_obj) },
+    { MP_ROM_QSTR(MP_QSTR_lost), MP_ROM_PTR(&pyb_keys_lost_obj) },
+
+    // the key numbers, from the board
+    MICROPY_HW_KEY_NAMES
+};
+STATIC MP_DEFINE_CONST_DICT(pyb_keys_locals_dict, pyb_keys_locals_dict_table);
+
+const mp_obj_type_t pyb_keys_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Keys,
+    .print = pyb_keys_print,
+    .make_new = pyb_keys_make_new,
+    .locals_dict = (mp_obj_dict_t*)&pyb_keys_locals_dict,
+};
+
+#endif // MICROPY_HW_ENABLE_KEYS
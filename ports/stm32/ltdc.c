@@ -0,0 +1,274 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/builtin.h"
+#include "py/mphal.h"
+#include "py/mperrno.h"
+#include "irq.h"
+#include "pin.h"
+#include "sdram.h"
+#include "ltdc.h"
+
+#if MICROPY_HW_ENABLE_LTDC
+
+// Parallel RGB display driven by the LTDC from a pair of 8-bit framebuffers
+// in the external SDRAM.  The LTDC reads the front buffer by itself, so
+// showing a frame costs no CPU time and no transfer, and flip() switches
+// buffers by writing the layer's address to a shadow register that the LTDC
+// loads during vertical blanking, so a frame is never shown half drawn.
+//
+// The buffers are PL8, looked up in the layer's CLUT.  framebuf stores RGB565
+// byte-swapped, in the order SPI panels take it, which the LTDC can't read.
+
+#define LTDC_WIDTH (MICROPY_HW_LTDC_WIDTH)
+#define LTDC_HEIGHT (MICROPY_HW_LTDC_HEIGHT)
+#define LTDC_FB_SIZE ((LTDC_WIDTH * LTDC_HEIGHT + 31) & ~31)
+
+// framebuf format constant, as in extmod/modframebuf.c
+#define LTDC_FB_PL8 (6)
+
+// value for the PF field of LxPFCR
+#define LTDC_PF_L8 (5)
+
+#define LTDC_FLIP_TIMEOUT_MS (100)
+
+typedef struct _pyb_ltdc_obj_t {
+    mp_obj_base_t base;
+    // framebuf.FrameBuffer for each buffer, created by buffers()
+    mp_obj_t fb[2];
+    // buffer to draw into; the other one is being shown
+    uint8_t back;
+} pyb_ltdc_obj_t;
+
+typedef struct _ltdc_pin_t {
+    const pin_obj_t *pin;
+    uint8_t af;
+} ltdc_pin_t;
+
+STATIC const ltdc_pin_t ltdc_pins[] = MICROPY_HW_LTDC_PINS;
+
+STATIC uint8_t *ltdc_buf(int i) {
+    return (uint8_t*)sdram_start() + i * LTDC_FB_SIZE;
+}
+
+// Set CLUT entries from RGB565 colours; the layer must be disabled or the
+// LTDC in vertical blanking.
+STATIC void ltdc_clut_set(size_t start, size_t n, const uint16_t *colours) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t c = colours[i];
+        uint32_t r = c >> 11, g = (c >> 5) & 0x3f, b = c & 0x1f;
+        LTDC_Layer1->CLUTWR = (start + i) << 24
+            | (r << 3 | r >> 2) << 16 | (g << 2 | g >> 4) << 8 | (b << 3 | b >> 2);
+    }
+}
+
+// Load the default palette, 3 bits of red, 3 of green and 2 of blue.
+STATIC void ltdc_clut_default(void) {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t r = (i >> 5) * 255 / 7, g = ((i >> 2) & 7) * 255 / 7, b = (i & 3) * 255 / 3;
+        LTDC_Layer1->CLUTWR = i << 24 | r << 16 | g << 8 | b;
+    }
+}
+
+STATIC void ltdc_init(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(ltdc_pins); ++i) {
+        mp_hal_pin_config(ltdc_pins[i].pin, MP_HAL_PIN_MODE_ALT, MP_HAL_PIN_PULL_NONE, ltdc_pins[i].af);
+        mp_hal_pin_config_speed(ltdc_pins[i].pin, MP_HAL_PIN_SPEED_HIGH);
+    }
+
+    // the pixel clock comes from PLLSAI
+    RCC_PeriphCLKInitTypeDef clk = {0};
+    clk.PeriphClockSelection = RCC_PERIPHCLK_LTDC;
+    clk.PLLSAI.PLLSAIN = MICROPY_HW_LTDC_PLLSAIN;
+    clk.PLLSAI.PLLSAIR = MICROPY_HW_LTDC_PLLSAIR;
+    clk.PLLSAIDivR = MICROPY_HW_LTDC_PLLSAIDIVR;
+    HAL_RCCEx_PeriphCLKConfig(&clk);
+    __HAL_RCC_LTDC_CLK_ENABLE();
+
+    #if defined(MICROPY_HW_LTDC_PANEL_INIT)
+    MICROPY_HW_LTDC_PANEL_INIT();
+    #endif
+
+    // each timing register holds a count of pixels or lines, accumulated
+    // from the start of the sync pulse, minus one
+    uint32_t hbp = MICROPY_HW_LTDC_HSYNC + MICROPY_HW_LTDC_HBP;
+    uint32_t vbp = MICROPY_HW_LTDC_VSYNC + MICROPY_HW_LTDC_VBP;
+    LTDC->SSCR = (MICROPY_HW_LTDC_HSYNC - 1) << 16 | (MICROPY_HW_LTDC_VSYNC - 1);
+    LTDC->BPCR = (hbp - 1) << 16 | (vbp - 1);
+    LTDC->AWCR = (hbp + LTDC_WIDTH - 1) << 16 | (vbp + LTDC_HEIGHT - 1);
+    LTDC->TWCR = (hbp + LTDC_WIDTH + MICROPY_HW_LTDC_HFP - 1) << 16
+        | (vbp + LTDC_HEIGHT + MICROPY_HW_LTDC_VFP - 1);
+    LTDC->BCCR = 0;
+    // sync and data enable active low, pixel clock not inverted
+    LTDC->GCR = 0;
+
+    // layer 1 covers the screen, opaque, and shows buffer 0 to start with
+    memset(ltdc_buf(0), 0, 2 * LTDC_FB_SIZE);
+    MP_HAL_CLEAN_DCACHE(ltdc_buf(0), 2 * LTDC_FB_SIZE);
+    LTDC_Layer1->WHPCR = (hbp + LTDC_WIDTH - 1) << 16 | hbp;
+    LTDC_Layer1->WVPCR = (vbp + LTDC_HEIGHT - 1) << 16 | vbp;
+    LTDC_Layer1->PFCR = LTDC_PF_L8;
+    LTDC_Layer1->CACR = 255;
+    LTDC_Layer1->DCCR = 0;
+    LTDC_Layer1->BFCR = 4 << 8 | 5; // constant alpha for both factors
+    LTDC_Layer1->CFBAR = (uint32_t)ltdc_buf(0);
+    LTDC_Layer1->CFBLR = LTDC_WIDTH << 16 | (LTDC_WIDTH + 3);
+    LTDC_Layer1->CFBLNR = LTDC_HEIGHT;
+    ltdc_clut_default();
+    LTDC_Layer1->CR = LTDC_LxCR_LEN | LTDC_LxCR_CLUTEN;
+    LTDC->SRCR = LTDC_SRCR_IMR;
+
+    LTDC->GCR |= LTDC_GCR_LTDCEN;
+}
+
+// Wait for a reload requested for the next vertical blanking to be done.
+STATIC void ltdc_wait_reload(void) {
+    uint32_t t0 = mp_hal_ticks_ms();
+    while (LTDC->SRCR & LTDC_SRCR_VBR) {
+        if (mp_hal_ticks_ms() - t0 >= LTDC_FLIP_TIMEOUT_MS) {
+            mp_raise_OSError(MP_ETIMEDOUT);
+        }
+        MICROPY_EVENT_POLL_HOOK
+    }
+}
+
+// Wait until the LTDC is, or isn't, sending the active lines of a frame.
+STATIC void ltdc_wait_active(bool active) {
+    uint32_t t0 = mp_hal_ticks_ms();
+    while (((LTDC->CDSR & LTDC_CDSR_VDES) != 0) != active) {
+        if (mp_hal_ticks_ms() - t0 >= LTDC_FLIP_TIMEOUT_MS) {
+            mp_raise_OSError(MP_ETIMEDOUT);
+        }
+    }
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+/// \classmethod \constructor()
+///
+/// Return the display object, initialising the LTDC and the panel the first
+/// time.  The screen starts out black.
+STATIC mp_obj_t pyb_ltdc_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    if (MP_STATE_PORT(pyb_ltdc_obj) == NULL) {
+        if ((uint8_t*)sdram_end() - (uint8_t*)sdram_start() < 2 * LTDC_FB_SIZE) {
+            mp_raise_msg(&mp_type_OSError, "not enough SDRAM");
+        }
+        pyb_ltdc_obj_t *self = m_new_obj(pyb_ltdc_obj_t);
+        self->base.type = &pyb_ltdc_type;
+        self->fb[0] = self->fb[1] = MP_OBJ_NULL;
+        self->back = 1;
+        if (!(LTDC->GCR & LTDC_GCR_LTDCEN)) {
+            ltdc_init();
+        } else {
+            // left running by an earlier session; keep showing the front buffer
+            self->back = LTDC_Layer1->CFBAR == (uint32_t)ltdc_buf(0);
+        }
+        MP_STATE_PORT(pyb_ltdc_obj) = self;
+    }
+    return MP_OBJ_FROM_PTR(MP_STATE_PORT(pyb_ltdc_obj));
+}
+
+/// \method buffers()
+///
+/// Return the back buffer, a PL8 framebuf.FrameBuffer in SDRAM to draw the
+/// next frame into.
+STATIC mp_obj_t pyb_ltdc_buffers(mp_obj_t self_in) {
+    pyb_ltdc_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->fb[0] == MP_OBJ_NULL) {
+        mp_obj_t fb_type = mp_load_attr(MP_OBJ_FROM_PTR(&mp_module_framebuf), MP_QSTR_FrameBuffer);
+        for (int i = 0; i < 2; ++i) {
+            mp_obj_t fb_args[4] = {
+                mp_obj_new_bytearray_by_ref(LTDC_WIDTH * LTDC_HEIGHT, ltdc_buf(i)),
+                MP_OBJ_NEW_SMALL_INT(LTDC_WIDTH),
+                MP_OBJ_NEW_SMALL_INT(LTDC_HEIGHT),
+                MP_OBJ_NEW_SMALL_INT(LTDC_FB_PL8),
+            };
+            self->fb[i] = mp_call_function_n_kw(fb_type, 4, 0, fb_args);
+        }
+    }
+    return self->fb[self->back];
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_ltdc_buffers_obj, pyb_ltdc_buffers);
+
+/// \method flip()
+///
+/// Show the back buffer from the next vertical blanking, wait for that, and
+/// return the buffer that was shown before, to draw the next frame into.
+STATIC mp_obj_t pyb_ltdc_flip(mp_obj_t self_in) {
+    pyb_ltdc_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint8_t *buf = ltdc_buf(self->back);
+    MP_HAL_CLEAN_DCACHE(buf, LTDC_WIDTH * LTDC_HEIGHT);
+    LTDC_Layer1->CFBAR = (uint32_t)buf;
+    LTDC->SRCR = LTDC_SRCR_VBR;
+    ltdc_wait_reload();
+    self->back ^= 1;
+    return self->fb[0] == MP_OBJ_NULL ? mp_const_none : self->fb[self->back];
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_ltdc_flip_obj, pyb_ltdc_flip);
+
+/// \method palette(colours)
+///
+/// Set the colours that PL8 pixel values 0, 1, ... are shown as from a
+/// buffer of RGB565 values, eg an array('H').  The change is made during
+/// the next vertical blanking.
+STATIC mp_obj_t pyb_ltdc_palette(mp_obj_t self_in, mp_obj_t colours_in) {
+    (void)self_in;
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(colours_in, &bufinfo, MP_BUFFER_READ);
+    size_t n = MIN(bufinfo.len / 2, 256);
+    // wait for the start of vertical blanking, which is long enough to write
+    // the whole CLUT
+    ltdc_wait_active(true);
+    ltdc_wait_active(false);
+    uint32_t irq_state = disable_irq();
+    ltdc_clut_set(0, n, bufinfo.buf);
+    enable_irq(irq_state);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_ltdc_palette_obj, pyb_ltdc_palette);
+
+STATIC const mp_rom_map_elem_t pyb_ltdc_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_buffers), MP_ROM_PTR(&pyb_ltdc_buffers_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flip), MP_ROM_PTR(&pyb_ltdc_flip_obj) },
+    { MP_ROM_QSTR(MP_QSTR_palette), MP_ROM_PTR(&pyb_ltdc_palette_obj) },
+    { MP_ROM_QSTR(MP_QSTR_WIDTH), MP_ROM_INT(LTDC_WIDTH) },
+    { MP_ROM_QSTR(MP_QSTR_HEIGHT), MP_ROM_INT(LTDC_HEIGHT) },
+};
+STATIC MP_DEFINE_CONST_DICT(pyb_ltdc_locals_dict, pyb_ltdc_locals_dict_table);
+
+const mp_obj_type_t pyb_ltdc_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_LTDC,
+    .make_new = pyb_ltdc_make_new,
+    .locals_dict = (mp_obj_dict_t*)&pyb_ltdc_locals_dict,
+};
+
+#endif // MICROPY_HW_ENABLE_LTDC
@@ -0,0 +1,256 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "pin.h"
+#include "timer.h"
+#include "dma.h"
+#include "modmachine.h"
+
+#if MICROPY_PY_MACHINE_BITSTREAM
+
+// machine.bitstream(pin, encoding, timing, buf) sends buf out of a pin as
+// fixed-period high/low pulses, as used by WS2812 (NeoPixel) LEDs.
+//
+// The pin is switched to a timer channel in PWM mode.  Every bit is one
+// timer period, and the DMA, triggered by the update event, copies the
+// compare value for the next bit into CCRx.  The compare values are encoded
+// from buf into a ring, the same way pyb.Audio feeds TIM5: the DMA runs
+// circularly and the half/full transfer interrupt encodes the next bits into
+// the half that has just gone out.  So interrupts stay enabled, and the ring
+// is a fixed size however long the strip is.
+
+// bits per half of the ring; 8 pixels of 24 bits gives the DMA interrupt
+// 240us to refill a half at 800kHz
+#define BITSTREAM_HALF_LEN (192)
+
+// The timers that can drive a pin, with the DMA stream of their update event.
+typedef struct _bitstream_tim_t {
+    uint8_t id;
+    TIM_TypeDef *tim;
+    const dma_descr_t *dma;
+} bitstream_tim_t;
+
+STATIC const bitstream_tim_t bitstream_tim[] = {
+    { 1, TIM1, &dma_TIM_1_UP },
+    { 2, TIM2, &dma_TIM_2_UP },
+    { 3, TIM3, &dma_TIM_3_UP },
+    { 4, TIM4, &dma_TIM_4_UP },
+    { 5, TIM5, &dma_TIM_5_UP },
+    #if defined(TIM8)
+    { 8, TIM8, &dma_TIM_8_UP },
+    #endif
+};
+
+typedef struct _bitstream_t {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos; // index of the next bit to encode
+    uint32_t ccr0; // high time of a 0 bit, in timer counts
+    uint32_t ccr1; // high time of a 1 bit
+    uint8_t idle; // consecutive halves of the ring filled with low
+    volatile bool busy;
+    TIM_TypeDef *tim;
+    uint32_t ring[2 * BITSTREAM_HALF_LEN];
+} bitstream_t;
+
+STATIC void bitstream_fill(bitstream_t *self, uint32_t *dest) {
+    size_t n = 0;
+    size_t nbits = self->len * 8;
+    while (n < BITSTREAM_HALF_LEN && self->pos < nbits) {
+        uint8_t b = self->buf[self->pos >> 3];
+        dest[n++] = (b & (0x80 >> (self->pos & 7))) ? self->ccr1 : self->ccr0;
+        self->pos += 1;
+    }
+    if (n == 0) {
+        self->idle += 1;
+    }
+    // a compare value of 0 holds the output low
+    while (n < BITSTREAM_HALF_LEN) {
+        dest[n++] = 0;
+    }
+}
+
+STATIC void bitstream_refill(DMA_HandleTypeDef *hdma, uint32_t *half) {
+    bitstream_t *self = hdma->Parent;
+    bitstream_fill(self, half);
+    if (self->idle >= 3) {
+        // the last bit went out, followed by a whole half of low which is
+        // longer than the reset time of the LEDs
+        self->tim->DIER &= ~TIM_DIER_UDE;
+        HAL_DMA_Abort(hdma);
+        self->busy = false;
+    }
+}
+
+STATIC void bitstream_dma_half_callback(DMA_HandleTypeDef *hdma) {
+    bitstream_t *self = hdma->Parent;
+    bitstream_refill(hdma, &self->ring[0]);
+}
+
+STATIC void bitstream_dma_callback(DMA_HandleTypeDef *hdma) {
+    bitstream_t *self = hdma->Parent;
+    bitstream_refill(hdma, &self->ring[BITSTREAM_HALF_LEN]);
+}
+
+STATIC void bitstream_tim_clock_enable(uint8_t id) {
+    switch (id) {
+        case 1: __HAL_RCC_TIM1_CLK_ENABLE(); break;
+        case 2: __HAL_RCC_TIM2_CLK_ENABLE(); break;
+        case 3: __HAL_RCC_TIM3_CLK_ENABLE(); break;
+        case 4: __HAL_RCC_TIM4_CLK_ENABLE(); break;
+        case 5: __HAL_RCC_TIM5_CLK_ENABLE(); break;
+        #if defined(TIM8)
+        case 8: __HAL_RCC_TIM8_CLK_ENABLE(); break;
+        #endif
+    }
+}
+
+// timing is in ns; the result is in counts of a timer running at source_freq
+STATIC uint32_t bitstream_ticks(uint32_t source_freq, mp_obj_t ns_in) {
+    mp_int_t ns = mp_obj_get_int(ns_in);
+    if (ns < 0) {
+        mp_raise_ValueError("bad timing");
+    }
+    return (uint64_t)source_freq * ns / 1000000000;
+}
+
+STATIC mp_obj_t machine_bitstream(size_t n_args, const mp_obj_t *args) {
+    mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(args[0]);
+    if (mp_obj_get_int(args[1]) != 0) {
+        mp_raise_ValueError("encoding not supported");
+    }
+    mp_obj_t *timing;
+    mp_obj_get_array_fixed_n(args[2], 4, &timing);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[3], &bufinfo, MP_BUFFER_READ);
+
+    // find a channel of a timer in the table that this pin can output
+    const bitstream_tim_t *t = NULL;
+    const pin_af_obj_t *af = NULL;
+    for (size_t i = 0; i < MP_ARRAY_SIZE(bitstream_tim) && t == NULL; ++i) {
+        af = pin_find_af(pin, AF_FN_TIM, bitstream_tim[i].id);
+        if (af != NULL && af->type <= AF_PIN_TYPE_TIM_CH4) {
+            t = &bitstream_tim[i];
+        }
+    }
+    if (t == NULL) {
+        mp_raise_ValueError("pin has no timer channel");
+    }
+
+    // the period is the longer of the two bits, which for WS2812 timings are
+    // the same to within the tolerance of the LEDs
+    uint32_t source_freq = timer_get_source_freq(t->id);
+    uint32_t period0 = bitstream_ticks(source_freq, timing[0]) + bitstream_ticks(source_freq, timing[1]);
+    uint32_t period1 = bitstream_ticks(source_freq, timing[2]) + bitstream_ticks(source_freq, timing[3]);
+    uint32_t period = MAX(period0, period1);
+    if (period < 2 || period > 0x10000) {
+        mp_raise_ValueError("bad timing");
+    }
+
+    if (bufinfo.len == 0) {
+        return mp_const_none;
+    }
+
+    // The ring is on the stack, which is fine because this function doesn't
+    // return, and doesn't run anything that can raise, until the DMA stops.
+    bitstream_t bs;
+    bs.buf = bufinfo.buf;
+    bs.len = bufinfo.len;
+    bs.pos = 0;
+    bs.ccr0 = bitstream_ticks(source_freq, timing[0]);
+    bs.ccr1 = bitstream_ticks(source_freq, timing[2]);
+    bs.idle = 0;
+    bs.tim = t->tim;
+    bitstream_fill(&bs, &bs.ring[0]);
+    bitstream_fill(&bs, &bs.ring[BITSTREAM_HALF_LEN]);
+
+    // The timer is borrowed for the write, and the registers touched here
+    // are put back after, so a pyb.Timer on it carries on where it was.
+    TIM_TypeDef *tim = t->tim;
+    bitstream_tim_clock_enable(t->id);
+    uint32_t ch = af->type; // 0-3 for CH1-CH4
+    volatile uint32_t *ccmr = ch < 2 ? &tim->CCMR1 : &tim->CCMR2;
+    volatile uint32_t *ccr = &tim->CCR1 + ch;
+    uint32_t ccmr_shift = (ch & 1) * 8;
+    uint32_t saved_cr1 = tim->CR1;
+    uint32_t saved_psc = tim->PSC;
+    uint32_t saved_arr = tim->ARR;
+    uint32_t saved_ccmr = *ccmr;
+    uint32_t saved_ccer = tim->CCER;
+    uint32_t saved_ccr = *ccr;
+    uint32_t saved_bdtr = tim->BDTR;
+
+    // PWM mode 1 with the compare value preloaded, so the value the DMA
+    // writes during one bit takes effect at the start of the next
+    tim->CR1 = 0;
+    tim->PSC = 0;
+    tim->ARR = period - 1;
+    tim->CNT = 0;
+    *ccr = 0;
+    *ccmr = (*ccmr & ~(0xff << ccmr_shift))
+        | ((TIM_OCMODE_PWM1 | TIM_CCMR1_OC1PE) << ccmr_shift);
+    tim->CCER = (tim->CCER & ~(0xf << (ch * 4))) | (TIM_CCER_CC1E << (ch * 4));
+    if (t->id == 1 || t->id == 8) {
+        // the advanced timers also need their main output enabled
+        tim->BDTR |= TIM_BDTR_MOE;
+    }
+    tim->EGR = TIM_EGR_UG;
+    mp_hal_pin_config(pin, MP_HAL_PIN_MODE_ALT, MP_HAL_PIN_PULL_NONE, af->idx);
+
+    DMA_HandleTypeDef dma;
+    dma_init(&dma, t->dma, DMA_MEMORY_TO_PERIPH, &bs);
+    // dma_init clears the handle, so the callbacks are set after it
+    dma.XferHalfCpltCallback = bitstream_dma_half_callback;
+    dma.XferCpltCallback = bitstream_dma_callback;
+    bs.busy = true;
+    HAL_DMA_Start_IT(&dma, (uint32_t)bs.ring, (uint32_t)ccr, MP_ARRAY_SIZE(bs.ring));
+    tim->DIER |= TIM_DIER_UDE;
+    tim->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+
+    while (bs.busy) {
+        __WFI();
+    }
+
+    dma_deinit(t->dma);
+    mp_hal_pin_low(pin);
+    mp_hal_pin_output(pin);
+
+    tim->CR1 = 0;
+    tim->CCER = saved_ccer;
+    *ccmr = saved_ccmr;
+    *ccr = saved_ccr;
+    tim->BDTR = saved_bdtr;
+    tim->PSC = saved_psc;
+    tim->ARR = saved_arr;
+    tim->CR1 = saved_cr1;
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_bitstream_obj, 4, 4, machine_bitstream);
+
+#endif // MICROPY_PY_MACHINE_BITSTREAM
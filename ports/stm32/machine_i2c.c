@@ -106,6 +106,12 @@ void machine_hard_i2c_init(machine_hard_i2c_obj_t *self, uint32_t freq, uint32_t
 int machine_hard_i2c_transfer(mp_obj_base_t *self_in, uint16_t addr, size_t n, mp_machine_i2c_buf_t *bufs, unsigned int flags) {
     machine_hard_i2c_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
+    if (n == 1 && (flags & MP_MACHINE_I2C_FLAG_READ)) {
+        // a plain read, which i2c_readfrom may do by DMA
+        int ret = i2c_readfrom(self->i2c, addr, bufs->buf, bufs->len, flags & MP_MACHINE_I2C_FLAG_STOP);
+        return ret < 0 ? ret : 0;
+    }
+
     size_t remain_len = 0;
     for (size_t i = 0; i < n; ++i) {
         remain_len += bufs[i].len;
@@ -0,0 +1,209 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "dma.h"
+#include "modmachine.h"
+
+#if MICROPY_PY_MACHINE_MEMCPY
+
+// machine.memcpy() and machine.memset() run on a DMA2 stream in
+// memory-to-memory mode, and return once the transfer has started.  There is
+// one transfer at a time: the next call, or machine.memwait(), waits for it.
+// The buffers are held in MP_STATE_PORT(machine_memcpy_buf) until then, so
+// the GC doesn't reclaim them while the DMA is using them.
+
+// the most items one DMA transfer can move
+#define MEMCPY_MAX_ITEMS (0xffff)
+
+STATIC const dma_descr_t *memcpy_dma;
+
+// memset reads the fill value from here, so it must be in DMA-able RAM
+STATIC uint32_t memset_word;
+
+STATIC void memcpy_finish(void) {
+    if (memcpy_dma != NULL) {
+        while (dma_nohal_is_busy(memcpy_dma)) {
+            MICROPY_EVENT_POLL_HOOK
+        }
+        dma_nohal_deinit(memcpy_dma);
+        memcpy_dma = NULL;
+    }
+    MP_STATE_PORT(machine_memcpy_buf)[0] = MP_OBJ_NULL;
+    MP_STATE_PORT(machine_memcpy_buf)[1] = MP_OBJ_NULL;
+}
+
+void machine_memcpy_deinit(void) {
+    memcpy_finish();
+}
+
+// The DMA can't reach the CCM RAM of the F4, where the stack may be.
+STATIC bool memcpy_dma_can_access(uintptr_t addr, size_t n) {
+    #if defined(CCMDATARAM_BASE)
+    if (addr + n > CCMDATARAM_BASE && addr < CCMDATARAM_END + 1) {
+        return false;
+    }
+    #endif
+    (void)addr;
+    (void)n;
+    return true;
+}
+
+// Get the address of a buffer object or an integer address, and the size
+// of the buffer, or SIZE_MAX for an address.
+STATIC uintptr_t memcpy_get_addr(mp_obj_t obj, size_t *len, mp_uint_t flags) {
+    if (mp_obj_is_int(obj)) {
+        *len = SIZE_MAX;
+        return mp_obj_int_get_truncated(obj);
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(obj, &bufinfo, flags);
+    *len = bufinfo.len;
+    return (uintptr_t)bufinfo.buf;
+}
+
+STATIC size_t memcpy_get_len(size_t n_args, const mp_obj_t *args, size_t dst_len, size_t src_len) {
+    size_t n = MIN(dst_len, src_len);
+    if (n_args > 2) {
+        mp_int_t n_in = mp_obj_get_int(args[2]);
+        if (n_in < 0 || (size_t)n_in > n) {
+            mp_raise_ValueError("length out of range");
+        }
+        n = n_in;
+    } else if (n == SIZE_MAX) {
+        mp_raise_TypeError("length required");
+    }
+    return n;
+}
+
+// Run a transfer of n bytes, in chunks of at most MEMCPY_MAX_ITEMS items.
+// All but the last chunk are waited for; the last one carries on in the
+// background.  src_inc is false for a fill, where src is a single word.
+STATIC void memcpy_dma_start(uintptr_t dst, uintptr_t src, size_t n, bool src_inc) {
+    // use the widest items that the addresses and length are aligned to
+    uintptr_t align = dst | n | (src_inc ? src : 0);
+    uint32_t size_shift;
+    uint32_t config;
+    if ((align & 3) == 0) {
+        size_shift = 2;
+        config = DMA_MDATAALIGN_WORD | DMA_PDATAALIGN_WORD;
+    } else if ((align & 1) == 0) {
+        size_shift = 1;
+        config = DMA_MDATAALIGN_HALFWORD | DMA_PDATAALIGN_HALFWORD;
+    } else {
+        size_shift = 0;
+        config = DMA_MDATAALIGN_BYTE | DMA_PDATAALIGN_BYTE;
+    }
+    config |= DMA_MEMORY_TO_MEMORY;
+    if (src_inc) {
+        config |= DMA_PINC_ENABLE;
+    }
+
+    MP_HAL_CLEAN_DCACHE((void*)src, src_inc ? n : sizeof(memset_word));
+    MP_HAL_CLEANINVALIDATE_DCACHE((void*)dst, n);
+
+    size_t items = n >> size_shift;
+    while (items > 0) {
+        size_t chunk = MIN(items, MEMCPY_MAX_ITEMS);
+        while (dma_nohal_is_busy(memcpy_dma)) {
+        }
+        dma_nohal_init(memcpy_dma, config);
+        // in memory-to-memory mode the source is the peripheral port, which
+        // dma_nohal_start takes as its dst_addr
+        dma_nohal_start(memcpy_dma, dst, src, chunk);
+        items -= chunk;
+        dst += chunk << size_shift;
+        if (src_inc) {
+            src += chunk << size_shift;
+        }
+    }
+}
+
+STATIC mp_obj_t machine_memcpy(size_t n_args, const mp_obj_t *args) {
+    memcpy_finish();
+
+    size_t dst_len, src_len;
+    uintptr_t dst = memcpy_get_addr(args[0], &dst_len, MP_BUFFER_WRITE);
+    uintptr_t src = memcpy_get_addr(args[1], &src_len, MP_BUFFER_READ);
+    size_t n = memcpy_get_len(n_args, args, dst_len, src_len);
+    if (n == 0) {
+        return mp_const_none;
+    }
+
+    // the DMA only copies forwards, so overlapping buffers are left to memmove
+    bool overlap = dst < src + n && src < dst + n;
+    if (!overlap && memcpy_dma_can_access(dst, n) && memcpy_dma_can_access(src, n)) {
+        memcpy_dma = dma_find_free_mem2mem();
+    }
+    if (memcpy_dma == NULL) {
+        // no DMA to use, so copy with the CPU
+        memmove((void*)dst, (const void*)src, n);
+        return mp_const_none;
+    }
+
+    MP_STATE_PORT(machine_memcpy_buf)[0] = args[0];
+    MP_STATE_PORT(machine_memcpy_buf)[1] = args[1];
+    memcpy_dma_start(dst, src, n, true);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_memcpy_obj, 2, 3, machine_memcpy);
+
+STATIC mp_obj_t machine_memset(size_t n_args, const mp_obj_t *args) {
+    memcpy_finish();
+
+    size_t dst_len;
+    uintptr_t dst = memcpy_get_addr(args[0], &dst_len, MP_BUFFER_WRITE);
+    uint8_t val = mp_obj_get_int(args[1]);
+    size_t n = memcpy_get_len(n_args, args, dst_len, SIZE_MAX);
+    if (n == 0) {
+        return mp_const_none;
+    }
+
+    if (memcpy_dma_can_access(dst, n)) {
+        memcpy_dma = dma_find_free_mem2mem();
+    }
+    if (memcpy_dma == NULL) {
+        memset((void*)dst, val, n);
+        return mp_const_none;
+    }
+
+    MP_STATE_PORT(machine_memcpy_buf)[0] = args[0];
+    memset_word = val * 0x01010101;
+    memcpy_dma_start(dst, (uintptr_t)&memset_word, n, false);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_memset_obj, 2, 3, machine_memset);
+
+STATIC mp_obj_t machine_memwait(void) {
+    memcpy_finish();
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_0(machine_memwait_obj, machine_memwait);
+
+#endif // MICROPY_PY_MACHINE_MEMCPY
@@ -112,6 +112,10 @@ STATIC void pyb_uart_irq_config(pyb_uart_obj_t *self, bool enable) {
             if (mp_irq_map[entry].flag & self->mp_irq_trigger) {
                 if (enable) {
                     self->uartx->CR1 |= mp_irq_map[entry].irq_en;
+                #if MICROPY_HW_UART_DMA
+                } else if (self->rx_dma && mp_irq_map[entry].irq_en == USART_CR1_IDLEIE) {
+                    // receiving by DMA needs the idle line IRQ regardless
+                #endif
                 } else {
                     self->uartx->CR1 &= ~mp_irq_map[entry].irq_en;
                 }
@@ -205,7 +209,7 @@ STATIC void pyb_uart_print(const mp_print_t *print, mp_obj_t self_in, mp_print_k
     }
 }
 
-/// \method init(baudrate, bits=8, parity=None, stop=1, *, timeout=1000, timeout_char=0, flow=0, read_buf_len=64)
+/// \method init(baudrate, bits=8, parity=None, stop=1, *, timeout=1000, timeout_char=0, flow=0, read_buf_len=64, dma=False)
 ///
 /// Initialise the UART bus with the given parameters:
 ///
@@ -217,6 +221,7 @@ STATIC void pyb_uart_print(const mp_print_t *print, mp_obj_t self_in, mp_print_k
 ///   - `timeout_char` is the timeout in milliseconds to wait between characters.
 ///   - `flow` is RTS | CTS where RTS == 256, CTS == 512
 ///   - `read_buf_len` is the character length of the read buffer (0 to disable).
+///   - `dma` is whether to receive into the read buffer, and send, by DMA.
 STATIC mp_obj_t pyb_uart_init_helper(pyb_uart_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_baudrate, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 9600} },
@@ -228,11 +233,12 @@ STATIC mp_obj_t pyb_uart_init_helper(pyb_uart_obj_t *self, size_t n_args, const
         { MP_QSTR_timeout_char, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_rxbuf, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
         { MP_QSTR_read_buf_len, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 64} }, // legacy
+        { MP_QSTR_dma, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
     };
 
     // parse args
     struct {
-        mp_arg_val_t baudrate, bits, parity, stop, flow, timeout, timeout_char, rxbuf, read_buf_len;
+        mp_arg_val_t baudrate, bits, parity, stop, flow, timeout, timeout_char, rxbuf, read_buf_len, dma;
     } args;
     mp_arg_parse_all(n_args, pos_args, kw_args,
         MP_ARRAY_SIZE(allowed_args), allowed_args, (mp_arg_val_t*)&args);
@@ -296,6 +302,11 @@ STATIC mp_obj_t pyb_uart_init_helper(pyb_uart_obj_t *self, size_t n_args, const
         self->timeout_char = min_timeout_char;
     }
 
+    // use DMA, or not, before the read buffer is set up to receive into
+    if (!uart_set_dma(self, args.dma.u_bool)) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "UART(%d) can't use DMA", self->uart_id));
+    }
+
     // setup the read buffer
     m_del(byte, self->read_buf, self->read_buf_len << self->char_width);
     if (args.rxbuf.u_int >= 0) {
@@ -594,14 +605,22 @@ STATIC mp_uint_t pyb_uart_read(mp_obj_t self_in, void *buf_in, mp_uint_t size, i
     // read the data
     byte *orig_buf = buf;
     for (;;) {
-        int data = uart_rx_char(self);
         if (self->char_width == CHAR_WIDTH_9BIT) {
-            *(uint16_t*)buf = data;
+            *(uint16_t*)buf = uart_rx_char(self);
             buf += 2;
+            --size;
         } else {
-            *buf++ = data;
+            // take everything already buffered in one go
+            size_t n = uart_rx_data(self, buf, size);
+            if (n == 0) {
+                // unbuffered, or the char is still in the UART
+                *buf = uart_rx_char(self);
+                n = 1;
+            }
+            buf += n;
+            size -= n;
         }
-        if (--size == 0 || !uart_rx_wait(self, self->timeout_char)) {
+        if (size == 0 || !uart_rx_wait(self, self->timeout_char)) {
             // return number of bytes read
             return buf - orig_buf;
         }
@@ -625,7 +644,7 @@ STATIC mp_uint_t pyb_uart_write(mp_obj_t self_in, const void *buf_in, mp_uint_t
     }
 
     // write the data
-    size_t num_tx = uart_tx_data(self, buf, size >> self->char_width, errcode);
+    size_t num_tx = uart_tx_data_dma(self, buf, size >> self->char_width, errcode);
 
     if (*errcode == 0 || *errcode == MP_ETIMEDOUT) {
         // return number of bytes written, even if there was a timeout
@@ -647,6 +666,16 @@ STATIC mp_uint_t pyb_uart_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t a
         if ((flags & MP_STREAM_POLL_WR) && uart_tx_avail(self)) {
             ret |= MP_STREAM_POLL_WR;
         }
+    #if MICROPY_PY_USELECT_NOTIFY
+    } else if (request == MP_STREAM_POLL_NOTIFY) {
+        // only RX is interrupt driven, so TX readiness must still be polled
+        if (arg != 0 && self->poll_notify != NULL) {
+            *errcode = MP_EBUSY;
+            return MP_STREAM_ERROR;
+        }
+        self->poll_notify = (struct _poll_obj_t*)arg;
+        ret = MP_STREAM_POLL_RD;
+    #endif
     } else {
         *errcode = MP_EINVAL;
         ret = MP_STREAM_ERROR;
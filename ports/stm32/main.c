@@ -31,6 +31,7 @@
 #include "py/stackctrl.h"
 #include "py/gc.h"
 #include "py/mphal.h"
+#include "py/frozenmod.h"
 #include "lib/mp-readline/readline.h"
 #include "lib/utils/pyexec.h"
 #include "lib/oofatfs/ff.h"
@@ -50,6 +51,7 @@
 #include "pybthread.h"
 #include "gccollect.h"
 #include "factoryreset.h"
+#include "hibernate.h"
 #include "modmachine.h"
 #include "i2c.h"
 #include "spi.h"
@@ -67,8 +69,13 @@
 #include "rng.h"
 #include "accel.h"
 #include "servo.h"
+#include "audio.h"
+#include "jacdac.h"
+#include "keys.h"
+#include "adc.h"
 #include "dac.h"
 #include "can.h"
+#include "screen.h"
 #include "modnetwork.h"
 
 #if MICROPY_PY_THREAD
@@ -291,6 +298,43 @@ STATIC bool init_sdcard_fs(void) {
 }
 #endif
 
+// Initialise the local flash filesystem: create it if needed, mount it on
+// /flash and set it as current dir.  Then mount the SD card, if present, on
+// /sd.
+MP_NOINLINE STATIC void init_filesystems(uint reset_mode, bool *mounted_flash, bool *mounted_sdcard) {
+    #if MICROPY_HW_ENABLE_STORAGE
+    *mounted_flash = init_flash_fs(reset_mode);
+    #endif
+
+    #if MICROPY_HW_SDCARD_MOUNT_AT_BOOT
+    // if an SD card is present then mount it on /sd/
+    if (sdcard_is_present()) {
+        // if there is a file in the flash called "SKIPSD", then we don't mount the SD card
+        if (!*mounted_flash || f_stat(&fs_user_mount_flash.fatfs, "/SKIPSD", NULL) != FR_OK) {
+            *mounted_sdcard = init_sdcard_fs();
+        }
+    }
+    #endif
+}
+
+#if MICROPY_HW_FAST_BOOT
+#if !MICROPY_MODULE_FROZEN
+#error MICROPY_HW_FAST_BOOT needs frozen modules
+#endif
+
+// set at boot when mounting the filesystems is left to their first access
+STATIC bool fs_mount_deferred;
+
+void pyb_fs_lazy_mount(void) {
+    if (fs_mount_deferred) {
+        fs_mount_deferred = false;
+        bool mounted_flash = false;
+        bool mounted_sdcard = false;
+        init_filesystems(1, &mounted_flash, &mounted_sdcard);
+    }
+}
+#endif
+
 #if !MICROPY_HW_USES_BOOTLOADER
 STATIC uint update_reset_mode(uint reset_mode) {
     #if MICROPY_HW_HAS_SWITCH
@@ -429,6 +473,11 @@ void stm32_main(uint32_t reset_mode) {
     // set the system clock to be HSE
     SystemClock_Config();
 
+    #if __CORTEX_M >= 0x03
+    // start the cycle counter, for utime.ticks_cpu and MP_HAL_CYCLES_START
+    mp_hal_ticks_cpu_enable();
+    #endif
+
     // enable GPIO clocks
     __HAL_RCC_GPIOA_CLK_ENABLE();
     __HAL_RCC_GPIOB_CLK_ENABLE();
@@ -558,6 +607,9 @@ soft_reset:
 
     // GC init
     gc_init(MICROPY_HEAP_START, MICROPY_HEAP_END);
+    #if MICROPY_GC_SPLIT_HEAP && defined(MICROPY_HEAP2_START)
+    gc_add(MICROPY_HEAP2_START, MICROPY_HEAP2_END);
+    #endif
 
     #if MICROPY_ENABLE_PYSTACK
     static mp_obj_t pystack[384];
@@ -581,6 +633,14 @@ soft_reset:
     MP_STATE_PORT(pyb_stdio_uart) = NULL;
     #endif
 
+    #if MICROPY_HW_HAS_SCREEN
+    MP_STATE_PORT(pyb_screen_obj) = NULL;
+    #endif
+
+    #if MICROPY_HW_ENABLE_LTDC
+    MP_STATE_PORT(pyb_ltdc_obj) = NULL;
+    #endif
+
     readline_init0();
     pin_init0();
     extint_init0();
@@ -594,23 +654,22 @@ soft_reset:
     pyb_usb_init0();
     #endif
 
-    // Initialise the local flash filesystem.
-    // Create it if needed, mount in on /flash, and set it as current dir.
     bool mounted_flash = false;
-    #if MICROPY_HW_ENABLE_STORAGE
-    mounted_flash = init_flash_fs(reset_mode);
-    #endif
-
     bool mounted_sdcard = false;
-    #if MICROPY_HW_SDCARD_MOUNT_AT_BOOT
-    // if an SD card is present then mount it on /sd/
-    if (sdcard_is_present()) {
-        // if there is a file in the flash called "SKIPSD", then we don't mount the SD card
-        if (!mounted_flash || f_stat(&fs_user_mount_flash.fatfs, "/SKIPSD", NULL) != FR_OK) {
-            mounted_sdcard = init_sdcard_fs();
-        }
-    }
+    #if MICROPY_HW_FAST_BOOT
+    // with a frozen main.py there may be no need for the filesystems, so
+    // leave mounting them (and powering up the SD card) to the first access
+    fs_mount_deferred = reset_mode == 1 && mp_frozen_stat("main.py") == MP_IMPORT_STAT_FILE;
+    if (fs_mount_deferred) {
+        mounted_flash = MICROPY_HW_ENABLE_STORAGE;
+        #if MICROPY_HW_SDCARD_MOUNT_AT_BOOT
+        mounted_sdcard = sdcard_is_present();
+        #endif
+    } else
     #endif
+    {
+        init_filesystems(reset_mode, &mounted_flash, &mounted_sdcard);
+    }
 
     #if MICROPY_HW_ENABLE_USB
     // if the SD card isn't used as the USB MSC medium then use the internal flash
@@ -629,14 +688,45 @@ soft_reset:
         mp_obj_list_append(mp_sys_path, MP_OBJ_NEW_QSTR(MP_QSTR__slash_flash_slash_lib));
     }
 
+    #if MICROPY_HW_ENABLE_HIBERNATE
+    // resume from a hibernation image, if there is one, in place of boot.py
+    // and main.py; it needs the flash filesystem mounted now
+    mp_obj_t resume = MP_OBJ_NULL;
+    if (reset_mode == 1 && mounted_flash
+        #if MICROPY_HW_FAST_BOOT
+        && !fs_mount_deferred
+        #endif
+        ) {
+        resume = hibernate_restore();
+        if (resume != MP_OBJ_NULL) {
+            // the mount table was on the heap that got replaced
+            MP_STATE_VM(vfs_mount_table) = NULL;
+            MP_STATE_PORT(vfs_cur) = MP_VFS_ROOT;
+            init_filesystems(reset_mode, &mounted_flash, &mounted_sdcard);
+        }
+    }
+    #endif
+
     // reset config variables; they should be set by boot.py
     MP_STATE_PORT(pyb_config_main) = MP_OBJ_NULL;
 
     // run boot.py, if it exists
     // TODO perhaps have pyb.reboot([bootpy]) function to soft-reboot and execute custom boot.py
-    if (reset_mode == 1 || reset_mode == 3) {
+    if ((reset_mode == 1 || reset_mode == 3)
+        #if MICROPY_HW_ENABLE_HIBERNATE
+        && resume == MP_OBJ_NULL
+        #endif
+        ) {
         const char *boot_py = "boot.py";
+        #if MICROPY_HW_FAST_BOOT
+        // only a frozen boot.py runs if the filesystems aren't mounted yet
+        int ret = 1;
+        if (!fs_mount_deferred || mp_frozen_stat(boot_py) == MP_IMPORT_STAT_FILE) {
+            ret = pyexec_file_if_exists(boot_py);
+        }
+        #else
         int ret = pyexec_file_if_exists(boot_py);
+        #endif
         //printf("boot exec %x\n", ret);
         if (ret & PYEXEC_FORCED_EXIT) {
             goto soft_reset_exit;
@@ -691,6 +781,17 @@ soft_reset:
     //printf("exec main %ld\r\n", reset_mode);
     // At this point everything is fully configured and initialised.
     // Run the main script from the current directory.
+    #if MICROPY_HW_ENABLE_HIBERNATE
+    if (resume != MP_OBJ_NULL) {
+        int ret = hibernate_resume(resume);
+        if (ret & PYEXEC_FORCED_EXIT) {
+            goto soft_reset_exit;
+        }
+        if (!ret) {
+            flash_error(3);
+        }
+    } else
+    #endif
     if ((reset_mode == 1 || reset_mode == 3) && pyexec_mode_kind == PYEXEC_MODE_FRIENDLY_REPL) {
         const char *main_py;
         if (MP_STATE_PORT(pyb_config_main) == MP_OBJ_NULL) {
@@ -730,9 +831,29 @@ soft_reset_exit:
     #endif
 
     printf("MPY: soft reboot\n");
+    #if MICROPY_HW_ENABLE_FREQ_POLICY
+    // the clock stays where it is, as after machine.freq
+    powerctrl_freq_policy_disable();
+    #endif
     #if MICROPY_PY_NETWORK
     mod_network_deinit();
     #endif
+    #if MICROPY_HW_HAS_SCREEN
+    screen_deinit();
+    #endif
+    spi_async_deinit();
+    #if MICROPY_HW_ENABLE_AUDIO
+    audio_deinit();
+    #endif
+    #if MICROPY_HW_ENABLE_ADC_CAPTURE
+    adc_capture_deinit();
+    #endif
+    #if MICROPY_HW_ENABLE_JACDAC
+    jacdac_deinit();
+    #endif
+    #if MICROPY_HW_ENABLE_KEYS
+    keys_deinit();
+    #endif
     timer_deinit();
     uart_deinit_all();
     #if MICROPY_HW_ENABLE_CAN
@@ -35,6 +35,11 @@
 
 #define DICT_SIZE (1 << 15)
 
+// The update is checked against flash a page at a time while it is verified,
+// and only the pages that differ are erased and programmed.  Pages beyond
+// this many are always programmed.
+#define FSLOAD_PAGE_MAX (1024)
+
 typedef struct _gz_stream_t {
     FIL fp;
     TINF_DATA tinf;
@@ -42,7 +47,13 @@ typedef struct _gz_stream_t {
     uint8_t dict[DICT_SIZE];
 } gz_stream_t;
 
+typedef struct _fsload_state_t {
+    uint32_t crc; // of the DFU file read so far
+    uint8_t page_differs[FSLOAD_PAGE_MAX / 8];
+} fsload_state_t;
+
 static gz_stream_t gz_stream SECTION_NOZERO_BSS;
+static fsload_state_t fsload_state;
 
 static int gz_stream_read_src(TINF_DATA *tinf) {
     UINT n;
@@ -90,18 +101,38 @@ static int gz_stream_read(size_t len, uint8_t *buf) {
     return gz_stream.tinf.dest - buf;
 }
 
+static int fsload_read(size_t len, uint8_t *buf) {
+    int res = gz_stream_read(len, buf);
+    if (res > 0) {
+        fsload_state.crc = uzlib_crc32(buf, res, fsload_state.crc);
+    }
+    return res;
+}
+
+static bool fsload_page_differs(size_t page) {
+    return page >= FSLOAD_PAGE_MAX || (fsload_state.page_differs[page / 8] & (1 << (page & 7)));
+}
+
 static int fsload_program_file(FATFS *fatfs, const char *filename, bool write_to_flash) {
     int res = gz_stream_open(fatfs, filename);
     if (res != 0) {
         return res;
     }
 
+    fsload_state.crc = 0xffffffff;
+    if (!write_to_flash) {
+        memset(fsload_state.page_differs, 0, sizeof(fsload_state.page_differs));
+    }
+
     // Parse DFU
     uint8_t buf[512];
+    uint8_t flash_buf[512];
     size_t file_offset;
+    size_t page = 0;
+    size_t num_pages = 0;
 
     // Read file header, <5sBIB
-    res = gz_stream_read(11, buf);
+    res = fsload_read(11, buf);
     if (res != 11) {
         return -1;
     }
@@ -121,7 +152,7 @@ static int fsload_program_file(FATFS *fatfs, const char *filename, bool write_to
     uint32_t total_size = get_le32(buf + 6);
 
     // Read target header, <6sBi255sII
-    res = gz_stream_read(274, buf);
+    res = fsload_read(274, buf);
     if (res != 274) {
         return -1;
     }
@@ -141,7 +172,7 @@ static int fsload_program_file(FATFS *fatfs, const char *filename, bool write_to
     // Parse each element
     for (size_t elem = 0; elem < num_elems; ++elem) {
         // Read element header, <II
-        res = gz_stream_read(8, buf);
+        res = fsload_read(8, buf);
         if (res != 8) {
             return -1;
         }
@@ -151,34 +182,50 @@ static int fsload_program_file(FATFS *fatfs, const char *filename, bool write_to
         uint32_t elem_addr = get_le32(buf);
         uint32_t elem_size = get_le32(buf + 4);
 
-        // Erase flash before writing
-        if (write_to_flash) {
-            uint32_t addr = elem_addr;
-            while (addr < elem_addr + elem_size) {
-                res = do_page_erase(addr, &addr);
-                if (res != 0) {
-                    return res;
+        // Read element data a page at a time, and either compare it with
+        // flash or, if the page differs, erase the page and write it
+        uint32_t page_end = elem_addr;
+        for (uint32_t s = elem_size; s;) {
+            if (elem_addr == page_end) {
+                page = num_pages++;
+                uint32_t page_size = do_page_size(elem_addr);
+                if (page_size == 0) {
+                    return -1;
+                }
+                page_end = elem_addr + page_size;
+                if (write_to_flash && fsload_page_differs(page)) {
+                    uint32_t next_addr;
+                    res = do_page_erase(elem_addr, &next_addr);
+                    if (res != 0) {
+                        return res;
+                    }
                 }
             }
-        }
-
-        // Read element data and possibly write to flash
-        for (uint32_t s = elem_size; s;) {
             uint32_t l = s;
             if (l > sizeof(buf)) {
                 l = sizeof(buf);
             }
-            res = gz_stream_read(l, buf);
+            if (l > page_end - elem_addr) {
+                l = page_end - elem_addr;
+            }
+            res = fsload_read(l, buf);
             if (res != l) {
                 return -1;
             }
-            if (write_to_flash) {
+            if (!write_to_flash) {
+                if (!fsload_page_differs(page)) {
+                    do_read(elem_addr, l, flash_buf);
+                    if (memcmp(buf, flash_buf, l) != 0) {
+                        fsload_state.page_differs[page / 8] |= 1 << (page & 7);
+                    }
+                }
+            } else if (fsload_page_differs(page)) {
                 res = do_write(elem_addr, buf, l);
                 if (res != 0) {
                     return -1;
                 }
-                elem_addr += l;
             }
+            elem_addr += l;
             s -= l;
         }
 
@@ -193,13 +240,21 @@ static int fsload_program_file(FATFS *fatfs, const char *filename, bool write_to
         return -1;
     }
 
-    // Read trailing info
-    res = gz_stream_read(16, buf);
-    if (res != 16) {
+    // Read trailing info, <4H3sBI, ending with the CRC32 of all before it
+    res = fsload_read(12, buf);
+    if (res != 12) {
+        return -1;
+    }
+    uint32_t crc = fsload_state.crc;
+    res = gz_stream_read(4, buf);
+    if (res != 4) {
         return -1;
     }
 
-    // TODO validate CRC32
+    // Validate CRC32
+    if (get_le32(buf) != crc) {
+        return -1;
+    }
 
     return 0;
 }
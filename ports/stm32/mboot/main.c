@@ -691,6 +691,26 @@ int do_page_erase(uint32_t addr, uint32_t *next_addr) {
     return flash_page_erase(addr, next_addr);
 }
 
+// Return the size of the page starting at addr that do_page_erase would
+// erase, or 0 if there is no such page.
+uint32_t do_page_size(uint32_t addr) {
+    #if defined(MBOOT_SPIFLASH_ADDR)
+    if (MBOOT_SPIFLASH_ADDR <= addr && addr < MBOOT_SPIFLASH_ADDR + MBOOT_SPIFLASH_BYTE_SIZE) {
+        return MBOOT_SPIFLASH_ERASE_BLOCKS_PER_PAGE * MP_SPIFLASH_ERASE_BLOCK_SIZE;
+    }
+    #endif
+
+    #if defined(MBOOT_SPIFLASH2_ADDR)
+    if (MBOOT_SPIFLASH2_ADDR <= addr && addr < MBOOT_SPIFLASH2_ADDR + MBOOT_SPIFLASH2_BYTE_SIZE) {
+        return MBOOT_SPIFLASH2_ERASE_BLOCKS_PER_PAGE * MP_SPIFLASH_ERASE_BLOCK_SIZE;
+    }
+    #endif
+
+    uint32_t sector_size = 0;
+    flash_get_sector_index(addr, &sector_size);
+    return sector_size;
+}
+
 void do_read(uint32_t addr, int len, uint8_t *buf) {
     #if defined(MBOOT_SPIFLASH_ADDR)
     if (MBOOT_SPIFLASH_ADDR <= addr && addr < MBOOT_SPIFLASH_ADDR + MBOOT_SPIFLASH_BYTE_SIZE) {
@@ -55,6 +55,7 @@ uint32_t get_le32(const uint8_t *b);
 void led_state_all(unsigned int mask);
 
 int do_page_erase(uint32_t addr, uint32_t *next_addr);
+uint32_t do_page_size(uint32_t addr);
 void do_read(uint32_t addr, int len, uint8_t *buf);
 int do_write(uint32_t addr, const uint8_t *src8, size_t len);
 
@@ -44,6 +44,7 @@
 #include "gccollect.h"
 #include "irq.h"
 #include "powerctrl.h"
+#include "hibernate.h"
 #include "pybthread.h"
 #include "rng.h"
 #include "storage.h"
@@ -143,6 +144,9 @@ void machine_init(void) {
 void machine_deinit(void) {
     // we are doing a soft-reset so change the reset_cause
     reset_cause = PYB_RESET_SOFT;
+    #if MICROPY_PY_MACHINE_MEMCPY
+    machine_memcpy_deinit();
+    #endif
 }
 
 // machine.info([dump_alloc_table])
@@ -220,6 +224,10 @@ STATIC mp_obj_t machine_info(size_t n_args, const mp_obj_t *args) {
         #endif
     }
 
+    #if MICROPY_HW_CYCLE_STATS
+    mp_hal_cycles_print();
+    #endif
+
     #if MICROPY_PY_THREAD
     pyb_thread_dump();
     #endif
@@ -321,6 +329,10 @@ STATIC mp_obj_t machine_freq(size_t n_args, const mp_obj_t *args) {
                 }
             }
         }
+        #if MICROPY_HW_ENABLE_FREQ_POLICY
+        // an explicit frequency replaces the policy
+        powerctrl_freq_policy_disable();
+        #endif
         int ret = powerctrl_set_sysclk(sysclk, ahb, apb1, apb2);
         if (ret == -MP_EINVAL) {
             mp_raise_ValueError("invalid freq");
@@ -334,6 +346,73 @@ STATIC mp_obj_t machine_freq(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_freq_obj, 0, 4, machine_freq);
 
+#if MICROPY_HW_ENABLE_FREQ_POLICY
+// get, set or disable the policy that runs at a low frequency while idle
+// and boosts it for drivers that ask, eg the display while rendering
+STATIC mp_obj_t machine_freq_policy(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        uint32_t idle, boost, hold_ms;
+        if (!powerctrl_freq_policy_get(&idle, &boost, &hold_ms)) {
+            return mp_const_none;
+        }
+        mp_obj_t tuple[] = {
+            mp_obj_new_int(idle),
+            mp_obj_new_int(boost),
+            mp_obj_new_int(hold_ms),
+        };
+        return mp_obj_new_tuple(MP_ARRAY_SIZE(tuple), tuple);
+    }
+    if (args[0] == mp_const_none) {
+        powerctrl_freq_policy_disable();
+        return mp_const_none;
+    }
+    if (n_args == 1) {
+        mp_raise_TypeError(NULL);
+    }
+    mp_int_t idle = mp_obj_get_int(args[0]);
+    mp_int_t boost = mp_obj_get_int(args[1]);
+    mp_int_t hold_ms = n_args > 2 ? mp_obj_get_int(args[2]) : 200;
+    if (idle <= 0 || boost < idle || hold_ms < 0) {
+        mp_raise_ValueError(NULL);
+    }
+    int ret = powerctrl_freq_policy_enable(idle, boost, hold_ms);
+    if (ret == -MP_EINVAL) {
+        mp_raise_ValueError("invalid freq");
+    } else if (ret < 0) {
+        void NORETURN __fatal_error(const char *msg);
+        __fatal_error("can't change freq");
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_freq_policy_obj, 0, 3, machine_freq_policy);
+#endif
+
+#if MICROPY_HW_ENABLE_HIBERNATE
+// save the heap and the loaded modules so that the next boot calls resume
+// instead of running boot.py and main.py, or cancel that with None
+STATIC mp_obj_t machine_hibernate(mp_obj_t resume) {
+    if (resume == mp_const_none) {
+        hibernate_discard();
+        return mp_const_none;
+    }
+    if (!mp_obj_is_callable(resume)) {
+        mp_raise_TypeError(NULL);
+    }
+    #if MICROPY_PY_THREAD
+    if (pyb_thread_enabled) {
+        // other threads' stacks can't be saved
+        mp_raise_OSError(MP_EBUSY);
+    }
+    #endif
+    int ret = hibernate_save(resume);
+    if (ret < 0) {
+        mp_raise_OSError(-ret);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_hibernate_obj, machine_hibernate);
+#endif
+
 STATIC mp_obj_t machine_lightsleep(size_t n_args, const mp_obj_t *args) {
     if (n_args != 0) {
         mp_obj_t args2[2] = {MP_OBJ_NULL, args[0]};
@@ -367,11 +446,17 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_soft_reset),          MP_ROM_PTR(&machine_soft_reset_obj) },
     { MP_ROM_QSTR(MP_QSTR_bootloader),          MP_ROM_PTR(&machine_bootloader_obj) },
     { MP_ROM_QSTR(MP_QSTR_freq),                MP_ROM_PTR(&machine_freq_obj) },
+    #if MICROPY_HW_ENABLE_FREQ_POLICY
+    { MP_ROM_QSTR(MP_QSTR_freq_policy),         MP_ROM_PTR(&machine_freq_policy_obj) },
+    #endif
 #if MICROPY_HW_ENABLE_RNG
     { MP_ROM_QSTR(MP_QSTR_rng),                 MP_ROM_PTR(&pyb_rng_get_obj) },
 #endif
     { MP_ROM_QSTR(MP_QSTR_idle),                MP_ROM_PTR(&pyb_wfi_obj) },
     { MP_ROM_QSTR(MP_QSTR_sleep),               MP_ROM_PTR(&machine_lightsleep_obj) },
+    #if MICROPY_HW_ENABLE_HIBERNATE
+    { MP_ROM_QSTR(MP_QSTR_hibernate),           MP_ROM_PTR(&machine_hibernate_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_lightsleep),          MP_ROM_PTR(&machine_lightsleep_obj) },
     { MP_ROM_QSTR(MP_QSTR_deepsleep),           MP_ROM_PTR(&machine_deepsleep_obj) },
     { MP_ROM_QSTR(MP_QSTR_reset_cause),         MP_ROM_PTR(&machine_reset_cause_obj) },
@@ -383,10 +468,18 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_enable_irq),          MP_ROM_PTR(&pyb_enable_irq_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_time_pulse_us),       MP_ROM_PTR(&machine_time_pulse_us_obj) },
+#if MICROPY_PY_MACHINE_BITSTREAM
+    { MP_ROM_QSTR(MP_QSTR_bitstream),           MP_ROM_PTR(&machine_bitstream_obj) },
+#endif
 
     { MP_ROM_QSTR(MP_QSTR_mem8),                MP_ROM_PTR(&machine_mem8_obj) },
     { MP_ROM_QSTR(MP_QSTR_mem16),               MP_ROM_PTR(&machine_mem16_obj) },
     { MP_ROM_QSTR(MP_QSTR_mem32),               MP_ROM_PTR(&machine_mem32_obj) },
+#if MICROPY_PY_MACHINE_MEMCPY
+    { MP_ROM_QSTR(MP_QSTR_memcpy),              MP_ROM_PTR(&machine_memcpy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_memset),              MP_ROM_PTR(&machine_memset_obj) },
+    { MP_ROM_QSTR(MP_QSTR_memwait),             MP_ROM_PTR(&machine_memwait_obj) },
+#endif
 
     { MP_ROM_QSTR(MP_QSTR_Pin),                 MP_ROM_PTR(&pin_type) },
     { MP_ROM_QSTR(MP_QSTR_Signal),              MP_ROM_PTR(&machine_signal_type) },
@@ -399,6 +492,12 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_I2C),                 MP_ROM_PTR(&machine_i2c_type) },
 #endif
     { MP_ROM_QSTR(MP_QSTR_SPI),                 MP_ROM_PTR(&machine_hard_spi_type) },
+#if MICROPY_PY_MACHINE_SDCARD_SPI
+    { MP_ROM_QSTR(MP_QSTR_SDCardSPI),           MP_ROM_PTR(&mp_machine_sdcard_spi_type) },
+#endif
+#if MICROPY_PY_MACHINE_NRF24L01
+    { MP_ROM_QSTR(MP_QSTR_NRF24L01),            MP_ROM_PTR(&mp_machine_nrf24l01_type) },
+#endif
     { MP_ROM_QSTR(MP_QSTR_UART),                MP_ROM_PTR(&pyb_uart_type) },
     { MP_ROM_QSTR(MP_QSTR_WDT),                 MP_ROM_PTR(&pyb_wdt_type) },
 #if 0
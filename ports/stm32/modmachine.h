@@ -30,6 +30,7 @@
 
 void machine_init(void);
 void machine_deinit(void);
+void machine_memcpy_deinit(void);
 
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_info_obj);
 MP_DECLARE_CONST_FUN_OBJ_0(machine_unique_id_obj);
@@ -38,5 +39,9 @@ MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_bootloader_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_freq_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_lightsleep_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_deepsleep_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_bitstream_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_memcpy_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_memset_obj);
+MP_DECLARE_CONST_FUN_OBJ_0(machine_memwait_obj);
 
 #endif // MICROPY_INCLUDED_STM32_MODMACHINE_H
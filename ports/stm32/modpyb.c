@@ -45,13 +45,19 @@
 #include "can.h"
 #include "adc.h"
 #include "storage.h"
+#include "asset.h"
+#include "audio.h"
+#include "jacdac.h"
+#include "keys.h"
 #include "sdcard.h"
 #include "accel.h"
 #include "servo.h"
 #include "dac.h"
 #include "lcd.h"
 #include "screen.h"
+#include "ltdc.h"
 #include "usb.h"
+#include "pybthread.h"
 #include "portmodules.h"
 #include "modmachine.h"
 #include "extmod/vfs.h"
@@ -131,6 +137,36 @@ STATIC mp_obj_t pyb_country(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_country_obj, 0, 1, pyb_country);
 
+#if MICROPY_PY_THREAD
+// Get or set the scheduling priority of the calling thread
+STATIC mp_obj_t pyb_thread_priority(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return MP_OBJ_NEW_SMALL_INT(pyb_thread_cur->priority);
+    }
+    mp_int_t priority = mp_obj_get_int(args[0]);
+    if (priority < 0 || priority > 255) {
+        mp_raise_ValueError(NULL);
+    }
+    pyb_thread_set_priority(priority);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_thread_priority_obj, 0, 1, pyb_thread_priority);
+
+// Get or set the timeslice of the calling thread, in milliseconds
+STATIC mp_obj_t pyb_thread_quantum(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return MP_OBJ_NEW_SMALL_INT(pyb_thread_cur->quantum);
+    }
+    mp_int_t quantum = mp_obj_get_int(args[0]);
+    if (quantum < 1 || quantum > 1000) {
+        mp_raise_ValueError(NULL);
+    }
+    pyb_thread_set_quantum(quantum);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_thread_quantum_obj, 0, 1, pyb_thread_quantum);
+#endif
+
 STATIC const mp_rom_map_elem_t pyb_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_pyb) },
 
@@ -159,12 +195,19 @@ STATIC const mp_rom_map_elem_t pyb_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_main), MP_ROM_PTR(&pyb_main_obj) },
     { MP_ROM_QSTR(MP_QSTR_repl_uart), MP_ROM_PTR(&pyb_repl_uart_obj) },
     { MP_ROM_QSTR(MP_QSTR_country), MP_ROM_PTR(&pyb_country_obj) },
+    #if MICROPY_PY_THREAD
+    { MP_ROM_QSTR(MP_QSTR_thread_priority), MP_ROM_PTR(&pyb_thread_priority_obj) },
+    { MP_ROM_QSTR(MP_QSTR_thread_quantum), MP_ROM_PTR(&pyb_thread_quantum_obj) },
+    #endif
 
     #if MICROPY_HW_ENABLE_USB
     { MP_ROM_QSTR(MP_QSTR_usb_mode), MP_ROM_PTR(&pyb_usb_mode_obj) },
     #if MICROPY_HW_USB_HID
     { MP_ROM_QSTR(MP_QSTR_hid_mouse), MP_ROM_PTR(&pyb_usb_hid_mouse_obj) },
     { MP_ROM_QSTR(MP_QSTR_hid_keyboard), MP_ROM_PTR(&pyb_usb_hid_keyboard_obj) },
+    #if MICROPY_HW_USB_HID_GAMEPAD
+    { MP_ROM_QSTR(MP_QSTR_hid_gamepad), MP_ROM_PTR(&pyb_usb_hid_gamepad_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_USB_HID), MP_ROM_PTR(&pyb_usb_hid_type) },
     #endif
     { MP_ROM_QSTR(MP_QSTR_USB_VCP), MP_ROM_PTR(&pyb_usb_vcp_type) },
@@ -208,6 +251,18 @@ STATIC const mp_rom_map_elem_t pyb_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_Servo), MP_ROM_PTR(&pyb_servo_type) },
 #endif
 
+#if MICROPY_HW_ENABLE_AUDIO
+    { MP_ROM_QSTR(MP_QSTR_Audio), MP_ROM_PTR(&pyb_audio_type) },
+#endif
+
+#if MICROPY_HW_ENABLE_JACDAC
+    { MP_ROM_QSTR(MP_QSTR_Jacdac), MP_ROM_PTR(&pyb_jacdac_type) },
+#endif
+
+#if MICROPY_HW_ENABLE_KEYS
+    { MP_ROM_QSTR(MP_QSTR_Keys), MP_ROM_PTR(&pyb_keys_type) },
+#endif
+
 #if MICROPY_HW_HAS_SWITCH
     { MP_ROM_QSTR(MP_QSTR_Switch), MP_ROM_PTR(&pyb_switch_type) },
 #endif
@@ -216,6 +271,10 @@ STATIC const mp_rom_map_elem_t pyb_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_Flash), MP_ROM_PTR(&pyb_flash_type) },
 #endif
 
+#if MICROPY_HW_ENABLE_ASSETS
+    { MP_ROM_QSTR(MP_QSTR_Asset), MP_ROM_PTR(&pyb_asset_type) },
+#endif
+
 #if MICROPY_HW_ENABLE_SDCARD
     #if MICROPY_PY_PYB_LEGACY
     { MP_ROM_QSTR(MP_QSTR_SD), MP_ROM_PTR(&pyb_sdcard_obj) }, // now obsolete
@@ -258,6 +317,10 @@ STATIC const mp_rom_map_elem_t pyb_module_globals_table[] = {
 #if MICROPY_HW_HAS_SCREEN
     { MP_ROM_QSTR(MP_QSTR_SCREEN), MP_ROM_PTR(&pyb_screen_type) },
 #endif
+
+#if MICROPY_HW_ENABLE_LTDC
+    { MP_ROM_QSTR(MP_QSTR_LTDC), MP_ROM_PTR(&pyb_ltdc_type) },
+#endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(pyb_module_globals, pyb_module_globals_table);
@@ -0,0 +1,35 @@
+# NeoPixel driver for MicroPython on STM32
+# MIT license; Copyright (c) 2016 Damien P. George
+
+from machine import bitstream
+
+
+class NeoPixel:
+    ORDER = (1, 0, 2, 3)
+    # high/low times in ns of a 0 bit and a 1 bit, for 800kHz and 400kHz
+    TIMING = ((400, 850, 800, 450), (500, 2000, 1200, 1300))
+
+    def __init__(self, pin, n, bpp=3, timing=1):
+        self.pin = pin
+        self.n = n
+        self.bpp = bpp
+        self.buf = bytearray(n * bpp)
+        self.pin.init(pin.OUT)
+        self.timing = self.TIMING[0 if timing else 1]
+
+    def __setitem__(self, index, val):
+        offset = index * self.bpp
+        for i in range(self.bpp):
+            self.buf[offset + self.ORDER[i]] = val[i]
+
+    def __getitem__(self, index):
+        offset = index * self.bpp
+        return tuple(self.buf[offset + self.ORDER[i]]
+                     for i in range(self.bpp))
+
+    def fill(self, color):
+        for i in range(self.n):
+            self[i] = color
+
+    def write(self):
+        bitstream(self.pin, 0, self.timing, self.buf)
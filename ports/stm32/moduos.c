@@ -30,6 +30,7 @@
 #include "py/runtime.h"
 #include "py/objtuple.h"
 #include "py/objstr.h"
+#include "py/mphal.h"
 #include "lib/timeutils/timeutils.h"
 #include "lib/oofatfs/ff.h"
 #include "lib/oofatfs/diskio.h"
@@ -40,6 +41,7 @@
 #include "rng.h"
 #include "usb.h"
 #include "uart.h"
+#include "storage.h"
 #include "portmodules.h"
 
 /// \module os - basic "operating system" services
@@ -80,9 +82,27 @@ STATIC mp_obj_t os_uname(void) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(os_uname_obj, os_uname);
 
-/// \function sync()
+/// \function sync([deadline_ms])
 /// Sync all filesystems.
-STATIC mp_obj_t os_sync(void) {
+///
+/// With `deadline_ms`, write back the cache of the internal storage a step at
+/// a time for at most that many milliseconds, idling while the flash is busy
+/// instead of blocking on it.  Returns `True` if the cache is clean, `False`
+/// if the deadline passed first; the rest is written back in the background.
+STATIC mp_obj_t os_sync(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 1) {
+        #if MICROPY_HW_ENABLE_STORAGE
+        mp_uint_t timeout = mp_obj_get_int(args[0]);
+        mp_uint_t start = mp_hal_ticks_ms();
+        while (!storage_flush_step()) {
+            if (mp_hal_ticks_ms() - start >= timeout) {
+                return mp_const_false;
+            }
+            MICROPY_EVENT_POLL_HOOK
+        }
+        #endif
+        return mp_const_true;
+    }
     #if MICROPY_VFS_FAT
     for (mp_vfs_mount_t *vfs = MP_STATE_VM(vfs_mount_table); vfs != NULL; vfs = vfs->next) {
         // this assumes that vfs->obj is fs_user_mount_t with block device functions
@@ -91,7 +111,7 @@ STATIC mp_obj_t os_sync(void) {
     #endif
     return mp_const_none;
 }
-MP_DEFINE_CONST_FUN_OBJ_0(mod_os_sync_obj, os_sync);
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_os_sync_obj, 0, 1, os_sync);
 
 #if MICROPY_HW_ENABLE_RNG
 /// \function urandom(n)
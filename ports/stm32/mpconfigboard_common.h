@@ -62,11 +62,49 @@
 #define MICROPY_HW_ENABLE_ADC (1)
 #endif
 
+// Whether UARTs 1, 2 and 6 can use DMA, by UART.init(..., dma=True); F4 only
+#ifndef MICROPY_HW_UART_DMA
+#define MICROPY_HW_UART_DMA (0)
+#endif
+
+// Whether hardware I2C reads of 8 bytes or more are done by DMA; F4 only
+#ifndef MICROPY_HW_I2C_DMA
+#define MICROPY_HW_I2C_DMA (0)
+#endif
+
+// Whether to enable the Jacdac single-wire bus on UART1, exposed as
+// pyb.Jacdac; needs MICROPY_HW_UART_DMA for the USART1 DMA streams
+#ifndef MICROPY_HW_ENABLE_JACDAC
+#define MICROPY_HW_ENABLE_JACDAC (0)
+#endif
+
+// Number of frames that pyb.Jacdac queues each way
+#ifndef MICROPY_HW_JACDAC_QUEUE
+#define MICROPY_HW_JACDAC_QUEUE (4)
+#endif
+
+// Whether to enable background circular-DMA sampling on ADC1, exposed as
+// ADC.capture(); F4 only
+#ifndef MICROPY_HW_ENABLE_ADC_CAPTURE
+#define MICROPY_HW_ENABLE_ADC_CAPTURE (0)
+#endif
+
 // Whether to enable the DAC peripheral, exposed as pyb.DAC
 #ifndef MICROPY_HW_ENABLE_DAC
 #define MICROPY_HW_ENABLE_DAC (0)
 #endif
 
+// Whether to use the DMA2D for framebuf fills and blits
+#ifndef MICROPY_HW_ENABLE_DMA2D
+#define MICROPY_HW_ENABLE_DMA2D (0)
+#endif
+
+// Whether to provide pyb.LTDC for a parallel RGB display; the board defines
+// the MICROPY_HW_LTDC_xxx panel settings, and SDRAM holds the framebuffers
+#ifndef MICROPY_HW_ENABLE_LTDC
+#define MICROPY_HW_ENABLE_LTDC (0)
+#endif
+
 // Whether to enable the DCMI peripheral
 #ifndef MICROPY_HW_ENABLE_DCMI
 #define MICROPY_HW_ENABLE_DCMI (0)
@@ -82,6 +120,67 @@
 #define MICROPY_HW_ENABLE_SERVO (0)
 #endif
 
+// Whether to enable sample playback on the PA2 (TIM5 CH3) PWM output using
+// DMA, exposed as pyb.Audio; F4 only
+#ifndef MICROPY_HW_ENABLE_AUDIO
+#define MICROPY_HW_ENABLE_AUDIO (0)
+#endif
+
+// Number of voices mixed by pyb.Audio.voice()
+#ifndef MICROPY_HW_AUDIO_VOICES
+#define MICROPY_HW_AUDIO_VOICES (4)
+#endif
+
+// Whether to scan buttons from systick, exposed as pyb.Keys.  The board
+// gives MICROPY_HW_KEY_PINS, an initialiser for an array of up to 16 pins,
+// and MICROPY_HW_KEY_NAMES, locals dict entries naming their indices.
+#ifndef MICROPY_HW_ENABLE_KEYS
+#define MICROPY_HW_ENABLE_KEYS (0)
+#endif
+
+#ifndef MICROPY_HW_KEY_PULL
+#define MICROPY_HW_KEY_PULL (MP_HAL_PIN_PULL_UP)
+#endif
+
+#ifndef MICROPY_HW_KEY_PRESSED
+#define MICROPY_HW_KEY_PRESSED (0)
+#endif
+
+// Whether mp_hal_delay_ms stretches SysTick over the wait, so the CPU isn't
+// woken every ms while it sleeps
+#ifndef MICROPY_HW_ENABLE_TICKLESS_IDLE
+#define MICROPY_HW_ENABLE_TICKLESS_IDLE (0)
+#endif
+
+// Whether machine.freq_policy is available, to run at a low clock while idle
+// and boost it on demand
+#ifndef MICROPY_HW_ENABLE_FREQ_POLICY
+#define MICROPY_HW_ENABLE_FREQ_POLICY (0)
+#endif
+
+// Whether to leave mounting the filesystems to their first access when a
+// frozen main.py is run at power-up, so it starts without waiting for them
+#ifndef MICROPY_HW_FAST_BOOT
+#define MICROPY_HW_FAST_BOOT (0)
+#endif
+
+// Whether machine.hibernate is available, to save the heap to the flash
+// filesystem and resume from it at the next boot
+#ifndef MICROPY_HW_ENABLE_HIBERNATE
+#define MICROPY_HW_ENABLE_HIBERNATE (0)
+#endif
+
+// The file on the flash filesystem that holds the hibernation image
+#ifndef MICROPY_HW_HIBERNATE_FILE
+#define MICROPY_HW_HIBERNATE_FILE "/.hibernate"
+#endif
+
+// Number of soft ExtInt and Pin.irq callbacks that can be waiting to run,
+// less one
+#ifndef MICROPY_HW_EXTINT_EVENTS
+#define MICROPY_HW_EXTINT_EVENTS (16)
+#endif
+
 // Whether to enable a USR switch, exposed as pyb.Switch
 #ifndef MICROPY_HW_HAS_SWITCH
 #define MICROPY_HW_HAS_SWITCH (0)
@@ -92,6 +191,20 @@
 #define MICROPY_HW_HAS_FLASH (0)
 #endif
 
+// Whether to enable the read-only asset image, exposed as pyb.Asset.  The
+// board gives its size as MICROPY_HW_ASSETS_SIZE and either a memory mapped
+// MICROPY_HW_ASSETS_ADDR, or MICROPY_HW_ASSETS_SPIFLASH and the offset in
+// that flash as MICROPY_HW_ASSETS_SPIFLASH_ADDR.
+#ifndef MICROPY_HW_ENABLE_ASSETS
+#define MICROPY_HW_ENABLE_ASSETS (0)
+#endif
+
+// Whether pyb.Asset can be given to pyb.usb_mode(msc=...) as a USB drive that
+// programs the SPI flash asset partition from a copied UF2 file
+#ifndef MICROPY_HW_ASSETS_UF2
+#define MICROPY_HW_ASSETS_UF2 (0)
+#endif
+
 // Whether to enable the SD card interface, exposed as pyb.SDCard
 #ifndef MICROPY_HW_ENABLE_SDCARD
 #define MICROPY_HW_ENABLE_SDCARD (0)
@@ -107,6 +220,12 @@
 #define MICROPY_HW_SDMMC_BUS_WIDTH (4)
 #endif
 
+// Number of blocks read ahead when the filesystem reads the SD card in
+// sequence, held in a static buffer (0 to disable)
+#ifndef MICROPY_HW_SDCARD_READAHEAD_BLOCKS
+#define MICROPY_HW_SDCARD_READAHEAD_BLOCKS (0)
+#endif
+
 // Whether to automatically mount (and boot from) the SD card if it's present
 #ifndef MICROPY_HW_SDCARD_MOUNT_AT_BOOT
 #define MICROPY_HW_SDCARD_MOUNT_AT_BOOT (MICROPY_HW_ENABLE_SDCARD)
@@ -138,6 +257,14 @@
 #define MICROPY_HEAP_END &_heap_end
 #endif
 
+// A board can give the heap RAM that isn't contiguous with the main heap
+// by defining MICROPY_HEAP2_START and MICROPY_HEAP2_END.  Python buffers
+// may be used for DMA, so the RAM must be reachable by the DMA controllers,
+// which rules out CCM on F4.
+#if defined(MICROPY_HEAP2_START)
+#define MICROPY_GC_SPLIT_HEAP (1)
+#endif
+
 // Configuration for STM32F0 series
 #if defined(STM32F0)
 
@@ -298,6 +425,42 @@
 #define MICROPY_HW_USB_HID (MICROPY_HW_ENABLE_USB)
 #endif
 
+// Whether USB HID can send the pyb.Keys buttons as gamepad reports by itself,
+// at every poll of the host.  The board may give MICROPY_HW_KEY_DPAD, the
+// indices of its up, down, left and right keys, to drive the X/Y axes.
+#ifndef MICROPY_HW_USB_HID_GAMEPAD
+#define MICROPY_HW_USB_HID_GAMEPAD (0)
+#endif
+#if MICROPY_HW_USB_HID_GAMEPAD && !(MICROPY_HW_USB_HID && MICROPY_HW_ENABLE_KEYS)
+#error "MICROPY_HW_USB_HID_GAMEPAD requires MICROPY_HW_USB_HID and MICROPY_HW_ENABLE_KEYS"
+#endif
+
+// Whether sections of C code wrapped in MP_HAL_CYCLES_START/STOP, such as
+// gc_collect and spi_transfer, count the CPU cycles they take, for
+// machine.info() to print.  Needs the DWT cycle counter of Cortex-M3 and up.
+#ifndef MICROPY_HW_CYCLE_STATS
+#define MICROPY_HW_CYCLE_STATS (0)
+#endif
+
+// Whether pyb.Timer.latency() can measure how long after a timer event its
+// IRQ handler, a PendSV dispatch and a scheduled callback run.  Needs the DWT
+// cycle counter of Cortex-M3 and up.
+#ifndef MICROPY_HW_IRQ_LATENCY
+#define MICROPY_HW_IRQ_LATENCY (0)
+#endif
+
+// Whether SCREEN.overlay() can draw frame timing stats into the corner of
+// each frame sent by show()
+#ifndef MICROPY_HW_SCREEN_OVERLAY
+#define MICROPY_HW_SCREEN_OVERLAY (0)
+#endif
+
+// Whether to place mp_execute_bytecode and gc_mark_subtree in SRAM, to run
+// them without flash wait states; costs RAM equal to their code size
+#ifndef MICROPY_HW_RAMFUNC_HOT
+#define MICROPY_HW_RAMFUNC_HOT (0)
+#endif
+
 // Pin definition header file
 #define MICROPY_PIN_DEFS_PORT_H "pin_defs_stm32.h"
 
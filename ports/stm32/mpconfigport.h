@@ -40,9 +40,16 @@
 #endif
 #endif
 #define MICROPY_ALLOC_PATH_MAX      (128)
+#define MICROPY_ALLOC_VSTR_GROW_MAX (1024)
+#define MICROPY_GC_FREE_LISTS       (8)
+#define MICROPY_GC_INCREMENTAL      (1)
+#define MICROPY_GC_ARENA            (1)
+#define MICROPY_GC_LARGE_ALLOC      (1024)
+#define MICROPY_QSTR_INDEX          (1)
 
 // emitters
 #define MICROPY_PERSISTENT_CODE_LOAD (1)
+#define MICROPY_PERSISTENT_CODE_LOAD_XIP (1)
 #ifndef MICROPY_EMIT_THUMB
 #define MICROPY_EMIT_THUMB          (1)
 #endif
@@ -58,7 +65,14 @@
 // optimisations
 #define MICROPY_OPT_COMPUTED_GOTO   (1)
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
+#define MICROPY_OPT_VM_SMALL_INT (1)
+#define MICROPY_OPT_SUPERINSTRUCTIONS (1)
+#define MICROPY_OPT_MAP_LOOKUP_CACHE (1)
+#define MICROPY_OPT_ROM_MAP_LOOKUP_CACHE (1)
+#define MICROPY_OPT_MAP_ORDERED_INDEX (1)
 #define MICROPY_OPT_MPZ_BITWISE     (1)
+#define MICROPY_OPT_MPZ_FAST_MUL    (1)
+#define MICROPY_OPT_FAST_FLOAT      (1)
 #define MICROPY_OPT_MATH_FACTORIAL  (1)
 
 // Python internal features
@@ -68,6 +82,7 @@
 #define MICROPY_STACK_CHECK         (1)
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF (1)
 #define MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE (0)
+#define MICROPY_EXC_TRACEBACK_LAZY  (1)
 #define MICROPY_KBD_EXCEPTION       (1)
 #define MICROPY_HELPER_REPL         (1)
 #define MICROPY_REPL_EMACS_KEYS     (1)
@@ -77,6 +92,12 @@
 #ifndef MICROPY_FLOAT_IMPL // can be configured by each board via mpconfigboard.mk
 #define MICROPY_FLOAT_IMPL          (MICROPY_FLOAT_IMPL_FLOAT)
 #endif
+// A board can define this as MICROPY_OBJ_REPR_C to store floats in the object
+// word instead of on the heap, with 2 fewer bits of mantissa; this needs
+// single-precision floats
+#ifndef MICROPY_OBJ_REPR
+#define MICROPY_OBJ_REPR            (MICROPY_OBJ_REPR_A)
+#endif
 #define MICROPY_STREAMS_NON_BLOCK   (1)
 #define MICROPY_MODULE_WEAK_LINKS   (1)
 #define MICROPY_CAN_OVERRIDE_BUILTINS (1)
@@ -92,6 +113,7 @@
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
 #define MICROPY_PY_DESCRIPTORS      (1)
 #define MICROPY_PY_DELATTR_SETATTR  (1)
+#define MICROPY_PY_GENERATOR_RELEASE_STATE (1)
 #define MICROPY_PY_BUILTINS_STR_UNICODE (1)
 #define MICROPY_PY_BUILTINS_STR_CENTER (1)
 #define MICROPY_PY_BUILTINS_STR_PARTITION (1)
@@ -111,7 +133,11 @@
 #define MICROPY_PY_BUILTINS_HELP_MODULES (1)
 #define MICROPY_PY_MICROPYTHON_MEM_INFO (1)
 #define MICROPY_PY_ARRAY_SLICE_ASSIGN (1)
+#define MICROPY_PY_ARRAY_OPS        (1)
+#define MICROPY_PY_STRUCT_STRUCT    (1)
 #define MICROPY_PY_COLLECTIONS_DEQUE (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_ITER (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR (1)
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (1)
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS (1)
 #define MICROPY_PY_MATH_FACTORIAL   (1)
@@ -126,6 +152,7 @@
 #ifndef MICROPY_PY_SYS_PLATFORM     // let boards override it if they want
 #define MICROPY_PY_SYS_PLATFORM     "pyboard"
 #endif
+#define MICROPY_PY_GC_FRAGMENTATION (1)
 #define MICROPY_PY_UERRNO           (1)
 #ifndef MICROPY_PY_THREAD
 #define MICROPY_PY_THREAD           (0)
@@ -134,19 +161,31 @@
 // extended modules
 #define MICROPY_PY_UCTYPES          (1)
 #define MICROPY_PY_UZLIB            (1)
+#define MICROPY_PY_UZLIB_LOOKUP_BITS (9)
+#define MICROPY_PY_UZLIB_COMPRESS   (1)
 #define MICROPY_PY_UJSON            (1)
+#define MICROPY_PY_UJSON_DECODER    (1)
 #define MICROPY_PY_URE              (1)
 #define MICROPY_PY_URE_SUB          (1)
+#define MICROPY_PY_URE_CACHE_SIZE   (4)
+#define MICROPY_PY_URE_PIKEVM       (1)
 #define MICROPY_PY_UHEAPQ           (1)
 #define MICROPY_PY_UHASHLIB         (1)
 #define MICROPY_PY_UHASHLIB_MD5     (MICROPY_PY_USSL)
 #define MICROPY_PY_UHASHLIB_SHA1    (MICROPY_PY_USSL)
+#define MICROPY_PY_UHASHLIB_CRC32   (1)
+#ifndef MICROPY_PY_UCRYPTOLIB
 #define MICROPY_PY_UCRYPTOLIB       (MICROPY_PY_USSL)
+#endif
 #define MICROPY_PY_UBINASCII        (1)
+#define MICROPY_PY_UBINASCII_CRC32  (1)
+#define MICROPY_PY_USSL_SESSION_CACHE_SIZE (2)
 #define MICROPY_PY_URANDOM          (1)
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS (1)
 #define MICROPY_PY_USELECT          (1)
+#define MICROPY_PY_USELECT_NOTIFY   (1)
 #define MICROPY_PY_UTIMEQ           (1)
+#define MICROPY_PY_UASYNCIO         (1)
 #define MICROPY_PY_UTIME_MP_HAL     (1)
 #define MICROPY_PY_OS_DUPTERM       (3)
 #define MICROPY_PY_UOS_DUPTERM_BUILTIN_STREAM (1)
@@ -162,6 +201,30 @@
 #define MICROPY_PY_MACHINE_SPI_MSB  (SPI_FIRSTBIT_MSB)
 #define MICROPY_PY_MACHINE_SPI_LSB  (SPI_FIRSTBIT_LSB)
 #define MICROPY_PY_MACHINE_SPI_MAKE_NEW machine_hard_spi_make_new
+#define MICROPY_PY_MACHINE_DISPLAY  (MICROPY_HW_HAS_SCREEN)
+#define MICROPY_PY_MACHINE_AUDIO    (MICROPY_HW_ENABLE_AUDIO)
+#ifndef MICROPY_PY_MACHINE_SDCARD_SPI
+#define MICROPY_PY_MACHINE_SDCARD_SPI (1)
+#endif
+#ifndef MICROPY_PY_MACHINE_NRF24L01
+#define MICROPY_PY_MACHINE_NRF24L01 (1)
+#endif
+#ifndef MICROPY_PY_MACHINE_MEMCPY
+// needs a DMA that can do memory-to-memory, which is DMA2 of F4 and F7
+#if defined(STM32F4) || defined(STM32F7)
+#define MICROPY_PY_MACHINE_MEMCPY (1)
+#else
+#define MICROPY_PY_MACHINE_MEMCPY (0)
+#endif
+#endif
+#ifndef MICROPY_PY_MACHINE_BITSTREAM
+// needs the timer update DMA requests, which are only mapped for F4 and F7
+#if defined(STM32F4) || defined(STM32F7)
+#define MICROPY_PY_MACHINE_BITSTREAM (1)
+#else
+#define MICROPY_PY_MACHINE_BITSTREAM (0)
+#endif
+#endif
 #define MICROPY_HW_SOFTSPI_MIN_DELAY (0)
 #define MICROPY_HW_SOFTSPI_MAX_BAUDRATE (HAL_RCC_GetSysClockFreq() / 48)
 #define MICROPY_PY_UWEBSOCKET       (MICROPY_PY_LWIP)
@@ -182,6 +245,7 @@
 #define MICROPY_FATFS_USE_LABEL        (1)
 #define MICROPY_FATFS_RPATH            (2)
 #define MICROPY_FATFS_MULTI_PARTITION  (1)
+#define MICROPY_FATFS_USE_FASTSEEK     (1)
 
 // TODO these should be generic, not bound to fatfs
 #define mp_type_fileio mp_type_vfs_fat_fileio
@@ -314,6 +378,29 @@ extern const struct _mp_obj_module_t mp_module_onewire;
     /* pointers to all CAN objects (if they have been created) */ \
     struct _pyb_can_obj_t *pyb_can_obj_all[MICROPY_HW_MAX_CAN]; \
     \
+    /* the SCREEN object, which a non-blocking show() refers to */ \
+    struct _pyb_screen_obj_t *pyb_screen_obj; \
+    \
+    /* the LTDC display object, which holds its framebuffers */ \
+    struct _pyb_ltdc_obj_t *pyb_ltdc_obj; \
+    \
+    /* buffers being sent by SPI.write_async(), per SPI bus */ \
+    mp_obj_t spi_async_buf[6]; \
+    \
+    /* the Audio object, whose buffers the DMA is reading */ \
+    struct _pyb_audio_obj_t *pyb_audio_obj; \
+    \
+    /* the ADC object, buffer and callback of a running ADC.capture() */ \
+    struct _pyb_obj_adc_t *pyb_adc_capture_obj; \
+    mp_obj_t pyb_adc_capture_buf; \
+    mp_obj_t pyb_adc_capture_callback; \
+    \
+    /* the Jacdac bus, whose frames the DMA is reading and writing */ \
+    struct _pyb_jacdac_obj_t *pyb_jacdac_obj; \
+    \
+    /* destination and source of a running machine.memcpy() or memset() */ \
+    mp_obj_t machine_memcpy_buf[2]; \
+    \
     /* list of registered NICs */ \
     mp_obj_list_t mod_network_nic_list; \
     \
@@ -325,6 +412,16 @@ extern const struct _mp_obj_module_t mp_module_onewire;
 
 #define MP_SSIZE_MAX (0x7fffffff)
 
+#if MICROPY_HW_RAMFUNC_HOT
+// Run the VM loop and GC marking from SRAM; the .ramfunc section is copied
+// there with .data at reset.  noinline stops them being inlined into flash.
+#define MICROPY_HW_RAMFUNC __attribute__((section(".ramfunc"), noinline))
+#define MICROPY_WRAP_MP_EXECUTE_BYTECODE(f) MICROPY_HW_RAMFUNC f
+#define MICROPY_WRAP_GC_MARK_SUBTREE(f) MICROPY_HW_RAMFUNC f
+// Frozen code that mpy-tool.py marked hot from a profile also goes in SRAM.
+#define MICROPY_FROZEN_HOT_ATTR __attribute__((section(".ramfunc.frozen")))
+#endif
+
 #define UINT_FMT "%u"
 #define INT_FMT "%d"
 
@@ -370,6 +467,12 @@ static inline mp_uint_t disable_irq(void) {
     } while (0);
 
 #define MICROPY_THREAD_YIELD() pyb_thread_yield()
+
+// For C code that waits on a peripheral, eg for a DMA transfer to finish:
+// other threads can run during the wait if the GIL was released
+#define MICROPY_HW_WAIT_BEGIN() mp_thread_hw_wait_begin()
+#define MICROPY_HW_WAIT_IDLE(released) do { if (released) { pyb_thread_yield(); } else { __WFI(); } } while (0)
+#define MICROPY_HW_WAIT_END(released) mp_thread_hw_wait_end(released)
 #else
 #define MICROPY_EVENT_POLL_HOOK \
     do { \
@@ -379,6 +482,31 @@ static inline mp_uint_t disable_irq(void) {
     } while (0);
 
 #define MICROPY_THREAD_YIELD()
+
+#define MICROPY_HW_WAIT_BEGIN() (false)
+#define MICROPY_HW_WAIT_IDLE(released) __WFI()
+#define MICROPY_HW_WAIT_END(released) (void)(released)
+#endif
+
+#if MICROPY_HW_FAST_BOOT
+// the filesystems may be mounted at their first use, see main.c
+#define MICROPY_VFS_LAZY_MOUNT_HOOK() \
+    do { \
+        extern void pyb_fs_lazy_mount(void); \
+        pyb_fs_lazy_mount(); \
+    } while (0)
+#endif
+
+// CRC32 calculations use the CRC unit, see crc.c
+#define MICROPY_CRC32_UPDATE(crc, buf, len) crc32_update((crc), (buf), (len))
+uint32_t crc32_update(uint32_t crc, const void *buf, size_t len);
+
+#if MICROPY_HW_ENABLE_DMA2D
+// framebuf fills and blits use the DMA2D, see dma2d.c
+#include "dma2d.h"
+#define MICROPY_FRAMEBUF_HW_FILL_RGB565 dma2d_fill_rgb565
+#define MICROPY_FRAMEBUF_HW_COPY_RGB565 dma2d_copy_rgb565
+#define MICROPY_FRAMEBUF_HW_COPY_L8_RGB565 dma2d_copy_l8_rgb565
 #endif
 
 // The LwIP interface must run at a raised IRQ priority
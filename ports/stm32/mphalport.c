@@ -100,6 +100,30 @@ void mp_hal_ticks_cpu_enable(void) {
 }
 #endif
 
+#if MICROPY_HW_CYCLE_STATS
+mp_hal_cycles_t mp_hal_cycles_gc_collect;
+mp_hal_cycles_t mp_hal_cycles_spi_transfer;
+
+void mp_hal_cycles_add(mp_hal_cycles_t *cycles, uint32_t n) {
+    cycles->count += 1;
+    cycles->total += n;
+    if (n > cycles->max) {
+        cycles->max = n;
+    }
+}
+
+STATIC void mp_hal_cycles_print_one(const char *name, const mp_hal_cycles_t *cycles) {
+    uint32_t mean = cycles->count == 0 ? 0 : cycles->total / cycles->count;
+    mp_printf(&mp_plat_print, "  %s: n=%u mean=%u max=%u\n", name, (uint)cycles->count, (uint)mean, (uint)cycles->max);
+}
+
+void mp_hal_cycles_print(void) {
+    mp_printf(&mp_plat_print, "cycles:\n");
+    mp_hal_cycles_print_one("gc_collect", &mp_hal_cycles_gc_collect);
+    mp_hal_cycles_print_one("spi_transfer", &mp_hal_cycles_spi_transfer);
+}
+#endif
+
 void mp_hal_gpio_clock_enable(GPIO_TypeDef *gpio) {
     #if defined(STM32L476xx) || defined(STM32L496xx)
     if (gpio == GPIOG) {
@@ -21,18 +21,49 @@ void mp_hal_set_interrupt_char(int c); // -1 to disable
 #endif
 #define mp_hal_delay_us_fast(us) mp_hal_delay_us(us)
 
+// Falling edges on a pin are timed in the background by its ExtInt line, so
+// drivers/dht doesn't need interrupts disabled to read the sensor
+int extint_capture_start(const pin_obj_t *pin, uint32_t *buf, size_t n);
+size_t extint_capture_count(void);
+void extint_capture_stop(void);
+#define mp_hal_pin_capture_start(pin, buf, n) extint_capture_start((pin), (buf), (n))
+#define mp_hal_pin_capture_count() extint_capture_count()
+#define mp_hal_pin_capture_stop() extint_capture_stop()
+
+// The DWT cycle counter is enabled at boot, so reading it is a single load
 void mp_hal_ticks_cpu_enable(void);
 static inline mp_uint_t mp_hal_ticks_cpu(void) {
     #if __CORTEX_M == 0
     return 0;
     #else
-    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
-        mp_hal_ticks_cpu_enable();
-    }
     return DWT->CYCCNT;
     #endif
 }
 
+#if MICROPY_HW_CYCLE_STATS
+// CPU cycles spent in an instrumented section of C code, used like:
+//     MP_HAL_CYCLES_START(t0);
+//     ...
+//     MP_HAL_CYCLES_STOP(t0, &mp_hal_cycles_gc_collect);
+typedef struct _mp_hal_cycles_t {
+    uint32_t count;
+    uint32_t max;
+    uint64_t total;
+} mp_hal_cycles_t;
+
+extern mp_hal_cycles_t mp_hal_cycles_gc_collect;
+extern mp_hal_cycles_t mp_hal_cycles_spi_transfer;
+
+void mp_hal_cycles_add(mp_hal_cycles_t *cycles, uint32_t n);
+void mp_hal_cycles_print(void);
+
+#define MP_HAL_CYCLES_START(t0) uint32_t t0 = DWT->CYCCNT
+#define MP_HAL_CYCLES_STOP(t0, cycles) mp_hal_cycles_add((cycles), DWT->CYCCNT - (t0))
+#else
+#define MP_HAL_CYCLES_START(t0)
+#define MP_HAL_CYCLES_STOP(t0, cycles)
+#endif
+
 // C-level pin HAL
 
 #include "pin.h"
@@ -84,6 +84,27 @@ void mp_thread_create(void *(*entry)(void*), void *arg, size_t *stack_size) {
     *stack_size -= 1024;
 }
 
+bool mp_thread_hw_wait_begin(void) {
+    // A thread switch needs PendSV, so the GIL is kept when in an interrupt
+    // handler, where it belongs to the interrupted thread, and when IRQs are
+    // masked, eg by spi_bdev, which keeps other users off the bus that way.
+    if (!pyb_thread_enabled || __get_IPSR() != 0 || __get_PRIMASK() != 0
+        #if __CORTEX_M != 0
+        || __get_BASEPRI() != 0
+        #endif
+        ) {
+        return false;
+    }
+    MP_THREAD_GIL_EXIT();
+    return true;
+}
+
+void mp_thread_hw_wait_end(bool released) {
+    if (released) {
+        MP_THREAD_GIL_ENTER();
+    }
+}
+
 void mp_thread_start(void) {
 }
 
@@ -32,6 +32,11 @@ typedef pyb_mutex_t mp_thread_mutex_t;
 void mp_thread_init(void);
 void mp_thread_gc_others(void);
 
+// Release the GIL, if a thread switch can happen here, for a wait for
+// hardware that doesn't touch Python objects; returns whether it did
+bool mp_thread_hw_wait_begin(void);
+void mp_thread_hw_wait_end(bool released);
+
 static inline void mp_thread_set_state(void *state) {
     pyb_thread_set_local(state);
 }
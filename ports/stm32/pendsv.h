@@ -33,10 +33,13 @@ enum {
     PENDSV_DISPATCH_CYW43,
     #endif
     #endif
+    #if MICROPY_HW_IRQ_LATENCY
+    PENDSV_DISPATCH_IRQ_LATENCY,
+    #endif
     PENDSV_DISPATCH_MAX
 };
 
-#if MICROPY_PY_NETWORK && MICROPY_PY_LWIP
+#if (MICROPY_PY_NETWORK && MICROPY_PY_LWIP) || MICROPY_HW_IRQ_LATENCY
 #define PENDSV_DISPATCH_NUM_SLOTS PENDSV_DISPATCH_MAX
 #endif
 
@@ -37,7 +37,7 @@ extern const mp_obj_module_t mp_module_usocket;
 MP_DECLARE_CONST_FUN_OBJ_1(time_sleep_ms_obj);
 MP_DECLARE_CONST_FUN_OBJ_1(time_sleep_us_obj);
 
-MP_DECLARE_CONST_FUN_OBJ_0(mod_os_sync_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mod_os_sync_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mod_os_dupterm_obj);
 
 #endif // MICROPY_INCLUDED_STM32_PORTMODULES_H
@@ -44,6 +44,16 @@
 extern uint32_t _estack[];
 #define BL_STATE ((uint32_t*)&_estack)
 
+powerctrl_clock_notify_t powerctrl_clock_notify_table[POWERCTRL_CLOCK_NOTIFY_MAX];
+
+void powerctrl_clock_notify(int event) {
+    for (size_t i = 0; i < POWERCTRL_CLOCK_NOTIFY_MAX; ++i) {
+        if (powerctrl_clock_notify_table[i] != NULL) {
+            powerctrl_clock_notify_table[i](event);
+        }
+    }
+}
+
 NORETURN void powerctrl_mcu_reset(void) {
     BL_STATE[1] = 1; // invalidate bootloader address
     #if __DCACHE_PRESENT == 1
@@ -223,9 +233,14 @@ int powerctrl_set_sysclk(uint32_t sysclk, uint32_t ahb, uint32_t apb1, uint32_t
     return -MP_EINVAL;
 
 set_clk:
+    // Let drivers finish what they are doing at the old clocks
+    powerctrl_clock_notify(POWERCTRL_CLOCKS_CHANGING);
+
     // Let the USB CDC have a chance to process before we change the clock
     mp_hal_delay_ms(5);
 
+    int ret = 0;
+
     // Desired system clock source is in sysclk_source
     RCC_ClkInitTypeDef RCC_ClkInitStruct;
     RCC_ClkInitStruct.ClockType = (RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2);
@@ -260,7 +275,8 @@ set_clk:
 
     // Configure clock
     if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_1) != HAL_OK) {
-        return -MP_EIO;
+        ret = -MP_EIO;
+        goto done;
     }
 
     #if defined(STM32F7)
@@ -284,15 +300,16 @@ set_clk:
     RCC_OscInitStruct.PLL.PLLP = p;
     RCC_OscInitStruct.PLL.PLLQ = q;
     if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) {
-        return -MP_EIO;
+        ret = -MP_EIO;
+        goto done;
     }
 
     // Set PLL as system clock source if wanted
     if (sysclk_source == RCC_SYSCLKSOURCE_PLLCLK) {
         RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_SYSCLK;
-        int ret = powerctrl_rcc_clock_config_pll(&RCC_ClkInitStruct, sysclk_mhz, need_pllsai);
+        ret = powerctrl_rcc_clock_config_pll(&RCC_ClkInitStruct, sysclk_mhz, need_pllsai);
         if (ret != 0) {
-            return ret;
+            goto done;
         }
     }
 
@@ -314,9 +331,90 @@ set_clk:
         | (b2 << 29);
     #endif
 
+done:
+    // Whatever clocks we ended up with, let drivers re-derive their timings
+    powerctrl_clock_notify(POWERCTRL_CLOCKS_CHANGED);
+
+    return ret;
+}
+
+#if MICROPY_HW_ENABLE_FREQ_POLICY
+
+/******************************************************************************/
+// Frequency policy: run at a low clock while idle and boost on demand
+
+typedef struct _powerctrl_freq_policy_t {
+    uint32_t idle_hz;
+    uint32_t boost_hz;
+    uint32_t hold_ms;
+    uint32_t boost_ticks; // when a boost was last asked for
+    bool enabled;
+    bool boosted;
+    bool changing; // powerctrl_set_sysclk itself waits with mp_hal_delay_ms
+} powerctrl_freq_policy_t;
+
+STATIC powerctrl_freq_policy_t freq_policy;
+
+STATIC int powerctrl_freq_policy_set(uint32_t sysclk) {
+    // use the same bus dividers as machine.freq does by default
+    freq_policy.changing = true;
+    int ret = powerctrl_set_sysclk(sysclk, sysclk, sysclk / 4, sysclk / 2);
+    freq_policy.changing = false;
+    return ret;
+}
+
+int powerctrl_freq_policy_enable(uint32_t idle_hz, uint32_t boost_hz, uint32_t hold_ms) {
+    freq_policy.enabled = false;
+    // check both frequencies can be set, ending up at the idle one
+    int ret = powerctrl_freq_policy_set(boost_hz);
+    if (ret == 0) {
+        ret = powerctrl_freq_policy_set(idle_hz);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    freq_policy.idle_hz = idle_hz;
+    freq_policy.boost_hz = boost_hz;
+    freq_policy.hold_ms = hold_ms;
+    freq_policy.boosted = false;
+    freq_policy.enabled = true;
     return 0;
 }
 
+void powerctrl_freq_policy_disable(void) {
+    freq_policy.enabled = false;
+}
+
+bool powerctrl_freq_policy_get(uint32_t *idle_hz, uint32_t *boost_hz, uint32_t *hold_ms) {
+    *idle_hz = freq_policy.idle_hz;
+    *boost_hz = freq_policy.boost_hz;
+    *hold_ms = freq_policy.hold_ms;
+    return freq_policy.enabled;
+}
+
+void powerctrl_freq_boost(void) {
+    if (!freq_policy.enabled || freq_policy.changing) {
+        return;
+    }
+    freq_policy.boost_ticks = mp_hal_ticks_ms();
+    if (!freq_policy.boosted) {
+        freq_policy.boosted = true;
+        powerctrl_freq_policy_set(freq_policy.boost_hz);
+    }
+}
+
+void powerctrl_freq_idle(void) {
+    if (!freq_policy.enabled || freq_policy.changing || !freq_policy.boosted) {
+        return;
+    }
+    if (mp_hal_ticks_ms() - freq_policy.boost_ticks >= freq_policy.hold_ms) {
+        freq_policy.boosted = false;
+        powerctrl_freq_policy_set(freq_policy.idle_hz);
+    }
+}
+
+#endif // MICROPY_HW_ENABLE_FREQ_POLICY
+
 #endif
 
 void powerctrl_enter_stop_mode(void) {
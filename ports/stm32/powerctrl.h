@@ -39,4 +39,37 @@ int powerctrl_set_sysclk(uint32_t sysclk, uint32_t ahb, uint32_t apb1, uint32_t
 void powerctrl_enter_stop_mode(void);
 void powerctrl_enter_standby_mode(void);
 
+// Drivers that derive their timings from the bus clocks are told when
+// powerctrl_set_sysclk changes them: with POWERCTRL_CLOCKS_CHANGING while the
+// old clocks still run, to finish transfers and save what they need, then with
+// POWERCTRL_CLOCKS_CHANGED to re-derive prescalers, baudrates and periods.
+enum {
+    POWERCTRL_CLOCKS_CHANGING,
+    POWERCTRL_CLOCKS_CHANGED,
+};
+
+enum {
+    POWERCTRL_CLOCK_NOTIFY_UART = 0,
+    POWERCTRL_CLOCK_NOTIFY_SPI,
+    POWERCTRL_CLOCK_NOTIFY_TIMER,
+    POWERCTRL_CLOCK_NOTIFY_MAX
+};
+
+typedef void (*powerctrl_clock_notify_t)(int event);
+
+extern powerctrl_clock_notify_t powerctrl_clock_notify_table[POWERCTRL_CLOCK_NOTIFY_MAX];
+
+void powerctrl_clock_notify(int event);
+
+#if MICROPY_HW_ENABLE_FREQ_POLICY
+// Run at idle_hz, and switch to boost_hz when a driver asks for it with
+// powerctrl_freq_boost, going back once there was no such request for hold_ms
+// and mp_hal_delay_ms is waiting.  Both are called in thread context only.
+int powerctrl_freq_policy_enable(uint32_t idle_hz, uint32_t boost_hz, uint32_t hold_ms);
+void powerctrl_freq_policy_disable(void);
+bool powerctrl_freq_policy_get(uint32_t *idle_hz, uint32_t *boost_hz, uint32_t *hold_ms);
+void powerctrl_freq_boost(void);
+void powerctrl_freq_idle(void);
+#endif
+
 #endif // MICROPY_INCLUDED_STM32_POWERCTRL_H
@@ -28,6 +28,7 @@
 #include <stdio.h>
 
 #include "py/obj.h"
+#include "py/stackctrl.h"
 #include "gccollect.h"
 #include "irq.h"
 #include "pybthread.h"
@@ -72,6 +73,9 @@ void pyb_thread_init(pyb_thread_t *thread) {
     thread->arg = NULL;
     thread->stack = &_sstack;
     thread->stack_len = ((uint32_t)&_estack - (uint32_t)&_sstack) / sizeof(uint32_t);
+    thread->quantum = PYB_THREAD_QUANTUM_DEFAULT;
+    thread->priority = 0;
+    thread->yielded = 0;
     thread->all_next = NULL;
     thread->run_prev = thread;
     thread->run_next = thread;
@@ -116,6 +120,10 @@ STATIC void pyb_thread_terminate(void) {
 }
 
 uint32_t pyb_thread_new(pyb_thread_t *thread, void *stack, size_t stack_len, void *entry, void *arg) {
+    #if MICROPY_STACK_HIGH_WATER
+    // fill the whole stack so that pyb_thread_dump can report its maximum use
+    mp_stack_paint(stack, (uint32_t*)stack + stack_len);
+    #endif
     uint32_t *stack_top = (uint32_t*)stack + stack_len; // stack is full descending
     *--stack_top = 0x01000000; // xPSR (thumb bit set)
     *--stack_top = (uint32_t)entry & 0xfffffffe; // pc (must have bit 0 cleared, even for thumb code)
@@ -133,6 +141,9 @@ uint32_t pyb_thread_new(pyb_thread_t *thread, void *stack, size_t stack_len, voi
     thread->arg = arg;
     thread->stack = stack;
     thread->stack_len = stack_len;
+    thread->quantum = PYB_THREAD_QUANTUM_DEFAULT;
+    thread->priority = 0;
+    thread->yielded = 0;
     thread->queue_next = NULL;
     uint32_t irq_state = disable_irq();
     pyb_thread_enabled = 1;
@@ -143,6 +154,23 @@ uint32_t pyb_thread_new(pyb_thread_t *thread, void *stack, size_t stack_len, voi
     return (uint32_t)thread; // success
 }
 
+#if MICROPY_STACK_HIGH_WATER
+// Return the maximum number of bytes used by the given thread's stack.  The
+// bottom of the main stack is not painted, so skip any words below the first
+// painted one before looking for the end of the painted region.
+STATIC size_t pyb_thread_stack_use_max(pyb_thread_t *th) {
+    uint32_t *p = th->stack;
+    uint32_t *top = p + th->stack_len;
+    while (p < top && *p != (uint32_t)MP_STACK_PAINT) {
+        ++p;
+    }
+    while (p < top && *p == (uint32_t)MP_STACK_PAINT) {
+        ++p;
+    }
+    return (top - p) * sizeof(uint32_t);
+}
+#endif
+
 void pyb_thread_dump(void) {
     if (!pyb_thread_enabled) {
         printf("THREAD: only main thread\n");
@@ -159,7 +187,11 @@ void pyb_thread_dump(void) {
                     break;
                 }
             }
-            printf("    id=%p sp=%p sz=%u", th, th->stack, th->stack_len);
+            printf("    id=%p sp=%p sz=%u pri=%u q=%u", th, th->stack, th->stack_len,
+                th->priority, (uint)th->quantum);
+            #if MICROPY_STACK_HIGH_WATER
+            printf(" max=%u", (uint)pyb_thread_stack_use_max(th));
+            #endif
             if (runable) {
                 printf(" (runable)");
             }
@@ -168,12 +200,47 @@ void pyb_thread_dump(void) {
     }
 }
 
+void pyb_thread_set_priority(uint8_t priority) {
+    pyb_thread_cur->priority = priority;
+    if (pyb_thread_enabled) {
+        // let a thread that now has a higher priority run
+        SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    }
+}
+
+void pyb_thread_set_quantum(uint32_t quantum) {
+    pyb_thread_cur->quantum = quantum;
+    if (pyb_thread_cur->timeslice > quantum) {
+        pyb_thread_cur->timeslice = quantum;
+    }
+}
+
 // should only be called from pendsv_isr_handler
 void *pyb_thread_next(void *sp) {
-    pyb_thread_cur->sp = sp;
-    pyb_thread_cur = pyb_thread_cur->run_next;
-    pyb_thread_cur->timeslice = 4; // in milliseconds
-    return pyb_thread_cur->sp;
+    pyb_thread_t *cur = pyb_thread_cur;
+    cur->sp = sp;
+    // Pick the highest priority runable thread, searching from the one after
+    // the current thread so that threads of equal priority take turns.  A
+    // thread that yielded gives way to the others even if they are lower
+    // priority; it gets back in when their timeslice ends.  The current thread
+    // may be off the run list, but its run_next is still on it.
+    pyb_thread_t *start = cur->run_next;
+    pyb_thread_t *best = NULL;
+    pyb_thread_t *th = start;
+    do {
+        if (!(th == cur && cur->yielded) && (best == NULL || th->priority > best->priority)) {
+            best = th;
+        }
+        th = th->run_next;
+    } while (th != start);
+    if (best == NULL) {
+        // the current thread yielded but is the only one runable
+        best = cur;
+    }
+    cur->yielded = 0;
+    pyb_thread_cur = best;
+    best->timeslice = best->quantum;
+    return best->sp;
 }
 
 void pyb_mutex_init(pyb_mutex_t *m) {
@@ -192,17 +259,23 @@ int pyb_mutex_lock(pyb_mutex_t *m, int wait) {
             RESTORE_IRQ_PRI(irq_state);
             return 0; // failed to lock mutex
         }
+        // the wait queue is ordered by priority, first come first served
+        // within a priority, and the thread at its head gets the mutex next
+        pyb_thread_t *th = pyb_thread_cur;
         if (*m == PYB_MUTEX_LOCKED) {
-            *m = pyb_thread_cur;
+            th->queue_next = NULL;
+            *m = th;
+        } else if (th->priority > (*m)->priority) {
+            th->queue_next = *m;
+            *m = th;
         } else {
-            for (pyb_thread_t *n = *m;; n = n->queue_next) {
-                if (n->queue_next == NULL) {
-                    n->queue_next = pyb_thread_cur;
-                    break;
-                }
+            pyb_thread_t *n = *m;
+            while (n->queue_next != NULL && n->queue_next->priority >= th->priority) {
+                n = n->queue_next;
             }
+            th->queue_next = n->queue_next;
+            n->queue_next = th;
         }
-        pyb_thread_cur->queue_next = NULL;
         // take current thread off the run list
         pyb_thread_remove_from_runable(pyb_thread_cur);
         // thread switch will occur after we enable irqs
@@ -230,6 +303,10 @@ void pyb_mutex_unlock(pyb_mutex_t *m) {
         }
         // put unblocked thread on runable list
         pyb_thread_add_to_runable(th);
+        if (th->priority > pyb_thread_cur->priority) {
+            // switch to it now rather than at the end of our timeslice
+            SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+        }
     }
     RESTORE_IRQ_PRI(irq_state);
 }
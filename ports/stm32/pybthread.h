@@ -26,6 +26,10 @@
 #ifndef MICROPY_INCLUDED_STM32_PYBTHREAD_H
 #define MICROPY_INCLUDED_STM32_PYBTHREAD_H
 
+// Default time, in milliseconds, a thread runs before others of the same
+// priority get a turn
+#define PYB_THREAD_QUANTUM_DEFAULT (4)
+
 typedef struct _pyb_thread_t {
     void *sp;
     uint32_t local_state;
@@ -33,6 +37,9 @@ typedef struct _pyb_thread_t {
     void *stack;                // pointer to the stack
     size_t stack_len;           // number of words in the stack
     uint32_t timeslice;
+    uint32_t quantum;           // timeslice given at each switch-in
+    uint8_t priority;           // higher runs first
+    volatile uint8_t yielded;   // set by pyb_thread_yield for the next switch
     struct _pyb_thread_t *all_next;
     struct _pyb_thread_t *run_prev;
     struct _pyb_thread_t *run_next;
@@ -49,6 +56,8 @@ void pyb_thread_init(pyb_thread_t *th);
 void pyb_thread_deinit();
 uint32_t pyb_thread_new(pyb_thread_t *th, void *stack, size_t stack_len, void *entry, void *arg);
 void pyb_thread_dump(void);
+void pyb_thread_set_priority(uint8_t priority);
+void pyb_thread_set_quantum(uint32_t quantum);
 
 static inline uint32_t pyb_thread_get_id(void) {
     return (uint32_t)pyb_thread_cur;
@@ -66,6 +75,7 @@ static inline void pyb_thread_yield(void) {
     if (pyb_thread_cur->run_next == pyb_thread_cur) {
         __WFI();
     } else {
+        pyb_thread_cur->yielded = 1;
         SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
     }
 }
@@ -39,7 +39,7 @@ Reset_Handler:
     /* Load the stack pointer */
     ldr  sp, =_estack
 
-    /* Initialise the data section */
+    /* Initialise the data section, which also holds any .ramfunc code */
     ldr  r1, =_sidata
     ldr  r2, =_sdata
     ldr  r3, =_edata
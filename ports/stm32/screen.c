@@ -1,8 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include "py/mphal.h"
 #include "py/runtime.h"
+#include "py/builtin.h"
+#include "py/stream.h"
 
 #if MICROPY_HW_HAS_SCREEN
 
@@ -10,39 +14,38 @@
 #include "bufhelper.h"
 #include "spi.h"
 #include "dma.h"
+#include "irq.h"
+#include "powerctrl.h"
 #include "font_petme128_8x8.h"
+#include "extmod/machine_display.h"
 #include "screen.h"
 
 #define LCD_INSTR (0)
 //#define LCD_CHAR_BUF_W (16)
 //#define LCD_CHAR_BUF_H (4)
 
-#define COL0(r, g, b) ((((r) >> 3) << 11) | (((g) >> 2) << 5) | ((b) >> 3))
-#define COL(c) COL0((c >> 16) & 0xff, (c >> 8) & 0xff, c & 0xff)
-
-const uint16_t palette[] = {
-    COL(0x000000), // 0
-    COL(0xffffff), // 1
-    COL(0xff2121), // 2
-    COL(0xff93c4), // 3
-    COL(0xff8135), // 4
-    COL(0xfff609), // 5
-    COL(0x249ca3), // 6
-    COL(0x78dc52), // 7
-    COL(0x003fad), // 8
-    COL(0x87f2ff), // 9
-    COL(0x8e2ec4), // 10
-    COL(0xa4839f), // 11
-    COL(0x5c406c), // 12
-    COL(0xe5cdc4), // 13
-    COL(0x91463d), // 14
-    COL(0x000000), // 15
-};
-
-// uint8_t fb[DISPLAY_WIDTH * DISPLAY_HEIGHT]; // only for palette
+// palette used by show(buf, palette), stored in wire (big-endian) byte order
+STATIC uint16_t palette[MP_MACHINE_DISPLAY_PALETTE_SIZE];
 
 static uint8_t cmdBuf[20];
 
+// 8x8 character cells covering the largest address window
+#define SCREEN_CON_COLS (DISPLAY_WIDTH / 8)
+#define SCREEN_CON_ROWS (DISPLAY_HEIGHT / 8)
+
+typedef struct _screen_console_t {
+    // text as it should appear, and as it was last drawn on the panel
+    char cells[SCREEN_CON_ROWS][SCREEN_CON_COLS];
+    char shown[SCREEN_CON_ROWS][SCREEN_CON_COLS];
+    uint8_t cols;
+    uint8_t rows;
+    uint8_t col;
+    uint8_t row;
+    // state of the VT100 escape sequence parser, and its numeric argument
+    uint8_t esc_state;
+    uint8_t esc_arg;
+} screen_console_t;
+
 typedef struct _pyb_screen_obj_t {
     mp_obj_base_t base;
 
@@ -53,14 +56,72 @@ typedef struct _pyb_screen_obj_t {
     const pin_obj_t *pin_dc;
     const pin_obj_t *pin_bl;
 
-    // character buffer for stdout-like output
-    //char char_buffer[LCD_CHAR_BUF_W * LCD_CHAR_BUF_H];
-    //int line;
-    //int column;
-    //int next_line;
+    // text console used when the screen is attached with uos.dupterm,
+    // allocated on first write
+    struct _screen_console_t *console;
+
+    // address window set up by the constructor; window_partial is set
+    // while the panel is left with a smaller window by show(rect=...)
+    uint8_t off_x;
+    uint8_t off_y;
+    uint16_t width;
+    uint16_t height;
+    bool window_partial;
+
+    // SPI2 baudrate given to the constructor, and the frame size (8 or 16 bits) used for the RGB565 data phase of show()
+    uint32_t baudrate;
+    uint8_t bits;
+
+    // nominal panel refresh rate in Hz, and show() pacing state
+    uint16_t frame_rate;
+    uint32_t pace_us;
+    uint32_t next_frame_us;
+
+    // hardware vertical scroll area and current start offset within it
+    uint16_t scroll_top;
+    uint16_t scroll_height;
+    uint16_t scroll_offset;
+
+    // framebuf.FrameBuffer pair used by flip(); fb[fb_back] is drawn into
+    mp_obj_t fb[2];
+    uint8_t fb_back;
+    uint8_t fb_mode;
+
+    // state of a non-blocking show(); the buffer is kept here so the GC
+    // doesn't reclaim it while the DMA is still reading from it
+    volatile bool busy;
+    mp_obj_t tx_buf;
+    mp_obj_t tx_callback;
 
+    // state of a transfer through the display protocol: whether its writes
+    // use DMA, the status of the last one and when it started, and the IRQ
+    // priority to restore if the transfer was started by the window call
+    bool line_dma;
+    bool line_cs;
+    HAL_StatusTypeDef line_status;
+    uint32_t line_t_start;
+    uint32_t line_basepri;
+
+    #if MICROPY_HW_SCREEN_OVERLAY
+    // frame timing stats drawn by the overlay: start of the last show(), the
+    // smoothed and last interval between shows, and how long the last
+    // transfer took (set by screen_tx_done for a background one)
+    bool overlay;
+    uint32_t show_t0_us;
+    uint32_t frame_avg_us;
+    uint32_t frame_us;
+    volatile uint32_t tx_us;
+    size_t gc_collections;
+    uint8_t gc_frame;
+    #endif
 } pyb_screen_obj_t;
 
+STATIC DMA_HandleTypeDef screen_tx_dma;
+
+// RGB565 pixels of the console cells being drawn, in wire byte order
+#define SCREEN_LINE_PIXELS (DISPLAY_WIDTH)
+STATIC uint16_t screen_line_buf[2][SCREEN_LINE_PIXELS];
+
 #define DELAY 0x80
 
 static const uint8_t initCmds[] = {
@@ -90,11 +151,198 @@ static const uint8_t initCmds[] = {
     0, 0 // END
 };
 
+// Switch the SPI frame size between 8 and 16 bits.  The DFF bit may only be
+// changed while the peripheral is disabled; the HAL transmit functions pick
+// byte or halfword access from Init.DataSize.
+STATIC void screen_set_frame_bits(pyb_screen_obj_t *screen, uint bits) {
+    SPI_HandleTypeDef *spi = screen->spi->spi;
+    uint32_t data_size = bits == 16 ? SPI_DATASIZE_16BIT : SPI_DATASIZE_8BIT;
+    if (spi->Init.DataSize == data_size) {
+        return;
+    }
+    __HAL_SPI_DISABLE(spi);
+    spi->Init.DataSize = data_size;
+    MODIFY_REG(spi->Instance->CR1, SPI_CR1_DFF, data_size);
+}
+
+// Set up screen_tx_dma for an SPI transmit matching the current frame size.
+STATIC void screen_dma_begin(pyb_screen_obj_t *screen) {
+    SPI_HandleTypeDef *spi = screen->spi->spi;
+    dma_init(&screen_tx_dma, screen->spi->tx_dma_descr, DMA_MEMORY_TO_PERIPH, spi);
+    if (spi->Init.DataSize == SPI_DATASIZE_16BIT) {
+        // dma_init sets up byte transfers, 16-bit frames need halfwords
+        screen_tx_dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+        screen_tx_dma.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+        HAL_DMA_DeInit(&screen_tx_dma);
+        HAL_DMA_Init(&screen_tx_dma);
+    }
+    spi->hdmatx = &screen_tx_dma;
+    spi->hdmarx = NULL;
+}
+
+STATIC void screen_dma_end(pyb_screen_obj_t *screen) {
+    if (screen_tx_dma.Init.MemDataAlignment != DMA_MDATAALIGN_BYTE) {
+        // make the next dma_init reprogram the stream for byte transfers
+        screen_tx_dma.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        dma_invalidate_channel(screen->spi->tx_dma_descr);
+    }
+    dma_deinit(screen->spi->tx_dma_descr);
+}
+
 STATIC void screen_delay(void) {
     __asm volatile ("nop\nnop");
 }
 
+// Wait for any pending non-blocking show() to finish.
+STATIC void screen_wait_idle(pyb_screen_obj_t *screen) {
+    uint32_t t_start = HAL_GetTick();
+    while (screen->busy) {
+        if (HAL_GetTick() - t_start >= SPI_TRANSFER_TIMEOUT(DISPLAY_WIDTH * DISPLAY_HEIGHT * 2)) {
+            // transfer got stuck, abort it so the bus can be used again
+            spi_transfer_abort(screen->spi);
+            mp_hal_raise(HAL_TIMEOUT);
+        }
+        MICROPY_EVENT_POLL_HOOK
+    }
+}
+
+// Called from the DMA IRQ when a non-blocking show() completes.
+STATIC void screen_tx_done(const spi_t *spi, HAL_StatusTypeDef status, void *arg) {
+    (void)spi;
+    (void)status;
+    pyb_screen_obj_t *screen = arg;
+    mp_hal_pin_high(screen->pin_cs1); // CS=1; disable
+    #if MICROPY_HW_SCREEN_OVERLAY
+    screen->tx_us = mp_hal_ticks_us() - screen->show_t0_us;
+    #endif
+    screen->tx_buf = MP_OBJ_NULL;
+    screen->busy = false;
+    if (screen->tx_callback != mp_const_none) {
+        mp_sched_schedule(screen->tx_callback, MP_OBJ_FROM_PTR(screen));
+    }
+}
+
+STATIC HAL_StatusTypeDef screen_wait_spi_ready(pyb_screen_obj_t *screen, uint32_t t_start) {
+    volatile HAL_SPI_StateTypeDef *state = &screen->spi->spi->State;
+    while (*state != HAL_SPI_STATE_READY) {
+        if (HAL_GetTick() - t_start >= 1000) {
+            return HAL_TIMEOUT;
+        }
+    }
+    return HAL_OK;
+}
+
+// Start a run of writes through the display protocol, with CS and DC
+// already asserted.  They use DMA if IRQs are enabled.
+STATIC void screen_line_begin(pyb_screen_obj_t *screen) {
+    screen->line_dma = query_irq() == IRQ_STATE_ENABLED;
+    if (screen->line_dma) {
+        screen_dma_begin(screen);
+    }
+    screen->line_status = HAL_OK;
+    screen->line_t_start = HAL_GetTick();
+}
+
+// The display protocol write: send n pixels, leaving them going out by DMA
+// once the previous write has finished.
+STATIC int screen_line_write(void *self, const uint16_t *pixels, size_t n) {
+    pyb_screen_obj_t *screen = self;
+    SPI_HandleTypeDef *spi = screen->spi->spi;
+    HAL_StatusTypeDef status = screen->line_status;
+    // a transfer is at most 65535 bytes
+    for (size_t i = 0; i < n && status == HAL_OK; i += 32767) {
+        size_t len = MIN(n - i, 32767);
+        if (screen->line_dma) {
+            status = screen_wait_spi_ready(screen, screen->line_t_start);
+            if (status != HAL_OK) {
+                break;
+            }
+            MP_HAL_CLEAN_DCACHE(pixels + i, len * 2);
+            status = HAL_SPI_Transmit_DMA(spi, (uint8_t*)(pixels + i), len * 2);
+        } else {
+            status = HAL_SPI_Transmit(spi, (uint8_t*)(pixels + i), len * 2, 1000);
+        }
+        screen->line_t_start = HAL_GetTick();
+    }
+    screen->line_status = status;
+    return status;
+}
+
+// The display protocol flush: wait for the last write, and end the
+// transaction if the window call began it.
+STATIC int screen_line_flush(void *self) {
+    pyb_screen_obj_t *screen = self;
+    HAL_StatusTypeDef status = screen->line_status;
+    if (screen->line_dma) {
+        if (status == HAL_OK) {
+            status = screen_wait_spi_ready(screen, screen->line_t_start);
+        } else {
+            HAL_SPI_DMAStop(screen->spi->spi);
+        }
+        screen_dma_end(screen);
+        screen->line_dma = false;
+    }
+    if (screen->line_cs) {
+        mp_hal_pin_high(screen->pin_cs1); // CS=1; disable
+        restore_irq_pri(screen->line_basepri);
+        screen->line_cs = false;
+    }
+    return status;
+}
+
+// Select the smallest prescaler that yields at most the requested baudrate.
+// This is done each time the settings are applied, because the clock of
+// APB1, where SPI2 is, may have been changed by machine.freq since.
+STATIC uint32_t screen_spi_prescaler(uint32_t baudrate) {
+    static const uint32_t prescalers[] = {
+        SPI_BAUDRATEPRESCALER_2, SPI_BAUDRATEPRESCALER_4, SPI_BAUDRATEPRESCALER_8,
+        SPI_BAUDRATEPRESCALER_16, SPI_BAUDRATEPRESCALER_32, SPI_BAUDRATEPRESCALER_64,
+        SPI_BAUDRATEPRESCALER_128,
+    };
+    uint32_t spi_clock = HAL_RCC_GetPCLK1Freq();
+    for (size_t i = 0; i < MP_ARRAY_SIZE(prescalers); ++i) {
+        if ((spi_clock >> (i + 1)) <= baudrate) {
+            return prescalers[i];
+        }
+    }
+    return SPI_BAUDRATEPRESCALER_256;
+}
+
+STATIC void screen_set_spi_init(pyb_screen_obj_t *screen) {
+    SPI_InitTypeDef *init = &screen->spi->spi->Init;
+    init->Mode = SPI_MODE_MASTER;
+
+    // data is sent bigendian, latches on rising clock
+    init->BaudRatePrescaler = screen_spi_prescaler(screen->baudrate);
+    init->CLKPolarity = SPI_POLARITY_HIGH;
+    init->CLKPhase = SPI_PHASE_2EDGE;
+    init->Direction = SPI_DIRECTION_2LINES;
+    init->DataSize = SPI_DATASIZE_8BIT;
+    init->NSS = SPI_NSS_SOFT;
+    init->FirstBit = SPI_FIRSTBIT_MSB;
+    init->TIMode = SPI_TIMODE_DISABLED;
+    init->CRCCalculation = SPI_CRCCALCULATION_DISABLED;
+    init->CRCPolynomial = 0;
+}
+
+// Claim SPI2, which is shared with the SPI flash, for one transaction and
+// restore the display's SPI settings if the flash used the bus in between.
+// Returns the IRQ priority to pass to restore_irq_pri when done.
+STATIC uint32_t screen_bus_acquire(pyb_screen_obj_t *screen) {
+    uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH); // prevent flash cache flushing and USB access
+    if (spi_bus_acquire(screen->spi, screen)) {
+        screen_set_spi_init(screen);
+        spi_bus_apply_init(screen->spi);
+    } else {
+        // a non-blocking 16-bit show() leaves the bus in 16-bit frames
+        screen_set_frame_bits(screen, 8);
+    }
+    return basepri;
+}
+
 STATIC void send_cmd(pyb_screen_obj_t *screen, uint8_t * buf, uint8_t len) {
+    screen_wait_idle(screen);
+    uint32_t basepri = screen_bus_acquire(screen);
     screen_delay();
     mp_hal_pin_low(screen->pin_cs1); // CS=0; enable
     mp_hal_pin_low(screen->pin_dc); // DC=0 for instruction
@@ -110,6 +358,7 @@ STATIC void send_cmd(pyb_screen_obj_t *screen, uint8_t * buf, uint8_t len) {
         //printf("v 0x%x len %d\n", buf[0], len);
     }
     mp_hal_pin_high(screen->pin_cs1); // CS=1; disable
+    restore_irq_pri(basepri);
 }
 
 static void sendCmdSeq(pyb_screen_obj_t *screen, const uint8_t *buf) {
@@ -134,18 +383,58 @@ static void setAddrWindow(pyb_screen_obj_t *screen, int x, int y, int w, int h)
     send_cmd(screen, cmd0, sizeof(cmd0));
 }
 
+// Panel refresh rate in normal mode, per the ST7735 datasheet:
+//   rate = fosc / ((RTNA * 2 + 40) * (LINE + FPA + BPA + 2))
+#define ST7735_FOSC (850000)
+#define ST7735_LINES (DISPLAY_WIDTH)
+
+STATIC uint32_t screen_frame_rate(uint8_t rtna, uint8_t fpa, uint8_t bpa) {
+    return ST7735_FOSC / ((rtna * 2 + 40) * (ST7735_LINES + fpa + bpa + 2));
+}
+
+STATIC void screen_set_frmctr1(pyb_screen_obj_t *screen, uint8_t rtna, uint8_t fpa, uint8_t bpa) {
+    uint8_t cmd[] = {ST7735_FRMCTR1, rtna, fpa, bpa};
+    send_cmd(screen, cmd, sizeof(cmd));
+    screen->frame_rate = screen_frame_rate(rtna, fpa, bpa);
+}
+
 static void configure(pyb_screen_obj_t *screen, uint8_t madctl) {
     uint8_t cmd0[] = {ST7735_MADCTL, madctl};
-    // 0x00 0x06 0x03: blue tab
-    uint8_t cmd1[] = {ST7735_FRMCTR1, 0x00, 0x06, 0x03};
     send_cmd(screen, cmd0, sizeof(cmd0));
-    send_cmd(screen, cmd1, sizeof(cmd1));
+    // 0x00 0x06 0x03: blue tab
+    screen_set_frmctr1(screen, 0x00, 0x06, 0x03);
+}
+
+// Block until the next paced frame slot.  Slots are a fixed period apart so
+// that a late frame doesn't push back the ones that follow it, unless the
+// caller fell behind by more than a whole period.
+STATIC void screen_pace_wait(pyb_screen_obj_t *screen) {
+    if (screen->pace_us == 0) {
+        return;
+    }
+    uint32_t now = mp_hal_ticks_us();
+    int32_t remain = (int32_t)(screen->next_frame_us - now);
+    if (remain < -(int32_t)screen->pace_us || remain > (int32_t)screen->pace_us) {
+        // missed a whole slot (or first frame), resynchronise to now
+        screen->next_frame_us = now + screen->pace_us;
+        return;
+    }
+    while ((int32_t)(screen->next_frame_us - mp_hal_ticks_us()) > 1000) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    while ((int32_t)(screen->next_frame_us - mp_hal_ticks_us()) > 0) {
+    }
+    screen->next_frame_us += screen->pace_us;
 }
 
-/// \classmethod \constructor(skin_position)
+/// \classmethod \constructor([madctl, [offX, offY, width, height]], *, baudrate=10500000, bits=8)
 ///
-/// Construct an LCD object in the given skin position.  `skin_position` can be 'X' or 'Y', and
-/// should match the position where the LCD pyskin is plugged in.
+/// Construct a Screen object driving the ST7735 panel on SPI2.
+///
+/// `baudrate` is rounded down to the nearest rate SPI2 supports, which is
+/// the APB1 clock divided by 2 up to 256.  With `bits=16` RGB565 pixels are
+/// sent as 16-bit frames, so show() takes native-endian pixel data (for
+/// example an array('H')) instead of byte-swapped RGB565.
 STATIC mp_obj_t pyb_screen_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     // check arguments
     int madctl = 0x60; // riven, adapt to new screen
@@ -154,7 +443,28 @@ STATIC mp_obj_t pyb_screen_make_new(const mp_obj_type_t *type, size_t n_args, si
     int offY = 0x0;
     int width = DISPLAY_HEIGHT;
     int height = DISPLAY_WIDTH;
-    mp_arg_check_num(n_args, n_kw, 0, 5, false);
+    mp_arg_check_num(n_args, n_kw, 0, 5, true);
+
+    enum { ARG_baudrate, ARG_bits };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_baudrate, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 10500000} },
+        { MP_QSTR_bits, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8} },
+    };
+    mp_arg_val_t kw_vals[MP_ARRAY_SIZE(allowed_args)];
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, args + n_args);
+    mp_arg_parse_all(0, NULL, &kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, kw_vals);
+
+    // SPI2 is on APB1, and can run at most at half of its clock
+    uint32_t spi_clock = HAL_RCC_GetPCLK1Freq();
+    mp_int_t baudrate = kw_vals[ARG_baudrate].u_int;
+    if (baudrate > (mp_int_t)(spi_clock / 2) || baudrate < (mp_int_t)(spi_clock / 256)) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+            "baudrate must be between %u and %u", (uint)(spi_clock / 256), (uint)(spi_clock / 2)));
+    }
+    if (kw_vals[ARG_bits].u_int != 8 && kw_vals[ARG_bits].u_int != 16) {
+        mp_raise_ValueError("bits must be 8 or 16");
+    }
     if (n_args >= 1) {
         madctl = mp_obj_get_int(args[0]);
         if (n_args == 5) {
@@ -168,6 +478,22 @@ STATIC mp_obj_t pyb_screen_make_new(const mp_obj_type_t *type, size_t n_args, si
     // create screen object
     pyb_screen_obj_t *screen = m_new_obj(pyb_screen_obj_t);
     screen->base.type = &pyb_screen_type;
+    screen->console = NULL;
+    screen->baudrate = baudrate;
+    screen->bits = kw_vals[ARG_bits].u_int;
+    screen->busy = false;
+    screen->line_dma = false;
+    screen->line_cs = false;
+    screen->tx_buf = MP_OBJ_NULL;
+    screen->tx_callback = mp_const_none;
+    screen->pace_us = 0;
+    screen->fb[0] = screen->fb[1] = MP_OBJ_NULL;
+    screen->scroll_top = 0;
+    screen->scroll_height = DISPLAY_WIDTH;
+    screen->scroll_offset = 0;
+    #if MICROPY_HW_SCREEN_OVERLAY
+    screen->overlay = false;
+    #endif
 
     // configure pins, tft bind to spi2 on f4
     screen->spi = &spi_obj[1];
@@ -176,29 +502,16 @@ STATIC mp_obj_t pyb_screen_make_new(const mp_obj_type_t *type, size_t n_args, si
     screen->pin_dc = pyb_pin_PA8;
     screen->pin_bl = pyb_pin_PB3;
 
-    // init the SPI bus
-    SPI_InitTypeDef *init = &screen->spi->spi->Init;
-    init->Mode = SPI_MODE_MASTER;
-
-    // compute the baudrate prescaler from the desired baudrate
-    // uint spi_clock;
-    // SPI2 and SPI3 are on APB1
-    // spi_clock = HAL_RCC_GetPCLK1Freq();
-
-    // data is sent bigendian, latches on rising clock
-    init->BaudRatePrescaler = SPI_BAUDRATEPRESCALER_4;
-    init->CLKPolarity = SPI_POLARITY_HIGH;
-    init->CLKPhase = SPI_PHASE_2EDGE;
-    init->Direction = SPI_DIRECTION_2LINES;
-    init->DataSize = SPI_DATASIZE_8BIT;
-    init->NSS = SPI_NSS_SOFT;
-    init->FirstBit = SPI_FIRSTBIT_MSB;
-    init->TIMode = SPI_TIMODE_DISABLED;
-    init->CRCCalculation = SPI_CRCCALCULATION_DISABLED;
-    init->CRCPolynomial = 0;
+    // a previous screen may still be sending in the background
+    if (MP_STATE_PORT(pyb_screen_obj) != NULL) {
+        screen_wait_idle(MP_STATE_PORT(pyb_screen_obj));
+    }
 
     // init the SPI bus
+    uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH); // prevent flash cache flushing and USB access
+    screen_set_spi_init(screen);
     spi_init(screen->spi, false);
+    restore_irq_pri(basepri);
     // set the pins to default values
     mp_hal_pin_high(screen->pin_cs1);
     mp_hal_pin_high(screen->pin_rst);
@@ -224,66 +537,831 @@ STATIC mp_obj_t pyb_screen_make_new(const mp_obj_type_t *type, size_t n_args, si
     madctl = madctl & 0xff;
     configure(screen, madctl);
     setAddrWindow(screen, offX, offY, width, height);
+    screen->off_x = offX;
+    screen->off_y = offY;
+    screen->width = width;
+    screen->height = height;
+    screen->window_partial = false;
 
     //memset(fb, 10, sizeof(fb));
     //draw_screen(screen);
 
+    mp_machine_display_palette_reset(palette);
+
+    // keeps the screen alive while a non-blocking show() refers to it
+    MP_STATE_PORT(pyb_screen_obj) = screen;
+
     return MP_OBJ_FROM_PTR(screen);
 }
 
 
-/// \method show()
-///
-/// Show the hidden buffer on the screen.
-STATIC mp_obj_t pyb_screen_show(size_t n_args, const mp_obj_t *args) {
-    (void)n_args;
-    bool usePalette = 0;
-    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(args[0]);
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
-    byte *p = bufinfo.buf;
+// pixel formats accepted by show()
+#define SCREEN_MODE_RGB565 (MP_MACHINE_DISPLAY_RGB565)
+#define SCREEN_MODE_PL8 (MP_MACHINE_DISPLAY_PL8)
+#define SCREEN_MODE_PL4 (MP_MACHINE_DISPLAY_PL4)
 
-    if (n_args >= 3){
-        usePalette = 1;
-    }
+STATIC const mp_machine_display_p_t screen_display_p;
 
+// Send a w x h rectangle of pixels from buf to the current address window.
+// The rectangle starts at pixel index start and rows are stride pixels apart.
+// Returns true if the transfer was left running in the background, in which
+// case CS is released by screen_tx_done.
+STATIC bool screen_write_pixels(pyb_screen_obj_t *screen, mp_obj_t buf_obj, const byte *p,
+    size_t start, size_t w, size_t h, size_t stride, int mode, bool wait, mp_obj_t callback) {
     uint8_t cmdBuf[] = {ST7735_RAMWR};
     send_cmd(screen, cmdBuf, 1);
 
+    uint32_t basepri = screen_bus_acquire(screen);
     mp_hal_pin_low(screen->pin_cs1); // CS=0; enable
     mp_hal_pin_high(screen->pin_dc); // DC=1
-    if (usePalette){
-        for (int i=0;i<bufinfo.len;i++){
-            uint16_t color = palette[p[i] & 0xf];
-            uint8_t cc[] = {color >> 8, color & 0xff};
-            HAL_SPI_Transmit(screen->spi->spi, (uint8_t*)&cc, 2, 1000);
+    HAL_StatusTypeDef status = HAL_OK;
+    if (mode != SCREEN_MODE_RGB565) {
+        // indices are expanded a line at a time while the previous line is
+        // sent by DMA, by the framebuf to display code shared with other ports
+        screen_line_begin(screen);
+        status = mp_machine_display_write_rect(&screen_display_p, screen, p, mode, palette, start, w, h, stride);
+    } else if (screen->bits == 16) {
+        // native-endian pixels go out as 16-bit frames, so no byte swap is needed
+        screen_set_frame_bits(screen, 16);
+        const uint16_t *p16 = (const uint16_t*)p + start;
+        if (!wait && w == stride && query_irq() == IRQ_STATE_ENABLED) {
+            screen->tx_buf = buf_obj;
+            screen->tx_callback = callback;
+            screen->busy = true;
+            // the frame size is put back to 8 bits by the next screen_bus_acquire
+            status = spi_transfer_async(screen->spi, w * h * 2, (const uint8_t*)p16, NULL, screen_tx_done, screen);
+            if (status == HAL_OK) {
+                restore_irq_pri(basepri);
+                return true;
+            }
+            screen->tx_buf = MP_OBJ_NULL;
+            screen->busy = false;
+        } else {
+            if (w == stride) {
+                // contiguous, send it in as few pieces as possible
+                w *= h;
+                h = 1;
+            }
+            for (; h && status == HAL_OK; --h, p16 += stride) {
+                for (size_t i = 0; i < w && status == HAL_OK; i += 65535) {
+                    status = HAL_SPI_Transmit(screen->spi->spi, (uint8_t*)(p16 + i), MIN(w - i, 65535), 1000);
+                }
+            }
+        }
+        screen_set_frame_bits(screen, 8);
+    } else if (w != stride && h > 1) {
+        // strided rectangle, send it row by row
+        for (p += start * 2; h; --h, p += stride * 2) {
+            spi_transfer(screen->spi, w * 2, p, NULL, 1000);
         }
+    } else if (!wait && query_irq() == IRQ_STATE_ENABLED) {
+        // non-blocking: CS is released by screen_tx_done, and the flash
+        // waits for the transfer before it can use the bus
+        screen->tx_buf = buf_obj;
+        screen->tx_callback = callback;
+        screen->busy = true;
+        status = spi_transfer_async(screen->spi, w * h * 2, p + start * 2, NULL, screen_tx_done, screen);
+        if (status == HAL_OK) {
+            restore_irq_pri(basepri);
+            return true;
+        }
+        screen->tx_buf = MP_OBJ_NULL;
+        screen->busy = false;
     } else {
         // HAL_SPI_Transmit(screen->spi->spi, p, bufinfo.len, 1000);
-        spi_transfer(screen->spi, bufinfo.len, p, NULL, 1000);
+        spi_transfer(screen->spi, w * h * 2, p + start * 2, NULL, 1000);
+    }
+    mp_hal_pin_high(screen->pin_cs1); // CS=1; disable
+    restore_irq_pri(basepri);
+    if (status != HAL_OK) {
+        mp_hal_raise(status);
     }
+    return false;
+}
 
+// Set the panel address window to a rectangle in framebuffer coordinates.
+// The constructor's x/width arguments select panel rows (RASET) and y/height
+// select panel columns (CASET), so framebuffer x runs along the columns.
+STATIC void screen_set_window(pyb_screen_obj_t *screen, int x, int y, int w, int h) {
+    setAddrWindow(screen, screen->off_x + y, screen->off_y + x, h, w);
+}
 
-    mp_hal_pin_high(screen->pin_cs1); // CS=1; disable
+// The display protocol window: begin a transaction writing to a rectangle,
+// which screen_line_flush ends.
+STATIC void screen_line_window(void *self, int x, int y, int w, int h) {
+    pyb_screen_obj_t *screen = self;
+    screen_set_window(screen, x, y, w, h);
+    screen->window_partial = true;
+    uint8_t cmd[] = {ST7735_RAMWR};
+    send_cmd(screen, cmd, 1);
+    screen->line_basepri = screen_bus_acquire(screen);
+    screen->line_cs = true;
+    mp_hal_pin_low(screen->pin_cs1); // CS=0; enable
+    mp_hal_pin_high(screen->pin_dc); // DC=1
+    screen_line_begin(screen);
+}
+
+STATIC const mp_machine_display_p_t screen_display_p = {
+    .window = screen_line_window,
+    .write = screen_line_write,
+    .flush = screen_line_flush,
+};
+
+#if MICROPY_HW_SCREEN_OVERLAY
 
+// the overlay is 2 lines of 8x8 text in the top left corner
+#define SCREEN_OVERLAY_COLS (16)
+#define SCREEN_OVERLAY_ROWS (2)
+
+// Update the frame stats at the start of a show(), before the transfer.
+STATIC void screen_overlay_update(pyb_screen_obj_t *screen) {
+    uint32_t now = mp_hal_ticks_us();
+    uint32_t dt = now - screen->show_t0_us;
+    screen->show_t0_us = now;
+    screen->frame_us = dt;
+    if (dt > 1000000) {
+        // first frame, or after a pause; restart the average
+        screen->frame_avg_us = 0;
+    } else if (screen->frame_avg_us == 0) {
+        screen->frame_avg_us = dt;
+    } else {
+        screen->frame_avg_us = (screen->frame_avg_us * 7 + dt) / 8;
+    }
+    #if MICROPY_GC_STATS
+    size_t n = MP_STATE_MEM(gc_stats_collections);
+    screen->gc_frame = MIN(n - screen->gc_collections, 99);
+    screen->gc_collections = n;
+    #endif
+}
+
+// Set pixel i of buffer p, in the given show() mode, to white/colour 1 if on
+// is true or black/colour 0 otherwise.  White and black are the same in
+// either RGB565 byte order.
+STATIC void screen_overlay_pixel(byte *p, int mode, size_t i, bool on) {
+    if (mode == SCREEN_MODE_RGB565) {
+        p[i * 2] = p[i * 2 + 1] = on ? 0xff : 0;
+    } else if (mode == SCREEN_MODE_PL8) {
+        p[i] = on;
+    } else {
+        uint shift = (i & 1) ? 0 : 4;
+        p[i >> 1] = (p[i >> 1] & ~(0xf << shift)) | (on << shift);
+    }
+}
+
+// Draw the stats of the previous frame into the top left corner of the
+// outgoing buffer, so they are sent with the frame itself.
+STATIC void screen_overlay_draw(pyb_screen_obj_t *screen, byte *p, size_t len, int mode, size_t fb_w) {
+    size_t needed = fb_w * SCREEN_OVERLAY_ROWS * 8;
+    needed = mode == SCREEN_MODE_RGB565 ? needed * 2 : mode == SCREEN_MODE_PL4 ? needed / 2 : needed;
+    if (len < needed || fb_w < SCREEN_OVERLAY_COLS * 8) {
+        return;
+    }
+    char text[SCREEN_OVERLAY_ROWS][SCREEN_OVERLAY_COLS + 1];
+    uint32_t fps = screen->frame_avg_us == 0 ? 0 : (1000000 + screen->frame_avg_us / 2) / screen->frame_avg_us;
+    uint32_t tx = screen->tx_us / 100;
+    uint32_t dt = MIN(screen->frame_us / 100, 9999);
+    snprintf(text[0], sizeof(text[0]), "FPS%3u TX%3u.%u", (uint)MIN(fps, 999), (uint)(tx / 10), (uint)(tx % 10));
+    snprintf(text[1], sizeof(text[1]), "DT%3u.%u GC%2u", (uint)(dt / 10), (uint)(dt % 10), (uint)screen->gc_frame);
+    for (uint row = 0; row < SCREEN_OVERLAY_ROWS; ++row) {
+        size_t n = strlen(text[row]);
+        for (uint col = 0; col < SCREEN_OVERLAY_COLS; ++col) {
+            // pad with spaces so the background is a fixed-size box
+            uint chr = col < n ? (byte)text[row][col] : ' ';
+            const uint8_t *chr_data = &font_petme128_8x8[(chr - 32) * 8];
+            // each font byte is a column of 8 pixels, LSB at top
+            for (uint x = 0; x < 8; ++x) {
+                uint vline_data = chr_data[x];
+                for (uint y = 0; y < 8; ++y, vline_data >>= 1) {
+                    size_t i = (row * 8 + y) * fb_w + col * 8 + x;
+                    screen_overlay_pixel(p, mode, i, vline_data & 1);
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+// Send buf_obj to the screen, either whole or as the rectangles in rect_obj.
+STATIC void screen_show(pyb_screen_obj_t *screen, mp_obj_t buf_obj, int mode, bool wait, mp_obj_t callback, mp_obj_t rect_obj) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_obj, &bufinfo, MP_BUFFER_READ);
+    byte *p = bufinfo.buf;
+
+    // framebuffer dimensions of the whole window
+    size_t fb_w = screen->height;
+    size_t fb_h = screen->width;
+
+    screen_wait_idle(screen);
+    screen_pace_wait(screen);
+
+    #if MICROPY_HW_ENABLE_FREQ_POLICY
+    // a frame is being rendered, so run at the boost clock for a while
+    powerctrl_freq_boost();
+    #endif
+
+    #if MICROPY_HW_SCREEN_OVERLAY
+    if (screen->overlay) {
+        screen_overlay_update(screen);
+        // it's drawn into the buffer, so not into a read-only one such as
+        // bytes, which may be in flash
+        mp_buffer_info_t wbufinfo;
+        if (rect_obj == mp_const_none && mp_get_buffer(buf_obj, &wbufinfo, MP_BUFFER_WRITE)) {
+            screen_overlay_draw(screen, p, bufinfo.len, mode, fb_w);
+        }
+    }
+    #endif
+
+    bool in_background = false;
+    if (rect_obj == mp_const_none) {
+        // whole screen, sending as many pixels as the buffer holds
+        if (screen->window_partial) {
+            screen_set_window(screen, 0, 0, fb_w, fb_h);
+            screen->window_partial = false;
+        }
+        size_t npixels = mode == SCREEN_MODE_RGB565 ? bufinfo.len / 2
+            : mode == SCREEN_MODE_PL4 ? fb_w * fb_h : bufinfo.len;
+        in_background = screen_write_pixels(screen, buf_obj, p, 0, npixels, 1, npixels, mode, wait, callback);
+    } else {
+        size_t needed = mode == SCREEN_MODE_RGB565 ? fb_w * fb_h * 2
+            : mode == SCREEN_MODE_PL4 ? fb_w * fb_h / 2 : fb_w * fb_h;
+        if (bufinfo.len < needed) {
+            mp_raise_ValueError("buffer too small");
+        }
+
+        // accept either a single rectangle or a sequence of them
+        size_t nrects;
+        mp_obj_t *rects;
+        mp_machine_display_get_rects(&rect_obj, &nrects, &rects);
+
+        for (size_t i = 0; i < nrects; ++i) {
+            int r[4];
+            if (!mp_machine_display_clip_rect(rects[i], (int)fb_w, (int)fb_h, r)) {
+                continue;
+            }
+            screen_set_window(screen, r[0], r[1], r[2], r[3]);
+            screen->window_partial = true;
+            in_background = screen_write_pixels(screen, buf_obj, p, r[1] * fb_w + r[0], r[2], r[3],
+                fb_w, mode, wait || i + 1 != nrects, callback);
+        }
+    }
+
+    #if MICROPY_HW_SCREEN_OVERLAY
+    if (!in_background) {
+        screen->tx_us = mp_hal_ticks_us() - screen->show_t0_us;
+    }
+    #endif
+
+    if (!in_background && callback != mp_const_none) {
+        mp_sched_schedule(callback, MP_OBJ_FROM_PTR(screen));
+    }
+}
+
+/// \method show(buf, palette=None, *, wait=True, callback=None, rect=None)
+///
+/// Show the hidden buffer on the screen.
+///
+/// If `wait` is False then an RGB565 buffer is sent using DMA and the method
+/// returns straight away; `buf` must not be modified until the transfer is
+/// done.  Completion can be polled with `busy()`, waited for with `wait()`,
+/// or signalled by `callback`, which is scheduled with the screen object as
+/// its argument.  Palette mode is always blocking; indices are expanded to
+/// RGB565 a line at a time while the previous line is sent by DMA.
+///
+/// If pacing is enabled with `pace()` then show() first waits for the next
+/// frame slot.
+///
+/// `rect` restricts the update to part of the screen.  It is an (x, y, w, h)
+/// tuple, or a list of them, in the coordinates of a framebuffer covering the
+/// whole screen; only those pixels of `buf` are sent.  A transfer without
+/// `wait` only runs in the background for a single rectangle spanning the
+/// full width of the screen.
+STATIC mp_obj_t pyb_screen_show(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_palette, ARG_wait, ARG_callback, ARG_rect };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_palette, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+        { MP_QSTR_wait, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+        { MP_QSTR_rect, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(pos_args[0]);
+
+    bool with_palette = args[ARG_palette].u_obj != mp_const_none;
+    if (with_palette) {
+        // a buffer given as the palette argument is loaded as by palette()
+        mp_buffer_info_t palinfo;
+        if (mp_get_buffer(args[ARG_palette].u_obj, &palinfo, MP_BUFFER_READ)) {
+            mp_machine_display_palette_load(palette, &palinfo);
+        }
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_READ);
+    int mode = mp_machine_display_mode(bufinfo.len, (size_t)screen->width * screen->height, with_palette);
+
+    screen_show(screen, args[ARG_buf].u_obj, mode, args[ARG_wait].u_bool, args[ARG_callback].u_obj, args[ARG_rect].u_obj);
+
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_screen_show_obj, 2, pyb_screen_show);
+
+/// \method busy()
+///
+/// Return True if a non-blocking show() is still in progress.
+STATIC mp_obj_t pyb_screen_busy(mp_obj_t self_in) {
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(screen->busy);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_screen_busy_obj, pyb_screen_busy);
+
+/// \method wait()
+///
+/// Block until a non-blocking show() has finished.
+STATIC mp_obj_t pyb_screen_wait(mp_obj_t self_in) {
+    screen_wait_idle(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_screen_wait_obj, pyb_screen_wait);
+
+// framebuf format constants, as in extmod/modframebuf.c
+#define SCREEN_FB_RGB565 (1)
+#define SCREEN_FB_GS4_HMSB (2)
+#define SCREEN_FB_PL8 (6)
+
+/// \method buffers(format=framebuf.RGB565)
+///
+/// Allocate a pair of screen-sized framebuf.FrameBuffer objects in the given
+/// format (RGB565, PL8 or GS4_HMSB) for use with flip(), and return the back
+/// buffer to draw into.  The screen keeps them alive until buffers(None) is
+/// called.
+STATIC mp_obj_t pyb_screen_buffers(size_t n_args, const mp_obj_t *args) {
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 2 && args[1] == mp_const_none) {
+        screen_wait_idle(screen);
+        screen->fb[0] = screen->fb[1] = MP_OBJ_NULL;
+        return mp_const_none;
+    }
+    mp_int_t format = n_args == 2 ? mp_obj_get_int(args[1]) : SCREEN_FB_RGB565;
+    size_t npixels = (size_t)screen->width * screen->height;
+    size_t len;
+    if (format == SCREEN_FB_RGB565) {
+        screen->fb_mode = SCREEN_MODE_RGB565;
+        len = npixels * 2;
+    } else if (format == SCREEN_FB_PL8) {
+        screen->fb_mode = SCREEN_MODE_PL8;
+        len = npixels;
+    } else if (format == SCREEN_FB_GS4_HMSB) {
+        screen->fb_mode = SCREEN_MODE_PL4;
+        len = npixels / 2;
+    } else {
+        mp_raise_ValueError("invalid format");
+    }
+
+    // release the old pair first so its memory can be reused
+    screen_wait_idle(screen);
+    screen->fb[0] = screen->fb[1] = MP_OBJ_NULL;
+
+    mp_obj_t fb_type = mp_load_attr(MP_OBJ_FROM_PTR(&mp_module_framebuf), MP_QSTR_FrameBuffer);
+    for (int i = 0; i < 2; ++i) {
+        mp_obj_t fb_args[4] = {
+            mp_obj_new_bytearray_by_ref(len, m_new0(byte, len)),
+            MP_OBJ_NEW_SMALL_INT(screen->height),
+            MP_OBJ_NEW_SMALL_INT(screen->width),
+            MP_OBJ_NEW_SMALL_INT(format),
+        };
+        screen->fb[i] = mp_call_function_n_kw(fb_type, 4, 0, fb_args);
+    }
+    screen->fb_back = 0;
+    return screen->fb[0];
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_screen_buffers_obj, 1, 2, pyb_screen_buffers);
+
+/// \method flip(*, callback=None)
+///
+/// Make the back buffer from buffers() the front one and start sending it to
+/// the screen, then return the other buffer to draw the next frame into.  An
+/// RGB565 pair is sent in the background so drawing overlaps the transfer;
+/// palette formats are expanded and sent before flip() returns.
+STATIC mp_obj_t pyb_screen_flip(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(pos_args[0]);
+    if (screen->fb[0] == MP_OBJ_NULL) {
+        mp_raise_msg(&mp_type_OSError, "no buffers");
+    }
+    // show() waits for the previous frame, which was sent from the buffer
+    // we are about to hand back for drawing
+    screen_show(screen, screen->fb[screen->fb_back], screen->fb_mode, false, args[ARG_callback].u_obj, mp_const_none);
+    screen->fb_back ^= 1;
+    return screen->fb[screen->fb_back];
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_screen_flip_obj, 1, pyb_screen_flip);
+
+
+/// \method framerate([hz])
+///
+/// Get or set the panel refresh rate in Hz.  The closest rate the ST7735
+/// frame rate control supports is chosen (roughly 40 to 120 Hz) and the
+/// nominal rate is returned; the panel's internal oscillator makes the real
+/// rate vary by some percent.
+STATIC mp_obj_t pyb_screen_framerate(size_t n_args, const mp_obj_t *args) {
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 2) {
+        int hz = mp_obj_get_int(args[1]);
+        if (hz <= 0) {
+            mp_raise_ValueError(NULL);
+        }
+        uint8_t best_rtna = 0, best_porch = 1;
+        int best_err = INT_MAX;
+        // search RTNA and (equal) front/back porch lengths
+        for (uint8_t rtna = 0; rtna < 16; ++rtna) {
+            for (uint8_t porch = 1; porch < 64; ++porch) {
+                int err = abs((int)screen_frame_rate(rtna, porch, porch) - hz);
+                if (err < best_err) {
+                    best_err = err;
+                    best_rtna = rtna;
+                    best_porch = porch;
+                }
+            }
+        }
+        screen_set_frmctr1(screen, best_rtna, best_porch, best_porch);
+    }
+    return MP_OBJ_NEW_SMALL_INT(screen->frame_rate);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_screen_framerate_obj, 1, 2, pyb_screen_framerate);
+
+/// \method pace([fps])
+///
+/// Get or set the rate at which show() sends frames.  Each show() waits
+/// until its slot on a fixed cadence so frames go out with stable timing;
+/// choose `fps` as a divisor of `framerate()` to keep in step with the
+/// panel refresh.  0 disables pacing.
+STATIC mp_obj_t pyb_screen_pace(size_t n_args, const mp_obj_t *args) {
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 2) {
+        int fps = mp_obj_get_int(args[1]);
+        if (fps < 0) {
+            mp_raise_ValueError(NULL);
+        }
+        screen->pace_us = fps == 0 ? 0 : 1000000 / fps;
+        screen->next_frame_us = mp_hal_ticks_us();
+        return mp_const_none;
+    }
+    return MP_OBJ_NEW_SMALL_INT(screen->pace_us == 0 ? 0 : 1000000 / screen->pace_us);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_screen_pace_obj, 1, 2, pyb_screen_pace);
+
+#if MICROPY_HW_SCREEN_OVERLAY
+/// \method overlay([enable])
+///
+/// Get or set whether show() draws frame timing stats into the top left
+/// corner of the buffer it sends, so they can be watched on the device
+/// without printing, which would itself change the timing:
+///
+///   - `FPS`: frames per second, averaged over the last few show() calls
+///   - `TX`: how long the previous frame took to send, in ms, from the
+///     start of show() to the end of its (possibly background) transfer
+///   - `DT`: time between the previous show() and this one, in ms
+///   - `GC`: number of garbage collections since the previous show(), if
+///     the port keeps GC stats
+///
+/// The text is written into `buf` itself, in white on black (colours 1 and
+/// 0 for palette buffers), and only when the whole screen is shown from a
+/// writable buffer; a read-only one such as `bytes` is sent unchanged.
+STATIC mp_obj_t pyb_screen_overlay(size_t n_args, const mp_obj_t *args) {
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 2) {
+        screen->overlay = mp_obj_is_true(args[1]);
+        screen->show_t0_us = mp_hal_ticks_us() - 2000000; // restart the average
+        screen->tx_us = 0;
+        screen->gc_frame = 0;
+        #if MICROPY_GC_STATS
+        screen->gc_collections = MP_STATE_MEM(gc_stats_collections);
+        #endif
+        return mp_const_none;
+    }
+    return mp_obj_new_bool(screen->overlay);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_screen_overlay_obj, 1, 2, pyb_screen_overlay);
+#endif
+
+/// \method scroll_area(top, height, bottom)
+///
+/// Define the hardware scrolling area as `height` panel lines between fixed
+/// areas of `top` and `bottom` lines; the three must add up to the number of
+/// panel lines (160).  The scroll offset is reset to 0.
+STATIC mp_obj_t pyb_screen_scroll_area(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t top = mp_obj_get_int(args[1]);
+    mp_int_t height = mp_obj_get_int(args[2]);
+    mp_int_t bottom = mp_obj_get_int(args[3]);
+    if (top < 0 || height <= 0 || bottom < 0 || top + height + bottom != DISPLAY_WIDTH) {
+        mp_raise_ValueError(NULL);
+    }
+    uint8_t cmd[] = {ST7735_VSCRDEF, top >> 8, top, height >> 8, height, bottom >> 8, bottom};
+    send_cmd(screen, cmd, sizeof(cmd));
+    screen->scroll_top = top;
+    screen->scroll_height = height;
+    screen->scroll_offset = 0;
+    uint8_t cmd1[] = {ST7735_VSCRSADD, top >> 8, top};
+    send_cmd(screen, cmd1, sizeof(cmd1));
     return mp_const_none;
 }
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_screen_show_obj, 2, 3, pyb_screen_show);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_screen_scroll_area_obj, 4, 4, pyb_screen_scroll_area);
+
+/// \method scroll([lines])
+///
+/// Scroll the contents of the scrolling area by `lines` panel lines using
+/// the ST7735 vertical scroll, without resending any pixels, and return the
+/// new scroll offset.  Panel lines run along the panel's 160-pixel axis,
+/// which is the horizontal one with the default landscape MADCTL; a
+/// vertically scrolling console needs a portrait MADCTL.
+///
+/// Frame memory does not move: after scrolling, the memory line at
+/// `top + (offset + n) % height` is displayed at line `top + n`, so only the
+/// lines that scrolled into view need to be drawn and sent with
+/// show(rect=...).  With no argument the current offset is returned.
+STATIC mp_obj_t pyb_screen_scroll(size_t n_args, const mp_obj_t *args) {
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 2) {
+        mp_int_t h = screen->scroll_height;
+        mp_int_t offset = (screen->scroll_offset + mp_obj_get_int(args[1])) % h;
+        if (offset < 0) {
+            offset += h;
+        }
+        screen->scroll_offset = offset;
+        uint16_t ssa = screen->scroll_top + offset;
+        uint8_t cmd[] = {ST7735_VSCRSADD, ssa >> 8, ssa};
+        send_cmd(screen, cmd, sizeof(cmd));
+    }
+    return MP_OBJ_NEW_SMALL_INT(screen->scroll_offset);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_screen_scroll_obj, 1, 2, pyb_screen_scroll);
+
+/// \method palette([buf])
+///
+/// Load the palette used by show(buf, palette).  `buf` holds up to 256
+/// RGB565 colours as unsigned 16-bit values, eg an array('H'); entries
+/// beyond the end of `buf` are left unchanged.  With no argument the default
+/// 16-colour palette is restored.
+STATIC mp_obj_t pyb_screen_palette(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 1) {
+        mp_machine_display_palette_reset(palette);
+        return mp_const_none;
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+    mp_machine_display_palette_load(palette, &bufinfo);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_screen_palette_obj, 1, 2, pyb_screen_palette);
+
+// Render the glyphs of n console cells starting at cell (col, row) as RGB565
+// using palette entries 1 (text) and 0 (background), and send them in one
+// address window.  n must fit in the line buffers.
+STATIC void screen_console_draw_cells(pyb_screen_obj_t *screen, uint col, uint row, uint n) {
+    screen_console_t *con = screen->console;
+    uint16_t *dest = &screen_line_buf[0][0];
+    uint w = n * 8;
+    uint16_t colors[2] = {palette[0], palette[1]};
+    if (screen->bits == 16) {
+        // the palette is kept in wire order for 8-bit frames
+        colors[0] = (colors[0] >> 8) | (colors[0] << 8);
+        colors[1] = (colors[1] >> 8) | (colors[1] << 8);
+    }
+    for (uint i = 0; i < n; ++i) {
+        uint chr = (byte)con->cells[row][col + i];
+        if (chr < 32 || chr > 127) {
+            chr = 127;
+        }
+        const uint8_t *chr_data = &font_petme128_8x8[(chr - 32) * 8];
+        // each font byte is a column of 8 pixels, LSB at top
+        for (uint x = 0; x < 8; ++x) {
+            uint vline_data = chr_data[x];
+            for (uint y = 0; y < 8; ++y, vline_data >>= 1) {
+                dest[y * w + i * 8 + x] = colors[vline_data & 1];
+            }
+        }
+    }
+    screen_set_window(screen, col * 8, row * 8, w, 8);
+    screen->window_partial = true;
+    screen_write_pixels(screen, MP_OBJ_NULL, (const byte*)dest, 0, w, 8, w, SCREEN_MODE_RGB565, true, mp_const_none);
+}
+
+// Redraw the console cells that differ from what is on the panel, sending
+// each run of changed cells in a row as one rectangle.
+STATIC void screen_console_flush(pyb_screen_obj_t *screen) {
+    screen_console_t *con = screen->console;
+    const uint max_run = sizeof(screen_line_buf) / (8 * 8 * sizeof(uint16_t));
+    // a background show() still has the bus, so finish that first
+    screen_wait_idle(screen);
+    for (uint row = 0; row < con->rows; ++row) {
+        for (uint col = 0; col < con->cols;) {
+            if (con->cells[row][col] == con->shown[row][col]) {
+                ++col;
+                continue;
+            }
+            uint n = 0;
+            while (col + n < con->cols && n < max_run
+                && con->cells[row][col + n] != con->shown[row][col + n]) {
+                con->shown[row][col + n] = con->cells[row][col + n];
+                ++n;
+            }
+            screen_console_draw_cells(screen, col, row, n);
+            col += n;
+        }
+    }
+}
+
+STATIC void screen_console_newline(screen_console_t *con) {
+    con->col = 0;
+    if (con->row + 1 < con->rows) {
+        ++con->row;
+    } else {
+        // scroll the text up a line; only cells that change get redrawn
+        memmove(con->cells[0], con->cells[1], (con->rows - 1) * SCREEN_CON_COLS);
+        memset(con->cells[con->rows - 1], ' ', SCREEN_CON_COLS);
+    }
+}
 
+STATIC void screen_console_char(screen_console_t *con, byte c) {
+    if (con->esc_state == 1) {
+        con->esc_state = c == '[' ? 2 : 0;
+        con->esc_arg = 0;
+        return;
+    }
+    if (con->esc_state == 2) {
+        if (c >= '0' && c <= '9') {
+            con->esc_arg = con->esc_arg * 10 + c - '0';
+            return;
+        }
+        con->esc_state = 0;
+        if (c == 'D') {
+            // cursor left, as used by the REPL line editor
+            uint n = con->esc_arg == 0 ? 1 : con->esc_arg;
+            con->col = n > con->col ? 0 : con->col - n;
+        } else if (c == 'C') {
+            uint n = con->esc_arg == 0 ? 1 : con->esc_arg;
+            con->col = MIN(con->col + n, con->cols - 1);
+        } else if (c == 'K') {
+            // erase to end of line
+            memset(&con->cells[con->row][con->col], ' ', con->cols - con->col);
+        }
+        return;
+    }
+    if (c == 0x1b) {
+        con->esc_state = 1;
+    } else if (c == '\n') {
+        screen_console_newline(con);
+    } else if (c == '\r') {
+        con->col = 0;
+    } else if (c == '\b') {
+        if (con->col > 0) {
+            --con->col;
+        }
+    } else if (c >= 32) {
+        if (con->col >= con->cols) {
+            screen_console_newline(con);
+        }
+        con->cells[con->row][con->col++] = c;
+    }
+}
+
+STATIC mp_uint_t screen_stream_write(mp_obj_t self_in, const void *buf_in, mp_uint_t size, int *errcode) {
+    (void)errcode;
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(self_in);
+    screen_console_t *con = screen->console;
+    if (con == NULL) {
+        con = m_new_obj(screen_console_t);
+        // '\0' never matches a printable cell, so the first flush clears the panel
+        memset(con->cells, ' ', sizeof(con->cells));
+        memset(con->shown, 0, sizeof(con->shown));
+        con->cols = MIN(screen->height / 8, SCREEN_CON_COLS);
+        con->rows = MIN(screen->width / 8, SCREEN_CON_ROWS);
+        con->col = con->row = con->esc_state = 0;
+        screen->console = con;
+    }
+    const byte *buf = buf_in;
+    for (mp_uint_t i = 0; i < size; ++i) {
+        screen_console_char(con, buf[i]);
+    }
+    screen_console_flush(screen);
+    return size;
+}
+
+STATIC mp_uint_t screen_stream_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
+    (void)self_in;
+    (void)buf;
+    (void)size;
+    // the screen is output only
+    *errcode = MP_EAGAIN;
+    return MP_STREAM_ERROR;
+}
+
+STATIC mp_uint_t screen_stream_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    (void)self_in;
+    (void)arg;
+    if (request == MP_STREAM_POLL || request == MP_STREAM_CLOSE) {
+        // never readable
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+/// \method console_clear()
+///
+/// Clear the text console shown when the screen is attached with
+/// `uos.dupterm(screen)`, and move its cursor to the top left.  The console
+/// draws only the 8x8 character cells whose text changed, so output to it
+/// costs little more than the pixels of the new characters.
+STATIC mp_obj_t pyb_screen_console_clear(mp_obj_t self_in) {
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(self_in);
+    screen_console_t *con = screen->console;
+    if (con != NULL) {
+        memset(con->cells, ' ', sizeof(con->cells));
+        // the panel may have been drawn over by show(), so redraw everything
+        memset(con->shown, 0, sizeof(con->shown));
+        con->col = con->row = con->esc_state = 0;
+        screen_console_flush(screen);
+    }
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_screen_console_clear_obj, pyb_screen_console_clear);
 
 STATIC const mp_rom_map_elem_t pyb_screen_locals_dict_table[] = {
     // instance methods
-    { MP_ROM_QSTR(MP_QSTR_show), MP_ROM_PTR(&pyb_screen_show_obj) }
+    { MP_ROM_QSTR(MP_QSTR_show), MP_ROM_PTR(&pyb_screen_show_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&pyb_screen_busy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&pyb_screen_wait_obj) },
+    { MP_ROM_QSTR(MP_QSTR_buffers), MP_ROM_PTR(&pyb_screen_buffers_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flip), MP_ROM_PTR(&pyb_screen_flip_obj) },
+    { MP_ROM_QSTR(MP_QSTR_palette), MP_ROM_PTR(&pyb_screen_palette_obj) },
+    { MP_ROM_QSTR(MP_QSTR_framerate), MP_ROM_PTR(&pyb_screen_framerate_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pace), MP_ROM_PTR(&pyb_screen_pace_obj) },
+    #if MICROPY_HW_SCREEN_OVERLAY
+    { MP_ROM_QSTR(MP_QSTR_overlay), MP_ROM_PTR(&pyb_screen_overlay_obj) },
+    #endif
+    { MP_ROM_QSTR(MP_QSTR_scroll_area), MP_ROM_PTR(&pyb_screen_scroll_area_obj) },
+    { MP_ROM_QSTR(MP_QSTR_scroll), MP_ROM_PTR(&pyb_screen_scroll_obj) },
+    { MP_ROM_QSTR(MP_QSTR_console_clear), MP_ROM_PTR(&pyb_screen_console_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(pyb_screen_locals_dict, pyb_screen_locals_dict_table);
 
+STATIC const mp_stream_p_t screen_stream_p = {
+    .read = screen_stream_read,
+    .write = screen_stream_write,
+    .ioctl = screen_stream_ioctl,
+    .is_text = false,
+};
+
+// Abort any non-blocking show() and forget the screen object; called on soft reset.
+void screen_deinit(void) {
+    pyb_screen_obj_t *screen = MP_STATE_PORT(pyb_screen_obj);
+    if (screen != NULL && screen->busy) {
+        // the callback can't be run after a soft reset
+        screen->tx_callback = mp_const_none;
+        spi_transfer_abort(screen->spi);
+    }
+    MP_STATE_PORT(pyb_screen_obj) = NULL;
+}
+
 const mp_obj_type_t pyb_screen_type = {
     { &mp_type_type },
     .name = MP_QSTR_SCREEN,
     .make_new = pyb_screen_make_new,
+    .protocol = &screen_stream_p,
     .locals_dict = (mp_obj_dict_t*)&pyb_screen_locals_dict,
 };
 
+const mp_machine_display_p_t *mp_machine_display_get(mp_obj_t obj) {
+    if (!mp_obj_is_type(obj, &pyb_screen_type)) {
+        mp_raise_TypeError("not a display");
+    }
+    return &screen_display_p;
+}
+
 #endif // MICROPY_HW_HAS_SCREEN
@@ -23,6 +23,8 @@
 #define ST7735_RAMRD 0x2E
 
 #define ST7735_PTLAR 0x30
+#define ST7735_VSCRDEF 0x33
+#define ST7735_VSCRSADD 0x37
 #define ST7735_COLMOD 0x3A
 #define ST7735_MADCTL 0x36
 
@@ -57,4 +59,6 @@
 
 extern const mp_obj_type_t pyb_screen_type;
 
+void screen_deinit(void);
+
 #endif // MICROPY_INCLUDED_STM32_LCD_H
\ No newline at end of file
@@ -131,6 +131,16 @@
 
 static uint8_t pyb_sdmmc_flags;
 
+#if MICROPY_HW_SDCARD_READAHEAD_BLOCKS
+// FatFs reads a file a sector or two at a time, so when reads follow on from
+// each other a window of blocks is fetched with one multi-block transfer and
+// the next reads are served from it.  Any write drops the window.
+STATIC uint8_t sdcard_readahead_buf[MICROPY_HW_SDCARD_READAHEAD_BLOCKS * SDCARD_BLOCK_SIZE] __attribute__((aligned(4)));
+STATIC uint32_t sdcard_readahead_start; // first block held in the window
+STATIC uint32_t sdcard_readahead_count; // number of blocks held, 0 if none
+STATIC uint32_t sdcard_readahead_next; // block following the last read
+#endif
+
 // TODO: I think that as an optimization, we can allocate these dynamically
 //       if an sd card is detected. This will save approx 260 bytes of RAM
 //       when no sdcard was being used.
@@ -354,6 +364,9 @@ void sdcard_power_off(void) {
         #endif
     }
     pyb_sdmmc_flags &= ~PYB_SDMMC_FLAG_ACTIVE;
+    #if MICROPY_HW_SDCARD_READAHEAD_BLOCKS
+    sdcard_readahead_count = 0; // the card may be changed
+    #endif
 }
 
 uint64_t sdcard_get_capacity_in_bytes(void) {
@@ -571,12 +584,48 @@ mp_uint_t sdcard_read_blocks(uint8_t *dest, uint32_t block_num, uint32_t num_blo
     return err;
 }
 
+#if MICROPY_HW_SDCARD_READAHEAD_BLOCKS
+STATIC mp_uint_t sdcard_read_blocks_readahead(uint8_t *dest, uint32_t block_num, uint32_t num_blocks) {
+    bool sequential = block_num == sdcard_readahead_next;
+    sdcard_readahead_next = block_num + num_blocks;
+
+    // Copy the leading blocks held in the window
+    while (num_blocks > 0 && block_num - sdcard_readahead_start < sdcard_readahead_count) {
+        memcpy(dest, &sdcard_readahead_buf[(block_num - sdcard_readahead_start) * SDCARD_BLOCK_SIZE], SDCARD_BLOCK_SIZE);
+        dest += SDCARD_BLOCK_SIZE;
+        block_num += 1;
+        num_blocks -= 1;
+    }
+    if (num_blocks == 0) {
+        return HAL_OK;
+    }
+
+    if (sequential && num_blocks < MICROPY_HW_SDCARD_READAHEAD_BLOCKS) {
+        // Fill the window from here; this can fail at the end of the card,
+        // and then the blocks are read alone
+        sdcard_readahead_count = 0;
+        if (sdcard_read_blocks(sdcard_readahead_buf, block_num, MICROPY_HW_SDCARD_READAHEAD_BLOCKS) == HAL_OK) {
+            sdcard_readahead_start = block_num;
+            sdcard_readahead_count = MICROPY_HW_SDCARD_READAHEAD_BLOCKS;
+            memcpy(dest, sdcard_readahead_buf, num_blocks * SDCARD_BLOCK_SIZE);
+            return HAL_OK;
+        }
+    }
+
+    return sdcard_read_blocks(dest, block_num, num_blocks);
+}
+#endif
+
 mp_uint_t sdcard_write_blocks(const uint8_t *src, uint32_t block_num, uint32_t num_blocks) {
     // check that SD card is initialised
     if (!(pyb_sdmmc_flags & PYB_SDMMC_FLAG_ACTIVE)) {
         return HAL_ERROR;
     }
 
+    #if MICROPY_HW_SDCARD_READAHEAD_BLOCKS
+    sdcard_readahead_count = 0;
+    #endif
+
     HAL_StatusTypeDef err = HAL_OK;
 
     // check that src pointer is aligned on a 4-byte boundary
@@ -872,7 +921,11 @@ void sdcard_init_vfs(fs_user_mount_t *vfs, int part) {
     vfs->fatfs.part = part;
     vfs->readblocks[0] = MP_OBJ_FROM_PTR(&pyb_sdcard_readblocks_obj);
     vfs->readblocks[1] = MP_OBJ_FROM_PTR(&pyb_sdcard_obj);
+    #if MICROPY_HW_SDCARD_READAHEAD_BLOCKS
+    vfs->readblocks[2] = MP_OBJ_FROM_PTR(sdcard_read_blocks_readahead); // native version
+    #else
     vfs->readblocks[2] = MP_OBJ_FROM_PTR(sdcard_read_blocks); // native version
+    #endif
     vfs->writeblocks[0] = MP_OBJ_FROM_PTR(&pyb_sdcard_writeblocks_obj);
     vfs->writeblocks[1] = MP_OBJ_FROM_PTR(&pyb_sdcard_obj);
     vfs->writeblocks[2] = MP_OBJ_FROM_PTR(sdcard_write_blocks); // native version
@@ -30,6 +30,7 @@
 #include "py/runtime.h"
 #include "py/mphal.h"
 #include "spi.h"
+#include "powerctrl.h"
 
 // Possible DMA configurations for SPI busses:
 // SPI1_TX: DMA2_Stream3.CHANNEL_3 or DMA2_Stream5.CHANNEL_3
@@ -119,6 +120,8 @@ void SPI6_IRQHandler(void) { IRQ_ENTER(SPI6_IRQn); HAL_SPI_IRQHandler(&SPIHandle
 #endif
 #endif
 
+STATIC void spi_clock_notify(int event);
+
 void spi_init0(void) {
     // Initialise the SPI handles.
     // The structs live on the BSS so all other fields will be zero after a reset.
@@ -140,6 +143,8 @@ void spi_init0(void) {
     #if defined(MICROPY_HW_SPI6_SCK)
     SPIHandle6.Instance = SPI6;
     #endif
+
+    powerctrl_clock_notify_table[POWERCTRL_CLOCK_NOTIFY_SPI] = spi_clock_notify;
 }
 
 int spi_find_index(mp_obj_t id) {
@@ -259,6 +264,8 @@ void spi_set_params(const spi_t *spi_obj, uint32_t prescale, int32_t baudrate,
 // TODO allow to take a list of pins to use
 void spi_init(const spi_t *self, bool enable_nss_pin) {
     SPI_HandleTypeDef *spi = self->spi;
+    // settings applied by a driver sharing this bus are no longer in place
+    spi_bus_state[self - &spi_obj[0]].owner = NULL;
     uint32_t irqn = 0;
     const pin_obj_t *pins[4] = { NULL, NULL, NULL, NULL };
 
@@ -387,6 +394,7 @@ void spi_init(const spi_t *self, bool enable_nss_pin) {
 
 void spi_deinit(const spi_t *spi_obj) {
     SPI_HandleTypeDef *spi = spi_obj->spi;
+    spi_transfer_abort(spi_obj);
     HAL_SPI_DeInit(spi);
     if (0) {
     #if defined(MICROPY_HW_SPI1_SCK)
@@ -436,34 +444,49 @@ void spi_deinit(const spi_t *spi_obj) {
 
 STATIC HAL_StatusTypeDef spi_wait_dma_finished(const spi_t *spi, uint32_t t_start, uint32_t timeout) {
     volatile HAL_SPI_StateTypeDef *state = &spi->spi->State;
+    HAL_StatusTypeDef status = HAL_OK;
+    bool released = MICROPY_HW_WAIT_BEGIN();
     for (;;) {
         // Do an atomic check of the state; WFI will exit even if IRQs are disabled
         uint32_t irq_state = disable_irq();
         if (*state == HAL_SPI_STATE_READY) {
             enable_irq(irq_state);
-            return HAL_OK;
+            break;
         }
-        __WFI();
+        MICROPY_HW_WAIT_IDLE(released);
         enable_irq(irq_state);
         if (HAL_GetTick() - t_start >= timeout) {
-            return HAL_TIMEOUT;
+            status = HAL_TIMEOUT;
+            break;
         }
     }
-    return HAL_OK;
+    MICROPY_HW_WAIT_END(released);
+    return status;
 }
 
+// Transfers up to this many bytes are polled: setting up the DMA takes
+// longer than sending them, and commands to SPI flash are mostly this short.
+#define SPI_TRANSFER_POLL_MAX (16)
+
 void spi_transfer(const spi_t *self, size_t len, const uint8_t *src, uint8_t *dest, uint32_t timeout) {
     // Note: there seems to be a problem sending 1 byte using DMA the first
     // time directly after the SPI/DMA is initialised.  The cause of this is
-    // unknown but we sidestep the issue by using polling for 1 byte transfer.
+    // unknown but we sidestep the issue by using polling for short transfers.
 
     // Note: DMA transfers are limited to 65535 bytes at a time.
 
+    if (spi_transfer_busy(self)) {
+        // its error, if any, is for whoever started it
+        spi_transfer_wait(self, timeout);
+    }
+
+    MP_HAL_CYCLES_START(cycles_start);
     HAL_StatusTypeDef status;
+    bool poll = len <= SPI_TRANSFER_POLL_MAX || query_irq() == IRQ_STATE_DISABLED;
 
     if (dest == NULL) {
         // send only
-        if (len == 1 || query_irq() == IRQ_STATE_DISABLED) {
+        if (poll) {
             status = HAL_SPI_Transmit(self->spi, (uint8_t*)src, len, timeout);
         } else {
             DMA_HandleTypeDef tx_dma;
@@ -489,7 +512,7 @@ void spi_transfer(const spi_t *self, size_t len, const uint8_t *src, uint8_t *de
         }
     } else if (src == NULL) {
         // receive only
-        if (len == 1 || query_irq() == IRQ_STATE_DISABLED) {
+        if (poll) {
             status = HAL_SPI_Receive(self->spi, dest, len, timeout);
         } else {
             DMA_HandleTypeDef tx_dma, rx_dma;
@@ -524,7 +547,7 @@ void spi_transfer(const spi_t *self, size_t len, const uint8_t *src, uint8_t *de
         }
     } else {
         // send and receive
-        if (len == 1 || query_irq() == IRQ_STATE_DISABLED) {
+        if (poll) {
             status = HAL_SPI_TransmitReceive(self->spi, (uint8_t*)src, dest, len, timeout);
         } else {
             DMA_HandleTypeDef tx_dma, rx_dma;
@@ -553,6 +576,7 @@ void spi_transfer(const spi_t *self, size_t len, const uint8_t *src, uint8_t *de
             dma_deinit(self->rx_dma_descr);
         }
     }
+    MP_HAL_CYCLES_STOP(cycles_start, &mp_hal_cycles_spi_transfer);
 
     if (status != HAL_OK) {
         mp_hal_raise(status);
@@ -616,27 +640,386 @@ const spi_t *spi_from_mp_obj(mp_obj_t o) {
     }
 }
 
+/******************************************************************************/
+// Arbitration of an SPI bus shared by several drivers
+
+typedef struct _spi_bus_state_t {
+    const void *owner;
+    volatile bool busy;
+} spi_bus_state_t;
+
+STATIC spi_bus_state_t spi_bus_state[MP_ARRAY_SIZE(spi_obj)];
+
+bool spi_bus_acquire(const spi_t *spi, const void *owner) {
+    spi_bus_state_t *bus = &spi_bus_state[spi - &spi_obj[0]];
+    // A background transfer is completed by the DMA IRQ, which has a higher
+    // priority than IRQ_PRI_FLASH, so it is safe to spin here.
+    uint32_t t_start = HAL_GetTick();
+    while (bus->busy) {
+        if (HAL_GetTick() - t_start >= 1000) {
+            break;
+        }
+    }
+    if (bus->owner == owner) {
+        return false;
+    }
+    bus->owner = owner;
+    return true;
+}
+
+void spi_bus_set_busy(const spi_t *spi, bool busy) {
+    spi_bus_state[spi - &spi_obj[0]].busy = busy;
+}
+
+void spi_bus_apply_init(const spi_t *spi) {
+    // the peripheral is already clocked and its pins configured, so only the
+    // control registers need to be rewritten
+    HAL_SPI_Init(spi->spi);
+}
+
+// Keep the baudrates of initialised SPI buses across a change of the bus
+// clocks.  Drivers sharing a bus are made to re-apply their own settings at
+// their next transaction, since they know the baudrate they asked for.
+STATIC void spi_clock_notify(int event) {
+    static uint32_t baudrate[MP_ARRAY_SIZE(spi_obj)];
+    for (size_t i = 0; i < MP_ARRAY_SIZE(spi_obj); ++i) {
+        const spi_t *self = &spi_obj[i];
+        SPI_HandleTypeDef *spi = self->spi;
+        if (spi->Instance == NULL || spi->State == HAL_SPI_STATE_RESET
+            || spi->Init.Mode != SPI_MODE_MASTER) {
+            continue;
+        }
+        if (event == POWERCTRL_CLOCKS_CHANGING) {
+            // let background transfers end at the old rate
+            spi_transfer_wait(self, 1000);
+            spi_bus_acquire(self, NULL);
+            baudrate[i] = spi_get_source_freq(spi) >> ((spi->Init.BaudRatePrescaler >> 3) + 1);
+        } else {
+            spi_set_params(self, 0xffffffff, baudrate[i], -1, -1, -1, -1);
+            spi_bus_apply_init(self);
+        }
+    }
+}
+
+/******************************************************************************/
+// Background transfers
+
+typedef struct _spi_async_t {
+    // these must outlive the call that starts the transfer
+    DMA_HandleTypeDef tx_dma;
+    DMA_HandleTypeDef rx_dma;
+    bool use_tx;
+    bool use_rx;
+    volatile bool busy;
+    HAL_StatusTypeDef status; // of the last transfer
+    spi_async_callback_t callback;
+    void *callback_arg;
+    // what is left of the transfer, which goes in pieces of 65535 frames
+    const uint8_t *src;
+    uint8_t *dest;
+    size_t len;
+    size_t chunk_len;
+    size_t frame_len;
+} spi_async_t;
+
+STATIC spi_async_t spi_async[MP_ARRAY_SIZE(spi_obj)];
+
+STATIC void spi_async_dma_init(DMA_HandleTypeDef *dma, const dma_descr_t *descr, uint32_t dir, SPI_HandleTypeDef *spi) {
+    dma_init(dma, descr, dir, spi);
+    if (spi->Init.DataSize == SPI_DATASIZE_16BIT) {
+        // dma_init sets up byte transfers, 16-bit frames need halfwords
+        dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+        dma->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+        HAL_DMA_DeInit(dma);
+        HAL_DMA_Init(dma);
+    }
+}
+
+STATIC void spi_async_dma_deinit(DMA_HandleTypeDef *dma, const dma_descr_t *descr) {
+    if (dma->Init.MemDataAlignment != DMA_MDATAALIGN_BYTE) {
+        // make the next dma_init reprogram the stream for byte transfers
+        dma_invalidate_channel(descr);
+    }
+    dma_deinit(descr);
+}
+
+STATIC HAL_StatusTypeDef spi_async_start_chunk(const spi_t *self, spi_async_t *async) {
+    // the HAL counts frames, not bytes
+    uint16_t n = MIN(async->len / async->frame_len, 65535);
+    async->chunk_len = n * async->frame_len;
+    if (async->dest == NULL) {
+        return HAL_SPI_Transmit_DMA(self->spi, (uint8_t*)async->src, n);
+    } else if (async->src == NULL) {
+        return HAL_SPI_Receive_DMA(self->spi, async->dest, n);
+    } else {
+        return HAL_SPI_TransmitReceive_DMA(self->spi, (uint8_t*)async->src, async->dest, n);
+    }
+}
+
+STATIC void spi_async_finish(const spi_t *self, spi_async_t *async, HAL_StatusTypeDef status) {
+    if (async->use_tx) {
+        spi_async_dma_deinit(&async->tx_dma, self->tx_dma_descr);
+    }
+    if (async->use_rx) {
+        spi_async_dma_deinit(&async->rx_dma, self->rx_dma_descr);
+    }
+    async->status = status;
+    async->busy = false;
+    spi_bus_set_busy(self, false);
+    if (async->callback != NULL) {
+        async->callback(self, status, async->callback_arg);
+    }
+}
+
+// Called by the HAL from the DMA IRQ when any DMA transfer ends.
+STATIC void spi_async_irq(SPI_HandleTypeDef *hspi, HAL_StatusTypeDef status) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(spi_obj); ++i) {
+        if (spi_obj[i].spi != hspi) {
+            continue;
+        }
+        spi_async_t *async = &spi_async[i];
+        if (!async->busy) {
+            // a blocking transfer, which polls for its end
+            return;
+        }
+        if (status == HAL_OK) {
+            async->len -= async->chunk_len;
+            if (async->src != NULL) {
+                async->src += async->chunk_len;
+            }
+            if (async->dest != NULL) {
+                async->dest += async->chunk_len;
+            }
+            if (async->len > 0) {
+                status = spi_async_start_chunk(&spi_obj[i], async);
+                if (status == HAL_OK) {
+                    return;
+                }
+            }
+        }
+        spi_async_finish(&spi_obj[i], async, status);
+        return;
+    }
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spi_async_irq(hspi, HAL_OK);
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spi_async_irq(hspi, HAL_OK);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spi_async_irq(hspi, HAL_OK);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+    spi_async_irq(hspi, HAL_ERROR);
+}
+
+HAL_StatusTypeDef spi_transfer_async(const spi_t *self, size_t len, const uint8_t *src, uint8_t *dest,
+    spi_async_callback_t callback, void *callback_arg) {
+    spi_async_t *async = &spi_async[self - &spi_obj[0]];
+    if (async->busy) {
+        return HAL_BUSY;
+    }
+    size_t frame_len = self->spi->Init.DataSize == SPI_DATASIZE_16BIT ? 2 : 1;
+    if (len == 0 || len % frame_len != 0) {
+        return HAL_ERROR;
+    }
+    async->callback = callback;
+    async->callback_arg = callback_arg;
+
+    if (len <= SPI_TRANSFER_POLL_MAX || query_irq() == IRQ_STATE_DISABLED) {
+        // not worth the DMA set up, see spi_transfer
+        HAL_StatusTypeDef status;
+        uint32_t timeout = SPI_TRANSFER_TIMEOUT(len);
+        if (dest == NULL) {
+            status = HAL_SPI_Transmit(self->spi, (uint8_t*)src, len / frame_len, timeout);
+        } else if (src == NULL) {
+            status = HAL_SPI_Receive(self->spi, dest, len / frame_len, timeout);
+        } else {
+            status = HAL_SPI_TransmitReceive(self->spi, (uint8_t*)src, dest, len / frame_len, timeout);
+        }
+        if (status == HAL_OK) {
+            async->use_tx = async->use_rx = false;
+            spi_async_finish(self, async, status);
+        }
+        return status;
+    }
+
+    async->src = src;
+    async->dest = dest;
+    async->len = len;
+    async->frame_len = frame_len;
+    // in master mode a receive is done by the HAL as a TransmitReceive
+    async->use_tx = dest == NULL || src != NULL || self->spi->Init.Mode == SPI_MODE_MASTER;
+    async->use_rx = dest != NULL;
+    self->spi->hdmatx = NULL;
+    self->spi->hdmarx = NULL;
+    if (async->use_tx) {
+        spi_async_dma_init(&async->tx_dma, self->tx_dma_descr, DMA_MEMORY_TO_PERIPH, self->spi);
+        self->spi->hdmatx = &async->tx_dma;
+    }
+    if (async->use_rx) {
+        spi_async_dma_init(&async->rx_dma, self->rx_dma_descr, DMA_PERIPH_TO_MEMORY, self->spi);
+        self->spi->hdmarx = &async->rx_dma;
+    }
+    if (src != NULL) {
+        MP_HAL_CLEAN_DCACHE(src, len);
+    }
+    if (dest != NULL) {
+        MP_HAL_CLEANINVALIDATE_DCACHE(dest, len);
+    }
+
+    // other drivers on the bus wait in spi_bus_acquire until this is done
+    async->busy = true;
+    spi_bus_set_busy(self, true);
+    HAL_StatusTypeDef status = spi_async_start_chunk(self, async);
+    if (status != HAL_OK) {
+        async->callback = NULL;
+        spi_async_finish(self, async, status);
+    }
+    return status;
+}
+
+bool spi_transfer_busy(const spi_t *self) {
+    return spi_async[self - &spi_obj[0]].busy;
+}
+
+HAL_StatusTypeDef spi_transfer_wait(const spi_t *self, uint32_t timeout) {
+    spi_async_t *async = &spi_async[self - &spi_obj[0]];
+    uint32_t t_start = HAL_GetTick();
+    HAL_StatusTypeDef status;
+    bool released = MICROPY_HW_WAIT_BEGIN();
+    for (;;) {
+        // Do an atomic check of the state; WFI will exit even if IRQs are disabled
+        uint32_t irq_state = disable_irq();
+        if (!async->busy) {
+            enable_irq(irq_state);
+            status = async->status;
+            break;
+        }
+        MICROPY_HW_WAIT_IDLE(released);
+        enable_irq(irq_state);
+        if (HAL_GetTick() - t_start >= timeout) {
+            spi_transfer_abort(self);
+            status = HAL_TIMEOUT;
+            break;
+        }
+    }
+    MICROPY_HW_WAIT_END(released);
+    return status;
+}
+
+void spi_transfer_abort(const spi_t *self) {
+    spi_async_t *async = &spi_async[self - &spi_obj[0]];
+    uint32_t irq_state = disable_irq();
+    if (async->busy) {
+        HAL_SPI_DMAStop(self->spi);
+        spi_async_finish(self, async, HAL_ERROR);
+    }
+    enable_irq(irq_state);
+}
+
+void spi_async_deinit(void) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(spi_obj); ++i) {
+        if (spi_async[i].busy) {
+            spi_async[i].callback = NULL;
+            spi_transfer_abort(&spi_obj[i]);
+        }
+        MP_STATE_PORT(spi_async_buf)[i] = MP_OBJ_NULL;
+    }
+}
+
+// SPI.write_async(buf) and SPI.done(), shared by pyb.SPI and machine.SPI
+
+STATIC void spi_write_async_callback(const spi_t *spi, HAL_StatusTypeDef status, void *arg) {
+    (void)status;
+    (void)arg;
+    // the DMA has finished with the buffer
+    MP_STATE_PORT(spi_async_buf)[spi - &spi_obj[0]] = MP_OBJ_NULL;
+}
+
+// Wait for a background transfer to end, raising its error if it failed.
+STATIC void spi_async_wait_raise(const spi_t *self) {
+    spi_async_t *async = &spi_async[self - &spi_obj[0]];
+    while (async->busy) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    HAL_StatusTypeDef status = async->status;
+    async->status = HAL_OK;
+    if (status != HAL_OK) {
+        mp_hal_raise(status);
+    }
+}
+
+STATIC mp_obj_t spi_write_async(mp_obj_t self_in, mp_obj_t buf_in) {
+    const spi_t *self = spi_from_mp_obj(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    spi_async_wait_raise(self);
+    if (bufinfo.len == 0) {
+        return mp_const_none;
+    }
+    MP_STATE_PORT(spi_async_buf)[self - &spi_obj[0]] = buf_in;
+    HAL_StatusTypeDef status = spi_transfer_async(self, bufinfo.len, bufinfo.buf, NULL, spi_write_async_callback, NULL);
+    if (status != HAL_OK) {
+        MP_STATE_PORT(spi_async_buf)[self - &spi_obj[0]] = MP_OBJ_NULL;
+        mp_hal_raise(status);
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(spi_write_async_obj, spi_write_async);
+
+STATIC mp_obj_t spi_done(mp_obj_t self_in) {
+    const spi_t *self = spi_from_mp_obj(self_in);
+    if (spi_transfer_busy(self)) {
+        return mp_const_false;
+    }
+    spi_async_wait_raise(self);
+    return mp_const_true;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(spi_done_obj, spi_done);
+
 /******************************************************************************/
 // Implementation of low-level SPI C protocol
 
+STATIC void spi_proto_set_init(spi_proto_cfg_t *self) {
+    self->spi->spi->Init.Mode = SPI_MODE_MASTER;
+    self->spi->spi->Init.Direction = SPI_DIRECTION_2LINES;
+    self->spi->spi->Init.NSS = SPI_NSS_SOFT;
+    self->spi->spi->Init.TIMode = SPI_TIMODE_DISABLE;
+    self->spi->spi->Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    spi_set_params(self->spi, 0xffffffff, self->baudrate,
+        self->polarity, self->phase, self->bits, self->firstbit);
+}
+
 STATIC int spi_proto_ioctl(void *self_in, uint32_t cmd) {
     spi_proto_cfg_t *self = (spi_proto_cfg_t*)self_in;
     // printf("spi ioctl %ld\n", cmd);
     switch (cmd) {
         case MP_SPI_IOCTL_INIT:
-            self->spi->spi->Init.Mode = SPI_MODE_MASTER;
-            self->spi->spi->Init.Direction = SPI_DIRECTION_2LINES;
-            self->spi->spi->Init.NSS = SPI_NSS_SOFT;
-            self->spi->spi->Init.TIMode = SPI_TIMODE_DISABLE;
-            self->spi->spi->Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
-            spi_set_params(self->spi, 0xffffffff, self->baudrate,
-                self->polarity, self->phase, self->bits, self->firstbit);
+            spi_proto_set_init(self);
             spi_init(self->spi, false);
+            spi_bus_acquire(self->spi, self);
             break;
 
         case MP_SPI_IOCTL_DEINIT:
             spi_deinit(self->spi);
             break;
+
+        case MP_SPI_IOCTL_BUS_ACQUIRE:
+            if (spi_bus_acquire(self->spi, self)) {
+                // another driver used the bus since, restore our settings
+                spi_proto_set_init(self);
+                spi_bus_apply_init(self->spi);
+            }
+            break;
+
+        case MP_SPI_IOCTL_BUS_RELEASE:
+            break;
     }
 
     return 0;
@@ -80,7 +80,36 @@ int spi_find_index(mp_obj_t id);
 void spi_set_params(const spi_t *spi_obj, uint32_t prescale, int32_t baudrate,
     int32_t polarity, int32_t phase, int32_t bits, int32_t firstbit);
 void spi_transfer(const spi_t *self, size_t len, const uint8_t *src, uint8_t *dest, uint32_t timeout);
+
+// A background transfer uses DMA and returns straight away.  callback is
+// called with the result from the DMA IRQ once the transfer has ended, or
+// before spi_transfer_async returns if the transfer was short enough to be
+// polled.  If spi_transfer_async doesn't return HAL_OK nothing was started
+// and callback isn't called.  src and dest must stay valid until the end,
+// and if the bus has 16-bit frames len must be even.  Blocking transfers
+// on the bus wait for a background one to finish.
+typedef void (*spi_async_callback_t)(const spi_t *spi, HAL_StatusTypeDef status, void *arg);
+HAL_StatusTypeDef spi_transfer_async(const spi_t *self, size_t len, const uint8_t *src, uint8_t *dest,
+    spi_async_callback_t callback, void *callback_arg);
+bool spi_transfer_busy(const spi_t *self);
+HAL_StatusTypeDef spi_transfer_wait(const spi_t *self, uint32_t timeout);
+void spi_transfer_abort(const spi_t *self);
+void spi_async_deinit(void);
+MP_DECLARE_CONST_FUN_OBJ_2(spi_write_async_obj);
+MP_DECLARE_CONST_FUN_OBJ_1(spi_done_obj);
 void spi_print(const mp_print_t *print, const spi_t *spi_obj, bool legacy);
 const spi_t *spi_from_mp_obj(mp_obj_t o);
 
+// Arbitration for an SPI bus shared by drivers with different settings, eg
+// the display and the external flash on MEOWBIT.  Each transaction must run
+// at IRQ_PRI_FLASH or above so it can't be interrupted by another user.
+// spi_bus_acquire waits for any background transfer on the bus to finish and
+// returns true if the bus was last set up by a different owner, in which case
+// the caller must set its init parameters and call spi_bus_apply_init.  A
+// driver that leaves a DMA transfer running marks the bus with
+// spi_bus_set_busy until the transfer completes.
+bool spi_bus_acquire(const spi_t *spi, const void *owner);
+void spi_bus_set_busy(const spi_t *spi, bool busy);
+void spi_bus_apply_init(const spi_t *spi);
+
 #endif // MICROPY_INCLUDED_STM32_SPI_H
@@ -41,9 +41,28 @@ int32_t spi_bdev_ioctl(spi_bdev_t *bdev, uint32_t op, uint32_t arg) {
             return 0;
 
         case BDEV_IOCTL_IRQ_HANDLER:
+            // Write back the cache a step at a time once writes have stopped,
+            // returning 1 to be called again soon
             if ((bdev->spiflash.flags & 1) && HAL_GetTick() - bdev->flash_tick_counter_last_write >= 1000) {
-                mp_spiflash_cache_flush(&bdev->spiflash);
-                led_state(PYB_LED_RED, 0); // indicate a clean cache with LED off
+                int ret = mp_spiflash_cache_flush_step(&bdev->spiflash);
+                if (ret > 0) {
+                    return 1;
+                } else if (ret == 0) {
+                    led_state(PYB_LED_RED, 0); // indicate a clean cache with LED off
+                }
+            }
+            return 0;
+
+        case BDEV_IOCTL_SYNC_STEP:
+            if (bdev->spiflash.flags & 1) {
+                uint32_t basepri = raise_irq_pri(IRQ_PRI_FLASH); // prevent cache flushing and USB access
+                int ret = mp_spiflash_cache_flush_step(&bdev->spiflash);
+                restore_irq_pri(basepri);
+                if (ret > 0) {
+                    return 1;
+                } else if (ret == 0) {
+                    led_state(PYB_LED_RED, 0); // indicate a clean cache with LED off
+                }
             }
             return 0;
 
@@ -81,8 +81,15 @@ uint32_t storage_get_block_count(void) {
     #endif
 }
 
+// set while a block device is part way through writing back its cache
+static volatile bool storage_flush_pending = false;
+
+uint32_t storage_systick_period(void) {
+    return storage_flush_pending ? SYSTICK_DISPATCH_NUM_SLOTS : STORAGE_SYSTICK_MASK + 1;
+}
+
 static void storage_systick_callback(uint32_t ticks_ms) {
-    if (STORAGE_IDLE_TICK(ticks_ms)) {
+    if (STORAGE_IDLE_TICK(ticks_ms) || storage_flush_pending) {
         // Trigger a FLASH IRQ to execute at a lower priority
         NVIC->STIR = FLASH_IRQn;
     }
@@ -90,10 +97,13 @@ static void storage_systick_callback(uint32_t ticks_ms) {
 
 void FLASH_IRQHandler(void) {
     IRQ_ENTER(FLASH_IRQn);
-    MICROPY_HW_BDEV_IOCTL(BDEV_IOCTL_IRQ_HANDLER, 0);
+    // A block device returns 1 if it has more to write back, so keep
+    // triggering the IRQ until it is done
+    bool pending = MICROPY_HW_BDEV_IOCTL(BDEV_IOCTL_IRQ_HANDLER, 0) > 0;
     #if defined(MICROPY_HW_BDEV2_IOCTL)
-    MICROPY_HW_BDEV2_IOCTL(BDEV_IOCTL_IRQ_HANDLER, 0);
+    pending |= MICROPY_HW_BDEV2_IOCTL(BDEV_IOCTL_IRQ_HANDLER, 0) > 0;
     #endif
+    storage_flush_pending = pending;
     IRQ_EXIT(FLASH_IRQn);
 }
 
@@ -104,6 +114,16 @@ void storage_flush(void) {
     #endif
 }
 
+// Do one step of writing back the block device caches, without waiting for
+// the flash.  Returns true once they are clean.
+bool storage_flush_step(void) {
+    bool clean = MICROPY_HW_BDEV_IOCTL(BDEV_IOCTL_SYNC_STEP, 0) <= 0;
+    #if defined(MICROPY_HW_BDEV2_IOCTL)
+    clean &= MICROPY_HW_BDEV2_IOCTL(BDEV_IOCTL_SYNC_STEP, 0) <= 0;
+    #endif
+    return clean;
+}
+
 static void build_partition(uint8_t *buf, int boot, int type, uint32_t start_block, uint32_t num_blocks) {
     buf[0] = boot;
 
@@ -36,12 +36,16 @@ enum {
     BDEV_IOCTL_SYNC = 3,
     BDEV_IOCTL_NUM_BLOCKS = 4,
     BDEV_IOCTL_IRQ_HANDLER = 6,
+    BDEV_IOCTL_SYNC_STEP = 7,
 };
 
 void storage_init(void);
+// How often, in ms, the storage systick callback needs to run
+uint32_t storage_systick_period(void);
 uint32_t storage_get_block_size(void);
 uint32_t storage_get_block_count(void);
 void storage_flush(void);
+bool storage_flush_step(void);
 bool storage_read_block(uint8_t *dest, uint32_t block);
 bool storage_write_block(const uint8_t *src, uint32_t block);
 
@@ -62,6 +66,41 @@ int32_t spi_bdev_ioctl(spi_bdev_t *bdev, uint32_t op, uint32_t arg);
 int spi_bdev_readblocks(spi_bdev_t *bdev, uint8_t *dest, uint32_t block_num, uint32_t num_blocks);
 int spi_bdev_writeblocks(spi_bdev_t *bdev, const uint8_t *src, uint32_t block_num, uint32_t num_blocks);
 
+// A log-structured translation layer over SPI flash, an alternative to
+// spi_bdev that spreads writes over the whole device.  Each erase block
+// holds FTL_SLOTS_PER_BLOCK sectors after a page of tags; the tables are
+// sized for the flash by FTL_BDEV_DEFINE.
+#define FTL_SLOTS_PER_BLOCK (7)
+#define FTL_RESERVED_BLOCKS (8)
+#define FTL_NUM_SECTORS(num_blocks) (((num_blocks) - FTL_RESERVED_BLOCKS) * FTL_SLOTS_PER_BLOCK)
+
+typedef struct _ftl_bdev_t {
+    mp_spiflash_t spiflash;
+    uint32_t flash_tick_counter_last_write;
+    uint32_t num_blocks;
+    uint32_t seq; // sequence number of the last sector written
+    uint32_t free_blocks; // erased blocks ready to be written
+    uint32_t cur_block; // block being filled, or num_blocks if none
+    uint16_t *map; // FTL_NUM_SECTORS entries: slot holding each sector, 0xffff if none
+    uint8_t *used; // per block: slots written, FTL_SLOTS_PER_BLOCK when it can take no more
+    uint8_t *valid; // per block: slots holding the current data of a sector
+    uint16_t *wear; // per block: erase count, saturating
+} ftl_bdev_t;
+
+#define FTL_BDEV_DEFINE(name, flash_bytes) \
+    STATIC uint16_t name##_map[FTL_NUM_SECTORS((flash_bytes) / MP_SPIFLASH_ERASE_BLOCK_SIZE)]; \
+    STATIC uint8_t name##_used[(flash_bytes) / MP_SPIFLASH_ERASE_BLOCK_SIZE]; \
+    STATIC uint8_t name##_valid[(flash_bytes) / MP_SPIFLASH_ERASE_BLOCK_SIZE]; \
+    STATIC uint16_t name##_wear[(flash_bytes) / MP_SPIFLASH_ERASE_BLOCK_SIZE]; \
+    ftl_bdev_t name = { \
+        .num_blocks = (flash_bytes) / MP_SPIFLASH_ERASE_BLOCK_SIZE, \
+        .map = name##_map, .used = name##_used, .valid = name##_valid, .wear = name##_wear, \
+    }
+
+int32_t ftl_bdev_ioctl(ftl_bdev_t *bdev, uint32_t op, uint32_t arg);
+int ftl_bdev_readblocks(ftl_bdev_t *bdev, uint8_t *dest, uint32_t block_num, uint32_t num_blocks);
+int ftl_bdev_writeblocks(ftl_bdev_t *bdev, const uint8_t *src, uint32_t block_num, uint32_t num_blocks);
+
 extern const struct _mp_obj_type_t pyb_flash_type;
 
 struct _fs_user_mount_t;
@@ -29,6 +29,8 @@
 #include "irq.h"
 #include "systick.h"
 #include "pybthread.h"
+#include "storage.h"
+#include "powerctrl.h"
 
 extern __IO uint32_t uwTick;
 
@@ -52,6 +54,10 @@ void SysTick_Handler(void) {
         f(uw_tick);
     }
 
+    #if MICROPY_SAMPLING_PROFILE
+    mp_sampling_profile_tick();
+    #endif
+
     #if MICROPY_PY_THREAD
     if (pyb_thread_enabled) {
         if (pyb_thread_cur->timeslice == 0) {
@@ -72,6 +78,12 @@ void HAL_Delay(uint32_t Delay) {
     if (query_irq() == IRQ_STATE_ENABLED) {
         // IRQs enabled, so can use systick counter to do the delay
         uint32_t start = uwTick;
+        #if MICROPY_HW_ENABLE_FREQ_POLICY
+        // dropping the clock takes about 5ms, which is part of the delay
+        if (Delay > 5) {
+            powerctrl_freq_idle();
+        }
+        #endif
         // Wraparound of tick is taken care of by 2's complement arithmetic.
         while (uwTick - start < Delay) {
             // Enter sleep mode, waiting for (at least) the SysTick interrupt.
@@ -83,6 +95,122 @@ void HAL_Delay(uint32_t Delay) {
     }
 }
 
+#if MICROPY_HW_ENABLE_TICKLESS_IDLE
+
+// How often, in ticks, a dispatch slot must still run while SysTick is
+// stretched, or 0 if its handler doesn't mind being skipped.  A slot with
+// period P runs on the ticks that are equal to the slot number modulo P.
+STATIC uint32_t systick_dispatch_period(size_t slot) {
+    switch (slot) {
+        case SYSTICK_DISPATCH_DMA:
+            // only turns the clock of an idle DMA controller off
+            return 0;
+        #if MICROPY_HW_ENABLE_STORAGE
+        case SYSTICK_DISPATCH_STORAGE:
+            return storage_systick_period();
+        #endif
+        default:
+            return SYSTICK_DISPATCH_NUM_SLOTS;
+    }
+}
+
+// Sleep for up to ms ticks, or until an interrupt, with SysTick reprogrammed
+// so it doesn't wake the CPU every millisecond; uwTick is brought up to date
+// afterwards.  Must be called with IRQs disabled, so that no interrupt
+// handler runs, and sees a stale uwTick, until the ticks are back to normal.
+STATIC void systick_sleep_stretched(uint32_t ms) {
+    // don't skip a tick on which a dispatch slot must run: the tick which
+    // ends the sleep is delivered by the SysTick IRQ as usual
+    uint32_t next = uwTick + 1;
+    for (size_t slot = 0; slot < SYSTICK_DISPATCH_NUM_SLOTS; ++slot) {
+        if (systick_dispatch_table[slot] != NULL) {
+            uint32_t period = systick_dispatch_period(slot);
+            if (period != 0) {
+                ms = MIN(ms, ((slot - next) & (period - 1)) + 1);
+            }
+        }
+    }
+    uint32_t per_ms = SysTick->LOAD + 1;
+    ms = MIN(ms, (SysTick_LOAD_RELOAD_Msk + 1) / per_ms);
+    if (ms < 2) {
+        __WFI();
+        return;
+    }
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        // a tick is due now, so let it be handled normally
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        return;
+    }
+
+    // finish the current ms, which has val counts left, then ms - 1 more
+    uint32_t val = SysTick->VAL;
+    uint32_t reload = val + (ms - 1) * per_ms;
+    SysTick->LOAD = reload;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    __DSB();
+    __WFI();
+    __ISB();
+
+    uint32_t ctrl = SysTick->CTRL; // clears COUNTFLAG
+    SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+    uint32_t elapsed = reload - SysTick->VAL;
+    uint32_t done, left;
+    if (ctrl & SysTick_CTRL_COUNTFLAG_Msk) {
+        // slept the whole time; the pending SysTick IRQ counts the last tick
+        done = ms - 1;
+        left = elapsed < per_ms ? per_ms - elapsed : 1;
+    } else if (elapsed < val) {
+        // woken by another interrupt within the current ms
+        done = 0;
+        left = val - elapsed;
+    } else {
+        // woken by another interrupt after some whole ms
+        elapsed -= val;
+        done = 1 + elapsed / per_ms;
+        left = per_ms - elapsed % per_ms;
+    }
+    uwTick += done;
+
+    // go back to a tick every ms, the first one after what is left of this
+    // ms; LOAD is reloaded from at the first count so it can be reset at once
+    SysTick->LOAD = MAX(left, 2) - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = per_ms - 1;
+}
+
+// The idle step of mp_hal_delay_ms when there are ms ticks left to wait.
+// Returns false if SysTick can't be stretched now, and the caller should
+// use MICROPY_EVENT_POLL_HOOK instead.
+STATIC bool systick_idle_tickless(uint32_t ms) {
+    #if MICROPY_PY_THREAD
+    if (pyb_thread_enabled) {
+        // other threads need their timeslices counted
+        return false;
+    }
+    #endif
+    if (ms < 2) {
+        return false;
+    }
+    mp_handle_pending();
+    uint32_t irq_state = disable_irq();
+    // an IRQ may have raised or scheduled something since
+    if (MP_STATE_VM(mp_pending_exception) == MP_OBJ_NULL
+        #if MICROPY_ENABLE_SCHEDULER
+        && MP_STATE_VM(sched_state) != MP_SCHED_PENDING
+        #endif
+        ) {
+        systick_sleep_stretched(ms);
+    }
+    enable_irq(irq_state);
+    return true;
+}
+
+#endif
+
 // Core delay function that does an efficient sleep and may switch thread context.
 // If IRQs are enabled then we must have the GIL.
 void mp_hal_delay_ms(mp_uint_t Delay) {
@@ -91,6 +219,11 @@ void mp_hal_delay_ms(mp_uint_t Delay) {
         uint32_t start = uwTick;
         // Wraparound of tick is taken care of by 2's complement arithmetic.
         while (uwTick - start < Delay) {
+            #if MICROPY_HW_ENABLE_TICKLESS_IDLE
+            if (systick_idle_tickless(Delay - (uwTick - start))) {
+                continue;
+            }
+            #endif
             // This macro will execute the necessary idle behaviour.  It may
             // raise an exception, switch threads or enter sleep mode (waiting for
             // (at least) the SysTick interrupt).
@@ -37,6 +37,12 @@ enum {
     #if MICROPY_PY_NETWORK && MICROPY_PY_LWIP
     SYSTICK_DISPATCH_LWIP,
     #endif
+    #if MICROPY_HW_ENABLE_JACDAC
+    SYSTICK_DISPATCH_JACDAC,
+    #endif
+    #if MICROPY_HW_ENABLE_KEYS
+    SYSTICK_DISPATCH_KEYS,
+    #endif
     SYSTICK_DISPATCH_MAX
 };
 
@@ -34,6 +34,8 @@
 #include "servo.h"
 #include "pin.h"
 #include "irq.h"
+#include "powerctrl.h"
+#include "irq_latency.h"
 
 /// \moduleref pyb
 /// \class Timer - periodically call a function
@@ -135,6 +137,9 @@ typedef struct _pyb_timer_obj_t {
     TIM_HandleTypeDef tim;
     IRQn_Type irqn;
     pyb_timer_channel_obj_t *channel;
+    #if MICROPY_HW_IRQ_LATENCY
+    bool latency;
+    #endif
 } pyb_timer_obj_t;
 
 // The following yields TIM_IT_UPDATE when channel is zero and
@@ -152,10 +157,13 @@ STATIC mp_obj_t pyb_timer_deinit(mp_obj_t self_in);
 STATIC mp_obj_t pyb_timer_callback(mp_obj_t self_in, mp_obj_t callback);
 STATIC mp_obj_t pyb_timer_channel_callback(mp_obj_t self_in, mp_obj_t callback);
 
+STATIC void timer_clock_notify(int event);
+
 void timer_init0(void) {
     for (uint i = 0; i < PYB_TIMER_OBJ_ALL_NUM; i++) {
         MP_STATE_PORT(pyb_timer_obj_all)[i] = NULL;
     }
+    powerctrl_clock_notify_table[POWERCTRL_CLOCK_NOTIFY_TIMER] = timer_clock_notify;
 }
 
 // unregister all interrupt sources
@@ -281,7 +289,7 @@ STATIC uint32_t compute_prescaler_period_from_freq(pyb_timer_obj_t *self, mp_obj
     uint32_t period;
     if (0) {
     #if MICROPY_PY_BUILTINS_FLOAT
-    } else if (mp_obj_is_type(freq_in, &mp_type_float)) {
+    } else if (mp_obj_is_float(freq_in)) {
         float freq = mp_obj_get_float(freq_in);
         if (freq <= 0) {
             goto bad_freq;
@@ -376,7 +384,7 @@ STATIC uint32_t compute_pwm_value_from_percent(uint32_t period, mp_obj_t percent
     uint32_t cmp;
     if (0) {
     #if MICROPY_PY_BUILTINS_FLOAT
-    } else if (mp_obj_is_type(percent_in, &mp_type_float)) {
+    } else if (mp_obj_is_float(percent_in)) {
         mp_float_t percent = mp_obj_get_float(percent_in);
         if (percent <= 0.0) {
             cmp = 0;
@@ -829,6 +837,40 @@ STATIC const uint32_t tim_instance_table[MICROPY_HW_MAX_TIMER] = {
     #endif
     #endif
 };
+// Keep the rate of a running timer across a change of its source clock,
+// preferably by changing only the prescaler so that the period and the duty
+// cycles stay exact.  The new values take effect at the next update event.
+STATIC void timer_rescale(TIM_TypeDef *tim, uint32_t max_period, uint32_t old_freq, uint32_t new_freq) {
+    uint64_t prescaler = (uint64_t)(tim->PSC + 1) * new_freq;
+    if (prescaler % old_freq == 0 && prescaler / old_freq <= 0x10000) {
+        tim->PSC = prescaler / old_freq - 1;
+        return;
+    }
+    // otherwise scale the period and compare values, with the same prescaler
+    uint64_t old_period = (uint64_t)tim->ARR + 1;
+    uint64_t period = MAX(2, MIN(old_period * new_freq / old_freq, (uint64_t)max_period + 1));
+    tim->CCR1 = tim->CCR1 * period / old_period;
+    tim->CCR2 = tim->CCR2 * period / old_period;
+    tim->CCR3 = tim->CCR3 * period / old_period;
+    tim->CCR4 = tim->CCR4 * period / old_period;
+    tim->ARR = period - 1;
+}
+
+STATIC void timer_clock_notify(int event) {
+    static uint32_t source_freq[MICROPY_HW_MAX_TIMER];
+    for (uint32_t tim_id = 1; tim_id <= MICROPY_HW_MAX_TIMER; ++tim_id) {
+        TIM_TypeDef *tim = (TIM_TypeDef*)(tim_instance_table[tim_id - 1] & 0xffffff00);
+        if (tim == NULL) {
+            continue;
+        }
+        if (event == POWERCTRL_CLOCKS_CHANGING) {
+            source_freq[tim_id - 1] = timer_get_source_freq(tim_id);
+        } else if (tim->CR1 & TIM_CR1_CEN) {
+            uint32_t max_period = tim_id == 2 || tim_id == 5 ? 0xffffffff : 0xffff;
+            timer_rescale(tim, max_period, source_freq[tim_id - 1], timer_get_source_freq(tim_id));
+        }
+    }
+}
 #undef TIM_ENTRY
 
 /// \classmethod \constructor(id, ...)
@@ -885,6 +927,12 @@ STATIC mp_obj_t pyb_timer_deinit(mp_obj_t self_in) {
     pyb_timer_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
     // Disable the base interrupt
+    #if MICROPY_HW_IRQ_LATENCY
+    if (self->latency) {
+        irq_latency_stop();
+        self->latency = false;
+    }
+    #endif
     pyb_timer_callback(self_in, mp_const_none);
 
     pyb_timer_channel_obj_t *chan = self->channel;
@@ -1327,8 +1375,13 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_timer_period_obj, 1, 2, pyb_timer
 STATIC mp_obj_t pyb_timer_callback(mp_obj_t self_in, mp_obj_t callback) {
     pyb_timer_obj_t *self = MP_OBJ_TO_PTR(self_in);
     if (callback == mp_const_none) {
-        // stop interrupt (but not timer)
-        __HAL_TIM_DISABLE_IT(&self->tim, TIM_IT_UPDATE);
+        // stop interrupt (but not timer), unless measuring latency
+        #if MICROPY_HW_IRQ_LATENCY
+        if (!self->latency)
+        #endif
+        {
+            __HAL_TIM_DISABLE_IT(&self->tim, TIM_IT_UPDATE);
+        }
         self->callback = mp_const_none;
     } else if (mp_obj_is_callable(callback)) {
         __HAL_TIM_DISABLE_IT(&self->tim, TIM_IT_UPDATE);
@@ -1345,6 +1398,46 @@ STATIC mp_obj_t pyb_timer_callback(mp_obj_t self_in, mp_obj_t callback) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_timer_callback_obj, pyb_timer_callback);
 
+#if MICROPY_HW_IRQ_LATENCY
+/// \method latency([enable])
+/// With enable True, start measuring the latency of the timer's update IRQ,
+/// of a PendSV dispatch and of a scheduled callback; with False, stop.
+/// Without an argument, return the histograms measured so far.
+STATIC mp_obj_t pyb_timer_latency(size_t n_args, const mp_obj_t *args) {
+    pyb_timer_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 1) {
+        return irq_latency_results();
+    }
+    if (mp_obj_is_true(args[1])) {
+        // only one timer can be measured at a time
+        for (size_t i = 0; i < PYB_TIMER_OBJ_ALL_NUM; i++) {
+            pyb_timer_obj_t *tim = MP_STATE_PORT(pyb_timer_obj_all)[i];
+            if (tim != NULL) {
+                tim->latency = false;
+            }
+        }
+        if (self->tim.Init.CounterMode != TIM_COUNTERMODE_UP) {
+            mp_raise_ValueError("timer must count up");
+        }
+        uint64_t cycles_per_tick_q8 = ((uint64_t)SystemCoreClock << 8)
+            * (self->tim.Instance->PSC + 1) / timer_get_source_freq(self->tim_id);
+        irq_latency_start(cycles_per_tick_q8);
+        self->latency = true;
+        __HAL_TIM_CLEAR_FLAG(&self->tim, TIM_IT_UPDATE);
+        HAL_TIM_Base_Start_IT(&self->tim);
+        HAL_NVIC_EnableIRQ(self->irqn);
+    } else if (self->latency) {
+        irq_latency_stop();
+        self->latency = false;
+        if (self->callback == mp_const_none) {
+            __HAL_TIM_DISABLE_IT(&self->tim, TIM_IT_UPDATE);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_timer_latency_obj, 1, 2, pyb_timer_latency);
+#endif
+
 STATIC const mp_rom_map_elem_t pyb_timer_locals_dict_table[] = {
     // instance methods
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&pyb_timer_init_obj) },
@@ -1356,6 +1449,9 @@ STATIC const mp_rom_map_elem_t pyb_timer_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_prescaler), MP_ROM_PTR(&pyb_timer_prescaler_obj) },
     { MP_ROM_QSTR(MP_QSTR_period), MP_ROM_PTR(&pyb_timer_period_obj) },
     { MP_ROM_QSTR(MP_QSTR_callback), MP_ROM_PTR(&pyb_timer_callback_obj) },
+    #if MICROPY_HW_IRQ_LATENCY
+    { MP_ROM_QSTR(MP_QSTR_latency), MP_ROM_PTR(&pyb_timer_latency_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_UP), MP_ROM_INT(TIM_COUNTERMODE_UP) },
     { MP_ROM_QSTR(MP_QSTR_DOWN), MP_ROM_INT(TIM_COUNTERMODE_DOWN) },
     { MP_ROM_QSTR(MP_QSTR_CENTER), MP_ROM_INT(TIM_COUNTERMODE_CENTERALIGNED1) },
@@ -1573,6 +1669,13 @@ void timer_irq_handler(uint tim_id) {
             return;
         }
 
+        #if MICROPY_HW_IRQ_LATENCY
+        // read the counter first, to time how long the IRQ took to get here
+        if (tim->latency && __HAL_TIM_GET_FLAG(&tim->tim, TIM_IT_UPDATE) != RESET) {
+            irq_latency_timer_irq(tim->tim.Instance->CNT);
+        }
+        #endif
+
         // Check for timer (versus timer channel) interrupt.
         timer_handle_irq_channel(tim, 0, tim->callback);
         uint32_t handled = TIMER_IRQ_MASK(0);
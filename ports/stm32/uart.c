@@ -37,6 +37,9 @@
 #include "uart.h"
 #include "irq.h"
 #include "pendsv.h"
+#include "dma.h"
+#include "jacdac.h"
+#include "powerctrl.h"
 
 #if defined(STM32F4)
 #define UART_RXNE_IS_SET(uart) ((uart)->SR & USART_SR_RXNE)
@@ -91,8 +94,91 @@
 #endif
 #endif
 
+#if MICROPY_HW_UART_DMA
+#define UART_RX_DMA(self) ((self)->rx_dma)
+#else
+#define UART_RX_DMA(self) (false)
+#endif
+
+// Writes shorter than this are quicker to send by polling than to set up DMA for
+#define UART_DMA_TX_MIN (16)
+
 extern void NORETURN __fatal_error(const char *msg);
 
+#if MICROPY_HW_UART_DMA
+
+// DMA state of a UART set up by uart_set_dma.  Receive runs continuously in
+// circular mode round read_buf, and read_buf_head is brought up to date with
+// the DMA's position on each half/full transfer and idle line IRQ, and
+// whenever it's about to be looked at.  Transmit uses its stream only for
+// the length of a write.
+typedef struct _uart_dma_t {
+    const dma_descr_t *rx_descr;
+    const dma_descr_t *tx_descr;
+    DMA_HandleTypeDef rx;
+    DMA_HandleTypeDef tx;
+} uart_dma_t;
+
+// must be called with IRQs disabled, or from an IRQ of at least UART priority
+STATIC void uart_dma_rx_update(pyb_uart_obj_t *self) {
+    uint32_t pos = self->read_buf_len - __HAL_DMA_GET_COUNTER(&self->dma->rx);
+    if (pos == self->read_buf_len) {
+        pos = 0;
+    }
+    self->read_buf_head = pos;
+}
+
+STATIC void uart_dma_rx_sync(pyb_uart_obj_t *self) {
+    if (self->rx_dma) {
+        uint32_t irq_state = disable_irq();
+        uart_dma_rx_update(self);
+        enable_irq(irq_state);
+    }
+}
+
+STATIC void uart_dma_rx_irq(pyb_uart_obj_t *self) {
+    uint16_t old_head = self->read_buf_head;
+    uart_dma_rx_update(self);
+    #if MICROPY_PY_USELECT_NOTIFY
+    if (self->read_buf_head != old_head && self->poll_notify != NULL) {
+        mp_poll_notify(self->poll_notify, MP_STREAM_POLL_RD);
+    }
+    #else
+    (void)old_head;
+    #endif
+}
+
+STATIC void uart_dma_rx_callback(DMA_HandleTypeDef *hdma) {
+    uart_dma_rx_irq(hdma->Parent);
+}
+
+STATIC void uart_dma_rx_start(pyb_uart_obj_t *self) {
+    uart_dma_t *dma = self->dma;
+    dma_init(&dma->rx, dma->rx_descr, DMA_PERIPH_TO_MEMORY, self);
+    // dma_init clears the handle, so the callbacks are set after it
+    dma->rx.XferHalfCpltCallback = uart_dma_rx_callback;
+    dma->rx.XferCpltCallback = uart_dma_rx_callback;
+    HAL_DMA_Start_IT(&dma->rx, (uint32_t)&self->uartx->DR, (uint32_t)self->read_buf, self->read_buf_len);
+    self->rx_dma = true;
+    self->uartx->CR3 |= USART_CR3_DMAR;
+    self->uartx->CR1 |= USART_CR1_IDLEIE;
+}
+
+STATIC void uart_dma_rx_stop(pyb_uart_obj_t *self) {
+    if (!self->rx_dma) {
+        return;
+    }
+    self->uartx->CR1 &= ~USART_CR1_IDLEIE;
+    self->uartx->CR3 &= ~USART_CR3_DMAR;
+    HAL_DMA_Abort(&self->dma->rx);
+    dma_deinit(self->dma->rx_descr);
+    self->rx_dma = false;
+}
+
+#endif
+
+STATIC void uart_clock_notify(int event);
+
 void uart_init0(void) {
     #if defined(STM32H7)
     RCC_PeriphCLKInitTypeDef RCC_PeriphClkInit = {0};
@@ -110,6 +196,8 @@ void uart_init0(void) {
         __fatal_error("HAL_RCCEx_PeriphCLKConfig");
     }
     #endif
+
+    powerctrl_clock_notify_table[POWERCTRL_CLOCK_NOTIFY_UART] = uart_clock_notify;
 }
 
 // unregister all interrupt sources
@@ -182,6 +270,11 @@ bool uart_init(pyb_uart_obj_t *uart_obj,
 
     const pin_obj_t *pins[4] = {0};
 
+    #if MICROPY_HW_UART_DMA
+    // the DMA mustn't keep writing into a read buffer that's about to be replaced
+    uart_dma_rx_stop(uart_obj);
+    #endif
+
     switch (uart_obj->uart_id) {
         #if defined(MICROPY_HW_UART1_TX) && defined(MICROPY_HW_UART1_RX)
         case PYB_UART_1:
@@ -416,20 +509,68 @@ bool uart_init(pyb_uart_obj_t *uart_obj,
 }
 
 void uart_set_rxbuf(pyb_uart_obj_t *self, size_t len, void *buf) {
+    #if MICROPY_HW_UART_DMA
+    uart_dma_rx_stop(self);
+    #endif
     self->read_buf_head = 0;
     self->read_buf_tail = 0;
     self->read_buf_len = len;
     self->read_buf = buf;
     if (len == 0) {
         UART_RXNE_IT_DIS(self->uartx);
+    #if MICROPY_HW_UART_DMA
+    } else if (self->dma != NULL && self->dma->rx_descr != NULL) {
+        UART_RXNE_IT_DIS(self->uartx);
+        uart_dma_rx_start(self);
+    #endif
     } else {
         UART_RXNE_IT_EN(self->uartx);
     }
 }
 
+// Use DMA for this UART's receive and transmit, where it has the DMA streams
+// for them, or stop using it.  Must be called after uart_init and before
+// uart_set_rxbuf.  Returns false if DMA can't be used.
+bool uart_set_dma(pyb_uart_obj_t *self, bool enable) {
+    #if MICROPY_HW_UART_DMA
+    if (!enable) {
+        self->dma = NULL;
+        return true;
+    }
+    const dma_descr_t *rx_descr = NULL;
+    const dma_descr_t *tx_descr = NULL;
+    switch (self->uart_id) {
+        #if defined(STM32F4)
+        case PYB_UART_1: rx_descr = &dma_USART_1_RX; tx_descr = &dma_USART_1_TX; break;
+        case PYB_UART_2: rx_descr = &dma_USART_2_RX; tx_descr = &dma_USART_2_TX; break;
+        #if defined(USART6)
+        case PYB_UART_6: rx_descr = &dma_USART_6_RX; tx_descr = &dma_USART_6_TX; break;
+        #endif
+        #endif
+        default: return false;
+    }
+    if (self->char_width != CHAR_WIDTH_8BIT) {
+        // the streams are set up for byte transfers
+        return false;
+    }
+    if (self->dma == NULL) {
+        self->dma = m_new0(uart_dma_t, 1);
+    }
+    self->dma->rx_descr = rx_descr;
+    self->dma->tx_descr = tx_descr;
+    return true;
+    #else
+    return !enable;
+    #endif
+}
+
 void uart_deinit(pyb_uart_obj_t *self) {
     self->is_enabled = false;
 
+    #if MICROPY_HW_UART_DMA
+    uart_dma_rx_stop(self);
+    #endif
+
     // Disable UART
     self->uartx->CR1 &= ~USART_CR1_UE;
 
@@ -535,7 +676,7 @@ void uart_attach_to_repl(pyb_uart_obj_t *self, bool attached) {
     self->attached_to_repl = attached;
 }
 
-uint32_t uart_get_baudrate(pyb_uart_obj_t *self) {
+STATIC uint32_t uart_get_source_freq(pyb_uart_obj_t *self) {
     uint32_t uart_clk = 0;
 
     #if defined(STM32F0)
@@ -604,20 +745,51 @@ uint32_t uart_get_baudrate(pyb_uart_obj_t *self) {
     }
     #endif
 
+    return uart_clk;
+}
+
+uint32_t uart_get_baudrate(pyb_uart_obj_t *self) {
     // This formula assumes UART_OVERSAMPLING_16
-    uint32_t baudrate = uart_clk / self->uartx->BRR;
+    uint32_t baudrate = uart_get_source_freq(self) / self->uartx->BRR;
 
     return baudrate;
 }
 
+STATIC bool uart_wait_flag_set(pyb_uart_obj_t *self, uint32_t flag, uint32_t timeout);
+
+// Keep the baudrates of enabled UARTs across a change of the bus clocks
+STATIC void uart_clock_notify(int event) {
+    static uint32_t baudrate[MP_ARRAY_SIZE(MP_STATE_PORT(pyb_uart_obj_all))];
+    for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_PORT(pyb_uart_obj_all)); ++i) {
+        pyb_uart_obj_t *self = MP_STATE_PORT(pyb_uart_obj_all)[i];
+        if (self == NULL || !self->is_enabled) {
+            continue;
+        }
+        if (event == POWERCTRL_CLOCKS_CHANGING) {
+            // let the last char go out at the old rate
+            uart_wait_flag_set(self, UART_FLAG_TC, 10);
+            baudrate[i] = uart_get_baudrate(self);
+        } else if (baudrate[i] != 0) {
+            // some families only accept a new BRR while the UART is disabled
+            self->uartx->CR1 &= ~USART_CR1_UE;
+            self->uartx->BRR = (uart_get_source_freq(self) + baudrate[i] / 2) / baudrate[i];
+            self->uartx->CR1 |= USART_CR1_UE;
+        }
+    }
+}
+
 mp_uint_t uart_rx_any(pyb_uart_obj_t *self) {
+    #if MICROPY_HW_UART_DMA
+    uart_dma_rx_sync(self);
+    #endif
     int buffer_bytes = self->read_buf_head - self->read_buf_tail;
     if (buffer_bytes < 0) {
         return buffer_bytes + self->read_buf_len;
     } else if (buffer_bytes > 0) {
         return buffer_bytes;
     } else {
-        return UART_RXNE_IS_SET(self->uartx) != 0;
+        // with DMA, RXNE only means a char the DMA is about to take
+        return !UART_RX_DMA(self) && UART_RXNE_IS_SET(self->uartx) != 0;
     }
 }
 
@@ -627,7 +799,11 @@ mp_uint_t uart_rx_any(pyb_uart_obj_t *self) {
 bool uart_rx_wait(pyb_uart_obj_t *self, uint32_t timeout) {
     uint32_t start = HAL_GetTick();
     for (;;) {
-        if (self->read_buf_tail != self->read_buf_head || UART_RXNE_IS_SET(self->uartx)) {
+        #if MICROPY_HW_UART_DMA
+        uart_dma_rx_sync(self);
+        #endif
+        if (self->read_buf_tail != self->read_buf_head
+            || (!UART_RX_DMA(self) && UART_RXNE_IS_SET(self->uartx))) {
             return true; // have at least 1 char ready for reading
         }
         if (HAL_GetTick() - start >= timeout) {
@@ -648,7 +824,7 @@ int uart_rx_char(pyb_uart_obj_t *self) {
             data = self->read_buf[self->read_buf_tail];
         }
         self->read_buf_tail = (self->read_buf_tail + 1) % self->read_buf_len;
-        if (UART_RXNE_IS_SET(self->uartx)) {
+        if (!UART_RX_DMA(self) && UART_RXNE_IS_SET(self->uartx)) {
             // UART was stalled by flow ctrl: re-enable IRQ now we have room in buffer
             UART_RXNE_IT_EN(self->uartx);
         }
@@ -665,6 +841,34 @@ int uart_rx_char(pyb_uart_obj_t *self) {
     }
 }
 
+// Take up to len 8-bit chars that are waiting in the read buffer, copying them
+// straight into dest a contiguous run at a time.  Returns the number taken.
+size_t uart_rx_data(pyb_uart_obj_t *self, void *dest, size_t len) {
+    #if MICROPY_HW_UART_DMA
+    uart_dma_rx_sync(self);
+    #endif
+    uint8_t *buf = dest;
+    size_t n = 0;
+    uint16_t head = self->read_buf_head;
+    uint16_t tail = self->read_buf_tail;
+    while (n < len && tail != head) {
+        size_t run = (head > tail ? head : self->read_buf_len) - tail;
+        run = MIN(run, len - n);
+        memcpy(buf + n, self->read_buf + tail, run);
+        n += run;
+        tail += run;
+        if (tail == self->read_buf_len) {
+            tail = 0;
+        }
+    }
+    self->read_buf_tail = tail;
+    if (n != 0 && !UART_RX_DMA(self) && UART_RXNE_IS_SET(self->uartx)) {
+        // UART was stalled by flow ctrl: re-enable IRQ now we have room in buffer
+        UART_RXNE_IT_EN(self->uartx);
+    }
+    return n;
+}
+
 // Waits at most timeout milliseconds for TX register to become empty.
 // Returns true if can write, false if can't.
 bool uart_tx_wait(pyb_uart_obj_t *self, uint32_t timeout) {
@@ -706,26 +910,29 @@ STATIC bool uart_wait_flag_set(pyb_uart_obj_t *self, uint32_t flag, uint32_t tim
 // num_chars - number of characters to send (9-bit chars count for 2 bytes from src)
 // *errcode - returns 0 for success, MP_Exxx on error
 // returns the number of characters sent (valid even if there was an error)
-size_t uart_tx_data(pyb_uart_obj_t *self, const void *src_in, size_t num_chars, int *errcode) {
-    if (num_chars == 0) {
-        *errcode = 0;
-        return 0;
-    }
-
-    uint32_t timeout;
+STATIC uint32_t uart_tx_timeout(pyb_uart_obj_t *self) {
     if (self->uartx->CR3 & USART_CR3_CTSE) {
         // CTS can hold off transmission for an arbitrarily long time. Apply
         // the overall timeout rather than the character timeout.
-        timeout = self->timeout;
+        return self->timeout;
     } else {
         // The timeout specified here is for waiting for the TX data register to
         // become empty (ie between chars), as well as for the final char to be
         // completely transferred.  The default value for timeout_char is long
         // enough for 1 char, but we need to double it to wait for the last char
         // to be transferred to the data register, and then to be transmitted.
-        timeout = 2 * self->timeout_char;
+        return 2 * self->timeout_char;
+    }
+}
+
+size_t uart_tx_data(pyb_uart_obj_t *self, const void *src_in, size_t num_chars, int *errcode) {
+    if (num_chars == 0) {
+        *errcode = 0;
+        return 0;
     }
 
+    uint32_t timeout = uart_tx_timeout(self);
+
     const uint8_t *src = (const uint8_t*)src_in;
     size_t num_tx = 0;
     USART_TypeDef *uart = self->uartx;
@@ -760,12 +967,68 @@ size_t uart_tx_data(pyb_uart_obj_t *self, const void *src_in, size_t num_chars,
     return num_tx;
 }
 
+// As uart_tx_data, but hands the chars to the UART by DMA where it can, and
+// runs MICROPY_EVENT_POLL_HOOK while they go; so only call it from Python.
+size_t uart_tx_data_dma(pyb_uart_obj_t *self, const void *src_in, size_t num_chars, int *errcode) {
+    #if MICROPY_HW_UART_DMA
+    uart_dma_t *dma = self->dma;
+    if (dma == NULL || dma->tx_descr == NULL || num_chars < UART_DMA_TX_MIN) {
+        return uart_tx_data(self, src_in, num_chars, errcode);
+    }
+
+    uint32_t timeout = uart_tx_timeout(self);
+    USART_TypeDef *uart = self->uartx;
+
+    dma_init(&dma->tx, dma->tx_descr, DMA_MEMORY_TO_PERIPH, self);
+    // clear TC so the wait at the end is for the last char of this write
+    uart->SR = ~USART_SR_TC;
+    HAL_DMA_Start_IT(&dma->tx, (uint32_t)src_in, (uint32_t)&uart->DR, num_chars);
+    uart->CR3 |= USART_CR3_DMAT;
+
+    // wait for the DMA to hand over the last char, giving up if it makes no
+    // progress for a whole timeout; the transfer-complete IRQ ends the wait
+    *errcode = 0;
+    uint32_t remaining = num_chars;
+    uint32_t start = HAL_GetTick();
+    for (;;) {
+        uint32_t ndtr = __HAL_DMA_GET_COUNTER(&dma->tx);
+        if (ndtr == 0) {
+            break;
+        }
+        if (ndtr != remaining) {
+            remaining = ndtr;
+            start = HAL_GetTick();
+        } else if (HAL_GetTick() - start >= timeout) {
+            *errcode = MP_ETIMEDOUT;
+            break;
+        }
+        MICROPY_EVENT_POLL_HOOK
+    }
+
+    uart->CR3 &= ~USART_CR3_DMAT;
+    if (*errcode != 0) {
+        HAL_DMA_Abort(&dma->tx);
+    }
+    size_t num_tx = num_chars - __HAL_DMA_GET_COUNTER(&dma->tx);
+    dma_deinit(dma->tx_descr);
+
+    // wait for the UART frame to complete
+    if (*errcode == 0 && !uart_wait_flag_set(self, UART_FLAG_TC, timeout)) {
+        *errcode = MP_ETIMEDOUT;
+    }
+    return num_tx;
+    #else
+    return uart_tx_data(self, src_in, num_chars, errcode);
+    #endif
+}
+
 void uart_tx_strn(pyb_uart_obj_t *uart_obj, const char *str, uint len) {
     int errcode;
     uart_tx_data(uart_obj, str, len, &errcode);
 }
 
-// this IRQ handler is set up to handle RXNE interrupts only
+// this IRQ handler is set up to handle RXNE interrupts only, or IDLE ones
+// when receiving by DMA
 void uart_irq_handler(mp_uint_t uart_id) {
     // get the uart object
     pyb_uart_obj_t *self = MP_STATE_PORT(pyb_uart_obj_all)[uart_id - 1];
@@ -776,6 +1039,19 @@ void uart_irq_handler(mp_uint_t uart_id) {
         return;
     }
 
+    #if MICROPY_HW_ENABLE_JACDAC
+    if (jacdac_uart_irq(self)) {
+        return;
+    }
+    #endif
+
+    #if MICROPY_HW_UART_DMA
+    if (self->rx_dma) {
+        // the DMA takes each char, and this IRQ is for the line going idle
+        // after a burst, to make what it has received visible to readers
+        uart_dma_rx_irq(self);
+    } else
+    #endif
     if (UART_RXNE_IS_SET(self->uartx)) {
         if (self->read_buf_len != 0) {
             uint16_t next_head = (self->read_buf_head + 1) % self->read_buf_len;
@@ -798,6 +1074,11 @@ void uart_irq_handler(mp_uint_t uart_id) {
                         self->read_buf[self->read_buf_head] = data;
                     }
                     self->read_buf_head = next_head;
+                    #if MICROPY_PY_USELECT_NOTIFY
+                    if (self->poll_notify != NULL) {
+                        mp_poll_notify(self->poll_notify, MP_STREAM_POLL_RD);
+                    }
+                    #endif
                 }
             } else { // No room: leave char in buf, disable interrupt
                 UART_RXNE_IT_DIS(self->uartx);
@@ -27,6 +27,7 @@
 #define MICROPY_INCLUDED_STM32_UART_H
 
 struct _mp_irq_obj_t;
+struct _uart_dma_t;
 
 typedef enum {
     PYB_UART_NONE = 0,
@@ -51,6 +52,9 @@ typedef struct _pyb_uart_obj_t {
     pyb_uart_t uart_id : 8;
     bool is_static : 1;
     bool is_enabled : 1;
+    #if MICROPY_HW_UART_DMA
+    bool rx_dma : 1;                    // whether read_buf is filled by DMA
+    #endif
     bool attached_to_repl;              // whether the UART is attached to REPL
     byte char_width;                    // 0 for 7,8 bit chars, 1 for 9 bit chars
     uint16_t char_mask;                 // 0x7f for 7 bit, 0xff for 8 bit, 0x1ff for 9 bit
@@ -63,6 +67,12 @@ typedef struct _pyb_uart_obj_t {
     uint16_t mp_irq_trigger;            // user IRQ trigger mask
     uint16_t mp_irq_flags;              // user IRQ active IRQ flags
     struct _mp_irq_obj_t *mp_irq_obj;   // user IRQ object
+    #if MICROPY_PY_USELECT_NOTIFY
+    struct _poll_obj_t *poll_notify;    // poll entry told of incoming data
+    #endif
+    #if MICROPY_HW_UART_DMA
+    struct _uart_dma_t *dma;            // DMA state, if enabled by uart_set_dma
+    #endif
 } pyb_uart_obj_t;
 
 extern const mp_obj_type_t pyb_uart_type;
@@ -73,6 +83,7 @@ bool uart_exists(int uart_id);
 bool uart_init(pyb_uart_obj_t *uart_obj,
     uint32_t baudrate, uint32_t bits, uint32_t parity, uint32_t stop, uint32_t flow);
 void uart_set_rxbuf(pyb_uart_obj_t *self, size_t len, void *buf);
+bool uart_set_dma(pyb_uart_obj_t *self, bool enable);
 void uart_deinit(pyb_uart_obj_t *uart_obj);
 void uart_irq_handler(mp_uint_t uart_id);
 
@@ -81,8 +92,10 @@ uint32_t uart_get_baudrate(pyb_uart_obj_t *self);
 mp_uint_t uart_rx_any(pyb_uart_obj_t *uart_obj);
 bool uart_rx_wait(pyb_uart_obj_t *self, uint32_t timeout);
 int uart_rx_char(pyb_uart_obj_t *uart_obj);
+size_t uart_rx_data(pyb_uart_obj_t *self, void *dest, size_t len);
 bool uart_tx_wait(pyb_uart_obj_t *self, uint32_t timeout);
 size_t uart_tx_data(pyb_uart_obj_t *self, const void *src_in, size_t num_chars, int *errcode);
+size_t uart_tx_data_dma(pyb_uart_obj_t *self, const void *src_in, size_t num_chars, int *errcode);
 void uart_tx_strn(pyb_uart_obj_t *uart_obj, const char *str, uint len);
 
 static inline bool uart_tx_avail(pyb_uart_obj_t *self) {
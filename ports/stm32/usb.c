@@ -42,6 +42,7 @@
 #include "bufhelper.h"
 #include "storage.h"
 #include "sdcard.h"
+#include "asset.h"
 #include "usb.h"
 
 #if MICROPY_HW_ENABLE_USB
@@ -113,6 +114,27 @@ const mp_rom_obj_tuple_t pyb_usb_hid_keyboard_obj = {
         MP_ROM_PTR(&pyb_usb_hid_keyboard_desc_obj),
     },
 };
+
+#if MICROPY_HW_USB_HID_GAMEPAD
+// predefined hid gamepad data, for reports sent by USB_HID.gamepad()
+STATIC const mp_obj_str_t pyb_usb_hid_gamepad_desc_obj = {
+    {&mp_type_bytes},
+    0, // hash not valid
+    USBD_HID_GAMEPAD_REPORT_DESC_SIZE,
+    USBD_HID_GAMEPAD_ReportDesc,
+};
+const mp_rom_obj_tuple_t pyb_usb_hid_gamepad_obj = {
+    {&mp_type_tuple},
+    5,
+    {
+        MP_ROM_INT(0), // subclass: none
+        MP_ROM_INT(0), // protocol: none
+        MP_ROM_INT(USBD_HID_GAMEPAD_MAX_PACKET),
+        MP_ROM_INT(1), // polling interval: 1ms
+        MP_ROM_PTR(&pyb_usb_hid_gamepad_desc_obj),
+    },
+};
+#endif
 #endif
 
 void pyb_usb_init0(void) {
@@ -120,6 +142,10 @@ void pyb_usb_init0(void) {
         usb_device.usbd_cdc_itf[i].attached_to_repl = false;
     }
     MP_STATE_PORT(pyb_hid_report_desc) = MP_OBJ_NULL;
+    #if MICROPY_HW_USB_HID_GAMEPAD
+    // the key scanner is stopped on soft reset
+    usb_device.usbd_hid_itf.gamepad = false;
+    #endif
 
     pyb_usb_vcp_init0();
 }
@@ -422,6 +448,11 @@ STATIC mp_obj_t pyb_usb_mode(size_t n_args, const mp_obj_t *pos_args, mp_map_t *
                 #endif
                 ) {
                 msc_unit[i] = type;
+            #if MICROPY_HW_ASSETS_UF2
+            } else if (items[i] == MP_OBJ_FROM_PTR(&pyb_asset_type)) {
+                // the class itself selects the UF2 drive for the asset partition
+                msc_unit[i] = &pyb_asset_type;
+            #endif
             } else {
                 mp_raise_ValueError("unsupported logical unit");
             }
@@ -831,6 +862,20 @@ STATIC mp_obj_t pyb_usb_hid_send(mp_obj_t self_in, mp_obj_t report_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_usb_hid_send_obj, pyb_usb_hid_send);
 
+#if MICROPY_HW_USB_HID_GAMEPAD
+/// \method gamepad(enable)
+///
+/// Send the buttons of pyb.Keys as gamepad reports at every poll of the
+/// host, without Python, for USB set up with `hid=pyb.hid_gamepad`.
+/// The key scanner is started if it is not already running.
+STATIC mp_obj_t pyb_usb_hid_gamepad(mp_obj_t self_in, mp_obj_t enable) {
+    pyb_usb_hid_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    usbd_hid_gamepad(&self->usb_dev->usbd_hid_itf, mp_obj_is_true(enable));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_usb_hid_gamepad_obj, pyb_usb_hid_gamepad);
+#endif
+
 // deprecated in favour of USB_HID.send
 STATIC mp_obj_t pyb_hid_send_report(mp_obj_t arg) {
     return pyb_usb_hid_send(MP_OBJ_FROM_PTR(&pyb_usb_hid_obj), arg);
@@ -840,6 +885,9 @@ MP_DEFINE_CONST_FUN_OBJ_1(pyb_hid_send_report_obj, pyb_hid_send_report);
 STATIC const mp_rom_map_elem_t pyb_usb_hid_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&pyb_usb_hid_send_obj) },
     { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&pyb_usb_hid_recv_obj) },
+    #if MICROPY_HW_USB_HID_GAMEPAD
+    { MP_ROM_QSTR(MP_QSTR_gamepad), MP_ROM_PTR(&pyb_usb_hid_gamepad_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(pyb_usb_hid_locals_dict, pyb_usb_hid_locals_dict_table);
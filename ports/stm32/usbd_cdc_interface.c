@@ -36,6 +36,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "usbd_cdc_msc_hid.h"
 #include "usbd_cdc_interface.h"
@@ -259,20 +260,39 @@ void usbd_cdc_rx_check_resume(usbd_cdc_itf_t *cdc) {
 int8_t usbd_cdc_receive(usbd_cdc_state_t *cdc_in, size_t len) {
     usbd_cdc_itf_t *cdc = (usbd_cdc_itf_t*)cdc_in;
 
-    // copy the incoming data into the circular buffer
-    for (const uint8_t *src = cdc->rx_packet_buf, *top = cdc->rx_packet_buf + len; src < top; ++src) {
-        if (cdc->attached_to_repl && mp_interrupt_char != -1 && *src == mp_interrupt_char) {
-            pendsv_kbd_intr();
-        } else {
-            uint16_t next_put = (cdc->rx_buf_put + 1) & (USBD_CDC_RX_DATA_SIZE - 1);
-            if (next_put == cdc->rx_buf_get) {
+    // copy the incoming data into the circular buffer, in runs up to the
+    // next interrupt char if there is one to look for
+    bool check_intr = cdc->attached_to_repl && mp_interrupt_char != -1;
+    const uint8_t *src = cdc->rx_packet_buf, *top = cdc->rx_packet_buf + len;
+    while (src < top) {
+        const uint8_t *end = top;
+        if (check_intr) {
+            const uint8_t *c = memchr(src, mp_interrupt_char, top - src);
+            if (c != NULL) {
+                end = c;
+            }
+        }
+        while (src < end) {
+            // free space from put to the end of the buffer, or to get (less
+            // one, so a full buffer can be told from an empty one)
+            uint16_t put = cdc->rx_buf_put, get = cdc->rx_buf_get;
+            uint32_t n = (get > put ? get - 1 : get == 0 ? USBD_CDC_RX_DATA_SIZE - 1 : USBD_CDC_RX_DATA_SIZE) - put;
+            if (n == 0) {
                 // overflow, we just discard the rest of the chars
-                break;
+                goto overflow;
             }
-            cdc->rx_user_buf[cdc->rx_buf_put] = *src;
-            cdc->rx_buf_put = next_put;
+            n = MIN(n, (uint32_t)(end - src));
+            memcpy(&cdc->rx_user_buf[put], src, n);
+            cdc->rx_buf_put = (put + n) & (USBD_CDC_RX_DATA_SIZE - 1);
+            src += n;
+        }
+        if (src < top) {
+            // src is at the interrupt char
+            pendsv_kbd_intr();
+            ++src;
         }
     }
+overflow:
 
     if ((cdc->flow & USBD_CDC_FLOWCONTROL_RTS) && (usbd_cdc_rx_buffer_full(cdc))) {
         cdc->rx_buf_full = true;
@@ -292,14 +312,31 @@ int usbd_cdc_tx_half_empty(usbd_cdc_itf_t *cdc) {
     return tx_waiting <= USBD_CDC_TX_DATA_SIZE / 2;
 }
 
+// Returns the number of bytes that can be added to the tx buffer.
+static uint32_t usbd_cdc_tx_buf_space(usbd_cdc_itf_t *cdc) {
+    return (cdc->tx_buf_ptr_out - cdc->tx_buf_ptr_in - 1) & (USBD_CDC_TX_DATA_SIZE - 1);
+}
+
+// Add len bytes to the tx buffer, whether or not there is space for them.
+static void usbd_cdc_tx_buf_write(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len) {
+    while (len > 0) {
+        uint32_t n = MIN(len, USBD_CDC_TX_DATA_SIZE - cdc->tx_buf_ptr_in);
+        memcpy(&cdc->tx_buf[cdc->tx_buf_ptr_in], buf, n);
+        cdc->tx_buf_ptr_in = (cdc->tx_buf_ptr_in + n) & (USBD_CDC_TX_DATA_SIZE - 1);
+        buf += n;
+        len -= n;
+    }
+}
+
 // timout in milliseconds.
 // Returns number of bytes written to the device.
 int usbd_cdc_tx(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len, uint32_t timeout) {
-    for (uint32_t i = 0; i < len; i++) {
+    for (uint32_t i = 0; i < len;) {
         // Wait until the device is connected and the buffer has space, with a given timeout
         uint32_t start = HAL_GetTick();
+        uint32_t space = 0;
         while (cdc->connect_state == USBD_CDC_CONNECT_STATE_DISCONNECTED
-            || ((cdc->tx_buf_ptr_in + 1) & (USBD_CDC_TX_DATA_SIZE - 1)) == cdc->tx_buf_ptr_out) {
+            || (space = usbd_cdc_tx_buf_space(cdc)) == 0) {
             usbd_cdc_try_tx(cdc);
             // Wraparound of tick is taken care of by 2's complement arithmetic.
             if (HAL_GetTick() - start >= timeout) {
@@ -313,13 +350,14 @@ int usbd_cdc_tx(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len, uint32_t
             __WFI(); // enter sleep mode, waiting for interrupt
         }
 
-        // Write data to device buffer
-        cdc->tx_buf[cdc->tx_buf_ptr_in] = buf[i];
-        cdc->tx_buf_ptr_in = (cdc->tx_buf_ptr_in + 1) & (USBD_CDC_TX_DATA_SIZE - 1);
+        // Write as much data as fits to device buffer, and start sending it
+        // so the USB transfer overlaps with copying the rest
+        uint32_t n = MIN(space, len - i);
+        usbd_cdc_tx_buf_write(cdc, buf + i, n);
+        i += n;
+        usbd_cdc_try_tx(cdc);
     }
 
-    usbd_cdc_try_tx(cdc);
-
     // Success, return number of bytes read
     return len;
 }
@@ -328,7 +366,8 @@ int usbd_cdc_tx(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len, uint32_t
 // device is not connected, or if the buffer is full.  Has a small timeout
 // to wait for the buffer to be drained, in the case the device is connected.
 void usbd_cdc_tx_always(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len) {
-    for (int i = 0; i < len; i++) {
+    while (len > 0) {
+        uint32_t n = len;
         // If the CDC device is not connected to the host then we don't have anyone to receive our data.
         // The device may become connected in the future, so we should at least try to fill the buffer
         // and hope that it doesn't overflow by the time the device connects.
@@ -338,7 +377,7 @@ void usbd_cdc_tx_always(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len) {
             // If the buffer is full, wait until it gets drained, with a timeout of 500ms
             // (wraparound of tick is taken care of by 2's complement arithmetic).
             uint32_t start = HAL_GetTick();
-            while (((cdc->tx_buf_ptr_in + 1) & (USBD_CDC_TX_DATA_SIZE - 1)) == cdc->tx_buf_ptr_out && HAL_GetTick() - start <= 500) {
+            while (usbd_cdc_tx_buf_space(cdc) == 0 && HAL_GetTick() - start <= 500) {
                 usbd_cdc_try_tx(cdc);
                 if (query_irq() == IRQ_STATE_DISABLED) {
                     // IRQs disabled so buffer will never be drained; exit loop
@@ -346,12 +385,15 @@ void usbd_cdc_tx_always(usbd_cdc_itf_t *cdc, const uint8_t *buf, uint32_t len) {
                 }
                 __WFI(); // enter sleep mode, waiting for interrupt
             }
+            // on a timeout the buffer overflows one char at a time
+            n = MAX(1, MIN(n, usbd_cdc_tx_buf_space(cdc)));
         }
 
-        cdc->tx_buf[cdc->tx_buf_ptr_in] = buf[i];
-        cdc->tx_buf_ptr_in = (cdc->tx_buf_ptr_in + 1) & (USBD_CDC_TX_DATA_SIZE - 1);
+        usbd_cdc_tx_buf_write(cdc, buf, n);
+        buf += n;
+        len -= n;
+        usbd_cdc_try_tx(cdc);
     }
-    usbd_cdc_try_tx(cdc);
 }
 
 // Returns number of bytes in the rx buffer.
@@ -368,7 +410,7 @@ int usbd_cdc_rx_num(usbd_cdc_itf_t *cdc) {
 // Returns number of bytes read from the device.
 int usbd_cdc_rx(usbd_cdc_itf_t *cdc, uint8_t *buf, uint32_t len, uint32_t timeout) {
     // loop to read bytes
-    for (uint32_t i = 0; i < len; i++) {
+    for (uint32_t i = 0; i < len;) {
         // Wait until we have at least 1 byte to read
         uint32_t start = HAL_GetTick();
         while (cdc->rx_buf_put == cdc->rx_buf_get) {
@@ -385,9 +427,13 @@ int usbd_cdc_rx(usbd_cdc_itf_t *cdc, uint8_t *buf, uint32_t len, uint32_t timeou
             __WFI(); // enter sleep mode, waiting for interrupt
         }
 
-        // Copy byte from device to user buffer
-        buf[i] = cdc->rx_user_buf[cdc->rx_buf_get];
-        cdc->rx_buf_get = (cdc->rx_buf_get + 1) & (USBD_CDC_RX_DATA_SIZE - 1);
+        // Copy what is there, up to the end of the device buffer, straight
+        // to the user buffer
+        uint16_t put = cdc->rx_buf_put, get = cdc->rx_buf_get;
+        uint32_t n = MIN((put > get ? put : USBD_CDC_RX_DATA_SIZE) - get, len - i);
+        memcpy(&buf[i], &cdc->rx_user_buf[get], n);
+        cdc->rx_buf_get = (get + n) & (USBD_CDC_RX_DATA_SIZE - 1);
+        i += n;
     }
     usbd_cdc_rx_check_resume(cdc);
 
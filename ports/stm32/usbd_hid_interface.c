@@ -29,6 +29,8 @@
 #include "py/mpstate.h"
 #include "py/mperrno.h"
 #include "py/mphal.h"
+#include "irq.h"
+#include "keys.h"
 #include "usb.h"
 
 #if MICROPY_HW_USB_HID
@@ -39,6 +41,20 @@ uint8_t *usbd_hid_init(usbd_hid_state_t *hid_in) {
     return &hid->report_in_buf[0]; // location to place first incoming report
 }
 
+void usbd_hid_tx_ready(usbd_hid_state_t *hid_in) {
+    #if MICROPY_HW_USB_HID_GAMEPAD
+    // The last report went out (or the device was just configured): queue the
+    // current state of the keys, for the host to take at its next poll
+    usbd_hid_itf_t *hid = (usbd_hid_itf_t*)hid_in;
+    if (hid->gamepad) {
+        keys_gamepad_report(hid->report_out_buf);
+        USBD_HID_SendReport(&hid->base, hid->report_out_buf, USBD_HID_GAMEPAD_MAX_PACKET);
+    }
+    #else
+    (void)hid_in;
+    #endif
+}
+
 int8_t usbd_hid_receive(usbd_hid_state_t *hid_in, size_t len) {
     // Incoming report: save the length but don't schedule next report until user reads this one
     usbd_hid_itf_t *hid = (usbd_hid_itf_t*)hid_in;
@@ -68,4 +84,19 @@ int usbd_hid_rx(usbd_hid_itf_t *hid, size_t len, uint8_t *buf, uint32_t timeout_
     return n;
 }
 
+#if MICROPY_HW_USB_HID_GAMEPAD
+void usbd_hid_gamepad(usbd_hid_itf_t *hid, bool enable) {
+    if (enable) {
+        keys_start();
+    }
+    uint32_t basepri = raise_irq_pri(IRQ_PRI_OTG_FS);
+    hid->gamepad = enable;
+    if (enable && hid->base.usbd != NULL && USBD_HID_CanSendReport(&hid->base)) {
+        // Nothing in flight to chain from, so start the reports here
+        usbd_hid_tx_ready(&hid->base);
+    }
+    restore_irq_pri(basepri);
+}
+#endif
+
 #endif // MICROPY_HW_USB_HID
@@ -4,6 +4,7 @@
 #ifndef MICROPY_INCLUDED_STM32_USBD_HID_INTERFACE_H
 #define MICROPY_INCLUDED_STM32_USBD_HID_INTERFACE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "usbd_cdc_msc_hid.h"
 
@@ -14,6 +15,12 @@ typedef struct _usbd_hid_itf_t {
 
     volatile size_t report_in_len;
     uint8_t report_in_buf[HID_DATA_FS_MAX_PACKET_SIZE];
+
+    #if MICROPY_HW_USB_HID_GAMEPAD
+    // when set, gamepad reports of the keys are sent at every poll
+    volatile bool gamepad;
+    uint8_t report_out_buf[USBD_HID_GAMEPAD_MAX_PACKET];
+    #endif
 } usbd_hid_itf_t;
 
 static inline int usbd_hid_rx_num(usbd_hid_itf_t *hid) {
@@ -21,5 +28,6 @@ static inline int usbd_hid_rx_num(usbd_hid_itf_t *hid) {
 }
 
 int usbd_hid_rx(usbd_hid_itf_t *hid, size_t len, uint8_t *buf, uint32_t timeout_ms);
+void usbd_hid_gamepad(usbd_hid_itf_t *hid, bool enable);
 
 #endif // MICROPY_INCLUDED_STM32_USBD_HID_INTERFACE_H
@@ -32,6 +32,7 @@
 #include "extmod/vfs.h"
 #include "storage.h"
 #include "sdcard.h"
+#include "asset.h"
 
 #if MICROPY_HW_USB_MSC
 
@@ -162,6 +163,24 @@ STATIC int lu_ioctl(uint8_t lun, int op, uint32_t *data) {
                 return -1;
         }
     #endif
+    #if MICROPY_HW_ASSETS_UF2
+    } else if (lu == &pyb_asset_type) {
+        switch (op) {
+            case BP_IOCTL_INIT:
+                *data = 0;
+                return 0;
+            case BP_IOCTL_SYNC:
+                return 0;
+            case BP_IOCTL_SEC_SIZE:
+                *data = 512;
+                return 0;
+            case BP_IOCTL_SEC_COUNT:
+                *data = asset_uf2_block_count();
+                return 0;
+            default:
+                return -1;
+        }
+    #endif
     } else {
         return -1;
     }
@@ -214,17 +233,26 @@ STATIC int usbd_msc_Inquiry(uint8_t lun, const uint8_t *params, uint8_t *data_ou
     int len = MIN(sizeof(usbd_msc_inquiry_data), alloc_len);
     memcpy(data_out, usbd_msc_inquiry_data, len);
 
-    #if MICROPY_HW_ENABLE_SDCARD
+    #if MICROPY_HW_ENABLE_SDCARD || MICROPY_HW_ASSETS_UF2
     const void *lu = usbd_msc_lu_data[lun];
     if (len == sizeof(usbd_msc_inquiry_data)) {
-        if (lu == &pyb_sdcard_type) {
+        if (0) {
+        }
+        #if MICROPY_HW_ENABLE_SDCARD
+        else if (lu == &pyb_sdcard_type) {
             memcpy(data_out + 24, "SDCard", sizeof("SDCard") - 1);
         }
+        #endif
         #if MICROPY_HW_ENABLE_MMCARD
         else if (lu == &pyb_mmcard_type) {
             memcpy(data_out + 24, "MMCard", sizeof("MMCard") - 1);
         }
         #endif
+        #if MICROPY_HW_ASSETS_UF2
+        else if (lu == &pyb_asset_type) {
+            memcpy(data_out + 24, "Assets", sizeof("Assets") - 1);
+        }
+        #endif
     }
     #endif
 
@@ -298,6 +326,11 @@ STATIC int8_t usbd_msc_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16
             return 0;
         }
     #endif
+    #if MICROPY_HW_ASSETS_UF2
+    } else if (lu == &pyb_asset_type) {
+        asset_uf2_read_blocks(buf, blk_addr, blk_len);
+        return 0;
+    #endif
     }
     return -1;
 }
@@ -309,6 +342,11 @@ STATIC int8_t usbd_msc_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint1
     }
     const void *lu = usbd_msc_lu_data[lun];
 
+    #if MICROPY_VFS_STAT_CACHE_SIZE
+    // the host may be adding or removing files
+    mp_vfs_stat_cache_clear();
+    #endif
+
     if (lu == &pyb_flash_type) {
         storage_write_blocks(buf, blk_addr, blk_len);
         return 0;
@@ -322,6 +360,10 @@ STATIC int8_t usbd_msc_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint1
             return 0;
         }
     #endif
+    #if MICROPY_HW_ASSETS_UF2
+    } else if (lu == &pyb_asset_type) {
+        return asset_uf2_write_blocks(buf, blk_addr, blk_len);
+    #endif
     }
     return -1;
 }
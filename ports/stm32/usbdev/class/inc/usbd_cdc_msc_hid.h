@@ -148,6 +148,11 @@ extern const uint8_t USBD_HID_MOUSE_ReportDesc[USBD_HID_MOUSE_REPORT_DESC_SIZE];
 
 extern const uint8_t USBD_HID_KEYBOARD_ReportDesc[USBD_HID_KEYBOARD_REPORT_DESC_SIZE];
 
+#define USBD_HID_GAMEPAD_MAX_PACKET        (4)
+#define USBD_HID_GAMEPAD_REPORT_DESC_SIZE  (39)
+
+extern const uint8_t USBD_HID_GAMEPAD_ReportDesc[USBD_HID_GAMEPAD_REPORT_DESC_SIZE];
+
 extern const USBD_ClassTypeDef USBD_CDC_MSC_HID;
 
 static inline uint32_t usbd_msc_max_packet(USBD_HandleTypeDef *pdev) {
@@ -201,6 +206,7 @@ int8_t usbd_cdc_receive(usbd_cdc_state_t *cdc, size_t len);
 
 // These are provided externally to implement the HID interface
 uint8_t *usbd_hid_init(usbd_hid_state_t *hid);
+void usbd_hid_tx_ready(usbd_hid_state_t *hid);
 int8_t usbd_hid_receive(usbd_hid_state_t *hid, size_t len);
 
 #endif // _USB_CDC_MSC_CORE_H_
@@ -402,6 +402,29 @@ __ALIGN_BEGIN const uint8_t USBD_HID_KEYBOARD_ReportDesc[USBD_HID_KEYBOARD_REPOR
     0x81, 0x00,         // Input (Data, Array), ;Key arrays (6 bytes)
     0xC0            // End Collection
 };
+
+__ALIGN_BEGIN const uint8_t USBD_HID_GAMEPAD_ReportDesc[USBD_HID_GAMEPAD_REPORT_DESC_SIZE] __ALIGN_END = {
+    0x05, 0x01,     // Usage Page (Generic Desktop),
+    0x09, 0x05,     // Usage (Game Pad),
+    0xA1, 0x01,     // Collection (Application),
+    0x05, 0x09,         // Usage Page (Buttons),
+    0x19, 0x01,         // Usage Minimum (01),
+    0x29, 0x10,         // Usage Maximum (16),
+    0x15, 0x00,         // Logical Minimum (0),
+    0x25, 0x01,         // Logical Maximum (1),
+    0x75, 0x01,         // Report Size (1),
+    0x95, 0x10,         // Report Count (16),
+    0x81, 0x02,         // Input (Data, Variable, Absolute), -- 16 button bits
+    0x05, 0x01,         // Usage Page (Generic Desktop),
+    0x09, 0x30,         // Usage (X),
+    0x09, 0x31,         // Usage (Y),
+    0x15, 0x81,         // Logical Minimum (-127),
+    0x25, 0x7F,         // Logical Maximum (127),
+    0x75, 0x08,         // Report Size (8),
+    0x95, 0x02,         // Report Count (2),
+    0x81, 0x02,         // Input (Data, Variable, Absolute), -- X,Y axis bytes
+    0xC0            // End Collection
+};
 #endif
 
 static void make_head_desc(uint8_t *dest, uint16_t len, uint8_t num_itf) {
@@ -674,6 +697,9 @@ static uint8_t USBD_CDC_MSC_HID_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx) {
         USBD_LL_PrepareReceive(pdev, usbd->hid->out_ep, buf, mps_out);
 
         usbd->hid->state = HID_IDLE;
+
+        // Let the interface queue its first report if it sends them by itself
+        usbd_hid_tx_ready(usbd->hid);
     }
     #endif
 
@@ -981,6 +1007,7 @@ static uint8_t USBD_CDC_MSC_HID_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
         /* Ensure that the FIFO is empty before a new transfer, this condition could
         be caused by  a new transfer before the end of the previous transfer */
         usbd->hid->state = HID_IDLE;
+        usbd_hid_tx_ready(usbd->hid);
         return USBD_OK;
     }
     #endif
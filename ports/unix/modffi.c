@@ -34,8 +34,19 @@
 
 #include "py/runtime.h"
 #include "py/binary.h"
+#include "py/smallint.h"
 #include "py/mperrno.h"
 
+// Functions that take and return only integers and pointers are called
+// directly, instead of through ffi_call, on ABIs where such values are all
+// passed and returned as words in the same way.
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || defined(__arm__)
+#define MODFFI_DIRECT_CALL (1)
+#define MODFFI_DIRECT_CALL_MAX_ARGS (4)
+#else
+#define MODFFI_DIRECT_CALL (0)
+#endif
+
 /*
  * modffi uses character codes to encode a value type, based on "struct"
  * module type codes, with some extensions and overridings.
@@ -73,11 +84,29 @@ typedef struct _mp_obj_ffivar_t {
 //    ffi_type *type;
 } mp_obj_ffivar_t;
 
+// The storage for one argument of a call; libffi reads it as the argument's
+// type, which may be wider than ffi_arg.
+typedef union _ffi_value_t {
+    ffi_arg word;
+    uint64_t u64;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    float flt;
+    double dbl;
+    #endif
+} ffi_value_t;
+
+// Converters for the arguments and return value of an ffifunc, chosen by
+// make_func from the typecodes so that a call doesn't switch on them.
+typedef void (*ffi_arg_conv_t)(ffi_value_t *dest, mp_obj_t src);
+typedef mp_obj_t (*ffi_ret_conv_t)(ffi_arg val);
+
 typedef struct _mp_obj_ffifunc_t {
     mp_obj_base_t base;
     void *func;
     char rettype;
-    const char *argtypes;
+    bool direct; // all values are words, so func can be called without libffi
+    ffi_ret_conv_t ret_conv;
+    ffi_arg_conv_t *arg_conv;
     ffi_cif cif;
     ffi_type *params[];
 } mp_obj_ffifunc_t;
@@ -138,32 +167,155 @@ STATIC ffi_type *get_ffi_type(mp_obj_t o_in)
     mp_raise_TypeError("Unknown type");
 }
 
-STATIC mp_obj_t return_ffi_value(ffi_arg val, char type)
-{
-    switch (type) {
-        case 's': {
-            const char *s = (const char *)(intptr_t)val;
-            if (!s) {
-                return mp_const_none;
-            }
-            return mp_obj_new_str(s, strlen(s));
+// Argument converters
+
+// Convert an object that is passed by value or by address as a word.
+STATIC ffi_arg ffi_obj_to_word(mp_obj_t a) {
+    if (a == mp_const_none) {
+        return 0;
+    } else if (mp_obj_is_int(a)) {
+        return mp_obj_int_get_truncated(a);
+    } else if (mp_obj_is_str(a)) {
+        const char *s = mp_obj_str_get_str(a);
+        return (ffi_arg)(intptr_t)s;
+    } else if (((mp_obj_base_t*)MP_OBJ_TO_PTR(a))->type->buffer_p.get_buffer != NULL) {
+        mp_obj_base_t *o = (mp_obj_base_t*)MP_OBJ_TO_PTR(a);
+        mp_buffer_info_t bufinfo;
+        int ret = o->type->buffer_p.get_buffer(MP_OBJ_FROM_PTR(o), &bufinfo, MP_BUFFER_READ); // TODO: MP_BUFFER_READ?
+        if (ret == 0) {
+            return (ffi_arg)(intptr_t)bufinfo.buf;
         }
-        case 'v':
-            return mp_const_none;
+    } else if (mp_obj_is_type(a, &fficallback_type)) {
+        mp_obj_fficallback_t *p = MP_OBJ_TO_PTR(a);
+        return (ffi_arg)(intptr_t)p->func;
+    }
+    mp_raise_TypeError("Don't know how to pass object to native function");
+}
+
+STATIC void ffi_arg_obj(ffi_value_t *dest, mp_obj_t src) {
+    dest->word = (ffi_arg)(intptr_t)src;
+}
+
+STATIC void ffi_arg_ptr(ffi_value_t *dest, mp_obj_t src) {
+    dest->word = ffi_obj_to_word(src);
+}
+
+// Integers are cast to their C type, so that they are sign or zero extended
+// the way the callee expects when they are passed as a word.
+#define FFI_ARG_INT(name, ctype, field) \
+    STATIC void name(ffi_value_t *dest, mp_obj_t src) { \
+        if (mp_obj_is_small_int(src)) { \
+            dest->field = (ctype)MP_OBJ_SMALL_INT_VALUE(src); \
+        } else { \
+            dest->field = (ctype)ffi_obj_to_word(src); \
+        } \
+    }
+
+FFI_ARG_INT(ffi_arg_schar, signed char, word)
+FFI_ARG_INT(ffi_arg_uchar, unsigned char, word)
+FFI_ARG_INT(ffi_arg_sshort, short, word)
+FFI_ARG_INT(ffi_arg_ushort, unsigned short, word)
+FFI_ARG_INT(ffi_arg_sint, int, word)
+FFI_ARG_INT(ffi_arg_uint, unsigned int, word)
+FFI_ARG_INT(ffi_arg_slong, long, word)
+FFI_ARG_INT(ffi_arg_ulong, unsigned long, word)
+FFI_ARG_INT(ffi_arg_sint64, int64_t, u64)
+FFI_ARG_INT(ffi_arg_uint64, uint64_t, u64)
+
+#if MICROPY_PY_BUILTINS_FLOAT
+STATIC void ffi_arg_float(ffi_value_t *dest, mp_obj_t src) {
+    dest->flt = mp_obj_get_float(src);
+}
+
+STATIC void ffi_arg_double(ffi_value_t *dest, mp_obj_t src) {
+    dest->dbl = mp_obj_get_float(src);
+}
+#endif
+
+STATIC ffi_arg_conv_t char2ffi_arg_conv(char c) {
+    switch (c) {
+        case 'b': return ffi_arg_schar;
+        case 'B': return ffi_arg_uchar;
+        case 'h': return ffi_arg_sshort;
+        case 'H': return ffi_arg_ushort;
+        case 'i': return ffi_arg_sint;
+        case 'I': return ffi_arg_uint;
+        case 'l': return ffi_arg_slong;
+        case 'L': return ffi_arg_ulong;
+        case 'q': return ffi_arg_sint64;
+        case 'Q': return ffi_arg_uint64;
         #if MICROPY_PY_BUILTINS_FLOAT
-        case 'f': {
-            union { ffi_arg ffi; float flt; } val_union = { .ffi = val };
-            return mp_obj_new_float(val_union.flt);
-        }
-        case 'd': {
-            double *p = (double*)&val;
-            return mp_obj_new_float(*p);
-        }
+        case 'f': return ffi_arg_float;
+        case 'd': return ffi_arg_double;
         #endif
-        case 'O':
-            return (mp_obj_t)(intptr_t)val;
-        default:
-            return mp_obj_new_int(val);
+        case 'O': return ffi_arg_obj;
+        default: return ffi_arg_ptr;
+    }
+}
+
+// Return value converters
+
+STATIC mp_obj_t ffi_ret_void(ffi_arg val) {
+    (void)val;
+    return mp_const_none;
+}
+
+STATIC mp_obj_t ffi_ret_obj(ffi_arg val) {
+    return (mp_obj_t)(intptr_t)val;
+}
+
+STATIC mp_obj_t ffi_ret_str(ffi_arg val) {
+    const char *s = (const char *)(intptr_t)val;
+    if (!s) {
+        return mp_const_none;
+    }
+    return mp_obj_new_str(s, strlen(s));
+}
+
+// Results that fit a small int are returned without going to the heap.
+#define FFI_RET_INT(name, ctype) \
+    STATIC mp_obj_t name(ffi_arg val) { \
+        mp_int_t i = (ctype)val; \
+        if (MP_SMALL_INT_FITS(i)) { \
+            return MP_OBJ_NEW_SMALL_INT(i); \
+        } \
+        return mp_obj_new_int(i); \
+    }
+
+FFI_RET_INT(ffi_ret_schar, signed char)
+FFI_RET_INT(ffi_ret_uchar, unsigned char)
+FFI_RET_INT(ffi_ret_sshort, short)
+FFI_RET_INT(ffi_ret_ushort, unsigned short)
+FFI_RET_INT(ffi_ret_sint, int)
+FFI_RET_INT(ffi_ret_word, mp_int_t)
+
+#if MICROPY_PY_BUILTINS_FLOAT
+STATIC mp_obj_t ffi_ret_float(ffi_arg val) {
+    union { ffi_arg ffi; float flt; } val_union = { .ffi = val };
+    return mp_obj_new_float(val_union.flt);
+}
+
+STATIC mp_obj_t ffi_ret_double(ffi_arg val) {
+    double *p = (double*)&val;
+    return mp_obj_new_float(*p);
+}
+#endif
+
+STATIC ffi_ret_conv_t char2ffi_ret_conv(char c) {
+    switch (c) {
+        case 'b': return ffi_ret_schar;
+        case 'B': return ffi_ret_uchar;
+        case 'h': return ffi_ret_sshort;
+        case 'H': return ffi_ret_ushort;
+        case 'i': return ffi_ret_sint;
+        case 's': return ffi_ret_str;
+        case 'v': return ffi_ret_void;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case 'f': return ffi_ret_float;
+        case 'd': return ffi_ret_double;
+        #endif
+        case 'O': return ffi_ret_obj;
+        default: return ffi_ret_word;
     }
 }
 
@@ -182,9 +334,26 @@ STATIC mp_obj_t ffimod_close(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(ffimod_close_obj, ffimod_close);
 
+#if MODFFI_DIRECT_CALL
+// Whether a value of this type is passed and returned in the same way as a
+// word, so a function taking and returning only such values can be called
+// through a pointer cast to words.
+STATIC bool ffi_type_is_word(char c) {
+    switch (c) {
+        case 'q':
+        case 'Q':
+            return sizeof(ffi_arg) >= sizeof(uint64_t);
+        case 'f':
+        case 'd':
+            return false;
+        default:
+            return true;
+    }
+}
+#endif
+
 STATIC mp_obj_t make_func(mp_obj_t rettype_in, void *func, mp_obj_t argtypes_in) {
     const char *rettype = mp_obj_str_get_str(rettype_in);
-    const char *argtypes = mp_obj_str_get_str(argtypes_in);
 
     mp_int_t nparams = MP_OBJ_SMALL_INT_VALUE(mp_obj_len_maybe(argtypes_in));
     mp_obj_ffifunc_t *o = m_new_obj_var(mp_obj_ffifunc_t, ffi_type*, nparams);
@@ -192,14 +361,26 @@ STATIC mp_obj_t make_func(mp_obj_t rettype_in, void *func, mp_obj_t argtypes_in)
 
     o->func = func;
     o->rettype = *rettype;
-    o->argtypes = argtypes;
+    o->ret_conv = char2ffi_ret_conv(*rettype);
+    o->arg_conv = m_new(ffi_arg_conv_t, nparams);
+    #if MODFFI_DIRECT_CALL
+    o->direct = nparams <= MODFFI_DIRECT_CALL_MAX_ARGS && ffi_type_is_word(*rettype);
+    #else
+    o->direct = false;
+    #endif
 
     mp_obj_iter_buf_t iter_buf;
     mp_obj_t iterable = mp_getiter(argtypes_in, &iter_buf);
     mp_obj_t item;
     int i = 0;
     while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
-        o->params[i++] = get_ffi_type(item);
+        o->params[i] = get_ffi_type(item);
+        char argtype = *mp_obj_str_get_str(item);
+        o->arg_conv[i] = char2ffi_arg_conv(argtype);
+        #if MODFFI_DIRECT_CALL
+        o->direct &= ffi_type_is_word(argtype);
+        #endif
+        i++;
     }
 
     int res = ffi_prep_cif(&o->cif, FFI_DEFAULT_ABI, nparams, char2ffi_type(*rettype), o->params);
@@ -348,51 +529,44 @@ STATIC void ffifunc_print(const mp_print_t *print, mp_obj_t self_in, mp_print_ki
     mp_printf(print, "<ffifunc %p>", self->func);
 }
 
+#if MODFFI_DIRECT_CALL
+// Call a function that takes and returns only words.  The arguments have
+// already been extended to words, and the result is narrowed by ret_conv.
+STATIC ffi_arg ffifunc_call_direct(void *func, size_t n_args, const ffi_value_t *values) {
+    typedef ffi_arg (*f0_t)(void);
+    typedef ffi_arg (*f1_t)(ffi_arg);
+    typedef ffi_arg (*f2_t)(ffi_arg, ffi_arg);
+    typedef ffi_arg (*f3_t)(ffi_arg, ffi_arg, ffi_arg);
+    typedef ffi_arg (*f4_t)(ffi_arg, ffi_arg, ffi_arg, ffi_arg);
+    switch (n_args) {
+        case 0: return ((f0_t)func)();
+        case 1: return ((f1_t)func)(values[0].word);
+        case 2: return ((f2_t)func)(values[0].word, values[1].word);
+        case 3: return ((f3_t)func)(values[0].word, values[1].word, values[2].word);
+        default: return ((f4_t)func)(values[0].word, values[1].word, values[2].word, values[3].word);
+    }
+}
+#endif
+
 STATIC mp_obj_t ffifunc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     (void)n_kw;
     mp_obj_ffifunc_t *self = MP_OBJ_TO_PTR(self_in);
     assert(n_kw == 0);
     assert(n_args == self->cif.nargs);
 
-    ffi_arg values[n_args];
+    ffi_value_t values[n_args];
     void *valueptrs[n_args];
-    const char *argtype = self->argtypes;
-    for (uint i = 0; i < n_args; i++, argtype++) {
-        mp_obj_t a = args[i];
-        if (*argtype == 'O') {
-            values[i] = (ffi_arg)(intptr_t)a;
-        #if MICROPY_PY_BUILTINS_FLOAT
-        } else if (*argtype == 'f') {
-            float *p = (float*)&values[i];
-            *p = mp_obj_get_float(a);
-        } else if (*argtype == 'd') {
-            double *p = (double*)&values[i];
-            *p = mp_obj_get_float(a);
-        #endif
-        } else if (a == mp_const_none) {
-            values[i] = 0;
-        } else if (mp_obj_is_int(a)) {
-            values[i] = mp_obj_int_get_truncated(a);
-        } else if (mp_obj_is_str(a)) {
-            const char *s = mp_obj_str_get_str(a);
-            values[i] = (ffi_arg)(intptr_t)s;
-        } else if (((mp_obj_base_t*)MP_OBJ_TO_PTR(a))->type->buffer_p.get_buffer != NULL) {
-            mp_obj_base_t *o = (mp_obj_base_t*)MP_OBJ_TO_PTR(a);
-            mp_buffer_info_t bufinfo;
-            int ret = o->type->buffer_p.get_buffer(MP_OBJ_FROM_PTR(o), &bufinfo, MP_BUFFER_READ); // TODO: MP_BUFFER_READ?
-            if (ret != 0) {
-                goto error;
-            }
-            values[i] = (ffi_arg)(intptr_t)bufinfo.buf;
-        } else if (mp_obj_is_type(a, &fficallback_type)) {
-            mp_obj_fficallback_t *p = MP_OBJ_TO_PTR(a);
-            values[i] = (ffi_arg)(intptr_t)p->func;
-        } else {
-            goto error;
-        }
+    for (uint i = 0; i < n_args; i++) {
+        self->arg_conv[i](&values[i], args[i]);
         valueptrs[i] = &values[i];
     }
 
+    #if MODFFI_DIRECT_CALL
+    if (self->direct) {
+        return self->ret_conv(ffifunc_call_direct(self->func, n_args, values));
+    }
+    #endif
+
     // If ffi_arg is not big enough to hold a double, then we must pass along a
     // pointer to a memory location of the correct size.
     // TODO check if this needs to be done for other types which don't fit into
@@ -407,11 +581,8 @@ STATIC mp_obj_t ffifunc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
     {
         ffi_arg retval;
         ffi_call(&self->cif, self->func, &retval, valueptrs);
-        return return_ffi_value(retval, self->rettype);
+        return self->ret_conv(retval);
     }
-
-error:
-    mp_raise_TypeError("Don't know how to pass object to native function");
 }
 
 STATIC const mp_obj_type_t ffifunc_type = {
@@ -0,0 +1,213 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "extmod/machine_display.h"
+
+#if MICROPY_PY_PYB_SCREEN
+
+// A stand-in for pyb.SCREEN of the MEOWBIT, so that code drawing to the screen
+// can be run and benchmarked on a host.  show() does the same work on the CPU
+// as the board, copying RGB565 pixels or expanding palette indices, but into
+// a frame in RAM instead of sending them over SPI, and never in the background.
+// The pixels go through the display protocol of extmod/machine_display.c, the
+// same code as on the board.
+
+#define SCREEN_WIDTH (160)
+#define SCREEN_HEIGHT (128)
+
+typedef struct _pyb_screen_obj_t {
+    mp_obj_base_t base;
+    // the window being written and the next pixel of it
+    int win_x, win_y, win_w, win_h;
+    size_t win_pos;
+    // palette and frame are in wire (big-endian) byte order, as on the board
+    uint16_t palette[MP_MACHINE_DISPLAY_PALETTE_SIZE];
+    uint16_t frame[SCREEN_WIDTH * SCREEN_HEIGHT];
+} pyb_screen_obj_t;
+
+STATIC const mp_obj_type_t pyb_screen_type;
+
+STATIC pyb_screen_obj_t screen_obj = { .base = { &pyb_screen_type } };
+STATIC bool screen_inited;
+
+STATIC mp_obj_t pyb_screen_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    // baudrate and bits are accepted as on the board, and ignored
+    mp_arg_check_num(n_args, n_kw, 0, 0, true);
+    if (!screen_inited) {
+        mp_machine_display_palette_reset(screen_obj.palette);
+        screen_inited = true;
+    }
+    return MP_OBJ_FROM_PTR(&screen_obj);
+}
+
+STATIC void screen_window(void *self, int x, int y, int w, int h) {
+    pyb_screen_obj_t *screen = self;
+    screen->win_x = x;
+    screen->win_y = y;
+    screen->win_w = w;
+    screen->win_h = h;
+    screen->win_pos = 0;
+}
+
+// Copy pixels into the window of the frame, wrapping at its right edge.
+STATIC int screen_write(void *self, const uint16_t *pixels, size_t n) {
+    pyb_screen_obj_t *screen = self;
+    size_t win_size = (size_t)screen->win_w * screen->win_h;
+    n = MIN(n, win_size - screen->win_pos);
+    while (n > 0) {
+        size_t row = screen->win_pos / screen->win_w;
+        size_t col = screen->win_pos % screen->win_w;
+        size_t len = MIN(n, screen->win_w - col);
+        uint16_t *dest = screen->frame + (screen->win_y + row) * SCREEN_WIDTH + screen->win_x + col;
+        memcpy(dest, pixels, len * 2);
+        pixels += len;
+        screen->win_pos += len;
+        n -= len;
+    }
+    return 0;
+}
+
+#ifdef MICROPY_PY_PYB_SCREEN_SHOW_HOOK
+// let the port put the frame where it can be seen
+STATIC void screen_present(void *self) {
+    pyb_screen_obj_t *screen = self;
+    MICROPY_PY_PYB_SCREEN_SHOW_HOOK(screen->frame, SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+#endif
+
+STATIC const mp_machine_display_p_t pyb_screen_p = {
+    .window = screen_window,
+    .write = screen_write,
+    .flush = NULL,
+    #ifdef MICROPY_PY_PYB_SCREEN_SHOW_HOOK
+    .present = screen_present,
+    #endif
+};
+
+const mp_machine_display_p_t *mp_machine_display_get(mp_obj_t obj) {
+    if (!mp_obj_is_type(obj, &pyb_screen_type)) {
+        mp_raise_TypeError("not a display");
+    }
+    return &pyb_screen_p;
+}
+
+STATIC mp_obj_t pyb_screen_show(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_palette, ARG_wait, ARG_callback, ARG_rect };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_palette, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+        { MP_QSTR_wait, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+        { MP_QSTR_rect, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_READ);
+
+    bool with_palette = args[ARG_palette].u_obj != mp_const_none;
+    if (with_palette) {
+        mp_buffer_info_t palinfo;
+        if (mp_get_buffer(args[ARG_palette].u_obj, &palinfo, MP_BUFFER_READ)) {
+            mp_machine_display_palette_load(screen->palette, &palinfo);
+        }
+    }
+    int mode = mp_machine_display_mode(bufinfo.len, SCREEN_WIDTH * SCREEN_HEIGHT, with_palette);
+    mp_machine_display_show(&pyb_screen_p, screen, &bufinfo, mode, screen->palette,
+        SCREEN_WIDTH, SCREEN_HEIGHT, args[ARG_rect].u_obj);
+
+    if (args[ARG_callback].u_obj != mp_const_none) {
+        mp_sched_schedule(args[ARG_callback].u_obj, MP_OBJ_FROM_PTR(screen));
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_screen_show_obj, 2, pyb_screen_show);
+
+STATIC mp_obj_t pyb_screen_busy(mp_obj_t self_in) {
+    (void)self_in;
+    return mp_const_false;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_screen_busy_obj, pyb_screen_busy);
+
+STATIC mp_obj_t pyb_screen_wait(mp_obj_t self_in) {
+    (void)self_in;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_screen_wait_obj, pyb_screen_wait);
+
+STATIC mp_obj_t pyb_screen_palette(size_t n_args, const mp_obj_t *args) {
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 1) {
+        mp_machine_display_palette_reset(screen->palette);
+        return mp_const_none;
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+    mp_machine_display_palette_load(screen->palette, &bufinfo);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pyb_screen_palette_obj, 1, 2, pyb_screen_palette);
+
+// frame() returns the pixels last shown, as RGB565 in wire byte order, so that
+// tests can check what would be on the screen; the board has no equivalent.
+STATIC mp_obj_t pyb_screen_frame(mp_obj_t self_in) {
+    pyb_screen_obj_t *screen = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bytearray_by_ref(sizeof(screen->frame), screen->frame);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_screen_frame_obj, pyb_screen_frame);
+
+STATIC const mp_rom_map_elem_t pyb_screen_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_show), MP_ROM_PTR(&pyb_screen_show_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&pyb_screen_busy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&pyb_screen_wait_obj) },
+    { MP_ROM_QSTR(MP_QSTR_palette), MP_ROM_PTR(&pyb_screen_palette_obj) },
+    { MP_ROM_QSTR(MP_QSTR_frame), MP_ROM_PTR(&pyb_screen_frame_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(pyb_screen_locals_dict, pyb_screen_locals_dict_table);
+
+STATIC const mp_obj_type_t pyb_screen_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_SCREEN,
+    .make_new = pyb_screen_make_new,
+    .locals_dict = (mp_obj_dict_t*)&pyb_screen_locals_dict,
+};
+
+STATIC const mp_rom_map_elem_t pyb_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_pyb) },
+    { MP_ROM_QSTR(MP_QSTR_SCREEN), MP_ROM_PTR(&pyb_screen_type) },
+};
+STATIC MP_DEFINE_CONST_DICT(pyb_module_globals, pyb_module_globals_table);
+
+const mp_obj_module_t mp_module_pyb = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&pyb_module_globals,
+};
+
+#endif // MICROPY_PY_PYB_SCREEN
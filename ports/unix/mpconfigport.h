@@ -27,7 +27,9 @@
 // options to control how MicroPython is built
 
 #define MICROPY_ALLOC_PATH_MAX      (PATH_MAX)
+#define MICROPY_ALLOC_VSTR_GROW_MAX (1024 * 1024)
 #define MICROPY_PERSISTENT_CODE_LOAD (1)
+#define MICROPY_PERSISTENT_CODE_LOAD_XIP (1)
 #if !defined(MICROPY_EMIT_X64) && defined(__x86_64__)
     #define MICROPY_EMIT_X64        (1)
 #endif
@@ -48,6 +50,12 @@
 #define MICROPY_COMP_RETURN_IF_EXPR (1)
 #define MICROPY_ENABLE_GC           (1)
 #define MICROPY_ENABLE_FINALISER    (1)
+#define MICROPY_GC_FREE_LISTS       (16)
+#define MICROPY_GC_INCREMENTAL      (1)
+#define MICROPY_GC_ARENA            (1)
+#define MICROPY_GC_LARGE_ALLOC      (1024)
+#define MICROPY_GC_THREAD_CACHE     (8)
+#define MICROPY_QSTR_INDEX          (2)
 #define MICROPY_STACK_CHECK         (1)
 #define MICROPY_MALLOC_USES_ALLOCATED_SIZE (1)
 #define MICROPY_MEM_STATS           (1)
@@ -56,10 +64,12 @@
 // check stdout a chance to pass, etc.
 #define MICROPY_DEBUG_PRINTER       (&mp_stderr_print)
 #define MICROPY_READER_POSIX        (1)
+#define MICROPY_READER_BUF_SIZE     (256)
 #define MICROPY_USE_READLINE_HISTORY (1)
 #define MICROPY_HELPER_REPL         (1)
 #define MICROPY_REPL_EMACS_KEYS     (1)
 #define MICROPY_REPL_AUTO_INDENT    (1)
+#define MICROPY_READLINE_HISTORY_BYTES (4096)
 #define MICROPY_HELPER_LEXER_UNIX   (1)
 #define MICROPY_ENABLE_SOURCE_LINE  (1)
 #define MICROPY_FLOAT_IMPL          (MICROPY_FLOAT_IMPL_DOUBLE)
@@ -70,9 +80,35 @@
 #ifndef MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (1)
 #endif
+#ifndef MICROPY_OPT_VM_SMALL_INT
+#define MICROPY_OPT_VM_SMALL_INT (1)
+#endif
+#ifndef MICROPY_OPT_SUPERINSTRUCTIONS
+#define MICROPY_OPT_SUPERINSTRUCTIONS (1)
+#endif
+#define MICROPY_OPT_MAP_LOOKUP_CACHE (1)
+#define MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE (256)
+#define MICROPY_OPT_ROM_MAP_LOOKUP_CACHE (1)
+#define MICROPY_OPT_ROM_MAP_LOOKUP_CACHE_SIZE (256)
+#ifndef MICROPY_OPT_MAP_ORDERED_INDEX
+#define MICROPY_OPT_MAP_ORDERED_INDEX (1)
+#endif
+#ifndef MICROPY_OPT_MPZ_FAST_MUL
+#define MICROPY_OPT_MPZ_FAST_MUL    (1)
+#endif
+#ifndef MICROPY_OPT_FAST_FLOAT
+#define MICROPY_OPT_FAST_FLOAT      (1)
+#endif
+#ifndef MICROPY_OPT_VM_FREE_RETURNED_TUPLE
+#define MICROPY_OPT_VM_FREE_RETURNED_TUPLE (1)
+#endif
+#ifndef MICROPY_OPT_BOUND_METH_CACHE
+#define MICROPY_OPT_BOUND_METH_CACHE (1)
+#endif
 #define MICROPY_CAN_OVERRIDE_BUILTINS (1)
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
 #define MICROPY_PY_DESCRIPTORS      (1)
+#define MICROPY_PY_GENERATOR_RELEASE_STATE (1)
 #define MICROPY_PY_BUILTINS_STR_UNICODE (1)
 #define MICROPY_PY_BUILTINS_STR_CENTER (1)
 #define MICROPY_PY_BUILTINS_STR_PARTITION (1)
@@ -88,6 +124,8 @@
 #define MICROPY_PY_ALL_SPECIAL_METHODS (1)
 #define MICROPY_PY_REVERSE_SPECIAL_METHODS (1)
 #define MICROPY_PY_ARRAY_SLICE_ASSIGN (1)
+#define MICROPY_PY_ARRAY_OPS        (1)
+#define MICROPY_PY_STRUCT_STRUCT    (1)
 #define MICROPY_PY_BUILTINS_SLICE_ATTRS (1)
 #define MICROPY_PY_SYS_EXIT         (1)
 #if defined(__APPLE__) && defined(__MACH__)
@@ -99,6 +137,8 @@
 #define MICROPY_PY_SYS_STDFILES     (1)
 #define MICROPY_PY_SYS_EXC_INFO     (1)
 #define MICROPY_PY_COLLECTIONS_DEQUE (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_ITER (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR (1)
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (1)
 #ifndef MICROPY_PY_MATH_SPECIAL_FUNCTIONS
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS (1)
@@ -107,6 +147,7 @@
 #define MICROPY_PY_IO_IOBASE        (1)
 #define MICROPY_PY_IO_FILEIO        (1)
 #define MICROPY_PY_GC_COLLECT_RETVAL (1)
+#define MICROPY_PY_GC_FRAGMENTATION (1)
 #define MICROPY_MODULE_FROZEN_STR   (1)
 
 #ifndef MICROPY_STACKLESS
@@ -120,16 +161,38 @@
 #define MICROPY_PY_UERRNO           (1)
 #define MICROPY_PY_UCTYPES          (1)
 #define MICROPY_PY_UZLIB            (1)
+#ifndef MICROPY_PY_UZLIB_LOOKUP_BITS
+#define MICROPY_PY_UZLIB_LOOKUP_BITS (10)
+#endif
+#ifndef MICROPY_PY_UZLIB_COMPRESS
+#define MICROPY_PY_UZLIB_COMPRESS   (1)
+#endif
+#ifndef MICROPY_PY_BTREE_CACHESIZE
+#define MICROPY_PY_BTREE_CACHESIZE  (32768)
+#endif
+#ifndef MICROPY_PY_BTREE_READAHEAD
+#define MICROPY_PY_BTREE_READAHEAD  (4096)
+#endif
 #define MICROPY_PY_UJSON            (1)
+#define MICROPY_PY_UJSON_DECODER    (1)
 #define MICROPY_PY_URE              (1)
+#ifndef MICROPY_PY_URE_CACHE_SIZE
+#define MICROPY_PY_URE_CACHE_SIZE   (4)
+#endif
+#ifndef MICROPY_PY_URE_PIKEVM
+#define MICROPY_PY_URE_PIKEVM       (1)
+#endif
 #define MICROPY_PY_UHEAPQ           (1)
 #define MICROPY_PY_UTIMEQ           (1)
+#define MICROPY_PY_UASYNCIO         (1)
 #define MICROPY_PY_UHASHLIB         (1)
+#define MICROPY_PY_UHASHLIB_CRC32   (1)
 #if MICROPY_PY_USSL
 #define MICROPY_PY_UHASHLIB_MD5     (1)
 #define MICROPY_PY_UHASHLIB_SHA1    (1)
-#define MICROPY_PY_UCRYPTOLIB       (1)
 #endif
+#define MICROPY_PY_UCRYPTOLIB       (1)
+#define MICROPY_PY_UCRYPTOLIB_CTR   (1)
 #define MICROPY_PY_UBINASCII        (1)
 #define MICROPY_PY_UBINASCII_CRC32  (1)
 #define MICROPY_PY_URANDOM          (1)
@@ -146,6 +209,7 @@
 #define MICROPY_FATFS_RPATH            (2)
 #define MICROPY_FATFS_MAX_SS           (4096)
 #define MICROPY_FATFS_LFN_CODE_PAGE    437 /* 1=SFN/ANSI 437=LFN/U.S.(OEM) */
+#define MICROPY_FATFS_USE_FASTSEEK     (1)
 #define MICROPY_VFS_FAT                (0)
 
 // Define to MICROPY_ERROR_REPORTING_DETAILED to get function, etc.
@@ -170,6 +234,7 @@ extern const struct _mp_print_t mp_stderr_print;
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF   (1)
 #define MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE  (256)
 #define MICROPY_KBD_EXCEPTION       (1)
+#define MICROPY_EXC_TRACEBACK_LAZY  (1)
 #define MICROPY_ASYNC_KBD_INTR      (1)
 
 extern const struct _mp_obj_module_t mp_module_machine;
@@ -181,6 +246,7 @@ extern const struct _mp_obj_module_t mp_module_termios;
 extern const struct _mp_obj_module_t mp_module_socket;
 extern const struct _mp_obj_module_t mp_module_ffi;
 extern const struct _mp_obj_module_t mp_module_jni;
+extern const struct _mp_obj_module_t mp_module_pyb;
 
 #if MICROPY_PY_UOS_VFS
 #define MICROPY_PY_UOS_DEF { MP_ROM_QSTR(MP_QSTR_uos), MP_ROM_PTR(&mp_module_uos_vfs) },
@@ -218,6 +284,12 @@ extern const struct _mp_obj_module_t mp_module_jni;
 #define MICROPY_PY_USELECT_DEF
 #endif
 
+#if MICROPY_PY_PYB_SCREEN
+#define MICROPY_PY_PYB_DEF { MP_ROM_QSTR(MP_QSTR_pyb), MP_ROM_PTR(&mp_module_pyb) },
+#else
+#define MICROPY_PY_PYB_DEF
+#endif
+
 #define MICROPY_PORT_BUILTIN_MODULES \
     MICROPY_PY_FFI_DEF \
     MICROPY_PY_JNI_DEF \
@@ -227,6 +299,7 @@ extern const struct _mp_obj_module_t mp_module_jni;
     MICROPY_PY_UOS_DEF \
     MICROPY_PY_USELECT_DEF \
     MICROPY_PY_TERMIOS_DEF \
+    MICROPY_PY_PYB_DEF \
 
 // type definitions for the specific machine
 
@@ -60,6 +60,12 @@
 #define MICROPY_PY_COLLECTIONS_NAMEDTUPLE__ASDICT (1)
 #define MICROPY_PY_UCRYPTOLIB          (1)
 #define MICROPY_PY_UCRYPTOLIB_CTR      (1)
+#define MICROPY_PY_UHASHLIB_SHA256_UNROLL (1)
+#define MICROPY_GC_PROFILE             (1)
+#define MICROPY_GC_STATS               (1)
+#define MICROPY_STACK_HIGH_WATER       (1)
+#define MICROPY_VM_OPCODE_STATS        (1)
+#define MICROPY_COMP_PEEPHOLE          (1)
 
 // TODO these should be generic, not bound to fatfs
 #define mp_type_fileio mp_type_vfs_posix_fileio
@@ -62,26 +62,68 @@ STATIC sem_t *thread_signal_done_p;
 STATIC sem_t thread_signal_done;
 #endif
 
+// scan the regs and stack of the calling thread
+STATIC void mp_thread_gc_self(void) {
+    void gc_collect_regs_and_stack(void);
+    gc_collect_regs_and_stack();
+    // We have access to the context (regs, stack) of the thread but it seems
+    // that we don't need the extra information, enough is captured by the
+    // gc_collect_regs_and_stack function above
+    //gc_collect_root((void**)context, sizeof(ucontext_t) / sizeof(uintptr_t));
+    #if MICROPY_ENABLE_PYSTACK
+    void **ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
+    gc_collect_root(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*));
+    #endif
+}
+
+#if !MICROPY_PY_THREAD_GIL
+// Without the GIL the other threads are stopped for the whole of the marking,
+// as they would otherwise move pointers into what was already traced.  Each
+// waits in the signal handler, for SIGUSR2, until thread_gc_scan is its id
+// and it scans its stack, and then until thread_gc_resumed is counted on,
+// which a new collection can't undo before the thread sees it.
+STATIC bool thread_gc_stopped;
+STATIC volatile pthread_t thread_gc_scan;
+STATIC volatile sig_atomic_t thread_gc_resumed;
+
+STATIC void mp_thread_gc_wake(int signo) {
+    (void)signo;
+}
+#endif
+
 // this signal handler is used to scan the regs and stack of a thread
 STATIC void mp_thread_gc(int signo, siginfo_t *info, void *context) {
     (void)info; // unused
     (void)context; // unused
     if (signo == SIGUSR1) {
-        void gc_collect_regs_and_stack(void);
-        gc_collect_regs_and_stack();
-        // We have access to the context (regs, stack) of the thread but it seems
-        // that we don't need the extra information, enough is captured by the
-        // gc_collect_regs_and_stack function above
-        //gc_collect_root((void**)context, sizeof(ucontext_t) / sizeof(uintptr_t));
-        #if MICROPY_ENABLE_PYSTACK
-        void **ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
-        gc_collect_root(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*));
+        #if MICROPY_PY_THREAD_GIL
+        mp_thread_gc_self();
+        #else
+        // SIGUSR2 is blocked while in this handler, except in sigsuspend
+        sig_atomic_t resumed = thread_gc_resumed;
+        sigset_t mask;
+        sigfillset(&mask);
+        sigdelset(&mask, SIGUSR2);
+        #if defined (__APPLE__)
+        sem_post(thread_signal_done_p);
+        #else
+        sem_post(&thread_signal_done);
+        #endif
+        while (!pthread_equal(thread_gc_scan, pthread_self())) {
+            sigsuspend(&mask);
+        }
+        mp_thread_gc_self();
         #endif
         #if defined (__APPLE__)
         sem_post(thread_signal_done_p);
         #else
         sem_post(&thread_signal_done);
         #endif
+        #if !MICROPY_PY_THREAD_GIL
+        while (thread_gc_resumed == resumed) {
+            sigsuspend(&mask);
+        }
+        #endif
     }
 }
 
@@ -108,7 +150,19 @@ void mp_thread_init(void) {
     sa.sa_flags = SA_SIGINFO;
     sa.sa_sigaction = mp_thread_gc;
     sigemptyset(&sa.sa_mask);
+    #if !MICROPY_PY_THREAD_GIL
+    sigaddset(&sa.sa_mask, SIGUSR2);
+    #endif
     sigaction(SIGUSR1, &sa, NULL);
+
+    #if !MICROPY_PY_THREAD_GIL
+    // SIGUSR2 wakes a thread stopped in the handler above
+    sa.sa_flags = 0;
+    sa.sa_handler = mp_thread_gc_wake;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR2, &sa, NULL);
+    thread_gc_scan = thread->id;
+    #endif
 }
 
 void mp_thread_deinit(void) {
@@ -134,6 +188,7 @@ void mp_thread_deinit(void) {
 // with race conditions and root-pointer scanning: a given thread may manipulate
 // the global root pointers (in mp_state_ctx) while another thread is doing a
 // garbage collection and tracing these pointers.
+#if MICROPY_PY_THREAD_GIL
 void mp_thread_gc_others(void) {
     pthread_mutex_lock(&thread_mutex);
     for (thread_t *th = thread; th != NULL; th = th->next) {
@@ -153,6 +208,58 @@ void mp_thread_gc_others(void) {
     }
     pthread_mutex_unlock(&thread_mutex);
 }
+#else
+// Without the GIL the other threads are stopped by mp_thread_gc_others_stop
+// before anything is traced, and the thread list is locked until they are
+// resumed, so the threads that are ready stay the same.
+void mp_thread_gc_others_stop(void) {
+    pthread_mutex_lock(&thread_mutex);
+    thread_gc_stopped = true;
+    // no thread may scan until mp_thread_gc_others gives it its turn
+    thread_gc_scan = pthread_self();
+    for (thread_t *th = thread; th != NULL; th = th->next) {
+        if (th->id != pthread_self() && th->ready) {
+            pthread_kill(th->id, SIGUSR1);
+            #if defined(__APPLE__)
+            sem_wait(thread_signal_done_p);
+            #else
+            sem_wait(&thread_signal_done);
+            #endif
+        }
+    }
+}
+
+void mp_thread_gc_others(void) {
+    for (thread_t *th = thread; th != NULL; th = th->next) {
+        gc_collect_root(&th->arg, 1);
+        if (th->id != pthread_self() && th->ready) {
+            // the threads scan in turn, as marking isn't thread-safe
+            thread_gc_scan = th->id;
+            pthread_kill(th->id, SIGUSR2);
+            #if defined(__APPLE__)
+            sem_wait(thread_signal_done_p);
+            #else
+            sem_wait(&thread_signal_done);
+            #endif
+        }
+    }
+}
+
+void mp_thread_gc_others_resume(void) {
+    if (!thread_gc_stopped) {
+        // gc_sweep_all didn't stop them
+        return;
+    }
+    thread_gc_stopped = false;
+    thread_gc_resumed += 1;
+    for (thread_t *th = thread; th != NULL; th = th->next) {
+        if (th->id != pthread_self() && th->ready) {
+            pthread_kill(th->id, SIGUSR2);
+        }
+    }
+    pthread_mutex_unlock(&thread_mutex);
+}
+#endif
 
 mp_state_thread_t *mp_thread_get_state(void) {
     return (mp_state_thread_t*)pthread_getspecific(tls_key);
@@ -201,6 +308,11 @@ void mp_thread_create(void *(*entry)(void*), void *arg, size_t *stack_size) {
         goto er;
     }
 
+    // adjust stack_size to provide room to recover from hitting the limit
+    // this value seems to be about right for both 32-bit and 64-bit builds
+    // (done before the thread starts because it reads stack_size on entry)
+    *stack_size -= 8192;
+
     pthread_mutex_lock(&thread_mutex);
 
     // create thread
@@ -211,10 +323,6 @@ void mp_thread_create(void *(*entry)(void*), void *arg, size_t *stack_size) {
         goto er;
     }
 
-    // adjust stack_size to provide room to recover from hitting the limit
-    // this value seems to be about right for both 32-bit and 64-bit builds
-    *stack_size -= 8192;
-
     // add thread to linked list of all threads
     thread_t *th = malloc(sizeof(thread_t));
     th->id = id;
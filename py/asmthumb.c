@@ -102,6 +102,12 @@ STATIC void asm_thumb_write_word32(asm_thumb_t *as, int w32) {
 #define OP_POP_RLIST(rlolist)       (0xbc00 | (rlolist))
 #define OP_POP_RLIST_PC(rlolist)    (0xbc00 | 0x0100 | (rlolist))
 
+// Thumb2 push/pop, where rlist can include r8-r12
+#define OP_PUSH_W_RLIST_LR_HI (0xe92d)
+#define OP_PUSH_W_RLIST_LR_LO(rlist) (0x4000 | (rlist))
+#define OP_POP_W_RLIST_PC_HI (0xe8bd)
+#define OP_POP_W_RLIST_PC_LO(rlist) (0x8000 | (rlist))
+
 // The number of words must fit in 7 unsigned bits
 #define OP_ADD_SP(num_words) (0xb000 | (num_words))
 #define OP_SUB_SP(num_words) (0xb080 | (num_words))
@@ -117,7 +123,7 @@ STATIC void asm_thumb_write_word32(asm_thumb_t *as, int w32) {
 //  ^                ^
 //  | low address    | high address in RAM
 
-void asm_thumb_entry(asm_thumb_t *as, int num_locals) {
+STATIC void asm_thumb_entry_helper(asm_thumb_t *as, int num_locals, bool save_hi) {
     assert(num_locals >= 0);
 
     // If this Thumb machine code is run from ARM state then add a prelude
@@ -169,7 +175,13 @@ void asm_thumb_entry(asm_thumb_t *as, int num_locals) {
             stack_adjust = ((num_locals - 3) + 1) & (~1);
             break;
     }
-    asm_thumb_op16(as, OP_PUSH_RLIST_LR(reglist));
+    if (save_hi) {
+        // r8-r11 are 4 more words, so the stack stays 8-byte aligned
+        reglist |= 0xf00;
+        asm_thumb_op32(as, OP_PUSH_W_RLIST_LR_HI, OP_PUSH_W_RLIST_LR_LO(reglist));
+    } else {
+        asm_thumb_op16(as, OP_PUSH_RLIST_LR(reglist));
+    }
     if (stack_adjust > 0) {
         if (UNSIGNED_FIT7(stack_adjust)) {
             asm_thumb_op16(as, OP_SUB_SP(stack_adjust));
@@ -181,6 +193,14 @@ void asm_thumb_entry(asm_thumb_t *as, int num_locals) {
     as->stack_adjust = stack_adjust;
 }
 
+void asm_thumb_entry(asm_thumb_t *as, int num_locals) {
+    asm_thumb_entry_helper(as, num_locals, false);
+}
+
+void asm_thumb_entry_save_hi(asm_thumb_t *as, int num_locals) {
+    asm_thumb_entry_helper(as, num_locals, true);
+}
+
 void asm_thumb_exit(asm_thumb_t *as) {
     if (as->stack_adjust > 0) {
         if (UNSIGNED_FIT7(as->stack_adjust)) {
@@ -189,7 +209,11 @@ void asm_thumb_exit(asm_thumb_t *as) {
             asm_thumb_op32(as, OP_ADD_W_RRI_HI(ASM_THUMB_REG_SP), OP_ADD_W_RRI_LO(ASM_THUMB_REG_SP, as->stack_adjust * 4));
         }
     }
-    asm_thumb_op16(as, OP_POP_RLIST_PC(as->push_reglist));
+    if (as->push_reglist > 0xff) {
+        asm_thumb_op32(as, OP_POP_W_RLIST_PC_HI, OP_POP_W_RLIST_PC_LO(as->push_reglist));
+    } else {
+        asm_thumb_op16(as, OP_POP_RLIST_PC(as->push_reglist));
+    }
 }
 
 STATIC mp_uint_t get_label_dest(asm_thumb_t *as, uint label) {
@@ -315,18 +339,28 @@ void asm_thumb_mov_reg_i32_optimised(asm_thumb_t *as, uint reg_dest, int i32) {
 #define OP_STR_TO_SP_OFFSET(rlo_dest, word_offset) (0x9000 | ((rlo_dest) << 8) | ((word_offset) & 0x00ff))
 #define OP_LDR_FROM_SP_OFFSET(rlo_dest, word_offset) (0x9800 | ((rlo_dest) << 8) | ((word_offset) & 0x00ff))
 
-void asm_thumb_mov_local_reg(asm_thumb_t *as, int local_num, uint rlo_src) {
-    assert(rlo_src < ASM_THUMB_REG_R8);
+#define OP_STR_W_TO_SP_OFFSET_HI (0xf8cd)
+#define OP_LDR_W_FROM_SP_OFFSET_HI (0xf8dd)
+#define OP_RW_SP_OFFSET_LO(reg, word_offset) ((reg) << 12 | ((word_offset) * 4))
+
+void asm_thumb_mov_local_reg(asm_thumb_t *as, int local_num, uint reg_src) {
     int word_offset = local_num;
     assert(as->base.pass < MP_ASM_PASS_EMIT || word_offset >= 0);
-    asm_thumb_op16(as, OP_STR_TO_SP_OFFSET(rlo_src, word_offset));
+    if (reg_src < ASM_THUMB_REG_R8) {
+        asm_thumb_op16(as, OP_STR_TO_SP_OFFSET(reg_src, word_offset));
+    } else {
+        asm_thumb_op32(as, OP_STR_W_TO_SP_OFFSET_HI, OP_RW_SP_OFFSET_LO(reg_src, word_offset));
+    }
 }
 
-void asm_thumb_mov_reg_local(asm_thumb_t *as, uint rlo_dest, int local_num) {
-    assert(rlo_dest < ASM_THUMB_REG_R8);
+void asm_thumb_mov_reg_local(asm_thumb_t *as, uint reg_dest, int local_num) {
     int word_offset = local_num;
     assert(as->base.pass < MP_ASM_PASS_EMIT || word_offset >= 0);
-    asm_thumb_op16(as, OP_LDR_FROM_SP_OFFSET(rlo_dest, word_offset));
+    if (reg_dest < ASM_THUMB_REG_R8) {
+        asm_thumb_op16(as, OP_LDR_FROM_SP_OFFSET(reg_dest, word_offset));
+    } else {
+        asm_thumb_op32(as, OP_LDR_W_FROM_SP_OFFSET_HI, OP_RW_SP_OFFSET_LO(reg_dest, word_offset));
+    }
 }
 
 #define OP_ADD_REG_SP_OFFSET(rlo_dest, word_offset) (0xa800 | ((rlo_dest) << 8) | ((word_offset) & 0x00ff))
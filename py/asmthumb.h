@@ -73,6 +73,8 @@ typedef struct _asm_thumb_t {
 void asm_thumb_end_pass(asm_thumb_t *as);
 
 void asm_thumb_entry(asm_thumb_t *as, int num_locals);
+// as asm_thumb_entry, but also saving r8-r11 so the function can use them
+void asm_thumb_entry_save_hi(asm_thumb_t *as, int num_locals);
 void asm_thumb_exit(asm_thumb_t *as);
 
 // argument order follows ARM, in general dest is first
@@ -235,6 +237,28 @@ static inline void asm_thumb_ldrb_rlo_rlo_i5(asm_thumb_t *as, uint rlo_dest, uin
 static inline void asm_thumb_ldrh_rlo_rlo_i5(asm_thumb_t *as, uint rlo_dest, uint rlo_base, uint byte_offset)
     { asm_thumb_format_9_10(as, ASM_THUMB_FORMAT_10_LDRH, rlo_dest, rlo_base, byte_offset); }
 
+// DSP: SIMD and saturating instructions of ARMv7E-M
+// The ops of the form "op rd, rn, rm" have the first halfword in the low 16
+// bits and the second in the high 16 bits, with the registers left as 0
+
+#define ASM_THUMB_OP_UADD8  (0xf040fa80)
+#define ASM_THUMB_OP_USUB8  (0xf040fac0)
+#define ASM_THUMB_OP_UQADD8 (0xf050fa80)
+#define ASM_THUMB_OP_UQSUB8 (0xf050fac0)
+#define ASM_THUMB_OP_UHADD8 (0xf060fa80)
+#define ASM_THUMB_OP_UQADD16 (0xf050fa90)
+#define ASM_THUMB_OP_QADD16 (0xf010fa90)
+#define ASM_THUMB_OP_SEL    (0xf080faa0)
+
+static inline void asm_thumb_dsp_reg_reg_reg(asm_thumb_t *as, uint32_t op, uint rd, uint rn, uint rm)
+    { asm_thumb_op32(as, (op & 0xffff) | rn, (op >> 16) | rd << 8 | rm); }
+// rd = ra + rn[15:0] * rm[15:0] + rn[31:16] * rm[31:16], signed
+static inline void asm_thumb_smlad(asm_thumb_t *as, uint rd, uint rn, uint rm, uint ra)
+    { asm_thumb_op32(as, 0xfb20 | rn, ra << 12 | rd << 8 | rm); }
+// rd = rn saturated to the range 0 to 2**sat_bits - 1
+static inline void asm_thumb_usat(asm_thumb_t *as, uint rd, uint rn, uint sat_bits)
+    { asm_thumb_op32(as, 0xf380 | rn, rd << 8 | sat_bits); }
+
 // TODO convert these to above format style
 
 #define ASM_THUMB_OP_MOVW (0xf240)
@@ -250,8 +274,8 @@ bool asm_thumb_bl_label(asm_thumb_t *as, uint label);
 
 size_t asm_thumb_mov_reg_i32(asm_thumb_t *as, uint reg_dest, mp_uint_t i32_src); // convenience
 void asm_thumb_mov_reg_i32_optimised(asm_thumb_t *as, uint reg_dest, int i32_src); // convenience
-void asm_thumb_mov_local_reg(asm_thumb_t *as, int local_num_dest, uint rlo_src); // convenience
-void asm_thumb_mov_reg_local(asm_thumb_t *as, uint rlo_dest, int local_num); // convenience
+void asm_thumb_mov_local_reg(asm_thumb_t *as, int local_num_dest, uint reg_src); // convenience
+void asm_thumb_mov_reg_local(asm_thumb_t *as, uint reg_dest, int local_num); // convenience
 void asm_thumb_mov_reg_local_addr(asm_thumb_t *as, uint rlo_dest, int local_num); // convenience
 void asm_thumb_mov_reg_pcrel(asm_thumb_t *as, uint rlo_dest, uint label);
 
@@ -186,17 +186,26 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
 
         // get pointer to arg_names array
         const mp_obj_t *arg_names = (const mp_obj_t*)self->const_table;
+        size_t n_arg_names = n_pos_args + n_kwonly_args;
 
+        // Keyword arguments are usually given in the order of the parameters, so
+        // each search starts just after the previous match and wraps around; in
+        // that case every argument is found at the first comparison.
+        size_t j = 0;
         for (size_t i = 0; i < n_kw; i++) {
             // the keys in kwargs are expected to be qstr objects
             mp_obj_t wanted_arg_name = kwargs[2 * i];
-            for (size_t j = 0; j < n_pos_args + n_kwonly_args; j++) {
+            for (size_t n = n_arg_names; n > 0; n--, j++) {
+                if (j == n_arg_names) {
+                    j = 0;
+                }
                 if (wanted_arg_name == arg_names[j]) {
                     if (code_state->state[n_state - 1 - j] != MP_OBJ_NULL) {
                         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
                             "function got multiple values for argument '%q'", MP_OBJ_QSTR_VALUE(wanted_arg_name)));
                     }
                     code_state->state[n_state - 1 - j] = kwargs[2 * i + 1];
+                    j++;
                     goto continue2;
                 }
             }
@@ -284,6 +293,60 @@ continue2:;
     dump_args(code_state->state, n_state);
 }
 
+size_t mp_bytecode_get_source_line(const mp_obj_fun_bc_t *fun_bc, const byte *ip_cur, qstr *block_name, qstr *source_file) {
+    const byte *ip = fun_bc->bytecode;
+    ip = mp_decode_uint_skip(ip); // skip n_state
+    ip = mp_decode_uint_skip(ip); // skip n_exc_stack
+    ip++; // skip scope_params
+    ip++; // skip n_pos_args
+    ip++; // skip n_kwonly_args
+    ip++; // skip n_def_pos_args
+    size_t bc = ip_cur - ip;
+    size_t code_info_size = mp_decode_uint_value(ip);
+    ip = mp_decode_uint_skip(ip); // skip code_info_size
+    bc -= code_info_size;
+    #if MICROPY_PERSISTENT_CODE
+    *block_name = ip[0] | (ip[1] << 8);
+    *source_file = ip[2] | (ip[3] << 8);
+    ip += 4;
+    #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+    if (mp_bytecode_is_xip(fun_bc->bytecode)) {
+        *block_name = MP_OBJ_QSTR_VALUE(fun_bc->const_table[*block_name]);
+        *source_file = MP_OBJ_QSTR_VALUE(fun_bc->const_table[*source_file]);
+    }
+    #endif
+    #else
+    *block_name = mp_decode_uint_value(ip);
+    ip = mp_decode_uint_skip(ip);
+    *source_file = mp_decode_uint_value(ip);
+    ip = mp_decode_uint_skip(ip);
+    #endif
+    size_t source_line = 1;
+    size_t c;
+    while ((c = *ip)) {
+        size_t b, l;
+        if ((c & 0x80) == 0) {
+            // 0b0LLBBBBB encoding
+            b = c & 0x1f;
+            l = c >> 5;
+            ip += 1;
+        } else {
+            // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
+            b = c & 0xf;
+            l = ((c << 4) & 0x700) | ip[1];
+            ip += 2;
+        }
+        if (bc >= b) {
+            bc -= b;
+            source_line += l;
+        } else {
+            // found source line corresponding to bytecode offset
+            break;
+        }
+    }
+    return source_line;
+}
+
 #if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
 
 // The following table encodes the number of bytes that a specific opcode
@@ -302,7 +365,7 @@ continue2:;
 #define B (MP_OPCODE_BYTE) // single byte
 #define Q (MP_OPCODE_QSTR) // single byte plus 2-byte qstr
 #define V (MP_OPCODE_VAR_UINT) // single byte plus variable encoded unsigned int
-#define O (MP_OPCODE_OFFSET) // single byte plus 2-byte bytecode offset
+#define O (MP_OPCODE_OFFSET) // single byte plus 2-byte bytecode offset, or 2 bytes of args
 STATIC const byte opcode_format_table[64] = {
     OC4(U, U, U, U), // 0x00-0x03
     OC4(U, U, U, U), // 0x04-0x07
@@ -322,7 +385,7 @@ STATIC const byte opcode_format_table[64] = {
     OC4(U, O, B, O), // 0x3c-0x3f
     OC4(O, B, B, O), // 0x40-0x43
     OC4(O, U, O, B), // 0x44-0x47
-    OC4(U, U, U, U), // 0x48-0x4b
+    OC4(O, O, U, U), // 0x48-0x4b
     OC4(U, U, U, U), // 0x4c-0x4f
     OC4(V, V, U, V), // 0x50-0x53
     OC4(B, U, V, V), // 0x54-0x57
@@ -94,9 +94,24 @@ mp_uint_t mp_decode_uint(const byte **ptr);
 mp_uint_t mp_decode_uint_value(const byte *ptr);
 const byte *mp_decode_uint_skip(const byte *ptr);
 
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+// Whether bytecode is in the XIP form, with const table indices for its qstrs
+static inline bool mp_bytecode_is_xip(const byte *bytecode) {
+    return (*mp_decode_uint_skip(mp_decode_uint_skip(bytecode)) & MP_SCOPE_FLAG_XIP) != 0;
+}
+#endif
+
 mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp_obj_t inject_exc);
+#if MICROPY_VM_OPCODE_STATS
+// Times each opcode was run, and each opcode after another; row 0 of the pair
+// table, which isn't an opcode, counts those run first on entering the VM
+extern size_t mp_vm_opcode_count[256];
+extern size_t mp_vm_opcode_pair_count[256][256];
+#endif
 mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t func, size_t n_args, size_t n_kw, const mp_obj_t *args);
 void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw, const mp_obj_t *args);
+// Find the line, and the function and file, of the opcode at ip in fun_bc
+size_t mp_bytecode_get_source_line(const mp_obj_fun_bc_t *fun_bc, const byte *ip, qstr *block_name, qstr *source_file);
 void mp_bytecode_print(const void *descr, const byte *code, mp_uint_t len, const mp_uint_t *const_table);
 void mp_bytecode_print2(const byte *code, size_t len, const mp_uint_t *const_table);
 const byte *mp_bytecode_print_str(const byte *ip);
@@ -81,6 +81,11 @@
 #define MP_BC_UNWIND_JUMP        (0x46) // rel byte code offset, 16-bit signed, in excess; then a byte
 #define MP_BC_GET_ITER_STACK     (0x47)
 
+// Superinstructions, for LOAD_FAST_MULTI then LOAD_FAST_MULTI or
+// LOAD_CONST_SMALL_INT_MULTI then BINARY_OP_MULTI
+#define MP_BC_LOAD_FAST_FAST_BINARY_OP (0x48) // byte: local << 4 | local; byte: op
+#define MP_BC_LOAD_FAST_INT_BINARY_OP  (0x49) // byte: local << 4 | (int + 16) >> 2; byte: (int + 16) << 6 | op
+
 #define MP_BC_BUILD_TUPLE        (0x50) // uint
 #define MP_BC_BUILD_LIST         (0x51) // uint
 #define MP_BC_BUILD_MAP          (0x53) // uint
@@ -29,6 +29,11 @@
 #include "py/obj.h"
 
 mp_obj_t mp_builtin___import__(size_t n_args, const mp_obj_t *args);
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+// Import the module from the .mpy file in buf; if that's outside the heap its
+// bytecode may run in place, so it mustn't change while the module is used
+mp_obj_t mp_import_mpy(qstr mod_name, const byte *buf, size_t len);
+#endif
 mp_obj_t mp_builtin_open(size_t n_args, const mp_obj_t *args, mp_map_t *kwargs);
 mp_obj_t mp_micropython_mem_info(size_t n_args, const mp_obj_t *args);
 
@@ -116,6 +121,7 @@ extern const mp_obj_module_t mp_module_urandom;
 extern const mp_obj_module_t mp_module_uselect;
 extern const mp_obj_module_t mp_module_ussl;
 extern const mp_obj_module_t mp_module_utimeq;
+extern const mp_obj_module_t mp_module_uasyncio;
 extern const mp_obj_module_t mp_module_machine;
 extern const mp_obj_module_t mp_module_lwip;
 extern const mp_obj_module_t mp_module_uwebsocket;
@@ -35,6 +35,15 @@
 #include "py/runtime.h"
 #include "py/builtin.h"
 #include "py/frozenmod.h"
+#include "py/gc.h"
+#if MICROPY_IMPORT_STATS
+#include "py/mphal.h"
+#endif
+
+#if MICROPY_MODULE_CACHE_MPY
+#include "py/stream.h"
+#include "extmod/vfs.h"
+#endif
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -48,6 +57,38 @@
 
 #define PATH_SEP_CHAR '/'
 
+#if MICROPY_IMPORT_STATS
+// a module loaded once the table is full has its times put here, so its
+// time isn't put down to the module importing it
+STATIC mp_import_stats_t import_stats_dropped;
+
+// Add the time since the last switch to the phase being timed, and time the
+// given phase from now on, or nothing if it's NULL
+STATIC void import_stats_switch(uint32_t *phase) {
+    mp_uint_t t = mp_hal_ticks_us();
+    if (MP_STATE_VM(import_stats_phase) != NULL) {
+        *MP_STATE_VM(import_stats_phase) += t - MP_STATE_VM(import_stats_t0);
+    }
+    MP_STATE_VM(import_stats_t0) = t;
+    MP_STATE_VM(import_stats_phase) = phase;
+}
+
+// these are no-ops for code run other than by import, like mp_import_mpy
+#define IMPORT_STATS_PHASE(field) do { \
+    if (MP_STATE_VM(import_stats_cur) != NULL) { \
+        import_stats_switch(&MP_STATE_VM(import_stats_cur)->field); \
+    } \
+} while (0)
+#define IMPORT_STATS_KIND(k) do { \
+    if (MP_STATE_VM(import_stats_cur) != NULL) { \
+        MP_STATE_VM(import_stats_cur)->kind = (k); \
+    } \
+} while (0)
+#else
+#define IMPORT_STATS_PHASE(field)
+#define IMPORT_STATS_KIND(k)
+#endif
+
 bool mp_obj_is_package(mp_obj_t module) {
     mp_obj_t dest[2];
     mp_load_method_maybe(module, MP_QSTR___path__, dest);
@@ -131,16 +172,89 @@ STATIC mp_import_stat_t find_file(const char *file_str, uint file_len, vstr_t *d
 #endif
 }
 
-#if MICROPY_MODULE_FROZEN_STR || MICROPY_ENABLE_COMPILER
+#if MICROPY_PARSE_STREAM
+// Compile and execute one top-level statement of the module being imported
+STATIC void do_execute_stmt(void *env, mp_parse_tree_t *tree) {
+    mp_lexer_t *lex = env;
+    IMPORT_STATS_PHASE(compile_us);
+    mp_obj_t stmt_fun = mp_compile(tree, lex->source_name, MP_EMIT_OPT_NONE, false);
+    IMPORT_STATS_PHASE(exec_us);
+    mp_call_function_0(stmt_fun);
+    IMPORT_STATS_PHASE(parse_us);
+}
+#endif
+
+#if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_MODULE_FROZEN_MPY \
+    || ((MICROPY_IMPORT_STATS || MICROPY_PARSE_STREAM) && (MICROPY_MODULE_FROZEN_STR || MICROPY_ENABLE_COMPILER))
+// Execute the module's code in its context, making its function there from
+// the raw code, or parsing and compiling it from lex if raw_code is NULL,
+// because a function takes its globals from the context that it's made in.
+STATIC void do_execute_module_code(mp_obj_t module_obj, mp_raw_code_t *raw_code, mp_lexer_t *lex) {
+    (void)lex;
+
+    // execute the module in its context
+    mp_obj_dict_t *mod_globals = mp_obj_module_get_globals(module_obj);
+
+    // save context
+    mp_obj_dict_t *volatile old_globals = mp_globals_get();
+    mp_obj_dict_t *volatile old_locals = mp_locals_get();
+
+    // set new context
+    mp_globals_set(mod_globals);
+    mp_locals_set(mod_globals);
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        #if MICROPY_ENABLE_COMPILER
+        if (raw_code == NULL) {
+            IMPORT_STATS_PHASE(parse_us);
+            #if MICROPY_PARSE_STREAM
+            mp_parse_stream(lex, do_execute_stmt, lex);
+            #else
+            qstr source_name = lex->source_name;
+            mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+            IMPORT_STATS_PHASE(compile_us);
+            mp_obj_t module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+            IMPORT_STATS_PHASE(exec_us);
+            mp_call_function_0(module_fun);
+            #endif
+        } else
+        #endif
+        {
+            mp_obj_t module_fun = mp_make_function_from_raw_code(raw_code, MP_OBJ_NULL, MP_OBJ_NULL);
+            IMPORT_STATS_PHASE(exec_us);
+            mp_call_function_0(module_fun);
+        }
+
+        // finish nlr block, restore context
+        nlr_pop();
+        mp_globals_set(old_globals);
+        mp_locals_set(old_locals);
+    } else {
+        // exception; restore context and re-raise same exception
+        mp_globals_set(old_globals);
+        mp_locals_set(old_locals);
+        nlr_jump(nlr.ret_val);
+    }
+}
+#endif
+
+#if MICROPY_MODULE_FROZEN_STR || (MICROPY_ENABLE_COMPILER && !MICROPY_MODULE_CACHE_MPY)
 STATIC void do_load_from_lexer(mp_obj_t module_obj, mp_lexer_t *lex) {
     #if MICROPY_PY___FILE__
     qstr source_name = lex->source_name;
     mp_store_attr(module_obj, MP_QSTR___file__, MP_OBJ_NEW_QSTR(source_name));
     #endif
 
+    #if MICROPY_IMPORT_STATS || MICROPY_PARSE_STREAM
+    // parse and compile here, rather than in mp_parse_compile_execute, to
+    // time each phase or to go one statement at a time
+    do_execute_module_code(module_obj, NULL, lex);
+    #else
     // parse, compile and execute the module in its context
     mp_obj_dict_t *mod_globals = mp_obj_module_get_globals(module_obj);
     mp_parse_compile_execute(lex, MP_PARSE_FILE_INPUT, mod_globals, mod_globals);
+    #endif
 }
 #endif
 
@@ -152,36 +266,171 @@ STATIC void do_execute_raw_code(mp_obj_t module_obj, mp_raw_code_t *raw_code, co
     mp_store_attr(module_obj, MP_QSTR___file__, MP_OBJ_NEW_QSTR(qstr_from_str(source_name)));
     #endif
 
-    // execute the module in its context
-    mp_obj_dict_t *mod_globals = mp_obj_module_get_globals(module_obj);
+    do_execute_module_code(module_obj, raw_code, NULL);
+}
+#endif
 
-    // save context
-    mp_obj_dict_t *volatile old_globals = mp_globals_get();
-    mp_obj_dict_t *volatile old_locals = mp_locals_get();
+#if MICROPY_MODULE_CACHE_MPY
 
-    // set new context
-    mp_globals_set(mod_globals);
-    mp_locals_set(mod_globals);
+#if !(MICROPY_ENABLE_COMPILER && MICROPY_VFS && MICROPY_PERSISTENT_CODE_LOAD && MICROPY_PERSISTENT_CODE_SAVE)
+#error MICROPY_MODULE_CACHE_MPY needs the compiler, MICROPY_VFS and MICROPY_PERSISTENT_CODE_LOAD/SAVE
+#endif
 
+// The cache file of dir/name.py is dir/__pycache__/name.mpy.  It holds the
+// size and mtime of the source it was compiled from, as 32-bit little endian
+// values, followed by the .mpy data.
+#define MODULE_CACHE_KEY_LEN (8)
+
+// Get the key of the source file, returning false if it can't be stat'd
+STATIC bool module_cache_key(const char *file_str, byte *key) {
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
-        mp_obj_t module_fun = mp_make_function_from_raw_code(raw_code, MP_OBJ_NULL, MP_OBJ_NULL);
-        mp_call_function_0(module_fun);
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(mp_vfs_stat(mp_obj_new_str(file_str, strlen(file_str))), 10, &items);
+        mp_uint_t size = mp_obj_get_int_truncated(items[6]);
+        mp_uint_t mtime = mp_obj_get_int_truncated(items[8]);
+        for (size_t i = 0; i < 4; ++i) {
+            key[i] = size >> (8 * i);
+            key[4 + i] = mtime >> (8 * i);
+        }
+        nlr_pop();
+        return true;
+    }
+    return false;
+}
 
-        // finish nlr block, restore context
+STATIC void module_cache_path(vstr_t *dest, const char *file_str, size_t len) {
+    const char *base = strrchr(file_str, PATH_SEP_CHAR);
+    base = base == NULL ? file_str : base + 1;
+    vstr_add_strn(dest, file_str, base - file_str);
+    vstr_add_str(dest, "__pycache__/");
+    vstr_add_strn(dest, base, file_str + len - base - 3);
+    vstr_add_str(dest, ".mpy");
+}
+
+// Load the cached code if its key matches, or return NULL if there's no
+// cache file, it's stale or it was made by an incompatible version
+STATIC mp_raw_code_t *module_cache_load(const char *cache_str, const byte *key) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_reader_t reader;
+        mp_reader_new_file(&reader, cache_str);
+        bool match = true;
+        for (size_t i = 0; i < MODULE_CACHE_KEY_LEN; ++i) {
+            if (reader.readbyte(reader.data) != key[i]) {
+                match = false;
+            }
+        }
+        mp_raw_code_t *raw_code = NULL;
+        if (match) {
+            raw_code = mp_raw_code_load(&reader);
+        } else {
+            reader.close(reader.data);
+        }
+        nlr_pop();
+        return raw_code;
+    }
+    return NULL;
+}
+
+STATIC void module_cache_call_no_raise(mp_obj_t (*fun)(mp_obj_t), mp_obj_t arg) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        fun(arg);
+        nlr_pop();
+    }
+}
+
+// Save the compiled code, writing a temporary file first so that a cache
+// file is never left half written, eg by a reset
+STATIC void module_cache_save(vstr_t *cache_path, const byte *key, mp_raw_code_t *raw_code) {
+    mp_obj_t cache_obj = mp_obj_new_str(cache_path->buf, cache_path->len);
+    vstr_add_str(cache_path, ".tmp");
+    mp_obj_t tmp_obj = mp_obj_new_str(cache_path->buf, cache_path->len);
+    cache_path->len -= 4;
+
+    // make the __pycache__ directory if it isn't there yet
+    mp_obj_t dir_obj = mp_obj_new_str(cache_path->buf, strrchr(cache_path->buf, PATH_SEP_CHAR) - cache_path->buf);
+    module_cache_call_no_raise(mp_vfs_mkdir, dir_obj);
+
+    mp_obj_t volatile file = MP_OBJ_NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t args[2] = { tmp_obj, MP_OBJ_NEW_QSTR(MP_QSTR_wb) };
+        file = mp_vfs_open(2, args, (mp_map_t*)&mp_const_empty_map);
+        mp_stream_write(file, key, MODULE_CACHE_KEY_LEN, MP_STREAM_RW_WRITE);
+        mp_print_t print = {MP_OBJ_TO_PTR(file), mp_stream_write_adaptor};
+        mp_raw_code_save(raw_code, &print);
+        mp_obj_t f = file;
+        file = MP_OBJ_NULL;
+        mp_stream_close(f);
+        module_cache_call_no_raise(mp_vfs_remove, cache_obj);
+        mp_vfs_rename(tmp_obj, cache_obj);
         nlr_pop();
-        mp_globals_set(old_globals);
-        mp_locals_set(old_locals);
     } else {
-        // exception; restore context and re-raise same exception
-        mp_globals_set(old_globals);
-        mp_locals_set(old_locals);
-        nlr_jump(nlr.ret_val);
+        // a read-only or full filesystem, or code that can't be saved: the
+        // module is just not cached
+        if (file != MP_OBJ_NULL) {
+            module_cache_call_no_raise(mp_stream_close, file);
+        }
+        module_cache_call_no_raise(mp_vfs_remove, tmp_obj);
+    }
+}
+
+STATIC void do_load_cached(mp_obj_t module_obj, vstr_t *file) {
+    char *file_str = vstr_null_terminated_str(file);
+    byte key[MODULE_CACHE_KEY_LEN];
+    bool have_key = module_cache_key(file_str, key);
+    vstr_t cache_path;
+    vstr_init(&cache_path, file->len + 16);
+    module_cache_path(&cache_path, file_str, file->len);
+
+    mp_raw_code_t *raw_code = NULL;
+    if (have_key) {
+        raw_code = module_cache_load(vstr_null_terminated_str(&cache_path), key);
+    }
+    if (raw_code != NULL) {
+        IMPORT_STATS_KIND('c');
+    } else {
+        IMPORT_STATS_PHASE(parse_us);
+        mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
+        qstr source_name = lex->source_name;
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        IMPORT_STATS_PHASE(compile_us);
+        raw_code = mp_compile_to_raw_code(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+        if (have_key) {
+            module_cache_save(&cache_path, key, raw_code);
+        }
+    }
+    vstr_clear(&cache_path);
+
+    do_execute_raw_code(module_obj, raw_code, file_str);
+}
+#endif // MICROPY_MODULE_CACHE_MPY
+
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+mp_obj_t mp_import_mpy(qstr mod_name, const byte *buf, size_t len) {
+    mp_obj_t module_obj = mp_module_get(mod_name);
+    if (module_obj != MP_OBJ_NULL) {
+        return module_obj;
     }
+    mp_raw_code_t *raw_code;
+    #if MICROPY_ENABLE_GC
+    if (!gc_is_heap_ptr(buf)) {
+        raw_code = mp_raw_code_load_rom(buf, len);
+    } else
+    #endif
+    {
+        // the buffer may be freed, or changed, so load a copy
+        raw_code = mp_raw_code_load_mem(buf, len);
+    }
+    module_obj = mp_obj_new_module(mod_name);
+    do_execute_raw_code(module_obj, raw_code, qstr_str(mod_name));
+    return module_obj;
 }
 #endif
 
-STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
+STATIC void do_load_file(mp_obj_t module_obj, vstr_t *file) {
     #if MICROPY_MODULE_FROZEN || MICROPY_ENABLE_COMPILER || (MICROPY_PERSISTENT_CODE_LOAD && MICROPY_HAS_FILE_READER)
     char *file_str = vstr_null_terminated_str(file);
     #endif
@@ -197,6 +446,7 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     // found the filename in the list of frozen files, then load and execute it.
     #if MICROPY_MODULE_FROZEN_STR
     if (frozen_type == MP_FROZEN_STR) {
+        IMPORT_STATS_KIND('s');
         do_load_from_lexer(module_obj, modref);
         return;
     }
@@ -206,6 +456,7 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     // its data) in the list of frozen files, execute it.
     #if MICROPY_MODULE_FROZEN_MPY
     if (frozen_type == MP_FROZEN_MPY) {
+        IMPORT_STATS_KIND('f');
         do_execute_raw_code(module_obj, modref, file_str);
         return;
     }
@@ -215,15 +466,23 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     // the correct format and, if so, load and execute the file.
     #if MICROPY_HAS_FILE_READER && MICROPY_PERSISTENT_CODE_LOAD
     if (file_str[file->len - 3] == 'm') {
+        IMPORT_STATS_KIND('m');
         mp_raw_code_t *raw_code = mp_raw_code_load_file(file_str);
         do_execute_raw_code(module_obj, raw_code, file_str);
         return;
     }
     #endif
 
-    // If we can compile scripts then load the file and compile and execute it.
-    #if MICROPY_ENABLE_COMPILER
+    // If we can compile scripts then load the file and compile and execute it,
+    // or use the compiled code cached from an earlier import.
+    #if MICROPY_MODULE_CACHE_MPY
     {
+        do_load_cached(module_obj, file);
+        return;
+    }
+    #elif MICROPY_ENABLE_COMPILER
+    {
+        IMPORT_STATS_PHASE(parse_us);
         mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
         do_load_from_lexer(module_obj, lex);
         return;
@@ -234,6 +493,59 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     #endif
 }
 
+#if MICROPY_IMPORT_STATS
+// Load the module, recording the time each phase takes and the heap it
+// keeps, less that of any modules it imports
+STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
+    mp_import_stats_t *outer = MP_STATE_VM(import_stats_cur);
+    uint32_t *outer_phase = MP_STATE_VM(import_stats_phase);
+    mp_int_t outer_child_bytes = MP_STATE_VM(import_stats_child_bytes);
+    import_stats_switch(NULL);
+
+    #if MICROPY_ENABLE_GC
+    gc_info_t info;
+    gc_info(&info);
+    size_t used = info.used;
+    #endif
+
+    mp_import_stats_t *stats = &import_stats_dropped;
+    if (MP_STATE_VM(import_stats_n) < MICROPY_IMPORT_STATS_MAX) {
+        stats = &MP_STATE_VM(import_stats)[MP_STATE_VM(import_stats_n)++];
+    }
+    memset(stats, 0, sizeof(*stats));
+    mp_obj_t name = mp_obj_dict_get(MP_OBJ_FROM_PTR(mp_obj_module_get_globals(module_obj)), MP_OBJ_NEW_QSTR(MP_QSTR___name__));
+    stats->name = MP_OBJ_QSTR_VALUE(name);
+    stats->kind = 'p';
+    stats->find_us = MP_STATE_VM(import_stats_find_us);
+    MP_STATE_VM(import_stats_cur) = stats;
+    MP_STATE_VM(import_stats_child_bytes) = 0;
+    import_stats_switch(&stats->load_us);
+
+    nlr_buf_t nlr;
+    bool loaded = nlr_push(&nlr) == 0;
+    if (loaded) {
+        do_load_file(module_obj, file);
+        nlr_pop();
+    }
+
+    import_stats_switch(NULL);
+    #if MICROPY_ENABLE_GC
+    gc_info(&info);
+    mp_int_t bytes = info.used - used;
+    stats->bytes = bytes - MP_STATE_VM(import_stats_child_bytes);
+    MP_STATE_VM(import_stats_child_bytes) = outer_child_bytes + bytes;
+    #endif
+    MP_STATE_VM(import_stats_cur) = outer;
+    import_stats_switch(outer_phase);
+
+    if (!loaded) {
+        nlr_jump(nlr.ret_val);
+    }
+}
+#else
+#define do_load do_load_file
+#endif
+
 STATIC void chop_component(const char *start, const char **end) {
     const char *p = *end;
     while (p > start) {
@@ -368,6 +680,11 @@ mp_obj_t mp_builtin___import__(size_t n_args, const mp_obj_t *args) {
             DEBUG_printf("Previous path: =%.*s=\n", vstr_len(&path), vstr_str(&path));
 
             // find the file corresponding to the module name
+            #if MICROPY_IMPORT_STATS
+            uint32_t *import_stats_outer_phase = MP_STATE_VM(import_stats_phase);
+            MP_STATE_VM(import_stats_find_us) = 0;
+            import_stats_switch(&MP_STATE_VM(import_stats_find_us));
+            #endif
             mp_import_stat_t stat;
             if (vstr_len(&path) == 0) {
                 // first module in the dotted-name; search for a directory or file
@@ -378,6 +695,9 @@ mp_obj_t mp_builtin___import__(size_t n_args, const mp_obj_t *args) {
                 vstr_add_strn(&path, mod_str + last, i - last);
                 stat = stat_dir_or_file(&path);
             }
+            #if MICROPY_IMPORT_STATS
+            import_stats_switch(import_stats_outer_phase);
+            #endif
             DEBUG_printf("Current path: %.*s\n", vstr_len(&path), vstr_str(&path));
 
             if (stat == MP_IMPORT_STAT_NO_EXIST) {
@@ -867,6 +867,55 @@ STATIC bool compile_built_in_decorator(compiler_t *comp, int name_len, mp_parse_
     return true;
 }
 
+#if MICROPY_DYNAMIC_COMPILER && MICROPY_EMIT_NATIVE
+// Return true if the function fname, defined in the current scope, is in
+// the comma-separated list of names.  A method may be given as Class.name.
+STATIC bool compile_func_in_list(compiler_t *comp, const char *list, qstr fname) {
+    if (list == NULL) {
+        return false;
+    }
+    size_t flen;
+    const char *f = (const char*)qstr_data(fname, &flen);
+    size_t clen = 0;
+    const char *c = NULL;
+    if (comp->scope_cur->kind == SCOPE_CLASS) {
+        c = (const char*)qstr_data(comp->scope_cur->simple_name, &clen);
+    }
+    while (*list) {
+        const char *end = strchr(list, ',');
+        size_t len = end == NULL ? strlen(list) : (size_t)(end - list);
+        if ((len == flen && memcmp(list, f, flen) == 0)
+            || (c != NULL && len == clen + 1 + flen && memcmp(list, c, clen) == 0
+                && list[clen] == '.' && memcmp(list + clen + 1, f, flen) == 0)) {
+            return true;
+        }
+        list += len;
+        if (*list == ',') {
+            ++list;
+        }
+    }
+    return false;
+}
+
+// Select the emitter for a function that has no built-in decorator, from the
+// lists of functions given to the cross compiler.
+STATIC uint compile_funcdef_emit_options(compiler_t *comp, mp_parse_node_struct_t *pns, uint emit_options) {
+    qstr fname = MP_PARSE_NODE_LEAF_ARG(pns->nodes[0]);
+    uint opt = emit_options;
+    if (compile_func_in_list(comp, mp_dynamic_compiler.native_funcs, fname)) {
+        opt = MP_EMIT_OPT_NATIVE_PYTHON;
+    } else if (compile_func_in_list(comp, mp_dynamic_compiler.viper_funcs, fname)) {
+        opt = MP_EMIT_OPT_VIPER;
+    }
+    if (opt != emit_options && emit_native_table[mp_dynamic_compiler.native_arch] == NULL) {
+        compile_syntax_error(comp, (mp_parse_node_t)pns, "invalid arch");
+    }
+    return opt;
+}
+#else
+#define compile_funcdef_emit_options(comp, pns, emit_options) (emit_options)
+#endif
+
 STATIC void compile_decorated(compiler_t *comp, mp_parse_node_struct_t *pns) {
     // get the list of decorators
     mp_parse_node_t *nodes;
@@ -912,11 +961,17 @@ STATIC void compile_decorated(compiler_t *comp, mp_parse_node_struct_t *pns) {
     mp_parse_node_struct_t *pns_body = (mp_parse_node_struct_t*)pns->nodes[1];
     qstr body_name = 0;
     if (MP_PARSE_NODE_STRUCT_KIND(pns_body) == PN_funcdef) {
+        if (num_built_in_decorators == 0 && comp->pass == MP_PASS_SCOPE) {
+            emit_options = compile_funcdef_emit_options(comp, pns_body, emit_options);
+        }
         body_name = compile_funcdef_helper(comp, pns_body, emit_options);
     #if MICROPY_PY_ASYNC_AWAIT
     } else if (MP_PARSE_NODE_STRUCT_KIND(pns_body) == PN_async_funcdef) {
         assert(MP_PARSE_NODE_IS_STRUCT(pns_body->nodes[0]));
         mp_parse_node_struct_t *pns0 = (mp_parse_node_struct_t*)pns_body->nodes[0];
+        if (num_built_in_decorators == 0 && comp->pass == MP_PASS_SCOPE) {
+            emit_options = compile_funcdef_emit_options(comp, pns0, emit_options);
+        }
         body_name = compile_funcdef_helper(comp, pns0, emit_options);
         scope_t *fscope = (scope_t*)pns0->nodes[4];
         fscope->scope_flags |= MP_SCOPE_FLAG_GENERATOR;
@@ -936,7 +991,11 @@ STATIC void compile_decorated(compiler_t *comp, mp_parse_node_struct_t *pns) {
 }
 
 STATIC void compile_funcdef(compiler_t *comp, mp_parse_node_struct_t *pns) {
-    qstr fname = compile_funcdef_helper(comp, pns, comp->scope_cur->emit_options);
+    uint emit_options = comp->scope_cur->emit_options;
+    if (comp->pass == MP_PASS_SCOPE) {
+        emit_options = compile_funcdef_emit_options(comp, pns, emit_options);
+    }
+    qstr fname = compile_funcdef_helper(comp, pns, emit_options);
     // store function object into function name
     compile_store_id(comp, fname);
 }
@@ -39,6 +39,21 @@
 #define BYTES_FOR_INT ((BYTES_PER_WORD * 8 + 6) / 7)
 #define DUMMY_DATA_SIZE (BYTES_FOR_INT)
 
+#if MICROPY_OPT_SUPERINSTRUCTIONS
+// A load written just before, that a BINARY_OP may be fused with
+typedef struct _emit_bc_fuse_t {
+    size_t offset;
+    byte kind;
+    byte arg;
+} emit_bc_fuse_t;
+
+enum {
+    EMIT_BC_FUSE_NONE,
+    EMIT_BC_FUSE_FAST, // LOAD_FAST_MULTI, with the local number
+    EMIT_BC_FUSE_INT, // LOAD_CONST_SMALL_INT_MULTI, with the int + 16
+};
+#endif
+
 struct _emit_t {
     // Accessed as mp_obj_t, so must be aligned as such, and we rely on the
     // memory allocator returning a suitably aligned pointer.
@@ -64,6 +79,22 @@ struct _emit_t {
     size_t bytecode_size;
     byte *code_base; // stores both byte code and code info
 
+    #if MICROPY_OPT_SUPERINSTRUCTIONS
+    emit_bc_fuse_t fuse[2];
+    #endif
+
+    #if MICROPY_COMP_PEEPHOLE
+    // The opcode just written, if it is one the peephole rules look at, and
+    // its offset.  Any other write, or a label, clears it.
+    byte last_op;
+    size_t last_op_offset;
+    // For each label, the label that an unconditional jump placed at it goes
+    // to (or -1), found in MP_PASS_STACK_SIZE.  While labels are waiting to
+    // see what comes after them they are chained from label_pending.
+    mp_uint_t *label_jump;
+    mp_uint_t label_pending;
+    #endif
+
     #if MICROPY_PERSISTENT_CODE
     uint16_t ct_cur_obj;
     uint16_t ct_num_obj;
@@ -80,15 +111,81 @@ emit_t *emit_bc_new(void) {
 void emit_bc_set_max_num_labels(emit_t *emit, mp_uint_t max_num_labels) {
     emit->max_num_labels = max_num_labels;
     emit->label_offsets = m_new(mp_uint_t, emit->max_num_labels);
+    #if MICROPY_COMP_PEEPHOLE
+    emit->label_jump = m_new(mp_uint_t, emit->max_num_labels);
+    #endif
 }
 
 void emit_bc_free(emit_t *emit) {
+    #if MICROPY_COMP_PEEPHOLE
+    m_del(mp_uint_t, emit->label_jump, emit->max_num_labels);
+    #endif
     m_del(mp_uint_t, emit->label_offsets, emit->max_num_labels);
     m_del_obj(emit_t, emit);
 }
 
 typedef byte *(*emit_allocator_t)(emit_t *emit, int nbytes);
 
+#if MICROPY_COMP_PEEPHOLE
+
+#define EMIT_BC_PEEPHOLE (MP_STATE_VM(mp_optimise_value) >= 2)
+#define EMIT_BC_NO_LABEL ((mp_uint_t)-1)
+
+// Record that the labels waiting at the current offset are followed by a
+// jump to target, or by something else if target is EMIT_BC_NO_LABEL.
+STATIC void emit_bc_label_pending_resolve(emit_t *emit, mp_uint_t target) {
+    mp_uint_t l = emit->label_pending;
+    while (l != EMIT_BC_NO_LABEL) {
+        mp_uint_t next = emit->label_jump[l];
+        emit->label_jump[l] = target;
+        l = next;
+    }
+    emit->label_pending = EMIT_BC_NO_LABEL;
+}
+
+// Return the label that a jump to label can go to instead, skipping over
+// unconditional jumps.  The number of hops is bounded in case jumps loop.
+STATIC mp_uint_t emit_bc_thread_label(emit_t *emit, mp_uint_t label) {
+    if (EMIT_BC_PEEPHOLE && emit->pass > MP_PASS_STACK_SIZE) {
+        for (int i = 0; i < 8 && emit->label_jump[label] != EMIT_BC_NO_LABEL; ++i) {
+            label = emit->label_jump[label];
+        }
+    }
+    return label;
+}
+
+// Note that the opcode op was just written, for the peephole rules.
+STATIC void emit_bc_peephole_note(emit_t *emit, byte op) {
+    emit->last_op = op;
+    emit->last_op_offset = emit->bytecode_offset - 1;
+}
+
+// If the last opcode written is op_first to op_last, with nothing after it
+// and no line number entry pointing past it, remove it and return it.
+// Returns 0 otherwise.  This is done the same way in every pass, so the
+// offsets worked out in earlier passes still hold.
+STATIC byte emit_bc_peephole_take(emit_t *emit, byte op_first, byte op_last) {
+    byte op = emit->last_op;
+    if (!EMIT_BC_PEEPHOLE || op < op_first || op > op_last
+        || emit->last_op_offset + 1 != emit->bytecode_offset
+        || emit->last_source_line_offset > emit->last_op_offset) {
+        return 0;
+    }
+    emit->bytecode_offset = emit->last_op_offset;
+    emit->last_op = 0;
+    #if MICROPY_OPT_SUPERINSTRUCTIONS
+    emit->fuse[0].kind = emit->fuse[1].kind = EMIT_BC_FUSE_NONE;
+    #endif
+    return op;
+}
+
+#else
+
+#define emit_bc_thread_label(emit, label) (label)
+#define emit_bc_peephole_note(emit, op)
+
+#endif
+
 STATIC void emit_write_uint(emit_t *emit, emit_allocator_t allocator, mp_uint_t val) {
     // We store each 7 bits in a separate byte, and that's how many bytes needed
     byte buf[BYTES_FOR_INT];
@@ -171,6 +268,12 @@ STATIC void emit_write_code_info_bytes_lines(emit_t *emit, mp_uint_t bytes_to_sk
 // all functions must go through this one to emit byte code
 STATIC byte *emit_get_cur_to_write_bytecode(emit_t *emit, int num_bytes_to_write) {
     //printf("emit %d\n", num_bytes_to_write);
+    #if MICROPY_COMP_PEEPHOLE
+    emit->last_op = 0;
+    if (emit->label_pending != EMIT_BC_NO_LABEL) {
+        emit_bc_label_pending_resolve(emit, EMIT_BC_NO_LABEL);
+    }
+    #endif
     if (emit->pass < MP_PASS_EMIT) {
         emit->bytecode_offset += num_bytes_to_write;
         return emit->dummy_data;
@@ -306,6 +409,49 @@ STATIC void emit_write_bytecode_byte_signed_label(emit_t *emit, byte b1, mp_uint
     c[2] = bytecode_offset >> 8;
 }
 
+#if MICROPY_OPT_SUPERINSTRUCTIONS
+STATIC void emit_bc_fuse_reset(emit_t *emit) {
+    emit->fuse[0].kind = EMIT_BC_FUSE_NONE;
+    emit->fuse[1].kind = EMIT_BC_FUSE_NONE;
+}
+
+// Remember a load about to be written, keeping the one before it
+STATIC void emit_bc_fuse_push(emit_t *emit, byte kind, byte arg) {
+    emit->fuse[0] = emit->fuse[1];
+    emit->fuse[1].offset = emit->bytecode_offset;
+    emit->fuse[1].kind = kind;
+    emit->fuse[1].arg = arg;
+}
+
+// If the last two opcodes written are LOAD_FAST_MULTI and LOAD_FAST_MULTI or
+// LOAD_CONST_SMALL_INT_MULTI, with no label between, rewrite them and write
+// the BINARY_OP as one superinstruction.  It has the same length, so the
+// offsets worked out in earlier passes still hold.
+STATIC bool emit_bc_fuse_binary_op(emit_t *emit, mp_binary_op_t op) {
+    emit_bc_fuse_t *f = emit->fuse;
+    if (f[0].kind != EMIT_BC_FUSE_FAST || f[1].kind == EMIT_BC_FUSE_NONE
+        || f[0].offset + 1 != f[1].offset || f[1].offset + 1 != emit->bytecode_offset) {
+        return false;
+    }
+    byte b[3];
+    if (f[1].kind == EMIT_BC_FUSE_FAST) {
+        b[0] = MP_BC_LOAD_FAST_FAST_BINARY_OP;
+        b[1] = f[0].arg << 4 | f[1].arg;
+        b[2] = op;
+    } else {
+        b[0] = MP_BC_LOAD_FAST_INT_BINARY_OP;
+        b[1] = f[0].arg << 4 | f[1].arg >> 2;
+        b[2] = f[1].arg << 6 | op;
+    }
+    byte *c = emit_get_cur_to_write_bytecode(emit, 1);
+    if (emit->pass == MP_PASS_EMIT) {
+        memcpy(c - 2, b, 3);
+    }
+    emit_bc_fuse_reset(emit);
+    return true;
+}
+#endif
+
 void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->pass = pass;
     emit->stack_size = 0;
@@ -313,6 +459,16 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->scope = scope;
     emit->last_source_line_offset = 0;
     emit->last_source_line = 1;
+    #if MICROPY_OPT_SUPERINSTRUCTIONS
+    emit_bc_fuse_reset(emit);
+    #endif
+    #if MICROPY_COMP_PEEPHOLE
+    emit->last_op = 0;
+    emit->label_pending = EMIT_BC_NO_LABEL;
+    if (pass == MP_PASS_STACK_SIZE && emit->label_jump != NULL) {
+        memset(emit->label_jump, -1, emit->max_num_labels * sizeof(mp_uint_t));
+    }
+    #endif
     #ifndef NDEBUG
     // With debugging enabled labels are checked for unique assignment
     if (pass < MP_PASS_EMIT && emit->label_offsets != NULL) {
@@ -412,6 +568,11 @@ void mp_emit_bc_end_pass(emit_t *emit) {
     // check stack is back to zero size
     assert(emit->stack_size == 0);
 
+    #if MICROPY_COMP_PEEPHOLE
+    // labels at the very end aren't followed by a jump
+    emit_bc_label_pending_resolve(emit, EMIT_BC_NO_LABEL);
+    #endif
+
     emit_write_code_info_byte(emit, 0); // end of line number info
 
     #if MICROPY_PERSISTENT_CODE
@@ -498,6 +659,18 @@ void mp_emit_bc_label_assign(emit_t *emit, mp_uint_t l) {
         return;
     }
     assert(l < emit->max_num_labels);
+    #if MICROPY_OPT_SUPERINSTRUCTIONS
+    // code can jump here, so what's before can't be fused with what's after
+    emit_bc_fuse_reset(emit);
+    #endif
+    #if MICROPY_COMP_PEEPHOLE
+    emit->last_op = 0;
+    if (EMIT_BC_PEEPHOLE && emit->pass == MP_PASS_STACK_SIZE) {
+        // wait to see if an unconditional jump follows this label
+        emit->label_jump[l] = emit->label_pending;
+        emit->label_pending = l;
+    }
+    #endif
     if (emit->pass < MP_PASS_EMIT) {
         // assign label offset
         assert(emit->label_offsets[l] == (mp_uint_t)-1);
@@ -532,14 +705,19 @@ void mp_emit_bc_load_const_tok(emit_t *emit, mp_token_kind_t tok) {
         default:
             assert(tok == MP_TOKEN_ELLIPSIS);
             emit_write_bytecode_byte_obj(emit, MP_BC_LOAD_CONST_OBJ, MP_OBJ_FROM_PTR(&mp_const_ellipsis_obj));
-            break;
+            return;
     }
+    emit_bc_peephole_note(emit, MP_BC_LOAD_CONST_FALSE + (tok == MP_TOKEN_KW_NONE) + 2 * (tok == MP_TOKEN_KW_TRUE));
 }
 
 void mp_emit_bc_load_const_small_int(emit_t *emit, mp_int_t arg) {
     emit_bc_pre(emit, 1);
     if (-16 <= arg && arg <= 47) {
+        #if MICROPY_OPT_SUPERINSTRUCTIONS
+        emit_bc_fuse_push(emit, EMIT_BC_FUSE_INT, 16 + arg);
+        #endif
         emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 16 + arg);
+        emit_bc_peephole_note(emit, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 16 + arg);
     } else {
         emit_write_bytecode_byte_int(emit, MP_BC_LOAD_CONST_SMALL_INT, arg);
     }
@@ -566,6 +744,9 @@ void mp_emit_bc_load_local(emit_t *emit, qstr qst, mp_uint_t local_num, int kind
     (void)qst;
     emit_bc_pre(emit, 1);
     if (kind == MP_EMIT_IDOP_LOCAL_FAST && local_num <= 15) {
+        #if MICROPY_OPT_SUPERINSTRUCTIONS
+        emit_bc_fuse_push(emit, EMIT_BC_FUSE_FAST, local_num);
+        #endif
         emit_write_bytecode_byte(emit, MP_BC_LOAD_FAST_MULTI + local_num);
     } else {
         emit_write_bytecode_byte_uint(emit, MP_BC_LOAD_FAST_N + kind, local_num);
@@ -660,6 +841,7 @@ void mp_emit_bc_delete_global(emit_t *emit, qstr qst, int kind) {
 void mp_emit_bc_dup_top(emit_t *emit) {
     emit_bc_pre(emit, 1);
     emit_write_bytecode_byte(emit, MP_BC_DUP_TOP);
+    emit_bc_peephole_note(emit, MP_BC_DUP_TOP);
 }
 
 void mp_emit_bc_dup_top_two(emit_t *emit) {
@@ -669,6 +851,12 @@ void mp_emit_bc_dup_top_two(emit_t *emit) {
 
 void mp_emit_bc_pop_top(emit_t *emit) {
     emit_bc_pre(emit, -1);
+    #if MICROPY_COMP_PEEPHOLE
+    if (emit_bc_peephole_take(emit, MP_BC_DUP_TOP, MP_BC_DUP_TOP)) {
+        // DUP_TOP then POP_TOP does nothing
+        return;
+    }
+    #endif
     emit_write_bytecode_byte(emit, MP_BC_POP_TOP);
 }
 
@@ -684,11 +872,18 @@ void mp_emit_bc_rot_three(emit_t *emit) {
 
 void mp_emit_bc_jump(emit_t *emit, mp_uint_t label) {
     emit_bc_pre(emit, 0);
-    emit_write_bytecode_byte_signed_label(emit, MP_BC_JUMP, label);
+    #if MICROPY_COMP_PEEPHOLE
+    if (emit->label_pending != EMIT_BC_NO_LABEL) {
+        // jumps to the labels here can go straight to label
+        emit_bc_label_pending_resolve(emit, label);
+    }
+    #endif
+    emit_write_bytecode_byte_signed_label(emit, MP_BC_JUMP, emit_bc_thread_label(emit, label));
 }
 
 void mp_emit_bc_pop_jump_if(emit_t *emit, bool cond, mp_uint_t label) {
     emit_bc_pre(emit, -1);
+    label = emit_bc_thread_label(emit, label);
     if (cond) {
         emit_write_bytecode_byte_signed_label(emit, MP_BC_POP_JUMP_IF_TRUE, label);
     } else {
@@ -698,6 +893,7 @@ void mp_emit_bc_pop_jump_if(emit_t *emit, bool cond, mp_uint_t label) {
 
 void mp_emit_bc_jump_if_or_pop(emit_t *emit, bool cond, mp_uint_t label) {
     emit_bc_pre(emit, -1);
+    label = emit_bc_thread_label(emit, label);
     if (cond) {
         emit_write_bytecode_byte_signed_label(emit, MP_BC_JUMP_IF_TRUE_OR_POP, label);
     } else {
@@ -716,9 +912,9 @@ void mp_emit_bc_unwind_jump(emit_t *emit, mp_uint_t label, mp_uint_t except_dept
                 emit_write_bytecode_byte(emit, MP_BC_POP_TOP);
             }
         }
-        emit_write_bytecode_byte_signed_label(emit, MP_BC_JUMP, label & ~MP_EMIT_BREAK_FROM_FOR);
+        emit_write_bytecode_byte_signed_label(emit, MP_BC_JUMP, emit_bc_thread_label(emit, label & ~MP_EMIT_BREAK_FROM_FOR));
     } else {
-        emit_write_bytecode_byte_signed_label(emit, MP_BC_UNWIND_JUMP, label & ~MP_EMIT_BREAK_FROM_FOR);
+        emit_write_bytecode_byte_signed_label(emit, MP_BC_UNWIND_JUMP, emit_bc_thread_label(emit, label & ~MP_EMIT_BREAK_FROM_FOR));
         emit_write_bytecode_byte(emit, ((label & MP_EMIT_BREAK_FROM_FOR) ? 0x80 : 0) | except_depth);
     }
 }
@@ -771,6 +967,31 @@ void mp_emit_bc_pop_except_jump(emit_t *emit, mp_uint_t label, bool within_exc_h
 }
 
 void mp_emit_bc_unary_op(emit_t *emit, mp_unary_op_t op) {
+    #if MICROPY_COMP_PEEPHOLE
+    // fold `not` of True, False or None, and a unary op on a small int,
+    // into a constant
+    byte load = 0;
+    if (op == MP_UNARY_OP_NOT) {
+        load = emit_bc_peephole_take(emit, MP_BC_LOAD_CONST_FALSE, MP_BC_LOAD_CONST_TRUE);
+        if (load != 0) {
+            emit_bc_pre(emit, -1);
+            mp_emit_bc_load_const_tok(emit, load == MP_BC_LOAD_CONST_TRUE ? MP_TOKEN_KW_FALSE : MP_TOKEN_KW_TRUE);
+            return;
+        }
+    }
+    load = emit_bc_peephole_take(emit, MP_BC_LOAD_CONST_SMALL_INT_MULTI, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 63);
+    if (load != 0) {
+        mp_int_t arg = (mp_int_t)load - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16;
+        emit_bc_pre(emit, -1);
+        if (op == MP_UNARY_OP_NOT) {
+            mp_emit_bc_load_const_tok(emit, arg == 0 ? MP_TOKEN_KW_TRUE : MP_TOKEN_KW_FALSE);
+        } else {
+            mp_emit_bc_load_const_small_int(emit,
+                op == MP_UNARY_OP_NEGATIVE ? -arg : op == MP_UNARY_OP_INVERT ? ~arg : arg);
+        }
+        return;
+    }
+    #endif
     emit_bc_pre(emit, 0);
     emit_write_bytecode_byte(emit, MP_BC_UNARY_OP_MULTI + op);
 }
@@ -785,7 +1006,15 @@ void mp_emit_bc_binary_op(emit_t *emit, mp_binary_op_t op) {
         op = MP_BINARY_OP_IS;
     }
     emit_bc_pre(emit, -1);
-    emit_write_bytecode_byte(emit, MP_BC_BINARY_OP_MULTI + op);
+    #if MICROPY_OPT_SUPERINSTRUCTIONS
+    MP_STATIC_ASSERT(MP_BINARY_OP_NUM_BYTECODE <= 64);
+    if (MICROPY_OPT_SUPERINSTRUCTIONS_DYNAMIC && emit_bc_fuse_binary_op(emit, op)) {
+        // written together with the loads before it
+    } else
+    #endif
+    {
+        emit_write_bytecode_byte(emit, MP_BC_BINARY_OP_MULTI + op);
+    }
     if (invert) {
         emit_bc_pre(emit, 0);
         emit_write_bytecode_byte(emit, MP_BC_UNARY_OP_MULTI + MP_UNARY_OP_NOT);
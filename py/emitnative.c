@@ -48,6 +48,7 @@
 
 #include "py/emit.h"
 #include "py/bc.h"
+#include "py/persistentcode.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -134,6 +135,7 @@ typedef enum {
 
     VTYPE_UNBOUND = 0x60 | MP_NATIVE_TYPE_OBJ,
     VTYPE_BUILTIN_CAST = 0x70 | MP_NATIVE_TYPE_OBJ,
+    VTYPE_BUILTIN_DSP = 0x80 | MP_NATIVE_TYPE_OBJ,
 } vtype_kind_t;
 
 STATIC qstr vtype_to_qstr(vtype_kind_t vtype) {
@@ -214,6 +216,56 @@ struct _emit_t {
 
 STATIC const uint8_t reg_local_table[REG_LOCAL_NUM] = {REG_LOCAL_1, REG_LOCAL_2, REG_LOCAL_3};
 
+#if N_THUMB
+// Viper functions on Thumb keep the next locals in r8-r11.  Most instructions
+// can't take these as operands, so a value in one of them is moved to a low
+// register before it's used, which is still cheaper than a load from memory.
+#define REG_LOCAL_HI_NUM (4)
+#define REG_CAN_BE_OPERAND(reg) ((reg) < ASM_THUMB_REG_R8)
+STATIC const uint8_t reg_local_hi_table[REG_LOCAL_HI_NUM] = {ASM_THUMB_REG_R8, ASM_THUMB_REG_R9, ASM_THUMB_REG_R10, ASM_THUMB_REG_R11};
+#define CAN_USE_HI_REGS_FOR_LOCALS(emit) ((emit)->do_viper_types && CAN_USE_REGS_FOR_LOCALS(emit))
+#define LOCAL_IS_IN_HI_REG(emit, local_num) ((local_num) >= REG_LOCAL_NUM && (local_num) < REG_LOCAL_NUM + REG_LOCAL_HI_NUM && CAN_USE_HI_REGS_FOR_LOCALS(emit))
+#define REG_LOCAL_HI(local_num) (reg_local_hi_table[(local_num) - REG_LOCAL_NUM])
+#else
+#define REG_CAN_BE_OPERAND(reg) (true)
+#define LOCAL_IS_IN_HI_REG(emit, local_num) (false)
+#define REG_LOCAL_HI(local_num) (0)
+#endif
+
+#if N_THUMB
+// Whether the target has the ARMv7E-M DSP instructions
+#if MICROPY_DYNAMIC_COMPILER
+#define N_THUMB_DSP (mp_dynamic_compiler.native_arch >= MP_NATIVE_ARCH_ARMV7EM)
+#elif defined(__ARM_FEATURE_DSP)
+#define N_THUMB_DSP (1)
+#else
+#define N_THUMB_DSP (0)
+#endif
+
+// Viper builtins that each compile to one DSP instruction, working on the
+// bytes or halfwords packed in an int.  ops with 2 args are of the form
+// "op rd, rn, rm"; smlad and usat are done separately.
+typedef struct _dsp_builtin_t {
+    uint16_t qst;
+    uint8_t n_args;
+    uint8_t vtype;
+    uint32_t op;
+} dsp_builtin_t;
+
+STATIC const dsp_builtin_t dsp_builtin_table[] = {
+    { MP_QSTR_uadd8, 2, VTYPE_UINT, ASM_THUMB_OP_UADD8 },
+    { MP_QSTR_usub8, 2, VTYPE_UINT, ASM_THUMB_OP_USUB8 },
+    { MP_QSTR_uqadd8, 2, VTYPE_UINT, ASM_THUMB_OP_UQADD8 },
+    { MP_QSTR_uqsub8, 2, VTYPE_UINT, ASM_THUMB_OP_UQSUB8 },
+    { MP_QSTR_uhadd8, 2, VTYPE_UINT, ASM_THUMB_OP_UHADD8 },
+    { MP_QSTR_uqadd16, 2, VTYPE_UINT, ASM_THUMB_OP_UQADD16 },
+    { MP_QSTR_qadd16, 2, VTYPE_INT, ASM_THUMB_OP_QADD16 },
+    { MP_QSTR_sel, 2, VTYPE_UINT, ASM_THUMB_OP_SEL },
+    { MP_QSTR_smlad, 3, VTYPE_INT, 0 },
+    { MP_QSTR_usat, 2, VTYPE_UINT, 0 },
+};
+#endif
+
 STATIC void emit_native_global_exc_entry(emit_t *emit);
 STATIC void emit_native_global_exc_exit(emit_t *emit);
 STATIC void emit_native_load_const_obj(emit_t *emit, mp_obj_t obj);
@@ -395,7 +447,14 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         }
 
         // Entry to function
-        ASM_ENTRY(emit->as, emit->stack_start + emit->n_state - num_locals_in_regs);
+        #if N_THUMB
+        if (CAN_USE_HI_REGS_FOR_LOCALS(emit) && scope->num_locals > REG_LOCAL_NUM) {
+            asm_thumb_entry_save_hi(emit->as, emit->stack_start + emit->n_state - num_locals_in_regs);
+        } else
+        #endif
+        {
+            ASM_ENTRY(emit->as, emit->stack_start + emit->n_state - num_locals_in_regs);
+        }
 
         #if N_X86
         asm_x86_mov_arg_to_r32(emit->as, 0, REG_ARG_1);
@@ -441,6 +500,8 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
             // REG_LOCAL_3 points to the args array so be sure not to overwrite it if it's still needed
             if (i < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit) && (i != 2 || emit->scope->num_pos_args == 3)) {
                 ASM_MOV_REG_REG(emit->as, reg_local_table[i], r);
+            } else if (LOCAL_IS_IN_HI_REG(emit, i)) {
+                ASM_MOV_REG_REG(emit->as, REG_LOCAL_HI(i), r);
             } else {
                 emit_native_mov_state_reg(emit, LOCAL_IDX_LOCAL_VAR(emit, i), r);
             }
@@ -824,7 +885,8 @@ STATIC void emit_fold_stack_top(emit_t *emit, int reg_dest) {
 STATIC void emit_pre_pop_reg_flexible(emit_t *emit, vtype_kind_t *vtype, int *reg_dest, int not_r1, int not_r2) {
     emit->last_emit_was_return_value = false;
     stack_info_t *si = peek_stack(emit, 0);
-    if (si->kind == STACK_REG && si->data.u_reg != not_r1 && si->data.u_reg != not_r2) {
+    if (si->kind == STACK_REG && si->data.u_reg != not_r1 && si->data.u_reg != not_r2
+        && REG_CAN_BE_OPERAND(si->data.u_reg)) {
         *vtype = si->vtype;
         *reg_dest = si->data.u_reg;
         need_reg_single(emit, *reg_dest, 1);
@@ -1321,6 +1383,8 @@ STATIC void emit_native_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     emit_native_pre(emit);
     if (local_num < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit)) {
         emit_post_push_reg(emit, vtype, reg_local_table[local_num]);
+    } else if (LOCAL_IS_IN_HI_REG(emit, local_num)) {
+        emit_post_push_reg(emit, vtype, REG_LOCAL_HI(local_num));
     } else {
         need_reg_single(emit, REG_TEMP0, 0);
         emit_native_mov_reg_state(emit, REG_TEMP0, LOCAL_IDX_LOCAL_VAR(emit, local_num));
@@ -1363,6 +1427,16 @@ STATIC void emit_native_load_global(emit_t *emit, qstr qst, int kind) {
                 emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, native_type);
                 return;
             }
+            #if N_THUMB
+            if (N_THUMB_DSP) {
+                for (size_t i = 0; i < MP_ARRAY_SIZE(dsp_builtin_table); ++i) {
+                    if (dsp_builtin_table[i].qst == qst) {
+                        emit_post_push_imm(emit, VTYPE_BUILTIN_DSP, i);
+                        return;
+                    }
+                }
+            }
+            #endif
         }
     }
     emit_call_with_qstr_arg(emit, MP_F_LOAD_NAME + kind, qst, REG_ARG_1);
@@ -1540,6 +1614,14 @@ STATIC void emit_native_store_fast(emit_t *emit, qstr qst, mp_uint_t local_num)
     vtype_kind_t vtype;
     if (local_num < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit)) {
         emit_pre_pop_reg(emit, &vtype, reg_local_table[local_num]);
+    } else if (LOCAL_IS_IN_HI_REG(emit, local_num)) {
+        // go via a low register, because a high one can't be loaded directly
+        // from an immediate or a const; anything stacked that's still in the
+        // high register has to be saved before it's overwritten
+        int reg_src = REG_TEMP0;
+        emit_pre_pop_reg_flexible(emit, &vtype, &reg_src, -1, -1);
+        need_reg_single(emit, REG_LOCAL_HI(local_num), 0);
+        ASM_MOV_REG_REG(emit->as, REG_LOCAL_HI(local_num), reg_src);
     } else {
         emit_pre_pop_reg(emit, &vtype, REG_TEMP0);
         emit_native_mov_state_reg(emit, LOCAL_IDX_LOCAL_VAR(emit, local_num), REG_TEMP0);
@@ -2501,6 +2583,52 @@ STATIC void emit_native_make_closure(emit_t *emit, scope_t *scope, mp_uint_t n_c
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
+#if N_THUMB
+STATIC void emit_native_call_dsp_builtin(emit_t *emit, mp_uint_t n_positional, mp_uint_t n_keyword, mp_uint_t star_flags) {
+    const dsp_builtin_t *b = &dsp_builtin_table[peek_stack(emit, n_positional + 2 * n_keyword)->data.u_imm];
+    if (n_positional != b->n_args || n_keyword != 0 || star_flags) {
+        EMIT_NATIVE_VIPER_TYPE_ERROR(emit, "%q() takes %d positional args", b->qst, b->n_args);
+        adjust_stack(emit, -(mp_int_t)(n_positional + 2 * n_keyword + 1 + (star_flags ? 2 : 0)));
+        emit_post_push_imm(emit, b->vtype, 0);
+        return;
+    }
+    bool bad_sat_bits = false;
+    mp_uint_t sat_bits = 0;
+    if (b->qst == MP_QSTR_usat) {
+        // the number of bits is part of the instruction
+        stack_info_t *top = peek_stack(emit, 0);
+        if (top->kind == STACK_IMM && top->vtype == VTYPE_INT && (mp_uint_t)top->data.u_imm <= 31) {
+            sat_bits = top->data.u_imm;
+        } else {
+            bad_sat_bits = true;
+        }
+        emit_pre_pop_discard(emit);
+        --n_positional;
+    }
+    vtype_kind_t vtype[3];
+    int reg[3] = {REG_ARG_1, REG_ARG_2, REG_ARG_3};
+    for (mp_uint_t i = n_positional; i-- > 0;) {
+        emit_pre_pop_reg(emit, &vtype[i], reg[i]);
+        if (vtype[i] != VTYPE_INT && vtype[i] != VTYPE_UINT) {
+            EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
+                "%q() can't take '%q'", b->qst, vtype_to_qstr(vtype[i]));
+        }
+    }
+    emit_pre_pop_discard(emit); // the builtin
+    if (b->qst == MP_QSTR_usat) {
+        if (bad_sat_bits) {
+            EMIT_NATIVE_VIPER_TYPE_ERROR(emit, "usat() needs a constant bit count 0-31");
+        }
+        asm_thumb_usat(emit->as, REG_RET, REG_ARG_1, sat_bits);
+    } else if (b->qst == MP_QSTR_smlad) {
+        asm_thumb_smlad(emit->as, REG_RET, REG_ARG_1, REG_ARG_2, REG_ARG_3);
+    } else {
+        asm_thumb_dsp_reg_reg_reg(emit->as, b->op, REG_RET, REG_ARG_1, REG_ARG_2);
+    }
+    emit_post_push_reg(emit, b->vtype, REG_RET);
+}
+#endif
+
 STATIC void emit_native_call_function(emit_t *emit, mp_uint_t n_positional, mp_uint_t n_keyword, mp_uint_t star_flags) {
     DEBUG_printf("call_function(n_pos=" UINT_FMT ", n_kw=" UINT_FMT ", star_flags=" UINT_FMT ")\n", n_positional, n_keyword, star_flags);
 
@@ -2539,6 +2667,10 @@ STATIC void emit_native_call_function(emit_t *emit, mp_uint_t n_positional, mp_u
                 // this can happen when casting a cast: int(int)
                 mp_raise_NotImplementedError("casting");
         }
+    #if N_THUMB
+    } else if (vtype_fun == VTYPE_BUILTIN_DSP) {
+        emit_native_call_dsp_builtin(emit, n_positional, n_keyword, star_flags);
+    #endif
     } else {
         assert(vtype_fun == VTYPE_PYOBJ);
         if (star_flags) {
@@ -0,0 +1,101 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/eventring.h"
+
+#if MICROPY_ENABLE_SCHEDULER
+
+void mp_event_ring_init(mp_event_ring_t *r, mp_obj_t drain, mp_obj_t drain_arg) {
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    r->iget = r->iput = 0;
+    r->pending = false;
+    r->lost = 0;
+    r->drain = drain;
+    r->drain_arg = drain_arg;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+STATIC void mp_event_ring_schedule(mp_event_ring_t *r) {
+    if (!r->pending && r->drain != MP_OBJ_NULL) {
+        // if the scheduler is full the next put tries again
+        r->pending = mp_sched_schedule(r->drain, r->drain_arg);
+    }
+}
+
+bool mp_event_ring_put(mp_event_ring_t *r, const void *item) {
+    uint16_t iput = r->iput;
+    uint16_t iput_new = iput + 1;
+    if (iput_new >= r->len) {
+        iput_new = 0;
+    }
+    bool ret = iput_new != r->iget;
+    // the atomic section orders the record's write before the index's, and
+    // keeps pending consistent with a take in progress
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    if (ret) {
+        memcpy(r->buf + iput * r->item_size, item, r->item_size);
+        r->iput = iput_new;
+    } else {
+        ++r->lost;
+    }
+    mp_event_ring_schedule(r);
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    return ret;
+}
+
+size_t mp_event_ring_take(mp_event_ring_t *r, void *dest, size_t max) {
+    // the producer doesn't touch the records between iget and iput, and the
+    // atomic section makes sure the records before iput are fully written
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint16_t iput = r->iput;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+
+    uint8_t *d = dest;
+    uint16_t iget = r->iget;
+    size_t n = 0;
+    for (; n < max && iget != iput; ++n) {
+        memcpy(d, r->buf + iget * r->item_size, r->item_size);
+        d += r->item_size;
+        if (++iget >= r->len) {
+            iget = 0;
+        }
+    }
+
+    atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    r->iget = iget;
+    if (iget == r->iput) {
+        // empty, so the next put needs to schedule the drain again; while
+        // events are left the running drain keeps taking them
+        r->pending = false;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    return n;
+}
+
+#endif // MICROPY_ENABLE_SCHEDULER
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_EVENTRING_H
+#define MICROPY_INCLUDED_PY_EVENTRING_H
+
+#include "py/obj.h"
+
+// A ring of fixed-size event records, put by one producer such as an IRQ
+// handler and taken by Python code.  The put that finds no drain pending
+// schedules the drain callback, so a burst of events takes one scheduler
+// slot however long it is, and events are only lost when the ring is full.
+//
+// The drain callback is called with drain_arg and should take events until
+// mp_event_ring_take returns 0.  Events put while it runs are taken by the
+// same call, and those put after the ring emptied schedule it again.
+// A drain of MP_OBJ_NULL only queues the events.  The ring doesn't keep drain
+// and drain_arg alive, so they must be reachable some other way, such as
+// from a root pointer, if they're on the heap.
+
+typedef struct _mp_event_ring_t {
+    uint8_t *buf; // len * item_size bytes
+    uint16_t item_size;
+    uint16_t len; // slots; one is kept free, so it holds len - 1 events
+    volatile uint16_t iget;
+    volatile uint16_t iput;
+    volatile bool pending; // the drain is scheduled or running and the ring isn't empty
+    uint32_t lost; // events dropped because the ring was full
+    mp_obj_t drain;
+    mp_obj_t drain_arg;
+} mp_event_ring_t;
+
+// Static initialization:
+// byte buf_array[N * sizeof(item)];
+// mp_event_ring_t ring = {buf_array, sizeof(item), N};
+// then set drain and drain_arg with mp_event_ring_init
+
+void mp_event_ring_init(mp_event_ring_t *r, mp_obj_t drain, mp_obj_t drain_arg);
+
+// Called by the producer, which mustn't be preempted by another producer.
+// Returns false if the ring was full and the event was dropped.
+bool mp_event_ring_put(mp_event_ring_t *r, const void *item);
+
+// Called by the consumer.  Copies up to max events into dest and returns
+// how many were copied.
+size_t mp_event_ring_take(mp_event_ring_t *r, void *dest, size_t max);
+
+static inline size_t mp_event_ring_count(const mp_event_ring_t *r) {
+    return (r->iput + r->len - r->iget) % r->len;
+}
+
+#endif // MICROPY_INCLUDED_PY_EVENTRING_H
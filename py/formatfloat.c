@@ -28,6 +28,7 @@
 #if MICROPY_FLOAT_IMPL != MICROPY_FLOAT_IMPL_NONE
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <math.h>
@@ -74,6 +75,15 @@ static inline int fp_signbit(float x) { union floatbits fb = {x}; return fb.u &
 static inline int fp_iszero(float x) { union floatbits fb = {x}; return fb.u == 0; }
 static inline int fp_isless1(float x) { union floatbits fb = {x}; return fb.u < 0x3f800000; }
 
+#define FPMANT_BITS 23
+#define FPEXP_BIAS 127
+#define FPPOW10_EXACT_MAX 10 // 5^10 < 2^24
+#define FPDD_EXP_MAX 28 // so scaling to and from decimal won't overflow
+#define FPFIX_BITS 28 // 10 << FPFIX_BITS fits in 32 bits
+#define FPSPLIT 4097.0F // 2^12 + 1
+static inline mp_float_bits_t fp_bits(float x) { union floatbits fb = {x}; return fb.u; }
+static inline float fp_from_bits(mp_float_bits_t u) { union floatbits fb = {.u = u}; return fb.f; }
+
 #elif MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
 
 #define FPTYPE double
@@ -87,6 +97,19 @@ static inline int fp_isless1(float x) { union floatbits fb = {x}; return fb.u <
 #define fp_iszero(x) (x == 0)
 #define fp_isless1(x) (x < 1.0)
 
+union doublebits {
+    double f;
+    uint64_t u;
+};
+#define FPMANT_BITS 52
+#define FPEXP_BIAS 1023
+#define FPPOW10_EXACT_MAX 22 // 5^22 < 2^53
+#define FPDD_EXP_MAX 280 // so scaling to and from decimal won't overflow
+#define FPFIX_BITS 60 // 10 << FPFIX_BITS fits in 64 bits
+#define FPSPLIT 134217729.0 // 2^27 + 1
+static inline mp_float_bits_t fp_bits(double x) { union doublebits db = {x}; return db.u; }
+static inline double fp_from_bits(mp_float_bits_t u) { union doublebits db = {.u = u}; return db.f; }
+
 #endif
 
 static const FPTYPE g_pos_pow[] = {
@@ -102,6 +125,119 @@ static const FPTYPE g_neg_pow[] = {
     1e-32, 1e-16, 1e-8, 1e-4, 1e-2, 1e-1
 };
 
+#if MICROPY_OPT_FAST_FLOAT
+// Powers of 10 that can be stored exactly
+static const FPTYPE g_pow10_exact[FPPOW10_EXACT_MAX + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    #if FPPOW10_EXACT_MAX > 10
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    #endif
+};
+
+// Compute a * b exactly as *hi + *lo (Dekker's product)
+static void fp_two_prod(FPTYPE a, FPTYPE b, FPTYPE *hi, FPTYPE *lo) {
+    FPTYPE c = FPSPLIT * a;
+    FPTYPE ah = c - (c - a);
+    FPTYPE al = a - ah;
+    c = FPSPLIT * b;
+    FPTYPE bh = c - (c - b);
+    FPTYPE bl = b - bh;
+    *hi = a * b;
+    *lo = ((ah * bh - *hi) + ah * bl + al * bh) + al * bl;
+}
+
+// Multiply *hi + *lo by 10^k, keeping about twice the precision of FPTYPE
+// between them, with *lo less than an ulp of *hi when done
+static void fp_scale_pow10(FPTYPE *hi, FPTYPE *lo, int k) {
+    FPTYPE x = *hi;
+    FPTYPE y = *lo;
+    while (k != 0) {
+        int n = k < 0 ? -k : k;
+        if (n > FPPOW10_EXACT_MAX) {
+            n = FPPOW10_EXACT_MAX;
+        }
+        FPTYPE p = g_pow10_exact[n];
+        FPTYPE h, l;
+        if (k < 0) {
+            // x - h is exact as they're so close
+            FPTYPE q = x / p;
+            fp_two_prod(q, p, &h, &l);
+            y = (((x - h) - l) + y) / p;
+            x = q;
+            k += n;
+        } else {
+            fp_two_prod(x, p, &h, &l);
+            y = l + y * p;
+            x = h;
+            k -= n;
+        }
+    }
+    *hi = x + y;
+    *lo = y - (*hi - x);
+}
+
+bool mp_float_from_decimal(mp_float_bits_t dig, int exp, FPTYPE *res) {
+    // Scaling up, exp is limited so the products can't overflow.  Scaling
+    // down, the limit is on the decimal exponent of the result, which just has
+    // to stay clear of subnormals, so long strings of digits are still exact.
+    int res_exp = exp;
+    for (mp_float_bits_t t = dig; t >= 10; t /= 10) {
+        ++res_exp;
+    }
+    if (res_exp < -FPDD_EXP_MAX || exp > FPDD_EXP_MAX || dig >> (sizeof(dig) * 8 - 1) != 0) {
+        return false;
+    }
+    FPTYPE d = (FPTYPE)dig;
+    if (dig < (mp_float_bits_t)1 << (FPMANT_BITS + 1) && -FPPOW10_EXACT_MAX <= exp && exp <= FPPOW10_EXACT_MAX) {
+        // both are exact, so one multiply or divide rounds correctly
+        d = exp < 0 ? d / g_pow10_exact[-exp] : d * g_pow10_exact[exp];
+    } else {
+        // dig may not fit in d, but then the rest of it does
+        FPTYPE lo = (FPTYPE)(mp_float_sbits_t)(dig - (mp_float_bits_t)d);
+        fp_scale_pow10(&d, &lo, exp);
+    }
+    *res = d;
+    return true;
+}
+
+// Whether the decimal dig * 10^k is read back as f_orig
+static bool fp_digits_read_back(mp_float_bits_t dig, int k, FPTYPE f_orig) {
+    FPTYPE d;
+    return mp_float_from_decimal(dig, k, &d) && d == f_orig;
+}
+
+// The mantissa found by repeatedly scaling f has been rounded at each step.
+// Instead compute it straight from f_orig = *f * 10^exp10 as *f + *f_corr,
+// which between them hold it to about twice the precision, and the gap to the
+// next float after f_orig in the same units as *f_ulp.  The scaling may have
+// been a power of 10 out, so this returns the corrected exp10.
+static int fp_renormalise(FPTYPE *f, FPTYPE *f_corr, FPTYPE *f_ulp, FPTYPE f_orig, int exp10) {
+    for (int tries = 0; tries < 2; ++tries) {
+        FPTYPE hi = f_orig;
+        FPTYPE lo = FPCONST(0.0);
+        fp_scale_pow10(&hi, &lo, -exp10);
+        if (hi == FPCONST(10.0) && lo < FPCONST(0.0)) {
+            // just below 10, which hi has rounded up to
+            FPTYPE below = fp_from_bits(fp_bits(hi) - 1);
+            lo += hi - below;
+            hi = below;
+        }
+        if (hi < FPCONST(1.0) || (hi == FPCONST(1.0) && lo < FPCONST(0.0))) {
+            exp10 -= 1;
+        } else if (hi >= FPCONST(10.0)) {
+            exp10 += 1;
+        } else {
+            FPTYPE ulp = fp_from_bits(fp_bits(f_orig) + 1) - f_orig;
+            *f = hi;
+            *f_corr = lo;
+            *f_ulp = ulp * (hi / f_orig);
+            break;
+        }
+    }
+    return exp10;
+}
+#endif
+
 int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, char sign) {
 
     char *s = buf;
@@ -128,6 +264,14 @@ int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, ch
         }
     }
 
+    #if MICROPY_OPT_FAST_FLOAT
+    FPTYPE f_orig = f;
+    FPTYPE f_corr = FPCONST(0.0);
+    FPTYPE f_ulp = FPCONST(0.0);
+    int f_exp10 = 0;
+    bool shortest = fmt == 'r';
+    #endif
+
     // buf_remaining contains bytes available for digits and exponent.
     // It is buf_size minus room for the sign and null byte.
     int buf_remaining = buf_size - 1 - (s - buf);
@@ -152,6 +296,9 @@ int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, ch
     if (prec < 0) {
         prec = 6;
     }
+    if (fmt == 'r') {
+        fmt = 'g';
+    }
     char e_char = 'E' | (fmt & 0x20);   // e_char will match case of fmt
     fmt |= 0x20; // Force fmt to be lowercase
     char org_fmt = fmt;
@@ -188,9 +335,12 @@ int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, ch
         // As we just tested number to be <1, this is obviously 0,
         // but we can round it up to 1 below.
         char first_dig = '0';
+        #if !MICROPY_OPT_FAST_FLOAT
+        // with the fast path the exact digits are rounded instead, below
         if (f >= FPROUND_TO_ONE) {
             first_dig = '1';
         }
+        #endif
 
         // Build negative exponent
         for (e = 0, e1 = FPDECEXP; e1; e1 >>= 1, pos_pow++, neg_pow++) {
@@ -200,6 +350,18 @@ int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, ch
             }
         }
         char e_sign_char = '-';
+        #if MICROPY_OPT_FAST_FLOAT
+        if (e < FPDD_EXP_MAX) {
+            // Take the digits exactly from f_orig; if they're all 9s up to
+            // the precision, rounding them below carries into a new digit
+            if (fp_isless1(f)) {
+                e++;
+                f *= FPCONST(10.0);
+            }
+            e = -fp_renormalise(&f, &f_corr, &f_ulp, f_orig, -e);
+            f_exp10 = -e;
+        } else
+        #endif
         if (fp_isless1(f) && f >= FPROUND_TO_ONE) {
             f = FPCONST(1.0);
             if (e == 0) {
@@ -262,6 +424,12 @@ int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, ch
             e += 1;
             f *= FPCONST(0.1);
         }
+        #if MICROPY_OPT_FAST_FLOAT
+        if (e <= FPDD_EXP_MAX) {
+            e = fp_renormalise(&f, &f_corr, &f_ulp, f_orig, e);
+            f_exp10 = e;
+        }
+        #endif
 
         // If the user specified fixed format (fmt == 'f') and e makes the
         // number too big to fit into the available buffer, then we'll
@@ -327,19 +495,106 @@ int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, ch
         num_digits = prec;
     }
 
-    // Print the digits of the mantissa
-    for (int i = 0; i < num_digits; ++i, --dec) {
-        int32_t d = (int32_t)f;
-        if (d < 0) {
-            *s++ = '0';
-        } else {
+    #if MICROPY_OPT_FAST_FLOAT
+    if (f >= FPCONST(1.0) && f < FPCONST(10.0)) {
+        // Take the digits from the mantissa as a fixed-point integer with
+        // FPFIX_BITS below the point, enough for f_corr to be added too.
+        // Multiplying its fraction by 10 can't overflow, and unlike
+        // multiplying f by 10 no bits are lost.
+        mp_float_bits_t u = fp_bits(f);
+        mp_float_bits_t one = (mp_float_bits_t)1 << FPFIX_BITS;
+        mp_float_bits_t frac = ((u & (((mp_float_bits_t)1 << FPMANT_BITS) - 1)) | ((mp_float_bits_t)1 << FPMANT_BITS))
+            << (FPFIX_BITS - FPMANT_BITS + (int)((u >> FPMANT_BITS) - FPEXP_BIAS));
+        mp_float_bits_t corr = (mp_float_bits_t)(mp_int_t)(f_corr * (FPTYPE)one);
+        if ((frac + corr) >> FPFIX_BITS >= 1 && (frac + corr) >> FPFIX_BITS <= 9) {
+            frac += corr;
+        }
+
+        // For the shortest digits, stop as soon as rounding the digits so far
+        // down or up gives a value that reads back as f_orig.  That is when
+        // it's nearer to f_orig than to the floats either side, which are
+        // half an ulp away (a quarter below a power of 2).  Within 1/16 of
+        // that margin f_corr isn't precise enough to tell, so then check by
+        // reading the value back.  One more digit than prec may be needed.
+        mp_float_bits_t lo_margin = 0;
+        mp_float_bits_t hi_margin = 0;
+        if (shortest && f_ulp > FPCONST(0.0)
+            && (s - buf) + num_digits + 1 + 1 + FPMIN_BUF_SIZE < (int)buf_size) {
+            hi_margin = (mp_float_bits_t)(f_ulp * (FPTYPE)one * FPCONST(0.53125));
+            lo_margin = hi_margin;
+            if ((fp_bits(f_orig) & (((mp_float_bits_t)1 << FPMANT_BITS) - 1)) == 0) {
+                lo_margin /= 2;
+            }
+            num_digits += 1;
+            prec += 1;
+        }
+        mp_float_bits_t dig = 0;
+        bool all_nines = true;
+        bool carry = false;
+
+        mp_float_bits_t mask = one - 1;
+        for (int i = 0; i < num_digits; ++i, --dec) {
+            int d = carry ? 9 : (int)(frac >> FPFIX_BITS);
             *s++ = '0' + d;
+            if (dec == 0 && prec > 0) {
+                *s++ = '.';
+            }
+            dig = dig * 10 + d;
+            all_nines &= d == 9;
+            frac &= mask;
+            bool down = frac < lo_margin
+                && (frac < lo_margin - lo_margin / 8 || fp_digits_read_back(dig, f_exp10 - i, f_orig));
+            bool up = one - frac < hi_margin
+                && (one - frac < hi_margin - hi_margin / 8 || fp_digits_read_back(dig + 1, f_exp10 - i, f_orig));
+            if (up && down) {
+                // both read back, so take the nearest, or the even one if a tie
+                up = frac > one / 2 || (frac == one / 2 && (d & 1));
+                down = !up;
+            }
+            if (up && all_nines) {
+                // Rounding up carries into a new leading digit, which the
+                // rounding below does, so make the rest of the digits 9s
+                // and round them up there
+                carry = true;
+                frac = lo_margin = hi_margin = 0;
+            } else if (down || up) {
+                if (up) {
+                    char *rs = s;
+                    while (*--rs == '9' || *rs == '.') {
+                        if (*rs == '9') {
+                            *rs = '0';
+                        }
+                    }
+                    (*rs)++;
+                }
+                // the rest of the digits are 0
+                frac = lo_margin = hi_margin = 0;
+            }
+            frac *= 10;
+            // once a margin is above one it's certain to stop at the next
+            // digit, so cap it rather than let it overflow
+            lo_margin = lo_margin > one ? 2 * one : lo_margin * 10;
+            hi_margin = hi_margin > one ? 2 * one : hi_margin * 10;
         }
-        if (dec == 0 && prec > 0) {
-            *s++ = '.';
+        // the next digit is used to round by, below
+        f = carry ? FPCONST(9.0) : (FPTYPE)(int)(frac >> FPFIX_BITS);
+    } else
+    #endif
+    {
+        // Print the digits of the mantissa
+        for (int i = 0; i < num_digits; ++i, --dec) {
+            int32_t d = (int32_t)f;
+            if (d < 0) {
+                *s++ = '0';
+            } else {
+                *s++ = '0' + d;
+            }
+            if (dec == 0 && prec > 0) {
+                *s++ = '.';
+            }
+            f -= (FPTYPE)d;
+            f *= FPCONST(10.0);
         }
-        f -= (FPTYPE)d;
-        f *= FPCONST(10.0);
     }
 
     // Round
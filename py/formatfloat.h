@@ -26,10 +26,27 @@
 #ifndef MICROPY_INCLUDED_PY_FORMATFLOAT_H
 #define MICROPY_INCLUDED_PY_FORMATFLOAT_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "py/mpconfig.h"
 
 #if MICROPY_PY_BUILTINS_FLOAT
 int mp_format_float(mp_float_t f, char *buf, size_t bufSize, char fmt, int prec, char sign);
+
+// Integers as wide as mp_float_t
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+typedef uint32_t mp_float_bits_t;
+typedef int32_t mp_float_sbits_t;
+#else
+typedef uint64_t mp_float_bits_t;
+typedef int64_t mp_float_sbits_t;
+#endif
+
+#if MICROPY_OPT_FAST_FLOAT
+// Convert the decimal dig * 10^exp to the nearest float in *res, returning
+// false if the result is too far out of range to do that accurately
+bool mp_float_from_decimal(mp_float_bits_t dig, int exp, mp_float_t *res);
+#endif
 #endif
 
 #endif // MICROPY_INCLUDED_PY_FORMATFLOAT_H
@@ -31,6 +31,10 @@
 
 #include "py/gc.h"
 #include "py/runtime.h"
+#include "py/bc.h"
+#if MICROPY_GC_STATS
+#include "py/mphal.h"
+#endif
 
 #if MICROPY_ENABLE_GC
 
@@ -75,26 +79,43 @@
 #define ATB_3_IS_FREE(a) (((a) & ATB_MASK_3) == 0)
 
 #define BLOCK_SHIFT(block) (2 * ((block) & (BLOCKS_PER_ATB - 1)))
-#define ATB_GET_KIND(block) ((MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
-#define ATB_ANY_TO_FREE(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
-#define ATB_FREE_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
-#define ATB_FREE_TO_TAIL(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
-#define ATB_HEAD_TO_MARK(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
-#define ATB_MARK_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
-
-#define BLOCK_FROM_PTR(ptr) (((byte*)(ptr) - MP_STATE_MEM(gc_pool_start)) / BYTES_PER_BLOCK)
-#define PTR_FROM_BLOCK(block) (((block) * BYTES_PER_BLOCK + (uintptr_t)MP_STATE_MEM(gc_pool_start)))
+#define ATB_GET_KIND(area, block) (((area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
+#define ATB_ANY_TO_FREE(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
+#define ATB_FREE_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
+#define ATB_FREE_TO_TAIL(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
+#define ATB_HEAD_TO_MARK(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
+#define ATB_MARK_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
+
+#if MICROPY_GC_INCREMENTAL
+// the heads ahead of a pending sweep are marked
+#define ATB_IS_HEAD(area, block) (ATB_GET_KIND(area, block) == AT_HEAD || ATB_GET_KIND(area, block) == AT_MARK)
+#define GC_SWEEP_STEP_BLOCKS (32)
+#else
+#define ATB_IS_HEAD(area, block) (ATB_GET_KIND(area, block) == AT_HEAD)
+#endif
+
+#define BLOCK_FROM_PTR(area, ptr) (((byte*)(ptr) - (area)->gc_pool_start) / BYTES_PER_BLOCK)
+#define PTR_FROM_BLOCK(area, block) (((block) * BYTES_PER_BLOCK + (uintptr_t)(area)->gc_pool_start))
 #define ATB_FROM_BLOCK(bl) ((bl) / BLOCKS_PER_ATB)
 
+// the number of blocks in the area's pool
+#define AREA_BLOCKS(area) ((area)->gc_alloc_table_byte_len * BLOCKS_PER_ATB)
+
+#if MICROPY_GC_SPLIT_HEAP
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define NEXT_AREA(area) (NULL)
+#endif
+
 #if MICROPY_ENABLE_FINALISER
 // FTB = finaliser table byte
 // if set, then the corresponding block may have a finaliser
 
 #define BLOCKS_PER_FTB (8)
 
-#define FTB_GET(block) ((MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
-#define FTB_SET(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
-#define FTB_CLEAR(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#define FTB_GET(area, block) (((area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
+#define FTB_SET(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
+#define FTB_CLEAR(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
 #endif
 
 #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
@@ -105,8 +126,55 @@
 #define GC_EXIT()
 #endif
 
+#if MICROPY_GC_FREE_LISTS
+#define GC_FREE_LIST_CLASSES (4)
+
+// Remember a free run of n_blocks blocks, if there's room
+STATIC void gc_free_list_push(mp_state_mem_area_t *area, size_t block, size_t n_blocks) {
+    uint16_t *len = &area->gc_free_list_len[n_blocks - 1];
+    if (*len < MICROPY_GC_FREE_LISTS) {
+        area->gc_free_list[n_blocks - 1][(*len)++] = block;
+    }
+}
+
+// Take a free run of n_blocks blocks from the lists, splitting a longer run
+// if there's none of that length.  Entries go stale when their blocks are
+// allocated by a scan or a realloc, so each is checked as it's popped.
+// Returns the start block, or (size_t)-1 if none was found.
+STATIC size_t gc_free_list_pop(mp_state_mem_area_t *area, size_t n_blocks) {
+    for (size_t c = n_blocks; c <= GC_FREE_LIST_CLASSES; c++) {
+        uint16_t *len = &area->gc_free_list_len[c - 1];
+        while (*len > 0) {
+            size_t block = area->gc_free_list[c - 1][--(*len)];
+            size_t n = 0;
+            while (n < c && ATB_GET_KIND(area, block + n) == AT_FREE) {
+                n++;
+            }
+            if (n < c) {
+                continue; // stale
+            }
+            if (c > n_blocks) {
+                gc_free_list_push(area, block + n_blocks, c - n_blocks);
+            }
+            return block;
+        }
+    }
+    return (size_t)-1;
+}
+
+// Blocks from the given ATB of the area on have been freed, so a scan for a
+// run of any length has to start there
+STATIC void gc_free_run_lower(mp_state_mem_area_t *area, size_t atb) {
+    for (size_t c = 0; c < GC_FREE_LIST_CLASSES; c++) {
+        if (area->gc_free_run_atb_index[c] > atb) {
+            area->gc_free_run_atb_index[c] = atb;
+        }
+    }
+}
+#endif
+
 // TODO waste less memory; currently requires that all entries in alloc_table have a corresponding block in pool
-void gc_init(void *start, void *end) {
+STATIC void gc_setup_area(mp_state_mem_area_t *area, void *start, void *end) {
     // align end pointer on block boundary
     end = (void*)((uintptr_t)end & (~(BYTES_PER_BLOCK - 1)));
     DEBUG_printf("Initializing GC heap: %p..%p = " UINT_FMT " bytes\n", start, end, (byte*)end - (byte*)start);
@@ -118,36 +186,62 @@ void gc_init(void *start, void *end) {
     // => T = A * (1 + BLOCKS_PER_ATB / BLOCKS_PER_FTB + BLOCKS_PER_ATB * BYTES_PER_BLOCK)
     size_t total_byte_len = (byte*)end - (byte*)start;
 #if MICROPY_ENABLE_FINALISER
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
+    area->gc_alloc_table_byte_len = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
 #else
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
+    area->gc_alloc_table_byte_len = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
 #endif
 
-    MP_STATE_MEM(gc_alloc_table_start) = (byte*)start;
+    area->gc_alloc_table_start = (byte*)start;
 
 #if MICROPY_ENABLE_FINALISER
-    size_t gc_finaliser_table_byte_len = (MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
-    MP_STATE_MEM(gc_finaliser_table_start) = MP_STATE_MEM(gc_alloc_table_start) + MP_STATE_MEM(gc_alloc_table_byte_len);
+    size_t gc_finaliser_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
+    area->gc_finaliser_table_start = area->gc_alloc_table_start + area->gc_alloc_table_byte_len;
 #endif
 
-    size_t gc_pool_block_len = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
-    MP_STATE_MEM(gc_pool_start) = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
-    MP_STATE_MEM(gc_pool_end) = end;
+    size_t gc_pool_block_len = AREA_BLOCKS(area);
+    area->gc_pool_start = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
+    area->gc_pool_end = end;
 
 #if MICROPY_ENABLE_FINALISER
-    assert(MP_STATE_MEM(gc_pool_start) >= MP_STATE_MEM(gc_finaliser_table_start) + gc_finaliser_table_byte_len);
+    assert(area->gc_pool_start >= area->gc_finaliser_table_start + gc_finaliser_table_byte_len);
 #endif
 
     // clear ATBs
-    memset(MP_STATE_MEM(gc_alloc_table_start), 0, MP_STATE_MEM(gc_alloc_table_byte_len));
+    memset(area->gc_alloc_table_start, 0, area->gc_alloc_table_byte_len);
 
 #if MICROPY_ENABLE_FINALISER
     // clear FTBs
-    memset(MP_STATE_MEM(gc_finaliser_table_start), 0, gc_finaliser_table_byte_len);
+    memset(area->gc_finaliser_table_start, 0, gc_finaliser_table_byte_len);
 #endif
 
     // set last free ATB index to start of heap
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    area->gc_last_free_atb_index = 0;
+
+    #if MICROPY_GC_FREE_LISTS
+    memset(area->gc_free_list_len, 0, sizeof(area->gc_free_list_len));
+    memset(area->gc_free_run_atb_index, 0, sizeof(area->gc_free_run_atb_index));
+    #endif
+
+    #if MICROPY_GC_SPLIT_HEAP
+    area->next = NULL;
+    #endif
+
+    DEBUG_printf("GC layout:\n");
+    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_alloc_table_start, area->gc_alloc_table_byte_len, AREA_BLOCKS(area));
+#if MICROPY_ENABLE_FINALISER
+    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_finaliser_table_start, gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
+#endif
+    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_pool_start, gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+}
+
+void gc_init(void *start, void *end) {
+    gc_setup_area(&MP_STATE_MEM(area), start, end);
+
+    #if MICROPY_GC_INCREMENTAL
+    MP_STATE_MEM(gc_sweep_pending) = 0;
+    MP_STATE_MEM(gc_sweep_lazy) = 0;
+    MP_STATE_MEM(gc_step_amount) = AREA_BLOCKS(&MP_STATE_MEM(area)) / 2;
+    #endif
 
     // unlock the GC
     MP_STATE_MEM(gc_lock_depth) = 0;
@@ -161,17 +255,56 @@ void gc_init(void *start, void *end) {
     MP_STATE_MEM(gc_alloc_amount) = 0;
     #endif
 
+    #if MICROPY_GC_PROFILE
+    MP_STATE_MEM(gc_profile_n) = 0;
+    MP_STATE_MEM(gc_profile_period) = 0;
+    #endif
+
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats_collections) = 0;
+    MP_STATE_MEM(gc_stats_pause_us_total) = 0;
+    MP_STATE_MEM(gc_stats_pause_us_max) = 0;
+    MP_STATE_MEM(gc_stats_bytes_allocated) = 0;
+    MP_STATE_MEM(gc_stats_blocks_freed) = 0;
+    #endif
+
+    #if MICROPY_GC_ARENA
+    MP_STATE_MEM(gc_arena_retired) = 0;
+    #endif
+
+    #if MICROPY_GC_THREAD_CACHE
+    // the thread state may not be set up yet, and this is the main thread
+    mp_state_ctx.thread.gc_cache_len = 0;
+    #endif
+
     #if MICROPY_PY_THREAD
     mp_thread_mutex_init(&MP_STATE_MEM(gc_mutex));
     #endif
+}
 
-    DEBUG_printf("GC layout:\n");
-    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_alloc_table_start), MP_STATE_MEM(gc_alloc_table_byte_len), MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-#if MICROPY_ENABLE_FINALISER
-    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_finaliser_table_start), gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
-#endif
-    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_pool_start), gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+#if MICROPY_GC_SPLIT_HEAP
+void gc_add(void *start, void *end) {
+    // the area's state goes at the start of the RAM, and its tables after
+    mp_state_mem_area_t *area = (mp_state_mem_area_t*)(((uintptr_t)start + sizeof(void*) - 1) & ~(sizeof(void*) - 1));
+    if ((byte*)end <= (byte*)(area + 1)) {
+        return;
+    }
+    gc_setup_area(area, area + 1, end);
+    if (AREA_BLOCKS(area) == 0) {
+        return;
+    }
+
+    // chain it after the other areas; a pending sweep reaches it last, and
+    // only finds blocks allocated since, which are marked
+    GC_ENTER();
+    mp_state_mem_area_t *prev = &MP_STATE_MEM(area);
+    while (prev->next != NULL) {
+        prev = prev->next;
+    }
+    prev->next = area;
+    GC_EXIT();
 }
+#endif
 
 void gc_lock(void) {
     GC_ENTER();
@@ -189,12 +322,100 @@ bool gc_is_locked(void) {
     return MP_STATE_MEM(gc_lock_depth) != 0;
 }
 
+// Return the area whose pool ptr points to a block of, or NULL if it's not
+// a heap pointer
+static inline mp_state_mem_area_t *gc_get_ptr_area(const void *ptr) {
+    if (((uintptr_t)(ptr) & (BYTES_PER_BLOCK - 1)) != 0) { // must be aligned on a block
+        return NULL;
+    }
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        if (ptr >= (void*)area->gc_pool_start     // must be above start of pool
+            && ptr < (void*)area->gc_pool_end) { // must be below end of pool
+            return area;
+        }
+    }
+    return NULL;
+}
+
 // ptr should be of type void*
-#define VERIFY_PTR(ptr) ( \
-        ((uintptr_t)(ptr) & (BYTES_PER_BLOCK - 1)) == 0      /* must be aligned on a block */ \
-        && ptr >= (void*)MP_STATE_MEM(gc_pool_start)     /* must be above start of pool */ \
-        && ptr < (void*)MP_STATE_MEM(gc_pool_end)        /* must be below end of pool */ \
-    )
+#define VERIFY_PTR(ptr) (gc_get_ptr_area(ptr) != NULL)
+
+#if MICROPY_GC_ARENA
+
+// An arena is a heap allocation starting with this header, which gc_alloc
+// bump-allocates from while it's the thread's current arena.  Each
+// allocation in it is preceded by a word holding its rounded-up size.
+typedef struct _gc_arena_t {
+    const byte *magic; // &gc_arena_magic, to tell arenas from other allocations
+    struct _gc_arena_t *prev;
+    byte *top;
+    byte *end;
+} gc_arena_t;
+
+STATIC const byte gc_arena_magic = 0;
+
+// Return the arena that ptr points into the allocations of, setting *area_out
+// to its area if not NULL, or NULL if ptr isn't in an arena
+STATIC gc_arena_t *gc_arena_find(const void *ptr, mp_state_mem_area_t **area_out) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        if ((const byte*)ptr >= area->gc_pool_start && (const byte*)ptr < area->gc_pool_end) {
+            // walk back to the head of the allocation ptr is in
+            size_t block = BLOCK_FROM_PTR(area, ptr);
+            while (ATB_GET_KIND(area, block) == AT_TAIL) {
+                block -= 1;
+            }
+            if (ATB_GET_KIND(area, block) == AT_FREE) {
+                return NULL;
+            }
+            gc_arena_t *arena = (gc_arena_t*)PTR_FROM_BLOCK(area, block);
+            if (arena->magic != &gc_arena_magic
+                || (const byte*)ptr < (const byte*)(arena + 1) || (const byte*)ptr >= arena->end) {
+                return NULL;
+            }
+            if (area_out != NULL) {
+                *area_out = area;
+            }
+            return arena;
+        }
+    }
+    return NULL;
+}
+
+gc_arena_t *gc_arena_suspend(void) {
+    gc_arena_t *arena = MP_STATE_THREAD(gc_arena);
+    MP_STATE_THREAD(gc_arena) = NULL;
+    return arena;
+}
+
+void gc_arena_restore(gc_arena_t *arena) {
+    if (arena != NULL) {
+        MP_STATE_THREAD(gc_arena) = arena;
+    }
+}
+
+#endif
+
+// Return the area of the block that ptr points to, setting *block to it, or
+// NULL if ptr isn't a heap pointer.  A pointer into a retired arena is taken
+// as pointing to the arena's head, to keep the arena alive.
+static inline mp_state_mem_area_t *gc_get_ptr_block(const void *ptr, size_t *block) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    #if MICROPY_GC_ARENA
+    if (MP_STATE_MEM(gc_arena_retired) > 0
+        && (area == NULL || ATB_GET_KIND(area, BLOCK_FROM_PTR(area, ptr)) == AT_TAIL)) {
+        mp_state_mem_area_t *arena_area;
+        gc_arena_t *arena = gc_arena_find(ptr, &arena_area);
+        if (arena != NULL) {
+            *block = BLOCK_FROM_PTR(arena_area, arena);
+            return arena_area;
+        }
+    }
+    #endif
+    if (area != NULL) {
+        *block = BLOCK_FROM_PTR(area, ptr);
+    }
+    return area;
+}
 
 #ifndef TRACE_MARK
 #if DEBUG_PRINT
@@ -208,28 +429,33 @@ bool gc_is_locked(void) {
 // children: mark the unmarked child blocks and put those newly marked
 // blocks on the stack. When all children have been checked, pop off the
 // topmost block on the stack and repeat with that one.
-STATIC void gc_mark_subtree(size_t block) {
+STATIC void MICROPY_WRAP_GC_MARK_SUBTREE(gc_mark_subtree)(mp_state_mem_area_t *area, size_t block) {
     // Start with the block passed in the argument.
     size_t sp = 0;
     for (;;) {
         // work out number of consecutive blocks in the chain starting with this one
         size_t n_blocks = 0;
+        size_t max_blocks = AREA_BLOCKS(area) - block;
         do {
             n_blocks += 1;
-        } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+        } while (n_blocks < max_blocks && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
 
         // check this block's children
-        void **ptrs = (void**)PTR_FROM_BLOCK(block);
+        void **ptrs = (void**)PTR_FROM_BLOCK(area, block);
         for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void*); i > 0; i--, ptrs++) {
             void *ptr = *ptrs;
-            if (VERIFY_PTR(ptr)) {
+            size_t childblock;
+            mp_state_mem_area_t *ptr_area = gc_get_ptr_block(ptr, &childblock);
+            if (ptr_area != NULL) {
                 // Mark and push this pointer
-                size_t childblock = BLOCK_FROM_PTR(ptr);
-                if (ATB_GET_KIND(childblock) == AT_HEAD) {
+                if (ATB_GET_KIND(ptr_area, childblock) == AT_HEAD) {
                     // an unmarked head, mark it, and push it on gc stack
                     TRACE_MARK(childblock, ptr);
-                    ATB_HEAD_TO_MARK(childblock);
+                    ATB_HEAD_TO_MARK(ptr_area, childblock);
                     if (sp < MICROPY_ALLOC_GC_STACK_SIZE) {
+                        #if MICROPY_GC_SPLIT_HEAP
+                        MP_STATE_MEM(gc_area_stack)[sp] = ptr_area;
+                        #endif
                         MP_STATE_MEM(gc_stack)[sp++] = childblock;
                     } else {
                         MP_STATE_MEM(gc_stack_overflow) = 1;
@@ -245,6 +471,9 @@ STATIC void gc_mark_subtree(size_t block) {
 
         // pop the next block off the stack
         block = MP_STATE_MEM(gc_stack)[--sp];
+        #if MICROPY_GC_SPLIT_HEAP
+        area = MP_STATE_MEM(gc_area_stack)[sp];
+        #endif
     }
 }
 
@@ -253,27 +482,51 @@ STATIC void gc_deal_with_stack_overflow(void) {
         MP_STATE_MEM(gc_stack_overflow) = 0;
 
         // scan entire memory looking for blocks which have been marked but not their children
-        for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-            // trace (again) if mark bit set
-            if (ATB_GET_KIND(block) == AT_MARK) {
-                gc_mark_subtree(block);
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            for (size_t block = 0; block < AREA_BLOCKS(area); block++) {
+                // trace (again) if mark bit set
+                if (ATB_GET_KIND(area, block) == AT_MARK) {
+                    gc_mark_subtree(area, block);
+                }
             }
         }
     }
 }
 
-STATIC void gc_sweep(void) {
+STATIC void gc_sweep_start(mp_gc_sweep_t *sweep) {
     #if MICROPY_PY_GC_COLLECT_RETVAL
     MP_STATE_MEM(gc_collected) = 0;
     #endif
-    // free unmarked heads and their tails
-    int free_tail = 0;
-    for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-        switch (ATB_GET_KIND(block)) {
+    #if MICROPY_GC_FREE_LISTS
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        memset(area->gc_free_list_len, 0, sizeof(area->gc_free_list_len));
+    }
+    #endif
+    sweep->area = &MP_STATE_MEM(area);
+    sweep->block = 0;
+    sweep->run = 0;
+    sweep->n_free = 0;
+    sweep->free_tail = 0;
+}
+
+// Sweep on from sweep->block up to end in sweep->area, freeing unmarked
+// heads and their tails, and move on to the next area at the end of this
+// one.  The GC must be locked, since finalisers are run.
+STATIC void gc_sweep_area(mp_gc_sweep_t *sweep, size_t end) {
+    mp_state_mem_area_t *area = sweep->area;
+    size_t total_blocks = AREA_BLOCKS(area);
+    size_t block = sweep->block;
+    size_t first_freed = total_blocks;
+    #if MICROPY_GC_STATS
+    size_t n_freed = 0;
+    #endif
+    int free_tail = sweep->free_tail;
+    for (; block < end; block++) {
+        switch (ATB_GET_KIND(area, block)) {
             case AT_HEAD:
 #if MICROPY_ENABLE_FINALISER
-                if (FTB_GET(block)) {
-                    mp_obj_base_t *obj = (mp_obj_base_t*)PTR_FROM_BLOCK(block);
+                if (FTB_GET(area, block)) {
+                    mp_obj_base_t *obj = (mp_obj_base_t*)PTR_FROM_BLOCK(area, block);
                     if (obj->type != NULL) {
                         // if the object has a type then see if it has a __del__ method
                         mp_obj_t dest[2];
@@ -290,11 +543,17 @@ STATIC void gc_sweep(void) {
                         }
                     }
                     // clear finaliser flag
-                    FTB_CLEAR(block);
+                    FTB_CLEAR(area, block);
                 }
 #endif
+                #if MICROPY_GC_ARENA
+                if (MP_STATE_MEM(gc_arena_retired) > 0
+                    && ((gc_arena_t*)PTR_FROM_BLOCK(area, block))->magic == &gc_arena_magic) {
+                    MP_STATE_MEM(gc_arena_retired) -= 1;
+                }
+                #endif
                 free_tail = 1;
-                DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(block));
+                DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(area, block));
                 #if MICROPY_PY_GC_COLLECT_RETVAL
                 MP_STATE_MEM(gc_collected)++;
                 #endif
@@ -302,29 +561,156 @@ STATIC void gc_sweep(void) {
 
             case AT_TAIL:
                 if (free_tail) {
-                    ATB_ANY_TO_FREE(block);
+                    ATB_ANY_TO_FREE(area, block);
                     #if CLEAR_ON_SWEEP
-                    memset((void*)PTR_FROM_BLOCK(block), 0, BYTES_PER_BLOCK);
+                    memset((void*)PTR_FROM_BLOCK(area, block), 0, BYTES_PER_BLOCK);
+                    #endif
+                    if (first_freed == total_blocks) {
+                        first_freed = block;
+                    }
+                    #if MICROPY_GC_STATS
+                    n_freed += 1;
                     #endif
                 }
                 break;
 
             case AT_MARK:
-                ATB_MARK_TO_HEAD(block);
+                ATB_MARK_TO_HEAD(area, block);
                 free_tail = 0;
                 break;
         }
+
+        #if MICROPY_GC_FREE_LISTS || MICROPY_GC_INCREMENTAL
+        // count the free blocks, and fill the free lists with the short runs
+        if (ATB_GET_KIND(area, block) == AT_FREE) {
+            sweep->n_free += 1;
+            sweep->run += 1;
+        } else {
+            #if MICROPY_GC_FREE_LISTS
+            if (sweep->run > 0 && sweep->run <= GC_FREE_LIST_CLASSES) {
+                gc_free_list_push(area, block - sweep->run, sweep->run);
+            }
+            #endif
+            sweep->run = 0;
+        }
+        #endif
+    }
+    sweep->block = block;
+    sweep->free_tail = free_tail;
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats_blocks_freed) += n_freed;
+    #endif
+
+    // a scan for free blocks has to start from those just freed
+    if (first_freed / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+        area->gc_last_free_atb_index = first_freed / BLOCKS_PER_ATB;
+    }
+    #if MICROPY_GC_FREE_LISTS
+    gc_free_run_lower(area, first_freed / BLOCKS_PER_ATB);
+    #endif
+
+    if (block == total_blocks) {
+        #if MICROPY_GC_FREE_LISTS
+        if (sweep->run > 0 && sweep->run <= GC_FREE_LIST_CLASSES) {
+            gc_free_list_push(area, block - sweep->run, sweep->run);
+        }
+        #endif
+        sweep->area = NEXT_AREA(area);
+        sweep->block = 0;
+        sweep->run = 0;
+        sweep->free_tail = 0;
+        #if MICROPY_GC_INCREMENTAL
+        if (sweep->area == NULL) {
+            // gc.step starts the next collection once half of what's free
+            // now has been allocated
+            MP_STATE_MEM(gc_sweep_pending) = 0;
+            MP_STATE_MEM(gc_step_amount) = sweep->n_free / 2;
+        }
+        #endif
+    }
+}
+
+// Sweep up to n_blocks more blocks, going on through the areas
+STATIC void gc_sweep_blocks(mp_gc_sweep_t *sweep, size_t n_blocks) {
+    while (sweep->area != NULL && n_blocks > 0) {
+        size_t n = MIN(n_blocks, AREA_BLOCKS(sweep->area) - sweep->block);
+        gc_sweep_area(sweep, sweep->block + n);
+        n_blocks -= n;
+    }
+}
+
+#if MICROPY_GC_INCREMENTAL
+// Sweep up to n_blocks more of a pending sweep; the GC must be entered
+STATIC void gc_sweep_step_internal(size_t n_blocks) {
+    MP_STATE_MEM(gc_lock_depth)++;
+    gc_sweep_blocks(&MP_STATE_MEM(gc_sweep), n_blocks);
+    MP_STATE_MEM(gc_lock_depth)--;
+}
+
+// Whether a pending sweep has yet to reach the block
+STATIC bool gc_sweep_is_ahead(mp_state_mem_area_t *area, size_t block) {
+    mp_gc_sweep_t *sweep = &MP_STATE_MEM(gc_sweep);
+    if (!MP_STATE_MEM(gc_sweep_pending)) {
+        return false;
+    }
+    if (area == sweep->area) {
+        return block >= sweep->block;
+    }
+    // the areas are swept in order
+    for (mp_state_mem_area_t *a = NEXT_AREA(sweep->area); a != NULL; a = NEXT_AREA(a)) {
+        if (a == area) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool gc_sweep_step(size_t n_blocks) {
+    GC_ENTER();
+    if (MP_STATE_MEM(gc_sweep_pending) && MP_STATE_MEM(gc_lock_depth) == 0) {
+        gc_sweep_step_internal(n_blocks);
     }
+    bool pending = MP_STATE_MEM(gc_sweep_pending);
+    GC_EXIT();
+    return pending;
 }
 
+bool gc_collect_due(void) {
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    return MP_STATE_MEM(gc_alloc_amount) >= MP_STATE_MEM(gc_step_amount);
+    #else
+    return false;
+    #endif
+}
+#endif
+
 void gc_collect_start(void) {
     GC_ENTER();
     MP_STATE_MEM(gc_lock_depth)++;
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats_t0) = mp_hal_ticks_us();
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    // the marks must all be cleared before marking again
+    if (MP_STATE_MEM(gc_sweep_pending)) {
+        gc_sweep_blocks(&MP_STATE_MEM(gc_sweep), (size_t)-1);
+    }
+    #endif
     #if MICROPY_GC_ALLOC_THRESHOLD
     MP_STATE_MEM(gc_alloc_amount) = 0;
     #endif
     MP_STATE_MEM(gc_stack_overflow) = 0;
 
+    #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+    mp_thread_gc_others_stop();
+    #endif
+
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    // don't keep the bound methods this thread made last, or their objects,
+    // alive; other threads' caches are only kept until they're overwritten
+    memset(MP_STATE_THREAD(bound_meth_cache), 0, sizeof(MP_STATE_THREAD(bound_meth_cache)));
+    #endif
+
     // Trace root pointers.  This relies on the root pointers being organised
     // correctly in the mp_state_ctx structure.  We scan nlr_top, dict_locals,
     // dict_globals, then the root pointer section of mp_state_vm.
@@ -343,13 +729,14 @@ void gc_collect_start(void) {
 void gc_collect_root(void **ptrs, size_t len) {
     for (size_t i = 0; i < len; i++) {
         void *ptr = ptrs[i];
-        if (VERIFY_PTR(ptr)) {
-            size_t block = BLOCK_FROM_PTR(ptr);
-            if (ATB_GET_KIND(block) == AT_HEAD) {
+        size_t block;
+        mp_state_mem_area_t *area = gc_get_ptr_block(ptr, &block);
+        if (area != NULL) {
+            if (ATB_GET_KIND(area, block) == AT_HEAD) {
                 // An unmarked head: mark it, and mark all its children
                 TRACE_MARK(block, ptr);
-                ATB_HEAD_TO_MARK(block);
-                gc_mark_subtree(block);
+                ATB_HEAD_TO_MARK(area, block);
+                gc_mark_subtree(area, block);
             }
         }
     }
@@ -357,8 +744,40 @@ void gc_collect_root(void **ptrs, size_t len) {
 
 void gc_collect_end(void) {
     gc_deal_with_stack_overflow();
-    gc_sweep();
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+    // the sweep only frees what no thread can reach, so they can run during it
+    mp_thread_gc_others_resume();
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        area->gc_last_free_atb_index = 0;
+        #if MICROPY_GC_FREE_LISTS
+        memset(area->gc_free_run_atb_index, 0, sizeof(area->gc_free_run_atb_index));
+        #endif
+    }
+    #if MICROPY_GC_INCREMENTAL
+    // A collection started by an allocation or gc.step leaves the sweep to
+    // be done in steps.  Blocks allocated ahead of the sweep are marked so
+    // they survive it.
+    gc_sweep_start(&MP_STATE_MEM(gc_sweep));
+    MP_STATE_MEM(gc_sweep_pending) = 1;
+    if (!MP_STATE_MEM(gc_sweep_lazy)) {
+        gc_sweep_blocks(&MP_STATE_MEM(gc_sweep), (size_t)-1);
+    }
+    MP_STATE_MEM(gc_sweep_lazy) = 0;
+    #else
+    mp_gc_sweep_t sweep;
+    gc_sweep_start(&sweep);
+    gc_sweep_blocks(&sweep, (size_t)-1);
+    #endif
+    #if MICROPY_GC_STATS
+    // the pause doesn't include a sweep left to be done in steps
+    mp_uint_t pause = mp_hal_ticks_us() - MP_STATE_MEM(gc_stats_t0);
+    MP_STATE_MEM(gc_stats_collections) += 1;
+    MP_STATE_MEM(gc_stats_pause_us_total) += pause;
+    if (pause > MP_STATE_MEM(gc_stats_pause_us_max)) {
+        MP_STATE_MEM(gc_stats_pause_us_max) = pause;
+    }
+    #endif
     MP_STATE_MEM(gc_lock_depth)--;
     GC_EXIT();
 }
@@ -366,73 +785,238 @@ void gc_collect_end(void) {
 void gc_sweep_all(void) {
     GC_ENTER();
     MP_STATE_MEM(gc_lock_depth)++;
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_sweep_pending)) {
+        gc_sweep_blocks(&MP_STATE_MEM(gc_sweep), (size_t)-1);
+    }
+    #endif
     MP_STATE_MEM(gc_stack_overflow) = 0;
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats_t0) = mp_hal_ticks_us();
+    #endif
     gc_collect_end();
 }
 
 void gc_info(gc_info_t *info) {
     GC_ENTER();
-    info->total = MP_STATE_MEM(gc_pool_end) - MP_STATE_MEM(gc_pool_start);
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_sweep_pending) && MP_STATE_MEM(gc_lock_depth) == 0) {
+        gc_sweep_step_internal((size_t)-1);
+    }
+    #endif
+    info->total = 0;
     info->used = 0;
     info->free = 0;
     info->max_free = 0;
     info->num_1block = 0;
     info->num_2block = 0;
     info->max_block = 0;
-    bool finish = false;
-    for (size_t block = 0, len = 0, len_free = 0; !finish;) {
-        size_t kind = ATB_GET_KIND(block);
-        switch (kind) {
-            case AT_FREE:
-                info->free += 1;
-                len_free += 1;
-                len = 0;
-                break;
-
-            case AT_HEAD:
-                info->used += 1;
-                len = 1;
-                break;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        info->total += area->gc_pool_end - area->gc_pool_start;
+        bool finish = false;
+        for (size_t block = 0, len = 0, len_free = 0; !finish;) {
+            size_t kind = ATB_GET_KIND(area, block);
+            switch (kind) {
+                case AT_FREE:
+                    info->free += 1;
+                    len_free += 1;
+                    len = 0;
+                    break;
+
+                case AT_HEAD:
+                    info->used += 1;
+                    len = 1;
+                    break;
+
+                case AT_TAIL:
+                    info->used += 1;
+                    len += 1;
+                    break;
+
+                case AT_MARK:
+                    // shouldn't happen
+                    break;
+            }
 
-            case AT_TAIL:
-                info->used += 1;
-                len += 1;
-                break;
+            block++;
+            finish = (block == AREA_BLOCKS(area));
+            // Get next block type if possible
+            if (!finish) {
+                kind = ATB_GET_KIND(area, block);
+            }
 
-            case AT_MARK:
-                // shouldn't happen
-                break;
+            if (finish || kind == AT_FREE || kind == AT_HEAD) {
+                if (len == 1) {
+                    info->num_1block += 1;
+                } else if (len == 2) {
+                    info->num_2block += 1;
+                }
+                if (len > info->max_block) {
+                    info->max_block = len;
+                }
+                if (finish || kind == AT_HEAD) {
+                    if (len_free > info->max_free) {
+                        info->max_free = len_free;
+                    }
+                    len_free = 0;
+                }
+            }
         }
+    }
 
-        block++;
-        finish = (block == MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-        // Get next block type if possible
-        if (!finish) {
-            kind = ATB_GET_KIND(block);
-        }
+    info->used *= BYTES_PER_BLOCK;
+    info->free *= BYTES_PER_BLOCK;
+    GC_EXIT();
+}
 
-        if (finish || kind == AT_FREE || kind == AT_HEAD) {
-            if (len == 1) {
-                info->num_1block += 1;
-            } else if (len == 2) {
-                info->num_2block += 1;
+size_t gc_free_runs(size_t *runs, size_t n_runs) {
+    GC_ENTER();
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_sweep_pending) && MP_STATE_MEM(gc_lock_depth) == 0) {
+        gc_sweep_step_internal((size_t)-1);
+    }
+    #endif
+    memset(runs, 0, n_runs * sizeof(*runs));
+    size_t max_free = 0;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        size_t n_blocks = AREA_BLOCKS(area);
+        for (size_t block = 0; block < n_blocks;) {
+            if (ATB_GET_KIND(area, block) != AT_FREE) {
+                block++;
+                continue;
             }
-            if (len > info->max_block) {
-                info->max_block = len;
+            size_t len = 0;
+            while (block < n_blocks && ATB_GET_KIND(area, block) == AT_FREE) {
+                len++;
+                block++;
             }
-            if (finish || kind == AT_HEAD) {
-                if (len_free > info->max_free) {
-                    info->max_free = len_free;
-                }
-                len_free = 0;
+            if (len > max_free) {
+                max_free = len;
+            }
+            size_t i = 0;
+            while (i + 1 < n_runs && len >> (i + 1) != 0) {
+                i++;
             }
+            runs[i] += 1;
         }
     }
-
-    info->used *= BYTES_PER_BLOCK;
-    info->free *= BYTES_PER_BLOCK;
     GC_EXIT();
+    return max_free;
+}
+
+#if MICROPY_GC_PROFILE
+// Record the line of the running bytecode as making an allocation of n_bytes
+STATIC void gc_profile_sample(size_t n_bytes) {
+    MP_STATE_MEM(gc_profile_countdown) = MP_STATE_MEM(gc_profile_period);
+    mp_gc_profile_sample_t *sample = &MP_STATE_MEM(gc_profile)[MP_STATE_MEM(gc_profile_n)++ % MICROPY_GC_PROFILE_SAMPLES];
+    const mp_code_state_t *code_state = MP_STATE_THREAD(current_code_state);
+    if (code_state != NULL) {
+        sample->line = mp_bytecode_get_source_line(code_state->fun_bc, code_state->ip, &sample->block_name, &sample->source_file);
+    } else {
+        sample->source_file = MP_QSTR_NULL;
+        sample->block_name = MP_QSTR_NULL;
+        sample->line = 0;
+    }
+    sample->n_bytes = n_bytes;
+}
+#endif
+
+#if MICROPY_GC_ARENA
+
+#define GC_ARENA_ROUND(n) (((n) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+
+STATIC void *gc_arena_alloc(gc_arena_t *arena, size_t n_bytes) {
+    size_t n = GC_ARENA_ROUND(n_bytes);
+    if (sizeof(size_t) + n > (size_t)(arena->end - arena->top)) {
+        return NULL;
+    }
+    size_t *header = (size_t*)arena->top;
+    *header = n;
+    arena->top += sizeof(size_t) + n;
+    // zero the padding, as gc_alloc does
+    memset((byte*)(header + 1) + n_bytes, 0, n - n_bytes);
+    return header + 1;
+}
+
+// Only the most recent allocation in an arena can be given back to it
+STATIC void gc_arena_free(void *ptr) {
+    gc_arena_t *arena = gc_arena_find(ptr, NULL);
+    assert(arena != NULL);
+    size_t *header = (size_t*)ptr - 1;
+    if ((byte*)ptr + *header == arena->top) {
+        arena->top = (byte*)header;
+    }
+}
+
+STATIC void *gc_arena_realloc(void *ptr, size_t n_bytes, bool allow_move) {
+    gc_arena_t *arena = gc_arena_find(ptr, NULL);
+    assert(arena != NULL);
+    size_t *header = (size_t*)ptr - 1;
+    size_t n = GC_ARENA_ROUND(n_bytes);
+    if ((byte*)ptr + *header == arena->top) {
+        // the most recent allocation can grow or shrink in place
+        if (n <= (size_t)(arena->end - (byte*)ptr)) {
+            if (n > *header) {
+                memset((byte*)ptr + *header, 0, n - *header);
+            }
+            *header = n;
+            arena->top = (byte*)ptr + n;
+            return ptr;
+        }
+    } else if (n <= *header) {
+        return ptr;
+    }
+    if (!allow_move) {
+        return NULL;
+    }
+    void *ptr2 = gc_alloc(n_bytes, 0);
+    if (ptr2 != NULL) {
+        memcpy(ptr2, ptr, *header);
+    }
+    return ptr2;
+}
+
+#endif
+
+#if MICROPY_GC_LARGE_ALLOC
+// Find the highest run of n_blocks free blocks in the area, scanning down from
+// its end.  Returns the start block, or (size_t)-1 if none was found.
+STATIC size_t gc_find_high_run(mp_state_mem_area_t *area, size_t n_blocks) {
+    size_t n_free = 0;
+    for (size_t i = area->gc_alloc_table_byte_len; i-- > 0;) {
+        byte a = area->gc_alloc_table_start[i];
+        if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { return i * BLOCKS_PER_ATB + 3; } } else { n_free = 0; }
+        if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { return i * BLOCKS_PER_ATB + 2; } } else { n_free = 0; }
+        if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { return i * BLOCKS_PER_ATB + 1; } } else { n_free = 0; }
+        if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { return i * BLOCKS_PER_ATB + 0; } } else { n_free = 0; }
+    }
+    return (size_t)-1;
 }
+#endif
+
+#if MICROPY_GC_THREAD_CACHE
+// Take free single blocks into the cache, from len up to full, from the
+// bottom of each area.  The GC mutex must be held.  Returns the new length.
+STATIC size_t gc_thread_cache_fill(void **cache, size_t len) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL && len < MICROPY_GC_THREAD_CACHE; area = NEXT_AREA(area)) {
+        size_t block = area->gc_last_free_atb_index * BLOCKS_PER_ATB;
+        for (; block < AREA_BLOCKS(area) && len < MICROPY_GC_THREAD_CACHE; block++) {
+            if (ATB_GET_KIND(area, block) == AT_FREE) {
+                ATB_FREE_TO_HEAD(area, block);
+                #if MICROPY_GC_INCREMENTAL
+                if (gc_sweep_is_ahead(area, block)) {
+                    ATB_HEAD_TO_MARK(area, block);
+                }
+                #endif
+                cache[len++] = (void*)(area->gc_pool_start + block * BYTES_PER_BLOCK);
+            }
+        }
+        // there are no free blocks below here now
+        area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
+    }
+    return len;
+}
+#endif
 
 void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
     bool has_finaliser = alloc_flags & GC_ALLOC_FLAG_HAS_FINALISER;
@@ -444,6 +1028,23 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
         return NULL;
     }
 
+    #if MICROPY_GC_THREAD_CACHE
+    // Single blocks without a finaliser come from the thread's cache without
+    // taking the mutex.  They're counted as allocated when they are cached,
+    // and were zeroed then.
+    void **cache = MP_STATE_THREAD(gc_cache);
+    size_t *cache_len = &MP_STATE_THREAD(gc_cache_len);
+    bool use_cache = n_blocks == 1 && !has_finaliser;
+    #if MICROPY_GC_ARENA
+    use_cache = use_cache && MP_STATE_THREAD(gc_arena) == NULL;
+    #endif
+    if (use_cache && *cache_len > 0 && MP_STATE_MEM(gc_lock_depth) == 0) {
+        void *ptr = cache[--*cache_len];
+        cache[*cache_len] = NULL;
+        return ptr;
+    }
+    #endif
+
     GC_ENTER();
 
     // check if GC is locked
@@ -452,6 +1053,18 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
         return NULL;
     }
 
+    #if MICROPY_GC_ARENA
+    // objects with finalisers are left to the heap, so __del__ is run
+    if (MP_STATE_THREAD(gc_arena) != NULL && !has_finaliser) {
+        void *ptr = gc_arena_alloc(MP_STATE_THREAD(gc_arena), n_bytes);
+        if (ptr != NULL) {
+            GC_EXIT();
+            return ptr;
+        }
+    }
+    #endif
+
+    mp_state_mem_area_t *area;
     size_t i;
     size_t end_block;
     size_t start_block;
@@ -461,6 +1074,9 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
     #if MICROPY_GC_ALLOC_THRESHOLD
     if (!collected && MP_STATE_MEM(gc_alloc_amount) >= MP_STATE_MEM(gc_alloc_threshold)) {
         GC_EXIT();
+        #if MICROPY_GC_INCREMENTAL
+        MP_STATE_MEM(gc_sweep_lazy) = 1;
+        #endif
         gc_collect();
         collected = 1;
         GC_ENTER();
@@ -469,22 +1085,82 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
 
     for (;;) {
 
-        // look for a run of n_blocks available blocks
-        n_free = 0;
-        for (i = MP_STATE_MEM(gc_last_free_atb_index); i < MP_STATE_MEM(gc_alloc_table_byte_len); i++) {
-            byte a = MP_STATE_MEM(gc_alloc_table_start)[i];
-            if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
-            if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
-            if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
-            if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+        #if MICROPY_GC_INCREMENTAL
+        // each allocation does a little of a pending sweep
+        if (MP_STATE_MEM(gc_sweep_pending)) {
+            gc_sweep_step_internal(GC_SWEEP_STEP_BLOCKS);
         }
+        #endif
+
+        #if MICROPY_GC_FREE_LISTS
+        // take a short run from the free lists if there's one
+        if (n_blocks <= GC_FREE_LIST_CLASSES) {
+            for (area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+                start_block = gc_free_list_pop(area, n_blocks);
+                if (start_block != (size_t)-1) {
+                    end_block = start_block + n_blocks - 1;
+                    goto found_run;
+                }
+            }
+        }
+        #endif
+
+        #if MICROPY_GC_LARGE_ALLOC
+        // put a large allocation up high, away from the small ones
+        if (n_blocks * BYTES_PER_BLOCK >= MICROPY_GC_LARGE_ALLOC) {
+            for (area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+                start_block = gc_find_high_run(area, n_blocks);
+                if (start_block != (size_t)-1) {
+                    end_block = start_block + n_blocks - 1;
+                    goto found_run;
+                }
+            }
+        } else
+        #endif
+        // look for a run of n_blocks available blocks, in each area in turn
+        for (area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            n_free = 0;
+            i = area->gc_last_free_atb_index;
+            #if MICROPY_GC_FREE_LISTS
+            // skip the part of the area known to have only shorter runs
+            if (n_blocks <= GC_FREE_LIST_CLASSES && area->gc_free_run_atb_index[n_blocks - 1] > i) {
+                i = area->gc_free_run_atb_index[n_blocks - 1];
+            }
+            #endif
+            for (; i < area->gc_alloc_table_byte_len; i++) {
+                byte a = area->gc_alloc_table_start[i];
+                if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
+                if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
+                if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
+                if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+            }
+        }
+
+        #if MICROPY_GC_INCREMENTAL
+        if (MP_STATE_MEM(gc_sweep_pending)) {
+            // the rest of the sweep may free enough
+            gc_sweep_step_internal((size_t)-1);
+            continue;
+        }
+        #endif
 
         GC_EXIT();
         // nothing found!
         if (collected) {
+            #if MICROPY_GC_SPLIT_HEAP_AUTO
+            // the areas are full of live data, so add another and look again
+            if (collected == 1 && gc_grow_heap(n_bytes)) {
+                collected = 2;
+                GC_ENTER();
+                continue;
+            }
+            #endif
             return NULL;
         }
         DEBUG_printf("gc_alloc(" UINT_FMT "): no free mem, triggering GC\n", n_bytes);
+        #if MICROPY_GC_INCREMENTAL
+        MP_STATE_MEM(gc_sweep_lazy) = 1;
+        #endif
         gc_collect();
         collected = 1;
         GC_ENTER();
@@ -502,29 +1178,81 @@ found:
     // before this one.  Also, whenever we free or shink a block we must check
     // if this index needs adjusting (see gc_realloc and gc_free).
     if (n_free == 1) {
-        MP_STATE_MEM(gc_last_free_atb_index) = (i + 1) / BLOCKS_PER_ATB;
+        area->gc_last_free_atb_index = (i + 1) / BLOCKS_PER_ATB;
     }
 
+    #if MICROPY_GC_FREE_LISTS
+    // the scan found the first run long enough, and now it's used, so the
+    // next scan for a run this long or longer can start after it
+    for (size_t c = n_free - 1; c < GC_FREE_LIST_CLASSES; c++) {
+        if (area->gc_free_run_atb_index[c] < (i + 1) / BLOCKS_PER_ATB) {
+            area->gc_free_run_atb_index[c] = (i + 1) / BLOCKS_PER_ATB;
+        }
+    }
+
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS || MICROPY_GC_LARGE_ALLOC
+found_run:
+    #endif
     // mark first block as used head
-    ATB_FREE_TO_HEAD(start_block);
+    ATB_FREE_TO_HEAD(area, start_block);
+    #if MICROPY_GC_INCREMENTAL
+    if (gc_sweep_is_ahead(area, start_block)) {
+        // the sweep hasn't reached it yet, so mark it to survive
+        ATB_HEAD_TO_MARK(area, start_block);
+    }
+    #endif
 
     // mark rest of blocks as used tail
     // TODO for a run of many blocks can make this more efficient
     for (size_t bl = start_block + 1; bl <= end_block; bl++) {
-        ATB_FREE_TO_TAIL(bl);
+        ATB_FREE_TO_TAIL(area, bl);
     }
 
     // get pointer to first block
     // we must create this pointer before unlocking the GC so a collection can find it
-    void *ret_ptr = (void*)(MP_STATE_MEM(gc_pool_start) + start_block * BYTES_PER_BLOCK);
+    void *ret_ptr = (void*)(area->gc_pool_start + start_block * BYTES_PER_BLOCK);
     DEBUG_printf("gc_alloc(%p)\n", ret_ptr);
 
+    #if MICROPY_GC_THREAD_CACHE
+    // fill the thread's cache while the mutex is held
+    size_t cache_from = *cache_len;
+    if (use_cache) {
+        *cache_len = gc_thread_cache_fill(cache, cache_from);
+        #if MICROPY_GC_ALLOC_THRESHOLD
+        MP_STATE_MEM(gc_alloc_amount) += *cache_len - cache_from;
+        #endif
+        #if MICROPY_GC_STATS
+        MP_STATE_MEM(gc_stats_bytes_allocated) += (*cache_len - cache_from) * BYTES_PER_BLOCK;
+        #endif
+    }
+    #endif
+
     #if MICROPY_GC_ALLOC_THRESHOLD
     MP_STATE_MEM(gc_alloc_amount) += n_blocks;
     #endif
 
+    #if MICROPY_GC_STATS
+    MP_STATE_MEM(gc_stats_bytes_allocated) += n_blocks * BYTES_PER_BLOCK;
+    #endif
+
+    #if MICROPY_GC_PROFILE
+    if (MP_STATE_MEM(gc_profile_period) != 0 && --MP_STATE_MEM(gc_profile_countdown) == 0) {
+        gc_profile_sample(n_blocks * BYTES_PER_BLOCK);
+    }
+    #endif
+
     GC_EXIT();
 
+    #if MICROPY_GC_THREAD_CACHE
+    if (use_cache) {
+        for (size_t c = cache_from; c < *cache_len; c++) {
+            memset(cache[c], 0, BYTES_PER_BLOCK);
+        }
+    }
+    #endif
+
     #if MICROPY_GC_CONSERVATIVE_CLEAR
     // be conservative and zero out all the newly allocated blocks
     memset((byte*)ret_ptr, 0, (end_block - start_block + 1) * BYTES_PER_BLOCK);
@@ -543,7 +1271,7 @@ found:
         ((mp_obj_base_t*)ret_ptr)->type = NULL;
         // set mp_obj flag only if it has a finaliser
         GC_ENTER();
-        FTB_SET(start_block);
+        FTB_SET(area, start_block);
         GC_EXIT();
     }
     #else
@@ -583,24 +1311,45 @@ void gc_free(void *ptr) {
         GC_EXIT();
     } else {
         // get the GC block number corresponding to this pointer
-        assert(VERIFY_PTR(ptr));
-        size_t block = BLOCK_FROM_PTR(ptr);
-        assert(ATB_GET_KIND(block) == AT_HEAD);
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        #if MICROPY_GC_ARENA
+        if (area == NULL || !ATB_IS_HEAD(area, BLOCK_FROM_PTR(area, ptr))) {
+            gc_arena_free(ptr);
+            GC_EXIT();
+            return;
+        }
+        #endif
+        assert(area != NULL);
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        assert(ATB_IS_HEAD(area, block));
 
         #if MICROPY_ENABLE_FINALISER
-        FTB_CLEAR(block);
+        FTB_CLEAR(area, block);
         #endif
 
         // set the last_free pointer to this block if it's earlier in the heap
-        if (block / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = block / BLOCKS_PER_ATB;
+        if (block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
         }
+        #if MICROPY_GC_FREE_LISTS
+        gc_free_run_lower(area, block / BLOCKS_PER_ATB);
+        #endif
 
         // free head and all of its tail blocks
+        #if MICROPY_GC_FREE_LISTS
+        size_t start_block = block;
+        #endif
         do {
-            ATB_ANY_TO_FREE(block);
+            ATB_ANY_TO_FREE(area, block);
             block += 1;
-        } while (ATB_GET_KIND(block) == AT_TAIL);
+        } while (block < AREA_BLOCKS(area) && ATB_GET_KIND(area, block) == AT_TAIL);
+
+        #if MICROPY_GC_FREE_LISTS
+        // keep the run for the next allocation of its size
+        if (block - start_block <= GC_FREE_LIST_CLASSES) {
+            gc_free_list_push(area, start_block, block - start_block);
+        }
+        #endif
 
         GC_EXIT();
 
@@ -612,24 +1361,41 @@ void gc_free(void *ptr) {
 
 size_t gc_nbytes(const void *ptr) {
     GC_ENTER();
-    if (VERIFY_PTR(ptr)) {
-        size_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        if (ATB_IS_HEAD(area, block)) {
             // work out number of consecutive blocks in the chain starting with this on
             size_t n_blocks = 0;
             do {
                 n_blocks += 1;
-            } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+            } while (block + n_blocks < AREA_BLOCKS(area) && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
             GC_EXIT();
             return n_blocks * BYTES_PER_BLOCK;
         }
     }
 
+    #if MICROPY_GC_ARENA
+    if (gc_arena_find(ptr, NULL) != NULL) {
+        GC_EXIT();
+        return ((const size_t*)ptr)[-1];
+    }
+    #endif
+
     // invalid pointer
     GC_EXIT();
     return 0;
 }
 
+bool gc_is_heap_ptr(const void *ptr) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        if ((const byte*)ptr >= area->gc_pool_start && (const byte*)ptr < area->gc_pool_end) {
+            return true;
+        }
+    }
+    return false;
+}
+
 #if 0
 // old, simple realloc that didn't expand memory in place
 void *gc_realloc(void *ptr, mp_uint_t n_bytes) {
@@ -681,9 +1447,16 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     // get the GC block number corresponding to this pointer
-    assert(VERIFY_PTR(ptr));
-    size_t block = BLOCK_FROM_PTR(ptr);
-    assert(ATB_GET_KIND(block) == AT_HEAD);
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    #if MICROPY_GC_ARENA
+    if (area == NULL || !ATB_IS_HEAD(area, BLOCK_FROM_PTR(area, ptr))) {
+        GC_EXIT();
+        return gc_arena_realloc(ptr, n_bytes, allow_move);
+    }
+    #endif
+    assert(area != NULL);
+    size_t block = BLOCK_FROM_PTR(area, ptr);
+    assert(ATB_IS_HEAD(area, block));
 
     // compute number of new blocks that are requested
     size_t new_blocks = (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
@@ -696,9 +1469,9 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     // efficiently shrink it (see below for shrinking code).
     size_t n_free   = 0;
     size_t n_blocks = 1; // counting HEAD block
-    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    size_t max_block = AREA_BLOCKS(area);
     for (size_t bl = block + n_blocks; bl < max_block; bl++) {
-        byte block_type = ATB_GET_KIND(bl);
+        byte block_type = ATB_GET_KIND(area, bl);
         if (block_type == AT_TAIL) {
             n_blocks++;
             continue;
@@ -724,13 +1497,16 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     if (new_blocks < n_blocks) {
         // free unneeded tail blocks
         for (size_t bl = block + new_blocks, count = n_blocks - new_blocks; count > 0; bl++, count--) {
-            ATB_ANY_TO_FREE(bl);
+            ATB_ANY_TO_FREE(area, bl);
         }
 
         // set the last_free pointer to end of this block if it's earlier in the heap
-        if ((block + new_blocks) / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = (block + new_blocks) / BLOCKS_PER_ATB;
+        if ((block + new_blocks) / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = (block + new_blocks) / BLOCKS_PER_ATB;
         }
+        #if MICROPY_GC_FREE_LISTS
+        gc_free_run_lower(area, (block + new_blocks) / BLOCKS_PER_ATB);
+        #endif
 
         GC_EXIT();
 
@@ -745,8 +1521,8 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     if (new_blocks <= n_blocks + n_free) {
         // mark few more blocks as used tail
         for (size_t bl = block + n_blocks; bl < block + new_blocks; bl++) {
-            assert(ATB_GET_KIND(bl) == AT_FREE);
-            ATB_FREE_TO_TAIL(bl);
+            assert(ATB_GET_KIND(area, bl) == AT_FREE);
+            ATB_FREE_TO_TAIL(area, bl);
         }
 
         GC_EXIT();
@@ -767,7 +1543,7 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     #if MICROPY_ENABLE_FINALISER
-    bool ftb_state = FTB_GET(block);
+    bool ftb_state = FTB_GET(area, block);
     #else
     bool ftb_state = false;
     #endif
@@ -780,7 +1556,14 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     // can't resize inplace; try to find a new contiguous chain
+    #if MICROPY_GC_ARENA
+    // memory from outside an arena stays outside, as it may outlive the arena
+    gc_arena_t *arena = gc_arena_suspend();
     void *ptr_out = gc_alloc(n_bytes, ftb_state);
+    gc_arena_restore(arena);
+    #else
+    void *ptr_out = gc_alloc(n_bytes, ftb_state);
+    #endif
 
     // check that the alloc succeeded
     if (ptr_out == NULL) {
@@ -794,6 +1577,49 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
 }
 #endif // Alternative gc_realloc impl
 
+#if MICROPY_GC_ARENA
+gc_arena_t *gc_arena_push(size_t n_bytes) {
+    // the arena itself comes from the heap, not from the current arena
+    gc_arena_t *prev = gc_arena_suspend();
+    gc_arena_t *arena = gc_alloc(sizeof(gc_arena_t) + n_bytes, 0);
+    gc_arena_restore(prev);
+    if (arena == NULL) {
+        return NULL;
+    }
+    size_t n = gc_nbytes(arena);
+    // clear it all, so stale pointers in it don't keep others alive
+    memset(arena, 0, n);
+    arena->magic = &gc_arena_magic;
+    arena->prev = prev;
+    arena->top = (byte*)(arena + 1);
+    arena->end = (byte*)arena + n;
+    MP_STATE_THREAD(gc_arena) = arena;
+    return arena;
+}
+
+// The arena is passed back here, rather than taken as the current one, as
+// an exception can leave the arena suspended
+void gc_arena_pop(gc_arena_t *arena, bool retire) {
+    MP_STATE_THREAD(gc_arena) = arena->prev;
+    if (retire) {
+        GC_ENTER();
+        MP_STATE_MEM(gc_arena_retired) += 1;
+        GC_EXIT();
+    } else {
+        gc_free(arena);
+    }
+}
+
+bool gc_arena_has(const void *ptr) {
+    GC_ENTER();
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    bool has = (area == NULL || !ATB_IS_HEAD(area, BLOCK_FROM_PTR(area, ptr)))
+        && gc_arena_find(ptr, NULL) != NULL;
+    GC_EXIT();
+    return has;
+}
+#endif
+
 void gc_dump_info(void) {
     gc_info_t info;
     gc_info(&info);
@@ -806,108 +1632,110 @@ void gc_dump_info(void) {
 void gc_dump_alloc_table(void) {
     GC_ENTER();
     static const size_t DUMP_BYTES_PER_LINE = 64;
-    #if !EXTENSIVE_HEAP_PROFILING
-    // When comparing heap output we don't want to print the starting
-    // pointer of the heap because it changes from run to run.
-    mp_printf(&mp_plat_print, "GC memory layout; from %p:", MP_STATE_MEM(gc_pool_start));
-    #endif
-    for (size_t bl = 0; bl < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; bl++) {
-        if (bl % DUMP_BYTES_PER_LINE == 0) {
-            // a new line of blocks
-            {
-                // check if this line contains only free blocks
-                size_t bl2 = bl;
-                while (bl2 < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB && ATB_GET_KIND(bl2) == AT_FREE) {
-                    bl2++;
-                }
-                if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
-                    // there are at least 2 lines containing only free blocks, so abbreviate their printing
-                    mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
-                    bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
-                    if (bl >= MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
-                        // got to end of heap
-                        break;
-                    }
-                }
-            }
-            // print header for new line of blocks
-            // (the cast to uint32_t is for 16-bit ports)
-            //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
-            mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
-        }
-        int c = ' ';
-        switch (ATB_GET_KIND(bl)) {
-            case AT_FREE: c = '.'; break;
-            /* this prints out if the object is reachable from BSS or STACK (for unix only)
-            case AT_HEAD: {
-                c = 'h';
-                void **ptrs = (void**)(void*)&mp_state_ctx;
-                mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
-                for (mp_uint_t i = 0; i < len; i++) {
-                    mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                    if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                        c = 'B';
-                        break;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        #if !EXTENSIVE_HEAP_PROFILING
+        // When comparing heap output we don't want to print the starting
+        // pointer of the heap because it changes from run to run.
+        mp_printf(&mp_plat_print, "GC memory layout; from %p:", area->gc_pool_start);
+        #endif
+        for (size_t bl = 0; bl < AREA_BLOCKS(area); bl++) {
+            if (bl % DUMP_BYTES_PER_LINE == 0) {
+                // a new line of blocks
+                {
+                    // check if this line contains only free blocks
+                    size_t bl2 = bl;
+                    while (bl2 < AREA_BLOCKS(area) && ATB_GET_KIND(area, bl2) == AT_FREE) {
+                        bl2++;
                     }
-                }
-                if (c == 'h') {
-                    ptrs = (void**)&c;
-                    len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
-                    for (mp_uint_t i = 0; i < len; i++) {
-                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                            c = 'S';
+                    if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
+                        // there are at least 2 lines containing only free blocks, so abbreviate their printing
+                        mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
+                        bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
+                        if (bl >= AREA_BLOCKS(area)) {
+                            // got to end of heap
                             break;
                         }
                     }
                 }
-                break;
+                // print header for new line of blocks
+                // (the cast to uint32_t is for 16-bit ports)
+                //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(area, bl) & (uint32_t)0xfffff));
+                mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
             }
-            */
-            /* this prints the uPy object type of the head block */
-            case AT_HEAD: {
-                void **ptr = (void**)(MP_STATE_MEM(gc_pool_start) + bl * BYTES_PER_BLOCK);
-                if (*ptr == &mp_type_tuple) { c = 'T'; }
-                else if (*ptr == &mp_type_list) { c = 'L'; }
-                else if (*ptr == &mp_type_dict) { c = 'D'; }
-                else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
-                #if MICROPY_PY_BUILTINS_BYTEARRAY
-                else if (*ptr == &mp_type_bytearray) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_ARRAY
-                else if (*ptr == &mp_type_array) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_BUILTINS_FLOAT
-                else if (*ptr == &mp_type_float) { c = 'F'; }
-                #endif
-                else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
-                else if (*ptr == &mp_type_module) { c = 'M'; }
-                else {
+            int c = ' ';
+            switch (ATB_GET_KIND(area, bl)) {
+                case AT_FREE: c = '.'; break;
+                /* this prints out if the object is reachable from BSS or STACK (for unix only)
+                case AT_HEAD: {
                     c = 'h';
-                    #if 0
-                    // This code prints "Q" for qstr-pool data, and "q" for qstr-str
-                    // data.  It can be useful to see how qstrs are being allocated,
-                    // but is disabled by default because it is very slow.
-                    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
-                        if ((qstr_pool_t*)ptr == pool) {
-                            c = 'Q';
+                    void **ptrs = (void**)(void*)&mp_state_ctx;
+                    mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
+                    for (mp_uint_t i = 0; i < len; i++) {
+                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                            c = 'B';
                             break;
                         }
-                        for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
-                            if ((const byte*)ptr == *q) {
-                                c = 'q';
+                    }
+                    if (c == 'h') {
+                        ptrs = (void**)&c;
+                        len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
+                        for (mp_uint_t i = 0; i < len; i++) {
+                            mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                            if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                                c = 'S';
                                 break;
                             }
                         }
                     }
+                    break;
+                }
+                */
+                /* this prints the uPy object type of the head block */
+                case AT_HEAD: {
+                    void **ptr = (void**)(area->gc_pool_start + bl * BYTES_PER_BLOCK);
+                    if (*ptr == &mp_type_tuple) { c = 'T'; }
+                    else if (*ptr == &mp_type_list) { c = 'L'; }
+                    else if (*ptr == &mp_type_dict) { c = 'D'; }
+                    else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
+                    #if MICROPY_PY_BUILTINS_BYTEARRAY
+                    else if (*ptr == &mp_type_bytearray) { c = 'A'; }
+                    #endif
+                    #if MICROPY_PY_ARRAY
+                    else if (*ptr == &mp_type_array) { c = 'A'; }
                     #endif
+                    #if MICROPY_PY_BUILTINS_FLOAT
+                    else if (*ptr == &mp_type_float) { c = 'F'; }
+                    #endif
+                    else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
+                    else if (*ptr == &mp_type_module) { c = 'M'; }
+                    else {
+                        c = 'h';
+                        #if 0
+                        // This code prints "Q" for qstr-pool data, and "q" for qstr-str
+                        // data.  It can be useful to see how qstrs are being allocated,
+                        // but is disabled by default because it is very slow.
+                        for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
+                            if ((qstr_pool_t*)ptr == pool) {
+                                c = 'Q';
+                                break;
+                            }
+                            for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
+                                if ((const byte*)ptr == *q) {
+                                    c = 'q';
+                                    break;
+                                }
+                            }
+                        }
+                        #endif
+                    }
+                    break;
                 }
-                break;
+                case AT_TAIL: c = '='; break;
+                case AT_MARK: c = 'm'; break;
             }
-            case AT_TAIL: c = '='; break;
-            case AT_MARK: c = 'm'; break;
+            mp_printf(&mp_plat_print, "%c", c);
         }
-        mp_printf(&mp_plat_print, "%c", c);
     }
     mp_print_str(&mp_plat_print, "\n");
     GC_EXIT();
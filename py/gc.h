@@ -33,6 +33,18 @@
 
 void gc_init(void *start, void *end);
 
+#if MICROPY_GC_SPLIT_HEAP
+// Give the GC another area of RAM, after gc_init; the area's own state is
+// kept at its start
+void gc_add(void *start, void *end);
+#endif
+
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+// Provided by the port: gc_add an area that can hold an allocation of
+// n_bytes, returning false if it can't get the RAM
+bool gc_grow_heap(size_t n_bytes);
+#endif
+
 // These lock/unlock functions can be nested.
 // They can be used to prevent the GC from allocating/freeing.
 void gc_lock(void);
@@ -48,6 +60,14 @@ void gc_collect_end(void);
 // Use this function to sweep the whole heap and run all finalisers
 void gc_sweep_all(void);
 
+#if MICROPY_GC_INCREMENTAL
+// Sweep up to n_blocks blocks of a pending sweep, returning whether there
+// are more
+bool gc_sweep_step(size_t n_blocks);
+// Whether enough has been allocated for gc.step to start a collection
+bool gc_collect_due(void);
+#endif
+
 enum {
     GC_ALLOC_FLAG_HAS_FINALISER = 1,
 };
@@ -55,8 +75,24 @@ enum {
 void *gc_alloc(size_t n_bytes, unsigned int alloc_flags);
 void gc_free(void *ptr); // does not call finaliser
 size_t gc_nbytes(const void *ptr);
+// Whether ptr points anywhere in the heap, not just to the start of a block
+bool gc_is_heap_ptr(const void *ptr);
 void *gc_realloc(void *ptr, size_t n_bytes, bool allow_move);
 
+#if MICROPY_GC_ARENA
+// Reserve n_bytes of heap for the current thread's small allocations, and
+// return the arena, or NULL if there's no memory.  gc_arena_pop frees it and
+// everything allocated in it, which must not be used after; with retire true
+// it leaves the arena to the GC instead, to free once nothing points into it.
+struct _gc_arena_t *gc_arena_push(size_t n_bytes);
+void gc_arena_pop(struct _gc_arena_t *arena, bool retire);
+// For memory that may outlive the current arena: stop allocating from the
+// arena until gc_arena_restore is given what gc_arena_suspend returned
+struct _gc_arena_t *gc_arena_suspend(void);
+void gc_arena_restore(struct _gc_arena_t *arena);
+bool gc_arena_has(const void *ptr);
+#endif
+
 typedef struct _gc_info_t {
     size_t total;
     size_t used;
@@ -68,6 +104,10 @@ typedef struct _gc_info_t {
 } gc_info_t;
 
 void gc_info(gc_info_t *info);
+// Count the free runs of blocks in the heap by length: runs[i] is the number
+// of runs 2**i to 2**(i+1)-1 blocks long, except that the last entry also
+// counts the longer ones.  Returns the length in blocks of the longest run.
+size_t gc_free_runs(size_t *runs, size_t n_runs);
 void gc_dump_info(void);
 void gc_dump_alloc_table(void);
 
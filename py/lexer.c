@@ -209,7 +209,6 @@ STATIC const uint8_t tok_enc_kind[] = {
 };
 
 // must have the same order as enum in lexer.h
-// must be sorted according to strcmp
 STATIC const char *const tok_kw[] = {
     "False",
     "None",
@@ -251,6 +250,55 @@ STATIC const char *const tok_kw[] = {
     "yield",
 };
 
+// A perfect hash of the keywords, mapping the hash of a name to the keyword
+// it may be, or MP_TOKEN_END.  A name is at least 1 char and null terminated,
+// so s[1] can be read.  The multipliers were found by search so that no two
+// keywords collide; if keywords are added, search for new ones.
+#define TOK_KW_HASH(s, len) (((byte)(s)[0] + (byte)(s)[1] * 15 + (byte)(s)[(len) - 1] * 24 + (len) * 41) & 63)
+
+STATIC const uint8_t tok_kw_hash[64] = {
+    [0] = MP_TOKEN_KW_IS,
+    [2] = MP_TOKEN_KW_WITH,
+    [3] = MP_TOKEN_KW_EXCEPT,
+    [4] = MP_TOKEN_KW_FINALLY,
+    [5] = MP_TOKEN_KW_IF,
+    #if MICROPY_PY_ASYNC_AWAIT
+    [7] = MP_TOKEN_KW_AWAIT,
+    #endif
+    [9] = MP_TOKEN_KW___DEBUG__,
+    [10] = MP_TOKEN_KW_NOT,
+    [11] = MP_TOKEN_KW_PASS,
+    [12] = MP_TOKEN_KW_CLASS,
+    [13] = MP_TOKEN_KW_YIELD,
+    [17] = MP_TOKEN_KW_GLOBAL,
+    [18] = MP_TOKEN_KW_FOR,
+    [20] = MP_TOKEN_KW_WHILE,
+    [21] = MP_TOKEN_KW_ELSE,
+    [23] = MP_TOKEN_KW_NONLOCAL,
+    [26] = MP_TOKEN_KW_DEF,
+    [30] = MP_TOKEN_KW_TRUE,
+    [31] = MP_TOKEN_KW_OR,
+    [34] = MP_TOKEN_KW_IMPORT,
+    [35] = MP_TOKEN_KW_RETURN,
+    [36] = MP_TOKEN_KW_CONTINUE,
+    [37] = MP_TOKEN_KW_BREAK,
+    [38] = MP_TOKEN_KW_RAISE,
+    [41] = MP_TOKEN_KW_LAMBDA,
+    [42] = MP_TOKEN_KW_DEL,
+    [43] = MP_TOKEN_KW_NONE,
+    [45] = MP_TOKEN_KW_ELIF,
+    [46] = MP_TOKEN_KW_AND,
+    [48] = MP_TOKEN_KW_FROM,
+    #if MICROPY_PY_ASYNC_AWAIT
+    [51] = MP_TOKEN_KW_ASYNC,
+    #endif
+    [52] = MP_TOKEN_KW_ASSERT,
+    [53] = MP_TOKEN_KW_TRY,
+    [56] = MP_TOKEN_KW_AS,
+    [58] = MP_TOKEN_KW_FALSE,
+    [61] = MP_TOKEN_KW_IN,
+};
+
 // This is called with CUR_CHAR() before first hex digit, and should return with
 // it pointing to last hex digit
 // num_digits must be greater than zero
@@ -545,17 +593,11 @@ void mp_lexer_to_next(mp_lexer_t *lex) {
         // so the parser gives a syntax error on, eg, x.__debug__.  Otherwise, we
         // need to check for this special token in many places in the compiler.
         const char *s = vstr_null_terminated_str(&lex->vstr);
-        for (size_t i = 0; i < MP_ARRAY_SIZE(tok_kw); i++) {
-            int cmp = strcmp(s, tok_kw[i]);
-            if (cmp == 0) {
-                lex->tok_kind = MP_TOKEN_KW_FALSE + i;
-                if (lex->tok_kind == MP_TOKEN_KW___DEBUG__) {
-                    lex->tok_kind = (MP_STATE_VM(mp_optimise_value) == 0 ? MP_TOKEN_KW_TRUE : MP_TOKEN_KW_FALSE);
-                }
-                break;
-            } else if (cmp < 0) {
-                // Table is sorted and comparison was less-than, so stop searching
-                break;
+        mp_token_kind_t kw = tok_kw_hash[TOK_KW_HASH(s, lex->vstr.len)];
+        if (kw != MP_TOKEN_END && strcmp(s, tok_kw[kw - MP_TOKEN_KW_FALSE]) == 0) {
+            lex->tok_kind = kw;
+            if (lex->tok_kind == MP_TOKEN_KW___DEBUG__) {
+                lex->tok_kind = (MP_STATE_VM(mp_optimise_value) == 0 ? MP_TOKEN_KW_TRUE : MP_TOKEN_KW_FALSE);
             }
         }
 
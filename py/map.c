@@ -32,6 +32,7 @@
 #include "py/mpconfig.h"
 #include "py/misc.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -76,6 +77,36 @@ STATIC size_t get_hash_alloc_greater_or_equal_to(size_t x) {
 /******************************************************************************/
 /* map                                                                        */
 
+#if MICROPY_PY_THREAD_MAP_LOCKS
+// Without the GIL, a map that can change is locked while it is looked up or
+// changed, with one of a few locks picked by the map's address.  A lookup
+// may run __hash__ or __eq__ code, so the thread holding a lock can take it
+// again.  Tables replaced by a rehash are left for the GC to free, as
+// another thread may still be reading a value from a slot it looked up.
+
+// Returns the lock taken, or NULL if there's only been one thread so far.
+STATIC mp_map_lock_t *map_lock(const mp_map_t *map) {
+    if (!MP_STATE_VM(map_locking)) {
+        return NULL;
+    }
+    mp_map_lock_t *lock = &MP_STATE_VM(map_locks)[((uintptr_t)map / sizeof(mp_map_t)) % MICROPY_PY_THREAD_MAP_LOCKS];
+    mp_state_thread_t *ts = mp_thread_get_state();
+    if (lock->owner != ts) {
+        mp_thread_mutex_lock(&lock->mutex, 1);
+        lock->owner = ts;
+    }
+    lock->depth += 1;
+    return lock;
+}
+
+STATIC void map_unlock(mp_map_lock_t *lock) {
+    if (lock != NULL && --lock->depth == 0) {
+        lock->owner = NULL;
+        mp_thread_mutex_unlock(&lock->mutex);
+    }
+}
+#endif
+
 void mp_map_init(mp_map_t *map, size_t n) {
     if (n == 0) {
         map->alloc = 0;
@@ -88,6 +119,7 @@ void mp_map_init(mp_map_t *map, size_t n) {
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 0;
     map->is_ordered = 0;
+    map->is_indexed = 0;
 }
 
 void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
@@ -96,26 +128,145 @@ void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 1;
     map->is_ordered = 1;
+    map->is_indexed = 0;
     map->table = (mp_map_elem_t*)table;
 }
 
+// get hash of index, with fast path for common case of qstr
+STATIC inline mp_uint_t map_hash(mp_obj_t index) {
+    if (mp_obj_is_qstr(index)) {
+        return qstr_hash(MP_OBJ_QSTR_VALUE(index));
+    } else {
+        return MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
+    }
+}
+
+#if MICROPY_PY_COLLECTIONS_ORDEREDDICT && MICROPY_OPT_MAP_ORDERED_INDEX
+// An indexed ordered map has, after its alloc entries, a hash table of
+// map_index_len() slots which hold 1 + the position of an entry, or 0 if
+// empty.  Slots are 8 bits wide if that's enough and 16 bits otherwise, and
+// collisions are resolved by linear probing.  Smaller maps aren't indexed as
+// it's just as quick to search them.
+#define MAP_INDEX_MIN (8)
+#define MAP_INDEX_MAX (0xffff)
+
+STATIC size_t map_index_len(size_t alloc) {
+    // keep the slots at most 2/3 full
+    size_t len = 16;
+    while (len < alloc + alloc / 2) {
+        len <<= 1;
+    }
+    return len;
+}
+
+STATIC size_t map_table_bytes(const mp_map_t *map) {
+    size_t n = map->alloc * sizeof(mp_map_elem_t);
+    if (map->is_indexed) {
+        n += map_index_len(map->alloc) * (map->alloc < 0xff ? 1 : 2);
+    }
+    return n;
+}
+
+STATIC inline size_t map_index_get(const mp_map_t *map, size_t slot) {
+    const void *index = &map->table[map->alloc];
+    return map->alloc < 0xff ? ((const uint8_t*)index)[slot] : ((const uint16_t*)index)[slot];
+}
+
+STATIC inline void map_index_set(mp_map_t *map, size_t slot, size_t val) {
+    void *index = &map->table[map->alloc];
+    if (map->alloc < 0xff) {
+        ((uint8_t*)index)[slot] = val;
+    } else {
+        ((uint16_t*)index)[slot] = val;
+    }
+}
+
+STATIC void map_index_add(mp_map_t *map, mp_uint_t hash, size_t pos) {
+    size_t mask = map_index_len(map->alloc) - 1;
+    size_t slot = hash & mask;
+    while (map_index_get(map, slot) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    map_index_set(map, slot, pos + 1);
+}
+
+// Empty the given slot, moving back any later entries of its run that
+// would otherwise no longer be found from their hash.
+STATIC void map_index_remove(mp_map_t *map, size_t slot) {
+    size_t mask = map_index_len(map->alloc) - 1;
+    for (size_t next = (slot + 1) & mask;; next = (next + 1) & mask) {
+        size_t val = map_index_get(map, next);
+        if (val == 0) {
+            break;
+        }
+        size_t home = map_hash(map->table[val - 1].key) & mask;
+        // move the entry back unless its home is cyclically in (slot, next]
+        if (slot <= next ? (home <= slot || home > next) : (home <= slot && home > next)) {
+            map_index_set(map, slot, val);
+            slot = next;
+        }
+    }
+    map_index_set(map, slot, 0);
+}
+
+// Resize the entries of an ordered map to new_alloc, and index them if the
+// map is large enough.
+STATIC void map_ordered_resize(mp_map_t *map, size_t new_alloc) {
+    size_t old_bytes = map_table_bytes(map);
+    size_t old_alloc = map->alloc;
+    map->is_indexed = MAP_INDEX_MIN < new_alloc && new_alloc < MAP_INDEX_MAX;
+    map->alloc = new_alloc;
+    size_t new_bytes = map_table_bytes(map);
+    map->alloc = old_alloc;
+    map->table = (mp_map_elem_t*)m_renew(byte, map->table, old_bytes, new_bytes);
+    map->alloc = new_alloc;
+    memset(&map->table[map->used], 0, new_bytes - map->used * sizeof(mp_map_elem_t));
+    if (map->is_indexed) {
+        for (size_t i = 0; i < map->used; i++) {
+            map_index_add(map, map_hash(map->table[i].key), i);
+        }
+    }
+}
+#else
+STATIC size_t map_table_bytes(const mp_map_t *map) {
+    return map->alloc * sizeof(mp_map_elem_t);
+}
+#endif
+
 // Differentiate from mp_map_clear() - semantics is different
 void mp_map_deinit(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(byte, map->table, map_table_bytes(map));
     }
     map->used = map->alloc = 0;
+    map->is_indexed = 0;
 }
 
 void mp_map_clear(mp_map_t *map) {
+    #if MICROPY_PY_THREAD_MAP_LOCKS
+    mp_map_lock_t *lock = map_lock(map);
+    // a table on the heap is left in place for the GC to free, so an unlocked
+    // read that checks an index against the old alloc still reads a table
+    if (map->is_fixed) {
+        map->table = NULL;
+    }
+    map->alloc = 0;
+    map->used = 0;
+    map->all_keys_are_qstrs = 1;
+    map->is_fixed = 0;
+    map->is_indexed = 0;
+    map_unlock(lock);
+    #else
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(byte, map->table, map_table_bytes(map));
     }
     map->alloc = 0;
     map->used = 0;
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 0;
+    map->is_indexed = 0;
     map->table = NULL;
+    #endif
 }
 
 STATIC void mp_map_rehash(mp_map_t *map) {
@@ -123,27 +274,63 @@ STATIC void mp_map_rehash(mp_map_t *map) {
     size_t new_alloc = get_hash_alloc_greater_or_equal_to(map->alloc + 1);
     DEBUG_printf("mp_map_rehash(%p): " UINT_FMT " -> " UINT_FMT "\n", map, old_alloc, new_alloc);
     mp_map_elem_t *old_table = map->table;
+    #if MICROPY_GC_ARENA
+    // a table from outside an arena stays outside, as the map may outlive it
+    struct _gc_arena_t *arena = gc_arena_has(old_table) ? NULL : gc_arena_suspend();
     mp_map_elem_t *new_table = m_new0(mp_map_elem_t, new_alloc);
+    gc_arena_restore(arena);
+    #else
+    mp_map_elem_t *new_table = m_new0(mp_map_elem_t, new_alloc);
+    #endif
     // If we reach this point, table resizing succeeded, now we can edit the old map.
+    // The table is replaced before alloc grows, so that a read by another
+    // thread that checks an index against alloc stays inside the table.
+    map->table = new_table;
     map->alloc = new_alloc;
     map->used = 0;
     map->all_keys_are_qstrs = 1;
-    map->table = new_table;
     for (size_t i = 0; i < old_alloc; i++) {
         if (old_table[i].key != MP_OBJ_NULL && old_table[i].key != MP_OBJ_SENTINEL) {
             mp_map_lookup(map, old_table[i].key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = old_table[i].value;
         }
     }
+    #if !MICROPY_PY_THREAD_MAP_LOCKS
     m_del(mp_map_elem_t, old_table, old_alloc);
+    #endif
 }
 
+#if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+// remove the element from an ordered map by moving the rest of the array down
+STATIC mp_map_elem_t *map_ordered_remove(mp_map_t *map, mp_map_elem_t *elem) {
+    mp_obj_t value = elem->value;
+    --map->used;
+    memmove(elem, elem + 1, (&map->table[map->used] - elem) * sizeof(*elem));
+    // put the found element after the end so the caller can access it if needed
+    elem = &map->table[map->used];
+    elem->key = MP_OBJ_NULL;
+    elem->value = value;
+    return elem;
+}
+#endif
+
+#if MICROPY_OPT_ROM_MAP_LOOKUP_CACHE
+// smaller maps are quicker to search
+#define ROM_MAP_LOOKUP_CACHE_MIN (8)
+#define ROM_MAP_LOOKUP_CACHE_SLOT(map, index) \
+    ((((uintptr_t)(map) >> 2) ^ MP_OBJ_QSTR_VALUE(index)) & (MICROPY_OPT_ROM_MAP_LOOKUP_CACHE_SIZE - 1))
+#endif
+
 // MP_MAP_LOOKUP behaviour:
 //  - returns NULL if not found, else the slot it was found in with key,value non-null
 // MP_MAP_LOOKUP_ADD_IF_NOT_FOUND behaviour:
 //  - returns slot, with key non-null and value=MP_OBJ_NULL if it was added
 // MP_MAP_LOOKUP_REMOVE_IF_FOUND behaviour:
 //  - returns NULL if not found, else the slot if was found in with key null and value non-null
+#if MICROPY_PY_THREAD_MAP_LOCKS
+STATIC mp_map_elem_t *map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+#else
 mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+#endif
     // If the map is a fixed array then we must only be called for a lookup
     assert(!map->is_fixed || lookup_kind == MP_MAP_LOOKUP);
 
@@ -168,33 +355,94 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
 
     // if the map is an ordered array then we must do a brute force linear search
     if (map->is_ordered) {
+        #if MICROPY_OPT_ROM_MAP_LOOKUP_CACHE
+        // fixed tables of many qstrs, such as the globals of built-in modules
+        // and the locals of built-in types, first try where the key was found
+        // last time, from a table of guesses picked by the map and key
+        uint8_t *guess = NULL;
+        if (map->is_fixed && compare_only_ptrs && map->used > ROM_MAP_LOOKUP_CACHE_MIN) {
+            guess = &MP_STATE_VM(rom_map_lookup_cache)[ROM_MAP_LOOKUP_CACHE_SLOT(map, index)];
+            if (*guess < map->used && map->table[*guess].key == index) {
+                return &map->table[*guess];
+            }
+        }
+        #endif
+        #if MICROPY_PY_COLLECTIONS_ORDEREDDICT && MICROPY_OPT_MAP_ORDERED_INDEX
+        // keys of OrderedDicts must be hashable, as for hash tables
+        mp_uint_t hash = 0;
+        if (map->is_indexed || (!map->is_fixed && lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)) {
+            hash = map_hash(index);
+        }
+        if (map->is_indexed) {
+            size_t mask = map_index_len(map->alloc) - 1;
+            for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+                size_t val = map_index_get(map, slot);
+                if (val == 0) {
+                    break;
+                }
+                mp_map_elem_t *elem = &map->table[val - 1];
+                if (elem->key == index || (!compare_only_ptrs && mp_obj_equal(elem->key, index))) {
+                    if (MP_UNLIKELY(lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND)) {
+                        // remove the found element from the index, and renumber
+                        // the elements that are about to move down
+                        map_index_remove(map, slot);
+                        if (val < map->used) {
+                            for (size_t i = 0, len = mask + 1; i < len; i++) {
+                                size_t v = map_index_get(map, i);
+                                if (v > val) {
+                                    map_index_set(map, i, v - 1);
+                                }
+                            }
+                        }
+                        elem = map_ordered_remove(map, elem);
+                    }
+                    return elem;
+                }
+            }
+            goto not_found;
+        }
+        #endif
         for (mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->used]; elem < top; elem++) {
             if (elem->key == index || (!compare_only_ptrs && mp_obj_equal(elem->key, index))) {
+                #if MICROPY_OPT_ROM_MAP_LOOKUP_CACHE
+                if (guess != NULL) {
+                    *guess = elem - &map->table[0];
+                }
+                #endif
                 #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
                 if (MP_UNLIKELY(lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND)) {
-                    // remove the found element by moving the rest of the array down
-                    mp_obj_t value = elem->value;
-                    --map->used;
-                    memmove(elem, elem + 1, (top - elem - 1) * sizeof(*elem));
-                    // put the found element after the end so the caller can access it if needed
-                    elem = &map->table[map->used];
-                    elem->key = MP_OBJ_NULL;
-                    elem->value = value;
+                    elem = map_ordered_remove(map, elem);
                 }
                 #endif
                 return elem;
             }
         }
         #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+        #if MICROPY_OPT_MAP_ORDERED_INDEX
+    not_found:
+        #endif
         if (MP_LIKELY(lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)) {
             return NULL;
         }
+        #if MICROPY_OPT_MAP_ORDERED_INDEX
+        if (map->used == map->alloc) {
+            // grow geometrically once indexed, as the index is rebuilt each time
+            map_ordered_resize(map, map->alloc + (map->alloc < MAP_INDEX_MIN ? 4 : map->alloc / 2));
+        } else if (!map->is_indexed && MAP_INDEX_MIN < map->alloc && map->alloc < MAP_INDEX_MAX) {
+            // a copied map, or one that was made ordered after being allocated
+            map_ordered_resize(map, map->alloc);
+        }
+        if (map->is_indexed) {
+            map_index_add(map, hash, map->used);
+        }
+        #else
         if (map->used == map->alloc) {
             // TODO: Alloc policy
             map->alloc += 4;
             map->table = m_renew(mp_map_elem_t, map->table, map->used, map->alloc);
             mp_seq_clear(map->table, map->used, map->alloc, sizeof(*map->table));
         }
+        #endif
         mp_map_elem_t *elem = map->table + map->used++;
         elem->key = index;
         if (!mp_obj_is_qstr(index)) {
@@ -216,13 +464,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
     }
 
-    // get hash of index, with fast path for common case of qstr
-    mp_uint_t hash;
-    if (mp_obj_is_qstr(index)) {
-        hash = qstr_hash(MP_OBJ_QSTR_VALUE(index));
-    } else {
-        hash = MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
-    }
+    mp_uint_t hash = map_hash(index);
 
     size_t pos = hash % map->alloc;
     size_t start_pos = pos;
@@ -295,6 +537,45 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
     }
 }
 
+#if MICROPY_PY_THREAD_MAP_LOCKS
+mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+    if (map->is_fixed || !MP_STATE_VM(map_locking)) {
+        return map_lookup(map, index, lookup_kind);
+    }
+    mp_map_lock_t *lock = map_lock(map);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_map_elem_t *elem = map_lookup(map, index, lookup_kind);
+        nlr_pop();
+        map_unlock(lock);
+        return elem;
+    } else {
+        // __hash__ or __eq__ raised, or the table couldn't grow
+        map_unlock(lock);
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+void mp_map_store(mp_map_t *map, mp_obj_t index, mp_obj_t value) {
+    // hold the lock until the value is set, so that a rehash by another
+    // thread doesn't copy the slot before then
+    if (!MP_STATE_VM(map_locking)) {
+        map_lookup(map, index, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+        return;
+    }
+    mp_map_lock_t *lock = map_lock(map);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_map_lookup(map, index, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+        nlr_pop();
+        map_unlock(lock);
+    } else {
+        map_unlock(lock);
+        nlr_jump(nlr.ret_val);
+    }
+}
+#endif
+
 /******************************************************************************/
 /* set                                                                        */
 
@@ -311,7 +592,13 @@ STATIC void mp_set_rehash(mp_set_t *set) {
     mp_obj_t *old_table = set->table;
     set->alloc = get_hash_alloc_greater_or_equal_to(set->alloc + 1);
     set->used = 0;
+    #if MICROPY_GC_ARENA
+    struct _gc_arena_t *arena = gc_arena_has(old_table) ? NULL : gc_arena_suspend();
+    set->table = m_new0(mp_obj_t, set->alloc);
+    gc_arena_restore(arena);
+    #else
     set->table = m_new0(mp_obj_t, set->alloc);
+    #endif
     for (size_t i = 0; i < old_alloc; i++) {
         if (old_table[i] != MP_OBJ_NULL && old_table[i] != MP_OBJ_SENTINEL) {
             mp_set_lookup(set, old_table[i], MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
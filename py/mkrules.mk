@@ -107,16 +107,23 @@ ifneq ($(FROZEN_MPY_DIR),)
 FROZEN_MPY_PY_FILES := $(shell find -L $(FROZEN_MPY_DIR) -type f -name '*.py' | $(SED) -e 's=^$(FROZEN_MPY_DIR)/==')
 FROZEN_MPY_MPY_FILES := $(addprefix $(BUILD)/frozen_mpy/,$(FROZEN_MPY_PY_FILES:.py=.mpy))
 
+# FROZEN_MPY_PROFILE can name files holding micropython.profile() output; the
+# hot functions they show are compiled native and placed in RAM if the port
+# defines MICROPY_FROZEN_HOT_ATTR
+ifneq ($(FROZEN_MPY_PROFILE),)
+MPY_TOOL_FLAGS += $(addprefix --profile ,$(FROZEN_MPY_PROFILE))
+endif
+
 # to build .mpy files from .py files
-$(BUILD)/frozen_mpy/%.mpy: $(FROZEN_MPY_DIR)/%.py
+$(BUILD)/frozen_mpy/%.mpy: $(FROZEN_MPY_DIR)/%.py $(FROZEN_MPY_PROFILE)
 	@$(ECHO) "MPY $<"
 	$(Q)$(MKDIR) -p $(dir $@)
-	$(Q)$(MPY_CROSS) -o $@ -s $(<:$(FROZEN_MPY_DIR)/%=%) $(MPY_CROSS_FLAGS) $<
+	$(Q)$(MPY_CROSS) -o $@ -s $(<:$(FROZEN_MPY_DIR)/%=%) $(MPY_CROSS_FLAGS) $(if $(FROZEN_MPY_PROFILE),$(shell $(PYTHON) $(TOP)/tools/hotfuncs.py -s $(<:$(FROZEN_MPY_DIR)/%=%) $(FROZEN_MPY_PROFILE))) $<
 
 # to build frozen_mpy.c from all .mpy files
 $(BUILD)/frozen_mpy.c: $(FROZEN_MPY_MPY_FILES) $(BUILD)/genhdr/qstrdefs.generated.h
 	@$(ECHO) "GEN $@"
-	$(Q)$(MPY_TOOL) -f -q $(BUILD)/genhdr/qstrdefs.preprocessed.h $(FROZEN_MPY_MPY_FILES) > $@
+	$(Q)$(MPY_TOOL) -f -q $(BUILD)/genhdr/qstrdefs.preprocessed.h $(MPY_TOOL_FLAGS) $(FROZEN_MPY_MPY_FILES) > $@
 endif
 
 ifneq ($(PROG),)
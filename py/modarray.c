@@ -24,13 +24,352 @@
  * THE SOFTWARE.
  */
 
+#include <limits.h>
+
 #include "py/builtin.h"
+#include "py/runtime.h"
+#include "py/binary.h"
+#include "py/objint.h"
 
 #if MICROPY_PY_ARRAY
 
+#if MICROPY_PY_ARRAY_OPS
+
+// These functions take anything with the buffer protocol and a numeric
+// typecode, and each has a loop for every typecode.  Integer arithmetic wraps
+// around like storing to an array does, but sums are exact.
+
+// Call INT(type, signed, min, max) or FLOAT(type) with the C type for typecode
+#define ARRAY_OPS_DISPATCH(typecode, INT, FLOAT) \
+    switch (typecode) { \
+        case 'b': INT(int8_t, true, INT8_MIN, INT8_MAX); break; \
+        case 'B': INT(uint8_t, false, 0, UINT8_MAX); break; \
+        case 'h': INT(short, true, SHRT_MIN, SHRT_MAX); break; \
+        case 'H': INT(unsigned short, false, 0, USHRT_MAX); break; \
+        case 'i': INT(int, true, INT_MIN, INT_MAX); break; \
+        case 'I': INT(unsigned int, false, 0, UINT_MAX); break; \
+        case 'l': INT(long, true, LONG_MIN, LONG_MAX); break; \
+        case 'L': INT(unsigned long, false, 0, ULONG_MAX); break; \
+        case 'q': INT(long long, true, LLONG_MIN, LLONG_MAX); break; \
+        case 'Q': INT(unsigned long long, false, 0, ULLONG_MAX); break; \
+        ARRAY_OPS_DISPATCH_FLOAT(FLOAT) \
+        default: mp_raise_ValueError("bad typecode"); \
+    }
+
+#if MICROPY_PY_BUILTINS_FLOAT
+#define ARRAY_OPS_DISPATCH_FLOAT(FLOAT) \
+    case 'f': FLOAT(float); break; \
+    case 'd': FLOAT(double); break;
+#else
+#define ARRAY_OPS_DISPATCH_FLOAT(FLOAT)
+#endif
+
+// Get the buffer of an array-like object, returning the number of items
+STATIC size_t array_ops_get_buffer(mp_obj_t obj, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    mp_get_buffer_raise(obj, bufinfo, flags);
+    if (bufinfo->typecode == BYTEARRAY_TYPECODE) {
+        bufinfo->typecode = 'B';
+    }
+    return bufinfo->len / mp_binary_get_size('@', bufinfo->typecode, NULL);
+}
+
+// Get the buffer of the second argument, which must be like the first, or
+// return false if it's a number
+STATIC bool array_ops_get_rhs(mp_obj_t obj, const mp_buffer_info_t *lhs, const void **rhs) {
+    mp_buffer_info_t bufinfo;
+    if (!mp_get_buffer(obj, &bufinfo, MP_BUFFER_READ)) {
+        return false;
+    }
+    if (bufinfo.typecode == BYTEARRAY_TYPECODE) {
+        bufinfo.typecode = 'B';
+    }
+    if (bufinfo.typecode != lhs->typecode || bufinfo.len != lhs->len) {
+        mp_raise_ValueError("lhs and rhs should be compatible");
+    }
+    *rhs = bufinfo.buf;
+    return true;
+}
+
+// Whole number arguments are taken as long long, so they fit any typecode
+STATIC long long array_ops_get_ll(mp_obj_t obj) {
+    #if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
+    if (!mp_obj_is_small_int(obj) && mp_obj_is_int(obj)) {
+        long long val;
+        mp_obj_int_to_bytes_impl(obj, MP_ENDIANNESS_BIG, sizeof(val), (byte *)&val);
+        return val;
+    }
+    #endif
+    return mp_obj_get_int(obj);
+}
+
+#define ARRAY_OPS_ELEMENTWISE(OP) \
+    mp_buffer_info_t bufinfo; \
+    size_t n = array_ops_get_buffer(lhs_in, &bufinfo, MP_BUFFER_RW); \
+    const void *rhs = NULL; \
+    bool is_array = array_ops_get_rhs(rhs_in, &bufinfo, &rhs); \
+    ARRAY_OPS_DISPATCH(bufinfo.typecode, OP##_INT, OP##_FLOAT) \
+    return mp_const_none;
+
+// Integers are added and multiplied as unsigned long long, so they wrap
+typedef unsigned long long array_ops_uint_t;
+
+#define ARRAY_OPS_LOOP(T, W, OP, GET) { \
+        T *a = bufinfo.buf; \
+        if (is_array) { \
+            const T *b = rhs; \
+            for (size_t i = 0; i < n; ++i) { \
+                a[i] = (T)((W)a[i] OP (W)b[i]); \
+            } \
+        } else { \
+            W b = GET(rhs_in); \
+            for (size_t i = 0; i < n; ++i) { \
+                a[i] = (T)((W)a[i] OP b); \
+            } \
+        } \
+}
+
+#define ADD_INT(T, SIGNED, MIN, MAX) ARRAY_OPS_LOOP(T, array_ops_uint_t, +, array_ops_get_ll)
+#define ADD_FLOAT(T) ARRAY_OPS_LOOP(T, mp_float_t, +, mp_obj_get_float)
+#define MUL_INT(T, SIGNED, MIN, MAX) ARRAY_OPS_LOOP(T, array_ops_uint_t, *, array_ops_get_ll)
+#define MUL_FLOAT(T) ARRAY_OPS_LOOP(T, mp_float_t, *, mp_obj_get_float)
+
+STATIC mp_obj_t array_ops_add(mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    ARRAY_OPS_ELEMENTWISE(ADD)
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_ops_add_obj, array_ops_add);
+
+STATIC mp_obj_t array_ops_mul(mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    ARRAY_OPS_ELEMENTWISE(MUL)
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_ops_mul_obj, array_ops_mul);
+
+// a[i] = a[i] * mul >> shift, as fixed point for integers
+#define SCALE_INT(T, SIGNED, MIN, MAX) { \
+        T *a = bufinfo.buf; \
+        for (size_t i = 0; i < n; ++i) { \
+            a[i] = (T)((long long)((array_ops_uint_t)(long long)a[i] * (array_ops_uint_t)mul) >> shift); \
+        } \
+}
+#define SCALE_FLOAT(T) { \
+        T *a = bufinfo.buf; \
+        mp_float_t m = mp_obj_get_float(args[1]) / ((mp_float_t)((array_ops_uint_t)1 << shift)); \
+        for (size_t i = 0; i < n; ++i) { \
+            a[i] = (T)((mp_float_t)a[i] * m); \
+        } \
+}
+
+STATIC mp_obj_t array_ops_scale(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    size_t n = array_ops_get_buffer(args[0], &bufinfo, MP_BUFFER_RW);
+    mp_int_t shift = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
+    if (shift < 0 || shift > 62) {
+        mp_raise_ValueError(NULL);
+    }
+    long long mul = 0;
+    if (bufinfo.typecode != 'f' && bufinfo.typecode != 'd') {
+        mul = array_ops_get_ll(args[1]);
+    }
+    ARRAY_OPS_DISPATCH(bufinfo.typecode, SCALE_INT, SCALE_FLOAT)
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_ops_scale_obj, 2, 3, array_ops_scale);
+
+// The bounds are first brought into the range of the typecode
+STATIC array_ops_uint_t array_ops_get_bound(mp_obj_t obj, long long min, unsigned long long max) {
+    #if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
+    if (!mp_obj_is_small_int(obj) && mp_obj_is_int(obj)) {
+        if (mp_obj_int_sign(obj) < 0) {
+            if (mp_obj_is_true(mp_binary_op(MP_BINARY_OP_LESS, obj, mp_obj_new_int_from_ll(min)))) {
+                return min;
+            }
+        } else if (mp_obj_is_true(mp_binary_op(MP_BINARY_OP_MORE, obj, mp_obj_new_int_from_ull(max)))) {
+            return max;
+        }
+        return array_ops_get_ll(obj);
+    }
+    #endif
+    mp_int_t val = mp_obj_get_int(obj);
+    if (val < min) {
+        return min;
+    } else if (val > 0 && (unsigned long long)val > max) {
+        return max;
+    }
+    return val;
+}
+
+#define CLIP_INT(T, SIGNED, MIN, MAX) { \
+        T *a = bufinfo.buf; \
+        T lo = (T)array_ops_get_bound(lo_in, MIN, MAX); \
+        T hi = (T)array_ops_get_bound(hi_in, MIN, MAX); \
+        for (size_t i = 0; i < n; ++i) { \
+            if (a[i] < lo) { \
+                a[i] = lo; \
+            } else if (a[i] > hi) { \
+                a[i] = hi; \
+            } \
+        } \
+}
+#define CLIP_FLOAT(T) { \
+        T *a = bufinfo.buf; \
+        T lo = mp_obj_get_float(lo_in); \
+        T hi = mp_obj_get_float(hi_in); \
+        for (size_t i = 0; i < n; ++i) { \
+            if (a[i] < lo) { \
+                a[i] = lo; \
+            } else if (a[i] > hi) { \
+                a[i] = hi; \
+            } \
+        } \
+}
+
+STATIC mp_obj_t array_ops_clip(mp_obj_t buf_in, mp_obj_t lo_in, mp_obj_t hi_in) {
+    mp_buffer_info_t bufinfo;
+    size_t n = array_ops_get_buffer(buf_in, &bufinfo, MP_BUFFER_RW);
+    ARRAY_OPS_DISPATCH(bufinfo.typecode, CLIP_INT, CLIP_FLOAT)
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(array_ops_clip_obj, array_ops_clip);
+
+// Sums are accumulated in 64 bits, and spilled into an int object whenever
+// the next term would overflow, so the result doesn't wrap
+typedef struct _array_ops_acc_t {
+    array_ops_uint_t sum;
+    bool is_signed;
+    mp_obj_t big;
+} array_ops_acc_t;
+
+STATIC mp_obj_t array_ops_new_int(array_ops_uint_t val, bool is_signed) {
+    return is_signed ? mp_obj_new_int_from_ll((long long)val) : mp_obj_new_int_from_ull(val);
+}
+
+STATIC void array_ops_acc_add(array_ops_acc_t *acc, array_ops_uint_t term) {
+    array_ops_uint_t sum = acc->sum + term;
+    bool overflow;
+    if (acc->is_signed) {
+        overflow = (long long)((acc->sum ^ sum) & (term ^ sum)) < 0;
+    } else {
+        overflow = sum < term;
+    }
+    if (overflow) {
+        acc->big = mp_binary_op(MP_BINARY_OP_ADD, acc->big, array_ops_new_int(acc->sum, acc->is_signed));
+        sum = term;
+    }
+    acc->sum = sum;
+}
+
+// Products of items within 32 bits fit in 64 bits, larger ones are done as ints
+STATIC void array_ops_acc_add_mul(array_ops_acc_t *acc, array_ops_uint_t a, array_ops_uint_t b) {
+    array_ops_uint_t bias = acc->is_signed ? 0x80000000 : 0;
+    if (a + bias <= 0xffffffff && b + bias <= 0xffffffff) {
+        array_ops_acc_add(acc, a * b);
+    } else {
+        mp_obj_t prod = mp_binary_op(MP_BINARY_OP_MULTIPLY,
+            array_ops_new_int(a, acc->is_signed), array_ops_new_int(b, acc->is_signed));
+        acc->big = mp_binary_op(MP_BINARY_OP_ADD, acc->big, prod);
+    }
+}
+
+// The sum of a[i] * b[i], or of a[i] if b is NULL
+#define SUM_INT(T, SIGNED, MIN, MAX) { \
+        const T *a = bufinfo.buf; \
+        const T *b = rhs; \
+        array_ops_acc_t acc = { 0, SIGNED, MP_OBJ_NEW_SMALL_INT(0) }; \
+        for (size_t i = 0; i < n; ++i) { \
+            if (b == NULL) { \
+                array_ops_acc_add(&acc, (array_ops_uint_t)a[i]); \
+            } else if (sizeof(T) <= 4) { \
+                array_ops_acc_add(&acc, (array_ops_uint_t)a[i] * (array_ops_uint_t)b[i]); \
+            } else { \
+                array_ops_acc_add_mul(&acc, (array_ops_uint_t)a[i], (array_ops_uint_t)b[i]); \
+            } \
+        } \
+        return mp_binary_op(MP_BINARY_OP_ADD, acc.big, array_ops_new_int(acc.sum, SIGNED)); \
+}
+#define SUM_FLOAT(T) { \
+        const T *a = bufinfo.buf; \
+        const T *b = rhs; \
+        mp_float_t sum = 0; \
+        for (size_t i = 0; i < n; ++i) { \
+            sum += b == NULL ? (mp_float_t)a[i] : (mp_float_t)a[i] * (mp_float_t)b[i]; \
+        } \
+        return mp_obj_new_float(sum); \
+}
+
+STATIC mp_obj_t array_ops_sum_helper(mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    mp_buffer_info_t bufinfo;
+    size_t n = array_ops_get_buffer(lhs_in, &bufinfo, MP_BUFFER_READ);
+    const void *rhs = NULL;
+    if (rhs_in != MP_OBJ_NULL) {
+        if (!array_ops_get_rhs(rhs_in, &bufinfo, &rhs)) {
+            mp_raise_TypeError(NULL);
+        }
+    }
+    ARRAY_OPS_DISPATCH(bufinfo.typecode, SUM_INT, SUM_FLOAT)
+    return MP_OBJ_NULL; // not reached
+}
+
+STATIC mp_obj_t array_ops_sum(mp_obj_t buf_in) {
+    return array_ops_sum_helper(buf_in, MP_OBJ_NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_ops_sum_obj, array_ops_sum);
+
+STATIC mp_obj_t array_ops_dot(mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    return array_ops_sum_helper(lhs_in, rhs_in);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_ops_dot_obj, array_ops_dot);
+
+#define MINMAX_LOOP(T) \
+        const T *a = bufinfo.buf; \
+        T best = a[0]; \
+        for (size_t i = 1; i < n; ++i) { \
+            if (is_max ? a[i] > best : a[i] < best) { \
+                best = a[i]; \
+            } \
+        }
+#define MINMAX_INT(T, SIGNED, MIN, MAX) { \
+        MINMAX_LOOP(T) \
+        return SIGNED ? mp_obj_new_int_from_ll(best) : mp_obj_new_int_from_ull(best); \
+}
+#define MINMAX_FLOAT(T) { \
+        MINMAX_LOOP(T) \
+        return mp_obj_new_float(best); \
+}
+
+STATIC mp_obj_t array_ops_minmax(mp_obj_t buf_in, bool is_max) {
+    mp_buffer_info_t bufinfo;
+    size_t n = array_ops_get_buffer(buf_in, &bufinfo, MP_BUFFER_READ);
+    if (n == 0) {
+        mp_raise_ValueError("arg is an empty sequence");
+    }
+    ARRAY_OPS_DISPATCH(bufinfo.typecode, MINMAX_INT, MINMAX_FLOAT)
+    return MP_OBJ_NULL; // not reached
+}
+
+STATIC mp_obj_t array_ops_min(mp_obj_t buf_in) {
+    return array_ops_minmax(buf_in, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_ops_min_obj, array_ops_min);
+
+STATIC mp_obj_t array_ops_max(mp_obj_t buf_in) {
+    return array_ops_minmax(buf_in, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_ops_max_obj, array_ops_max);
+
+#endif // MICROPY_PY_ARRAY_OPS
+
 STATIC const mp_rom_map_elem_t mp_module_array_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_array) },
     { MP_ROM_QSTR(MP_QSTR_array), MP_ROM_PTR(&mp_type_array) },
+    #if MICROPY_PY_ARRAY_OPS
+    { MP_ROM_QSTR(MP_QSTR_add), MP_ROM_PTR(&array_ops_add_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mul), MP_ROM_PTR(&array_ops_mul_obj) },
+    { MP_ROM_QSTR(MP_QSTR_scale), MP_ROM_PTR(&array_ops_scale_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clip), MP_ROM_PTR(&array_ops_clip_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sum), MP_ROM_PTR(&array_ops_sum_obj) },
+    { MP_ROM_QSTR(MP_QSTR_min), MP_ROM_PTR(&array_ops_min_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max), MP_ROM_PTR(&array_ops_max_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dot), MP_ROM_PTR(&array_ops_dot_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_array_globals, mp_module_array_globals_table);
@@ -26,7 +26,11 @@
 
 #include "py/mpstate.h"
 #include "py/obj.h"
+#include "py/objlist.h"
 #include "py/gc.h"
+#if MICROPY_GC_INCREMENTAL
+#include "py/mphal.h"
+#endif
 
 #if MICROPY_PY_GC && MICROPY_ENABLE_GC
 
@@ -41,6 +45,27 @@ STATIC mp_obj_t py_gc_collect(void) {
 }
 MP_DEFINE_CONST_FUN_OBJ_0(gc_collect_obj, py_gc_collect);
 
+#if MICROPY_GC_INCREMENTAL
+// step([us]): spend up to us microseconds, 1000 by default, sweeping.  If no
+// sweep is pending and enough has been allocated since the last collection,
+// first mark the heap, which is done in one go, to start one.  Returns
+// whether there's more sweeping to do.
+STATIC mp_obj_t gc_step(size_t n_args, const mp_obj_t *args) {
+    mp_uint_t us = n_args > 0 ? mp_obj_get_int(args[0]) : 1000;
+    mp_uint_t t0 = mp_hal_ticks_us();
+    if (!MP_STATE_MEM(gc_sweep_pending) && gc_collect_due()) {
+        MP_STATE_MEM(gc_sweep_lazy) = 1;
+        gc_collect();
+    }
+    bool pending;
+    do {
+        pending = gc_sweep_step(64);
+    } while (pending && mp_hal_ticks_us() - t0 < us);
+    return mp_obj_new_bool(pending);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_step_obj, 0, 1, gc_step);
+#endif
+
 // disable(): disable the garbage collector
 STATIC mp_obj_t gc_disable(void) {
     MP_STATE_MEM(gc_auto_collect_enabled) = 0;
@@ -76,6 +101,52 @@ STATIC mp_obj_t gc_mem_alloc(void) {
 }
 MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_alloc_obj, gc_mem_alloc);
 
+#if MICROPY_PY_GC_FRAGMENTATION
+// fragmentation(): return the size in bytes of the largest free run of heap,
+// and a list whose entry i is the number of free runs 2**i to 2**(i+1)-1
+// blocks long
+STATIC mp_obj_t gc_fragmentation(void) {
+    size_t runs[8 * sizeof(size_t)];
+    size_t max_free = gc_free_runs(runs, MP_ARRAY_SIZE(runs));
+    size_t n = MP_ARRAY_SIZE(runs);
+    while (n > 0 && runs[n - 1] == 0) {
+        n--;
+    }
+    mp_obj_t items[2] = {
+        mp_obj_new_int_from_uint(max_free * MICROPY_BYTES_PER_GC_BLOCK),
+        mp_obj_new_list(n, NULL),
+    };
+    mp_obj_list_t *list = MP_OBJ_TO_PTR(items[1]);
+    for (size_t i = 0; i < n; i++) {
+        list->items[i] = mp_obj_new_int_from_uint(runs[i]);
+    }
+    return mp_obj_new_tuple(2, items);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_fragmentation_obj, gc_fragmentation);
+#endif
+
+#if MICROPY_GC_STATS
+// stats(): return a tuple of the number of collections, their total and
+// longest pauses in microseconds, the bytes allocated and the blocks freed,
+// all since boot
+STATIC mp_obj_t gc_stats(void) {
+    // take a copy first, since making the objects allocates
+    uint64_t stats[5] = {
+        MP_STATE_MEM(gc_stats_collections),
+        MP_STATE_MEM(gc_stats_pause_us_total),
+        MP_STATE_MEM(gc_stats_pause_us_max),
+        MP_STATE_MEM(gc_stats_bytes_allocated),
+        MP_STATE_MEM(gc_stats_blocks_freed),
+    };
+    mp_obj_t items[5];
+    for (size_t i = 0; i < 5; i++) {
+        items[i] = mp_obj_new_int_from_ull(stats[i]);
+    }
+    return mp_obj_new_tuple(5, items);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_stats_obj, gc_stats);
+#endif
+
 #if MICROPY_GC_ALLOC_THRESHOLD
 STATIC mp_obj_t gc_threshold(size_t n_args, const mp_obj_t *args) {
     if (n_args == 0) {
@@ -98,11 +169,20 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_threshold_obj, 0, 1, gc_threshold);
 STATIC const mp_rom_map_elem_t mp_module_gc_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_gc) },
     { MP_ROM_QSTR(MP_QSTR_collect), MP_ROM_PTR(&gc_collect_obj) },
+    #if MICROPY_GC_INCREMENTAL
+    { MP_ROM_QSTR(MP_QSTR_step), MP_ROM_PTR(&gc_step_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_disable), MP_ROM_PTR(&gc_disable_obj) },
     { MP_ROM_QSTR(MP_QSTR_enable), MP_ROM_PTR(&gc_enable_obj) },
     { MP_ROM_QSTR(MP_QSTR_isenabled), MP_ROM_PTR(&gc_isenabled_obj) },
     { MP_ROM_QSTR(MP_QSTR_mem_free), MP_ROM_PTR(&gc_mem_free_obj) },
     { MP_ROM_QSTR(MP_QSTR_mem_alloc), MP_ROM_PTR(&gc_mem_alloc_obj) },
+    #if MICROPY_PY_GC_FRAGMENTATION
+    { MP_ROM_QSTR(MP_QSTR_fragmentation), MP_ROM_PTR(&gc_fragmentation_obj) },
+    #endif
+    #if MICROPY_GC_STATS
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&gc_stats_obj) },
+    #endif
     #if MICROPY_GC_ALLOC_THRESHOLD
     { MP_ROM_QSTR(MP_QSTR_threshold), MP_ROM_PTR(&gc_threshold_obj) },
     #endif
@@ -25,8 +25,10 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/builtin.h"
+#include "py/bc.h"
 #include "py/stackctrl.h"
 #include "py/runtime.h"
 #include "py/gc.h"
@@ -114,11 +116,25 @@ STATIC mp_obj_t mp_micropython_stack_use(void) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_stack_use_obj, mp_micropython_stack_use);
 #endif
 
+#if MICROPY_PY_MICROPYTHON_STACK_USE && MICROPY_STACK_CHECK && MICROPY_STACK_HIGH_WATER
+STATIC mp_obj_t mp_micropython_stack_use_max(void) {
+    return MP_OBJ_NEW_SMALL_INT(mp_stack_high_water());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_stack_use_max_obj, mp_micropython_stack_use_max);
+#endif
+
 #if MICROPY_ENABLE_PYSTACK
 STATIC mp_obj_t mp_micropython_pystack_use(void) {
     return MP_OBJ_NEW_SMALL_INT(mp_pystack_usage());
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_pystack_use_obj, mp_micropython_pystack_use);
+
+#if MICROPY_STACK_HIGH_WATER
+STATIC mp_obj_t mp_micropython_pystack_use_max(void) {
+    return MP_OBJ_NEW_SMALL_INT(mp_pystack_high_water());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_pystack_use_max_obj, mp_micropython_pystack_use_max);
+#endif
 #endif
 
 #if MICROPY_ENABLE_GC
@@ -135,6 +151,299 @@ STATIC mp_obj_t mp_micropython_heap_unlock(void) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_heap_unlock_obj, mp_micropython_heap_unlock);
 #endif
 
+#if MICROPY_GC_PROFILE
+// alloc_profile(period) samples every period'th allocation from now on, or
+// none if period is 0.  alloc_profile() returns the sites of the samples
+// still kept, as (file, line, function, count, bytes) with the count and
+// bytes scaled up by the period, largest bytes first.
+STATIC mp_obj_t mp_micropython_alloc_profile(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 1) {
+        mp_int_t period = mp_obj_get_int(args[0]);
+        if (period < 0 || period > 0xffff) {
+            mp_raise_ValueError(NULL);
+        }
+        MP_STATE_MEM(gc_profile_period) = period;
+        MP_STATE_MEM(gc_profile_countdown) = period;
+        MP_STATE_MEM(gc_profile_n) = 0;
+        return mp_const_none;
+    }
+
+    // don't sample the allocations made here
+    uint16_t period = MP_STATE_MEM(gc_profile_period);
+    MP_STATE_MEM(gc_profile_period) = 0;
+
+    // total the samples of each site into its first sample
+    const mp_gc_profile_sample_t *samples = MP_STATE_MEM(gc_profile);
+    size_t n = MIN(MP_STATE_MEM(gc_profile_n), MICROPY_GC_PROFILE_SAMPLES);
+    uint16_t count[MICROPY_GC_PROFILE_SAMPLES];
+    size_t bytes[MICROPY_GC_PROFILE_SAMPLES];
+    for (size_t i = 0; i < n; i++) {
+        size_t j = 0;
+        while (samples[j].line != samples[i].line || samples[j].source_file != samples[i].source_file
+            || samples[j].block_name != samples[i].block_name) {
+            j++;
+        }
+        count[i] = 0;
+        bytes[i] = 0;
+        count[j] += 1;
+        bytes[j] += samples[i].n_bytes;
+    }
+
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (;;) {
+        size_t best = n;
+        for (size_t i = 0; i < n; i++) {
+            if (count[i] != 0 && (best == n || bytes[i] > bytes[best])) {
+                best = i;
+            }
+        }
+        if (best == n) {
+            break;
+        }
+        const mp_gc_profile_sample_t *s = &samples[best];
+        mp_obj_t tuple[5] = {
+            s->source_file == MP_QSTR_NULL ? mp_const_none : MP_OBJ_NEW_QSTR(s->source_file),
+            MP_OBJ_NEW_SMALL_INT(s->line),
+            s->block_name == MP_QSTR_NULL ? mp_const_none : MP_OBJ_NEW_QSTR(s->block_name),
+            mp_obj_new_int_from_uint(count[best] * period),
+            mp_obj_new_int_from_uint(bytes[best] * period),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(5, tuple));
+        count[best] = 0;
+    }
+
+    MP_STATE_MEM(gc_profile_period) = period;
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_alloc_profile_obj, 0, 1, mp_micropython_alloc_profile);
+#endif
+
+#if MICROPY_SAMPLING_PROFILE
+// Called by the port from a periodic interrupt: every profile_period'th call
+// records the source line of the bytecode running.  Finding the line walks
+// the line number table of the function, so it takes a few us.
+void mp_sampling_profile_tick(void) {
+    if (MP_STATE_VM(profile_period) == 0 || --MP_STATE_VM(profile_countdown) != 0) {
+        return;
+    }
+    MP_STATE_VM(profile_countdown) = MP_STATE_VM(profile_period);
+    mp_profile_sample_t *sample = &MP_STATE_VM(profile)[MP_STATE_VM(profile_n)++ % MICROPY_SAMPLING_PROFILE_SAMPLES];
+    const mp_code_state_t *code_state = MP_STATE_THREAD(current_code_state);
+    if (code_state != NULL) {
+        sample->line = mp_bytecode_get_source_line(code_state->fun_bc, code_state->ip, &sample->block_name, &sample->source_file);
+    } else {
+        sample->source_file = MP_QSTR_NULL;
+        sample->block_name = MP_QSTR_NULL;
+        sample->line = 0;
+    }
+}
+
+// Total the samples at each function (by_line false) or each line, and
+// return them as a list of (file, line, function, count) or (file, function,
+// count) tuples, most samples first.
+STATIC mp_obj_t mp_micropython_profile_totals(size_t n, bool by_line) {
+    const mp_profile_sample_t *samples = MP_STATE_VM(profile);
+    uint16_t count[MICROPY_SAMPLING_PROFILE_SAMPLES];
+    for (size_t i = 0; i < n; i++) {
+        size_t j = 0;
+        while ((by_line && samples[j].line != samples[i].line) || samples[j].source_file != samples[i].source_file
+            || samples[j].block_name != samples[i].block_name) {
+            j++;
+        }
+        count[i] = 0;
+        count[j] += 1;
+    }
+
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (;;) {
+        size_t best = n;
+        for (size_t i = 0; i < n; i++) {
+            if (count[i] != 0 && (best == n || count[i] > count[best])) {
+                best = i;
+            }
+        }
+        if (best == n) {
+            break;
+        }
+        const mp_profile_sample_t *s = &samples[best];
+        mp_obj_t tuple[4] = {
+            s->source_file == MP_QSTR_NULL ? mp_const_none : MP_OBJ_NEW_QSTR(s->source_file),
+            MP_OBJ_NEW_SMALL_INT(s->line),
+            s->block_name == MP_QSTR_NULL ? mp_const_none : MP_OBJ_NEW_QSTR(s->block_name),
+            MP_OBJ_NEW_SMALL_INT(count[best]),
+        };
+        if (by_line) {
+            mp_obj_list_append(list, mp_obj_new_tuple(4, tuple));
+        } else {
+            tuple[1] = tuple[0];
+            mp_obj_list_append(list, mp_obj_new_tuple(3, tuple + 1));
+        }
+        count[best] = 0;
+    }
+    return list;
+}
+
+// profile(period) samples the running line every period ticks of the port's
+// profiling interrupt from now on, or stops if period is 0.  profile()
+// returns the functions and the lines found in the samples still kept, as
+// a tuple of two lists.
+STATIC mp_obj_t mp_micropython_profile(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 1) {
+        mp_int_t period = mp_obj_get_int(args[0]);
+        if (period < 0 || period > 0xffff) {
+            mp_raise_ValueError(NULL);
+        }
+        MP_STATE_VM(profile_period) = 0;
+        MP_STATE_VM(profile_n) = 0;
+        MP_STATE_VM(profile_countdown) = period;
+        MP_STATE_VM(profile_period) = period;
+        return mp_const_none;
+    }
+
+    // stop sampling while the ring is read
+    uint16_t period = MP_STATE_VM(profile_period);
+    MP_STATE_VM(profile_period) = 0;
+
+    size_t n = MIN(MP_STATE_VM(profile_n), MICROPY_SAMPLING_PROFILE_SAMPLES);
+    mp_obj_t tuple[2] = {
+        mp_micropython_profile_totals(n, false),
+        mp_micropython_profile_totals(n, true),
+    };
+
+    MP_STATE_VM(profile_period) = period;
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_profile_obj, 0, 1, mp_micropython_profile);
+#endif
+
+#if MICROPY_VM_OPCODE_STATS
+// opcode_stats() returns a tuple of a list of (opcode, count) and a list of
+// (opcode, next_opcode, count), of those run since boot or since
+// opcode_stats(True) cleared the counts; opcode 0 in a pair is VM entry
+STATIC mp_obj_t mp_micropython_opcode_stats(size_t n_args, const mp_obj_t *args) {
+    if (n_args > 0 && mp_obj_is_true(args[0])) {
+        memset(mp_vm_opcode_count, 0, sizeof(mp_vm_opcode_count));
+        memset(mp_vm_opcode_pair_count, 0, sizeof(mp_vm_opcode_pair_count));
+        return mp_const_none;
+    }
+    mp_obj_t ops = mp_obj_new_list(0, NULL);
+    mp_obj_t pairs = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < 256; i++) {
+        if (mp_vm_opcode_count[i] != 0) {
+            mp_obj_t t[2] = {MP_OBJ_NEW_SMALL_INT(i), mp_obj_new_int_from_uint(mp_vm_opcode_count[i])};
+            mp_obj_list_append(ops, mp_obj_new_tuple(2, t));
+        }
+        for (size_t j = 0; j < 256; j++) {
+            if (mp_vm_opcode_pair_count[i][j] != 0) {
+                mp_obj_t t[3] = {MP_OBJ_NEW_SMALL_INT(i), MP_OBJ_NEW_SMALL_INT(j),
+                    mp_obj_new_int_from_uint(mp_vm_opcode_pair_count[i][j])};
+                mp_obj_list_append(pairs, mp_obj_new_tuple(3, t));
+            }
+        }
+    }
+    mp_obj_t tuple[2] = {ops, pairs};
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_opcode_stats_obj, 0, 1, mp_micropython_opcode_stats);
+#endif
+
+#if MICROPY_IMPORT_STATS
+// import_stats() prints the time each phase of loading each module took, and
+// the heap it kept
+STATIC mp_obj_t mp_micropython_import_stats(void) {
+    mp_printf(&mp_plat_print, "module               kind     find    parse  compile     load     exec    bytes\n");
+    mp_import_stats_t total = {0};
+    for (size_t i = 0; i < MP_STATE_VM(import_stats_n); ++i) {
+        const mp_import_stats_t *s = &MP_STATE_VM(import_stats)[i];
+        const char *kind = s->kind == 'm' ? "mpy" : s->kind == 'c' ? "pyc" : s->kind == 's' ? "fstr" : s->kind == 'f' ? "fmpy" : "py";
+        mp_printf(&mp_plat_print, "%-20q %-4s %8u %8u %8u %8u %8u %8d\n", s->name, kind,
+            (uint)s->find_us, (uint)s->parse_us, (uint)s->compile_us, (uint)s->load_us, (uint)s->exec_us, (int)s->bytes);
+        total.find_us += s->find_us;
+        total.parse_us += s->parse_us;
+        total.compile_us += s->compile_us;
+        total.load_us += s->load_us;
+        total.exec_us += s->exec_us;
+        total.bytes += s->bytes;
+    }
+    mp_printf(&mp_plat_print, "%-25s %8u %8u %8u %8u %8u %8d\n", "total",
+        (uint)total.find_us, (uint)total.parse_us, (uint)total.compile_us, (uint)total.load_us, (uint)total.exec_us, (int)total.bytes);
+    if (MP_STATE_VM(import_stats_n) == MICROPY_IMPORT_STATS_MAX) {
+        mp_printf(&mp_plat_print, "(only the first %u modules are recorded)\n", MICROPY_IMPORT_STATS_MAX);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_import_stats_obj, mp_micropython_import_stats);
+#endif
+
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+STATIC mp_obj_t mp_micropython_import_mpy(mp_obj_t name_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    return mp_import_mpy(mp_obj_str_get_qstr(name_in), bufinfo.buf, bufinfo.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mp_micropython_import_mpy_obj, mp_micropython_import_mpy);
+#endif
+
+#if MICROPY_GC_ARENA
+// with arena(nbytes): takes the small allocations made in the block from an
+// arena of nbytes, freed at the end of the block
+typedef struct _mp_obj_arena_t {
+    mp_obj_base_t base;
+    size_t n_bytes;
+    struct _gc_arena_t *arena;
+} mp_obj_arena_t;
+
+STATIC mp_obj_t mp_micropython_arena_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_int_t n_bytes = mp_obj_get_int(args[0]);
+    if (n_bytes <= 0) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_obj_arena_t *self = m_new_obj(mp_obj_arena_t);
+    self->base.type = type;
+    self->n_bytes = n_bytes;
+    self->arena = NULL;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t mp_micropython_arena___enter__(mp_obj_t self_in) {
+    mp_obj_arena_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->arena != NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, "arena in use");
+    }
+    self->arena = gc_arena_push(self->n_bytes);
+    if (self->arena == NULL) {
+        m_malloc_fail(self->n_bytes);
+    }
+    return self_in;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_arena___enter___obj, mp_micropython_arena___enter__);
+
+STATIC mp_obj_t mp_micropython_arena___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_arena_t *self = MP_OBJ_TO_PTR(args[0]);
+    // the exception being raised may have been allocated in the arena, so
+    // then it's left to the GC
+    gc_arena_pop(self->arena, args[1] != mp_const_none);
+    self->arena = NULL;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_arena___exit___obj, 4, 4, mp_micropython_arena___exit__);
+
+STATIC const mp_rom_map_elem_t mp_micropython_arena_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_micropython_arena___enter___obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&mp_micropython_arena___exit___obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(mp_micropython_arena_locals_dict, mp_micropython_arena_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_micropython_arena_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_arena,
+    .make_new = mp_micropython_arena_make_new,
+    .locals_dict = (mp_obj_dict_t*)&mp_micropython_arena_locals_dict,
+};
+#endif
+
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && (MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0)
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_alloc_emergency_exception_buf_obj, mp_alloc_emergency_exception_buf);
 #endif
@@ -175,16 +484,40 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     #if MICROPY_PY_MICROPYTHON_STACK_USE
     { MP_ROM_QSTR(MP_QSTR_stack_use), MP_ROM_PTR(&mp_micropython_stack_use_obj) },
     #endif
+    #if MICROPY_PY_MICROPYTHON_STACK_USE && MICROPY_STACK_CHECK && MICROPY_STACK_HIGH_WATER
+    { MP_ROM_QSTR(MP_QSTR_stack_use_max), MP_ROM_PTR(&mp_micropython_stack_use_max_obj) },
+    #endif
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && (MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0)
     { MP_ROM_QSTR(MP_QSTR_alloc_emergency_exception_buf), MP_ROM_PTR(&mp_alloc_emergency_exception_buf_obj) },
 #endif
     #if MICROPY_ENABLE_PYSTACK
     { MP_ROM_QSTR(MP_QSTR_pystack_use), MP_ROM_PTR(&mp_micropython_pystack_use_obj) },
+    #if MICROPY_STACK_HIGH_WATER
+    { MP_ROM_QSTR(MP_QSTR_pystack_use_max), MP_ROM_PTR(&mp_micropython_pystack_use_max_obj) },
+    #endif
     #endif
     #if MICROPY_ENABLE_GC
     { MP_ROM_QSTR(MP_QSTR_heap_lock), MP_ROM_PTR(&mp_micropython_heap_lock_obj) },
     { MP_ROM_QSTR(MP_QSTR_heap_unlock), MP_ROM_PTR(&mp_micropython_heap_unlock_obj) },
     #endif
+    #if MICROPY_GC_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_alloc_profile), MP_ROM_PTR(&mp_micropython_alloc_profile_obj) },
+    #endif
+    #if MICROPY_SAMPLING_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_profile), MP_ROM_PTR(&mp_micropython_profile_obj) },
+    #endif
+    #if MICROPY_VM_OPCODE_STATS
+    { MP_ROM_QSTR(MP_QSTR_opcode_stats), MP_ROM_PTR(&mp_micropython_opcode_stats_obj) },
+    #endif
+    #if MICROPY_IMPORT_STATS
+    { MP_ROM_QSTR(MP_QSTR_import_stats), MP_ROM_PTR(&mp_micropython_import_stats_obj) },
+    #endif
+    #if MICROPY_GC_ARENA
+    { MP_ROM_QSTR(MP_QSTR_arena), MP_ROM_PTR(&mp_micropython_arena_type) },
+    #endif
+    #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+    { MP_ROM_QSTR(MP_QSTR_import_mpy), MP_ROM_PTR(&mp_micropython_import_mpy_obj) },
+    #endif
     #if MICROPY_KBD_EXCEPTION
     { MP_ROM_QSTR(MP_QSTR_kbd_intr), MP_ROM_PTR(&mp_micropython_kbd_intr_obj) },
     #endif
@@ -118,40 +118,11 @@ STATIC mp_obj_t struct_calcsize(mp_obj_t fmt_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(struct_calcsize_obj, struct_calcsize);
 
-STATIC mp_obj_t struct_unpack_from(size_t n_args, const mp_obj_t *args) {
-    // unpack requires that the buffer be exactly the right size.
-    // unpack_from requires that the buffer be "big enough".
-    // Since we implement unpack and unpack_from using the same function
-    // we relax the "exact" requirement, and only implement "big enough".
-    const char *fmt = mp_obj_str_get_str(args[0]);
-    size_t total_sz;
-    size_t num_items = calc_size_items(fmt, &total_sz);
+// This function assumes there are total_sz bytes available at p
+STATIC mp_obj_t struct_unpack_internal(const char *fmt, size_t num_items, const byte *p_in) {
+    byte *p = (byte*)p_in;
     char fmt_type = get_fmt_type(&fmt);
     mp_obj_tuple_t *res = MP_OBJ_TO_PTR(mp_obj_new_tuple(num_items, NULL));
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
-    byte *p = bufinfo.buf;
-    byte *end_p = &p[bufinfo.len];
-    mp_int_t offset = 0;
-
-    if (n_args > 2) {
-        // offset arg provided
-        offset = mp_obj_get_int(args[2]);
-        if (offset < 0) {
-            // negative offsets are relative to the end of the buffer
-            offset = bufinfo.len + offset;
-            if (offset < 0) {
-                mp_raise_ValueError("buffer too small");
-            }
-        }
-        p += offset;
-    }
-
-    // Check that the input buffer is big enough to unpack all the values
-    if (p + total_sz > end_p) {
-        mp_raise_ValueError("buffer too small");
-    }
-
     for (size_t i = 0; i < num_items;) {
         mp_uint_t cnt = 1;
         if (unichar_isdigit(*fmt)) {
@@ -172,11 +143,51 @@ STATIC mp_obj_t struct_unpack_from(size_t n_args, const mp_obj_t *args) {
     }
     return MP_OBJ_FROM_PTR(res);
 }
+
+// Returns a pointer to the start of the data to unpack, checking that there
+// are total_sz bytes available there
+STATIC const byte *struct_get_unpack_buf(size_t n_args, const mp_obj_t *args, size_t total_sz) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    const byte *p = bufinfo.buf;
+    const byte *end_p = &p[bufinfo.len];
+    mp_int_t offset = 0;
+
+    if (n_args > 1) {
+        // offset arg provided
+        offset = mp_obj_get_int(args[1]);
+        if (offset < 0) {
+            // negative offsets are relative to the end of the buffer
+            offset = bufinfo.len + offset;
+            if (offset < 0) {
+                mp_raise_ValueError("buffer too small");
+            }
+        }
+        p += offset;
+    }
+
+    // Check that the input buffer is big enough to unpack all the values
+    if (p + total_sz > end_p) {
+        mp_raise_ValueError("buffer too small");
+    }
+    return p;
+}
+
+STATIC mp_obj_t struct_unpack_from(size_t n_args, const mp_obj_t *args) {
+    // unpack requires that the buffer be exactly the right size.
+    // unpack_from requires that the buffer be "big enough".
+    // Since we implement unpack and unpack_from using the same function
+    // we relax the "exact" requirement, and only implement "big enough".
+    const char *fmt = mp_obj_str_get_str(args[0]);
+    size_t total_sz;
+    size_t num_items = calc_size_items(fmt, &total_sz);
+    const byte *p = struct_get_unpack_buf(n_args - 1, args + 1, total_sz);
+    return struct_unpack_internal(fmt, num_items, p);
+}
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_unpack_from_obj, 2, 3, struct_unpack_from);
 
 // This function assumes there is enough room in p to store all the values
-STATIC void struct_pack_into_internal(mp_obj_t fmt_in, byte *p, size_t n_args, const mp_obj_t *args) {
-    const char *fmt = mp_obj_str_get_str(fmt_in);
+STATIC void struct_pack_into_internal(const char *fmt, byte *p, size_t n_args, const mp_obj_t *args) {
     char fmt_type = get_fmt_type(&fmt);
 
     size_t i;
@@ -210,22 +221,30 @@ STATIC void struct_pack_into_internal(mp_obj_t fmt_in, byte *p, size_t n_args, c
     }
 }
 
-STATIC mp_obj_t struct_pack(size_t n_args, const mp_obj_t *args) {
+STATIC mp_obj_t struct_pack_internal(const char *fmt, size_t size, size_t n_args, const mp_obj_t *args) {
     // TODO: "The arguments must match the values required by the format exactly."
-    mp_int_t size = MP_OBJ_SMALL_INT_VALUE(struct_calcsize(args[0]));
     vstr_t vstr;
     vstr_init_len(&vstr, size);
     byte *p = (byte*)vstr.buf;
     memset(p, 0, size);
-    struct_pack_into_internal(args[0], p, n_args - 1, &args[1]);
+    struct_pack_into_internal(fmt, p, n_args, args);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
+
+STATIC mp_obj_t struct_pack(size_t n_args, const mp_obj_t *args) {
+    const char *fmt = mp_obj_str_get_str(args[0]);
+    size_t size;
+    calc_size_items(fmt, &size);
+    return struct_pack_internal(fmt, size, n_args - 1, &args[1]);
+}
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_obj, 1, MP_OBJ_FUN_ARGS_MAX, struct_pack);
 
-STATIC mp_obj_t struct_pack_into(size_t n_args, const mp_obj_t *args) {
+// Returns a pointer to where the values should be packed, checking that there
+// are size bytes available there
+STATIC byte *struct_get_pack_buf(mp_obj_t buf_in, mp_obj_t offset_in, size_t size) {
     mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
-    mp_int_t offset = mp_obj_get_int(args[2]);
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    mp_int_t offset = mp_obj_get_int(offset_in);
     if (offset < 0) {
         // negative offsets are relative to the end of the buffer
         offset = (mp_int_t)bufinfo.len + offset;
@@ -238,16 +257,164 @@ STATIC mp_obj_t struct_pack_into(size_t n_args, const mp_obj_t *args) {
     p += offset;
 
     // Check that the output buffer is big enough to hold all the values
-    mp_int_t sz = MP_OBJ_SMALL_INT_VALUE(struct_calcsize(args[0]));
-    if (p + sz > end_p) {
+    if (p + size > end_p) {
         mp_raise_ValueError("buffer too small");
     }
+    return p;
+}
 
-    struct_pack_into_internal(args[0], p, n_args - 3, &args[3]);
+STATIC mp_obj_t struct_pack_into(size_t n_args, const mp_obj_t *args) {
+    const char *fmt = mp_obj_str_get_str(args[0]);
+    size_t size;
+    calc_size_items(fmt, &size);
+    byte *p = struct_get_pack_buf(args[1], args[2], size);
+    struct_pack_into_internal(fmt, p, n_args - 3, &args[3]);
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_pack_into);
 
+#if MICROPY_PY_STRUCT_STRUCT
+
+// A Struct object parses its format string once, when it's created, so that
+// repeated packing and unpacking with the same format doesn't pay for it
+typedef struct _mp_obj_struct_t {
+    mp_obj_base_t base;
+    mp_obj_t fmt;
+    size_t size;
+    size_t num_items;
+} mp_obj_struct_t;
+
+// Iterator returned by iter_unpack; it keeps a reference to the buffer and
+// fetches its contents again on each step, in case the buffer was resized
+typedef struct _mp_obj_struct_it_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_struct_t *st;
+    mp_obj_t buf;
+    size_t offset;
+} mp_obj_struct_it_t;
+
+STATIC const mp_obj_type_t struct_type_struct;
+
+STATIC mp_obj_t struct_struct_new(mp_obj_t fmt_in) {
+    const char *fmt = mp_obj_str_get_str(fmt_in);
+    mp_obj_struct_t *o = m_new_obj(mp_obj_struct_t);
+    o->base.type = &struct_type_struct;
+    o->fmt = fmt_in;
+    o->num_items = calc_size_items(fmt, &o->size);
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_obj_t struct_struct_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    (void)type;
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    return struct_struct_new(args[0]);
+}
+
+STATIC void struct_struct_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "Struct(%R)", self->fmt);
+}
+
+STATIC mp_obj_t struct_struct_pack(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    return struct_pack_internal(mp_obj_str_get_str(self->fmt), self->size, n_args - 1, &args[1]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_struct_pack_obj, 1, MP_OBJ_FUN_ARGS_MAX, struct_struct_pack);
+
+STATIC mp_obj_t struct_struct_pack_into(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    byte *p = struct_get_pack_buf(args[1], args[2], self->size);
+    struct_pack_into_internal(mp_obj_str_get_str(self->fmt), p, n_args - 3, &args[3]);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_struct_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_struct_pack_into);
+
+STATIC mp_obj_t struct_struct_unpack_from(size_t n_args, const mp_obj_t *args) {
+    // As for the module-level function, unpack only checks the buffer is big enough
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    const byte *p = struct_get_unpack_buf(n_args - 1, args + 1, self->size);
+    return struct_unpack_internal(mp_obj_str_get_str(self->fmt), self->num_items, p);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_struct_unpack_from_obj, 2, 3, struct_struct_unpack_from);
+
+STATIC mp_obj_t struct_it_iternext(mp_obj_t self_in) {
+    mp_obj_struct_it_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(self->buf, &bufinfo, MP_BUFFER_READ);
+    if (self->offset + self->st->size > bufinfo.len) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    const byte *p = (const byte*)bufinfo.buf + self->offset;
+    self->offset += self->st->size;
+    return struct_unpack_internal(mp_obj_str_get_str(self->st->fmt), self->st->num_items, p);
+}
+
+STATIC mp_obj_t struct_struct_iter_unpack(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    if (self->size == 0) {
+        mp_raise_ValueError("zero-size format");
+    }
+    if (bufinfo.len % self->size != 0) {
+        mp_raise_ValueError("buffer size not a multiple of format size");
+    }
+    mp_obj_struct_it_t *o = m_new_obj(mp_obj_struct_it_t);
+    o->base.type = &mp_type_polymorph_iter;
+    o->iternext = struct_it_iternext;
+    o->st = self;
+    o->buf = buf_in;
+    o->offset = 0;
+    return MP_OBJ_FROM_PTR(o);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(struct_struct_iter_unpack_obj, struct_struct_iter_unpack);
+
+STATIC const mp_rom_map_elem_t struct_struct_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_pack), MP_ROM_PTR(&struct_struct_pack_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_struct_pack_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_struct_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_struct_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_iter_unpack), MP_ROM_PTR(&struct_struct_iter_unpack_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(struct_struct_locals_dict, struct_struct_locals_dict_table);
+
+STATIC void struct_struct_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        // not load attribute
+        return;
+    }
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    if (attr == MP_QSTR_format) {
+        dest[0] = self->fmt;
+    } else if (attr == MP_QSTR_size) {
+        dest[0] = MP_OBJ_NEW_SMALL_INT(self->size);
+    } else {
+        // a type with an attr handler must look up its own methods
+        mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&struct_struct_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            mp_convert_member_lookup(self_in, self->base.type, elem->value, dest);
+        }
+    }
+}
+
+STATIC const mp_obj_type_t struct_type_struct = {
+    { &mp_type_type },
+    .name = MP_QSTR_Struct,
+    .print = struct_struct_print,
+    .make_new = struct_struct_make_new,
+    .attr = struct_struct_attr,
+};
+
+STATIC mp_obj_t struct_iter_unpack(mp_obj_t fmt_in, mp_obj_t buf_in) {
+    return struct_struct_iter_unpack(struct_struct_new(fmt_in), buf_in);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(struct_iter_unpack_obj, struct_iter_unpack);
+
+#endif // MICROPY_PY_STRUCT_STRUCT
+
 STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ustruct) },
     { MP_ROM_QSTR(MP_QSTR_calcsize), MP_ROM_PTR(&struct_calcsize_obj) },
@@ -255,6 +422,10 @@ STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_pack_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_unpack_from_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_unpack_from_obj) },
+    #if MICROPY_PY_STRUCT_STRUCT
+    { MP_ROM_QSTR(MP_QSTR_iter_unpack), MP_ROM_PTR(&struct_iter_unpack_obj) },
+    { MP_ROM_QSTR(MP_QSTR_Struct), MP_ROM_PTR(&struct_type_struct) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_struct_globals, mp_module_struct_globals_table);
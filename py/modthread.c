@@ -160,11 +160,23 @@ STATIC void *thread_entry(void *args_in) {
     thread_entry_args_t *args = (thread_entry_args_t*)args_in;
 
     mp_state_thread_t ts;
+    #if MICROPY_GC_PROFILE || MICROPY_SAMPLING_PROFILE
+    // set before the state is used, as the profiler reads it from an IRQ
+    ts.current_code_state = NULL;
+    #endif
     mp_thread_set_state(&ts);
 
     mp_stack_set_top(&ts + 1); // need to include ts in root-pointer scan
     mp_stack_set_limit(args->stack_size);
 
+    #if MICROPY_GC_ARENA
+    ts.gc_arena = NULL;
+    #endif
+
+    #if MICROPY_GC_THREAD_CACHE
+    ts.gc_cache_len = 0;
+    #endif
+
     #if MICROPY_ENABLE_PYSTACK
     // TODO threading and pystack is not fully supported, for now just make a small stack
     mp_obj_t mini_pystack[128];
@@ -264,6 +276,11 @@ STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *args)
     th_args->fun = args[0];
 
     // spawn the thread!
+    #if MICROPY_PY_THREAD_MAP_LOCKS
+    // the maps are locked from now on, as there's more than one thread
+    MP_STATE_VM(map_locking) = true;
+    #endif
+
     mp_thread_create(thread_entry, th_args, &th_args->stack_size);
 
     return mp_const_none;
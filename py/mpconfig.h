@@ -148,6 +148,104 @@
 #define MICROPY_GC_ALLOC_THRESHOLD (1)
 #endif
 
+// Number of recently freed runs of each length from 1 to 4 blocks to keep,
+// so small allocations take one instead of scanning the allocation table.
+// The lists are rebuilt by each sweep.  Set to 0 to disable.
+#ifndef MICROPY_GC_FREE_LISTS
+#define MICROPY_GC_FREE_LISTS (0)
+#endif
+
+// Whether collections started by allocation or gc.step() sweep the heap in
+// steps: a little with each allocation, and up to a time limit with each
+// gc.step().  Marking is still done in one go.  gc.step() needs the port
+// to provide mp_hal_ticks_us.
+#ifndef MICROPY_GC_INCREMENTAL
+#define MICROPY_GC_INCREMENTAL (0)
+#endif
+
+// Whether gc_add() can give the GC more areas of RAM besides the one passed
+// to gc_init(), for RAM that isn't contiguous with it.  Each area has its own
+// allocation table, and pointers are checked against all of them.
+#ifndef MICROPY_GC_SPLIT_HEAP
+#define MICROPY_GC_SPLIT_HEAP (0)
+#endif
+
+// Whether gc_alloc, when a collection hasn't freed enough memory, asks the
+// port for more with gc_grow_heap before failing (needs MICROPY_GC_SPLIT_HEAP)
+#ifndef MICROPY_GC_SPLIT_HEAP_AUTO
+#define MICROPY_GC_SPLIT_HEAP_AUTO (0)
+#endif
+
+// Whether every so many allocations gc_alloc records the source line of the
+// bytecode making it, for micropython.alloc_profile().  The last
+// MICROPY_GC_PROFILE_SAMPLES samples are kept.
+#ifndef MICROPY_GC_PROFILE
+#define MICROPY_GC_PROFILE (0)
+#endif
+#ifndef MICROPY_GC_PROFILE_SAMPLES
+#define MICROPY_GC_PROFILE_SAMPLES (64)
+#endif
+
+// Whether the GC keeps running totals of collections, their pause times,
+// bytes allocated and blocks freed, for gc.stats().  Pauses are timed with
+// mp_hal_ticks_us, which the port must provide.
+#ifndef MICROPY_GC_STATS
+#define MICROPY_GC_STATS (0)
+#endif
+
+// Whether every so many ticks the source line of the bytecode running is
+// recorded, for micropython.profile().  The port calls
+// mp_sampling_profile_tick() from a periodic interrupt.  The last
+// MICROPY_SAMPLING_PROFILE_SAMPLES samples are kept.
+#ifndef MICROPY_SAMPLING_PROFILE
+#define MICROPY_SAMPLING_PROFILE (0)
+#endif
+#ifndef MICROPY_SAMPLING_PROFILE_SAMPLES
+#define MICROPY_SAMPLING_PROFILE_SAMPLES (128)
+#endif
+
+// Whether the VM counts each opcode it runs, and each pair of opcodes run one
+// after the other in the same function, for micropython.opcode_stats().  The
+// pair table takes 256 * 256 words of RAM, so this is for profiling builds of
+// the unix port; tools/opcode_stats.py makes a report from the counts.
+#ifndef MICROPY_VM_OPCODE_STATS
+#define MICROPY_VM_OPCODE_STATS (0)
+#endif
+
+// Whether importing a module records how long finding, parsing, compiling,
+// loading and executing it take, and how much heap it keeps, for
+// micropython.import_stats().  The first MICROPY_IMPORT_STATS_MAX modules
+// loaded are recorded.  Needs mp_hal_ticks_us.
+#ifndef MICROPY_IMPORT_STATS
+#define MICROPY_IMPORT_STATS (0)
+#endif
+#ifndef MICROPY_IMPORT_STATS_MAX
+#define MICROPY_IMPORT_STATS_MAX (32)
+#endif
+
+// Whether gc_arena_push()/gc_arena_pop() and micropython.arena() are
+// available, to bump-allocate a thread's small allocations from one heap
+// block that is freed as a whole at the end of the scope.
+#ifndef MICROPY_GC_ARENA
+#define MICROPY_GC_ARENA (0)
+#endif
+
+// Allocations of at least this many bytes are placed as high in the heap as
+// they fit, while smaller ones are placed as low as they fit, so that small
+// objects coming and going don't split up the space for large buffers.  Set
+// to 0 to place everything low.
+#ifndef MICROPY_GC_LARGE_ALLOC
+#define MICROPY_GC_LARGE_ALLOC (0)
+#endif
+
+// Number of free single blocks each thread takes from the heap at a time, to
+// serve its single-block allocations without taking the GC mutex.  This is
+// for builds without the GIL, where threads allocate in parallel.  Set to 0
+// to allocate every block under the mutex.
+#ifndef MICROPY_GC_THREAD_CACHE
+#define MICROPY_GC_THREAD_CACHE (0)
+#endif
+
 // Number of bytes to allocate initially when creating new chunks to store
 // interned string data.  Smaller numbers lead to more chunks being needed
 // and more wastage at the end of the chunk.  Larger numbers lead to wasted
@@ -156,6 +254,14 @@
 #define MICROPY_ALLOC_QSTR_CHUNK_INIT (128)
 #endif
 
+// Whether qstr lookups use a hash index, grown as strings are interned,
+// instead of comparing against every qstr in turn: 1 to index the qstrs
+// interned at runtime, 2 to index the constant ones as well.  The index
+// takes 4 bytes of heap per qstr it holds.
+#ifndef MICROPY_QSTR_INDEX
+#define MICROPY_QSTR_INDEX (0)
+#endif
+
 // Initial amount for lexer indentation level
 #ifndef MICROPY_ALLOC_LEXER_INDENT_INIT
 #define MICROPY_ALLOC_LEXER_INDENT_INIT (10)
@@ -207,6 +313,14 @@
 #define MICROPY_ALLOC_SCOPE_ID_INC (6)
 #endif
 
+// Most that a vstr (the buffer behind StringIO, BytesIO and strings being
+// built) grows by beyond what's asked for: it grows by half its size up to
+// this many bytes, so appending many small pieces needs fewer reallocs.
+// With 0 it only grows by a few bytes more than is needed.
+#ifndef MICROPY_ALLOC_VSTR_GROW_MAX
+#define MICROPY_ALLOC_VSTR_GROW_MAX (0)
+#endif
+
 // Maximum length of a path in the filesystem
 // So we can allocate a buffer on the stack for path manipulation in import
 #ifndef MICROPY_ALLOC_PATH_MAX
@@ -267,6 +381,13 @@
 #define MICROPY_PERSISTENT_CODE_LOAD (0)
 #endif
 
+// Whether persistent code can be loaded from .mpy files made by mpy-cross
+// -mxip, whose bytecode runs where it is in ROM, with micropython.import_mpy.
+// This costs a check on every opcode that takes a qstr.
+#ifndef MICROPY_PERSISTENT_CODE_LOAD_XIP
+#define MICROPY_PERSISTENT_CODE_LOAD_XIP (0)
+#endif
+
 // Whether to support saving of persistent code
 #ifndef MICROPY_PERSISTENT_CODE_SAVE
 #define MICROPY_PERSISTENT_CODE_SAVE (0)
@@ -349,12 +470,22 @@
 // Configure dynamic compiler macros
 #if MICROPY_DYNAMIC_COMPILER
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE_DYNAMIC (mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode)
+#define MICROPY_OPT_SUPERINSTRUCTIONS_DYNAMIC (mp_dynamic_compiler.opt_superinstructions)
 #define MICROPY_PY_BUILTINS_STR_UNICODE_DYNAMIC (mp_dynamic_compiler.py_builtins_str_unicode)
 #else
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE_DYNAMIC MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+#define MICROPY_OPT_SUPERINSTRUCTIONS_DYNAMIC MICROPY_OPT_SUPERINSTRUCTIONS
 #define MICROPY_PY_BUILTINS_STR_UNICODE_DYNAMIC MICROPY_PY_BUILTINS_STR_UNICODE
 #endif
 
+// Whether the bytecode emitter applies peephole optimisations at
+// optimisation level 2 and higher: jumps to an unconditional jump go
+// straight to its target, DUP_TOP then POP_TOP is dropped, and a unary op
+// on a constant is replaced by the result
+#ifndef MICROPY_COMP_PEEPHOLE
+#define MICROPY_COMP_PEEPHOLE (0)
+#endif
+
 // Whether to enable constant folding; eg 1+2 rewritten as 3
 #ifndef MICROPY_COMP_CONST_FOLDING
 #define MICROPY_COMP_CONST_FOLDING (1)
@@ -375,6 +506,15 @@
 #define MICROPY_COMP_CONST (1)
 #endif
 
+// Whether imported .py modules are parsed, compiled and executed one
+// top-level statement at a time, so that only the parse tree and bytecode of
+// one statement (eg a function or class definition) is in RAM at once,
+// instead of those of the whole module.  A syntax error is then raised only
+// after the statements before it have been executed.
+#ifndef MICROPY_PARSE_STREAM
+#define MICROPY_PARSE_STREAM (0)
+#endif
+
 // Whether to enable optimisation of: a, b = c, d
 // Costs 124 bytes (Thumb2)
 #ifndef MICROPY_COMP_DOUBLE_TUPLE_ASSIGN
@@ -446,12 +586,93 @@
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 #endif
 
+// Whether the VM does add, subtract, compare and bitwise and/or/xor of two
+// small ints itself, only calling mp_binary_op if the result overflows.  Uses
+// a bit of extra code ROM.
+#ifndef MICROPY_OPT_VM_SMALL_INT
+#define MICROPY_OPT_VM_SMALL_INT (0)
+#endif
+
+// Whether the bytecode compiler fuses LOAD_FAST, then LOAD_FAST or a
+// LOAD_CONST_SMALL_INT of -16 to 47, then BINARY_OP into one opcode of the
+// same length, which the VM runs with one dispatch.  Bytecode without the
+// fused opcodes still runs.
+#ifndef MICROPY_OPT_SUPERINSTRUCTIONS
+#define MICROPY_OPT_SUPERINSTRUCTIONS (0)
+#endif
+
+// Whether a tuple made by "return a, b" in a bytecode function, and unpacked
+// straight away by the bytecode that called it, as in "x, y = f()", is freed
+// there, so its memory is reused by the next allocation instead of waiting
+// for a collection.  The tuple can't have been stored anywhere else.
+#ifndef MICROPY_OPT_VM_FREE_RETURNED_TUPLE
+#define MICROPY_OPT_VM_FREE_RETURNED_TUPLE (0)
+#endif
+
+// Whether each thread keeps the last bound methods that it made, in a table
+// of MICROPY_OPT_BOUND_METH_CACHE_SIZE entries (a power of 2), so that
+// loading the same method of the same object again, eg to pass it as a
+// callback each frame, doesn't allocate.  Such bound methods are then the
+// same object.  A thread's table is cleared when it runs a collection.
+#ifndef MICROPY_OPT_BOUND_METH_CACHE
+#define MICROPY_OPT_BOUND_METH_CACHE (0)
+#endif
+#ifndef MICROPY_OPT_BOUND_METH_CACHE_SIZE
+#define MICROPY_OPT_BOUND_METH_CACHE_SIZE (8)
+#endif
+
+// Whether to cache the result of map lookups made by LOAD_METHOD on native
+// types, and by the opcodes above if not cached in the bytecode, in a table
+// of MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE bytes of RAM (a power of 2).  This
+// suits bytecode in ROM and .mpy files, which the bytecode cache doesn't.
+#ifndef MICROPY_OPT_MAP_LOOKUP_CACHE
+#define MICROPY_OPT_MAP_LOOKUP_CACHE (0)
+#endif
+#ifndef MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE
+#define MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE (128)
+#endif
+
+// Whether mp_map_lookup remembers where qstrs were found in fixed ordered
+// maps of more than 8 entries, like the globals of built-in modules and the
+// locals of built-in types, which are otherwise searched linearly.  Uses a
+// table of MICROPY_OPT_ROM_MAP_LOOKUP_CACHE_SIZE bytes of RAM (a power of 2).
+#ifndef MICROPY_OPT_ROM_MAP_LOOKUP_CACHE
+#define MICROPY_OPT_ROM_MAP_LOOKUP_CACHE (0)
+#endif
+#ifndef MICROPY_OPT_ROM_MAP_LOOKUP_CACHE_SIZE
+#define MICROPY_OPT_ROM_MAP_LOOKUP_CACHE_SIZE (128)
+#endif
+
+// Whether ordered maps of more than 8 entries, like OrderedDict, keep a hash
+// index of 8- or 16-bit entry positions after their array of entries, so
+// lookups don't search the entries linearly.  Costs 1.5 to 6 bytes per entry.
+#ifndef MICROPY_OPT_MAP_ORDERED_INDEX
+#define MICROPY_OPT_MAP_ORDERED_INDEX (0)
+#endif
+
 // Whether to use fast versions of bitwise operations (and, or, xor) when the
 // arguments are both positive.  Increases Thumb2 code size by about 250 bytes.
 #ifndef MICROPY_OPT_MPZ_BITWISE
 #define MICROPY_OPT_MPZ_BITWISE (0)
 #endif
 
+// Whether to multiply big ints of many digits by Karatsuba's method, and to
+// compute pow(a, b, m) with m odd a few bits of b at a time and without
+// dividing.  Increases code size, and uses heap for scratch digits and a
+// table of powers.
+#ifndef MICROPY_OPT_MPZ_FAST_MUL
+#define MICROPY_OPT_MPZ_FAST_MUL (0)
+#endif
+
+// Whether to format and parse floats by scaling them by exact powers of 10
+// with twice the precision of a float, and extracting digits with integers,
+// rather than a digit at a time or with pow().  This makes parsing correctly
+// rounded for most inputs and lets repr() give the shortest digits that read
+// back to the same value, at the cost of some code and a table of powers of 10.
+#ifndef MICROPY_OPT_FAST_FLOAT
+#define MICROPY_OPT_FAST_FLOAT (0)
+#endif
+
 
 // Whether math.factorial is large, fast and recursive (1) or small and slow (0).
 #ifndef MICROPY_OPT_MATH_FACTORIAL
@@ -478,6 +699,14 @@
 #define MICROPY_READER_VFS (0)
 #endif
 
+// Size of the buffer that the POSIX and VFS readers read files into; each
+// refill is a read() call or a call through the stream protocol, so a larger
+// buffer makes importing .py and .mpy files faster at the cost of RAM while
+// they are read
+#ifndef MICROPY_READER_BUF_SIZE
+#define MICROPY_READER_BUF_SIZE (24)
+#endif
+
 // Whether any readers have been defined
 #ifndef MICROPY_HAS_FILE_READER
 #define MICROPY_HAS_FILE_READER (MICROPY_READER_POSIX || MICROPY_READER_VFS)
@@ -526,6 +755,21 @@
 #define MICROPY_STACK_CHECK (0)
 #endif
 
+// Whether to fill unused C stack (below the limit set by mp_stack_set_limit)
+// and pystack with a known pattern so the high-water mark can be queried.
+// Requires MICROPY_STACK_CHECK for the C stack part.
+#ifndef MICROPY_STACK_HIGH_WATER
+#define MICROPY_STACK_HIGH_WATER (0)
+#endif
+
+// Whether an exception caught by an except clause in the function it was
+// raised in leaves its traceback entry undecoded and unallocated until the
+// traceback is needed, and whether "raise StopIteration" raises a shared
+// instance that never has a traceback
+#ifndef MICROPY_EXC_TRACEBACK_LAZY
+#define MICROPY_EXC_TRACEBACK_LAZY (0)
+#endif
+
 // Whether to have an emergency exception buffer
 #ifndef MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF (0)
@@ -552,6 +796,12 @@
 #define MICROPY_HELPER_REPL (0)
 #endif
 
+// Longest name prefix whose completion search is remembered, so that
+// pressing Tab again, or after typing more of the name, scans fewer qstrs
+#ifndef MICROPY_REPL_COMPL_CACHE_PREFIX
+#define MICROPY_REPL_COMPL_CACHE_PREFIX (32)
+#endif
+
 // Whether to include emacs-style readline behavior in REPL
 #ifndef MICROPY_REPL_EMACS_KEYS
 #define MICROPY_REPL_EMACS_KEYS (0)
@@ -562,6 +812,14 @@
 #define MICROPY_REPL_AUTO_INDENT (0)
 #endif
 
+// Size in bytes of the static pool holding the readline history lines, so
+// that entering a line doesn't allocate on the heap.  The oldest lines are
+// dropped to make room; the number of lines is set by the readline_hist
+// root pointer array of the port.
+#ifndef MICROPY_READLINE_HISTORY_BYTES
+#define MICROPY_READLINE_HISTORY_BYTES (512)
+#endif
+
 // Whether port requires event-driven REPL functions
 #ifndef MICROPY_REPL_EVENT_DRIVEN
 #define MICROPY_REPL_EVENT_DRIVEN (0)
@@ -645,6 +903,10 @@ typedef double mp_float_t;
 #define MICROPY_PY_BUILTINS_FLOAT (0)
 #endif
 
+#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C && MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+#error "MICROPY_OBJ_REPR_C can only store single-precision floats"
+#endif
+
 #ifndef MICROPY_PY_BUILTINS_COMPLEX
 #define MICROPY_PY_BUILTINS_COMPLEX (MICROPY_PY_BUILTINS_FLOAT)
 #endif
@@ -708,6 +970,15 @@ typedef double mp_float_t;
 #define MICROPY_MODULE_FROZEN_MPY (0)
 #endif
 
+// Whether the compiled code of an imported .py file is cached in a .mpy file
+// in a __pycache__ directory beside it, and loaded from there by later imports
+// while the source keeps its size and mtime.  This saves the time and the peak
+// RAM of parsing and compiling.  Needs MICROPY_VFS, MICROPY_PERSISTENT_CODE_LOAD
+// and MICROPY_PERSISTENT_CODE_SAVE.
+#ifndef MICROPY_MODULE_CACHE_MPY
+#define MICROPY_MODULE_CACHE_MPY (0)
+#endif
+
 // Convenience macro for whether frozen modules are supported
 #ifndef MICROPY_MODULE_FROZEN
 #define MICROPY_MODULE_FROZEN (MICROPY_MODULE_FROZEN_STR || MICROPY_MODULE_FROZEN_MPY)
@@ -762,6 +1033,20 @@ typedef double mp_float_t;
 #define MICROPY_VFS_FAT (0)
 #endif
 
+// Number of import_stat results to remember, so that the repeated lookups of
+// an import searching sys.path don't each stat the filesystem.  The cache is
+// cleared by any change made through the VFS (or mp_vfs_stat_cache_clear()),
+// so it must be disabled (0) if files can be changed another way.
+#ifndef MICROPY_VFS_STAT_CACHE_SIZE
+#define MICROPY_VFS_STAT_CACHE_SIZE (0)
+#endif
+
+// Hook called before the VFS mount table is used, so a port can defer
+// mounting its filesystems until they are first accessed
+#ifndef MICROPY_VFS_LAZY_MOUNT_HOOK
+#define MICROPY_VFS_LAZY_MOUNT_HOOK()
+#endif
+
 /*****************************************************************************/
 /* Fine control over Python builtins, classes, modules, etc                  */
 
@@ -805,6 +1090,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_GENERATOR_PEND_THROW (1)
 #endif
 
+// Whether a generator frees its locals and stack as soon as it finishes,
+// rather than when the generator object is collected
+#ifndef MICROPY_PY_GENERATOR_RELEASE_STATE
+#define MICROPY_PY_GENERATOR_RELEASE_STATE (0)
+#endif
+
 // Issue a warning when comparing str and bytes objects
 #ifndef MICROPY_PY_STR_BYTES_CMP_WARN
 #define MICROPY_PY_STR_BYTES_CMP_WARN (0)
@@ -1038,6 +1329,13 @@ typedef double mp_float_t;
 #define MICROPY_PY_ARRAY_SLICE_ASSIGN (0)
 #endif
 
+// Whether to provide functions in the "array" module that work on whole
+// arrays of numbers at once (add, mul, scale, clip, sum, min, max, dot).
+// Each has a loop for every typecode, which adds a few K of code.
+#ifndef MICROPY_PY_ARRAY_OPS
+#define MICROPY_PY_ARRAY_OPS (0)
+#endif
+
 // Whether to support attrtuple type (MicroPython extension)
 // It provides space-efficient tuples with attribute access
 #ifndef MICROPY_PY_ATTRTUPLE
@@ -1054,6 +1352,16 @@ typedef double mp_float_t;
 #define MICROPY_PY_COLLECTIONS_DEQUE (0)
 #endif
 
+// Whether "ucollections.deque" supports iteration
+#ifndef MICROPY_PY_COLLECTIONS_DEQUE_ITER
+#define MICROPY_PY_COLLECTIONS_DEQUE_ITER (0)
+#endif
+
+// Whether "ucollections.deque" supports getting and setting items by index
+#ifndef MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR
+#define MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR (0)
+#endif
+
 // Whether to provide "collections.OrderedDict" type
 #ifndef MICROPY_PY_COLLECTIONS_ORDEREDDICT
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (0)
@@ -1094,6 +1402,11 @@ typedef double mp_float_t;
 #define MICROPY_PY_GC_COLLECT_RETVAL (0)
 #endif
 
+// Whether to provide gc.fragmentation()
+#ifndef MICROPY_PY_GC_FRAGMENTATION
+#define MICROPY_PY_GC_FRAGMENTATION (0)
+#endif
+
 // Whether to provide "io" module
 #ifndef MICROPY_PY_IO
 #define MICROPY_PY_IO (1)
@@ -1135,6 +1448,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_STRUCT (1)
 #endif
 
+// Whether to provide struct.Struct objects, which cache a parsed format,
+// and struct.iter_unpack
+#ifndef MICROPY_PY_STRUCT_STRUCT
+#define MICROPY_PY_STRUCT_STRUCT (0)
+#endif
+
 // Whether to provide "sys" module
 #ifndef MICROPY_PY_SYS
 #define MICROPY_PY_SYS (1)
@@ -1192,6 +1511,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_USELECT (0)
 #endif
 
+// Whether uselect.poll accepts readiness notifications from streams that
+// support MP_STREAM_POLL_NOTIFY, so it only checks those that signalled
+#ifndef MICROPY_PY_USELECT_NOTIFY
+#define MICROPY_PY_USELECT_NOTIFY (0)
+#endif
+
 // Whether to provide "utime" module functions implementation
 // in terms of mp_hal_* functions.
 #ifndef MICROPY_PY_UTIME_MP_HAL
@@ -1225,6 +1550,17 @@ typedef double mp_float_t;
 #define MICROPY_PY_THREAD_GIL_VM_DIVISOR (32)
 #endif
 
+// Number of locks that the mutable maps (dicts, globals, instance members) are
+// spread over by address, to make them thread-safe without the GIL.  Set to
+// 0 if thread safety of maps is provided at the Python level.
+#ifndef MICROPY_PY_THREAD_MAP_LOCKS
+#if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+#define MICROPY_PY_THREAD_MAP_LOCKS (16)
+#else
+#define MICROPY_PY_THREAD_MAP_LOCKS (0)
+#endif
+#endif
+
 // Extended modules
 
 #ifndef MICROPY_PY_UCTYPES
@@ -1241,10 +1577,46 @@ typedef double mp_float_t;
 #define MICROPY_PY_UZLIB (0)
 #endif
 
+// Number of bits of a Huffman code that uzlib decodes with one table lookup,
+// which adds 4*2^n bytes to each decompressor (0 to decode bit by bit)
+#ifndef MICROPY_PY_UZLIB_LOOKUP_BITS
+#define MICROPY_PY_UZLIB_LOOKUP_BITS (0)
+#endif
+
+// Whether to provide uzlib.compress and uzlib.CompIO
+#ifndef MICROPY_PY_UZLIB_COMPRESS
+#define MICROPY_PY_UZLIB_COMPRESS (0)
+#endif
+
+// Default log2 of the window size of uzlib.CompIO, which needs about
+// three times that many bytes of RAM
+#ifndef MICROPY_PY_UZLIB_COMPRESS_WBITS
+#define MICROPY_PY_UZLIB_COMPRESS_WBITS (10)
+#endif
+
+// Most memory btree.open gives the page cache when no cachesize is given;
+// less is used if it's more than 1/8 of the free heap (0 to leave it to
+// the library)
+#ifndef MICROPY_PY_BTREE_CACHESIZE
+#define MICROPY_PY_BTREE_CACHESIZE (0)
+#endif
+
+// Number of bytes a btree reads at once when iterating over pages stored
+// one after another (0 to read a page at a time)
+#ifndef MICROPY_PY_BTREE_READAHEAD
+#define MICROPY_PY_BTREE_READAHEAD (0)
+#endif
+
 #ifndef MICROPY_PY_UJSON
 #define MICROPY_PY_UJSON (0)
 #endif
 
+// Whether to provide ujson.Decoder, which parses JSON fed to it in pieces
+// into a list of events, without building the whole object
+#ifndef MICROPY_PY_UJSON_DECODER
+#define MICROPY_PY_UJSON_DECODER (0)
+#endif
+
 #ifndef MICROPY_PY_URE
 #define MICROPY_PY_URE (0)
 #endif
@@ -1261,6 +1633,18 @@ typedef double mp_float_t;
 #define MICROPY_PY_URE_SUB (0)
 #endif
 
+// Number of patterns compiled by the module-level ure functions to keep
+// for reuse (0 to recompile on every call)
+#ifndef MICROPY_PY_URE_CACHE_SIZE
+#define MICROPY_PY_URE_CACHE_SIZE (0)
+#endif
+
+// Whether to run patterns with nested repetition on a Pike VM, which takes
+// time linear in the subject length instead of possibly exponential
+#ifndef MICROPY_PY_URE_PIKEVM
+#define MICROPY_PY_URE_PIKEVM (0)
+#endif
+
 #ifndef MICROPY_PY_UHEAPQ
 #define MICROPY_PY_UHEAPQ (0)
 #endif
@@ -1270,6 +1654,11 @@ typedef double mp_float_t;
 #define MICROPY_PY_UTIMEQ (0)
 #endif
 
+// Native task loop for coroutines, the _uasyncio module; needs utimeq
+#ifndef MICROPY_PY_UASYNCIO
+#define MICROPY_PY_UASYNCIO (0)
+#endif
+
 #ifndef MICROPY_PY_UHASHLIB
 #define MICROPY_PY_UHASHLIB (0)
 #endif
@@ -1286,6 +1675,18 @@ typedef double mp_float_t;
 #define MICROPY_PY_UHASHLIB_SHA256 (1)
 #endif
 
+// Whether the built-in SHA256 code uses a transform with its rounds unrolled,
+// which is faster but about 2k bigger
+#ifndef MICROPY_PY_UHASHLIB_SHA256_UNROLL
+#define MICROPY_PY_UHASHLIB_SHA256_UNROLL (0)
+#endif
+
+// Whether to provide uhashlib.crc32; depends on MICROPY_PY_UZLIB
+#ifndef MICROPY_PY_UHASHLIB_CRC32
+#define MICROPY_PY_UHASHLIB_CRC32 (0)
+#endif
+
+// AES comes from axTLS or mbedTLS if one is in use, otherwise it is built in
 #ifndef MICROPY_PY_UCRYPTOLIB
 #define MICROPY_PY_UCRYPTOLIB (0)
 #endif
@@ -1308,6 +1709,13 @@ typedef double mp_float_t;
 #define MICROPY_PY_UBINASCII_CRC32 (0)
 #endif
 
+// Function used by ubinascii.crc32 and uhashlib.crc32 to add len bytes at buf
+// to a running CRC32; a port can define it to use a hardware CRC unit.  The
+// running value is not inverted, ie it starts at 0xffffffff.
+#ifndef MICROPY_CRC32_UPDATE
+#define MICROPY_CRC32_UPDATE(crc, buf, len) uzlib_crc32((buf), (len), (crc))
+#endif
+
 #ifndef MICROPY_PY_URANDOM
 #define MICROPY_PY_URANDOM (0)
 #endif
@@ -1334,12 +1742,46 @@ typedef double mp_float_t;
 #define MICROPY_PY_MACHINE_SPI (0)
 #endif
 
+// Whether to provide machine.SDCardSPI, an SD card block device on a machine.SPI bus
+#ifndef MICROPY_PY_MACHINE_SDCARD_SPI
+#define MICROPY_PY_MACHINE_SDCARD_SPI (0)
+#endif
+
+// Whether to provide machine.NRF24L01, an nRF24L01+ radio on a machine.SPI bus
+#ifndef MICROPY_PY_MACHINE_NRF24L01
+#define MICROPY_PY_MACHINE_NRF24L01 (0)
+#endif
+
+// Whether to include the display protocol and the framebuf to display code
+// shared by the ports' screens (see extmod/machine_display.h)
+#ifndef MICROPY_PY_MACHINE_DISPLAY
+#define MICROPY_PY_MACHINE_DISPLAY (0)
+#endif
+
+// Number of pixels in each of the two line buffers that palette indices are
+// expanded into on their way to a display
+#ifndef MICROPY_PY_MACHINE_DISPLAY_LINE
+#define MICROPY_PY_MACHINE_DISPLAY_LINE (160)
+#endif
+
+// Whether to include the audio output protocol (see extmod/machine_audio.h)
+#ifndef MICROPY_PY_MACHINE_AUDIO
+#define MICROPY_PY_MACHINE_AUDIO (0)
+#endif
+
 #ifndef MICROPY_PY_USSL
 #define MICROPY_PY_USSL (0)
 // Whether to add finaliser code to ussl objects
 #define MICROPY_PY_USSL_FINALISER (0)
 #endif
 
+// Number of TLS sessions that ussl keeps from client connections (with
+// mbedTLS), so that connecting to the same server_hostname again can resume
+// the session with an abbreviated handshake; 0 disables the cache
+#ifndef MICROPY_PY_USSL_SESSION_CACHE_SIZE
+#define MICROPY_PY_USSL_SESSION_CACHE_SIZE (0)
+#endif
+
 #ifndef MICROPY_PY_UWEBSOCKET
 #define MICROPY_PY_UWEBSOCKET (0)
 #endif
@@ -1348,6 +1790,19 @@ typedef double mp_float_t;
 #define MICROPY_PY_FRAMEBUF (0)
 #endif
 
+// Functions a port can define to do framebuf fills and blits on RGB565 pixels
+// with a 2D graphics accelerator.  Strides are in pixels, colours are as
+// stored in the buffer, and each evaluates to false if it did nothing.
+#ifndef MICROPY_FRAMEBUF_HW_FILL_RGB565
+#define MICROPY_FRAMEBUF_HW_FILL_RGB565(dest, stride, w, h, col) (false)
+#endif
+#ifndef MICROPY_FRAMEBUF_HW_COPY_RGB565
+#define MICROPY_FRAMEBUF_HW_COPY_RGB565(dest, dest_stride, src, src_stride, w, h) (false)
+#endif
+#ifndef MICROPY_FRAMEBUF_HW_COPY_L8_RGB565
+#define MICROPY_FRAMEBUF_HW_COPY_L8_RGB565(dest, dest_stride, src, src_stride, w, h, lut) (false)
+#endif
+
 #ifndef MICROPY_PY_BTREE
 #define MICROPY_PY_BTREE (0)
 #endif
@@ -1502,6 +1957,15 @@ typedef double mp_float_t;
 #define MP_NOINLINE __attribute__((noinline))
 #endif
 
+// Wrappers for the hottest functions of the VM and GC, which a port can
+// define to place them in fast memory, eg RAM when flash has wait states
+#ifndef MICROPY_WRAP_MP_EXECUTE_BYTECODE
+#define MICROPY_WRAP_MP_EXECUTE_BYTECODE(f) f
+#endif
+#ifndef MICROPY_WRAP_GC_MARK_SUBTREE
+#define MICROPY_WRAP_GC_MARK_SUBTREE(f) f
+#endif
+
 // Modifier for functions which should be always inlined
 #ifndef MP_ALWAYSINLINE
 #define MP_ALWAYSINLINE __attribute__((always_inline))
@@ -45,12 +45,28 @@
 typedef struct mp_dynamic_compiler_t {
     uint8_t small_int_bits; // must be <= host small_int_bits
     bool opt_cache_map_lookup_in_bytecode;
+    bool opt_superinstructions;
+    bool persistent_code_xip;
     bool py_builtins_str_unicode;
     uint8_t native_arch;
+    // comma-separated names of functions to emit as native or viper code
+    // without a decorator, as "name" or "Class.name"; NULL for none
+    const char *native_funcs;
+    const char *viper_funcs;
 } mp_dynamic_compiler_t;
 extern mp_dynamic_compiler_t mp_dynamic_compiler;
 #endif
 
+#if MICROPY_PY_THREAD_MAP_LOCKS
+// A lock for mutable maps, which the thread holding it can take again, as a
+// lookup may call __eq__ or __hash__ code that uses the same map.
+typedef struct _mp_map_lock_t {
+    mp_thread_mutex_t mutex;
+    struct _mp_state_thread_t *owner;
+    size_t depth;
+} mp_map_lock_t;
+#endif
+
 // These are the values for sched_state
 #define MP_SCHED_IDLE (1)
 #define MP_SCHED_LOCKED (-1)
@@ -61,12 +77,10 @@ typedef struct _mp_sched_item_t {
     mp_obj_t arg;
 } mp_sched_item_t;
 
-// This structure hold information about the memory allocation system.
-typedef struct _mp_state_mem_t {
-    #if MICROPY_MEM_STATS
-    size_t total_bytes_allocated;
-    size_t current_bytes_allocated;
-    size_t peak_bytes_allocated;
+// One contiguous region of RAM managed by the GC, with its own tables.
+typedef struct _mp_state_mem_area_t {
+    #if MICROPY_GC_SPLIT_HEAP
+    struct _mp_state_mem_area_t *next;
     #endif
 
     byte *gc_alloc_table_start;
@@ -77,8 +91,84 @@ typedef struct _mp_state_mem_t {
     byte *gc_pool_start;
     byte *gc_pool_end;
 
+    size_t gc_last_free_atb_index;
+
+    #if MICROPY_GC_FREE_LISTS
+    // start blocks of free runs, indexed by run length less 1
+    size_t gc_free_list[4][MICROPY_GC_FREE_LISTS];
+    uint16_t gc_free_list_len[4];
+    // per run length, an ATB index with no free run that long before it
+    size_t gc_free_run_atb_index[4];
+    #endif
+} mp_state_mem_area_t;
+
+// The progress of a sweep of the GC heap, which can be done in steps.
+typedef struct _mp_gc_sweep_t {
+    mp_state_mem_area_t *area; // area being swept, NULL once all are done
+    size_t block; // next block to sweep
+    size_t run; // free blocks just before block
+    size_t n_free; // free blocks swept
+    int free_tail; // whether the tail blocks at block are to be freed
+} mp_gc_sweep_t;
+
+// An allocation sampled by the GC profiler.
+typedef struct _mp_gc_profile_sample_t {
+    qstr source_file; // MP_QSTR_NULL if not made by bytecode
+    qstr block_name;
+    size_t line;
+    size_t n_bytes;
+} mp_gc_profile_sample_t;
+
+// Where the sampling profiler found the VM.
+typedef struct _mp_profile_sample_t {
+    qstr source_file; // MP_QSTR_NULL if not running bytecode
+    qstr block_name;
+    size_t line;
+} mp_profile_sample_t;
+
+// The times in microseconds taken by each phase of loading a module, not
+// counting the modules it imports, and the heap it keeps.
+typedef struct _mp_import_stats_t {
+    qstr name;
+    char kind; // 'p' .py file, 'm' .mpy file, 's' frozen str, 'f' frozen mpy
+    uint32_t find_us;
+    uint32_t parse_us;
+    uint32_t compile_us;
+    uint32_t load_us;
+    uint32_t exec_us;
+    mp_int_t bytes;
+} mp_import_stats_t;
+
+// The last search for a REPL completion.  Matches of a longer prefix in an
+// unchanged namespace lie between the first and last qstr matched then, so
+// the next Tab only scans that range.  The namespace map is only compared,
+// never followed, so it isn't a root pointer.
+typedef struct _mp_repl_compl_cache_t {
+    const mp_map_t *map; // NULL if nothing is cached
+    size_t map_used;
+    size_t nqstr;
+    qstr q_first; // 0 if nothing matched
+    qstr q_last;
+    uint8_t prefix_len;
+    char prefix[MICROPY_REPL_COMPL_CACHE_PREFIX];
+} mp_repl_compl_cache_t;
+
+// This structure hold information about the memory allocation system.
+typedef struct _mp_state_mem_t {
+    #if MICROPY_MEM_STATS
+    size_t total_bytes_allocated;
+    size_t current_bytes_allocated;
+    size_t peak_bytes_allocated;
+    #endif
+
+    // the first heap area; with MICROPY_GC_SPLIT_HEAP more are chained to it
+    mp_state_mem_area_t area;
+
     int gc_stack_overflow;
     MICROPY_GC_STACK_ENTRY_TYPE gc_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #if MICROPY_GC_SPLIT_HEAP
+    mp_state_mem_area_t *gc_area_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #endif
     uint16_t gc_lock_depth;
 
     // This variable controls auto garbage collection.  If set to 0 then the
@@ -91,12 +181,43 @@ typedef struct _mp_state_mem_t {
     size_t gc_alloc_threshold;
     #endif
 
-    size_t gc_last_free_atb_index;
-
     #if MICROPY_PY_GC_COLLECT_RETVAL
     size_t gc_collected;
     #endif
 
+    #if MICROPY_GC_INCREMENTAL
+    mp_gc_sweep_t gc_sweep;
+    uint8_t gc_sweep_pending;
+    // set to leave the sweep of the next collection to be done in steps
+    uint8_t gc_sweep_lazy;
+    // blocks to allocate before gc.step starts a collection
+    size_t gc_step_amount;
+    #endif
+
+    #if MICROPY_GC_STATS
+    // totals since gc_init, for gc.stats()
+    size_t gc_stats_collections;
+    uint64_t gc_stats_pause_us_total;
+    mp_uint_t gc_stats_pause_us_max;
+    mp_uint_t gc_stats_t0; // ticks_us at the start of the collection
+    uint64_t gc_stats_bytes_allocated;
+    uint64_t gc_stats_blocks_freed;
+    #endif
+
+    #if MICROPY_GC_PROFILE
+    // a ring of samples, taken every gc_profile_period allocations
+    mp_gc_profile_sample_t gc_profile[MICROPY_GC_PROFILE_SAMPLES];
+    size_t gc_profile_n; // samples taken, including those overwritten
+    uint16_t gc_profile_period; // 0 to take none
+    uint16_t gc_profile_countdown;
+    #endif
+
+    #if MICROPY_GC_ARENA
+    // arenas popped with an exception in flight, which are kept by the GC
+    // while anything points into them
+    size_t gc_arena_retired;
+    #endif
+
     #if MICROPY_PY_THREAD
     // This is a global mutex used to make the GC thread-safe.
     mp_thread_mutex_t gc_mutex;
@@ -115,6 +236,11 @@ typedef struct _mp_state_vm_t {
 
     qstr_pool_t *last_pool;
 
+    #if MICROPY_QSTR_INDEX
+    // open-addressed table of qstrs by hash, with 0 for an empty slot
+    uint16_t *qstr_index;
+    #endif
+
     // non-heap memory for creating an exception if we can't allocate RAM
     mp_obj_exception_t mp_emergency_exception_obj;
 
@@ -178,11 +304,27 @@ typedef struct _mp_state_vm_t {
     mp_obj_t lwip_slip_stream;
     #endif
 
+    #if MICROPY_PY_URE && MICROPY_PY_URE_CACHE_SIZE
+    // recently compiled patterns, most recent first, as (str, re) pairs
+    mp_obj_t ure_cache[2 * MICROPY_PY_URE_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_PY_USSL && MICROPY_PY_USSL_SESSION_CACHE_SIZE
+    // sessions of recent TLS client connections, most recent first, as
+    // (server_hostname str, session) pairs
+    mp_obj_t ussl_session_cache[2 * MICROPY_PY_USSL_SESSION_CACHE_SIZE];
+    #endif
+
     #if MICROPY_VFS
     struct _mp_vfs_mount_t *vfs_cur;
     struct _mp_vfs_mount_t *vfs_mount_table;
     #endif
 
+    #if MICROPY_VFS && MICROPY_VFS_STAT_CACHE_SIZE
+    // recent results of mp_vfs_import_stat, as (path str, small int) pairs
+    mp_obj_t vfs_stat_cache[2 * MICROPY_VFS_STAT_CACHE_SIZE];
+    #endif
+
     //
     // END ROOT POINTER SECTION
     ////////////////////////////////////////////////////////////
@@ -193,6 +335,21 @@ typedef struct _mp_state_vm_t {
     size_t qstr_last_alloc;
     size_t qstr_last_used;
 
+    #if MICROPY_QSTR_INDEX
+    size_t qstr_index_alloc; // a power of 2
+    size_t qstr_index_used;
+    #endif
+
+    #if MICROPY_OPT_MAP_LOOKUP_CACHE
+    // guesses at map indices for the lookups made by bytecode
+    uint8_t map_lookup_cache[MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_OPT_ROM_MAP_LOOKUP_CACHE
+    // guesses at where qstrs are in fixed ordered maps
+    uint8_t rom_map_lookup_cache[MICROPY_OPT_ROM_MAP_LOOKUP_CACHE_SIZE];
+    #endif
+
     #if MICROPY_PY_THREAD
     // This is a global mutex used to make qstr interning thread-safe.
     mp_thread_mutex_t qstr_mutex;
@@ -217,6 +374,36 @@ typedef struct _mp_state_vm_t {
     // This is a global mutex used to make the VM/runtime thread-safe.
     mp_thread_mutex_t gil_mutex;
     #endif
+
+    #if MICROPY_PY_THREAD_MAP_LOCKS
+    // locks for the mutable maps, one picked by the address of each map, used
+    // from when a second thread is started
+    mp_map_lock_t map_locks[MICROPY_PY_THREAD_MAP_LOCKS];
+    bool map_locking;
+    #endif
+
+    #if MICROPY_SAMPLING_PROFILE
+    // a ring of samples, taken every profile_period ticks
+    mp_profile_sample_t profile[MICROPY_SAMPLING_PROFILE_SAMPLES];
+    size_t profile_n; // samples taken, including those overwritten
+    volatile uint16_t profile_period; // 0 to take none
+    uint16_t profile_countdown;
+    #endif
+
+    #if MICROPY_IMPORT_STATS
+    mp_import_stats_t import_stats[MICROPY_IMPORT_STATS_MAX];
+    size_t import_stats_n;
+    // the module being loaded, and the phase its time is going to, or NULL
+    mp_import_stats_t *import_stats_cur;
+    uint32_t *import_stats_phase;
+    mp_uint_t import_stats_t0;
+    uint32_t import_stats_find_us;
+    mp_int_t import_stats_child_bytes;
+    #endif
+
+    #if MICROPY_HELPER_REPL
+    mp_repl_compl_cache_t repl_compl;
+    #endif
 } mp_state_vm_t;
 
 // This structure holds state that is specific to a given thread.
@@ -235,6 +422,21 @@ typedef struct _mp_state_thread_t {
     uint8_t *pystack_cur;
     #endif
 
+    #if MICROPY_GC_PROFILE || MICROPY_SAMPLING_PROFILE
+    // the bytecode being run, or NULL
+    struct _mp_code_state_t *current_code_state;
+    #endif
+
+    #if MICROPY_GC_THREAD_CACHE
+    size_t gc_cache_len;
+    #endif
+
+    #if MICROPY_OPT_VM_FREE_RETURNED_TUPLE
+    // the tuple made by "return a, b" in the bytecode function that
+    // returned last, or NULL if it returned anything else
+    mp_obj_t vm_returned_tuple;
+    #endif
+
     ////////////////////////////////////////////////////////////
     // START ROOT POINTER SECTION
     // Everything that needs GC scanning must start here, and
@@ -244,6 +446,22 @@ typedef struct _mp_state_thread_t {
     mp_obj_dict_t *dict_locals;
     mp_obj_dict_t *dict_globals;
 
+    #if MICROPY_GC_ARENA
+    // the arena gc_alloc takes small allocations from, or NULL
+    struct _gc_arena_t *gc_arena;
+    #endif
+
+    #if MICROPY_GC_THREAD_CACHE
+    // free blocks that gc_alloc has taken for this thread, kept from being
+    // swept by being here, or on the stack of the thread
+    void *gc_cache[MICROPY_GC_THREAD_CACHE];
+    #endif
+
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    // bound methods made by this thread, indexed by a hash of meth and self
+    mp_obj_t bound_meth_cache[MICROPY_OPT_BOUND_METH_CACHE_SIZE];
+    #endif
+
     nlr_buf_t *nlr_top;
 } mp_state_thread_t;
 
@@ -47,6 +47,13 @@ void mp_thread_mutex_init(mp_thread_mutex_t *mutex);
 int mp_thread_mutex_lock(mp_thread_mutex_t *mutex, int wait);
 void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex);
 
+#if !MICROPY_PY_THREAD_GIL
+// Without the GIL the other threads must be stopped while the GC marks, so
+// the GC calls these before it traces anything, and once it has marked.
+void mp_thread_gc_others_stop(void);
+void mp_thread_gc_others_resume(void);
+#endif
+
 #endif // MICROPY_PY_THREAD
 
 #if MICROPY_PY_THREAD && MICROPY_PY_THREAD_GIL
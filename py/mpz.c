@@ -424,7 +424,7 @@ STATIC size_t mpn_mul_dig_add_dig(mpz_dig_t *idig, size_t ilen, mpz_dig_t dmul,
    assumes enough memory in i; assumes i is zeroed; assumes normalised j, k
    can have j, k point to same memory
 */
-STATIC size_t mpn_mul(mpz_dig_t *idig, mpz_dig_t *jdig, size_t jlen, mpz_dig_t *kdig, size_t klen) {
+STATIC size_t mpn_mul(mpz_dig_t *idig, const mpz_dig_t *jdig, size_t jlen, const mpz_dig_t *kdig, size_t klen) {
     mpz_dig_t *oidig = idig;
     size_t ilen = 0;
 
@@ -433,7 +433,7 @@ STATIC size_t mpn_mul(mpz_dig_t *idig, mpz_dig_t *jdig, size_t jlen, mpz_dig_t *
         mpz_dbl_dig_t carry = 0;
 
         size_t jl = jlen;
-        for (mpz_dig_t *jd = jdig; jl > 0; --jl, ++jd, ++id) {
+        for (const mpz_dig_t *jd = jdig; jl > 0; --jl, ++jd, ++id) {
             carry += (mpz_dbl_dig_t)*id + (mpz_dbl_dig_t)*jd * (mpz_dbl_dig_t)*kdig; // will never overflow so long as DIG_SIZE <= 8*sizeof(mpz_dbl_dig_t)/2
             *id = carry & DIG_MASK;
             carry >>= DIG_SIZE;
@@ -449,6 +449,126 @@ STATIC size_t mpn_mul(mpz_dig_t *idig, mpz_dig_t *jdig, size_t jlen, mpz_dig_t *
     return ilen;
 }
 
+#if MICROPY_OPT_MPZ_FAST_MUL
+
+// Numbers with fewer digits than this are multiplied by mpn_mul
+#define MPN_KARATSUBA_THRESHOLD (32)
+
+/* computes i += j, with the carry going on up to the end of i
+   assumes ilen >= jlen, and that the sum fits in ilen digits
+*/
+STATIC void mpn_add_inpl(mpz_dig_t *idig, size_t ilen, const mpz_dig_t *jdig, size_t jlen) {
+    mpz_dbl_dig_t carry = 0;
+    ilen -= jlen;
+    for (; jlen > 0; --jlen, ++idig, ++jdig) {
+        carry += (mpz_dbl_dig_t)*idig + (mpz_dbl_dig_t)*jdig;
+        *idig = carry & DIG_MASK;
+        carry >>= DIG_SIZE;
+    }
+    for (; carry != 0 && ilen > 0; --ilen, ++idig) {
+        carry += *idig;
+        *idig = carry & DIG_MASK;
+        carry >>= DIG_SIZE;
+    }
+}
+
+/* computes i -= j, with the borrow going on up to the end of i
+   assumes ilen >= jlen, and i >= j
+*/
+STATIC void mpn_sub_inpl(mpz_dig_t *idig, size_t ilen, const mpz_dig_t *jdig, size_t jlen) {
+    mpz_dbl_dig_signed_t borrow = 0;
+    ilen -= jlen;
+    for (; jlen > 0; --jlen, ++idig, ++jdig) {
+        borrow += (mpz_dbl_dig_t)*idig - (mpz_dbl_dig_t)*jdig;
+        *idig = borrow & DIG_MASK;
+        borrow >>= DIG_SIZE;
+    }
+    for (; borrow != 0 && ilen > 0; --ilen, ++idig) {
+        borrow += *idig;
+        *idig = borrow & DIG_MASK;
+        borrow >>= DIG_SIZE;
+    }
+}
+
+// The number of digits of scratch space mpn_mul_karatsuba needs
+STATIC size_t mpn_mul_karatsuba_scratch(size_t jlen, size_t klen) {
+    if (klen < MPN_KARATSUBA_THRESHOLD) {
+        return 0;
+    }
+    size_t n;
+    if (jlen >= 2 * klen - 1) {
+        // the product of each klen digits of j goes in the scratch space
+        n = mpn_mul_karatsuba_scratch(klen, klen);
+        if (jlen % klen != 0) {
+            n = MAX(n, mpn_mul_karatsuba_scratch(klen, jlen % klen));
+        }
+        return 2 * klen + n;
+    }
+    size_t m = (jlen + 1) / 2;
+    n = mpn_mul_karatsuba_scratch(m + 1, m + 1);
+    n = MAX(n, mpn_mul_karatsuba_scratch(m, m));
+    n = MAX(n, mpn_mul_karatsuba_scratch(jlen - m, klen - m));
+    return 4 * (m + 1) + n;
+}
+
+/* computes i = j * k, writing all jlen + klen digits of i
+   assumes jlen >= klen; j and k needn't be normalised
+   scratch has mpn_mul_karatsuba_scratch(jlen, klen) digits
+*/
+STATIC void mpn_mul_karatsuba(mpz_dig_t *idig, const mpz_dig_t *jdig, size_t jlen, const mpz_dig_t *kdig, size_t klen, mpz_dig_t *scratch) {
+    if (klen < MPN_KARATSUBA_THRESHOLD) {
+        memset(idig, 0, (jlen + klen) * sizeof(mpz_dig_t));
+        if (klen > 0) {
+            mpn_mul(idig, jdig, jlen, kdig, klen);
+        }
+        return;
+    }
+
+    if (jlen >= 2 * klen - 1) {
+        // lopsided, so multiply k by each part of j that's as long as k
+        memset(idig, 0, (jlen + klen) * sizeof(mpz_dig_t));
+        for (size_t off = 0; off < jlen; off += klen) {
+            size_t n = MIN(klen, jlen - off);
+            if (n < klen) {
+                mpn_mul_karatsuba(scratch, kdig, klen, jdig + off, n, scratch + 2 * klen);
+            } else {
+                mpn_mul_karatsuba(scratch, jdig + off, n, kdig, klen, scratch + 2 * klen);
+            }
+            mpn_add_inpl(idig + off, jlen + klen - off, scratch, n + klen);
+        }
+        return;
+    }
+
+    // with j = j1 * B**m + j0 and k = k1 * B**m + k0, and B the digit base,
+    // j * k = j1*k1 * B**2m + ((j0 + j1)*(k0 + k1) - j0*k0 - j1*k1) * B**m + j0*k0
+    size_t m = (jlen + 1) / 2;
+    mpz_dig_t *jsum = scratch;
+    mpz_dig_t *ksum = jsum + m + 1;
+    mpz_dig_t *mid = ksum + m + 1;
+    mpz_dig_t *next = mid + 2 * (m + 1);
+
+    mpn_mul_karatsuba(idig, jdig, m, kdig, m, next);
+    mpn_mul_karatsuba(idig + 2 * m, jdig + m, jlen - m, kdig + m, klen - m, next);
+
+    memcpy(jsum, jdig, m * sizeof(mpz_dig_t));
+    jsum[m] = 0;
+    mpn_add_inpl(jsum, m + 1, jdig + m, jlen - m);
+    memcpy(ksum, kdig, m * sizeof(mpz_dig_t));
+    ksum[m] = 0;
+    mpn_add_inpl(ksum, m + 1, kdig + m, klen - m);
+    mpn_mul_karatsuba(mid, jsum, m + 1, ksum, m + 1, next);
+
+    mpn_sub_inpl(mid, 2 * (m + 1), idig, 2 * m);
+    mpn_sub_inpl(mid, 2 * (m + 1), idig + 2 * m, jlen + klen - 2 * m);
+
+    // the middle product can have more digits than there's room for, but
+    // the ones that don't fit are zero
+    size_t ilen = jlen + klen - m;
+    mpn_add_inpl(idig + m, ilen, mid, MIN(ilen, 2 * (m + 1)));
+}
+
+#endif
+
 /* natural_div - quo * den + new_num = old_num (ie num is replaced with rem)
    assumes den != 0
    assumes num_dig has enough memory to be extended by 1 digit
@@ -1313,8 +1433,24 @@ void mpz_mul_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs) {
     }
 
     mpz_need_dig(dest, lhs->len + rhs->len); // min mem l+r-1, max mem l+r
-    memset(dest->dig, 0, dest->alloc * sizeof(mpz_dig_t));
-    dest->len = mpn_mul(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    #if MICROPY_OPT_MPZ_FAST_MUL
+    if (lhs->len >= MPN_KARATSUBA_THRESHOLD && rhs->len >= MPN_KARATSUBA_THRESHOLD) {
+        if (lhs->len < rhs->len) {
+            const mpz_t *t = lhs;
+            lhs = rhs;
+            rhs = t;
+        }
+        size_t n = mpn_mul_karatsuba_scratch(lhs->len, rhs->len);
+        mpz_dig_t *scratch = m_new(mpz_dig_t, n);
+        mpn_mul_karatsuba(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len, scratch);
+        m_del(mpz_dig_t, scratch, n);
+        dest->len = mpn_remove_trailing_zeros(dest->dig, dest->dig + lhs->len + rhs->len);
+    } else
+    #endif
+    {
+        memset(dest->dig, 0, dest->alloc * sizeof(mpz_dig_t));
+        dest->len = mpn_mul(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    }
 
     if (lhs->neg == rhs->neg) {
         dest->neg = 0;
@@ -1359,6 +1495,160 @@ void mpz_pow_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs) {
     mpz_free(n);
 }
 
+#if MICROPY_OPT_MPZ_FAST_MUL
+
+// For pow(a, b, m) with m odd, numbers mod m are kept in Montgomery form, as
+// x * R % m with R = B ** mlen, and then multiplied without dividing
+
+// The size of the window of exponent bits taken at once, from the bit length
+#define MPZ_POW_WINDOW(n_bits) ((n_bits) > 512 ? 5 : (n_bits) > 128 ? 4 : (n_bits) > 24 ? 3 : 1)
+
+typedef struct _mpz_mont_t {
+    const mpz_dig_t *mod;
+    size_t len;
+    mpz_dig_t minv; // -1 / mod % B
+    mpz_dig_t *t; // 2 * len + 1 digits for the product
+    mpz_dig_t *scratch;
+} mpz_mont_t;
+
+/* computes i = j * k / R % m
+   j, k and i have m->len digits and are less than the modulus
+   can have i, j, k pointing to same memory
+*/
+STATIC void mpz_mont_mul(const mpz_mont_t *m, mpz_dig_t *idig, const mpz_dig_t *jdig, const mpz_dig_t *kdig) {
+    size_t len = m->len;
+    mpz_dig_t *t = m->t;
+    mpn_mul_karatsuba(t, jdig, len, kdig, len, m->scratch);
+    t[2 * len] = 0;
+
+    // add multiples of the modulus to clear the low digits, so that t divides by R
+    for (size_t i = 0; i < len; ++i) {
+        mpz_dig_t u = ((mpz_dbl_dig_t)t[i] * m->minv) & DIG_MASK;
+        mpz_dbl_dig_t carry = 0;
+        for (size_t j = 0; j < len; ++j) {
+            carry += (mpz_dbl_dig_t)t[i + j] + (mpz_dbl_dig_t)u * m->mod[j]; // will never overflow so long as DIG_SIZE <= 8*sizeof(mpz_dbl_dig_t)/2
+            t[i + j] = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+        for (mpz_dig_t *d = t + i + len; carry != 0; ++d) {
+            carry += *d;
+            *d = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+    }
+
+    // t / R is now less than twice the modulus
+    mpz_dig_t *r = t + len;
+    int cmp = r[len] != 0;
+    for (size_t i = len; cmp == 0 && i > 0; --i) {
+        cmp = (r[i - 1] > m->mod[i - 1]) - (r[i - 1] < m->mod[i - 1]);
+    }
+    if (cmp >= 0) {
+        mpn_sub_inpl(r, len + 1, m->mod, len);
+    }
+    memcpy(idig, r, len * sizeof(mpz_dig_t));
+}
+
+STATIC bool mpz_test_bit(const mpz_t *z, size_t bit) {
+    return (z->dig[bit / DIG_SIZE] >> (bit % DIG_SIZE)) & 1;
+}
+
+/* computes dest = (lhs ** rhs) % mod, going through the bits of rhs from the
+   top, squaring for each bit and multiplying by an odd power of lhs for each
+   window of up to w bits that starts and ends with a 1
+   assumes mod is odd and positive, and rhs is positive
+   can have dest, lhs, rhs the same; mod can't be the same as dest
+*/
+STATIC void mpz_pow3_mont(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t *mod) {
+    size_t len = mod->len;
+    size_t n_bits = (rhs->len - 1) * DIG_SIZE;
+    for (mpz_dig_t d = rhs->dig[rhs->len - 1]; d != 0; d >>= 1) {
+        ++n_bits;
+    }
+    size_t w = MPZ_POW_WINDOW(n_bits);
+    size_t n_pow = (size_t)1 << (w - 1);
+
+    mpz_mont_t m;
+    m.mod = mod->dig;
+    m.len = len;
+    // Newton's iteration doubles the number of correct low bits of 1 / mod,
+    // starting with mod itself being right to 3 bits
+    mpz_dbl_dig_t inv = mod->dig[0];
+    for (size_t bits = 3; bits < DIG_SIZE; bits *= 2) {
+        inv = (inv * (2 - mod->dig[0] * inv)) & DIG_MASK;
+    }
+    m.minv = -inv & DIG_MASK;
+
+    // odd_pow holds lhs ** (2 * i + 1) * R % mod for i < n_pow, then comes
+    // the accumulator, the product and the scratch space for multiplying
+    size_t n_scratch = mpn_mul_karatsuba_scratch(len, len);
+    size_t n_dig = (n_pow + 1) * len + 2 * len + 1 + n_scratch;
+    mpz_dig_t *odd_pow = m_new(mpz_dig_t, n_dig);
+    mpz_dig_t *acc = odd_pow + n_pow * len;
+    m.t = acc + len;
+    m.scratch = m.t + 2 * len + 1;
+
+    // lhs * R % mod, which is the only division
+    mpz_t x, quo;
+    mpz_init_zero(&x);
+    mpz_init_zero(&quo);
+    mpz_shl_inpl(&x, lhs, len * DIG_SIZE);
+    mpz_divmod_inpl(&quo, &x, &x, mod);
+    memset(odd_pow, 0, len * sizeof(mpz_dig_t));
+    memcpy(odd_pow, x.dig, x.len * sizeof(mpz_dig_t));
+    mpz_deinit(&x);
+    mpz_deinit(&quo);
+
+    if (n_pow > 1) {
+        mpz_mont_mul(&m, acc, odd_pow, odd_pow);
+        for (size_t i = 1; i < n_pow; ++i) {
+            mpz_mont_mul(&m, odd_pow + i * len, odd_pow + (i - 1) * len, acc);
+        }
+    }
+
+    // the top bit of rhs is set, so the first window starts off acc
+    bool first = true;
+    for (size_t i = n_bits; i > 0;) {
+        if (!mpz_test_bit(rhs, i - 1)) {
+            mpz_mont_mul(&m, acc, acc, acc);
+            --i;
+            continue;
+        }
+        // the window is bits i - 1 down to l, with bit l set
+        size_t l = i > w ? i - w : 0;
+        while (!mpz_test_bit(rhs, l)) {
+            ++l;
+        }
+        size_t val = 0;
+        for (size_t j = i; j > l; --j) {
+            val = val << 1 | mpz_test_bit(rhs, j - 1);
+        }
+        if (first) {
+            memcpy(acc, odd_pow + (val >> 1) * len, len * sizeof(mpz_dig_t));
+            first = false;
+        } else {
+            for (size_t j = l; j < i; ++j) {
+                mpz_mont_mul(&m, acc, acc, acc);
+            }
+            mpz_mont_mul(&m, acc, acc, odd_pow + (val >> 1) * len);
+        }
+        i = l;
+    }
+
+    // multiplying by 1 takes it out of Montgomery form
+    memset(odd_pow, 0, len * sizeof(mpz_dig_t));
+    odd_pow[0] = 1;
+    mpz_mont_mul(&m, acc, acc, odd_pow);
+
+    mpz_need_dig(dest, len);
+    memcpy(dest->dig, acc, len * sizeof(mpz_dig_t));
+    dest->len = mpn_remove_trailing_zeros(dest->dig, dest->dig + len);
+    dest->neg = 0;
+    m_del(mpz_dig_t, odd_pow, n_dig);
+}
+
+#endif
+
 /* computes dest = (lhs ** rhs) % mod
    can have dest, lhs, rhs the same; mod can't be the same as dest
 */
@@ -1368,6 +1658,13 @@ void mpz_pow3_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t
         return;
     }
 
+    #if MICROPY_OPT_MPZ_FAST_MUL
+    if (rhs->len != 0 && mod->len >= 2 && !mod->neg && (mod->dig[0] & 1) != 0) {
+        mpz_pow3_mont(dest, lhs, rhs, mod);
+        return;
+    }
+    #endif
+
     mpz_set_from_int(dest, 1);
 
     if (rhs->len == 0) {
@@ -132,7 +132,7 @@ NORETURN void nlr_jump(void *val) {
     "bx     lr                  \n" // return
     :                               // output operands
     : "r"(top)                      // input operands
-    :                               // clobbered registers
+    : "memory"                      // clobbered registers
     );
 
     #if defined(__GNUC__)
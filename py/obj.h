@@ -354,7 +354,8 @@ typedef struct _mp_map_t {
     size_t all_keys_are_qstrs : 1;
     size_t is_fixed : 1;    // a fixed array that can't be modified; must also be ordered
     size_t is_ordered : 1;  // an ordered array
-    size_t used : (8 * sizeof(size_t) - 3);
+    size_t is_indexed : 1;  // an ordered array followed by a hash index of it
+    size_t used : (8 * sizeof(size_t) - 4);
     size_t alloc;
     mp_map_elem_t *table;
 } mp_map_t;
@@ -377,6 +378,12 @@ mp_map_t *mp_map_new(size_t n);
 void mp_map_deinit(mp_map_t *map);
 void mp_map_free(mp_map_t *map);
 mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind);
+#if MICROPY_PY_THREAD_MAP_LOCKS
+// set the value at index, with the map locked for the whole store
+void mp_map_store(mp_map_t *map, mp_obj_t index, mp_obj_t value);
+#else
+static inline void mp_map_store(mp_map_t *map, mp_obj_t index, mp_obj_t value) { mp_map_lookup(map, index, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value; }
+#endif
 void mp_map_clear(mp_map_t *map);
 void mp_map_dump(mp_map_t *map);
 
@@ -618,6 +625,9 @@ extern const struct _mp_obj_tuple_t mp_const_empty_tuple_obj;
 extern const struct _mp_obj_singleton_t mp_const_ellipsis_obj;
 extern const struct _mp_obj_singleton_t mp_const_notimplemented_obj;
 extern const struct _mp_obj_exception_t mp_const_GeneratorExit_obj;
+#if MICROPY_EXC_TRACEBACK_LAZY
+extern const struct _mp_obj_exception_t mp_const_StopIteration_obj;
+#endif
 
 // General API for objects
 
@@ -718,6 +728,11 @@ bool mp_obj_is_exception_instance(mp_obj_t self_in);
 bool mp_obj_exception_match(mp_obj_t exc, mp_const_obj_t exc_type);
 void mp_obj_exception_clear_traceback(mp_obj_t self_in);
 void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qstr block);
+#if MICROPY_EXC_TRACEBACK_LAZY
+struct _mp_obj_fun_bc_t;
+// Add the opcode at ip in fun_bc to the traceback, but not until it's needed
+void mp_obj_exception_defer_traceback(mp_obj_t self_in, const struct _mp_obj_fun_bc_t *fun_bc, const byte *ip);
+#endif
 void mp_obj_exception_get_traceback(mp_obj_t self_in, size_t *n, size_t **values);
 mp_obj_t mp_obj_exception_get_value(mp_obj_t self_in);
 mp_obj_t mp_obj_exception_make_new(const mp_obj_type_t *type_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
@@ -775,10 +790,24 @@ mp_obj_t mp_obj_dict_delete(mp_obj_t self_in, mp_obj_t key);
 static inline mp_map_t *mp_obj_dict_get_map(mp_obj_t dict) {
     return &((mp_obj_dict_t*)MP_OBJ_TO_PTR(dict))->map;
 }
+// For an iterator over the items of a dict, store the next value and key in
+// items and return true, or return false at the end
+bool mp_obj_is_dict_items_iter(mp_obj_t o);
+bool mp_obj_dict_items_next2(mp_obj_t self_in, mp_obj_t *items);
 
 // set
 void mp_obj_set_store(mp_obj_t self_in, mp_obj_t item);
 
+// enumerate
+// Store the next index and item in items, or return false at the end
+bool mp_obj_enumerate_next2(mp_obj_t self_in, mp_obj_t *items);
+
+// zip
+// Store the next item of each iterable in num items, last first, or return
+// false at the end; num must be the number of iterables
+size_t mp_obj_zip_len(mp_obj_t self_in);
+bool mp_obj_zip_next_n(mp_obj_t self_in, size_t num, mp_obj_t *items);
+
 // slice
 void mp_obj_slice_get(mp_obj_t self_in, mp_obj_t *start, mp_obj_t *stop, mp_obj_t *step);
 
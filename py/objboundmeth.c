@@ -108,9 +108,24 @@ STATIC const mp_obj_type_t mp_type_bound_meth = {
 };
 
 mp_obj_t mp_obj_new_bound_meth(mp_obj_t meth, mp_obj_t self) {
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    // a bound method can't be changed, so the one made last for the same meth
+    // and self can be given out again
+    size_t i = (((uintptr_t)self >> 4) ^ ((uintptr_t)meth >> 2)) & (MICROPY_OPT_BOUND_METH_CACHE_SIZE - 1);
+    mp_obj_t *cached = &MP_STATE_THREAD(bound_meth_cache)[i];
+    if (*cached != MP_OBJ_NULL) {
+        mp_obj_bound_meth_t *c = MP_OBJ_TO_PTR(*cached);
+        if (c->meth == meth && c->self == self) {
+            return *cached;
+        }
+    }
+    #endif
     mp_obj_bound_meth_t *o = m_new_obj(mp_obj_bound_meth_t);
     o->base.type = &mp_type_bound_meth;
     o->meth = meth;
     o->self = self;
+    #if MICROPY_OPT_BOUND_METH_CACHE
+    *cached = MP_OBJ_FROM_PTR(o);
+    #endif
     return MP_OBJ_FROM_PTR(o);
 }
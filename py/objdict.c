@@ -259,7 +259,7 @@ STATIC mp_obj_t dict_fromkeys(size_t n_args, const mp_obj_t *args) {
 
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_out);
     while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
-        mp_map_lookup(&self->map, next, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+        mp_map_store(&self->map, next, value);
     }
 
     return self_out;
@@ -318,14 +318,30 @@ STATIC mp_obj_t dict_popitem(mp_obj_t self_in) {
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
     mp_ensure_not_fixed(self);
     size_t cur = 0;
-    mp_map_elem_t *next = dict_iter_next(self, &cur);
+    mp_map_elem_t *next;
+    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+    if (self->map.is_ordered) {
+        // an ordered array can't have holes, so remove the last item, like CPython
+        next = self->map.used == 0 ? NULL : &self->map.table[self->map.used - 1];
+    } else
+    #endif
+    {
+        next = dict_iter_next(self, &cur);
+    }
     if (next == NULL) {
         mp_raise_msg(&mp_type_KeyError, "popitem(): dictionary is empty");
     }
-    self->map.used--;
     mp_obj_t items[] = {next->key, next->value};
-    next->key = MP_OBJ_SENTINEL; // must mark key as sentinel to indicate that it was deleted
-    next->value = MP_OBJ_NULL;
+    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+    if (self->map.is_ordered) {
+        mp_map_lookup(&self->map, items[0], MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    } else
+    #endif
+    {
+        self->map.used--;
+        next->key = MP_OBJ_SENTINEL; // must mark key as sentinel to indicate that it was deleted
+        next->value = MP_OBJ_NULL;
+    }
     mp_obj_t tuple = mp_obj_new_tuple(2, items);
 
     return tuple;
@@ -348,7 +364,7 @@ STATIC mp_obj_t dict_update(size_t n_args, const mp_obj_t *args, mp_map_t *kwarg
                 size_t cur = 0;
                 mp_map_elem_t *elem = NULL;
                 while ((elem = dict_iter_next((mp_obj_dict_t*)MP_OBJ_TO_PTR(args[1]), &cur)) != NULL) {
-                    mp_map_lookup(&self->map, elem->key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = elem->value;
+                    mp_map_store(&self->map, elem->key, elem->value);
                 }
             }
         } else {
@@ -365,7 +381,7 @@ STATIC mp_obj_t dict_update(size_t n_args, const mp_obj_t *args, mp_map_t *kwarg
                     || stop != MP_OBJ_STOP_ITERATION) {
                     mp_raise_ValueError("dict update sequence has wrong length");
                 } else {
-                    mp_map_lookup(&self->map, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+                    mp_map_store(&self->map, key, value);
                 }
             }
         }
@@ -374,7 +390,7 @@ STATIC mp_obj_t dict_update(size_t n_args, const mp_obj_t *args, mp_map_t *kwarg
     // update the dict with any keyword args
     for (size_t i = 0; i < kwargs->alloc; i++) {
         if (mp_map_slot_is_filled(kwargs, i)) {
-            mp_map_lookup(&self->map, kwargs->table[i].key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = kwargs->table[i].value;
+            mp_map_store(&self->map, kwargs->table[i].key, kwargs->table[i].value);
         }
     }
 
@@ -439,6 +455,23 @@ STATIC const mp_obj_type_t dict_view_it_type = {
     .iternext = dict_view_it_iternext,
 };
 
+bool mp_obj_is_dict_items_iter(mp_obj_t o) {
+    return mp_obj_is_type(o, &dict_view_it_type)
+        && ((mp_obj_dict_view_it_t*)MP_OBJ_TO_PTR(o))->kind == MP_DICT_VIEW_ITEMS;
+}
+
+bool mp_obj_dict_items_next2(mp_obj_t self_in, mp_obj_t *items) {
+    assert(mp_obj_is_dict_items_iter(self_in));
+    mp_obj_dict_view_it_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_map_elem_t *next = dict_iter_next(MP_OBJ_TO_PTR(self->dict), &self->cur);
+    if (next == NULL) {
+        return false;
+    }
+    items[0] = next->value;
+    items[1] = next->key;
+    return true;
+}
+
 STATIC mp_obj_t dict_view_getiter(mp_obj_t view_in, mp_obj_iter_buf_t *iter_buf) {
     assert(sizeof(mp_obj_dict_view_it_t) <= sizeof(mp_obj_iter_buf_t));
     mp_check_self(mp_obj_is_type(view_in, &dict_view_type));
@@ -604,7 +637,7 @@ mp_obj_t mp_obj_dict_store(mp_obj_t self_in, mp_obj_t key, mp_obj_t value) {
     mp_check_self(mp_obj_is_dict_type(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
     mp_ensure_not_fixed(self);
-    mp_map_lookup(&self->map, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+    mp_map_store(&self->map, key, value);
     return self_in;
 }
 
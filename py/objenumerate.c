@@ -35,6 +35,8 @@ typedef struct _mp_obj_enumerate_t {
     mp_obj_base_t base;
     mp_obj_t iter;
     mp_int_t cur;
+    // so that iterating over a list or similar doesn't need another allocation
+    mp_obj_iter_buf_t iter_buf;
 } mp_obj_enumerate_t;
 
 STATIC mp_obj_t enumerate_iternext(mp_obj_t self_in);
@@ -56,13 +58,13 @@ STATIC mp_obj_t enumerate_make_new(const mp_obj_type_t *type, size_t n_args, siz
     // create enumerate object
     mp_obj_enumerate_t *o = m_new_obj(mp_obj_enumerate_t);
     o->base.type = type;
-    o->iter = mp_getiter(arg_vals.iterable.u_obj, NULL);
+    o->iter = mp_getiter(arg_vals.iterable.u_obj, &o->iter_buf);
     o->cur = arg_vals.start.u_int;
 #else
     (void)n_kw;
     mp_obj_enumerate_t *o = m_new_obj(mp_obj_enumerate_t);
     o->base.type = type;
-    o->iter = mp_getiter(args[0], NULL);
+    o->iter = mp_getiter(args[0], &o->iter_buf);
     o->cur = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
 #endif
 
@@ -77,16 +79,24 @@ const mp_obj_type_t mp_type_enumerate = {
     .getiter = mp_identity_getiter,
 };
 
-STATIC mp_obj_t enumerate_iternext(mp_obj_t self_in) {
+bool mp_obj_enumerate_next2(mp_obj_t self_in, mp_obj_t *items) {
     assert(mp_obj_is_type(self_in, &mp_type_enumerate));
     mp_obj_enumerate_t *self = MP_OBJ_TO_PTR(self_in);
     mp_obj_t next = mp_iternext(self->iter);
     if (next == MP_OBJ_STOP_ITERATION) {
+        return false;
+    }
+    items[0] = MP_OBJ_NEW_SMALL_INT(self->cur++);
+    items[1] = next;
+    return true;
+}
+
+STATIC mp_obj_t enumerate_iternext(mp_obj_t self_in) {
+    mp_obj_t items[2];
+    if (!mp_obj_enumerate_next2(self_in, items)) {
         return MP_OBJ_STOP_ITERATION;
-    } else {
-        mp_obj_t items[] = {MP_OBJ_NEW_SMALL_INT(self->cur++), next};
-        return mp_obj_new_tuple(2, items);
     }
+    return mp_obj_new_tuple(2, items);
 }
 
 #endif // MICROPY_PY_BUILTINS_ENUMERATE
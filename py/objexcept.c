@@ -30,6 +30,8 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include "py/bc.h"
+#include "py/objfun.h"
 #include "py/objlist.h"
 #include "py/objstr.h"
 #include "py/objtuple.h"
@@ -105,6 +107,11 @@ mp_obj_t mp_alloc_emergency_exception_buf(mp_obj_t size_in) {
 // definition module-private so far, have it here.
 const mp_obj_exception_t mp_const_GeneratorExit_obj = {{&mp_type_GeneratorExit}, 0, 0, NULL, (mp_obj_tuple_t*)&mp_const_empty_tuple_obj};
 
+#if MICROPY_EXC_TRACEBACK_LAZY
+// Instance raised by "raise StopIteration", which is often used for control flow
+const mp_obj_exception_t mp_const_StopIteration_obj = {{&mp_type_StopIteration}, 0, 0, NULL, (mp_obj_tuple_t*)&mp_const_empty_tuple_obj};
+#endif
+
 void mp_obj_exception_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t kind) {
     mp_obj_exception_t *o = MP_OBJ_TO_PTR(o_in);
     mp_print_kind_t k = kind & ~PRINT_EXC_SUBCLASS;
@@ -210,6 +217,12 @@ void mp_obj_exception_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
             // exception instance, so before throwing it, traceback should
             // be cleared like above.
             self->traceback_len = 0;
+            #if MICROPY_EXC_TRACEBACK_LAZY
+            if (self->traceback_alloc == 0) {
+                // drop a deferred entry
+                self->traceback_data = NULL;
+            }
+            #endif
             dest[0] = MP_OBJ_NULL; // indicate success
         }
         return;
@@ -493,9 +506,7 @@ void mp_obj_exception_clear_traceback(mp_obj_t self_in) {
     self->traceback_data = NULL;
 }
 
-void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qstr block) {
-    GET_NATIVE_EXCEPTION(self, self_in);
-
+STATIC void exception_add_traceback(mp_obj_exception_t *self, qstr file, size_t line, qstr block) {
     // append this traceback info to traceback data
     // if memory allocation fails (eg because gc is locked), just return
 
@@ -546,8 +557,50 @@ void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qs
     tb_data[2] = block;
 }
 
+#if MICROPY_EXC_TRACEBACK_LAZY
+// A deferred entry is kept in place of the traceback, which must be empty, by
+// setting traceback_data to the function and traceback_len to the offset of
+// the opcode in its bytecode; traceback_alloc is 0 to tell it apart.
+STATIC void exception_decode_deferred_traceback(mp_obj_exception_t *self) {
+    if (self->traceback_alloc == 0 && self->traceback_data != NULL) {
+        const mp_obj_fun_bc_t *fun_bc = (const mp_obj_fun_bc_t*)self->traceback_data;
+        qstr block_name, source_file;
+        size_t source_line = mp_bytecode_get_source_line(fun_bc, fun_bc->bytecode + self->traceback_len,
+            &block_name, &source_file);
+        self->traceback_data = NULL;
+        exception_add_traceback(self, source_file, source_line, block_name);
+    }
+}
+
+void mp_obj_exception_defer_traceback(mp_obj_t self_in, const mp_obj_fun_bc_t *fun_bc, const byte *ip) {
+    GET_NATIVE_EXCEPTION(self, self_in);
+    exception_decode_deferred_traceback(self);
+    size_t offset = ip - fun_bc->bytecode;
+    if (self->traceback_data == NULL && offset < ((size_t)1 << (4 * sizeof(size_t)))) {
+        self->traceback_alloc = 0;
+        self->traceback_len = offset;
+        self->traceback_data = (size_t*)fun_bc;
+    } else {
+        qstr block_name, source_file;
+        size_t source_line = mp_bytecode_get_source_line(fun_bc, ip, &block_name, &source_file);
+        exception_add_traceback(self, source_file, source_line, block_name);
+    }
+}
+#endif
+
+void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qstr block) {
+    GET_NATIVE_EXCEPTION(self, self_in);
+    #if MICROPY_EXC_TRACEBACK_LAZY
+    exception_decode_deferred_traceback(self);
+    #endif
+    exception_add_traceback(self, file, line, block);
+}
+
 void mp_obj_exception_get_traceback(mp_obj_t self_in, size_t *n, size_t **values) {
     GET_NATIVE_EXCEPTION(self, self_in);
+    #if MICROPY_EXC_TRACEBACK_LAZY
+    exception_decode_deferred_traceback(self);
+    #endif
 
     if (self->traceback_data == NULL) {
         *n = 0;
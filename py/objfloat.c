@@ -116,11 +116,14 @@ STATIC void float_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t
     #else
     const int precision = 7;
     #endif
+    const char fmt = 'g';
 #else
     char buf[32];
     const int precision = 16;
+    // shortest digits that give back the same value, like CPython
+    const char fmt = 'r';
 #endif
-    mp_format_float(o_val, buf, sizeof(buf), 'g', precision, '\0');
+    mp_format_float(o_val, buf, sizeof(buf), fmt, precision, '\0');
     mp_print_str(print, buf);
     if (strchr(buf, '.') == NULL && strchr(buf, 'e') == NULL && strchr(buf, 'n') == NULL) {
         // Python floats always have decimal point (unless inf or nan)
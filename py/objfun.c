@@ -167,6 +167,11 @@ qstr mp_obj_fun_get_name(mp_const_obj_t fun_in) {
     bc++; // skip n_pos_args
     bc++; // skip n_kwonly_args
     bc++; // skip n_def_pos_args
+    #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+    if (mp_bytecode_is_xip(fun->bytecode)) {
+        return MP_OBJ_QSTR_VALUE(fun->const_table[mp_obj_code_get_name(bc)]);
+    }
+    #endif
     return mp_obj_code_get_name(bc);
 }
 
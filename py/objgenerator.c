@@ -123,6 +123,30 @@ const mp_obj_type_t mp_type_native_gen_wrap = {
 /******************************************************************************/
 /* generator instance                                                         */
 
+#if MICROPY_PY_GENERATOR_RELEASE_STATE
+// Once a generator has finished its locals and stack are no longer needed, so
+// give that memory back to the heap straight away instead of keeping it until
+// the generator object itself is collected.  One state slot is kept so that sp
+// still points into the object, for pend_throw.
+STATIC void gen_instance_release_state(mp_obj_gen_instance_t *self) {
+    const byte *bc = self->code_state.fun_bc->bytecode;
+    size_t n_bytes;
+    #if MICROPY_EMIT_NATIVE
+    if (self->code_state.exc_sp == NULL) {
+        n_bytes = mp_decode_uint_value(bc + ((uintptr_t*)bc)[0]) * sizeof(mp_obj_t);
+    } else
+    #endif
+    {
+        n_bytes = mp_decode_uint_value(bc) * sizeof(mp_obj_t)
+            + mp_decode_uint_value(mp_decode_uint_skip(bc)) * sizeof(mp_exc_stack_t);
+    }
+    self->code_state.state[0] = mp_const_none;
+    self->code_state.sp = &self->code_state.state[0];
+    (void)m_renew_maybe(byte, self, sizeof(mp_obj_gen_instance_t) + n_bytes,
+        sizeof(mp_obj_gen_instance_t) + sizeof(mp_obj_t), false);
+}
+#endif
+
 STATIC void gen_instance_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)kind;
     mp_obj_gen_instance_t *self = MP_OBJ_TO_PTR(self_in);
@@ -212,6 +236,12 @@ mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_
         }
     }
 
+    #if MICROPY_PY_GENERATOR_RELEASE_STATE
+    if (ret_kind != MP_VM_RETURN_YIELD) {
+        gen_instance_release_state(self);
+    }
+    #endif
+
     return ret_kind;
 }
 
@@ -283,35 +283,246 @@ STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args) {
     return ret;
 }
 
-STATIC void mp_quicksort(mp_obj_t *head, mp_obj_t *tail, mp_obj_t key_fn, mp_obj_t binop_less_result) {
-    MP_STACK_CHECK();
-    while (head < tail) {
-        mp_obj_t *h = head - 1;
-        mp_obj_t *t = tail;
-        mp_obj_t v = key_fn == MP_OBJ_NULL ? tail[0] : mp_call_function_1(key_fn, tail[0]); // get pivot using key_fn
-        for (;;) {
-            do ++h; while (h < t && mp_binary_op(MP_BINARY_OP_LESS, key_fn == MP_OBJ_NULL ? h[0] : mp_call_function_1(key_fn, h[0]), v) == binop_less_result);
-            do --t; while (h < t && mp_binary_op(MP_BINARY_OP_LESS, v, key_fn == MP_OBJ_NULL ? t[0] : mp_call_function_1(key_fn, t[0])) == binop_less_result);
-            if (h >= t) break;
-            mp_obj_t x = h[0];
-            h[0] = t[0];
-            t[0] = x;
+// list.sort() is a stable merge sort.  Like timsort it finds the runs that are
+// already in order, extends short ones with a binary insertion sort and merges
+// them, so nearly sorted lists take close to one pass; it doesn't gallop.  Keys
+// are computed once, and merging needs a buffer of half the list's length.
+
+// Lists shorter than this are just insertion sorted
+#define LIST_SORT_MIN_MERGE (32)
+
+// The run lengths grow at least as fast as the Fibonacci numbers
+#define LIST_SORT_MAX_RUNS (sizeof(size_t) * 8 * 3 / 2)
+
+typedef struct _list_sort_t {
+    mp_obj_t *items;
+    mp_obj_t *keys; // the same as items if there's no key function
+    mp_obj_t *tmp_items; // NULL if the buffer couldn't be allocated
+    mp_obj_t *tmp_keys;
+    bool reverse;
+    // if an exception is raised while merging, the rec_n items at index
+    // rec_tmp in the buffer must be put back at index rec_dest
+    size_t rec_n;
+    size_t rec_tmp;
+    size_t rec_dest;
+} list_sort_t;
+
+// Whether a goes before b; equal elements stay in the order they're in
+STATIC bool list_sort_lt(const list_sort_t *st, mp_obj_t a, mp_obj_t b) {
+    if (st->reverse) {
+        return mp_obj_is_true(mp_binary_op(MP_BINARY_OP_LESS, b, a));
+    } else {
+        return mp_obj_is_true(mp_binary_op(MP_BINARY_OP_LESS, a, b));
+    }
+}
+
+// Copy n items, and their keys, between index i in the list and index t in the buffer
+STATIC void list_sort_to_tmp(const list_sort_t *st, size_t t, size_t i, size_t n) {
+    memcpy(&st->tmp_items[t], &st->items[i], n * sizeof(mp_obj_t));
+    if (st->keys != st->items) {
+        memcpy(&st->tmp_keys[t], &st->keys[i], n * sizeof(mp_obj_t));
+    }
+}
+
+STATIC void list_sort_from_tmp(const list_sort_t *st, size_t i, size_t t, size_t n) {
+    memcpy(&st->items[i], &st->tmp_items[t], n * sizeof(mp_obj_t));
+    if (st->keys != st->items) {
+        memcpy(&st->keys[i], &st->tmp_keys[t], n * sizeof(mp_obj_t));
+    }
+}
+
+// Sort [lo, hi), given that [lo, start) is already sorted
+STATIC void list_sort_insertion(list_sort_t *st, size_t lo, size_t start, size_t hi) {
+    mp_obj_t *items = st->items;
+    mp_obj_t *keys = st->keys;
+    for (size_t i = start; i < hi; i++) {
+        // find where it goes, after any equal elements
+        mp_obj_t key = keys[i];
+        size_t l = lo;
+        size_t r = i;
+        while (l < r) {
+            size_t m = l + (r - l) / 2;
+            if (list_sort_lt(st, key, keys[m])) {
+                r = m;
+            } else {
+                l = m + 1;
+            }
         }
-        mp_obj_t x = h[0];
-        h[0] = tail[0];
-        tail[0] = x;
-        // do the smaller recursive call first, to keep stack within O(log(N))
-        if (t - head < tail - h - 1) {
-            mp_quicksort(head, t, key_fn, binop_less_result);
-            head = h + 1;
+        if (l < i) {
+            mp_obj_t item = items[i];
+            memmove(&items[l + 1], &items[l], (i - l) * sizeof(mp_obj_t));
+            items[l] = item;
+            if (keys != items) {
+                memmove(&keys[l + 1], &keys[l], (i - l) * sizeof(mp_obj_t));
+                keys[l] = key;
+            }
+        }
+    }
+}
+
+// Return the length of the run starting at lo, reversing it if it's descending
+STATIC size_t list_sort_count_run(list_sort_t *st, size_t lo, size_t hi) {
+    mp_obj_t *keys = st->keys;
+    size_t i = lo + 1;
+    if (i == hi) {
+        return 1;
+    }
+    if (list_sort_lt(st, keys[i], keys[lo])) {
+        // strictly descending, so reversing it keeps equal elements in order
+        while (++i < hi && list_sort_lt(st, keys[i], keys[i - 1])) {
+        }
+        for (size_t l = lo, r = i - 1; l < r; l++, r--) {
+            mp_obj_t x = st->items[l];
+            st->items[l] = st->items[r];
+            st->items[r] = x;
+            if (keys != st->items) {
+                x = keys[l];
+                keys[l] = keys[r];
+                keys[r] = x;
+            }
+        }
+    } else {
+        while (++i < hi && !list_sort_lt(st, keys[i], keys[i - 1])) {
+        }
+    }
+    return i - lo;
+}
+
+// Merge the sorted runs [lo, mid) and [mid, hi)
+STATIC void list_sort_merge(list_sort_t *st, size_t lo, size_t mid, size_t hi) {
+    mp_obj_t *items = st->items;
+    mp_obj_t *keys = st->keys;
+
+    // the elements of the first run up to the first that goes after the start
+    // of the second run are in place already
+    size_t l = lo;
+    size_t r = mid;
+    while (l < r) {
+        size_t m = l + (r - l) / 2;
+        if (list_sort_lt(st, keys[mid], keys[m])) {
+            r = m;
+        } else {
+            l = m + 1;
+        }
+    }
+    lo = l;
+    if (lo == mid) {
+        return;
+    }
+
+    // and so are the elements of the second run from the first that goes
+    // after the end of the first run
+    l = mid;
+    r = hi;
+    while (l < r) {
+        size_t m = l + (r - l) / 2;
+        if (list_sort_lt(st, keys[m], keys[mid - 1])) {
+            l = m + 1;
         } else {
-            mp_quicksort(h + 1, tail, key_fn, binop_less_result);
-            tail = t;
+            r = m;
         }
     }
+    hi = l;
+
+    mp_obj_t *tmp_items = st->tmp_items;
+    mp_obj_t *tmp_keys = st->tmp_keys;
+    size_t na = mid - lo;
+    size_t nb = hi - mid;
+    if (tmp_items == NULL) {
+        // no buffer, so insert the second run into the first instead
+        list_sort_insertion(st, lo, mid, hi);
+    } else if (na <= nb) {
+        // move the first run to the buffer and merge from the start
+        list_sort_to_tmp(st, 0, lo, na);
+        size_t i = 0;
+        size_t j = mid;
+        size_t d = lo;
+        while (i < na && j < hi) {
+            st->rec_n = na - i;
+            st->rec_tmp = i;
+            st->rec_dest = d;
+            if (list_sort_lt(st, keys[j], tmp_keys[i])) {
+                items[d] = items[j];
+                keys[d++] = keys[j++];
+            } else {
+                items[d] = tmp_items[i];
+                keys[d++] = tmp_keys[i++];
+            }
+        }
+        st->rec_n = 0;
+        list_sort_from_tmp(st, d, i, na - i);
+    } else {
+        // move the second run to the buffer and merge from the end
+        list_sort_to_tmp(st, 0, mid, nb);
+        size_t i = mid;
+        size_t j = nb;
+        size_t d = hi;
+        while (i > lo && j > 0) {
+            st->rec_n = j;
+            st->rec_tmp = 0;
+            st->rec_dest = i;
+            if (list_sort_lt(st, tmp_keys[j - 1], keys[i - 1])) {
+                items[--d] = items[--i];
+                keys[d] = keys[i];
+            } else {
+                items[--d] = tmp_items[--j];
+                keys[d] = tmp_keys[j];
+            }
+        }
+        st->rec_n = 0;
+        list_sort_from_tmp(st, lo, 0, j);
+    }
+}
+
+STATIC void list_sort_runs(list_sort_t *st, size_t n) {
+    // aim for a number of runs that's a power of 2, or just under one
+    size_t min_run = n;
+    size_t extra = 0;
+    while (min_run >= LIST_SORT_MIN_MERGE) {
+        extra |= min_run & 1;
+        min_run >>= 1;
+    }
+    min_run += extra;
+
+    // start[k] is where run k starts, and the last entry is the end of the last run
+    size_t start[LIST_SORT_MAX_RUNS + 1];
+    size_t n_runs = 0;
+    start[0] = 0;
+    #define RUN_LEN(k) (start[(k) + 1] - start[k])
+    for (size_t lo = 0; lo < n || n_runs > 1;) {
+        if (lo < n) {
+            size_t len = list_sort_count_run(st, lo, n);
+            if (len < min_run) {
+                size_t force = MIN(min_run, n - lo);
+                list_sort_insertion(st, lo, lo + len, lo + force);
+                len = force;
+            }
+            lo += len;
+            assert(n_runs < LIST_SORT_MAX_RUNS);
+            start[++n_runs] = lo;
+        }
+
+        // merge while the run lengths don't decrease fast enough, or at the end
+        while (n_runs > 1) {
+            size_t k = n_runs - 2;
+            if ((k > 0 && RUN_LEN(k - 1) <= RUN_LEN(k) + RUN_LEN(k + 1))
+                || (k > 1 && RUN_LEN(k - 2) <= RUN_LEN(k - 1) + RUN_LEN(k))) {
+                if (RUN_LEN(k - 1) < RUN_LEN(k + 1)) {
+                    k--;
+                }
+            } else if (lo < n && RUN_LEN(k) > RUN_LEN(k + 1)) {
+                break;
+            }
+            list_sort_merge(st, start[k], start[k + 1], start[k + 2]);
+            for (size_t i = k + 1; i < n_runs; i++) {
+                start[i] = start[i + 1];
+            }
+            n_runs--;
+        }
+    }
+    #undef RUN_LEN
 }
 
-// TODO Python defines sort to be stable but ours is not
 mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_key, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
@@ -328,10 +539,57 @@ mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_
     mp_check_self(mp_obj_is_type(pos_args[0], &mp_type_list));
     mp_obj_list_t *self = MP_OBJ_TO_PTR(pos_args[0]);
 
-    if (self->len > 1) {
-        mp_quicksort(self->items, self->items + self->len - 1,
-                     args.key.u_obj == mp_const_none ? MP_OBJ_NULL : args.key.u_obj,
-                     args.reverse.u_bool ? mp_const_false : mp_const_true);
+    size_t n = self->len;
+    if (n > 1) {
+        list_sort_t st;
+        st.items = self->items;
+        st.keys = self->items;
+        st.tmp_items = NULL;
+        st.tmp_keys = NULL;
+        st.reverse = args.reverse.u_bool;
+        st.rec_n = 0;
+
+        // compute the keys once
+        size_t n_keys = 0;
+        if (args.key.u_obj != mp_const_none) {
+            n_keys = n;
+            st.keys = m_new(mp_obj_t, n_keys);
+            for (size_t i = 0; i < n; i++) {
+                st.keys[i] = mp_call_function_1(args.key.u_obj, st.items[i]);
+            }
+        }
+
+        // the merge buffer is optional: without it merging is slower
+        size_t n_tmp = 0;
+        if (n >= LIST_SORT_MIN_MERGE) {
+            n_tmp = n / 2;
+            st.tmp_items = m_new_maybe(mp_obj_t, n_tmp * (n_keys ? 2 : 1));
+            if (st.tmp_items == NULL) {
+                n_tmp = 0;
+            }
+            st.tmp_keys = n_keys ? st.tmp_items + n_tmp : st.tmp_items;
+        }
+
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            list_sort_runs(&st, n);
+            nlr_pop();
+        } else {
+            // leave all the items in the list; st was changed after nlr_push
+            // so it has to be read through a volatile pointer
+            list_sort_t *volatile rec = &st;
+            if (rec->rec_n != 0) {
+                memcpy(&rec->items[rec->rec_dest], &rec->tmp_items[rec->rec_tmp], rec->rec_n * sizeof(mp_obj_t));
+            }
+            nlr_jump(nlr.ret_val);
+        }
+
+        if (st.tmp_items != NULL) {
+            m_del(mp_obj_t, st.tmp_items, n_tmp * (n_keys ? 2 : 1));
+        }
+        if (n_keys) {
+            m_del(mp_obj_t, st.keys, n_keys);
+        }
     }
 
     return mp_const_none;
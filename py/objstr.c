@@ -457,9 +457,27 @@ STATIC mp_obj_t str_join(mp_obj_t self_in, mp_obj_t arg) {
     mp_obj_t *seq_items;
 
     if (!mp_obj_is_type(arg, &mp_type_list) && !mp_obj_is_type(arg, &mp_type_tuple)) {
-        // arg is not a list nor a tuple, try to convert it to a list
-        // TODO: Try to optimize?
-        arg = mp_type_list.make_new(&mp_type_list, 1, 0, &arg);
+        // arg is not a list nor a tuple, so add its items to the string as
+        // they come instead of making a list of them first
+        vstr_t vstr;
+        vstr_init(&vstr, 16);
+        mp_obj_iter_buf_t iter_buf;
+        mp_obj_t iterable = mp_getiter(arg, &iter_buf);
+        mp_obj_t item;
+        bool first = true;
+        while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+            if (mp_obj_get_type(item) != self_type) {
+                mp_raise_TypeError(
+                    "join expects a list of str/bytes objects consistent with self object");
+            }
+            if (!first) {
+                vstr_add_strn(&vstr, (const char*)sep_str, sep_len);
+            }
+            first = false;
+            GET_STR_DATA_LEN(item, s, l);
+            vstr_add_strn(&vstr, (const char*)s, l);
+        }
+        return mp_obj_new_str_from_vstr(self_type, &vstr);
     }
     mp_obj_get_array(arg, &seq_len, &seq_items);
 
@@ -944,7 +962,8 @@ STATIC NORETURN void terse_str_format_value_error(void) {
 STATIC vstr_t mp_obj_str_format_helper(const char *str, const char *top, int *arg_i, size_t n_args, const mp_obj_t *args, mp_map_t *kwargs) {
     vstr_t vstr;
     mp_print_t print;
-    vstr_init_print(&vstr, 16, &print);
+    // the result is usually at least as long as the format
+    vstr_init_print(&vstr, top - str + 16, &print);
 
     for (; str < top; str++) {
         if (*str == '}') {
@@ -960,7 +979,12 @@ STATIC vstr_t mp_obj_str_format_helper(const char *str, const char *top, int *ar
             }
         }
         if (*str != '{') {
-            vstr_add_byte(&vstr, *str);
+            // copy the literal text up to the next brace in one go
+            const char *lit = str;
+            while (str + 1 < top && str[1] != '{' && str[1] != '}') {
+                ++str;
+            }
+            vstr_add_strn(&vstr, lit, str + 1 - lit);
             continue;
         }
 
@@ -1401,12 +1425,18 @@ STATIC mp_obj_t str_modulo_format(mp_obj_t pattern, size_t n_args, const mp_obj_
     size_t arg_i = 0;
     vstr_t vstr;
     mp_print_t print;
-    vstr_init_print(&vstr, 16, &print);
+    // the result is usually at least as long as the format
+    vstr_init_print(&vstr, len + 16, &print);
 
     for (const byte *top = str + len; str < top; str++) {
         mp_obj_t arg = MP_OBJ_NULL;
         if (*str != '%') {
-            vstr_add_byte(&vstr, *str);
+            // copy the literal text up to the next % in one go
+            const byte *lit = str;
+            while (str + 1 < top && str[1] != '%') {
+                ++str;
+            }
+            vstr_add_strn(&vstr, (const char*)lit, str + 1 - lit);
             continue;
         }
         if (++str >= top) {
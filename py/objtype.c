@@ -792,7 +792,7 @@ skip_special_accessors:
         return elem != NULL;
     } else {
         // store attribute
-        mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = value;
+        mp_map_store(&self->members, MP_OBJ_NEW_QSTR(attr), value);
         return true;
     }
 }
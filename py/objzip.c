@@ -67,6 +67,25 @@ STATIC mp_obj_t zip_iternext(mp_obj_t self_in) {
     return MP_OBJ_FROM_PTR(tuple);
 }
 
+size_t mp_obj_zip_len(mp_obj_t self_in) {
+    assert(mp_obj_is_type(self_in, &mp_type_zip));
+    mp_obj_zip_t *self = MP_OBJ_TO_PTR(self_in);
+    return self->n_iters;
+}
+
+bool mp_obj_zip_next_n(mp_obj_t self_in, size_t num, mp_obj_t *items) {
+    assert(mp_obj_zip_len(self_in) == num);
+    mp_obj_zip_t *self = MP_OBJ_TO_PTR(self_in);
+    for (size_t i = 0; i < num; i++) {
+        mp_obj_t next = mp_iternext(self->iters[i]);
+        if (next == MP_OBJ_STOP_ITERATION) {
+            return false;
+        }
+        items[num - 1 - i] = next;
+    }
+    return num > 0;
+}
+
 const mp_obj_type_t mp_type_zip = {
     { &mp_type_type },
     .name = MP_QSTR_zip,
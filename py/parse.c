@@ -239,6 +239,11 @@ typedef struct _parser_t {
     #if MICROPY_COMP_CONST
     mp_map_t consts;
     #endif
+
+    #if MICROPY_PARSE_STREAM
+    mp_parse_stmt_fun_t stmt_fun;
+    void *stmt_env;
+    #endif
 } parser_t;
 
 STATIC const uint16_t *get_rule_arg(uint8_t r_id) {
@@ -595,6 +600,64 @@ STATIC bool fold_logical_constants(parser_t *parser, uint8_t rule_id, size_t *nu
         pop_result(parser);
         push_result_node(parser, pn);
         return true;
+
+    } else if (rule_id == RULE_comparison) {
+        // folding for integer comparisons, including chained ones: < > == <= >= !=
+        mp_obj_t arg0;
+        if (!mp_parse_node_get_int_maybe(peek_result(parser, *num_args - 1), &arg0)) {
+            return false;
+        }
+        bool result = true;
+        for (ssize_t i = *num_args - 2; i >= 1; i -= 2) {
+            mp_parse_node_t pn = peek_result(parser, i);
+            if (!MP_PARSE_NODE_IS_TOKEN(pn)) {
+                // not in, is, is not
+                return false;
+            }
+            mp_binary_op_t op;
+            switch (MP_PARSE_NODE_LEAF_ARG(pn)) {
+                case MP_TOKEN_OP_LESS: op = MP_BINARY_OP_LESS; break;
+                case MP_TOKEN_OP_MORE: op = MP_BINARY_OP_MORE; break;
+                case MP_TOKEN_OP_DBL_EQUAL: op = MP_BINARY_OP_EQUAL; break;
+                case MP_TOKEN_OP_LESS_EQUAL: op = MP_BINARY_OP_LESS_EQUAL; break;
+                case MP_TOKEN_OP_MORE_EQUAL: op = MP_BINARY_OP_MORE_EQUAL; break;
+                case MP_TOKEN_OP_NOT_EQUAL: op = MP_BINARY_OP_NOT_EQUAL; break;
+                default: return false; // in
+            }
+            mp_obj_t arg1;
+            if (!mp_parse_node_get_int_maybe(peek_result(parser, i - 1), &arg1)) {
+                return false;
+            }
+            if (mp_binary_op(op, arg0, arg1) == mp_const_false) {
+                result = false;
+            }
+            arg0 = arg1;
+        }
+        for (size_t i = *num_args; i > 0; --i) {
+            pop_result(parser);
+        }
+        push_result_node(parser, mp_parse_node_new_leaf(MP_PARSE_NODE_TOKEN,
+            result ? MP_TOKEN_KW_TRUE : MP_TOKEN_KW_FALSE));
+        return true;
+
+    } else if (rule_id == RULE_test_if_expr) {
+        // folding for conditional expressions with a constant test: x if C else y
+        mp_parse_node_t pn = peek_result(parser, 0);
+        if (!MP_PARSE_NODE_IS_STRUCT_KIND(pn, RULE_test_if_else)) {
+            return false;
+        }
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn;
+        if (mp_parse_node_is_const_true(pns->nodes[0])) {
+            pn = peek_result(parser, 1);
+        } else if (mp_parse_node_is_const_false(pns->nodes[0])) {
+            pn = pns->nodes[1];
+        } else {
+            return false;
+        }
+        pop_result(parser);
+        pop_result(parser);
+        push_result_node(parser, pn);
+        return true;
     }
 
     return false;
@@ -829,7 +892,32 @@ STATIC void push_result_rule(parser_t *parser, size_t src_line, uint8_t rule_id,
     push_result_node(parser, (mp_parse_node_t)pn);
 }
 
+#if MICROPY_PARSE_STREAM
+// Pass a complete top-level statement to the statement function, along with
+// all the parse chunks, which hold only the nodes of this statement
+STATIC void parse_stream_stmt(parser_t *parser, mp_parse_node_t pn) {
+    mp_parse_tree_t tree = {pn, parser->tree.chunk};
+    if (parser->cur_chunk != NULL) {
+        parser->cur_chunk->union_.next = tree.chunk;
+        tree.chunk = parser->cur_chunk;
+    }
+    parser->tree.chunk = NULL;
+    parser->cur_chunk = NULL;
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        parser->stmt_fun(parser->stmt_env, &tree);
+        nlr_pop();
+    } else {
+        mp_lexer_free(parser->lexer);
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+STATIC mp_parse_tree_t parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind, mp_parse_stmt_fun_t stmt_fun, void *stmt_env) {
+#else
 mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
+#endif
 
     // initialise parser and allocate memory for its stacks
 
@@ -852,6 +940,11 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
     mp_map_init(&parser.consts, 0);
     #endif
 
+    #if MICROPY_PARSE_STREAM
+    parser.stmt_fun = stmt_fun;
+    parser.stmt_env = stmt_env;
+    #endif
+
     // work out the top-level rule to use, and push it on the stack
     size_t top_level_rule;
     switch (input_kind) {
@@ -1068,6 +1161,17 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                         }
                     }
                 } else {
+                    #if MICROPY_PARSE_STREAM
+                    if (rule_id == RULE_file_input_2 && i == 1 && parser.stmt_fun != NULL) {
+                        // got a top-level statement (or a NEWLINE); hand it
+                        // over and parse the next one as if it were the first
+                        mp_parse_node_t pn = pop_result(&parser);
+                        if (!MP_PARSE_NODE_IS_NULL(pn) && !MP_PARSE_NODE_IS_TOKEN_KIND(pn, MP_TOKEN_NEWLINE)) {
+                            parse_stream_stmt(&parser, pn);
+                        }
+                        i = 0;
+                    }
+                    #endif
                     for (;;) {
                         size_t arg = rule_arg[i & 1 & n];
                         if ((arg & RULE_ARG_KIND_MASK) == RULE_ARG_TOK) {
@@ -1170,6 +1274,18 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
     return parser.tree;
 }
 
+#if MICROPY_PARSE_STREAM
+mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
+    return parse(lex, input_kind, NULL, NULL);
+}
+
+void mp_parse_stream(mp_lexer_t *lex, mp_parse_stmt_fun_t fun, void *env) {
+    // all statements have been passed to fun, so this tree is empty
+    mp_parse_tree_t tree = parse(lex, MP_PARSE_FILE_INPUT, fun, env);
+    mp_parse_tree_clear(&tree);
+}
+#endif
+
 void mp_parse_tree_clear(mp_parse_tree_t *tree) {
     mp_parse_chunk_t *chunk = tree->chunk;
     while (chunk != NULL) {
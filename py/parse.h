@@ -104,4 +104,12 @@ typedef struct _mp_parse_t {
 mp_parse_tree_t mp_parse(struct _mp_lexer_t *lex, mp_parse_input_kind_t input_kind);
 void mp_parse_tree_clear(mp_parse_tree_t *tree);
 
+#if MICROPY_PARSE_STREAM
+// Parse a file one top-level statement at a time, passing the parse tree of
+// each to fun, which must clear it, eg by compiling it with mp_compile.
+// Like mp_parse, this frees the lexer, also if fun raises an exception.
+typedef void (*mp_parse_stmt_fun_t)(void *env, mp_parse_tree_t *tree);
+void mp_parse_stream(struct _mp_lexer_t *lex, mp_parse_stmt_fun_t fun, void *env);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_PARSE_H
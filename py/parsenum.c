@@ -31,6 +31,7 @@
 #include "py/parsenumbase.h"
 #include "py/parsenum.h"
 #include "py/smallint.h"
+#include "py/formatfloat.h"
 
 #if MICROPY_PY_BUILTINS_FLOAT
 #include <math.h>
@@ -184,11 +185,23 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
 #define SMALL_NORMAL_VAL (1e-37F)
 #define SMALL_NORMAL_EXP (-37)
 #define EXACT_POWER_OF_10 (9)
+#define DEC_INT_MAX (0x19999999) // 10 * DEC_INT_MAX + 9 fits in 32 bits
 #elif MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
 #define DEC_VAL_MAX 1e200
 #define SMALL_NORMAL_VAL (1e-307)
 #define SMALL_NORMAL_EXP (-307)
 #define EXACT_POWER_OF_10 (22)
+#define DEC_INT_MAX (0x1999999999999999) // 10 * DEC_INT_MAX + 9 fits in 64 bits
+#endif
+
+// The digits are accumulated in dec_acc.  With MICROPY_OPT_FAST_FLOAT that's
+// an integer, so it's exact as far as it goes, and converted to a float once.
+#if MICROPY_OPT_FAST_FLOAT
+#define DEC_ACC_MAX DEC_INT_MAX
+typedef mp_float_bits_t dec_acc_t;
+#else
+#define DEC_ACC_MAX DEC_VAL_MAX
+typedef mp_float_t dec_acc_t;
 #endif
 
     const char *top = str + len;
@@ -237,6 +250,7 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
         bool exp_neg = false;
         int exp_val = 0;
         int exp_extra = 0;
+        dec_acc_t dec_acc = 0;
         while (str < top) {
             unsigned int dig = *str++;
             if ('0' <= dig && dig <= '9') {
@@ -249,14 +263,14 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
                         exp_val = 10 * exp_val + dig;
                     }
                 } else {
-                    if (dec_val < DEC_VAL_MAX) {
-                        // dec_val won't overflow so keep accumulating
-                        dec_val = 10 * dec_val + dig;
+                    if (dec_acc < DEC_ACC_MAX) {
+                        // dec_acc won't overflow so keep accumulating
+                        dec_acc = 10 * dec_acc + dig;
                         if (in == PARSE_DEC_IN_FRAC) {
                             --exp_extra;
                         }
                     } else {
-                        // dec_val might overflow and we anyway can't represent more digits
+                        // dec_acc might overflow and we anyway can't represent more digits
                         // of precision, so ignore the digit and just adjust the exponent
                         if (in == PARSE_DEC_IN_INTG) {
                             ++exp_extra;
@@ -295,8 +309,18 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
             exp_val = -exp_val;
         }
 
-        // apply the exponent, making sure it's not a subnormal value
         exp_val += exp_extra;
+        dec_val = dec_acc;
+
+        #if MICROPY_OPT_FAST_FLOAT
+        // This covers most numbers written out in full, rounding dec_acc * 10^exp_val
+        // once rather than at each step
+        if (mp_float_from_decimal(dec_acc, exp_val, &dec_val)) {
+            goto dec_done;
+        }
+        #endif
+
+        // apply the exponent, making sure it's not a subnormal value
         if (exp_val < SMALL_NORMAL_EXP) {
             exp_val -= SMALL_NORMAL_EXP;
             dec_val *= SMALL_NORMAL_VAL;
@@ -312,6 +336,9 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
         } else {
             dec_val *= MICROPY_FLOAT_C_FUN(pow)(10, exp_val);
         }
+        #if MICROPY_OPT_FAST_FLOAT
+    dec_done:;
+        #endif
     }
 
     // negate value if needed
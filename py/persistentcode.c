@@ -40,24 +40,37 @@
 
 #define QSTR_LAST_STATIC MP_QSTR_zip
 
-// Macros to encode/decode flags to/from the feature byte
-#define MPY_FEATURE_ENCODE_FLAGS(flags) (flags)
-#define MPY_FEATURE_DECODE_FLAGS(feat) ((feat) & 3)
+// Macros to encode/decode flags to/from the feature byte; flags 2 and 3 are
+// kept in the top two bits, above the architecture
+#define MPY_FEATURE_ENCODE_FLAGS(flags) (((flags) & 3) | ((flags) & 4) << 5 | ((flags) & 8) << 3)
+#define MPY_FEATURE_DECODE_FLAGS(feat) (((feat) & 3) | ((feat) >> 5 & 4) | ((feat) >> 3 & 8))
 
 // Macros to encode/decode native architecture to/from the feature byte
 #define MPY_FEATURE_ENCODE_ARCH(arch) ((arch) << 2)
-#define MPY_FEATURE_DECODE_ARCH(feat) ((feat) >> 2)
+#define MPY_FEATURE_DECODE_ARCH(feat) (((feat) >> 2) & 0xf)
+
+// Flag for a file whose bytecode is saved in the form that runs in place,
+// with the qstrs it uses after it: see load_raw_code
+#define MPY_FEATURE_XIP (8)
 
 // The feature flag bits encode the compile-time config options that
 // affect the generate bytecode.
 #define MPY_FEATURE_FLAGS ( \
     ((MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE) << 0) \
     | ((MICROPY_PY_BUILTINS_STR_UNICODE) << 1) \
+    | ((MICROPY_OPT_SUPERINSTRUCTIONS) << 2) \
     )
 // This is a version of the flags that can be configured at runtime.
 #define MPY_FEATURE_FLAGS_DYNAMIC ( \
     ((MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE_DYNAMIC) << 0) \
     | ((MICROPY_PY_BUILTINS_STR_UNICODE_DYNAMIC) << 1) \
+    | ((MICROPY_OPT_SUPERINSTRUCTIONS_DYNAMIC) << 2) \
+    )
+// The flags that needn't match: bytecode without superinstructions runs
+// either way, and bytecode in either form may be loaded if XIP is supported.
+#define MPY_FEATURE_FLAGS_OPTIONAL ( \
+    ((MICROPY_OPT_SUPERINSTRUCTIONS) << 2) \
+    | ((MICROPY_PERSISTENT_CODE_LOAD_XIP) << 3) \
     )
 
 // Define the host architecture
@@ -65,6 +78,8 @@
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_X86)
 #elif MICROPY_EMIT_X64
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_X64)
+#elif MICROPY_EMIT_THUMB && defined(__ARM_FEATURE_DSP)
+#define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_ARMV7EM)
 #elif MICROPY_EMIT_THUMB
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_ARMV7M)
 #elif MICROPY_EMIT_ARM
@@ -75,10 +90,19 @@
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_NONE)
 #endif
 
+// Whether native code for the given arch can run on this one
+#if MICROPY_EMIT_THUMB && defined(__ARM_FEATURE_DSP)
+#define MPY_FEATURE_ARCH_CAN_RUN(arch) ((arch) == MP_NATIVE_ARCH_ARMV7M || (arch) == MP_NATIVE_ARCH_ARMV7EM)
+#else
+#define MPY_FEATURE_ARCH_CAN_RUN(arch) ((arch) == MPY_FEATURE_ARCH)
+#endif
+
 #if MICROPY_DYNAMIC_COMPILER
 #define MPY_FEATURE_ARCH_DYNAMIC mp_dynamic_compiler.native_arch
+#define MPY_SAVE_XIP_DYNAMIC mp_dynamic_compiler.persistent_code_xip
 #else
 #define MPY_FEATURE_ARCH_DYNAMIC MPY_FEATURE_ARCH
+#define MPY_SAVE_XIP_DYNAMIC (0)
 #endif
 
 #if MICROPY_PERSISTENT_CODE_LOAD || (MICROPY_PERSISTENT_CODE_SAVE && !MICROPY_DYNAMIC_COMPILER)
@@ -157,7 +181,7 @@ typedef struct _bytecode_prelude_t {
     uint code_info_size;
 } bytecode_prelude_t;
 
-#if MICROPY_PERSISTENT_CODE_SAVE || MICROPY_EMIT_MACHINE_CODE
+#if MICROPY_PERSISTENT_CODE_SAVE || MICROPY_EMIT_MACHINE_CODE || MICROPY_PERSISTENT_CODE_LOAD_XIP
 
 // ip will point to start of opcodes
 // ip2 will point to simple_name, source_file qstrs
@@ -321,7 +345,43 @@ STATIC void load_bytecode(mp_reader_t *reader, qstr_window_t *qw, byte *ip, byte
     }
 }
 
-STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
+// How the bytecode of a .mpy file is loaded
+enum {
+    LOAD_BC_QSTRS, // with the qstrs in the bytecode, the usual form
+    LOAD_BC_XIP_COPY, // in the XIP form, copied to RAM with the qstrs put in
+    LOAD_BC_XIP_IN_PLACE, // in the XIP form, run where it is
+};
+
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+STATIC void link_xip_qstr(byte *p, const qstr *qstrs, size_t qstr_base) {
+    qstr qst = qstrs[(p[0] | p[1] << 8) - qstr_base];
+    p[0] = qst;
+    p[1] = qst >> 8;
+}
+
+// Put the qstrs into bytecode in the XIP form that's been copied to RAM.  Its
+// qstrs are const table indices, and qstrs[0] is for index qstr_base.
+STATIC void link_xip_bytecode(byte *fun_data, byte *ip, byte *ip2, const byte *ip_top, const qstr *qstrs, size_t qstr_base) {
+    byte *scope_flags = (byte*)mp_decode_uint_skip(mp_decode_uint_skip(fun_data));
+    *scope_flags &= ~MP_SCOPE_FLAG_XIP;
+    link_xip_qstr(ip2, qstrs, qstr_base); // simple_name
+    link_xip_qstr(ip2 + 2, qstrs, qstr_base); // source_file
+    while (ip < ip_top) {
+        size_t sz;
+        uint f = mp_opcode_format(ip, &sz, true);
+        if (f == MP_OPCODE_QSTR) {
+            link_xip_qstr(ip + 1, qstrs, qstr_base);
+        }
+        ip += sz;
+    }
+}
+#endif
+
+// The XIP form of bytecode, in a .mpy file with MPY_FEATURE_XIP set, is the
+// bytecode as the VM runs it, but with MP_SCOPE_FLAG_XIP set, and with each
+// qstr an index into the const table.  The qstrs come after the function's
+// argument names, and go at the end of its const table.
+STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw, uint load_bc) {
     // Load function kind and data length
     size_t kind_len = read_uint(reader, NULL);
     int kind = (kind_len & 3) + MP_CODE_BYTECODE;
@@ -342,16 +402,38 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     size_t n_qstr_link = 0;
     #endif
 
+    #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+    byte *ip_xip = NULL;
+    #endif
+
     if (kind == MP_CODE_BYTECODE) {
-        // Allocate memory for the bytecode
-        fun_data = m_new(uint8_t, fun_data_len);
+        #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+        if (load_bc != LOAD_BC_QSTRS) {
+            if (load_bc == LOAD_BC_XIP_IN_PLACE) {
+                // Use the bytecode where it is
+                fun_data = (uint8_t*)mp_reader_mem_read_in_place(reader, fun_data_len);
+                if (fun_data == NULL) {
+                    mp_raise_ValueError("incompatible .mpy file");
+                }
+            } else {
+                fun_data = m_new(uint8_t, fun_data_len);
+                read_bytes(reader, fun_data, fun_data_len);
+            }
+            ip_xip = fun_data;
+            extract_prelude((const byte**)&ip_xip, (const byte**)&ip2, &prelude);
+        } else
+        #endif
+        {
+            // Allocate memory for the bytecode
+            fun_data = m_new(uint8_t, fun_data_len);
 
-        // Load prelude
-        byte *ip = fun_data;
-        load_prelude(reader, &ip, &ip2, &prelude);
+            // Load prelude
+            byte *ip = fun_data;
+            load_prelude(reader, &ip, &ip2, &prelude);
 
-        // Load bytecode
-        load_bytecode(reader, qw, ip, fun_data + fun_data_len);
+            // Load bytecode
+            load_bytecode(reader, qw, ip, fun_data + fun_data_len);
+        }
 
     #if MICROPY_EMIT_MACHINE_CODE
     } else {
@@ -396,7 +478,7 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     #endif
     }
 
-    if (kind == MP_CODE_BYTECODE || kind == MP_CODE_NATIVE_PY) {
+    if ((kind == MP_CODE_BYTECODE && load_bc == LOAD_BC_QSTRS) || kind == MP_CODE_NATIVE_PY) {
         // Load qstrs in prelude
         qstr simple_name = load_qstr(reader, qw);
         qstr source_file = load_qstr(reader, qw);
@@ -420,7 +502,15 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
         if (kind != MP_CODE_BYTECODE) {
             ++n_alloc; // additional entry for mp_fun_table
         }
+        #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+        size_t n_xip_qstr = 0;
+        if (kind == MP_CODE_BYTECODE && load_bc != LOAD_BC_QSTRS) {
+            n_xip_qstr = read_uint(reader, NULL);
+        }
+        const_table = m_new(mp_uint_t, n_alloc + (load_bc == LOAD_BC_XIP_IN_PLACE ? n_xip_qstr : 0));
+        #else
         const_table = m_new(mp_uint_t, n_alloc);
+        #endif
         mp_uint_t *ct = const_table;
 
         // Load function argument names (initial entries in const_table)
@@ -429,6 +519,27 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
             *ct++ = (mp_uint_t)MP_OBJ_NEW_QSTR(load_qstr(reader, qw));
         }
 
+        #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+        // Load the qstrs of bytecode in the XIP form
+        if (n_xip_qstr > 0) {
+            if (load_bc == LOAD_BC_XIP_IN_PLACE) {
+                for (size_t i = 0; i < n_xip_qstr; ++i) {
+                    const_table[n_alloc + i] = (mp_uint_t)MP_OBJ_NEW_QSTR(load_qstr(reader, qw));
+                }
+            } else {
+                qstr *qstrs = m_new(qstr, n_xip_qstr);
+                for (size_t i = 0; i < n_xip_qstr; ++i) {
+                    qstrs[i] = load_qstr(reader, qw);
+                }
+                link_xip_bytecode(fun_data, ip_xip, ip2, fun_data + fun_data_len, qstrs, n_alloc);
+                m_del(qstr, qstrs, n_xip_qstr);
+            }
+        }
+        if (load_bc == LOAD_BC_XIP_COPY) {
+            prelude.scope_flags &= ~MP_SCOPE_FLAG_XIP;
+        }
+        #endif
+
         #if MICROPY_EMIT_MACHINE_CODE
         if (kind != MP_CODE_BYTECODE) {
             // Populate mp_fun_table entry
@@ -441,7 +552,7 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
             *ct++ = (mp_uint_t)load_obj(reader);
         }
         for (size_t i = 0; i < n_raw_code; ++i) {
-            *ct++ = (mp_uint_t)(uintptr_t)load_raw_code(reader, qw);
+            *ct++ = (mp_uint_t)(uintptr_t)load_raw_code(reader, qw, load_bc);
         }
     }
 
@@ -477,33 +588,53 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     return rc;
 }
 
-mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
+STATIC mp_raw_code_t *raw_code_load(mp_reader_t *reader, bool in_place) {
     byte header[4];
     read_bytes(reader, header, sizeof(header));
     if (header[0] != 'M'
         || header[1] != MPY_VERSION
-        || MPY_FEATURE_DECODE_FLAGS(header[2]) != MPY_FEATURE_FLAGS
+        || (MPY_FEATURE_DECODE_FLAGS(header[2]) | MPY_FEATURE_FLAGS_OPTIONAL) != (MPY_FEATURE_FLAGS | MPY_FEATURE_FLAGS_OPTIONAL)
         || header[3] > mp_small_int_bits()
         || read_uint(reader, NULL) > QSTR_WINDOW_SIZE) {
         mp_raise_ValueError("incompatible .mpy file");
     }
     if (MPY_FEATURE_DECODE_ARCH(header[2]) != MP_NATIVE_ARCH_NONE
-        && MPY_FEATURE_DECODE_ARCH(header[2]) != MPY_FEATURE_ARCH) {
+        && !MPY_FEATURE_ARCH_CAN_RUN(MPY_FEATURE_DECODE_ARCH(header[2]))) {
         mp_raise_ValueError("incompatible .mpy arch");
     }
+    uint load_bc = LOAD_BC_QSTRS;
+    if (MPY_FEATURE_DECODE_FLAGS(header[2]) & MPY_FEATURE_XIP) {
+        load_bc = in_place ? LOAD_BC_XIP_IN_PLACE : LOAD_BC_XIP_COPY;
+    }
     qstr_window_t qw;
     qw.idx = 0;
-    mp_raw_code_t *rc = load_raw_code(reader, &qw);
+    mp_raw_code_t *rc = load_raw_code(reader, &qw, load_bc);
     reader->close(reader->data);
     return rc;
 }
 
+mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
+    return raw_code_load(reader, false);
+}
+
 mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len) {
     mp_reader_t reader;
     mp_reader_new_mem(&reader, buf, len, 0);
     return mp_raw_code_load(&reader);
 }
 
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+
+mp_raw_code_t *mp_raw_code_load_rom(const byte *buf, size_t len) {
+    mp_reader_t reader;
+    mp_reader_new_mem(&reader, buf, len, 0);
+    // With the map lookup cache in the bytecode the VM writes to bytecode, so
+    // it's only copied
+    return raw_code_load(&reader, !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE);
+}
+
+#endif
+
 #if MICROPY_HAS_FILE_READER
 
 mp_raw_code_t *mp_raw_code_load_file(const char *filename) {
@@ -612,14 +743,67 @@ STATIC void save_bytecode(mp_print_t *print, qstr_window_t *qw, const byte *ip,
     }
 }
 
+STATIC void unlink_xip_qstr(byte *p, qstr *qstrs, size_t *n_qstr, size_t qstr_base) {
+    qstr qst = p[0] | p[1] << 8;
+    size_t i = 0;
+    while (i < *n_qstr && qstrs[i] != qst) {
+        ++i;
+    }
+    if (i == *n_qstr) {
+        qstrs[(*n_qstr)++] = qst;
+    }
+    if (qstr_base + i > 0xffff) {
+        mp_raise_ValueError("function too big for XIP");
+    }
+    p[0] = qstr_base + i;
+    p[1] = (qstr_base + i) >> 8;
+}
+
+// Turn a copy of bytecode into the XIP form, see load_raw_code, putting the
+// qstrs it uses in qstrs and returning how many there are
+STATIC size_t unlink_xip_bytecode(byte *fun_data, size_t fun_data_len, qstr *qstrs, size_t qstr_base) {
+    const byte *ip = fun_data;
+    byte *ip2;
+    bytecode_prelude_t prelude;
+    extract_prelude(&ip, (const byte**)&ip2, &prelude);
+    byte *scope_flags = (byte*)mp_decode_uint_skip(mp_decode_uint_skip(fun_data));
+    *scope_flags |= MP_SCOPE_FLAG_XIP;
+    size_t n_qstr = 0;
+    unlink_xip_qstr(ip2, qstrs, &n_qstr, qstr_base); // simple_name
+    unlink_xip_qstr(ip2 + 2, qstrs, &n_qstr, qstr_base); // source_file
+    while (ip < fun_data + fun_data_len) {
+        size_t sz;
+        uint f = mp_opcode_format(ip, &sz, true);
+        if (f == MP_OPCODE_QSTR) {
+            unlink_xip_qstr((byte*)ip + 1, qstrs, &n_qstr, qstr_base);
+        }
+        ip += sz;
+    }
+    return n_qstr;
+}
+
 STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *qstr_window) {
     // Save function kind and data length
     mp_print_uint(print, (rc->fun_data_len << 2) | (rc->kind - MP_CODE_BYTECODE));
 
     const byte *ip2;
     bytecode_prelude_t prelude;
+    size_t n_xip_qstr = 0;
+    qstr *xip_qstrs = NULL;
 
-    if (rc->kind == MP_CODE_BYTECODE) {
+    if (rc->kind == MP_CODE_BYTECODE && MPY_SAVE_XIP_DYNAMIC) {
+        // Save bytecode in the XIP form
+        const byte *ip = rc->fun_data;
+        extract_prelude(&ip, &ip2, &prelude);
+        byte *fun_data = m_new(byte, rc->fun_data_len);
+        memcpy(fun_data, rc->fun_data, rc->fun_data_len);
+        // each qstr takes at least 2 bytes
+        xip_qstrs = m_new(qstr, rc->fun_data_len / 2);
+        n_xip_qstr = unlink_xip_bytecode(fun_data, rc->fun_data_len, xip_qstrs,
+            prelude.n_pos_args + prelude.n_kwonly_args + rc->n_obj + rc->n_raw_code);
+        mp_print_bytes(print, fun_data, rc->fun_data_len);
+        m_del(byte, fun_data, rc->fun_data_len);
+    } else if (rc->kind == MP_CODE_BYTECODE) {
         // Save prelude
         const byte *ip = rc->fun_data;
         extract_prelude(&ip, &ip2, &prelude);
@@ -661,7 +845,7 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
     #endif
     }
 
-    if (rc->kind == MP_CODE_BYTECODE || rc->kind == MP_CODE_NATIVE_PY) {
+    if ((rc->kind == MP_CODE_BYTECODE && xip_qstrs == NULL) || rc->kind == MP_CODE_NATIVE_PY) {
         // Save qstrs in prelude
         save_qstr(print, qstr_window, ip2[0] | (ip2[1] << 8)); // simple_name
         save_qstr(print, qstr_window, ip2[2] | (ip2[3] << 8)); // source_file
@@ -673,6 +857,9 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
         // Number of entries in constant table
         mp_print_uint(print, rc->n_obj);
         mp_print_uint(print, rc->n_raw_code);
+        if (xip_qstrs != NULL) {
+            mp_print_uint(print, n_xip_qstr);
+        }
 
         const mp_uint_t *const_table = rc->const_table;
 
@@ -683,6 +870,14 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
             save_qstr(print, qstr_window, MP_OBJ_QSTR_VALUE(o));
         }
 
+        if (xip_qstrs != NULL) {
+            // Save the qstrs of bytecode in the XIP form
+            for (size_t i = 0; i < n_xip_qstr; ++i) {
+                save_qstr(print, qstr_window, xip_qstrs[i]);
+            }
+            m_del(qstr, xip_qstrs, rc->fun_data_len / 2);
+        }
+
         if (rc->kind != MP_CODE_BYTECODE) {
             // Skip saving mp_fun_table entry
             ++const_table;
@@ -731,7 +926,7 @@ void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
     byte header[4] = {
         'M',
         MPY_VERSION,
-        MPY_FEATURE_ENCODE_FLAGS(MPY_FEATURE_FLAGS_DYNAMIC),
+        MPY_FEATURE_ENCODE_FLAGS(MPY_FEATURE_FLAGS_DYNAMIC | (MPY_SAVE_XIP_DYNAMIC ? MPY_FEATURE_XIP : 0)),
         #if MICROPY_DYNAMIC_COMPILER
         mp_dynamic_compiler.small_int_bits,
         #else
@@ -772,6 +967,19 @@ void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename) {
     close(fd);
 }
 
+#elif MICROPY_VFS
+
+#include "py/stream.h"
+#include "extmod/vfs.h"
+
+void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename) {
+    mp_obj_t args[2] = { mp_obj_new_str(filename, strlen(filename)), MP_OBJ_NEW_QSTR(MP_QSTR_wb) };
+    mp_obj_t file = mp_vfs_open(2, args, (mp_map_t*)&mp_const_empty_map);
+    mp_print_t file_print = {MP_OBJ_TO_PTR(file), mp_stream_write_adaptor};
+    mp_raw_code_save(rc, &file_print);
+    mp_stream_close(file);
+}
+
 #else
 #error mp_raw_code_save_file not implemented for this platform
 #endif
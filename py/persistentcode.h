@@ -48,6 +48,11 @@ enum {
 
 mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader);
 mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len);
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+// Load from memory that stays mapped, and unchanged, for as long as the code
+// may run, running bytecode in the XIP form where it is
+mp_raw_code_t *mp_raw_code_load_rom(const byte *buf, size_t len);
+#endif
 mp_raw_code_t *mp_raw_code_load_file(const char *filename);
 
 void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print);
@@ -82,6 +82,7 @@ PY_CORE_O_BASENAME = $(addprefix py/,\
 	runtime.o \
 	runtime_utils.o \
 	scheduler.o \
+	eventring.o \
 	nativeglue.o \
 	stackctrl.o \
 	argcheck.o \
@@ -160,6 +161,7 @@ PY_EXTMOD_O_BASENAME = \
 	extmod/moduzlib.o \
 	extmod/moduheapq.o \
 	extmod/modutimeq.o \
+	extmod/moduasyncio.o \
 	extmod/moduhashlib.o \
 	extmod/moducryptolib.o \
 	extmod/modubinascii.o \
@@ -170,6 +172,10 @@ PY_EXTMOD_O_BASENAME = \
 	extmod/machine_pulse.o \
 	extmod/machine_i2c.o \
 	extmod/machine_spi.o \
+	extmod/machine_display.o \
+	extmod/machine_audio.o \
+	extmod/machine_sdcard_spi.o \
+	extmod/machine_nrf24l01.o \
 	extmod/modussl_axtls.o \
 	extmod/modussl_mbedtls.o \
 	extmod/modurandom.o \
@@ -25,6 +25,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/runtime.h"
 
@@ -34,8 +35,25 @@ void mp_pystack_init(void *start, void *end) {
     MP_STATE_THREAD(pystack_start) = start;
     MP_STATE_THREAD(pystack_end) = end;
     MP_STATE_THREAD(pystack_cur) = start;
+    #if MICROPY_STACK_HIGH_WATER
+    memset(start, 0xa5, (byte*)end - (byte*)start);
+    #endif
 }
 
+#if MICROPY_STACK_HIGH_WATER
+// Return the maximum number of bytes of pystack used since it was initialised.
+// Only allocated regions that were written to are detected.
+size_t mp_pystack_high_water(void) {
+    byte *start = MP_STATE_THREAD(pystack_start);
+    byte *p = MP_STATE_THREAD(pystack_end);
+    while (p > start && p[-1] == 0xa5) {
+        --p;
+    }
+    // the current allocation is in use even if it hasn't been written to
+    return MAX(p, MP_STATE_THREAD(pystack_cur)) - start;
+}
+#endif
+
 void *mp_pystack_alloc(size_t n_bytes) {
     n_bytes = (n_bytes + (MICROPY_PYSTACK_ALIGN - 1)) & ~(MICROPY_PYSTACK_ALIGN - 1);
     #if MP_PYSTACK_DEBUG
@@ -71,6 +71,10 @@ static inline size_t mp_pystack_limit(void) {
     return MP_STATE_THREAD(pystack_end) - MP_STATE_THREAD(pystack_start);
 }
 
+#if MICROPY_STACK_HIGH_WATER
+size_t mp_pystack_high_water(void);
+#endif
+
 #endif
 
 #if !MICROPY_ENABLE_PYSTACK
@@ -85,12 +85,17 @@
 #define MICROPY_ALLOC_QSTR_ENTRIES_INIT (10)
 
 // this must match the equivalent function in makeqstrdata.py
-mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
+STATIC mp_uint_t qstr_compute_hash_full(const byte *data, size_t len) {
     // djb2 algorithm; see http://www.cse.yorku.ca/~oz/hash.html
     mp_uint_t hash = 5381;
     for (const byte *top = data + len; data < top; data++) {
         hash = ((hash << 5) + hash) ^ (*data); // hash * 33 ^ data
     }
+    return hash;
+}
+
+// Reduce a full hash to the one stored with the qstr
+STATIC mp_uint_t qstr_hash_from_full(mp_uint_t hash) {
     hash &= Q_HASH_MASK;
     // Make sure that valid hash is never zero, zero means "hash not computed"
     if (hash == 0) {
@@ -99,6 +104,10 @@ mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
     return hash;
 }
 
+mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
+    return qstr_hash_from_full(qstr_compute_hash_full(data, len));
+}
+
 const qstr_pool_t mp_qstr_const_pool = {
     NULL,               // no previous pool
     0,                  // no previous pool
@@ -120,15 +129,6 @@ extern const qstr_pool_t MICROPY_QSTR_EXTRA_POOL;
 #define CONST_POOL mp_qstr_const_pool
 #endif
 
-void qstr_init(void) {
-    MP_STATE_VM(last_pool) = (qstr_pool_t*)&CONST_POOL; // we won't modify the const_pool since it has no allocated room left
-    MP_STATE_VM(qstr_last_chunk) = NULL;
-
-    #if MICROPY_PY_THREAD
-    mp_thread_mutex_init(&MP_STATE_VM(qstr_mutex));
-    #endif
-}
-
 STATIC const byte *find_qstr(qstr q) {
     // search pool for this qstr
     // total_prev_len==0 in the final pool, so the loop will always terminate
@@ -139,6 +139,74 @@ STATIC const byte *find_qstr(qstr q) {
     return pool->qstrs[q - pool->total_prev_len];
 }
 
+#if MICROPY_QSTR_INDEX
+
+// The index holds the qstrs from this one on.  It's indexed by the full
+// hash, as the stored one may be just 8 bits.
+#if MICROPY_QSTR_INDEX == 1
+#define QSTR_INDEX_FIRST (CONST_POOL.total_prev_len + CONST_POOL.len)
+#else
+#define QSTR_INDEX_FIRST (1)
+#endif
+
+STATIC void qstr_index_insert(uint16_t *index, size_t alloc, qstr q) {
+    const byte *qd = find_qstr(q);
+    size_t mask = alloc - 1;
+    size_t i = qstr_compute_hash_full(Q_GET_DATA(qd), Q_GET_LENGTH(qd)) & mask;
+    while (index[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    index[i] = q;
+}
+
+// Replace the index with one that is at most half full.  If there's no
+// memory for it, or the qstrs don't fit in 16 bits, there's no index and
+// lookups go through the pools.
+STATIC void qstr_index_rebuild(void) {
+    size_t first = QSTR_INDEX_FIRST;
+    size_t total = QSTR_TOTAL();
+    m_del(uint16_t, MP_STATE_VM(qstr_index), MP_STATE_VM(qstr_index_alloc));
+    MP_STATE_VM(qstr_index) = NULL;
+    MP_STATE_VM(qstr_index_alloc) = 0;
+    if (total > 0x10000) {
+        return;
+    }
+    size_t alloc = 32;
+    while (alloc < 2 * (total - first)) {
+        alloc *= 2;
+    }
+    uint16_t *index = m_new_maybe(uint16_t, alloc);
+    if (index == NULL) {
+        return;
+    }
+    memset(index, 0, alloc * sizeof(uint16_t));
+    for (qstr q = first; q < total; q++) {
+        qstr_index_insert(index, alloc, q);
+    }
+    MP_STATE_VM(qstr_index) = index;
+    MP_STATE_VM(qstr_index_alloc) = alloc;
+    MP_STATE_VM(qstr_index_used) = total - first;
+}
+
+#endif
+
+void qstr_init(void) {
+    MP_STATE_VM(last_pool) = (qstr_pool_t*)&CONST_POOL; // we won't modify the const_pool since it has no allocated room left
+    MP_STATE_VM(qstr_last_chunk) = NULL;
+
+    #if MICROPY_QSTR_INDEX
+    MP_STATE_VM(qstr_index) = NULL;
+    MP_STATE_VM(qstr_index_alloc) = 0;
+    #if MICROPY_QSTR_INDEX == 2
+    qstr_index_rebuild();
+    #endif
+    #endif
+
+    #if MICROPY_PY_THREAD
+    mp_thread_mutex_init(&MP_STATE_VM(qstr_mutex));
+    #endif
+}
+
 // qstr_mutex must be taken while in this function
 STATIC qstr qstr_add(const byte *q_ptr) {
     DEBUG_printf("QSTR: add hash=%d len=%d data=%.*s\n", Q_GET_HASH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_DATA(q_ptr));
@@ -165,17 +233,48 @@ STATIC qstr qstr_add(const byte *q_ptr) {
 
     // add the new qstr
     MP_STATE_VM(last_pool)->qstrs[MP_STATE_VM(last_pool)->len++] = q_ptr;
+    qstr q = MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
+
+    #if MICROPY_QSTR_INDEX
+    if (MP_STATE_VM(qstr_index) != NULL && 2 * (MP_STATE_VM(qstr_index_used) + 1) <= MP_STATE_VM(qstr_index_alloc)) {
+        qstr_index_insert(MP_STATE_VM(qstr_index), MP_STATE_VM(qstr_index_alloc), q);
+        MP_STATE_VM(qstr_index_used) += 1;
+    } else {
+        qstr_index_rebuild();
+    }
+    #endif
 
     // return id for the newly-added qstr
-    return MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
+    return q;
 }
 
 qstr qstr_find_strn(const char *str, size_t str_len) {
     // work out hash of str
-    mp_uint_t str_hash = qstr_compute_hash((const byte*)str, str_len);
+    mp_uint_t str_hash_full = qstr_compute_hash_full((const byte*)str, str_len);
+    mp_uint_t str_hash = qstr_hash_from_full(str_hash_full);
+    qstr_pool_t *last_pool = MP_STATE_VM(last_pool);
+
+    #if MICROPY_QSTR_INDEX
+    const uint16_t *index = MP_STATE_VM(qstr_index);
+    if (index != NULL) {
+        size_t mask = MP_STATE_VM(qstr_index_alloc) - 1;
+        for (size_t i = str_hash_full & mask; index[i] != 0; i = (i + 1) & mask) {
+            const byte *qd = find_qstr(index[i]);
+            if (Q_GET_HASH(qd) == str_hash && Q_GET_LENGTH(qd) == str_len && memcmp(Q_GET_DATA(qd), str, str_len) == 0) {
+                return index[i];
+            }
+        }
+        #if MICROPY_QSTR_INDEX == 1
+        // only the constant pools are left to search
+        last_pool = (qstr_pool_t*)&CONST_POOL;
+        #else
+        return 0;
+        #endif
+    }
+    #endif
 
     // search pools for the data
-    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool != NULL; pool = pool->prev) {
+    for (qstr_pool_t *pool = last_pool; pool != NULL; pool = pool->prev) {
         for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
             if (Q_GET_HASH(*q) == str_hash && Q_GET_LENGTH(*q) == str_len && memcmp(Q_GET_DATA(*q), str, str_len) == 0) {
                 return pool->total_prev_len + (q - pool->qstrs);
@@ -194,6 +293,11 @@ qstr qstr_from_str(const char *str) {
 qstr qstr_from_strn(const char *str, size_t len) {
     assert(len < (1 << (8 * MICROPY_QSTR_BYTES_IN_LEN)));
     QSTR_ENTER();
+    #if MICROPY_GC_ARENA
+    // interned strings are kept for ever, so never go in an arena; if this
+    // raises MemoryError the arena just stays suspended until it's popped
+    struct _gc_arena_t *arena = gc_arena_suspend();
+    #endif
     qstr q = qstr_find_strn(str, len);
     if (q == 0) {
         // qstr does not exist in interned pool so need to add it
@@ -246,6 +350,9 @@ qstr qstr_from_strn(const char *str, size_t len) {
         q_ptr[MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN + len] = '\0';
         q = qstr_add(q_ptr);
     }
+    #if MICROPY_GC_ARENA
+    gc_arena_restore(arena);
+    #endif
     QSTR_EXIT();
     return q;
 }
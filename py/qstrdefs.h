@@ -61,3 +61,17 @@ Q(utf-8)
 #if MICROPY_ENABLE_PYSTACK
 Q(pystack exhausted)
 #endif
+
+#if MICROPY_EMIT_THUMB
+// viper builtins for the ARMv7E-M DSP instructions, see emitnative.c
+Q(uadd8)
+Q(usub8)
+Q(uqadd8)
+Q(uqsub8)
+Q(uhadd8)
+Q(uqadd16)
+Q(qadd16)
+Q(sel)
+Q(smlad)
+Q(usat)
+#endif
@@ -66,6 +66,18 @@ void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t
     reader->close = mp_reader_mem_close;
 }
 
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+const byte *mp_reader_mem_read_in_place(mp_reader_t *reader, size_t len) {
+    mp_reader_mem_t *rm = (mp_reader_mem_t*)reader->data;
+    if ((size_t)(rm->end - rm->cur) < len) {
+        return NULL;
+    }
+    const byte *buf = rm->cur;
+    rm->cur += len;
+    return buf;
+}
+#endif
+
 #if MICROPY_READER_POSIX
 
 #include <sys/stat.h>
@@ -77,7 +89,7 @@ typedef struct _mp_reader_posix_t {
     int fd;
     size_t len;
     size_t pos;
-    byte buf[20];
+    byte buf[MICROPY_READER_BUF_SIZE];
 } mp_reader_posix_t;
 
 STATIC mp_uint_t mp_reader_posix_readbyte(void *data) {
@@ -40,6 +40,11 @@ typedef struct _mp_reader_t {
 } mp_reader_t;
 
 void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t free_len);
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+// For a reader made by mp_reader_new_mem: return a pointer to the next len
+// bytes and skip them, or NULL if there aren't that many
+const byte *mp_reader_mem_read_in_place(mp_reader_t *reader, size_t len);
+#endif
 void mp_reader_new_file(mp_reader_t *reader, const char *filename);
 void mp_reader_new_file_from_fd(mp_reader_t *reader, int fd, bool close_fd);
 
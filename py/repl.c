@@ -130,6 +130,21 @@ bool mp_repl_continue_with_input(const char *input) {
     return false;
 }
 
+// Get the map holding the attributes of obj, if they can only change by
+// adding to or removing from it, so a completion search of it can be cached.
+STATIC const mp_map_t *repl_compl_map(mp_obj_t obj) {
+    if (!mp_obj_is_type(obj, &mp_type_module)) {
+        return NULL;
+    }
+    const mp_map_t *map = &mp_obj_module_get_globals(obj)->map;
+    #if MICROPY_MODULE_GETATTR
+    if (mp_map_lookup((mp_map_t*)map, MP_OBJ_NEW_QSTR(MP_QSTR___getattr__), MP_MAP_LOOKUP) != NULL) {
+        return NULL;
+    }
+    #endif
+    return map;
+}
+
 size_t mp_repl_autocomplete(const char *str, size_t len, const mp_print_t *print, const char **compl_str) {
     // scan backwards to find start of "a.b.c" chain
     const char *org_str = str;
@@ -177,11 +192,23 @@ size_t mp_repl_autocomplete(const char *str, size_t len, const mp_print_t *print
         } else {
             // end of string, do completion on this partial name
 
+            // narrow the search to the matches of the last search, if this
+            // name extends its prefix and the namespace hasn't changed since
+            mp_repl_compl_cache_t *cache = &MP_STATE_VM(repl_compl);
+            const mp_map_t *map = repl_compl_map(obj);
+            qstr q_start = MP_QSTR_ + 1, q_end = nqstr;
+            if (map != NULL && cache->map == map && cache->map_used == map->used
+                && cache->nqstr == nqstr && s_len >= cache->prefix_len
+                && memcmp(s_start, cache->prefix, cache->prefix_len) == 0) {
+                q_start = cache->q_first;
+                q_end = cache->q_first == 0 ? 0 : cache->q_last + 1;
+            }
+
             // look for matches
             const char *match_str = NULL;
             size_t match_len = 0;
             qstr q_first = 0, q_last = 0;
-            for (qstr q = MP_QSTR_ + 1; q < nqstr; ++q) {
+            for (qstr q = q_start; q < q_end; ++q) {
                 size_t d_len;
                 const char *d_str = (const char*)qstr_data(q, &d_len);
                 if (s_len <= d_len && strncmp(s_start, d_str, s_len) == 0) {
@@ -208,6 +235,17 @@ size_t mp_repl_autocomplete(const char *str, size_t len, const mp_print_t *print
                 }
             }
 
+            cache->map = NULL;
+            if (map != NULL && s_len <= sizeof(cache->prefix)) {
+                cache->map = map;
+                cache->map_used = map->used;
+                cache->nqstr = nqstr;
+                cache->q_first = q_first;
+                cache->q_last = q_last;
+                cache->prefix_len = s_len;
+                memcpy(cache->prefix, s_start, s_len);
+            }
+
             // nothing found
             if (q_first == 0) {
                 // If there're no better alternatives, and if it's first word
@@ -59,6 +59,40 @@ const mp_obj_module_t mp_module___main__ = {
 void mp_init(void) {
     qstr_init();
 
+    #if MICROPY_PY_THREAD_MAP_LOCKS
+    for (size_t i = 0; i < MICROPY_PY_THREAD_MAP_LOCKS; i++) {
+        mp_thread_mutex_init(&MP_STATE_VM(map_locks)[i].mutex);
+        MP_STATE_VM(map_locks)[i].owner = NULL;
+        MP_STATE_VM(map_locks)[i].depth = 0;
+    }
+    MP_STATE_VM(map_locking) = false;
+    #endif
+
+    #if MICROPY_GC_PROFILE || MICROPY_SAMPLING_PROFILE
+    MP_STATE_THREAD(current_code_state) = NULL;
+    #endif
+
+    #if MICROPY_SAMPLING_PROFILE
+    MP_STATE_VM(profile_period) = 0;
+    MP_STATE_VM(profile_n) = 0;
+    #endif
+
+    #if MICROPY_IMPORT_STATS
+    MP_STATE_VM(import_stats_n) = 0;
+    MP_STATE_VM(import_stats_cur) = NULL;
+    MP_STATE_VM(import_stats_phase) = NULL;
+    MP_STATE_VM(import_stats_child_bytes) = 0;
+    #endif
+
+    #if MICROPY_GC_ARENA
+    MP_STATE_THREAD(gc_arena) = NULL;
+    #endif
+
+    #if MICROPY_HELPER_REPL
+    // __main__'s dict is reused, so forget completions from before
+    MP_STATE_VM(repl_compl).map = NULL;
+    #endif
+
     // no pending exceptions to start with
     MP_STATE_VM(mp_pending_exception) = MP_OBJ_NULL;
     #if MICROPY_ENABLE_SCHEDULER
@@ -112,10 +146,27 @@ void mp_init(void) {
     }
     #endif
 
+    #if MICROPY_PY_URE && MICROPY_PY_URE_CACHE_SIZE
+    for (size_t i = 0; i < 2 * MICROPY_PY_URE_CACHE_SIZE; ++i) {
+        MP_STATE_VM(ure_cache[i]) = MP_OBJ_NULL;
+    }
+    #endif
+
+    #if MICROPY_PY_USSL && MICROPY_PY_USSL_SESSION_CACHE_SIZE
+    for (size_t i = 0; i < 2 * MICROPY_PY_USSL_SESSION_CACHE_SIZE; ++i) {
+        MP_STATE_VM(ussl_session_cache[i]) = MP_OBJ_NULL;
+    }
+    #endif
+
     #if MICROPY_VFS
     // initialise the VFS sub-system
     MP_STATE_VM(vfs_cur) = NULL;
     MP_STATE_VM(vfs_mount_table) = NULL;
+    #if MICROPY_VFS_STAT_CACHE_SIZE
+    for (size_t i = 0; i < 2 * MICROPY_VFS_STAT_CACHE_SIZE; ++i) {
+        MP_STATE_VM(vfs_stat_cache[i]) = MP_OBJ_NULL;
+    }
+    #endif
     #endif
 
     #if MICROPY_PY_THREAD_GIL
@@ -1235,6 +1286,30 @@ mp_obj_t mp_iternext(mp_obj_t o_in) {
     }
 }
 
+// Get the next item of iterator o unpacked into num items, last first like
+// mp_unpack_sequence, without making the tuple that built-in iterators of
+// pairs and zip would make for it.  Returns MP_OBJ_SENTINEL if o isn't one
+// of those, or doesn't give items of length num, and otherwise
+// MP_OBJ_STOP_ITERATION at the end or mp_const_none.
+mp_obj_t mp_iternext_unpack(mp_obj_t o, size_t num, mp_obj_t *items) {
+    bool more;
+    if (num == 2 && mp_obj_is_dict_items_iter(o)) {
+        more = mp_obj_dict_items_next2(o, items);
+    #if MICROPY_PY_BUILTINS_ENUMERATE
+    } else if (num == 2 && mp_obj_is_type(o, &mp_type_enumerate)) {
+        mp_obj_t pair[2];
+        more = mp_obj_enumerate_next2(o, pair);
+        items[0] = pair[1];
+        items[1] = pair[0];
+    #endif
+    } else if (mp_obj_is_type(o, &mp_type_zip) && mp_obj_zip_len(o) == num) {
+        more = mp_obj_zip_next_n(o, num, items);
+    } else {
+        return MP_OBJ_SENTINEL;
+    }
+    return more ? mp_const_none : MP_OBJ_STOP_ITERATION;
+}
+
 // TODO: Unclear what to do with StopIterarion exception here.
 mp_vm_return_kind_t mp_resume(mp_obj_t self_in, mp_obj_t send_value, mp_obj_t throw_value, mp_obj_t *ret_val) {
     assert((send_value != MP_OBJ_NULL) ^ (throw_value != MP_OBJ_NULL));
@@ -1314,6 +1389,11 @@ mp_obj_t mp_make_raise_obj(mp_obj_t o) {
         // create and return a new exception instance by calling o
         // TODO could have an option to disable traceback, then builtin exceptions (eg TypeError)
         // could have const instances in ROM which we return here instead
+        #if MICROPY_EXC_TRACEBACK_LAZY
+        if (o == MP_OBJ_FROM_PTR(&mp_type_StopIteration)) {
+            return MP_OBJ_FROM_PTR(&mp_const_StopIteration_obj);
+        }
+        #endif
         return mp_call_function_n_kw(o, 0, 0, NULL);
     } else if (mp_obj_is_exception_instance(o)) {
         // o is an instance of an exception, so use it as the exception
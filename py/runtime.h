@@ -65,6 +65,9 @@ void mp_init(void);
 void mp_deinit(void);
 
 void mp_handle_pending(void);
+#if MICROPY_SAMPLING_PROFILE
+void mp_sampling_profile_tick(void);
+#endif
 void mp_handle_pending_tail(mp_uint_t atomic_state);
 
 #if MICROPY_ENABLE_SCHEDULER
@@ -142,6 +145,7 @@ void mp_store_attr(mp_obj_t base, qstr attr, mp_obj_t val);
 mp_obj_t mp_getiter(mp_obj_t o, mp_obj_iter_buf_t *iter_buf);
 mp_obj_t mp_iternext_allow_raise(mp_obj_t o); // may return MP_OBJ_STOP_ITERATION instead of raising StopIteration()
 mp_obj_t mp_iternext(mp_obj_t o); // will always return MP_OBJ_STOP_ITERATION instead of raising StopIteration(...)
+mp_obj_t mp_iternext_unpack(mp_obj_t o, size_t num, mp_obj_t *items); // may return MP_OBJ_SENTINEL if unsupported
 mp_vm_return_kind_t mp_resume(mp_obj_t self_in, mp_obj_t send_value, mp_obj_t throw_value, mp_obj_t *ret_val);
 
 mp_obj_t mp_make_raise_obj(mp_obj_t o);
@@ -34,6 +34,7 @@
 #define MP_SCOPE_FLAG_DEFKWARGS    (0x08)
 #define MP_SCOPE_FLAG_REFGLOBALS   (0x10) // used only if native emitter enabled
 #define MP_SCOPE_FLAG_HASCONSTS    (0x20) // used only if native emitter enabled
+#define MP_SCOPE_FLAG_XIP          (0x40) // bytecode only: qstrs are const table indices
 #define MP_SCOPE_FLAG_VIPERRET_POS    (6) // 3 bits used for viper return type
 
 // types for native (viper) function signature
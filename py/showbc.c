@@ -46,9 +46,18 @@
 
 #if MICROPY_PERSISTENT_CODE
 
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+#define DECODE_QSTR \
+    qst = ip[0] | ip[1] << 8; \
+    ip += 2; \
+    if (mp_showbc_xip) { \
+        qst = MP_OBJ_QSTR_VALUE(mp_showbc_const_table[qst]); \
+    }
+#else
 #define DECODE_QSTR \
     qst = ip[0] | ip[1] << 8; \
     ip += 2;
+#endif
 #define DECODE_PTR \
     DECODE_UINT; \
     unum = mp_showbc_const_table[unum]
@@ -79,9 +88,16 @@
 
 const byte *mp_showbc_code_start;
 const mp_uint_t *mp_showbc_const_table;
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+// whether the bytecode mp_bytecode_print is printing is in the XIP form
+STATIC bool mp_showbc_xip;
+#endif
 
 void mp_bytecode_print(const void *descr, const byte *ip, mp_uint_t len, const mp_uint_t *const_table) {
     mp_showbc_code_start = ip;
+    #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+    mp_showbc_xip = mp_bytecode_is_xip(ip);
+    #endif
 
     // get bytecode parameters
     mp_uint_t n_state = mp_decode_uint(&ip);
@@ -99,6 +115,12 @@ void mp_bytecode_print(const void *descr, const byte *ip, mp_uint_t len, const m
     qstr block_name = code_info[0] | (code_info[1] << 8);
     qstr source_file = code_info[2] | (code_info[3] << 8);
     code_info += 4;
+    #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+    if (mp_showbc_xip) {
+        block_name = MP_OBJ_QSTR_VALUE(const_table[block_name]);
+        source_file = MP_OBJ_QSTR_VALUE(const_table[source_file]);
+    }
+    #endif
     #else
     qstr block_name = mp_decode_uint(&code_info);
     qstr source_file = mp_decode_uint(&code_info);
@@ -159,6 +181,9 @@ void mp_bytecode_print(const void *descr, const byte *ip, mp_uint_t len, const m
         }
     }
     mp_bytecode_print2(ip, len - 0, const_table);
+    #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+    mp_showbc_xip = false;
+    #endif
 }
 
 const byte *mp_bytecode_print_str(const byte *ip) {
@@ -527,6 +552,23 @@ const byte *mp_bytecode_print_str(const byte *ip) {
             printf("IMPORT_STAR");
             break;
 
+        case MP_BC_LOAD_FAST_FAST_BINARY_OP: {
+            mp_uint_t op = ip[1];
+            printf("LOAD_FAST_FAST_BINARY_OP " UINT_FMT " " UINT_FMT " " UINT_FMT " %s",
+                (mp_uint_t)ip[0] >> 4, (mp_uint_t)ip[0] & 0xf, op, qstr_str(mp_binary_op_method_name[op]));
+            ip += 2;
+            break;
+        }
+
+        case MP_BC_LOAD_FAST_INT_BINARY_OP: {
+            mp_uint_t op = ip[1] & 0x3f;
+            printf("LOAD_FAST_INT_BINARY_OP " UINT_FMT " " INT_FMT " " UINT_FMT " %s",
+                (mp_uint_t)ip[0] >> 4, (mp_int_t)((ip[0] & 0xf) << 2 | ip[1] >> 6) - 16,
+                op, qstr_str(mp_binary_op_method_name[op]));
+            ip += 2;
+            break;
+        }
+
         default:
             if (ip[-1] < MP_BC_LOAD_CONST_SMALL_INT_MULTI + 64) {
                 printf("LOAD_CONST_SMALL_INT " INT_FMT, (mp_int_t)ip[-1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16);
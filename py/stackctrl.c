@@ -46,8 +46,38 @@ mp_uint_t mp_stack_usage(void) {
 
 void mp_stack_set_limit(mp_uint_t limit) {
     MP_STATE_THREAD(stack_limit) = limit;
+    #if MICROPY_STACK_HIGH_WATER
+    // paint from the limit up to just below the current frame
+    volatile int stack_dummy;
+    mp_stack_paint(MP_STATE_THREAD(stack_top) - limit, (void*)((uintptr_t)&stack_dummy - 64));
+    #endif
+}
+
+#if MICROPY_STACK_HIGH_WATER
+
+// Must not be inlined, and must not call anything, because it may be writing
+// to the stack just below its own frame.
+MP_NOINLINE void mp_stack_paint(void *bottom, void *top) {
+    uintptr_t *p = (uintptr_t*)(((uintptr_t)bottom + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1));
+    uintptr_t *end = (uintptr_t*)((uintptr_t)top & ~(sizeof(uintptr_t) - 1));
+    while (p < end) {
+        *(volatile uintptr_t*)p++ = MP_STACK_PAINT;
+    }
 }
 
+// Return the maximum number of bytes of C stack used since the limit was set,
+// found by scanning up from the limit for the first word not holding the paint.
+mp_uint_t mp_stack_high_water(void) {
+    char *top = MP_STATE_THREAD(stack_top);
+    uintptr_t *p = (uintptr_t*)(((uintptr_t)(top - MP_STATE_THREAD(stack_limit)) + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1));
+    while ((char*)p < top && *(volatile uintptr_t*)p == MP_STACK_PAINT) {
+        ++p;
+    }
+    return top - (char*)p;
+}
+
+#endif
+
 void mp_stack_check(void) {
     if (mp_stack_usage() >= MP_STATE_THREAD(stack_limit)) {
         mp_raise_recursion_depth();
@@ -38,6 +38,13 @@ void mp_stack_set_limit(mp_uint_t limit);
 void mp_stack_check(void);
 #define MP_STACK_CHECK() mp_stack_check()
 
+#if MICROPY_STACK_HIGH_WATER
+// Word pattern used to fill unused stack, 0xa5a5...
+#define MP_STACK_PAINT ((uintptr_t)-1 / 0xff * 0xa5)
+void mp_stack_paint(void *bottom, void *top);
+mp_uint_t mp_stack_high_water(void);
+#endif
+
 #else
 
 #define mp_stack_set_limit(limit)
@@ -43,6 +43,7 @@
 #define MP_STREAM_GET_DATA_OPTS (8)  // Get data/message options
 #define MP_STREAM_SET_DATA_OPTS (9)  // Set data/message options
 #define MP_STREAM_GET_FILENO    (10) // Get fileno of underlying file
+#define MP_STREAM_POLL_NOTIFY   (11) // Set/clear the poll entry to notify of events
 
 // These poll ioctl values are compatible with Linux
 #define MP_STREAM_POLL_RD  (0x0001)
@@ -50,6 +51,14 @@
 #define MP_STREAM_POLL_ERR (0x0008)
 #define MP_STREAM_POLL_HUP (0x0010)
 
+#if MICROPY_PY_USELECT_NOTIFY
+// A stream that handles MP_STREAM_POLL_NOTIFY keeps the entry it is given (NULL
+// detaches it) and returns the events it will report.  It must then call
+// mp_poll_notify, which is IRQ-safe, whenever any of those may have become ready.
+struct _poll_obj_t;
+void mp_poll_notify(struct _poll_obj_t *poll_obj, mp_uint_t events);
+#endif
+
 // Argument structure for MP_STREAM_SEEK
 struct mp_stream_seek_t {
     // If whence == MP_SEEK_SET, offset should be treated as unsigned.
@@ -32,9 +32,22 @@
 #include "py/emitglue.h"
 #include "py/objtype.h"
 #include "py/runtime.h"
+#include "py/smallint.h"
 #include "py/bc0.h"
 #include "py/bc.h"
 
+#if MICROPY_VM_OPCODE_STATS
+size_t mp_vm_opcode_count[256];
+size_t mp_vm_opcode_pair_count[256][256];
+#define OPCODE_STATS(ip) do { \
+    mp_vm_opcode_count[*(ip)] += 1; \
+    mp_vm_opcode_pair_count[opcode_prev][*(ip)] += 1; \
+    opcode_prev = *(ip); \
+} while (0)
+#else
+#define OPCODE_STATS(ip)
+#endif
+
 #if 0
 #define TRACE(ip) printf("sp=%d ", (int)(sp - &code_state->state[0] + 1)); mp_bytecode_print2(ip, 1, code_state->fun_bc->const_table);
 #else
@@ -58,9 +71,18 @@
 
 #if MICROPY_PERSISTENT_CODE
 
+#if MICROPY_PERSISTENT_CODE_LOAD_XIP
+#define DECODE_QSTR \
+    qstr qst = ip[0] | ip[1] << 8; \
+    ip += 2; \
+    if (qstr_in_const_table) { \
+        qst = MP_OBJ_QSTR_VALUE(code_state->fun_bc->const_table[qst]); \
+    }
+#else
 #define DECODE_QSTR \
     qstr qst = ip[0] | ip[1] << 8; \
     ip += 2;
+#endif
 #define DECODE_PTR \
     DECODE_UINT; \
     void *ptr = (void*)(uintptr_t)code_state->fun_bc->const_table[unum]
@@ -85,6 +107,43 @@
 
 #endif
 
+#if MICROPY_OPT_MAP_LOOKUP_CACHE
+// A guess at the index in the map of the key looked up by the opcode just
+// decoded, from a table in RAM at a slot picked by the address of the next
+// opcode.  Guesses are checked, so clashes are harmless.
+#define MAP_CACHE_ENTRY (MP_STATE_VM(map_lookup_cache)[(uintptr_t)ip & (MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE - 1)])
+#endif
+
+#if MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+// the guess is kept in the byte after the opcode
+#define VM_MAP_CACHE (1)
+#define MAP_CACHE_GET() (*ip)
+#define MAP_CACHE_SET(x) (*(byte*)ip = (x))
+#define MAP_CACHE_END() (ip++)
+#elif MICROPY_OPT_MAP_LOOKUP_CACHE
+#define VM_MAP_CACHE (1)
+#define MAP_CACHE_GET() (MAP_CACHE_ENTRY)
+#define MAP_CACHE_SET(x) (MAP_CACHE_ENTRY = (x))
+#define MAP_CACHE_END() (void)0
+#else
+#define VM_MAP_CACHE (0)
+#endif
+
+#if MICROPY_OPT_VM_FREE_RETURNED_TUPLE && !MICROPY_STACKLESS
+// a stackless call returns straight to the caller's frame, not through the
+// call opcode that checks whether the result can be freed
+#define VM_FREE_RETURNED_TUPLE (1)
+// a bytecode function's result is the tuple that it built for its return if
+// it's the one that the last bytecode return on this thread handed back
+#define CHECK_RETURNED_TUPLE(fun) \
+    if (*ip == MP_BC_UNPACK_SEQUENCE && mp_obj_is_type(fun, &mp_type_fun_bc) \
+        && TOP() == MP_STATE_THREAD(vm_returned_tuple)) { \
+        fresh_tuple = TOP(); \
+    }
+#else
+#define VM_FREE_RETURNED_TUPLE (0)
+#endif
+
 #define PUSH(val) *++sp = (val)
 #define POP() (*sp--)
 #define TOP() (*sp)
@@ -108,13 +167,53 @@
     exc_sp--; /* pop back to previous exception handler */ \
     CLEAR_SYS_EXC_INFO() /* just clear sys.exc_info(), not compliant, but it shouldn't be used in 1st place */
 
+#if MICROPY_OPT_VM_SMALL_INT || MICROPY_OPT_SUPERINSTRUCTIONS
+// The small-int ops that loops use most, done here without calling
+// mp_binary_op.  Returns MP_OBJ_NULL for any other op, or if the result isn't
+// a small int.
+static inline mp_obj_t vm_small_int_binary_op(mp_binary_op_t op, mp_int_t lhs, mp_int_t rhs) {
+    switch (op) {
+        case MP_BINARY_OP_LESS: return mp_obj_new_bool(lhs < rhs);
+        case MP_BINARY_OP_MORE: return mp_obj_new_bool(lhs > rhs);
+        case MP_BINARY_OP_EQUAL: return mp_obj_new_bool(lhs == rhs);
+        case MP_BINARY_OP_LESS_EQUAL: return mp_obj_new_bool(lhs <= rhs);
+        case MP_BINARY_OP_MORE_EQUAL: return mp_obj_new_bool(lhs >= rhs);
+        case MP_BINARY_OP_NOT_EQUAL: return mp_obj_new_bool(lhs != rhs);
+        case MP_BINARY_OP_ADD:
+        case MP_BINARY_OP_INPLACE_ADD:
+            // can't overflow, as small ints are narrower than mp_int_t
+            lhs += rhs;
+            break;
+        case MP_BINARY_OP_SUBTRACT:
+        case MP_BINARY_OP_INPLACE_SUBTRACT:
+            lhs -= rhs;
+            break;
+        case MP_BINARY_OP_AND:
+        case MP_BINARY_OP_INPLACE_AND:
+            return MP_OBJ_NEW_SMALL_INT(lhs & rhs);
+        case MP_BINARY_OP_OR:
+        case MP_BINARY_OP_INPLACE_OR:
+            return MP_OBJ_NEW_SMALL_INT(lhs | rhs);
+        case MP_BINARY_OP_XOR:
+        case MP_BINARY_OP_INPLACE_XOR:
+            return MP_OBJ_NEW_SMALL_INT(lhs ^ rhs);
+        default:
+            return MP_OBJ_NULL;
+    }
+    if (!MP_SMALL_INT_FITS(lhs)) {
+        return MP_OBJ_NULL;
+    }
+    return MP_OBJ_NEW_SMALL_INT(lhs);
+}
+#endif
+
 // fastn has items in reverse order (fastn[0] is local[0], fastn[-1] is local[1], etc)
 // sp points to bottom of stack which grows up
 // returns:
 //  MP_VM_RETURN_NORMAL, sp valid, return value in *sp
 //  MP_VM_RETURN_YIELD, ip, sp valid, yielded value in *sp
 //  MP_VM_RETURN_EXCEPTION, exception in state[0]
-mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp_obj_t inject_exc) {
+mp_vm_return_kind_t MICROPY_WRAP_MP_EXECUTE_BYTECODE(mp_execute_bytecode)(mp_code_state_t *code_state, volatile mp_obj_t inject_exc) {
 #define SELECTIVE_EXC_IP (0)
 #if SELECTIVE_EXC_IP
 #define MARK_EXC_IP_SELECTIVE() { code_state->ip = ip; } /* stores ip 1 byte past last opcode */
@@ -127,6 +226,7 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp
     #include "py/vmentrytable.h"
     #define DISPATCH() do { \
         TRACE(ip); \
+        OPCODE_STATS(ip); \
         MARK_EXC_IP_GLOBAL(); \
         goto *entry_table[*ip++]; \
     } while (0)
@@ -146,9 +246,22 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp
     // loop and the exception handler, leading to very obscure bugs.
     #define RAISE(o) do { nlr_pop(); nlr.ret_val = MP_OBJ_TO_PTR(o); goto exception_handler; } while (0)
 
+    // With MICROPY_GC_PROFILE the thread state points to the running code, so
+    // allocations can be put down to the opcode making them, and with
+    // MICROPY_SAMPLING_PROFILE so the profiler can see where the VM is.
+    #if MICROPY_GC_PROFILE || MICROPY_SAMPLING_PROFILE
+    mp_code_state_t *const caller_code_state = MP_STATE_THREAD(current_code_state);
+    #define PROFILE_ENTER() (MP_STATE_THREAD(current_code_state) = code_state)
+    #define PROFILE_EXIT() (MP_STATE_THREAD(current_code_state) = caller_code_state)
+    #else
+    #define PROFILE_ENTER()
+    #define PROFILE_EXIT()
+    #endif
+
 #if MICROPY_STACKLESS
 run_code_state: ;
 #endif
+    PROFILE_ENTER();
     // Pointers which are constant for particular invocation of mp_execute_bytecode()
     mp_obj_t * /*const*/ fastn;
     mp_exc_stack_t * /*const*/ exc_stack;
@@ -157,6 +270,10 @@ run_code_state: ;
         fastn = &code_state->state[n_state - 1];
         exc_stack = (mp_exc_stack_t*)(code_state->state + n_state);
     }
+    #if MICROPY_PERSISTENT_CODE_LOAD_XIP
+    // bytecode run in place from ROM has const table indices for its qstrs
+    const bool qstr_in_const_table = mp_bytecode_is_xip(code_state->fun_bc->bytecode);
+    #endif
 
     // variables that are visible to the exception handler (declared volatile)
     mp_exc_stack_t *volatile exc_sp = MP_TAGPTR_PTR(code_state->exc_sp); // stack grows up, exc_sp points to top of stack
@@ -176,6 +293,14 @@ outer_dispatch_loop:
             const byte *ip = code_state->ip;
             mp_obj_t *sp = code_state->sp;
             mp_obj_t obj_shared;
+            #if VM_FREE_RETURNED_TUPLE
+            // a tuple that nothing else refers to: built to be returned by
+            // the next opcode, or returned to be unpacked by the next opcode
+            mp_obj_t fresh_tuple = MP_OBJ_NULL;
+            #endif
+            #if MICROPY_VM_OPCODE_STATS
+            byte opcode_prev = 0;
+            #endif
             MICROPY_VM_HOOK_INIT
 
             // If we have exception to inject, now that we finish setting up
@@ -197,6 +322,7 @@ dispatch_loop:
                 DISPATCH();
 #else
                 TRACE(ip);
+                OPCODE_STATS(ip);
                 MARK_EXC_IP_GLOBAL();
                 switch (*ip++) {
 #endif
@@ -263,7 +389,7 @@ dispatch_loop:
                     goto load_check;
                 }
 
-                #if !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+                #if !VM_MAP_CACHE
                 ENTRY(MP_BC_LOAD_NAME): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
@@ -275,24 +401,24 @@ dispatch_loop:
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
                     mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
-                    mp_uint_t x = *ip;
+                    mp_uint_t x = MAP_CACHE_GET();
                     if (x < mp_locals_get()->map.alloc && mp_locals_get()->map.table[x].key == key) {
                         PUSH(mp_locals_get()->map.table[x].value);
                     } else {
                         mp_map_elem_t *elem = mp_map_lookup(&mp_locals_get()->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
                         if (elem != NULL) {
-                            *(byte*)ip = (elem - &mp_locals_get()->map.table[0]) & 0xff;
+                            MAP_CACHE_SET((elem - &mp_locals_get()->map.table[0]) & 0xff);
                             PUSH(elem->value);
                         } else {
                             PUSH(mp_load_name(MP_OBJ_QSTR_VALUE(key)));
                         }
                     }
-                    ip++;
+                    MAP_CACHE_END();
                     DISPATCH();
                 }
                 #endif
 
-                #if !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+                #if !VM_MAP_CACHE
                 ENTRY(MP_BC_LOAD_GLOBAL): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
@@ -304,24 +430,24 @@ dispatch_loop:
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
                     mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
-                    mp_uint_t x = *ip;
+                    mp_uint_t x = MAP_CACHE_GET();
                     if (x < mp_globals_get()->map.alloc && mp_globals_get()->map.table[x].key == key) {
                         PUSH(mp_globals_get()->map.table[x].value);
                     } else {
                         mp_map_elem_t *elem = mp_map_lookup(&mp_globals_get()->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
                         if (elem != NULL) {
-                            *(byte*)ip = (elem - &mp_globals_get()->map.table[0]) & 0xff;
+                            MAP_CACHE_SET((elem - &mp_globals_get()->map.table[0]) & 0xff);
                             PUSH(elem->value);
                         } else {
                             PUSH(mp_load_global(MP_OBJ_QSTR_VALUE(key)));
                         }
                     }
-                    ip++;
+                    MAP_CACHE_END();
                     DISPATCH();
                 }
                 #endif
 
-                #if !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+                #if !VM_MAP_CACHE
                 ENTRY(MP_BC_LOAD_ATTR): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
@@ -335,7 +461,7 @@ dispatch_loop:
                     mp_obj_t top = TOP();
                     if (mp_obj_is_instance_type(mp_obj_get_type(top))) {
                         mp_obj_instance_t *self = MP_OBJ_TO_PTR(top);
-                        mp_uint_t x = *ip;
+                        mp_uint_t x = MAP_CACHE_GET();
                         mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
                         mp_map_elem_t *elem;
                         if (x < self->members.alloc && self->members.table[x].key == key) {
@@ -343,22 +469,23 @@ dispatch_loop:
                         } else {
                             elem = mp_map_lookup(&self->members, key, MP_MAP_LOOKUP);
                             if (elem != NULL) {
-                                *(byte*)ip = elem - &self->members.table[0];
+                                MAP_CACHE_SET(elem - &self->members.table[0]);
                             } else {
                                 goto load_attr_cache_fail;
                             }
                         }
                         SET_TOP(elem->value);
-                        ip++;
+                        MAP_CACHE_END();
                         DISPATCH();
                     }
                 load_attr_cache_fail:
                     SET_TOP(mp_load_attr(top, qst));
-                    ip++;
+                    MAP_CACHE_END();
                     DISPATCH();
                 }
                 #endif
 
+                #if !MICROPY_OPT_MAP_LOOKUP_CACHE
                 ENTRY(MP_BC_LOAD_METHOD): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
@@ -366,6 +493,41 @@ dispatch_loop:
                     sp += 1;
                     DISPATCH();
                 }
+                #else
+                // Methods of native types are found in their locals dict, which for
+                // types in ROM is searched linearly, so the index is cached.  The
+                // names mp_load_method_maybe handles first are left to it.
+                ENTRY(MP_BC_LOAD_METHOD): {
+                    MARK_EXC_IP_SELECTIVE();
+                    DECODE_QSTR;
+                    mp_obj_t top = TOP();
+                    mp_obj_type_t *type = mp_obj_get_type(top);
+                    if (type->attr == NULL && type->locals_dict != NULL
+                        && qst != MP_QSTR___next__ && qst != MP_QSTR___class__) {
+                        mp_map_t *map = &type->locals_dict->map;
+                        mp_uint_t x = MAP_CACHE_ENTRY;
+                        mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
+                        mp_map_elem_t *elem;
+                        if (x < map->alloc && map->table[x].key == key) {
+                            elem = &map->table[x];
+                        } else {
+                            elem = mp_map_lookup(map, key, MP_MAP_LOOKUP);
+                            if (elem == NULL) {
+                                goto load_method_cache_fail;
+                            }
+                            MAP_CACHE_ENTRY = elem - &map->table[0];
+                        }
+                        sp[1] = MP_OBJ_NULL;
+                        mp_convert_member_lookup(top, type, elem->value, sp);
+                        sp += 1;
+                        DISPATCH();
+                    }
+                load_method_cache_fail:
+                    mp_load_method(top, qst, sp);
+                    sp += 1;
+                    DISPATCH();
+                }
+                #endif
 
                 ENTRY(MP_BC_LOAD_SUPER_METHOD): {
                     MARK_EXC_IP_SELECTIVE();
@@ -413,7 +575,7 @@ dispatch_loop:
                     DISPATCH();
                 }
 
-                #if !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+                #if !VM_MAP_CACHE
                 ENTRY(MP_BC_STORE_ATTR): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
@@ -433,7 +595,7 @@ dispatch_loop:
                     mp_obj_t top = TOP();
                     if (mp_obj_is_instance_type(mp_obj_get_type(top)) && sp[-1] != MP_OBJ_NULL) {
                         mp_obj_instance_t *self = MP_OBJ_TO_PTR(top);
-                        mp_uint_t x = *ip;
+                        mp_uint_t x = MAP_CACHE_GET();
                         mp_obj_t key = MP_OBJ_NEW_QSTR(qst);
                         mp_map_elem_t *elem;
                         if (x < self->members.alloc && self->members.table[x].key == key) {
@@ -441,20 +603,27 @@ dispatch_loop:
                         } else {
                             elem = mp_map_lookup(&self->members, key, MP_MAP_LOOKUP);
                             if (elem != NULL) {
-                                *(byte*)ip = elem - &self->members.table[0];
+                                MAP_CACHE_SET(elem - &self->members.table[0]);
                             } else {
                                 goto store_attr_cache_fail;
                             }
                         }
+                        #if MICROPY_PY_THREAD_MAP_LOCKS
+                        // the key is there, so the store won't add it, and is
+                        // done with the map locked
+                        (void)elem;
+                        mp_map_store(&self->members, key, sp[-1]);
+                        #else
                         elem->value = sp[-1];
+                        #endif
                         sp -= 2;
-                        ip++;
+                        MAP_CACHE_END();
                         DISPATCH();
                     }
                 store_attr_cache_fail:
                     mp_store_attr(sp[0], qst, sp[-1]);
                     sp -= 2;
-                    ip++;
+                    MAP_CACHE_END();
                     DISPATCH();
                 }
                 #endif
@@ -747,6 +916,20 @@ unwind_jump:;
                     } else {
                         obj = MP_OBJ_FROM_PTR(&sp[-MP_OBJ_ITER_BUF_NSLOTS + 1]);
                     }
+                    if (ip[0] == MP_BC_UNPACK_SEQUENCE && ip[1] < 0x80) {
+                        // for i, x in enumerate(...), d.items() or zip(...): push
+                        // the items without making a tuple, and skip the unpack
+                        mp_obj_t more = mp_iternext_unpack(obj, ip[1], sp + 1);
+                        if (more == MP_OBJ_STOP_ITERATION) {
+                            sp -= MP_OBJ_ITER_BUF_NSLOTS; // pop the exhausted iterator
+                            ip += ulab; // jump to after for-block
+                            DISPATCH();
+                        } else if (more != MP_OBJ_SENTINEL) {
+                            sp += ip[1];
+                            ip += 2;
+                            DISPATCH();
+                        }
+                    }
                     mp_obj_t value = mp_iternext_allow_raise(obj);
                     if (value == MP_OBJ_STOP_ITERATION) {
                         sp -= MP_OBJ_ITER_BUF_NSLOTS; // pop the exhausted iterator
@@ -770,6 +953,11 @@ unwind_jump:;
                     DECODE_UINT;
                     sp -= unum - 1;
                     SET_TOP(mp_obj_new_tuple(unum, sp));
+                    #if VM_FREE_RETURNED_TUPLE
+                    if (*ip == MP_BC_RETURN_VALUE && unum > 0) {
+                        fresh_tuple = TOP();
+                    }
+                    #endif
                     DISPATCH();
                 }
 
@@ -841,8 +1029,18 @@ unwind_jump:;
                 ENTRY(MP_BC_UNPACK_SEQUENCE): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_UINT;
+                    #if VM_FREE_RETURNED_TUPLE
+                    mp_obj_t seq = sp[0];
+                    #endif
                     mp_unpack_sequence(sp[0], unum, sp);
                     sp += unum - 1;
+                    #if VM_FREE_RETURNED_TUPLE
+                    if (seq == fresh_tuple) {
+                        // the items are on the stack now, and the tuple is gone
+                        m_del_var(mp_obj_tuple_t, mp_obj_t, unum, MP_OBJ_TO_PTR(seq));
+                    }
+                    fresh_tuple = MP_OBJ_NULL;
+                    #endif
                     DISPATCH();
                 }
 
@@ -916,7 +1114,13 @@ unwind_jump:;
                         }
                     }
                     #endif
+                    #if VM_FREE_RETURNED_TUPLE
+                    mp_obj_t fun = *sp;
+                    #endif
                     SET_TOP(mp_call_function_n_kw(*sp, unum & 0xff, (unum >> 8) & 0xff, sp + 1));
+                    #if VM_FREE_RETURNED_TUPLE
+                    CHECK_RETURNED_TUPLE(fun);
+                    #endif
                     DISPATCH();
                 }
 
@@ -999,7 +1203,13 @@ unwind_jump:;
                         }
                     }
                     #endif
+                    #if VM_FREE_RETURNED_TUPLE
+                    mp_obj_t fun = *sp;
+                    #endif
                     SET_TOP(mp_call_method_n_kw(unum & 0xff, (unum >> 8) & 0xff, sp));
+                    #if VM_FREE_RETURNED_TUPLE
+                    CHECK_RETURNED_TUPLE(fun);
+                    #endif
                     DISPATCH();
                 }
 
@@ -1099,6 +1309,12 @@ unwind_return:
                         goto run_code_state;
                     }
                     #endif
+                    #if VM_FREE_RETURNED_TUPLE
+                    // every bytecode return sets this, so a caller that sees it
+                    // knows the tuple came from the function that it called
+                    MP_STATE_THREAD(vm_returned_tuple) = (*sp == fresh_tuple) ? *sp : MP_OBJ_NULL;
+                    #endif
+                    PROFILE_EXIT();
                     return MP_VM_RETURN_NORMAL;
 
                 ENTRY(MP_BC_RAISE_VARARGS): {
@@ -1136,6 +1352,7 @@ yield:
                     code_state->ip = ip;
                     code_state->sp = sp;
                     code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, 0);
+                    PROFILE_EXIT();
                     return MP_VM_RETURN_YIELD;
 
                 ENTRY(MP_BC_YIELD_FROM): {
@@ -1212,6 +1429,48 @@ yield:
                     mp_import_all(POP());
                     DISPATCH();
 
+                #if MICROPY_OPT_SUPERINSTRUCTIONS
+                ENTRY(MP_BC_LOAD_FAST_FAST_BINARY_OP): {
+                    mp_obj_t lhs = fastn[-(mp_int_t)(ip[0] >> 4)];
+                    mp_obj_t rhs = fastn[-(mp_int_t)(ip[0] & 0xf)];
+                    mp_binary_op_t op = ip[1];
+                    ip += 2;
+                    if (lhs == MP_OBJ_NULL || rhs == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    mp_obj_t res = MP_OBJ_NULL;
+                    if (mp_obj_is_small_int(lhs) && mp_obj_is_small_int(rhs)) {
+                        res = vm_small_int_binary_op(op, MP_OBJ_SMALL_INT_VALUE(lhs), MP_OBJ_SMALL_INT_VALUE(rhs));
+                    }
+                    if (res == MP_OBJ_NULL) {
+                        MARK_EXC_IP_SELECTIVE();
+                        res = mp_binary_op(op, lhs, rhs);
+                    }
+                    PUSH(res);
+                    DISPATCH();
+                }
+
+                ENTRY(MP_BC_LOAD_FAST_INT_BINARY_OP): {
+                    mp_obj_t lhs = fastn[-(mp_int_t)(ip[0] >> 4)];
+                    mp_int_t rhs = ((ip[0] & 0xf) << 2 | ip[1] >> 6) - 16;
+                    mp_binary_op_t op = ip[1] & 0x3f;
+                    ip += 2;
+                    if (lhs == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    mp_obj_t res = MP_OBJ_NULL;
+                    if (mp_obj_is_small_int(lhs)) {
+                        res = vm_small_int_binary_op(op, MP_OBJ_SMALL_INT_VALUE(lhs), rhs);
+                    }
+                    if (res == MP_OBJ_NULL) {
+                        MARK_EXC_IP_SELECTIVE();
+                        res = mp_binary_op(op, lhs, MP_OBJ_NEW_SMALL_INT(rhs));
+                    }
+                    PUSH(res);
+                    DISPATCH();
+                }
+                #endif
+
 #if MICROPY_OPT_COMPUTED_GOTO
                 ENTRY(MP_BC_LOAD_CONST_SMALL_INT_MULTI):
                     PUSH(MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[-1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16));
@@ -1231,9 +1490,19 @@ yield:
                     DISPATCH();
 
                 ENTRY(MP_BC_BINARY_OP_MULTI): {
-                    MARK_EXC_IP_SELECTIVE();
                     mp_obj_t rhs = POP();
                     mp_obj_t lhs = TOP();
+                    #if MICROPY_OPT_VM_SMALL_INT
+                    if (mp_obj_is_small_int(lhs) && mp_obj_is_small_int(rhs)) {
+                        mp_obj_t res = vm_small_int_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI,
+                            MP_OBJ_SMALL_INT_VALUE(lhs), MP_OBJ_SMALL_INT_VALUE(rhs));
+                        if (res != MP_OBJ_NULL) {
+                            SET_TOP(res);
+                            DISPATCH();
+                        }
+                    }
+                    #endif
+                    MARK_EXC_IP_SELECTIVE();
                     SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
                     DISPATCH();
                 }
@@ -1257,6 +1526,16 @@ yield:
                     } else if (ip[-1] < MP_BC_BINARY_OP_MULTI + MP_BINARY_OP_NUM_BYTECODE) {
                         mp_obj_t rhs = POP();
                         mp_obj_t lhs = TOP();
+                        #if MICROPY_OPT_VM_SMALL_INT
+                        if (mp_obj_is_small_int(lhs) && mp_obj_is_small_int(rhs)) {
+                            mp_obj_t res = vm_small_int_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI,
+                                MP_OBJ_SMALL_INT_VALUE(lhs), MP_OBJ_SMALL_INT_VALUE(rhs));
+                            if (res != MP_OBJ_NULL) {
+                                SET_TOP(res);
+                                DISPATCH();
+                            }
+                        }
+                        #endif
                         SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
                         DISPATCH();
                     } else
@@ -1265,6 +1544,7 @@ yield:
                     mp_obj_t obj = mp_obj_new_exception_msg(&mp_type_NotImplementedError, "byte code not implemented");
                     nlr_pop();
                     code_state->state[0] = obj;
+                    PROFILE_EXIT();
                     return MP_VM_RETURN_EXCEPTION;
                 }
 
@@ -1358,57 +1638,6 @@ exception_handler:
 #if MICROPY_STACKLESS
 unwind_loop:
 #endif
-            // set file and line number that the exception occurred at
-            // TODO: don't set traceback for exceptions re-raised by END_FINALLY.
-            // But consider how to handle nested exceptions.
-            if (nlr.ret_val != &mp_const_GeneratorExit_obj) {
-                const byte *ip = code_state->fun_bc->bytecode;
-                ip = mp_decode_uint_skip(ip); // skip n_state
-                ip = mp_decode_uint_skip(ip); // skip n_exc_stack
-                ip++; // skip scope_params
-                ip++; // skip n_pos_args
-                ip++; // skip n_kwonly_args
-                ip++; // skip n_def_pos_args
-                size_t bc = code_state->ip - ip;
-                size_t code_info_size = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip); // skip code_info_size
-                bc -= code_info_size;
-                #if MICROPY_PERSISTENT_CODE
-                qstr block_name = ip[0] | (ip[1] << 8);
-                qstr source_file = ip[2] | (ip[3] << 8);
-                ip += 4;
-                #else
-                qstr block_name = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
-                qstr source_file = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
-                #endif
-                size_t source_line = 1;
-                size_t c;
-                while ((c = *ip)) {
-                    size_t b, l;
-                    if ((c & 0x80) == 0) {
-                        // 0b0LLBBBBB encoding
-                        b = c & 0x1f;
-                        l = c >> 5;
-                        ip += 1;
-                    } else {
-                        // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
-                        b = c & 0xf;
-                        l = ((c << 4) & 0x700) | ip[1];
-                        ip += 2;
-                    }
-                    if (bc >= b) {
-                        bc -= b;
-                        source_line += l;
-                    } else {
-                        // found source line corresponding to bytecode offset
-                        break;
-                    }
-                }
-                mp_obj_exception_add_traceback(MP_OBJ_FROM_PTR(nlr.ret_val), source_file, source_line, block_name);
-            }
-
             while (exc_sp >= exc_stack && exc_sp->handler <= code_state->ip) {
 
                 // nested exception
@@ -1422,6 +1651,28 @@ unwind_loop:
                 POP_EXC_BLOCK();
             }
 
+            // set file and line number that the exception occurred at
+            // TODO: don't set traceback for exceptions re-raised by END_FINALLY.
+            // But consider how to handle nested exceptions.
+            if (nlr.ret_val != &mp_const_GeneratorExit_obj
+                #if MICROPY_EXC_TRACEBACK_LAZY
+                && nlr.ret_val != &mp_const_StopIteration_obj
+                #endif
+                ) {
+                #if MICROPY_EXC_TRACEBACK_LAZY
+                if (exc_sp >= exc_stack && !MP_TAGPTR_TAG1(exc_sp->val_sp)) {
+                    // caught by an except clause in this function, which most likely
+                    // swallows it, so only note where it happened for now
+                    mp_obj_exception_defer_traceback(MP_OBJ_FROM_PTR(nlr.ret_val), code_state->fun_bc, code_state->ip);
+                } else
+                #endif
+                {
+                    qstr block_name, source_file;
+                    size_t source_line = mp_bytecode_get_source_line(code_state->fun_bc, code_state->ip, &block_name, &source_file);
+                    mp_obj_exception_add_traceback(MP_OBJ_FROM_PTR(nlr.ret_val), source_file, source_line, block_name);
+                }
+            }
+
             if (exc_sp >= exc_stack) {
                 // catch exception and pass to byte code
                 code_state->ip = exc_sp->handler;
@@ -1449,6 +1700,7 @@ unwind_loop:
                 exc_stack = (mp_exc_stack_t*)(code_state->state + n_state);
                 // variables that are visible to the exception handler (declared volatile)
                 exc_sp = MP_TAGPTR_PTR(code_state->exc_sp); // stack grows up, exc_sp points to top of stack
+                PROFILE_ENTER();
                 goto unwind_loop;
 
             #endif
@@ -1456,6 +1708,7 @@ unwind_loop:
                 // propagate exception to higher level
                 // Note: ip and sp don't have usable values at this point
                 code_state->state[0] = MP_OBJ_FROM_PTR(nlr.ret_val); // put exception here because sp is invalid
+                PROFILE_EXIT();
                 return MP_VM_RETURN_EXCEPTION;
             }
         }
@@ -112,6 +112,13 @@ STATIC void vstr_ensure_extra(vstr_t *vstr, size_t size) {
             mp_raise_msg(&mp_type_RuntimeError, NULL);
         }
         size_t new_alloc = ROUND_ALLOC((vstr->len + size) + 16);
+        #if MICROPY_ALLOC_VSTR_GROW_MAX
+        // grow geometrically, so lots of small appends take amortised linear time
+        size_t grow = MIN(vstr->alloc / 2, MICROPY_ALLOC_VSTR_GROW_MAX);
+        if (new_alloc < vstr->alloc + grow) {
+            new_alloc = ROUND_ALLOC(vstr->alloc + grow);
+        }
+        #endif
         char *new_buf = m_renew(char, vstr->buf, vstr->alloc, new_alloc);
         vstr->alloc = new_alloc;
         vstr->buf = new_buf;
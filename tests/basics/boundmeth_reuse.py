@@ -0,0 +1,32 @@
+# test bound methods made again for the same or different objects
+
+class A:
+    def __init__(self, x):
+        self.x = x
+    def f(self):
+        return self.x
+    def g(self):
+        return -self.x
+
+objs = [A(i) for i in range(20)]
+
+# each bound method calls its own method of its own object
+for _ in range(2):
+    print([o.f() for o in objs])
+    print([o.g() for o in objs])
+    ms = [(o.f, o.g) for o in objs]
+    print([(f(), g()) for f, g in ms])
+
+# bound methods of builtin types
+l = []
+for i in range(3):
+    l.append(i)
+    ap = l.append
+    ap(-i)
+print(l)
+
+# bound methods still work after a collection
+import gc
+m = objs[5].f
+gc.collect()
+print(m(), objs[5].f(), objs[6].f())
@@ -10,17 +10,8 @@ except ImportError:
     raise SystemExit
 
 
-# Initial sequence is not supported
-try:
-    deque([1, 2, 3], 10)
-except ValueError:
-    print("ValueError")
-
-# Not even empty list, only empty tuple
-try:
-    deque([], 10)
-except ValueError:
-    print("ValueError")
+# Initial sequence can be any iterable
+print(len(deque([1, 2, 3], 10)), len(deque([], 10)), len(deque(range(5), 10)))
 
 # Only fixed-size deques are supported, so length arg is mandatory
 try:
@@ -64,3 +55,23 @@ try:
     d.popleft()
 except IndexError as e:
     print(repr(e))
+
+# Overflow is checked adding on the left side and for each item extended by
+d.extend([8, 9])
+try:
+    d.appendleft(10)
+except IndexError as e:
+    print(repr(e))
+try:
+    d.extend((11,))
+except IndexError as e:
+    print(repr(e))
+try:
+    d = deque([1, 2, 3], 2, True)
+except IndexError as e:
+    print(repr(e))
+print(d.pop(), d.pop())
+try:
+    d.pop()
+except IndexError as e:
+    print(repr(e))
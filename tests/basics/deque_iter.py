@@ -0,0 +1,66 @@
+# Tests for deque appendleft, pop, extend, indexing and iteration
+try:
+    try:
+        from ucollections import deque
+    except ImportError:
+        from collections import deque
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    iter(deque((), 1))
+    deque([1], 1)[0]
+except TypeError:
+    print("SKIP")
+    raise SystemExit
+
+d = deque((), 3)
+d.extend([1, 2])
+d.appendleft(0)
+print(list(d), len(d), d[0], d[1], d[-1])
+
+# full, so items drop off the other end
+d.appendleft(-1)
+print(list(d))
+d.append(9)
+print(list(d))
+print(d.pop(), list(d), d.popleft(), list(d))
+
+# extend from other iterables, wrapping round the ring
+d.extend(range(10, 15))
+print(list(d), [x for x in d], tuple(d))
+d.extend(x * 2 for x in range(2))
+print(list(d))
+d.extend(deque([7, 8], 2))
+print(list(d))
+
+# store by index
+d[0] = "a"
+d[-1] = "z"
+print(list(d))
+try:
+    d[3]
+except IndexError:
+    print("IndexError")
+try:
+    d[-4] = 0
+except IndexError:
+    print("IndexError")
+
+# initial items
+print(list(deque([1, 2, 3, 4], 2)))
+print(list(deque("abc", 5)))
+
+# mixed use from both ends
+d = deque((), 4)
+for i in range(20):
+    d.append(i)
+    d.appendleft(-i)
+    if i % 3 == 0:
+        d.pop()
+print(list(d), sum(d), d[1], d[-2])
+try:
+    deque((), 2).pop()
+except IndexError:
+    print("IndexError")
@@ -0,0 +1,57 @@
+# test for-loops over enumerate that unpack the index and item
+
+for i, x in enumerate([10, 20, 30]):
+    print(i, x)
+
+for i, x in enumerate('ab', 5):
+    print(i, x)
+
+for i, x in enumerate(range(3)):
+    i = 'changed'
+    print(x)
+
+def gen():
+    yield 'a'
+    yield 'b'
+for i, x in enumerate(gen()):
+    print(i, x)
+
+for i, (a, b) in enumerate([(1, 2), (3, 4)]):
+    print(i, a, b)
+
+for i, x in enumerate([]):
+    print('not reached')
+else:
+    print('else', 'i' in locals())
+
+for i, x in enumerate([1, 2, 3]):
+    if x == 2:
+        break
+else:
+    print('not reached')
+print(i, x)
+
+def f(l):
+    for i, x in enumerate(l):
+        for j, y in enumerate(l):
+            if i + j == 3:
+                return x, y
+print(f([5, 6, 7]))
+
+class It:
+    def __iter__(self):
+        return self
+    def __next__(self):
+        raise ValueError
+try:
+    for i, x in enumerate(It()):
+        pass
+except ValueError:
+    print('ValueError')
+
+# an item that's not unpacked
+for t in enumerate([1]):
+    print(t)
+e = enumerate([1, 2])
+for i, x in e:
+    print(i, x, list(e))
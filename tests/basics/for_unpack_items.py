@@ -0,0 +1,41 @@
+# test for-loops over dict items and zip that unpack each item
+
+d = {1: 'a', 2: 'b', 3: 'c'}
+l = []
+for k, v in d.items():
+    l.append((k, d[k] == v))
+print(sorted(l))
+print(sorted(k * 10 for k, v in d.items()))
+
+for x, y in zip([1, 2, 3], 'abcd'):
+    print(x, y)
+for x, y, z in zip(range(3), range(10, 13), range(20, 30)):
+    print(x, y, z)
+for x, y in zip([], [1]):
+    print('not reached')
+else:
+    print('else')
+
+# item lengths that don't match are unpacked as usual
+try:
+    for x, y in zip([1], [2], [3]):
+        pass
+except ValueError:
+    print('ValueError')
+for (x,) in zip('ab'):
+    print(x)
+
+# items that are not unpacked, and iterators used after a break
+for t in zip(d.items(), 'xy'):
+    print(t[1])
+it = iter(d.items())
+for k, v in it:
+    break
+print(len(list(it)))
+z = zip([1, 2, 3], [4, 5, 6])
+for x, y in z:
+    print(x, y, list(z))
+
+# nested unpacking
+for i, (a, b) in zip(range(2), [(1, 2), (3, 4)]):
+    print(i, a, b)
@@ -0,0 +1,31 @@
+# test keyword arguments given in various orders
+
+def f(a, b=2, c=3, *, d=4, e=5):
+    return a, b, c, d, e
+
+print(f(1, b=10, c=11, d=12, e=13))
+print(f(1, e=13, d=12, c=11, b=10))
+print(f(1, c=11, e=13, b=10))
+print(f(a=1, e=13))
+print(f(e=13, a=1, d=12))
+print(f(1, 2, d=12, c=11))
+
+def g(**kw):
+    return sorted(kw.items())
+
+print(g(x=1, y=2))
+
+def h(a, b, **kw):
+    return a, b, sorted(kw.items())
+
+print(h(1, z=3, b=2))
+print(h(b=2, a=1, c=3))
+
+try:
+    f(1, 2, b=3)
+except TypeError:
+    print('TypeError')
+try:
+    f(1, c=3, x=4)
+except TypeError:
+    print('TypeError')
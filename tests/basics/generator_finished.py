@@ -0,0 +1,56 @@
+# test using generators after they have finished
+
+def gen(n):
+    a, b, c = 1, 2, 3
+    for i in range(n):
+        yield i + a + b + c
+    return 'ret'
+
+# after returning
+g = gen(2)
+print(next(g), next(g))
+try:
+    next(g)
+except StopIteration as e:
+    print('StopIteration', e.args)
+print(list(g))
+try:
+    g.send(None)
+except StopIteration:
+    print('StopIteration')
+print(g.close())
+
+# the return value is passed on
+def outer():
+    r = yield from gen(1)
+    yield r
+print(list(outer()))
+
+# after raising
+def gen_raise():
+    yield 1
+    raise ValueError('x')
+g = gen_raise()
+print(next(g))
+try:
+    next(g)
+except ValueError as e:
+    print('ValueError', e.args)
+print(list(g))
+
+# after close
+g = gen(5)
+print(next(g))
+g.close()
+print(list(g))
+
+# many short lived generators
+def gen2(n):
+    a, b, c = 1, 2, 3
+    for i in range(n):
+        yield i + a + b + c
+t = 0
+for i in range(100):
+    for x in gen2(3):
+        t += x
+print(t)
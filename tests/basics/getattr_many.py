@@ -0,0 +1,16 @@
+# test looking up many attribute names interned at runtime
+
+class A:
+    pass
+
+a = A()
+names = ['attr%d' % i for i in range(300)]
+for i, n in enumerate(names):
+    setattr(a, n, i)
+print(all(getattr(a, n) == i for i, n in enumerate(names)))
+print(getattr(a, 'attr' + '299'))
+print(hasattr(a, 'attr300'))
+
+# names that are built in are found too
+print(getattr([], 'app' + 'end') is not None)
+print(getattr(A, 'x' * 3, 'missing'))
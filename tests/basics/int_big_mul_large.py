@@ -0,0 +1,35 @@
+# multiplication and 3 arg pow of ints with many digits
+
+seed = 7
+def rand(bits):
+    global seed
+    r = 0
+    for _ in range((bits + 29) // 30):
+        seed = (seed * 1103515245 + 12345) & 0x7fffffff
+        r = r << 30 | (seed >> 1)
+    return r >> ((bits + 29) // 30 * 30 - bits)
+
+# check products against (a * b) ** 2 == a * a * b * b, and by their
+# remainders, for lengths either side of the cutoffs and lopsided ones
+for bits_a in (1000, 1024, 1025, 2047, 3000, 9000):
+    for bits_b in (1000, 1100, 2048, 4100, 30000):
+        a = rand(bits_a) | 1 << (bits_a - 1)
+        b = rand(bits_b) | 1
+        p = a * b
+        print(bits_a, bits_b, p % 1000000007, (-a * b) % 999983, p * p == a * a * (b * b))
+
+# squares, and numbers with many zero digits
+x = 7 ** 5000
+print(x * x == 49 ** 5000, (x * x) % 1000003)
+x = (1 << 5000) + 1
+print(x * x == (1 << 10000) + (1 << 5001) + 1)
+print((x * x - 1) // x == x - 1)
+
+# 3 arg pow with odd, even and negative moduli
+for bits in (64, 200, 521, 1024):
+    m = rand(bits) | 1
+    for mod in (m, m + 1, -m):
+        a = rand(bits + 10)
+        e = rand(bits)
+        print(bits, pow(a, e, mod) % 1000003, pow(-a, e, mod) % 1000003, pow(a, 65537, mod) % 1000003)
+        print(pow(mod - 1, e | 1, mod) == (mod - 1) % mod, pow(a, 1, mod) == a % mod)
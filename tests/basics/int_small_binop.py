@@ -0,0 +1,22 @@
+# test binary ops on two small ints that aren't both locals, which the VM
+# may do itself, near the limits of a small int
+
+for a, b in ((3, 4), (-5, 12), (0, 0), (True, 1)):
+    print(a + b, a - b, a < b, a > b, a == b, a <= b, a >= b, a != b)
+    print(a & b, a | b, a ^ b)
+
+# results too big for a small int, for 31-bit and 63-bit small ints
+for a, b in ((0x3fffffff, 1), (-0x40000000, 1), (0x3fffffffffffffff, 1), (-0x4000000000000000, 1)):
+    print(a + b, a - b, b - a, -a - b, a + a)
+    print(a & -1, a | -b, a ^ -1)
+
+l = [0x3fffffff, -0x40000000]
+x = l[0]
+x += l[0]
+print(x)
+x = l[1]
+x -= l[0]
+print(x)
+x = l[0]
+x ^= l[1]
+print(x)
@@ -0,0 +1,25 @@
+# test many small writes to a BytesIO and StringIO, which grow their buffer
+try:
+    import uio as io
+except ImportError:
+    import io
+
+b = io.BytesIO()
+for i in range(2000):
+    b.write(b"%d," % i)
+v = b.getvalue()
+print(len(v), v[:20], v[-20:], v == b",".join(b"%d" % i for i in range(2000)) + b",")
+
+# writing after seeking back, and past the end
+b.seek(5)
+b.write(b"*" * 10)
+b.seek(len(v) + 3)
+b.write(b"end")
+v = b.getvalue()
+print(len(v), v[:20], v[-10:])
+
+s = io.StringIO()
+for i in range(500):
+    s.write("é%d" % i)
+v = s.getvalue()
+print(len(v), v[:12], v[-12:])
@@ -0,0 +1,68 @@
+# list.sort and sorted are stable, and leave the list whole on an exception
+
+seed = 1
+def rand(n):
+    global seed
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff
+    return (seed >> 11) % n
+
+def check(l, **kw):
+    # sort (key, index) pairs by key only, and check the indices stay in order
+    pairs = [(x, i) for i, x in enumerate(l)]
+    s = sorted(pairs, key=lambda p: p[0], **kw)
+    expect = [(x, i) for i, x in enumerate(l)]
+    expect.sort()
+    if kw.get("reverse"):
+        # equal keys still keep their original order when reversed
+        expect = sorted(expect, key=lambda p: (-p[0], p[1]))
+    print(len(l), s == expect)
+
+# short lists, that are only insertion sorted, and longer ones that are merged
+for n in (0, 1, 2, 10, 31, 32, 33, 100, 1000):
+    l = [rand(10) for _ in range(n)]
+    check(l)
+    check(l, reverse=True)
+
+# runs already in order, and in reverse order
+l = list(range(500)) + list(range(250))
+check(l)
+l = list(range(300, 0, -1)) + [5] * 40 + list(range(300))
+check(l)
+check(l, reverse=True)
+l = [rand(50) for _ in range(400)]
+l.sort()
+l[100], l[300] = l[300], l[100]
+check(l)
+
+# the key function is called once for each item
+calls = 0
+def key(x):
+    global calls
+    calls += 1
+    return -x
+l = [rand(1000) for _ in range(300)]
+l.sort(key=key)
+print(calls, l == sorted(l, reverse=True))
+
+# an exception part way through leaves all the items in the list
+class Cmp:
+    def __init__(self, v):
+        self.v = v
+    def __lt__(self, other):
+        global n_cmp
+        n_cmp += 1
+        if n_cmp == limit:
+            raise ValueError
+        return self.v < other.v
+
+ok = True
+for limit in range(1, 2000, 37):
+    l = [Cmp(rand(100)) for _ in range(200)]
+    before = sorted(id(x) for x in l)
+    n_cmp = 0
+    try:
+        l.sort()
+    except ValueError:
+        pass
+    ok = ok and len(l) == 200 and sorted(id(x) for x in l) == before
+print(ok)
@@ -0,0 +1,51 @@
+# test binary ops on a local and another local or a small int, which the
+# compiler may fuse into one opcode
+
+def f(a, b):
+    print(a + b, a - b, a * b, a < b, a > b, a == b, a <= b, a >= b, a != b)
+    print(a + 1, a - 1, a * 47, a // 3, a % 7, a < -16, a >= 0, a != 47)
+    print(a & 15, a | 1, a ^ -1, a << 2, a >> 1)
+
+f(3, 4)
+f(-16, 47)
+f(0, 0)
+# results too big for a small int
+f(0x3fffffff, 0x3fffffff)
+f(-0x40000000, 0x3fffffff)
+f(0x7fffffffffffffff, 2)
+f(True, False)
+
+# other types
+def g(s, t):
+    print(s + t, s * 2, s == t, s < t)
+
+g(1.5, 2)
+g('ab', 'cd')
+g([1], [2])
+
+def h(n):
+    i = 0
+    s = 0
+    while i < n:
+        s += i
+        i += 1
+    return s
+
+print(h(100))
+
+# many locals, so the later ones aren't fused
+def k():
+    a0 = a1 = a2 = a3 = a4 = a5 = a6 = a7 = a8 = a9 = a10 = a11 = a12 = a13 = a14 = a15 = 1
+    a16 = 2
+    print(a15 + a16, a16 - 1, a0 + a15)
+
+k()
+
+# a bad operand type
+def t(a):
+    return a - 1
+
+try:
+    t('a')
+except TypeError:
+    print('TypeError')
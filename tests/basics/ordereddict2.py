@@ -0,0 +1,45 @@
+# test OrderedDicts large enough to be indexed, and popitem
+try:
+    from collections import OrderedDict
+except ImportError:
+    try:
+        from ucollections import OrderedDict
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+# popitem removes the last item
+d = OrderedDict([(1, 'a'), (2, 'b'), (3, 'c')])
+print(d.popitem(), list(d.items()), 3 in d, 2 in d)
+d[3] = 'd'
+print(d.popitem(), d.popitem(), d.popitem(), len(d))
+try:
+    d.popitem()
+except KeyError:
+    print('KeyError')
+
+# insertion order is kept while growing past the small sizes
+d = OrderedDict()
+for i in range(300):
+    d[(i * 37) % 300] = i
+d['x'] = 'y'
+print(len(d), list(d.keys())[:5], list(d.keys())[-3:], d[111], d['x'])
+
+# delete from the start, middle and end, then look everything up
+for k in (0, 37, 150, 'x', 263, 299):
+    del d[k]
+print(len(d), 0 in d, 150 in d, 'x' in d, 1 in d)
+print(all(d[k] == (k * 73) % 300 for k in d))
+d[0] = 'new'
+print(list(d.keys())[-2:], d.popitem(), d.popitem())
+
+# a copy keeps the order and can be added to
+e = d.copy()
+e['z'] = 1
+print(len(e), list(e.keys())[:3], list(e.keys())[-1], e[111])
+
+# keys must be hashable
+try:
+    OrderedDict()[[]] = 1
+except TypeError:
+    print('TypeError')
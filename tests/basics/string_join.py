@@ -10,6 +10,14 @@ print(''.join(''))
 print(''.join('abc'))
 print(','.join('abc'))
 print(','.join('abc' for i in range(5)))
+print(','.join(iter([])))
+print('-'.join(str(i) for i in range(100)))
+print(b'.'.join(bytes([65 + i]) for i in range(10)))
+print(''.join({'a': 1, 'b': 2}))
+try:
+    ','.join(x for x in ['a', 1])
+except TypeError:
+    print("TypeError")
 
 print(b','.join([b'abc', b'123']))
 
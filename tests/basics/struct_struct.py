@@ -0,0 +1,56 @@
+# test ustruct.Struct and iter_unpack
+
+try:
+    import ustruct as struct
+except:
+    try:
+        import struct
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+try:
+    struct.Struct
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+s = struct.Struct('<hIb2s')
+print(s.format, s.size)
+b = s.pack(-2, 100000, 3, b'xy')
+print(b)
+print(s.unpack(b))
+print(s.unpack_from(b'\x00' + b, 1))
+print(s.unpack_from(b'\x00' + b, -s.size))
+
+buf = bytearray(s.size + 2)
+s.pack_into(buf, 2, 1, 2, 3, b'z')
+print(buf)
+s.pack_into(buf, -s.size, 4, 5, 6, b'ab')
+print(buf)
+
+# stream records from a buffer
+rec = struct.Struct('>HB')
+data = b''.join(rec.pack(i * 1000, i) for i in range(5))
+print(list(rec.iter_unpack(data)))
+print(list(struct.iter_unpack('<h', b'\x01\x00\xff\xff')))
+print(list(rec.iter_unpack(b'')))
+for x, in struct.iter_unpack('B', memoryview(b'abc')[1:]):
+    print(x)
+
+# errors
+try:
+    s.unpack(b'123')
+except Exception:
+    print('error')
+try:
+    s.pack_into(bytearray(2), 0, 1, 2, 3, b'x')
+except Exception:
+    print('error')
+try:
+    rec.iter_unpack(b'1234')
+except Exception:
+    print('error')
+try:
+    struct.iter_unpack('', b'')
+except Exception:
+    print('error')
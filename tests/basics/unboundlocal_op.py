@@ -0,0 +1,19 @@
+# test unbound locals used in a binary op
+
+def u1():
+    x + 1
+    x = 1
+
+def u2(y):
+    y + x
+    x = 1
+
+def u3(y):
+    x + y
+    x = 1
+
+for fn in (u1, lambda: u2(1), lambda: u3(1)):
+    try:
+        fn()
+    except NameError:
+        print('NameError')
@@ -0,0 +1,67 @@
+# test unpacking tuples returned by functions, which may be freed once unpacked
+
+def f(a, b):
+    return a, b
+
+def g(a, b):
+    return f(b, a)
+
+saved = []
+def h(a, b):
+    t = a, b
+    saved.append(t)
+    return t
+
+def k(a, b):
+    try:
+        return a, b
+    finally:
+        saved.append(a)
+
+def gen():
+    yield 1
+    return 2, 3
+
+class A:
+    def m(self, x):
+        return x, self
+
+# the freed tuples are reused by later allocations
+for i in range(4):
+    x, y = f(i, [i])
+    x2, y2 = f('a', 'b')
+    print(x, y, x2, y2)
+
+# a tuple passed on from another function
+x, y = g(1, 2)
+print(x, y)
+
+# a tuple that's also kept somewhere else
+x, y = h(3, 4)
+l = [f(5, 6) for _ in range(3)]
+print(x, y, saved, l)
+
+# a return through a finally block
+x, y = k(7, 8)
+print(x, y, saved)
+
+# methods
+a = A()
+x, y = a.m(9)
+print(x, y is a)
+
+# a generator's return value
+g = gen()
+next(g)
+try:
+    next(g)
+except StopIteration as e:
+    x, y = e.value
+    print(x, y, e.value)
+
+# unpacking to the wrong number of items
+try:
+    x, y, z = f(1, 2)
+except ValueError:
+    print('ValueError')
+print(f(1, 2))
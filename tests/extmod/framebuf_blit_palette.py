@@ -0,0 +1,60 @@
+# test blit between formats, with a palette and a colour key
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+def make(w, h, fmt):
+    bpp = {framebuf.RGB565: 16, framebuf.PL8: 8, framebuf.GS4_HMSB: 4}[fmt]
+    return framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt)
+
+def dump(fb, w, h):
+    for y in range(h):
+        print(' '.join('%04x' % fb.pixel(x, y) for x in range(w)))
+
+# palette in RGB565 target format
+pal = make(16, 1, framebuf.RGB565)
+for i in range(16):
+    pal.pixel(i, 0, (i * 0x10) << 16 | (i * 0x08) << 8 | (0xf0 - i * 0x10))
+
+# 4-bit and 8-bit sprites with the same pixels
+spr4 = make(6, 3, framebuf.GS4_HMSB)
+spr8 = make(6, 3, framebuf.PL8)
+for y in range(3):
+    for x in range(6):
+        spr4.pixel(x, y, (x + y * 6) % 16)
+        spr8.pixel(x, y, (x + y * 6) % 16)
+
+dst = make(8, 4, framebuf.RGB565)
+for spr in (spr4, spr8):
+    dst.fill(0)
+    dst.blit(spr, 1, 0, -1, pal)
+    dump(dst, 8, 4)
+    # key skips source index 3, and the sprite is clipped on both sides
+    dst.fill(0)
+    dst.blit(spr, -1, 2, 3, pal)
+    dst.blit(spr, 5, -1, 3, pal)
+    dump(dst, 8, 4)
+
+# RGB565 to RGB565, with and without a key
+src = make(3, 2, framebuf.RGB565)
+src.fill(0xff0000)
+src.pixel(1, 1, 0x00ff00)
+dst.fill(0)
+dst.blit(src, 0, 0)
+dst.blit(src, 4, 1, src.pixel(0, 0))
+dump(dst, 8, 4)
+
+# PL8 to PL8 through a PL8 palette
+pal8 = make(16, 1, framebuf.PL8)
+for i in range(16):
+    pal8.pixel(i, 0, 0x80 + i)
+d8 = make(8, 2, framebuf.PL8)
+d8.blit(spr8, 0, 0, 0, pal8)
+dump(d8, 8, 2)
+
+# other format pairs fall back to per-pixel copying
+g4 = make(8, 2, framebuf.GS4_HMSB)
+g4.blit(spr8, 2, 0, 2)
+dump(g4, 8, 2)
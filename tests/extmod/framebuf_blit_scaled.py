@@ -0,0 +1,57 @@
+# test scaled and rotated blits
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+src = framebuf.FrameBuffer(bytearray(3 * 2), 3, 2, framebuf.PL8)
+for i in range(6):
+    src.pixel(i % 3, i // 3, i + 1)
+
+w = 10
+h = 8
+buf = bytearray(w * h)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.PL8)
+
+def printbuf():
+    print("--8<--")
+    for y in range(h):
+        print(''.join(str(buf[x + y * w]) for x in range(w)))
+    print("-->8--")
+    fbuf.fill(0)
+
+fbuf.blit_scaled(src, 1, 1, 2, 3)
+printbuf()
+# clipped, and with a key
+fbuf.blit_scaled(src, -2, 5, 3, 2, 2)
+printbuf()
+# shrinking
+big = framebuf.FrameBuffer(bytearray(8 * 4), 8, 4, framebuf.PL8)
+for x in range(8):
+    big.vline(x, 0, 4, x + 1)
+fbuf.blit_scaled(big, 0, 0, 1, 1)
+fbuf.blit_scaled(big, 0, 5, 0.5, 0.5)
+printbuf()
+try:
+    fbuf.blit_scaled(src, 0, 0, 0, 1)
+except ValueError:
+    print('ValueError')
+
+# rotate in steps of 90 degrees about the centre of a 4x2 source
+src = framebuf.FrameBuffer(bytearray(4 * 2), 4, 2, framebuf.PL8)
+for i in range(8):
+    src.pixel(i % 4, i // 4, i + 1)
+for angle in (0, 90, 180, 270):
+    fbuf.blit_rotated(src, 5, 4, angle)
+    printbuf()
+fbuf.blit_rotated(src, 5, 4, 45, 1)
+printbuf()
+
+# RGB565 to RGB565
+s16 = framebuf.FrameBuffer(bytearray(2 * 2 * 2), 2, 2, framebuf.RGB565)
+s16.fill(0xff0000)
+s16.pixel(1, 1, 0x0000ff)
+d16 = framebuf.FrameBuffer(bytearray(4 * 4 * 2), 4, 4, framebuf.RGB565)
+d16.blit_scaled(s16, 0, 0, 2, 2)
+print(d16.pixel(0, 0) == s16.pixel(0, 0), d16.pixel(3, 3) == s16.pixel(1, 1), d16.pixel(1, 2) == s16.pixel(0, 1))
@@ -0,0 +1,51 @@
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+w = 8
+h = 6
+buf = bytearray(w * h // 8)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.MONO_HLSB)
+
+def printbuf():
+    for y in range(h):
+        print(''.join('#' if fbuf.pixel(x, y) else '.' for x in range(w)))
+    print('--')
+
+# default clip covers the whole buffer
+print(fbuf.clip(2, 1, 4, 3))
+
+# primitives are limited to the clip rectangle
+fbuf.fill(1)
+printbuf()
+
+fbuf.clip()
+fbuf.fill(0)
+fbuf.clip(1, 1, 5, 4)
+fbuf.line(0, 0, 7, 5, 1)
+fbuf.hline(0, 4, 8, 1)
+printbuf()
+
+fbuf.fill(0)
+fbuf.rect(-2, -2, 6, 5, 1)
+fbuf.pixel(0, 0, 1)
+fbuf.pixel(5, 4, 1)
+printbuf()
+
+# text and blit honour the clip
+fbuf.fill(0)
+src = framebuf.FrameBuffer(bytearray(b'\xff\xff'), 4, 4, framebuf.MONO_HLSB)
+fbuf.blit(src, 3, 3)
+printbuf()
+
+# clipping is intersected with the buffer; returns the previous clip
+print(fbuf.clip(-4, 4, 100, 100))
+print(fbuf.clip(10, 10, 2, 2))
+fbuf.clip()
+fbuf.fill(0)
+fbuf.clip(10, 10, 2, 2)
+fbuf.fill(1)
+printbuf()
+print(fbuf.clip())
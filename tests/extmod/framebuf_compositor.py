@@ -0,0 +1,105 @@
+# test framebuf.Compositor against drawing whole frames
+
+try:
+    import framebuf, pyb
+
+    framebuf.Compositor
+    pyb.SCREEN
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+W = 160
+H = 128
+screen = pyb.SCREEN()
+
+# a sheet of 4 tiles of 8x8 and a map of them, 24 x 20 cells
+sheet = framebuf.FrameBuffer(bytearray(32 * 8 * 2), 32, 8, framebuf.RGB565)
+for i, col in enumerate((0x0000, 0xf800, 0x07e0, 0x001f)):
+    sheet.fill_rect(i * 8, 0, 8, 8, col)
+    sheet.pixel(i * 8 + 1, 1, 0xffff)
+cells = bytearray((x * 3 + y) % 4 for y in range(20) for x in range(24))
+tm = framebuf.TileMap(sheet, 8, 8, cells, 24)
+
+# a sprite with a transparent border, and a PL8 frame drawn through a palette
+spr_fb = framebuf.FrameBuffer(bytearray(12 * 10 * 2), 12, 10, framebuf.RGB565)
+spr_fb.fill(0x1234)
+spr_fb.fill_rect(2, 2, 8, 6, 0xffe0)
+spr = framebuf.Sprite(spr_fb, 0x1234)
+pal = framebuf.FrameBuffer(bytearray(4 * 2), 4, 1, framebuf.RGB565)
+for i, col in enumerate((0, 0xf81f, 0x07ff, 0x8410)):
+    pal.pixel(i, 0, col)
+ui = framebuf.FrameBuffer(bytearray(40 * 10), 40, 10, framebuf.PL8)
+ui.fill(0)
+ui.fill_rect(1, 1, 20, 8, 1)
+
+# the reference, drawn the way an app would without a compositor
+ref_buf = bytearray(W * H * 2)
+ref = framebuf.FrameBuffer(ref_buf, W, H, framebuf.RGB565)
+
+
+def reference(scroll, sx, sy, ui_shown):
+    ref.fill(0)
+    ref.draw_tilemap(tm, scroll[0], scroll[1])
+    ref.blit(spr, sx, sy)
+    if ui_shown:
+        ref.blit(ui, 100, 4, 0, pal)
+    screen.show(ref_buf)
+    return bytes(screen.frame())
+
+
+comp = framebuf.Compositor(screen, W, H)
+bg = comp.layer(tm, 3, 5)
+s = comp.layer(spr, 20, 30)
+u = comp.layer(ui, 100, 4, 0, pal)
+
+# the first update draws everything
+print(comp.update())
+got = bytes(screen.frame())
+print(got == reference((3, 5), 20, 30, True))
+
+# nothing changed
+print(comp.update())
+
+# moving a sprite redraws the tiles under where it was and where it is
+comp.move(s, 25, 33)
+n = comp.update()
+got = bytes(screen.frame())
+print(n, got == reference((3, 5), 25, 33, True))
+
+# partly off the screen
+comp.move(s, -5, H - 4)
+n = comp.update()
+got = bytes(screen.frame())
+print(n, got == reference((3, 5), -5, H - 4, True))
+
+# drawing on a FrameBuffer layer is picked up from its dirty box
+ui.fill_rect(30, 2, 4, 4, 2)
+n = comp.update()
+got = bytes(screen.frame())
+print(n, got == reference((3, 5), -5, H - 4, True))
+
+# hiding a layer
+comp.visible(u, False)
+n = comp.update()
+got = bytes(screen.frame())
+print(n, got == reference((3, 5), -5, H - 4, False))
+
+# scrolling the map redraws everything
+comp.move(bg, 10, 7)
+n = comp.update()
+got = bytes(screen.frame())
+print(n, got == reference((10, 7), -5, H - 4, False))
+
+# explicit damage
+comp.damage(0, 0, 9, 9)
+print(comp.update())
+
+try:
+    comp.move(3, 0, 0)
+except IndexError:
+    print("IndexError")
+try:
+    framebuf.Compositor(ref, W, H)
+except TypeError:
+    print("TypeError")
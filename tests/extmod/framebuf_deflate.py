@@ -0,0 +1,44 @@
+# test inflating compressed pixels into a framebuffer
+try:
+    import framebuf, uio
+    framebuf.FrameBuffer.load_deflated
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+# 16x8 RGB565 pixels, row y holding the native value y | y << 12
+px = b''.join(bytes([y, y * 16]) * 16 for y in range(8))
+zlib_data = b'x\xdac`\xc0\x0f\x18\x05\xf0C&\x05\xfc\x90\xd9\x00?dq\xc0\x0fY\x03\xf0C\xb6\x04\xfc\x90\xbd\x00?\x04\x00OG\x1d\xc1'
+raw_data = zlib_data[2:-4]
+gzip_data = b'\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03' + raw_data + b'\xe1O~Z\x00\x01\x00\x00'
+half_data = b'x\x9cc`\xc0\x0f\x18\x05\xf0C&\x05\xfc\x90\xd9\x00?\x04\x00\xee\xe0\x06a'
+
+buf = bytearray(256)
+fb = framebuf.FrameBuffer(buf, 16, 8, framebuf.RGB565)
+
+# zlib, raw deflate and gzip streams
+for data, wbits in ((zlib_data, 0), (raw_data, -9), (gzip_data, 25)):
+    fb.fill(0)
+    fb.dirty_reset()
+    print(fb.load_deflated(uio.BytesIO(data), wbits), buf == px, fb.dirty())
+print(hex(fb.pixel(3, 5)))
+
+# default is a zlib header
+fb.fill(0)
+print(fb.load_deflated(uio.BytesIO(zlib_data)), buf == px)
+
+# a short stream fills only the start of the buffer
+fb.fill(0)
+print(fb.load_deflated(uio.BytesIO(half_data)), buf[:128] == px[:128], buf[128:] == bytes(128))
+
+# a longer stream stops at the end of the buffer
+small = framebuf.FrameBuffer(bytearray(32), 16, 1, framebuf.RGB565)
+print(small.load_deflated(uio.BytesIO(zlib_data)))
+
+# errors
+for data in (b'', b'xx', zlib_data[:10], zlib_data[:2] + b'\xff' + zlib_data[3:]):
+    fb.fill(0)
+    try:
+        fb.load_deflated(uio.BytesIO(data))
+    except ValueError as er:
+        print('ValueError', er)
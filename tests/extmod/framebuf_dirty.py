@@ -0,0 +1,50 @@
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+w = 16
+h = 10
+buf = bytearray(w * h)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.PL8)
+
+# a new framebuffer is all dirty
+print(fbuf.dirty())
+fbuf.dirty_reset()
+print(fbuf.dirty())
+
+# each primitive grows the box
+fbuf.pixel(3, 4, 1)
+print(fbuf.dirty())
+fbuf.hline(5, 2, 4, 1)
+print(fbuf.dirty())
+fbuf.dirty_reset()
+fbuf.line(10, 9, 12, 6, 1)
+print(fbuf.dirty())
+fbuf.dirty_reset()
+fbuf.fill_rect(-5, -5, 8, 7, 1)
+print(fbuf.dirty())
+fbuf.dirty_reset()
+fbuf.text("A", 14, 0, 1)
+print(fbuf.dirty())
+fbuf.dirty_reset()
+src = framebuf.FrameBuffer(bytearray(4), 2, 2, framebuf.PL8)
+fbuf.blit(src, 7, 8)
+print(fbuf.dirty())
+fbuf.dirty_reset()
+fbuf.ellipse(8, 5, 2, 1, 1, True)
+print(fbuf.dirty())
+
+# reading and fully clipped drawing leave it alone
+fbuf.dirty_reset()
+fbuf.pixel(1, 1)
+fbuf.rect(20, 20, 4, 4, 1)
+fbuf.clip(0, 0, 4, 4)
+fbuf.hline(5, 5, 4, 1)
+print(fbuf.dirty())
+fbuf.clip()
+
+# scrolling touches everything
+fbuf.scroll(1, 0)
+print(fbuf.dirty())
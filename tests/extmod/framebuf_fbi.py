@@ -0,0 +1,61 @@
+# test native .fbi images
+try:
+    import framebuf, uio, ustruct
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+from array import array
+
+def fbi(fmt, w, h, stride, pixels, palette=()):
+    head = b'FBI\x01' + ustruct.pack('<BBHHHHH', fmt, 0, w, h, stride, len(palette), 0)
+    return head + b''.join(ustruct.pack('<H', c) for c in palette) + pixels
+
+def show(fb, w, h):
+    for y in range(h):
+        print(' '.join('%04x' % fb.pixel(x, y) for x in range(w)))
+    print('--')
+
+# RGB565 pixels are stored as in the framebuffer
+rgb = fbi(framebuf.RGB565, 3, 2, 4, bytes(range(16)))
+fb = framebuf.load(uio.BytesIO(rgb))
+show(fb, 3, 2)
+print(bytes(fb))
+
+# PL8 images carry a palette
+pal8 = fbi(framebuf.PL8, 2, 2, 2, bytes((0, 1, 2, 1)), (0xf800, 0x07e0, 0x001f))
+pal = array('H', [0] * 4)
+fb = framebuf.load(uio.BytesIO(pal8), pal)
+show(fb, 2, 2)
+print(list(pal))
+
+# drawn into a framebuffer of the same format, clipped, or through the palette
+W = 5
+H = 3
+dest = framebuf.FrameBuffer(bytearray(W * H * 2), W, H, framebuf.RGB565)
+dest.loadfbi(uio.BytesIO(rgb), 1, 1)
+show(dest, W, H)
+dest.fill(0)
+dest.loadfbi(uio.BytesIO(rgb), -1, 0)
+show(dest, W, H)
+dest.fill(0)
+dest.dirty_reset()
+dest.loadfbi(uio.BytesIO(pal8), 3, 2)
+show(dest, W, H)
+print(dest.dirty())
+
+gs4 = fbi(framebuf.GS4_HMSB, 3, 1, 4, bytes((0x0f, 0x80)), [(i * 2) << 11 for i in range(16)])
+dest.fill(0)
+dest.loadfbi(uio.BytesIO(gs4))
+show(dest, W, H)
+
+pl = framebuf.FrameBuffer(bytearray(4 * 2), 4, 2, framebuf.PL8)
+pl.loadfbi(uio.BytesIO(pal8), 1, 0)
+print(list(bytes(pl)))
+
+# errors
+for data in (b'FBI\x02' + rgb[4:], rgb[:4] + b'\x00' + rgb[5:], rgb[:20]):
+    try:
+        framebuf.load(uio.BytesIO(data))
+    except ValueError as e:
+        print('ValueError', e)
@@ -0,0 +1,177 @@
+# test stepping through GIF animations a frame at a time
+try:
+    import framebuf, uio, ustruct
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+def lzw(indices, min_size):
+    clear = 1 << min_size
+    size = min_size + 1
+    table = {bytes((i,)): i for i in range(clear)}
+    next_code = clear + 2
+    out = bytearray()
+    acc = 0
+    nbits = 0
+    codes = [(clear, size)]
+    w = b''
+    for k in indices:
+        wk = w + bytes((k,))
+        if wk in table:
+            w = wk
+            continue
+        codes.append((table[w], size))
+        if next_code < 4096:
+            table[wk] = next_code
+            next_code += 1
+            if next_code > (1 << size) and size < 12:
+                size += 1
+        w = bytes((k,))
+    codes.append((table[w], size))
+    codes.append((clear + 1, size))
+    for code, n in codes:
+        acc |= code << nbits
+        nbits += n
+        while nbits >= 8:
+            out.append(acc & 0xff)
+            acc >>= 8
+            nbits -= 8
+    if nbits:
+        out.append(acc)
+    # split into sub-blocks
+    data = bytearray((min_size,))
+    for i in range(0, len(out), 255):
+        chunk = out[i:i + 255]
+        data.append(len(chunk))
+        data += chunk
+    data.append(0)
+    return data
+
+def colours(n):
+    t = bytearray()
+    for i in range(n):
+        t += bytes((i * 0x40, 0, 0xff - i * 0x40))
+    return t
+
+def frame(x, y, w, h, rows, delay=0, trans=None, disposal=0, local=None, interlace=False):
+    flag = 1 if trans is not None else 0
+    d = b'!\xf9\x04' + ustruct.pack('<BHBB', flag | disposal << 2, delay, trans or 0, 0)
+    iflag = 0x40 if interlace else 0
+    if local:
+        iflag |= 0x80 | 1
+    d += b',' + ustruct.pack('<HHHHB', x, y, w, h, iflag)
+    if local:
+        d += local
+    order = list(range(h))
+    if interlace:
+        order = list(range(0, h, 8)) + list(range(4, h, 8)) + list(range(2, h, 4)) + list(range(1, h, 2))
+    pix = []
+    for r in order:
+        pix += rows[r]
+    return d + lzw(pix, 2)
+
+def gif(w, h, frames):
+    d = b'GIF89a' + ustruct.pack('<HHBBB', w, h, 0x80 | 1, 0, 0) + colours(4)
+    return d + b''.join(frames) + b';'
+
+W = 6
+H = 5
+buf = bytearray(W * H)
+fbuf = framebuf.FrameBuffer(buf, W, H, framebuf.PL8)
+fbuf.fill(9)
+
+def printbuf():
+    for y in range(H):
+        print(''.join(str(buf[x + y * W]) for x in range(W)))
+    print('--')
+
+full = [[(x + y) % 4 for x in range(5)] for y in range(4)]
+data = gif(5, 4, [
+    frame(0, 0, 5, 4, full, delay=20),
+    frame(1, 1, 3, 2, [[3, 3, 0], [0, 3, 3]], trans=0, disposal=2),
+    frame(3, 0, 2, 2, [[1, 2], [2, 1]], delay=5, local=bytes((0, 0, 8, 0, 0, 9, 0, 0, 7, 0, 0, 6))),
+    frame(0, 0, 5, 5, [[y % 4] * 5 for y in range(5)], interlace=True),
+])
+
+g = framebuf.GIF(uio.BytesIO(data))
+print(g.size())
+while True:
+    delay = g.next_frame(fbuf, 1, 0)
+    print(delay)
+    if delay is None:
+        break
+    printbuf()
+print(g.next_frame(fbuf))
+
+# a highly compressible frame exercises codes longer than the minimum size
+big = [[(x // 7) % 4 for x in range(40)] for y in range(30)]
+BW = 40
+bbuf = bytearray(BW * 30)
+fb2 = framebuf.FrameBuffer(bbuf, BW, 30, framebuf.PL8)
+g = framebuf.GIF(uio.BytesIO(gif(40, 30, [frame(0, 0, 40, 30, big)])))
+print(g.next_frame(fb2), g.next_frame(fb2))
+print(all(bbuf[x + y * BW] == big[y][x] for y in range(30) for x in range(40)))
+
+# a noisy frame fills the whole code table
+seed = 1
+noise = []
+for y in range(64):
+    r = []
+    for x in range(128):
+        seed = (seed * 1103515245 + 12345) & 0x7fffffff
+        r.append((seed >> 16) & 3)
+    noise.append(r)
+nbuf = bytearray(128 * 64)
+fb3 = framebuf.FrameBuffer(nbuf, 128, 64, framebuf.PL8)
+g = framebuf.GIF(uio.BytesIO(gif(128, 64, [frame(0, 0, 128, 64, noise)])))
+print(g.next_frame(fb3))
+print(all(nbuf[x + y * 128] == noise[y][x] for y in range(64) for x in range(128)))
+
+# RGB565 framebuffers are written through the colour table directly
+rbuf = bytearray(W * H * 2)
+fb4 = framebuf.FrameBuffer(rbuf, W, H, framebuf.RGB565)
+g = framebuf.GIF(uio.BytesIO(data))
+g.next_frame(fb4)
+g.next_frame(fb4)
+for y in range(H):
+    print(' '.join('%04x' % fb4.pixel(x, y) for x in range(W)))
+
+# loadgif plays the whole animation, calling back after each frame
+count = [0]
+def cb():
+    count[0] += 1
+fbuf.loadgif(uio.BytesIO(gif(2, 1, [frame(0, 0, 2, 1, [[1, 2]], delay=1)] * 3)), cb)
+print(count[0])
+
+# errors
+try:
+    framebuf.GIF(uio.BytesIO(b'GIF87b' + bytes(7)))
+except ValueError as e:
+    print('ValueError', e)
+g = framebuf.GIF(uio.BytesIO(data[:40]))
+try:
+    while g.next_frame(fbuf) is not None:
+        pass
+except ValueError as e:
+    print('ValueError', e)
+print(g.next_frame(fbuf))
+
+# PL8 framebuffers hold the colour indices, with the colours in palette()
+from array import array
+g = framebuf.GIF(uio.BytesIO(data))
+pal = array('H', [0xaaaa] * 6)
+print(g.palette(pal), ['%04x' % c for c in pal])
+
+# the LZW tables can live in a buffer supplied by the caller
+scratch = bytearray(framebuf.GIF.SCRATCH_SIZE)
+for i in range(2):
+    fbuf.fill(9)
+    g = framebuf.GIF(uio.BytesIO(data), scratch)
+    print(g.next_frame(fbuf), g.size())
+    g.close()
+    print(g.next_frame(fbuf), g.size())
+printbuf()
+try:
+    framebuf.GIF(uio.BytesIO(data), bytearray(16))
+except ValueError as e:
+    print('ValueError', e)
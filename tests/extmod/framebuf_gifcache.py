@@ -0,0 +1,97 @@
+# test playing GIF animations from frames decoded once
+try:
+    import framebuf, uio, ustruct
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+def lzw(indices, min_size):
+    # a clear code before every index keeps the codes a fixed size
+    clear = 1 << min_size
+    size = min_size + 1
+    out = bytearray()
+    acc = 0
+    nbits = 0
+    for code in [c for k in indices for c in (clear, k)] + [clear + 1]:
+        acc |= code << nbits
+        nbits += size
+        while nbits >= 8:
+            out.append(acc & 0xff)
+            acc >>= 8
+            nbits -= 8
+    if nbits:
+        out.append(acc)
+    data = bytearray((min_size,))
+    for i in range(0, len(out), 255):
+        chunk = out[i:i + 255]
+        data.append(len(chunk))
+        data += chunk
+    data.append(0)
+    return data
+
+def frame(x, y, w, h, rows, delay=0, trans=None):
+    flag = 1 if trans is not None else 0
+    d = b'!\xf9\x04' + ustruct.pack('<BHBB', flag, delay, trans or 0, 0)
+    d += b',' + ustruct.pack('<HHHHB', x, y, w, h, 0)
+    pix = []
+    for r in rows:
+        pix += r
+    return d + lzw(pix, 2)
+
+def gif(w, h, frames):
+    d = b'GIF89a' + ustruct.pack('<HHBBB', w, h, 0x80 | 1, 0, 0)
+    d += bytes((0, 0, 0, 0xff, 0, 0, 0, 0xff, 0, 0, 0, 0xff))
+    return d + b''.join(frames) + b';'
+
+# a spinner: a 4x3 animation in which one pixel moves each frame
+data = gif(4, 3, [
+    frame(0, 0, 4, 3, [[0, 0, 0, 0], [0, 1, 0, 0], [0, 0, 0, 0]], delay=5),
+    frame(1, 1, 2, 1, [[0, 2]], delay=6),
+    frame(2, 1, 1, 2, [[0], [3]], delay=7),
+    frame(0, 0, 1, 1, [[1]], trans=1),
+])
+
+W = 6
+H = 4
+buf = bytearray(W * H)
+fbuf = framebuf.FrameBuffer(buf, W, H, framebuf.PL8)
+fbuf.fill(9)
+
+def printbuf():
+    for y in range(H):
+        print(''.join(str(buf[x + y * W]) for x in range(W)))
+    print('--')
+
+c = framebuf.GIFCache(uio.BytesIO(data), framebuf.PL8)
+print(c.size(), c.info())
+
+# twice round the loop, then from the start again
+for i in range(6):
+    fbuf.dirty_reset()
+    print(c.next_frame(fbuf, 1, 1), fbuf.dirty())
+    printbuf()
+c.rewind()
+print(c.next_frame(fbuf, 1, 1), fbuf.dirty())
+
+# the same frames as drawn by GIF, in RGB565
+g = framebuf.GIF(uio.BytesIO(data))
+c = framebuf.GIFCache(uio.BytesIO(data))
+b1 = bytearray(4 * 3 * 2)
+b2 = bytearray(4 * 3 * 2)
+f1 = framebuf.FrameBuffer(b1, 4, 3, framebuf.RGB565)
+f2 = framebuf.FrameBuffer(b2, 4, 3, framebuf.RGB565)
+while True:
+    d = g.next_frame(f1)
+    if d is None:
+        break
+    print(d == c.next_frame(f2), b1 == b2)
+
+# errors
+try:
+    framebuf.GIFCache(uio.BytesIO(data), framebuf.GS4_HMSB)
+except ValueError as er:
+    print('ValueError', er)
+try:
+    framebuf.GIFCache(uio.BytesIO(gif(4, 3, [])))
+except ValueError as er:
+    print('ValueError', er)
@@ -0,0 +1,238 @@
+# test decoding baseline JPEG images
+try:
+    import framebuf, uio, ustruct, math
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+ZIGZAG = [
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+]
+
+# huffman tables: DC categories all 4 bits; AC symbols 7 bits for the
+# first 64 and 10 bits for the rest, so both short and long codes are used
+DC_COUNTS = [0, 0, 0, 12] + [0] * 12
+DC_VALS = list(range(12))
+AC_VALS = [0x00, 0xf0] + [r << 4 | s for r in range(16) for s in range(1, 11)]
+AC_COUNTS = [0] * 6 + [64, 0, 0, 98] + [0] * 6
+
+def codes(counts, vals):
+    table = {}
+    code = 0
+    k = 0
+    for l in range(1, 17):
+        for i in range(counts[l - 1]):
+            table[vals[k]] = (code, l)
+            code += 1
+            k += 1
+        code <<= 1
+    return table
+
+DC_CODES = codes(DC_COUNTS, DC_VALS)
+AC_CODES = codes(AC_COUNTS, AC_VALS)
+COS = [[math.cos((2 * x + 1) * u * math.pi / 16) for x in range(8)] for u in range(8)]
+
+class Bits:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.n = 0
+
+    def put(self, v, n):
+        self.acc = self.acc << n | v
+        self.n += n
+        while self.n >= 8:
+            self.n -= 8
+            b = (self.acc >> self.n) & 0xff
+            self.out.append(b)
+            if b == 0xff:
+                self.out.append(0)
+
+    def flush(self):
+        if self.n:
+            self.put((1 << (8 - self.n)) - 1, 8 - self.n)
+
+def category(v):
+    v = abs(v)
+    n = 0
+    while v:
+        n += 1
+        v >>= 1
+    return n
+
+def put_value(bits, v, n):
+    if v < 0:
+        v += (1 << n) - 1
+    bits.put(v, n)
+
+def encode_block(bits, samples, q, pred):
+    coef = [0] * 64
+    for v in range(8):
+        for u in range(8):
+            s = 0.0
+            for y in range(8):
+                row = samples[y]
+                cy = COS[v][y]
+                for x in range(8):
+                    s += (row[x] - 128) * COS[u][x] * cy
+            cu = 0.7071067811865476 if u == 0 else 1.0
+            cv = 0.7071067811865476 if v == 0 else 1.0
+            coef[v * 8 + u] = int(math.floor(s * cu * cv / 4 / q + 0.5))
+    diff = coef[0] - pred
+    n = category(diff)
+    bits.put(*DC_CODES[n])
+    if n:
+        put_value(bits, diff, n)
+    run = 0
+    for k in range(1, 64):
+        c = coef[ZIGZAG[k]]
+        if c == 0:
+            run += 1
+            continue
+        while run > 15:
+            bits.put(*AC_CODES[0xf0])
+            run -= 16
+        n = category(c)
+        bits.put(*AC_CODES[run << 4 | n])
+        put_value(bits, c, n)
+        run = 0
+    if run:
+        bits.put(*AC_CODES[0])
+    return coef[0]
+
+def segment(m, data):
+    return b'\xff' + bytes((m,)) + ustruct.pack('>H', len(data) + 2) + data
+
+def jpeg(w, h, pixel, sampling=(1, 1), grey=False, q=1, restart=0):
+    # pixel(x, y) gives (r, g, b); each component gets its own scale of YCbCr
+    ncomp = 1 if grey else 3
+    hmax, vmax = sampling if not grey else (1, 1)
+    d = b'\xff\xd8' + segment(0xe0, b'JFIF\x00\x01\x01\x00\x00\x01\x00\x01\x00\x00')
+    d += segment(0xdb, bytes((0,)) + bytes((q,)) * 64)
+    sof = b'\x08' + ustruct.pack('>HHB', h, w, ncomp)
+    sof += bytes((1, hmax << 4 | vmax, 0))
+    if not grey:
+        sof += b'\x02\x11\x00\x03\x11\x00'
+    d += segment(0xc0, sof)
+    d += segment(0xc4, b'\x00' + bytes(DC_COUNTS) + bytes(DC_VALS))
+    d += segment(0xc4, b'\x10' + bytes(AC_COUNTS) + bytes(AC_VALS))
+    if restart:
+        d += segment(0xdd, ustruct.pack('>H', restart))
+    sos = bytes((ncomp,)) + bytes((1, 0))
+    if not grey:
+        sos += b'\x02\x00\x03\x00'
+    d += segment(0xda, sos + b'\x00\x3f\x00')
+
+    def ycc(x, y):
+        r, g, b = pixel(min(x, w - 1), min(y, h - 1))
+        Y = 0.299 * r + 0.587 * g + 0.114 * b
+        if grey:
+            return (Y,)
+        return (Y, 128 - 0.168736 * r - 0.331264 * g + 0.5 * b, 128 + 0.5 * r - 0.418688 * g - 0.081312 * b)
+
+    bits = Bits()
+    preds = [0, 0, 0]
+    mw = 8 * hmax
+    mh = 8 * vmax
+    nmcu = 0
+    for my in range(0, h, mh):
+        for mx in range(0, w, mw):
+            if restart and nmcu and nmcu % restart == 0:
+                bits.flush()
+                bits.out += bytes((0xff, 0xd0 + (nmcu // restart - 1) % 8))
+                preds = [0, 0, 0]
+            nmcu += 1
+            for by in range(vmax):
+                for bx in range(hmax):
+                    blk = [[ycc(mx + bx * 8 + x, my + by * 8 + y)[0] for x in range(8)] for y in range(8)]
+                    preds[0] = encode_block(bits, blk, q, preds[0])
+            for c in (1, 2)[:ncomp - 1]:
+                # chroma averaged over the MCU pixels each sample covers
+                blk = []
+                for y in range(8):
+                    row = []
+                    for x in range(8):
+                        s = 0
+                        for sy in range(vmax):
+                            for sx in range(hmax):
+                                s += ycc(mx + x * hmax + sx, my + y * vmax + sy)[c]
+                        row.append(s / (hmax * vmax))
+                    blk.append(row)
+                preds[c] = encode_block(bits, blk, q, preds[c])
+    bits.flush()
+    return d + bits.out + b'\xff\xd9'
+
+def rgb(c):
+    c = (c >> 8) | (c & 0xff) << 8
+    return (c >> 11) << 3, ((c >> 5) & 0x3f) << 2, (c & 0x1f) << 3
+
+def max_error(fb, w, h, pixel, ox=0, oy=0):
+    err = 0
+    for y in range(h):
+        for x in range(w):
+            got = rgb(fb.pixel(ox + x, oy + y))
+            want = pixel(x, y)
+            for i in range(3):
+                err = max(err, abs(got[i] - want[i]))
+    return err
+
+def smooth(x, y):
+    return (x * 12, 64 + y * 10, 200 - x * 6 - y * 4)
+
+W = 20
+H = 18
+buf = bytearray(W * H * 2)
+fb = framebuf.FrameBuffer(buf, W, H, framebuf.RGB565)
+
+# 4:4:4, 4:2:2 and 4:2:0 colour, and greyscale, with sizes that are not a
+# whole number of MCUs
+for sampling in ((1, 1), (2, 1), (2, 2)):
+    fb.fill(0)
+    # subsampled chroma is repeated, not interpolated
+    print(sampling, fb.loadjpeg(uio.BytesIO(jpeg(W, H, smooth, sampling))), max_error(fb, W, H, smooth) <= 20)
+grey = lambda x, y: (x * 12, x * 12, x * 12)
+fb.fill(0)
+print(fb.loadjpeg(uio.BytesIO(jpeg(W, H, grey, grey=True))), max_error(fb, W, H, grey) <= 8)
+
+# flat colours come out exactly
+flat = lambda x, y: (255, 0, 0) if x < 8 else (0, 0, 255)
+fb.fill(0)
+fb.loadjpeg(uio.BytesIO(jpeg(16, 8, flat, q=4)))
+print(hex(fb.pixel(0, 0)), hex(fb.pixel(15, 7)))
+
+# restart intervals, and coarse quantisation giving long runs of zeros
+fb.fill(0)
+fb.loadjpeg(uio.BytesIO(jpeg(W, H, smooth, (2, 2), restart=1)))
+print(max_error(fb, W, H, smooth) <= 20)
+fb.fill(0)
+fb.loadjpeg(uio.BytesIO(jpeg(W, H, grey, grey=True, q=16, restart=3)))
+print(max_error(fb, W, H, grey) <= 24)
+
+# clipped, placed off the edge, with dirty marking only what was drawn
+data = jpeg(8, 8, smooth)
+fb.fill(0)
+fb.dirty_reset()
+fb.loadjpeg(uio.BytesIO(data), 15, -3)
+print(fb.dirty(), fb.pixel(14, 0), max_error(fb, 5, 5, lambda x, y: smooth(x, y + 3), 15, 0) <= 12)
+fb.clip(2, 2, 4, 4)
+fb.fill(0)
+fb.dirty_reset()
+fb.loadjpeg(uio.BytesIO(data))
+print(fb.dirty(), fb.pixel(1, 1), fb.pixel(6, 6), fb.pixel(2, 2) != 0)
+fb.clip()
+
+# other framebuffer formats take RGB888 colours
+gbuf = bytearray(8 * 8 // 2)
+gfb = framebuf.FrameBuffer(gbuf, 8, 8, framebuf.GS4_HMSB)
+gfb.loadjpeg(uio.BytesIO(jpeg(8, 8, lambda x, y: (255, 255, 255))))
+print(gbuf[:4])
+
+# errors
+for d in (b'', b'GIF89a', data[:40], jpeg(8, 8, smooth).replace(b'\xff\xc0', b'\xff\xc2')):
+    try:
+        fb.loadjpeg(uio.BytesIO(d))
+    except ValueError as er:
+        print('ValueError', er)
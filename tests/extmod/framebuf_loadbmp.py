@@ -0,0 +1,123 @@
+# test decoding BMP images from a stream
+try:
+    import framebuf, uio, ustruct
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+def bmp(w, h, bpp, pixels, top_down=False):
+    # pixels is a list of rows of (r, g, b), top row first
+    row_len = (w * bpp + 31) // 32 * 4
+    rows = []
+    for row in pixels:
+        b = bytearray()
+        for r, g, bl in row:
+            b += bytes((bl, g, r))
+            if bpp == 32:
+                b.append(0xff)
+        b += bytes(row_len - len(b))
+        rows.append(b)
+    if not top_down:
+        rows.reverse()
+    data = b''.join(bytes(r) for r in rows)
+    off = 14 + 40 + 6
+    head = ustruct.pack('<HIHHI', 0x4d42, off + len(data), 0, 0, off)
+    height = -h if top_down else h
+    info = ustruct.pack('<IiiHHIIiiII', 40, w, height, 1, bpp, 0, len(data), 0, 0, 0, 0)
+    return head + info + bytes(6) + data
+
+RED = (0xff, 0, 0)
+GRN = (0, 0xff, 0)
+BLU = (0, 0, 0xff)
+WHT = (0xff, 0xff, 0xff)
+img = [[RED, GRN, BLU], [WHT, RED, GRN]]
+
+w = 5
+h = 4
+buf = bytearray(w * h * 2)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.RGB565)
+
+def printbuf():
+    for y in range(h):
+        print(' '.join('%04x' % fbuf.pixel(x, y) for x in range(w)))
+    print('--')
+    fbuf.fill(0)
+
+for bpp in (24, 32):
+    for top_down in (False, True):
+        fbuf.loadbmp(uio.BytesIO(bmp(3, 2, bpp, img, top_down)), 1, 1)
+        printbuf()
+
+# clipped at the edges and by the clip rectangle
+fbuf.loadbmp(uio.BytesIO(bmp(3, 2, 24, img)), -1, 3)
+printbuf()
+fbuf.clip(0, 0, 2, 4)
+fbuf.dirty_reset()
+fbuf.loadbmp(uio.BytesIO(bmp(3, 2, 24, img)))
+print(fbuf.dirty())
+fbuf.clip()
+printbuf()
+
+# other formats go through the colour conversion of each format
+mono = framebuf.FrameBuffer(bytearray(4), 4, 4, framebuf.MONO_HLSB)
+mono.loadbmp(uio.BytesIO(bmp(3, 2, 24, img)))
+print([[mono.pixel(x, y) for x in range(4)] for y in range(2)])
+
+# errors
+for data in (b'XX' + bmp(1, 1, 24, [[RED]])[2:], bmp(1, 1, 24, [[RED]])[:-2], bmp(1, 1, 24, [[RED]])[:20]):
+    try:
+        fbuf.loadbmp(uio.BytesIO(data))
+    except ValueError as e:
+        print('ValueError', e)
+bad = bytearray(bmp(1, 1, 24, [[RED]]))
+bad[28] = 4
+try:
+    fbuf.loadbmp(uio.BytesIO(bad))
+except ValueError as e:
+    print('ValueError', e)
+
+# 16 bit images, with and without 5-6-5 bitfields
+def bmp16(w, h, pixels, masks=None):
+    row_len = (w * 16 + 31) // 32 * 4
+    data = bytearray()
+    for row in reversed(pixels):
+        b = bytearray()
+        for v in row:
+            b += ustruct.pack('<H', v)
+        data += b + bytes(row_len - len(b))
+    comp = 3 if masks else 0
+    extra = ustruct.pack('<III', *masks) if masks else b''
+    off = 14 + 40 + len(extra)
+    head = ustruct.pack('<HIHHI', 0x4d42, off + len(data), 0, 0, off)
+    info = ustruct.pack('<IiiHHIIiiII', 40, w, h, 1, 16, comp, len(data), 0, 0, 0, 0)
+    return head + info + extra + data
+
+fbuf.loadbmp(uio.BytesIO(bmp16(3, 1, [[0xf800, 0x07e0, 0x1234]], (0xf800, 0x07e0, 0x001f))))
+fbuf.loadbmp(uio.BytesIO(bmp16(3, 1, [[0x7c00, 0x03e0, 0x001f]])), 0, 1)
+printbuf()
+
+# 8 bit paletted images keep their indices in a PL8 framebuffer
+def bmp8(w, h, pixels, colors):
+    row_len = (w + 3) // 4 * 4
+    data = bytearray()
+    for row in reversed(pixels):
+        data += bytes(row) + bytes(row_len - len(row))
+    pal = bytearray()
+    for r, g, b in colors:
+        pal += bytes((b, g, r, 0))
+    off = 14 + 40 + len(pal)
+    head = ustruct.pack('<HIHHI', 0x4d42, off + len(data), 0, 0, off)
+    info = ustruct.pack('<IiiHHIIiiII', 40, w, h, 1, 8, 0, len(data), 0, 0, len(colors), 0)
+    return head + info + pal + data
+
+from array import array
+img8 = bmp8(3, 2, [[0, 1, 2], [2, 1, 0]], [RED, GRN, WHT])
+pl8buf = bytearray(4 * 2)
+pl8 = framebuf.FrameBuffer(pl8buf, 4, 2, framebuf.PL8)
+pal = array('H', [0xaaaa] * 4)
+print(pl8.loadbmp(uio.BytesIO(img8), 1, 0, pal))
+print(list(pl8buf), ['%04x' % c for c in pal])
+
+# and are expanded through the palette in other formats
+fbuf.loadbmp(uio.BytesIO(img8))
+printbuf()
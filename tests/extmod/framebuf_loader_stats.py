@@ -0,0 +1,52 @@
+# test the statistics gathered by the image loaders
+try:
+    import framebuf, uio, ustruct
+    framebuf.loader_stats
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+def bmp(w, h, pixels):
+    # 24 bit, pixels is a list of rows of (r, g, b), top row first
+    row_len = (w * 24 + 31) // 32 * 4
+    data = b''
+    for row in reversed(pixels):
+        b = b''.join(bytes((bl, g, r)) for r, g, bl in row)
+        data += b + bytes(row_len - len(b))
+    off = 14 + 40
+    head = ustruct.pack('<HIHHI', 0x4d42, off + len(data), 0, 0, off)
+    info = ustruct.pack('<IiiHHIIiiII', 40, w, h, 1, 24, 0, len(data), 0, 0, 0, 0)
+    return head + info + data
+
+def fbi(w, h, pixels):
+    return b'FBI\x01' + ustruct.pack('<BBHHHHH', framebuf.RGB565, 0, w, h, w, 0, 0) + pixels
+
+def check(stats):
+    # byte and pixel counts, and whether every time is a whole number of us
+    return stats[:2], all(isinstance(t, int) and t >= 0 for t in stats[2:])
+
+buf = bytearray(8 * 4 * 2)
+fb = framebuf.FrameBuffer(buf, 8, 4, framebuf.RGB565)
+data = bmp(3, 2, [[(255, 0, 0)] * 3] * 2)
+
+# nothing is timed until enabled
+fb.loadbmp(uio.BytesIO(data))
+print(framebuf.loader_stats()[2:])
+
+framebuf.loader_stats(True)
+fb.loadbmp(uio.BytesIO(data))
+print(len(data), check(framebuf.loader_stats()))
+
+# totals add up over several loads, and are cleared when read
+fb.loadbmp(uio.BytesIO(data))
+fb.loadfbi(uio.BytesIO(fbi(2, 2, bytes(8))), 1, 1)
+print(check(framebuf.loader_stats()))
+print(framebuf.loader_stats())
+
+# only the pixels drawn inside the clip rectangle count
+fb.loadbmp(uio.BytesIO(data), 6, 3)
+print(check(framebuf.loader_stats()))
+
+framebuf.loader_stats(False)
+fb.loadbmp(uio.BytesIO(data))
+print(framebuf.loader_stats()[2:])
@@ -0,0 +1,62 @@
+# test polygons and the shapes sharing the scanline filler
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+from array import array
+
+w = 16
+h = 12
+buf = bytearray(w * h)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.PL8)
+
+def printbuf():
+    print("--8<--")
+    for y in range(h):
+        print(''.join('#' if buf[x + y * w] else '.' for x in range(w)))
+    print("-->8--")
+    fbuf.fill(0)
+
+# concave polygon, outline and filled
+arrow = array('h', [0, 4, 6, 0, 6, 2, 12, 2, 12, 6, 6, 6, 6, 8])
+fbuf.poly(1, 1, arrow, 1)
+printbuf()
+fbuf.poly(1, 1, arrow, 1, True)
+printbuf()
+
+# clipped, and a polygon with a hole by the even-odd rule
+fbuf.poly(-4, 6, array('b', [0, 0, 10, -8, 24, 10]), 1, 1)
+printbuf()
+fbuf.poly(0, 0, array('h', [1, 1, 14, 1, 14, 10, 1, 10, 1, 1, 4, 4, 4, 7, 11, 7, 11, 4, 4, 4]), 1, 1)
+printbuf()
+
+# degenerate polygons
+fbuf.poly(0, 0, array('h', [3, 3]), 1, 1)
+fbuf.poly(0, 0, array('h', [5, 5, 10, 5]), 1, 1)
+fbuf.poly(0, 0, array('h'), 1, 1)
+printbuf()
+
+# ellipses
+fbuf.ellipse(7, 5, 6, 4, 1)
+printbuf()
+fbuf.ellipse(7, 5, 6, 4, 1, 1)
+printbuf()
+fbuf.ellipse(2, 2, 3, 0, 1)
+fbuf.ellipse(10, 8, 0, 3, 1)
+fbuf.ellipse(15, 0, 5, 5, 1, 1)
+printbuf()
+
+# rounded rectangles
+fbuf.round_rect(1, 1, 14, 10, 3, 1)
+printbuf()
+fbuf.round_rect(1, 1, 14, 10, 3, 1, 1)
+printbuf()
+fbuf.round_rect(-2, 6, 8, 8, 10, 1, 1)
+fbuf.round_rect(10, 2, 4, 3, 0, 1)
+printbuf()
+
+# filled triangle uses the same filler
+fbuf.traingle(1, 1, 14, 4, 5, 11, 1, 1)
+printbuf()
@@ -0,0 +1,35 @@
+# test RGB565 fills against pixel-by-pixel drawing, at all alignments
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+w = 13
+h = 4
+buf = bytearray(w * h * 2)
+ref = bytearray(w * h * 2)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.RGB565)
+fref = framebuf.FrameBuffer(ref, w, h, framebuf.RGB565)
+
+def check(x, y, fw, fh, col):
+    fbuf.fill(0)
+    fref.fill(0)
+    fbuf.fill_rect(x, y, fw, fh, col)
+    for yy in range(max(y, 0), min(y + fh, h)):
+        for xx in range(max(x, 0), min(x + fw, w)):
+            fref.pixel(xx, yy, col)
+    return buf == ref
+
+ok = True
+for x in range(-1, 4):
+    for fw in range(0, 12):
+        ok = ok and check(x, 1, fw, 2, 0x123456)
+print(ok)
+
+# full-width rectangle and whole buffer
+print(check(0, 1, w, 3, 0xff8000))
+fbuf.fill(0xffffff)
+print(buf == b'\xff' * len(buf))
+fbuf.fill(0xf800)
+print(fbuf.pixel(0, 0) == fbuf.pixel(w - 1, h - 1), fbuf.pixel(5, 2) != 0)
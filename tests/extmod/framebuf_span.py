@@ -0,0 +1,50 @@
+# test shapes that are drawn as spans: lines, circles and triangles
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+w = 16
+h = 12
+buf = bytearray(w * h)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.PL8)
+
+def printbuf():
+    print("--8<--")
+    for y in range(h):
+        print(''.join('#' if buf[x + y * w] else '.' for x in range(w)))
+    print("-->8--")
+    fbuf.fill(0)
+
+# lines, including ones clipped at the edges
+fbuf.line(0, 0, 15, 5, 1)
+fbuf.line(2, 11, 5, 0, 1)
+printbuf()
+fbuf.line(-5, -3, 20, 14, 1)
+fbuf.line(20, 3, -20, 3, 1)
+fbuf.line(8, -4, 8, 40, 1)
+printbuf()
+
+# circle outline and filled, and clipped
+fbuf.circle(7, 5, 4, 1)
+printbuf()
+fbuf.circle(7, 5, 4, 1, 1)
+printbuf()
+fbuf.circle(0, 0, 5, 1)
+fbuf.circle(15, 11, 3, 1, 1)
+printbuf()
+
+# triangle outline and filled, and clipped
+fbuf.traingle(1, 1, 14, 4, 5, 11, 1)
+printbuf()
+fbuf.traingle(1, 1, 14, 4, 5, 11, 1, 1)
+printbuf()
+fbuf.traingle(-4, 2, 20, 6, 3, 30, 1, 1)
+printbuf()
+
+# hline and vline
+fbuf.hline(-3, 2, 10, 1)
+fbuf.vline(4, -2, 30, 1)
+fbuf.hline(0, 20, 10, 1)
+printbuf()
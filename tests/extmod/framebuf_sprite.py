@@ -0,0 +1,55 @@
+# test run-length encoded sprites against keyed blits
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+def make(w, h, fmt):
+    bpp = 2 if fmt == framebuf.RGB565 else 1
+    return framebuf.FrameBuffer(bytearray(w * h * bpp), w, h, fmt)
+
+# a mostly transparent 6x5 shape
+shape = (
+    "..##..",
+    ".#..#.",
+    "#.##.#",
+    "......",
+    "##..##",
+)
+
+for fmt in (framebuf.PL8, framebuf.RGB565):
+    src = make(6, 5, fmt)
+    for y, row in enumerate(shape):
+        for x, c in enumerate(row):
+            src.pixel(x, y, 0 if c == '.' else 0x100000 * (x + 1) + y + 1)
+    key = src.pixel(0, 0)
+    spr = framebuf.Sprite(src, key)
+    print(len(bytes(spr)))
+
+    a = make(8, 6, fmt)
+    b = make(8, 6, fmt)
+    ok = True
+    for x in range(-7, 9):
+        for y in range(-6, 7):
+            a.fill(0x00ff00)
+            b.fill(0x00ff00)
+            a.blit(src, x, y, key)
+            b.blit(spr, x, y)
+            ok = ok and bytes(a) == bytes(b)
+    print(ok)
+
+# PL8 sprite through a palette onto RGB565
+src = make(6, 5, framebuf.PL8)
+for y, row in enumerate(shape):
+    for x, c in enumerate(row):
+        src.pixel(x, y, 0 if c == '.' else x + 1)
+pal = make(8, 1, framebuf.RGB565)
+for i in range(8):
+    pal.pixel(i, 0, 0x204080 * i)
+spr = framebuf.Sprite(src, 0)
+a = make(8, 6, framebuf.RGB565)
+b = make(8, 6, framebuf.RGB565)
+a.blit(src, 1, 1, 0, pal)
+b.blit(spr, 1, 1, -1, pal)
+print(bytes(a) == bytes(b))
@@ -0,0 +1,56 @@
+# test text with the builtin font, scaling and a compact font
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+w = 20
+h = 10
+buf = bytearray(w * h)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.PL8)
+
+def printbuf():
+    print("--8<--")
+    for y in range(h):
+        print(''.join('.123'[buf[x + y * w]] for x in range(w)))
+    print("-->8--")
+    fbuf.fill(0)
+
+# builtin font, clipped at the edges, and scaled
+fbuf.text("Hi", -2, 1, 1)
+fbuf.text("A", 12, 4, 2)
+printbuf()
+fbuf.text("o", 0, 0, 1, None, 2)
+printbuf()
+
+# 1 bit per pixel font with characters 'a' to 'b' of height 3
+font1 = bytes([0, 3, ord('a'), ord('b'),
+    0, 0, 2,   # 'a': 2 wide, at offset 0
+    3, 0, 3])  # 'b': 3 wide, at offset 3
+font1 += bytes([0b11000000, 0b01000000, 0b11000000])
+font1 += bytes([0b10000000, 0b11100000, 0b10100000])
+fbuf.text("abba", 0, 0, 1, font1)
+fbuf.text("ab", 1, 4, 2, font1, 2)
+printbuf()
+
+# characters outside the font take no space
+fbuf.text("a?b", 0, 0, 1, font1)
+printbuf()
+
+# 2 bits per pixel font: coverage levels 0-3
+font2 = bytes([1, 2, ord('x'), ord('x'), 0, 0, 4])
+font2 += bytes([0b11100100, 0b00011011])
+fbuf.text("x", 0, 0, 3, font2)
+printbuf()
+
+# on RGB565 partial coverage is blended with the background
+fb16 = framebuf.FrameBuffer(bytearray(8), 4, 1, framebuf.RGB565)
+fb16.fill(0)
+fb16.text("x", 0, 0, 0xffffff, bytes([1, 1, ord('x'), ord('x'), 0, 0, 4, 0b11100100]))
+print(['%04x' % fb16.pixel(i, 0) for i in range(4)])
+
+try:
+    fbuf.text("a", 0, 0, 1, b'\x00\x03')
+except ValueError:
+    print('ValueError')
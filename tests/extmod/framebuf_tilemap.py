@@ -0,0 +1,48 @@
+# test drawing a scrolled TileMap
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+# sheet of 4 tiles of 2x2 pixels, 2 tiles per row; tile n is filled with n + 1
+sheet = framebuf.FrameBuffer(bytearray(4 * 4), 4, 4, framebuf.PL8)
+for t in range(4):
+    sheet.fill_rect((t % 2) * 2, (t // 2) * 2, 2, 2, t + 1)
+sheet.pixel(0, 0, 0)
+
+# 4x3 map; 255 is past the end of the sheet and stays empty
+tm = framebuf.TileMap(sheet, 2, 2, bytes([0, 1, 2, 3, 3, 255, 1, 0, 2, 2, 0, 1]), 4)
+
+w = 7
+h = 5
+buf = bytearray(w * h)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.PL8)
+
+def draw(sx, sy, *args):
+    fbuf.fill(9)
+    fbuf.draw_tilemap(tm, sx, sy, *args)
+    print("--8<--")
+    for y in range(h):
+        print(''.join(str(buf[x + y * w]) for x in range(w)))
+    print("-->8--")
+
+draw(0, 0)
+draw(1, 1)
+draw(-3, -2)
+draw(3, 3)
+draw(100, 0)
+# colour key and palette
+pal = framebuf.FrameBuffer(bytearray(8), 8, 1, framebuf.PL8)
+for i in range(8):
+    pal.pixel(i, 0, 7 - i)
+draw(0, 0, 0, pal)
+
+try:
+    framebuf.TileMap(sheet, 0, 2, b'', 1)
+except ValueError:
+    print('ValueError')
+try:
+    fbuf.draw_tilemap(sheet, 0, 0)
+except TypeError:
+    print('TypeError')
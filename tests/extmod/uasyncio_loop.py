@@ -0,0 +1,86 @@
+# Test the native task loop in _uasyncio
+try:
+    import _uasyncio
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+loop = _uasyncio.Loop()
+log = []
+
+async def worker(name, n, ms):
+    for i in range(n):
+        log.append((name, i))
+        await loop.sleep_ms(ms)
+    return name
+
+async def main():
+    loop.create_task(worker('a', 3, 10))
+    loop.create_task(worker('b', 3, 15))
+    await loop.sleep_ms(60)
+    return 'main'
+
+print(loop.run_until_complete(main()))
+print(log)
+
+# plain generators, and the values they can yield
+def child():
+    log.append('child')
+    yield
+
+def gen():
+    yield
+    yield 5
+    yield child()
+    yield
+    return 42
+
+log = []
+print(loop.run_until_complete(gen()), log)
+
+# many task switches
+async def switch(n):
+    for i in range(n):
+        await loop.sleep_ms(0)
+    return n
+
+print(loop.run_until_complete(switch(1000)))
+
+# a task can be parked and resumed by another
+def parked():
+    log.append('park')
+    yield False
+    log.append('resumed')
+
+async def waker(t):
+    await loop.sleep_ms(5)
+    loop.create_task(t)
+
+log = []
+t = parked()
+loop.create_task(t)
+loop.create_task(waker(t))
+loop.run_forever()
+print(log)
+
+# exceptions from tasks propagate out of the loop
+async def fail():
+    raise ValueError('fail')
+
+try:
+    loop.run_until_complete(fail())
+except ValueError as er:
+    print('ValueError', er)
+
+# queue limits
+small = _uasyncio.Loop(runq_len=1)
+small.create_task(switch(1))
+try:
+    small.create_task(switch(1))
+except IndexError:
+    print('IndexError')
+
+try:
+    loop.create_task(1)
+except TypeError:
+    print('TypeError')
@@ -0,0 +1,37 @@
+# CTR-AES256 vector from NIST SP 800-38A, fed in pieces and in place
+try:
+    from ucryptolib import aes
+    import ubinascii
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    aes(b"x" * 16, 6, b"x" * 16)
+except ValueError as e:
+    # is CTR support disabled?
+    if e.args[0] == "mode":
+        print("SKIP")
+        raise SystemExit
+    raise e
+
+key = ubinascii.unhexlify("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4")
+ctr = ubinascii.unhexlify("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff")
+pt = ubinascii.unhexlify(
+    "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+    "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710"
+)
+
+print(ubinascii.hexlify(aes(key, 6, ctr).encrypt(pt)))
+
+# in place, in pieces that don't line up with the blocks
+buf = bytearray(pt)
+mv = memoryview(buf)
+crypto = aes(key, 6, ctr)
+i = 0
+for n in (1, 15, 17, 3, 28):
+    crypto.encrypt(mv[i:i + n], mv[i:i + n])
+    i += n
+print(ubinascii.hexlify(buf))
+
+print(aes(key, 6, ctr).decrypt(buf) == pt)
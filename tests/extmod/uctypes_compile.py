@@ -0,0 +1,58 @@
+# test uctypes.compile gives the same results as the descriptor it came from
+try:
+    import uctypes
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+desc = {
+    "s0": uctypes.UINT16 | 0,
+    "s1": uctypes.INT8 | 2,
+    "sub": (4, {
+        "b0": uctypes.UINT8 | 0,
+        "b1": uctypes.UINT8 | 1,
+    }),
+    "arr": (uctypes.ARRAY | 4, uctypes.UINT8 | 2),
+    "arr16": (uctypes.ARRAY | 4, uctypes.UINT16 | 2),
+    "arr2": (uctypes.ARRAY | 4, 2, {"b": uctypes.UINT8 | 0}),
+    "bf0": uctypes.BFUINT16 | 0 | 0 << uctypes.BF_POS | 4 << uctypes.BF_LEN,
+    "bf1": uctypes.BFUINT16 | 0 | 4 << uctypes.BF_POS | 12 << uctypes.BF_LEN,
+    "ptr": (uctypes.PTR | 8, uctypes.UINT8),
+}
+
+cdesc = uctypes.compile(desc)
+print(type(cdesc).__name__)
+print(uctypes.compile(cdesc) is cdesc)
+
+for layout in (uctypes.NATIVE, uctypes.LITTLE_ENDIAN, uctypes.BIG_ENDIAN):
+    data = bytearray(b"\x01\x02\xfd\x00\x30\x31\x32\x33\x00\x00\x00\x00\x00\x00\x00\x00")
+    S = uctypes.struct(uctypes.addressof(data), desc, layout)
+    C = uctypes.struct(uctypes.addressof(data), cdesc, layout)
+    print(uctypes.sizeof(S) == uctypes.sizeof(C), uctypes.sizeof(cdesc, layout) == uctypes.sizeof(desc, layout))
+    print(S.s0 == C.s0, S.s1 == C.s1, C.s1)
+    print(C.sub.b0, C.sub.b1, uctypes.sizeof(C.sub))
+    print(C.arr[0], C.arr[1], C.arr16[1] == S.arr16[1])
+    print(C.arr2[0].b, C.arr2[1].b)
+    print(S.bf0 == C.bf0, S.bf1 == C.bf1)
+
+    # stores go through the compiled descriptor too
+    C.s1 = -5
+    C.sub.b1 = 0x41
+    C.arr2[0].b = 0x42
+    C.bf0 = 7
+    print(S.s1, S.sub.b1, S.arr[0], S.bf0)
+
+    try:
+        C.missing
+    except KeyError:
+        print("KeyError")
+
+    try:
+        C.sub = 1
+    except TypeError:
+        print("TypeError")
+
+try:
+    uctypes.compile(1)
+except TypeError:
+    print("TypeError")
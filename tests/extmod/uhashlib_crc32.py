@@ -0,0 +1,29 @@
+try:
+    import uhashlib as hashlib
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if not hasattr(hashlib, "crc32"):
+    print("SKIP")
+    raise SystemExit
+
+print(hashlib.crc32().digest())
+print(hashlib.crc32(b"a").digest())
+print(hashlib.crc32(b"123456789").digest())
+
+# long input, and the same input fed in pieces of awkward lengths
+data = bytes(range(256)) * 5
+print(hashlib.crc32(data).digest())
+h = hashlib.crc32()
+for i in range(0, len(data), 37):
+    h.update(data[i:i + 37])
+print(h.digest())
+h.update(memoryview(data)[1:100])
+print(h.digest())
+
+# digest doesn't end the hash
+h = hashlib.crc32(b"1234")
+h.digest()
+h.update(b"56789")
+print(h.digest())
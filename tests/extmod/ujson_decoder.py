@@ -0,0 +1,51 @@
+# test ujson.Decoder, which parses JSON fed to it in pieces
+try:
+    import ujson
+    ujson.Decoder
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+names = {}
+for n in ("START_OBJECT", "END_OBJECT", "START_ARRAY", "END_ARRAY", "KEY", "VALUE"):
+    names[getattr(ujson, n)] = n
+
+def decode(doc, n):
+    d = ujson.Decoder()
+    ev = []
+    for i in range(0, len(doc), n):
+        ev.extend(d.feed(doc[i:i + n]))
+    ev.extend(d.close())
+    return ev
+
+# every split of the document gives the same events
+doc = '{"a": [1, 2.5, -3e2, true, false, null], "b\\u00e9": {"c": "x\\"y\\n"}, "d": []}'
+for e, v in decode(doc, len(doc)):
+    print(names[e], repr(v))
+print(all(decode(doc, n) == decode(doc, len(doc)) for n in range(1, 12)))
+
+# bytes, and a number at the top level only ends with the document
+d = ujson.Decoder()
+print(d.feed(b'12'), d.feed(b'34 '), d.close())
+print(decode('"abc"', 2), decode('  []  ', 1))
+
+# syntax errors
+for bad in ('{1: 2}', '[1}', '{"a"}', '1 2', 'nul', 'tru e', '"\\uZZ', ']', '[', '"ab', ''):
+    d = ujson.Decoder()
+    try:
+        d.feed(bad)
+        d.close()
+        print("no error", bad)
+    except ValueError:
+        print("ValueError", repr(bad))
+
+# a decoder stays failed after an error
+d = ujson.Decoder()
+try:
+    d.feed('[}')
+except ValueError:
+    pass
+try:
+    d.feed('1]')
+except ValueError:
+    print("ValueError")
@@ -28,3 +28,9 @@ try:
     json.dump(123, {})
 except (AttributeError, OSError): # CPython and uPy have different errors
     print('Exception')
+
+# output longer than the write buffer, with a string longer than it too
+l = [{"t": i, "s": "abc" * i} for i in range(120)]
+s = StringIO()
+json.dump(l, s)
+print(s.getvalue() == json.dumps(l), len(s.getvalue()) > 1000)
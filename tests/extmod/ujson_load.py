@@ -13,3 +13,17 @@ print(json.load(StringIO('null')))
 print(json.load(StringIO('"abc\\u0064e"')))
 print(json.load(StringIO('[false, true, 1, -2]')))
 print(json.load(StringIO('{"a":true}')))
+
+# documents longer than a read chunk, with values split across chunks
+l = [{"name": "item%d" % i, "value": i * 1.5, "tags": ["a\\u00e9", "b"]} for i in range(40)]
+s = json.dumps(l)
+print(len(s) > 1000, json.load(StringIO(s)) == json.loads(s))
+for n in (255, 256, 257, 511):
+    s = '"' + "x" * (n - 2) + '"' + ' ' * 10
+    print(n, len(json.load(StringIO(s))), json.load(StringIO(" " * n + "[1, 12345]")))
+
+# trailing garbage after a chunk boundary is still an error
+try:
+    json.load(StringIO("1" + " " * 300 + "x"))
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,13 @@
+# test patterns that would take exponential time to match by backtracking
+
+try:
+    import ure as re
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+print(re.search("(x+x+)+y", "x" * 40))
+print(re.match("(x+x+)+y", "x" * 40 + "y").group(0))
+print(re.search("(a|aa)+$", "a" * 40 + "b"))
+print(re.match("((a|b)*)*c", "ab" * 20 + "c").group(2))
+print(re.compile("(a*)*b").search("a" * 100))
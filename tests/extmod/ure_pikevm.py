@@ -0,0 +1,40 @@
+# test patterns with nested repetition, which are not run by backtracking
+
+try:
+    import ure as re
+except ImportError:
+    try:
+        import re
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+def print_groups(match, n):
+    print(match and [match.group(i) for i in range(n + 1)])
+
+print_groups(re.search("(a|b)*c", "xxababc"), 1)
+print_groups(re.search("(a|ab)(c|bcd)(d*)", "abcd"), 3)
+print_groups(re.search("(a|b)+", "cabbac"), 1)
+print_groups(re.search("^(a|b)+", "cabbac"), 1)
+print_groups(re.search("(a+|b+)*c", "aabbaab c"), 1)
+print_groups(re.search("x(a|b)*y", "zzxababyy"), 1)
+print_groups(re.search("(ab|a)*?b", "ababab"), 1)
+print_groups(re.search("(a|b)*?c", "ababc"), 1)
+print_groups(re.search("(\d+|[a-z])+!", "ab12c!"), 1)
+print_groups(re.search("((a)|b)+", "ab"), 2)
+print_groups(re.match("(?:a|b)+$", "abba"), 0)
+print_groups(re.match("(?:a|b)+$", "abbac"), 0)
+
+# patterns starting with a literal byte
+print_groups(re.search("status=(\d+)", "id=1 status=200 x"), 1)
+print_groups(re.search("status=(\d+)", "id=1 status: 200"), 1)
+print_groups(re.search("(s)(t)", "a st"), 2)
+print_groups(re.match("ab", "xab"), 0)
+print_groups(re.match("ab", ""), 0)
+print(re.compile("x").split("axbxc"))
+print(re.compile(b"b+").search(b"abbbc").group(0))
+
+# reusing compiled patterns, including ones that compare equal
+for i in range(3):
+    for p in ("a", "b", "c", "d", "e", "a+"):
+        print(p, re.search(p, "xaab") is not None, re.search(p.encode(), b"bee") is not None)
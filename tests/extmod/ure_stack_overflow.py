@@ -7,7 +7,15 @@ except ImportError:
         print("SKIP")
         raise SystemExit
 
+# a repeated pattern that can match empty, which backtracking recurses on
 try:
-    re.match("(a*)*", "aaa")
+    print(re.match("(a*)*", "aaa").group(0))
+except RuntimeError:
+    print("RuntimeError")
+
+# a repetition longer than backtracking can recurse
+try:
+    print(len(re.match("a*", "a" * 10000).group(0)))
+    print(len(re.search("b[a-z]*", "x" + "b" * 10000 + "!").group(0)))
 except RuntimeError:
     print("RuntimeError")
@@ -0,0 +1,52 @@
+try:
+    import uzlib as zlib
+    import uio as io
+    zlib.CompIO
+except (AttributeError, ImportError):
+    print("SKIP")
+    raise SystemExit
+
+log = b"".join(b"00:%02d INFO id=%d status=200\n" % (i % 60, i * 7) for i in range(200))
+PATTERNS = [b"", b"a", b"abcabcabcabc", b"a" * 1000, bytes(range(256)) * 3, log]
+
+# round trip through compress, checking the output is the same as for CompIO
+# with the data written in pieces of various sizes
+for wbits in (8, 10, 15, -9, 25):
+    for data in PATTERNS:
+        c = zlib.compress(data, -1, wbits)
+        if wbits >= 16:
+            d = zlib.DecompIO(io.BytesIO(c), wbits).read()
+        else:
+            d = zlib.decompress(c, wbits)
+        for n in (1, 100, 10000):
+            buf = io.BytesIO()
+            s = zlib.CompIO(buf, wbits)
+            for i in range(0, len(data), n):
+                s.write(data[i : i + n])
+            s.close()
+            if buf.getvalue() != c:
+                print("CompIO differs", wbits, len(data), n)
+        print(wbits, len(data), d == data, len(c) < len(data) // 2 + 25)
+
+# exact output
+print(zlib.compress(b""))
+print(zlib.compress(b"hello hello hello"))
+print(zlib.compress(b"hello", 9, -15))
+
+# context manager, and writing after close
+buf = io.BytesIO()
+with zlib.CompIO(buf) as s:
+    print(s.write(b"hello"))
+print(zlib.decompress(buf.getvalue()))
+try:
+    s.write(b"x")
+except OSError:
+    print("OSError")
+s.close()
+
+# bad window sizes
+for wbits in (7, 16, -16, 32):
+    try:
+        zlib.CompIO(io.BytesIO(), wbits)
+    except ValueError:
+        print("ValueError", wbits)
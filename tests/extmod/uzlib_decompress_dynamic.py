@@ -0,0 +1,61 @@
+try:
+    import uzlib as zlib
+    import uio as io
+    import ubinascii as binascii
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+
+# skewed symbol frequencies, so the dynamic Huffman codes include long ones
+def gen(n):
+    out = bytearray()
+    x = 1
+    for i in range(n):
+        x = (x * 1103515245 + 12345) & 0x7fffffff
+        r = x >> 16
+        k = 0
+        while r & 1 and k < 14:
+            r >>= 1
+            k += 1
+        out.append(65 + k)
+    return out
+
+
+data = gen(2000)
+comp = binascii.unhexlify(
+    b'78da4d5559b2c330083b1b9bd3febcfb1fe721099c7626a963308b10d8cc23c2'
+    b'c2cc4f3fe98f9b59655a62d14f4b9dcbcad6d5567f1ef73a0fd694f2d7ab2fe5'
+    b'e5fdd75fe190f3393a0881ec420e93fb0debd8421051587affa24df49eccf323'
+    b'83cb8e3361df5bdd700cc11d9a83024cd34be796b3d727bc13634a14b8141c66'
+    b'21547a7cf51e0c54315087d776a25899520314d285d8f241281d4130c3431597'
+    b'1f062234a1e2355b089f8f8d8c109dde8a0b3a14e0b69d94118ff0861d2beee0'
+    b'e8c7582c1c78c25211fae46f93950237824ce8a8e8cc3d9981124f64fc184177'
+    b'bbb5022d0627873a02ec04093e4e7ffda794587470cd83497d736ca52af7d365'
+    b'f013744cf8623168e08c556e7ef5ea614ed8edcab1de61728c58132ecfd68c36'
+    b'5054a1fa1df07c0a3a4c059b44be0e10c1673cf101160512b5ce61c4a1b2b2ba'
+    b'49c20ca1a6a4297743f03e99433067e873568923e5c5a0d2871312a7ea8f1604'
+    b'f0b9a98381b1b8d84b91dc46bba5b43d3f4ce6e95cc962c9ce5227b9c28307b0'
+    b'0039e50bdf9fa9b9273b6ac71c984ad2819ad2c9a2a706ac2d74a0b117236eab'
+    b'b9f2128189043ac103cd82a8b34f81fd1fb53e213d1c0a242367ca876ff9d124'
+    b'70cc96c507750b16f8ac6ffea7cc4dcf038c2b0ab7cb0f3252649bc059e01c1e'
+    b'd108289fc09b1d21805bff9936d220b29f9918cf3ae6be18803e53084e627d79'
+    b'ecb36381ce648f232f916beca8c29b530fb41d32fdd2c4143ea66144bc855902'
+    b'0d55e0a7072d6a5577fa90c7454a2c51b36ed9ba3d5a52ecc3788958a812af87'
+    b'ba23236cda20d41b0eae11c2f2b954ee5580960ee5cd90b672d4c7fcc648bc09'
+    b'3e3ccb41a5c9e0f1a25d1c12ceb093b3e20547259b31360d7c8731602ec5900a'
+    b'84e3e9e590fa555f22f573b67cc646be13dbe2877d3fec7c6fbe5013e996b3f5'
+    b'c2db4bf7155ca5902bd5789a673a2de7b29a4bb664dfff01726103b8'
+)
+
+print(zlib.decompress(comp) == data)
+
+# through DecompIO, with the window size taken from the zlib header
+inp = zlib.DecompIO(io.BytesIO(comp))
+out = b''
+while True:
+    b = inp.read(37)
+    if not b:
+        break
+    out += b
+print(out == data)
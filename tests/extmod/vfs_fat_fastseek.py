@@ -0,0 +1,73 @@
+try:
+    import uos
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    uos.VfsFat
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMFS:
+
+    SEC_SIZE = 512
+
+    def __init__(self, blocks):
+        self.data = bytearray(blocks * self.SEC_SIZE)
+
+    def readblocks(self, n, buf):
+        for i in range(len(buf)):
+            buf[i] = self.data[n * self.SEC_SIZE + i]
+
+    def writeblocks(self, n, buf):
+        for i in range(len(buf)):
+            self.data[n * self.SEC_SIZE + i] = buf[i]
+
+    def ioctl(self, op, arg):
+        if op == 4:  # BP_IOCTL_SEC_COUNT
+            return len(self.data) // self.SEC_SIZE
+        if op == 5:  # BP_IOCTL_SEC_SIZE
+            return self.SEC_SIZE
+
+
+try:
+    bdev = RAMFS(64)
+except MemoryError:
+    print("SKIP")
+    raise SystemExit
+
+uos.VfsFat.mkfs(bdev)
+vfs = uos.VfsFat(bdev)
+
+# write two files a cluster at a time in turn, so both are fragmented
+with vfs.open("a", "w") as fa:
+    with vfs.open("b", "w") as fb:
+        for i in range(12):
+            fa.write(chr(65 + i) * 512)
+            fb.write(chr(97 + i) * 512)
+
+for fastseek in (False, True):
+    with vfs.open("a", "rb", fastseek) as f:
+        out = []
+        for i in (11, 0, 5, 10, 1):
+            f.seek(i * 512 + 100)
+            out.append(f.read(2))
+        f.seek(-3, 2)
+        out.append(f.read())
+        print(fastseek, out, f.tell())
+
+# an empty file
+vfs.open("e", "w").close()
+with vfs.open("e", "rb", True) as f:
+    print(f.read(), f.seek(10), f.tell())
+
+# fast seek can't be used when writing
+for mode in ("w", "a", "r+"):
+    try:
+        vfs.open("a", mode, True)
+    except ValueError:
+        print("ValueError", mode)
+print(vfs.open("a", "rb").read(3))
@@ -124,13 +124,17 @@ micropython.heap_unlock()
 
 # Here we test that the finaliser is actually called during a garbage collection.
 import gc
+# The files are opened in a function which has returned by the time of the
+# collection, so no stale reference to them is left in a live C stack frame.
 N = 4
-for i in range(N):
-    n = 'x%d' % i
-    f = vfs.open(n, 'w')
-    f.write(n)
-    f = None # release f without closing
-    [0, 1, 2, 3] # use up Python stack so f is really gone
+def open_files():
+    for i in range(N):
+        n = 'x%d' % i
+        f = vfs.open(n, 'w')
+        f.write(n)
+        f = None # release f without closing
+        [0, 1, 2, 3] # use up Python stack so f is really gone
+open_files()
 gc.collect() # should finalise all N files by closing them
 for i in range(N):
     with vfs.open('x%d' % i, 'r') as f:
@@ -0,0 +1,66 @@
+try:
+    import uos
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    uos.VfsFat
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMFS:
+
+    SEC_SIZE = 512
+
+    def __init__(self, blocks):
+        self.data = bytearray(blocks * self.SEC_SIZE)
+        self.reads = []
+
+    def readblocks(self, n, buf):
+        self.reads.append(len(buf) // self.SEC_SIZE)
+        for i in range(len(buf)):
+            buf[i] = self.data[n * self.SEC_SIZE + i]
+
+    def writeblocks(self, n, buf):
+        for i in range(len(buf)):
+            self.data[n * self.SEC_SIZE + i] = buf[i]
+
+    def ioctl(self, op, arg):
+        if op == 4:  # BP_IOCTL_SEC_COUNT
+            return len(self.data) // self.SEC_SIZE
+        if op == 5:  # BP_IOCTL_SEC_SIZE
+            return self.SEC_SIZE
+
+
+try:
+    bdev = RAMFS(80)
+except MemoryError:
+    print("SKIP")
+    raise SystemExit
+
+uos.VfsFat.mkfs(bdev)
+vfs = uos.VfsFat(bdev)
+
+data = bytes(range(256)) * 40
+
+# one file written whole, so its clusters follow each other
+with vfs.open("seq", "wb") as f:
+    f.write(data)
+
+# two files written a sector at a time in turn, so their clusters alternate
+with vfs.open("f1", "wb") as f1:
+    with vfs.open("f2", "wb") as f2:
+        for i in range(0, 4096, 512):
+            f1.write(data[i:i + 512])
+            f2.write(data[i:i + 512])
+
+for name, size, skip in (("seq", len(data), 0), ("seq", len(data), 100), ("f1", 4096, 0)):
+    buf = bytearray(size - skip)
+    with vfs.open(name, "rb") as f:
+        f.seek(skip)
+        bdev.reads = []
+        n = f.readinto(buf)
+    print(name, skip, n, buf == data[skip:size], max(bdev.reads), len(bdev.reads))
@@ -58,3 +58,16 @@ try:
     ws.ioctl(-1)
 except OSError as e:
     print("ioctl: EINVAL:", e.args[0] == uerrno.EINVAL)
+
+# several frames, read through the read-ahead buffer
+ws = uwebsocket.websocket(uio.BytesIO(b"\x81\x02ab\x81\x03cde\x81\x01f"))
+print(ws.read(2), ws.read(3), ws.read(1))
+
+# long masked payload, read with readinto at an odd offset
+msg = bytes(range(100))
+mask = b"\x01\x02\x04\x08"
+masked = bytes(msg[i] ^ mask[i & 3] for i in range(len(msg)))
+ws = uwebsocket.websocket(uio.BytesIO(b"\x81\xe4" + mask + masked))
+buf = bytearray(101)
+n = ws.readinto(memoryview(buf)[1:])
+print(n, buf[1:1 + n] == msg[:n])
@@ -0,0 +1,2 @@
+# this test for the availability of the framebuf module
+import framebuf
@@ -0,0 +1,3 @@
+# this test for the availability of the MEOWBIT screen
+import pyb
+pyb.SCREEN
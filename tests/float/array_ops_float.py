@@ -0,0 +1,26 @@
+# test the functions in the array module that work on whole arrays of floats
+
+try:
+    import uarray as array
+except ImportError:
+    try:
+        import array
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+if not hasattr(array, "dot"):
+    print("SKIP")
+    raise SystemExit
+
+for tc in "fd":
+    a = array.array(tc, [1.5, -2.0, 3.25, 0.5])
+    array.add(a, 0.5)
+    print(a)
+    array.mul(a, array.array(tc, [2, 2, -1, 4]))
+    print(a)
+    array.scale(a, 3, 1)
+    print(a)
+    array.clip(a, -4, 5.5)
+    print(a)
+    print(array.sum(a), array.min(a), array.max(a), array.dot(a, a))
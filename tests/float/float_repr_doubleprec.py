@@ -0,0 +1,40 @@
+# test repr of floats gives the shortest digits that read back the same,
+# requiring double-precision
+
+# builds without MICROPY_OPT_FAST_FLOAT print 16 significant digits instead
+if repr(0.1 + 0.2) != '0.30000000000000004':
+    print('SKIP')
+    raise SystemExit
+
+for x in (0.1, 0.2, 0.3, 0.1 + 0.2, 1 / 3, 2 / 3, 780.941, 8310.167, 0.809,
+          123456.789, 1e-5, 1.5e-7, 9.999e15, 1e16, 1e22, 2.5, 100.0):
+    print(repr(x), repr(-x))
+
+# rounding up carries into a new leading digit, or the digits are all 9s
+for x in (99.99999999999999, 0.09999999999999999, 0.9999999999999999, 1e23,
+          1.0000000000000001e-21, 9.999999999999999e-266, 9.999999999999999e22):
+    print(repr(x), repr(-x))
+
+# values from sensors and the like, written out in full
+for s in ('23.5', '1013.25', '-40.125', '0.001', '3.14159', '65535.0', '0.000123'):
+    x = float(s)
+    print(s, repr(x), float(repr(x)) == x)
+
+# repr must always read back as the same value
+seed = 1
+bad = 0
+for i in range(2000):
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff
+    x = seed / (1 << (i % 61))
+    if float(repr(x)) != x:
+        bad += 1
+print(bad)
+
+# parsing short decimals is correctly rounded
+print(float('0.1') == 1 / 10, float('1.7') == 17 / 10, float('2.675') == 2675 / 1000)
+print(float('123.456e-2') == 123456 / 100000, float('5e22') == 5e22)
+
+# long strings of digits near the bottom of the range are correctly rounded
+for s in ('1.0000000000000003e-270', '1.0000000000000003e-265', '2.2250738585072014e-270',
+          '4.940656458412465e-270'):
+    print(s, repr(float(s)))
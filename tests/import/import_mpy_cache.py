@@ -0,0 +1,78 @@
+# test the cache of compiled imports, MICROPY_MODULE_CACHE_MPY
+
+import sys
+try:
+    import uos
+    uos.listdir, uos.mkdir, uos.remove, uos.rmdir
+except (ImportError, AttributeError):
+    print('SKIP')
+    raise SystemExit
+
+DIR = 'import_mpy_cache_dir'
+
+def rmtree(path):
+    try:
+        for name in uos.listdir(path):
+            p = path + '/' + name
+            try:
+                uos.remove(p)
+            except OSError:
+                rmtree(p)
+        uos.rmdir(path)
+    except OSError:
+        pass
+
+def write(name, data):
+    with open(DIR + '/' + name, 'wb') as f:
+        f.write(data)
+
+def read(name):
+    with open(DIR + '/' + name, 'rb') as f:
+        return f.read()
+
+rmtree(DIR)
+uos.mkdir(DIR)
+write('mod_a.py', b'x = "a"\n')
+write('mod_b.py', b'x = "b"\n')
+sys.path.insert(0, DIR)
+
+try:
+    import mod_a
+    import mod_b
+    cache = uos.listdir(DIR + '/__pycache__')
+except OSError:
+    cache = None
+if cache is None:
+    # this build doesn't cache compiled imports
+    sys.path.pop(0)
+    rmtree(DIR)
+    print('SKIP')
+    raise SystemExit
+
+print(mod_a.x, mod_b.x, sorted(cache))
+
+# the cache file is the source's key, then the .mpy data
+key_a = read('__pycache__/mod_a.mpy')[:8]
+mpy_b = read('__pycache__/mod_b.mpy')[8:]
+print(mpy_b[:1])
+
+# a second import loads the cached code: here mod_b's, behind mod_a's key
+write('__pycache__/mod_a.mpy', key_a + mpy_b)
+del sys.modules['mod_a']
+import mod_a
+print(mod_a.x)
+
+# a stale key falls back to compiling the source, and caches it again
+write('__pycache__/mod_a.mpy', b'\0' * 8 + mpy_b)
+del sys.modules['mod_a']
+import mod_a
+print(mod_a.x, read('__pycache__/mod_a.mpy')[:8] == key_a)
+
+# an unusable cache file falls back to compiling the source
+write('__pycache__/mod_a.mpy', key_a + b'junk')
+del sys.modules['mod_a']
+import mod_a
+print(mod_a.x)
+
+sys.path.pop(0)
+rmtree(DIR)
@@ -0,0 +1,44 @@
+# test micropython.import_mpy with a .mpy file in the XIP form
+
+import micropython
+
+try:
+    micropython.import_mpy
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# this is the file made with mpy-cross -mxip from:
+#
+# s = 'hello'
+# def f(x, *, y=2):
+#     def g():
+#         return (x, y, 'g')
+#     return g
+# def h(e):
+#     raise e('in h')
+mpy = bytearray(b"M\x04B\x1f \x81,\x04\x00p\x00\x00\x00\n\x02\x00\x03\x00'm \x00\x00\xff\x16\x04\x00$\x05\x00\x18S\x00\x82\x16\x06\x00Ta\x00$\x07\x00`\x01$\x08\x00\x11[\x00\x02\x07\x00\x07\x14mod_xip.py\nhello\x02s\x02y\x02f\x02hh\x05\x00x\x01\x01\x00\t\x03\x00\x04\x00CF\x00\x00\x00\x01\xff\xb0\xb1b\x02\x02\xc2\xb2[\x00\x01\x02\x02x\x07\x07\rd\x05\x00@\x02\x00\x00\x08\x02\x00\x03\x00a\x00\x00\xff\x1a\x00\x1a\x01\x16\x02\x00P\x03[\x00\x00\x02\x00\x05\x00\x05\x02g\x03h\x03\x00@\x01\x00\x00\t\x01\x00\x02\x00a`\x00\x00\xff\xb0\x16\x03\x00d\x01\\\x01\x11[\x00\x00\x03\x02e\r\x05\x08in h")
+
+# the code doesn't depend on the bytecode cache or superinstructions, so try
+# the feature flags for each until one suits this build
+for flags in (0x00, 0x01, 0x80, 0x81):
+    mpy[2] = 0x42 | flags
+    try:
+        m = micropython.import_mpy('mod_xip', mpy)
+        break
+    except ValueError:
+        pass
+else:
+    print("SKIP")
+    raise SystemExit
+
+print(m.__name__, m.s)
+print(m.f.__name__, m.h.__name__)
+print(m.f(1)(), m.f(3, y=4)())
+try:
+    m.h(ValueError)
+except ValueError as er:
+    print(repr(er))
+
+# importing again gives the same module
+print(micropython.import_mpy('mod_xip', b'') is m)
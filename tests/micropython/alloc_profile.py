@@ -0,0 +1,40 @@
+# test micropython.alloc_profile, which samples allocations by source line
+
+import micropython
+
+try:
+    micropython.alloc_profile
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+
+def f():
+    l = []
+    for i in range(100):
+        l.append(bytearray(40))
+    return l
+
+
+micropython.alloc_profile(1)
+f()
+prof = micropython.alloc_profile()
+print(prof[0][1:3], prof[0][3] > 0)
+print(prof[0][4] >= prof[0][3] * 40)
+print(all(prof[i][4] >= prof[i + 1][4] for i in range(len(prof) - 1)))
+
+# sampling every 4th allocation scales up the counts
+micropython.alloc_profile(4)
+f()
+prof = micropython.alloc_profile()
+print(prof[0][1:3], prof[0][3] % 4 == 0, prof[0][3] >= 100)
+
+# with sampling off nothing is recorded
+micropython.alloc_profile(0)
+f()
+print(micropython.alloc_profile())
+
+try:
+    micropython.alloc_profile(-1)
+except ValueError:
+    print('ValueError')
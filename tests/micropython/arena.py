@@ -0,0 +1,58 @@
+# test micropython.arena
+
+import micropython
+import gc
+
+try:
+    micropython.arena
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+# objects made in an arena work as usual until its end
+def work(n):
+    l = []
+    for i in range(n):
+        l.append((i, [i] * 3, 'x%d' % i))
+    return sum(t[1][2] for t in l)
+
+with micropython.arena(4000):
+    print(work(10))
+    print(work(100))
+
+# which doesn't take from the heap
+m = 0
+with micropython.arena(8000):
+    m = gc.mem_alloc()
+    work(10)
+    print(gc.mem_alloc() == m)
+
+# the rest keeps its objects
+keep = [[i] for i in range(20)]
+for i in range(50):
+    with micropython.arena(1000):
+        work(5)
+        gc.collect()
+print(sum(x[0] for x in keep))
+
+# arenas can nest
+with micropython.arena(1000):
+    a = [1, 2]
+    with micropython.arena(1000):
+        b = [3, 4]
+        print(a + b)
+    print(a)
+
+# an exception raised from an arena survives it
+try:
+    with micropython.arena(1000):
+        raise ValueError('in arena', [1, 2, 3])
+except ValueError as er:
+    gc.collect()
+    junk = [bytearray(16) for i in range(100)]
+    print(er.args)
+
+try:
+    micropython.arena(0)
+except ValueError:
+    print('ValueError')
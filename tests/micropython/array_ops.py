@@ -0,0 +1,98 @@
+# test the functions in the array module that work on whole arrays
+
+try:
+    import uarray as array
+except ImportError:
+    try:
+        import array
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+if not hasattr(array, "dot"):
+    print("SKIP")
+    raise SystemExit
+
+# elementwise with an array or a number, wrapping around
+a = array.array("h", [1, -2, 30000, 4])
+array.add(a, 5000)
+print(a)
+array.mul(a, array.array("h", [2, 3, 1, -1]))
+print(a)
+array.add(a, a)
+print(a)
+
+# fixed point scaling, and clipping to the range of the typecode
+a = array.array("h", [1000, -1000, 32000, 7])
+array.scale(a, 3, 2)
+print(a)
+array.scale(a, 5)
+print(a)
+array.clip(a, -1000, 100000)
+print(a)
+
+# reductions
+print(array.sum(a), array.min(a), array.max(a), array.dot(a, a))
+print(array.sum(array.array("b")), array.dot(array.array("B"), array.array("B")))
+
+# every integer typecode
+for tc in "bBhHiIlLqQ":
+    a = array.array(tc, [5, 100, 1, 50])
+    array.add(a, 3)
+    array.mul(a, 2)
+    array.clip(a, 10, 150)
+    print(tc, a, array.sum(a), array.min(a), array.max(a), array.dot(a, a))
+
+# unsigned and 64-bit values, and big int bounds
+a = array.array("Q", [2 ** 64 - 1, 5])
+array.add(a, 1)
+print(a, array.sum(a))
+a = array.array("q", [-5, 7, 2 ** 62])
+array.clip(a, -(2 ** 70), 2 ** 70)
+print(a)
+array.clip(a, 0, 2 ** 61)
+print(a)
+a = array.array("B", [3, 200])
+array.clip(a, -1000, 100)
+print(a)
+
+# sums and dot products don't wrap around
+print(array.sum(array.array("q", [2 ** 62, 2 ** 62])))
+print(array.sum(array.array("q", [-(2 ** 63), -1, 1, -(2 ** 63)])))
+print(array.sum(array.array("Q", [2 ** 63, 2 ** 63, 1])))
+print(array.dot(array.array("i", [-(2 ** 31)] * 3), array.array("i", [-(2 ** 31)] * 3)))
+print(array.dot(array.array("I", [2 ** 32 - 1] * 2), array.array("I", [2 ** 32 - 1] * 2)))
+a = array.array("q", [2 ** 40, -(2 ** 62), 3])
+print(array.dot(a, a))
+a = array.array("Q", [2 ** 63, 2 ** 33, 2])
+print(array.dot(a, a))
+
+# bytearray and memoryview
+b = bytearray(b"\x01\x02\xff")
+array.add(b, 1)
+print(b, array.max(memoryview(b)))
+a = array.array("i", [1, 2, 3, 4])
+array.mul(memoryview(a)[1:3], -1)
+print(a)
+
+# errors
+try:
+    array.add(a, array.array("b", [1, 2, 3, 4]))
+except ValueError:
+    print("ValueError")
+try:
+    array.add(a, array.array("i", [1, 2]))
+except ValueError:
+    print("ValueError")
+try:
+    array.min(array.array("i"))
+except ValueError:
+    print("ValueError")
+try:
+    array.add(b"abc", 1)
+except TypeError:
+    print("TypeError")
+try:
+    array.dot(a, 1)
+except TypeError:
+    print("TypeError")
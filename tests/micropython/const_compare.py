@@ -0,0 +1,33 @@
+# test folding of comparisons and conditional expressions with constants
+
+from micropython import const
+
+_A = const(1)
+_B = const(2)
+
+print(_A < _B, _A > _B, _A == 1, _A != 1, _A <= 1, _B >= 3)
+print(_A < _B < 3, _A < _B > 3, 0 <= _A <= _B <= 2)
+
+print('a' if _A == 1 else 'b')
+print('a' if _A == 2 else 'b')
+print('a' if _A < _B and _B < 3 else 'b')
+print('a' if not _A else 'b' if _B else 'c')
+
+# only some of the operands are constant
+x = 2
+print(_A < x, _A < _B < x, _A < x < _B, 'a' if x == _B else 'b')
+
+# comparisons that are not folded
+print(_A in (1, 2), _A not in (1, 2))
+
+def f(y):
+    if _A == 1:
+        return y + 1
+    return y
+print(f(1))
+
+def g():
+    while _A > _B:
+        return 'no'
+    return 'yes'
+print(g())
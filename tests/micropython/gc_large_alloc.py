@@ -0,0 +1,27 @@
+# test gc.fragmentation() and placing large allocations high in the heap
+
+import gc
+
+try:
+    gc.fragmentation
+    import uctypes
+except (AttributeError, ImportError):
+    print('SKIP')
+    raise SystemExit
+
+gc.collect()
+free = gc.mem_free()
+largest, runs = gc.fragmentation()
+print(type(largest), type(runs))
+print(0 < largest <= free)
+print(len(runs) > 0 and runs[-1] > 0)
+
+# a large buffer is placed above small objects, even those allocated after it
+big = bytearray(4096)
+small = [bytearray(16) for i in range(8)]
+print(all(uctypes.addressof(big) > uctypes.addressof(s) for s in small))
+
+# so freeing it leaves a free run at least as large
+big = None
+gc.collect()
+print(gc.fragmentation()[0] >= 4096)
@@ -0,0 +1,23 @@
+# test gc.stats, the running totals of collections and allocations
+
+import gc
+
+try:
+    gc.stats
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+s0 = gc.stats()
+print(len(s0))
+
+# allocate at least 100 * 64 bytes of garbage, then collect it
+for i in range(100):
+    bytearray(64)
+gc.collect()
+s1 = gc.stats()
+
+print(s1[0] - s0[0] >= 1)
+print(s1[3] - s0[3] >= 100 * 64)
+print(s1[4] > s0[4])
+print(s1[1] >= s0[1], s1[2] >= s0[2], s1[1] >= s1[2])
@@ -0,0 +1,30 @@
+# test that sweeping a collection in steps keeps live objects intact
+
+import gc
+
+try:
+    gc.step
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+# build up garbage between live objects, allocating through the collections
+# that allocation starts so some objects are made ahead of the sweep
+keep = []
+for i in range(2000):
+    x = [i] * (i % 5 + 1)
+    if i % 4 == 0:
+        keep.append(x)
+    while gc.step(0):
+        pass
+
+# let steps finish any pending sweep, a little at a time
+while gc.step(0):
+    pass
+
+ok = True
+for j, x in enumerate(keep):
+    i = j * 4
+    if x != [i] * (i % 5 + 1):
+        ok = False
+print(ok)
@@ -0,0 +1,32 @@
+# test that small allocations reusing freed runs don't corrupt live objects
+
+import gc
+
+# interleave live objects with ones that become garbage, of 1 to 4 blocks
+keep = []
+drop = []
+for i in range(200):
+    n = i % 4
+    keep.append(bytes([i & 0xff]) * (n * 16 + 1))
+    drop.append([i] * (n * 4 + 1))
+drop = None
+gc.collect()
+
+# reuse the holes with objects of other sizes, mixing in explicit frees
+new = []
+for i in range(400):
+    x = (i,) * (i % 7 + 1)
+    if i % 3 == 0:
+        new.append(x)
+    if i % 50 == 0:
+        gc.collect()
+
+ok = True
+for i, b in enumerate(keep):
+    if len(b) != (i % 4) * 16 + 1 or b[0] != i & 0xff or b[-1] != i & 0xff:
+        ok = False
+for j, x in enumerate(new):
+    i = j * 3
+    if x != (i,) * (i % 7 + 1):
+        ok = False
+print(ok)
@@ -0,0 +1,27 @@
+# test micropython.opcode_stats, the counts of opcodes run by the VM
+
+import micropython
+
+try:
+    micropython.opcode_stats
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+
+def f(n):
+    x = 0
+    for i in range(n):
+        x = i
+    return x
+
+
+micropython.opcode_stats(True)
+f(100)
+ops, pairs = micropython.opcode_stats()
+
+# the loop body runs its opcodes at least 100 times each
+print(max(n for op, n in ops) >= 100)
+print(all(0 <= op < 256 and n > 0 for op, n in ops))
+print(sum(n for a, b, n in pairs) <= sum(n for op, n in ops))
+print(micropython.opcode_stats(True))
@@ -0,0 +1,42 @@
+# test that code compiled at optimisation level 2, which may apply peephole
+# optimisations, behaves the same
+
+import micropython
+
+micropython.opt_level(2)
+exec("""
+def g(xs):
+    n = 0
+    for x in xs:
+        if x > 2:
+            n += x
+        elif x:
+            n -= 1
+        else:
+            n = 0
+    while n > 100:
+        if n & 1:
+            n -= 3
+        else:
+            n //= 2
+    return n
+print(g(range(20)), g([0, 1, 5]))
+
+def h(x):
+    while True:
+        try:
+            if x:
+                x -= 1
+                continue
+            else:
+                break
+        finally:
+            pass
+    return x
+print(h(5))
+
+a = b = [1]
+print(a is b, not None, not 0, not 7, -(3), ~(5), +(2))
+print([i if i & 1 else -i for i in range(5)])
+""")
+micropython.opt_level(0)
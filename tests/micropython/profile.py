@@ -0,0 +1,34 @@
+# test micropython.profile, which samples the running line from an interrupt
+
+import micropython
+
+try:
+    micropython.profile
+    import utime
+except (AttributeError, ImportError):
+    print('SKIP')
+    raise SystemExit
+
+
+def busy(ms):
+    t0 = utime.ticks_ms()
+    while utime.ticks_diff(utime.ticks_ms(), t0) < ms:
+        pass
+
+
+micropython.profile(1)
+busy(100)
+funcs, lines = micropython.profile()
+print(funcs[0][1], funcs[0][2] > 10)
+print(lines[0][2], lines[0][3] <= funcs[0][2])
+print(all(lines[i][3] >= lines[i + 1][3] for i in range(len(lines) - 1)))
+
+# with sampling off nothing is recorded
+micropython.profile(0)
+busy(20)
+print(micropython.profile())
+
+try:
+    micropython.profile(-1)
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,22 @@
+# test micropython.stack_use_max()
+
+import micropython
+
+try:
+    micropython.stack_use_max
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+def recurse(n):
+    if n:
+        recurse(n - 1)
+
+m0 = micropython.stack_use_max()
+print(m0 >= micropython.stack_use())
+
+# a deep call must raise the high-water mark, and it must stay raised
+recurse(50)
+m1 = micropython.stack_use_max()
+print(m1 > m0)
+print(micropython.stack_use_max() >= m1)
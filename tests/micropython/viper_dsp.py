@@ -0,0 +1,45 @@
+# test viper builtins for the ARMv7E-M DSP instructions
+
+# the builtins are globals (and so raise NameError) on other targets, and
+# the casts below keep the code valid viper for those
+@micropython.viper
+def f(a:uint, b:uint) -> uint:
+    return uint(uadd8(a, b))
+try:
+    f(0, 0)
+except NameError:
+    print("SKIP")
+    raise SystemExit
+
+@micropython.viper
+def bytewise(a:uint, b:uint):
+    print(hex(uadd8(a, b)), hex(usub8(a, b)))
+    print(hex(uqadd8(a, b)), hex(uqsub8(a, b)), hex(uhadd8(a, b)))
+bytewise(0x10ff8001, 0x20028001)
+
+@micropython.viper
+def halfwords(a:uint, b:uint):
+    print(hex(uqadd16(a, b)), qadd16(a, b))
+halfwords(0xfff00010, 0x00200020)
+halfwords(0x7fff0001, 0x00010002)
+
+@micropython.viper
+def select(a:uint, b:uint) -> uint:
+    usub8(a, b)
+    return uint(sel(a, b))
+print(hex(select(0x10203040, 0x40302010)))
+
+@micropython.viper
+def dot(a:ptr32, b:ptr32, n:int) -> int:
+    acc = 0
+    for i in range(n):
+        acc = int(smlad(a[i], b[i], acc))
+    return acc
+x = bytearray(b'\x01\x00\x02\x00\xff\xff\x04\x00')
+y = bytearray(b'\x03\x00\x04\x00\x05\x00\x06\x00')
+print(dot(x, y, 2))
+
+@micropython.viper
+def clamp(v:int) -> uint:
+    return uint(usat(v, 8))
+print(clamp(-5), clamp(100), clamp(300))
@@ -0,0 +1,47 @@
+# test viper functions with more locals than fit in registers
+
+@micropython.viper
+def f(n:int) -> int:
+    a = 1
+    b = 2
+    c = 3
+    d = 4
+    e = 5
+    g = 6
+    h = 7
+    t = 0
+    i = 0
+    while i < n:
+        t = a
+        a = b
+        b = c
+        c = d
+        d = e
+        e = g
+        g = h
+        h = t + a
+        i += 1
+    print(a, b, c, d, e, g, h)
+    return a + b + c + d + e + g + h
+print(f(0), f(1), f(10))
+
+# locals used in expressions and as pointers
+@micropython.viper
+def fill(buf, n:int, v:int):
+    x = 0
+    y = 1
+    z = 2
+    p = ptr8(buf)
+    q = p
+    t = 0
+    i = 0
+    while i < n:
+        t = v + x
+        q[i] = t
+        x = y
+        y = z
+        z = i
+        i += 1
+buf = bytearray(6)
+fill(buf, 6, 10)
+print(buf)
@@ -0,0 +1,54 @@
+# test tracebacks of exceptions that are caught in the function that raised
+# them, and only printed or raised again later
+
+import sys
+try:
+    try:
+        import uio as io
+    except ImportError:
+        import io
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if hasattr(sys, 'print_exception'):
+    print_exception = sys.print_exception
+else:
+    import traceback
+    print_exception = lambda e, f: traceback.print_exception(None, e, e.__traceback__, file=f)
+
+def print_exc(e):
+    buf = io.StringIO()
+    print_exception(e, buf)
+    s = buf.getvalue()
+    for l in s.split("\n"):
+        # remove filename, and the source lines that CPython prints
+        if l.startswith("  File "):
+            l = l.split('"')
+            print(l[0], l[2])
+        elif not l.startswith("    "):
+            print(l)
+
+# caught where it was raised, printed by the caller
+def f():
+    try:
+        raise ValueError('f')
+    except ValueError as e:
+        return e
+print_exc(f())
+
+# caught where it was raised, then raised again from another function
+def g(e):
+    raise e
+try:
+    g(f())
+except ValueError as e:
+    print_exc(e)
+
+# caught from a builtin in the same function
+def h():
+    try:
+        [][0]
+    except IndexError as e:
+        return e
+print_exc(h())
@@ -0,0 +1,33 @@
+# Blit 16x16 sprites over a framebuf, with and without a transparent key
+
+import framebuf
+
+FORMATS = ((framebuf.RGB565, 16), (framebuf.PL8, 8), (framebuf.GS4_HMSB, 4))
+
+def new_fbufs(w, h):
+    return [framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt) for fmt, bpp in FORMATS]
+
+def blit(w, h, n):
+    fbufs = new_fbufs(w, h)
+    sprites = new_fbufs(16, 16)
+    for s in sprites:
+        for y in range(16):
+            s.hline(0, y, 16, y)
+        s.fill_rect(4, 4, 8, 8, 0)
+    for i in range(n):
+        for fb, s in zip(fbufs, sprites):
+            for y in range(-8, h, 16):
+                for x in range(-8, w, 16):
+                    fb.blit(s, x + (i & 7), y, -1 if x & 16 else 0)
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 25): (64, 64, 20),
+    (100, 100): (160, 128, 10),
+    (1000, 1000): (320, 240, 4),
+}
+
+def bm_setup(params):
+    return lambda: blit(*params), lambda: (params[2] * ((params[0] + 23) // 16) * ((params[1] + 23) // 16) * len(FORMATS), None)
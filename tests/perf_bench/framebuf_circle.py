@@ -0,0 +1,28 @@
+# Draw circle outlines and filled circles, some clipped
+
+import framebuf
+
+FORMATS = ((framebuf.RGB565, 16), (framebuf.PL8, 8), (framebuf.GS4_HMSB, 4))
+
+def new_fbufs(w, h):
+    return [framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt) for fmt, bpp in FORMATS]
+
+def circle(w, h, n):
+    fbufs = new_fbufs(w, h)
+    for i in range(n):
+        for fb in fbufs:
+            for r in range(2, h // 2, 3):
+                fb.circle(w // 2, h // 2, r, r & 15)
+                fb.circle(r * 2, r, r, r & 15, 1)
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 25): (64, 64, 20),
+    (100, 100): (160, 128, 10),
+    (1000, 1000): (320, 240, 4),
+}
+
+def bm_setup(params):
+    return lambda: circle(*params), lambda: (params[2] * len(range(2, params[1] // 2, 3)) * 2 * len(FORMATS), None)
@@ -0,0 +1,26 @@
+# Fill whole framebufs, in the formats used for games on MEOWBIT
+
+import framebuf
+
+FORMATS = ((framebuf.RGB565, 16), (framebuf.PL8, 8), (framebuf.GS4_HMSB, 4))
+
+def new_fbufs(w, h):
+    return [framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt) for fmt, bpp in FORMATS]
+
+def fill(w, h, n):
+    fbufs = new_fbufs(w, h)
+    for i in range(n):
+        for fb in fbufs:
+            fb.fill(i & 15)
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 25): (64, 64, 50),
+    (100, 100): (160, 128, 20),
+    (1000, 1000): (320, 240, 10),
+}
+
+def bm_setup(params):
+    return lambda: fill(*params), lambda: (params[0] * params[1] * params[2] * len(FORMATS) // 1000, None)
@@ -0,0 +1,27 @@
+# Fill rectangles of various sizes and positions, some clipped
+
+import framebuf
+
+FORMATS = ((framebuf.RGB565, 16), (framebuf.PL8, 8), (framebuf.GS4_HMSB, 4))
+
+def new_fbufs(w, h):
+    return [framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt) for fmt, bpp in FORMATS]
+
+def fill_rect(w, h, n):
+    fbufs = new_fbufs(w, h)
+    for i in range(n):
+        for fb in fbufs:
+            for j in range(16):
+                fb.fill_rect(j * 7 - 8, j * 5 - 4, 8 + j * 3, 4 + j * 2, j)
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 25): (64, 64, 100),
+    (100, 100): (160, 128, 100),
+    (1000, 1000): (320, 240, 100),
+}
+
+def bm_setup(params):
+    return lambda: fill_rect(*params), lambda: (params[2] * 16 * len(FORMATS), None)
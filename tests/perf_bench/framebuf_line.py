@@ -0,0 +1,33 @@
+# Draw lines at all angles, radiating from the middle of the framebuf
+
+import framebuf
+
+FORMATS = ((framebuf.RGB565, 16), (framebuf.PL8, 8), (framebuf.GS4_HMSB, 4))
+
+def new_fbufs(w, h):
+    return [framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt) for fmt, bpp in FORMATS]
+
+def line(w, h, n):
+    fbufs = new_fbufs(w, h)
+    cx = w // 2
+    cy = h // 2
+    for i in range(n):
+        for fb in fbufs:
+            for x in range(0, w, 4):
+                fb.line(cx, cy, x, 0, x & 15)
+                fb.line(cx, cy, x, h - 1, x & 15)
+            for y in range(0, h, 4):
+                fb.line(cx, cy, 0, y, y & 15)
+                fb.line(cx, cy, w - 1, y, y & 15)
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 25): (64, 64, 10),
+    (100, 100): (160, 128, 5),
+    (1000, 1000): (320, 240, 2),
+}
+
+def bm_setup(params):
+    return lambda: line(*params), lambda: (2 * params[2] * ((params[0] + 3) // 4 + (params[1] + 3) // 4) * len(FORMATS), None)
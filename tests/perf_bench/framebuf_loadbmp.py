@@ -0,0 +1,46 @@
+# Decode 24-bit and 8-bit paletted BMP images from memory
+
+import framebuf, uio, ustruct
+
+FORMATS = ((framebuf.RGB565, 16), (framebuf.PL8, 8), (framebuf.GS4_HMSB, 4))
+
+def new_fbufs(w, h):
+    return [framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt) for fmt, bpp in FORMATS]
+
+def bmp(w, h, bpp):
+    row_len = (w * bpp + 31) // 32 * 4
+    ncolors = 256 if bpp == 8 else 0
+    data = bytearray(row_len * h)
+    for y in range(h):
+        for x in range(w):
+            if bpp == 8:
+                data[y * row_len + x] = (x ^ y) & 0xff
+            else:
+                data[y * row_len + x * 3:y * row_len + x * 3 + 3] = bytes((x & 0xff, y & 0xff, (x ^ y) & 0xff))
+    off = 14 + 40 + 4 * ncolors
+    head = ustruct.pack('<HIHHI', 0x4d42, off + len(data), 0, 0, off)
+    info = ustruct.pack('<IiiHHIIiiII', 40, w, h, 1, bpp, 0, len(data), 0, 0, ncolors, 0)
+    pal = bytearray(4 * ncolors)
+    for i in range(ncolors):
+        pal[i * 4:i * 4 + 3] = bytes((i, 255 - i, i >> 1))
+    return head + info + pal + data
+
+def loadbmp(w, h, n):
+    fbufs = new_fbufs(w, h)
+    images = (bmp(w, h, 24), bmp(w, h, 8))
+    for i in range(n):
+        for fb in fbufs:
+            for img in images:
+                fb.loadbmp(uio.BytesIO(img))
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 25): (32, 32, 2),
+    (100, 100): (80, 64, 2),
+    (1000, 1000): (160, 128, 1),
+}
+
+def bm_setup(params):
+    return lambda: loadbmp(*params), lambda: (params[0] * params[1] * params[2] * 2 * len(FORMATS) // 1000, None)
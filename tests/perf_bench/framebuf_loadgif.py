@@ -0,0 +1,72 @@
+# Decode GIF animations from memory, each frame covering the whole image, as
+# loadgif() does
+
+import framebuf, uio, ustruct
+
+FORMATS = ((framebuf.RGB565, 16), (framebuf.PL8, 8), (framebuf.GS4_HMSB, 4))
+
+def new_fbufs(w, h):
+    return [framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt) for fmt, bpp in FORMATS]
+
+def lzw(pixels):
+    # Each pixel is a 9-bit literal code, with a clear code often enough that
+    # the code size never grows.
+    out = bytearray()
+    acc = 0
+    nbits = 0
+    for i in range(len(pixels) + 1):
+        if i % 250 == 0 and i < len(pixels):
+            acc |= 256 << nbits
+            nbits += 9
+        acc |= (pixels[i] if i < len(pixels) else 257) << nbits
+        nbits += 9
+        while nbits >= 8:
+            out.append(acc & 0xff)
+            acc >>= 8
+            nbits -= 8
+    if nbits:
+        out.append(acc)
+    data = bytearray((8,))
+    for i in range(0, len(out), 255):
+        chunk = out[i:i + 255]
+        data.append(len(chunk))
+        data += chunk
+    data.append(0)
+    return data
+
+def gif(w, h, nframes):
+    pal = bytearray(768)
+    for i in range(256):
+        pal[i * 3:i * 3 + 3] = bytes((i, 255 - i, i >> 1))
+    data = b'GIF89a' + ustruct.pack('<HHBBB', w, h, 0xf7, 0, 0) + pal
+    for f in range(nframes):
+        pixels = bytearray(w * h)
+        for y in range(h):
+            for x in range(w):
+                pixels[y * w + x] = (x + y + f * 8) & 0xff
+        data += b'!\xf9\x04' + ustruct.pack('<BHBB', 0, 0, 0, 0)
+        data += b',' + ustruct.pack('<HHHHB', 0, 0, w, h, 0) + lzw(pixels)
+    return data + b';'
+
+def loadgif(w, h, n):
+    fbufs = new_fbufs(w, h)
+    anim = gif(w, h, 2)
+    for i in range(n):
+        for fb in fbufs:
+            # the frames are stepped through as loadgif() does, but without
+            # its sleep for each frame's delay
+            dec = framebuf.GIF(uio.BytesIO(anim))
+            while dec.next_frame(fb) is not None:
+                pass
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 25): (32, 32, 2),
+    (100, 100): (80, 64, 2),
+    (1000, 1000): (160, 128, 1),
+}
+
+def bm_setup(params):
+    return lambda: loadgif(*params), lambda: (params[0] * params[1] * params[2] * 2 * len(FORMATS) // 1000, None)
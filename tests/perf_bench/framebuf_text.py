@@ -0,0 +1,27 @@
+# Draw lines of text with the built-in 8x8 font
+
+import framebuf
+
+FORMATS = ((framebuf.RGB565, 16), (framebuf.PL8, 8), (framebuf.GS4_HMSB, 4))
+
+def new_fbufs(w, h):
+    return [framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt) for fmt, bpp in FORMATS]
+
+def text(w, h, n):
+    fbufs = new_fbufs(w, h)
+    for i in range(n):
+        for fb in fbufs:
+            for y in range(0, h, 8):
+                fb.text('Score %05d Lives 3' % (i * 10 + y), 0, y, y & 15)
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 25): (64, 64, 20),
+    (100, 100): (160, 128, 10),
+    (1000, 1000): (320, 240, 4),
+}
+
+def bm_setup(params):
+    return lambda: text(*params), lambda: (params[2] * ((params[1] + 7) // 8) * len(FORMATS), None)
@@ -0,0 +1,29 @@
+# Draw triangle outlines and filled triangles, some clipped
+
+import framebuf
+
+FORMATS = ((framebuf.RGB565, 16), (framebuf.PL8, 8), (framebuf.GS4_HMSB, 4))
+
+def new_fbufs(w, h):
+    return [framebuf.FrameBuffer(bytearray(w * h * bpp // 8), w, h, fmt) for fmt, bpp in FORMATS]
+
+def traingle(w, h, n):
+    fbufs = new_fbufs(w, h)
+    for i in range(n):
+        for fb in fbufs:
+            for j in range(16):
+                x = j * w // 16
+                fb.traingle(x, 0, w - 1 - x, h // 2, x // 2, h - 1, j)
+                fb.traingle(x - 8, j * 4, x + 24, j * 4 + 8, x, j * 4 + 40, j, 1)
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 25): (64, 64, 20),
+    (100, 100): (160, 128, 10),
+    (1000, 1000): (320, 240, 4),
+}
+
+def bm_setup(params):
+    return lambda: traingle(*params), lambda: (params[2] * 32 * len(FORMATS), None)
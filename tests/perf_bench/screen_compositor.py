@@ -0,0 +1,36 @@
+# Move sprites over a tile map on the MEOWBIT screen with a Compositor, which
+# redraws only the tiles under where they were and where they are
+
+import framebuf, pyb
+
+def compose(n):
+    screen = pyb.SCREEN()
+    sheet = framebuf.FrameBuffer(bytearray(32 * 8 * 2), 32, 8, framebuf.RGB565)
+    for i in range(4):
+        sheet.fill_rect(i * 8, 0, 8, 8, i * 0x404040)
+    cells = bytearray(i % 4 for i in range(20 * 16))
+    tm = framebuf.TileMap(sheet, 8, 8, cells, 20)
+    spr_fb = framebuf.FrameBuffer(bytearray(16 * 16 * 2), 16, 16, framebuf.RGB565)
+    spr_fb.fill(0)
+    spr_fb.fill_rect(2, 2, 12, 12, 0xffff00)
+    spr = framebuf.Sprite(spr_fb, 0)
+    comp = framebuf.Compositor(screen, 160, 128)
+    comp.layer(tm)
+    sprites = [comp.layer(spr, 20 * i, 10 * i) for i in range(4)]
+    comp.update()
+    for i in range(n):
+        for s in sprites:
+            comp.move(s, (20 * s + 3 * i) % 144, (10 * s + 2 * i) % 112)
+        comp.update()
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 40): (10,),
+    (100, 40): (40,),
+    (1000, 40): (400,),
+}
+
+def bm_setup(params):
+    return lambda: compose(*params), lambda: (params[0], None)
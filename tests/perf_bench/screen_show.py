@@ -0,0 +1,21 @@
+# Send whole RGB565 frames to the MEOWBIT screen
+
+import pyb
+
+def show(n):
+    screen = pyb.SCREEN()
+    buf = bytearray(160 * 128 * 2)
+    for i in range(n):
+        screen.show(buf)
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 40): (5,),
+    (100, 40): (20,),
+    (1000, 40): (100,),
+}
+
+def bm_setup(params):
+    return lambda: show(*params), lambda: (params[0], None)
@@ -0,0 +1,24 @@
+# Send whole PL8 and GS4 frames to the MEOWBIT screen, expanded through the
+# palette as they go
+
+import pyb
+
+def show_palette(n):
+    screen = pyb.SCREEN()
+    pl8 = bytearray(160 * 128)
+    gs4 = bytearray(160 * 128 // 2)
+    for i in range(n):
+        screen.show(pl8, 1)
+        screen.show(gs4, 1)
+
+###########################################################################
+# Benchmark interface
+
+bm_params = {
+    (50, 40): (5,),
+    (100, 40): (20,),
+    (1000, 40): (100,),
+}
+
+def bm_setup(params):
+    return lambda: show_palette(*params), lambda: (params[0], None)
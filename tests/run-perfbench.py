@@ -8,6 +8,8 @@ import os
 import subprocess
 import sys
 import argparse
+import json
+import time
 from glob import glob
 
 sys.path.append('../tools')
@@ -24,6 +26,7 @@ else:
 PYTHON_TRUTH = CPYTHON3
 
 BENCH_SCRIPT_DIR = 'perf_bench/'
+TARGET_CONFIG_DIR = BENCH_SCRIPT_DIR + 'targets/'
 
 def compute_stats(lst):
     avg = 0
@@ -77,13 +80,18 @@ def run_benchmark_on_target(target, script):
         return -1, -1, 'CRASH: %r' % err
 
 def run_benchmarks(target, param_n, param_m, n_average, test_list):
+    results = {}
     skip_native = run_feature_test(target, 'native_check') != ''
+    skip_framebuf = run_feature_test(target, 'framebuf_check') != ''
+    skip_screen = run_feature_test(target, 'screen_check') != ''
 
     for test_file in sorted(test_list):
         print(test_file + ': ', end='')
 
         # Check if test should be skipped
-        skip = skip_native and test_file.find('viper_') != -1
+        skip = (skip_native and test_file.find('viper_') != -1
+            or skip_framebuf and test_file.find('framebuf_') != -1
+            or skip_screen and test_file.find('screen_') != -1)
         if skip:
             print('skip')
             continue
@@ -131,12 +139,71 @@ def run_benchmarks(target, param_n, param_m, n_average, test_list):
             t_avg, t_sd = compute_stats(times)
             s_avg, s_sd = compute_stats(scores)
             print('{:.2f} {:.4f} {:.2f} {:.4f}'.format(t_avg, 100 * t_sd / t_avg, s_avg, 100 * s_sd / s_avg))
+            results[test_file.rsplit('/')[-1]] = {'times': times, 'scores': scores}
             if 0:
                 print('  times: ', times)
                 print('  scores:', scores)
 
         sys.stdout.flush()
 
+    return results
+
+def load_target_config(name):
+    with open(TARGET_CONFIG_DIR + name + '.json') as f:
+        return json.load(f)
+
+def git_describe():
+    try:
+        return subprocess.check_output(['git', 'describe', '--always', '--dirty'],
+            stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return 'unknown'
+
+def db_append(db_file, record):
+    with open(db_file, 'a') as f:
+        f.write(json.dumps(record, sort_keys=True) + '\n')
+
+def db_find_baseline(db_file, record, label):
+    # The latest run with the label, or the latest of all if label is 'last',
+    # with the same target, parameters and emitter
+    found = None
+    try:
+        with open(db_file) as f:
+            for l in f:
+                r = json.loads(l)
+                if (all(r[k] == record[k] for k in ('target', 'N', 'M', 'emit'))
+                        and (label == 'last' or r['label'] == label)):
+                    found = r
+    except FileNotFoundError:
+        pass
+    return found
+
+def compare_baseline(base, record, threshold):
+    # Compare mean times, and count a slowdown of more than threshold percent
+    # as a regression if it's also significant: more than 2 standard errors
+    print('baseline {} ({}) -> {}'.format(base['label'], base['date'], record['label']))
+    regressions = []
+    for name, res in sorted(record['results'].items()):
+        if name not in base['results']:
+            continue
+        times1 = base['results'][name]['times']
+        times2 = res['times']
+        av1, sd1 = compute_stats(times1)
+        av2, sd2 = compute_stats(times2)
+        se_diff = (sd1 ** 2 / len(times1) + sd2 ** 2 / len(times2)) ** 0.5
+        percent = 100 * (av2 - av1) / av1
+        significant = abs(av2 - av1) > 2 * se_diff
+        if significant and percent > threshold:
+            verdict = 'REGRESSION'
+            regressions.append(name)
+        elif significant and percent < -threshold:
+            verdict = 'faster'
+        else:
+            verdict = ''
+        print('{:24} {:10.2f} -> {:10.2f} : {:+7.3f}% (+/-{:.2f}%) {}'.format(
+            name, av1, av2, percent, 200 * se_diff / av1, verdict))
+    return regressions
+
 def parse_output(filename):
     with open(filename) as f:
         params = f.readline()
@@ -196,25 +263,52 @@ def main():
     cmd_parser.add_argument('-d', '--device', default='/dev/ttyACM0', help='the device for pyboard.py')
     cmd_parser.add_argument('-a', '--average', default='8', help='averaging number')
     cmd_parser.add_argument('--emit', default='bytecode', help='MicroPython emitter to use (bytecode or native)')
-    cmd_parser.add_argument('N', nargs=1, help='N parameter (approximate target CPU frequency)')
-    cmd_parser.add_argument('M', nargs=1, help='M parameter (approximate target heap in kbytes)')
+    cmd_parser.add_argument('--target', help='board config from ' + TARGET_CONFIG_DIR + ', giving N, M and the device or executable')
+    cmd_parser.add_argument('--db', help='JSON lines file to append the results to')
+    cmd_parser.add_argument('--label', help='label for the results in the db (default: git describe)')
+    cmd_parser.add_argument('--baseline', help='label of results in the db to compare with, or "last"; exits with status 1 on a regression')
+    cmd_parser.add_argument('--threshold', type=float, default=3, help='slowdown in percent that counts as a regression')
+    cmd_parser.add_argument('N', nargs='?', help='N parameter (approximate target CPU frequency)')
+    cmd_parser.add_argument('M', nargs='?', help='M parameter (approximate target heap in kbytes)')
     cmd_parser.add_argument('files', nargs='*', help='input test files')
     args = cmd_parser.parse_args()
 
     if args.diff_time or args.diff_score:
-        compute_diff(args.N[0], args.M[0], args.diff_score)
+        compute_diff(args.N, args.M, args.diff_score)
         sys.exit(0)
 
+    if args.target:
+        config = load_target_config(args.target)
+        # with a target, N and M may be left out, and then any files follow
+        if args.N is not None and not args.N.isdigit():
+            args.files = [args.N] + ([args.M] if args.M is not None else []) + args.files
+            args.N = args.M = None
+        args.pyboard = args.pyboard or config.get('pyboard', False)
+        if args.device == cmd_parser.get_default('device'):
+            args.device = config.get('device', args.device)
+        if args.average == cmd_parser.get_default('average'):
+            args.average = str(config.get('average', args.average))
+        if args.N is None:
+            args.N = str(config['N'])
+            args.M = str(config['M'])
+    if args.N is None or args.M is None:
+        cmd_parser.error('N and M are needed, or a --target')
+    if args.baseline and not args.db:
+        cmd_parser.error('--baseline needs a --db')
+
     # N, M = 50, 25 # esp8266
     # N, M = 100, 100 # pyboard, esp32
     # N, M = 1000, 1000 # PC
-    N = int(args.N[0])
-    M = int(args.M[0])
+    N = int(args.N)
+    M = int(args.M)
     n_average = int(args.average)
 
     if args.pyboard:
         target = pyboard.Pyboard(args.device)
         target.enter_raw_repl()
+    elif args.target and 'executable' in config:
+        # a host build standing in for the board, eg run under qemu-arm
+        target = config['executable'] + ['-X', 'emit=' + args.emit]
     else:
         target = [MICROPYTHON, '-X', 'emit=' + args.emit]
 
@@ -232,11 +326,33 @@ def main():
 
     print('N={} M={} n_average={}'.format(N, M, n_average))
 
-    run_benchmarks(target, N, M, n_average, tests)
+    results = run_benchmarks(target, N, M, n_average, tests)
 
     if isinstance(target, pyboard.Pyboard):
         target.exit_raw_repl()
         target.close()
 
+    if args.db:
+        record = {
+            'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+            'label': args.label or git_describe(),
+            'target': args.target or ('pyboard' if args.pyboard else 'unix'),
+            'N': N,
+            'M': M,
+            'emit': args.emit,
+            'results': results,
+        }
+        base = None
+        if args.baseline:
+            # look for the baseline before adding this run, for 'last'
+            base = db_find_baseline(args.db, record, args.baseline)
+        db_append(args.db, record)
+        if args.baseline:
+            if base is None:
+                print('no baseline {} in {}'.format(args.baseline, args.db))
+                sys.exit(1)
+            if compare_baseline(base, record, args.threshold):
+                sys.exit(1)
+
 if __name__ == "__main__":
     main()
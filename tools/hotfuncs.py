@@ -0,0 +1,92 @@
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Pick the hot functions out of profiles taken with micropython.profile().
+
+A profile file holds what the board printed for micropython.profile(), or
+just its first element, the list of (file, function, count) tuples, eg
+saved with:
+
+    pyboard.py -c "import micropython; print(micropython.profile()[0])" > game.prof
+
+Used by mpy_cross_all.py and mpy-tool.py with their --profile option, and
+by the build for FROZEN_MPY_PROFILE, running this script to get the
+mpy-cross option for each frozen module.
+"""
+
+import ast
+
+
+def read_profile(filename):
+    """Return {(file, function): count} summed over the profile file."""
+    with open(filename) as f:
+        prof = ast.literal_eval(f.read().strip())
+    if isinstance(prof, tuple):
+        # the whole result of micropython.profile(); use the per-function list
+        prof = prof[0]
+    counts = {}
+    for file, func, count in prof:
+        if file is None or func is None:
+            continue
+        counts[(file, func)] = counts.get((file, func), 0) + count
+    return counts
+
+
+def hot_functions(filenames, fraction):
+    """Return {file: [function, ...]} for the functions with the most samples
+    over all the given profiles, enough to cover fraction of the samples.
+
+    Module level code, lambdas and comprehensions can't be selected by name,
+    so they are left out.
+    """
+    counts = {}
+    for filename in filenames:
+        for key, count in read_profile(filename).items():
+            counts[key] = counts.get(key, 0) + count
+    total = sum(counts.values())
+    hot = {}
+    covered = 0
+    for (file, func), count in sorted(counts.items(), key=lambda x: -x[1]):
+        if covered >= fraction * total:
+            break
+        covered += count
+        if not func.startswith('<'):
+            hot.setdefault(file, []).append(func)
+    return hot
+
+
+def main():
+    import argparse
+    cmd_parser = argparse.ArgumentParser(description='Print the mpy-cross option to emit the hot functions of a module as native code.')
+    cmd_parser.add_argument('-s', '--source', required=True, help='name of the module\'s source file, as given to mpy-cross -s')
+    cmd_parser.add_argument('--hot', type=float, default=0.8,
+                            help='fraction of the samples that the hot functions cover (default 0.8)')
+    cmd_parser.add_argument('profiles', nargs='+', help='micropython.profile() output files')
+    args = cmd_parser.parse_args()
+    funcs = hot_functions(args.profiles, args.hot).get(args.source)
+    if funcs:
+        print('-mnative=' + ','.join(funcs))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Report flash and RAM use per object file and per feature from a GNU ld map.
+
+Flash counts the code and read-only data of each object plus the initial
+values of its .data, which are copied from flash at reset; RAM counts its
+.data and .bss.  The heap and stack are reserved by the linker script, not
+by objects, so they are not included.
+
+Objects are grouped into features: py for the core, extmod/<feature> for
+each extension module (eg extmod/framebuf), lib/<dir> and drivers/<dir>,
+port for the port's own files, the archive name for library code and
+(toolchain) for other objects given by absolute path, eg startup files.  The
+output is sorted by name so that the reports of two builds can be diffed,
+or compared directly with -c:
+
+    mapsize.py --strip build-MEOWBIT/ build-MEOWBIT/firmware.map
+    mapsize.py --strip build-MEOWBIT/ -c old.map build-MEOWBIT/firmware.map
+"""
+
+from __future__ import print_function
+import argparse
+import os
+import re
+import sys
+
+# output sections that occupy no space on the target
+NOLOAD_SECTIONS = ('.debug', '.comment', '.ARM.attributes', '.stab', '.gnu.attributes', '.heap', '.stack')
+
+RE_OUTPUT = re.compile(r'^(\.\S+|COMMON)(?:\s+0x[0-9a-fA-F]+\s+0x[0-9a-fA-F]+)?\s*$')
+RE_INPUT = re.compile(r'^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+RE_INPUT_NAME = re.compile(r'^ (\S+)$')
+RE_INPUT_CONT = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+RE_FILL = re.compile(r'^ \*fill\*\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)')
+
+
+def section_kind(name):
+    """Return (in_flash, in_ram) for an output section."""
+    if name.startswith(NOLOAD_SECTIONS):
+        return False, False
+    if name.startswith(('.bss', '.tbss', '.noinit')):
+        return False, True
+    if name.startswith(('.data', '.tdata')) and not name.startswith('.data.rel.ro'):
+        return True, True
+    return True, False
+
+
+def parse_map(filename, strip=''):
+    """Return {object: [flash, ram]} for the allocated input sections of a map."""
+    sizes = {}
+    with open(filename) as f:
+        lines = iter(f.read().splitlines())
+    for line in lines:
+        if line.startswith('Linker script and memory map'):
+            break
+    kind = (False, False)
+    pending = None
+    for line in lines:
+        if pending is not None:
+            # second line of an input section whose name was too long
+            m = RE_INPUT_CONT.match(line)
+            pending = None
+            if m:
+                _add(sizes, m.group(3), int(m.group(2), 16), kind, strip)
+                continue
+        m = RE_OUTPUT.match(line)
+        if m:
+            kind = section_kind(m.group(1))
+            continue
+        m = RE_FILL.match(line)
+        if m:
+            _add(sizes, '(fill)', int(m.group(1), 16), kind, '')
+            continue
+        m = RE_INPUT.match(line)
+        if m:
+            _add(sizes, m.group(4), int(m.group(3), 16), kind, strip)
+            continue
+        if RE_INPUT_NAME.match(line):
+            pending = line
+    return sizes
+
+
+def _add(sizes, obj, size, kind, strip):
+    if size == 0 or kind == (False, False):
+        return
+    obj = obj.strip()
+    if strip and obj.startswith(strip):
+        obj = obj[len(strip):]
+    entry = sizes.setdefault(obj, [0, 0])
+    if kind[0]:
+        entry[0] += size
+    if kind[1]:
+        entry[1] += size
+
+
+def feature(obj):
+    """Return the feature group that an object belongs to."""
+    if obj.startswith('('):
+        return obj
+    m = re.match(r'(.*?\.a)\(', obj)
+    if m:
+        return os.path.basename(m.group(1))
+    if os.path.isabs(obj):
+        return '(toolchain)'
+    parts = obj.split('/')
+    if parts[0] == 'py':
+        return 'py'
+    if parts[0] == 'extmod' and len(parts) == 2:
+        name = os.path.splitext(parts[1])[0]
+        if name.startswith('mod'):
+            name = name[3:]
+        return 'extmod/' + name.split('_')[0]
+    if parts[0] in ('lib', 'drivers', 'extmod') and len(parts) > 2:
+        return parts[0] + '/' + parts[1]
+    return 'port'
+
+
+def group(sizes):
+    groups = {}
+    for obj, (flash, ram) in sizes.items():
+        entry = groups.setdefault(feature(obj), [0, 0])
+        entry[0] += flash
+        entry[1] += ram
+    return groups
+
+
+def total(sizes):
+    return [sum(v[0] for v in sizes.values()), sum(v[1] for v in sizes.values())]
+
+
+def print_table(title, sizes):
+    print('%8s %8s  %s' % ('flash', 'ram', title))
+    for name in sorted(sizes):
+        print('%8u %8u  %s' % (sizes[name][0], sizes[name][1], name))
+    print()
+
+
+def print_compare(title, old, new):
+    print('%8s %8s  %s' % ('flash', 'ram', title))
+    for name in sorted(set(old) | set(new)):
+        o = old.get(name, (0, 0))
+        n = new.get(name, (0, 0))
+        if o[0] != n[0] or o[1] != n[1]:
+            print('%+8d %+8d  %s' % (n[0] - o[0], n[1] - o[1], name))
+    print()
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description='Report flash and RAM use per object and feature from a linker map.')
+    cmd_parser.add_argument('--strip', default='', help='prefix to remove from object paths, eg the build directory')
+    cmd_parser.add_argument('-c', '--compare', metavar='OLD', help='map of an earlier build to report the change from')
+    cmd_parser.add_argument('-g', '--groups-only', action='store_true', help='report features only, not each object')
+    cmd_parser.add_argument('map', help='linker map file')
+    args = cmd_parser.parse_args()
+    try:
+        new = parse_map(args.map, args.strip)
+        old = parse_map(args.compare, args.strip) if args.compare else None
+    except IOError as er:
+        print('error: %s' % er, file=sys.stderr)
+        sys.exit(1)
+    if old is None:
+        if not args.groups_only:
+            print_table('object', new)
+        print_table('feature', group(new))
+        print('%8u %8u  total' % tuple(total(new)))
+    else:
+        if not args.groups_only:
+            print_compare('object', old, new)
+        print_compare('feature', group(old), group(new))
+        o, n = total(old), total(new)
+        print('%+8d %+8d  total' % (n[0] - o[0], n[1] - o[1]))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+"""Pack files into an asset image for pyb.Asset.
+
+The image is a table of names, offsets and lengths followed by the data of
+each file, 4 byte aligned, so a board reads an asset at a fixed place in
+flash without a filesystem.  Each file is named by its base name unless
+given as name=path.
+
+    mkassets.py -o assets.img tiles.fbi music=sound/music.raw
+
+Copy the image to the board and program it with pyb.Asset.load(file).
+"""
+
+from __future__ import print_function
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b'AST1'
+NAME_LEN = 24
+ENTRY_SIZE = NAME_LEN + 8
+
+
+def make_image(assets):
+    """Return the image holding the (name, data) pairs in assets."""
+    names = set()
+    offset = 8 + ENTRY_SIZE * len(assets)
+    table = bytearray()
+    data = bytearray()
+    for name, blob in assets:
+        encoded = name.encode('utf-8')
+        if len(encoded) > NAME_LEN:
+            raise ValueError('name longer than %d bytes: %s' % (NAME_LEN, name))
+        if name in names:
+            raise ValueError('duplicate name: %s' % name)
+        names.add(name)
+        pad = -(offset + len(data)) % 4
+        data += b'\0' * pad
+        table += struct.pack('<%dsII' % NAME_LEN, encoded, offset + len(data), len(blob))
+        data += blob
+    return MAGIC + struct.pack('<I', len(assets)) + table + data
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description='Pack files into an asset image.')
+    cmd_parser.add_argument('-o', '--output', required=True, help='output image file')
+    cmd_parser.add_argument('-s', '--size', type=int, help='size of the asset partition in bytes, to check the image fits')
+    cmd_parser.add_argument('files', nargs='+', help='files to pack, as path or name=path')
+    args = cmd_parser.parse_args()
+    assets = []
+    for arg in args.files:
+        name, sep, path = arg.partition('=')
+        if not sep:
+            name, path = os.path.basename(arg), arg
+        with open(path, 'rb') as f:
+            assets.append((name, f.read()))
+    try:
+        image = make_image(assets)
+        if args.size is not None and len(image) > args.size:
+            raise ValueError('image is %d bytes, partition is %d' % (len(image), args.size))
+    except ValueError as er:
+        print('error: %s' % er, file=sys.stderr)
+        sys.exit(1)
+    with open(args.output, 'wb') as f:
+        f.write(image)
+
+
+if __name__ == '__main__':
+    main()
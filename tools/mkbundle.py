@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Convert images and pack them, with other files, into one asset bundle.
+
+BMP, PNG and GIF images are converted to .fbi files, as by mkfbi.py, so the
+board loads them with framebuf.load() or loadfbi() without decoding.  Other
+files are packed as they are.  Each input is given as [name=]path[:format],
+where format overrides -f for one image; an image is named by its base name
+with the extension changed to .fbi.
+
+With -z every entry is deflated with a zlib header and gets a .z suffix.
+The window is kept small (-w, default 10 bits) so that uzlib.DecompIO
+needs only that much RAM to inflate it on the board:
+
+    framebuf.load(uzlib.DecompIO(pyb.Asset('tiles.fbi.z')))
+
+The output is an asset image for pyb.Asset, as made by mkassets.py, or with
+--module a Python module holding a dict ASSETS of name to bytes, for
+freezing into the firmware and reading with uio.BytesIO:
+
+    mkbundle.py -f pl8 -z -o assets.img tiles.png logo.gif:rgb565 music.raw
+    mkbundle.py --module -o assets.py tiles.png
+"""
+
+from __future__ import print_function
+import argparse
+import os
+import sys
+import zlib
+
+import mkassets
+import mkfbi
+
+IMAGE_EXTS = ('.bmp', '.png', '.gif')
+
+
+def make_entry(name, path, fmt, window):
+    """Return the (name, data) entry for one input file."""
+    base, ext = os.path.splitext(path)
+    if ext.lower() in IMAGE_EXTS:
+        if name is None:
+            name = os.path.basename(base) + '.fbi'
+        data = mkfbi.convert(*mkfbi.read_image(path), fmt=fmt)
+    else:
+        if name is None:
+            name = os.path.basename(path)
+        with open(path, 'rb') as f:
+            data = f.read()
+    if window:
+        comp = zlib.compressobj(9, zlib.DEFLATED, window)
+        data = comp.compress(data) + comp.flush()
+        name += '.z'
+    return name, data
+
+
+def parse_input(arg, default_fmt):
+    """Split [name=]path[:format] into (name, path, format)."""
+    name, sep, path = arg.partition('=')
+    if not sep:
+        name, path = None, arg
+    fmt = default_fmt
+    head, sep, tail = path.rpartition(':')
+    if sep and tail in mkfbi.FORMATS:
+        path, fmt = head, tail
+    return name, path, fmt
+
+
+def make_module(assets):
+    """Return Python source for a module holding the assets."""
+    out = ['# asset bundle generated by mkbundle.py', 'ASSETS = {']
+    for name, data in assets:
+        out.append('    %r: %r,' % (name, bytes(data)))
+    out.append('}')
+    return '\n'.join(out) + '\n'
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description='Convert images and pack files into an asset bundle.')
+    cmd_parser.add_argument('-o', '--output', required=True, help='output file')
+    cmd_parser.add_argument('-f', '--format', choices=sorted(mkfbi.FORMATS), default='rgb565',
+                            help='pixel format of converted images (default rgb565)')
+    cmd_parser.add_argument('-z', '--deflate', action='store_true',
+                            help='deflate each entry for uzlib.DecompIO')
+    cmd_parser.add_argument('-w', '--window', type=int, default=10, choices=range(9, 16),
+                            metavar='BITS', help='deflate window size in bits, 9 to 15 (default 10)')
+    cmd_parser.add_argument('-s', '--size', type=int, help='size of the asset partition in bytes, to check the image fits')
+    cmd_parser.add_argument('--module', action='store_true',
+                            help='write a Python module to freeze instead of an asset image')
+    cmd_parser.add_argument('files', nargs='+', help='files to pack, as [name=]path[:format]')
+    args = cmd_parser.parse_args()
+    try:
+        assets = []
+        for arg in args.files:
+            name, path, fmt = parse_input(arg, args.format)
+            assets.append(make_entry(name, path, fmt, args.deflate and args.window))
+        if args.module:
+            out = make_module(assets).encode('utf-8')
+        else:
+            out = mkassets.make_image(assets)
+            if args.size is not None and len(out) > args.size:
+                raise ValueError('image is %d bytes, partition is %d' % (len(out), args.size))
+    except (IOError, ValueError) as er:
+        print('error: %s' % er, file=sys.stderr)
+        sys.exit(1)
+    with open(args.output, 'wb') as f:
+        f.write(out)
+    for name, data in assets:
+        print('%-24s %7u' % (name, len(data)))
+    print('%-24s %7u' % ('total', len(out)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,322 @@
+#!/usr/bin/env python3
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Convert BMP, PNG and GIF images to .fbi files for framebuf.load() and loadfbi().
+
+An .fbi file holds pixels already in a framebuffer format, so the board
+reads them without decoding.  Uncompressed 24 and 32 bit BMPs and
+non-interlaced 8 bit PNGs can be converted to rgb565 or gs4; paletted BMPs,
+PNGs and GIFs also to pl8, keeping their palette.  Only the first frame of
+a GIF is used, and alpha is dropped.
+
+    mkfbi.py [-f rgb565|pl8|gs4] input.bmp output.fbi
+"""
+
+from __future__ import print_function
+import argparse
+import struct
+import sys
+import zlib
+
+# framebuf format constants
+FORMATS = {'rgb565': 1, 'gs4': 2, 'pl8': 6}
+
+
+def rgb565(r, g, b):
+    return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3
+
+
+def read_bmp(filename):
+    """Return (width, height, rows, palette).
+
+    rows is a list of rows, top first, of (r, g, b) tuples for true colour
+    images or of palette indices.  palette is a list of (r, g, b) or None.
+    """
+    with open(filename, 'rb') as f:
+        data = f.read()
+    if data[:2] != b'BM':
+        raise ValueError('not a bmp')
+    off, = struct.unpack_from('<I', data, 10)
+    hsize, w, h, planes, bpp, comp = struct.unpack_from('<IiiHHI', data, 14)
+    if comp not in (0, 3) or bpp not in (8, 24, 32) or (bpp == 8 and comp != 0):
+        raise ValueError('unsupported bmp: %d bit, compression %d' % (bpp, comp))
+    palette = None
+    if bpp == 8:
+        ncolors, = struct.unpack_from('<I', data, 46)
+        ncolors = ncolors or 256
+        pos = 14 + hsize
+        palette = [(data[pos + 4 * i + 2], data[pos + 4 * i + 1], data[pos + 4 * i])
+                   for i in range(ncolors)]
+    top_down = h < 0
+    h = abs(h)
+    row_len = (w * bpp + 31) // 32 * 4
+    rows = []
+    for r in range(h):
+        p = off + r * row_len
+        if bpp == 8:
+            rows.append(list(data[p:p + w]))
+        else:
+            n = bpp // 8
+            rows.append([(data[p + n * i + 2], data[p + n * i + 1], data[p + n * i])
+                         for i in range(w)])
+    if not top_down:
+        rows.reverse()
+    return w, h, rows, palette
+
+
+def _png_unfilter(data, h, row_len, bpp):
+    """Undo the per-row filters of decompressed PNG data."""
+    rows = []
+    prev = bytearray(row_len)
+    pos = 0
+    for _ in range(h):
+        ftype = data[pos]
+        row = bytearray(data[pos + 1:pos + 1 + row_len])
+        pos += 1 + row_len
+        for i in range(row_len):
+            a = row[i - bpp] if i >= bpp else 0
+            b = prev[i]
+            if ftype == 1:
+                row[i] = (row[i] + a) & 0xff
+            elif ftype == 2:
+                row[i] = (row[i] + b) & 0xff
+            elif ftype == 3:
+                row[i] = (row[i] + ((a + b) >> 1)) & 0xff
+            elif ftype == 4:
+                c = prev[i - bpp] if i >= bpp else 0
+                pa, pb, pc = abs(b - c), abs(a - c), abs(a + b - 2 * c)
+                row[i] = (row[i] + (a if pa <= pb and pa <= pc else b if pb <= pc else c)) & 0xff
+            elif ftype != 0:
+                raise ValueError('bad png filter %d' % ftype)
+        rows.append(row)
+        prev = row
+    return rows
+
+
+def read_png(filename):
+    """Return (width, height, rows, palette) for a PNG, as read_bmp()."""
+    with open(filename, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('not a png')
+    pos = 8
+    idat = bytearray()
+    palette = None
+    while pos < len(data):
+        ln, kind = struct.unpack_from('>I4s', data, pos)
+        chunk = data[pos + 8:pos + 8 + ln]
+        pos += 12 + ln
+        if kind == b'IHDR':
+            w, h, depth, ctype, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+        elif kind == b'PLTE':
+            palette = [tuple(chunk[i:i + 3]) for i in range(0, len(chunk), 3)]
+        elif kind == b'IDAT':
+            idat += chunk
+        elif kind == b'IEND':
+            break
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}.get(ctype)
+    if channels is None or interlace or not (depth == 8 or (channels == 1 and depth < 8)):
+        raise ValueError('unsupported png: %d bit, colour type %d%s'
+                         % (depth, ctype, ', interlaced' if interlace else ''))
+    row_len = (w * channels * depth + 7) // 8
+    raw = _png_unfilter(zlib.decompress(bytes(idat)), h, row_len, max(1, channels * depth // 8))
+    rows = []
+    for raw_row in raw:
+        if depth < 8:
+            # unpack 1, 2 or 4 bit samples, most significant first
+            per = 8 // depth
+            mask = (1 << depth) - 1
+            row = [raw_row[i // per] >> (8 - depth * (i % per + 1)) & mask for i in range(w)]
+        else:
+            row = list(raw_row)
+        if ctype == 3:
+            rows.append(row)
+        elif ctype in (0, 4):
+            if depth < 8:
+                row = [v * 255 // mask for v in row]
+            rows.append([(v, v, v) for v in row[::channels]])
+        else:
+            rows.append([tuple(row[i:i + 3]) for i in range(0, len(row), channels)])
+    if ctype != 3:
+        palette = None
+    return w, h, rows, palette
+
+
+def _gif_lzw(data, min_size, npixels):
+    """Decode GIF LZW data into a list of palette indices."""
+    clear = 1 << min_size
+    out = []
+    size = min_size + 1
+    table = [[i] for i in range(clear)] + [None, None]
+    prev = None
+    bits = nbits = 0
+    pos = 0
+    while len(out) < npixels:
+        while nbits < size:
+            if pos >= len(data):
+                return out
+            bits |= data[pos] << nbits
+            nbits += 8
+            pos += 1
+        code = bits & ((1 << size) - 1)
+        bits >>= size
+        nbits -= size
+        if code == clear:
+            size = min_size + 1
+            table = table[:clear + 2]
+            prev = None
+            continue
+        if code == clear + 1:
+            break
+        if code < len(table):
+            entry = table[code]
+            if prev is not None and len(table) < 4096:
+                table.append(prev + entry[:1])
+        elif prev is not None and code == len(table):
+            entry = prev + prev[:1]
+            table.append(entry)
+        else:
+            raise ValueError('bad gif data')
+        out.extend(entry)
+        prev = entry
+        if len(table) == 1 << size and size < 12:
+            size += 1
+    return out
+
+
+def read_gif(filename):
+    """Return (width, height, rows, palette) for the first frame of a GIF."""
+    with open(filename, 'rb') as f:
+        data = f.read()
+    if data[:6] not in (b'GIF87a', b'GIF89a'):
+        raise ValueError('not a gif')
+    w, h, flags, bg = struct.unpack_from('<HHBB', data, 6)
+    pos = 13
+    palette = None
+    if flags & 0x80:
+        n = 2 << (flags & 7)
+        palette = [tuple(data[pos + 3 * i:pos + 3 * i + 3]) for i in range(n)]
+        pos += 3 * n
+    while data[pos] == 0x21:
+        # skip extension blocks
+        pos += 2
+        while data[pos]:
+            pos += data[pos] + 1
+        pos += 1
+    if data[pos] != 0x2c:
+        raise ValueError('no image in gif')
+    fx, fy, fw, fh, fflags = struct.unpack_from('<HHHHB', data, pos + 1)
+    pos += 10
+    if fflags & 0x80:
+        n = 2 << (fflags & 7)
+        palette = [tuple(data[pos + 3 * i:pos + 3 * i + 3]) for i in range(n)]
+        pos += 3 * n
+    if palette is None:
+        raise ValueError('gif has no palette')
+    min_size = data[pos]
+    pos += 1
+    lzw = bytearray()
+    while data[pos]:
+        lzw += data[pos + 1:pos + 1 + data[pos]]
+        pos += data[pos] + 1
+    pixels = _gif_lzw(lzw, min_size, fw * fh)
+    pixels += [bg] * (fw * fh - len(pixels))
+    order = list(range(fh))
+    if fflags & 0x40:
+        # interlaced rows are stored in four passes
+        order = list(range(0, fh, 8)) + list(range(4, fh, 8)) + list(range(2, fh, 4)) + list(range(1, fh, 2))
+    rows = [[bg] * w for _ in range(h)]
+    for i, y in enumerate(order):
+        if fy + y < h:
+            line = pixels[i * fw:(i + 1) * fw]
+            rows[fy + y][fx:fx + fw] = line[:max(0, w - fx)]
+    for row in rows:
+        del row[w:]
+    return w, h, rows, palette
+
+
+def read_image(filename):
+    """Read a BMP, PNG or GIF, chosen by its first bytes."""
+    with open(filename, 'rb') as f:
+        magic = f.read(4)
+    if magic[:2] == b'BM':
+        return read_bmp(filename)
+    elif magic == b'\x89PNG':
+        return read_png(filename)
+    elif magic[:3] == b'GIF':
+        return read_gif(filename)
+    raise ValueError('not a bmp, png or gif: %s' % filename)
+
+
+def convert(w, h, rows, palette, fmt):
+    """Return the .fbi file contents for the image in the named format."""
+    if fmt == 'pl8' and palette is None:
+        raise ValueError('pl8 needs a paletted image')
+    if palette is not None and fmt != 'pl8':
+        rows = [[palette[i] for i in row] for row in rows]
+        palette = None
+    if len(palette or ()) > 256:
+        raise ValueError('palette has more than 256 colours')
+    stride = w
+    pixels = bytearray()
+    if fmt == 'rgb565':
+        for row in rows:
+            for c in row:
+                # big endian, as held in an RGB565 framebuffer
+                pixels += struct.pack('>H', rgb565(*c))
+    elif fmt == 'pl8':
+        for row in rows:
+            pixels += bytes(row)
+    else:
+        stride = (w + 1) & ~1
+        palette = [(v * 17, v * 17, v * 17) for v in range(16)]
+        for row in rows:
+            levels = [(r * 77 + g * 150 + b * 29) >> 12 for r, g, b in row]
+            levels += [0] * (stride - w)
+            for i in range(0, stride, 2):
+                pixels.append(levels[i] << 4 | levels[i + 1])
+    palette = palette or []
+    head = b'FBI\x01' + struct.pack('<BBHHHHH', FORMATS[fmt], 0, w, h, stride, len(palette), 0)
+    pal = b''.join(struct.pack('<H', rgb565(*c)) for c in palette)
+    return head + pal + pixels
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description='Convert a BMP, PNG or GIF image to an .fbi file.')
+    cmd_parser.add_argument('-f', '--format', choices=sorted(FORMATS), default='rgb565',
+                            help='pixel format of the output (default rgb565)')
+    cmd_parser.add_argument('input', help='input BMP, PNG or GIF file')
+    cmd_parser.add_argument('output', help='output .fbi file')
+    args = cmd_parser.parse_args()
+    try:
+        data = convert(*read_image(args.input), fmt=args.format)
+    except ValueError as er:
+        print('error: %s' % er, file=sys.stderr)
+        sys.exit(1)
+    with open(args.output, 'wb') as f:
+        f.write(data)
+
+
+if __name__ == '__main__':
+    main()
@@ -103,6 +103,8 @@ MP_NATIVE_ARCH_ARMV7EMSP = 7
 MP_NATIVE_ARCH_ARMV7EMDP = 8
 MP_NATIVE_ARCH_XTENSA = 9
 
+MP_SCOPE_FLAG_XIP = 0x40
+
 MP_OPCODE_BYTE = 0
 MP_OPCODE_QSTR = 1
 MP_OPCODE_VAR_UINT = 2
@@ -146,7 +148,7 @@ def make_opcode_format():
     OC4(U, O, B, O), # 0x3c-0x3f
     OC4(O, B, B, O), # 0x40-0x43
     OC4(O, U, O, B), # 0x44-0x47
-    OC4(U, U, U, U), # 0x48-0x4b
+    OC4(O, O, U, U), # 0x48-0x4b
     OC4(U, U, U, U), # 0x4c-0x4f
     OC4(V, V, U, V), # 0x50-0x53
     OC4(B, U, V, V), # 0x54-0x57
@@ -263,6 +265,14 @@ class RawCode(object):
     # a set of all escaped names, to make sure they are unique
     escaped_names = set()
 
+    # constant objects already emitted, keyed by type and value, so that
+    # identical constants across all frozen modules share one definition
+    const_pool = {}
+
+    # (source file, function name) of the functions that a profile showed to
+    # be hot, whose code is placed in RAM if the port supports it
+    hot_funcs = set()
+
     # convert code kind number to string
     code_kind_str = {
        MP_CODE_BYTECODE: 'MP_CODE_BYTECODE',
@@ -314,10 +324,45 @@ class RawCode(object):
         for rc in self.raw_codes:
             rc.freeze(self.escaped_name + '_')
 
+    def is_hot(self):
+        source_file = getattr(self, 'source_file', None)
+        return source_file is not None and (source_file.str, self.simple_name.str) in RawCode.hot_funcs
+
+    def print_fun_data_decl(self, const_decl):
+        # hot code goes in a writable array so the port can put it in RAM
+        if self.is_hot():
+            print('#ifdef MICROPY_FROZEN_HOT_ATTR')
+            print('STATIC byte fun_data_%s[%u] MICROPY_FROZEN_HOT_ATTR = {' % (self.escaped_name, len(self.bytecode)))
+            print('#else')
+            print(const_decl)
+            print('#endif')
+        else:
+            print(const_decl)
+
+    @staticmethod
+    def _const_pool_key(obj):
+        # floats are keyed by their bit pattern so that 0.0/-0.0 and nan stay distinct
+        if type(obj) is float:
+            return (float, struct.pack('<d', obj))
+        elif type(obj) is complex:
+            return (complex, struct.pack('<dd', obj.real, obj.imag))
+        else:
+            return (type(obj), obj)
+
     def freeze_constants(self):
         # generate constant objects
         for i, obj in enumerate(self.objs):
             obj_name = 'const_obj_%s_%u' % (self.escaped_name, i)
+            if obj is MPFunTable or obj is Ellipsis:
+                pool_key = None
+            else:
+                pool_key = RawCode._const_pool_key(obj)
+            if pool_key in RawCode.const_pool:
+                # reuse an identical object emitted earlier
+                print('#define %s %s' % (obj_name, RawCode.const_pool[pool_key]))
+                continue
+            elif pool_key is not None:
+                RawCode.const_pool[pool_key] = obj_name
             if obj is MPFunTable:
                 pass
             elif obj is Ellipsis:
@@ -431,10 +476,11 @@ class RawCodeBytecode(RawCode):
         # generate bytecode data
         print()
         print('// frozen bytecode for file %s, scope %s%s' % (self.source_file.str, parent_name, self.simple_name.str))
-        print('STATIC ', end='')
-        if not config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE:
-            print('const ', end='')
-        print('byte fun_data_%s[%u] = {' % (self.escaped_name, len(self.bytecode)))
+        if config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE:
+            # already in RAM
+            print('STATIC byte fun_data_%s[%u] = {' % (self.escaped_name, len(self.bytecode)))
+        else:
+            self.print_fun_data_decl('STATIC const byte fun_data_%s[%u] = {' % (self.escaped_name, len(self.bytecode)))
         print('   ', end='')
         for i in range(self.ip2):
             print(' 0x%02x,' % self.bytecode[i], end='')
@@ -514,7 +560,7 @@ class RawCodeNative(RawCode):
             print('// frozen viper code for scope %s' % (parent_name,))
         else:
             print('// frozen assembler code for scope %s' % (parent_name,))
-        print('STATIC const byte fun_data_%s[%u] %s = {' % (self.escaped_name, len(self.bytecode), self.fun_data_attributes))
+        self.print_fun_data_decl('STATIC const byte fun_data_%s[%u] %s = {' % (self.escaped_name, len(self.bytecode), self.fun_data_attributes))
 
         if self.code_kind == MP_CODE_NATIVE_PY:
             i_top = self.prelude_offset
@@ -654,13 +700,35 @@ def read_bytecode(file, bytecode, qstr_win):
         for _ in range(sz):
             read_byte(file, bytecode)
 
+def link_xip_bytecode(bytecode, qstrs, qstr_base):
+    # bytecode in the XIP form has indices into the const table in place of
+    # its qstrs, counting from qstr_base for qstrs[0]; put the qstrs back
+    def link(i):
+        qst = qstrs[(bytecode[i] | bytecode[i + 1] << 8) - qstr_base]
+        bytecode[i] = qst & 0xff
+        bytecode[i + 1] = qst >> 8
+    ip, ip2, _ = extract_prelude(bytecode, 0)
+    flags_idx, _ = decode_uint(bytecode, 0)
+    flags_idx, _ = decode_uint(bytecode, flags_idx)
+    bytecode[flags_idx] &= ~MP_SCOPE_FLAG_XIP
+    link(ip2)
+    link(ip2 + 2)
+    while ip < len(bytecode):
+        f, sz = mp_opcode_format(bytecode, ip, True)
+        if f == MP_OPCODE_QSTR:
+            link(ip + 1)
+        ip += sz
+
 def read_raw_code(f, qstr_win):
     kind_len = read_uint(f)
     kind = (kind_len & 3) + MP_CODE_BYTECODE
     fun_data_len = kind_len >> 2
     fun_data = BytecodeBuffer(fun_data_len)
 
-    if kind == MP_CODE_BYTECODE:
+    if kind == MP_CODE_BYTECODE and config.xip:
+        fun_data.buf[:] = f.read(fun_data_len)
+        _, name_idx, prelude = extract_prelude(fun_data.buf, 0)
+    elif kind == MP_CODE_BYTECODE:
         name_idx, prelude = read_prelude(f, fun_data)
         read_bytecode(f, fun_data, qstr_win)
     else:
@@ -688,7 +756,7 @@ def read_raw_code(f, qstr_win):
                 type_sig = read_uint(f)
             prelude = (None, None, scope_flags, n_pos_args, 0)
 
-    if kind in (MP_CODE_BYTECODE, MP_CODE_NATIVE_PY):
+    if (kind == MP_CODE_BYTECODE and not config.xip) or kind == MP_CODE_NATIVE_PY:
         fun_data.idx = name_idx # rewind to where qstrs are in prelude
         read_qstr_and_pack(f, fun_data, qstr_win) # simple_name
         read_qstr_and_pack(f, fun_data, qstr_win) # source_file
@@ -700,7 +768,13 @@ def read_raw_code(f, qstr_win):
         # load constant table
         n_obj = read_uint(f)
         n_raw_code = read_uint(f)
+        xip = kind == MP_CODE_BYTECODE and config.xip
+        if xip:
+            n_xip_qstr = read_uint(f)
         qstrs = [read_qstr(f, qstr_win) for _ in range(prelude[3] + prelude[4])]
+        if xip:
+            xip_qstrs = [read_qstr(f, qstr_win) for _ in range(n_xip_qstr)]
+            link_xip_bytecode(fun_data.buf, xip_qstrs, len(qstrs) + n_obj + n_raw_code)
         if kind != MP_CODE_BYTECODE:
             objs.append(MPFunTable)
         objs.extend([read_obj(f) for _ in range(n_obj)])
@@ -722,7 +796,9 @@ def read_mpy(filename):
         qw_size = read_uint(f)
         config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE = (feature_byte & 1) != 0
         config.MICROPY_PY_BUILTINS_STR_UNICODE = (feature_byte & 2) != 0
-        mpy_native_arch = feature_byte >> 2
+        config.MICROPY_OPT_SUPERINSTRUCTIONS = (feature_byte & 0x80) != 0
+        config.xip = (feature_byte & 0x40) != 0
+        mpy_native_arch = (feature_byte >> 2) & 0xf
         if mpy_native_arch != MP_NATIVE_ARCH_NONE:
             if config.native_arch == MP_NATIVE_ARCH_NONE:
                 config.native_arch = mpy_native_arch
@@ -757,6 +833,12 @@ def freeze_mpy(base_qstrs, raw_codes):
     print('#endif')
     print()
 
+    if config.MICROPY_OPT_SUPERINSTRUCTIONS:
+        print('#if !MICROPY_OPT_SUPERINSTRUCTIONS')
+        print('#error "incompatible MICROPY_OPT_SUPERINSTRUCTIONS"')
+        print('#endif')
+        print()
+
     print('#if MICROPY_LONGINT_IMPL != %u' % config.MICROPY_LONGINT_IMPL)
     print('#error "incompatible MICROPY_LONGINT_IMPL"')
     print('#endif')
@@ -840,10 +922,19 @@ def main():
         help='long-int implementation used by target (default mpz)')
     cmd_parser.add_argument('-mmpz-dig-size', metavar='N', type=int, default=16,
         help='mpz digit size used by target (default 16)')
+    cmd_parser.add_argument('--profile', action='append', default=[],
+        help='micropython.profile() output whose hot functions are placed in RAM (can be repeated)')
+    cmd_parser.add_argument('--hot', type=float, default=0.8,
+        help='fraction of the profile samples that the hot functions cover (default 0.8)')
     cmd_parser.add_argument('files', nargs='+',
         help='input .mpy files')
     args = cmd_parser.parse_args()
 
+    if args.profile:
+        import hotfuncs
+        for file, funcs in hotfuncs.hot_functions(args.profile, args.hot).items():
+            RawCode.hot_funcs.update((file, func) for func in funcs)
+
     # set config values relevant to target machine
     config.MICROPY_LONGINT_IMPL = {
         'none':config.MICROPY_LONGINT_IMPL_NONE,
@@ -1,20 +1,74 @@
 #!/usr/bin/env python3
 import argparse
+import json
 import os
 import os.path
+import sys
+
+import hotfuncs
 
 argparser = argparse.ArgumentParser(description="Compile all .py files to .mpy recursively")
 argparser.add_argument("-o", "--out", help="output directory (default: input dir)")
 argparser.add_argument("--target", help="select MicroPython target config")
 argparser.add_argument("-mcache-lookup-bc", action="store_true", help="cache map lookups in the bytecode")
+argparser.add_argument("-march", help="architecture for native code (default: from target, else host)")
+argparser.add_argument("--manifest", help="JSON file selecting modules/functions to emit as native or viper code")
+argparser.add_argument("--profile", action="append", default=[],
+    help="micropython.profile() output; its hot functions are emitted as native code (can be repeated)")
+argparser.add_argument("--hot", type=float, default=0.8,
+    help="fraction of the profile samples that the hot functions cover (default 0.8)")
+argparser.add_argument("--mpy-cross", default="mpy-cross", help="mpy-cross executable to use")
 argparser.add_argument("dir", help="input directory")
 args = argparser.parse_args()
 
 TARGET_OPTS = {
     "unix": "-mcache-lookup-bc",
     "baremetal": "",
+    "stm32": "-march=armv7m -msuperinstr",
 }
 
+# The manifest maps a .py path, relative to the input directory, to either a
+# default emitter for the whole module ("native", "viper" or "bytecode"), or
+# to an object with any of these keys:
+#   "emit": default emitter for the whole module
+#   "native": list of functions to emit as native code, "name" or "Class.name"
+#   "viper": list of functions to emit as viper code
+# For example:
+#   {"game/physics.py": {"native": ["step", "Body.update"]}, "fx.py": "native"}
+manifest = {}
+if args.manifest:
+    with open(args.manifest) as f:
+        manifest = json.load(f)
+
+# Functions hot in the profiles are added to the native list of their module,
+# unless the manifest chose an emitter for them or for the whole module.
+hot = hotfuncs.hot_functions(args.profile, args.hot) if args.profile else {}
+profile_only = set(rel_path for rel_path in hot if rel_path not in manifest)
+for rel_path, funcs in hot.items():
+    entry = manifest.get(rel_path, {})
+    if isinstance(entry, str):
+        continue
+    chosen = set(entry.get("native", []) + entry.get("viper", []))
+    funcs = [f for f in funcs if f not in chosen]
+    if funcs and "emit" not in entry:
+        print("%s: native %s" % (rel_path, ",".join(funcs)), file=sys.stderr)
+        entry["native"] = entry.get("native", []) + funcs
+        manifest[rel_path] = entry
+
+def manifest_opts(rel_path):
+    entry = manifest.pop(rel_path, None)
+    if entry is None:
+        return ""
+    if isinstance(entry, str):
+        entry = {"emit": entry}
+    opts = []
+    if "emit" in entry:
+        opts.append("-X emit=%s" % entry["emit"])
+    for kind in ("native", "viper"):
+        if entry.get(kind):
+            opts.append("-m%s=%s" % (kind, ",".join(entry[kind])))
+    return " ".join(opts)
+
 args.dir = args.dir.rstrip("/")
 
 if not args.out:
@@ -22,6 +76,13 @@ if not args.out:
 
 path_prefix_len = len(args.dir) + 1
 
+target_opts = TARGET_OPTS.get(args.target, "")
+if args.mcache_lookup_bc:
+    target_opts += " -mcache-lookup-bc"
+if args.march:
+    target_opts = " ".join(o for o in target_opts.split() if not o.startswith("-march="))
+    target_opts += " -march=" + args.march
+
 for path, subdirs, files in os.walk(args.dir):
     for f in files:
         if f.endswith(".py"):
@@ -31,8 +92,15 @@ for path, subdirs, files in os.walk(args.dir):
             out_dir = os.path.dirname(out_fpath)
             if not os.path.isdir(out_dir):
                 os.makedirs(out_dir)
-            cmd = "mpy-cross -v -v %s -s %s %s -o %s" % (TARGET_OPTS.get(args.target, ""),
-                fpath[path_prefix_len:], fpath, out_fpath)
+            cmd = "%s -v -v %s %s -s %s %s -o %s" % (args.mpy_cross, target_opts,
+                manifest_opts(fpath[path_prefix_len:]), fpath[path_prefix_len:], fpath, out_fpath)
             #print(cmd)
             res = os.system(cmd)
             assert res == 0
+
+# anything left in the manifest didn't match a file, which is likely a typo
+for rel_path in manifest:
+    if rel_path in profile_only:
+        # profiles also cover modules from elsewhere, eg frozen into the firmware
+        continue
+    print("warning: %s in manifest not found" % rel_path)
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Report on the opcode counts from a MicroPython built with
+MICROPY_VM_OPCODE_STATS, and list superinstruction candidates.
+
+The counts come from micropython.opcode_stats(), either printed to a file
+beforehand or collected by running a script under a unix build:
+
+    opcode_stats.py stats.txt
+    opcode_stats.py --run script.py [--micropython ports/unix/micropython]
+
+Opcodes are named from py/bc0.h, with the *_MULTI opcodes that carry their
+argument in the opcode byte grouped together.  A candidate is a pair of
+opcodes often run one after the other, where the first one doesn't jump, so
+the two could be fused into one opcode and save a dispatch each time.
+"""
+
+from __future__ import print_function
+import argparse
+import ast
+import os
+import re
+import subprocess
+import sys
+
+TOP = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+# opcodes after which the next one run isn't the next in the bytecode
+CONTROL_FLOW = {
+    "JUMP", "POP_JUMP_IF_TRUE", "POP_JUMP_IF_FALSE", "JUMP_IF_TRUE_OR_POP",
+    "JUMP_IF_FALSE_OR_POP", "FOR_ITER", "POP_EXCEPT_JUMP", "UNWIND_JUMP",
+    "END_FINALLY", "RETURN_VALUE", "RAISE_VARARGS", "YIELD_VALUE", "YIELD_FROM",
+}
+
+
+def load_opcode_names():
+    """Map each opcode byte to its name, grouping the *_MULTI ranges."""
+    names = {0: "<entry>"}
+    multi = []
+    with open(os.path.join(TOP, "py", "bc0.h")) as f:
+        for line in f:
+            m = re.match(r"#define MP_BC_(\w+)\s+\((0x[0-9a-f]+)\)", line)
+            if m:
+                name, op = m.group(1), int(m.group(2), 16)
+                if name.endswith("_MULTI"):
+                    multi.append((op, name))
+                else:
+                    names[op] = name
+    multi.sort()
+    for i, (op, name) in enumerate(multi):
+        end = multi[i + 1][0] if i + 1 < len(multi) else 256
+        for b in range(op, end):
+            names.setdefault(b, name)
+    return names
+
+
+def read_stats(args):
+    if args.run:
+        code = (
+            "import micropython\n"
+            "micropython.opcode_stats(True)\n"
+            "exec(open(%r).read(), {'__name__': '__main__'})\n"
+            "print(repr(micropython.opcode_stats()))\n" % args.run
+        )
+        out = subprocess.check_output([args.micropython, "-c", code])
+        text = out.decode().strip().splitlines()[-1]
+    else:
+        with open(args.input) as f:
+            text = f.read().strip().splitlines()[-1]
+    return ast.literal_eval(text)
+
+
+def merge(counts):
+    total = {}
+    for key, n in counts:
+        total[key] = total.get(key, 0) + n
+    return sorted(total.items(), key=lambda kv: -kv[1])
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description="Report on VM opcode counts.")
+    cmd_parser.add_argument("input", nargs="?", help="file with the printed opcode_stats() result")
+    cmd_parser.add_argument("--run", metavar="SCRIPT", help="run SCRIPT and report on it")
+    cmd_parser.add_argument(
+        "--micropython",
+        default=os.path.join(TOP, "ports", "unix", "micropython"),
+        help="unix build to run SCRIPT with",
+    )
+    cmd_parser.add_argument("-n", type=int, default=20, help="number of entries to list")
+    args = cmd_parser.parse_args()
+    if not args.input and not args.run:
+        cmd_parser.error("give a stats file or --run SCRIPT")
+
+    names = load_opcode_names()
+    name = lambda op: names.get(op, "0x%02x" % op)
+    ops, pairs = read_stats(args)
+    total = sum(n for _, n in ops) or 1
+
+    print("%d opcodes run" % total)
+    print()
+    print("opcodes:")
+    for op, n in merge((name(op), n) for op, n in ops)[: args.n]:
+        print("  %10d %5.1f%%  %s" % (n, 100 * n / total, op))
+
+    print()
+    print("pairs:")
+    named_pairs = merge(((name(a), name(b)), n) for a, b, n in pairs if a != 0)
+    for (a, b), n in named_pairs[: args.n]:
+        print("  %10d %5.1f%%  %s, %s" % (n, 100 * n / total, a, b))
+
+    print()
+    print("superinstruction candidates (dispatches saved):")
+    candidates = [(p, n) for p, n in named_pairs if p[0] not in CONTROL_FLOW]
+    for (a, b), n in candidates[: args.n]:
+        print("  %10d %5.1f%%  %s + %s" % (n, 100 * n / total, a, b))
+
+
+if __name__ == "__main__":
+    main()
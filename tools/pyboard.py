@@ -65,6 +65,11 @@ Or:
 
     python pyboard.py test.py
 
+To copy only the files of a local directory that differ from those on the
+board, compared by hashes computed on the board:
+
+    ./pyboard.py -f sync game :/flash/game
+
 """
 
 import sys
@@ -227,6 +232,7 @@ class ProcessPtyToTerminal:
 
 class Pyboard:
     def __init__(self, device, baudrate=115200, user='micro', password='python', wait=0):
+        self.use_raw_paste = True
         if device.startswith("exec:"):
             self.serial = ProcessToSerial(device[len("exec:"):])
         elif device.startswith("execpty:"):
@@ -332,6 +338,37 @@ class Pyboard:
         # return normal and error output
         return data, data_err
 
+    def raw_paste_write(self, command_bytes):
+        # read the window size that the device gives us
+        data = self.serial.read(2)
+        window_size = data[0] | data[1] << 8
+        window_remain = window_size
+
+        # write the command, no more than the device has room for
+        i = 0
+        while i < len(command_bytes):
+            while window_remain == 0 or self.serial.inWaiting():
+                data = self.serial.read(1)
+                if data == b'\x01':
+                    # device has room for another window
+                    window_remain += window_size
+                elif data == b'\x04':
+                    # device ended the transfer early; acknowledge it
+                    self.serial.write(b'\x04')
+                    return
+                else:
+                    raise PyboardError('unexpected read during raw paste: {}'.format(data))
+            b = command_bytes[i:min(i + window_remain, len(command_bytes))]
+            self.serial.write(b)
+            window_remain -= len(b)
+            i += len(b)
+
+        # indicate end of data, and wait for the device to acknowledge it
+        self.serial.write(b'\x04')
+        data = self.read_until(1, b'\x04')
+        if not data.endswith(b'\x04'):
+            raise PyboardError('could not complete raw paste: {}'.format(data))
+
     def exec_raw_no_follow(self, command):
         if isinstance(command, bytes):
             command_bytes = command
@@ -343,7 +380,22 @@ class Pyboard:
         if not data.endswith(b'>'):
             raise PyboardError('could not enter raw repl')
 
-        # write command
+        if self.use_raw_paste:
+            # try raw-paste mode, which has flow control
+            self.serial.write(b'\x05A\x01')
+            data = self.serial.read(2)
+            if data == b'R\x01':
+                return self.raw_paste_write(command_bytes)
+            elif data != b'R\x00':
+                # older firmware treats the command as a raw REPL reset
+                data = self.read_until(1, b'w REPL; CTRL-B to exit\r\n>')
+                if not data.endswith(b'w REPL; CTRL-B to exit\r\n>'):
+                    print(data)
+                    raise PyboardError('could not enter raw repl')
+            # don't try again on this connection
+            self.use_raw_paste = False
+
+        # write command in chunks, giving the device time to consume each one
         for i in range(0, len(command_bytes), 256):
             self.serial.write(command_bytes[i:min(i + 256, len(command_bytes))])
             time.sleep(0.01)
@@ -415,6 +467,106 @@ class Pyboard:
                     self.exec_('w(' + repr(data) + ')')
         self.exec_("f.close()")
 
+    def _fs_put_ack(self):
+        # Wait for the board to acknowledge a chunk; anything else means the
+        # receiver stopped, so collect its output and raise that.
+        ack = self.serial.read(1)
+        if ack != b'A':
+            data = b'' if ack == b'\x04' else ack + self.read_until(1, b'\x04')
+            data_err = self.read_until(1, b'\x04')
+            raise PyboardError('exception', data.rstrip(b'\x04'), data_err[:-1])
+
+    def fs_put_binary(self, src, dest, chunk_size=1024, window=2):
+        # Send the file as raw bytes read by the board from stdin, with
+        # Ctrl-C disabled, rather than as escaped Python source.  Up to
+        # window chunks are in flight, so the host sends the next chunk while
+        # the board writes the last one, and each is acknowledged with 'A'.
+        with open(src, 'rb') as f:
+            data = f.read()
+        self.exec_raw_no_follow(
+            "import sys,micropython\n"
+            "micropython.kbd_intr(-1)\n"
+            "r=sys.stdin.buffer.read\n"
+            "f=open('%s','wb')\n"
+            "sys.stdout.write('A')\n"
+            "n=%u\n"
+            "while n:\n"
+            " k=min(n,%u);b=r(k)\n"
+            " while len(b)<k:b+=r(k-len(b))\n"
+            " f.write(b);n-=k\n"
+            " sys.stdout.write('A')\n"
+            "f.close()" % (dest, len(data), chunk_size))
+        self._fs_put_ack()
+        pending = 0
+        for i in range(0, len(data), chunk_size):
+            if pending >= window:
+                self._fs_put_ack()
+                pending -= 1
+            self.serial.write(data[i:i + chunk_size])
+            pending += 1
+        while pending:
+            self._fs_put_ack()
+            pending -= 1
+        ret, ret_err = self.follow(10)
+        if ret_err:
+            raise PyboardError('exception', ret, ret_err)
+
+    def fs_hash(self, srcs):
+        # Return the hex SHA1 (or SHA256 if the board lacks SHA1) of each
+        # file on the board, or None for files that can't be read.
+        ret = self.exec_(
+            "import uhashlib,ubinascii\n"
+            "H=getattr(uhashlib,'sha1',uhashlib.sha256)\n"
+            "b=bytearray(512);m=memoryview(b)\n"
+            "for p in %r:\n"
+            " try:\n"
+            "  h=H()\n"
+            "  with open(p,'rb') as f:\n"
+            "   while 1:\n"
+            "    n=f.readinto(b)\n"
+            "    if not n:break\n"
+            "    h.update(m[:n])\n"
+            "  print(ubinascii.hexlify(h.digest()).decode())\n"
+            " except OSError:\n"
+            "  print('-')" % (list(srcs),))
+        return [None if h == '-' else h for h in str(ret, 'ascii').split()]
+
+    def fs_sync(self, src_dir, dest_dir, chunk_size=1024, window=2):
+        # Copy the files under src_dir that differ from those on the board
+        # under dest_dir, comparing hashes computed on the board, and make
+        # any directories needed.  Returns the list of files copied.
+        import hashlib
+        files = []
+        for root, dirs, names in os.walk(src_dir):
+            dirs.sort()
+            for name in sorted(names):
+                files.append(os.path.relpath(os.path.join(root, name), src_dir).replace(os.sep, '/'))
+        def remote(rel):
+            return dest_dir.rstrip('/') + '/' + rel if dest_dir else rel
+        changed = []
+        for rel, digest in zip(files, self.fs_hash(remote(rel) for rel in files)):
+            if digest is not None:
+                with open(os.path.join(src_dir, rel), 'rb') as f:
+                    h = hashlib.new('sha1' if len(digest) == 40 else 'sha256', f.read())
+                if h.hexdigest() == digest:
+                    continue
+            changed.append(rel)
+        dirs = sorted(set(remote(rel).rsplit('/', 1)[0] for rel in changed if '/' in remote(rel)))
+        if dirs:
+            self.exec_(
+                "import uos\n"
+                "for d in %r:\n"
+                " p=''\n"
+                " for c in d.split('/'):\n"
+                "  p+=c\n"
+                "  try:uos.mkdir(p)\n"
+                "  except OSError:pass\n"
+                "  p+='/'" % (dirs,))
+        for rel in changed:
+            print('cp %s :%s' % (os.path.join(src_dir, rel), remote(rel)))
+            self.fs_put_binary(os.path.join(src_dir, rel), remote(rel), chunk_size, window)
+        return changed
+
     def fs_mkdir(self, dir):
         self.exec_("import uos\nuos.mkdir('%s')" % dir)
 
@@ -454,7 +606,12 @@ def filesystem_command(pyb, args):
     cmd = args[0]
     args = args[1:]
     try:
-        if cmd == 'cp':
+        if cmd == 'sync':
+            src = args[0]
+            dest = fname_remote(args[1]) if len(args) > 1 else ''
+            changed = pyb.fs_sync(src, dest)
+            print('sync %s :%s, %u file(s) copied' % (src, dest, len(changed)))
+        elif cmd == 'cp':
             srcs = args[:-1]
             dest = args[-1]
             if srcs[0].startswith('./') or dest.startswith(':'):
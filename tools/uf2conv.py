@@ -46,6 +46,8 @@ families = {
     'STM32F1': 0x5ee21072,
     'STM32F4': 0x57755a57,
     'ATMEGA32': 0x16573617,
+    # MicroPython asset image for pyb.Asset, addresses are partition offsets
+    'MPY_ASSETS': 0x3e6a1b5d,
 }
 
 INFO_FILE = "/INFO_UF2.TXT"
@@ -251,8 +253,8 @@ def main():
     parser.add_argument('input', metavar='INPUT', type=str, nargs='?',
                         help='input file (HEX, BIN or UF2)')
     parser.add_argument('-b' , '--base', dest='base', type=str,
-                        default="0x2000",
-                        help='set base address of application for BIN format (default: 0x2000)')
+                        default=None,
+                        help='set base address of application for BIN format (default: 0x2000, or 0 for MPY_ASSETS)')
     parser.add_argument('-o' , '--output', metavar="FILE", dest='output', type=str,
                         help='write output to named file; defaults to "flash.uf2" or "flash.bin" where sensible')
     parser.add_argument('-d' , '--device', dest="device_path",
@@ -267,7 +269,6 @@ def main():
     parser.add_argument('-C' , '--carray', action='store_true',
                         help='convert binary file to a C array, not UF2')
     args = parser.parse_args()
-    appstartaddr = int(args.base, 0)
 
     if args.family.upper() in families:
         familyid = families[args.family.upper()]
@@ -277,6 +278,11 @@ def main():
         except ValueError:
             error("Family ID needs to be a number or one of: " + ", ".join(families.keys()))
 
+    if args.base is not None:
+        appstartaddr = int(args.base, 0)
+    elif familyid == families['MPY_ASSETS']:
+        appstartaddr = 0
+
     if args.list:
         list_drives()
     else: